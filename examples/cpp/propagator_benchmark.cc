@@ -0,0 +1,395 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//
+// Micro-benchmark of the propagators of the constraint solver.
+// For each propagator in --propagators, a random instance of the given size
+// is built around it, and explored with a random search (with a fixed seed)
+// up to a branch limit. The instance and the search tree only depend on the
+// flags, so that two versions of the solver can be compared.
+//
+// Each instance is solved twice:
+// - without profiling, to measure the time of the initial propagation, the
+//   search time and the number of demon runs per second,
+// - with the DemonProfiler, to get the number of demon invocations and the
+//   runtime of the benchmarked constraints only.
+// The results are written as one JSON object per line.
+
+#include <string>
+#include <vector>
+
+#include "base/commandlineflags.h"
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "base/random.h"
+#include "base/split.h"
+#include "base/stringprintf.h"
+#include "base/file.h"
+#include "base/timer.h"
+#include "constraint_solver/constraint_solver.h"
+#include "util/tuple_set.h"
+
+DEFINE_string(propagators,
+              "sum,scal_prod,element,alldiff,table,cumulative,disjunctive",
+              "Comma-separated list of the propagators to benchmark.");
+DEFINE_int32(benchmark_size, 50, "Number of variables of each instance.");
+DEFINE_int32(benchmark_domain_size, 100,
+             "Size of the domains of the variables.");
+DEFINE_int32(benchmark_seed, 0, "Seed of the instances and of the search.");
+DEFINE_int64(benchmark_branches, 100000,
+             "Maximum number of branches explored on each instance.");
+DEFINE_string(benchmark_output, "",
+              "File where the results are written. If empty, they are written "
+              "to the standard output.");
+
+namespace operations_research {
+
+extern void DemonProfilerVisitConstraints(
+    DemonProfiler* const monitor, std::function<void(const Constraint*)> visit);
+extern void DemonProfilerExportInformation(
+    DemonProfiler* const monitor, const Constraint* const constraint,
+    int64* const fails, int64* const initial_propagation_runtime,
+    int64* const demon_invocations, int64* const total_demon_runtime,
+    int* const demon_count);
+
+namespace {
+// A random instance: the benchmarked constraints, and the variables the
+// search branches on.
+struct Instance {
+  std::vector<Constraint*> constraints;
+  std::vector<IntVar*> decision_vars;
+};
+
+void MakeVars(Solver* const solver, int size, int64 max,
+              std::vector<IntVar*>* const vars) {
+  solver->MakeIntVarArray(size, 0, max, "x", vars);
+}
+
+void BuildSum(Solver* const solver, ACMRandom* const rand,
+              Instance* const instance) {
+  const int size = FLAGS_benchmark_size;
+  const int64 domain = FLAGS_benchmark_domain_size;
+  MakeVars(solver, size, domain - 1, &instance->decision_vars);
+  IntVar* const target =
+      solver->MakeIntVar(size * domain / 4, size * domain / 2, "target");
+  instance->constraints.push_back(
+      solver->MakeSumEquality(instance->decision_vars, target));
+}
+
+void BuildScalProd(Solver* const solver, ACMRandom* const rand,
+                   Instance* const instance) {
+  const int size = FLAGS_benchmark_size;
+  const int64 domain = FLAGS_benchmark_domain_size;
+  MakeVars(solver, size, domain - 1, &instance->decision_vars);
+  std::vector<int64> coefficients(size);
+  int64 total = 0;
+  for (int i = 0; i < size; ++i) {
+    coefficients[i] = 1 + rand->Uniform(10);
+    total += coefficients[i] * (domain - 1);
+  }
+  IntVar* const target = solver->MakeIntVar(total / 4, total / 2, "target");
+  instance->constraints.push_back(solver->MakeScalProdEquality(
+      instance->decision_vars, coefficients, target));
+}
+
+void BuildElement(Solver* const solver, ACMRandom* const rand,
+                  Instance* const instance) {
+  const int size = FLAGS_benchmark_size;
+  const int64 domain = FLAGS_benchmark_domain_size;
+  std::vector<int64> values(domain);
+  for (int i = 0; i < domain; ++i) {
+    values[i] = rand->Uniform(domain);
+  }
+  std::vector<IntVar*> targets;
+  MakeVars(solver, size, domain - 1, &instance->decision_vars);
+  MakeVars(solver, size, domain - 1, &targets);
+  for (int i = 0; i < size; ++i) {
+    instance->constraints.push_back(solver->MakeElementEquality(
+        values, instance->decision_vars[i], targets[i]));
+  }
+  // Links the targets, so that the search fails.
+  instance->constraints.push_back(solver->MakeSumLessOrEqual(
+      targets, size * domain / 3));
+}
+
+void BuildAllDifferent(Solver* const solver, ACMRandom* const rand,
+                       Instance* const instance) {
+  const int size = FLAGS_benchmark_size;
+  MakeVars(solver, size, std::max(size, FLAGS_benchmark_domain_size) - 1,
+           &instance->decision_vars);
+  instance->constraints.push_back(
+      solver->MakeAllDifferent(instance->decision_vars));
+  // Random forbidden values, so that the search fails.
+  for (int i = 0; i < size; ++i) {
+    instance->decision_vars[i]->RemoveValue(rand->Uniform(size));
+  }
+}
+
+void BuildTable(Solver* const solver, ACMRandom* const rand,
+                Instance* const instance) {
+  const int size = FLAGS_benchmark_size;
+  const int64 domain = FLAGS_benchmark_domain_size;
+  const int kArity = 3;
+  const int num_tuples = domain * domain / 4;
+  MakeVars(solver, size, domain - 1, &instance->decision_vars);
+  // Overlapping scopes: (x0, x1, x2), (x1, x2, x3), ...
+  for (int first = 0; first + kArity <= size; ++first) {
+    IntTupleSet tuples(kArity);
+    std::vector<int64> tuple(kArity);
+    for (int t = 0; t < num_tuples; ++t) {
+      for (int j = 0; j < kArity; ++j) {
+        tuple[j] = rand->Uniform(domain);
+      }
+      tuples.Insert(tuple);
+    }
+    std::vector<IntVar*> scope(instance->decision_vars.begin() + first,
+                               instance->decision_vars.begin() + first +
+                                   kArity);
+    instance->constraints.push_back(
+        solver->MakeAllowedAssignments(scope, tuples));
+  }
+}
+
+// Builds fixed-duration intervals whose start variables are the decision
+// variables.
+void MakeIntervals(Solver* const solver, ACMRandom* const rand, int64 horizon,
+                   std::vector<IntervalVar*>* const intervals,
+                   Instance* const instance) {
+  const int size = FLAGS_benchmark_size;
+  for (int i = 0; i < size; ++i) {
+    const int64 duration = 1 + rand->Uniform(FLAGS_benchmark_domain_size);
+    IntervalVar* const interval = solver->MakeFixedDurationIntervalVar(
+        0, horizon - duration, duration, false, StringPrintf("task%d", i));
+    intervals->push_back(interval);
+    instance->decision_vars.push_back(interval->StartExpr()->Var());
+  }
+}
+
+void BuildCumulative(Solver* const solver, ACMRandom* const rand,
+                     Instance* const instance) {
+  const int size = FLAGS_benchmark_size;
+  const int64 capacity = 10;
+  std::vector<IntervalVar*> intervals;
+  std::vector<int64> demands(size);
+  const int64 horizon = size * FLAGS_benchmark_domain_size / 4;
+  MakeIntervals(solver, rand, horizon, &intervals, instance);
+  for (int i = 0; i < size; ++i) {
+    demands[i] = 1 + rand->Uniform(capacity);
+  }
+  instance->constraints.push_back(
+      solver->MakeCumulative(intervals, demands, capacity, "cumulative"));
+}
+
+void BuildDisjunctive(Solver* const solver, ACMRandom* const rand,
+                      Instance* const instance) {
+  std::vector<IntervalVar*> intervals;
+  // A horizon shorter than the sum of the durations on average, so that the
+  // search fails.
+  const int64 horizon =
+      FLAGS_benchmark_size * FLAGS_benchmark_domain_size / 2;
+  MakeIntervals(solver, rand, horizon, &intervals, instance);
+  instance->constraints.push_back(
+      solver->MakeDisjunctiveConstraint(intervals, "disjunctive"));
+}
+
+// Returns false if the propagator is unknown.
+bool BuildInstance(const std::string& propagator, Solver* const solver,
+                   Instance* const instance) {
+  ACMRandom rand(FLAGS_benchmark_seed);
+  if (propagator == "sum") {
+    BuildSum(solver, &rand, instance);
+  } else if (propagator == "scal_prod") {
+    BuildScalProd(solver, &rand, instance);
+  } else if (propagator == "element") {
+    BuildElement(solver, &rand, instance);
+  } else if (propagator == "alldiff") {
+    BuildAllDifferent(solver, &rand, instance);
+  } else if (propagator == "table") {
+    BuildTable(solver, &rand, instance);
+  } else if (propagator == "cumulative") {
+    BuildCumulative(solver, &rand, instance);
+  } else if (propagator == "disjunctive") {
+    BuildDisjunctive(solver, &rand, instance);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Measures the wall time of the initial propagation.
+class InitialPropagationTimer : public SearchMonitor {
+ public:
+  explicit InitialPropagationTimer(Solver* const solver)
+      : SearchMonitor(solver), time_us_(0) {}
+  ~InitialPropagationTimer() override {}
+
+  void BeginInitialPropagation() override { timer_.Restart(); }
+  void EndInitialPropagation() override {
+    timer_.Stop();
+    time_us_ += timer_.GetInUsec();
+  }
+
+  int64 time_us() const { return time_us_; }
+
+ private:
+  WallTimer timer_;
+  int64 time_us_;
+};
+
+struct RunResult {
+  RunResult()
+      : initial_propagation_us(0),
+        search_us(0),
+        branches(0),
+        failures(0),
+        demon_runs(0),
+        deterministic_time(0.0),
+        constraint_demon_runs(0),
+        constraint_initial_propagation_us(0),
+        constraint_demon_runtime_us(0) {}
+  int64 initial_propagation_us;
+  int64 search_us;
+  int64 branches;
+  int64 failures;
+  int64 demon_runs;
+  double deterministic_time;
+  // Only filled by the profiled run.
+  int64 constraint_demon_runs;
+  int64 constraint_initial_propagation_us;
+  int64 constraint_demon_runtime_us;
+};
+
+void Run(const std::string& propagator, bool profile,
+         RunResult* const result) {
+  SolverParameters parameters;
+  if (profile) {
+    parameters.profile_level = SolverParameters::NORMAL_PROFILING;
+  }
+  Solver solver(propagator, parameters);
+  solver.ReSeed(FLAGS_benchmark_seed);
+  Instance instance;
+  CHECK(BuildInstance(propagator, &solver, &instance));
+  for (Constraint* const ct : instance.constraints) {
+    solver.AddConstraint(ct);
+  }
+  DecisionBuilder* const db =
+      solver.MakePhase(instance.decision_vars, Solver::CHOOSE_RANDOM,
+                       Solver::ASSIGN_RANDOM_VALUE);
+  InitialPropagationTimer* const init_timer =
+      solver.RevAlloc(new InitialPropagationTimer(&solver));
+  SearchLimit* const limit = solver.MakeLimit(
+      kint64max, FLAGS_benchmark_branches, kint64max, kint64max);
+  WallTimer timer;
+  timer.Start();
+  solver.NewSearch(db, init_timer, limit);
+  while (solver.NextSolution()) {
+  }
+  solver.EndSearch();
+  timer.Stop();
+  result->initial_propagation_us = init_timer->time_us();
+  result->search_us = timer.GetInUsec();
+  result->branches = solver.branches();
+  result->failures = solver.failures();
+  result->demon_runs = solver.demon_runs(Solver::NORMAL_PRIORITY) +
+                       solver.demon_runs(Solver::DELAYED_PRIORITY);
+  result->deterministic_time = solver.deterministic_time();
+  if (profile && solver.demon_profiler() != nullptr) {
+    // Constraints created inside the benchmarked ones (for instance by their
+    // decomposition) are counted too, since they implement the propagator.
+    DemonProfilerVisitConstraints(
+        solver.demon_profiler(), [&solver, result](const Constraint* ct) {
+          int64 fails = 0;
+          int64 initial_propagation_runtime = 0;
+          int64 demon_invocations = 0;
+          int64 total_demon_runtime = 0;
+          int demon_count = 0;
+          DemonProfilerExportInformation(
+              solver.demon_profiler(), ct, &fails,
+              &initial_propagation_runtime, &demon_invocations,
+              &total_demon_runtime, &demon_count);
+          result->constraint_demon_runs += demon_invocations;
+          result->constraint_initial_propagation_us +=
+              initial_propagation_runtime;
+          result->constraint_demon_runtime_us += total_demon_runtime;
+        });
+  }
+}
+}  // namespace
+
+// Benchmarks a propagator and returns its results as a JSON object.
+std::string BenchmarkPropagator(const std::string& propagator) {
+  RunResult plain;
+  RunResult profiled;
+  Run(propagator, false, &plain);
+  Run(propagator, true, &profiled);
+  const double search_s = std::max(plain.search_us, int64{1}) * 1e-6;
+  std::string out;
+  StringAppendF(&out, "{\"propagator\": \"%s\", \"size\": %d, ",
+                propagator.c_str(), FLAGS_benchmark_size);
+  StringAppendF(&out, "\"domain_size\": %d, \"seed\": %d, ",
+                FLAGS_benchmark_domain_size, FLAGS_benchmark_seed);
+  StringAppendF(&out, "\"initial_propagation_us\": %lld, ",
+                plain.initial_propagation_us);
+  StringAppendF(&out, "\"search_us\": %lld, ", plain.search_us);
+  StringAppendF(&out, "\"branches\": %lld, \"failures\": %lld, ",
+                plain.branches, plain.failures);
+  StringAppendF(&out, "\"demon_runs\": %lld, ", plain.demon_runs);
+  StringAppendF(&out, "\"demon_runs_per_s\": %.0f, ",
+                plain.demon_runs / search_s);
+  // Used to calibrate the weights of Solver::deterministic_time(), this ratio
+  // should be close to one.
+  StringAppendF(&out, "\"deterministic_time\": %.6f, ",
+                plain.deterministic_time);
+  StringAppendF(&out, "\"wall_time_per_deterministic_time\": %.3f, ",
+                plain.deterministic_time == 0.0
+                    ? 0.0
+                    : search_s / plain.deterministic_time);
+  StringAppendF(&out, "\"us_per_branch\": %.3f, ",
+                plain.branches == 0
+                    ? 0.0
+                    : 1.0 * (plain.search_us - plain.initial_propagation_us) /
+                          plain.branches);
+  StringAppendF(&out, "\"profiled_demon_runs\": %lld, ",
+                profiled.constraint_demon_runs);
+  StringAppendF(&out, "\"profiled_initial_propagation_us\": %lld, ",
+                profiled.constraint_initial_propagation_us);
+  StringAppendF(&out, "\"profiled_demon_runtime_us\": %lld}",
+                profiled.constraint_demon_runtime_us);
+  if (profiled.branches != plain.branches) {
+    LOG(WARNING) << propagator << ": the profiled search explored "
+                 << profiled.branches << " branches instead of "
+                 << plain.branches;
+  }
+  return out;
+}
+
+}  // namespace operations_research
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags( &argc, &argv, true);
+  const std::vector<std::string> propagators =
+      operations_research::strings::Split(
+          FLAGS_propagators, ",", operations_research::strings::SkipEmpty());
+  std::string output;
+  for (const std::string& propagator : propagators) {
+    output += operations_research::BenchmarkPropagator(propagator) + "\n";
+  }
+  if (FLAGS_benchmark_output.empty()) {
+    printf("%s", output.c_str());
+  } else {
+    CHECK(operations_research::file::SetContents(
+              FLAGS_benchmark_output, output,
+              operations_research::file::Defaults()).ok());
+  }
+  return 0;
+}
@@ -0,0 +1,502 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//
+// Benchmark of the routing library on standard instance sets.
+// Each instance given in --routing_benchmark_instances is loaded, solved with
+// deterministic limits (a solution limit instead of a time limit, no LNS,
+// whose sub-searches are time-limited, and a fixed operator selection seed),
+// and the following metrics are output as JSON:
+// - the time to find the first solution,
+// - the cost of each solution, with the time and the number of neighbors
+//   explored when it was found,
+// - the numbers of neighbors explored, accepted by the filters and accepted
+//   by the solver, and the rate at which the filters rejected neighbors,
+// - the peak memory usage observed during the search.
+// When --routing_benchmark_baseline is set, the final costs and solve times
+// are compared with the ones of a previous output of this program, and the
+// program returns a non-zero exit code if an instance regressed.
+//
+// Two file formats are supported:
+// - the Solomon format, also used by the Gehring & Homberger instances
+//   (http://www.sintef.no/Projectweb/TOP/VRPTW/),
+// - the Li & Lim format for pickup and delivery instances
+//   (http://www.sintef.no/Projectweb/TOP/PDPTW/Li--Lim-benchmark/Documentation/).
+// The format is detected from the first line of the file: Li & Lim files start
+// with a line of three integers, Solomon files with the instance name.
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "base/callback.h"
+#include "base/commandlineflags.h"
+#include "base/file.h"
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "base/split.h"
+#include "base/stringprintf.h"
+#include "base/strtoint.h"
+#include "base/sysinfo.h"
+#include "base/timer.h"
+#include "constraint_solver/routing.h"
+
+DECLARE_bool(routing_no_lns);
+DECLARE_int64(routing_solution_limit);
+DECLARE_int64(routing_time_limit);
+DECLARE_int32(routing_operator_selection_seed);
+DEFINE_string(routing_benchmark_instances, "",
+              "Comma-separated list of instance files to solve.");
+DEFINE_string(routing_benchmark_output, "",
+              "File where the JSON results are written. If empty, the results "
+              "are written to the standard output.");
+DEFINE_string(routing_benchmark_baseline, "",
+              "JSON results of a previous run to compare with.");
+DEFINE_double(routing_benchmark_cost_tolerance, 0.0,
+              "Relative cost increase over the baseline above which an "
+              "instance is reported as a regression.");
+DEFINE_double(routing_benchmark_time_tolerance, 0.2,
+              "Relative solve time increase over the baseline above which an "
+              "instance is reported as a regression.");
+DEFINE_int64(routing_benchmark_solution_limit, 100,
+             "Maximum number of solutions found on each instance.");
+DEFINE_int32(routing_benchmark_seed, 0,
+             "Seed of the randomized components of the search.");
+
+namespace operations_research {
+
+// Scaling factor used to scale up distances, allowing a bit more precision
+// from Euclidean distances.
+const int64 kScalingFactor = 1000;
+// Penalty for not visiting a node, which allows to find a first solution on
+// tight instances.
+const int64 kPenalty = 10000000000LL;
+
+// Data of an instance, unscaled.
+struct RoutingInstance {
+  RoutingInstance() : num_vehicles(0), capacity(0), horizon(0) {}
+
+  int num_vehicles;
+  int64 capacity;
+  int64 horizon;
+  std::vector<std::pair<int, int> > coords;
+  std::vector<int64> demands;
+  std::vector<int64> open_times;
+  std::vector<int64> close_times;
+  std::vector<int64> service_times;
+  // Pickup and delivery pairs, empty for Solomon instances.
+  std::vector<std::pair<int, int> > pairs;
+};
+
+// Returns the scaled Euclidean distance between two nodes.
+int64 Travel(const RoutingInstance* const instance,
+             RoutingModel::NodeIndex from, RoutingModel::NodeIndex to) {
+  const int xd = instance->coords[from.value()].first -
+                 instance->coords[to.value()].first;
+  const int yd = instance->coords[from.value()].second -
+                 instance->coords[to.value()].second;
+  return static_cast<int64>(kScalingFactor * sqrt(1.0L * xd * xd + yd * yd));
+}
+
+// Returns the scaled service time at 'from' plus the travel time to 'to'.
+int64 TravelPlusServiceTime(const RoutingInstance* const instance,
+                            RoutingModel::NodeIndex from,
+                            RoutingModel::NodeIndex to) {
+  return kScalingFactor * instance->service_times[from.value()] +
+         Travel(instance, from, to);
+}
+
+int64 Demand(const RoutingInstance* const instance,
+             RoutingModel::NodeIndex from, RoutingModel::NodeIndex to) {
+  return instance->demands[from.value()];
+}
+
+namespace {
+// Parses a whitespace-separated list of integers. Returns true iff the input
+// std::string was entirely valid and parsed.
+bool SafeParseInt64Array(const std::string& str, std::vector<int64>* parsed_int) {
+  static const char kWhiteSpaces[] = " \t\n\v\f\r";
+  std::vector<std::string> items = strings::Split(
+      str, strings::delimiter::AnyOf(kWhiteSpaces), strings::SkipEmpty());
+  parsed_int->assign(items.size(), 0);
+  for (int i = 0; i < items.size(); ++i) {
+    const char* item = items[i].c_str();
+    char* endptr = NULL;
+    (*parsed_int)[i] = strto64(item, &endptr, 10);
+    if (*endptr != '\0') return false;
+  }
+  return true;
+}
+
+void AddNode(RoutingInstance* const instance, int x, int y, int64 demand,
+             int64 open_time, int64 close_time, int64 service_time) {
+  instance->coords.push_back(std::make_pair(x, y));
+  instance->demands.push_back(demand);
+  instance->open_times.push_back(open_time);
+  instance->close_times.push_back(close_time);
+  instance->service_times.push_back(service_time);
+  instance->horizon = std::max(instance->horizon, close_time);
+}
+
+// Reads a Li & Lim file. The depot is the first node.
+bool ParseLiLim(const std::vector<std::string>& lines,
+                RoutingInstance* const instance) {
+  std::vector<int64> parsed_int;
+  if (!SafeParseInt64Array(lines[0], &parsed_int) || parsed_int.size() != 3) {
+    return false;
+  }
+  instance->num_vehicles = parsed_int[0];
+  instance->capacity = parsed_int[1];
+  for (int line_index = 1; line_index < lines.size(); ++line_index) {
+    if (!SafeParseInt64Array(lines[line_index], &parsed_int) ||
+        parsed_int.size() != 9) {
+      LOG(WARNING) << "Malformed line #" << line_index << ": "
+                   << lines[line_index];
+      return false;
+    }
+    if (parsed_int[0] != instance->coords.size()) {
+      LOG(WARNING) << "Nodes must be numbered consecutively from 0.";
+      return false;
+    }
+    const int pickup = parsed_int[7];
+    const int delivery = parsed_int[8];
+    // Demands are signed: negative for deliveries.
+    AddNode(instance, parsed_int[1], parsed_int[2], parsed_int[3],
+            parsed_int[4], parsed_int[5], parsed_int[6]);
+    if (pickup == 0 && delivery != 0) {
+      instance->pairs.push_back(std::make_pair(parsed_int[0], delivery));
+    }
+  }
+  return !instance->coords.empty();
+}
+
+// Reads a Solomon file: the vehicle section is the first line of two
+// integers, and the customers are the lines of seven integers, the first one
+// being the depot.
+bool ParseSolomon(const std::vector<std::string>& lines,
+                  RoutingInstance* const instance) {
+  std::vector<int64> parsed_int;
+  bool vehicles_parsed = false;
+  for (int line_index = 1; line_index < lines.size(); ++line_index) {
+    if (!SafeParseInt64Array(lines[line_index], &parsed_int) ||
+        parsed_int.empty()) {
+      continue;
+    }
+    if (!vehicles_parsed && parsed_int.size() == 2) {
+      instance->num_vehicles = parsed_int[0];
+      instance->capacity = parsed_int[1];
+      vehicles_parsed = true;
+    } else if (vehicles_parsed && parsed_int.size() == 7) {
+      AddNode(instance, parsed_int[1], parsed_int[2], parsed_int[3],
+              parsed_int[4], parsed_int[5], parsed_int[6]);
+    } else {
+      LOG(WARNING) << "Malformed line #" << line_index << ": "
+                   << lines[line_index];
+      return false;
+    }
+  }
+  return vehicles_parsed && !instance->coords.empty();
+}
+}  // namespace
+
+bool LoadInstance(const std::string& file_name,
+                  RoutingInstance* const instance) {
+  std::string contents;
+  if (!file::GetContents(file_name, &contents, file::Defaults()).ok()) {
+    LOG(WARNING) << "Could not read " << file_name;
+    return false;
+  }
+  const std::vector<std::string> lines =
+      strings::Split(contents, "\n", strings::SkipEmpty());
+  if (lines.empty()) {
+    LOG(WARNING) << "Empty file: " << file_name;
+    return false;
+  }
+  std::vector<int64> parsed_int;
+  if (SafeParseInt64Array(lines[0], &parsed_int) && parsed_int.size() == 3) {
+    return ParseLiLim(lines, instance);
+  }
+  return ParseSolomon(lines, instance);
+}
+
+// Records the cost of each solution, the search counters and the peak memory
+// usage.
+class BenchmarkMonitor : public SearchMonitor {
+ public:
+  BenchmarkMonitor(Solver* const solver, IntVar* const cost)
+      : SearchMonitor(solver),
+        cost_(cost),
+        first_solution_ms_(-1),
+        peak_memory_(0) {}
+  ~BenchmarkMonitor() override {}
+
+  void EnterSearch() override {
+    timer_.Restart();
+    UpdatePeakMemory();
+  }
+
+  void ExitSearch() override {
+    timer_.Stop();
+    UpdatePeakMemory();
+  }
+
+  bool AtSolution() override {
+    const int64 time_ms = timer_.GetInMs();
+    if (first_solution_ms_ == -1) {
+      first_solution_ms_ = time_ms;
+    }
+    SolutionRecord record;
+    record.time_ms = time_ms;
+    record.neighbors = solver()->neighbors();
+    record.cost = cost_->Value();
+    solutions_.push_back(record);
+    UpdatePeakMemory();
+    return false;
+  }
+
+  // Appends the metrics as the fields of a JSON object.
+  void AppendJsonFields(std::string* const out) const {
+    const Solver* const s = solver();
+    const int64 neighbors = s->neighbors();
+    const int64 filtered = s->filtered_neighbors();
+    StringAppendF(out, "\"first_solution_ms\": %lld, ", first_solution_ms_);
+    StringAppendF(out, "\"solve_ms\": %lld, ", timer_.GetInMs());
+    StringAppendF(out, "\"neighbors\": %lld, ", neighbors);
+    StringAppendF(out, "\"filtered_neighbors\": %lld, ", filtered);
+    StringAppendF(out, "\"accepted_neighbors\": %lld, ",
+                  s->accepted_neighbors());
+    StringAppendF(out, "\"filter_rejection_rate\": %.4f, ",
+                  neighbors == 0 ? 0.0 : 1.0 - 1.0 * filtered / neighbors);
+    StringAppendF(out, "\"failures\": %lld, ", s->failures());
+    StringAppendF(out, "\"peak_memory_bytes\": %lld, ", peak_memory_);
+    StringAppendF(out, "\"solutions\": [");
+    for (int i = 0; i < solutions_.size(); ++i) {
+      StringAppendF(out, "%s{\"time_ms\": %lld, \"neighbors\": %lld, "
+                    "\"cost\": %lld}",
+                    i == 0 ? "" : ", ", solutions_[i].time_ms,
+                    solutions_[i].neighbors, solutions_[i].cost);
+    }
+    StringAppendF(out, "]");
+  }
+
+  int64 solve_ms() const { return timer_.GetInMs(); }
+
+ private:
+  struct SolutionRecord {
+    int64 time_ms;
+    int64 neighbors;
+    int64 cost;
+  };
+
+  void UpdatePeakMemory() {
+    peak_memory_ = std::max(peak_memory_, GetProcessMemoryUsage());
+  }
+
+  IntVar* const cost_;
+  WallTimer timer_;
+  int64 first_solution_ms_;
+  int64 peak_memory_;
+  std::vector<SolutionRecord> solutions_;
+};
+
+// Results of an instance, as compared with the baseline.
+struct BenchmarkResult {
+  std::string name;
+  int64 cost;
+  int64 solve_ms;
+};
+
+// Solves an instance and appends its results to 'json' as a JSON object.
+// Returns false if the instance could not be loaded.
+bool RunInstance(const std::string& file_name, std::string* const json,
+                 BenchmarkResult* const result) {
+  RoutingInstance instance;
+  if (!LoadInstance(file_name, &instance)) {
+    return false;
+  }
+  const int num_nodes = instance.coords.size();
+  const RoutingModel::NodeIndex kDepot(0);
+  RoutingModel routing(num_nodes, instance.num_vehicles);
+  routing.SetDepot(kDepot);
+  const RoutingInstance* const data = &instance;
+  routing.SetArcCostEvaluatorOfAllVehicles(NewPermanentCallback(Travel, data));
+  routing.AddDimension(NewPermanentCallback(Demand, data), 0,
+                       instance.capacity, /*fix_start_cumul_to_zero=*/true,
+                       "demand");
+  const int64 horizon = kScalingFactor * instance.horizon;
+  routing.AddDimension(NewPermanentCallback(TravelPlusServiceTime, data),
+                       horizon, horizon, /*fix_start_cumul_to_zero=*/true,
+                       "time");
+  const RoutingDimension& time_dimension = routing.GetDimensionOrDie("time");
+  Solver* const solver = routing.solver();
+  for (RoutingModel::NodeIndex i(0); i < num_nodes; ++i) {
+    IntVar* const cumul = time_dimension.CumulVar(routing.NodeToIndex(i));
+    cumul->SetMin(kScalingFactor * instance.open_times[i.value()]);
+    cumul->SetMax(kScalingFactor * instance.close_times[i.value()]);
+  }
+  for (const std::pair<int, int>& pair : instance.pairs) {
+    const RoutingModel::NodeIndex pickup(pair.first);
+    const RoutingModel::NodeIndex delivery(pair.second);
+    const int64 pickup_index = routing.NodeToIndex(pickup);
+    const int64 delivery_index = routing.NodeToIndex(delivery);
+    solver->AddConstraint(solver->MakeEquality(
+        routing.VehicleVar(pickup_index), routing.VehicleVar(delivery_index)));
+    solver->AddConstraint(
+        solver->MakeLessOrEqual(time_dimension.CumulVar(pickup_index),
+                                time_dimension.CumulVar(delivery_index)));
+    routing.AddPickupAndDelivery(pickup, delivery);
+  }
+  for (RoutingModel::NodeIndex node(1); node < routing.nodes(); ++node) {
+    std::vector<RoutingModel::NodeIndex> nodes(1, node);
+    routing.AddDisjunction(nodes, kPenalty);
+  }
+  if (!instance.pairs.empty()) {
+    routing.set_first_solution_strategy(RoutingModel::ROUTING_ALL_UNPERFORMED);
+  }
+  // The monitor must be added before the model is closed.
+  BenchmarkMonitor* const monitor =
+      solver->RevAlloc(new BenchmarkMonitor(solver, routing.CostVar()));
+  routing.AddSearchMonitor(monitor);
+  routing.CloseModel();
+
+  const Assignment* const solution = routing.Solve();
+  result->name = file_name;
+  result->cost = solution != NULL ? solution->ObjectiveValue() : -1;
+  result->solve_ms = monitor->solve_ms();
+  StringAppendF(json, "{\"name\": \"%s\", \"nodes\": %d, \"vehicles\": %d, ",
+                file_name.c_str(), num_nodes, instance.num_vehicles);
+  StringAppendF(json, "\"pickup_delivery_pairs\": %d, ",
+                static_cast<int>(instance.pairs.size()));
+  StringAppendF(json, "\"final_cost\": %lld, ", result->cost);
+  monitor->AppendJsonFields(json);
+  StringAppendF(json, "}");
+  return true;
+}
+
+namespace {
+// Extracts the value of an integer field from a JSON object written by
+// RunInstance().
+bool GetIntField(const std::string& line, const std::string& field,
+                 int64* const value) {
+  const std::string key = "\"" + field + "\": ";
+  const size_t position = line.find(key);
+  if (position == std::string::npos) return false;
+  *value = strto64(line.c_str() + position + key.size(), NULL, 10);
+  return true;
+}
+
+// Extracts the name of the instance from a JSON object written by
+// RunInstance().
+bool GetName(const std::string& line, std::string* const name) {
+  const std::string key = "{\"name\": \"";
+  const size_t begin = line.find(key);
+  if (begin == std::string::npos) return false;
+  const size_t end = line.find('"', begin + key.size());
+  if (end == std::string::npos) return false;
+  *name = line.substr(begin + key.size(), end - begin - key.size());
+  return true;
+}
+}  // namespace
+
+// Compares the results with the ones stored in the baseline file, where
+// instances are written one per line. Returns the number of regressions.
+int CompareWithBaseline(const std::string& baseline_file,
+                        const std::vector<BenchmarkResult>& results) {
+  std::string contents;
+  if (!file::GetContents(baseline_file, &contents, file::Defaults()).ok()) {
+    LOG(WARNING) << "Could not read baseline " << baseline_file;
+    return 0;
+  }
+  int regressions = 0;
+  const std::vector<std::string> lines =
+      strings::Split(contents, "\n", strings::SkipEmpty());
+  for (const BenchmarkResult& result : results) {
+    bool found = false;
+    for (const std::string& line : lines) {
+      std::string name;
+      int64 cost = 0;
+      int64 solve_ms = 0;
+      if (!GetName(line, &name) || name != result.name ||
+          !GetIntField(line, "final_cost", &cost) ||
+          !GetIntField(line, "solve_ms", &solve_ms)) {
+        continue;
+      }
+      found = true;
+      const bool cost_regression =
+          result.cost == -1 ||
+          (cost != -1 &&
+           result.cost > cost * (1.0 + FLAGS_routing_benchmark_cost_tolerance));
+      const bool time_regression =
+          result.solve_ms >
+          solve_ms * (1.0 + FLAGS_routing_benchmark_time_tolerance);
+      LOG(INFO) << result.name << ": cost " << result.cost << " (baseline "
+                << cost << "), time " << result.solve_ms << "ms (baseline "
+                << solve_ms << "ms)"
+                << (cost_regression ? ", COST REGRESSION" : "")
+                << (time_regression ? ", TIME REGRESSION" : "");
+      if (cost_regression || time_regression) {
+        ++regressions;
+      }
+      break;
+    }
+    if (!found) {
+      LOG(INFO) << result.name << ": not in baseline";
+    }
+  }
+  return regressions;
+}
+
+}  // namespace operations_research
+
+using operations_research::BenchmarkResult;
+using operations_research::CompareWithBaseline;
+using operations_research::RunInstance;
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags( &argc, &argv, true);
+  // Deterministic search: solution limit, no time-limited LNS sub-searches and
+  // fixed seeds.
+  FLAGS_routing_no_lns = true;
+  FLAGS_routing_time_limit = kint64max;
+  FLAGS_routing_solution_limit = FLAGS_routing_benchmark_solution_limit;
+  FLAGS_routing_operator_selection_seed = FLAGS_routing_benchmark_seed;
+
+  const std::vector<std::string> instances = operations_research::strings::Split(
+      FLAGS_routing_benchmark_instances, ",",
+      operations_research::strings::SkipEmpty());
+  std::vector<BenchmarkResult> results;
+  std::string json = "{\"instances\": [\n";
+  for (const std::string& instance : instances) {
+    std::string instance_json;
+    BenchmarkResult result;
+    if (!RunInstance(instance, &instance_json, &result)) {
+      LOG(WARNING) << "Skipping " << instance;
+      continue;
+    }
+    json += (results.empty() ? "" : ",\n") + instance_json;
+    results.push_back(result);
+  }
+  json += "\n]}\n";
+  if (FLAGS_routing_benchmark_output.empty()) {
+    printf("%s", json.c_str());
+  } else {
+    CHECK(operations_research::file::SetContents(
+              FLAGS_routing_benchmark_output, json,
+              operations_research::file::Defaults()).ok());
+  }
+  if (!FLAGS_routing_benchmark_baseline.empty() &&
+      CompareWithBaseline(FLAGS_routing_benchmark_baseline, results) > 0) {
+    return 1;
+  }
+  return 0;
+}
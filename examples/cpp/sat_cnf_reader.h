@@ -14,16 +14,26 @@
 #ifndef OR_TOOLS_SAT_SAT_CNF_READER_H_
 #define OR_TOOLS_SAT_SAT_CNF_READER_H_
 
+#include <zlib.h>
 #include <map>
 #include <string>
 #include <vector>
+#if !defined(_MSC_VER)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "base/commandlineflags.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/strtoint.h"
 #include "base/split.h"
+#include "base/strutil.h"
 #include "sat/boolean_problem.pb.h"
+#include "sat/sat_base.h"
+#include "sat/sat_solver.h"
 #include "util/filelineiter.h"
 
 DEFINE_bool(wcnf_use_strong_slack, true,
@@ -38,9 +48,13 @@ namespace sat {
 //    http://people.sc.fsu.edu/~jburkardt/data/cnf/cnf.html
 //
 // It also support the wcnf input format for partial weighted max-sat problems.
+//
+// Pure sat problems can also be loaded directly into a SatSolver with
+// LoadIntoSolver(), which is much faster on large files since it tokenizes
+// the file in place and never builds the LinearBooleanProblem.
 class SatCnfReader {
  public:
-  SatCnfReader() : interpret_cnf_as_max_sat_(false) {}
+  SatCnfReader() : interpret_cnf_as_max_sat_(false), num_variables_(0) {}
 
   // If called with true, then a cnf file will be converted to the max-sat
   // problem: Try to minimize the number of unsatisfiable clauses.
@@ -92,7 +106,134 @@ class SatCnfReader {
     return true;
   }
 
+  // Loads the clauses of the given cnf file directly into the solver. The file
+  // is memory-mapped when possible, and otherwise streamed through zlib, which
+  // also reads gzipped files. Returns false if the problem was detected to be
+  // UNSAT while loading. The wcnf format is not supported.
+  bool LoadIntoSolver(const std::string& filename, SatSolver* solver) {
+    num_variables_ = 0;
+    num_clauses_ = 0;
+    direct_num_clauses_ = 0;
+    direct_header_seen_ = false;
+    direct_end_marker_seen_ = false;
+    direct_unsat_ = false;
+    clause_.clear();
+    bool loaded = false;
+#if !defined(_MSC_VER)
+    if (!HasSuffixString(filename, ".gz")) {
+      const int fd = open(filename.c_str(), O_RDONLY);
+      struct stat file_stat;
+      if (fd >= 0 && fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+        void* const data =
+            mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+          madvise(data, file_stat.st_size, MADV_SEQUENTIAL);
+          const char* const begin = static_cast<const char*>(data);
+          ParseCnfLines(begin, begin + file_stat.st_size, solver);
+          munmap(data, file_stat.st_size);
+          loaded = true;
+        }
+      }
+      if (fd >= 0) close(fd);
+    }
+#endif
+    if (!loaded) {
+      gzFile file = gzopen(filename.c_str(), "rb");
+      if (file == nullptr) {
+        LOG(FATAL) << "File '" << filename << "' can't be read.";
+      }
+      // Only complete lines are parsed; the end of the buffer after the last
+      // '\n' is kept for the next read.
+      const int kChunkSize = 1 << 20;
+      std::string buffer;
+      int pending = 0;
+      while (true) {
+        buffer.resize(pending + kChunkSize);
+        const int num_read = gzread(file, &buffer[pending], kChunkSize);
+        if (num_read <= 0) break;
+        const int size = pending + num_read;
+        int line_end = size;
+        while (line_end > 0 && buffer[line_end - 1] != '\n') --line_end;
+        ParseCnfLines(buffer.data(), buffer.data() + line_end, solver);
+        pending = size - line_end;
+        buffer.erase(0, line_end);
+      }
+      ParseCnfLines(buffer.data(), buffer.data() + pending, solver);
+      gzclose(file);
+    }
+    if (!direct_header_seen_) {
+      LOG(FATAL) << "File '" << filename << "' is empty or has no header.";
+    }
+    if (!clause_.empty()) {
+      LOG(FATAL) << "The last clause of '" << filename << "' is not ended.";
+    }
+    if (direct_num_clauses_ != num_clauses_) {
+      LOG(ERROR) << "Wrong number of clauses.";
+    }
+    return !direct_unsat_;
+  }
+
+  // Number of variables and of clauses, as given in the header, of the last
+  // problem loaded with LoadIntoSolver().
+  int num_variables() const { return num_variables_; }
+  int num_clauses() const { return num_clauses_; }
+
  private:
+  // Parses the complete lines in [begin, end) and adds their clauses to the
+  // solver. A clause may span several lines, so the literals read since the
+  // last 0 are kept in clause_.
+  void ParseCnfLines(const char* begin, const char* end, SatSolver* solver) {
+    const char* p = begin;
+    while (p < end && !direct_end_marker_seen_) {
+      const char c = *p;
+      if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+        ++p;
+      } else if (c == 'c') {
+        while (p < end && *p != '\n') ++p;
+      } else if (c == '%') {
+        direct_end_marker_seen_ = true;
+      } else if (c == 'p') {
+        const char* const line_begin = p;
+        while (p < end && *p != '\n') ++p;
+        const std::vector<std::string> words = strings::Split(
+            std::string(line_begin, p - line_begin), " ", strings::SkipEmpty());
+        if (words.size() < 4 || words[1] != "cnf") {
+          LOG(FATAL) << "Unsupported header: "
+                     << std::string(line_begin, p - line_begin);
+        }
+        num_variables_ = atoi64(words[2].c_str());
+        num_clauses_ = atoi64(words[3].c_str());
+        solver->SetNumVariables(num_variables_);
+        direct_header_seen_ = true;
+      } else {
+        bool negative = false;
+        if (c == '-') {
+          negative = true;
+          ++p;
+        }
+        int value = 0;
+        const char* const digits_begin = p;
+        while (p < end && *p >= '0' && *p <= '9') {
+          value = 10 * value + (*p - '0');
+          ++p;
+        }
+        if (p == digits_begin || !direct_header_seen_) {
+          LOG(FATAL) << "Unexpected character '" << c << "' in the cnf file.";
+        }
+        if (value == 0) {
+          ++direct_num_clauses_;
+          if (!direct_unsat_ && !solver->AddProblemClause(clause_)) {
+            direct_unsat_ = true;
+          }
+          clause_.clear();
+        } else {
+          DCHECK_LE(value, num_variables_);
+          clause_.push_back(Literal(negative ? -value : value));
+        }
+      }
+    }
+  }
+
   // Since the problem name is not stored in the cnf format, we infer it from
   // the file name.
   static std::string ExtractProblemName(const std::string& filename) {
@@ -226,6 +367,13 @@ class SatCnfReader {
   // Temporary storage for ProcessNewLine().
   std::vector<StringPiece> words_;
 
+  // Used by LoadIntoSolver().
+  std::vector<Literal> clause_;
+  int direct_num_clauses_;
+  bool direct_header_seen_;
+  bool direct_end_marker_seen_;
+  bool direct_unsat_;
+
   // We stores the objective in a map because we want the variables to appear
   // only once in the LinearObjective proto.
   std::map<int, int64> positive_literal_to_weight_;
@@ -11,6 +11,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -18,7 +19,10 @@
 #include "base/commandlineflags.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
+#include "base/split.h"
 #include "base/strtoint.h"
+#include "base/sysinfo.h"
+#include "base/threadpool.h"
 #include "base/timer.h"
 #include "base/file.h"
 #include "google/protobuf/descriptor.h"
@@ -27,8 +31,10 @@
 #include "base/strutil.h"
 #include "algorithms/sparse_permutation.h"
 #include "sat/boolean_problem.h"
+#include "sat/drat_writer.h"
 #include "cpp/opb_reader.h"
 #include "sat/optimization.h"
+#include "sat/portfolio.h"
 #include "cpp/sat_cnf_reader.h"
 #include "sat/sat_solver.h"
 #include "sat/simplification.h"
@@ -108,7 +114,35 @@ DEFINE_bool(refine_core, false,
 DEFINE_bool(reduce_memory_usage, false,
             "If true, do not keep a copy of the original problem in memory."
             "This reduce the memory usage, but disable the solution cheking at "
-            "the end.");
+            "the end. Pure sat cnf files are then loaded directly into the "
+            "solver, which is much faster on large files.");
+
+DEFINE_int32(num_threads, 1,
+             "Only work on pure SAT problem. If greater than one, solve the "
+             "problem with a portfolio of this many solvers sharing their "
+             "learned clauses.");
+
+DEFINE_string(drat_output, "",
+              "If non-empty, a DRAT proof of the unsatisfiability of the "
+              "problem is streamed to this file (or pipe) during the search. "
+              "Only valid for pure SAT problems.");
+
+DEFINE_bool(drat_binary, false,
+            "If true, the DRAT proof is written in the binary format.");
+
+DEFINE_string(benchmark_inputs, "",
+              "If non-empty, run in benchmark mode instead of solving --input: "
+              "solve the decision version of each of these comma-separated "
+              "files and output the time spent in each phase and the search "
+              "statistics of each of them.");
+
+DEFINE_int32(benchmark_threads, 1,
+             "In benchmark mode, number of files solved in parallel.");
+
+DEFINE_string(benchmark_output, "",
+              "In benchmark mode, file where the statistics are written, in "
+              "JSON if its extension is '.json' and in CSV otherwise. By "
+              "default, the CSV statistics are written to stdout.");
 
 namespace operations_research {
 namespace sat {
@@ -149,6 +183,14 @@ void LoadBooleanProblem(std::string filename, LinearBooleanProblem* problem) {
   }
 }
 
+// Returns true if the file is a cnf file that is read as a pure sat problem.
+bool IsPureSatCnfFile(const std::string& filename) {
+  return (HasSuffixString(filename, ".cnf") ||
+          HasSuffixString(filename, ".cnf.gz")) &&
+         !FLAGS_fu_malik && !FLAGS_linear_scan && !FLAGS_wpm1 &&
+         !FLAGS_qmaxsat && !FLAGS_core_enc;
+}
+
 std::string SolutionString(const LinearBooleanProblem& problem,
                       const std::vector<bool>& assignment) {
   std::string output;
@@ -161,6 +203,250 @@ std::string SolutionString(const LinearBooleanProblem& problem,
   return output;
 }
 
+// Presolves the problem loaded in *solver by alternating probing and the
+// SatPresolver until a fixed point is reached. The solver is replaced by a new
+// one holding the presolved problem. Returns false if the problem was proven
+// UNSAT.
+bool PresolveWithProbing(const SatParameters& parameters,
+                         std::unique_ptr<SatSolver>* solver,
+                         SatPostsolver* postsolver) {
+  // We use a new block so the memory used by the presolver can be
+  // reclaimed as soon as it is no longer needed.
+  //
+  // TODO(user): Automatically adapt the number of iterations.
+  for (int i = 0; i < 4; ++i) {
+    const int saved_num_variables = (*solver)->NumVariables();
+
+    // Probe + find equivalent literals.
+    ITIVector<LiteralIndex, LiteralIndex> equiv_map;
+    ProbeAndFindEquivalentLiteral(solver->get(), postsolver, &equiv_map);
+    if ((*solver)->IsModelUnsat()) {
+      printf("c unsat during probing!\n");
+      return false;
+    }
+
+    // Register the fixed variables with the presolver.
+    // TODO(user): Find a better place for this?
+    (*solver)->Backtrack(0);
+    for (int i = 0; i < (*solver)->LiteralTrail().Index(); ++i) {
+      postsolver->FixVariable((*solver)->LiteralTrail()[i]);
+    }
+
+    SatPresolver presolver(postsolver);
+    presolver.SetParameters(parameters);
+    presolver.SetEquivalentLiteralMapping(equiv_map);
+    (*solver)->ExtractClauses(&presolver);
+    solver->release();
+    if (!presolver.Presolve()) {
+      printf("c unsat during presolve!\n");
+
+      // This is just here for the satistics display below to work.
+      solver->reset(new SatSolver());
+      return false;
+    }
+
+    // Load the presolved problem in a new solver.
+    solver->reset(new SatSolver());
+    (*solver)->SetParameters(parameters);
+    presolver.LoadProblemIntoSatSolver(solver->get());
+    postsolver->ApplyMapping(presolver.VariableMapping());
+
+    // Stop if a fixed point has been reached.
+    if ((*solver)->NumVariables() == saved_num_variables) break;
+  }
+  return true;
+}
+
+// Statistics of the benchmark of one instance. Times are in seconds.
+struct BenchmarkResult {
+  BenchmarkResult()
+      : status(SatSolver::LIMIT_REACHED),
+        num_variables(0),
+        num_constraints(0),
+        load_time(0.0),
+        probing_time(0.0),
+        presolve_time(0.0),
+        search_time(0.0),
+        core_time(0.0),
+        core_size(-1),
+        conflicts(0),
+        branches(0),
+        propagations(0),
+        learned_clauses(0),
+        deterministic_time(0.0),
+        memory(0) {}
+
+  std::string filename;
+  SatSolver::Status status;
+  int num_variables;
+  int num_constraints;
+  double load_time;
+  double probing_time;
+  double presolve_time;
+  double search_time;
+  double core_time;
+  int core_size;
+  int64 conflicts;
+  int64 branches;
+  int64 propagations;
+  int64 learned_clauses;
+  double deterministic_time;
+  int64 memory;
+};
+
+// Solves the decision version of the problem in 'filename' and times each
+// phase. The probing, presolve and core extraction phases are only run when
+// the corresponding --probing, --presolve and --refine_core flags are set.
+// The memory is the one of the whole process when the search ends, so it
+// includes the instances solved concurrently.
+void BenchmarkInstance(const std::string& filename,
+                       const SatParameters& parameters,
+                       BenchmarkResult* const result) {
+  result->filename = filename;
+  WallTimer timer;
+  timer.Start();
+  std::unique_ptr<SatSolver> solver(new SatSolver());
+  solver->SetParameters(parameters);
+  bool loaded = false;
+  if (IsPureSatCnfFile(filename) && !FLAGS_probing) {
+    SatCnfReader reader;
+    loaded = reader.LoadIntoSolver(filename, solver.get());
+    result->num_variables = reader.num_variables();
+    result->num_constraints = reader.num_clauses();
+  } else {
+    LinearBooleanProblem problem;
+    LoadBooleanProblem(filename, &problem);
+    result->num_variables = problem.num_variables();
+    result->num_constraints = problem.constraints_size();
+    if (FLAGS_probing) {
+      result->load_time = timer.Get();
+      timer.Restart();
+      SatPostsolver probing_postsolver(problem.num_variables());
+      ProbeAndSimplifyProblem(&probing_postsolver, &problem);
+      result->probing_time = timer.Get();
+      timer.Restart();
+    }
+    loaded = LoadBooleanProblem(problem, solver.get());
+  }
+  result->load_time += timer.Get();
+  if (!loaded) {
+    result->status = SatSolver::MODEL_UNSAT;
+    return;
+  }
+  if (FLAGS_presolve) {
+    timer.Restart();
+    SatPostsolver postsolver(solver->NumVariables());
+    const bool feasible = PresolveWithProbing(parameters, &solver, &postsolver);
+    result->presolve_time = timer.Get();
+    if (!feasible) {
+      result->status = SatSolver::MODEL_UNSAT;
+      return;
+    }
+  }
+  timer.Restart();
+  result->status = solver->Solve();
+  result->search_time = timer.Get();
+  result->conflicts = solver->num_failures();
+  result->branches = solver->num_branches();
+  result->propagations = solver->num_propagations();
+  result->learned_clauses = solver->num_learned_clauses();
+  result->deterministic_time = solver->deterministic_time();
+  result->memory = GetProcessMemoryUsage();
+  if (result->status == SatSolver::MODEL_UNSAT && parameters.unsat_proof()) {
+    timer.Restart();
+    std::vector<int> core;
+    solver->ComputeUnsatCore(&core);
+    result->core_time = timer.Get();
+    result->core_size = core.size();
+  }
+}
+
+// Returns the results in CSV, with a header line, or in JSON.
+std::string BenchmarkResultsString(const std::vector<BenchmarkResult>& results,
+                              bool json) {
+  std::string output;
+  if (json) {
+    output = "[\n";
+  } else {
+    output =
+        "file,status,variables,constraints,load_s,probing_s,presolve_s,"
+        "search_s,core_s,core_size,conflicts,branches,propagations,"
+        "propagations_per_s,conflicts_per_s,learned_clauses,"
+        "deterministic_time,memory_bytes\n";
+  }
+  for (int i = 0; i < results.size(); ++i) {
+    const BenchmarkResult& r = results[i];
+    const double search_time = std::max(r.search_time, 1e-9);
+    const double propagations_per_s = r.propagations / search_time;
+    const double conflicts_per_s = r.conflicts / search_time;
+    const std::string status = SatStatusString(r.status);
+    if (json) {
+      StringAppendF(
+          &output,
+          "%s{\"file\": \"%s\", \"status\": \"%s\", \"variables\": %d, "
+          "\"constraints\": %d, \"load_s\": %f, \"probing_s\": %f, "
+          "\"presolve_s\": %f, \"search_s\": %f, \"core_s\": %f, "
+          "\"core_size\": %d, \"conflicts\": %lld, \"branches\": %lld, "
+          "\"propagations\": %lld, \"propagations_per_s\": %f, "
+          "\"conflicts_per_s\": %f, \"learned_clauses\": %lld, "
+          "\"deterministic_time\": %f, \"memory_bytes\": %lld}",
+          i == 0 ? "" : ",\n", r.filename.c_str(), status.c_str(),
+          r.num_variables, r.num_constraints, r.load_time, r.probing_time,
+          r.presolve_time, r.search_time, r.core_time, r.core_size,
+          r.conflicts, r.branches, r.propagations, propagations_per_s,
+          conflicts_per_s, r.learned_clauses, r.deterministic_time, r.memory);
+    } else {
+      StringAppendF(&output,
+                    "%s,%s,%d,%d,%f,%f,%f,%f,%f,%d,%lld,%lld,%lld,%f,%f,%lld,"
+                    "%f,%lld\n",
+                    r.filename.c_str(), status.c_str(), r.num_variables,
+                    r.num_constraints, r.load_time, r.probing_time,
+                    r.presolve_time, r.search_time, r.core_time, r.core_size,
+                    r.conflicts, r.branches, r.propagations,
+                    propagations_per_s, conflicts_per_s, r.learned_clauses,
+                    r.deterministic_time, r.memory);
+    }
+  }
+  if (json) output += "\n]\n";
+  return output;
+}
+
+// Benchmarks all the files of --benchmark_inputs, --benchmark_threads at a
+// time, and outputs their statistics.
+int RunBenchmark() {
+  SatParameters parameters;
+  if (!FLAGS_params.empty()) {
+    CHECK(google::protobuf::TextFormat::MergeFromString(FLAGS_params, &parameters))
+        << FLAGS_params;
+  }
+  if (FLAGS_refine_core) {
+    parameters.set_unsat_proof(true);
+    parameters.set_treat_binary_clauses_separately(false);
+  }
+  parameters.set_log_search_progress(false);
+  const std::vector<std::string> inputs =
+      strings::Split(FLAGS_benchmark_inputs, ",", strings::SkipEmpty());
+  std::vector<BenchmarkResult> results(inputs.size());
+  {
+    ThreadPool pool("SatBenchmark", std::max(1, FLAGS_benchmark_threads));
+    pool.StartWorkers();
+    for (int i = 0; i < inputs.size(); ++i) {
+      pool.Schedule([i, &inputs, &parameters, &results]() {
+        BenchmarkInstance(inputs[i], parameters, &results[i]);
+      });
+    }
+  }
+  const bool json = HasSuffixString(FLAGS_benchmark_output, ".json");
+  const std::string output = BenchmarkResultsString(results, json);
+  if (FLAGS_benchmark_output.empty()) {
+    printf("%s", output.c_str());
+  } else {
+    CHECK_OK(file::SetContents(FLAGS_benchmark_output, output,
+                               file::Defaults()));
+  }
+  return 0;
+}
+
 // To benefit from the operations_research namespace, we put all the main() code
 // here.
 int Run() {
@@ -187,11 +473,34 @@ int Run() {
   // Initialize the solver.
   std::unique_ptr<SatSolver> solver(new SatSolver());
   solver->SetParameters(parameters);
+  std::unique_ptr<DratWriter> drat_writer;
+  if (!FLAGS_drat_output.empty()) {
+    CHECK(!FLAGS_presolve && !FLAGS_probing && !FLAGS_use_symmetry)
+        << "incompatible";
+    CHECK_LE(FLAGS_num_threads, 1) << "incompatible";
+    drat_writer.reset(new DratWriter(
+        FLAGS_drat_binary, File::OpenOrDie(FLAGS_drat_output, "w")));
+    solver->SetDratWriter(drat_writer.get());
+  }
 
-  // Read the problem.
+  // Read the problem. Pure sat cnf files are loaded directly into the solver
+  // when the original problem does not need to be kept.
   LinearBooleanProblem problem;
-  LoadBooleanProblem(FLAGS_input, &problem);
-  if (FLAGS_strict_validity) {
+  const bool direct_cnf_loading =
+      FLAGS_reduce_memory_usage && IsPureSatCnfFile(FLAGS_input) &&
+      !FLAGS_probing && FLAGS_output.empty() && FLAGS_lower_bound.empty() &&
+      FLAGS_upper_bound.empty();
+  if (direct_cnf_loading) {
+    SatCnfReader reader;
+    if (!reader.LoadIntoSolver(FLAGS_input, solver.get())) {
+      LOG(INFO) << "UNSAT when loading the problem.";
+    }
+    problem.set_num_variables(reader.num_variables());
+    problem.set_original_num_variables(reader.num_variables());
+  } else {
+    LoadBooleanProblem(FLAGS_input, &problem);
+  }
+  if (FLAGS_strict_validity && !direct_cnf_loading) {
     const util::Status status = ValidateBooleanProblem(problem);
     if (!status.ok()) {
       LOG(ERROR) << "Invalid Boolean problem: " << status.error_message();
@@ -216,7 +525,9 @@ int Run() {
   }
 
   // Load the problem into the solver.
-  if (FLAGS_reduce_memory_usage) {
+  if (direct_cnf_loading) {
+    // Already loaded.
+  } else if (FLAGS_reduce_memory_usage) {
     if (!LoadAndConsumeBooleanProblem(&problem, solver.get())) {
       LOG(INFO) << "UNSAT when loading the problem.";
     }
@@ -237,7 +548,8 @@ int Run() {
     CHECK(!FLAGS_reduce_memory_usage) << "incompatible";
     LOG(INFO) << "Finding symmetries of the problem.";
     std::vector<std::unique_ptr<SparsePermutation>> generators;
-    FindLinearBooleanProblemSymmetries(problem, &generators);
+    FindLinearBooleanProblemSymmetries(
+        problem, parameters.max_time_in_seconds(), &generators);
     solver->AddSymmetries(&generators);
   }
 
@@ -279,53 +591,9 @@ int Run() {
     if (FLAGS_presolve) {
       SatPostsolver postsolver(problem.num_variables());
 
-      // We use a new block so the memory used by the presolver can be
-      // reclaimed as soon as it is no longer needed.
-      //
-      // TODO(user): Automatically adapt the number of iterations.
-      result = SatSolver::MODEL_SAT;
-      for (int i = 0; i < 4; ++i) {
-        const int saved_num_variables = solver->NumVariables();
-
-        // Probe + find equivalent literals.
-        ITIVector<LiteralIndex, LiteralIndex> equiv_map;
-        ProbeAndFindEquivalentLiteral(solver.get(), &postsolver, &equiv_map);
-        if (solver->IsModelUnsat()) {
-          printf("c unsat during probing!\n");
-          result = SatSolver::MODEL_UNSAT;
-          break;
-        }
-
-        // Register the fixed variables with the presolver.
-        // TODO(user): Find a better place for this?
-        solver->Backtrack(0);
-        for (int i = 0; i < solver->LiteralTrail().Index(); ++i) {
-          postsolver.FixVariable(solver->LiteralTrail()[i]);
-        }
-
-        SatPresolver presolver(&postsolver);
-        presolver.SetParameters(parameters);
-        presolver.SetEquivalentLiteralMapping(equiv_map);
-        solver->ExtractClauses(&presolver);
-        solver.release();
-        if (!presolver.Presolve()) {
-          printf("c unsat during presolve!\n");
-
-          // This is just here for the satistics display below to work.
-          solver.reset(new SatSolver());
-          result = SatSolver::MODEL_UNSAT;
-          break;
-        }
-
-        // Load the presolved problem in a new solver.
-        solver.reset(new SatSolver());
-        solver->SetParameters(parameters);
-        presolver.LoadProblemIntoSatSolver(solver.get());
-        postsolver.ApplyMapping(presolver.VariableMapping());
-
-        // Stop if a fixed point has been reached.
-        if (solver->NumVariables() == saved_num_variables) break;
-      }
+      result = PresolveWithProbing(parameters, &solver, &postsolver)
+                   ? SatSolver::MODEL_SAT
+                   : SatSolver::MODEL_UNSAT;
 
       // Solve.
       if (result != SatSolver::MODEL_UNSAT) {
@@ -337,6 +605,16 @@ int Run() {
         solution = postsolver.ExtractAndPostsolveSolution(*solver);
         CHECK(IsAssignmentValid(problem, solution));
       }
+    } else if (FLAGS_num_threads > 1) {
+      CHECK(!FLAGS_use_symmetry) << "incompatible";
+      CHECK(!FLAGS_reduce_memory_usage) << "incompatible";
+      CHECK(FLAGS_lower_bound.empty() && FLAGS_upper_bound.empty())
+          << "incompatible";
+      result = SolveWithPortfolio(problem, parameters, FLAGS_num_threads,
+                                  &solution);
+      if (result == SatSolver::MODEL_SAT) {
+        CHECK(IsAssignmentValid(problem, solution));
+      }
     } else {
       result = solver->Solve();
       if (result == SatSolver::MODEL_SAT) {
@@ -456,5 +734,8 @@ static const char kUsage[] =
 int main(int argc, char** argv) {
   gflags::SetUsageMessage(kUsage);
   gflags::ParseCommandLineFlags(&argc, &argv, true);
+  if (!FLAGS_benchmark_inputs.empty()) {
+    return operations_research::sat::RunBenchmark();
+  }
   return operations_research::sat::Run();
 }
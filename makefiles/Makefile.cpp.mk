@@ -313,6 +313,8 @@ CPBINARIES = \
 	$(BIN_DIR)/network_routing$E \
 	$(BIN_DIR)/nqueens$E \
 	$(BIN_DIR)/pdptw$E \
+	$(BIN_DIR)/propagator_benchmark$E \
+	$(BIN_DIR)/routing_benchmark$E \
 	$(BIN_DIR)/dimacs_assignment$E \
 	$(BIN_DIR)/sports_scheduling$E \
 	$(BIN_DIR)/tsp$E
@@ -451,8 +453,10 @@ CONSTRAINT_SOLVER_LIB_OBJS = \
 	$(OBJ_DIR)/constraint_solver/local_search.$O\
 	$(OBJ_DIR)/constraint_solver/model.pb.$O\
 	$(OBJ_DIR)/constraint_solver/model_cache.$O\
+	$(OBJ_DIR)/constraint_solver/model_template.$O\
 	$(OBJ_DIR)/constraint_solver/nogoods.$O\
 	$(OBJ_DIR)/constraint_solver/pack.$O\
+	$(OBJ_DIR)/constraint_solver/portfolio.$O\
 	$(OBJ_DIR)/constraint_solver/range_cst.$O\
 	$(OBJ_DIR)/constraint_solver/resource.$O\
 	$(OBJ_DIR)/constraint_solver/sat_constraint.$O\
@@ -500,7 +504,7 @@ $(OBJ_DIR)/constraint_solver/constraints.$O:$(SRC_DIR)/constraint_solver/constra
 $(OBJ_DIR)/constraint_solver/count_cst.$O:$(SRC_DIR)/constraint_solver/count_cst.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/constraint_solver/count_cst.cc $(OBJ_OUT)$(OBJ_DIR)$Sconstraint_solver$Scount_cst.$O
 
-$(OBJ_DIR)/constraint_solver/default_search.$O:$(SRC_DIR)/constraint_solver/default_search.cc
+$(OBJ_DIR)/constraint_solver/default_search.$O:$(SRC_DIR)/constraint_solver/default_search.cc $(GEN_DIR)/constraint_solver/model.pb.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/constraint_solver/default_search.cc $(OBJ_OUT)$(OBJ_DIR)$Sconstraint_solver$Sdefault_search.$O
 
 $(OBJ_DIR)/constraint_solver/demon_profiler.$O:$(SRC_DIR)/constraint_solver/demon_profiler.cc $(GEN_DIR)/constraint_solver/demon_profiler.pb.h
@@ -559,6 +563,9 @@ $(OBJ_DIR)/constraint_solver/model.pb.$O:$(GEN_DIR)/constraint_solver/model.pb.c
 $(OBJ_DIR)/constraint_solver/model_cache.$O:$(SRC_DIR)/constraint_solver/model_cache.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/constraint_solver/model_cache.cc $(OBJ_OUT)$(OBJ_DIR)$Sconstraint_solver$Smodel_cache.$O
 
+$(OBJ_DIR)/constraint_solver/model_template.$O:$(SRC_DIR)/constraint_solver/model_template.cc $(SRC_DIR)/constraint_solver/model_template.h $(GEN_DIR)/constraint_solver/model.pb.h
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)/constraint_solver/model_template.cc $(OBJ_OUT)$(OBJ_DIR)$Sconstraint_solver$Smodel_template.$O
+
 $(GEN_DIR)/constraint_solver/model.pb.cc:$(SRC_DIR)/constraint_solver/model.proto
 	$(PROTOBUF_DIR)/bin/protoc --proto_path=$(INC_DIR) --cpp_out=$(GEN_DIR) $(SRC_DIR)/constraint_solver/model.proto
 
@@ -570,6 +577,9 @@ $(OBJ_DIR)/constraint_solver/nogoods.$O:$(SRC_DIR)/constraint_solver/nogoods.cc
 $(OBJ_DIR)/constraint_solver/pack.$O:$(SRC_DIR)/constraint_solver/pack.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/constraint_solver/pack.cc $(OBJ_OUT)$(OBJ_DIR)$Sconstraint_solver$Spack.$O
 
+$(OBJ_DIR)/constraint_solver/portfolio.$O:$(SRC_DIR)/constraint_solver/portfolio.cc
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)/constraint_solver/portfolio.cc $(OBJ_OUT)$(OBJ_DIR)$Sconstraint_solver$Sportfolio.$O
+
 $(OBJ_DIR)/constraint_solver/range_cst.$O:$(SRC_DIR)/constraint_solver/range_cst.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/constraint_solver/range_cst.cc $(OBJ_OUT)$(OBJ_DIR)$Sconstraint_solver$Srange_cst.$O
 
@@ -631,6 +641,7 @@ endif
 # Linear Solver Library
 
 LINEAR_SOLVER_LIB_OBJS = \
+	$(OBJ_DIR)/linear_solver/batch_solver.$O \
 	$(OBJ_DIR)/linear_solver/bop_interface.$O \
 	$(OBJ_DIR)/linear_solver/glop_interface.$O \
 	$(OBJ_DIR)/linear_solver/cbc_interface.$O \
@@ -646,6 +657,9 @@ LINEAR_SOLVER_LIB_OBJS = \
 	$(OBJ_DIR)/linear_solver/sulum_interface.$O
 
 
+$(OBJ_DIR)/linear_solver/batch_solver.$O:$(SRC_DIR)/linear_solver/batch_solver.cc $(GEN_DIR)/linear_solver/linear_solver.pb.h
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Slinear_solver$Sbatch_solver.cc $(OBJ_OUT)$(OBJ_DIR)$Slinear_solver$Sbatch_solver.$O
+
 $(OBJ_DIR)/linear_solver/cbc_interface.$O:$(SRC_DIR)/linear_solver/cbc_interface.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/linear_solver/cbc_interface.cc $(OBJ_OUT)$(OBJ_DIR)$Slinear_solver$Scbc_interface.$O
 
@@ -755,15 +769,21 @@ endif
 GRAPH_LIB_OBJS=\
 	$(OBJ_DIR)/graph/simple_assignment.$O \
 	$(OBJ_DIR)/graph/linear_assignment.$O \
+	$(OBJ_DIR)/graph/auction_assignment.$O \
 	$(OBJ_DIR)/graph/cliques.$O \
 	$(OBJ_DIR)/graph/connectivity.$O \
 	$(OBJ_DIR)/graph/flow_problem.pb.$O \
+	$(OBJ_DIR)/graph/graph_file.$O \
 	$(OBJ_DIR)/graph/max_flow.$O \
-	$(OBJ_DIR)/graph/min_cost_flow.$O
+	$(OBJ_DIR)/graph/min_cost_flow.$O \
+	$(OBJ_DIR)/graph/network_simplex.$O
 
 $(OBJ_DIR)/graph/linear_assignment.$O:$(SRC_DIR)/graph/linear_assignment.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/graph/linear_assignment.cc $(OBJ_OUT)$(OBJ_DIR)$Sgraph$Slinear_assignment.$O
 
+$(OBJ_DIR)/graph/auction_assignment.$O:$(SRC_DIR)/graph/auction_assignment.cc
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)/graph/auction_assignment.cc $(OBJ_OUT)$(OBJ_DIR)$Sgraph$Sauction_assignment.$O
+
 $(OBJ_DIR)/graph/simple_assignment.$O:$(SRC_DIR)/graph/assignment.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/graph/assignment.cc $(OBJ_OUT)$(OBJ_DIR)$Sgraph$Ssimple_assignment.$O
 
@@ -773,6 +793,9 @@ $(OBJ_DIR)/graph/cliques.$O:$(SRC_DIR)/graph/cliques.cc
 $(OBJ_DIR)/graph/connectivity.$O:$(SRC_DIR)/graph/connectivity.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/graph/connectivity.cc $(OBJ_OUT)$(OBJ_DIR)$Sgraph$Sconnectivity.$O
 
+$(OBJ_DIR)/graph/graph_file.$O:$(SRC_DIR)/graph/graph_file.cc
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)/graph/graph_file.cc $(OBJ_OUT)$(OBJ_DIR)$Sgraph$Sgraph_file.$O
+
 $(GEN_DIR)/graph/flow_problem.pb.cc:$(SRC_DIR)/graph/flow_problem.proto
 	 $(PROTOBUF_DIR)$Sbin$Sprotoc --proto_path=$(INC_DIR) --cpp_out=$(GEN_DIR) $(SRC_DIR)$Sgraph$Sflow_problem.proto
 
@@ -789,6 +812,9 @@ $(OBJ_DIR)/graph/max_flow.$O:$(SRC_DIR)/graph/max_flow.cc $(SRC_DIR)/util/stats.
 $(OBJ_DIR)/graph/min_cost_flow.$O:$(SRC_DIR)/graph/min_cost_flow.cc $(GEN_DIR)/graph/flow_problem.pb.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/graph/min_cost_flow.cc $(OBJ_OUT)$(OBJ_DIR)$Sgraph$Smin_cost_flow.$O
 
+$(OBJ_DIR)/graph/network_simplex.$O:$(SRC_DIR)/graph/network_simplex.cc $(GEN_DIR)/graph/flow_problem.pb.h
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)/graph/network_simplex.cc $(OBJ_OUT)$(OBJ_DIR)$Sgraph$Snetwork_simplex.$O
+
 $(LIB_DIR)/$(LIBPREFIX)graph.$(DYNAMIC_LIB_SUFFIX): $(GRAPH_LIB_OBJS)
 	$(DYNAMIC_LINK_CMD) $(DYNAMIC_LINK_PREFIX)$(LIB_DIR)$S$(LIBPREFIX)graph.$(DYNAMIC_LIB_SUFFIX) $(GRAPH_LIB_OBJS)
 
@@ -801,12 +827,16 @@ endif
 
 SHORTESTPATHS_LIB_OBJS=\
 	$(OBJ_DIR)/graph/bellman_ford.$O \
+	$(OBJ_DIR)/graph/contraction_hierarchy.$O \
 	$(OBJ_DIR)/graph/dijkstra.$O \
 	$(OBJ_DIR)/graph/shortestpaths.$O
 
 $(OBJ_DIR)/graph/bellman_ford.$O:$(SRC_DIR)/graph/bellman_ford.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/graph/bellman_ford.cc $(OBJ_OUT)$(OBJ_DIR)$Sgraph$Sbellman_ford.$O
 
+$(OBJ_DIR)/graph/contraction_hierarchy.$O:$(SRC_DIR)/graph/contraction_hierarchy.cc
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)/graph/contraction_hierarchy.cc $(OBJ_OUT)$(OBJ_DIR)$Sgraph$Scontraction_hierarchy.$O
+
 $(OBJ_DIR)/graph/dijkstra.$O:$(SRC_DIR)/graph/dijkstra.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/graph/dijkstra.cc $(OBJ_OUT)$(OBJ_DIR)$Sgraph$Sdijkstra.$O
 
@@ -895,7 +925,9 @@ BASE_LIB_OBJS=\
 	$(OBJ_DIR)/base/file.$O\
 	$(OBJ_DIR)/base/filelinereader.$O\
 	$(OBJ_DIR)/base/join.$O\
+	$(OBJ_DIR)/base/large_array_allocator.$O\
 	$(OBJ_DIR)/base/logging.$O\
+	$(OBJ_DIR)/base/memory_accounting.$O\
 	$(OBJ_DIR)/base/mutex.$O\
 	$(OBJ_DIR)/base/numbers.$O\
 	$(OBJ_DIR)/base/random.$O\
@@ -916,8 +948,12 @@ $(OBJ_DIR)/base/file.$O:$(SRC_DIR)/base/file.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/base/file.cc $(OBJ_OUT)$(OBJ_DIR)$Sbase$Sfile.$O
 $(OBJ_DIR)/base/filelinereader.$O:$(SRC_DIR)/base/filelinereader.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/base/filelinereader.cc $(OBJ_OUT)$(OBJ_DIR)$Sbase$Sfilelinereader.$O
+$(OBJ_DIR)/base/large_array_allocator.$O:$(SRC_DIR)/base/large_array_allocator.cc $(SRC_DIR)/base/large_array_allocator.h
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)/base/large_array_allocator.cc $(OBJ_OUT)$(OBJ_DIR)$Sbase$Slarge_array_allocator.$O
 $(OBJ_DIR)/base/logging.$O:$(SRC_DIR)/base/logging.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/base/logging.cc $(OBJ_OUT)$(OBJ_DIR)$Sbase$Slogging.$O
+$(OBJ_DIR)/base/memory_accounting.$O:$(SRC_DIR)/base/memory_accounting.cc $(SRC_DIR)/base/memory_accounting.h
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)/base/memory_accounting.cc $(OBJ_OUT)$(OBJ_DIR)$Sbase$Smemory_accounting.$O
 $(OBJ_DIR)/base/mutex.$O:$(SRC_DIR)/base/mutex.cc
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/base/mutex.cc $(OBJ_OUT)$(OBJ_DIR)$Sbase$Smutex.$O
 $(OBJ_DIR)/base/numbers.$O:$(SRC_DIR)/base/numbers.cc
@@ -962,6 +998,7 @@ LP_DATA_OBJS= \
   $(OBJ_DIR)/lp_data/matrix_scaler.$O \
   $(OBJ_DIR)/lp_data/matrix_utils.$O \
   $(OBJ_DIR)/lp_data/mps_reader.$O \
+  $(OBJ_DIR)/lp_data/parallel_mps_reader.$O \
   $(OBJ_DIR)/lp_data/sparse.$O \
   $(OBJ_DIR)/lp_data/sparse_column.$O \
 
@@ -989,6 +1026,9 @@ $(OBJ_DIR)/lp_data/matrix_utils.$O:$(SRC_DIR)/lp_data/matrix_utils.cc
 $(OBJ_DIR)/lp_data/mps_reader.$O:$(SRC_DIR)/lp_data/mps_reader.cc
 	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Slp_data$Smps_reader.cc $(OBJ_OUT)$(OBJ_DIR)$Slp_data$Smps_reader.$O
 
+$(OBJ_DIR)/lp_data/parallel_mps_reader.$O:$(SRC_DIR)/lp_data/parallel_mps_reader.cc
+	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Slp_data$Sparallel_mps_reader.cc $(OBJ_OUT)$(OBJ_DIR)$Slp_data$Sparallel_mps_reader.$O
+
 $(OBJ_DIR)/lp_data/mps_to_png.$O:$(SRC_DIR)/lp_data/mps_to_png.cc
 	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Slp_data$Smps_to_png.cc $(OBJ_OUT)$(OBJ_DIR)$Slp_data$Smps_to_png.$O
 
@@ -1005,10 +1045,13 @@ GLOP_LIB_OBJS= $(LP_DATA_OBJS) \
   $(OBJ_DIR)/glop/basis_representation.$O \
   $(OBJ_DIR)/glop/dual_edge_norms.$O \
   $(OBJ_DIR)/glop/entering_variable.$O \
+  $(OBJ_DIR)/glop/incremental_lp_solver.$O \
   $(OBJ_DIR)/glop/initial_basis.$O \
+  $(OBJ_DIR)/glop/interior_point.$O \
   $(OBJ_DIR)/glop/lp_solver.$O \
   $(OBJ_DIR)/glop/lu_factorization.$O \
   $(OBJ_DIR)/glop/markowitz.$O \
+  $(OBJ_DIR)/glop/parallel_for.$O \
   $(OBJ_DIR)/glop/parameters.pb.$O \
   $(OBJ_DIR)/glop/preprocessor.$O \
   $(OBJ_DIR)/glop/primal_edge_norms.$O \
@@ -1037,9 +1080,15 @@ $(OBJ_DIR)/glop/dual_edge_norms.$O:$(SRC_DIR)/glop/dual_edge_norms.cc
 $(OBJ_DIR)/glop/entering_variable.$O:$(SRC_DIR)/glop/entering_variable.cc
 	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Sentering_variable.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Sentering_variable.$O
 
+$(OBJ_DIR)/glop/incremental_lp_solver.$O:$(SRC_DIR)/glop/incremental_lp_solver.cc
+	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Sincremental_lp_solver.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Sincremental_lp_solver.$O
+
 $(OBJ_DIR)/glop/initial_basis.$O:$(SRC_DIR)/glop/initial_basis.cc
 	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Sinitial_basis.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Sinitial_basis.$O
 
+$(OBJ_DIR)/glop/interior_point.$O:$(SRC_DIR)/glop/interior_point.cc
+	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Sinterior_point.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Sinterior_point.$O
+
 $(OBJ_DIR)/glop/lp_solver.$O:$(SRC_DIR)/glop/lp_solver.cc  $(GEN_DIR)/linear_solver/linear_solver.pb.h
 	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Slp_solver.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Slp_solver.$O
 
@@ -1049,6 +1098,9 @@ $(OBJ_DIR)/glop/lu_factorization.$O:$(SRC_DIR)/glop/lu_factorization.cc
 $(OBJ_DIR)/glop/markowitz.$O:$(SRC_DIR)/glop/markowitz.cc
 	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Smarkowitz.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Smarkowitz.$O
 
+$(OBJ_DIR)/glop/parallel_for.$O:$(SRC_DIR)/glop/parallel_for.cc
+	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Sparallel_for.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Sparallel_for.$O
+
 $(OBJ_DIR)/glop/preprocessor.$O:$(SRC_DIR)/glop/preprocessor.cc
 	 $(CCC) $(CFLAGS) -c $(SRC_DIR)$Sglop$Spreprocessor.cc $(OBJ_OUT)$(OBJ_DIR)$Sglop$Spreprocessor.$O
 
@@ -1136,12 +1188,16 @@ $(LIB_DIR)/$(LIBPREFIX)fap.$(DYNAMIC_LIB_SUFFIX): $(FAP_LIB_OBJS)
 FLATZINC_LIB_OBJS=\
 	$(OBJ_DIR)/flatzinc/constraints.$O\
 	$(OBJ_DIR)/flatzinc/flatzinc_constraints.$O\
+	$(OBJ_DIR)/flatzinc/linear_store.$O\
+	$(OBJ_DIR)/flatzinc/lns.$O\
+	$(OBJ_DIR)/flatzinc/lp_relaxation.$O\
 	$(OBJ_DIR)/flatzinc/model.$O\
 	$(OBJ_DIR)/flatzinc/parallel_support.$O\
 	$(OBJ_DIR)/flatzinc/parser.$O\
 	$(OBJ_DIR)/flatzinc/parser.tab.$O\
 	$(OBJ_DIR)/flatzinc/parser.yy.$O\
 	$(OBJ_DIR)/flatzinc/presolve.$O\
+	$(OBJ_DIR)/flatzinc/presolve_cache.$O\
 	$(OBJ_DIR)/flatzinc/sat_constraint.$O\
 	$(OBJ_DIR)/flatzinc/search.$O\
 	$(OBJ_DIR)/flatzinc/sequential_support.$O\
@@ -1161,10 +1217,19 @@ $(OBJ_DIR)/flatzinc/constraints.$O:$(SRC_DIR)/flatzinc/constraints.cc $(SRC_DIR)
 $(OBJ_DIR)/flatzinc/flatzinc_constraints.$O:$(SRC_DIR)/flatzinc/flatzinc_constraints.cc $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/solver.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Sflatzinc$Sflatzinc_constraints.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Sflatzinc_constraints.$O
 
+$(OBJ_DIR)/flatzinc/linear_store.$O:$(SRC_DIR)/flatzinc/linear_store.cc $(SRC_DIR)/flatzinc/linear_store.h
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Sflatzinc$Slinear_store.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Slinear_store.$O
+
+$(OBJ_DIR)/flatzinc/lns.$O:$(SRC_DIR)/flatzinc/lns.cc $(SRC_DIR)/flatzinc/lns.h $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/solver.h
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Sflatzinc$Slns.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Slns.$O
+
+$(OBJ_DIR)/flatzinc/lp_relaxation.$O:$(SRC_DIR)/flatzinc/lp_relaxation.cc $(SRC_DIR)/flatzinc/lp_relaxation.h $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/solver.h $(SRC_DIR)/glop/incremental_lp_solver.h $(GEN_DIR)/glop/parameters.pb.h
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Sflatzinc$Slp_relaxation.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Slp_relaxation.$O
+
 $(OBJ_DIR)/flatzinc/model.$O:$(SRC_DIR)/flatzinc/model.cc $(SRC_DIR)/flatzinc/model.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Sflatzinc$Smodel.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Smodel.$O
 
-$(OBJ_DIR)/flatzinc/parallel_support.$O:$(SRC_DIR)/flatzinc/parallel_support.cc $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/solver.h
+$(OBJ_DIR)/flatzinc/parallel_support.$O:$(SRC_DIR)/flatzinc/parallel_support.cc $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/solver.h $(SRC_DIR)/sat/portfolio.h $(GEN_DIR)/sat/sat_parameters.pb.h $(GEN_DIR)/sat/boolean_problem.pb.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Sflatzinc$Sparallel_support.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Sparallel_support.$O
 
 $(OBJ_DIR)/flatzinc/parser.$O:$(SRC_DIR)/flatzinc/parser.cc $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/parser.h $(GEN_DIR)/flatzinc/parser.tab.hh
@@ -1179,6 +1244,9 @@ $(OBJ_DIR)/flatzinc/parser.yy.$O:$(GEN_DIR)/flatzinc/parser.yy.cc $(SRC_DIR)/fla
 $(OBJ_DIR)/flatzinc/presolve.$O:$(SRC_DIR)/flatzinc/presolve.cc $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/presolve.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Sflatzinc$Spresolve.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Spresolve.$O
 
+$(OBJ_DIR)/flatzinc/presolve_cache.$O:$(SRC_DIR)/flatzinc/presolve_cache.cc $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/presolve_cache.h
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Sflatzinc$Spresolve_cache.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Spresolve_cache.$O
+
 $(OBJ_DIR)/flatzinc/sat_constraint.$O:$(SRC_DIR)/flatzinc/sat_constraint.cc $(SRC_DIR)/flatzinc/model.h $(SRC_DIR)/flatzinc/solver.h  $(GEN_DIR)/sat/sat_parameters.pb.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)$Sflatzinc$Ssat_constraint.cc $(OBJ_OUT)$(OBJ_DIR)$Sflatzinc$Ssat_constraint.$O
 
@@ -1356,6 +1424,18 @@ $(OBJ_DIR)/pdptw.$O: $(EX_DIR)/cpp/pdptw.cc $(SRC_DIR)/constraint_solver/constra
 $(BIN_DIR)/pdptw$E: $(DYNAMIC_ROUTING_DEPS) $(OBJ_DIR)/pdptw.$O
 	$(CCC) $(CFLAGS) $(OBJ_DIR)/pdptw.$O $(DYNAMIC_ROUTING_LNK) $(DYNAMIC_LD_FLAGS) $(EXE_OUT)$(BIN_DIR)$Spdptw$E
 
+$(OBJ_DIR)/propagator_benchmark.$O: $(EX_DIR)/cpp/propagator_benchmark.cc $(SRC_DIR)/constraint_solver/constraint_solver.h
+	$(CCC) $(CFLAGS) -c $(EX_DIR)$Scpp/propagator_benchmark.cc $(OBJ_OUT)$(OBJ_DIR)$Spropagator_benchmark.$O
+
+$(BIN_DIR)/propagator_benchmark$E: $(DYNAMIC_CP_DEPS) $(OBJ_DIR)/propagator_benchmark.$O
+	$(CCC) $(CFLAGS) $(OBJ_DIR)/propagator_benchmark.$O $(DYNAMIC_CP_LNK) $(DYNAMIC_LD_FLAGS) $(EXE_OUT)$(BIN_DIR)$Spropagator_benchmark$E
+
+$(OBJ_DIR)/routing_benchmark.$O: $(EX_DIR)/cpp/routing_benchmark.cc $(SRC_DIR)/constraint_solver/constraint_solver.h $(SRC_DIR)/constraint_solver/routing.h
+	$(CCC) $(CFLAGS) -c $(EX_DIR)$Scpp/routing_benchmark.cc $(OBJ_OUT)$(OBJ_DIR)$Srouting_benchmark.$O
+
+$(BIN_DIR)/routing_benchmark$E: $(DYNAMIC_ROUTING_DEPS) $(OBJ_DIR)/routing_benchmark.$O
+	$(CCC) $(CFLAGS) $(OBJ_DIR)/routing_benchmark.$O $(DYNAMIC_ROUTING_LNK) $(DYNAMIC_LD_FLAGS) $(EXE_OUT)$(BIN_DIR)$Srouting_benchmark$E
+
 $(OBJ_DIR)/sports_scheduling.$O:$(EX_DIR)/cpp/sports_scheduling.cc $(SRC_DIR)/constraint_solver/constraint_solver.h
 	$(CCC) $(CFLAGS) -c $(EX_DIR)$Scpp/sports_scheduling.cc $(OBJ_OUT)$(OBJ_DIR)$Ssports_scheduling.$O
 
@@ -1478,10 +1558,12 @@ SAT_LIB_OBJS = \
 	$(OBJ_DIR)/sat/boolean_problem.$O\
 	$(OBJ_DIR)/sat/boolean_problem.pb.$O \
 	$(OBJ_DIR)/sat/clause.$O\
+	$(OBJ_DIR)/sat/drat_writer.$O\
 	$(OBJ_DIR)/sat/encoding.$O\
 	$(OBJ_DIR)/sat/lp_utils.$O\
 	$(OBJ_DIR)/sat/optimization.$O\
 	$(OBJ_DIR)/sat/pb_constraint.$O\
+	$(OBJ_DIR)/sat/portfolio.$O\
 	$(OBJ_DIR)/sat/sat_parameters.pb.$O\
 	$(OBJ_DIR)/sat/sat_solver.$O\
 	$(OBJ_DIR)/sat/simplification.$O\
@@ -1490,7 +1572,7 @@ SAT_LIB_OBJS = \
 
 satlibs: $(DYNAMIC_SAT_DEPS) $(STATIC_SAT_DEPS)
 
-$(OBJ_DIR)/sat/sat_solver.$O: $(SRC_DIR)/sat/sat_solver.cc $(SRC_DIR)/sat/sat_solver.h $(SRC_DIR)/sat/sat_base.h $(SRC_DIR)/sat/clause.h $(SRC_DIR)/sat/encoding.h $(SRC_DIR)/sat/unsat_proof.h $(GEN_DIR)/sat/sat_parameters.pb.h
+$(OBJ_DIR)/sat/sat_solver.$O: $(SRC_DIR)/sat/sat_solver.cc $(SRC_DIR)/sat/sat_solver.h $(SRC_DIR)/sat/sat_base.h $(SRC_DIR)/sat/clause.h $(SRC_DIR)/sat/drat_writer.h $(SRC_DIR)/sat/encoding.h $(SRC_DIR)/sat/unsat_proof.h $(GEN_DIR)/sat/sat_parameters.pb.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/sat/sat_solver.cc $(OBJ_OUT)$(OBJ_DIR)$Ssat$Ssat_solver.$O
 
 $(OBJ_DIR)/sat/lp_utils.$O: $(SRC_DIR)/sat/lp_utils.cc $(SRC_DIR)/sat/lp_utils.h $(SRC_DIR)/sat/sat_solver.h $(GEN_DIR)/sat/sat_parameters.pb.h $(GEN_DIR)/glop/parameters.pb.h
@@ -1513,6 +1595,9 @@ $(OBJ_DIR)/sat/boolean_problem.pb.$O: $(GEN_DIR)/sat/boolean_problem.pb.cc $(GEN
 $(OBJ_DIR)/sat/clause.$O: $(SRC_DIR)/sat/clause.cc $(SRC_DIR)/sat/sat_base.h $(SRC_DIR)/sat/clause.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/sat/clause.cc $(OBJ_OUT)$(OBJ_DIR)$Ssat$Sclause.$O
 
+$(OBJ_DIR)/sat/drat_writer.$O: $(SRC_DIR)/sat/drat_writer.cc $(SRC_DIR)/sat/drat_writer.h $(SRC_DIR)/sat/sat_base.h
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)/sat/drat_writer.cc $(OBJ_OUT)$(OBJ_DIR)$Ssat$Sdrat_writer.$O
+
 $(OBJ_DIR)/sat/encoding.$O: $(SRC_DIR)/sat/encoding.cc $(SRC_DIR)/sat/sat_base.h $(SRC_DIR)/sat/encoding.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/sat/encoding.cc $(OBJ_OUT)$(OBJ_DIR)$Ssat$Sencoding.$O
 
@@ -1522,6 +1607,9 @@ $(OBJ_DIR)/sat/optimization.$O: $(SRC_DIR)/sat/optimization.cc $(SRC_DIR)/sat/sa
 $(OBJ_DIR)/sat/pb_constraint.$O: $(SRC_DIR)/sat/pb_constraint.cc $(SRC_DIR)/sat/sat_base.h $(SRC_DIR)/sat/pb_constraint.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/sat/pb_constraint.cc $(OBJ_OUT)$(OBJ_DIR)$Ssat$Spb_constraint.$O
 
+$(OBJ_DIR)/sat/portfolio.$O: $(SRC_DIR)/sat/portfolio.cc $(SRC_DIR)/sat/portfolio.h $(SRC_DIR)/sat/sat_solver.h $(SRC_DIR)/sat/sat_base.h $(SRC_DIR)/sat/boolean_problem.h $(GEN_DIR)/sat/boolean_problem.pb.h $(GEN_DIR)/sat/sat_parameters.pb.h
+	$(CCC) $(CFLAGS) -c $(SRC_DIR)/sat/portfolio.cc $(OBJ_OUT)$(OBJ_DIR)$Ssat$Sportfolio.$O
+
 $(OBJ_DIR)/sat/unsat_proof.$O: $(SRC_DIR)/sat/unsat_proof.cc $(SRC_DIR)/sat/sat_base.h $(SRC_DIR)/sat/unsat_proof.h
 	$(CCC) $(CFLAGS) -c $(SRC_DIR)/sat/unsat_proof.cc $(OBJ_OUT)$(OBJ_DIR)$Ssat$Sunsat_proof.$O
 
@@ -1544,7 +1632,7 @@ $(LIB_DIR)/$(LIBPREFIX)sat.$(STATIC_LIB_SUFFIX): $(SAT_LIB_OBJS)
 	$(STATIC_LINK_CMD) $(STATIC_LINK_PREFIX)$(LIB_DIR)$S$(LIBPREFIX)sat.$(STATIC_LIB_SUFFIX) $(SAT_LIB_OBJS)
 endif
 
-$(OBJ_DIR)/sat/sat_runner.$O:$(EX_DIR)/cpp/sat_runner.cc $(SRC_DIR)/sat/sat_solver.h $(EX_DIR)/cpp/opb_reader.h $(EX_DIR)/cpp/sat_cnf_reader.h $(GEN_DIR)/sat/sat_parameters.pb.h  $(GEN_DIR)/sat/boolean_problem.pb.h  $(SRC_DIR)/sat/boolean_problem.h  $(SRC_DIR)/sat/sat_base.h $(SRC_DIR)/sat/simplification.h
+$(OBJ_DIR)/sat/sat_runner.$O:$(EX_DIR)/cpp/sat_runner.cc $(SRC_DIR)/sat/sat_solver.h $(EX_DIR)/cpp/opb_reader.h $(EX_DIR)/cpp/sat_cnf_reader.h $(GEN_DIR)/sat/sat_parameters.pb.h  $(GEN_DIR)/sat/boolean_problem.pb.h  $(SRC_DIR)/sat/boolean_problem.h  $(SRC_DIR)/sat/sat_base.h $(SRC_DIR)/sat/simplification.h $(SRC_DIR)/sat/portfolio.h
 	$(CCC) $(CFLAGS) -c $(EX_DIR)$Scpp$Ssat_runner.cc $(OBJ_OUT)$(OBJ_DIR)$Ssat$Ssat_runner.$O
 
 $(BIN_DIR)/sat_runner$E: $(STATIC_SAT_DEPS) $(OBJ_DIR)/sat/sat_runner.$O
@@ -92,12 +92,30 @@ DynamicPartition::DynamicPartition(const std::vector<int>& initial_part_of_eleme
 }
 
 void DynamicPartition::Refine(const std::vector<int>& distinguished_subset) {
+  RefineBySubset(distinguished_subset.begin(), distinguished_subset.end());
+}
+
+void DynamicPartition::RefineByCells(const std::vector<int>& cell_elements,
+                                     const std::vector<int>& cell_start) {
+  DCHECK(!cell_start.empty());
+  DCHECK_EQ(0, cell_start.front());
+  DCHECK_EQ(cell_elements.size(), cell_start.back());
+  for (int c = 0; c + 1 < cell_start.size(); ++c) {
+    if (cell_start[c] == cell_start[c + 1]) continue;
+    RefineBySubset(cell_elements.begin() + cell_start[c],
+                   cell_elements.begin() + cell_start[c + 1]);
+  }
+}
+
+void DynamicPartition::RefineBySubset(std::vector<int>::const_iterator begin,
+                                      std::vector<int>::const_iterator end) {
   // tmp_counter_of_part_[i] will contain the number of
-  // elements in distinguished_subset that were part of part #i.
+  // elements in the distinguished subset that were part of part #i.
   tmp_counter_of_part_.resize(NumParts(), 0);
   // We remember the Parts that were actually affected.
   tmp_affected_parts_.clear();
-  for (const int element : distinguished_subset) {
+  for (std::vector<int>::const_iterator it = begin; it != end; ++it) {
+    const int element = *it;
     DCHECK_GE(element, 0);
     DCHECK_LT(element, NumElements());
     const int part = part_of_[element];
@@ -206,6 +224,8 @@ void MergingPartition::Reset(int num_nodes) {
   parent_.assign(num_nodes, -1);
   for (int i = 0; i < num_nodes; ++i) parent_[i] = i;
   tmp_part_bit_.assign(num_nodes, false);
+  undo_log_.clear();
+  checkpoints_.clear();
 }
 
 int MergingPartition::MergePartsOf(int node1, int node2) {
@@ -227,8 +247,13 @@ int MergingPartition::MergePartsOf(int node1, int node2) {
   // Update the part size. Don't change part_size_[root2]: it won't be used
   // again by further merges.
   part_size_[root1] += part_size_[root2];
-  SetParentAlongPathToRoot(node1, root1);
-  SetParentAlongPathToRoot(node2, root1);
+  if (checkpoints_.empty()) {
+    SetParentAlongPathToRoot(node1, root1);
+    SetParentAlongPathToRoot(node2, root1);
+  } else {
+    parent_[root2] = root1;
+    undo_log_.push_back(root2);
+  }
   return root2;
 }
 
@@ -236,10 +261,26 @@ int MergingPartition::GetRootAndCompressPath(int node) {
   DCHECK_GE(node, 0);
   DCHECK_LT(node, NumNodes());
   const int root = GetRoot(node);
-  SetParentAlongPathToRoot(node, root);
+  if (checkpoints_.empty()) SetParentAlongPathToRoot(node, root);
   return root;
 }
 
+void MergingPartition::RestoreLastCheckpoint() {
+  DCHECK(!checkpoints_.empty());
+  const int undo_log_size = checkpoints_.back();
+  checkpoints_.pop_back();
+  // The merges are undone in reverse order, so the parent of each undone root
+  // is still the root that it was attached to.
+  while (undo_log_.size() > undo_log_size) {
+    const int root2 = undo_log_.back();
+    undo_log_.pop_back();
+    const int root1 = parent_[root2];
+    DCHECK_EQ(root1, parent_[root1]);
+    part_size_[root1] -= part_size_[root2];
+    parent_[root2] = root2;
+  }
+}
+
 void MergingPartition::KeepOnlyOneNodePerPart(std::vector<int>* nodes) {
   int num_nodes_kept = 0;
   for (const int node : *nodes) {
@@ -106,8 +106,19 @@ class DynamicPartition {
   // the distinguished subset or entirely *out*?
   void Refine(const std::vector<int>& distinguished_subset);
 
+  // Same as calling Refine() successively on each of the "cells", which must
+  // be disjoint: cell #c is made of the elements
+  // cell_elements[cell_start[c] .. cell_start[c + 1] - 1], i.e. the cells are
+  // given in a flat layout, and cell_start.size() is the number of cells + 1.
+  // Empty cells are allowed. This avoids one std::vector<int> per cell when
+  // refining by a labeling of the elements (e.g. by their degree).
+  void RefineByCells(const std::vector<int>& cell_elements,
+                     const std::vector<int>& cell_start);
+
   // Undo one or several Refine() operations, until the number of parts
-  // becomes equal to "original_num_parts".
+  // becomes equal to "original_num_parts". Thus NumParts() can be used as a
+  // checkpoint: the complexity is O(number of elements in the undone parts),
+  // i.e. at most the complexity of the Refine() operations that are undone.
   // Prerequisite: NumParts() >= original_num_parts.
   void UndoRefineUntilNumPartsEqual(int original_num_parts);
 
@@ -167,6 +178,11 @@ class DynamicPartition {
   };
   std::vector<Part> part_;  // The disjoint parts.
 
+  // Implementation of Refine() and RefineByCells(), on the distinguished
+  // subset [begin, end).
+  void RefineBySubset(std::vector<int>::const_iterator begin,
+                      std::vector<int>::const_iterator end);
+
   // Used temporarily and exclusively by Refine(). This prevents Refine()
   // from being thread-safe.
   // INVARIANT: tmp_counter_of_part_ contains only 0s before and after Refine().
@@ -242,6 +258,17 @@ class MergingPartition {
   // CRASHES IF USED INCORRECTLY.
   void ResetNode(int node);
 
+  // Backtracking: SaveCheckpoint() saves the current partition, which will be
+  // restored by the next RestoreLastCheckpoint(). Checkpoints can be nested.
+  // While there is at least one active checkpoint, the paths are not
+  // compressed, so that each merge modifies only one parent, and can be undone
+  // in O(1). The complexity of GetRootAndCompressPath() then becomes
+  // O(log(N)), thanks to the merges of smaller parts onto larger ones.
+  // ResetNode() must not be used while there is an active checkpoint.
+  void SaveCheckpoint() { checkpoints_.push_back(undo_log_.size()); }
+  void RestoreLastCheckpoint();
+  int NumCheckpoints() const { return checkpoints_.size(); }
+
   int NumNodesInSamePartAs(int node) {
     return part_size_[GetRootAndCompressPath(node)];
   }
@@ -263,6 +290,12 @@ class MergingPartition {
 
   // Used transiently by KeepOnlyOneNodePerPart().
   std::vector<bool> tmp_part_bit_;
+
+  // The second root of each merge performed since the first active
+  // checkpoint (i.e. the root that was attached to the other one), and the
+  // size of undo_log_ at each active checkpoint.
+  std::vector<int> undo_log_;
+  std::vector<int> checkpoints_;
 };
 
 // *** Implementation of inline methods of the above classes. ***
@@ -331,6 +364,7 @@ inline void MergingPartition::SetParentAlongPathToRoot(int node, int parent) {
 }
 
 inline void MergingPartition::ResetNode(int node) {
+  DCHECK(checkpoints_.empty());
   DCHECK_GE(node, 0);
   DCHECK_LT(node, NumNodes());
   parent_[node] = node;
@@ -16,6 +16,7 @@
 #include <algorithm>
 #include <limits>
 #include <numeric>
+#include <thread>  // NOLINT
 
 #include "base/commandlineflags.h"
 #include "base/stringprintf.h"
@@ -97,7 +98,7 @@ GraphSymmetryFinder::GraphSymmetryFinder(const Graph& graph, bool is_undirected)
       tmp_dynamic_permutation_(NumNodes()),
       tmp_node_mask_(NumNodes(), false),
       tmp_degree_(NumNodes(), 0),
-      tmp_nodes_with_degree_(NumNodes() + 1) {
+      num_threads_(1) {
   // Set up an "unlimited" time limit by default.
   time_limit_ = TimeLimit::Infinite();
   tmp_partition_.Reset(NumNodes());
@@ -165,6 +166,10 @@ bool GraphSymmetryFinder::IsGraphAutomorphism(
 }
 
 namespace {
+// The arcs of a part are counted with several threads only if there are at
+// least this number of nodes per thread.
+const int kMinNumNodesPerRefinementThread = 1 << 13;
+
 // Specialized subroutine, to avoid code duplication: see its call site
 // and its self-explanatory code.
 template <class T>
@@ -180,6 +185,66 @@ inline void IncrementCounterForNonSingletons(const T& nodes,
 }
 }  // namespace
 
+void GraphSymmetryFinder::SetNumThreads(int num_threads) {
+  num_threads_ = std::max(1, num_threads);
+  tmp_thread_degree_.resize(num_threads_ - 1);
+  tmp_thread_nodes_.resize(num_threads_ - 1);
+}
+
+void GraphSymmetryFinder::CountArcsFromPart(int part_index, bool outgoing,
+                                            const DynamicPartition& partition) {
+  const DynamicPartition::IterablePart part =
+      partition.ElementsInPart(part_index);
+  const int part_size = part.size();
+  const int num_chunks = std::max(
+      1, std::min(num_threads_, part_size / kMinNumNodesPerRefinementThread));
+  // Counts the arcs of the nodes of part [begin, end) into the given counters.
+  auto count_arcs = [this, outgoing, &partition, &part](
+      int begin, int end, std::vector<int>* degree, std::vector<int>* nodes) {
+    if (outgoing) {
+      for (int i = begin; i < end; ++i) {
+        IncrementCounterForNonSingletons(graph_[part.begin()[i]], partition,
+                                         degree, nodes);
+      }
+    } else {
+      for (int i = begin; i < end; ++i) {
+        IncrementCounterForNonSingletons(
+            TailsOfIncomingArcsTo(part.begin()[i]), partition, degree, nodes);
+      }
+    }
+  };
+  if (num_chunks == 1) {
+    count_arcs(0, part_size, &tmp_degree_, &tmp_stack_);
+    return;
+  }
+
+  // Each thread counts the arcs of a contiguous chunk of the part. The first
+  // chunk uses tmp_degree_ and tmp_stack_ directly, and the other counts are
+  // added to them in the chunk order, which gives the same seen nodes in the
+  // same order as a sequential scan.
+  std::vector<std::thread> threads;
+  for (int chunk = 1; chunk < num_chunks; ++chunk) {
+    std::vector<int>* const degree = &tmp_thread_degree_[chunk - 1];
+    if (degree->empty()) degree->assign(NumNodes(), 0);
+    threads.push_back(std::thread(count_arcs,
+                                  part_size * chunk / num_chunks,
+                                  part_size * (chunk + 1) / num_chunks, degree,
+                                  &tmp_thread_nodes_[chunk - 1]));
+  }
+  count_arcs(0, part_size / num_chunks, &tmp_degree_, &tmp_stack_);
+  for (std::thread& thread : threads) thread.join();
+  for (int chunk = 1; chunk < num_chunks; ++chunk) {
+    std::vector<int>& degree = tmp_thread_degree_[chunk - 1];
+    std::vector<int>& nodes = tmp_thread_nodes_[chunk - 1];
+    for (const int node : nodes) {
+      if (tmp_degree_[node] == 0) tmp_stack_.push_back(node);
+      tmp_degree_[node] += degree[node];
+      degree[node] = 0;  // To clean up after us.
+    }
+    nodes.clear();  // To clean up after us.
+  }
+}
+
 void GraphSymmetryFinder::RecursivelyRefinePartitionByAdjacency(
     int first_unrefined_part_index, DynamicPartition* partition) {
   // Rename, for readability of the code below.
@@ -206,34 +271,33 @@ void GraphSymmetryFinder::RecursivelyRefinePartitionByAdjacency(
     for (const bool outgoing_adjacency : adjacency_directions) {
       // Count the aggregated degree of all nodes, only looking at arcs that
       // come from/to the current part.
-      if (outgoing_adjacency) {
-        for (const int node : partition->ElementsInPart(part_index)) {
-          IncrementCounterForNonSingletons(graph_[node], *partition,
-                                           &tmp_degree_,
-                                           &tmp_nodes_with_nonzero_degree);
-        }
-      } else {
-        for (const int node : partition->ElementsInPart(part_index)) {
-          IncrementCounterForNonSingletons(TailsOfIncomingArcsTo(node),
-                                           *partition, &tmp_degree_,
-                                           &tmp_nodes_with_nonzero_degree);
-        }
-      }
-      // Group the nodes by (nonzero) degree. Remember the maximum degree.
+      CountArcsFromPart(part_index, outgoing_adjacency, *partition);
+      // Group the nodes by degree with a counting sort: the cell #d of
+      // tmp_nodes_by_degree_ contains the nodes with degree d, in the order of
+      // tmp_nodes_with_nonzero_degree (the cell #0 is empty).
       int max_degree = 0;
       for (const int node : tmp_nodes_with_nonzero_degree) {
+        max_degree = std::max(max_degree, tmp_degree_[node]);
+      }
+      tmp_degree_cell_start_.assign(max_degree + 1, 0);
+      for (const int node : tmp_nodes_with_nonzero_degree) {
+        ++tmp_degree_cell_start_[tmp_degree_[node]];
+      }
+      for (int degree = 1; degree <= max_degree; ++degree) {
+        tmp_degree_cell_start_[degree] += tmp_degree_cell_start_[degree - 1];
+      }
+      tmp_nodes_by_degree_.resize(tmp_nodes_with_nonzero_degree.size());
+      for (int i = tmp_nodes_with_nonzero_degree.size() - 1; i >= 0; --i) {
+        const int node = tmp_nodes_with_nonzero_degree[i];
         const int degree = tmp_degree_[node];
         tmp_degree_[node] = 0;  // To clean up after us.
-        max_degree = std::max(max_degree, degree);
-        tmp_nodes_with_degree_[degree].push_back(node);
+        tmp_nodes_by_degree_[--tmp_degree_cell_start_[degree]] = node;
       }
+      tmp_degree_cell_start_.push_back(tmp_nodes_by_degree_.size());
       tmp_nodes_with_nonzero_degree.clear();  // To clean up after us.
-      // For each degree, refine the partition by the set of nodes with that
-      // degree.
-      for (int degree = 1; degree <= max_degree; ++degree) {
-        partition->Refine(tmp_nodes_with_degree_[degree]);
-        tmp_nodes_with_degree_[degree].clear();  // To clean up after us.
-      }
+      // For each degree, by increasing degree, refine the partition by the set
+      // of nodes with that degree.
+      partition->RefineByCells(tmp_nodes_by_degree_, tmp_degree_cell_start_);
     }
   }
 }
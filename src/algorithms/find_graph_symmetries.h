@@ -48,6 +48,12 @@ class GraphSymmetryFinder {
   // TODO(user): support multi-arcs.
   GraphSymmetryFinder(const Graph& graph, bool is_undirected);
 
+  // Sets the number of threads used to refine the partitions by adjacency, 1
+  // by default. The refinement of large parts counts the arcs in parallel,
+  // which needs num_threads - 1 additional integers per node. The results do
+  // not depend on the number of threads.
+  void SetNumThreads(int num_threads);
+
   // Whether the given permutation is an automorphism of the graph given at
   // construction. This costs O(sum(degree(x))) (the sum is over all nodes x
   // that are displaced by the permutation).
@@ -143,6 +149,14 @@ class GraphSymmetryFinder {
   BeginEndWrapper<std::vector<int>::const_iterator> TailsOfIncomingArcsTo(
       int node) const;
 
+  // Subroutine of RecursivelyRefinePartitionByAdjacency(): for each node in a
+  // non-singleton part, counts its arcs from (or to, if outgoing is false)
+  // the nodes of the given part into tmp_degree_, and lists the nodes with a
+  // nonzero count in tmp_stack_, in the order in which a scan of the part
+  // first sees them. This uses several threads on large parts.
+  void CountArcsFromPart(int part_index, bool outgoing,
+                         const DynamicPartition& partition);
+
   // Deadline management. Populated upon FindSymmetries().
   mutable std::unique_ptr<TimeLimit> time_limit_;
 
@@ -228,10 +242,17 @@ class GraphSymmetryFinder {
   mutable std::vector<bool> tmp_node_mask_;           // [0..N-1] = false
   std::vector<int> tmp_degree_;                       // [0..N-1] = 0.
   std::vector<int> tmp_stack_;                        // Empty.
-  std::vector<std::vector<int>> tmp_nodes_with_degree_;    // [0..N-1] = [].
+  std::vector<int> tmp_nodes_by_degree_;              // Any.
+  std::vector<int> tmp_degree_cell_start_;            // Any.
   MergingPartition tmp_partition_;               // Reset(N).
   std::vector<const SparsePermutation*> tmp_compatible_permutations_;  // Empty.
 
+  // The counts and the seen nodes of the threads of CountArcsFromPart(),
+  // except the first one which uses tmp_degree_ and tmp_stack_.
+  int num_threads_;
+  std::vector<std::vector<int>> tmp_thread_degree_;  // [0..N-1] = 0.
+  std::vector<std::vector<int>> tmp_thread_nodes_;   // Empty.
+
   // Internal statistics, used for performance tuning and debugging.
   struct Stats : public StatsGroup {
     Stats()
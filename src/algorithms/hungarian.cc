@@ -11,666 +11,327 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-// See: //depot/google3/java/com/google/wireless/genie/frontend
-//       /mixer/matching/HungarianOptimizer.java
-
 #include "algorithms/hungarian.h"
 
 #include <algorithm>
-#include <cstdio>
 #include <limits>
 
-namespace operations_research {
-
-class HungarianOptimizer {
-  static const int kHungarianOptimizerRowNotFound = -1;
-  static const int kHungarianOptimizerColNotFound = -2;
-
- public:
-  // Setup the initial conditions for the algorithm.
-
-  // Parameters: costs is a matrix of the cost of assigning each agent to
-  // each task. costs[i][j] is the cost of assigning agent i to task j.
-  // All the costs must be non-negative.  This matrix does not have to
-  // be square (i.e. we can have different numbers of agents and tasks), but it
-  // must be regular (i.e. there must be the same number of entries in each row
-  // of the matrix).
-  explicit HungarianOptimizer(const std::vector<std::vector<double> >& costs);
-
-  // Find an assignment which maximizes the total cost.
-  // Returns the assignment in the two vectors passed as argument.
-  // agent[i] is assigned to task[i].
-  void Maximize(std::vector<int>* agent, std::vector<int>* task);
-
-  // Find an assignment which minimizes the total cost.
-  // Returns the assignment in the two vectors passed as argument.
-  // agent[i] is assigned to task[i].
-  void Minimize(std::vector<int>* agent, std::vector<int>* task);
-
- private:
-  typedef void (HungarianOptimizer::*Step)();
-
-  typedef enum {
-    NONE,
-    PRIME,
-    STAR
-  } Mark;
-
-  // Convert the final cost matrix into a set of assignments of agents -> tasks.
-  // Returns the assignment in the two vectors passed as argument, the same as
-  // Minimize and Maximize
-  void FindAssignments(std::vector<int>* agent, std::vector<int>* task);
-
-  // Is the cell (row, col) starred?
-  bool IsStarred(int row, int col) const { return marks_[row][col] == STAR; }
-
-  // Mark cell (row, col) with a star
-  void Star(int row, int col) {
-    marks_[row][col] = STAR;
-    stars_in_col_[col]++;
-  }
-
-  // Remove a star from cell (row, col)
-  void UnStar(int row, int col) {
-    marks_[row][col] = NONE;
-    stars_in_col_[col]--;
-  }
-
-  // Find a column in row 'row' containing a star, or return
-  // kHungarianOptimizerColNotFound if no such column exists.
-  int FindStarInRow(int row) const;
-
-  // Find a row in column 'col' containing a star, or return
-  // kHungarianOptimizerRowNotFound if no such row exists.
-  int FindStarInCol(int col) const;
-
-  // Is cell (row, col) marked with a prime?
-  bool IsPrimed(int row, int col) const { return marks_[row][col] == PRIME; }
-
-  // Mark cell (row, col) with a prime.
-  void Prime(int row, int col) { marks_[row][col] = PRIME; }
-
-  // Find a column in row containing a prime, or return
-  // kHungarianOptimizerColNotFound if no such column exists.
-  int FindPrimeInRow(int row) const;
-
-  // Remove the prime marks_ from every cell in the matrix.
-  void ClearPrimes();
-
-  // Does column col contain a star?
-  bool ColContainsStar(int col) const { return stars_in_col_[col] > 0; }
-
-  // Is row 'row' covered?
-  bool RowCovered(int row) const { return rows_covered_[row]; }
-
-  // Cover row 'row'.
-  void CoverRow(int row) { rows_covered_[row] = true; }
-
-  // Uncover row 'row'.
-  void UncoverRow(int row) { rows_covered_[row] = false; }
-
-  // Is column col covered?
-  bool ColCovered(int col) const { return cols_covered_[col]; }
-
-  // Cover column col.
-  void CoverCol(int col) { cols_covered_[col] = true; }
-
-  // Uncover column col.
-  void UncoverCol(int col) { cols_covered_[col] = false; }
-
-  // Uncover ever row and column in the matrix.
-  void ClearCovers();
-
-  // Find the smallest uncovered cell in the matrix.
-  double FindSmallestUncovered() const;
-
-  // Find an uncovered zero and store its coordinates in (zeroRow_, zeroCol_)
-  // and return true, or return false if no such cell exists.
-  bool FindZero(int* zero_row, int* zero_col) const;
-
-  // Print the matrix to stdout (for debugging.)
-  void PrintMatrix();
-
-  // Run the Munkres algorithm!
-  void DoMunkres();
-
-  // Step 1.
-  // For each row of the matrix, find the smallest element and subtract it
-  // from every element in its row.  Go to Step 2.
-  void ReduceRows();
-
-  // Step 2.
-  // Find a zero (Z) in the matrix.  If there is no starred zero in its row
-  // or column, star Z.  Repeat for every element in the matrix.  Go to step 3.
-  // Note: profiling shows this method to use 9.2% of the CPU - the next
-  // slowest step takes 0.6%.  I can't think of a way of speeding it up though.
-  void StarZeroes();
-
-  // Step 3.
-  // Cover each column containing a starred zero.  If all columns are
-  // covered, the starred zeros describe a complete set of unique assignments.
-  // In this case, terminate the algorithm.  Otherwise, go to step 4.
-  void CoverStarredZeroes();
-
-  // Step 4.
-  // Find a noncovered zero and prime it.  If there is no starred zero in the
-  // row containing this primed zero, Go to Step 5.  Otherwise, cover this row
-  // and uncover the column containing the starred zero. Continue in this manner
-  // until there are no uncovered zeros left, then go to Step 6.
-  void PrimeZeroes();
-
-  // Step 5.
-  // Construct a series of alternating primed and starred zeros as follows.
-  // Let Z0 represent the uncovered primed zero found in Step 4.  Let Z1 denote
-  // the starred zero in the column of Z0 (if any). Let Z2 denote the primed
-  // zero in the row of Z1 (there will always be one).  Continue until the
-  // series terminates at a primed zero that has no starred zero in its column.
-  // Unstar each starred zero of the series, star each primed zero of the
-  // series, erase all primes and uncover every line in the matrix.  Return to
-  // Step 3.
-  void MakeAugmentingPath();
+#include "base/integral_types.h"
+#include "base/logging.h"
 
-  // Step 6.
-  // Add the smallest uncovered value in the matrix to every element of each
-  // covered row, and subtract it from every element of each uncovered column.
-  // Return to Step 4 without altering any stars, primes, or covered lines.
-  void AugmentPath();
-
-  // The size of the problem, i.e. std::max(#agents, #tasks).
-  int matrix_size_;
-
-  // The expanded cost matrix.
-  std::vector<std::vector<double> > costs_;
-
-  // The greatest cost in the initial cost matrix.
-  double max_cost_;
-
-  // Which rows and columns are currently covered.
-  std::vector<bool> rows_covered_;
-  std::vector<bool> cols_covered_;
-
-  // The marks_ (star/prime/none) on each element of the cost matrix.
-  std::vector<std::vector<Mark> > marks_;
-
-  // The number of stars in each column - used to speed up coverStarredZeroes.
-  std::vector<int> stars_in_col_;
-
-  // Representation of a path_ through the matrix - used in step 5.
-  std::vector<int> preimage_;  // i.e. the agents
-  std::vector<int> image_;     // i.e. the tasks
-
-  // The locations of a zero found in step 4.
-  int zero_col_, zero_row_;
-
-  // The width_ and height_ of the initial (non-expanded) cost matrix.
-  int width_;
-  int height_;
-
-  // The current state of the algorithm
-  HungarianOptimizer::Step state_;
-};
-
-HungarianOptimizer::HungarianOptimizer(const std::vector<std::vector<double> >& costs)
-    : matrix_size_(0),
-      costs_(),
-      max_cost_(0),
-      rows_covered_(),
-      cols_covered_(),
-      marks_(),
-      stars_in_col_(),
-      preimage_(),
-      image_(),
-      zero_col_(0),
-      zero_row_(0),
-      width_(0),
-      height_(0),
-      state_(NULL) {
-  width_ = costs.size();
-
-  if (width_ > 0) {
-    height_ = costs[0].size();
-  } else {
-    height_ = 0;
-  }
+namespace operations_research {
 
-  matrix_size_ = std::max(width_, height_);
-  max_cost_ = 0;
+namespace {
 
-  // Generate the expanded cost matrix by adding extra 0-valued elements in
-  // order to make a square matrix.  At the same time, find the greatest cost
-  // in the matrix (used later if we want to maximize rather than minimize the
-  // overall cost.)
-  costs_.resize(matrix_size_);
-  for (int row = 0; row < matrix_size_; ++row) {
-    costs_[row].resize(matrix_size_);
-  }
+// The maximum number of steps of each round of augmenting row reduction,
+// per row of the problem. See SolveSquareAssignment().
+const int kMaxRowReductionStepsPerRow = 8;
 
-  for (int row = 0; row < matrix_size_; ++row) {
-    for (int col = 0; col < matrix_size_; ++col) {
-      if ((row >= width_) || (col >= height_)) {
-        costs_[row][col] = 0;
-      } else {
-        costs_[row][col] = costs[row][col];
-        max_cost_ = std::max(max_cost_, costs_[row][col]);
+// Solves the square assignment problem of size n, whose costs are given in
+// row-major order, with the algorithm of Jonker and Volgenant (see the .h).
+// Fills col_of_row and returns the total cost.
+//
+// The loops over the columns of a row, which dominate the running time of the
+// first phases, are written over contiguous memory so that the compiler can
+// vectorize them.
+double SolveSquareAssignment(int n, const double* costs,
+                             std::vector<int>* col_of_row) {
+  const double kInfinity = std::numeric_limits<double>::infinity();
+  std::vector<int>& row_sol = *col_of_row;
+  row_sol.assign(n, -1);
+  if (n == 0) return 0.0;
+  std::vector<int> col_sol(n, -1);
+  // The dual values of the columns: the reduced cost of (row, col) is
+  // costs[row * n + col] - v[col].
+  std::vector<double> v(n, kInfinity);
+  std::vector<int> num_matches(n, 0);
+
+  // Column reduction: v[col] is the minimum cost of the column, and each
+  // column is tentatively assigned to the row of minimum cost, scanning the
+  // columns backwards so that a row is assigned to its last such column,
+  // unless a later one has a smaller cost. The minima are computed row by row,
+  // which reads the matrix contiguously.
+  std::vector<int> min_row(n, 0);
+  for (int row = 0; row < n; ++row) {
+    const double* const row_costs = costs + static_cast<int64>(row) * n;
+    for (int col = 0; col < n; ++col) {
+      if (row_costs[col] < v[col]) {
+        v[col] = row_costs[col];
+        min_row[col] = row;
       }
     }
   }
-
-  // Initially, none of the cells of the matrix are marked.
-  marks_.resize(matrix_size_);
-  for (int row = 0; row < matrix_size_; ++row) {
-    marks_[row].resize(matrix_size_);
-    for (int col = 0; col < matrix_size_; ++col) {
-      marks_[row][col] = NONE;
+  for (int col = n - 1; col >= 0; --col) {
+    const int row = min_row[col];
+    if (++num_matches[row] == 1) {
+      row_sol[row] = col;
+      col_sol[col] = row;
+    } else if (v[col] < v[row_sol[row]]) {
+      col_sol[row_sol[row]] = -1;
+      row_sol[row] = col;
+      col_sol[col] = row;
     }
   }
 
-  stars_in_col_.resize(matrix_size_);
-
-  rows_covered_.resize(matrix_size_);
-  cols_covered_.resize(matrix_size_);
-
-  preimage_.resize(matrix_size_ * 2);
-  image_.resize(matrix_size_ * 2);
-}
-
-// Find an assignment which maximizes the total cost.
-// Return an array of pairs of integers.  Each pair (i, j) corresponds to
-// assigning agent i to task j.
-void HungarianOptimizer::Maximize(std::vector<int>* preimage, std::vector<int>* image) {
-  // Find a maximal assignment by subtracting each of the
-  // original costs from max_cost_  and then minimizing.
-  for (int row = 0; row < width_; ++row) {
-    for (int col = 0; col < height_; ++col) {
-      costs_[row][col] = max_cost_ - costs_[row][col];
+  // Reduction transfer: for the rows assigned only once, decrease the dual
+  // value of their column so that their second best column gets a null
+  // reduced cost. The unassigned rows are the free rows.
+  std::vector<int> free_rows;
+  for (int row = 0; row < n; ++row) {
+    if (num_matches[row] == 0) {
+      free_rows.push_back(row);
+    } else if (num_matches[row] == 1) {
+      const double* const row_costs = costs + static_cast<int64>(row) * n;
+      const int assigned_col = row_sol[row];
+      double min_reduced_cost = kInfinity;
+      for (int col = 0; col < n; ++col) {
+        if (col == assigned_col) continue;
+        min_reduced_cost = std::min(min_reduced_cost, row_costs[col] - v[col]);
+      }
+      if (min_reduced_cost < kInfinity) v[assigned_col] -= min_reduced_cost;
     }
   }
-  Minimize(preimage, image);
-}
-
-// Find an assignment which minimizes the total cost.
-// Return an array of pairs of integers.  Each pair (i, j) corresponds to
-// assigning agent i to task j.
-void HungarianOptimizer::Minimize(std::vector<int>* preimage, std::vector<int>* image) {
-  DoMunkres();
-  FindAssignments(preimage, image);
-}
 
-// Convert the final cost matrix into a set of assignments of agents -> tasks.
-// Return an array of pairs of integers, the same as the return values of
-// Minimize() and Maximize()
-void HungarianOptimizer::FindAssignments(std::vector<int>* preimage,
-                                         std::vector<int>* image) {
-  preimage->clear();
-  image->clear();
-  for (int row = 0; row < width_; ++row) {
-    for (int col = 0; col < height_; ++col) {
-      if (IsStarred(row, col)) {
-        preimage->push_back(row);
-        image->push_back(col);
+  // Augmenting row reduction, twice: each free row takes its best column, and
+  // lowers its dual value so that it is just as good as its second best one.
+  // The row that was assigned to this column becomes free, and is processed
+  // right away when the dual value did decrease.
+  //
+  // This is an auction without a minimum price increase, so with floating
+  // point costs a few rows can outbid each other by tiny amounts for a very
+  // long time. Since the rows that are still free when we stop are handled
+  // by the augmentation below, we simply cap the number of steps.
+  const int64 max_num_steps = kMaxRowReductionStepsPerRow * n;
+  for (int round = 0; round < 2 && !free_rows.empty(); ++round) {
+    const int num_previous_free_rows = free_rows.size();
+    int num_free_rows = 0;
+    int k = 0;
+    for (int64 step = 0; k < num_previous_free_rows; ++step) {
+      if (step == max_num_steps) {
+        // Keep the remaining rows free. Note that num_free_rows <= k.
+        while (k < num_previous_free_rows) {
+          free_rows[num_free_rows++] = free_rows[k++];
+        }
         break;
       }
-    }
-  }
-  // TODO(user)
-  // result_size = std::min(width_, height_);
-  // CHECK image.size() == result_size
-  // CHECK preimage.size() == result_size
-}
-
-// Find a column in row 'row' containing a star, or return
-// kHungarianOptimizerColNotFound if no such column exists.
-int HungarianOptimizer::FindStarInRow(int row) const {
-  for (int col = 0; col < matrix_size_; ++col) {
-    if (IsStarred(row, col)) {
-      return col;
-    }
-  }
-
-  return kHungarianOptimizerColNotFound;
-}
-
-// Find a row in column 'col' containing a star, or return
-// kHungarianOptimizerRowNotFound if no such row exists.
-int HungarianOptimizer::FindStarInCol(int col) const {
-  if (!ColContainsStar(col)) {
-    return kHungarianOptimizerRowNotFound;
-  }
-
-  for (int row = 0; row < matrix_size_; ++row) {
-    if (IsStarred(row, col)) {
-      return row;
-    }
-  }
-
-  // NOTREACHED
-  return kHungarianOptimizerRowNotFound;
-}
-
-// Find a column in row containing a prime, or return
-// kHungarianOptimizerColNotFound if no such column exists.
-int HungarianOptimizer::FindPrimeInRow(int row) const {
-  for (int col = 0; col < matrix_size_; ++col) {
-    if (IsPrimed(row, col)) {
-      return col;
-    }
-  }
-
-  return kHungarianOptimizerColNotFound;
-}
-
-// Remove the prime marks from every cell in the matrix.
-void HungarianOptimizer::ClearPrimes() {
-  for (int row = 0; row < matrix_size_; ++row) {
-    for (int col = 0; col < matrix_size_; ++col) {
-      if (IsPrimed(row, col)) {
-        marks_[row][col] = NONE;
+      const int row = free_rows[k++];
+      const double* const row_costs = costs + static_cast<int64>(row) * n;
+      double best = row_costs[0] - v[0];
+      double second_best = kInfinity;
+      int best_col = 0;
+      int second_best_col = 0;
+      for (int col = 1; col < n; ++col) {
+        const double reduced_cost = row_costs[col] - v[col];
+        if (reduced_cost < second_best) {
+          if (reduced_cost >= best) {
+            second_best = reduced_cost;
+            second_best_col = col;
+          } else {
+            second_best = best;
+            second_best_col = best_col;
+            best = reduced_cost;
+            best_col = col;
+          }
+        }
       }
-    }
-  }
-}
-
-// Uncovery ever row and column in the matrix.
-void HungarianOptimizer::ClearCovers() {
-  for (int x = 0; x < matrix_size_; x++) {
-    UncoverRow(x);
-    UncoverCol(x);
-  }
-}
-
-// Find the smallest uncovered cell in the matrix.
-double HungarianOptimizer::FindSmallestUncovered() const {
-  double minval = std::numeric_limits<double>::max();
-
-  for (int row = 0; row < matrix_size_; ++row) {
-    if (RowCovered(row)) {
-      continue;
-    }
-
-    for (int col = 0; col < matrix_size_; ++col) {
-      if (ColCovered(col)) {
-        continue;
+      int previous_row = col_sol[best_col];
+      if (best < second_best) {
+        v[best_col] -= second_best - best;
+      } else if (previous_row >= 0) {
+        // Ties: take the second best column, to avoid cycling.
+        best_col = second_best_col;
+        previous_row = col_sol[best_col];
+      }
+      row_sol[row] = best_col;
+      col_sol[best_col] = row;
+      if (previous_row >= 0) {
+        row_sol[previous_row] = -1;
+        if (best < second_best) {
+          free_rows[--k] = previous_row;
+        } else {
+          free_rows[num_free_rows++] = previous_row;
+        }
       }
-
-      minval = std::min(minval, costs_[row][col]);
     }
+    free_rows.resize(num_free_rows);
   }
 
-  return minval;
-}
-
-// Find an uncovered zero and store its co-ordinates in (zeroRow, zeroCol)
-// and return true, or return false if no such cell exists.
-bool HungarianOptimizer::FindZero(int* zero_row, int* zero_col) const {
-  for (int row = 0; row < matrix_size_; ++row) {
-    if (RowCovered(row)) {
-      continue;
+  // Augmentation: assign each remaining free row along a shortest augmenting
+  // path from it, using Dijkstra's algorithm on the reduced costs. The
+  // columns are kept in to_scan, where the ones in [0, low) are done, the
+  // ones in [low, up) are at the current minimum distance and still need to
+  // be scanned, and the ones in [up, n) are not reached yet.
+  std::vector<double> distance(n);
+  std::vector<int> predecessor(n);
+  std::vector<int> to_scan(n);
+  for (const int free_row : free_rows) {
+    const double* const free_row_costs =
+        costs + static_cast<int64>(free_row) * n;
+    for (int col = 0; col < n; ++col) {
+      distance[col] = free_row_costs[col] - v[col];
+      predecessor[col] = free_row;
+      to_scan[col] = col;
     }
-
-    for (int col = 0; col < matrix_size_; ++col) {
-      if (ColCovered(col)) {
-        continue;
+    int low = 0;
+    int up = 0;
+    int last_done = 0;
+    int end_of_path = -1;
+    double min_distance = 0.0;
+    while (end_of_path < 0) {
+      if (up == low) {
+        // Find the columns at the new minimum distance.
+        last_done = low;
+        min_distance = distance[to_scan[up++]];
+        for (int k = up; k < n; ++k) {
+          const int col = to_scan[k];
+          const double d = distance[col];
+          if (d <= min_distance) {
+            if (d < min_distance) {
+              up = low;
+              min_distance = d;
+            }
+            to_scan[k] = to_scan[up];
+            to_scan[up++] = col;
+          }
+        }
+        for (int k = low; k < up; ++k) {
+          if (col_sol[to_scan[k]] < 0) {
+            end_of_path = to_scan[k];
+            break;
+          }
+        }
+        if (end_of_path >= 0) break;
       }
-
-      if (costs_[row][col] == 0) {
-        *zero_row = row;
-        *zero_col = col;
-        return true;
+      // Scan the next column at the minimum distance, through its row.
+      const int scanned_col = to_scan[low++];
+      const int row = col_sol[scanned_col];
+      const double* const row_costs = costs + static_cast<int64>(row) * n;
+      const double offset =
+          row_costs[scanned_col] - v[scanned_col] - min_distance;
+      for (int k = up; k < n; ++k) {
+        const int col = to_scan[k];
+        const double d = row_costs[col] - v[col] - offset;
+        if (d < distance[col]) {
+          predecessor[col] = row;
+          distance[col] = d;
+          if (d == min_distance) {
+            if (col_sol[col] < 0) {
+              end_of_path = col;
+              break;
+            }
+            to_scan[k] = to_scan[up];
+            to_scan[up++] = col;
+          }
+        }
       }
     }
-  }
-
-  return false;
-}
-
-// Print the matrix to stdout (for debugging.)
-void HungarianOptimizer::PrintMatrix() {
-  for (int row = 0; row < matrix_size_; ++row) {
-    for (int col = 0; col < matrix_size_; ++col) {
-      printf("%g ", costs_[row][col]);
 
-      if (IsStarred(row, col)) {
-        printf("*");
-      }
-
-      if (IsPrimed(row, col)) {
-        printf("'");
-      }
+    // Update the dual values of the columns that are done.
+    for (int k = 0; k < last_done; ++k) {
+      const int col = to_scan[k];
+      v[col] += distance[col] - min_distance;
     }
-    printf("\n");
-  }
-}
 
-//  Run the Munkres algorithm!
-void HungarianOptimizer::DoMunkres() {
-  state_ = &HungarianOptimizer::ReduceRows;
-  while (state_ != NULL) {
-    (this->*state_)();
-  }
-}
-
-// Step 1.
-// For each row of the matrix, find the smallest element and subtract it
-// from every element in its row.  Go to Step 2.
-void HungarianOptimizer::ReduceRows() {
-  for (int row = 0; row < matrix_size_; ++row) {
-    double min_cost = costs_[row][0];
-    for (int col = 1; col < matrix_size_; ++col) {
-      min_cost = std::min(min_cost, costs_[row][col]);
-    }
-    for (int col = 0; col < matrix_size_; ++col) {
-      costs_[row][col] -= min_cost;
+    // Augment along the path.
+    while (true) {
+      const int row = predecessor[end_of_path];
+      col_sol[end_of_path] = row;
+      const int next_col = row_sol[row];
+      row_sol[row] = end_of_path;
+      if (row == free_row) break;
+      end_of_path = next_col;
     }
   }
-  state_ = &HungarianOptimizer::StarZeroes;
-}
-
-// Step 2.
-// Find a zero (Z) in the matrix.  If there is no starred zero in its row
-// or column, star Z.  Repeat for every element in the matrix.  Go to step 3.
-// of the CPU - the next slowest step takes 0.6%.  I can't think of a way
-// of speeding it up though.
-void HungarianOptimizer::StarZeroes() {
-  // Since no rows or columns are covered on entry to this step, we use the
-  // covers as a quick way of marking which rows & columns have stars in them.
-  for (int row = 0; row < matrix_size_; ++row) {
-    if (RowCovered(row)) {
-      continue;
-    }
-
-    for (int col = 0; col < matrix_size_; ++col) {
-      if (ColCovered(col)) {
-        continue;
-      }
 
-      if (costs_[row][col] == 0) {
-        Star(row, col);
-        CoverRow(row);
-        CoverCol(col);
-        break;
-      }
-    }
+  double total_cost = 0.0;
+  for (int row = 0; row < n; ++row) {
+    DCHECK_GE(row_sol[row], 0);
+    total_cost += costs[static_cast<int64>(row) * n + row_sol[row]];
   }
-
-  ClearCovers();
-  state_ = &HungarianOptimizer::CoverStarredZeroes;
+  return total_cost;
 }
 
-// Step 3.
-// Cover each column containing a starred zero.  If all columns are
-// covered, the starred zeros describe a complete set of unique assignments.
-// In this case, terminate the algorithm.  Otherwise, go to step 4.
-void HungarianOptimizer::CoverStarredZeroes() {
-  int num_covered = 0;
-
-  for (int col = 0; col < matrix_size_; ++col) {
-    if (ColContainsStar(col)) {
-      CoverCol(col);
-      num_covered++;
-    }
-  }
-
-  if (num_covered >= matrix_size_) {
-    state_ = NULL;
-    return;
+// Solves the rectangular problem, with costs multiplied by sign.
+double SolveAssignment(int num_rows, int num_cols,
+                       const std::vector<double>& costs, double sign,
+                       std::vector<int>* col_of_row) {
+  CHECK_GE(num_rows, 0);
+  CHECK_GE(num_cols, 0);
+  CHECK_EQ(static_cast<int64>(num_rows) * num_cols, costs.size());
+  col_of_row->assign(num_rows, -1);
+  if (num_rows == 0 || num_cols == 0) return 0.0;
+  if (num_rows == num_cols && sign > 0.0) {
+    return SolveSquareAssignment(num_rows, costs.data(), col_of_row);
   }
-  state_ = &HungarianOptimizer::PrimeZeroes;
-}
-
-// Step 4.
-// Find a noncovered zero and prime it.  If there is no starred zero in the
-// row containing this primed zero, Go to Step 5.  Otherwise, cover this row
-// and uncover the column containing the starred zero. Continue in this manner
-// until there are no uncovered zeros left, then go to Step 6.
 
-void HungarianOptimizer::PrimeZeroes() {
-  // This loop is guaranteed to terminate in at most matrix_size_ iterations,
-  // as findZero() returns a location only if there is at least one uncovered
-  // zero in the matrix.  Each iteration, either one row is covered or the
-  // loop terminates.  Since there are matrix_size_ rows, after that many
-  // iterations there are no uncovered cells and hence no uncovered zeroes,
-  // so the loop terminates.
-  for (;;) {
-    int zero_row, zero_col;
-    if (!FindZero(&zero_row, &zero_col)) {
-      // No uncovered zeroes.
-      state_ = &HungarianOptimizer::AugmentPath;
-      return;
+  // Make the problem square by adding rows or columns of zero cost.
+  const int n = std::max(num_rows, num_cols);
+  std::vector<double> square_costs(static_cast<int64>(n) * n, 0.0);
+  for (int row = 0; row < num_rows; ++row) {
+    for (int col = 0; col < num_cols; ++col) {
+      square_costs[static_cast<int64>(row) * n + col] =
+          sign * costs[static_cast<int64>(row) * num_cols + col];
     }
-
-    Prime(zero_row, zero_col);
-    int star_col = FindStarInRow(zero_row);
-
-    if (star_col != kHungarianOptimizerColNotFound) {
-      CoverRow(zero_row);
-      UncoverCol(star_col);
-    } else {
-      preimage_[0] = zero_row;
-      image_[0] = zero_col;
-      state_ = &HungarianOptimizer::MakeAugmentingPath;
-      return;
+  }
+  std::vector<int> square_col_of_row;
+  SolveSquareAssignment(n, square_costs.data(), &square_col_of_row);
+  double total_cost = 0.0;
+  for (int row = 0; row < num_rows; ++row) {
+    const int col = square_col_of_row[row];
+    if (col < num_cols) {
+      (*col_of_row)[row] = col;
+      total_cost += costs[static_cast<int64>(row) * num_cols + col];
     }
   }
+  return total_cost;
 }
 
-// Step 5.
-// Construct a series of alternating primed and starred zeros as follows.
-// Let Z0 represent the uncovered primed zero found in Step 4.  Let Z1 denote
-// the starred zero in the column of Z0 (if any). Let Z2 denote the primed
-// zero in the row of Z1 (there will always be one).  Continue until the
-// series terminates at a primed zero that has no starred zero in its column.
-// Unstar each starred zero of the series, star each primed zero of the
-// series, erase all primes and uncover every line in the matrix.  Return to
-// Step 3.
-void HungarianOptimizer::MakeAugmentingPath() {
-  bool done = false;
-  int count = 0;
-
-  // Note: this loop is guaranteed to terminate within matrix_size_ iterations
-  // because:
-  // 1) on entry to this step, there is at least 1 column with no starred zero
-  //    (otherwise we would have terminated the algorithm already.)
-  // 2) each row containing a star also contains exactly one primed zero.
-  // 4) each column contains at most one starred zero.
-  //
-  // Since the path_ we construct visits primed and starred zeroes alternately,
-  // and terminates if we reach a primed zero in a column with no star, our
-  // path_ must either contain matrix_size_ or fewer stars (in which case the
-  // loop iterates fewer than matrix_size_ times), or it contains more.  In
-  // that case, because (1) implies that there are fewer than
-  // matrix_size_ stars, we must have visited at least one star more than once.
-  // Consider the first such star that we visit more than once; it must have
-  // been reached immediately after visiting a prime in the same row.  By (2),
-  // this prime is unique and so must have also been visited more than once.
-  // Therefore, that prime must be in the same column as a star that has been
-  // visited more than once, contradicting the assumption that we chose the
-  // first multiply visited star, or it must be in the same column as more
-  // than one star, contradicting (3).  Therefore, we never visit any star
-  // more than once and the loop terminates within matrix_size_ iterations.
-
-  while (!done) {
-    // First construct the alternating path...
-    int row = FindStarInCol(image_[count]);
-
-    if (row != kHungarianOptimizerRowNotFound) {
-      count++;
-      preimage_[count] = row;
-      image_[count] = image_[count - 1];
-    } else {
-      done = true;
-    }
-
-    if (!done) {
-      int col = FindPrimeInRow(preimage_[count]);
-      count++;
-      preimage_[count] = preimage_[count - 1];
-      image_[count] = col;
-    }
+// Flattens the cost matrix of the legacy API, and fills the assignments.
+void SolveLegacyAssignment(const std::vector<std::vector<double> >& cost,
+                           double sign, hash_map<int, int>* direct_assignment,
+                           hash_map<int, int>* reverse_assignment) {
+  const int num_rows = cost.size();
+  const int num_cols = num_rows == 0 ? 0 : cost[0].size();
+  std::vector<double> costs;
+  costs.reserve(static_cast<int64>(num_rows) * num_cols);
+  for (const std::vector<double>& row_costs : cost) {
+    CHECK_EQ(num_cols, row_costs.size());
+    costs.insert(costs.end(), row_costs.begin(), row_costs.end());
   }
-
-  // Then modify it.
-  for (int i = 0; i <= count; ++i) {
-    int row = preimage_[i];
-    int col = image_[i];
-
-    if (IsStarred(row, col)) {
-      UnStar(row, col);
-    } else {
-      Star(row, col);
-    }
+  std::vector<int> col_of_row;
+  SolveAssignment(num_rows, num_cols, costs, sign, &col_of_row);
+  for (int row = 0; row < num_rows; ++row) {
+    const int col = col_of_row[row];
+    if (col < 0) continue;
+    (*direct_assignment)[row] = col;
+    (*reverse_assignment)[col] = row;
   }
-
-  ClearCovers();
-  ClearPrimes();
-  state_ = &HungarianOptimizer::CoverStarredZeroes;
 }
 
-// Step 6
-// Add the smallest uncovered value in the matrix to every element of each
-// covered row, and subtract it from every element of each uncovered column.
-// Return to Step 4 without altering any stars, primes, or covered lines.
-void HungarianOptimizer::AugmentPath() {
-  double minval = FindSmallestUncovered();
-
-  for (int row = 0; row < matrix_size_; ++row) {
-    for (int col = 0; col < matrix_size_; ++col) {
-      if (RowCovered(row)) {
-        costs_[row][col] += minval;
-      }
+}  // namespace
 
-      if (!ColCovered(col)) {
-        costs_[row][col] -= minval;
-      }
-    }
-  }
+double MinimizeDenseLinearAssignment(int num_rows, int num_cols,
+                                     const std::vector<double>& costs,
+                                     std::vector<int>* col_of_row) {
+  return SolveAssignment(num_rows, num_cols, costs, 1.0, col_of_row);
+}
 
-  state_ = &HungarianOptimizer::PrimeZeroes;
+double MaximizeDenseLinearAssignment(int num_rows, int num_cols,
+                                     const std::vector<double>& costs,
+                                     std::vector<int>* col_of_row) {
+  return SolveAssignment(num_rows, num_cols, costs, -1.0, col_of_row);
 }
 
 void MinimizeLinearAssignment(const std::vector<std::vector<double> >& cost,
                               hash_map<int, int>* direct_assignment,
                               hash_map<int, int>* reverse_assignment) {
-  std::vector<int> agent;
-  std::vector<int> task;
-  HungarianOptimizer hungarian_optimizer(cost);
-  hungarian_optimizer.Minimize(&agent, &task);
-  for (int i = 0; i < agent.size(); ++i) {
-    (*direct_assignment)[agent[i]] = task[i];
-    (*reverse_assignment)[task[i]] = agent[i];
-  }
+  SolveLegacyAssignment(cost, 1.0, direct_assignment, reverse_assignment);
 }
 
 void MaximizeLinearAssignment(const std::vector<std::vector<double> >& cost,
                               hash_map<int, int>* direct_assignment,
                               hash_map<int, int>* reverse_assignment) {
-  std::vector<int> agent;
-  std::vector<int> task;
-  HungarianOptimizer hungarian_optimizer(cost);
-  hungarian_optimizer.Maximize(&agent, &task);
-  for (int i = 0; i < agent.size(); ++i) {
-    (*direct_assignment)[agent[i]] = task[i];
-    (*reverse_assignment)[task[i]] = agent[i];
-  }
+  SolveLegacyAssignment(cost, -1.0, direct_assignment, reverse_assignment);
 }
 
 }  // namespace operations_research
@@ -13,26 +13,22 @@
 
 //
 // IMPORTANT NOTE: we advise to use the code in
-// graph/linear_assignment.h whose complexity is
+// graph/linear_assignment.h for sparse problems, whose complexity is
 // usually much smaller.
-// TODO(user): base this code on LinearSumAssignment.
 //
-// See: //depot/google3/java/com/google/wireless/genie/frontend
-//       /mixer/matching/HungarianOptimizer.java
-
-// An O(n^4) implementation of the Kuhn-Munkres algorithm (aka the
-// Hungarian algorithm) for solving the assignment problem.
-// The assignment problem takes a set of agents, a set of tasks and a
-// cost associated with assigning each agent to each task and produces
-// an optimal (i.e. least cost) assignment of agents to tasks.
-// The code also enables to compute a maximum assignment by changing the
-// input matrix.
+// Dense linear assignment: given a matrix of the cost of assigning each agent
+// to each task, find an assignment of agents to tasks of minimum (or maximum)
+// total cost. The matrix does not have to be square: when there are more
+// agents than tasks (or vice-versa), some agents (or tasks) stay unassigned.
 //
-// This code is based on (read: translated from) the Java version
-// (read: translated from) the python version at
-//   http://www.clapper.org/software/python/munkres/
-// which in turn is based on
-//   http://www.public.iastate.edu/~ddoty/HungarianAlgorithm.html.
+// This is an O(n^3) implementation of the shortest augmenting path algorithm
+// of Jonker and Volgenant (LAPJV):
+//   R. Jonker, A. Volgenant, "A Shortest Augmenting Path Algorithm for Dense
+//   and Sparse Linear Assignment Problems", Computing 38:325-340, 1987.
+// It starts with a column reduction, a reduction transfer and two rounds of
+// augmenting row reduction, which assign most rows cheaply, and then assigns
+// each remaining row along a shortest augmenting path (a Dijkstra search on
+// the reduced costs).
 
 #ifndef OR_TOOLS_ALGORITHMS_HUNGARIAN_H_
 #define OR_TOOLS_ALGORITHMS_HUNGARIAN_H_
@@ -42,7 +38,25 @@
 
 namespace operations_research {
 
-// See IMPORTANT NOTE at the top of the file.
+// Finds an assignment of minimum total cost for the dense num_rows x num_cols
+// cost matrix given in row-major order: costs[row * num_cols + col] is the
+// cost of assigning agent "row" to task "col". The costs can be negative,
+// but must be finite. Returns the total cost, and fills col_of_row (of size
+// num_rows) with the task assigned to each agent, or -1 if the agent is
+// unassigned (which only happens when num_rows > num_cols).
+double MinimizeDenseLinearAssignment(int num_rows, int num_cols,
+                                     const std::vector<double>& costs,
+                                     std::vector<int>* col_of_row);
+
+// Same as above, but finds an assignment of maximum total cost.
+double MaximizeDenseLinearAssignment(int num_rows, int num_cols,
+                                     const std::vector<double>& costs,
+                                     std::vector<int>* col_of_row);
+
+// Legacy API: cost[i][j] is the cost of assigning agent i to task j, and all
+// the rows must have the same size. The assigned pairs (agent, task) are
+// added to direct_assignment, and the pairs (task, agent) to
+// reverse_assignment.
 void MinimizeLinearAssignment(const std::vector<std::vector<double> >& cost,
                               hash_map<int, int>* direct_assignment,
                               hash_map<int, int>* reverse_assignment);
@@ -19,7 +19,9 @@
 #include <string>
 #include <vector>
 
+#include "base/callback.h"
 #include "base/stl_util.h"
+#include "base/threadpool.h"
 #include "linear_solver/linear_solver.h"
 #include "util/bitset.h"
 #include "util/time_limit.h"
@@ -31,6 +33,10 @@ const int kNoSelection = -1;
 const int kMasterPropagatorId = 0;
 const int kMaxNumberOfBruteForceItems = 30;
 const int kMaxNumberOf64Items = 64;
+// The maximum number of states recorded by KnapsackExpandingCoreSolver to
+// rebuild its solution (4 bytes each). When it is reached, the best solution
+// found so far is returned, as when the time limit is reached.
+const int64 kMaxNumberOfRecordedStates = 1LL << 27;
 
 // Comparator used to sort item in decreasing efficiency order
 // (see KnapsackCapacityPropagator).
@@ -1017,6 +1023,376 @@ int64 KnapsackDynamicProgrammingSolver::Solve(TimeLimit* time_limit,
   return computed_profits_[capacity_];
 }
 
+// ----- KnapsackExpandingCoreSolver -----
+// KnapsackExpandingCoreSolver solves the 0-1 knapsack problem with the
+// expanding core algorithm of D. Pisinger, "A minimal algorithm for the 0-1
+// knapsack problem", Operations Research 45(5):758-767, 1997.
+// The items are considered in decreasing efficiency order, starting from the
+// break solution which contains all the items before the break item (the
+// first one that does not fit). Most items far from the break item have the
+// same value in the break solution and in the optimal one, so:
+//  - The break item is found in linear time by partitioning the items around
+//    an efficiency, like a selection algorithm, without sorting them.
+//  - The items whose value in the break solution cannot change without
+//    making the upper bound of Dembo and Hammer smaller than the profit of a
+//    greedy solution are fixed; only the other ones (the core) are sorted.
+//  - The dynamic programming then adds the core items one by one,
+//    alternatively after and before the break item, to a list of states each
+//    representing a partial solution by its weight and its profit. The
+//    dominated states and the states whose upper bound is not better than
+//    the best known solution are pruned from the list (as in a branch and
+//    bound), which usually stops the algorithm long before all the core items
+//    are considered.
+// Unlike KnapsackDynamicProgrammingSolver, the time and the memory do not
+// depend on the capacity. This solver handles instances with millions of
+// items and large weights.
+class KnapsackExpandingCoreSolver : public BaseKnapsackSolver {
+ public:
+  explicit KnapsackExpandingCoreSolver(const std::string& solver_name);
+
+  // Initializes the solver and enters the problem to be solved.
+  void Init(const std::vector<int64>& profits,
+            const std::vector<std::vector<int64> >& weights,
+            const std::vector<int64>& capacities) override;
+
+  // Solves the problem and returns the profit of the optimal solution.
+  int64 Solve(TimeLimit* time_limit, bool* is_solution_optimal) override;
+
+  // Returns true if the item 'item_id' is packed in the optimal knapsack.
+  bool best_solution(int item_id) const override {
+    return best_solution_.at(item_id);
+  }
+
+ private:
+  // A partial solution of the dynamic programming.
+  struct State {
+    int64 weight;
+    int64 profit;
+  };
+
+  // Partitions items_ so that the break item for the given capacity is at the
+  // returned position, the items before it being at least as efficient and
+  // the items after it at most as efficient.
+  int PartitionAroundBreakItem(int64 capacity);
+
+  // Adds the given core item to the states: it is added to (or removed from
+  // if is_removed is true) each state to create a new one, the two lists are
+  // merged, and the dominated and hopeless states are pruned. The efficiency
+  // of the next item that can be added (resp. removed) is used to compute the
+  // upper bound of the states, and must be 0 (resp. infinity) if there is no
+  // such item.
+  void AddCoreItem(const KnapsackItemWithEfficiency& item, bool is_removed,
+                   double next_added_efficiency,
+                   double next_removed_efficiency);
+
+  std::vector<int64> profits_;
+  std::vector<int64> weights_;
+  int64 capacity_;
+  std::vector<KnapsackItemWithEfficiency> items_;
+  std::vector<KnapsackItemWithEfficiency> core_items_;
+
+  // The states of the dynamic programming, sorted by increasing weight and
+  // increasing profit, and the next ones.
+  std::vector<State> states_;
+  std::vector<State> next_states_;
+
+  // To rebuild the best solution, the states of each level (the number of core
+  // items added) are recorded in trail_ from trail_start_[level]: each one as
+  // 2 * (its index in the previous level) + (1 if the core item was changed).
+  std::vector<uint32> trail_;
+  std::vector<int64> trail_start_;
+  std::vector<int> core_item_of_level_;
+  int64 best_profit_;
+  int best_level_;
+  uint32 best_state_;
+  std::vector<bool> best_solution_;
+};
+
+// ----- KnapsackExpandingCoreSolver -----
+KnapsackExpandingCoreSolver::KnapsackExpandingCoreSolver(
+    const std::string& solver_name)
+    : BaseKnapsackSolver(solver_name),
+      capacity_(0),
+      best_profit_(0),
+      best_level_(0),
+      best_state_(0) {}
+
+void KnapsackExpandingCoreSolver::Init(
+    const std::vector<int64>& profits,
+    const std::vector<std::vector<int64> >& weights,
+    const std::vector<int64>& capacities) {
+  CHECK_EQ(weights.size(), 1)
+      << "The expanding core solver only deals with one dimension.";
+  CHECK_EQ(capacities.size(), weights.size());
+
+  profits_ = profits;
+  weights_ = weights[0];
+  capacity_ = capacities[0];
+}
+
+int KnapsackExpandingCoreSolver::PartitionAroundBreakItem(int64 capacity) {
+  // The break item is always in [begin, end), and the items before begin fit
+  // in the knapsack with a total weight of weight_before.
+  int begin = 0;
+  int end = items_.size();
+  int64 weight_before = 0;
+  while (true) {
+    DCHECK_LT(begin, end);
+    // The pivot is the median of three efficiencies.
+    double pivot[3] = {items_[begin].efficiency,
+                       items_[begin + (end - begin) / 2].efficiency,
+                       items_[end - 1].efficiency};
+    std::sort(pivot, pivot + 3);
+    const double pivot_efficiency = pivot[1];
+    const auto more_efficient_end = std::partition(
+        items_.begin() + begin, items_.begin() + end,
+        [pivot_efficiency](const KnapsackItemWithEfficiency& item) {
+          return item.efficiency > pivot_efficiency;
+        });
+    const auto as_efficient_end = std::partition(
+        more_efficient_end, items_.begin() + end,
+        [pivot_efficiency](const KnapsackItemWithEfficiency& item) {
+          return item.efficiency >= pivot_efficiency;
+        });
+    int64 more_efficient_weight = 0;
+    for (auto it = items_.begin() + begin; it != more_efficient_end; ++it) {
+      more_efficient_weight += it->weight;
+    }
+    if (weight_before + more_efficient_weight > capacity) {
+      end = more_efficient_end - items_.begin();
+      continue;
+    }
+    weight_before += more_efficient_weight;
+    for (auto it = more_efficient_end; it != as_efficient_end; ++it) {
+      if (weight_before + it->weight > capacity) return it - items_.begin();
+      weight_before += it->weight;
+    }
+    begin = as_efficient_end - items_.begin();
+  }
+}
+
+void KnapsackExpandingCoreSolver::AddCoreItem(
+    const KnapsackItemWithEfficiency& item, bool is_removed,
+    double next_added_efficiency, double next_removed_efficiency) {
+  const int64 weight_change = is_removed ? -item.weight : item.weight;
+  const int64 profit_change = is_removed ? -item.profit : item.profit;
+  const int level = trail_start_.size();
+  // A state is only kept if its upper bound can improve the best solution by
+  // at least one. The bound is compared to the best profit relatively to the
+  // profit of the state, which is exact, and the tolerance protects against
+  // the rounding errors of the remaining part.
+  const double kRelativeTolerance = 1e-9;
+  auto add_state = [this, level, next_added_efficiency,
+                    next_removed_efficiency, kRelativeTolerance](
+      int64 weight, int64 profit, uint32 trail_code) {
+    if (!next_states_.empty() && next_states_.back().profit >= profit) return;
+    // The states with the same weight are added best profit first, so the
+    // only other dominated state is the last one.
+    if (!next_states_.empty() && next_states_.back().weight == weight) {
+      next_states_.pop_back();
+      trail_.pop_back();
+    }
+    double bound_increase;
+    if (weight <= capacity_) {
+      if (profit > best_profit_) {
+        best_profit_ = profit;
+        best_level_ = level;
+        best_state_ = trail_code;
+      }
+      bound_increase = (capacity_ - weight) * next_added_efficiency;
+    } else {
+      bound_increase = -(weight - capacity_) * next_removed_efficiency;
+    }
+    if (bound_increase + kRelativeTolerance * std::abs(bound_increase) <
+        best_profit_ + 1 - profit) {
+      return;
+    }
+    next_states_.push_back({weight, profit});
+    trail_.push_back(trail_code);
+  };
+
+  // Merges the states without and with the change of the item, which are
+  // both sorted by weight.
+  trail_start_.push_back(trail_.size());
+  core_item_of_level_.push_back(item.id);
+  next_states_.clear();
+  const int num_states = states_.size();
+  int unchanged = 0;
+  int changed = 0;
+  while (unchanged < num_states || changed < num_states) {
+    const bool take_changed =
+        unchanged == num_states ||
+        (changed < num_states &&
+         (states_[changed].weight + weight_change <
+              states_[unchanged].weight ||
+          (states_[changed].weight + weight_change ==
+               states_[unchanged].weight &&
+           states_[changed].profit + profit_change >
+               states_[unchanged].profit)));
+    if (take_changed) {
+      add_state(states_[changed].weight + weight_change,
+                states_[changed].profit + profit_change, 2 * changed + 1);
+      ++changed;
+    } else {
+      add_state(states_[unchanged].weight, states_[unchanged].profit,
+                2 * unchanged);
+      ++unchanged;
+    }
+  }
+  states_.swap(next_states_);
+}
+
+int64 KnapsackExpandingCoreSolver::Solve(TimeLimit* time_limit,
+                                         bool* is_solution_optimal) {
+  DCHECK(is_solution_optimal != nullptr);
+  *is_solution_optimal = true;
+  const int num_items = profits_.size();
+  best_solution_.assign(num_items, false);
+
+  // The items without weight are always packed, and the items without profit
+  // or that are too heavy never are.
+  int64 total_weight = 0;
+  items_.clear();
+  for (int item_id = 0; item_id < num_items; ++item_id) {
+    DCHECK_GE(weights_[item_id], 0);
+    if (profits_[item_id] <= 0 || weights_[item_id] > capacity_) continue;
+    if (weights_[item_id] == 0) {
+      best_solution_[item_id] = true;
+    } else {
+      items_.push_back(KnapsackItemWithEfficiency(
+          item_id, profits_[item_id], weights_[item_id], 0));
+      total_weight += weights_[item_id];
+    }
+  }
+  if (total_weight <= capacity_) {
+    for (const KnapsackItemWithEfficiency& item : items_) {
+      best_solution_[item.id] = true;
+    }
+  } else {
+    const int break_position = PartitionAroundBreakItem(capacity_);
+    const KnapsackItemWithEfficiency& break_item = items_[break_position];
+    int64 break_weight = 0;
+    int64 break_profit = 0;
+    for (int i = 0; i < break_position; ++i) {
+      break_weight += items_[i].weight;
+      break_profit += items_[i].profit;
+    }
+
+    // A first solution completes the break solution greedily.
+    best_profit_ = break_profit;
+    int64 greedy_weight = break_weight;
+    std::vector<int> greedy_items;
+    for (int i = break_position; i < items_.size(); ++i) {
+      if (greedy_weight + items_[i].weight <= capacity_) {
+        greedy_weight += items_[i].weight;
+        best_profit_ += items_[i].profit;
+        greedy_items.push_back(items_[i].id);
+      }
+    }
+    const int64 greedy_profit = best_profit_;
+
+    // An item of efficiency e whose value is changed in the break solution
+    // decreases the Dembo-Hammer upper bound by |profit - e * weight|, so it
+    // has the same value in all the solutions better than the best one if
+    // this decrease is larger than the gap. The gap decreases as better
+    // solutions are found, so this is tested again before adding an item to
+    // the states.
+    const double break_efficiency = break_item.efficiency;
+    const double break_bound_increase =
+        (capacity_ - break_weight) * break_efficiency;
+    const double kRelativeTolerance = 1e-9;
+    auto may_change = [this, break_profit, break_efficiency,
+                       break_bound_increase, kRelativeTolerance](
+        const KnapsackItemWithEfficiency& item) {
+      const double decrease =
+          std::abs(item.profit - break_efficiency * item.weight);
+      return decrease <= break_bound_increase + (break_profit - best_profit_) +
+                             kRelativeTolerance * item.profit;
+    };
+    std::vector<KnapsackItemWithEfficiency> after_break_items;
+    core_items_.clear();
+    for (int i = 0; i < items_.size(); ++i) {
+      if (i == break_position || may_change(items_[i])) {
+        if (i < break_position) {
+          core_items_.push_back(items_[i]);
+        } else {
+          after_break_items.push_back(items_[i]);
+        }
+      }
+    }
+    const int num_core_items_before_break = core_items_.size();
+    std::sort(core_items_.begin(), core_items_.end(),
+              CompareKnapsackItemWithEfficiencyInDecreasingEfficiencyOrder);
+    std::sort(after_break_items.begin(), after_break_items.end(),
+              CompareKnapsackItemWithEfficiencyInDecreasingEfficiencyOrder);
+    core_items_.insert(core_items_.end(), after_break_items.begin(),
+                       after_break_items.end());
+    const int num_core_items = core_items_.size();
+
+    // The core items in [first, last) are free in the states, the ones before
+    // are packed and the ones after are not.
+    states_.assign(1, {break_weight, break_profit});
+    trail_.clear();
+    trail_start_.clear();
+    core_item_of_level_.clear();
+    best_level_ = -1;
+    const double kInfinity = std::numeric_limits<double>::infinity();
+    int first = num_core_items_before_break;
+    int last = num_core_items_before_break;
+    while (!states_.empty() && (first > 0 || last < num_core_items)) {
+      if (time_limit->LimitReached() ||
+          trail_.size() > kMaxNumberOfRecordedStates) {
+        *is_solution_optimal = false;
+        break;
+      }
+      if (last < num_core_items) {
+        ++last;
+        if (may_change(core_items_[last - 1])) {
+          AddCoreItem(
+              core_items_[last - 1], false,
+              last < num_core_items ? core_items_[last].efficiency : 0.0,
+              first > 0 ? core_items_[first - 1].efficiency : kInfinity);
+        }
+      }
+      if (!states_.empty() && first > 0) {
+        --first;
+        if (may_change(core_items_[first])) {
+          AddCoreItem(
+              core_items_[first], true,
+              last < num_core_items ? core_items_[last].efficiency : 0.0,
+              first > 0 ? core_items_[first - 1].efficiency : kInfinity);
+        }
+      }
+    }
+
+    // Builds the best solution from the break solution.
+    for (int i = 0; i < break_position; ++i) {
+      best_solution_[items_[i].id] = true;
+    }
+    if (best_level_ == -1) {
+      DCHECK_EQ(greedy_profit, best_profit_);
+      for (const int item_id : greedy_items) best_solution_[item_id] = true;
+    } else {
+      uint32 trail_code = best_state_;
+      for (int level = best_level_; level >= 0; --level) {
+        if (trail_code & 1) {
+          const int item_id = core_item_of_level_[level];
+          best_solution_[item_id] = !best_solution_[item_id];
+        }
+        if (level > 0) {
+          trail_code = trail_[trail_start_[level - 1] + (trail_code >> 1)];
+        }
+      }
+    }
+  }
+
+  int64 profit = 0;
+  for (int item_id = 0; item_id < num_items; ++item_id) {
+    if (best_solution_[item_id]) profit += profits_[item_id];
+  }
+  return profit;
+}
+
 // ----- KnapsackMIPSolver -----
 class KnapsackMIPSolver : public BaseKnapsackSolver {
  public:
@@ -1130,6 +1506,9 @@ KnapsackSolver::KnapsackSolver(SolverType solver_type,
     case KNAPSACK_MULTIDIMENSION_BRANCH_AND_BOUND_SOLVER:
       solver_.reset(new KnapsackGenericSolver(solver_name));
       break;
+    case KNAPSACK_EXPANDING_CORE_SOLVER:
+      solver_.reset(new KnapsackExpandingCoreSolver(solver_name));
+      break;
     #if defined(USE_CBC)
     case KNAPSACK_MULTIDIMENSION_CBC_MIP_SOLVER:
       solver_.reset(new KnapsackMIPSolver(
@@ -1350,4 +1729,121 @@ void BaseKnapsackSolver::GetLowerAndUpperBoundWhenItem(int item_id,
   *upper_bound = kint64max;
 }
 
+// ----- KnapsackBatchSolver -----
+KnapsackBatchSolver::KnapsackBatchSolver(KnapsackSolver::SolverType solver_type,
+                                         const std::string& solver_name,
+                                         int num_threads)
+    : solver_type_(solver_type),
+      solver_name_(solver_name),
+      num_threads_(std::max(1, num_threads)),
+      use_reduction_(true),
+      time_limit_seconds_(std::numeric_limits<double>::infinity()),
+      num_items_(0),
+      next_problem_(0) {}
+
+KnapsackBatchSolver::~KnapsackBatchSolver() {}
+
+void KnapsackBatchSolver::Init(const std::vector<std::vector<int64> >& weights,
+                               const std::vector<int64>& capacities) {
+  CHECK_EQ(capacities.size(), weights.size());
+  CHECK(!weights.empty());
+  num_items_ = weights[0].size();
+  fitting_items_.clear();
+  for (int item_id = 0; item_id < num_items_; ++item_id) {
+    bool fits = true;
+    for (int dim = 0; dim < weights.size(); ++dim) {
+      DCHECK_GE(weights[dim][item_id], 0);
+      fits = fits && weights[dim][item_id] <= capacities[dim];
+    }
+    if (fits) fitting_items_.push_back(item_id);
+  }
+  fitting_weights_.clear();
+  capacities_.clear();
+  for (int dim = 0; dim < weights.size(); ++dim) {
+    int64 total_weight = 0;
+    for (const int item_id : fitting_items_) {
+      total_weight += weights[dim][item_id];
+    }
+    if (total_weight <= capacities[dim]) continue;
+    fitting_weights_.push_back(std::vector<int64>());
+    for (const int item_id : fitting_items_) {
+      fitting_weights_.back().push_back(weights[dim][item_id]);
+    }
+    capacities_.push_back(capacities[dim]);
+  }
+}
+
+void KnapsackBatchSolver::Solve(
+    const std::vector<std::vector<int64> >& profits) {
+  results_.resize(profits.size());
+  next_problem_ = 0;
+  const int num_workers =
+      std::min<int>(num_threads_, std::max<int>(1, profits.size()));
+  while (workers_.size() < num_workers) {
+    workers_.emplace_back(new Worker());
+    workers_.back()->solver.reset(
+        new KnapsackSolver(solver_type_, solver_name_));
+  }
+  if (num_workers == 1) {
+    RunWorker(workers_[0].get(), &profits);
+    return;
+  }
+  ThreadPool pool("KnapsackBatchSolver", num_workers);
+  pool.StartWorkers();
+  for (int i = 0; i < num_workers; ++i) {
+    pool.Add(NewCallback(this, &KnapsackBatchSolver::RunWorker,
+                         workers_[i].get(), &profits));
+  }
+}
+
+void KnapsackBatchSolver::RunWorker(
+    Worker* worker, const std::vector<std::vector<int64> >* profits) {
+  while (true) {
+    const int problem = next_problem_.fetch_add(1);
+    if (problem >= profits->size()) return;
+    SolveProblem((*profits)[problem], worker, &results_[problem]);
+  }
+}
+
+void KnapsackBatchSolver::SolveProblem(const std::vector<int64>& profits,
+                                       Worker* worker, Result* result) const {
+  CHECK_EQ(num_items_, profits.size());
+  result->solution.assign(num_items_, false);
+  result->profit = 0;
+  result->is_solution_optimal = true;
+
+  // The items with a non-positive profit are never needed.
+  worker->items.clear();
+  worker->profits.clear();
+  worker->weights.resize(capacities_.size());
+  for (std::vector<int64>& weights : worker->weights) weights.clear();
+  for (int i = 0; i < fitting_items_.size(); ++i) {
+    const int item_id = fitting_items_[i];
+    if (profits[item_id] <= 0) continue;
+    if (capacities_.empty()) {
+      result->solution[item_id] = true;
+      result->profit += profits[item_id];
+      continue;
+    }
+    worker->items.push_back(item_id);
+    worker->profits.push_back(profits[item_id]);
+    for (int dim = 0; dim < capacities_.size(); ++dim) {
+      worker->weights[dim].push_back(fitting_weights_[dim][i]);
+    }
+  }
+  if (worker->items.empty()) return;
+
+  KnapsackSolver* const solver = worker->solver.get();
+  solver->set_use_reduction(use_reduction_);
+  solver->set_time_limit(time_limit_seconds_);
+  solver->Init(worker->profits, worker->weights, capacities_);
+  result->profit = solver->Solve();
+  result->is_solution_optimal = solver->IsSolutionOptimal();
+  for (int i = 0; i < worker->items.size(); ++i) {
+    if (solver->BestSolutionContains(i)) {
+      result->solution[worker->items[i]] = true;
+    }
+  }
+}
+
 }  // namespace operations_research
@@ -58,6 +58,7 @@
 #define OR_TOOLS_ALGORITHMS_KNAPSACK_SOLVER_H_
 
 #include <math.h>
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -85,6 +86,10 @@ namespace operations_research {
 //  - KNAPSACK_DYNAMIC_PROGRAMMING_SOLVER: Limited to one dimension, this solver
 //    is based on a dynamic programming algorithm. The time and space
 //    complexity is O(capacity * number_of_items).
+//  - KNAPSACK_EXPANDING_CORE_SOLVER: Limited to one dimension, this solver
+//    combines dynamic programming and bounds on the items close to the break
+//    item in efficiency order. Its complexity does not depend on the capacity,
+//    and it is usually the fastest one-dimension solver on large instances.
 //  - KNAPSACK_MULTIDIMENSION_BRANCH_AND_BOUND_SOLVER: This solver can deal
 //    with both large number of items and several dimensions. This solver is
 //    based on branch and bound.
@@ -120,7 +125,8 @@ class KnapsackSolver {
     #if defined(USE_GLPK)
     KNAPSACK_MULTIDIMENSION_GLPK_MIP_SOLVER = 4,
     #endif  // USE_GLPK
-    KNAPSACK_MULTIDIMENSION_BRANCH_AND_BOUND_SOLVER = 5
+    KNAPSACK_MULTIDIMENSION_BRANCH_AND_BOUND_SOLVER = 5,
+    KNAPSACK_EXPANDING_CORE_SOLVER = 6
   };
 
   explicit KnapsackSolver(const std::string& solver_name);
@@ -580,6 +586,101 @@ class KnapsackGenericSolver : public BaseKnapsackSolver {
 
   DISALLOW_COPY_AND_ASSIGN(KnapsackGenericSolver);
 };
+
+// ----- KnapsackBatchSolver -----
+// KnapsackBatchSolver solves many problems that only differ by their profits,
+// for instance the pricing problems of a column generation, on several
+// threads. The work that only depends on the weights is done once by Init():
+// the items that cannot fit in the knapsack and the capacity constraints
+// that cannot be violated are removed. Then, the underlying KnapsackSolvers
+// (one per thread, kept from one Solve() to the next) are only given the
+// items with a positive profit, which are often few in pricing problems.
+//
+// Example:
+//   KnapsackBatchSolver solver(KnapsackSolver::KNAPSACK_EXPANDING_CORE_SOLVER,
+//                              "pricing", num_threads);
+//   solver.Init(weights, capacities);
+//   while (...) {
+//     ... compute the profits of each pricing problem ...
+//     solver.Solve(profits);
+//     for (int problem = 0; problem < profits.size(); ++problem) {
+//       ... use solver.best_profit(problem) and
+//       solver.BestSolutionContains(problem, item_id) ...
+//     }
+//   }
+class KnapsackBatchSolver {
+ public:
+  KnapsackBatchSolver(KnapsackSolver::SolverType solver_type,
+                      const std::string& solver_name, int num_threads);
+  ~KnapsackBatchSolver();
+
+  // Enters the weights and capacities common to all the problems, with the
+  // same format as in KnapsackSolver::Init(). The weights must be
+  // non-negative.
+  void Init(const std::vector<std::vector<int64> >& weights,
+            const std::vector<int64>& capacities);
+
+  // Solves one problem for each profit vector, which must have one profit per
+  // item.
+  void Solve(const std::vector<std::vector<int64> >& profits);
+
+  // The results of the problems of the last Solve().
+  int num_problems() const { return results_.size(); }
+  int64 best_profit(int problem) const { return results_[problem].profit; }
+  bool BestSolutionContains(int problem, int item_id) const {
+    return results_[problem].solution[item_id];
+  }
+  bool IsSolutionOptimal(int problem) const {
+    return results_[problem].is_solution_optimal;
+  }
+
+  // Same as for KnapsackSolver. The time limit applies to each problem.
+  void set_use_reduction(bool use_reduction) { use_reduction_ = use_reduction; }
+  void set_time_limit(double time_limit_seconds) {
+    time_limit_seconds_ = time_limit_seconds;
+  }
+
+ private:
+  struct Result {
+    int64 profit;
+    bool is_solution_optimal;
+    std::vector<bool> solution;
+  };
+
+  // The solver of a thread and its buffers to build the reduced problems.
+  struct Worker {
+    std::unique_ptr<KnapsackSolver> solver;
+    std::vector<int> items;
+    std::vector<int64> profits;
+    std::vector<std::vector<int64> > weights;
+  };
+
+  // Solves the problems of the given profits taken from next_problem_ until
+  // there are none left. This runs in a thread of the pool.
+  void RunWorker(Worker* worker,
+                 const std::vector<std::vector<int64> >* profits);
+  void SolveProblem(const std::vector<int64>& profits, Worker* worker,
+                    Result* result) const;
+
+  const KnapsackSolver::SolverType solver_type_;
+  const std::string solver_name_;
+  const int num_threads_;
+  bool use_reduction_;
+  double time_limit_seconds_;
+
+  // The items that fit in the knapsack, their weights in the capacity
+  // constraints that can be violated, and these capacities.
+  int num_items_;
+  std::vector<int> fitting_items_;
+  std::vector<std::vector<int64> > fitting_weights_;
+  std::vector<int64> capacities_;
+
+  std::vector<std::unique_ptr<Worker> > workers_;
+  std::atomic<int> next_problem_;
+  std::vector<Result> results_;
+
+  DISALLOW_COPY_AND_ASSIGN(KnapsackBatchSolver);
+};
 #endif  // SWIG
 }  // namespace operations_research
 
@@ -19,6 +19,20 @@
 
 namespace operations_research {
 
+void SparsePermutation::FillDenseImages(std::vector<int>* image) const {
+  image->resize(size_);
+  for (int i = 0; i < size_; ++i) (*image)[i] = i;
+  int start = 0;
+  for (const int end : cycle_ends_) {
+    int element = cycles_[end - 1];
+    for (int i = start; i < end; ++i) {
+      (*image)[element] = cycles_[i];
+      element = cycles_[i];
+    }
+    start = end;
+  }
+}
+
 void SparsePermutation::RemoveCycles(const std::vector<int>& cycle_indices) {
   // TODO(user): make this a class member to avoid allocation if the complexity
   // becomes an issue. In this case, also optimize the loop below by not copying
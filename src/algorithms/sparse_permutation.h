@@ -62,6 +62,12 @@ class SparsePermutation {
   void AddToCurrentCycle(int x);
   void CloseCurrentCycle();
 
+  // Fills the dense table of the images of all the elements: (*image)[e] is
+  // the image of e, for all e in [0, Size()). With such a table, applying the
+  // permutation to many elements is a simple gather, instead of a walk over
+  // the cycles. Complexity: O(Size()).
+  void FillDenseImages(std::vector<int>* image) const;
+
   // Removes the cycles with given indices from the permutation. This
   // works in O(K) for a permutation displacing K elements.
   void RemoveCycles(const std::vector<int>& cycle_indices);
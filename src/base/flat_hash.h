@@ -0,0 +1,369 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Open-addressing hash map and hash set, and a fast 64-bit hash function.
+//
+// FlatHashMap and FlatHashSet store their elements in a single array, with
+// linear probing, instead of one allocated node per element like hash_map and
+// hash_set: a lookup usually reads one cache line of metadata and one of
+// elements, and the memory overhead is one byte per slot. They provide the
+// subset of the hash_map/hash_set interface used in the code base (and by
+// map_util.h), with the following differences:
+// - Inserting an element may move all the elements: the iterators, pointers
+//   and references to the elements are invalidated by the insertions (but not
+//   by the erasures).
+// - The value_type of FlatHashMap is std::pair<Key, Value>, not
+//   std::pair<const Key, Value>. The keys must not be modified.
+// - The Key and Value types must be default-constructible.
+//
+// FastHash<T> hashes integers, enums, pointers, std::string and std::pair of
+// them with a multiply-and-fold mixer (as in wyhash), which gives well
+// distributed low bits; this is required by the power of two tables, and is
+// not the case of the identity hash of hash<int64> or hash<T*>.
+
+#ifndef OR_TOOLS_BASE_FLAT_HASH_H_
+#define OR_TOOLS_BASE_FLAT_HASH_H_
+
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/hash.h"
+#include "base/integral_types.h"
+#include "base/logging.h"
+
+namespace operations_research {
+
+// Returns a mix of the 128-bit product of a and b.
+inline uint64 FastMix64(uint64 a, uint64 b) {
+#if defined(__SIZEOF_INT128__)
+  const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+  return static_cast<uint64>(product) ^ static_cast<uint64>(product >> 64);
+#else
+  return Hash64NumWithSeed(a, b);
+#endif
+}
+
+inline uint64 FastHash64(uint64 value) {
+  return FastMix64(value ^ GG_ULONGLONG(0xa0761d6478bd642f),
+                   GG_ULONGLONG(0xe7037ed1a0b428db));
+}
+
+// Hashes the bytes 8 at a time.
+inline uint64 FastHashBytes(const char* data, size_t size) {
+  uint64 hash = FastHash64(size);
+  while (size >= 8) {
+    uint64 word;
+    memcpy(&word, data, 8);
+    hash = FastMix64(hash ^ word, GG_ULONGLONG(0xe7037ed1a0b428db));
+    data += 8;
+    size -= 8;
+  }
+  if (size > 0) {
+    uint64 word = 0;
+    memcpy(&word, data, size);
+    hash = FastMix64(hash ^ word, GG_ULONGLONG(0x8ebc6af09c88c6e3));
+  }
+  return FastHash64(hash);
+}
+
+template <typename T, typename Enable = void>
+struct FastHash;
+
+template <typename T>
+struct FastHash<T, typename std::enable_if<std::is_integral<T>::value ||
+                                           std::is_enum<T>::value>::type> {
+  size_t operator()(T value) const {
+    return FastHash64(static_cast<uint64>(value));
+  }
+};
+
+template <typename T>
+struct FastHash<T*> {
+  size_t operator()(const T* value) const {
+    return FastHash64(reinterpret_cast<uintptr_t>(value));
+  }
+};
+
+template <>
+struct FastHash<std::string> {
+  size_t operator()(const std::string& value) const {
+    return FastHashBytes(value.data(), value.size());
+  }
+};
+
+template <typename First, typename Second>
+struct FastHash<std::pair<First, Second>> {
+  size_t operator()(const std::pair<First, Second>& value) const {
+    return FastMix64(FastHash<First>()(value.first) ^
+                         GG_ULONGLONG(0x589965cc75374cc3),
+                     FastHash<Second>()(value.second) |
+                         GG_ULONGLONG(1));
+  }
+};
+
+namespace internal {
+// The open-addressing table shared by FlatHashMap and FlatHashSet. Slot is
+// the type of the elements, and KeyOf extracts their key.
+template <typename Key, typename Slot, typename KeyOf, typename Hash,
+          typename Equal>
+class FlatHashTable {
+ public:
+  typedef Key key_type;
+  typedef Slot value_type;
+  typedef size_t size_type;
+
+  template <typename TablePointer, typename Reference>
+  class Iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef Slot value_type;
+    typedef ptrdiff_t difference_type;
+    typedef typename std::remove_reference<Reference>::type* pointer;
+    typedef Reference reference;
+
+    Iterator() : table_(nullptr), index_(0) {}
+    Iterator(TablePointer table, size_t index)
+        : table_(table), index_(index) {}
+    // Conversion from iterator to const_iterator.
+    template <typename OtherTablePointer, typename OtherReference>
+    Iterator(const Iterator<OtherTablePointer, OtherReference>& other)
+        : table_(other.table_), index_(other.index_) {}
+
+    Reference operator*() const { return table_->slots_[index_]; }
+    pointer operator->() const { return &table_->slots_[index_]; }
+    Iterator& operator++() {
+      index_ = table_->NextFull(index_ + 1);
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator result = *this;
+      ++*this;
+      return result;
+    }
+    bool operator==(const Iterator& other) const {
+      return index_ == other.index_;
+    }
+    bool operator!=(const Iterator& other) const {
+      return index_ != other.index_;
+    }
+
+   private:
+    friend class FlatHashTable;
+    template <typename, typename>
+    friend class Iterator;
+
+    TablePointer table_;
+    size_t index_;
+  };
+  typedef Iterator<FlatHashTable*, Slot&> iterator;
+  typedef Iterator<const FlatHashTable*, const Slot&> const_iterator;
+
+  FlatHashTable() : size_(0), num_deleted_(0) {}
+
+  iterator begin() { return iterator(this, NextFull(0)); }
+  iterator end() { return iterator(this, slots_.size()); }
+  const_iterator begin() const { return const_iterator(this, NextFull(0)); }
+  const_iterator end() const { return const_iterator(this, slots_.size()); }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  void clear() {
+    if (size_ == 0 && num_deleted_ == 0) return;
+    std::fill(controls_.begin(), controls_.end(), kEmpty);
+    std::fill(slots_.begin(), slots_.end(), Slot());
+    size_ = 0;
+    num_deleted_ = 0;
+  }
+
+  // Makes room for num_elements elements without rehashing.
+  void reserve(size_t num_elements) {
+    if (MaxSizeForCapacity(slots_.size()) < num_elements) {
+      Rehash(CapacityForSize(num_elements));
+    }
+  }
+
+  void swap(FlatHashTable& other) {
+    controls_.swap(other.controls_);
+    slots_.swap(other.slots_);
+    std::swap(size_, other.size_);
+    std::swap(num_deleted_, other.num_deleted_);
+  }
+
+  iterator find(const Key& key) { return iterator(this, FindIndex(key)); }
+  const_iterator find(const Key& key) const {
+    return const_iterator(this, FindIndex(key));
+  }
+  size_t count(const Key& key) const {
+    return FindIndex(key) != slots_.size();
+  }
+
+  std::pair<iterator, bool> insert(const Slot& slot) {
+    const size_t index = FindIndex(KeyOf()(slot));
+    if (index != slots_.size()) {
+      return std::make_pair(iterator(this, index), false);
+    }
+    return std::make_pair(iterator(this, InsertNew(slot)), true);
+  }
+
+  template <typename InputIterator>
+  void insert(InputIterator first, InputIterator last) {
+    for (; first != last; ++first) insert(*first);
+  }
+
+  size_t erase(const Key& key) {
+    const size_t index = FindIndex(key);
+    if (index == slots_.size()) return 0;
+    EraseIndex(index);
+    return 1;
+  }
+  // The other iterators stay valid, so a table can be filtered in a loop
+  // with "table.erase(it++)".
+  void erase(const_iterator it) { EraseIndex(it.index_); }
+
+ protected:
+  // Returns the index of the element with the given key, or slots_.size().
+  size_t FindIndex(const Key& key) const {
+    if (size_ == 0) return slots_.size();
+    const size_t mask = slots_.size() - 1;
+    for (size_t index = Hash()(key) & mask;; index = (index + 1) & mask) {
+      const uint8 control = controls_[index];
+      if (control == kEmpty) return slots_.size();
+      if (control == kFull && Equal()(KeyOf()(slots_[index]), key)) {
+        return index;
+      }
+    }
+  }
+
+  // Inserts an element whose key is not in the table, and returns its index.
+  size_t InsertNew(const Slot& slot) {
+    if (MaxSizeForCapacity(slots_.size()) < size_ + num_deleted_ + 1) {
+      // Rehashes in place (to get rid of the deleted slots) if that frees
+      // enough room, otherwise grows.
+      Rehash(CapacityForSize(size_ + 1));
+    }
+    const size_t mask = slots_.size() - 1;
+    size_t index = Hash()(KeyOf()(slot)) & mask;
+    while (controls_[index] == kFull) index = (index + 1) & mask;
+    if (controls_[index] == kDeleted) --num_deleted_;
+    controls_[index] = kFull;
+    slots_[index] = slot;
+    ++size_;
+    return index;
+  }
+
+  size_t capacity() const { return slots_.size(); }
+  Slot& SlotAt(size_t index) { return slots_[index]; }
+
+ private:
+  // The deleted slots are not empty for the probing, so that the elements
+  // after them stay reachable.
+  enum : uint8 { kEmpty = 0, kFull = 1, kDeleted = 2 };
+  static const size_t kMinCapacity = 16;
+
+  // The maximum load factor is 3/4.
+  static size_t MaxSizeForCapacity(size_t capacity) {
+    return capacity - capacity / 4;
+  }
+  static size_t CapacityForSize(size_t size) {
+    size_t capacity = kMinCapacity;
+    while (MaxSizeForCapacity(capacity) < size) capacity *= 2;
+    return capacity;
+  }
+
+  size_t NextFull(size_t index) const {
+    while (index < controls_.size() && controls_[index] != kFull) ++index;
+    return index;
+  }
+
+  void EraseIndex(size_t index) {
+    DCHECK_EQ(kFull, controls_[index]);
+    controls_[index] = kDeleted;
+    slots_[index] = Slot();
+    --size_;
+    ++num_deleted_;
+  }
+
+  void Rehash(size_t capacity) {
+    std::vector<uint8> old_controls(capacity, kEmpty);
+    std::vector<Slot> old_slots(capacity);
+    old_controls.swap(controls_);
+    old_slots.swap(slots_);
+    size_ = 0;
+    num_deleted_ = 0;
+    const size_t mask = capacity - 1;
+    for (size_t i = 0; i < old_slots.size(); ++i) {
+      if (old_controls[i] != kFull) continue;
+      size_t index = Hash()(KeyOf()(old_slots[i])) & mask;
+      while (controls_[index] == kFull) index = (index + 1) & mask;
+      controls_[index] = kFull;
+      slots_[index] = std::move(old_slots[i]);
+      ++size_;
+    }
+  }
+
+  // controls_[i] tells whether slots_[i] is empty, full or deleted. Both
+  // have a power of two size.
+  std::vector<uint8> controls_;
+  std::vector<Slot> slots_;
+  size_t size_;
+  size_t num_deleted_;
+};
+
+template <typename Key, typename Value>
+struct SelectFirst {
+  const Key& operator()(const std::pair<Key, Value>& slot) const {
+    return slot.first;
+  }
+};
+
+template <typename Key>
+struct Identity {
+  const Key& operator()(const Key& slot) const { return slot; }
+};
+}  // namespace internal
+
+template <typename Key, typename Value, typename Hash = FastHash<Key>,
+          typename Equal = std::equal_to<Key>>
+class FlatHashMap
+    : public internal::FlatHashTable<Key, std::pair<Key, Value>,
+                                     internal::SelectFirst<Key, Value>, Hash,
+                                     Equal> {
+ public:
+  typedef Value mapped_type;
+
+  Value& operator[](const Key& key) {
+    size_t index = this->FindIndex(key);
+    if (index == this->capacity()) {
+      index = this->InsertNew(std::make_pair(key, Value()));
+    }
+    return this->SlotAt(index).second;
+  }
+};
+
+template <typename Key, typename Hash = FastHash<Key>,
+          typename Equal = std::equal_to<Key>>
+class FlatHashSet
+    : public internal::FlatHashTable<Key, Key, internal::Identity<Key>, Hash,
+                                     Equal> {};
+
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_BASE_FLAT_HASH_H_
@@ -0,0 +1,94 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/large_array_allocator.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "base/logging.h"
+
+DEFINE_bool(large_array_huge_pages, true,
+            "Back the large arrays of the solvers with transparent huge pages "
+            "when the platform supports it.");
+DEFINE_int64(large_array_min_bytes, 8 << 20,
+             "Minimum size in bytes of the arrays backed by huge pages.");
+
+namespace operations_research {
+namespace {
+#if defined(__linux__)
+const size_t kHugePageSize = 2 << 20;
+
+// Huge pages are only an advice: the kernel falls back to normal pages when
+// transparent huge pages are disabled or when none is available. All the
+// blocks come from malloc() or posix_memalign(), so they are all freed with
+// free() whatever the flags were at allocation time.
+class DefaultLargeArrayAllocationPolicy : public LargeArrayAllocationPolicy {
+ public:
+  void* Allocate(size_t bytes) override {
+    void* ptr = nullptr;
+    if (FLAGS_large_array_huge_pages &&
+        bytes >= static_cast<size_t>(FLAGS_large_array_min_bytes)) {
+      // The size is rounded up so that the last huge page is not shared with
+      // other allocations.
+      const size_t rounded_bytes =
+          (bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+      CHECK_EQ(0, posix_memalign(&ptr, kHugePageSize, rounded_bytes))
+          << "Could not allocate " << rounded_bytes << " bytes.";
+#if defined(MADV_HUGEPAGE)
+      madvise(ptr, rounded_bytes, MADV_HUGEPAGE);
+#endif
+      return ptr;
+    }
+    ptr = malloc(bytes > 0 ? bytes : 1);
+    CHECK(ptr != nullptr) << "Could not allocate " << bytes << " bytes.";
+    return ptr;
+  }
+
+  void Deallocate(void* ptr, size_t bytes) override { free(ptr); }
+};
+#else
+// Huge pages are not supported on this platform.
+class DefaultLargeArrayAllocationPolicy : public LargeArrayAllocationPolicy {
+ public:
+  void* Allocate(size_t bytes) override { return ::operator new(bytes); }
+  void Deallocate(void* ptr, size_t bytes) override { ::operator delete(ptr); }
+};
+#endif
+
+std::atomic<LargeArrayAllocationPolicy*> current_policy(nullptr);
+
+LargeArrayAllocationPolicy* DefaultPolicy() {
+  // Never deleted, so that the arrays can be freed during the static
+  // destruction.
+  static LargeArrayAllocationPolicy* const policy =
+      new DefaultLargeArrayAllocationPolicy();
+  return policy;
+}
+}  // namespace
+
+LargeArrayAllocationPolicy* GetLargeArrayAllocationPolicy() {
+  LargeArrayAllocationPolicy* const policy =
+      current_policy.load(std::memory_order_acquire);
+  return policy != nullptr ? policy : DefaultPolicy();
+}
+
+void SetLargeArrayAllocationPolicy(LargeArrayAllocationPolicy* policy) {
+  current_policy.store(policy, std::memory_order_release);
+}
+
+}  // namespace operations_research
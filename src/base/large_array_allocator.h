@@ -0,0 +1,111 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Allocation policy for the largest arrays of the solvers: the in-memory
+// blocks of the CP trail, the storage of the CompactSparseMatrix (and thus of
+// the LU factors of Glop), the arrays of the static graphs and the per-arc
+// state of LinearSumAssignment.
+//
+// With the default policy, the arrays of at least --large_array_min_bytes
+// bytes are aligned on huge page boundaries and, on Linux, advised with
+// MADV_HUGEPAGE so that they are backed by transparent huge pages, which
+// greatly reduces the TLB misses on big instances. The memory is not touched
+// by the allocation: with the first-touch placement of the kernel, the pages
+// thus end up on the NUMA node of the thread that initializes the array. When
+// each thread builds and runs its own solver instance, as in the parallel
+// modes, its large arrays are therefore local to it.
+//
+// The policy can be replaced, for instance to bind the arrays to a given NUMA
+// node, with SetLargeArrayAllocationPolicy().
+
+#ifndef OR_TOOLS_BASE_LARGE_ARRAY_ALLOCATOR_H_
+#define OR_TOOLS_BASE_LARGE_ARRAY_ALLOCATOR_H_
+
+#include <cstddef>
+
+#include "base/commandlineflags.h"
+#include "base/integral_types.h"
+
+DECLARE_bool(large_array_huge_pages);
+DECLARE_int64(large_array_min_bytes);
+
+namespace operations_research {
+
+// Interface of the policy used to allocate the large arrays.
+class LargeArrayAllocationPolicy {
+ public:
+  virtual ~LargeArrayAllocationPolicy() {}
+
+  // Returns a block of at least 'bytes' bytes, suitably aligned for any type.
+  // Never returns nullptr.
+  virtual void* Allocate(size_t bytes) = 0;
+
+  // Frees a block returned by Allocate(bytes).
+  virtual void Deallocate(void* ptr, size_t bytes) = 0;
+};
+
+// Returns the current policy. This is never nullptr.
+LargeArrayAllocationPolicy* GetLargeArrayAllocationPolicy();
+
+// Replaces the current policy, nullptr restoring the default one. This does
+// not take ownership. Since the arrays are freed by the policy current at that
+// time, this must be called before any large array is allocated, and the
+// policy must outlive all of them.
+void SetLargeArrayAllocationPolicy(LargeArrayAllocationPolicy* policy);
+
+// STL allocator that uses the current LargeArrayAllocationPolicy, for
+// instance std::vector<int, LargeArrayAllocator<int>>. It is stateless, so
+// containers using it can be swapped in O(1).
+template <typename T>
+class LargeArrayAllocator {
+ public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+  template <typename U>
+  struct rebind {
+    typedef LargeArrayAllocator<U> other;
+  };
+
+  LargeArrayAllocator() {}
+  template <typename U>
+  LargeArrayAllocator(const LargeArrayAllocator<U>& other) {}  // NOLINT
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(
+        GetLargeArrayAllocationPolicy()->Allocate(n * sizeof(T)));
+  }
+  void deallocate(T* ptr, size_t n) {
+    GetLargeArrayAllocationPolicy()->Deallocate(ptr, n * sizeof(T));
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const LargeArrayAllocator<T>& a,
+                const LargeArrayAllocator<U>& b) {
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const LargeArrayAllocator<T>& a,
+                const LargeArrayAllocator<U>& b) {
+  return false;
+}
+
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_BASE_LARGE_ARRAY_ALLOCATOR_H_
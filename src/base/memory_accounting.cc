@@ -0,0 +1,116 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/memory_accounting.h"
+
+#include <atomic>
+
+#include "base/logging.h"
+#include "base/stringprintf.h"
+
+DEFINE_int64(memory_budget_in_mb, 0,
+             "Budget of the memory accounted by the solvers, in MB. The "
+             "solvers that support it stop when it is exceeded. 0 means no "
+             "budget.");
+
+namespace operations_research {
+namespace {
+// The counters are only updated with relaxed atomic operations: they are
+// statistics, and never used to synchronize other data.
+std::atomic<int64> current_usage[NUM_MEMORY_SUBSYSTEMS];
+std::atomic<int64> peak_usage[NUM_MEMORY_SUBSYSTEMS];
+std::atomic<int64> total_usage(0);
+
+// -1 means that the budget is given by --memory_budget_in_mb.
+std::atomic<int64> budget_override(-1);
+
+const int64 kMegaByte = 1024 * 1024;
+}  // namespace
+
+const char* MemorySubsystemName(MemorySubsystem subsystem) {
+  switch (subsystem) {
+    case CP_TRAIL:
+      return "cp trail";
+    case CP_DOMAINS:
+      return "cp domains";
+    case ROUTING_CACHES:
+      return "routing caches";
+    case GLOP_LU:
+      return "glop lu";
+    case SAT_CLAUSES:
+      return "sat clauses";
+    case GRAPH_ARRAYS:
+      return "graph arrays";
+    default:
+      LOG(DFATAL) << "Unknown memory subsystem " << subsystem;
+      return "unknown";
+  }
+}
+
+void RecordMemoryAllocation(MemorySubsystem subsystem, int64 bytes) {
+  DCHECK_GE(subsystem, 0);
+  DCHECK_LT(subsystem, NUM_MEMORY_SUBSYSTEMS);
+  const int64 usage =
+      current_usage[subsystem].fetch_add(bytes, std::memory_order_relaxed) +
+      bytes;
+  total_usage.fetch_add(bytes, std::memory_order_relaxed);
+  int64 peak = peak_usage[subsystem].load(std::memory_order_relaxed);
+  while (usage > peak &&
+         !peak_usage[subsystem].compare_exchange_weak(
+             peak, usage, std::memory_order_relaxed)) {
+  }
+}
+
+int64 GetCurrentMemoryUsage(MemorySubsystem subsystem) {
+  return current_usage[subsystem].load(std::memory_order_relaxed);
+}
+
+int64 GetPeakMemoryUsage(MemorySubsystem subsystem) {
+  return peak_usage[subsystem].load(std::memory_order_relaxed);
+}
+
+int64 GetTotalAccountedMemoryUsage() {
+  return total_usage.load(std::memory_order_relaxed);
+}
+
+std::string MemoryAccountingReport() {
+  std::string report;
+  for (int i = 0; i < NUM_MEMORY_SUBSYSTEMS; ++i) {
+    const MemorySubsystem subsystem = static_cast<MemorySubsystem>(i);
+    StringAppendF(&report,
+                  "%s: %" GG_LL_FORMAT "d bytes (peak %" GG_LL_FORMAT
+                  "d bytes)\n",
+                  MemorySubsystemName(subsystem),
+                  GetCurrentMemoryUsage(subsystem),
+                  GetPeakMemoryUsage(subsystem));
+  }
+  StringAppendF(&report, "total: %" GG_LL_FORMAT "d bytes\n",
+                GetTotalAccountedMemoryUsage());
+  return report;
+}
+
+void SetMemoryBudget(int64 bytes) {
+  budget_override.store(bytes, std::memory_order_relaxed);
+}
+
+int64 GetMemoryBudget() {
+  const int64 bytes = budget_override.load(std::memory_order_relaxed);
+  return bytes >= 0 ? bytes : FLAGS_memory_budget_in_mb * kMegaByte;
+}
+
+bool IsMemoryBudgetExceeded() {
+  const int64 budget = GetMemoryBudget();
+  return budget > 0 && GetTotalAccountedMemoryUsage() > budget;
+}
+
+}  // namespace operations_research
@@ -0,0 +1,104 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Lightweight accounting of the memory used by the largest data structures of
+// the solvers. Unlike GetProcessMemoryUsage(), the usage is known per
+// subsystem, and it is cheap enough to be checked in the search loops.
+//
+// The accounting is explicit: the owner of a tagged data structure reports its
+// allocations and deallocations, either directly or through a
+// MemoryUsageTracker. Only the major allocations are tagged, so the total is a
+// lower bound of the memory actually used by the process.
+//
+// A process-wide budget can be set with --memory_budget_in_mb or
+// SetMemoryBudget(). The solvers that support it stop gracefully once the
+// accounted memory exceeds it: the TimeLimit of Glop and BOP is reached, the
+// search limits of the CP solver are crossed, and the routing library reports
+// ROUTING_FAIL_MEMORY_LIMIT when no solution was found.
+
+#ifndef OR_TOOLS_BASE_MEMORY_ACCOUNTING_H_
+#define OR_TOOLS_BASE_MEMORY_ACCOUNTING_H_
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/commandlineflags.h"
+#include "base/macros.h"
+
+DECLARE_int64(memory_budget_in_mb);
+
+namespace operations_research {
+
+// The tagged subsystems.
+enum MemorySubsystem {
+  CP_TRAIL,        // Blocks of the reversible trail of the CP solver.
+  CP_DOMAINS,      // Bitset domains of the CP integer variables.
+  ROUTING_CACHES,  // Caches of the RoutingModel.
+  GLOP_LU,         // LU factors of the Glop basis.
+  SAT_CLAUSES,     // Clauses stored by the SAT solver.
+  GRAPH_ARRAYS,    // Node and arc arrays of the graphs.
+  NUM_MEMORY_SUBSYSTEMS
+};
+
+// Returns the name of a subsystem, for logging.
+const char* MemorySubsystemName(MemorySubsystem subsystem);
+
+// Reports that 'bytes' bytes were allocated, or freed when 'bytes' is
+// negative, for the given subsystem. This is thread-safe.
+void RecordMemoryAllocation(MemorySubsystem subsystem, int64 bytes);
+
+// Current and peak number of bytes accounted for the given subsystem.
+int64 GetCurrentMemoryUsage(MemorySubsystem subsystem);
+int64 GetPeakMemoryUsage(MemorySubsystem subsystem);
+
+// Sum of the current usage of all the subsystems.
+int64 GetTotalAccountedMemoryUsage();
+
+// Returns a report with the current and peak usage of each subsystem.
+std::string MemoryAccountingReport();
+
+// Sets the process-wide budget in bytes, 0 meaning no budget. This overrides
+// --memory_budget_in_mb.
+void SetMemoryBudget(int64 bytes);
+int64 GetMemoryBudget();
+
+// Returns true if a budget is set and the accounted memory exceeds it.
+bool IsMemoryBudgetExceeded();
+
+// Tracks the memory of one data structure whose size is known as a whole, for
+// instance from its capacity after it was rebuilt. The difference with the
+// previous size is reported on each call to Set(), and the last size is
+// released by the destructor.
+class MemoryUsageTracker {
+ public:
+  explicit MemoryUsageTracker(MemorySubsystem subsystem)
+      : subsystem_(subsystem), bytes_(0) {}
+  ~MemoryUsageTracker() { Set(0); }
+
+  void Set(int64 bytes) {
+    if (bytes == bytes_) return;
+    RecordMemoryAllocation(subsystem_, bytes - bytes_);
+    bytes_ = bytes;
+  }
+  int64 bytes() const { return bytes_; }
+
+ private:
+  const MemorySubsystem subsystem_;
+  int64 bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(MemoryUsageTracker);
+};
+
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_BASE_MEMORY_ACCOUNTING_H_
@@ -107,7 +107,9 @@ inline PyObject* PyObjFrom(const std::string& c) {
 
 // Do numeric specialization.
 
+#include <cstring>
 #include <limits>
+#include <type_traits>
 
 template <>
 inline bool PyObjAs(PyObject* py, int* c) {
@@ -358,6 +360,57 @@ inline PyObject* vector_output_wrap_helper(const std::vector<T*>* vec,
 #endif
 }
 
+// Read-only view over a C-contiguous buffer with items of type T, obtained
+// through the buffer protocol (e.g. from a NumPy array). The data is not
+// copied, and the buffer is released when the view is destroyed.
+template <class T>
+class PyBufferView {
+ public:
+  PyBufferView() : valid_(false) {}
+  ~PyBufferView() {
+    if (valid_) PyBuffer_Release(&view_);
+  }
+
+  // Returns false and sets a Python TypeError if obj does not expose a
+  // C-contiguous buffer of dimension ndim whose items are Ts.
+  bool Init(PyObject* obj, int ndim) {
+    if (PyObject_GetBuffer(obj, &view_, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) ==
+        -1) {
+      return false;
+    }
+    valid_ = true;
+    if (view_.ndim != ndim || view_.itemsize != sizeof(T) ||
+        !FormatMatches(view_.format)) {
+      PyErr_Format(PyExc_TypeError,
+                   "expected a contiguous %d-dimensional array of %d-byte %s",
+                   ndim, static_cast<int>(sizeof(T)),
+                   std::is_integral<T>::value ? "integers" : "floats");
+      return false;
+    }
+    return true;
+  }
+
+  const T* data() const { return static_cast<const T*>(view_.buf); }
+  Py_ssize_t size() const { return view_.len / view_.itemsize; }
+  Py_ssize_t shape(int dimension) const { return view_.shape[dimension]; }
+
+ private:
+  // Only native byte order is accepted.
+  static bool FormatMatches(const char* format) {
+    if (format == NULL) return false;
+    if (*format == '@' || *format == '=') ++format;
+    if (format[0] == '\0' || format[1] != '\0') return false;
+    if (std::is_floating_point<T>::value) {
+      return strchr("fd", format[0]) != NULL;
+    }
+    return strchr(std::is_signed<T>::value ? "bhilq" : "BHILQ", format[0]) !=
+           NULL;
+  }
+
+  Py_buffer view_;
+  bool valid_;
+};
+
 #if PY_MAJOR_VERSION > 2
 /* SWIG 2's own C preprocessor macro for this is too strict.
  * It requires a (x) parameter which doesn't work for the case where the
@@ -12,10 +12,20 @@
 // limitations under the License.
 
 #include <zlib.h>
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstring>
 #include <memory>
 #include <string>
+#if !defined(_MSC_VER)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include "base/logging.h"
 #include "base/recordio.h"
+#include "base/threadpool.h"
 
 namespace operations_research {
 const int RecordWriter::kMagicNumber = 0x3ed7230a;
@@ -63,4 +73,541 @@ void RecordReader::Uncompress(const char* const source, uint64 source_size,
   }
   CHECK_LE(result_size, static_cast<unsigned long>(output_size));  // NOLINT
 }
+
+// ----- ChunkWriter -----
+
+const int ChunkWriter::kMagicNumber = 0x3ed7230b;
+
+ChunkWriter::ChunkWriter(File* const file) : file_(file) {}
+
+bool ChunkWriter::WriteChunk(int type, const std::string& payload) {
+  const int32 chunk_type = type;
+  const uint64 size = payload.size();
+  return file_->Write(&kMagicNumber, sizeof(kMagicNumber)) ==
+             sizeof(kMagicNumber) &&
+         file_->Write(&chunk_type, sizeof(chunk_type)) == sizeof(chunk_type) &&
+         file_->Write(&size, sizeof(size)) == sizeof(size) &&
+         file_->Write(payload.data(), size) == size;
+}
+
+bool ChunkWriter::Close() { return file_->Close(); }
+
+// ----- ChunkReader -----
+
+ChunkReader::ChunkReader()
+    : ok_(true),
+      offset_(0),
+      released_offset_(0),
+      mapped_data_(nullptr),
+      mapped_size_(0),
+      file_(nullptr) {}
+
+ChunkReader::~ChunkReader() { Close(); }
+
+bool ChunkReader::Open(const std::string& filename) {
+  Close();
+  ok_ = true;
+  offset_ = 0;
+  released_offset_ = 0;
+#if !defined(_MSC_VER)
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+    void* const data =
+        mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      mapped_data_ = static_cast<const char*>(data);
+      mapped_size_ = file_stat.st_size;
+      madvise(data, mapped_size_, MADV_SEQUENTIAL);
+    }
+  }
+  // The mapping stays valid after the file is closed.
+  close(fd);
+#endif
+  if (mapped_data_ == nullptr) {
+    file_ = File::Open(filename, "r");
+    if (file_ == nullptr) {
+      return false;
+    }
+  }
+  // Checks the magic number of the first chunk, and rewinds.
+  const char* const magic = ReadBytes(sizeof(ChunkWriter::kMagicNumber));
+  if (magic == nullptr ||
+      *reinterpret_cast<const int*>(magic) != ChunkWriter::kMagicNumber) {
+    Close();
+    return false;
+  }
+  if (mapped_data_ != nullptr) {
+    offset_ = 0;
+  } else {
+    file_->Close();
+    file_ = File::Open(filename, "r");
+    if (file_ == nullptr) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const char* ChunkReader::ReadBytes(uint64 size) {
+  if (mapped_data_ != nullptr) {
+    if (size > mapped_size_ - offset_) {
+      return nullptr;
+    }
+    const char* const data = mapped_data_ + offset_;
+    offset_ += size;
+    return data;
+  }
+  buffer_.resize(size);
+  if (file_->Read(&buffer_[0], size) != size) {
+    return nullptr;
+  }
+  offset_ += size;
+  return buffer_.data();
+}
+
+void ChunkReader::ReleaseReadPages() {
+#if !defined(_MSC_VER)
+  if (mapped_data_ == nullptr) {
+    return;
+  }
+  const uint64 page_size = sysconf(_SC_PAGESIZE);
+  // Only whole pages strictly before the current offset can be released.
+  const uint64 end = offset_ / page_size * page_size;
+  if (end > released_offset_) {
+    madvise(const_cast<char*>(mapped_data_) + released_offset_,
+            end - released_offset_, MADV_DONTNEED);
+    released_offset_ = end;
+  }
+#endif
+}
+
+bool ChunkReader::NextChunk(int* const type, const char** const data,
+                            uint64* const size) {
+  CHECK(type != nullptr);
+  CHECK(data != nullptr);
+  CHECK(size != nullptr);
+  if (!ok_ || (mapped_data_ == nullptr && file_ == nullptr)) {
+    return false;
+  }
+  // The pages of the previous chunk are not needed anymore.
+  ReleaseReadPages();
+  const uint64 kHeaderSize = sizeof(int) + sizeof(int32) + sizeof(uint64);
+  char header_buffer[kHeaderSize];
+  const char* header = nullptr;
+  if (mapped_data_ != nullptr) {
+    if (offset_ == mapped_size_) {
+      return false;
+    }
+    header = ReadBytes(kHeaderSize);
+  } else {
+    const size_t read = file_->Read(header_buffer, kHeaderSize);
+    if (read == 0) {
+      return false;
+    }
+    offset_ += read;
+    header = read == kHeaderSize ? header_buffer : nullptr;
+  }
+  if (header == nullptr) {
+    // Truncated header.
+    ok_ = false;
+    return false;
+  }
+  int magic_number = 0;
+  int32 chunk_type = 0;
+  uint64 payload_size = 0;
+  memcpy(&magic_number, header, sizeof(magic_number));
+  header += sizeof(magic_number);
+  memcpy(&chunk_type, header, sizeof(chunk_type));
+  header += sizeof(chunk_type);
+  memcpy(&payload_size, header, sizeof(payload_size));
+  if (magic_number != ChunkWriter::kMagicNumber) {
+    ok_ = false;
+    return false;
+  }
+  const char* const payload = ReadBytes(payload_size);
+  if (payload == nullptr) {
+    ok_ = false;
+    return false;
+  }
+  *type = chunk_type;
+  *data = payload;
+  *size = payload_size;
+  return true;
+}
+
+bool ChunkReader::Close() {
+  bool result = true;
+#if !defined(_MSC_VER)
+  if (mapped_data_ != nullptr) {
+    result = munmap(const_cast<char*>(mapped_data_), mapped_size_) == 0;
+  }
+#endif
+  mapped_data_ = nullptr;
+  mapped_size_ = 0;
+  if (file_ != nullptr) {
+    result = file_->Close() && result;
+    file_ = nullptr;
+  }
+  buffer_.clear();
+  return result;
+}
+// ----- BlockRecordWriter -----
+
+const int BlockRecordWriter::kMagicNumber = 0x3ed7230c;
+const int64 BlockRecordWriter::kDefaultBlockSize = 1 << 20;
+
+namespace {
+const uint64 kBlockHeaderSize = 2 * sizeof(int32) + 2 * sizeof(uint64);
+const uint64 kFooterSize = 3 * sizeof(uint64) + sizeof(int32);
+}  // namespace
+
+BlockRecordWriter::BlockRecordWriter(File* const file, int num_threads)
+    : file_(file),
+      use_compression_(true),
+      block_size_(kDefaultBlockSize),
+      current_num_records_(0),
+      num_records_(0),
+      offset_(0),
+      ok_(true),
+      closed_(false) {
+  if (num_threads > 0) {
+    pool_.reset(new ThreadPool("BlockRecordWriter", num_threads));
+    pool_->StartWorkers();
+  }
+}
+
+BlockRecordWriter::~BlockRecordWriter() {
+  if (!closed_) {
+    LOG(DFATAL) << "BlockRecordWriter destroyed without Close()";
+  }
+}
+
+BlockRecordWriter::Block BlockRecordWriter::MakeBlock(std::string payload,
+                                                      int32 num_records,
+                                                      bool compress) {
+  Block block;
+  block.num_records = num_records;
+  block.uncompressed_size = payload.size();
+  block.compressed = false;
+  if (compress) {
+    unsigned long compressed_size = compressBound(payload.size());  // NOLINT
+    block.data.resize(compressed_size);
+    const int result = compress2(
+        reinterpret_cast<unsigned char*>(&block.data[0]), &compressed_size,
+        reinterpret_cast<const unsigned char*>(payload.data()),
+        payload.size(), Z_DEFAULT_COMPRESSION);
+    if (result != Z_OK) {
+      LOG(FATAL) << "Compress error occured! Error code: " << result;
+    }
+    // Keeps the payload uncompressed if it does not compress.
+    if (compressed_size < payload.size()) {
+      block.data.resize(compressed_size);
+      block.compressed = true;
+      return block;
+    }
+  }
+  block.data.swap(payload);
+  return block;
+}
+
+bool BlockRecordWriter::WriteRecord(const std::string& record) {
+  CHECK(!closed_);
+  const uint32 size = record.size();
+  current_payload_.append(reinterpret_cast<const char*>(&size), sizeof(size));
+  current_payload_.append(record);
+  ++current_num_records_;
+  if (current_payload_.size() >= block_size_) {
+    FlushBlock();
+  }
+  return ok_;
+}
+
+void BlockRecordWriter::FlushBlock() {
+  if (current_num_records_ == 0) return;
+  std::string payload;
+  payload.swap(current_payload_);
+  const int32 num_records = current_num_records_;
+  current_num_records_ = 0;
+  if (pool_ == nullptr) {
+    ok_ = ok_ && WriteBlock(MakeBlock(std::move(payload), num_records,
+                                      use_compression_));
+    return;
+  }
+  // std::function needs a copyable functor, so the payload is moved into a
+  // shared pointer.
+  std::shared_ptr<std::string> shared_payload(
+      new std::string(std::move(payload)));
+  const bool compress = use_compression_;
+  pending_blocks_.push_back(
+      pool_->Submit([shared_payload, num_records, compress]() {
+        return MakeBlock(std::move(*shared_payload), num_records, compress);
+      }));
+  WriteCompressedBlocks(false);
+}
+
+void BlockRecordWriter::WriteCompressedBlocks(bool wait) {
+  // Bounds the memory used by the blocks being compressed.
+  const int max_pending_blocks = 2 * pool_->num_workers();
+  while (!pending_blocks_.empty()) {
+    std::future<Block>& front = pending_blocks_.front();
+    if (!wait && pending_blocks_.size() <= max_pending_blocks &&
+        front.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      return;
+    }
+    const Block block = front.get();
+    pending_blocks_.pop_front();
+    ok_ = ok_ && WriteBlock(block);
+  }
+}
+
+bool BlockRecordWriter::WriteUint64(uint64 value) {
+  offset_ += sizeof(value);
+  return file_->Write(&value, sizeof(value)) == sizeof(value);
+}
+
+bool BlockRecordWriter::WriteBlock(const Block& block) {
+  block_offsets_.push_back(offset_);
+  block_first_records_.push_back(num_records_);
+  num_records_ += block.num_records;
+  const int32 num_records = block.num_records;
+  const uint64 compressed_size = block.compressed ? block.data.size() : 0;
+  offset_ += sizeof(kMagicNumber) + sizeof(num_records) + block.data.size();
+  return file_->Write(&kMagicNumber, sizeof(kMagicNumber)) ==
+             sizeof(kMagicNumber) &&
+         file_->Write(&num_records, sizeof(num_records)) ==
+             sizeof(num_records) &&
+         WriteUint64(block.uncompressed_size) &&
+         WriteUint64(compressed_size) &&
+         file_->Write(block.data.data(), block.data.size()) ==
+             block.data.size();
+}
+
+bool BlockRecordWriter::Close() {
+  if (closed_) return ok_;
+  FlushBlock();
+  if (pool_ != nullptr) {
+    WriteCompressedBlocks(true);
+    pool_.reset();
+  }
+  closed_ = true;
+  const uint64 index_offset = offset_;
+  for (int block = 0; block < block_offsets_.size(); ++block) {
+    ok_ = ok_ && WriteUint64(block_offsets_[block]) &&
+          WriteUint64(block_first_records_[block]);
+  }
+  ok_ = ok_ && WriteUint64(index_offset) &&
+        WriteUint64(block_offsets_.size()) && WriteUint64(num_records_) &&
+        file_->Write(&kMagicNumber, sizeof(kMagicNumber)) ==
+            sizeof(kMagicNumber);
+  return file_->Close() && ok_;
+}
+
+// ----- BlockRecordReader -----
+
+BlockRecordReader::BlockRecordReader()
+    : data_(nullptr),
+      size_(0),
+      mapped_(false),
+      num_records_(0),
+      cached_block_(-1) {}
+
+BlockRecordReader::~BlockRecordReader() { Close(); }
+
+bool BlockRecordReader::Open(const std::string& filename) {
+  Close();
+#if !defined(_MSC_VER)
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+    void* const data =
+        mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      data_ = static_cast<const char*>(data);
+      size_ = file_stat.st_size;
+      mapped_ = true;
+    }
+  }
+  close(fd);
+#endif
+  if (data_ == nullptr) {
+    File* const file = File::Open(filename, "r");
+    if (file == nullptr) {
+      return false;
+    }
+    content_.resize(file->Size());
+    const bool read = content_.empty() ||
+                      file->Read(&content_[0], content_.size()) ==
+                          content_.size();
+    file->Close();
+    if (!read) {
+      content_.clear();
+      return false;
+    }
+    data_ = content_.data();
+    size_ = content_.size();
+  }
+  // Reads and checks the footer and the index.
+  int magic_number = 0;
+  uint64 footer[3];
+  if (size_ < kFooterSize) {
+    Close();
+    return false;
+  }
+  memcpy(footer, data_ + size_ - kFooterSize, sizeof(footer));
+  memcpy(&magic_number, data_ + size_ - sizeof(magic_number),
+         sizeof(magic_number));
+  const uint64 index_offset = footer[0];
+  const uint64 num_blocks = footer[1];
+  const uint64 index_size = size_ - kFooterSize - index_offset;
+  if (magic_number != BlockRecordWriter::kMagicNumber ||
+      index_offset > size_ - kFooterSize ||
+      num_blocks != index_size / (2 * sizeof(uint64))) {
+    Close();
+    return false;
+  }
+  num_records_ = footer[2];
+  block_offsets_.resize(num_blocks);
+  block_first_records_.resize(num_blocks);
+  for (int block = 0; block < num_blocks; ++block) {
+    const char* const entry = data_ + index_offset + 2 * sizeof(uint64) * block;
+    memcpy(&block_offsets_[block], entry, sizeof(uint64));
+    memcpy(&block_first_records_[block], entry + sizeof(uint64),
+           sizeof(uint64));
+    if (block_offsets_[block] + kBlockHeaderSize > index_offset) {
+      Close();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool BlockRecordReader::ReadBlock(
+    int block, std::vector<std::string>* const records) const {
+  const char* header = data_ + block_offsets_[block];
+  int magic_number = 0;
+  int32 num_records = 0;
+  uint64 uncompressed_size = 0;
+  uint64 compressed_size = 0;
+  memcpy(&magic_number, header, sizeof(magic_number));
+  header += sizeof(magic_number);
+  memcpy(&num_records, header, sizeof(num_records));
+  header += sizeof(num_records);
+  memcpy(&uncompressed_size, header, sizeof(uncompressed_size));
+  header += sizeof(uncompressed_size);
+  memcpy(&compressed_size, header, sizeof(compressed_size));
+  header += sizeof(compressed_size);
+  const uint64 stored_size =
+      compressed_size != 0 ? compressed_size : uncompressed_size;
+  if (magic_number != BlockRecordWriter::kMagicNumber ||
+      stored_size > size_ - (header - data_)) {
+    return false;
+  }
+  std::string uncompressed;
+  const char* payload = header;
+  if (compressed_size != 0) {
+    uncompressed.resize(uncompressed_size);
+    unsigned long result_size = uncompressed_size;  // NOLINT
+    if (uncompress(reinterpret_cast<unsigned char*>(&uncompressed[0]),
+                   &result_size, reinterpret_cast<const unsigned char*>(header),
+                   compressed_size) != Z_OK ||
+        result_size != uncompressed_size) {
+      return false;
+    }
+    payload = uncompressed.data();
+  }
+  uint64 position = 0;
+  for (int record = 0; record < num_records; ++record) {
+    uint32 size = 0;
+    if (uncompressed_size - position < sizeof(size)) return false;
+    memcpy(&size, payload + position, sizeof(size));
+    position += sizeof(size);
+    if (uncompressed_size - position < size) return false;
+    records->push_back(std::string(payload + position, size));
+    position += size;
+  }
+  return true;
+}
+
+bool BlockRecordReader::ReadRecord(int64 index, std::string* const record) {
+  CHECK(record != nullptr);
+  if (index < 0 || index >= num_records_) {
+    return false;
+  }
+  // The block of the record is the last one starting at or before it.
+  const int block =
+      std::upper_bound(block_first_records_.begin(),
+                       block_first_records_.end(), index) -
+      block_first_records_.begin() - 1;
+  if (block != cached_block_) {
+    cached_block_ = -1;
+    cached_records_.clear();
+    if (!ReadBlock(block, &cached_records_)) {
+      return false;
+    }
+    cached_block_ = block;
+  }
+  const int64 position = index - block_first_records_[block];
+  if (position >= cached_records_.size()) {
+    return false;
+  }
+  *record = cached_records_[position];
+  return true;
+}
+
+bool BlockRecordReader::ReadAllRecords(
+    int num_threads, std::vector<std::string>* const records) {
+  CHECK(records != nullptr);
+  const int num_blocks = block_offsets_.size();
+  std::vector<std::vector<std::string>> block_records(num_blocks);
+  // Not a vector<bool>, whose elements cannot be written concurrently.
+  std::vector<char> block_ok(num_blocks, false);
+  if (num_threads > 0) {
+    ThreadPool pool("BlockRecordReader", num_threads);
+    pool.StartWorkers();
+    pool.ParallelFor(num_blocks, 1, [this, &block_records, &block_ok](
+                                        int64 begin, int64 end) {
+      for (int64 block = begin; block < end; ++block) {
+        block_ok[block] = ReadBlock(block, &block_records[block]);
+      }
+    });
+  } else {
+    for (int block = 0; block < num_blocks; ++block) {
+      block_ok[block] = ReadBlock(block, &block_records[block]);
+    }
+  }
+  for (int block = 0; block < num_blocks; ++block) {
+    if (!block_ok[block]) return false;
+    for (std::string& record : block_records[block]) {
+      records->push_back(std::string());
+      records->back().swap(record);
+    }
+  }
+  return true;
+}
+
+bool BlockRecordReader::Close() {
+  bool result = true;
+#if !defined(_MSC_VER)
+  if (mapped_) {
+    result = munmap(const_cast<char*>(data_), size_) == 0;
+  }
+#endif
+  data_ = nullptr;
+  size_ = 0;
+  mapped_ = false;
+  content_.clear();
+  num_records_ = 0;
+  block_offsets_.clear();
+  block_first_records_.clear();
+  cached_block_ = -1;
+  cached_records_.clear();
+  return result;
+}
 }  // namespace operations_research
@@ -14,9 +14,13 @@
 #ifndef OR_TOOLS_BASE_RECORDIO_H_
 #define OR_TOOLS_BASE_RECORDIO_H_
 
+#include <deque>
+#include <future>  // NOLINT
 #include <memory>
 #include <string>
+#include <vector>
 #include "base/file.h"
+#include "base/integral_types.h"
 
 // This file defines some IO interfaces to compatible with Google
 // IO specifications.
@@ -130,6 +134,216 @@ class RecordReader {
 
   File* const file_;
 };
+
+// Chunked record files store a sequence of independent chunks, so that a
+// large message can be split into many small ones, written and read one at
+// a time. Each chunk follows the following format (sequentially):
+// - MagicNumber (32 bits) to recognize this format.
+// - Chunk type (32 bits), defined by the application.
+// - Payload size (64 bits).
+// - Payload, a serialized protocol buffer. Payloads are never compressed,
+//   so that they can be parsed in place from a memory mapping.
+class ChunkWriter {
+ public:
+  // Magic number starting each chunk.
+  static const int kMagicNumber;
+
+  explicit ChunkWriter(File* const file);
+
+  template <class P>
+  bool WriteChunk(int type, const P& proto) {
+    std::string buffer;
+    proto.SerializeToString(&buffer);
+    return WriteChunk(type, buffer);
+  }
+  bool WriteChunk(int type, const std::string& payload);
+  // Closes the underlying file.
+  bool Close();
+
+ private:
+  File* const file_;
+};
+
+// This class reads the chunks of a file written by ChunkWriter, one at a
+// time. Where supported, the file is memory mapped and the pages of the
+// chunks already read are released, so that memory usage is bounded by the
+// size of the largest chunk; otherwise chunks are read into a buffer.
+class ChunkReader {
+ public:
+  ChunkReader();
+  ~ChunkReader();
+
+  // Opens a file; returns false if it cannot be opened or does not start
+  // with a chunk.
+  bool Open(const std::string& filename);
+
+  // Reads the next chunk. Returns false at the end of the file, or if the
+  // file is corrupted, in which case ok() returns false.
+  template <class P>
+  bool ReadChunk(int* const type, P* const proto) {
+    const char* data = nullptr;
+    uint64 size = 0;
+    if (!NextChunk(type, &data, &size)) {
+      return false;
+    }
+    if (!proto->ParseFromArray(data, size)) {
+      ok_ = false;
+      return false;
+    }
+    return true;
+  }
+
+  // Returns the payload of the next chunk, valid until the next call.
+  bool NextChunk(int* const type, const char** const data,
+                 uint64* const size);
+
+  bool ok() const { return ok_; }
+  bool Close();
+
+ private:
+  // Reads 'size' bytes at the current offset, and returns a pointer to them
+  // or nullptr if the file is too short.
+  const char* ReadBytes(uint64 size);
+  void ReleaseReadPages();
+
+  bool ok_;
+  uint64 offset_;
+  uint64 released_offset_;
+  // Memory mapping of the file, if any.
+  const char* mapped_data_;
+  uint64 mapped_size_;
+  // Fallback when the file is not memory mapped.
+  File* file_;
+  std::string buffer_;
+};
+
+class ThreadPool;
+
+// Block record files store a sequence of records (usually serialized protocol
+// buffers) grouped in blocks that are compressed independently, followed by
+// an index of the blocks. Compared to RecordWriter, small records compress
+// much better together, the blocks can be compressed and uncompressed by
+// several threads, and BlockRecordReader can read any record directly.
+// The format is (sequentially):
+// - The blocks, each made of:
+//   - MagicNumber (32 bits) to recognize this format.
+//   - Number of records in the block (32 bits).
+//   - Uncompressed payload size (64 bits).
+//   - Compressed payload size (64 bits), or 0 if the payload is not
+//     compressed.
+//   - Payload, possibly compressed: for each record, its size (32 bits)
+//     followed by its bytes.
+// - The index: for each block, its offset in the file (64 bits) and the
+//   number of records before it (64 bits).
+// - The footer: the offset of the index (64 bits), the number of blocks
+//   (64 bits), the number of records (64 bits) and MagicNumber (32 bits).
+class BlockRecordWriter {
+ public:
+  static const int kMagicNumber;
+  static const int64 kDefaultBlockSize;
+
+  // Compresses the blocks with 'num_threads' threads; with 0, the blocks are
+  // compressed by the calling thread. Does not take ownership of the file.
+  BlockRecordWriter(File* const file, int num_threads);
+  // Close() must have been called.
+  ~BlockRecordWriter();
+
+  void set_use_compression(bool use_compression) {
+    use_compression_ = use_compression;
+  }
+  // Size of the uncompressed payload above which a block is complete.
+  void set_block_size(int64 block_size) { block_size_ = block_size; }
+
+  template <class P>
+  bool WriteProtocolMessage(const P& proto) {
+    std::string buffer;
+    proto.SerializeToString(&buffer);
+    return WriteRecord(buffer);
+  }
+  bool WriteRecord(const std::string& record);
+
+  // Writes the last block, the index and the footer, and closes the file.
+  bool Close();
+
+ private:
+  struct Block {
+    int32 num_records;
+    uint64 uncompressed_size;
+    // The compressed payload, or the payload if it is not compressed.
+    std::string data;
+    bool compressed;
+  };
+
+  static Block MakeBlock(std::string payload, int32 num_records,
+                         bool compress);
+  // Hands the current block to the compression, and writes the compressed
+  // blocks, in order, waiting for them if 'wait' is true or if too many of
+  // them are pending.
+  void FlushBlock();
+  void WriteCompressedBlocks(bool wait);
+  bool WriteBlock(const Block& block);
+  bool WriteUint64(uint64 value);
+
+  File* const file_;
+  std::unique_ptr<ThreadPool> pool_;
+  std::deque<std::future<Block>> pending_blocks_;
+  bool use_compression_;
+  int64 block_size_;
+  std::string current_payload_;
+  int32 current_num_records_;
+  int64 num_records_;
+  uint64 offset_;
+  std::vector<uint64> block_offsets_;
+  std::vector<uint64> block_first_records_;
+  bool ok_;
+  bool closed_;
+};
+
+// This class reads the records of a file written by BlockRecordWriter, in
+// any order. Where supported the file is memory mapped, otherwise it is read
+// into memory. The last uncompressed block is cached, so reading the records
+// in order uncompresses each block once.
+class BlockRecordReader {
+ public:
+  BlockRecordReader();
+  ~BlockRecordReader();
+
+  // Opens a file; returns false if it cannot be opened or has no valid
+  // footer and index.
+  bool Open(const std::string& filename);
+
+  int64 NumRecords() const { return num_records_; }
+
+  // Reads the record at 'index', in [0, NumRecords()). Returns false if the
+  // file is corrupted.
+  bool ReadRecord(int64 index, std::string* const record);
+  template <class P>
+  bool ReadProtocolMessage(int64 index, P* const proto) {
+    std::string buffer;
+    return ReadRecord(index, &buffer) && proto->ParseFromString(buffer);
+  }
+
+  // Reads all the records, in order, uncompressing the blocks with
+  // 'num_threads' threads (in the calling thread if 0).
+  bool ReadAllRecords(int num_threads, std::vector<std::string>* const records);
+
+  bool Close();
+
+ private:
+  // Uncompresses the block and appends its records to 'records'.
+  bool ReadBlock(int block, std::vector<std::string>* const records) const;
+
+  const char* data_;
+  uint64 size_;
+  bool mapped_;
+  // Content of the file when it is not memory mapped.
+  std::string content_;
+  int64 num_records_;
+  std::vector<uint64> block_offsets_;
+  std::vector<uint64> block_first_records_;
+  int cached_block_;
+  std::vector<std::string> cached_records_;
+};
 }  // namespace operations_research
 
 #endif  // OR_TOOLS_BASE_RECORDIO_H_
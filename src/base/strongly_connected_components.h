@@ -40,13 +40,24 @@
 // IMPORTANT: num_nodes will be the number of nodes of the graph. Its type
 // is the type used internally by the algorithm. It is why it is better to
 // convert it to int or even int32 rather than using size_t which takes 64 bits.
+//
+// Clients computing the components of many graphs should use the class
+// StronglyConnectedComponentsFinder below, which keeps its memory between two
+// calls, returns the components in flat arrays, and has a parallel version
+// for large graphs.
 
 #ifndef OR_TOOLS_BASE_STRONGLY_CONNECTED_COMPONENTS_H_
 #define OR_TOOLS_BASE_STRONGLY_CONNECTED_COMPONENTS_H_
 
+#include <algorithm>
+#include <atomic>
 #include <limits>
+#include <memory>
+#include <numeric>
+#include <thread>  // NOLINT
 #include <vector>
 
+#include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/macros.h"
 
@@ -92,6 +103,205 @@ struct SccCounterOutput {
   int size() const { return number_of_components; }
 };
 
+// A class version of FindStronglyConnectedComponents() for the clients that
+// compute the components of many graphs: the memory used by the algorithm is
+// kept from one call to the next. Besides the SccOutput interface above, the
+// components can be returned in flat arrays, which avoids one allocation per
+// component:
+//
+// StronglyConnectedComponentsFinder<int> finder;
+// const int num_components = finder.FindComponents(num_nodes, graph);
+// for (int c = 0; c < num_components; ++c) {
+//   for (int i = finder.component_start()[c];
+//        i < finder.component_start()[c + 1]; ++i) {
+//     const int node = finder.component_nodes()[i];
+//     ...
+//   }
+// }
+//
+// FindComponentsInParallel() computes the same components with several
+// threads, with the "Multistep" method of G.M. Slota, S. Rajamanickam,
+// K. Madduri, "BFS and coloring-based parallel algorithms for strongly
+// connected components and related problems", IPDPS 2014:
+// - The nodes without incoming or outgoing arc are trimmed away.
+// - The component of a node with many incoming and outgoing arcs, which is
+//   usually the largest one, is computed by a forward and a backward parallel
+//   breadth-first search.
+// - Then the coloring step is repeated: each remaining node gets as color the
+//   largest node that can reach it, by parallel propagation until a fixed
+//   point is reached, and the component of each node whose color is itself is
+//   computed by a backward breadth-first search restricted to its color.
+// - The last remaining nodes are processed by the sequential algorithm.
+template <typename NodeIndex>
+class StronglyConnectedComponentsFinder {
+ public:
+  StronglyConnectedComponentsFinder()
+      : num_components_(0), num_threads_(1), atomic_capacity_(0) {}
+
+  // Same as the function FindStronglyConnectedComponents().
+  template <typename Graph, typename SccOutput>
+  void FindStronglyConnectedComponents(NodeIndex num_nodes, const Graph& graph,
+                                       SccOutput* components);
+
+  // Computes the strongly connected components of the graph, with the same
+  // requirements on Graph as FindStronglyConnectedComponents(), and returns
+  // their number. The components are numbered in reverse topological order.
+  template <typename Graph>
+  NodeIndex FindComponents(NodeIndex num_nodes, const Graph& graph);
+
+  // Same as FindComponents() with num_threads threads. The components are
+  // numbered in the order of their smallest node, and the nodes of each
+  // component are in increasing order, so that the result does not depend on
+  // num_threads. graph[node] is called once per node from the calling thread:
+  // the graph and its transpose are first copied in compact form, which uses
+  // O(nodes + arcs) memory.
+  template <typename Graph>
+  NodeIndex FindComponentsInParallel(NodeIndex num_nodes, const Graph& graph,
+                                     int num_threads);
+
+  // The result of the last call to FindComponents() or
+  // FindComponentsInParallel(): the component of each node, and the nodes of
+  // the component c in component_nodes()[component_start()[c]] to
+  // component_nodes()[component_start()[c + 1] - 1].
+  NodeIndex num_components() const { return num_components_; }
+  const std::vector<NodeIndex>& component_of_node() const {
+    return component_of_node_;
+  }
+  const std::vector<NodeIndex>& component_start() const {
+    return component_start_;
+  }
+  const std::vector<NodeIndex>& component_nodes() const {
+    return component_nodes_;
+  }
+
+ private:
+  // The label of the nodes that are not yet in a component.
+  static NodeIndex Unassigned() {
+    return std::numeric_limits<NodeIndex>::max();
+  }
+
+  // The SccOutput of FindComponents().
+  struct FlatOutput {
+    explicit FlatOutput(StronglyConnectedComponentsFinder* f) : finder(f) {}
+    void emplace_back(NodeIndex const* begin, NodeIndex const* end) {
+      for (NodeIndex const* node = begin; node != end; ++node) {
+        finder->component_of_node_[*node] = finder->num_components_;
+        finder->component_nodes_.push_back(*node);
+      }
+      ++finder->num_components_;
+      finder->component_start_.push_back(finder->component_nodes_.size());
+    }
+    StronglyConnectedComponentsFinder* finder;
+  };
+
+  // The graph of the nodes without label, and the SccOutput that labels its
+  // components, used to finish FindComponentsInParallel(). The labeled nodes
+  // are isolated in this graph, and their trivial components are ignored.
+  struct UnlabeledGraph {
+    explicit UnlabeledGraph(const StronglyConnectedComponentsFinder* f)
+        : finder(f) {}
+    const std::vector<NodeIndex>& operator[](NodeIndex node) const {
+      heads.clear();
+      if (finder->label_[node] != Unassigned()) return heads;
+      for (int64 arc = finder->forward_start_[node];
+           arc < finder->forward_start_[node + 1]; ++arc) {
+        const NodeIndex head = finder->forward_heads_[arc];
+        if (finder->label_[head] == Unassigned()) heads.push_back(head);
+      }
+      return heads;
+    }
+    const StronglyConnectedComponentsFinder* finder;
+    mutable std::vector<NodeIndex> heads;
+  };
+  struct LabelingOutput {
+    explicit LabelingOutput(StronglyConnectedComponentsFinder* f)
+        : finder(f) {}
+    void emplace_back(NodeIndex const* begin, NodeIndex const* end) {
+      if (finder->label_[*begin] != Unassigned()) return;
+      for (NodeIndex const* node = begin; node != end; ++node) {
+        finder->label_[*node] = *begin;
+      }
+    }
+    StronglyConnectedComponentsFinder* finder;
+  };
+
+  // Returns the number of threads used for a parallel loop on num_items.
+  int NumChunks(int64 num_items) const {
+    const int64 kMinItemsPerThread = 1024;
+    return static_cast<int>(std::max<int64>(
+        1, std::min<int64>(num_threads_, num_items / kMinItemsPerThread)));
+  }
+
+  // Splits [0, num_items) into num_chunks contiguous chunks, and calls
+  // body(chunk, begin, end) on each of them in parallel.
+  template <typename Body>
+  static void ParallelForChunks(int num_chunks, int64 num_items,
+                                const Body& body);
+
+  // Sets label_[node] to node for the nodes of remaining_ without incoming or
+  // outgoing arcs from other remaining nodes, until there are few of them.
+  void Trim();
+
+  // Marks with bit the nodes reachable from the nodes of frontier_ that are
+  // not labeled and have the same color as the node they are reached from
+  // (if use_colors is true), following the arcs of the given CSR graph.
+  void ParallelSearch(const std::vector<int64>& start,
+                      const std::vector<NodeIndex>& adjacency, uint8 bit,
+                      bool use_colors);
+
+  // Labels the component of a node with many arcs, by a forward and a
+  // backward search.
+  void ForwardBackwardStep();
+
+  // Runs the coloring step and returns the number of nodes it labeled.
+  int64 ColoringStep();
+
+  // Removes the labeled nodes from remaining_.
+  void CompactRemainingNodes();
+
+  // Workspaces of FindStronglyConnectedComponents(). See the comments in this
+  // method.
+  std::vector<NodeIndex> scc_stack_;
+  std::vector<NodeIndex> scc_start_index_;
+  std::vector<NodeIndex> node_index_;
+  std::vector<NodeIndex> node_to_process_;
+
+  // The output of FindComponents() and FindComponentsInParallel().
+  NodeIndex num_components_;
+  std::vector<NodeIndex> component_of_node_;
+  std::vector<NodeIndex> component_start_;
+  std::vector<NodeIndex> component_nodes_;
+
+  // Workspaces of FindComponentsInParallel(): the graph and its transpose in
+  // CSR form, the label of each node (the node that identifies its
+  // component, or Unassigned()), the nodes without label, the current
+  // frontier of a parallel search, and the nodes found by each thread.
+  int num_threads_;
+  std::vector<int64> forward_start_;
+  std::vector<NodeIndex> forward_heads_;
+  std::vector<int64> backward_start_;
+  std::vector<NodeIndex> backward_tails_;
+  std::vector<NodeIndex> label_;
+  std::vector<NodeIndex> remaining_;
+  std::vector<NodeIndex> frontier_;
+  std::vector<std::vector<NodeIndex>> chunk_nodes_;
+  std::vector<NodeIndex> component_of_label_;
+  // The color of each node, and the bits set by ParallelSearch().
+  int64 atomic_capacity_;
+  std::unique_ptr<std::atomic<NodeIndex>[]> color_;
+  std::unique_ptr<std::atomic<uint8>[]> reached_;
+
+  DISALLOW_COPY_AND_ASSIGN(StronglyConnectedComponentsFinder);
+};
+
+template<typename NodeIndex, typename Graph, typename SccOutput>
+void FindStronglyConnectedComponents(const NodeIndex num_nodes,
+                                     const Graph& graph,
+                                     SccOutput* components) {
+  StronglyConnectedComponentsFinder<NodeIndex> finder;
+  finder.FindStronglyConnectedComponents(num_nodes, graph, components);
+}
+
 // This implementation is slightly different than a classical iterative version
 // of Tarjan's strongly connected components algorithm. But basically it is
 // still an iterative DFS.
@@ -99,23 +309,23 @@ struct SccCounterOutput {
 // TODO(user): Possible optimizations:
 // - Try to reserve the vectors which sizes are bounded by num_nodes.
 // - Use an index rather than doing push_back(), pop_back() on them.
-// - For a client needing many Scc computations one after another, it could be
-//   better to wrap this in a class so we don't need to allocate the stacks at
-//   each computation.
-template<typename NodeIndex, typename Graph, typename SccOutput>
-void FindStronglyConnectedComponents(const NodeIndex num_nodes,
-                                     const Graph& graph,
-                                     SccOutput* components) {
+template <typename NodeIndex>
+template <typename Graph, typename SccOutput>
+void StronglyConnectedComponentsFinder<NodeIndex>::
+    FindStronglyConnectedComponents(NodeIndex num_nodes, const Graph& graph,
+                                    SccOutput* components) {
   // Each node expanded by the DFS will be pushed on this stack. A node is only
   // popped back when its strongly connected component has been explored and
   // outputted.
-  std::vector<NodeIndex> scc_stack;
+  std::vector<NodeIndex>& scc_stack = scc_stack_;
+  scc_stack.clear();
 
   // This is equivalent to the "low link" of a node in Tarjan's algorithm.
   // Basically, scc_start_index.back() represent the 1-based index in scc_stack
   // of the beginning of the current strongly connected component. All the
   // nodes after this index will be on the same component.
-  std::vector<NodeIndex> scc_start_index;
+  std::vector<NodeIndex>& scc_start_index = scc_start_index_;
+  scc_start_index.clear();
 
   // Optimization. This will always be equal to scc_start_index.back() except
   // when scc_stack is empty, in which case its value does not matter.
@@ -127,13 +337,15 @@ void FindStronglyConnectedComponents(const NodeIndex num_nodes,
   //   get their 1-based index on this stack.
   // - Once they have been processed and outputted to components, they are said
   //   to be settled, and their index become kSettledIndex.
-  std::vector<NodeIndex> node_index(num_nodes, 0);
+  std::vector<NodeIndex>& node_index = node_index_;
+  node_index.assign(num_nodes, 0);
   const NodeIndex kSettledIndex = std::numeric_limits<NodeIndex>::max();
 
   // This is a well known way to do an efficient iterative DFS. Each time a node
   // is explored, all its adjacent nodes are pushed on this stack. The iterative
   // dfs processes the nodes one by one by popping them back from here.
-  std::vector<NodeIndex> node_to_process;
+  std::vector<NodeIndex>& node_to_process = node_to_process_;
+  node_to_process.clear();
 
   // Loop over all the nodes not yet settled and start a DFS from each of them.
   for (NodeIndex base_node = 0; base_node < num_nodes; ++base_node) {
@@ -188,4 +400,329 @@ void FindStronglyConnectedComponents(const NodeIndex num_nodes,
   }
 }
 
+template <typename NodeIndex>
+template <typename Graph>
+NodeIndex StronglyConnectedComponentsFinder<NodeIndex>::FindComponents(
+    NodeIndex num_nodes, const Graph& graph) {
+  num_components_ = 0;
+  component_of_node_.resize(num_nodes);
+  component_start_.assign(1, 0);
+  component_nodes_.clear();
+  FlatOutput output(this);
+  FindStronglyConnectedComponents(num_nodes, graph, &output);
+  return num_components_;
+}
+
+template <typename NodeIndex>
+template <typename Body>
+void StronglyConnectedComponentsFinder<NodeIndex>::ParallelForChunks(
+    int num_chunks, int64 num_items, const Body& body) {
+  std::vector<std::thread> threads;
+  for (int chunk = 1; chunk < num_chunks; ++chunk) {
+    threads.push_back(std::thread(body, chunk, num_items * chunk / num_chunks,
+                                  num_items * (chunk + 1) / num_chunks));
+  }
+  body(0, 0, num_items / num_chunks);
+  for (std::thread& thread : threads) thread.join();
+}
+
+template <typename NodeIndex>
+void StronglyConnectedComponentsFinder<NodeIndex>::CompactRemainingNodes() {
+  const int num_chunks = NumChunks(remaining_.size());
+  chunk_nodes_.resize(num_chunks);
+  ParallelForChunks(num_chunks, remaining_.size(),
+                    [this](int chunk, int64 begin, int64 end) {
+                      std::vector<NodeIndex>& nodes = chunk_nodes_[chunk];
+                      nodes.clear();
+                      for (int64 i = begin; i < end; ++i) {
+                        const NodeIndex node = remaining_[i];
+                        if (label_[node] == Unassigned()) nodes.push_back(node);
+                      }
+                    });
+  remaining_.clear();
+  for (int chunk = 0; chunk < num_chunks; ++chunk) {
+    remaining_.insert(remaining_.end(), chunk_nodes_[chunk].begin(),
+                      chunk_nodes_[chunk].end());
+  }
+}
+
+template <typename NodeIndex>
+void StronglyConnectedComponentsFinder<NodeIndex>::Trim() {
+  while (!remaining_.empty()) {
+    const int num_chunks = NumChunks(remaining_.size());
+    chunk_nodes_.resize(num_chunks);
+    // A node is trimmed if all its predecessors or all its successors other
+    // than itself are labeled.
+    auto has_unlabeled_neighbor = [this](NodeIndex node,
+                                         const std::vector<int64>& start,
+                                         const std::vector<NodeIndex>& heads) {
+      for (int64 arc = start[node]; arc < start[node + 1]; ++arc) {
+        const NodeIndex head = heads[arc];
+        if (head != node && label_[head] == Unassigned()) return true;
+      }
+      return false;
+    };
+    ParallelForChunks(
+        num_chunks, remaining_.size(),
+        [this, &has_unlabeled_neighbor](int chunk, int64 begin, int64 end) {
+          std::vector<NodeIndex>& trimmed = chunk_nodes_[chunk];
+          trimmed.clear();
+          for (int64 i = begin; i < end; ++i) {
+            const NodeIndex node = remaining_[i];
+            if (!has_unlabeled_neighbor(node, forward_start_, forward_heads_) ||
+                !has_unlabeled_neighbor(node, backward_start_,
+                                        backward_tails_)) {
+              trimmed.push_back(node);
+            }
+          }
+        });
+    int64 num_trimmed = 0;
+    for (int chunk = 0; chunk < num_chunks; ++chunk) {
+      for (const NodeIndex node : chunk_nodes_[chunk]) label_[node] = node;
+      num_trimmed += chunk_nodes_[chunk].size();
+    }
+    const int64 num_remaining = remaining_.size();
+    if (num_trimmed > 0) CompactRemainingNodes();
+    // Each round only trims one more node of the paths of trimmed nodes, so
+    // the rounds that trim few nodes are left to the next steps.
+    if (100 * num_trimmed < num_remaining) break;
+  }
+}
+
+template <typename NodeIndex>
+void StronglyConnectedComponentsFinder<NodeIndex>::ParallelSearch(
+    const std::vector<int64>& start, const std::vector<NodeIndex>& adjacency,
+    uint8 bit, bool use_colors) {
+  while (!frontier_.empty()) {
+    const int num_chunks = NumChunks(frontier_.size());
+    chunk_nodes_.resize(num_chunks);
+    ParallelForChunks(
+        num_chunks, frontier_.size(),
+        [this, &start, &adjacency, bit, use_colors](int chunk, int64 begin,
+                                                    int64 end) {
+          std::vector<NodeIndex>& next = chunk_nodes_[chunk];
+          next.clear();
+          for (int64 i = begin; i < end; ++i) {
+            const NodeIndex node = frontier_[i];
+            const NodeIndex color =
+                use_colors ? color_[node].load(std::memory_order_relaxed) : 0;
+            for (int64 arc = start[node]; arc < start[node + 1]; ++arc) {
+              const NodeIndex head = adjacency[arc];
+              if (label_[head] != Unassigned()) continue;
+              if (use_colors &&
+                  color_[head].load(std::memory_order_relaxed) != color) {
+                continue;
+              }
+              if ((reached_[head].load(std::memory_order_relaxed) & bit) != 0) {
+                continue;
+              }
+              if ((reached_[head].fetch_or(bit, std::memory_order_relaxed) &
+                   bit) == 0) {
+                next.push_back(head);
+              }
+            }
+          }
+        });
+    frontier_.clear();
+    for (int chunk = 0; chunk < num_chunks; ++chunk) {
+      frontier_.insert(frontier_.end(), chunk_nodes_[chunk].begin(),
+                       chunk_nodes_[chunk].end());
+    }
+  }
+}
+
+template <typename NodeIndex>
+void StronglyConnectedComponentsFinder<NodeIndex>::ForwardBackwardStep() {
+  // The pivot maximizes the product of its in and out degrees, as the nodes
+  // of the largest component usually have many arcs.
+  NodeIndex pivot = remaining_[0];
+  int64 best_degree_product = -1;
+  for (const NodeIndex node : remaining_) {
+    const int64 degree_product =
+        (forward_start_[node + 1] - forward_start_[node]) *
+        (backward_start_[node + 1] - backward_start_[node]);
+    if (degree_product > best_degree_product) {
+      best_degree_product = degree_product;
+      pivot = node;
+    }
+  }
+  const uint8 kForward = 1;
+  const uint8 kBackward = 2;
+  for (const uint8 bit : {kForward, kBackward}) {
+    reached_[pivot].fetch_or(bit, std::memory_order_relaxed);
+    frontier_.assign(1, pivot);
+    ParallelSearch(bit == kForward ? forward_start_ : backward_start_,
+                   bit == kForward ? forward_heads_ : backward_tails_, bit,
+                   /*use_colors=*/false);
+  }
+  ParallelForChunks(NumChunks(remaining_.size()), remaining_.size(),
+                    [this, pivot, kForward, kBackward](int chunk, int64 begin,
+                                                       int64 end) {
+                      for (int64 i = begin; i < end; ++i) {
+                        const NodeIndex node = remaining_[i];
+                        if (reached_[node].load(std::memory_order_relaxed) ==
+                            (kForward | kBackward)) {
+                          label_[node] = pivot;
+                        }
+                        reached_[node].store(0, std::memory_order_relaxed);
+                      }
+                    });
+  CompactRemainingNodes();
+}
+
+template <typename NodeIndex>
+int64 StronglyConnectedComponentsFinder<NodeIndex>::ColoringStep() {
+  const int num_chunks = NumChunks(remaining_.size());
+  ParallelForChunks(num_chunks, remaining_.size(),
+                    [this](int chunk, int64 begin, int64 end) {
+                      for (int64 i = begin; i < end; ++i) {
+                        const NodeIndex node = remaining_[i];
+                        color_[node].store(node, std::memory_order_relaxed);
+                      }
+                    });
+  // The colors are propagated along the arcs, each node taking the largest
+  // color of its predecessors, until nothing changes. The nodes are updated
+  // in place, which propagates the colors faster.
+  std::atomic<bool> changed(true);
+  while (changed) {
+    changed = false;
+    ParallelForChunks(
+        num_chunks, remaining_.size(),
+        [this, &changed](int chunk, int64 begin, int64 end) {
+          bool chunk_changed = false;
+          for (int64 i = begin; i < end; ++i) {
+            const NodeIndex node = remaining_[i];
+            const NodeIndex old_color =
+                color_[node].load(std::memory_order_relaxed);
+            NodeIndex color = old_color;
+            for (int64 arc = backward_start_[node];
+                 arc < backward_start_[node + 1]; ++arc) {
+              const NodeIndex tail = backward_tails_[arc];
+              if (label_[tail] != Unassigned()) continue;
+              color = std::max(color,
+                               color_[tail].load(std::memory_order_relaxed));
+            }
+            if (color != old_color) {
+              color_[node].store(color, std::memory_order_relaxed);
+              chunk_changed = true;
+            }
+          }
+          if (chunk_changed) changed = true;
+        });
+  }
+
+  // The component of a node whose color is itself is made of the nodes of
+  // this color that can reach it.
+  const uint8 kReached = 1;
+  frontier_.clear();
+  for (const NodeIndex node : remaining_) {
+    if (color_[node].load(std::memory_order_relaxed) == node) {
+      reached_[node].store(kReached, std::memory_order_relaxed);
+      frontier_.push_back(node);
+    }
+  }
+  ParallelSearch(backward_start_, backward_tails_, kReached,
+                 /*use_colors=*/true);
+  int64 num_labeled = 0;
+  for (const NodeIndex node : remaining_) {
+    if (reached_[node].load(std::memory_order_relaxed) != 0) {
+      label_[node] = color_[node].load(std::memory_order_relaxed);
+      reached_[node].store(0, std::memory_order_relaxed);
+      ++num_labeled;
+    }
+  }
+  CompactRemainingNodes();
+  return num_labeled;
+}
+
+template <typename NodeIndex>
+template <typename Graph>
+NodeIndex
+StronglyConnectedComponentsFinder<NodeIndex>::FindComponentsInParallel(
+    NodeIndex num_nodes, const Graph& graph, int num_threads) {
+  num_threads_ = std::max(1, num_threads);
+
+  // Copies the graph and its transpose in CSR form.
+  forward_start_.assign(num_nodes + 1, 0);
+  forward_heads_.clear();
+  for (NodeIndex node = 0; node < num_nodes; ++node) {
+    for (const NodeIndex head : graph[node]) forward_heads_.push_back(head);
+    forward_start_[node + 1] = forward_heads_.size();
+  }
+  backward_start_.assign(num_nodes + 1, 0);
+  for (const NodeIndex head : forward_heads_) ++backward_start_[head + 1];
+  std::partial_sum(backward_start_.begin(), backward_start_.end(),
+                   backward_start_.begin());
+  backward_tails_.resize(forward_heads_.size());
+  for (NodeIndex node = 0; node < num_nodes; ++node) {
+    for (int64 arc = forward_start_[node]; arc < forward_start_[node + 1];
+         ++arc) {
+      backward_tails_[backward_start_[forward_heads_[arc]]++] = node;
+    }
+  }
+  // backward_start_[node] is now the start of node + 1.
+  for (NodeIndex node = num_nodes; node > 0; --node) {
+    backward_start_[node] = backward_start_[node - 1];
+  }
+  backward_start_[0] = 0;
+
+  label_.assign(num_nodes, Unassigned());
+  if (atomic_capacity_ < num_nodes) {
+    atomic_capacity_ = num_nodes;
+    color_.reset(new std::atomic<NodeIndex>[num_nodes]);
+    reached_.reset(new std::atomic<uint8>[num_nodes]);
+  }
+  for (NodeIndex node = 0; node < num_nodes; ++node) {
+    reached_[node].store(0, std::memory_order_relaxed);
+  }
+  remaining_.resize(num_nodes);
+  std::iota(remaining_.begin(), remaining_.end(), 0);
+
+  // Below this number of remaining nodes, the sequential algorithm is faster.
+  const int64 kMinNumNodesForParallelSteps = 1 << 14;
+  if (num_threads_ > 1) {
+    Trim();
+    if (remaining_.size() >= kMinNumNodesForParallelSteps) {
+      ForwardBackwardStep();
+      Trim();
+    }
+    while (remaining_.size() >= kMinNumNodesForParallelSteps) {
+      // A coloring step labels at least the node of the largest color of
+      // each part of the graph, but this can be very few nodes.
+      const int64 num_remaining = remaining_.size();
+      if (100 * ColoringStep() < num_remaining) break;
+    }
+  }
+  if (!remaining_.empty()) {
+    LabelingOutput output(this);
+    FindStronglyConnectedComponents(num_nodes, UnlabeledGraph(this), &output);
+  }
+
+  // Numbers the components in the order of their smallest node, and sorts
+  // their nodes.
+  num_components_ = 0;
+  component_of_label_.assign(num_nodes, Unassigned());
+  component_of_node_.resize(num_nodes);
+  for (NodeIndex node = 0; node < num_nodes; ++node) {
+    NodeIndex& component = component_of_label_[label_[node]];
+    if (component == Unassigned()) component = num_components_++;
+    component_of_node_[node] = component;
+  }
+  component_start_.assign(num_components_ + 1, 0);
+  for (const NodeIndex component : component_of_node_) {
+    ++component_start_[component + 1];
+  }
+  std::partial_sum(component_start_.begin(), component_start_.end(),
+                   component_start_.begin());
+  component_nodes_.resize(num_nodes);
+  for (NodeIndex node = 0; node < num_nodes; ++node) {
+    component_nodes_[component_start_[component_of_node_[node]]++] = node;
+  }
+  for (NodeIndex component = num_components_; component > 0; --component) {
+    component_start_[component] = component_start_[component - 1];
+  }
+  component_start_[0] = 0;
+  return num_components_;
+}
+
 #endif  // OR_TOOLS_BASE_STRONGLY_CONNECTED_COMPONENTS_H_
@@ -13,18 +13,47 @@
 
 #include "base/threadpool.h"
 
+#include <algorithm>
+#include <chrono>  // NOLINT
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace operations_research {
-void RunWorker(void* data) {
-  ThreadPool* const thread_pool = reinterpret_cast<ThreadPool*>(data);
-  Closure* work = thread_pool->GetNextTask();
-  while (work != NULL) {
-    work->Run();
-    work = thread_pool->GetNextTask();
-  }
+namespace {
+// The pool and the index of the worker running the current thread, if any.
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local int current_worker = -1;
+
+// How long TaskGroup::Wait() sleeps before looking for tasks to run again,
+// when there are none.
+const int kTaskGroupWaitMicroseconds = 1000;
+
+void PinCurrentThread(int index) {
+#if defined(__linux__)
+  const int num_cpus = std::thread::hardware_concurrency();
+  if (num_cpus <= 0) return;
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(index % num_cpus, &cpus);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
 }
+}  // namespace
 
 ThreadPool::ThreadPool(const std::string& prefix, int num_workers)
-    : num_workers_(num_workers), waiting_to_finish_(false), started_(false) {}
+    : prefix_(prefix),
+      num_workers_(std::max(1, num_workers)),
+      num_pending_tasks_(0),
+      next_queue_(0),
+      waiting_to_finish_(false),
+      started_(false),
+      pin_workers_(false) {
+  for (int i = 0; i < num_workers_; ++i) {
+    queues_.emplace_back(new WorkerQueue);
+  }
+}
 
 ThreadPool::~ThreadPool() {
   if (started_) {
@@ -41,33 +70,138 @@ ThreadPool::~ThreadPool() {
 void ThreadPool::StartWorkers() {
   started_ = true;
   for (int i = 0; i < num_workers_; ++i) {
-    all_workers_.push_back(std::thread(&RunWorker, this));
+    all_workers_.push_back(std::thread(&ThreadPool::RunWorker, this, i));
   }
 }
 
-Closure* ThreadPool::GetNextTask() {
-  std::unique_lock<std::mutex> lock(mutex_);
+void ThreadPool::RunWorker(int index) {
+  current_pool = this;
+  current_worker = index;
+  if (pin_workers_) PinCurrentThread(index);
+  std::function<void()> task;
   for (;;) {
-    if (!tasks_.empty()) {
-      Closure* const task = tasks_.front();
-      tasks_.pop_front();
-      return task;
+    if (PopTask(index, &task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    // A task may be between its queue and the counter; look again.
+    if (num_pending_tasks_.load() > 0) continue;
+    if (waiting_to_finish_) return;
+    condition_.wait(lock);
+  }
+}
+
+bool ThreadPool::PopTask(int index, std::function<void()>* task) {
+  if (num_pending_tasks_.load() == 0) return false;
+  if (index >= 0) {
+    WorkerQueue* const queue = queues_[index].get();
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!queue->tasks.empty()) {
+      *task = std::move(queue->tasks.back());
+      queue->tasks.pop_back();
+      --num_pending_tasks_;
+      return true;
     }
-    if (waiting_to_finish_) {
-      return NULL;
-    } else {
-      condition_.wait(lock);
+  }
+  const int first = index >= 0 ? index + 1 : 0;
+  for (int i = 0; i < num_workers_; ++i) {
+    const int victim = (first + i) % num_workers_;
+    if (victim == index) continue;
+    WorkerQueue* const queue = queues_[victim].get();
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!queue->tasks.empty()) {
+      *task = std::move(queue->tasks.front());
+      queue->tasks.pop_front();
+      --num_pending_tasks_;
+      return true;
     }
   }
-  return NULL;
+  return false;
+}
+
+bool ThreadPool::RunPendingTask() {
+  std::function<void()> task;
+  if (!PopTask(CurrentWorker(), &task)) return false;
+  task();
+  return true;
+}
+
+int ThreadPool::CurrentWorker() const {
+  return current_pool == this ? current_worker : -1;
 }
 
 void ThreadPool::Add(Closure* const closure) {
-  std::unique_lock<std::mutex> lock(mutex_);
-  tasks_.push_back(closure);
+  Schedule([closure]() { closure->Run(); });
+}
+
+void ThreadPool::Schedule(std::function<void()> task) {
+  const int worker = CurrentWorker();
+  if (worker >= 0) {
+    WorkerQueue* const queue = queues_[worker].get();
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    queue->tasks.push_back(std::move(task));
+  } else {
+    // The owner of a queue runs its back first; putting the tasks of the
+    // other threads in front keeps them in order.
+    WorkerQueue* const queue =
+        queues_[static_cast<unsigned int>(next_queue_++) % num_workers_].get();
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    queue->tasks.push_front(std::move(task));
+  }
+  ++num_pending_tasks_;
   if (started_) {
+    // Taking the mutex ensures that no worker is between its check of the
+    // counter and its wait.
+    std::unique_lock<std::mutex> lock(mutex_);
     lock.unlock();
-    condition_.notify_all();
+    condition_.notify_one();
+  }
+}
+
+void ThreadPool::ParallelFor(int64 num_items, int64 grain_size,
+                             const std::function<void(int64, int64)>& body) {
+  grain_size = std::max<int64>(1, grain_size);
+  if (num_items <= grain_size) {
+    if (num_items > 0) body(0, num_items);
+    return;
+  }
+  TaskGroup group(this);
+  for (int64 begin = 0; begin < num_items; begin += grain_size) {
+    const int64 end = std::min(num_items, begin + grain_size);
+    group.Add([&body, begin, end]() { body(begin, end); });
+  }
+  group.Wait();
+}
+
+TaskGroup::TaskGroup(ThreadPool* pool) : pool_(pool), num_running_tasks_(0) {}
+
+TaskGroup::~TaskGroup() { Wait(); }
+
+void TaskGroup::Add(std::function<void()> task) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++num_running_tasks_;
+  }
+  pool_->Schedule([this, task]() {
+    task();
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (--num_running_tasks_ == 0) condition_.notify_all();
+  });
+}
+
+void TaskGroup::Wait() {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (num_running_tasks_ == 0) return;
+    }
+    if (pool_->RunPendingTask()) continue;
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait_for(
+        lock, std::chrono::microseconds(kTaskGroupWaitMicroseconds),
+        [this]() { return num_running_tasks_ == 0; });
   }
 }
 }  // namespace operations_research
@@ -14,33 +14,127 @@
 #ifndef OR_TOOLS_BASE_THREADPOOL_H_
 #define OR_TOOLS_BASE_THREADPOOL_H_
 
+#include <atomic>
 #include <condition_variable>  // NOLINT
-#include <list>
+#include <deque>
+#include <functional>
+#include <future>  // NOLINT
+#include <memory>
 #include <mutex>  // NOLINT
 #include <string>
+#include <type_traits>
 #include <vector>
 #include <thread>  // NOLINT
 
 #include "base/callback.h"
+#include "base/integral_types.h"
 
 namespace operations_research {
+// A pool of worker threads with one task queue per worker. A worker runs the
+// tasks of its own queue, newest first, and steals the oldest tasks of the
+// other queues when its own is empty. Tasks added by a worker of the pool go
+// to its own queue, so that nested tasks stay on the same thread as long as
+// the other workers are busy; tasks added from other threads are spread over
+// the queues.
+//
+// The tasks added before StartWorkers() are run once the workers are
+// started. The destructor waits until all the tasks have been run.
 class ThreadPool {
  public:
   explicit ThreadPool(const std::string& prefix, int num_threads);
   ~ThreadPool();
 
+  // Pins the worker i to the CPU i modulo the number of CPUs, so that the
+  // workers started together spread over the CPUs (and over their memory
+  // nodes) instead of migrating. Must be called before StartWorkers().
+  // Does nothing on the platforms without thread affinity.
+  void SetCpuAffinity(bool pin_workers) { pin_workers_ = pin_workers; }
+
   void StartWorkers();
+
+  // Adds a task. The closure is run once, and deletes itself if it is not
+  // repeatable, as usual.
   void Add(Closure* const closure);
-  Closure* GetNextTask();
+  void Schedule(std::function<void()> task);
+
+  // Adds a task that returns a value, and returns the future holding this
+  // value. Note that waiting on the future from a task of the same pool may
+  // deadlock if all the workers do so; use a TaskGroup instead.
+  template <typename Function>
+  std::future<typename std::result_of<Function()>::type> Submit(
+      Function function) {
+    typedef typename std::result_of<Function()>::type Result;
+    std::shared_ptr<std::packaged_task<Result()>> task(
+        new std::packaged_task<Result()>(function));
+    std::future<Result> result = task->get_future();
+    Schedule([task]() { (*task)(); });
+    return result;
+  }
+
+  // Calls body(begin, end) on consecutive ranges of at most grain_size
+  // indices covering [0, num_items), on the workers of the pool, and returns
+  // once all of them are done. The calling thread runs tasks of the pool
+  // while waiting, so this can be called from a task of the pool.
+  void ParallelFor(int64 num_items, int64 grain_size,
+                   const std::function<void(int64, int64)>& body);
+
+  int num_workers() const { return num_workers_; }
 
  private:
+  friend class TaskGroup;
+
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void RunWorker(int index);
+  // Pops a task from the queue 'index', or steals one from the other
+  // queues. Returns false if there was no task.
+  bool PopTask(int index, std::function<void()>* task);
+  // Runs one task of the pool if there is one, and returns true if it did.
+  bool RunPendingTask();
+  // Returns the index of the worker of this pool running the calling thread,
+  // or -1.
+  int CurrentWorker() const;
+
+  const std::string prefix_;
   const int num_workers_;
-  std::list<Closure*> tasks_;
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  // Number of tasks in the queues. Idle workers sleep on condition_ until it
+  // becomes positive.
+  std::atomic<int64> num_pending_tasks_;
+  std::atomic<int> next_queue_;
   std::mutex mutex_;
   std::condition_variable condition_;
   bool waiting_to_finish_;
   bool started_;
+  bool pin_workers_;
   std::vector<std::thread> all_workers_;
 };
+
+// A set of tasks run on a thread pool that can be waited for as a whole.
+//
+// TaskGroup group(&pool);
+// for (...) group.Add([...]() { ... });
+// group.Wait();
+//
+// Wait() runs tasks of the pool while the tasks of the group are not done,
+// so a task of the pool can create and wait for its own group of sub-tasks.
+class TaskGroup {
+ public:
+  explicit TaskGroup(ThreadPool* pool);
+  // Waits for the tasks of the group.
+  ~TaskGroup();
+
+  void Add(std::function<void()> task);
+  void Wait();
+
+ private:
+  ThreadPool* const pool_;
+  int64 num_running_tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+};
 }  // namespace operations_research
 #endif  // OR_TOOLS_BASE_THREADPOOL_H_
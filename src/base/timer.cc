@@ -13,6 +13,9 @@
 
 #include "base/timer.h"
 
+#include <chrono>  // NOLINT
+#include <thread>  // NOLINT
+
 namespace operations_research {
 
 ScopedWallTime::ScopedWallTime(double* aggregate_time)
@@ -26,4 +29,19 @@ ScopedWallTime::~ScopedWallTime() {
   *aggregate_time_ += timer_.Get();
 }
 
+double CycleTimerBase::CyclesPerSecond() {
+  // Measures the cycle counter against the wall clock during a few
+  // milliseconds. The time-stamp counter of the recent x86-64 processors
+  // runs at a constant rate, whatever the frequency of the cores.
+  static const double cycles_per_second = []() {
+    const int64 start_nanos = base::GetCurrentTimeNanos();
+    const int64 start_cycles = base::CycleClockNow();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const int64 cycles = base::CycleClockNow() - start_cycles;
+    const int64 nanos = base::GetCurrentTimeNanos() - start_nanos;
+    return nanos > 0 && cycles > 0 ? cycles * 1e9 / nanos : 1e9;
+  }();
+  return cycles_per_second;
+}
+
 }  // namespace operations_research
@@ -62,26 +62,79 @@ class WallTimer {
 // TODO(user): implement it properly.
 typedef WallTimer UserTimer;
 
-// This is meant to be a ultra-fast interface to the hardware cycle counter,
-// without periodic recalibration, to be even faster than
-// base::GetCurrentTimeNanos().
-// But this current implementation just uses GetCurrentTimeNanos().
-// TODO(user): implement it.
-class CycleTimer : public WallTimer {
+namespace base {
+// Returns the value of the hardware cycle counter (the time-stamp counter on
+// x86-64), or GetCurrentTimeNanos() on the platforms where it is not
+// available. Only the differences between two values are meaningful, and
+// only on the same machine.
+inline int64 CycleClockNow() {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+  uint32 low;
+  uint32 high;
+  __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+  return static_cast<int64>((static_cast<uint64>(high) << 32) | low);
+#else
+  return GetCurrentTimeNanos();
+#endif
+}
+}  // namespace base
+
+// Conversion routines between CycleTimer::GetCycles and actual times. The
+// frequency of the cycle counter is measured once, on the first conversion,
+// so converting should be done when the stats are displayed, not when they
+// are collected.
+class CycleTimerBase {
  public:
-  // This actually returns a number of nanoseconds instead of the number
-  // of CPU cycles.
-  int64 GetCycles() const { return GetNanos(); }
+  static double CyclesPerSecond();
+  static int64 SecondsToCycles(double s) {
+    return static_cast<int64>(s * CyclesPerSecond());
+  }
+  static double CyclesToSeconds(int64 c) { return c / CyclesPerSecond(); }
+  static int64 CyclesToMs(int64 c) {
+    return static_cast<int64>(CyclesToSeconds(c) * 1e3);
+  }
+  static int64 CyclesToUsec(int64 c) {
+    return static_cast<int64>(CyclesToSeconds(c) * 1e6);
+  }
 };
 
-// Conversion routines between CycleTimer::GetCycles and actual times.
-class CycleTimerBase {
+// An ultra-fast interface to the hardware cycle counter, without periodic
+// recalibration, to be even faster than base::GetCurrentTimeNanos(). It has
+// the same interface as WallTimer, plus GetCycles().
+class CycleTimer {
  public:
-  static int64 SecondsToCycles(double s) { return static_cast<int64>(s * 1e9); }
-  static double CyclesToSeconds(int64 c) { return c * 1e-9; }
-  static int64 CyclesToMs(int64 c) { return c / 1000000; }
-  static int64 CyclesToUsec(int64 c) { return c / 1000; }
+  CycleTimer() { Reset(); }
+  void Reset() {
+    running_ = false;
+    sum_ = 0;
+  }
+  void Start() {
+    running_ = true;
+    start_ = base::CycleClockNow();
+  }
+  void Restart() {
+    sum_ = 0;
+    Start();
+  }
+  void Stop() {
+    if (running_) {
+      sum_ += base::CycleClockNow() - start_;
+      running_ = false;
+    }
+  }
+  int64 GetCycles() const {
+    return running_ ? base::CycleClockNow() - start_ + sum_ : sum_;
+  }
+  double Get() const { return CycleTimerBase::CyclesToSeconds(GetCycles()); }
+  int64 GetInMs() const { return CycleTimerBase::CyclesToMs(GetCycles()); }
+  int64 GetInUsec() const { return CycleTimerBase::CyclesToUsec(GetCycles()); }
+
+ private:
+  bool running_;
+  int64 start_;
+  int64 sum_;
 };
+
 typedef CycleTimerBase CycleTimerInstance;
 
 // A WallTimer clone meant to support SetClock(), for unit testing. But for now
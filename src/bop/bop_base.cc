@@ -72,7 +72,9 @@ ProblemState::ProblemState(const LinearBooleanProblem& problem)
       solution_(problem, "AllZero"),
       assignment_preference_(),
       lower_bound_(kint64min),
-      upper_bound_(kint64max) {
+      upper_bound_(kint64max),
+      learned_clauses_(),
+      num_merged_learned_clauses_(0) {
   // TODO(user): Extract to a function used by all solvers.
   // Compute trivial unscaled lower bound.
   const LinearObjective& objective = problem.objective();
@@ -116,6 +118,28 @@ bool ProblemState::MergeLearnedInfo(
     }
   }
 
+  // The new learned clauses do not count as an update, see learned_clauses().
+  const int max_num_learned_clauses =
+      parameters_.max_num_shared_learned_clauses();
+  if (max_num_learned_clauses > 0) {
+    const sat::VariableIndex num_vars(original_problem_.num_variables());
+    for (const LearnedClause& clause : learned_info.learned_clauses) {
+      bool ignored = false;
+      for (const sat::Literal literal : clause.literals) {
+        if (literal.Variable() >= num_vars) {
+          ignored = true;
+          break;
+        }
+      }
+      if (ignored) continue;
+      while (learned_clauses_.size() >= max_num_learned_clauses) {
+        learned_clauses_.pop_front();
+      }
+      learned_clauses_.push_back(clause);
+      ++num_merged_learned_clauses_;
+    }
+  }
+
   bool new_solution = false;
   if (learned_info.solution.IsFeasible() &&
       (!solution_.IsFeasible() ||
@@ -14,7 +14,9 @@
 #ifndef OR_TOOLS_BOP_BOP_BASE_H_
 #define OR_TOOLS_BOP_BOP_BASE_H_
 
+#include <deque>
 #include <string>
+#include <vector>
 
 #include "base/basictypes.h"
 #include "bop/bop_parameters.pb.h"
@@ -105,6 +107,17 @@ inline std::ostream& operator<<(std::ostream& os,
   return os;
 }
 
+// A short clause learned by a SAT based optimizer, with its LBD. Such clauses
+// are implied by the problem and the objective constraint of
+// LoadStateProblemToSatSolver(), so they remain valid for all the later
+// problem states. The optimizer that learned the clause is kept so that it
+// does not import it back.
+struct LearnedClause {
+  std::vector<sat::Literal> literals;
+  int lbd;
+  const BopOptimizerBase* source;
+};
+
 // This class represents the current state of the problem with all the
 // information that the solver learned about it at a given time.
 class ProblemState {
@@ -214,6 +227,21 @@ class ProblemState {
   // once all the optimize have been synchronized.
   void SynchronizationDone();
 
+  // Returns the pool of short learned clauses shared between the SAT based
+  // optimizers. Only the last max_num_shared_learned_clauses merged clauses
+  // are kept. The clause number i (counting all the clauses ever merged, see
+  // num_merged_learned_clauses()) is at index
+  // i - (num_merged_learned_clauses() - learned_clauses().size()), if it is
+  // still in the pool. Note that merging new learned clauses does not change
+  // the update stamp: the optimizers import them at their next
+  // synchronization.
+  const std::deque<LearnedClause>& learned_clauses() const {
+    return learned_clauses_;
+  }
+  int64 num_merged_learned_clauses() const {
+    return num_merged_learned_clauses_;
+  }
+
  private:
   const LinearBooleanProblem& original_problem_;
   BopParameters parameters_;
@@ -230,6 +258,10 @@ class ProblemState {
   // Manage the set of the problem binary clauses (including the learned ones).
   sat::BinaryClauseManager binary_clause_manager_;
 
+  // See learned_clauses().
+  std::deque<LearnedClause> learned_clauses_;
+  int64 num_merged_learned_clauses_;
+
   DISALLOW_COPY_AND_ASSIGN(ProblemState);
 };
 
@@ -243,7 +275,8 @@ struct LearnedInfo {
         solution(problem, "AllZero"),
         lower_bound(kint64min),
         lp_values(),
-        binary_clauses() {}
+        binary_clauses(),
+        learned_clauses() {}
 
   // Clears all just as if the object were a brand new one. This can be used
   // to reduce the number of creation / deletion of objects.
@@ -252,6 +285,7 @@ struct LearnedInfo {
     lower_bound = kint64min;
     lp_values.clear();
     binary_clauses.clear();
+    learned_clauses.clear();
   }
 
   // Vector of all literals that have been fixed.
@@ -271,6 +305,10 @@ struct LearnedInfo {
 
   // New binary clauses.
   std::vector<sat::BinaryClause> binary_clauses;
+
+  // New short learned clauses with more than two literals, see
+  // ProblemState::learned_clauses().
+  std::vector<LearnedClause> learned_clauses;
 };
 
 }  // namespace bop
@@ -81,7 +81,8 @@ GuidedSatFirstSolutionGenerator::GuidedSatFirstSolutionGenerator(
       policy_(policy),
       abort_(false),
       state_update_stamp_(ProblemState::kInitialStampValue),
-      sat_solver_() {}
+      sat_solver_(),
+      num_imported_learned_clauses_(0) {}
 
 GuidedSatFirstSolutionGenerator::~GuidedSatFirstSolutionGenerator() {}
 
@@ -98,6 +99,9 @@ BopOptimizerBase::Status GuidedSatFirstSolutionGenerator::SynchronizeIfNeeded(
   const BopOptimizerBase::Status load_status =
       LoadStateProblemToSatSolver(problem_state, sat_solver_.get());
   if (load_status != BopOptimizerBase::CONTINUE) return load_status;
+  const BopOptimizerBase::Status import_status = ImportSharedLearnedClauses(
+      problem_state, this, &num_imported_learned_clauses_, sat_solver_.get());
+  if (import_status != BopOptimizerBase::CONTINUE) return import_status;
 
   switch (policy_) {
     case Policy::kNotGuided:
@@ -164,7 +168,10 @@ BopOptimizerBase::Status GuidedSatFirstSolutionGenerator::Optimize(
   sat_solver_->SetParameters(sat_params);
 
   const double initial_deterministic_time = sat_solver_->deterministic_time();
+  StartExportingLearnedClauses(parameters, this, sat_solver_.get(),
+                               learned_info);
   const sat::SatSolver::Status sat_status = sat_solver_->Solve();
+  StopExportingLearnedClauses(sat_solver_.get());
   time_limit->AdvanceDeterministicTime(sat_solver_->deterministic_time() -
                                        initial_deterministic_time);
 
@@ -505,12 +512,18 @@ double LinearRelaxation::ComputeLowerBoundUsingStrongBranching(
   const double tolerance =
       lp_solver_.GetParameters().primal_feasibility_tolerance();
   double best_lp_objective = lp_solver_.GetObjectiveValue();
+
+  // Each candidate variable is evaluated at true then at false. All the
+  // evaluations are done in one batch on the current lp_model_, so contrary to
+  // a sequential strong branching, the variables fixed below are not used to
+  // evaluate the other variables. The deduced bounds are still valid.
+  std::vector<glop::ColIndex> cols;
+  std::vector<glop::BranchingCandidate> candidates;
   for (glop::ColIndex col(0); col < initial_lp_values.size(); ++col) {
     // TODO(user): Order the variables by some meaningful quantity (probably
     //              the cost variation when we snap it to one of its bound) so
     //              we can try the one that seems the most promising first.
     //              That way we can stop the strong branching earlier.
-    if (time_limit->LimitReached()) break;
 
     // Skip fixed variables.
     if (lp_model_.variable_lower_bounds()[col] ==
@@ -533,27 +546,37 @@ double LinearRelaxation::ComputeLowerBoundUsingStrongBranching(
          initial_lp_values[col] + tolerance > 1)) {
       continue;
     }
+    cols.push_back(col);
+    candidates.push_back(glop::BranchingCandidate(col, 1.0, 1.0));
+    candidates.push_back(glop::BranchingCandidate(col, 0.0, 0.0));
+  }
 
+  const GlopParameters initial_glop_params = lp_solver_.GetParameters();
+  GlopParameters glop_params = initial_glop_params;
+  glop_params.set_num_omp_threads(
+      parameters_.lp_strong_branching_num_threads());
+  lp_solver_.SetParameters(glop_params);
+  std::vector<glop::BranchingResult> results;
+  lp_solver_.SolveBranchings(lp_model_, candidates, time_limit, &results);
+  lp_solver_.SetParameters(initial_glop_params);
+
+  for (int i = 0; i < cols.size(); ++i) {
+    const glop::ColIndex col = cols[i];
+    const glop::BranchingResult& result_true = results[2 * i];
+    const glop::BranchingResult& result_false = results[2 * i + 1];
     double objective_true = best_lp_objective;
     double objective_false = best_lp_objective;
 
-    // Set to true.
-    lp_model_.SetVariableBounds(col, 1.0, 1.0);
-    const glop::ProblemStatus status_true = Solve(true, time_limit);
     // TODO(user): Deal with PRIMAL_INFEASIBLE, DUAL_INFEASIBLE and
     //              INFEASIBLE_OR_UNBOUNDED statuses. In all cases, if the
     //              original lp was feasible, this means that the variable can
     //              be fixed to the other bound.
-    if (status_true == glop::ProblemStatus::OPTIMAL ||
-        status_true == glop::ProblemStatus::DUAL_FEASIBLE) {
-      objective_true = lp_solver_.GetObjectiveValue();
-
-      // Set to false.
-      lp_model_.SetVariableBounds(col, 0.0, 0.0);
-      const glop::ProblemStatus status_false = Solve(true, time_limit);
-      if (status_false == glop::ProblemStatus::OPTIMAL ||
-          status_false == glop::ProblemStatus::DUAL_FEASIBLE) {
-        objective_false = lp_solver_.GetObjectiveValue();
+    if (result_true.status == glop::ProblemStatus::OPTIMAL ||
+        result_true.status == glop::ProblemStatus::DUAL_FEASIBLE) {
+      objective_true = result_true.objective_value;
+      if (result_false.status == glop::ProblemStatus::OPTIMAL ||
+          result_false.status == glop::ProblemStatus::DUAL_FEASIBLE) {
+        objective_false = result_false.objective_value;
 
         // Compute the new min.
         best_lp_objective =
@@ -575,9 +598,6 @@ double LinearRelaxation::ComputeLowerBoundUsingStrongBranching(
       lp_model_.SetVariableBounds(col, 1.0, 1.0);
       learned_info->fixed_literals.push_back(
           sat::Literal(sat::VariableIndex(col.value()), true));
-    } else {
-      // Unset. This is safe to use 0.0 and 1.0 as the variable is not fixed.
-      lp_model_.SetVariableBounds(col, 0.0, 1.0);
     }
   }
   return best_lp_objective;
@@ -67,6 +67,7 @@ class GuidedSatFirstSolutionGenerator : public BopOptimizerBase {
   bool abort_;
   int64 state_update_stamp_;
   std::unique_ptr<sat::SatSolver> sat_solver_;
+  int64 num_imported_learned_clauses_;
 };
 
 
@@ -60,7 +60,8 @@ BopCompleteLNSOptimizer::BopCompleteLNSOptimizer(
     const std::string& name, const BopConstraintTerms& objective_terms)
     : BopOptimizerBase(name),
       state_update_stamp_(ProblemState::kInitialStampValue),
-      objective_terms_(objective_terms) {}
+      objective_terms_(objective_terms),
+      num_imported_learned_clauses_(0) {}
 
 BopCompleteLNSOptimizer::~BopCompleteLNSOptimizer() {}
 
@@ -76,6 +77,10 @@ BopOptimizerBase::Status BopCompleteLNSOptimizer::SynchronizeIfNeeded(
   const BopOptimizerBase::Status status =
       LoadStateProblemToSatSolver(problem_state, sat_solver_.get());
   if (status != BopOptimizerBase::CONTINUE) return status;
+  num_imported_learned_clauses_ = 0;
+  const BopOptimizerBase::Status import_status = ImportSharedLearnedClauses(
+      problem_state, this, &num_imported_learned_clauses_, sat_solver_.get());
+  if (import_status != BopOptimizerBase::CONTINUE) return import_status;
 
   // Add the constraint that forces the solver to look for a solution
   // at a distance <= num_relaxed_vars from the curent one. Note that not all
@@ -164,31 +169,60 @@ BopOptimizerBase::Status BopCompleteLNSOptimizer::Optimize(
 // BopAdaptiveLNSOptimizer
 //------------------------------------------------------------------------------
 
-namespace {
-// Returns false if the limit is reached while solving the LP.
-bool UseLinearRelaxationForSatAssignmentPreference(
+// Note(user): We prefer to start with a really low difficulty as this works
+// better for large problem, and for small ones, it will be really quickly
+// increased anyway. Maybe a better appproach is to start by relaxing something
+// like 10 variables instead of having a fixed percentage.
+BopAdaptiveLNSOptimizer::BopAdaptiveLNSOptimizer(
+    const std::string& name, bool use_lp_to_guide_sat,
+    NeighborhoodGenerator* neighborhood_generator,
+    sat::SatSolver* sat_propagator)
+    : BopOptimizerBase(name),
+      use_lp_to_guide_sat_(use_lp_to_guide_sat),
+      neighborhood_generator_(neighborhood_generator),
+      sat_propagator_(sat_propagator),
+      adaptive_difficulty_(0.001) {
+  CHECK(sat_propagator != nullptr);
+}
+
+BopAdaptiveLNSOptimizer::~BopAdaptiveLNSOptimizer() {}
+
+bool BopAdaptiveLNSOptimizer::UseLinearRelaxationForSatAssignmentPreference(
     const BopParameters& parameters, const LinearBooleanProblem& problem,
     sat::SatSolver* sat_solver, TimeLimit* time_limit) {
-  // TODO(user): Re-use the lp_model and lp_solver or build a model with only
-  //              needed constraints and variables.
-  glop::LinearProgram lp_model;
-  sat::ConvertBooleanProblemToLinearProgram(problem, &lp_model);
+  // The LP model and solver are kept from one neighborhood to the next, and
+  // only the bounds of the variables fixed by the previous neighborhood and by
+  // this one change. Because the matrix and the objective are unchanged, the
+  // dual simplex restarts from the previous basis.
+  if (lp_model_.num_variables() == 0) {
+    sat::ConvertBooleanProblemToLinearProgram(problem, &lp_model_);
+    GlopParameters glop_params;
+    glop_params.set_use_dual_simplex(true);
+    glop_params.set_allow_simplex_algorithm_change(true);
+    glop_params.set_use_preprocessing(false);
+    lp_solver_.SetParameters(glop_params);
+  }
+  for (const ColIndex col : lp_fixed_columns_) {
+    lp_model_.SetVariableBounds(col, 0.0, 1.0);
+  }
+  lp_fixed_columns_.clear();
 
   // Set bounds of variables fixed by the sat_solver.
   const sat::Trail& propagation_trail = sat_solver->LiteralTrail();
   for (int trail_index = 0; trail_index < propagation_trail.Index();
        ++trail_index) {
     const sat::Literal fixed_literal = propagation_trail[trail_index];
+    const ColIndex col(fixed_literal.Variable().value());
+    if (col >= lp_model_.num_variables()) continue;
     const glop::Fractional value = fixed_literal.IsPositive() ? 1.0 : 0.0;
-    lp_model.SetVariableBounds(ColIndex(fixed_literal.Variable().value()),
-                               value, value);
+    lp_model_.SetVariableBounds(col, value, value);
+    lp_fixed_columns_.push_back(col);
   }
 
-  glop::LPSolver lp_solver;
   NestedTimeLimit nested_time_limit(time_limit, time_limit->GetTimeLeft(),
                                     parameters.lp_max_deterministic_time());
-  const glop::ProblemStatus lp_status =
-      lp_solver.SolveWithTimeLimit(lp_model, nested_time_limit.GetTimeLimit());
+  const glop::ProblemStatus lp_status = lp_solver_.SolveWithTimeLimit(
+      lp_model_, nested_time_limit.GetTimeLimit());
 
   if (lp_status != glop::ProblemStatus::OPTIMAL &&
       lp_status != glop::ProblemStatus::PRIMAL_FEASIBLE &&
@@ -198,33 +232,14 @@ bool UseLinearRelaxationForSatAssignmentPreference(
   }
 
   // Set preferences based on the solution of the relaxation.
-  for (ColIndex col(0); col < lp_solver.variable_values().size(); ++col) {
-    const double value = lp_solver.variable_values()[col];
+  for (ColIndex col(0); col < lp_solver_.variable_values().size(); ++col) {
+    const double value = lp_solver_.variable_values()[col];
     sat_solver->SetAssignmentPreference(
         sat::Literal(sat::VariableIndex(col.value()), round(value) == 1),
         1 - fabs(value - round(value)));
   }
   return true;
 }
-}  // namespace
-
-// Note(user): We prefer to start with a really low difficulty as this works
-// better for large problem, and for small ones, it will be really quickly
-// increased anyway. Maybe a better appproach is to start by relaxing something
-// like 10 variables instead of having a fixed percentage.
-BopAdaptiveLNSOptimizer::BopAdaptiveLNSOptimizer(
-    const std::string& name, bool use_lp_to_guide_sat,
-    NeighborhoodGenerator* neighborhood_generator,
-    sat::SatSolver* sat_propagator)
-    : BopOptimizerBase(name),
-      use_lp_to_guide_sat_(use_lp_to_guide_sat),
-      neighborhood_generator_(neighborhood_generator),
-      sat_propagator_(sat_propagator),
-      adaptive_difficulty_(0.001) {
-  CHECK(sat_propagator != nullptr);
-}
-
-BopAdaptiveLNSOptimizer::~BopAdaptiveLNSOptimizer() {}
 
 bool BopAdaptiveLNSOptimizer::ShouldBeRun(
     const ProblemState& problem_state) const {
@@ -57,6 +57,10 @@ class BopCompleteLNSOptimizer : public BopOptimizerBase {
   int64 state_update_stamp_;
   std::unique_ptr<sat::SatSolver> sat_solver_;
   const BopConstraintTerms& objective_terms_;
+
+  // Because of the LNS constraint, the clauses learned by this optimizer are
+  // not exported, it only imports the ones of the other optimizers.
+  int64 num_imported_learned_clauses_;
 };
 
 // Interface of the different LNS neighborhood generation algorithm.
@@ -113,10 +117,24 @@ class BopAdaptiveLNSOptimizer : public BopOptimizerBase {
                   const ProblemState& problem_state, LearnedInfo* learned_info,
                   TimeLimit* time_limit) final;
 
+  // Solves the linear relaxation of the given problem with the variables fixed
+  // by the given solver, and uses its solution as the solver assignment
+  // preference. Returns false if no useful LP solution was found, for instance
+  // if the limit is reached while solving the LP.
+  bool UseLinearRelaxationForSatAssignmentPreference(
+      const BopParameters& parameters, const LinearBooleanProblem& problem,
+      sat::SatSolver* sat_solver, TimeLimit* time_limit);
+
   const bool use_lp_to_guide_sat_;
   std::unique_ptr<NeighborhoodGenerator> neighborhood_generator_;
   sat::SatSolver* const sat_propagator_;
 
+  // The linear relaxation used when use_lp_to_guide_sat_ is true, and its
+  // columns fixed by the last neighborhood.
+  glop::LinearProgram lp_model_;
+  glop::LPSolver lp_solver_;
+  std::vector<glop::ColIndex> lp_fixed_columns_;
+
   // Adaptive neighborhood size logic.
   // The values are kept from one run to the next.
   LubyAdaptiveParameterValue adaptive_difficulty_;
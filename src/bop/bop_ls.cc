@@ -13,6 +13,9 @@
 
 #include "bop/bop_ls.h"
 
+#include <algorithm>
+
+#include "base/random.h"
 #include "bop/bop_util.h"
 #include "sat/boolean_problem.h"
 
@@ -23,13 +26,15 @@ namespace bop {
 // LocalSearchOptimizer
 //------------------------------------------------------------------------------
 
-LocalSearchOptimizer::LocalSearchOptimizer(const std::string& name,
-                                           int max_num_decisions,
-                                           sat::SatSolver* sat_propagator)
+LocalSearchOptimizer::LocalSearchOptimizer(
+    const std::string& name, int max_num_decisions,
+    sat::SatSolver* sat_propagator,
+    LocalSearchTranspositionTable* transposition_table)
     : BopOptimizerBase(name),
       state_update_stamp_(ProblemState::kInitialStampValue),
       max_num_decisions_(max_num_decisions),
       sat_wrapper_(sat_propagator),
+      transposition_table_(transposition_table),
       assignment_iterator_() {}
 
 LocalSearchOptimizer::~LocalSearchOptimizer() {}
@@ -49,7 +54,8 @@ BopOptimizerBase::Status LocalSearchOptimizer::Optimize(
   if (assignment_iterator_ == nullptr) {
     assignment_iterator_.reset(new LocalSearchAssignmentIterator(
         problem_state, max_num_decisions_,
-        parameters.max_num_broken_constraints_in_ls(), &sat_wrapper_));
+        parameters.max_num_broken_constraints_in_ls(), &sat_wrapper_,
+        transposition_table_));
   }
 
   if (state_update_stamp_ != problem_state.update_stamp()) {
@@ -104,6 +110,78 @@ BopOptimizerBase::Status LocalSearchOptimizer::Optimize(
   return BopOptimizerBase::ABORT;
 }
 
+//------------------------------------------------------------------------------
+// LocalSearchTranspositionTable
+//------------------------------------------------------------------------------
+
+LocalSearchTranspositionTable::LocalSearchTranspositionTable(
+    int num_variables, int log2_num_entries, int seed)
+    : literal_keys_(2 * num_variables),
+      buckets_(std::max(1, (1 << std::min(30, std::max(0, log2_num_entries))) /
+                               kBucketSize)),
+      bucket_mask_(buckets_.size() - 1),
+      generation_(0) {
+  MTRandom random(seed);
+  for (uint64& key : literal_keys_) {
+    key = static_cast<uint64>(random.Next64());
+  }
+  for (Bucket& bucket : buckets_) {
+    for (Entry& entry : bucket.entries) {
+      entry.hash = 0;
+      entry.generation = 0;
+      entry.num_remaining_decisions = -1;
+    }
+  }
+}
+
+uint64 LocalSearchTranspositionTable::SolutionKey(
+    const BopSolution& solution) const {
+  uint64 key = 0;
+  for (VariableIndex var(0); var < solution.Size(); ++var) {
+    key ^= LiteralKey(
+        sat::Literal(sat::VariableIndex(var.value()), solution.Value(var)));
+  }
+  return key;
+}
+
+bool LocalSearchTranspositionTable::Contains(
+    uint64 hash, int num_remaining_decisions) const {
+  for (const Entry& entry : BucketOf(hash).entries) {
+    if (entry.hash == hash &&
+        entry.num_remaining_decisions >= num_remaining_decisions) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void LocalSearchTranspositionTable::Insert(uint64 hash,
+                                           int num_remaining_decisions) {
+  Bucket* const bucket = &buckets_[hash & bucket_mask_];
+  Entry* to_replace = &bucket->entries[0];
+  for (Entry& entry : bucket->entries) {
+    if (entry.num_remaining_decisions >= 0 && entry.hash == hash) {
+      entry.generation = generation_;
+      entry.num_remaining_decisions =
+          std::max(entry.num_remaining_decisions, num_remaining_decisions);
+      return;
+    }
+
+    // Empty entries first, then the oldest ones, then the shallowest ones.
+    if (to_replace->num_remaining_decisions < 0) continue;
+    if (entry.num_remaining_decisions < 0 ||
+        entry.generation < to_replace->generation ||
+        (entry.generation == to_replace->generation &&
+         entry.num_remaining_decisions <
+             to_replace->num_remaining_decisions)) {
+      to_replace = &entry;
+    }
+  }
+  to_replace->hash = hash;
+  to_replace->generation = generation_;
+  to_replace->num_remaining_decisions = num_remaining_decisions;
+}
+
 //------------------------------------------------------------------------------
 // BacktrackableIntegerSet
 //------------------------------------------------------------------------------
@@ -405,6 +483,34 @@ OneFlipConstraintRepairer::OneFlipConstraintRepairer(
   }
 
   SortTermsOfEachConstraints(problem.num_variables());
+
+  min_abs_weights_.assign(by_constraint_matrix_.size(), kint64max);
+  max_abs_weights_.assign(by_constraint_matrix_.size(), 0);
+  for (ConstraintIndex ct(0); ct < by_constraint_matrix_.size(); ++ct) {
+    for (const ConstraintTerm& term : by_constraint_matrix_[ct]) {
+      const int64 abs_weight = std::abs(term.weight);
+      min_abs_weights_[ct] = std::min(min_abs_weights_[ct], abs_weight);
+      max_abs_weights_[ct] = std::max(max_abs_weights_[ct], abs_weight);
+    }
+  }
+}
+
+bool OneFlipConstraintRepairer::MayBeRepairedInOneFlip(
+    ConstraintIndex ct_index) const {
+  const int64 value = maintainer_.ConstraintValue(ct_index);
+  const int64 lb = maintainer_.ConstraintLowerBound(ct_index);
+  const int64 ub = maintainer_.ConstraintUpperBound(ct_index);
+  if (value > ub) {
+    // The value must decrease by at least value - ub and at most value - lb.
+    return value - ub <= max_abs_weights_[ct_index] &&
+           (lb == kint64min || value - lb >= min_abs_weights_[ct_index]);
+  }
+  if (value < lb) {
+    // The value must increase by at least lb - value and at most ub - value.
+    return lb - value <= max_abs_weights_[ct_index] &&
+           (ub == kint64max || ub - value >= min_abs_weights_[ct_index]);
+  }
+  return true;
 }
 
 const ConstraintIndex OneFlipConstraintRepairer::kInvalidConstraint(-1);
@@ -434,6 +540,9 @@ ConstraintIndex OneFlipConstraintRepairer::ConstraintToRepair() const {
       return i;
     }
 
+    // The constraint can't be repaired in one decision.
+    if (!MayBeRepairedInOneFlip(i)) continue;
+
     const int64 constraint_value = maintainer_.ConstraintValue(i);
     const int64 lb = maintainer_.ConstraintLowerBound(i);
     const int64 ub = maintainer_.ConstraintUpperBound(i);
@@ -467,6 +576,7 @@ ConstraintIndex OneFlipConstraintRepairer::ConstraintToRepair() const {
 TermIndex OneFlipConstraintRepairer::NextRepairingTerm(
     ConstraintIndex ct_index, TermIndex init_term_index,
     TermIndex start_term_index) const {
+  if (!MayBeRepairedInOneFlip(ct_index)) return kInvalidTerm;
   const ITIVector<TermIndex, ConstraintTerm>& terms =
       by_constraint_matrix_[ct_index];
   const int64 constraint_value = maintainer_.ConstraintValue(ct_index);
@@ -597,7 +707,8 @@ double SatWrapper::deterministic_time() const {
 
 LocalSearchAssignmentIterator::LocalSearchAssignmentIterator(
     const ProblemState& problem_state, int max_num_decisions,
-    int max_num_broken_constraints, SatWrapper* sat_wrapper)
+    int max_num_broken_constraints, SatWrapper* sat_wrapper,
+    LocalSearchTranspositionTable* transposition_table)
     : max_num_decisions_(max_num_decisions),
       max_num_broken_constraints_(max_num_broken_constraints),
       maintainer_(problem_state.original_problem()),
@@ -609,6 +720,9 @@ LocalSearchAssignmentIterator::LocalSearchAssignmentIterator(
           problem_state.original_problem().constraints_size() + 1,
           OneFlipConstraintRepairer::kInitTerm),
       use_transposition_table_(false),
+      transposition_table_(transposition_table),
+      reference_hash_(0),
+      num_stored_nodes_(0),
       num_nodes_(0),
       num_skipped_nodes_(0) {}
 
@@ -620,7 +734,7 @@ void LocalSearchAssignmentIterator::Synchronize(
     initial_term_index_[node.constraint] = node.term_index;
   }
   search_nodes_.clear();
-  transposition_table_.clear();
+  NewReferenceSolution();
   num_nodes_ = 0;
   num_skipped_nodes_ = 0;
 }
@@ -663,7 +777,7 @@ bool LocalSearchAssignmentIterator::NextAssignment() {
       initial_term_index_[node.constraint] = node.term_index;
     }
     search_nodes_.clear();
-    transposition_table_.clear();
+    NewReferenceSolution();
     num_nodes_ = 0;
     num_skipped_nodes_ = 0;
     return true;
@@ -680,7 +794,7 @@ bool LocalSearchAssignmentIterator::NextAssignment() {
   if (search_nodes_.empty()) {
     VLOG(1) << std::string(25, ' ') + "LS finished."
             << " #explored:" << num_nodes_
-            << " #stored:" << transposition_table_.size()
+            << " #stored:" << num_stored_nodes_
             << " #skipped:" << num_skipped_nodes_;
     return false;
   }
@@ -731,51 +845,39 @@ void LocalSearchAssignmentIterator::ApplyDecision(sat::Literal literal) {
   }
 }
 
-void LocalSearchAssignmentIterator::InitializeTranspositionTableKey(
-    std::array<int32, kStoredMaxDecisions>* a) {
-  int i = 0;
+void LocalSearchAssignmentIterator::NewReferenceSolution() {
+  if (transposition_table_ == nullptr) return;
+  reference_hash_ = transposition_table_->SolutionKey(maintainer_.reference());
+  transposition_table_->NewSearch();
+}
+
+uint64 LocalSearchAssignmentIterator::CurrentStateHash() const {
+  uint64 hash = reference_hash_;
   for (const SearchNode& n : search_nodes_) {
     // Negated because we already fliped this variable, so GetFlip() will
     // returns the old value.
-    (*a)[i] = -repairer_.GetFlip(n.constraint, n.term_index).SignedValue();
-    ++i;
-  }
-
-  // 'a' is not zero-initialized, so we need to complete it with zeros.
-  while (i < kStoredMaxDecisions) {
-    (*a)[i] = 0;
-    ++i;
+    hash ^= transposition_table_->LiteralKey(
+        repairer_.GetFlip(n.constraint, n.term_index).Negated());
   }
+  return hash;
 }
 
 bool LocalSearchAssignmentIterator::NewStateIsInTranspositionTable(
     sat::Literal l) {
-  if (search_nodes_.size() + 1 > kStoredMaxDecisions) return false;
-
-  // Fill the transposition table element, i.e the array 'a' of decisions.
-  std::array<int32, kStoredMaxDecisions> a;
-  InitializeTranspositionTableKey(&a);
-  a[search_nodes_.size()] = l.SignedValue();
-  std::sort(a.begin(), a.begin() + 1 + search_nodes_.size());
-
-  if (transposition_table_.find(a) == transposition_table_.end()) {
+  const uint64 hash = CurrentStateHash() ^ transposition_table_->LiteralKey(l);
+  const int num_remaining_decisions =
+      max_num_decisions_ - search_nodes_.size() - 1;
+  if (!transposition_table_->Contains(hash, num_remaining_decisions)) {
     return false;
-  } else {
-    ++num_skipped_nodes_;
-    return true;
   }
+  ++num_skipped_nodes_;
+  return true;
 }
 
 void LocalSearchAssignmentIterator::InsertInTranspositionTable() {
-  // If there is more decision that kStoredMaxDecisions, do nothing.
-  if (search_nodes_.size() > kStoredMaxDecisions) return;
-
-  // Fill the transposition table element, i.e the array 'a' of decisions.
-  std::array<int32, kStoredMaxDecisions> a;
-  InitializeTranspositionTableKey(&a);
-  std::sort(a.begin(), a.begin() + search_nodes_.size());
-
-  transposition_table_.insert(a);
+  ++num_stored_nodes_;
+  transposition_table_->Insert(CurrentStateHash(),
+                               max_num_decisions_ - search_nodes_.size());
 }
 
 bool LocalSearchAssignmentIterator::EnqueueNextRepairingTermIfAny(
@@ -27,8 +27,7 @@
 #ifndef OR_TOOLS_BOP_BOP_LS_H_
 #define OR_TOOLS_BOP_BOP_LS_H_
 
-#include <array>
-#include "base/hash.h"
+#include <vector>
 
 #include "base/hash.h"
 #include "bop/bop_base.h"
@@ -40,6 +39,8 @@
 namespace operations_research {
 namespace bop {
 
+class LocalSearchTranspositionTable;
+
 // This class is used to ease the connection with the SAT solver.
 //
 // TODO(user): remove? the meat of the logic is used in just one place, so I am
@@ -110,8 +111,11 @@ class LocalSearchAssignmentIterator;
 // in the new solution can be greater than max_num_decisions.
 class LocalSearchOptimizer : public BopOptimizerBase {
  public:
+  // The transposition table, if not null, is not owned and may be shared
+  // with other LocalSearchOptimizer of the same problem.
   LocalSearchOptimizer(const std::string& name, int max_num_decisions,
-                       sat::SatSolver* sat_propagator);
+                       sat::SatSolver* sat_propagator,
+                       LocalSearchTranspositionTable* transposition_table);
   ~LocalSearchOptimizer() override;
 
  private:
@@ -130,6 +134,8 @@ class LocalSearchOptimizer : public BopOptimizerBase {
   // A wrapper around the given sat_propagator.
   SatWrapper sat_wrapper_;
 
+  LocalSearchTranspositionTable* const transposition_table_;
+
   // Iterator on all reachable assignments.
   // Note that this iterator is only reset when Synchronize() is called, i.e.
   // the iterator continues its iteration of the next assignments each time
@@ -413,14 +419,90 @@ class OneFlipConstraintRepairer {
   // on most promising variables first.
   void SortTermsOfEachConstraints(int num_variables);
 
+  // Returns false if the given infeasible constraint can't be repaired by any
+  // single flip. This only uses the current constraint value, that the
+  // maintainer updates incrementally, and the range of the absolute weights of
+  // the constraint terms, so it runs in O(1) instead of scanning the terms:
+  // the distance to each bound gives the range of the weight that a repairing
+  // term must have.
+  bool MayBeRepairedInOneFlip(ConstraintIndex constraint) const;
+
   ITIVector<ConstraintIndex, ITIVector<TermIndex, ConstraintTerm> >
       by_constraint_matrix_;
+
+  // The minimum and maximum absolute weight of the terms of each constraint.
+  ITIVector<ConstraintIndex, int64> min_abs_weights_;
+  ITIVector<ConstraintIndex, int64> max_abs_weights_;
   const AssignmentAndConstraintFeasibilityMaintainer& maintainer_;
   const sat::VariablesAssignment& sat_assignment_;
 
   DISALLOW_COPY_AND_ASSIGN(OneFlipConstraintRepairer);
 };
 
+// A fixed-size table of the local search states already explored. A state is a
+// reference solution plus a set of decisions (the flipped literals), and is
+// identified by its Zobrist hash: the xor of a random 64-bit key for each
+// literal of the reference solution and for each decision. The hash thus does
+// not depend on the order of the decisions, so we don't explore decisions
+// (a, b) and later (b, a) for instance.
+//
+// The table is shared by the local search optimizers of a portfolio: a state
+// fully explored by one of them is skipped by the others as long as they can't
+// take more decisions below it. The entries are grouped by buckets of the size
+// of a cache line. When a bucket is full, the entries of the oldest searches
+// (see NewSearch()) are replaced first, then the ones with the smallest number
+// of remaining decisions. Note that a hash collision can make the local search
+// skip a state that was never explored.
+class LocalSearchTranspositionTable {
+ public:
+  // The table holds 2^log2_num_entries entries. The keys are drawn from a
+  // generator seeded with the given seed.
+  LocalSearchTranspositionTable(int num_variables, int log2_num_entries,
+                                int seed);
+
+  // Returns the key of the given literal. The hash of a state is the xor of the
+  // SolutionKey() of its reference and of the LiteralKey() of its decisions.
+  uint64 LiteralKey(sat::Literal literal) const {
+    return literal_keys_[literal.Index().value()];
+  }
+  uint64 SolutionKey(const BopSolution& solution) const;
+
+  // Starts a new generation of entries. This is called each time an iterator
+  // starts from a new reference solution.
+  void NewSearch() { ++generation_; }
+
+  // Returns true if the state with the given hash was fully explored with at
+  // least the given number of remaining decisions.
+  bool Contains(uint64 hash, int num_remaining_decisions) const;
+
+  // Records that the state with the given hash was fully explored with the
+  // given number of remaining decisions.
+  void Insert(uint64 hash, int num_remaining_decisions);
+
+ private:
+  struct Entry {
+    uint64 hash;
+    uint32 generation;
+    // Negative for an empty entry.
+    int32 num_remaining_decisions;
+  };
+  static const int kBucketSize = 4;
+  struct Bucket {
+    Entry entries[kBucketSize];
+  };
+
+  const Bucket& BucketOf(uint64 hash) const {
+    return buckets_[hash & bucket_mask_];
+  }
+
+  std::vector<uint64> literal_keys_;
+  std::vector<Bucket> buckets_;
+  const uint64 bucket_mask_;
+  uint32 generation_;
+
+  DISALLOW_COPY_AND_ASSIGN(LocalSearchTranspositionTable);
+};
+
 // This class is used to iterate on all assignments that can be obtained by
 // deliberately flipping 'n' variables from the reference solution, 'n' being
 // smaller than or equal to max_num_decisions.
@@ -428,13 +510,16 @@ class OneFlipConstraintRepairer {
 // constraint propagation, those additional flips are not counted in 'n'.
 class LocalSearchAssignmentIterator {
  public:
-  LocalSearchAssignmentIterator(const ProblemState& problem_state,
-                                int max_num_decisions,
-                                int max_num_broken_constraints,
-                                SatWrapper* sat_wrapper);
-
-  // Sets whether or not a transposition table is used.
-  void UseTranspositionTable(bool v) { use_transposition_table_ = v; }
+  // The transposition table is not owned and can be null.
+  LocalSearchAssignmentIterator(
+      const ProblemState& problem_state, int max_num_decisions,
+      int max_num_broken_constraints, SatWrapper* sat_wrapper,
+      LocalSearchTranspositionTable* transposition_table);
+
+  // Sets whether or not the transposition table is used.
+  void UseTranspositionTable(bool v) {
+    use_transposition_table_ = v && transposition_table_ != nullptr;
+  }
 
   // Synchronizes the iterator with the problem state, e.g. set fixed variables,
   // set the reference solution. Call this only when a new solution has been
@@ -468,9 +553,6 @@ class LocalSearchAssignmentIterator {
   std::string DebugString() const;
 
  private:
-  // See transposition_table_ below.
-  static const size_t kStoredMaxDecisions = 4;
-
   // Internal structure used to represent a node of the search tree during local
   // search.
   struct SearchNode {
@@ -499,10 +581,12 @@ class LocalSearchAssignmentIterator {
   // Inserts the current set of decisions in transposition_table_.
   void InsertInTranspositionTable();
 
-  // Initializes the given array with the current decisions in search_nodes_ and
-  // by filling the other positions with 0.
-  void InitializeTranspositionTableKey(
-      std::array<int32, kStoredMaxDecisions>* a);
+  // Returns the hash of the current reference solution and decisions in
+  // search_nodes_.
+  uint64 CurrentStateHash() const;
+
+  // Updates reference_hash_ and starts a new search in transposition_table_.
+  void NewReferenceSolution();
 
   // Looks for the next repairing term in the given constraints while skipping
   // the position already present in transposition_table_. A given TermIndex of
@@ -522,26 +606,17 @@ class LocalSearchAssignmentIterator {
   // Temporary vector used by ApplyDecision().
   std::vector<sat::Literal> tmp_propagated_literals_;
 
-  // For each set of explored decisions, we store it in this table so that we
-  // don't explore decisions (a, b) and later (b, a) for instance. The decisions
-  // are converted to int32, sorted and padded with 0 before beeing inserted
-  // here.
+  // Each fully explored set of decisions is stored in this table so that it is
+  // not explored again, see LocalSearchTranspositionTable.
   //
   // TODO(user): We may still miss some equivalent states because it is possible
   // that completely differents decisions lead to exactly the same state.
   // However this is more time consuming to detect because we must apply the
   // last decision first before trying to compare the states.
-  //
-  // TODO(user): Currently, we only store kStoredMaxDecisions or less decisions.
-  // Ideally, this should be related to the maximum number of decision in the
-  // LS, but that requires templating the whole LS optimizer.
   bool use_transposition_table_;
-#if defined(_MSC_VER)
-  hash_set<std::array<int32, kStoredMaxDecisions>,
-           StdArrayHasher<int32, kStoredMaxDecisions>> transposition_table_;
-#else
-  hash_set<std::array<int32, kStoredMaxDecisions>> transposition_table_;
-#endif
+  LocalSearchTranspositionTable* const transposition_table_;
+  uint64 reference_hash_;
+  int64 num_stored_nodes_;
 
   // The number of explored nodes.
   int64 num_nodes_;
@@ -13,6 +13,9 @@
 
 #include "bop/bop_portfolio.h"
 
+#include <cmath>
+#include <limits>
+
 #include "base/stl_util.h"
 #include "bop/bop_fs.h"
 #include "bop/bop_lns.h"
@@ -147,9 +150,16 @@ BopOptimizerBase::Status PortfolioOptimizer::Optimize(
               << ". Time limit: " << time_limit->GetTimeLeft() << " -- "
               << time_limit->GetDeterministicTimeLeft();
   }
-  const BopOptimizerBase::Status optimization_status =
-      selected_optimizer->Optimize(parameters, problem_state, learned_info,
-                                   time_limit);
+  BopOptimizerBase::Status optimization_status;
+  {
+    // Note that the nested time limit updates the deterministic time of the
+    // given one when it goes out of scope.
+    NestedTimeLimit nested_time_limit(time_limit, time_limit->GetTimeLeft(),
+                                      selector_->DeterministicTimeBudget());
+    optimization_status = selected_optimizer->Optimize(
+        parameters, problem_state, learned_info,
+        nested_time_limit.GetTimeLimit());
+  }
 
   // ABORT means that this optimizer can't be run until we found a new solution.
   if (optimization_status == BopOptimizerBase::ABORT) {
@@ -209,9 +219,16 @@ void PortfolioOptimizer::AddOptimizer(
           new LinearRelaxation(parameters, "LinearRelaxation"));
       break;
     case BopOptimizerMethod::LOCAL_SEARCH: {
+      if (ls_transposition_table_ == nullptr) {
+        ls_transposition_table_.reset(new LocalSearchTranspositionTable(
+            problem.num_variables(),
+            parameters.ls_transposition_table_size_log2(),
+            parameters.random_seed()));
+      }
       for (int i = 1; i <= parameters.max_num_decisions_in_ls(); ++i) {
-        optimizers_.push_back(new LocalSearchOptimizer(StringPrintf("LS_%d", i),
-                                                       i, &sat_propagator_));
+        optimizers_.push_back(new LocalSearchOptimizer(
+            StringPrintf("LS_%d", i), i, &sat_propagator_,
+            ls_transposition_table_.get()));
       }
     } break;
     case BopOptimizerMethod::RANDOM_FIRST_SOLUTION:
@@ -300,7 +317,11 @@ void PortfolioOptimizer::CreateOptimizers(
   if (parameters.use_symmetry()) {
     VLOG(1) << "Finding symmetries of the problem.";
     std::vector<std::unique_ptr<SparsePermutation>> generators;
-    sat::FindLinearBooleanProblemSymmetries(problem, &generators);
+    sat::FindLinearBooleanProblemSymmetries(
+        problem,
+        std::min(parameters.max_time_in_seconds(),
+                 parameters.max_time_in_seconds_for_symmetry_detection()),
+        &generators);
     std::unique_ptr<sat::SymmetryPropagator> propagator(
         new sat::SymmetryPropagator);
     for (int i = 0; i < generators.size(); ++i) {
@@ -317,15 +338,18 @@ void PortfolioOptimizer::CreateOptimizers(
     AddOptimizer(problem, parameters, optimizer_method);
   }
 
-  selector_.reset(new OptimizerSelector(optimizers_));
+  selector_.reset(new OptimizerSelector(optimizers_, parameters));
 }
 
 //------------------------------------------------------------------------------
 // OptimizerSelector
 //------------------------------------------------------------------------------
 OptimizerSelector::OptimizerSelector(
-    const ITIVector<OptimizerIndex, BopOptimizerBase*>& optimizers)
-    : run_infos_(), selected_index_(optimizers.size()) {
+    const ITIVector<OptimizerIndex, BopOptimizerBase*>& optimizers,
+    const BopParameters& parameters)
+    : parameters_(parameters),
+      run_infos_(),
+      selected_index_(optimizers.size()) {
   for (OptimizerIndex i(0); i < optimizers.size(); ++i) {
     info_positions_.push_back(run_infos_.size());
     run_infos_.push_back(RunInfo(i, optimizers[i]->name()));
@@ -333,6 +357,9 @@ OptimizerSelector::OptimizerSelector(
 }
 
 OptimizerIndex OptimizerSelector::SelectOptimizer() {
+  if (parameters_.use_ucb_optimizer_selection()) {
+    return SelectOptimizerWithUcb();
+  }
   CHECK_GE(selected_index_, 0);
 
   do {
@@ -377,6 +404,64 @@ OptimizerIndex OptimizerSelector::SelectOptimizer() {
   return run_infos_[selected_index_].optimizer_index;
 }
 
+OptimizerIndex OptimizerSelector::SelectOptimizerWithUcb() {
+  int total_num_calls = 0;
+  for (const RunInfo& info : run_infos_) {
+    if (info.RunnableAndSelectable()) total_num_calls += info.num_calls;
+  }
+  const double max_rate = MaxGainRate();
+  const double log_num_calls = log(std::max(1, total_num_calls));
+
+  // We compare the optimizers by (not stalled, UCB value).
+  int best_index = -1;
+  bool best_is_stalled = true;
+  double best_value = -std::numeric_limits<double>::infinity();
+  for (int i = 0; i < run_infos_.size(); ++i) {
+    const RunInfo& info = run_infos_[i];
+    if (!info.RunnableAndSelectable()) continue;
+    const bool is_stalled = IsStalled(info);
+    if (is_stalled && !best_is_stalled) continue;
+    const double value =
+        info.num_calls == 0
+            ? std::numeric_limits<double>::infinity()
+            : (max_rate > 0.0 ? info.GainRate() / max_rate : 0.0) +
+                  parameters_.ucb_exploration_coefficient() *
+                      sqrt(log_num_calls / info.num_calls);
+    if (best_index == -1 || (best_is_stalled && !is_stalled) ||
+        value > best_value) {
+      best_index = i;
+      best_is_stalled = is_stalled;
+      best_value = value;
+    }
+  }
+  if (best_index == -1) return kInvalidOptimizerIndex;
+
+  selected_index_ = best_index;
+  ++run_infos_[selected_index_].num_calls;
+  return run_infos_[selected_index_].optimizer_index;
+}
+
+double OptimizerSelector::DeterministicTimeBudget() const {
+  if (!parameters_.use_ucb_optimizer_selection()) {
+    return std::numeric_limits<double>::infinity();
+  }
+  const double slice = parameters_.optimizer_deterministic_time_slice();
+  const RunInfo& info = run_infos_[selected_index_];
+  if (IsStalled(info)) return slice;
+  const double max_rate = MaxGainRate();
+  return max_rate > 0.0 ? slice * (1.0 + info.GainRate() / max_rate) : slice;
+}
+
+double OptimizerSelector::MaxGainRate() const {
+  double max_rate = 0.0;
+  for (const RunInfo& info : run_infos_) {
+    if (info.RunnableAndSelectable()) {
+      max_rate = std::max(max_rate, info.GainRate());
+    }
+  }
+  return max_rate;
+}
+
 void OptimizerSelector::UpdateScore(int64 gain, double time_spent) {
   const bool new_solution_found = gain != 0;
   if (new_solution_found) NewSolutionFound(gain);
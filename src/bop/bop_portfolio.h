@@ -16,6 +16,7 @@
 
 #include "bop/bop_base.h"
 #include "bop/bop_lns.h"
+#include "bop/bop_ls.h"
 #include "bop/bop_parameters.pb.h"
 #include "bop/bop_solution.h"
 #include "bop/bop_types.h"
@@ -88,6 +89,9 @@ class PortfolioOptimizer : public BopOptimizerBase {
   std::unique_ptr<OptimizerSelector> selector_;
   ITIVector<OptimizerIndex, BopOptimizerBase*> optimizers_;
   sat::SatSolver sat_propagator_;
+
+  // Shared by all the LocalSearchOptimizer, created with the first one.
+  std::unique_ptr<LocalSearchTranspositionTable> ls_transposition_table_;
   BopParameters parameters_;
   double lower_bound_;
   double upper_bound_;
@@ -100,8 +104,9 @@ class OptimizerSelector {
  public:
   // Note that the list of optimizers is only used to get the names for
   // debug purposes, the ownership of the optimizers is not transfered.
-  explicit OptimizerSelector(
-      const ITIVector<OptimizerIndex, BopOptimizerBase*>& optimizers);
+  OptimizerSelector(
+      const ITIVector<OptimizerIndex, BopOptimizerBase*>& optimizers,
+      const BopParameters& parameters);
 
   // Selects the next optimizer to run based on the user defined order and
   // history of success. Returns kInvalidOptimizerIndex if no optimizer is
@@ -117,8 +122,20 @@ class OptimizerSelector {
   //      since last solution is smaller than the deterministic time spent
   //      by any runnable optimizer in 1..l since last solution.
   //      If no such optimizer is available, go to option a.
+  //
+  // When use_ucb_optimizer_selection is true, the optimizers that were never
+  // called are selected first, then the one maximizing its UCB1 value
+  //   rate / max_rate + c * sqrt(log(total_num_calls) / num_calls)
+  // where rate is the total gain of the optimizer per deterministic time unit
+  // and c is the ucb_exploration_coefficient. The stalled optimizers are only
+  // considered when all the others are stalled.
   OptimizerIndex SelectOptimizer();
 
+  // Returns the deterministic time the last selected optimizer should be given
+  // (see the use_ucb_optimizer_selection parameter). This is infinity when the
+  // UCB selection is not used.
+  double DeterministicTimeBudget() const;
+
   // Updates the internal metrics to decide which optimizer to select.
   // This method should be called each time the selected optimizer is run.
   //
@@ -165,6 +182,9 @@ class OptimizerSelector {
   // Sorts optimizers based on their scores.
   void UpdateOrder();
 
+  // The UCB based selection, see SelectOptimizer().
+  OptimizerIndex SelectOptimizerWithUcb();
+
   struct RunInfo {
     RunInfo(OptimizerIndex i, const std::string& n)
         : optimizer_index(i),
@@ -180,6 +200,11 @@ class OptimizerSelector {
 
     bool RunnableAndSelectable() const { return runnable && selectable; }
 
+    // Total gain per deterministic time unit.
+    double GainRate() const {
+      return time_spent > 0.0 ? total_gain / time_spent : 0.0;
+    }
+
     OptimizerIndex optimizer_index;
     std::string name;
     int num_successes;
@@ -192,6 +217,17 @@ class OptimizerSelector {
     double score;
   };
 
+  // Returns true if the optimizer spent too much time since the last solution.
+  bool IsStalled(const RunInfo& info) const {
+    return info.time_spent_since_last_solution >
+           parameters_.optimizer_stall_num_slices() *
+               parameters_.optimizer_deterministic_time_slice();
+  }
+
+  // Returns the maximum GainRate() of the runnable and selectable optimizers.
+  double MaxGainRate() const;
+
+  const BopParameters parameters_;
   std::vector<RunInfo> run_infos_;
   ITIVector<OptimizerIndex, int> info_positions_;
   int selected_index_;
@@ -13,13 +13,17 @@
 
 #include "bop/bop_solver.h"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
+#include "base/callback.h"
 #include "base/commandlineflags.h"
+#include "base/mutex.h"
 #include "base/stringprintf.h"
 #include "google/protobuf/text_format.h"
 #include "base/stl_util.h"
+#include "base/threadpool.h"
 #include "bop/bop_fs.h"
 #include "bop/bop_lns.h"
 #include "bop/bop_ls.h"
@@ -129,9 +133,240 @@ BopSolveStatus BopSolver::InternalMonothreadSolver() {
              : BopSolveStatus::NO_SOLUTION_FOUND;
 }
 
+//------------------------------------------------------------------------------
+// SolverSynchronizer
+//------------------------------------------------------------------------------
+// The solvers work in rounds, one round being one optimizer run. At the end of
+// each round, a solver merges what it learned into the shared problem state,
+// and then:
+//  - NO_SYNCHRONIZATION: it continues right away without importing anything.
+//  - SYNCHRONIZE_ALL: it waits until all the running solvers have completed
+//    the same number of rounds, and imports the shared state as it was when
+//    the last of them completed its round.
+//  - SYNCHRONIZE_ON_RIGHT: the solver i waits until the running solvers
+//    0..i-1 have completed at least the same number of rounds, and imports
+//    what they learned so far (including what they imported from their own
+//    left solvers).
+// A solver that stops is not waited for anymore.
+class SolverSynchronizer {
+ public:
+  SolverSynchronizer(const LinearBooleanProblem& problem,
+                     const BopParameters& parameters, int num_solvers,
+                     ProblemState* shared_state)
+      : type_(parameters.synchronization_type()),
+        num_solvers_(num_solvers),
+        time_limit_(parameters.max_time_in_seconds(),
+                    parameters.max_deterministic_time()),
+        shared_state_(shared_state),
+        stop_(false),
+        num_rounds_(num_solvers, 0),
+        is_finished_(num_solvers, false),
+        num_complete_rounds_(0),
+        round_info_(problem),
+        num_imported_binary_clauses_(num_solvers,
+                                     std::vector<int>(num_solvers + 1, 0)) {
+    if (type_ == BopParameters::SYNCHRONIZE_ON_RIGHT) {
+      for (int i = 0; i < num_solvers; ++i) {
+        solver_states_.emplace_back(new ProblemState(problem));
+        solver_states_.back()->SetParameters(parameters);
+      }
+    }
+  }
+
+  // Returns the time limit shared by the solvers. It is cancelled once the
+  // shared state is optimal or infeasible.
+  ParallelTimeLimit* time_limit() { return &time_limit_; }
+
+  // Imports the shared state, as it is before the search, into the problem
+  // state of the solver 'index'.
+  void Start(int index, ProblemState* problem_state) {
+    MutexLock lock(&mutex_);
+    problem_state->set_assignment_preference(
+        shared_state_->assignment_preference());
+    if (type_ == BopParameters::SYNCHRONIZE_ON_RIGHT) {
+      solver_states_[index]->set_assignment_preference(
+          shared_state_->assignment_preference());
+    }
+    Import(index, shared_state_->GetLearnedInfo(), problem_state);
+  }
+
+  // Ends a round of the solver 'index' with the information it learned during
+  // this round. Returns false if the solver should stop, otherwise
+  // problem_state contains what it should import from the other solvers.
+  bool EndRound(int index, const LearnedInfo& learned_info,
+                BopOptimizerBase::Status optimization_status,
+                ProblemState* problem_state) {
+    MutexLock lock(&mutex_);
+    shared_state_->MergeLearnedInfo(learned_info, optimization_status);
+    if (optimization_status == BopOptimizerBase::SOLUTION_FOUND) {
+      VLOG(1) << shared_state_->solution().GetScaledCost()
+              << "  New solution from solver " << index;
+    }
+    if (shared_state_->IsOptimal() || shared_state_->IsInfeasible()) {
+      stop_ = true;
+      time_limit_.Cancel();
+      condition_.SignalAll();
+      return false;
+    }
+    const int round = ++num_rounds_[index];
+    switch (type_) {
+      case BopParameters::NO_SYNCHRONIZATION:
+        break;
+      case BopParameters::SYNCHRONIZE_ALL:
+        UpdateCompleteRounds();
+        while (!stop_ && num_complete_rounds_ < round) condition_.Wait(&mutex_);
+        if (stop_) return false;
+        Import(index, round_info_, problem_state);
+        break;
+      case BopParameters::SYNCHRONIZE_ON_RIGHT:
+        solver_states_[index]->MergeLearnedInfo(learned_info,
+                                                optimization_status);
+        condition_.SignalAll();
+        while (!stop_ && !LeftSolversCompleted(index, round)) {
+          condition_.Wait(&mutex_);
+        }
+        if (stop_) return false;
+        for (int i = 0; i < index; ++i) {
+          LearnedInfo info = solver_states_[i]->GetLearnedInfo();
+          RemoveImportedBinaryClauses(index, i, &info);
+          solver_states_[index]->MergeLearnedInfo(info,
+                                                  BopOptimizerBase::CONTINUE);
+          problem_state->MergeLearnedInfo(info, BopOptimizerBase::CONTINUE);
+        }
+        break;
+    }
+    return true;
+  }
+
+  // Must be called when the solver 'index' stops, so that the other solvers
+  // do not wait for it anymore.
+  void Finish(int index) {
+    MutexLock lock(&mutex_);
+    is_finished_[index] = true;
+    if (type_ == BopParameters::SYNCHRONIZE_ALL) UpdateCompleteRounds();
+    condition_.SignalAll();
+  }
+
+ private:
+  // The binary clauses of a problem state are never cleared. This removes
+  // from the given info, coming from the solver 'source' (or from the shared
+  // state if source is num_solvers_), the clauses already imported by the
+  // solver 'index'.
+  void RemoveImportedBinaryClauses(int index, int source, LearnedInfo* info) {
+    int* const num_imported = &num_imported_binary_clauses_[index][source];
+    const int num_binary_clauses = info->binary_clauses.size();
+    info->binary_clauses.erase(info->binary_clauses.begin(),
+                               info->binary_clauses.begin() + *num_imported);
+    *num_imported = num_binary_clauses;
+  }
+
+  // Merges the given info from the shared state into the given problem state.
+  void Import(int index, LearnedInfo info, ProblemState* problem_state) {
+    RemoveImportedBinaryClauses(index, num_solvers_, &info);
+    problem_state->MergeLearnedInfo(info, BopOptimizerBase::CONTINUE);
+  }
+
+  // Used by SYNCHRONIZE_ALL to detect that the last running solver completed
+  // its round, in which case round_info_ is updated.
+  void UpdateCompleteRounds() {
+    int min_rounds = kint32max;
+    for (int i = 0; i < num_solvers_; ++i) {
+      if (!is_finished_[i]) min_rounds = std::min(min_rounds, num_rounds_[i]);
+    }
+    if (min_rounds == kint32max || min_rounds <= num_complete_rounds_) return;
+    num_complete_rounds_ = min_rounds;
+    round_info_ = shared_state_->GetLearnedInfo();
+    condition_.SignalAll();
+  }
+
+  bool LeftSolversCompleted(int index, int round) const {
+    for (int i = 0; i < index; ++i) {
+      if (!is_finished_[i] && num_rounds_[i] < round) return false;
+    }
+    return true;
+  }
+
+  const BopParameters::ThreadSynchronizationType type_;
+  const int num_solvers_;
+  ParallelTimeLimit time_limit_;
+  Mutex mutex_;
+  CondVar condition_;
+  ProblemState* const shared_state_;
+  bool stop_;
+
+  std::vector<int> num_rounds_;
+  std::vector<bool> is_finished_;
+
+  // SYNCHRONIZE_ALL: the number of rounds completed by all the running
+  // solvers, and the shared state at the end of the last one.
+  int num_complete_rounds_;
+  LearnedInfo round_info_;
+
+  // SYNCHRONIZE_ON_RIGHT: everything each solver learned or imported so far.
+  std::vector<std::unique_ptr<ProblemState>> solver_states_;
+
+  // num_imported_binary_clauses_[i][j] is the number of binary clauses of the
+  // solver j (or of the shared state for j == num_solvers_) already imported
+  // by the solver i.
+  std::vector<std::vector<int>> num_imported_binary_clauses_;
+
+  DISALLOW_COPY_AND_ASSIGN(SolverSynchronizer);
+};
+
 BopSolveStatus BopSolver::InternalMultithreadSolver() {
-  // Not implemented.
-  return BopSolveStatus::INVALID_PROBLEM;
+  const int num_solvers = parameters_.number_of_solvers();
+  SolverSynchronizer synchronizer(problem_, parameters_, num_solvers,
+                                  &problem_state_);
+  {
+    ThreadPool pool("BopSolver", num_solvers);
+    pool.StartWorkers();
+    for (int i = 0; i < num_solvers; ++i) {
+      pool.Add(NewCallback(this, &BopSolver::RunSolverThread, i,
+                           &synchronizer));
+    }
+  }
+
+  if (problem_state_.IsOptimal()) {
+    CHECK(problem_state_.solution().IsFeasible());
+    return BopSolveStatus::OPTIMAL_SOLUTION_FOUND;
+  } else if (problem_state_.IsInfeasible()) {
+    return BopSolveStatus::INFEASIBLE_PROBLEM;
+  }
+  return problem_state_.solution().IsFeasible()
+             ? BopSolveStatus::FEASIBLE_SOLUTION_FOUND
+             : BopSolveStatus::NO_SOLUTION_FOUND;
+}
+
+void BopSolver::RunSolverThread(int index, SolverSynchronizer* synchronizer) {
+  BopParameters parameters = parameters_;
+  parameters.set_random_seed(parameters_.random_seed() + index);
+  ProblemState problem_state(problem_);
+  problem_state.SetParameters(parameters);
+  synchronizer->Start(index, &problem_state);
+
+  std::unique_ptr<TimeLimit> time_limit =
+      synchronizer->time_limit()->NewWorkerTimeLimit();
+  time_limit->RegisterExternalBooleanAsLimit(external_boolean_as_limit_);
+  const int set_index =
+      std::min(index, parameters.solver_optimizer_sets_size() - 1);
+  PortfolioOptimizer optimizer(problem_state, parameters,
+                               parameters.solver_optimizer_sets(set_index),
+                               StringPrintf("Portfolio_%d", index));
+  LearnedInfo learned_info(problem_state.original_problem());
+  while (!time_limit->LimitReached()) {
+    const BopOptimizerBase::Status optimization_status = optimizer.Optimize(
+        parameters, problem_state, &learned_info, time_limit.get());
+    problem_state.MergeLearnedInfo(learned_info, optimization_status);
+    if (!synchronizer->EndRound(index, learned_info, optimization_status,
+                                &problem_state)) {
+      break;
+    }
+    if (optimization_status == BopOptimizerBase::ABORT) {
+      break;
+    }
+    learned_info.Clear();
+  }
+  synchronizer->Finish(index);
 }
 
 BopSolveStatus BopSolver::Solve(const BopSolution& first_solution) {
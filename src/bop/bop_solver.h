@@ -43,6 +43,7 @@
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/macros.h"
+#include "base/mutex.h"
 #include "base/int_type_indexed_vector.h"
 #include "base/int_type.h"
 #include "bop/bop_base.h"
@@ -57,6 +58,10 @@
 
 namespace operations_research {
 namespace bop {
+// Implements the BopParameters::ThreadSynchronizationType between the solvers
+// of BopSolver::InternalMultithreadSolver(). Defined in bop_solver.cc.
+class SolverSynchronizer;
+
 // Solver of Boolean Optimization Problems based on Local Search.
 class BopSolver {
  public:
@@ -93,6 +98,12 @@ class BopSolver {
   BopSolveStatus InternalMonothreadSolver();
   BopSolveStatus InternalMultithreadSolver();
 
+  // Runs the solver number 'index' of InternalMultithreadSolver() with its own
+  // problem state. After each optimizer run, what it learned is merged into
+  // problem_state_ and what the other solvers learned is imported according to
+  // the synchronization type, both through the given synchronizer.
+  void RunSolverThread(int index, SolverSynchronizer* synchronizer);
+
   const LinearBooleanProblem& problem_;
   ProblemState problem_state_;
   BopParameters parameters_;
@@ -13,6 +13,8 @@
 
 #include "bop/bop_util.h"
 
+#include <algorithm>
+#include <deque>
 #include <vector>
 
 #include "base/basictypes.h"
@@ -118,6 +120,64 @@ void ExtractLearnedInfoFromSatSolver(sat::SatSolver* solver,
   solver->ClearNewlyAddedBinaryClauses();
 }
 
+void StartExportingLearnedClauses(const BopParameters& parameters,
+                                  const BopOptimizerBase* optimizer,
+                                  sat::SatSolver* solver, LearnedInfo* info) {
+  CHECK(nullptr != solver);
+  CHECK(nullptr != info);
+  if (parameters.max_num_shared_learned_clauses() == 0) return;
+  const int max_size = parameters.max_shared_learned_clause_size();
+  const int max_lbd = parameters.max_shared_learned_clause_lbd();
+
+  // The units and the binary clauses are already exported by
+  // ExtractLearnedInfoFromSatSolver().
+  solver->SetLearnedClauseCallback(
+      [optimizer, info, max_size, max_lbd](
+          const std::vector<sat::Literal>& clause, int lbd) {
+        if (clause.size() <= 2 || clause.size() > max_size || lbd > max_lbd) {
+          return;
+        }
+        info->learned_clauses.push_back(LearnedClause());
+        LearnedClause* const learned_clause = &info->learned_clauses.back();
+        learned_clause->literals = clause;
+        learned_clause->lbd = lbd;
+        learned_clause->source = optimizer;
+      });
+}
+
+void StopExportingLearnedClauses(sat::SatSolver* solver) {
+  CHECK(nullptr != solver);
+  solver->SetLearnedClauseCallback(nullptr);
+}
+
+BopOptimizerBase::Status ImportSharedLearnedClauses(
+    const ProblemState& problem_state, const BopOptimizerBase* optimizer,
+    int64* num_imported_clauses, sat::SatSolver* sat_solver) {
+  CHECK(nullptr != num_imported_clauses);
+  CHECK(nullptr != sat_solver);
+  const std::deque<LearnedClause>& clauses = problem_state.learned_clauses();
+  const int64 num_merged = problem_state.num_merged_learned_clauses();
+
+  // The clauses that were removed from the pool before we could import them
+  // are skipped.
+  const int64 first_in_pool = num_merged - clauses.size();
+  int64 i = std::max(*num_imported_clauses, first_in_pool);
+  *num_imported_clauses = num_merged;
+  if (i == num_merged) return BopOptimizerBase::CONTINUE;
+
+  sat_solver->Backtrack(0);
+  for (; i < num_merged; ++i) {
+    const LearnedClause& clause = clauses[i - first_in_pool];
+    if (clause.source == optimizer) continue;
+    if (!sat_solver->AddImportedClause(clause.literals, clause.lbd)) {
+      return problem_state.solution().IsFeasible()
+                 ? BopOptimizerBase::OPTIMAL_SOLUTION_FOUND
+                 : BopOptimizerBase::INFEASIBLE;
+    }
+  }
+  return BopOptimizerBase::CONTINUE;
+}
+
 void SatAssignmentToBopSolution(const sat::VariablesAssignment& assignment,
                                 BopSolution* solution) {
   CHECK(solution != nullptr);
@@ -43,6 +43,26 @@ BopOptimizerBase::Status LoadStateProblemToSatSolver(
 // "new".
 void ExtractLearnedInfoFromSatSolver(sat::SatSolver* solver, LearnedInfo* info);
 
+// Makes the sat solver of the given optimizer append to info->learned_clauses
+// its learned clauses that are short enough to be shared according to the
+// parameters, until StopExportingLearnedClauses() is called. This must only be
+// used on solvers that contain the problem as loaded by
+// LoadStateProblemToSatSolver() and nothing else that is not implied by it,
+// since these clauses are then used by other optimizers.
+void StartExportingLearnedClauses(const BopParameters& parameters,
+                                  const BopOptimizerBase* optimizer,
+                                  sat::SatSolver* solver, LearnedInfo* info);
+void StopExportingLearnedClauses(sat::SatSolver* solver);
+
+// Adds to the sat solver of the given optimizer the clauses of
+// problem_state.learned_clauses() that were merged since
+// *num_imported_clauses and that were not exported by this optimizer, and
+// updates the counter. It must be zero for a solver that did not import
+// anything yet. Returns the same statuses as LoadStateProblemToSatSolver().
+BopOptimizerBase::Status ImportSharedLearnedClauses(
+    const ProblemState& problem_state, const BopOptimizerBase* optimizer,
+    int64* num_imported_clauses, sat::SatSolver* sat_solver);
+
 void SatAssignmentToBopSolution(const sat::VariablesAssignment& assignment,
                                 BopSolution* solution);
 
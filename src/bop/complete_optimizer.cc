@@ -13,6 +13,7 @@
 
 #include "bop/complete_optimizer.h"
 
+#include "base/cleanup.h"
 #include "bop/bop_util.h"
 #include "sat/boolean_problem.h"
 #include "sat/optimization.h"
@@ -24,7 +25,8 @@ SatCoreBasedOptimizer::SatCoreBasedOptimizer(const std::string& name)
     : BopOptimizerBase(name),
       state_update_stamp_(ProblemState::kInitialStampValue),
       initialized_(false),
-      assumptions_already_added_(false) {
+      assumptions_already_added_(false),
+      num_imported_learned_clauses_(0) {
   // This is in term of number of variables not at their minimal value.
   lower_bound_ = sat::Coefficient(0);
   upper_bound_ = sat::kCoefficientMax;
@@ -44,6 +46,9 @@ BopOptimizerBase::Status SatCoreBasedOptimizer::SynchronizeIfNeeded(
   const BopOptimizerBase::Status status =
       LoadStateProblemToSatSolver(problem_state, &solver_);
   if (status != BopOptimizerBase::CONTINUE) return status;
+  const BopOptimizerBase::Status import_status = ImportSharedLearnedClauses(
+      problem_state, this, &num_imported_learned_clauses_, &solver_);
+  if (import_status != BopOptimizerBase::CONTINUE) return import_status;
 
   if (!initialized_) {
     // Initialize the algorithm.
@@ -122,6 +127,12 @@ BopOptimizerBase::Status SatCoreBasedOptimizer::Optimize(
     return sync_status;
   }
 
+  // Note that the clauses learned on the encoding variables are filtered out
+  // by ProblemState::MergeLearnedInfo().
+  StartExportingLearnedClauses(parameters, this, &solver_, learned_info);
+  auto stop_exporting = ::operations_research::util::MakeCleanup(
+      [this]() { StopExportingLearnedClauses(&solver_); });
+
   int64 conflict_limit = parameters.max_number_of_conflicts_in_random_lns();
   double deterministic_time_at_last_sync = solver_.deterministic_time();
   while (!time_limit->LimitReached()) {
@@ -60,6 +60,7 @@ class SatCoreBasedOptimizer : public BopOptimizerBase {
   bool initialized_;
   bool assumptions_already_added_;
   sat::SatSolver solver_;
+  int64 num_imported_learned_clauses_;
   sat::Coefficient offset_;
   sat::Coefficient lower_bound_;
   sat::Coefficient upper_bound_;
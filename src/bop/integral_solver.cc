@@ -14,7 +14,13 @@
 #include "bop/integral_solver.h"
 
 #include <math.h>
+#include <algorithm>
 #include <vector>
+
+#include "base/callback.h"
+#include "base/mutex.h"
+#include "base/threadpool.h"
+#include "base/timer.h"
 #include "bop/bop_solver.h"
 #include "lp_data/lp_decomposer.h"
 
@@ -986,45 +992,138 @@ BopSolveStatus InternalSolve(const LinearProgram& linear_problem,
   return status;
 }
 
-void RunOneBop(const BopParameters& parameters, int problem_index,
-               const DenseRow& initial_solution,
-               bool* external_boolean_as_limit, LPDecomposer* decomposer,
-               DenseRow* variable_values, Fractional* objective_value,
-               Fractional* best_bound, BopSolveStatus* status) {
-  CHECK(decomposer != nullptr);
-  CHECK(variable_values != nullptr);
-  CHECK(objective_value != nullptr);
-  CHECK(best_bound != nullptr);
-  CHECK(status != nullptr);
+// Solves the independent sub-problems of a decomposition on a pool of
+// num_bop_solvers_used_by_decomposition threads, the largest ones first. Each
+// sub-problem gets a share of the time still available that is proportional to
+// its number of variables, so the time not used by the sub-problems that
+// finish early goes to the ones started after them. As soon as a sub-problem
+// is proved infeasible, the others are interrupted.
+//
+// TODO(user): Investigate a better approximation of the time needed to
+//              solve the problem than just the number of variables.
+class DecomposedProblemSolver {
+ public:
+  DecomposedProblemSolver(const BopParameters& parameters,
+                          const DenseRow& initial_solution,
+                          bool* external_boolean_as_limit,
+                          LPDecomposer* decomposer)
+      : parameters_(parameters),
+        initial_solution_(initial_solution),
+        external_boolean_as_limit_(external_boolean_as_limit),
+        decomposer_(decomposer),
+        num_sub_problems_(decomposer->GetNumberOfProblems()),
+        num_threads_(std::max(
+            1, std::min(parameters.num_bop_solvers_used_by_decomposition(),
+                        num_sub_problems_))),
+        total_num_variables_(std::max(
+            1.0, static_cast<double>(
+                     decomposer->original_problem().num_variables().value()))),
+        remaining_num_variables_(0.0),
+        variable_values_(num_sub_problems_),
+        objective_values_(num_sub_problems_, Fractional(0.0)),
+        best_bounds_(num_sub_problems_, Fractional(0.0)),
+        statuses_(num_sub_problems_, BopSolveStatus::INVALID_PROBLEM) {}
+
+  void Solve() {
+    std::vector<int> order(num_sub_problems_);
+    for (int i = 0; i < num_sub_problems_; ++i) {
+      order[i] = i;
+      remaining_num_variables_ +=
+          std::max(1, decomposer_->GetNumberOfVariables(i));
+    }
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+      return decomposer_->GetNumberOfVariables(a) >
+             decomposer_->GetNumberOfVariables(b);
+    });
+    timer_.Start();
+    ThreadPool pool("DecomposedBop", num_threads_);
+    pool.StartWorkers();
+    for (const int problem_index : order) {
+      pool.Add(NewCallback(this, &DecomposedProblemSolver::RunOneBop,
+                           problem_index));
+    }
+  }
+
+  const std::vector<DenseRow>& variable_values() const {
+    return variable_values_;
+  }
+  const std::vector<Fractional>& objective_values() const {
+    return objective_values_;
+  }
+  const std::vector<Fractional>& best_bounds() const { return best_bounds_; }
+  const std::vector<BopSolveStatus>& statuses() const { return statuses_; }
+
+ private:
+  void RunOneBop(int problem_index);
+
+  const BopParameters& parameters_;
+  const DenseRow& initial_solution_;
+  bool* const external_boolean_as_limit_;
+  LPDecomposer* const decomposer_;
+  const int num_sub_problems_;
+  const int num_threads_;
+  const double total_num_variables_;
+
+  Mutex mutex_;
+  WallTimer timer_;
+  // Number of variables of the sub-problems not started yet.
+  double remaining_num_variables_;
+
+  // Results of each sub-problem. Each thread only writes the entries of the
+  // sub-problem it solves.
+  std::vector<DenseRow> variable_values_;
+  std::vector<Fractional> objective_values_;
+  std::vector<Fractional> best_bounds_;
+  std::vector<BopSolveStatus> statuses_;
+
+  DISALLOW_COPY_AND_ASSIGN(DecomposedProblemSolver);
+};
+
+void DecomposedProblemSolver::RunOneBop(int problem_index) {
+  const double local_num_variables =
+      std::max(1, decomposer_->GetNumberOfVariables(problem_index));
+  BopParameters local_parameters = parameters_;
+  {
+    MutexLock lock(&mutex_);
+    if (*external_boolean_as_limit_) {
+      statuses_[problem_index] = BopSolveStatus::NO_SOLUTION_FOUND;
+      return;
+    }
+
+    // With one thread and no sub-problem finishing early, this is the same as
+    // max_time_in_seconds * local_num_variables / total_num_variables_.
+    const double remaining_time =
+        std::max(0.0, parameters_.max_time_in_seconds() - timer_.Get());
+    const double time_share = remaining_time * num_threads_ *
+                              local_num_variables / remaining_num_variables_;
+    remaining_num_variables_ -= local_num_variables;
+    local_parameters.set_max_time_in_seconds(std::max(
+        std::min(time_share, remaining_time),
+        parameters_.decomposed_problem_min_time_in_seconds()));
+  }
+  local_parameters.set_max_deterministic_time(
+      parameters_.max_deterministic_time() * local_num_variables /
+      total_num_variables_);
 
   LinearProgram problem;
-  decomposer->ExtractLocalProblem(problem_index, &problem);
+  decomposer_->ExtractLocalProblem(problem_index, &problem);
   DenseRow local_initial_solution;
-  if (initial_solution.size() > 0) {
+  if (initial_solution_.size() > 0) {
     local_initial_solution =
-        decomposer->ExtractLocalAssignment(problem_index, initial_solution);
+        decomposer_->ExtractLocalAssignment(problem_index, initial_solution_);
+  }
+  const BopSolveStatus status = InternalSolve(
+      problem, local_parameters, local_initial_solution,
+      external_boolean_as_limit_, &variable_values_[problem_index],
+      &objective_values_[problem_index], &best_bounds_[problem_index]);
+
+  MutexLock lock(&mutex_);
+  statuses_[problem_index] = status;
+  if (status == BopSolveStatus::INFEASIBLE_PROBLEM ||
+      status == BopSolveStatus::INVALID_PROBLEM) {
+    // The whole problem has no solution, there is no need to continue.
+    *external_boolean_as_limit_ = true;
   }
-  // TODO(user): Investigate a better approximation of the time needed to
-  //              solve the problem than just the number of variables.
-  const double total_num_variables =
-      std::max(1.0, static_cast<double>(
-                   decomposer->original_problem().num_variables().value()));
-  const double time_per_variable =
-      parameters.max_time_in_seconds() / total_num_variables;
-  const double deterministic_time_per_variable =
-      parameters.max_deterministic_time() / total_num_variables;
-  const int local_num_variables = std::max(1, problem.num_variables().value());
-
-  BopParameters local_parameters = parameters;
-  local_parameters.set_max_time_in_seconds(
-      std::max(time_per_variable * local_num_variables,
-               parameters.decomposed_problem_min_time_in_seconds()));
-  local_parameters.set_max_deterministic_time(deterministic_time_per_variable *
-                                              local_num_variables);
-
-  *status = InternalSolve(problem, local_parameters, local_initial_solution,
-                          external_boolean_as_limit, variable_values,
-                          objective_value, best_bound);
 }
 }  // anonymous namespace
 
@@ -1064,36 +1163,34 @@ BopSolveStatus IntegralSolver::Solve(
     if (num_sub_problems > 1) {
       // The problem can be decomposed. Solve each sub-problem and aggregate the
       // result.
-      std::vector<DenseRow> variable_values(num_sub_problems);
-      std::vector<Fractional> objective_values(num_sub_problems, Fractional(0.0));
-      std::vector<Fractional> best_bounds(num_sub_problems, Fractional(0.0));
-      std::vector<BopSolveStatus> statuses(num_sub_problems,
-                                      BopSolveStatus::INVALID_PROBLEM);
-
-        for (int i = 0; i < num_sub_problems; ++i) {
-          RunOneBop(parameters_, i, initial_solution, &interrupt_solve_,
-                    &decomposer, &(variable_values[i]), &(objective_values[i]),
-                    &(best_bounds[i]), &(statuses[i]));
+      DecomposedProblemSolver decomposed_solver(
+          parameters_, initial_solution, &interrupt_solve_, &decomposer);
+      decomposed_solver.Solve();
+      const std::vector<BopSolveStatus>& statuses =
+          decomposed_solver.statuses();
+
+      // Aggregate results. An invalid or infeasible sub-problem takes
+      // precedence over the sub-problems interrupted because of it.
+      for (const BopSolveStatus bad_status :
+           {BopSolveStatus::INVALID_PROBLEM, BopSolveStatus::INFEASIBLE_PROBLEM,
+            BopSolveStatus::NO_SOLUTION_FOUND}) {
+        if (std::find(statuses.begin(), statuses.end(), bad_status) !=
+            statuses.end()) {
+          return bad_status;
         }
-
-      // Aggregate results.
+      }
       status = BopSolveStatus::OPTIMAL_SOLUTION_FOUND;
       objective_value_ = lp->objective_offset();
       best_bound_ = 0.0;
       for (int i = 0; i < num_sub_problems; ++i) {
-        objective_value_ += objective_values[i];
-        best_bound_ += best_bounds[i];
-        if (statuses[i] == BopSolveStatus::NO_SOLUTION_FOUND ||
-            statuses[i] == BopSolveStatus::INFEASIBLE_PROBLEM ||
-            statuses[i] == BopSolveStatus::INVALID_PROBLEM) {
-          return statuses[i];
-        }
-
+        objective_value_ += decomposed_solver.objective_values()[i];
+        best_bound_ += decomposed_solver.best_bounds()[i];
         if (statuses[i] == BopSolveStatus::FEASIBLE_SOLUTION_FOUND) {
           status = BopSolveStatus::FEASIBLE_SOLUTION_FOUND;
         }
       }
-      variable_values_ = decomposer.AggregateAssignments(variable_values);
+      variable_values_ =
+          decomposer.AggregateAssignments(decomposed_solver.variable_values());
       CheckSolution(*lp, variable_values_);
     } else {
       status =
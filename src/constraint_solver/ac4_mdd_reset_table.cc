@@ -11,6 +11,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <list>
 
 #include "base/integral_types.h"
@@ -18,6 +19,7 @@
 #include "base/macros.h"
 #include "base/int_type_indexed_vector.h"
 #include "base/int_type.h"
+#include "base/hash.h"
 #include "base/map_util.h"
 #include "base/stl_util.h"
 #include "constraint_solver/constraint_solver.h"
@@ -74,214 +76,115 @@ class MDD {
 };
 
 class MDD_Factory {
-  class VMREC {
-    VectorMap<int> mdd_;
-    std::vector<VMREC*> vmr_;
-    MDD* value_;
-
-   public:
-    VMREC(MDD* value = nullptr) : value_(value), mdd_(), vmr_() {}
-
-    ~VMREC() { STLDeleteElements(&vmr_); }
-
-    VMREC* next(MDD* mdd) {
-      if (mdd == nullptr) {
-        if (mdd_.Contains(0)) {
-          return vmr_[mdd_.Index(0)];
-        }
-        return nullptr;
-      }
-      if (mdd_.Contains(mdd->getID())) {
-        return vmr_[mdd_.Index(mdd->getID())];
+  // Hash of the children of a node, identified by their ids.
+  struct ChildrenHasher {
+    size_t operator()(const std::vector<int>& children) const {
+      uint64 hash = children.size();
+      for (const int child : children) {
+        hash = hash * 0x9E3779B97F4A7C15ULL + child;
       }
-      return nullptr;
+      return static_cast<size_t>(hash ^ (hash >> 32));
     }
-
-    void addMdd(MDD* mdd) {
-      if (mdd == nullptr) {
-        mdd_.Add(0);
-        vmr_.push_back(new VMREC());
-      } else {
-        mdd_.Add(mdd->getID());
-        vmr_.push_back(new VMREC());
-      }
-    }
-
-    void setValue(MDD* value) { value_ = value; }
-
-    MDD* getValue() { return value_; }
-
   };
 
-  std::vector<VMREC*> g_;
-  std::vector<int> NumDifferentValuesInColumn;
+  //all the nodes created, owned by the factory
+  std::vector<MDD*> nodes_;
+  //reduced nodes of each level, by children
+  std::vector<hash_map<std::vector<int>, MDD*, ChildrenHasher> > unique_;
+  //value indices of the tuples, and the tuples in lexicographic order
+  std::vector<int> value_indices_;
+  std::vector<int> order_;
+  int arity_;
   MDD* finalEdge_;
   int nb_instance;
 
  public:
   std::vector<VectorMap<int64> > vm_;
-  MDD_Factory() : nb_instance(1) {}
+  MDD_Factory() : arity_(0), finalEdge_(nullptr), nb_instance(1) {}
 
-  ~MDD_Factory() { STLDeleteElements(&g_); }
+  ~MDD_Factory() { STLDeleteElements(&nodes_); }
 
   int getNbInstance() { return nb_instance; }
 
-  //the first-one with table unsorted
+  // Builds the reduced MDD of the table. The tuples are sorted, so that the
+  // sub-MDD below each prefix is built from a contiguous range of tuples, and
+  // each node is merged with an identical node of its level, found by
+  // hashing its children, as soon as it is built. The unreduced trie of the
+  // table is never built: the memory used is proportional to the size of the
+  // reduced MDD.
   MDD* mddify(const IntTupleSet& table) {
-
-#ifdef MEMTABLETOMDDDEBUG
-    for (int i = 0; i < table.NumTuples(); i++) {
-      for (int j = 0; j < table.Arity(); j++) {
-        std::cout << table.Value(i, j) << " ";
-      }
-      std::cout << "\n";
-    }
-#endif
-
-    finalEdge_ = new MDD(0, table.Arity(), nb_instance++);
+    arity_ = table.Arity();
+    const int num_tuples = table.NumTuples();
+    finalEdge_ = NewNode(0, arity_);
     finalEdge_->setState(true);
 
-    for (int i = 0; i < table.Arity(); i++) {
-      vm_.push_back(VectorMap<int64>());
-      g_.push_back(new VMREC());
-      NumDifferentValuesInColumn.push_back(table.NumDifferentValuesInColumn(i));
-    }
-    MDD* Troot = new MDD(NumDifferentValuesInColumn[0], 0, nb_instance++);
-    MDD* T = nullptr;
-    for (int i = 0; i < table.NumTuples(); ++i) {
-      T = Troot;
-      for (int j = 0; j < table.Arity(); j++) {
-        if (!vm_[j].Contains(table.Value(i, j))) {
-          vm_[j].Add(table.Value(i, j));
-        }
-        const int index = vm_[j].Index(table.Value(i, j));
-        if ((*T)[index] == nullptr) {
-          if (j + 1 < table.Arity()) {
-            T->set(index, new MDD(NumDifferentValuesInColumn[j + 1], j + 1,
-                                  nb_instance++));
-          } else {  //last
-            T->set(index, finalEdge_);
-          }
-
-        }
-        T = (*T)[index];
-      }
-    }
-    return mddReduce(Troot);
-
-  }
-
-  //
-  MDD* mddReduce(MDD* T) {
-    if (T == nullptr) {
-      return nullptr;
-    }
-
-    if (T->getState()) {
-      return T;
-    }
-    int i;
-
-    //        for (i = 0; i < T->size(); i++) {
-    //            if ((*T)[i] != nullptr) {
-    //                if (!(*T)[i]->getState()) {
-    //                    break;
-    //                }
-    //            }
-    //        }
-    //        if (!(i < T->size())) {
-    //            return T;
-    //        }
-
-    std::vector<MDD*> B(T->size(), nullptr);
-    bool BEmpty = true;
-    for (i = 0; i < T->size(); i++) {
-      MDD* G = mddReduce((*T)[i]);
-      if (G != nullptr) {
-        B[i] = G;
-        BEmpty = false;
+    vm_.resize(arity_);
+    unique_.resize(arity_);
+    value_indices_.resize(num_tuples * arity_);
+    for (int i = 0; i < num_tuples; ++i) {
+      for (int j = 0; j < arity_; ++j) {
+        value_indices_[i * arity_ + j] = vm_[j].Add(table.Value(i, j));
       }
     }
-
-    if (BEmpty) {
-      delete (T);
-      return nullptr;
-    }
-
-    MDD* G = new MDD(T->size(), T->getNumVar(), nb_instance++);
-    for (int i = 0; i < T->size(); i++) {
-      G->set(i, B[i]);
-    }
-    delete (T);
-    MDD* GP = gContains(G);
-    if (GP != nullptr) {  //exist a G' identical to G...
-      delete (G);
-      return GP;
-    } else {
-      //add G to the global set of MDD
-      gAdd(G);
-      return G;
-    }
+    order_.resize(num_tuples);
+    for (int i = 0; i < num_tuples; ++i) {
+      order_[i] = i;
+    }
+    const int* const indices = value_indices_.data();
+    const int arity = arity_;
+    std::sort(order_.begin(), order_.end(), [indices, arity](int a, int b) {
+      return std::lexicographical_compare(
+          indices + a * arity, indices + (a + 1) * arity, indices + b * arity,
+          indices + (b + 1) * arity);
+    });
+    MDD* const root = Build(0, num_tuples, 0);
+    // The construction data is not needed anymore.
+    std::vector<int>().swap(value_indices_);
+    std::vector<int>().swap(order_);
+    unique_.clear();
+    return root;
   }
 
-  MDD* gContains(MDD* T) {
-    VMREC* tmp = g_[T->getNumVar()];
-
-    for (int i = 0; i < T->size(); i++) {
-      tmp = tmp->next((*T)[i]);
-      if (tmp == nullptr) {
-        return nullptr;
-      }
-    }
-    return tmp->getValue();
-  }
-
-  void gAdd(MDD* T) {
-    VMREC* tmp = g_[T->getNumVar()];
-    VMREC* tmp2 = tmp;
-    for (int i = 0; i < T->size(); i++) {
-      tmp2 = tmp;
-      tmp = tmp->next((*T)[i]);
-      if (tmp == nullptr) {
-        tmp2->addMdd((*T)[i]);
-        tmp = tmp2->next((*T)[i]);
+ private:
+  MDD* NewNode(int nb_values, int num_var) {
+    MDD* const node = new MDD(nb_values, num_var, nb_instance++);
+    nodes_.push_back(node);
+    return node;
+  }
+
+  int ValueIndex(int tuple, int var) const {
+    return value_indices_[tuple * arity_ + var];
+  }
+
+  // Returns the reduced MDD of the suffixes from 'var' of the tuples
+  // order_[begin..end), which all have the same prefix.
+  MDD* Build(int begin, int end, int var) {
+    if (var == arity_) {
+      return finalEdge_;
+    }
+    const int nb_values = vm_[var].size();
+    std::vector<MDD*> children(nb_values, nullptr);
+    std::vector<int> children_ids(nb_values, 0);
+    int first = begin;
+    while (first < end) {
+      const int value = ValueIndex(order_[first], var);
+      int last = first + 1;
+      while (last < end && ValueIndex(order_[last], var) == value) {
+        ++last;
       }
-    }
-    tmp->setValue(T);
-  }
-
-  MDD* ReCount(MDD* T) {
-    std::vector<MDD*>* v1, *v2, *tmp;
-    int nb = 0;
-
-    std::vector<bool> visited(getNbInstance());
-    v1 = new std::vector<MDD*>();
-    v2 = new std::vector<MDD*>();
-    v1->push_back(T);
-    while (v1->size() > 0) {
-      tmp = v2;
-      v2 = v1;
-      v1 = tmp;
-      while (v2->size()) {
-        v2->back()->setID(nb++);
-        for (int i = 0; i < v2->back()->size(); ++i) {
-          MDD* fils = (*v2->back())[i];
-          if (fils != nullptr) {
-            if (!visited[fils->getID()]) {
-              visited[fils->getID()] = true;
-              v1->push_back((*v2->back())[i]);
-            }
-          }
-
-        }
-        v2->pop_back();
+      children[value] = Build(first, last, var + 1);
+      children_ids[value] = children[value]->getID();
+      first = last;
+    }
+    MDD*& node = unique_[var][children_ids];
+    if (node == nullptr) {
+      node = NewNode(nb_values, var);
+      for (int value = 0; value < nb_values; ++value) {
+        node->set(value, children[value]);
       }
     }
-
-    nb_instance = nb;
-    return T;
+    return node;
   }
-
 };
 
 class Sparse_Set_Rev : public NumericalRev<int> {
@@ -590,9 +493,6 @@ class MyMDD {
       edges_lvl[nodes_[edges_[edge]->getStart()]->getVariable()]->Incr(solver);
       nodes_[edges_[edge]->getEnd()]->InsertEdgeIn(edge, solver);
     }
-
-    delete mdd;
-
   }
 
   ~MyMDD() {
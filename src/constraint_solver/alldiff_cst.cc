@@ -150,7 +150,8 @@ class RangeBipartiteMatching {
         tree_(new int[2 * size + 2]),
         diff_(new int64[2 * size + 2]),
         hall_(new int[2 * size + 2]),
-        active_size_(0) {
+        active_size_(0),
+        modified_(true) {
     for (int i = 0; i < size; ++i) {
       max_sorted_[i] = &intervals_[i];
       min_sorted_[i] = max_sorted_[i];
@@ -158,15 +159,27 @@ class RangeBipartiteMatching {
   }
 
   void SetRange(int index, int64 imin, int64 imax) {
-    intervals_[index].min = imin;
-    intervals_[index].max = imax;
+    Interval* const interval = &intervals_[index];
+    if (interval->min != imin || interval->max != imax) {
+      interval->min = imin;
+      interval->max = imax;
+      modified_ = true;
+    }
   }
 
+  // Returns true if some bounds were tightened. If no range changed since
+  // the last successful call, the intervals are still at their fixed point
+  // and nothing is done.
   bool Propagate() {
+    if (!modified_) {
+      return false;
+    }
     SortArray();
 
     const bool modified1 = PropagateMin();
     const bool modified2 = PropagateMax();
+    // Reached only if propagation did not fail.
+    modified_ = false;
     return modified1 || modified2;
   }
 
@@ -178,10 +191,8 @@ class RangeBipartiteMatching {
   // This method sorts the min_sorted_ and max_sorted_ arrays and fill
   // the bounds_ array (and set the active_size_ counter).
   void SortArray() {
-    std::sort(min_sorted_.get(), min_sorted_.get() + size_,
-              CompareIntervalMin());
-    std::sort(max_sorted_.get(), max_sorted_.get() + size_,
-              CompareIntervalMax());
+    IncrementalSort(min_sorted_.get(), CompareIntervalMin());
+    IncrementalSort(max_sorted_.get(), CompareIntervalMax());
 
     int64 min = min_sorted_[0]->min;
     int64 max = max_sorted_[0]->max + 1;
@@ -293,8 +304,29 @@ class RangeBipartiteMatching {
     return modified;
   }
 
-  // TODO(user) : use better sort, use bounding boxes of modifications to
-  //                 improve the sorting (only modified vars).
+  // The sorted arrays are kept from one call to the next, and only a few
+  // bounds change between two calls: an insertion sort is linear on such
+  // almost sorted arrays. It falls back to std::sort when too many
+  // intervals moved, e.g. after a backtrack.
+  template <class Compare>
+  void IncrementalSort(Interval** const sorted, const Compare& compare) {
+    const int64 max_moves = 4 * size_;
+    int64 moves = 0;
+    for (int i = 1; i < size_; ++i) {
+      Interval* const current = sorted[i];
+      int j = i;
+      while (j > 0 && compare(current, sorted[j - 1])) {
+        sorted[j] = sorted[j - 1];
+        --j;
+      }
+      sorted[j] = current;
+      moves += i - j;
+      if (moves > max_moves) {
+        std::sort(sorted, sorted + size_, compare);
+        return;
+      }
+    }
+  }
 
   // This method is used by the STL sort.
   struct CompareIntervalMin {
@@ -347,6 +379,9 @@ class RangeBipartiteMatching {
   std::unique_ptr<int64[]> diff_;  // diffs between critical capacities.
   std::unique_ptr<int[]> hall_;    // hall interval links.
   int active_size_;
+  // False iff the intervals are at the fixed point of the last successful
+  // propagation.
+  bool modified_;
 };
 
 class BoundsAllDifferent : public BaseAllDifferent {
@@ -440,6 +440,9 @@ void Assignment::Clear() {
   int_var_container_.Clear();
   interval_var_container_.Clear();
   sequence_var_container_.Clear();
+  tracked_int_vars_.clear();
+  tracked_interval_vars_.clear();
+  tracked_sequence_vars_.clear();
 }
 
 void Assignment::Store() {
@@ -496,9 +499,114 @@ void LoadElement(const hash_map<std::string, E*>& id_to_element_map,
   }
 }
 
+void LoadObjective(const IntVarAssignmentProto& objective,
+                   Assignment* const assignment) {
+  const std::string objective_id = objective.var_id();
+  CHECK(!objective_id.empty());
+  if (assignment->HasObjective() &&
+      objective_id.compare(assignment->Objective()->name()) == 0) {
+    const int64 obj_min = objective.min();
+    const int64 obj_max = objective.has_max() ? objective.max() : obj_min;
+    assignment->SetObjectiveRange(obj_min, obj_max);
+    if (objective.active()) {
+      assignment->ActivateObjective();
+    } else {
+      assignment->DeactivateObjective();
+    }
+  }
+}
+
+void SaveObjective(const Assignment& assignment,
+                   AssignmentProto* const assignment_proto) {
+  if (assignment.HasObjective()) {
+    const IntVar* objective = assignment.Objective();
+    const std::string& name = objective->name();
+    if (!name.empty()) {
+      IntVarAssignmentProto* objective = assignment_proto->mutable_objective();
+      objective->set_var_id(name);
+      const int64 obj_min = assignment.ObjectiveMin();
+      const int64 obj_max = assignment.ObjectiveMax();
+      objective->set_min(obj_min);
+      if (obj_min != obj_max) {
+        objective->set_max(obj_max);
+      }
+      objective->set_active(assignment.ActivatedObjective());
+    }
+  }
+}
+
+// Chunks of assignment files, see Assignment::SaveInChunks().
+const int kAssignmentChunk = 0;
+
+// Loads the chunks of an assignment file. Element names are indexed once
+// for all chunks.
+bool LoadChunks(ChunkReader* const reader, Assignment* const assignment) {
+  hash_map<std::string, IntVarElement*> int_var_map;
+  IdToElementMap<IntVar, IntVarElement>(assignment->MutableIntVarContainer(),
+                                        &int_var_map);
+  hash_map<std::string, IntervalVarElement*> interval_var_map;
+  IdToElementMap<IntervalVar, IntervalVarElement>(
+      assignment->MutableIntervalVarContainer(), &interval_var_map);
+  hash_map<std::string, SequenceVarElement*> sequence_var_map;
+  IdToElementMap<SequenceVar, SequenceVarElement>(
+      assignment->MutableSequenceVarContainer(), &sequence_var_map);
+  AssignmentProto chunk;
+  int type = -1;
+  while (reader->ReadChunk(&type, &chunk)) {
+    if (type != kAssignmentChunk) {
+      LOG(INFO) << "Invalid assignment chunk";
+      return false;
+    }
+    for (const IntVarAssignmentProto& proto : chunk.int_var_assignment()) {
+      LoadElement<IntVarElement, IntVarAssignmentProto>(int_var_map, proto);
+    }
+    for (const IntervalVarAssignmentProto& proto :
+         chunk.interval_var_assignment()) {
+      LoadElement<IntervalVarElement, IntervalVarAssignmentProto>(
+          interval_var_map, proto);
+    }
+    for (const SequenceVarAssignmentProto& proto :
+         chunk.sequence_var_assignment()) {
+      LoadElement<SequenceVarElement, SequenceVarAssignmentProto>(
+          sequence_var_map, proto);
+    }
+    if (chunk.has_objective()) {
+      LoadObjective(chunk.objective(), assignment);
+    }
+  }
+  return reader->ok() && reader->Close();
+}
+
+// Writes the named elements of a container in chunks of at most
+// 'elements_per_chunk' elements. 'chunk' holds the elements not written
+// yet, which can be completed by the next container.
+template <class Var, class Element, class Proto, class Container>
+bool SaveChunks(const Container& container, int elements_per_chunk,
+                Proto* (AssignmentProto::*Add)(), AssignmentProto* const chunk,
+                int* const chunk_size, ChunkWriter* const writer) {
+  for (const Element& element : container.elements()) {
+    const Var* const var = element.Var();
+    if (var->name().empty()) {
+      continue;
+    }
+    element.WriteToProto((chunk->*Add)());
+    if (++*chunk_size == elements_per_chunk) {
+      if (!writer->WriteChunk(kAssignmentChunk, *chunk)) {
+        return false;
+      }
+      chunk->Clear();
+      *chunk_size = 0;
+    }
+  }
+  return true;
+}
 }  // namespace
 
 bool Assignment::Load(const std::string& filename) {
+  ChunkReader reader;
+  if (reader.Open(filename)) {
+    return LoadChunks(&reader, this);
+  }
   File* file = File::Open(filename, "r");
   if (file == nullptr) {
     LOG(INFO) << "Cannot open " << filename;
@@ -558,19 +666,7 @@ void Assignment::Load(const AssignmentProto& assignment_proto) {
                               &AssignmentProto::sequence_var_assignment_size,
                               &AssignmentProto::sequence_var_assignment);
   if (assignment_proto.has_objective()) {
-    const IntVarAssignmentProto& objective = assignment_proto.objective();
-    const std::string objective_id = objective.var_id();
-    CHECK(!objective_id.empty());
-    if (HasObjective() && objective_id.compare(Objective()->name()) == 0) {
-      const int64 obj_min = objective.min();
-      const int64 obj_max = objective.has_max() ? objective.max() : obj_min;
-      SetObjectiveRange(obj_min, obj_max);
-      if (objective.active()) {
-        ActivateObjective();
-      } else {
-        DeactivateObjective();
-      }
-    }
+    LoadObjective(assignment_proto.objective(), this);
   }
 }
 
@@ -591,6 +687,42 @@ bool Assignment::Save(File* file) const {
   return writer.WriteProtocolMessage(assignment_proto) && writer.Close();
 }
 
+bool Assignment::SaveInChunks(const std::string& filename,
+                              int elements_per_chunk) const {
+  CHECK_LT(0, elements_per_chunk);
+  File* file = File::Open(filename, "w");
+  if (file == nullptr) {
+    LOG(INFO) << "Cannot open " << filename;
+    return false;
+  }
+  ChunkWriter writer(file);
+  AssignmentProto chunk;
+  int chunk_size = 0;
+  bool written =
+      SaveChunks<IntVar, IntVarElement, IntVarAssignmentProto, IntContainer>(
+          int_var_container_, elements_per_chunk,
+          &AssignmentProto::add_int_var_assignment, &chunk, &chunk_size,
+          &writer) &&
+      SaveChunks<IntervalVar, IntervalVarElement, IntervalVarAssignmentProto,
+                 IntervalContainer>(
+          interval_var_container_, elements_per_chunk,
+          &AssignmentProto::add_interval_var_assignment, &chunk, &chunk_size,
+          &writer) &&
+      SaveChunks<SequenceVar, SequenceVarElement, SequenceVarAssignmentProto,
+                 SequenceContainer>(
+          sequence_var_container_, elements_per_chunk,
+          &AssignmentProto::add_sequence_var_assignment, &chunk, &chunk_size,
+          &writer);
+  if (written) {
+    // The objective goes with the last elements.
+    SaveObjective(*this, &chunk);
+    if (chunk_size > 0 || chunk.has_objective()) {
+      written = writer.WriteChunk(kAssignmentChunk, chunk);
+    }
+  }
+  return writer.Close() && written;
+}
+
 template <class Var, class Element, class Proto, class Container>
 void RealSave(AssignmentProto* const assignment_proto,
               const Container& container, Proto* (AssignmentProto::*Add)()) {
@@ -615,21 +747,7 @@ void Assignment::Save(AssignmentProto* const assignment_proto) const {
   RealSave<SequenceVar, SequenceVarElement, SequenceVarAssignmentProto,
            SequenceContainer>(assignment_proto, sequence_var_container_,
                               &AssignmentProto::add_sequence_var_assignment);
-  if (HasObjective()) {
-    const IntVar* objective = Objective();
-    const std::string& name = objective->name();
-    if (!name.empty()) {
-      IntVarAssignmentProto* objective = assignment_proto->mutable_objective();
-      objective->set_var_id(name);
-      const int64 obj_min = ObjectiveMin();
-      const int64 obj_max = ObjectiveMax();
-      objective->set_min(obj_min);
-      if (obj_min != obj_max) {
-        objective->set_max(obj_max);
-      }
-      objective->set_active(ActivatedObjective());
-    }
-  }
+  SaveObjective(*this, assignment_proto);
 }
 
 template <class Container, class Element>
@@ -1024,6 +1142,29 @@ void Assignment::Copy(const Assignment* assignment) {
   objective_element_ = assignment->objective_element_;
 }
 
+void Assignment::CopyTracked(const Assignment* assignment) {
+  int_var_container_.Copy(assignment->int_var_container_, &tracked_int_vars_);
+  interval_var_container_.Copy(assignment->interval_var_container_,
+                               &tracked_interval_vars_);
+  sequence_var_container_.Copy(assignment->sequence_var_container_,
+                               &tracked_sequence_vars_);
+  objective_element_ = assignment->objective_element_;
+}
+
+void Assignment::RevertTracked(const Assignment* reference) {
+  DCHECK_EQ(int_var_container_.Size(), reference->int_var_container_.Size());
+  int_var_container_.CopyPositions(reference->int_var_container_,
+                                   tracked_int_vars_);
+  interval_var_container_.CopyPositions(reference->interval_var_container_,
+                                        tracked_interval_vars_);
+  sequence_var_container_.CopyPositions(reference->sequence_var_container_,
+                                        tracked_sequence_vars_);
+  objective_element_ = reference->objective_element_;
+  tracked_int_vars_.clear();
+  tracked_interval_vars_.clear();
+  tracked_sequence_vars_.clear();
+}
+
 Assignment* Solver::MakeAssignment() { return RevAlloc(new Assignment(this)); }
 
 Assignment* Solver::MakeAssignment(const Assignment* const a) {
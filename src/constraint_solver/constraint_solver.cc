@@ -17,17 +17,21 @@
 
 #include "constraint_solver/constraint_solver.h"
 
+#include <algorithm>
 #include <csetjmp>
 #include <deque>
 #include <iosfwd>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "base/callback.h"
 #include "base/commandlineflags.h"
 #include "base/integral_types.h"
+#include "base/large_array_allocator.h"
 #include "base/logging.h"
 #include "base/macros.h"
+#include "base/memory_accounting.h"
 #include "base/stringprintf.h"
 #include "base/file.h"
 #include "base/recordio.h"
@@ -52,6 +56,11 @@ DEFINE_bool(cp_model_stats, false,
 DEFINE_string(cp_export_file, "", "Export model to file using CPModelProto.");
 DEFINE_bool(cp_no_solve, false, "Force failure at the beginning of a search.");
 DEFINE_string(cp_profile_file, "", "Export profiling overview to file.");
+DEFINE_string(cp_profile_flame_file, "",
+              "Export profiling data to file in the collapsed stack format "
+              "used by flame graph tools.");
+DEFINE_bool(cp_presolve, true,
+            "Remove duplicate and dominated constraints before posting them.");
 DEFINE_bool(cp_verbose_fail, false, "Verbose output when failing.");
 DEFINE_bool(cp_name_variables, false, "Force all variables to have names.");
 DEFINE_bool(cp_name_cast_variables, false,
@@ -90,7 +99,8 @@ bool Solver::InstrumentsDemons() const {
 
 bool Solver::IsProfilingEnabled() const {
   return parameters_.profile_level != SolverParameters::NO_PROFILING ||
-         !FLAGS_cp_profile_file.empty();
+         !FLAGS_cp_profile_file.empty() ||
+         !FLAGS_cp_profile_flame_file.empty();
 }
 
 bool Solver::InstrumentsVariables() const {
@@ -138,7 +148,11 @@ class Queue {
         clean_action_(nullptr),
         clean_variable_(nullptr),
         in_add_(false),
-        instruments_demons_(s->InstrumentsDemons()) {}
+        instruments_demons_(s->InstrumentsDemons()),
+        coalesced_delayed_demons_(0),
+        requeued_delayed_demons_(0),
+        max_var_queue_length_(0),
+        max_delayed_queue_length_(0) {}
 
   ~Queue() {}
 
@@ -234,6 +248,9 @@ class Queue {
     if (demon->stamp() < stamp_) {
       demon->set_stamp(stamp_);
       var_queue_.push_back(demon);
+      if (var_queue_.size() > max_var_queue_length_) {
+        max_var_queue_length_ = var_queue_.size();
+      }
       if (freeze_level_ == 0) {
         Process();
       }
@@ -243,8 +260,17 @@ class Queue {
   void EnqueueDelayedDemon(Demon* const demon) {
     DCHECK(demon->priority() == Solver::DELAYED_PRIORITY);
     if (demon->stamp() < stamp_) {
+      // ProcessOneDemon() stamps demons with stamp_ - 1 when they run.
+      if (demon->stamp() == stamp_ - 1) {
+        ++requeued_delayed_demons_;
+      }
       demon->set_stamp(stamp_);
       delayed_queue_.push_back(demon);
+      if (delayed_queue_.size() > max_delayed_queue_length_) {
+        max_delayed_queue_length_ = delayed_queue_.size();
+      }
+    } else {
+      ++coalesced_delayed_demons_;
     }
   }
 
@@ -272,6 +298,11 @@ class Queue {
 
   uint64 stamp() const { return stamp_; }
 
+  int64 coalesced_delayed_demons() const { return coalesced_delayed_demons_; }
+  int64 requeued_delayed_demons() const { return requeued_delayed_demons_; }
+  int64 max_var_queue_length() const { return max_var_queue_length_; }
+  int64 max_delayed_queue_length() const { return max_delayed_queue_length_; }
+
   void set_action_on_fail(Solver::Action a) {
     DCHECK(clean_variable_ == nullptr);
     clean_action_ = a;
@@ -321,6 +352,11 @@ class Queue {
   std::vector<Constraint*> to_add_;
   bool in_add_;
   const bool instruments_demons_;
+  // Statistics.
+  int64 coalesced_delayed_demons_;
+  int64 requeued_delayed_demons_;
+  int64 max_var_queue_length_;
+  int64 max_delayed_queue_length_;
 };
 
 // ------------------ StateMarker / StateInfo struct -----------
@@ -382,6 +418,9 @@ struct StateMarker {
   int rev_object_array_memory_index_;
   int rev_memory_index_;
   int rev_memory_array_index_;
+  int rev_arena_object_index_;
+  int arena_block_;
+  int arena_offset_;
   StateInfo info_;
 };
 
@@ -399,6 +438,11 @@ StateMarker::StateMarker(Solver::MarkerType t, const StateInfo& info)
       rev_double_memory_index_(0),
       rev_object_memory_index_(0),
       rev_object_array_memory_index_(0),
+      rev_memory_index_(0),
+      rev_memory_array_index_(0),
+      rev_arena_object_index_(0),
+      arena_block_(-1),
+      arena_offset_(0),
       info_(info) {}
 
 // ---------- Trail and Reversibility ----------
@@ -509,8 +553,8 @@ class CompressedTrail {
       : block_size_(block_size),
         blocks_(nullptr),
         free_blocks_(nullptr),
-        data_(new addrval<T>[block_size]),
-        buffer_(new addrval<T>[block_size]),
+        data_(block_size),
+        buffer_(block_size),
         buffer_used_(false),
         current_(0),
         size_(0) {
@@ -530,12 +574,15 @@ class CompressedTrail {
     // will read them all, even if the uninitialized bytes are never used.
     // This makes valgrind happy.
 
-    memset(data_.get(), 0, sizeof(*data_.get()) * block_size);
-    memset(buffer_.get(), 0, sizeof(*buffer_.get()) * block_size);
+    memset(data_.data(), 0, sizeof(*data_.data()) * block_size);
+    memset(buffer_.data(), 0, sizeof(*buffer_.data()) * block_size);
+    RecordMemoryAllocation(CP_TRAIL, 2 * sizeof(addrval<T>) * block_size);
   }
   ~CompressedTrail() {
     FreeBlocks(blocks_);
     FreeBlocks(free_blocks_);
+    RecordMemoryAllocation(
+        CP_TRAIL, -static_cast<int64>(2 * sizeof(addrval<T>) * block_size_));
   }
   const addrval<T>& Back() const {
     // Back of empty trail.
@@ -546,24 +593,37 @@ class CompressedTrail {
     if (size_ > 0) {
       --current_;
       if (current_ <= 0) {
-        if (buffer_used_) {
-          data_.swap(buffer_);
-          current_ = block_size_;
-          buffer_used_ = false;
-        } else if (blocks_ != nullptr) {
-          packer_->Unpack(blocks_->compressed, data_.get());
-          FreeTopBlock();
-          current_ = block_size_;
-        }
+        Refill();
       }
       --size_;
     }
   }
+  // Restores all cells above 'target', from the most recent one, and removes
+  // them from the trail. This is equivalent to calling Back().restore() and
+  // PopBack() until the size of the trail is 'target', but cells are restored
+  // one in-memory block at a time, which makes long backtracks (to the root
+  // node on restarts for instance) much cheaper.
+  void RestoreTo(int target) {
+    DCHECK_LE(target, size_);
+    while (size_ > target) {
+      const int num_cells = std::min(current_, size_ - target);
+      const int first = current_ - num_cells;
+      for (int i = current_ - 1; i >= first; --i) {
+        data_[i].restore();
+      }
+      current_ = first;
+      size_ -= num_cells;
+      if (current_ <= 0) {
+        Refill();
+      }
+    }
+  }
   void PushBack(const addrval<T>& addr_val) {
     if (current_ >= block_size_) {
       if (buffer_used_) {  // Buffer is used.
         NewTopBlock();
-        packer_->Pack(buffer_.get(), &blocks_->compressed);
+        packer_->Pack(buffer_.data(), &blocks_->compressed);
+        RecordMemoryAllocation(CP_TRAIL, blocks_->compressed.size());
         // O(1) operation.
         data_.swap(buffer_);
       } else {
@@ -584,9 +644,24 @@ class CompressedTrail {
     Block* next;
   };
 
+  // Reloads the in-memory block from the buffer or the top compressed block
+  // when it has been emptied.
+  void Refill() {
+    if (buffer_used_) {
+      data_.swap(buffer_);
+      current_ = block_size_;
+      buffer_used_ = false;
+    } else if (blocks_ != nullptr) {
+      packer_->Unpack(blocks_->compressed, data_.data());
+      FreeTopBlock();
+      current_ = block_size_;
+    }
+  }
   void FreeTopBlock() {
     Block* block = blocks_;
     blocks_ = block->next;
+    RecordMemoryAllocation(CP_TRAIL,
+                           -static_cast<int64>(block->compressed.size()));
     block->compressed.clear();
     block->next = free_blocks_;
     free_blocks_ = block;
@@ -605,6 +680,8 @@ class CompressedTrail {
   void FreeBlocks(Block* blocks) {
     while (nullptr != blocks) {
       Block* next = blocks->next;
+      RecordMemoryAllocation(
+          CP_TRAIL, -static_cast<int64>(blocks->compressed.size()));
       delete blocks;
       blocks = next;
     }
@@ -614,14 +691,68 @@ class CompressedTrail {
   const int block_size_;
   Block* blocks_;
   Block* free_blocks_;
-  std::unique_ptr<addrval<T>[]> data_;
-  std::unique_ptr<addrval<T>[]> buffer_;
+  // The in-memory blocks are the hottest memory of the search, hence the
+  // LargeArrayAllocator.
+  std::vector<addrval<T>, LargeArrayAllocator<addrval<T> > > data_;
+  std::vector<addrval<T>, LargeArrayAllocator<addrval<T> > > buffer_;
   bool buffer_used_;
   int current_;
   int size_;
 };
 }  // namespace
 
+// ----- Search arena -----
+
+// Bump allocator for objects allocated during search. Memory is carved out
+// of large blocks; releasing the arena to a previous position is O(1), and
+// blocks are kept for reuse by later allocations.
+class SearchArena {
+ public:
+  SearchArena() : block_(-1), offset_(0) {}
+
+  void* Allocate(size_t size) {
+    size = (size + kAlignment - 1) & ~(kAlignment - 1);
+    if (block_ < 0 || offset_ + size > blocks_[block_].size) {
+      const int next = block_ + 1;
+      if (next == blocks_.size() || blocks_[next].size < size) {
+        // Blocks above the current one are all free.
+        blocks_.insert(blocks_.begin() + next,
+                       Block(std::max(kBlockSize, size)));
+      }
+      block_ = next;
+      offset_ = 0;
+    }
+    void* const memory = blocks_[block_].memory.get() + offset_;
+    offset_ += size;
+    return memory;
+  }
+
+  // Position of the top of the arena.
+  int block() const { return block_; }
+  int offset() const { return offset_; }
+
+  // Releases all memory allocated after position ('block', 'offset').
+  void ReleaseTo(int block, int offset) {
+    DCHECK_LE(block, block_);
+    block_ = block;
+    offset_ = offset;
+  }
+
+ private:
+  static const size_t kAlignment = 16;
+  static const size_t kBlockSize = 64 * 1024;
+
+  struct Block {
+    explicit Block(size_t s) : memory(new char[s]), size(s) {}
+    std::unique_ptr<char[]> memory;
+    size_t size;
+  };
+
+  std::vector<Block> blocks_;
+  int block_;
+  size_t offset_;
+};
+
 // ----- Trail -----
 
 // Object are explicitely copied using the copy ctor instead of
@@ -646,6 +777,8 @@ struct Trail {
   std::vector<BaseObject**> rev_object_array_memory_;
   std::vector<void*> rev_memory_;
   std::vector<void**> rev_memory_array_;
+  std::vector<BaseObject*> rev_arena_objects_;
+  SearchArena search_arena_;
 
   Trail(int block_size, SolverParameters::TrailCompression compression_level)
       : rev_ints_(block_size, compression_level),
@@ -656,43 +789,23 @@ struct Trail {
 
   void BacktrackTo(StateMarker* m) {
     int target = m->rev_int_index_;
-    for (int curr = rev_ints_.size(); curr > target; --curr) {
-      const addrval<int>& cell = rev_ints_.Back();
-      cell.restore();
-      rev_ints_.PopBack();
-    }
+    rev_ints_.RestoreTo(target);
     DCHECK_EQ(rev_ints_.size(), target);
     // Incorrect trail size after backtrack.
     target = m->rev_int64_index_;
-    for (int curr = rev_int64s_.size(); curr > target; --curr) {
-      const addrval<int64>& cell = rev_int64s_.Back();
-      cell.restore();
-      rev_int64s_.PopBack();
-    }
+    rev_int64s_.RestoreTo(target);
     DCHECK_EQ(rev_int64s_.size(), target);
     // Incorrect trail size after backtrack.
     target = m->rev_uint64_index_;
-    for (int curr = rev_uint64s_.size(); curr > target; --curr) {
-      const addrval<uint64>& cell = rev_uint64s_.Back();
-      cell.restore();
-      rev_uint64s_.PopBack();
-    }
+    rev_uint64s_.RestoreTo(target);
     DCHECK_EQ(rev_uint64s_.size(), target);
     // Incorrect trail size after backtrack.
     target = m->rev_double_index_;
-    for (int curr = rev_doubles_.size(); curr > target; --curr) {
-      const addrval<double>& cell = rev_doubles_.Back();
-      cell.restore();
-      rev_doubles_.PopBack();
-    }
+    rev_doubles_.RestoreTo(target);
     DCHECK_EQ(rev_doubles_.size(), target);
     // Incorrect trail size after backtrack.
     target = m->rev_ptr_index_;
-    for (int curr = rev_ptrs_.size(); curr > target; --curr) {
-      const addrval<void*>& cell = rev_ptrs_.Back();
-      cell.restore();
-      rev_ptrs_.PopBack();
-    }
+    rev_ptrs_.RestoreTo(target);
     DCHECK_EQ(rev_ptrs_.size(), target);
     // Incorrect trail size after backtrack.
     target = m->rev_boolvar_list_index_;
@@ -758,6 +871,13 @@ struct Trail {
       // delete [] version of the previous unsafe case.
     }
     rev_memory_array_.resize(target);
+
+    target = m->rev_arena_object_index_;
+    for (int curr = rev_arena_objects_.size() - 1; curr >= target; --curr) {
+      rev_arena_objects_[curr]->~BaseObject();
+    }
+    rev_arena_objects_.resize(target);
+    search_arena_.ReleaseTo(m->arena_block_, m->arena_offset_);
   }
 };
 
@@ -795,6 +915,17 @@ BaseObject* Solver::SafeRevAlloc(BaseObject* ptr) {
   return ptr;
 }
 
+void* Solver::AllocateInSearchArena(size_t size) {
+  check_alloc_state();
+  return trail_->search_arena_.Allocate(size);
+}
+
+BaseObject* Solver::SafeRevAllocInArena(BaseObject* ptr) {
+  check_alloc_state();
+  trail_->rev_arena_objects_.push_back(ptr);
+  return ptr;
+}
+
 int* Solver::SafeRevAllocArray(int* ptr) {
   check_alloc_state();
   trail_->rev_int_memory_.push_back(ptr);
@@ -1432,6 +1563,15 @@ int64 Solver::MemoryUsage() {
 
 int64 Solver::wall_time() const { return timer_->GetInMs(); }
 
+double Solver::deterministic_time() const {
+  // Average costs in seconds, measured on the propagator benchmark: a demon
+  // run touches the domains of a few variables, while a branch or a failure
+  // also saves or restores the trail and goes through the search monitors.
+  return 1e-7 * (demon_runs_[VAR_PRIORITY] + demon_runs_[NORMAL_PRIORITY] +
+                 demon_runs_[DELAYED_PRIORITY]) +
+         5e-7 * (branches_ + fails_);
+}
+
 int64 Solver::solutions() const { return TopLevelSearch()->solution_counter(); }
 
 void Solver::TopPeriodicCheck() { TopLevelSearch()->PeriodicCheck(); }
@@ -1466,6 +1606,9 @@ void Solver::PushState(Solver::MarkerType t, const StateInfo& info) {
     m->rev_object_array_memory_index_ = trail_->rev_object_array_memory_.size();
     m->rev_memory_index_ = trail_->rev_memory_.size();
     m->rev_memory_array_index_ = trail_->rev_memory_array_.size();
+    m->rev_arena_object_index_ = trail_->rev_arena_objects_.size();
+    m->arena_block_ = trail_->search_arena_.block();
+    m->arena_offset_ = trail_->search_arena_.offset();
   }
   searches_.back()->marker_stack_.push_back(m);
   queue_->increase_stamp();
@@ -1529,6 +1672,22 @@ uint64 Solver::stamp() const { return queue_->stamp(); }
 
 uint64 Solver::fail_stamp() const { return fail_stamp_; }
 
+int64 Solver::coalesced_delayed_demons() const {
+  return queue_->coalesced_delayed_demons();
+}
+
+int64 Solver::requeued_delayed_demons() const {
+  return queue_->requeued_delayed_demons();
+}
+
+int64 Solver::max_var_queue_length() const {
+  return queue_->max_var_queue_length();
+}
+
+int64 Solver::max_delayed_queue_length() const {
+  return queue_->max_delayed_queue_length();
+}
+
 void Solver::set_action_on_fail(Action a) { queue_->set_action_on_fail(a); }
 
 void Solver::set_variable_to_clean_on_fail(IntVar* v) {
@@ -1604,6 +1763,253 @@ void Solver::Accept(ModelVisitor* const visitor,
   visitor->EndVisitModel(name_);
 }
 
+namespace {
+// Collects the type and the arguments of a constraint, without visiting its
+// sub-expressions, to compare it with other constraints.
+class ConstraintSignatureVisitor : public ModelVisitor {
+ public:
+  ConstraintSignatureVisitor()
+      : depth_(0), fully_described_(true), expression_(nullptr), value_(0) {}
+  ~ConstraintSignatureVisitor() override {}
+
+  void Visit(const Constraint* const constraint) {
+    signature_.clear();
+    arguments_.clear();
+    depth_ = 0;
+    fully_described_ = true;
+    expression_ = nullptr;
+    value_ = 0;
+    constraint->Accept(this);
+  }
+
+  // Type and arguments of the last visited constraint.
+  const std::string& signature() const { return signature_; }
+  const std::string& type() const { return type_; }
+  // Returns false if the constraint has arguments which cannot be compared,
+  // such as callbacks.
+  bool fully_described() const { return fully_described_ && depth_ == 0; }
+  // Expression and integer arguments, for constraints of the form
+  // 'expression op value'.
+  IntExpr* expression() const { return expression_; }
+  int64 value() const { return value_; }
+  // Variables, expressions, intervals and sequences the constraint is on.
+  const std::vector<const void*>& arguments() const { return arguments_; }
+
+  void BeginVisitConstraint(const std::string& type_name,
+                            const Constraint* const constraint) override {
+    if (depth_++ == 0) {
+      type_ = type_name;
+      signature_ = type_name;
+    } else {
+      fully_described_ = false;
+    }
+  }
+  void EndVisitConstraint(const std::string& type_name,
+                          const Constraint* const constraint) override {
+    --depth_;
+  }
+  void BeginVisitExtension(const std::string& type) override {
+    fully_described_ = false;
+  }
+  void VisitIntegerArgument(const std::string& arg_name, int64 value) override {
+    if (arg_name == ModelVisitor::kValueArgument) value_ = value;
+    StringAppendF(&signature_, " %s=%" GG_LL_FORMAT "d", arg_name.c_str(),
+                  value);
+  }
+  void VisitIntegerArrayArgument(const std::string& arg_name,
+                                 const std::vector<int64>& values) override {
+    StringAppendF(&signature_, " %s=[", arg_name.c_str());
+    for (const int64 value : values) {
+      StringAppendF(&signature_, "%" GG_LL_FORMAT "d,", value);
+    }
+    signature_ += "]";
+  }
+  void VisitIntegerMatrixArgument(const std::string& arg_name,
+                                  const IntTupleSet& tuples) override {
+    fully_described_ = false;
+  }
+  void VisitIntegerExpressionArgument(const std::string& arg_name,
+                                      IntExpr* const argument) override {
+    if (arg_name == ModelVisitor::kExpressionArgument) expression_ = argument;
+    AddArgument(arg_name, argument);
+  }
+  void VisitIntegerVariableArrayArgument(
+      const std::string& arg_name,
+      const std::vector<IntVar*>& arguments) override {
+    AddArrayArgument(arg_name, arguments);
+  }
+  void VisitIntervalArgument(const std::string& arg_name,
+                             IntervalVar* const argument) override {
+    AddArgument(arg_name, argument);
+  }
+  void VisitIntervalArrayArgument(
+      const std::string& arg_name,
+      const std::vector<IntervalVar*>& arguments) override {
+    AddArrayArgument(arg_name, arguments);
+  }
+  void VisitSequenceArgument(const std::string& arg_name,
+                             SequenceVar* const argument) override {
+    AddArgument(arg_name, argument);
+  }
+  void VisitSequenceArrayArgument(
+      const std::string& arg_name,
+      const std::vector<SequenceVar*>& arguments) override {
+    AddArrayArgument(arg_name, arguments);
+  }
+  void VisitIntegerVariableEvaluatorArgument(
+      const std::string& arg_name,
+      const Solver::Int64ToIntVar& arguments) override {
+    fully_described_ = false;
+  }
+
+ private:
+  void AddArgument(const std::string& arg_name, const void* const argument) {
+    StringAppendF(&signature_, " %s=%p", arg_name.c_str(), argument);
+    arguments_.push_back(argument);
+  }
+  template <class T>
+  void AddArrayArgument(const std::string& arg_name,
+                        const std::vector<T*>& arguments) {
+    StringAppendF(&signature_, " %s=[", arg_name.c_str());
+    for (const T* const argument : arguments) {
+      StringAppendF(&signature_, "%p,", argument);
+      arguments_.push_back(argument);
+    }
+    signature_ += "]";
+  }
+
+  std::string type_;
+  std::string signature_;
+  std::vector<const void*> arguments_;
+  int depth_;
+  bool fully_described_;
+  IntExpr* expression_;
+  int64 value_;
+};
+
+// Returns true if constraints of this type are fully defined by the arguments
+// they visit, so that two of them with the same arguments are equivalent.
+bool IsComparableConstraintType(const std::string& type) {
+  static const char* const kComparableTypes[] = {
+      ModelVisitor::kAllDifferent,      ModelVisitor::kBetween,
+      ModelVisitor::kEquality,          ModelVisitor::kGreater,
+      ModelVisitor::kGreaterOrEqual,    ModelVisitor::kLess,
+      ModelVisitor::kLessOrEqual,       ModelVisitor::kMember,
+      ModelVisitor::kNonEqual,          ModelVisitor::kScalProdEqual,
+      ModelVisitor::kScalProdGreaterOrEqual,
+      ModelVisitor::kScalProdLessOrEqual, ModelVisitor::kSumEqual,
+      ModelVisitor::kSumGreaterOrEqual, ModelVisitor::kSumLessOrEqual};
+  for (const char* const comparable_type : kComparableTypes) {
+    if (type == comparable_type) return true;
+  }
+  return false;
+}
+
+// Union-find on the arguments of constraints, to count the independent
+// components of the model.
+const void* FindRoot(hash_map<const void*, const void*>* parents,
+                     const void* node) {
+  const void* root = node;
+  while (true) {
+    const void* const parent = LookupOrInsert(parents, root, root);
+    if (parent == root) break;
+    root = parent;
+  }
+  while (node != root) {
+    const void* const parent = (*parents)[node];
+    (*parents)[node] = root;
+    node = parent;
+  }
+  return root;
+}
+}  // namespace
+
+void Solver::PresolveConstraints() {
+  ConstraintSignatureVisitor visitor;
+  hash_set<const Constraint*> seen_constraints;
+  hash_set<std::string> signatures;
+  // Tightest 'expression <= value' and 'expression >= value' constraints.
+  hash_map<const IntExpr*, int64> upper_bounds;
+  hash_map<const IntExpr*, int64> lower_bounds;
+  hash_map<const void*, const void*> parents;
+  std::vector<bool> removed(constraints_list_.size(), false);
+  int num_duplicates = 0;
+  for (int i = 0; i < constraints_list_.size(); ++i) {
+    Constraint* const constraint = constraints_list_[i];
+    if (!seen_constraints.insert(constraint).second) {
+      removed[i] = true;
+      ++num_duplicates;
+      continue;
+    }
+    visitor.Visit(constraint);
+    const std::vector<const void*>& arguments = visitor.arguments();
+    for (int j = 1; j < arguments.size(); ++j) {
+      const void* const root = FindRoot(&parents, arguments[0]);
+      const void* const other_root = FindRoot(&parents, arguments[j]);
+      if (root != other_root) parents[other_root] = root;
+    }
+    if (!visitor.fully_described() ||
+        !IsComparableConstraintType(visitor.type())) {
+      continue;
+    }
+    if (!signatures.insert(visitor.signature()).second) {
+      removed[i] = true;
+      ++num_duplicates;
+      continue;
+    }
+    if (visitor.expression() != nullptr && arguments.size() == 1) {
+      if (visitor.type() == ModelVisitor::kLessOrEqual) {
+        int64& bound = LookupOrInsert(&upper_bounds, visitor.expression(),
+                                      visitor.value());
+        bound = std::min(bound, visitor.value());
+      } else if (visitor.type() == ModelVisitor::kGreaterOrEqual) {
+        int64& bound = LookupOrInsert(&lower_bounds, visitor.expression(),
+                                      visitor.value());
+        bound = std::max(bound, visitor.value());
+      }
+    }
+  }
+  // Bounds on an expression are dominated by a tighter bound on the same
+  // expression, which is kept (the first one if several are equal).
+  int num_dominated = 0;
+  for (int i = 0; i < constraints_list_.size(); ++i) {
+    if (removed[i]) continue;
+    visitor.Visit(constraints_list_[i]);
+    if (visitor.expression() == nullptr || visitor.arguments().size() != 1 ||
+        !visitor.fully_described()) {
+      continue;
+    }
+    hash_map<const IntExpr*, int64>* const bounds =
+        visitor.type() == ModelVisitor::kLessOrEqual
+            ? &upper_bounds
+            : (visitor.type() == ModelVisitor::kGreaterOrEqual ? &lower_bounds
+                                                               : nullptr);
+    if (bounds == nullptr) continue;
+    int64* const bound = FindOrNull(*bounds, visitor.expression());
+    if (bound == nullptr) continue;
+    if (*bound != visitor.value()) {
+      removed[i] = true;
+      ++num_dominated;
+    } else {
+      // Other constraints with the same bound are duplicates.
+      *bound = bounds == &upper_bounds ? kint64min : kint64max;
+    }
+  }
+  int new_size = 0;
+  for (int i = 0; i < constraints_list_.size(); ++i) {
+    if (!removed[i]) constraints_list_[new_size++] = constraints_list_[i];
+  }
+  constraints_list_.resize(new_size);
+  int num_components = 0;
+  for (const auto& node_parent : parents) {
+    if (node_parent.first == node_parent.second) ++num_components;
+  }
+  VLOG(1) << "Presolve removed " << num_duplicates << " duplicate and "
+          << num_dominated << " dominated constraints, " << new_size
+          << " constraints left on " << num_components
+          << " independent components.";
+}
+
 void Solver::ProcessConstraints() {
   // Both constraints_list_ and additional_constraints_list_ are used in
   // a FIFO way.
@@ -1634,6 +2040,10 @@ void Solver::ProcessConstraints() {
     Fail();
   }
 
+  if (FLAGS_cp_presolve) {
+    PresolveConstraints();
+  }
+
   // Clear state before processing constraints.
   const int constraints_size = constraints_list_.size();
   additional_constraints_list_.clear();
@@ -2194,6 +2604,11 @@ void Solver::EndSearch() {
       LOG(INFO) << "Exporting profile to " << FLAGS_cp_profile_file;
       ExportProfilingOverview(FLAGS_cp_profile_file);
     }
+    if (!FLAGS_cp_profile_flame_file.empty()) {
+      LOG(INFO) << "Exporting flame graph profile to "
+                << FLAGS_cp_profile_flame_file;
+      ExportProfilingFlameGraph(FLAGS_cp_profile_flame_file);
+    }
   } else {  // We clean the nested Search.
     delete search;
     searches_.pop_back();
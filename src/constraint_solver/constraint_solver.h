@@ -109,6 +109,7 @@ class DemonProfiler;
 class DependencyGraph;
 class Dimension;
 class DisjunctiveConstraint;
+class EliteSolutionPool;
 class ExpressionCache;
 class IntExpr;
 class IntTupleSet;
@@ -142,6 +143,7 @@ class SolutionCollector;
 class SolutionPool;
 class Solver;
 class SymmetryBreaker;
+class TimeLimit;
 struct StateInfo;
 struct Trail;
 template <class T>
@@ -229,6 +231,12 @@ struct DefaultPhaseParameters {
   // per variable.
   int initialization_splits;
 
+  // Number of threads used to initialize impacts. When greater than 1, the
+  // model is copied into as many solvers, each one probing a share of the
+  // variables. Falls back to a sequential initialization if the model
+  // cannot be copied.
+  int initialization_threads;
+
   // The default phase will run heuristic periodically. This parameter
   // indicates if we should run all heuristics, or a randomly selected
   // one.
@@ -875,6 +883,24 @@ class Solver {
     return reinterpret_cast<T*>(SafeRevAllocArray(object));
   }
 
+  // Allocates 'size' bytes, suitably aligned for any object, in the search
+  // arena of the solver: a bump allocator released wholesale when
+  // backtracking out of the current state. This is much cheaper than heap
+  // allocation for objects created at each node of the search tree, like
+  // decisions. The memory must be used to build a BaseObject registered with
+  // RevAllocInArena():
+  //   Decision* const d = s->RevAllocInArena(
+  //       new (s->AllocateInSearchArena(sizeof(MyDecision))) MyDecision(...));
+  void* AllocateInSearchArena(size_t size);
+
+  // Like RevAlloc(), but for an object built in memory returned by
+  // AllocateInSearchArena(). The object is destroyed when backtracking out of
+  // the current state, and its memory is released with the arena.
+  template <typename T>
+  T* RevAllocInArena(T* object) {
+    return reinterpret_cast<T*>(SafeRevAllocInArena(object));
+  }
+
   // propagation
 
   // Adds the constraint 'c' to the model.
@@ -1036,11 +1062,32 @@ class Solver {
   // the objective and limits to the protobuf.
   void ExportModel(const std::vector<SearchMonitor*>& monitors,
                    CPModelProto* const proto, DecisionBuilder* const db) const;
+  // Exports the model to protobuf, and fills indices with the index of
+  // each variable of vars among the integer expressions of the proto, or -1
+  // if the variable does not appear in the model.
+  void ExportModel(const std::vector<IntVar*>& vars, CPModelProto* const proto,
+                   std::vector<int>* const indices) const;
   // Loads the model into the solver, and returns true upon success.
   bool LoadModel(const CPModelProto& proto);
   // Loads the model into the solver, appends search monitors to monitors,
   // and returns true upon success.
   bool LoadModel(const CPModelProto& proto, std::vector<SearchMonitor*>* monitors);
+  // Same as above, and also fills expressions with the integer
+  // expressions built from the proto, indexed as in the proto.
+  bool LoadModel(const CPModelProto& proto, std::vector<SearchMonitor*>* monitors,
+                 std::vector<IntExpr*>* expressions);
+  // Exports the model to a chunked record file (see ChunkWriter in
+  // base/recordio.h), with at most elements_per_chunk variables, expressions
+  // or constraints per chunk. Search monitors are useful to pass the
+  // objective and limits to the file.
+  bool ExportModelToFile(const std::vector<SearchMonitor*>& monitors,
+                         const std::string& filename,
+                         int elements_per_chunk) const;
+  // Loads a model written by ExportModelToFile(), one chunk at a time, so
+  // that the serialized model is never entirely in memory. Appends search
+  // monitors to monitors if not null, and returns true upon success.
+  bool LoadModelFromFile(const std::string& filename,
+                         std::vector<SearchMonitor*>* monitors);
   // Upgrades the model to the latest version.
   static bool UpgradeModel(CPModelProto* const proto);
 
@@ -1096,9 +1143,27 @@ class Solver {
   // number of demons executed during search for a given priority.
   int64 demon_runs(DemonPriority p) const { return demon_runs_[p]; }
 
+  // Propagation queue statistics since the creation of the solver:
+  // - number of delayed demon enqueues skipped because the demon was already
+  //   in the queue,
+  // - number of delayed demons enqueued again after having run in the same
+  //   propagation,
+  // - largest number of demons waiting in the variable and delayed queues.
+  int64 coalesced_delayed_demons() const;
+  int64 requeued_delayed_demons() const;
+  int64 max_var_queue_length() const;
+  int64 max_delayed_queue_length() const;
+
   // number of failures encountered since the creation of the solver.
   int64 failures() const { return fails_; }
 
+  // Deterministic time since the creation of the solver, in the unit of
+  // TimeLimit::GetElapsedDeterministicTime(). It is a weighted count of the
+  // demon runs, branches and failures; the weights are fit so that one unit
+  // is about one second of search (see the ratio reported by
+  // examples/cpp/propagator_benchmark.cc).
+  double deterministic_time() const;
+
   // number of neighbors created
   int64 neighbors() const { return neighbors_; }
 
@@ -2206,6 +2271,9 @@ class Solver {
 
   // ----- Search Limit -----
 
+  // Note that all the limits created by MakeLimit() and its variants are also
+  // crossed when the memory budget of base/memory_accounting.h is exceeded.
+
   // Creates a search limit that constrains the running time given in
   // milliseconds.
   SearchLimit* MakeTimeLimit(int64 time_in_ms);
@@ -2253,12 +2321,21 @@ class Solver {
   // this happens at a leaf the corresponding solution will be rejected.
   SearchLimit* MakeCustomLimit(std::function<bool()> limiter);
 
+  // Search limit that advances the deterministic time of time_limit by the
+  // deterministic_time() spent in the search, and stops the search when
+  // time_limit is reached. This is used to share a single budget between the
+  // constraint solver and the other solvers of a portfolio. The time limit
+  // is not owned and must outlive the search.
+  SearchLimit* MakeDeterministicTimeLimit(TimeLimit* const time_limit);
+
   // ----- No Goods -----
 
   // Creates a non-reversible nogood manager to store and use nogoods
   // during search. Nogoods are defined by the NoGood class. It can be
   // used during search with restart to avoid revisiting the same
   // portion of the search tree.
+  // Nogoods are propagated through two watched terms each, and the least
+  // active ones are periodically removed (see --cp_max_nogoods).
   NoGoodManager* MakeNoGoodManager();
 
   // ----- Tree Monitor -----
@@ -2336,6 +2413,22 @@ class Solver {
   // search. Use this only for low level debugging.
   SearchMonitor* MakeSearchTrace(const std::string& prefix);
 
+  // ----- Search Telemetry -----
+
+  // Creates a search monitor that writes a compact binary trace of the
+  // search to filename: decisions (variable index in vars and value),
+  // failures (with the last decision), solutions (with the objective value
+  // if objective is not null) and search boundaries. Only one decision and
+  // one failure out of sampling_period are recorded. Events go through a
+  // lock-free ring buffer drained to the file by a background thread, so
+  // that the monitor can be used on production solves; events are dropped
+  // if the buffer is full. The TreeMonitor is better suited to inspect
+  // small searches.
+  SearchMonitor* MakeSearchTelemetry(const std::string& filename,
+                                     const std::vector<IntVar*>& vars,
+                                     IntVar* const objective,
+                                     int sampling_period);
+
   // ----- ModelVisitor -----
 
   // Prints the model.
@@ -2623,6 +2716,25 @@ class Solver {
                                              int number_of_variables,
                                              int32 seed);
 
+  // Large neighborhood search operators on sequence variables. Relaxed
+  // intervals are freed from their sequence, while the ranking of the others
+  // is kept. Like the random LNS operator above, they always return
+  // neighbors and must be used with a search limit.
+  //
+  // Relaxes, on all sequences, the intervals starting within the time window
+  // of 'window_size' consecutive intervals of a random sequence. Start times
+  // are read from the assignment when it contains the intervals.
+  LocalSearchOperator* MakeTimeWindowSequenceLNSOperator(
+      const std::vector<SequenceVar*>& vars, int window_size, int32 seed);
+  // Relaxes up to 'number_of_sequences' random sequences entirely.
+  LocalSearchOperator* MakeResourceSequenceLNSOperator(
+      const std::vector<SequenceVar*>& vars, int number_of_sequences,
+      int32 seed);
+  // Relaxes up to 'max_length' consecutive intervals of a random sequence,
+  // keeping all other precedences.
+  LocalSearchOperator* MakeSubsequenceLNSOperator(
+      const std::vector<SequenceVar*>& vars, int max_length, int32 seed);
+
   // Creates a local search operator that tries to move the assignment of some
   // variables toward a target. The target is given as an Assignment. This
   // operator generates neighbors in which the only difference compared to the
@@ -2639,6 +2751,15 @@ class Solver {
   LocalSearchOperator* MakeMoveTowardTargetOperator(
       const std::vector<IntVar*>& variables, const std::vector<int64>& target_values);
 
+  // Path relinking: at each start, picks a member of 'elite' (see
+  // MakeSharedSolutionPool()) which differs from the current assignment of
+  // 'vars', and generates the intermediate solutions in which a growing
+  // subset of the differing variables, in random order, take the values of
+  // this guiding solution.
+  LocalSearchOperator* MakePathRelinkingOperator(
+      const std::vector<IntVar*>& vars, EliteSolutionPool* const elite,
+      int32 seed);
+
   // Creates a local search operator which concatenates a vector of operators.
   // Each operator from the vector is called sequentially. By default, when a
   // neighbor is found the neighborhood exploration restarts from the last
@@ -2686,6 +2807,13 @@ class Solver {
   LocalSearchOperator* RandomConcatenateOperators(
       const std::vector<LocalSearchOperator*>& ops, int32 seed);
 
+  // Adaptive version of the randomized concatenator: operators are picked
+  // with a probability which follows the rate at which they produce
+  // accepted neighbors per unit of time, measured online. Operators with no
+  // more neighbors are skipped until the next call to Start().
+  LocalSearchOperator* AdaptiveConcatenateOperators(
+      const std::vector<LocalSearchOperator*>& ops, int32 seed);
+
   // Creates a local search operator that wraps another local search
   // operator and limits the number of neighbors explored (i.e. calls
   // to MakeNextNeighbor from the current solution (between two calls
@@ -2734,6 +2862,14 @@ class Solver {
   // Solution Pool.
   SolutionPool* MakeDefaultSolutionPool();
 
+  // Solution pool publishing the solutions of the local search to 'elite',
+  // and restarting from the best member of 'elite' when it is better than
+  // the current solution. 'vars' are the variables stored in 'elite'; they
+  // must belong to the assignment of the local search, and the other
+  // variables of this assignment are not changed when restarting.
+  SolutionPool* MakeSharedSolutionPool(EliteSolutionPool* const elite,
+                                       const std::vector<IntVar*>& vars);
+
   // Local Search Phase Parameters
   LocalSearchPhaseParameters* MakeLocalSearchPhaseParameters(
       LocalSearchOperator* const ls_operator,
@@ -2843,6 +2979,11 @@ class Solver {
   // different from NO_PROFILING.
   void ExportProfilingOverview(const std::string& filename);
 
+  // Exports the profiling information in the collapsed stack format read
+  // by flame graph tools, grouping demon runtimes by constraint type and
+  // by constraint name. Same requirements as ExportProfilingOverview().
+  void ExportProfilingFlameGraph(const std::string& filename);
+
   // Returns true whether the current search has been
   // created using a Solve() call instead of a NewSearch 0ne. It
   // returns false if the solver is not is search at all.
@@ -2852,6 +2993,10 @@ class Solver {
   // to the solver before the search,
   int constraints() const { return constraints_list_.size(); }
 
+  // Returns the constraint number 'index' added to the solver before the
+  // search, in the order they were added (0 <= index < constraints()).
+  Constraint* constraint(int index) const { return constraints_list_[index]; }
+
   // Accepts the given model visitor.
   void Accept(ModelVisitor* const visitor) const;
   // Accepts the given model visitor.
@@ -2968,6 +3113,9 @@ class Solver {
   void PushSentinel(int magic_code);
   void BacktrackToSentinel(int magic_code);
   void ProcessConstraints();
+  // Removes the constraints of constraints_list_ which are implied by other
+  // constraints of the list, before they are posted.
+  void PresolveConstraints();
   bool BacktrackOneLevel(Decision** fd);
   void JumpToSentinelWhenNested();
   void JumpToSentinel();
@@ -2993,6 +3141,7 @@ class Solver {
   }
 
   BaseObject* SafeRevAlloc(BaseObject* ptr);
+  BaseObject* SafeRevAllocInArena(BaseObject* ptr);
 
   int* SafeRevAllocArray(int* ptr);
   int64* SafeRevAllocArray(int64* ptr);
@@ -3979,6 +4128,13 @@ class IntVar : public IntExpr {
   // This method intersects the current domain with the values in the array.
   virtual void SetValues(const std::vector<int64>& values);
 
+  // This method intersects the current domain with the values set in
+  // 'bitset': value v is kept if bit v - 'offset' of 'bitset' is set. The
+  // bitset is 'num_words' words long. Variables with a bitset domain do this
+  // one 64-bit word at a time.
+  virtual void IntersectWithBitset(const uint64* const bitset, int64 offset,
+                                   int num_words);
+
   // This method attaches a demon that will be awakened when the
   // variable is bound.
   virtual void WhenBound(Demon* d) = 0;
@@ -4246,6 +4402,9 @@ class NoGood {
   bool Apply(Solver* const solver);
   // Pretty print.
   std::string DebugString() const;
+  // Accessors to the terms, for nogood managers.
+  int size() const { return terms_.size(); }
+  NoGoodTerm* term(int index) const { return terms_[index]; }
   // TODO(user) : support interval variables and more types of constraints.
 
  private:
@@ -4528,10 +4687,35 @@ class SequenceVar : public PropagationBaseObject {
   int ComputeForwardFrontier();
   int ComputeBackwardFrontier();
   void UpdatePrevious() const;
+  // Advances the cached frontiers over the intervals ranked since the last
+  // call, and removes the ranked and unperformed intervals from the set of
+  // unranked intervals. This costs O(number of unranked intervals) instead of
+  // O(number of intervals), and the search state is restored on backtrack.
+  void UpdateRanking() const;
+  bool IsUnranked(int index) const {
+    return unranked_position_[index] < num_unranked_.Value();
+  }
+  void RemoveUnranked(int index) const;
 
   const std::vector<IntervalVar*> intervals_;
   const std::vector<IntVar*> nexts_;
   mutable std::vector<int> previous_;
+  // The first unbound next of the forward chain, and the first node of the
+  // backward chain, as of the last UpdateRanking(). The backward frontier is
+  // not maintained once the forward chain reaches the sentinel.
+  mutable Rev<int> forward_frontier_;
+  mutable Rev<int> backward_frontier_;
+  // The unranked intervals that may be performed are the first
+  // num_unranked_ elements of unranked_.
+  mutable std::vector<int> unranked_;
+  mutable std::vector<int> unranked_position_;
+  mutable NumericalRev<int> num_unranked_;
+  mutable NumericalRev<int> num_ranked_;
+  mutable NumericalRev<int> num_unperformed_;
+  // Previous links of the bound nexts of unranked intervals, used and reset
+  // by UpdateRanking().
+  mutable std::vector<int> ranking_previous_;
+  mutable std::vector<int> touched_nodes_;
 };
 
 // --------- Assignments ----------------------------
@@ -4799,6 +4983,12 @@ class AssignmentContainer {
   bool Empty() const { return elements_.empty(); }
   // Copies intersection of containers.
   void Copy(const AssignmentContainer<V, E>& container) {
+    Copy(container, nullptr);
+  }
+  // Copies intersection of containers, and appends the positions of the
+  // elements which were copied to 'positions' if it is not null.
+  void Copy(const AssignmentContainer<V, E>& container,
+            std::vector<int>* const positions) {
     for (int i = 0; i < container.elements_.size(); ++i) {
       const E& element = container.elements_[i];
       const V* const var = element.Var();
@@ -4809,15 +4999,22 @@ class AssignmentContainer {
         continue;
       }
       DCHECK_GE(index, 0);
-      E* const local_element = &elements_[index];
-      local_element->Copy(element);
-      if (element.Activated()) {
-        local_element->Activate();
-      } else {
-        local_element->Deactivate();
+      CopyElement(element, &elements_[index]);
+      if (positions != nullptr) {
+        positions->push_back(index);
       }
     }
   }
+  // Copies the elements at the given positions from 'container', which must
+  // hold the same variables at these positions. Runs in O(positions.size()).
+  void CopyPositions(const AssignmentContainer<V, E>& container,
+                     const std::vector<int>& positions) {
+    for (const int position : positions) {
+      const E& element = container.elements_[position];
+      DCHECK_EQ(element.Var(), elements_[position].Var());
+      CopyElement(element, &elements_[position]);
+    }
+  }
   bool Contains(const V* const var) const {
     int index;
     return Find(var, &index);
@@ -4891,6 +5088,14 @@ class AssignmentContainer {
   }
 
  private:
+  static void CopyElement(const E& element, E* const local_element) {
+    local_element->Copy(element);
+    if (element.Activated()) {
+      local_element->Activate();
+    } else {
+      local_element->Deactivate();
+    }
+  }
   void EnsureMapIsUpToDate() const {
     hash_map<const V*, int>* map =
         const_cast<hash_map<const V*, int>*>(&elements_map_);
@@ -4954,6 +5159,7 @@ class Assignment : public PropagationBaseObject {
 
   // Loads an assignment from a file; does not add variables to the
   // assignment (only the variables contained in the assignment are modified).
+  // Files written by Save() and SaveInChunks() are both supported.
   bool Load(const std::string& filename);
 #if !defined(SWIG)
   bool Load(File* file);
@@ -4961,6 +5167,10 @@ class Assignment : public PropagationBaseObject {
   void Load(const AssignmentProto& proto);
   // Saves the assignment to a file.
   bool Save(const std::string& filename) const;
+  // Saves the assignment to a chunked record file (see ChunkWriter in
+  // base/recordio.h), with at most elements_per_chunk variables per chunk.
+  // Unlike Save(), the assignment is never entirely serialized in memory.
+  bool SaveInChunks(const std::string& filename, int elements_per_chunk) const;
 #if !defined(SWIG)
   bool Save(File* file) const;
 #endif  // #if !defined(SWIG)
@@ -5065,6 +5275,18 @@ class Assignment : public PropagationBaseObject {
   bool Contains(const SequenceVar* const var) const;
   // Copies the intersection of the 2 assignments to the current assignment.
   void Copy(const Assignment* assignment);
+  // Same as Copy(), but also records which elements were copied. Tracked
+  // elements accumulate until the next call to RevertTracked().
+  void CopyTracked(const Assignment* assignment);
+  // Copies back from 'reference' the elements modified by CopyTracked()
+  // since the last call to RevertTracked(), and the objective. 'reference'
+  // must hold the same variables at the same positions as this assignment,
+  // which is the case if one was created or fully copied from the other.
+  // This makes
+  //   copy->CopyTracked(delta); ... copy->RevertTracked(reference);
+  // equivalent to a full copy->Copy(reference), at the cost of the size of
+  // the deltas instead of the size of the assignment.
+  void RevertTracked(const Assignment* reference);
 
   // TODO(user): Add iterators on elements to avoid exposing container class.
   const IntContainer& IntVarContainer() const { return int_var_container_; }
@@ -5096,6 +5318,10 @@ class Assignment : public PropagationBaseObject {
   IntervalContainer interval_var_container_;
   SequenceContainer sequence_var_container_;
   IntVarElement objective_element_;
+  // Positions of the elements modified by CopyTracked().
+  std::vector<int> tracked_int_vars_;
+  std::vector<int> tracked_interval_vars_;
+  std::vector<int> tracked_sequence_vars_;
   DISALLOW_COPY_AND_ASSIGN(Assignment);
 };
 
@@ -5198,12 +5424,17 @@ class Pack : public Constraint {
 
  private:
   bool IsInProcess() const;
+  void PushForced(int bin_index, int var_index);
+  void PushRemoved(int bin_index, int var_index);
   const std::vector<IntVar*> vars_;
   const int bins_;
   std::vector<Dimension*> dims_;
   std::unique_ptr<RevBitMatrix> unprocessed_;
   std::vector<std::vector<int> > forced_;
   std::vector<std::vector<int> > removed_;
+  // Bins (excluding the 'unassigned' bin) with a non empty forced_ or
+  // removed_ list since the last ClearAll().
+  std::vector<int> touched_bins_;
   std::vector<IntVarIterator*> holes_;
   uint64 stamp_;
   Demon* demon_;
@@ -53,6 +53,7 @@
 #define OR_TOOLS_CONSTRAINT_SOLVER_CONSTRAINT_SOLVERI_H_
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstddef>
 #include <functional>
@@ -65,6 +66,7 @@
 #include "base/commandlineflags.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/sysinfo.h"
 #include "base/timer.h"
 #include "base/join.h"
@@ -416,6 +418,51 @@ class RevSwitch {
   bool value_;
 };
 
+// Collects the indices of the variables of a constraint modified since the
+// last time they were processed. This lets a constraint batch its variable
+// events: per-variable demons only record the index and enqueue a single
+// delayed demon, which processes all modified variables in one call, instead
+// of running the full propagation once per variable. The collection is
+// implicitly emptied upon backtrack.
+class ModifiedVarBatch {
+ public:
+  explicit ModifiedVarBatch(int num_vars)
+      : in_batch_(num_vars, false), fail_stamp_(0) {}
+
+  // Records a modification of variable 'index'. Returns true if the variable
+  // was not in the batch yet.
+  bool Add(Solver* const solver, int index) {
+    if (fail_stamp_ != solver->fail_stamp()) {
+      Clear();
+      fail_stamp_ = solver->fail_stamp();
+    }
+    if (in_batch_[index]) return false;
+    in_batch_[index] = true;
+    modified_.push_back(index);
+    return true;
+  }
+  // Returns the indices of the variables modified since the last call to
+  // Clear(), in order of first modification.
+  const std::vector<int>& modified(Solver* const solver) {
+    if (fail_stamp_ != solver->fail_stamp()) {
+      Clear();
+      fail_stamp_ = solver->fail_stamp();
+    }
+    return modified_;
+  }
+  void Clear() {
+    for (const int index : modified_) {
+      in_batch_[index] = false;
+    }
+    modified_.clear();
+  }
+
+ private:
+  std::vector<bool> in_batch_;
+  std::vector<int> modified_;
+  uint64 fail_stamp_;
+};
+
 // This class represents a small reversible bitset (size <= 64).
 // This class is useful to maintain supports.
 class SmallRevBitSet {
@@ -512,6 +559,51 @@ class RevBitMatrix : private RevBitSet {
   const int64 columns_;
 };
 
+// This class represents a reversible sparse bitset. Only the non-zero words
+// are visited: their indices are kept at the front of a permutation of all
+// word indices, whose size is reversible. Words are saved at most once per
+// search node. Bulk operations go through a non-reversible temporary mask;
+// this is the data structure of the Compact-Table propagator for table
+// constraints.
+class SparseRevBitSet {
+ public:
+  // Creates a bitset of 'size' bits, all set to one.
+  explicit SparseRevBitSet(int64 size);
+  ~SparseRevBitSet();
+
+  // Returns true if all bits are zero.
+  bool Empty() const { return limit_.Value() == -1; }
+  // Returns the number of bits set to one.
+  int64 Cardinality() const;
+  // Returns the word at the given offset.
+  uint64 Word(int offset) const { return words_[offset]; }
+  // Returns true if 'mask' and the bitset share a bit in word 'offset'.
+  bool IntersectsAt(const uint64* const mask, int offset) const {
+    return (words_[offset] & mask[offset]) != 0;
+  }
+  // Returns the offset of a word where 'mask' and the bitset share a bit,
+  // -1 if there are none.
+  int FirstIntersectingWord(const uint64* const mask) const;
+
+  // Temporary mask operations, restricted to the non-zero words.
+  void ClearMask();
+  void OrMask(const uint64* const mask);
+  void ReverseMask();
+  // Intersects the bitset with the temporary mask. Returns true if the bitset
+  // changed.
+  bool IntersectWithMask(Solver* const solver);
+
+ private:
+  const int64 length_;
+  std::unique_ptr<uint64[]> words_;
+  std::unique_ptr<uint64[]> stamps_;
+  std::unique_ptr<uint64[]> mask_;
+  std::unique_ptr<int[]> index_;
+  Rev<int> limit_;
+
+  DISALLOW_COPY_AND_ASSIGN(SparseRevBitSet);
+};
+
 // @{
 // These methods represent generic demons that will call back a
 // method on the constraint during their Run method.
@@ -1251,10 +1343,27 @@ class PathOperator : public IntVarLocalSearchOperator {
   // Number of next variables.
   int number_of_nexts() const { return number_of_nexts_; }
 
+  // Restricts the exploration of the neighborhood to moves for which the nodes
+  // returned by GetNeighborPair() are neighbors according to 'are_neighbors'.
+  // This is typically used to only consider moves between close nodes, as
+  // defined by nearest-neighbor lists. Moves are skipped before being built
+  // unless the operator is incremental, in which case they are built but not
+  // returned.
+  void SetNeighborRestriction(std::function<bool(int64, int64)> are_neighbors) {
+    are_neighbors_ = std::move(are_neighbors);
+  }
+
  protected:
   // This method should not be overridden. Override MakeNeighbor() instead.
   bool MakeOneNeighbor() override;
 
+  // Sets 'node1' and 'node2' to the nodes which must be neighbors for the
+  // current move to be explored when a neighbor restriction is set; returns
+  // false if the current move is not subject to the restriction. By default,
+  // the nodes are the first two base nodes. Only depends on the current
+  // assignment, not on the changes made by MakeNeighbor().
+  virtual bool GetNeighborPair(int64* node1, int64* node2) const;
+
   // Returns the index of the variable corresponding to the ith base node.
   int64 BaseNode(int i) const { return base_nodes_[i]; }
   // Returns the index of the variable corresponding to the current path
@@ -1351,6 +1460,7 @@ class PathOperator : public IntVarLocalSearchOperator {
     return false;
   }
   bool IncrementPosition();
+  bool IsAllowedByNeighborRestriction() const;
   void InitializePathStarts();
   void InitializeInactives();
   void InitializeBaseNodes();
@@ -1366,6 +1476,7 @@ class PathOperator : public IntVarLocalSearchOperator {
   bool just_started_;
   bool first_start_;
   ResultCallback1<int, int64>* start_empty_path_class_;
+  std::function<bool(int64, int64)> are_neighbors_;
 };
 
 // ----- Operator Factories ------
@@ -1412,6 +1523,11 @@ class LocalSearchFilter : public BaseObject {
   virtual void Synchronize(const Assignment* assignment,
                            const Assignment* delta) = 0;
   virtual bool IsIncremental() const { return false; }
+  // Returns true if Accept() can be called concurrently on different deltas
+  // between two synchronizations, which requires Accept() to leave the
+  // filter unchanged. Such filters are run in parallel on the batches of
+  // neighbors of the local search (see --cp_local_search_batch_size).
+  virtual bool IsThreadSafe() const { return false; }
 };
 
 // ----- IntVarLocalSearchFilter -----
@@ -1456,6 +1572,59 @@ class IntVarLocalSearchFilter : public LocalSearchFilter {
   static const int kUnassigned;
 };
 
+// ----- Elite Solution Pool -----
+
+// A bounded pool of good and diverse solutions, which can be shared between
+// searches running in different solvers and threads. A solution is stored as
+// the values of a list of variables, all the searches sharing the pool using
+// corresponding variables in the same order, together with its objective
+// value (lower is better). Two solutions are considered the same if they
+// differ on fewer than 'min_distance' variables. All methods are thread-safe.
+//
+// Local searches publish to and restart from the pool through
+// Solver::MakeSharedSolutionPool(), and Solver::MakePathRelinkingOperator()
+// explores the solutions between the current one and a member of the pool.
+class EliteSolutionPool {
+ public:
+  EliteSolutionPool(int max_size, int min_distance);
+  ~EliteSolutionPool();
+
+  // Adds a solution. If a member is closer than min_distance, the solution
+  // replaces it if it is better. Otherwise, it is added if the pool is not
+  // full, or replaces the worst member if it is better. Returns true if the
+  // solution was added.
+  bool Add(const std::vector<int64>& values, int64 objective);
+  // Copies the best member; returns false if the pool is empty.
+  bool GetBest(std::vector<int64>* const values, int64* const objective) const;
+  // Copies the member at 'index' modulo size(); returns false if the pool is
+  // empty.
+  bool Get(int index, std::vector<int64>* const values,
+           int64* const objective) const;
+  int size() const;
+  // Objective value of the best member, kint64max if the pool is empty.
+  // Lock-free, so that searches can poll it often.
+  int64 best_objective() const { return best_objective_.load(); }
+
+  // Number of variables on which two solutions differ.
+  static int Distance(const std::vector<int64>& a, const std::vector<int64>& b);
+
+ private:
+  struct Member {
+    std::vector<int64> values;
+    int64 objective;
+  };
+
+  void UpdateBest();
+
+  const int max_size_;
+  const int min_distance_;
+  mutable Mutex mutex_;
+  std::vector<Member> members_;
+  std::atomic<int64> best_objective_;
+
+  DISALLOW_COPY_AND_ASSIGN(EliteSolutionPool);
+};
+
 // ---------- PropagationMonitor ----------
 
 class PropagationMonitor : public SearchMonitor {
@@ -2538,6 +2707,16 @@ inline int64 PosIntDivDown(int64 e, int64 v) {
 
 // ----- Vector of integer manipulations -----
 std::vector<int64> ToInt64Vector(const std::vector<int>& input);
+
+// ----- Linear expressions -----
+
+// Flattens the linear part of an expression tree (sums, differences,
+// opposites and products by constants, including those behind cast
+// variables) into sum(coefs[i] * vars[i]) + constant, where vars are the
+// non-linear leaves of the tree cast to variables. Terms on the same
+// variable are merged.
+void LinearizeExpression(IntExpr* const expr, std::vector<IntVar*>* vars,
+                         std::vector<int64>* coefs, int64* constant);
 }  // namespace operations_research
 
 #endif  // OR_TOOLS_CONSTRAINT_SOLVER_CONSTRAINT_SOLVERI_H_
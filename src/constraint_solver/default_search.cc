@@ -26,8 +26,10 @@
 #include "base/macros.h"
 
 #include "base/stl_util.h"
+#include "base/threadpool.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
+#include "constraint_solver/model.pb.h"
 #include "util/cached_log.h"
 #include "util/string_array.h"
 #include "base/random.h"
@@ -53,6 +55,7 @@ DefaultPhaseParameters::DefaultPhaseParameters()
     : var_selection_schema(DefaultPhaseParameters::CHOOSE_MAX_SUM_IMPACT),
       value_selection_schema(DefaultPhaseParameters::SELECT_MIN_IMPACT),
       initialization_splits(kDefaultNumberOfSplits),
+      initialization_threads(1),
       run_all_heuristics(true),
       heuristic_period(kDefaultHeuristicPeriod),
       heuristic_num_failures_limit(kDefaultHeuristicNumFailuresLimit),
@@ -464,7 +467,7 @@ class ImpactRecorder : public SearchMonitor {
     init_count_++;
   }
 
-  void FirstRun(int64 splits) {
+  void FirstRun(int64 splits, int num_threads) {
     Solver* const s = solver();
     current_log_space_ = domain_watcher_->LogSearchSpaceSize();
     if (display_level_ != DefaultPhaseParameters::NONE) {
@@ -475,50 +478,18 @@ class ImpactRecorder : public SearchMonitor {
     int64 removed_counter = 0;
     FirstRunVariableContainers* container =
         s->RevAlloc(new FirstRunVariableContainers(this, splits));
-    // Loop on the variables, scan domains and initialize impacts.
-    for (int var_index = 0; var_index < size_; ++var_index) {
-      IntVar* const var = vars_[var_index];
-      if (var->Bound()) {
-        continue;
-      }
-      IntVarIterator* const iterator = domain_iterators_[var_index];
-      DecisionBuilder* init_decision_builder = nullptr;
-      const bool no_split = var->Size() < splits;
-      if (no_split) {
-        // The domain is small enough, we scan it completely.
-        container->without_split()->set_update_impact_callback(
-            container->update_impact_callback());
-        container->without_split()->Init(var, iterator, var_index);
-        init_decision_builder = container->without_split();
-      } else {
-        // The domain is too big, we scan it in initialization_splits
-        // intervals.
-        container->with_splits()->set_update_impact_callback(
-            container->update_impact_callback());
-        container->with_splits()->Init(var, iterator, var_index);
-        init_decision_builder = container->with_splits();
-      }
-      // Reset the number of impacts initialized.
-      init_count_ = 0;
-      // Use Solve() to scan all values of one variable.
-      s->Solve(init_decision_builder);
-
-      // If we have not initialized all values, then they can be removed.
-      // As the iterator is not stable w.r.t. deletion, we need to store
-      // removed values in an intermediate vector.
-      if (init_count_ != var->Size() && no_split) {
-        container->ClearRemovedValues();
-        for (const int64 value : InitAndGetValues(iterator)) {
-          const int64 value_index = value - original_min_[var_index];
-          if (impacts_[var_index][value_index] == kInitFailureImpact) {
-            container->PushBackRemovedValue(value);
-          }
+    if (num_threads > 1 && ParallelFirstRun(splits, num_threads)) {
+      // Values which failed in the workers can be removed.
+      for (int var_index = 0; var_index < size_; ++var_index) {
+        IntVar* const var = vars_[var_index];
+        if (!var->Bound() && var->Size() < splits) {
+          removed_counter += RemoveFailedValues(var_index, container);
         }
-        CHECK(container->HasRemovedValues()) << var->DebugString();
-        removed_counter += container->NumRemovedValues();
-        const double old_log = domain_watcher_->Log2(var->Size());
-        var->RemoveValues(container->removed_values());
-        current_log_space_ += domain_watcher_->Log2(var->Size()) - old_log;
+      }
+    } else {
+      // Loop on the variables, scan domains and initialize impacts.
+      for (int var_index = 0; var_index < size_; ++var_index) {
+        removed_counter += InitVariable(var_index, splits, container);
       }
     }
     if (display_level_ != DefaultPhaseParameters::NONE) {
@@ -627,6 +598,148 @@ class ImpactRecorder : public SearchMonitor {
     InitVarImpactsWithSplits with_splits_;
   };
 
+  // A copy of the model probing every num_workers-th variable, starting at
+  // its own index, on behalf of the main recorder.
+  struct FirstRunWorker {
+    std::unique_ptr<Solver> solver;
+    std::unique_ptr<DomainWatcher> domain_watcher;
+    std::unique_ptr<ImpactRecorder> recorder;
+  };
+
+  // Scans the values of one variable, and removes from its domain the
+  // values which fail. Returns the number of values removed.
+  int64 InitVariable(int var_index, int64 splits,
+                     FirstRunVariableContainers* const container) {
+    IntVar* const var = vars_[var_index];
+    if (var->Bound()) {
+      return 0;
+    }
+    IntVarIterator* const iterator = domain_iterators_[var_index];
+    DecisionBuilder* init_decision_builder = nullptr;
+    const bool no_split = var->Size() < splits;
+    if (no_split) {
+      // The domain is small enough, we scan it completely.
+      container->without_split()->set_update_impact_callback(
+          container->update_impact_callback());
+      container->without_split()->Init(var, iterator, var_index);
+      init_decision_builder = container->without_split();
+    } else {
+      // The domain is too big, we scan it in initialization_splits
+      // intervals.
+      container->with_splits()->set_update_impact_callback(
+          container->update_impact_callback());
+      container->with_splits()->Init(var, iterator, var_index);
+      init_decision_builder = container->with_splits();
+    }
+    // Reset the number of impacts initialized.
+    init_count_ = 0;
+    // Use Solve() to scan all values of one variable.
+    solver()->Solve(init_decision_builder);
+
+    // If we have not initialized all values, then they can be removed.
+    if (init_count_ != var->Size() && no_split) {
+      const int64 removed = RemoveFailedValues(var_index, container);
+      CHECK_LT(0, removed) << var->DebugString();
+      return removed;
+    }
+    return 0;
+  }
+
+  // Removes the values of a variable whose impact was not initialized.
+  int64 RemoveFailedValues(int var_index,
+                           FirstRunVariableContainers* const container) {
+    IntVar* const var = vars_[var_index];
+    // As the iterator is not stable w.r.t. deletion, we need to store
+    // removed values in an intermediate vector.
+    container->ClearRemovedValues();
+    for (const int64 value : InitAndGetValues(domain_iterators_[var_index])) {
+      const int64 value_index = value - original_min_[var_index];
+      if (impacts_[var_index][value_index] == kInitFailureImpact) {
+        container->PushBackRemovedValue(value);
+      }
+    }
+    if (!container->HasRemovedValues()) {
+      return 0;
+    }
+    const double old_log = domain_watcher_->Log2(var->Size());
+    var->RemoveValues(container->removed_values());
+    current_log_space_ += domain_watcher_->Log2(var->Size()) - old_log;
+    return container->NumRemovedValues();
+  }
+
+  // Probes the variables first, first + step, ... of a worker copy. Called
+  // on the recorder of the worker.
+  void WorkerFirstRun(int first, int step, int64 splits) {
+    current_log_space_ = domain_watcher_->LogSearchSpaceSize();
+    ResetAllImpacts();
+    FirstRunVariableContainers container(this, splits);
+    for (int var_index = first; var_index < size_; var_index += step) {
+      InitVariable(var_index, splits, &container);
+    }
+  }
+
+  // Copies the model into num_threads solvers, probes the variables in
+  // parallel, and merges the impacts. Returns false if the model cannot be
+  // copied, in which case nothing has been done.
+  bool ParallelFirstRun(int64 splits, int num_threads) {
+    CPModelProto proto;
+    std::vector<int> indices;
+    solver()->ExportModel(vars_, &proto, &indices);
+    // Workers are built sequentially, as Solver construction is not
+    // thread-safe w.r.t. flags and static initializations.
+    std::vector<std::unique_ptr<FirstRunWorker> > workers;
+    for (int w = 0; w < num_threads; ++w) {
+      workers.emplace_back(new FirstRunWorker);
+      FirstRunWorker* const worker = workers.back().get();
+      worker->solver.reset(
+          new Solver(StringPrintf("ImpactInitWorker%d", w)));
+      Solver* const worker_solver = worker->solver.get();
+      std::vector<IntExpr*> expressions;
+      if (!worker_solver->LoadModel(proto, nullptr, &expressions)) {
+        LOG(WARNING) << "Cannot copy the model, impacts are initialized "
+                     << "sequentially";
+        return false;
+      }
+      std::vector<IntVar*> worker_vars(size_);
+      for (int i = 0; i < size_; ++i) {
+        if (indices[i] >= 0 && indices[i] < expressions.size() &&
+            expressions[indices[i]] != nullptr) {
+          worker_vars[i] = expressions[indices[i]]->Var();
+        } else {
+          // Variables outside of any constraint are not exported; a fresh
+          // variable with the same domain has the same impacts.
+          std::vector<int64> values;
+          for (const int64 value : InitAndGetValues(domain_iterators_[i])) {
+            values.push_back(value);
+          }
+          worker_vars[i] = worker_solver->MakeIntVar(values);
+        }
+      }
+      worker->domain_watcher.reset(
+          new DomainWatcher(worker_vars, kLogCacheSize));
+      worker->recorder.reset(
+          new ImpactRecorder(worker_solver, worker->domain_watcher.get(),
+                             worker_vars, DefaultPhaseParameters::NONE));
+    }
+    {
+      ThreadPool pool("ImpactInit", num_threads);
+      for (int w = 0; w < num_threads; ++w) {
+        pool.Add(NewCallback(workers[w]->recorder.get(),
+                             &ImpactRecorder::WorkerFirstRun, w, num_threads,
+                             splits));
+      }
+      pool.StartWorkers();
+    }
+    for (int w = 0; w < num_threads; ++w) {
+      const ImpactRecorder& recorder = *workers[w]->recorder;
+      for (int var_index = w; var_index < size_; var_index += num_threads) {
+        DCHECK_EQ(original_min_[var_index], recorder.original_min_[var_index]);
+        impacts_[var_index] = recorder.impacts_[var_index];
+      }
+    }
+    return true;
+  }
+
   DomainWatcher* const domain_watcher_;
   std::vector<IntVar*> vars_;
   const int size_;
@@ -1312,7 +1425,8 @@ class DefaultIntegerSearch : public DecisionBuilder {
                   << ", restart_log_size = " << parameters_.restart_log_size;
       }
       // Init the impacts.
-      impact_recorder_.FirstRun(parameters_.initialization_splits);
+      impact_recorder_.FirstRun(parameters_.initialization_splits,
+                                parameters_.initialization_threads);
     }
     if (parameters_.persistent_impact) {
       init_done_ = true;
@@ -15,6 +15,7 @@
 #include <algorithm>
 #include <cmath>
 #include <cstddef>
+#include <functional>
 #include "base/hash.h"
 #include <string>
 #include <utility>
@@ -26,11 +27,17 @@
 #include "base/file.h"
 #include "base/stl_util.h"
 #include "base/hash.h"
+#include "base/map_util.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
 #include "constraint_solver/demon_profiler.pb.h"
 #include "base/status.h"
 
+DEFINE_int32(cp_profile_sampling_period, 0,
+             "If > 0, only one demon run out of this many is timed by the "
+             "demon profiler. The runtime of the other runs is extrapolated "
+             "from the timed ones.");
+
 namespace operations_research {
 namespace {
 struct Container {
@@ -40,6 +47,37 @@ struct Container {
   const Constraint* ct;
   int64 value;
 };
+
+// Retrieves the type name a constraint reports to model visitors.
+class ConstraintTypeVisitor : public ModelVisitor {
+ public:
+  ConstraintTypeVisitor() {}
+  ~ConstraintTypeVisitor() override {}
+
+  void BeginVisitConstraint(const std::string& type_name,
+                            const Constraint* const constraint) override {
+    if (type_name_.empty()) {
+      type_name_ = type_name;
+    }
+  }
+
+  const std::string& type_name() const { return type_name_; }
+
+ private:
+  std::string type_name_;
+};
+
+// Frames of the collapsed stack format are separated by ';' and the
+// sample count is separated from the stack by the last space.
+std::string FlameFrame(const std::string& name) {
+  std::string frame = name;
+  for (int i = 0; i < frame.size(); ++i) {
+    if (frame[i] == ';' || frame[i] == '\n') {
+      frame[i] = ',';
+    }
+  }
+  return frame.empty() ? "unnamed" : frame;
+}
 }  // namespace
 
 // DemonProfiler manages the profiling of demons and allows access to gathered
@@ -51,6 +89,9 @@ class DemonProfiler : public PropagationMonitor {
       : PropagationMonitor(solver),
         active_constraint_(nullptr),
         active_demon_(nullptr),
+        active_demon_sampled_(false),
+        sampling_period_(std::max(1, FLAGS_cp_profile_sampling_period)),
+        sampling_counter_(0),
         start_time_ns_(base::GetCurrentTimeNanos()) {}
 
   ~DemonProfiler() override {
@@ -148,6 +189,17 @@ class DemonProfiler : public PropagationMonitor {
     CHECK(active_demon_ == nullptr);
     CHECK(demon != nullptr);
     active_demon_ = demon;
+    // In sampling mode, runs in between two samples are only counted. This
+    // skips both the clock reads and the growth of the run protos.
+    active_demon_sampled_ = ++sampling_counter_ >= sampling_period_;
+    if (!active_demon_sampled_) {
+      const DemonRuns* const demon_run = demon_map_[active_demon_];
+      if (demon_run != nullptr) {
+        ++unsampled_runs_[demon_run];
+      }
+      return;
+    }
+    sampling_counter_ = 0;
     DemonRuns* const demon_run = demon_map_[active_demon_];
     if (demon_run != nullptr) {
       demon_run->add_start_time(CurrentTime());
@@ -160,9 +212,11 @@ class DemonProfiler : public PropagationMonitor {
     }
     CHECK_EQ(active_demon_, demon);
     CHECK(demon != nullptr);
-    DemonRuns* const demon_run = demon_map_[active_demon_];
-    if (demon_run != nullptr) {
-      demon_run->add_end_time(CurrentTime());
+    if (active_demon_sampled_) {
+      DemonRuns* const demon_run = demon_map_[active_demon_];
+      if (demon_run != nullptr) {
+        demon_run->add_end_time(CurrentTime());
+      }
     }
     active_demon_ = nullptr;
   }
@@ -176,7 +230,9 @@ class DemonProfiler : public PropagationMonitor {
     if (active_demon_ != nullptr) {
       DemonRuns* const demon_run = demon_map_[active_demon_];
       if (demon_run != nullptr) {
-        demon_run->add_end_time(CurrentTime());
+        if (active_demon_sampled_) {
+          demon_run->add_end_time(CurrentTime());
+        }
         demon_run->set_failures(demon_run->failures() + 1);
       }
       active_demon_ = nullptr;
@@ -199,6 +255,8 @@ class DemonProfiler : public PropagationMonitor {
     constraint_map_.clear();
     demon_map_.clear();
     demons_per_constraint_.clear();
+    unsampled_runs_.clear();
+    sampling_counter_ = 0;
   }
 
   // IntExpr modifiers.
@@ -322,6 +380,74 @@ class DemonProfiler : public PropagationMonitor {
     file->Close();
   }
 
+  // Exports the demon runtimes in the collapsed stack format used by
+  // flamegraph.pl. Each line reads
+  //   model;constraint type;constraint name;demon runtime_in_us
+  // so that flame graphs group time first by the type of constraint, then
+  // by model-level constraint. Initial propagations appear as a pseudo
+  // demon named "initial_propagation".
+  void PrintFlameGraph(Solver* const solver, const std::string& filename) {
+    File* const file = File::Open(filename, "w");
+    if (file == nullptr) {
+      return;
+    }
+    const std::string model = FlameFrame(solver->model_name());
+    for (hash_map<const Constraint*, ConstraintRuns*>::const_iterator it =
+             constraint_map_.begin();
+         it != constraint_map_.end(); ++it) {
+      const Constraint* const ct = it->first;
+      ConstraintTypeVisitor visitor;
+      ct->Accept(&visitor);
+      const std::string name = ct->HasName() ? ct->name() : ct->DebugString();
+      const std::string prefix =
+          StringPrintf("%s;%s;%s", model.c_str(),
+                       FlameFrame(visitor.type_name()).c_str(),
+                       FlameFrame(name).c_str());
+      const ConstraintRuns* const ct_run = it->second;
+      int64 initial_propagation_runtime = 0;
+      for (int i = 0; i < ct_run->initial_propagation_start_time_size(); ++i) {
+        initial_propagation_runtime +=
+            ct_run->initial_propagation_end_time(i) -
+            ct_run->initial_propagation_start_time(i);
+      }
+      if (initial_propagation_runtime > 0) {
+        file::WriteString(file,
+                          StringPrintf("%s;initial_propagation %" GG_LL_FORMAT
+                                       "d\n",
+                                       prefix.c_str(),
+                                       initial_propagation_runtime),
+                          file::Defaults()).IgnoreError();
+      }
+      for (DemonRuns* const demon_runs : demons_per_constraint_[ct]) {
+        int64 invocations = 0;
+        int64 fails = 0;
+        int64 runtime = 0;
+        double mean_runtime = 0;
+        double median_runtime = 0;
+        double standard_deviation = 0.0;
+        ExportInformation(demon_runs, &invocations, &fails, &runtime,
+                          &mean_runtime, &median_runtime, &standard_deviation);
+        if (runtime > 0) {
+          file::WriteString(
+              file, StringPrintf("%s;%s %" GG_LL_FORMAT "d\n", prefix.c_str(),
+                                 FlameFrame(demon_runs->demon_id()).c_str(),
+                                 runtime),
+              file::Defaults()).IgnoreError();
+        }
+      }
+    }
+    file->Close();
+  }
+
+  // Calls 'visit' on each constraint that has been profiled.
+  void VisitConstraints(std::function<void(const Constraint*)> visit) const {
+    for (hash_map<const Constraint*, ConstraintRuns*>::const_iterator it =
+             constraint_map_.begin();
+         it != constraint_map_.end(); ++it) {
+      visit(it->first);
+    }
+  }
+
   // Export Information
   void ExportInformation(const Constraint* const constraint, int64* const fails,
                          int64* const initial_propagation_runtime,
@@ -343,16 +469,19 @@ class DemonProfiler : public PropagationMonitor {
     *demons = ct_run->demons_size();
     CHECK_EQ(*demons, demons_per_constraint_[constraint].size());
     for (int demon_index = 0; demon_index < *demons; ++demon_index) {
-      const DemonRuns& demon_runs = ct_run->demons(demon_index);
-      *fails += demon_runs.failures();
-      CHECK_EQ(demon_runs.start_time_size(), demon_runs.end_time_size());
-      const int runs = demon_runs.start_time_size();
-      *demon_invocations += runs;
-      for (int run_index = 0; run_index < runs; ++run_index) {
-        const int64 demon_time =
-            demon_runs.end_time(run_index) - demon_runs.start_time(run_index);
-        *total_demon_runtime += demon_time;
-      }
+      const DemonRuns* const demon_runs =
+          demons_per_constraint_[constraint][demon_index];
+      int64 invocations = 0;
+      int64 demon_fails = 0;
+      int64 demon_runtime = 0;
+      double mean_runtime = 0;
+      double median_runtime = 0;
+      double standard_deviation = 0.0;
+      ExportInformation(demon_runs, &invocations, &demon_fails, &demon_runtime,
+                        &mean_runtime, &median_runtime, &standard_deviation);
+      *fails += demon_fails;
+      *demon_invocations += invocations;
+      *total_demon_runtime += demon_runtime;
     }
   }
 
@@ -366,7 +495,7 @@ class DemonProfiler : public PropagationMonitor {
     CHECK_EQ(demon_runs->start_time_size(), demon_runs->end_time_size());
 
     const int runs = demon_runs->start_time_size();
-    *demon_invocations = runs;
+    *demon_invocations = runs + FindWithDefault(unsampled_runs_, demon_runs, 0);
     *fails = demon_runs->failures();
     *total_demon_runtime = 0;
     *mean_demon_runtime = 0.0;
@@ -379,9 +508,14 @@ class DemonProfiler : public PropagationMonitor {
       *total_demon_runtime += demon_time;
       runtimes.push_back(demon_time);
     }
+    // Extrapolates the total runtime from the sampled runs.
+    if (runs > 0 && *demon_invocations > runs) {
+      *total_demon_runtime = static_cast<int64>(
+          (1.0L * *total_demon_runtime * *demon_invocations) / runs);
+    }
     // Compute mean.
     if (!runtimes.empty()) {
-      *mean_demon_runtime = (1.0L * *total_demon_runtime) / runtimes.size();
+      *mean_demon_runtime = (1.0L * *total_demon_runtime) / *demon_invocations;
 
       // Compute median.
       std::sort(runtimes.begin(), runtimes.end());
@@ -417,10 +551,15 @@ class DemonProfiler : public PropagationMonitor {
  private:
   Constraint* active_constraint_;
   Demon* active_demon_;
+  bool active_demon_sampled_;
+  const int sampling_period_;
+  int sampling_counter_;
   const int64 start_time_ns_;
   hash_map<const Constraint*, ConstraintRuns*> constraint_map_;
   hash_map<const Demon*, DemonRuns*> demon_map_;
   hash_map<const Constraint*, std::vector<DemonRuns*> > demons_per_constraint_;
+  // Number of runs that were counted but not timed in sampling mode.
+  hash_map<const DemonRuns*, int64> unsampled_runs_;
 };
 
 void Solver::ExportProfilingOverview(const std::string& filename) {
@@ -429,6 +568,12 @@ void Solver::ExportProfilingOverview(const std::string& filename) {
   }
 }
 
+void Solver::ExportProfilingFlameGraph(const std::string& filename) {
+  if (demon_profiler_ != nullptr) {
+    demon_profiler_->PrintFlameGraph(this, filename);
+  }
+}
+
 // ----- Exported Functions -----
 
 void InstallDemonProfiler(DemonProfiler* const monitor) { monitor->Install(); }
@@ -475,6 +620,12 @@ void DemonProfilerExportInformation(DemonProfiler* const monitor,
                              demon_count);
 }
 
+void DemonProfilerVisitConstraints(
+    DemonProfiler* const monitor,
+    std::function<void(const Constraint*)> visit) {
+  monitor->VisitConstraints(visit);
+}
+
 void DemonProfilerBeginInitialPropagation(DemonProfiler* const monitor,
                                           Constraint* const constraint) {
   monitor->BeginConstraintInitialPropagation(constraint);
@@ -139,11 +139,26 @@ class Diffn : public Constraint {
   }
 
  private:
+  // Below this number of boxes to propagate, their neighbors are found by
+  // scanning all the boxes for each of them; above, by a sweep over all the
+  // boxes.
+  static const int kMinBoxesForSweep = 32;
+
   void PropagateAll() {
-    for (const int box : to_propagate_) {
-      FillNeighbors(box);
-      FailWhenEnergyIsTooLarge(box);
-      PushOverlappingBoxes(box);
+    if (to_propagate_.size() >= kMinBoxesForSweep) {
+      FillAllNeighborsBySweep();
+      for (const int box : to_propagate_) {
+        neighbors_.swap(box_neighbors_[box]);
+        FailWhenEnergyIsTooLarge(box);
+        PushOverlappingBoxes(box);
+        neighbors_.swap(box_neighbors_[box]);
+      }
+    } else {
+      for (const int box : to_propagate_) {
+        FillNeighbors(box);
+        FailWhenEnergyIsTooLarge(box);
+        PushOverlappingBoxes(box);
+      }
     }
     to_propagate_.clear();
     fail_stamp_ = solver()->fail_stamp();
@@ -192,6 +207,44 @@ class Diffn : public Constraint {
     }
   }
 
+  // Fills box_neighbors_[box] for all the boxes to propagate, in
+  // O(n.log(n) + number of pairs of boxes whose x ranges can intersect):
+  // the x ranges [x.Min(), x.Max() + dx.Max()) of all the boxes are swept
+  // by increasing start, and each box is compared to the boxes whose range
+  // contains its start. Since domains only shrink, the lists remain supersets
+  // of the neighbors while the boxes are pushed.
+  void FillAllNeighborsBySweep() {
+    box_neighbors_.resize(size_);
+    to_propagate_flags_.assign(size_, false);
+    for (const int box : to_propagate_) {
+      box_neighbors_[box].clear();
+      to_propagate_flags_[box] = true;
+    }
+    sweep_events_.clear();
+    for (int box = 0; box < size_; ++box) {
+      sweep_events_.push_back(std::make_pair(x_[box]->Min(), box));
+    }
+    std::sort(sweep_events_.begin(), sweep_events_.end());
+    active_boxes_.clear();
+    for (const std::pair<int64, int>& event : sweep_events_) {
+      const int box = event.second;
+      int num_active = 0;
+      for (const int other : active_boxes_) {
+        // The ranges of the boxes which end before the start of this one
+        // are removed from the sweep.
+        if (x_[other]->Max() + dx_[other]->Max() <= event.first) continue;
+        active_boxes_[num_active++] = other;
+        if ((to_propagate_flags_[box] || to_propagate_flags_[other]) &&
+            CanBoxedOverlap(box, other)) {
+          if (to_propagate_flags_[box]) box_neighbors_[box].push_back(other);
+          if (to_propagate_flags_[other]) box_neighbors_[other].push_back(box);
+        }
+      }
+      active_boxes_.resize(num_active);
+      active_boxes_.push_back(box);
+    }
+  }
+
   // Fails if the minimum area of the given box plus the area of its neighbors
   // (that must already be computed in neighbors_) is greater than the area of a
   // bounding box that necessarily contains all these boxes.
@@ -292,6 +345,11 @@ class Diffn : public Constraint {
   Demon* delayed_demon_;
   hash_set<int> to_propagate_;
   std::vector<int> neighbors_;
+  // Scratch data of FillAllNeighborsBySweep().
+  std::vector<std::vector<int>> box_neighbors_;
+  std::vector<bool> to_propagate_flags_;
+  std::vector<std::pair<int64, int>> sweep_events_;
+  std::vector<int> active_boxes_;
   uint64 fail_stamp_;
 };
 }  // namespace
@@ -24,6 +24,7 @@
 #include "base/join.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
+#include "util/bitset.h"
 #include "util/iterators.h"
 #include "util/range_minimum_query.h"
 #include "util/string_array.h"
@@ -32,6 +33,10 @@ DEFINE_bool(cp_disable_element_cache, true,
             "If true, caching for IntElement is disabled.");
 DEFINE_bool(cp_use_element_rmq, true,
             "If true, rmq's will be used in element expressions.");
+DEFINE_int32(cp_large_element_size, 4096,
+             "Element constraints on constant arrays at least this large keep "
+             "the indices sorted by value instead of scanning the index "
+             "domain.");
 
 namespace operations_research {
 
@@ -284,6 +289,133 @@ class IntElementConstraint : public CastConstraint {
   std::vector<int64> to_remove_;
 };
 
+// ----- LargeIntElementConstraint -----
+
+// This constraint implements 'elem' == 'values'['index'] for large arrays.
+// The indices are sorted by value once. The positions [low_, high_] of the
+// sorted array delimit the indices compatible with the bounds of 'elem';
+// the indices at low_ and high_ are in the domain of 'index' and support the
+// bounds of 'elem'. A propagation only looks at the positions leaving this
+// window, and at the supports: it does not scan the domain of 'index'.
+// Indices are removed in bulk, through a bitset when there are many of them.
+class LargeIntElementConstraint : public CastConstraint {
+ public:
+  LargeIntElementConstraint(Solver* const s, const std::vector<int64>& values,
+                            IntVar* const index, IntVar* const elem)
+      : CastConstraint(s, elem),
+        values_(values),
+        index_(index),
+        low_(0),
+        high_(values.size() - 1) {
+    CHECK(index != nullptr);
+    const int size = values_.size();
+    std::vector<std::pair<int64, int>> sorted(size);
+    for (int i = 0; i < size; ++i) {
+      sorted[i] = std::make_pair(values_[i], i);
+    }
+    std::sort(sorted.begin(), sorted.end());
+    // Values and indices are kept apart so that binary searches only touch
+    // the values.
+    sorted_values_.resize(size);
+    sorted_indices_.resize(size);
+    for (int i = 0; i < size; ++i) {
+      sorted_values_[i] = sorted[i].first;
+      sorted_indices_[i] = sorted[i].second;
+    }
+  }
+
+  void Post() override {
+    Demon* const d =
+        solver()->MakeDelayedConstraintInitialPropagateCallback(this);
+    index_->WhenDomain(d);
+    target_var_->WhenRange(d);
+  }
+
+  void InitialPropagate() override {
+    index_->SetRange(0, values_.size() - 1);
+    int low = low_.Value();
+    int high = high_.Value();
+    const std::vector<int64>::const_iterator begin = sorted_values_.begin();
+    const int new_low =
+        std::lower_bound(begin + low, begin + high + 1, target_var_->Min()) -
+        begin;
+    const int new_high = std::upper_bound(begin + new_low, begin + high + 1,
+                                          target_var_->Max()) -
+                         begin - 1;
+    if (new_low > new_high) {
+      solver()->Fail();
+    }
+    to_remove_.clear();
+    for (int position = low; position < new_low; ++position) {
+      to_remove_.push_back(sorted_indices_[position]);
+    }
+    for (int position = new_high + 1; position <= high; ++position) {
+      to_remove_.push_back(sorted_indices_[position]);
+    }
+    RemoveIndices();
+    // Moves the supports to the first and last indices still in the domain.
+    low = new_low;
+    while (low <= new_high && !index_->Contains(sorted_indices_[low])) {
+      ++low;
+    }
+    high = new_high;
+    while (high >= low && !index_->Contains(sorted_indices_[high])) {
+      --high;
+    }
+    if (low > high) {
+      solver()->Fail();
+    }
+    low_.SetValue(solver(), low);
+    high_.SetValue(solver(), high);
+    target_var_->SetRange(sorted_values_[low], sorted_values_[high]);
+  }
+
+  std::string DebugString() const override {
+    return StringPrintf("LargeIntElementConstraint(%d values, %s, %s)",
+                        static_cast<int>(values_.size()),
+                        index_->DebugString().c_str(),
+                        target_var_->DebugString().c_str());
+  }
+
+  void Accept(ModelVisitor* const visitor) const override {
+    visitor->BeginVisitConstraint(ModelVisitor::kElementEqual, this);
+    visitor->VisitIntegerArrayArgument(ModelVisitor::kValuesArgument, values_);
+    visitor->VisitIntegerExpressionArgument(ModelVisitor::kIndexArgument,
+                                            index_);
+    visitor->VisitIntegerExpressionArgument(ModelVisitor::kTargetArgument,
+                                            target_var_);
+    visitor->EndVisitConstraint(ModelVisitor::kElementEqual, this);
+  }
+
+ private:
+  // Removes the indices in to_remove_ from the domain of index_. Few indices
+  // are sorted and removed as a list; many are cleared in a bitset of the
+  // kept indices, which is intersected with the domain a word at a time.
+  void RemoveIndices() {
+    if (to_remove_.empty()) return;
+    const int num_words = BitLength64(values_.size());
+    if (to_remove_.size() < num_words) {
+      std::sort(to_remove_.begin(), to_remove_.end());
+      index_->RemoveValues(to_remove_);
+    } else {
+      kept_indices_.assign(num_words, kAllBits64);
+      for (const int64 index : to_remove_) {
+        ClearBit64(kept_indices_.data(), index);
+      }
+      index_->IntersectWithBitset(kept_indices_.data(), 0, num_words);
+    }
+  }
+
+  const std::vector<int64> values_;
+  IntVar* const index_;
+  std::vector<int64> sorted_values_;
+  std::vector<int> sorted_indices_;
+  Rev<int> low_;
+  Rev<int> high_;
+  std::vector<int64> to_remove_;
+  std::vector<uint64> kept_indices_;
+};
+
 // ----- IntExprElement
 
 IntVar* BuildDomainIntVar(Solver* const solver, std::vector<int64>* values);
@@ -628,6 +760,14 @@ IntExpr* BuildElement(Solver* const solver, const std::vector<int64>& values,
     } else if (IsIncreasing(values)) {
       result = solver->RegisterIntExpr(solver->RevAlloc(
           new IncreasingIntExprElement(solver, values, index)));
+    } else if (values.size() >= FLAGS_cp_large_element_size) {
+      const int64 min_value = *std::min_element(values.begin(), values.end());
+      const int64 max_value = *std::max_element(values.begin(), values.end());
+      IntVar* const var =
+          solver->MakeIntVar(min_value, max_value, "LargeElementVar");
+      solver->AddConstraint(solver->RevAlloc(
+          new LargeIntElementConstraint(solver, values, index, var)));
+      result = var;
     } else {
       if (FLAGS_cp_use_element_rmq) {
         result = solver->RegisterIntExpr(solver->RevAlloc(
@@ -1586,6 +1726,9 @@ Constraint* MakeElementEqualityFunc(Solver* const solver,
   } else {
     if (IsIncreasingContiguous(vals)) {
       return solver->MakeEquality(target, solver->MakeSum(index, vals[0]));
+    } else if (vals.size() >= FLAGS_cp_large_element_size) {
+      return solver->RevAlloc(
+          new LargeIntElementConstraint(solver, vals, index, target));
     } else {
       return solver->RevAlloc(
           new IntElementConstraint(solver, vals, index, target));
@@ -162,7 +162,9 @@ class SumConstraint : public TreeArrayConstraint {
  public:
   SumConstraint(Solver* const solver, const std::vector<IntVar*>& vars,
                 IntVar* const sum_var)
-      : TreeArrayConstraint(solver, vars, sum_var), sum_demon_(nullptr) {}
+      : TreeArrayConstraint(solver, vars, sum_var),
+        sum_demon_(nullptr),
+        modified_leaves_(vars.size()) {}
 
   ~SumConstraint() override {}
 
@@ -173,7 +175,7 @@ class SumConstraint : public TreeArrayConstraint {
       vars_[i]->WhenRange(demon);
     }
     sum_demon_ = solver()->RegisterDemon(MakeDelayedConstraintDemon0(
-        solver(), this, &SumConstraint::SumChanged, "SumChanged"));
+        solver(), this, &SumConstraint::Propagate, "Propagate"));
     target_var_->WhenRange(sum_demon_);
   }
 
@@ -263,11 +265,30 @@ class SumConstraint : public TreeArrayConstraint {
     // above, rule 5) useful?
   }
 
+  // Leaf events are batched: they are all pushed up the tree by the next
+  // run of Propagate(), which then updates the sum variable only once.
   void LeafChanged(int term_index) {
-    IntVar* const var = vars_[term_index];
-    PushUp(term_index, CapSub(var->Min(), var->OldMin()),
-           CapSub(var->OldMax(), var->Max()));
-    EnqueueDelayedDemon(sum_demon_);  // TODO(user): Is this needed?
+    modified_leaves_.Add(solver(), term_index);
+    EnqueueDelayedDemon(sum_demon_);
+  }
+
+  void Propagate() {
+    const std::vector<int>& modified = modified_leaves_.modified(solver());
+    if (!modified.empty()) {
+      const int leaf_depth = MaxDepth();
+      for (const int term_index : modified) {
+        // Leaves hold the bounds of the variables at the last push up.
+        IntVar* const var = vars_[term_index];
+        const int64 delta_min = CapSub(var->Min(), Min(leaf_depth, term_index));
+        const int64 delta_max = CapSub(Max(leaf_depth, term_index), var->Max());
+        if (delta_min > 0 || delta_max > 0) {
+          PushUp(term_index, delta_min, delta_max);
+        }
+      }
+      modified_leaves_.Clear();
+      target_var_->SetRange(RootMin(), RootMax());
+    }
+    SumChanged();
   }
 
   void PushUp(int position, int64 delta_min, int64 delta_max) {
@@ -279,7 +300,6 @@ class SumConstraint : public TreeArrayConstraint {
       position = Parent(position);
     }
     DCHECK_EQ(0, position);
-    target_var_->SetRange(RootMin(), RootMax());
   }
 
   std::string DebugString() const override { return DebugStringInternal("Sum"); }
@@ -290,6 +310,7 @@ class SumConstraint : public TreeArrayConstraint {
 
  private:
   Demon* sum_demon_;
+  ModifiedVarBatch modified_leaves_;
 };
 
 // This constraint implements sum(vars) == target_var.
@@ -1528,7 +1549,12 @@ class SumBooleanLessOrEqualToOne : public BaseSumBooleanConstraint {
 
 // ----- Sum of Boolean >= 1 -----
 
-// We implement this one as a Max(array) == 1.
+// We implement this one as a clause, with two watched variables: while two
+// variables can still be 1, the constraint cannot propagate, and only the
+// events on these two variables need to be considered. As in SAT solvers, the
+// watched variables are not restored on backtrack, as backtracking cannot
+// bind them, and events on the other variables are dismissed in O(1) without
+// modifying the trail.
 
 class SumBooleanGreaterOrEqualToOne : public BaseSumBooleanConstraint {
  public:
@@ -1539,7 +1565,6 @@ class SumBooleanGreaterOrEqualToOne : public BaseSumBooleanConstraint {
   void InitialPropagate() override;
 
   void Update(int index);
-  void UpdateVar();
 
   std::string DebugString() const override;
 
@@ -1552,12 +1577,17 @@ class SumBooleanGreaterOrEqualToOne : public BaseSumBooleanConstraint {
   }
 
  private:
-  RevBitSet bits_;
+  // Returns the index of a variable which can still be 1, different from
+  // 'excluded', looking cyclically after 'from'; returns -1 if there is none.
+  int FindWatch(int from, int excluded) const;
+
+  int watch1_;
+  int watch2_;
 };
 
 SumBooleanGreaterOrEqualToOne::SumBooleanGreaterOrEqualToOne(
     Solver* const s, const std::vector<IntVar*>& vars)
-    : BaseSumBooleanConstraint(s, vars), bits_(vars.size()) {}
+    : BaseSumBooleanConstraint(s, vars), watch1_(-1), watch2_(-1) {}
 
 void SumBooleanGreaterOrEqualToOne::Post() {
   for (int i = 0; i < vars_.size(); ++i) {
@@ -1568,6 +1598,8 @@ void SumBooleanGreaterOrEqualToOne::Post() {
 }
 
 void SumBooleanGreaterOrEqualToOne::InitialPropagate() {
+  watch1_ = -1;
+  watch2_ = -1;
   for (int i = 0; i < vars_.size(); ++i) {
     IntVar* const var = vars_[i];
     if (var->Min() == 1LL) {
@@ -1575,33 +1607,53 @@ void SumBooleanGreaterOrEqualToOne::InitialPropagate() {
       return;
     }
     if (var->Max() == 1LL) {
-      bits_.SetToOne(solver(), i);
+      if (watch1_ == -1) {
+        watch1_ = i;
+      } else if (watch2_ == -1) {
+        watch2_ = i;
+      }
     }
   }
-  if (bits_.IsCardinalityZero()) {
+  if (watch1_ == -1) {
     solver()->Fail();
-  } else if (bits_.IsCardinalityOne()) {
-    vars_[bits_.GetFirstBit(0)]->SetValue(1LL);
+  } else if (watch2_ == -1) {
+    vars_[watch1_]->SetValue(1LL);
     inactive_.Switch(solver());
   }
 }
 
 void SumBooleanGreaterOrEqualToOne::Update(int index) {
-  if (!inactive_.Switched()) {
-    if (vars_[index]->Min() == 1LL) {  // Bound to 1.
-      inactive_.Switch(solver());
+  if (inactive_.Switched()) return;
+  if (vars_[index]->Min() == 1LL) {  // Bound to 1.
+    inactive_.Switch(solver());
+    return;
+  }
+  if (index != watch1_ && index != watch2_) return;
+  const int other = index == watch1_ ? watch2_ : watch1_;
+  const int replacement = FindWatch(index, other);
+  if (replacement != -1) {
+    if (index == watch1_) {
+      watch1_ = replacement;
     } else {
-      bits_.SetToZero(solver(), index);
-      if (bits_.IsCardinalityZero()) {
-        solver()->Fail();
-      } else if (bits_.IsCardinalityOne()) {
-        vars_[bits_.GetFirstBit(0)]->SetValue(1LL);
-        inactive_.Switch(solver());
-      }
+      watch2_ = replacement;
     }
+  } else {
+    // The other watched variable is the only one which can still be 1.
+    vars_[other]->SetValue(1LL);
+    inactive_.Switch(solver());
   }
 }
 
+int SumBooleanGreaterOrEqualToOne::FindWatch(int from, int excluded) const {
+  const int size = vars_.size();
+  int i = from;
+  for (int count = 1; count < size; ++count) {
+    if (++i == size) i = 0;
+    if (i != excluded && vars_[i]->Max() == 1LL) return i;
+  }
+  return -1;
+}
+
 std::string SumBooleanGreaterOrEqualToOne::DebugString() const {
   return DebugStringInternal("SumBooleanGreaterOrEqualToOne");
 }
@@ -3209,6 +3261,25 @@ IntExpr* MakeSumFct(Solver* solver, const std::vector<IntVar*>& pre_vars) {
 }
 }  // namespace
 
+void LinearizeExpression(IntExpr* const expr, std::vector<IntVar*>* vars,
+                         std::vector<int64>* coefs, int64* constant) {
+  CHECK(vars != nullptr);
+  CHECK(coefs != nullptr);
+  CHECK(constant != nullptr);
+  hash_map<IntVar*, int64> variables_to_coefficients;
+  ExprLinearizer linearizer(&variables_to_coefficients);
+  linearizer.Visit(expr, 1);
+  *constant = linearizer.Constant();
+  vars->clear();
+  coefs->clear();
+  for (const auto& variable_to_coefficient : variables_to_coefficients) {
+    if (variable_to_coefficient.second != 0) {
+      vars->push_back(variable_to_coefficient.first);
+      coefs->push_back(variable_to_coefficient.second);
+    }
+  }
+}
+
 // ----- API -----
 
 IntExpr* Solver::MakeSum(const std::vector<IntVar*>& vars) {
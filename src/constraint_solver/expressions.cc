@@ -14,6 +14,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <functional>
 #include "base/hash.h"
 #include <memory>
 #include <string>
@@ -27,6 +28,7 @@
 #include "base/map_util.h"
 #include "base/stl_util.h"
 #include "base/mathutil.h"
+#include "base/memory_accounting.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
 #include "util/bitset.h"
@@ -36,6 +38,9 @@
 DEFINE_bool(cp_disable_expression_optimization, false,
             "Disable special optimization when creating expressions.");
 DEFINE_bool(cp_share_int_consts, true, "Share IntConst's with the same value.");
+DEFINE_bool(cp_flatten_linear_expressions, true,
+            "Cast nested sums and differences of expressions to variables "
+            "through a single scalar product on their leaves.");
 
 #if defined(_MSC_VER)
 #pragma warning(disable : 4351 4355)
@@ -245,6 +250,20 @@ class DomainIntVar : public IntVar {
     virtual bool SetValue(int64 val) = 0;
     virtual bool RemoveValue(int64 val) = 0;
     virtual uint64 Size() const = 0;
+    // Bulk removals, working one 64-bit word at a time. They return the
+    // number of values removed and record the holes. All removed values
+    // must lie strictly between the current min and max of the variable.
+    // Removes all values in [l..u].
+    virtual uint64 RemoveInterval(int64 l, int64 u) = 0;
+    // Removes the 'num_values' values of 'values', sorted by increasing
+    // value without duplicates.
+    virtual uint64 RemoveSortedValues(const int64* const values,
+                                      int num_values) = 0;
+    // Removes all values v, cmin < v < cmax, such that bit v - offset of
+    // 'bitset' ('num_words' words long) is not set.
+    virtual uint64 RemoveValuesNotIn(const uint64* const bitset, int64 offset,
+                                     int num_words, int64 cmin,
+                                     int64 cmax) = 0;
     virtual void DelayRemoveValue(int64 val) = 0;
     virtual void ApplyRemovedValues(DomainIntVar* var) = 0;
     virtual void ClearRemovedValues() = 0;
@@ -1340,6 +1359,9 @@ class DomainIntVar : public IntVar {
   }
   void RemoveValue(int64 v) override;
   void RemoveInterval(int64 l, int64 u) override;
+  void RemoveValues(const std::vector<int64>& values) override;
+  void IntersectWithBitset(const uint64* const bitset, int64 offset,
+                           int num_words) override;
   void CreateBits();
   void WhenBound(Demon* d) override {
     if (min_.Value() != max_.Value()) {
@@ -1595,6 +1617,26 @@ inline bool ClosedIntervalNoLargerThan(int64 a, int64 b, int64 K) {
   }
 }
 
+// Returns the 64 bits of 'bitset' ('num_words' words long) starting at
+// position 'pos'. Bits outside of the bitset, including the ones at negative
+// positions, are returned as unset.
+inline uint64 ExtractBits64(const uint64* const bitset, int num_words,
+                            int64 pos) {
+  if (pos <= -64 || pos >= BitShift64(num_words)) {
+    return GG_ULONGLONG(0);
+  }
+  if (pos < 0) {
+    return bitset[0] << -pos;
+  }
+  const int64 offset = BitOffset64(pos);
+  const int shift = BitPos64(pos);
+  uint64 bits = bitset[offset] >> shift;
+  if (shift != 0 && offset + 1 < num_words) {
+    bits |= bitset[offset + 1] << (64 - shift);
+  }
+  return bits;
+}
+
 class SimpleBitSet : public DomainIntVar::BitSet {
  public:
   SimpleBitSet(Solver* const s, int64 vmin, int64 vmax)
@@ -1609,6 +1651,7 @@ class SimpleBitSet : public DomainIntVar::BitSet {
         << "Bitset too large: [" << vmin << ", " << vmax << "]";
     bits_ = new uint64[bsize_];
     stamps_ = new uint64[bsize_];
+    RecordMemoryAllocation(CP_DOMAINS, 2 * bsize_ * sizeof(uint64));
     for (int i = 0; i < bsize_; ++i) {
       const int bs =
           (i == size_.Value() - 1) ? 63 - BitPos64(size_.Value()) : 0;
@@ -1630,6 +1673,7 @@ class SimpleBitSet : public DomainIntVar::BitSet {
         << "Bitset too large: [" << vmin << ", " << vmax << "]";
     bits_ = new uint64[bsize_];
     stamps_ = new uint64[bsize_];
+    RecordMemoryAllocation(CP_DOMAINS, 2 * bsize_ * sizeof(uint64));
     for (int i = 0; i < bsize_; ++i) {
       bits_[i] = GG_ULONGLONG(0);
       stamps_[i] = s->stamp() - 1;
@@ -1646,6 +1690,8 @@ class SimpleBitSet : public DomainIntVar::BitSet {
   ~SimpleBitSet() override {
     delete[] bits_;
     delete[] stamps_;
+    RecordMemoryAllocation(CP_DOMAINS,
+                           -static_cast<int64>(2 * bsize_ * sizeof(uint64)));
   }
 
   bool bit(int64 val) const { return IsBitSet64(bits_, val - omin_); }
@@ -1719,6 +1765,65 @@ class SimpleBitSet : public DomainIntVar::BitSet {
   }
   uint64 Size() const override { return size_.Value(); }
 
+  uint64 RemoveInterval(int64 l, int64 u) override {
+    DCHECK_GE(l, omin_);
+    DCHECK_LE(u, omax_);
+    DCHECK_LE(l, u);
+    const uint64 start = l - omin_;
+    const uint64 end = u - omin_;
+    const int first = BitOffset64(start);
+    const int last = BitOffset64(end);
+    uint64 removed = 0;
+    for (int offset = first; offset <= last; ++offset) {
+      uint64 mask = kAllBits64;
+      if (offset == first) mask &= IntervalUp64(BitPos64(start));
+      if (offset == last) mask &= IntervalDown64(BitPos64(end));
+      removed += RemoveBits(offset, mask);
+    }
+    size_.Add(solver_, -static_cast<int64>(removed));
+    return removed;
+  }
+
+  uint64 RemoveSortedValues(const int64* const values,
+                            int num_values) override {
+    uint64 removed = 0;
+    int i = 0;
+    while (i < num_values) {
+      const int offset = BitOffset64(values[i] - omin_);
+      uint64 mask = GG_ULONGLONG(0);
+      do {
+        DCHECK_GE(values[i], omin_);
+        DCHECK_LE(values[i], omax_);
+        mask |= OneBit64(BitPos64(values[i] - omin_));
+        ++i;
+      } while (i < num_values && BitOffset64(values[i] - omin_) == offset);
+      removed += RemoveBits(offset, mask);
+    }
+    size_.Add(solver_, -static_cast<int64>(removed));
+    return removed;
+  }
+
+  uint64 RemoveValuesNotIn(const uint64* const bitset, int64 offset,
+                           int num_words, int64 cmin, int64 cmax) override {
+    DCHECK_GE(cmin, omin_);
+    DCHECK_LE(cmax, omax_);
+    if (cmax - cmin < 2) return 0;
+    const uint64 start = cmin + 1 - omin_;
+    const uint64 end = cmax - 1 - omin_;
+    const int first = BitOffset64(start);
+    const int last = BitOffset64(end);
+    uint64 removed = 0;
+    for (int word = first; word <= last; ++word) {
+      uint64 mask =
+          ~ExtractBits64(bitset, num_words, omin_ + BitShift64(word) - offset);
+      if (word == first) mask &= IntervalUp64(BitPos64(start));
+      if (word == last) mask &= IntervalDown64(BitPos64(end));
+      removed += RemoveBits(word, mask);
+    }
+    size_.Add(solver_, -static_cast<int64>(removed));
+    return removed;
+  }
+
   std::string DebugString() const override {
     std::string out;
     SStringPrintf(&out,
@@ -1793,6 +1898,29 @@ class SimpleBitSet : public DomainIntVar::BitSet {
   }
 
  private:
+  // Removes the bits of 'mask' from word 'offset', saving the word at most
+  // once per stamp, and returns the number of values removed. The size is
+  // not updated.
+  uint64 RemoveBits(int offset, uint64 mask) {
+    uint64 to_remove = bits_[offset] & mask;
+    if (to_remove == GG_ULONGLONG(0)) return 0;
+    const uint64 current_stamp = solver_->stamp();
+    if (stamps_[offset] < current_stamp) {
+      stamps_[offset] = current_stamp;
+      solver_->SaveValue(&bits_[offset]);
+    }
+    bits_[offset] &= ~to_remove;
+    InitHoles();
+    const int64 base = omin_ + BitShift64(offset);
+    uint64 removed = 0;
+    while (to_remove != GG_ULONGLONG(0)) {
+      AddHole(base + LeastSignificantBitPosition64(to_remove));
+      to_remove &= to_remove - 1;
+      ++removed;
+    }
+    return removed;
+  }
+
   uint64* bits_;
   uint64* stamps_;
   const int64 omin_;
@@ -1936,6 +2064,33 @@ class SmallBitSet : public DomainIntVar::BitSet {
 
   uint64 Size() const override { return size_.Value(); }
 
+  uint64 RemoveInterval(int64 l, int64 u) override {
+    DCHECK_GE(l, omin_);
+    DCHECK_LE(u, omax_);
+    DCHECK_LE(l, u);
+    return RemoveBits(OneRange64(l - omin_, u - omin_));
+  }
+
+  uint64 RemoveSortedValues(const int64* const values,
+                            int num_values) override {
+    uint64 mask = GG_ULONGLONG(0);
+    for (int i = 0; i < num_values; ++i) {
+      DCHECK_GE(values[i], omin_);
+      DCHECK_LE(values[i], omax_);
+      mask |= OneBit64(values[i] - omin_);
+    }
+    return RemoveBits(mask);
+  }
+
+  uint64 RemoveValuesNotIn(const uint64* const bitset, int64 offset,
+                           int num_words, int64 cmin, int64 cmax) override {
+    DCHECK_GE(cmin, omin_);
+    DCHECK_LE(cmax, omax_);
+    if (cmax - cmin < 2) return 0;
+    return RemoveBits(~ExtractBits64(bitset, num_words, omin_ - offset) &
+                      OneRange64(cmin + 1 - omin_, cmax - 1 - omin_));
+  }
+
   std::string DebugString() const override {
     return StringPrintf("SmallBitSet(%" GG_LL_FORMAT "d..%" GG_LL_FORMAT
                         "d : %llx)",
@@ -2008,6 +2163,27 @@ class SmallBitSet : public DomainIntVar::BitSet {
   }
 
  private:
+  // Removes the bits of 'mask', updates the size and returns the number of
+  // values removed.
+  uint64 RemoveBits(uint64 mask) {
+    uint64 to_remove = bits_ & mask;
+    if (to_remove == GG_ULONGLONG(0)) return 0;
+    const uint64 current_stamp = solver_->stamp();
+    if (stamp_ < current_stamp) {
+      stamp_ = current_stamp;
+      solver_->SaveValue(&bits_);
+    }
+    bits_ &= ~to_remove;
+    const uint64 removed = BitCount64(to_remove);
+    size_.Add(solver_, -static_cast<int64>(removed));
+    InitHoles();
+    while (to_remove != GG_ULONGLONG(0)) {
+      AddHole(omin_ + LeastSignificantBitPosition64(to_remove));
+      to_remove &= to_remove - 1;
+    }
+    return removed;
+  }
+
   uint64 bits_;
   uint64 stamp_;
   const int64 omin_;
@@ -2383,10 +2559,72 @@ void DomainIntVar::RemoveInterval(int64 l, int64 u) {
     SetMin(u + 1);
   } else if (u >= max_.Value()) {
     SetMax(l - 1);
-  } else {
+  } else if (in_process_) {
     for (int64 v = l; v <= u; ++v) {
       RemoveValue(v);
     }
+  } else {
+    if (bits_ == nullptr) {
+      CreateBits();
+    }
+    if (bits_->RemoveInterval(l, u) > 0) {
+      Push();
+    }
+  }
+}
+
+void DomainIntVar::RemoveValues(const std::vector<int64>& values) {
+  // The bulk removal needs values sorted without duplicates; other cases are
+  // left to the generic (value by value) implementation.
+  if (in_process_ || values.size() < 4 ||
+      std::adjacent_find(values.begin(), values.end(),
+                         std::greater_equal<int64>()) != values.end()) {
+    IntVar::RemoveValues(values);
+    return;
+  }
+  int begin = 0;
+  int end = values.size();
+  // Values matching the bounds change the bounds and are removed one at a
+  // time.
+  while (begin < end && values[begin] <= min_.Value()) {
+    RemoveValue(values[begin++]);
+  }
+  while (begin < end && values[end - 1] >= max_.Value()) {
+    RemoveValue(values[--end]);
+  }
+  if (begin == end) return;
+  // Remaining values lie strictly between min and max.
+  if (bits_ == nullptr) {
+    CreateBits();
+  }
+  if (bits_->RemoveSortedValues(values.data() + begin, end - begin) > 0) {
+    Push();
+  }
+}
+
+void DomainIntVar::IntersectWithBitset(const uint64* const bitset,
+                                       int64 offset, int num_words) {
+  if (in_process_) {
+    IntVar::IntersectWithBitset(bitset, offset, num_words);
+    return;
+  }
+  SetRange(offset, offset + BitShift64(num_words) - 1);
+  if (min_.Value() < max_.Value() - 1) {
+    if (bits_ == nullptr) {
+      CreateBits();
+    }
+    if (bits_->RemoveValuesNotIn(bitset, offset, num_words, min_.Value(),
+                                 max_.Value()) > 0) {
+      Push();
+    }
+  }
+  // All values strictly between the bounds are now in the bitset; the
+  // bounds are checked last.
+  if (!IsBitSet64(bitset, min_.Value() - offset)) {
+    SetMin(min_.Value() + 1);
+  }
+  if (!IsBitSet64(bitset, max_.Value() - offset)) {
+    SetMax(max_.Value() - 1);
   }
 }
 
@@ -3554,6 +3792,15 @@ bool TimesNegCstIntVar::Contains(int64 v) const {
 
 // ---------- arithmetic expressions ----------
 
+// Returns true if expr is a node of a linear expression tree, i.e. a sum,
+// difference, opposite or product by a constant which is not a variable.
+bool IsLinearExpressionNode(IntExpr* const expr);
+
+// Casts a linear expression tree to a variable linked to the leaves of the
+// tree by a single scalar product, instead of propagating through each node
+// of the tree.
+IntVar* CastLinearExpressionToVar(IntExpr* const expr);
+
 // ----- PlusIntExpr -----
 
 class PlusIntExpr : public BaseIntExpr {
@@ -3629,6 +3876,10 @@ class PlusIntExpr : public BaseIntExpr {
   }
 
   IntVar* CastToVar() override {
+    if (FLAGS_cp_flatten_linear_expressions &&
+        (IsLinearExpressionNode(left_) || IsLinearExpressionNode(right_))) {
+      return CastLinearExpressionToVar(this);
+    }
     if (dynamic_cast<PlusIntExpr*>(left_) != nullptr ||
         dynamic_cast<PlusIntExpr*>(right_) != nullptr) {
       std::vector<IntExpr*> sub_exprs;
@@ -3848,6 +4099,14 @@ class SubIntExpr : public BaseIntExpr {
     visitor->EndVisitIntegerExpression(ModelVisitor::kDifference, this);
   }
 
+  IntVar* CastToVar() override {
+    if (FLAGS_cp_flatten_linear_expressions &&
+        (IsLinearExpressionNode(left_) || IsLinearExpressionNode(right_))) {
+      return CastLinearExpressionToVar(this);
+    }
+    return BaseIntExpr::CastToVar();
+  }
+
   IntExpr* left() const { return left_; }
   IntExpr* right() const { return right_; }
 
@@ -3896,6 +4155,9 @@ class SafeSubIntExpr : public SubIntExpr {
     left_->SetMax(CapAdd(m, right_->Max()));
     right_->SetMin(CapSub(left_->Min(), m));
   }
+
+  // The scalar product of the flattened tree could overflow.
+  IntVar* CastToVar() override { return BaseIntExpr::CastToVar(); }
 };
 
 // l - r
@@ -4138,6 +4400,33 @@ class TimesIntNegCstExpr : public TimesIntCstExpr {
   }
 };
 
+// ----- Linear expression trees -----
+
+bool IsLinearExpressionNode(IntExpr* const expr) {
+  return !expr->IsVar() && (dynamic_cast<PlusIntExpr*>(expr) != nullptr ||
+                            dynamic_cast<SubIntExpr*>(expr) != nullptr ||
+                            dynamic_cast<PlusIntCstExpr*>(expr) != nullptr ||
+                            dynamic_cast<SubIntCstExpr*>(expr) != nullptr ||
+                            dynamic_cast<OppIntExpr*>(expr) != nullptr ||
+                            dynamic_cast<TimesIntCstExpr*>(expr) != nullptr);
+}
+
+IntVar* CastLinearExpressionToVar(IntExpr* const expr) {
+  Solver* const s = expr->solver();
+  std::vector<IntVar*> vars;
+  std::vector<int64> coefs;
+  int64 constant = 0;
+  LinearizeExpression(expr, &vars, &coefs, &constant);
+  int64 vmin, vmax;
+  expr->Range(&vmin, &vmax);
+  IntVar* const var = s->MakeIntVar(vmin, vmax);
+  // expr == var <=> sum(coefs[i] * vars[i]) - var == -constant.
+  vars.push_back(var);
+  coefs.push_back(-1);
+  s->AddConstraint(s->MakeScalProdEquality(vars, coefs, CapOpp(constant)));
+  return var;
+}
+
 // ----- Utilities for product expression -----
 
 // Propagates set_min on left * right, left and right >= 0.
@@ -7288,6 +7577,21 @@ void IntVar::RemoveValues(const std::vector<int64>& values) {
   }
 }
 
+void IntVar::IntersectWithBitset(const uint64* const bitset, int64 offset,
+                                 int num_words) {
+  SetRange(offset, offset + BitShift64(num_words) - 1);
+  std::vector<int64>& to_remove = solver()->tmp_vector_;
+  to_remove.clear();
+  std::unique_ptr<IntVarIterator> it(MakeDomainIterator(false));
+  for (it->Init(); it->Ok(); it->Next()) {
+    const int64 value = it->Value();
+    if (!IsBitSet64(bitset, value - offset)) {
+      to_remove.push_back(value);
+    }
+  }
+  RemoveValues(to_remove);
+}
+
 void IntVar::Accept(ModelVisitor* const visitor) const {
   IntExpr* const casted = solver()->CastExpression(this);
   visitor->VisitIntegerVariable(this, casted);
@@ -19,6 +19,7 @@
 // Mexico, pages 245-250, 2003.
 
 
+#include "base/commandlineflags.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/macros.h"
@@ -27,11 +28,17 @@
 #include "base/int_type.h"
 #include "base/map_util.h"
 #include "base/stl_util.h"
+#include "base/strongly_connected_components.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
+#include "util/string_array.h"
 #include "util/vector_map.h"
 #include "base/stringprintf.h"
 
+DEFINE_bool(cp_use_flow_gcc, true,
+            "If true, MakeGcc() builds a domain consistent gcc based on "
+            "matchings instead of a bounds consistent one.");
+
 namespace operations_research {
 namespace {
 DEFINE_INT_TYPE(Index, int);
@@ -712,12 +719,369 @@ class GccConstraint : public Constraint {
   PartialSum lower_sum_;
   PartialSum upper_sum_;
 };
+
+// ----- GccFlowConstraint -----
+
+// A matching of variables to values in which the value v is taken by at most
+// capacity[v] variables. The variables matched to a value are chained in a
+// doubly linked list.
+class CapacitatedMatching {
+ public:
+  CapacitatedMatching(int num_vars, int num_values)
+      : value_of_var_(num_vars, -1),
+        next_var_(num_vars, -1),
+        previous_var_(num_vars, -1),
+        first_var_(num_values, -1),
+        flow_(num_values, 0),
+        total_flow_(0) {}
+
+  // Returns the value matched to the variable, or -1.
+  int ValueOf(int var) const { return value_of_var_[var]; }
+  // The number of variables matched to the value.
+  int64 Flow(int value) const { return flow_[value]; }
+  int64 TotalFlow() const { return total_flow_; }
+  // The first variable matched to the value and the next one, or -1.
+  int FirstVar(int value) const { return first_var_[value]; }
+  int NextVar(int var) const { return next_var_[var]; }
+
+  void Assign(int var, int value) {
+    Unassign(var);
+    value_of_var_[var] = value;
+    flow_[value]++;
+    total_flow_++;
+    const int next = first_var_[value];
+    next_var_[var] = next;
+    previous_var_[var] = -1;
+    if (next != -1) {
+      previous_var_[next] = var;
+    }
+    first_var_[value] = var;
+  }
+
+  void Unassign(int var) {
+    const int value = value_of_var_[var];
+    if (value == -1) return;
+    const int next = next_var_[var];
+    const int previous = previous_var_[var];
+    if (previous == -1) {
+      first_var_[value] = next;
+    } else {
+      next_var_[previous] = next;
+    }
+    if (next != -1) {
+      previous_var_[next] = previous;
+    }
+    flow_[value]--;
+    total_flow_--;
+    value_of_var_[var] = -1;
+  }
+
+ private:
+  std::vector<int> value_of_var_;
+  std::vector<int> next_var_;
+  std::vector<int> previous_var_;
+  std::vector<int> first_var_;
+  std::vector<int64> flow_;
+  int64 total_flow_;
+};
+
+// Domain consistent version of the gcc, after Quimper et al., "Improved
+// algorithms for the global cardinality constraint", CP 2004: the constraint
+// is split into a lower bound problem, where the value v must be taken by at
+// least min_occurrences[v] variables, and an upper bound problem, where it
+// can be taken by at most max_occurrences[v] variables. Each one is solved by
+// a maximum matching, and the arcs outside the strongly connected components
+// of its residual graph are removed.
+//
+// The matchings are not reversible: they are kept from one propagation to
+// the next, as well as across backtracks, since a matching stays valid when
+// domains grow. A propagation only unmatches the variables whose matched
+// value was removed, and augments the matchings from there. The propagation
+// does nothing if no domain has changed since the last fixpoint, which
+// happens when it is woken up by its own removals.
+class GccFlowConstraint : public Constraint {
+ public:
+  GccFlowConstraint(Solver* const solver, const std::vector<IntVar*>& vars,
+                    int64 first_domain_value,
+                    const std::vector<int64>& min_occurrences,
+                    const std::vector<int64>& max_occurrences)
+      : Constraint(solver),
+        vars_(vars),
+        first_domain_value_(first_domain_value),
+        num_values_(min_occurrences.size()),
+        min_occurrences_(min_occurrences),
+        max_occurrences_(max_occurrences),
+        sum_of_min_occurrences_(0),
+        lower_(vars.size(), num_values_),
+        upper_(vars.size(), num_values_),
+        var_stamps_(vars.size(), 0),
+        value_stamps_(num_values_, 0),
+        stamp_(0),
+        last_sizes_(vars.size(), -1),
+        graph_(vars.size() + num_values_ + 1) {
+    CHECK_EQ(min_occurrences_.size(), max_occurrences_.size());
+    for (int i = 0; i < vars_.size(); ++i) {
+      iterators_.push_back(vars_[i]->MakeDomainIterator(true));
+    }
+    for (int value = 0; value < num_values_; ++value) {
+      CHECK_LE(min_occurrences_[value], max_occurrences_[value]);
+      sum_of_min_occurrences_ += min_occurrences_[value];
+    }
+  }
+
+  ~GccFlowConstraint() override {}
+
+  void Post() override {
+    Demon* const demon = MakeDelayedConstraintDemon0(
+        solver(), this, &GccFlowConstraint::Propagate, "Propagate");
+    for (int i = 0; i < vars_.size(); ++i) {
+      vars_[i]->WhenDomain(demon);
+    }
+  }
+
+  void InitialPropagate() override {
+    std::vector<int64> to_remove;
+    for (int value = 0; value < num_values_; ++value) {
+      if (max_occurrences_[value] == 0) {
+        to_remove.push_back(first_domain_value_ + value);
+      }
+    }
+    for (int i = 0; i < vars_.size(); ++i) {
+      vars_[i]->SetRange(first_domain_value_,
+                         first_domain_value_ + num_values_ - 1);
+      vars_[i]->RemoveValues(to_remove);
+    }
+    Propagate();
+  }
+
+  void Propagate() {
+    // Unmatches the variables that lost their matched value since the last
+    // fixpoint.
+    bool changed = false;
+    for (int i = 0; i < vars_.size(); ++i) {
+      IntVar* const var = vars_[i];
+      if (var->Size() == last_sizes_[i]) continue;
+      changed = true;
+      const int lower_value = lower_.ValueOf(i);
+      if (lower_value != -1 &&
+          !var->Contains(first_domain_value_ + lower_value)) {
+        lower_.Unassign(i);
+      }
+      const int upper_value = upper_.ValueOf(i);
+      if (upper_value != -1 &&
+          !var->Contains(first_domain_value_ + upper_value)) {
+        upper_.Unassign(i);
+      }
+    }
+    if (!changed) return;
+    // The pruning of the upper bound problem can remove matched arcs of the
+    // lower bound problem, in which case both are propagated again.
+    do {
+      Augment(&lower_, min_occurrences_, sum_of_min_occurrences_);
+      PruneLowerBoundProblem();
+      Augment(&upper_, max_occurrences_, vars_.size());
+    } while (PruneUpperBoundProblem());
+    for (int i = 0; i < vars_.size(); ++i) {
+      last_sizes_.SetValue(solver(), i, vars_[i]->Size());
+    }
+  }
+
+  std::string DebugString() const override {
+    return StringPrintf("GccFlowConstraint(%s, first value = %lld)",
+                        JoinDebugStringPtr(vars_, ", ").c_str(),
+                        first_domain_value_);
+  }
+
+  void Accept(ModelVisitor* const visitor) const override {
+    std::vector<int64> values(num_values_);
+    for (int value = 0; value < num_values_; ++value) {
+      values[value] = first_domain_value_ + value;
+    }
+    visitor->BeginVisitConstraint(ModelVisitor::kDistribute, this);
+    visitor->VisitIntegerVariableArrayArgument(ModelVisitor::kVarsArgument,
+                                               vars_);
+    visitor->VisitIntegerArrayArgument(ModelVisitor::kValuesArgument, values);
+    visitor->VisitIntegerArrayArgument(ModelVisitor::kMinArgument,
+                                       min_occurrences_);
+    visitor->VisitIntegerArrayArgument(ModelVisitor::kMaxArgument,
+                                       max_occurrences_);
+    visitor->EndVisitConstraint(ModelVisitor::kDistribute, this);
+  }
+
+ private:
+  // Augments the matching from its unmatched variables until its flow
+  // reaches 'target', and fails if it cannot.
+  void Augment(CapacitatedMatching* const matching,
+               const std::vector<int64>& capacities, int64 target) {
+    for (int i = 0; i < vars_.size() && matching->TotalFlow() < target; ++i) {
+      if (matching->ValueOf(i) == -1) {
+        ++stamp_;
+        FindAugmentingPath(i, matching, capacities);
+      }
+    }
+    if (matching->TotalFlow() < target) {
+      solver()->Fail();
+    }
+  }
+
+  // Finds an augmenting path from the variable, and returns true if it
+  // matched it to a new value.
+  bool FindAugmentingPath(int var, CapacitatedMatching* const matching,
+                          const std::vector<int64>& capacities) {
+    var_stamps_[var] = stamp_;
+    const int matched_value = matching->ValueOf(var);
+    for (const int64 v : InitAndGetValues(iterators_[var])) {
+      const int value = v - first_domain_value_;
+      if (value == matched_value || value_stamps_[value] == stamp_) continue;
+      value_stamps_[value] = stamp_;
+      if (matching->Flow(value) < capacities[value]) {
+        matching->Assign(var, value);
+        return true;
+      }
+      for (int other = matching->FirstVar(value); other != -1;
+           other = matching->NextVar(other)) {
+        if (var_stamps_[other] != stamp_ &&
+            FindAugmentingPath(other, matching, capacities)) {
+          matching->Assign(var, value);
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  int ValueNode(int value) const { return vars_.size() + value; }
+  int SinkNode() const { return vars_.size() + num_values_; }
+
+  // Computes the strongly connected components of graph_.
+  const std::vector<int>& Components() {
+    scc_finder_.FindComponents(graph_.size(), graph_);
+    return scc_finder_.component_of_node();
+  }
+
+  // In the residual graph of the lower bound problem, a value reaches the
+  // variables that can replace the ones matched to it, a matched variable
+  // reaches its value, and an unmatched variable reaches the sink, which
+  // reaches all the values. An unmatched variable can take any value, and a
+  // matched variable can take a value in its component.
+  void PruneLowerBoundProblem() {
+    for (std::vector<int>& arcs : graph_) arcs.clear();
+    for (int i = 0; i < vars_.size(); ++i) {
+      const int matched_value = lower_.ValueOf(i);
+      graph_[i].push_back(matched_value == -1 ? SinkNode()
+                                              : ValueNode(matched_value));
+      for (const int64 v : InitAndGetValues(iterators_[i])) {
+        const int value = v - first_domain_value_;
+        if (value != matched_value) {
+          graph_[ValueNode(value)].push_back(i);
+        }
+      }
+    }
+    for (int value = 0; value < num_values_; ++value) {
+      graph_[SinkNode()].push_back(ValueNode(value));
+    }
+    const std::vector<int>& components = Components();
+    for (int i = 0; i < vars_.size(); ++i) {
+      const int matched_value = lower_.ValueOf(i);
+      if (matched_value != -1) {
+        RemoveUnsupportedValues(i, matched_value, components);
+        const int upper_value = upper_.ValueOf(i);
+        if (upper_value != -1 &&
+            !vars_[i]->Contains(first_domain_value_ + upper_value)) {
+          upper_.Unassign(i);
+        }
+      }
+    }
+  }
+
+  // In the residual graph of the upper bound problem, a variable reaches the
+  // values it can take, a value reaches the variables matched to it, a value
+  // with some capacity left reaches the sink, and the sink reaches the
+  // values matched to some variable. All the variables are matched, and
+  // can take the values in their component. Returns true if a value matched
+  // in the lower bound problem was removed.
+  bool PruneUpperBoundProblem() {
+    for (std::vector<int>& arcs : graph_) arcs.clear();
+    for (int i = 0; i < vars_.size(); ++i) {
+      const int matched_value = upper_.ValueOf(i);
+      for (const int64 v : InitAndGetValues(iterators_[i])) {
+        const int value = v - first_domain_value_;
+        if (value == matched_value) {
+          graph_[ValueNode(value)].push_back(i);
+        } else {
+          graph_[i].push_back(ValueNode(value));
+        }
+      }
+    }
+    for (int value = 0; value < num_values_; ++value) {
+      if (upper_.Flow(value) < max_occurrences_[value]) {
+        graph_[ValueNode(value)].push_back(SinkNode());
+      }
+      if (upper_.Flow(value) > 0) {
+        graph_[SinkNode()].push_back(ValueNode(value));
+      }
+    }
+    const std::vector<int>& components = Components();
+    bool lower_matching_changed = false;
+    for (int i = 0; i < vars_.size(); ++i) {
+      RemoveUnsupportedValues(i, upper_.ValueOf(i), components);
+      const int lower_value = lower_.ValueOf(i);
+      if (lower_value != -1 &&
+          !vars_[i]->Contains(first_domain_value_ + lower_value)) {
+        lower_.Unassign(i);
+        lower_matching_changed = true;
+      }
+    }
+    return lower_matching_changed;
+  }
+
+  // Removes from the domain of the variable the values other than its
+  // matched value that are not in its strongly connected component.
+  void RemoveUnsupportedValues(int var, int matched_value,
+                               const std::vector<int>& components) {
+    to_remove_.clear();
+    for (const int64 v : InitAndGetValues(iterators_[var])) {
+      const int value = v - first_domain_value_;
+      if (value != matched_value &&
+          components[var] != components[ValueNode(value)]) {
+        to_remove_.push_back(v);
+      }
+    }
+    if (!to_remove_.empty()) {
+      vars_[var]->RemoveValues(to_remove_);
+    }
+  }
+
+  const std::vector<IntVar*> vars_;
+  const int64 first_domain_value_;
+  const int num_values_;
+  const std::vector<int64> min_occurrences_;
+  const std::vector<int64> max_occurrences_;
+  int64 sum_of_min_occurrences_;
+  CapacitatedMatching lower_;
+  CapacitatedMatching upper_;
+  std::vector<IntVarIterator*> iterators_;
+  // Visit marks of the augmenting path search.
+  std::vector<int64> var_stamps_;
+  std::vector<int64> value_stamps_;
+  int64 stamp_;
+  // The domain sizes at the last fixpoint.
+  RevArray<int64> last_sizes_;
+  // The residual graph: the variables, the values, then the sink.
+  std::vector<std::vector<int>> graph_;
+  StronglyConnectedComponentsFinder<int> scc_finder_;
+  std::vector<int64> to_remove_;
+};
 }  // namespace
 
 Constraint* MakeGcc(Solver* const solver, const std::vector<IntVar*>& vars,
                     int64 first_domain_value,
                     const std::vector<int64>& min_occurrences,
                     const std::vector<int64>& max_occurrences) {
+  if (FLAGS_cp_use_flow_gcc) {
+    return solver->RevAlloc(new GccFlowConstraint(
+        solver, vars, first_domain_value, min_occurrences, max_occurrences));
+  }
   return solver->RevAlloc(new GccConstraint(
       solver, vars, first_domain_value, min_occurrences.size(), min_occurrences,
       max_occurrences));
@@ -726,6 +1090,11 @@ Constraint* MakeGcc(Solver* const solver, const std::vector<IntVar*>& vars,
 Constraint* MakeGcc(Solver* const solver, const std::vector<IntVar*>& vars,
                     int64 offset, const std::vector<int>& min_occurrences,
                     const std::vector<int>& max_occurrences) {
+  if (FLAGS_cp_use_flow_gcc) {
+    return solver->RevAlloc(new GccFlowConstraint(
+        solver, vars, offset, ToInt64Vector(min_occurrences),
+        ToInt64Vector(max_occurrences)));
+  }
   return solver->RevAlloc(
       new GccConstraint(solver, vars, offset, min_occurrences.size(),
                         min_occurrences, max_occurrences));
@@ -68,12 +68,31 @@ class NoCycle : public Constraint {
 
  private:
   int64 size() const { return nexts_.size(); }
+  // Returns the representative of the set of 'index' in the reversible
+  // union-find of the bound arcs. The sets are merged by size, without path
+  // compression (which would have to be trailed too): the depth is at most
+  // log(size()).
+  int64 FindRoot(int64 index) const {
+    while (parents_[index] != index) index = parents_[index];
+    return index;
+  }
 
   const std::vector<IntVar*> nexts_;
   const std::vector<IntVar*> active_;
   std::vector<IntVarIterator*> iterators_;
   std::vector<int64> starts_;
   std::vector<int64> ends_;
+  // Reversible union-find of the nodes linked by bound arcs, used to detect
+  // cycles when the nexts do not form paths. A set is a tree of bound arcs
+  // whose root, tips_[representative], has an unbound next.
+  std::vector<int64> parents_;
+  std::vector<int64> set_sizes_;
+  std::vector<int64> tips_;
+  // Whether the arc leaving each node has been linked, and whether its next
+  // has been counted in num_bound_nexts_.
+  RevArray<bool> linked_;
+  RevArray<bool> counted_;
+  int64 num_bound_nexts_;
   bool all_nexts_bound_;
   std::vector<int64> outbound_supports_;
   std::vector<int64> support_leaves_;
@@ -92,6 +111,12 @@ NoCycle::NoCycle(Solver* const s, const std::vector<IntVar*>& nexts,
       iterators_(nexts.size(), nullptr),
       starts_(nexts.size()),
       ends_(nexts.size()),
+      parents_(nexts.size()),
+      set_sizes_(nexts.size(), 1),
+      tips_(nexts.size()),
+      linked_(nexts.size(), false),
+      counted_(nexts.size(), false),
+      num_bound_nexts_(0),
       all_nexts_bound_(false),
       outbound_supports_(nexts.size(), -1),
       sink_handler_(sink_handler),
@@ -101,6 +126,8 @@ NoCycle::NoCycle(Solver* const s, const std::vector<IntVar*>& nexts,
   for (int i = 0; i < size(); ++i) {
     starts_[i] = i;
     ends_[i] = i;
+    parents_[i] = i;
+    tips_[i] = i;
     iterators_[i] = nexts_[i]->MakeDomainIterator(true);
   }
 }
@@ -121,14 +148,16 @@ void NoCycle::InitialPropagate() {
       }
     }
   }
-  solver()->SaveAndSetValue(&all_nexts_bound_, true);
   for (int i = 0; i < size(); ++i) {
     if (nexts_[i]->Bound()) {
+      if (!counted_[i]) {
+        counted_.SetValue(solver(), i, true);
+        solver()->SaveAndAdd(&num_bound_nexts_, int64{1});
+      }
       NextBound(i);
-    } else {
-      solver()->SaveAndSetValue(&all_nexts_bound_, false);
     }
   }
+  solver()->SaveAndSetValue(&all_nexts_bound_, num_bound_nexts_ == size());
   ComputeSupports();
 }
 
@@ -162,17 +191,14 @@ void NoCycle::Post() {
 void NoCycle::NextChange(int index) {
   IntVar* const next_var = nexts_[index];
   if (next_var->Bound()) {
-    NextBound(index);
-  }
-  if (!all_nexts_bound_) {
-    bool all_nexts_bound = true;
-    for (int i = 0; i < size(); ++i) {
-      if (!nexts_[i]->Bound()) {
-        all_nexts_bound = false;
-        break;
+    if (!counted_[index]) {
+      counted_.SetValue(solver(), index, true);
+      solver()->SaveAndAdd(&num_bound_nexts_, int64{1});
+      if (num_bound_nexts_ == size()) {
+        solver()->SaveAndSetValue(&all_nexts_bound_, true);
       }
     }
-    solver()->SaveAndSetValue(&all_nexts_bound_, all_nexts_bound);
+    NextBound(index);
   }
   if (all_nexts_bound_) {
     return;
@@ -189,33 +215,33 @@ void NoCycle::ActiveBound(int index) {
 }
 
 void NoCycle::NextBound(int index) {
-  if (active_[index]->Min() == 0) return;
+  if (active_[index]->Min() == 0 || linked_[index]) return;
+  Solver* const s = solver();
+  linked_.SetValue(s, index, true);
   const int64 next = nexts_[index]->Value();
+  if (!assume_paths_ && !sink_handler_(next)) {
+    // 'index' had an unbound next, so it is the tip of its tree: the arc
+    // closes a cycle iff 'next' is in the same tree.
+    const int64 index_root = FindRoot(index);
+    const int64 next_root = FindRoot(next);
+    if (index_root == next_root) s->Fail();
+    const int64 tip = tips_[next_root];
+    int64 child = index_root;
+    int64 parent = next_root;
+    if (set_sizes_[child] > set_sizes_[parent]) std::swap(child, parent);
+    s->SaveAndSetValue(&parents_[child], parent);
+    s->SaveAndSetValue(&set_sizes_[parent],
+                       set_sizes_[parent] + set_sizes_[child]);
+    s->SaveAndSetValue(&tips_[parent], tip);
+    nexts_[tip]->RemoveValue(index);
+  }
   const int64 chain_start = starts_[index];
   const int64 chain_end = !sink_handler_(next) ? ends_[next] : next;
-  Solver* const s = solver();
   if (!sink_handler_(chain_start)) {
     s->SaveAndSetValue(&ends_[chain_start], chain_end);
     if (!sink_handler_(chain_end)) {
       s->SaveAndSetValue(&starts_[chain_end], chain_start);
       nexts_[chain_end]->RemoveValue(chain_start);
-      if (!assume_paths_) {
-        for (int i = 0; i < size(); ++i) {
-          int64 current = i;
-          bool found = (current == chain_end);
-          // Counter to detect implicit cycles.
-          int count = 0;
-          while (!found && count < size() && !sink_handler_(current) &&
-                 nexts_[current]->Bound()) {
-            current = nexts_[current]->Value();
-            found = (current == chain_end);
-            ++count;
-          }
-          if (found) {
-            nexts_[chain_end]->RemoveValue(i);
-          }
-        }
-      }
     }
   }
 }
@@ -975,30 +1001,11 @@ class DelayedPathCumul : public Constraint {
     for (const int touched : touched_values) {
       // Is touched the start of a chain ?
       if (is_chain_start_[touched]) {
-        // Propagate min cumuls from chain_starts[touch] to chain_ends_[touch].
-        int64 current = touched;
-        int64 next = nexts_[current]->Min();
-        while (current != chain_ends_[touched]) {
-          prevs_.SetValue(solver(), next, current);
-          PropagateLink(current, next);
-          current = next;
-          if (current != chain_ends_[touched]) {
-            next = nexts_[current]->Min();
-          }
-        }
-        // Propagate max cumuls from chain_ends_[i] to chain_starts_[i].
-        int64 prev = prevs_[current];
-        while (current != touched) {
-          PropagateLink(prev, current);
-          current = prev;
-          if (current != touched) {
-            prev = prevs_[current];
-          }
-        }
+        PropagateChain(touched, chain_ends_[touched]);
         // Now that the chain has been propagated in both directions, adding
         // demons for the corresponding cumul and transit variables for
         // future changes in their range.
-        current = touched;
+        int64 current = touched;
         while (current != chain_ends_[touched]) {
           if (!has_cumul_demon_[current]) {
             Demon* const demon = cumul_transit_demons_[current];
@@ -1100,6 +1107,65 @@ class DelayedPathCumul : public Constraint {
     return transit->Min() <= CapSub(next_cumul_var->Max(), cumul_var->Min()) &&
         CapSub(next_cumul_var->Min(), cumul_var->Max()) <= transit->Max();
   }
+  // Propagates the links of the chain from 'start' to 'end' in both
+  // directions, and sets the prevs_ of its nodes. The bounds of the cumuls and
+  // transits of the chain are copied to flat arrays, propagated there by a
+  // forward and a backward pass, and only the bounds which changed are then
+  // set on the variables: this avoids the variable updates (and their
+  // events) of the intermediate steps of a link by link propagation.
+  void PropagateChain(int64 start, int64 end) {
+    chain_.clear();
+    for (int64 current = start;; current = nexts_[current]->Min()) {
+      chain_.push_back(current);
+      if (current == end) break;
+    }
+    const int num_nodes = chain_.size();
+    const int num_links = num_nodes - 1;
+    cumul_mins_.resize(num_nodes);
+    cumul_maxs_.resize(num_nodes);
+    transit_mins_.resize(num_links);
+    transit_maxs_.resize(num_links);
+    for (int i = 0; i < num_nodes; ++i) {
+      IntVar* const cumul = cumuls_[chain_[i]];
+      cumul_mins_[i] = cumul->Min();
+      cumul_maxs_[i] = cumul->Max();
+      if (i > 0) prevs_.SetValue(solver(), chain_[i], chain_[i - 1]);
+    }
+    for (int i = 0; i < num_links; ++i) {
+      IntVar* const transit = transits_[chain_[i]];
+      transit_mins_[i] = transit->Min();
+      transit_maxs_[i] = transit->Max();
+    }
+    for (int i = 0; i < num_links; ++i) {
+      cumul_mins_[i + 1] = std::max(cumul_mins_[i + 1],
+                                    CapAdd(cumul_mins_[i], transit_mins_[i]));
+      cumul_maxs_[i + 1] = std::min(cumul_maxs_[i + 1],
+                                    CapAdd(cumul_maxs_[i], transit_maxs_[i]));
+    }
+    for (int i = num_links - 1; i >= 0; --i) {
+      cumul_mins_[i] = std::max(cumul_mins_[i],
+                                CapSub(cumul_mins_[i + 1], transit_maxs_[i]));
+      cumul_maxs_[i] = std::min(cumul_maxs_[i],
+                                CapSub(cumul_maxs_[i + 1], transit_mins_[i]));
+    }
+    for (int i = 0; i < num_nodes; ++i) {
+      if (cumul_mins_[i] > cumul_maxs_[i]) solver()->Fail();
+      IntVar* const cumul = cumuls_[chain_[i]];
+      if (cumul_mins_[i] > cumul->Min() || cumul_maxs_[i] < cumul->Max()) {
+        cumul->SetRange(cumul_mins_[i], cumul_maxs_[i]);
+      }
+    }
+    for (int i = 0; i < num_links; ++i) {
+      IntVar* const transit = transits_[chain_[i]];
+      const int64 transit_min = std::max(
+          transit_mins_[i], CapSub(cumul_mins_[i + 1], cumul_maxs_[i]));
+      const int64 transit_max = std::min(
+          transit_maxs_[i], CapSub(cumul_maxs_[i + 1], cumul_mins_[i]));
+      if (transit_min > transit->Min() || transit_max < transit->Max()) {
+        transit->SetRange(transit_min, transit_max);
+      }
+    }
+  }
 
   const std::vector<IntVar*> nexts_;
   const std::vector<IntVar*> active_;
@@ -1115,6 +1181,12 @@ class DelayedPathCumul : public Constraint {
   std::vector<int> supports_;
   RevArray<bool> was_bound_;
   RevArray<bool> has_cumul_demon_;
+  // Scratch arrays of PropagateChain().
+  std::vector<int64> chain_;
+  std::vector<int64> cumul_mins_;
+  std::vector<int64> cumul_maxs_;
+  std::vector<int64> transit_mins_;
+  std::vector<int64> transit_maxs_;
 };
 
 // cumuls[next[i]] = cumuls[i] + transit_evaluator(i, next[i])
@@ -16,6 +16,7 @@
 
 #include <math.h>
 #include <functional>
+#include <limits>
 #include "base/hash.h"
 #include <memory>
 #include "base/callback.h"
@@ -25,7 +26,13 @@
 #include "base/stl_util.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
+#include "glop/parameters.pb.h"
+#include "glop/proto_utils.h"
+#include "glop/revised_simplex.h"
 #include "linear_solver/linear_solver.h"
+#include "linear_solver/linear_solver.pb.h"
+#include "lp_data/lp_data.h"
+#include "util/time_limit.h"
 #include "util/string_array.h"
 
 DEFINE_int32(simplex_cleanup_frequency, 0,
@@ -510,15 +517,30 @@ class Linearizer : public ModelParser {
 
 // ----- Search Monitor -----
 
+// Maintains a linear relaxation of the linearizable part of the model. The
+// relaxation is extracted once, at the beginning of the search, and then
+// solved with a glop::RevisedSimplex kept across the nodes: only the bounds of
+// the columns that changed are updated, and the dual simplex restarts from the
+// basis of the previous solve. Since the bounds are read from the current
+// domains, backtracking needs no special handling.
+// The optimal value prunes the objective, and the reduced costs fix the
+// columns that cannot move away from their bound without going over the
+// current objective bound.
 class AutomaticLinearization : public SearchMonitor {
  public:
   AutomaticLinearization(Solver* const solver, int frequency)
       : SearchMonitor(solver),
-        mp_solver_("InSearchSimplex", LpSolverForCp()),
+        mp_solver_("InSearchSimplex", MPSolver::GLOP_LINEAR_PROGRAMMING),
         counter_(0),
         simplex_frequency_(frequency),
         objective_(nullptr),
-        maximize_(false) {}
+        maximize_(false),
+        time_limit_(std::numeric_limits<double>::infinity()) {
+    glop::GlopParameters parameters;
+    parameters.set_use_dual_simplex(true);
+    parameters.set_allow_simplex_algorithm_change(true);
+    simplex_.SetParameters(parameters);
+  }
 
   ~AutomaticLinearization() override {}
 
@@ -537,6 +559,7 @@ class AutomaticLinearization : public SearchMonitor {
   }
 
   void RunOptim() {
+    if (objective_ == nullptr) return;
     AssignVariables();
     SolveProblem();
   }
@@ -544,42 +567,95 @@ class AutomaticLinearization : public SearchMonitor {
   void BuildModel() {
     Linearizer linearizer(&mp_solver_, &translation_, &objective_, &maximize_);
     solver()->Accept(&linearizer);
+    MPModelProto model;
+    mp_solver_.ExportModelToProto(&model);
+    glop::MPModelProtoToLinearProgram(model, &linear_program_);
+    // The relaxation is always a minimization, so that the reduced cost
+    // fixing does not depend on the direction.
+    const glop::ColIndex num_cols = linear_program_.num_variables();
+    columns_.assign(num_cols.value(), nullptr);
+    for (const auto& it : translation_) {
+      columns_[it.second->index()] = it.first;
+    }
+    if (objective_ != nullptr && maximize_) {
+      const glop::ColIndex objective_col(
+          FindOrDie(translation_, objective_)->index());
+      linear_program_.SetObjectiveCoefficient(objective_col, -1.0);
+      linear_program_.SetMaximizationProblem(false);
+    }
+    first_solve_ = true;
   }
 
+  // Copies the current bounds of the CP expressions to the relaxation.
   void AssignVariables() {
-    for (const auto& it : translation_) {
-      it.second->SetBounds(it.first->Min(), it.first->Max());
+    for (glop::ColIndex col(0); col < glop::ColIndex(columns_.size()); ++col) {
+      const IntExpr* const expr = columns_[col.value()];
+      if (expr == nullptr) continue;
+      const double lb = expr->Min();
+      const double ub = expr->Max();
+      if (lb != linear_program_.variable_lower_bounds()[col] ||
+          ub != linear_program_.variable_upper_bounds()[col]) {
+        linear_program_.SetVariableBounds(col, lb, ub);
+      }
     }
   }
 
   void SolveProblem() {
-    if (objective_ != nullptr) {
-      switch (mp_solver_.Solve()) {
-        case MPSolver::OPTIMAL: {
-          const double obj_value = mp_solver_.Objective().Value();
-          if (maximize_) {
-            const int64 int_obj_value = static_cast<int64>(ceil(obj_value));
-            objective_->SetMax(int_obj_value);
-          } else {
-            const int64 int_obj_value = static_cast<int64>(floor(obj_value));
-            objective_->SetMin(int_obj_value);
-          }
-          break;
-        }
-        case MPSolver::FEASIBLE:
-          break;
-        case MPSolver::INFEASIBLE:
-          solver()->Fail();
-          break;
-        case MPSolver::UNBOUNDED:
-          LOG(INFO) << "Error: unbounded LP status.";
-          break;
-        case MPSolver::ABNORMAL:
-          LOG(INFO) << "Error: abnormal LP status.";
-          break;
-        default:
-          LOG(FATAL) << "Error: Unknown LP status.";
-          break;
+    // Only the bounds changed since the last solve.
+    if (!first_solve_) simplex_.NotifyThatMatrixIsUnchangedForNextSolve();
+    first_solve_ = false;
+    if (!simplex_.Solve(linear_program_, &time_limit_).ok()) {
+      LOG(INFO) << "Error: abnormal LP status.";
+      first_solve_ = true;
+      return;
+    }
+    switch (simplex_.GetProblemStatus()) {
+      case glop::ProblemStatus::OPTIMAL: {
+        PruneWithOptimalSolution(simplex_.GetObjectiveValue());
+        break;
+      }
+      case glop::ProblemStatus::PRIMAL_INFEASIBLE:
+      case glop::ProblemStatus::DUAL_UNBOUNDED:
+        solver()->Fail();
+        break;
+      case glop::ProblemStatus::PRIMAL_UNBOUNDED:
+        LOG(INFO) << "Error: unbounded LP status.";
+        break;
+      default:
+        break;
+    }
+  }
+
+  // The relaxation minimizes the objective (or its opposite when maximizing)
+  // and its optimal value is lp_value.
+  void PruneWithOptimalSolution(double lp_value) {
+    static const double kTolerance = 1e-6;
+    double cutoff;
+    if (maximize_) {
+      objective_->SetMax(static_cast<int64>(floor(-lp_value + kTolerance)));
+      cutoff = -objective_->Min();
+    } else {
+      objective_->SetMin(static_cast<int64>(ceil(lp_value - kTolerance)));
+      cutoff = objective_->Max();
+    }
+    // Reduced cost fixing: moving a column at a bound by delta increases the
+    // relaxation value by at least delta times its reduced cost, which must
+    // stay within the gap.
+    const double gap = cutoff - lp_value;
+    for (glop::ColIndex col(0); col < glop::ColIndex(columns_.size()); ++col) {
+      IntExpr* const expr = const_cast<IntExpr*>(columns_[col.value()]);
+      if (expr == nullptr || expr->Bound()) continue;
+      const double reduced_cost = simplex_.GetReducedCost(col);
+      const glop::VariableStatus status = simplex_.GetVariableStatus(col);
+      if (status == glop::VariableStatus::AT_LOWER_BOUND &&
+          reduced_cost > kTolerance) {
+        expr->SetMax(linear_program_.variable_lower_bounds()[col] +
+                     static_cast<int64>(floor(gap / reduced_cost + kTolerance)));
+      } else if (status == glop::VariableStatus::AT_UPPER_BOUND &&
+                 reduced_cost < -kTolerance) {
+        expr->SetMin(
+            linear_program_.variable_upper_bounds()[col] -
+            static_cast<int64>(floor(gap / -reduced_cost + kTolerance)));
       }
     }
   }
@@ -587,12 +663,19 @@ class AutomaticLinearization : public SearchMonitor {
   std::string DebugString() const override { return "AutomaticLinearization"; }
 
  private:
+  // Used to build the relaxation with the Linearizer.
   MPSolver mp_solver_;
   int64 counter_;
   const int simplex_frequency_;
   ExprTranslation translation_;
   IntVar* objective_;
   bool maximize_;
+  glop::LinearProgram linear_program_;
+  glop::RevisedSimplex simplex_;
+  TimeLimit time_limit_;
+  bool first_solve_;
+  // The CP expression of each column of linear_program_.
+  std::vector<const IntExpr*> columns_;
 };
 }  // namespace
 
@@ -32,7 +32,10 @@ SearchMonitor* MakeSimplexConnection(Solver* const solver,
 // of the problem. Every 'simplex_frequency' nodes explored in the
 // search tree, this linear relaxation will be called and the
 // resulting optimal solution found by the simplex will be used to
-// prune the objective of the constraint programming model.
+// prune the objective of the constraint programming model, and its
+// reduced costs to tighten the bounds of the linearized variables.
+// The relaxation is solved with Glop, and only the bounds that changed
+// since the previous node are updated before a warm-started dual simplex.
 SearchMonitor* MakeSimplexConstraint(Solver* const solver,
                                      int simplex_frequency);
 }  // namespace operations_research
@@ -25,6 +25,7 @@
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/map_util.h"
+#include "base/recordio.h"
 #include "base/stl_util.h"
 #include "base/hash.h"
 #include "constraint_solver/constraint_solver.h"
@@ -2496,6 +2497,97 @@ bool CPModelLoader::ScanOneArgument(int type_index,
   return false;
 }
 
+namespace {
+// Builds the variables, expressions and constraints of a model, or of a chunk
+// of a model, in the order in which they may refer to each other.
+bool LoadModelElements(const CPModelProto& model_proto,
+                       CPModelLoader* const builder) {
+  for (int i = 0; i < model_proto.intervals_size(); ++i) {
+    if (!builder->BuildFromProto(model_proto.intervals(i))) {
+      LOG(ERROR) << "Interval variable proto "
+                 << model_proto.intervals(i).DebugString()
+                 << " was not parsed correctly";
+      return false;
+    }
+  }
+  for (int i = 0; i < model_proto.sequences_size(); ++i) {
+    if (!builder->BuildFromProto(model_proto.sequences(i))) {
+      LOG(ERROR) << "Sequence variable proto "
+                 << model_proto.sequences(i).DebugString()
+                 << " was not parsed correctly";
+      return false;
+    }
+  }
+  for (int i = 0; i < model_proto.expressions_size(); ++i) {
+    if (!builder->BuildFromProto(model_proto.expressions(i))) {
+      LOG(ERROR) << "Integer expression proto "
+                 << model_proto.expressions(i).DebugString()
+                 << " was not parsed correctly";
+      return false;
+    }
+  }
+  for (int i = 0; i < model_proto.constraints_size(); ++i) {
+    Constraint* const constraint =
+        builder->BuildFromProto(model_proto.constraints(i));
+    if (constraint == nullptr) {
+      LOG(ERROR) << "Constraint proto "
+                 << model_proto.constraints(i).DebugString()
+                 << " was not parsed correctly";
+      return false;
+    }
+    builder->solver()->AddConstraint(constraint);
+  }
+  return true;
+}
+
+// Appends the search limit and objective of a model to monitors.
+void LoadModelMonitors(const CPModelProto& model_proto,
+                       CPModelLoader* const builder,
+                       std::vector<SearchMonitor*>* const monitors) {
+  Solver* const solver = builder->solver();
+  if (model_proto.has_search_limit()) {
+    monitors->push_back(solver->MakeLimit(model_proto.search_limit()));
+  }
+  if (model_proto.has_objective()) {
+    const CPObjectiveProto& objective_proto = model_proto.objective();
+    IntVar* const objective_var =
+        builder->IntegerExpression(objective_proto.objective_index())->Var();
+    const bool maximize = objective_proto.maximize();
+    const int64 step = objective_proto.step();
+    OptimizeVar* const objective =
+        solver->MakeOptimize(maximize, objective_var, step);
+    monitors->push_back(objective);
+  }
+}
+
+// Chunks of model files, see Solver::ExportModelToFile().
+enum ModelChunkType { MODEL_HEADER_CHUNK = 0, MODEL_ELEMENTS_CHUNK = 1 };
+
+// Moves the elements of a repeated field of 'body' to chunks of at most
+// 'elements_per_chunk' elements, and writes them. The content of the
+// elements is released as soon as it is written.
+template <class T>
+bool WriteModelChunks(
+    CPModelProto* const body,
+    google::protobuf::RepeatedPtrField<T>* (CPModelProto::*field)(),
+    int elements_per_chunk, ChunkWriter* const writer) {
+  google::protobuf::RepeatedPtrField<T>* const elements = (body->*field)();
+  CPModelProto chunk;
+  for (int i = 0; i < elements->size(); ++i) {
+    (chunk.*field)()->Add()->Swap(elements->Mutable(i));
+    if ((chunk.*field)()->size() == elements_per_chunk ||
+        i == elements->size() - 1) {
+      if (!writer->WriteChunk(MODEL_ELEMENTS_CHUNK, chunk)) {
+        return false;
+      }
+      CPModelProto().Swap(&chunk);
+    }
+  }
+  elements->Clear();
+  return true;
+}
+}  // namespace
+
 // ----- Solver API -----
 
 void Solver::ExportModel(const std::vector<SearchMonitor*>& monitors,
@@ -2525,12 +2617,108 @@ void Solver::ExportModel(CPModelProto* const model_proto) const {
   Accept(&second_pass);
 }
 
+void Solver::ExportModel(const std::vector<IntVar*>& vars,
+                         CPModelProto* const model_proto,
+                         std::vector<int>* const indices) const {
+  CHECK(model_proto != nullptr);
+  CHECK(indices != nullptr);
+  FirstPassVisitor first_pass;
+  Accept(&first_pass);
+  SecondPassVisitor second_pass(first_pass, model_proto);
+  Accept(&second_pass);
+  indices->assign(vars.size(), -1);
+  for (int i = 0; i < vars.size(); ++i) {
+    const IntExpr* const delegate =
+        FindWithDefault(first_pass.delegate_map(), vars[i], nullptr);
+    const IntExpr* const expression =
+        delegate != nullptr ? delegate : vars[i];
+    FindCopy(first_pass.expression_map(), expression, &(*indices)[i]);
+  }
+}
+
+bool Solver::ExportModelToFile(const std::vector<SearchMonitor*>& monitors,
+                               const std::string& filename,
+                               int elements_per_chunk) const {
+  CHECK_LT(0, elements_per_chunk);
+  CPModelProto header;
+  ExportModel(monitors, &header);
+  CPModelProto body;
+  body.mutable_intervals()->Swap(header.mutable_intervals());
+  body.mutable_sequences()->Swap(header.mutable_sequences());
+  body.mutable_expressions()->Swap(header.mutable_expressions());
+  body.mutable_constraints()->Swap(header.mutable_constraints());
+  File* const file = File::Open(filename, "w");
+  if (file == nullptr) {
+    LOG(ERROR) << "Cannot open " << filename;
+    return false;
+  }
+  ChunkWriter writer(file);
+  // Elements are written in the order in which LoadModel() builds them.
+  const bool written =
+      writer.WriteChunk(MODEL_HEADER_CHUNK, header) &&
+      WriteModelChunks(&body, &CPModelProto::mutable_intervals,
+                       elements_per_chunk, &writer) &&
+      WriteModelChunks(&body, &CPModelProto::mutable_sequences,
+                       elements_per_chunk, &writer) &&
+      WriteModelChunks(&body, &CPModelProto::mutable_expressions,
+                       elements_per_chunk, &writer) &&
+      WriteModelChunks(&body, &CPModelProto::mutable_constraints,
+                       elements_per_chunk, &writer);
+  return writer.Close() && written;
+}
+
+bool Solver::LoadModelFromFile(const std::string& filename,
+                               std::vector<SearchMonitor*>* monitors) {
+  ChunkReader reader;
+  if (!reader.Open(filename)) {
+    LOG(ERROR) << "Cannot open " << filename << " as a chunked model";
+    return false;
+  }
+  CPModelProto header;
+  int type = -1;
+  if (!reader.ReadChunk(&type, &header) || type != MODEL_HEADER_CHUNK) {
+    LOG(ERROR) << "Missing model header in " << filename;
+    return false;
+  }
+  if (header.version() > kModelVersion) {
+    LOG(ERROR) << "Model protocol buffer version is greater than"
+               << " the one compiled in the reader (" << header.version()
+               << " vs " << kModelVersion << ")";
+    return false;
+  }
+  CPModelLoader builder(this);
+  for (int i = 0; i < header.tags_size(); ++i) {
+    builder.AddTag(header.tags(i));
+  }
+  CPModelProto chunk;
+  while (reader.ReadChunk(&type, &chunk)) {
+    if (type != MODEL_ELEMENTS_CHUNK || !LoadModelElements(chunk, &builder)) {
+      LOG(ERROR) << "Invalid model chunk in " << filename;
+      return false;
+    }
+  }
+  if (!reader.ok()) {
+    LOG(ERROR) << "Corrupted model file " << filename;
+    return false;
+  }
+  if (monitors != nullptr) {
+    LoadModelMonitors(header, &builder, monitors);
+  }
+  return reader.Close();
+}
+
 bool Solver::LoadModel(const CPModelProto& model_proto) {
   return LoadModel(model_proto, nullptr);
 }
 
 bool Solver::LoadModel(const CPModelProto& model_proto,
                        std::vector<SearchMonitor*>* monitors) {
+  return LoadModel(model_proto, monitors, nullptr);
+}
+
+bool Solver::LoadModel(const CPModelProto& model_proto,
+                       std::vector<SearchMonitor*>* monitors,
+                       std::vector<IntExpr*>* expressions) {
   if (model_proto.version() > kModelVersion) {
     LOG(ERROR) << "Model protocol buffer version is greater than"
                << " the one compiled in the reader (" << model_proto.version()
@@ -2541,54 +2729,20 @@ bool Solver::LoadModel(const CPModelProto& model_proto,
   for (int i = 0; i < model_proto.tags_size(); ++i) {
     builder.AddTag(model_proto.tags(i));
   }
-  for (int i = 0; i < model_proto.intervals_size(); ++i) {
-    if (!builder.BuildFromProto(model_proto.intervals(i))) {
-      LOG(ERROR) << "Interval variable proto "
-                 << model_proto.intervals(i).DebugString()
-                 << " was not parsed correctly";
-      return false;
-    }
-  }
-  for (int i = 0; i < model_proto.sequences_size(); ++i) {
-    if (!builder.BuildFromProto(model_proto.sequences(i))) {
-      LOG(ERROR) << "Sequence variable proto "
-                 << model_proto.sequences(i).DebugString()
-                 << " was not parsed correctly";
-      return false;
-    }
-  }
-  for (int i = 0; i < model_proto.expressions_size(); ++i) {
-    if (!builder.BuildFromProto(model_proto.expressions(i))) {
-      LOG(ERROR) << "Integer expression proto "
-                 << model_proto.expressions(i).DebugString()
-                 << " was not parsed correctly";
-      return false;
-    }
-  }
-  for (int i = 0; i < model_proto.constraints_size(); ++i) {
-    Constraint* const constraint =
-        builder.BuildFromProto(model_proto.constraints(i));
-    if (constraint == nullptr) {
-      LOG(ERROR) << "Constraint proto "
-                 << model_proto.constraints(i).DebugString()
-                 << " was not parsed correctly";
-      return false;
-    }
-    AddConstraint(constraint);
+  if (!LoadModelElements(model_proto, &builder)) {
+    return false;
   }
   if (monitors != nullptr) {
-    if (model_proto.has_search_limit()) {
-      monitors->push_back(MakeLimit(model_proto.search_limit()));
-    }
-    if (model_proto.has_objective()) {
-      const CPObjectiveProto& objective_proto = model_proto.objective();
-      IntVar* const objective_var =
-          builder.IntegerExpression(objective_proto.objective_index())->Var();
-      const bool maximize = objective_proto.maximize();
-      const int64 step = objective_proto.step();
-      OptimizeVar* const objective =
-          MakeOptimize(maximize, objective_var, step);
-      monitors->push_back(objective);
+    LoadModelMonitors(model_proto, &builder, monitors);
+  }
+  if (expressions != nullptr) {
+    expressions->assign(model_proto.expressions_size(), nullptr);
+    for (int i = 0; i < model_proto.expressions_size(); ++i) {
+      const int index = model_proto.expressions(i).index();
+      if (index >= expressions->size()) {
+        expressions->resize(index + 1, nullptr);
+      }
+      (*expressions)[index] = builder.IntegerExpression(index);
     }
   }
   return true;
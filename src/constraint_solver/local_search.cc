@@ -28,6 +28,9 @@
 #include "base/logging.h"
 #include "base/macros.h"
 #include "base/map_util.h"
+#include "base/stringprintf.h"
+#include "base/threadpool.h"
+#include "base/time_support.h"
 #include "base/hash.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
@@ -44,6 +47,15 @@ DEFINE_int32(cp_local_search_tsp_opt_size, 13,
 DEFINE_int32(cp_local_search_tsp_lns_size, 10,
              "Size of TSPs solved in the TSPLns operator.");
 
+DEFINE_int32(cp_local_search_batch_size, 1,
+             "Number of neighbors generated and filtered together by the "
+             "local search before restoring the accepted ones. Batches are "
+             "only used when no filter is incremental.");
+
+DEFINE_int32(cp_local_search_filter_threads, 4,
+             "Number of threads running the thread-safe filters on a batch of "
+             "neighbors.");
+
 DEFINE_bool(cp_use_empty_path_symmetry_breaker, true,
             "If true, equivalent empty paths are removed from the neighborhood "
             "of PathOperators");
@@ -185,6 +197,209 @@ LocalSearchOperator* Solver::MakeRandomLNSOperator(const std::vector<IntVar*>& v
   return RevAlloc(new RandomLNS(vars, number_of_variables, seed));
 }
 
+// ----- Large Neighborhood Search operators on sequence variables -----
+
+// Sequence variables can only be partially relaxed by ranking a prefix of
+// their intervals first (forward sequence) and a suffix last (backward
+// sequence), the intervals in between being left free. All the operators
+// below build neighbors this way, and like RandomLNS, always return
+// neighbors: they must be used with a search limit.
+
+namespace {
+class BaseSequenceLNS : public SequenceVarLocalSearchOperator {
+ public:
+  BaseSequenceLNS(const std::vector<SequenceVar*>& vars, int32 seed)
+      : SequenceVarLocalSearchOperator(vars), rand_(seed) {}
+  ~BaseSequenceLNS() override {}
+
+  bool MakeNextNeighbor(Assignment* delta, Assignment* deltadelta) override {
+    CHECK(delta != nullptr);
+    while (true) {
+      RevertChanges(true);
+      if (!MakeOneNeighbor()) {
+        return false;
+      }
+      if (ApplyChanges(delta, deltadelta)) {
+        VLOG(2) << "Delta (" << DebugString() << ") = " << delta->DebugString();
+        return true;
+      }
+    }
+    return false;
+  }
+
+ protected:
+  virtual bool MakeOneNeighbor() = 0;
+
+  // Ranks the 'forward' first intervals of the sequence at 'index' first,
+  // the 'backward' last ones last, and frees the others.
+  void RelaxSequence(int index, int forward, int backward) {
+    const std::vector<int>& sequence = Sequence(index);
+    const int size = sequence.size();
+    DCHECK_LE(forward + backward, size);
+    const std::vector<int> forward_sequence(sequence.begin(),
+                                            sequence.begin() + forward);
+    std::vector<int> backward_sequence;
+    for (int i = size - 1; i >= size - backward; --i) {
+      backward_sequence.push_back(sequence[i]);
+    }
+    SetForwardSequence(index, forward_sequence);
+    SetBackwardSequence(index, backward_sequence);
+  }
+
+  ACMRandom rand_;
+};
+
+// Relaxes, on all sequences, the intervals which start in a time window.
+// The window starts at a random interval, and spans the time covered by
+// 'window_size' consecutive intervals of its sequence. Start times are read
+// from the assignment when it contains the intervals of the sequences, in
+// which case the window is consistent across sequences (e.g. machines of a
+// job-shop); otherwise ranks are used as time.
+class TimeWindowSequenceLNS : public BaseSequenceLNS {
+ public:
+  TimeWindowSequenceLNS(const std::vector<SequenceVar*>& vars,
+                        int window_size, int32 seed)
+      : BaseSequenceLNS(vars, seed), window_size_(window_size) {
+    CHECK_GT(window_size_, 0);
+  }
+  ~TimeWindowSequenceLNS() override {}
+
+  // The start times of the intervals are only available in the assignment,
+  // which OnStart() does not see.
+  void Start(const Assignment* assignment) override {
+    BaseSequenceLNS::Start(assignment);
+    times_.resize(Size());
+    for (int i = 0; i < Size(); ++i) {
+      times_[i].clear();
+      for (const int interval_index : Sequence(i)) {
+        times_[i].push_back(
+            StartTime(*assignment, i, interval_index, times_[i].size()));
+      }
+    }
+  }
+
+  std::string DebugString() const override { return "TimeWindowSequenceLNS"; }
+
+ protected:
+  bool MakeOneNeighbor() override {
+    if (Size() == 0) {
+      return false;
+    }
+    const int pivot_var = rand_.Uniform(Size());
+    const std::vector<int64>& pivot_times = times_[pivot_var];
+    if (pivot_times.empty()) {
+      return true;
+    }
+    const int pivot = rand_.Uniform(pivot_times.size());
+    const int last =
+        std::min(static_cast<int>(pivot_times.size()), pivot + window_size_) -
+        1;
+    const int64 window_start = pivot_times[pivot];
+    const int64 window_end = pivot_times[last];
+    for (int i = 0; i < Size(); ++i) {
+      const std::vector<int64>& times = times_[i];
+      const int size = times.size();
+      int forward = 0;
+      while (forward < size && times[forward] < window_start) {
+        ++forward;
+      }
+      int backward = 0;
+      while (backward < size - forward &&
+             times[size - 1 - backward] > window_end) {
+        ++backward;
+      }
+      RelaxSequence(i, forward, backward);
+    }
+    return true;
+  }
+
+ private:
+  int64 StartTime(const Assignment& assignment, int var_index,
+                  int interval_index, int rank) const {
+    IntervalVar* const interval = Var(var_index)->Interval(interval_index);
+    const IntervalVarElement* const element =
+        assignment.IntervalVarContainer().ElementPtrOrNull(interval);
+    return element != nullptr ? element->StartMin() : rank;
+  }
+
+  const int window_size_;
+  // Start times of the intervals of each sequence, in sequence order.
+  std::vector<std::vector<int64> > times_;
+};
+
+// Relaxes 'number_of_sequences' random sequences (e.g. machines) entirely,
+// the other sequences keeping their ranking.
+class ResourceSequenceLNS : public BaseSequenceLNS {
+ public:
+  ResourceSequenceLNS(const std::vector<SequenceVar*>& vars,
+                      int number_of_sequences, int32 seed)
+      : BaseSequenceLNS(vars, seed), number_of_sequences_(number_of_sequences) {
+    CHECK_GT(number_of_sequences_, 0);
+  }
+  ~ResourceSequenceLNS() override {}
+
+  std::string DebugString() const override { return "ResourceSequenceLNS"; }
+
+ protected:
+  bool MakeOneNeighbor() override {
+    for (int i = 0; i < number_of_sequences_ && i < Size(); ++i) {
+      RelaxSequence(rand_.Uniform(Size()), 0, 0);
+    }
+    return Size() > 0;
+  }
+
+ private:
+  const int number_of_sequences_;
+};
+
+// Relaxes up to 'max_length' consecutive intervals of one random sequence.
+// All precedences between the other intervals of the sequence are kept, as
+// well as the rankings of the other sequences.
+class SubsequenceLNS : public BaseSequenceLNS {
+ public:
+  SubsequenceLNS(const std::vector<SequenceVar*>& vars, int max_length,
+                 int32 seed)
+      : BaseSequenceLNS(vars, seed), max_length_(max_length) {
+    CHECK_GT(max_length_, 0);
+  }
+  ~SubsequenceLNS() override {}
+
+  std::string DebugString() const override { return "SubsequenceLNS"; }
+
+ protected:
+  bool MakeOneNeighbor() override {
+    if (Size() == 0) {
+      return false;
+    }
+    const int index = rand_.Uniform(Size());
+    const int size = Sequence(index).size();
+    const int length = std::min(size, max_length_);
+    const int start = rand_.Uniform(size - length + 1);
+    RelaxSequence(index, start, size - start - length);
+    return true;
+  }
+
+ private:
+  const int max_length_;
+};
+}  // namespace
+
+LocalSearchOperator* Solver::MakeTimeWindowSequenceLNSOperator(
+    const std::vector<SequenceVar*>& vars, int window_size, int32 seed) {
+  return RevAlloc(new TimeWindowSequenceLNS(vars, window_size, seed));
+}
+
+LocalSearchOperator* Solver::MakeResourceSequenceLNSOperator(
+    const std::vector<SequenceVar*>& vars, int number_of_sequences,
+    int32 seed) {
+  return RevAlloc(new ResourceSequenceLNS(vars, number_of_sequences, seed));
+}
+
+LocalSearchOperator* Solver::MakeSubsequenceLNSOperator(
+    const std::vector<SequenceVar*>& vars, int max_length, int32 seed) {
+  return RevAlloc(new SubsequenceLNS(vars, max_length, seed));
+}
+
 // ----- Move Toward Target Local Search operator -----
 
 // A local search operator that compares the current assignment with a target
@@ -274,6 +489,89 @@ LocalSearchOperator* Solver::MakeMoveTowardTargetOperator(
   return RevAlloc(new MoveTowardTargetLS(variables, target_values));
 }
 
+// ----- Path Relinking operator -----
+
+namespace {
+class PathRelinkingOperator : public IntVarLocalSearchOperator {
+ public:
+  // At most kMaxSteps intermediate solutions are generated between the
+  // current solution and the guiding one.
+  static const int kMaxSteps = 16;
+
+  PathRelinkingOperator(const std::vector<IntVar*>& vars,
+                        EliteSolutionPool* const elite, int32 seed)
+      : IntVarLocalSearchOperator(vars),
+        elite_(elite),
+        rand_(seed),
+        num_changed_(0),
+        stride_(1) {
+    CHECK(elite != nullptr);
+  }
+
+  ~PathRelinkingOperator() override {}
+
+  std::string DebugString() const override { return "PathRelinkingOperator"; }
+
+ protected:
+  bool MakeOneNeighbor() override {
+    num_changed_ += stride_;
+    if (num_changed_ >= differences_.size()) {
+      return false;
+    }
+    for (int i = 0; i < num_changed_; ++i) {
+      const int index = differences_[i];
+      SetValue(index, guide_[index]);
+    }
+    return true;
+  }
+
+ private:
+  void OnStart() override {
+    differences_.clear();
+    num_changed_ = 0;
+    current_.resize(Size());
+    for (int i = 0; i < Size(); ++i) {
+      current_[i] = OldValue(i);
+    }
+    // Picks the first member, from a random one, which is at least two
+    // variables away from the current solution.
+    const int pool_size = elite_->size();
+    const int first = pool_size > 0 ? rand_.Uniform(pool_size) : 0;
+    int64 objective = 0;
+    for (int i = 0; i < pool_size; ++i) {
+      if (elite_->Get(first + i, &guide_, &objective) &&
+          guide_.size() == Size() &&
+          EliteSolutionPool::Distance(current_, guide_) >= 2) {
+        for (int index = 0; index < Size(); ++index) {
+          if (current_[index] != guide_[index]) {
+            differences_.push_back(index);
+          }
+        }
+        break;
+      }
+    }
+    std::random_shuffle(differences_.begin(), differences_.end(), rand_);
+    stride_ = std::max<int>(1, (differences_.size() + kMaxSteps - 1) / kMaxSteps);
+  }
+
+  EliteSolutionPool* const elite_;
+  ACMRandom rand_;
+  std::vector<int64> current_;
+  std::vector<int64> guide_;
+  // The variables on which the current and guiding solutions differ, in the
+  // order in which they are moved to the guiding solution.
+  std::vector<int> differences_;
+  int num_changed_;
+  int stride_;
+};
+}  // namespace
+
+LocalSearchOperator* Solver::MakePathRelinkingOperator(
+    const std::vector<IntVar*>& vars, EliteSolutionPool* const elite,
+    int32 seed) {
+  return RevAlloc(new PathRelinkingOperator(vars, elite, seed));
+}
+
 // ----- ChangeValue Operators -----
 
 ChangeValue::ChangeValue(const std::vector<IntVar*>& vars)
@@ -344,17 +642,38 @@ void PathOperator::OnStart() {
 }
 
 bool PathOperator::MakeOneNeighbor() {
+  // Incremental operators rely on MakeNeighbor() being called on all
+  // positions, so the neighbor restriction is checked after building moves.
+  const bool check_restriction_after_move = IsIncremental();
   while (IncrementPosition()) {
     // Need to revert changes here since MakeNeighbor might have returned false
     // and have done changes in the previous iteration.
     RevertChanges(true);
-    if (MakeNeighbor()) {
+    if (!check_restriction_after_move && !IsAllowedByNeighborRestriction()) {
+      continue;
+    }
+    if (MakeNeighbor() && (!check_restriction_after_move ||
+                           IsAllowedByNeighborRestriction())) {
       return true;
     }
   }
   return false;
 }
 
+bool PathOperator::GetNeighborPair(int64* node1, int64* node2) const {
+  if (base_nodes_.size() < 2) return false;
+  *node1 = BaseNode(0);
+  *node2 = BaseNode(1);
+  return true;
+}
+
+bool PathOperator::IsAllowedByNeighborRestriction() const {
+  if (are_neighbors_ == nullptr) return true;
+  int64 node1 = -1;
+  int64 node2 = -1;
+  return !GetNeighborPair(&node1, &node2) || are_neighbors_(node1, node2);
+}
+
 bool PathOperator::SkipUnchanged(int index) const {
   if (ignore_path_vars_) {
     return true;
@@ -741,6 +1060,13 @@ class Relocate : public PathOperator {
     // version.
     return single_path_;
   }
+  // The first node of the moved chain must be close to its destination.
+  bool GetNeighborPair(int64* node1, int64* node2) const override {
+    if (IsPathEnd(BaseNode(0))) return false;
+    *node1 = OldNext(BaseNode(0));
+    *node2 = BaseNode(1);
+    return true;
+  }
 
  private:
   const int64 chain_length_;
@@ -780,6 +1106,15 @@ class Exchange : public PathOperator {
   bool MakeNeighbor() override;
 
   std::string DebugString() const override { return "Exchange"; }
+
+ protected:
+  // The second exchanged node must be close to the position of the first one.
+  bool GetNeighborPair(int64* node1, int64* node2) const override {
+    if (IsPathEnd(BaseNode(1))) return false;
+    *node1 = BaseNode(0);
+    *node2 = OldNext(BaseNode(1));
+    return true;
+  }
 };
 
 bool Exchange::MakeNeighbor() {
@@ -858,6 +1193,12 @@ class BaseInactiveNodeToPathOperator : public PathOperator {
  protected:
   bool MakeOneNeighbor() override;
   int64 GetInactiveNode() const { return inactive_node_; }
+  // The inserted node must be close to its insertion position.
+  bool GetNeighborPair(int64* node1, int64* node2) const override {
+    *node1 = GetInactiveNode();
+    *node2 = BaseNode(0);
+    return true;
+  }
 
  private:
   void OnNodeInitialization() override;
@@ -1847,6 +2188,173 @@ LocalSearchOperator* Solver::RandomConcatenateOperators(
   return RevAlloc(new RandomCompoundOperator(ops, seed));
 }
 
+namespace {
+// Picks operators randomly, with a probability proportional to the rate at
+// which they produce accepted neighbors per unit of time (a bandit with
+// recency-weighted rewards). A neighbor is accepted when the local search
+// calls Start() right after it. The time charged to an operator for a
+// neighbor runs from the call to the operator until the next call to
+// MakeNextNeighbor() or Start(), so that filtering and evaluating the
+// neighbor, which usually dominate, are accounted for.
+// Statistics are exponential moving averages, and selection weights are
+// bounded from below so that no operator is ever starved.
+class AdaptiveCompoundOperator : public LocalSearchOperator {
+ public:
+  AdaptiveCompoundOperator(const std::vector<LocalSearchOperator*>& operators,
+                           int32 seed);
+  ~AdaptiveCompoundOperator() override {}
+  void Start(const Assignment* assignment) override;
+  bool MakeNextNeighbor(Assignment* delta, Assignment* deltadelta) override;
+
+  std::string DebugString() const override;
+
+ private:
+  struct OperatorStats {
+    OperatorStats()
+        : success_rate(1.0), average_time(0.0), neighbors(0), accepted(0) {}
+    // Moving averages over the last neighbors.
+    double success_rate;
+    double average_time;
+    int64 neighbors;
+    int64 accepted;
+  };
+
+  static const double kDecay;
+  static const double kMinWeight;
+
+  void RecordLastNeighbor(bool accepted);
+  void ComputeWeights();
+
+  const std::vector<LocalSearchOperator*> operators_;
+  ACMRandom rand_;
+  std::vector<OperatorStats> stats_;
+  std::vector<double> weights_;
+  // Operators which have no more neighbors since the last call to Start().
+  std::vector<bool> exhausted_;
+  // Operator which made the last neighbor, -1 if none.
+  int last_;
+  int64 last_start_time_;
+};
+
+const double AdaptiveCompoundOperator::kDecay = 0.9;
+const double AdaptiveCompoundOperator::kMinWeight = 0.05;
+
+AdaptiveCompoundOperator::AdaptiveCompoundOperator(
+    const std::vector<LocalSearchOperator*>& operators, int32 seed)
+    : operators_(operators),
+      rand_(seed),
+      stats_(operators.size()),
+      weights_(operators.size(), 1.0),
+      exhausted_(operators.size(), false),
+      last_(-1),
+      last_start_time_(0) {}
+
+void AdaptiveCompoundOperator::RecordLastNeighbor(bool accepted) {
+  if (last_ == -1) {
+    return;
+  }
+  OperatorStats* const stats = &stats_[last_];
+  const double elapsed = base::GetCurrentTimeNanos() - last_start_time_;
+  if (stats->neighbors == 0) {
+    stats->average_time = elapsed;
+  } else {
+    stats->average_time =
+        kDecay * stats->average_time + (1.0 - kDecay) * elapsed;
+  }
+  stats->success_rate =
+      kDecay * stats->success_rate + (accepted ? 1.0 - kDecay : 0.0);
+  ++stats->neighbors;
+  if (accepted) {
+    ++stats->accepted;
+  }
+  last_ = -1;
+  ComputeWeights();
+}
+
+void AdaptiveCompoundOperator::ComputeWeights() {
+  // Operators which were never run are given the best reward, so that they
+  // are tried early.
+  double best_reward = 0;
+  std::vector<double> rewards(operators_.size(), -1);
+  for (int i = 0; i < operators_.size(); ++i) {
+    if (stats_[i].neighbors > 0) {
+      rewards[i] =
+          stats_[i].success_rate / std::max(1.0, stats_[i].average_time);
+      best_reward = std::max(best_reward, rewards[i]);
+    }
+  }
+  for (int i = 0; i < operators_.size(); ++i) {
+    if (rewards[i] < 0 || best_reward == 0) {
+      weights_[i] = 1.0;
+    } else {
+      weights_[i] = std::max(kMinWeight, rewards[i] / best_reward);
+    }
+  }
+}
+
+void AdaptiveCompoundOperator::Start(const Assignment* assignment) {
+  RecordLastNeighbor(true);
+  exhausted_.assign(operators_.size(), false);
+  for (LocalSearchOperator* const op : operators_) {
+    op->Start(assignment);
+  }
+}
+
+bool AdaptiveCompoundOperator::MakeNextNeighbor(Assignment* delta,
+                                                Assignment* deltadelta) {
+  RecordLastNeighbor(false);
+  while (true) {
+    double total_weight = 0;
+    for (int i = 0; i < operators_.size(); ++i) {
+      if (!exhausted_[i]) {
+        total_weight += weights_[i];
+      }
+    }
+    if (total_weight == 0) {
+      return false;
+    }
+    double selected = rand_.RndDouble() * total_weight;
+    int index = -1;
+    for (int i = 0; i < operators_.size(); ++i) {
+      if (!exhausted_[i]) {
+        index = i;
+        selected -= weights_[i];
+        if (selected < 0) {
+          break;
+        }
+      }
+    }
+    DCHECK_NE(-1, index);
+    const int64 start_time = base::GetCurrentTimeNanos();
+    if (operators_[index]->MakeNextNeighbor(delta, deltadelta)) {
+      last_ = index;
+      last_start_time_ = start_time;
+      return true;
+    }
+    exhausted_[index] = true;
+  }
+  return false;
+}
+
+std::string AdaptiveCompoundOperator::DebugString() const {
+  std::string out = "AdaptiveCompoundOperator(";
+  for (int i = 0; i < operators_.size(); ++i) {
+    if (i > 0) {
+      out += ", ";
+    }
+    out += StringPrintf("%s: %lld/%lld, weight %.2f",
+                        operators_[i]->DebugString().c_str(),
+                        stats_[i].accepted, stats_[i].neighbors, weights_[i]);
+  }
+  return out + ")";
+}
+}  // namespace
+
+LocalSearchOperator* Solver::AdaptiveConcatenateOperators(
+    const std::vector<LocalSearchOperator*>& ops, int32 seed) {
+  return RevAlloc(new AdaptiveCompoundOperator(ops, seed));
+}
+
 // ----- Operator factory -----
 
 template <class T>
@@ -2100,6 +2608,8 @@ class VariableDomainFilter : public LocalSearchFilter {
   void Synchronize(const Assignment* assignment,
                    const Assignment* delta) override {}
 
+  bool IsThreadSafe() const override { return true; }
+
   std::string DebugString() const override { return "VariableDomainFilter"; }
 };
 
@@ -2526,11 +3036,33 @@ class FindOneNeighbor : public DecisionBuilder {
 
  private:
   bool FilterAccept(const Assignment* delta, const Assignment* deltadelta);
+  // Batched version of the search loop of Next(); returns true if a neighbor
+  // was restored.
+  bool FindNeighborInBatches(Solver* const solver,
+                             Assignment* const assignment_copy,
+                             DecisionBuilder* const restore);
+  // Generates the next batch of neighbors and filters them.
+  void FillBatch(Solver* const solver);
   void SynchronizeAll();
   void SynchronizeFilters(const Assignment* assignment);
+  // Fills synchronization_delta_ with the variables of reference_assignment_
+  // whose values differ from previous_reference_assignment_. Returns false if
+  // the two assignments cannot be compared, in which case filters must be
+  // synchronized on the full assignment.
+  bool ComputeSynchronizationDelta();
 
   Assignment* const assignment_;
   std::unique_ptr<Assignment> reference_assignment_;
+  // Reference assignment on which filters were last synchronized, and the
+  // variables which changed since, from which filters are synchronized.
+  std::unique_ptr<Assignment> previous_reference_assignment_;
+  std::unique_ptr<Assignment> synchronization_delta_;
+  bool filters_synchronized_;
+  // Assignment on which deltas are applied. It mirrors reference_assignment_
+  // up to the last applied delta, which is reverted before applying the
+  // next one; it is fully copied only when the reference changes.
+  std::unique_ptr<Assignment> assignment_copy_;
+  bool assignment_copy_synced_;
   SolutionPool* const pool_;
   LocalSearchOperator* const ls_operator_;
   DecisionBuilder* const sub_decision_builder_;
@@ -2538,6 +3070,19 @@ class FindOneNeighbor : public DecisionBuilder {
   const SearchLimit* const original_limit_;
   bool neighbor_found_;
   std::vector<LocalSearchFilter*> filters_;
+  // Batched mode: the filters are split between the thread-safe ones, run
+  // in parallel on the neighbors of a batch, and the others. The neighbors
+  // accepted by all the filters are then restored in the order in which they
+  // were generated, as in the sequential mode.
+  bool batched_;
+  std::vector<LocalSearchFilter*> thread_safe_filters_;
+  std::vector<LocalSearchFilter*> sequential_filters_;
+  std::vector<std::unique_ptr<Assignment>> batch_deltas_;
+  std::vector<std::unique_ptr<Assignment>> batch_deltadeltas_;
+  std::vector<char> batch_accepted_;
+  int batch_size_;
+  int next_in_batch_;
+  std::unique_ptr<ThreadPool> filter_pool_;
 };
 
 // reference_assignment_ is used to keep track of the last assignment on which
@@ -2551,16 +3096,48 @@ FindOneNeighbor::FindOneNeighbor(Assignment* const assignment,
                                  const std::vector<LocalSearchFilter*>& filters)
     : assignment_(assignment),
       reference_assignment_(new Assignment(assignment_)),
+      previous_reference_assignment_(new Assignment(assignment_)),
+      synchronization_delta_(new Assignment(assignment_->solver())),
+      filters_synchronized_(false),
+      assignment_copy_(new Assignment(assignment_)),
+      assignment_copy_synced_(false),
       pool_(pool),
       ls_operator_(ls_operator),
       sub_decision_builder_(sub_decision_builder),
       limit_(nullptr),
       original_limit_(limit),
       neighbor_found_(false),
-      filters_(filters) {
+      filters_(filters),
+      batched_(FLAGS_cp_local_search_batch_size > 1),
+      batch_size_(0),
+      next_in_batch_(0) {
   CHECK(nullptr != assignment);
   CHECK(nullptr != ls_operator);
 
+  for (LocalSearchFilter* const filter : filters_) {
+    if (filter->IsIncremental()) {
+      batched_ = false;
+    } else if (filter->IsThreadSafe()) {
+      thread_safe_filters_.push_back(filter);
+    } else {
+      sequential_filters_.push_back(filter);
+    }
+  }
+  if (batched_) {
+    Solver* const solver = assignment_->solver();
+    for (int i = 0; i < FLAGS_cp_local_search_batch_size; ++i) {
+      batch_deltas_.emplace_back(new Assignment(solver));
+      batch_deltadeltas_.emplace_back(new Assignment(solver));
+    }
+    batch_accepted_.resize(FLAGS_cp_local_search_batch_size, false);
+    if (!thread_safe_filters_.empty() &&
+        FLAGS_cp_local_search_filter_threads > 1) {
+      filter_pool_.reset(new ThreadPool("LocalSearchFilters",
+                                        FLAGS_cp_local_search_filter_threads));
+      filter_pool_->StartWorkers();
+    }
+  }
+
   // If limit is nullptr, default limit is 1 solution
   if (nullptr == limit) {
     Solver* const solver = assignment_->solver();
@@ -2590,14 +3167,19 @@ Decision* FindOneNeighbor::Next(Solver* const solver) {
 
   {
     // Another assignment is needed to apply the delta
-    Assignment* assignment_copy =
-        solver->MakeAssignment(reference_assignment_.get());
+    Assignment* const assignment_copy = assignment_copy_.get();
     int counter = 0;
 
     DecisionBuilder* restore = solver->MakeRestoreAssignment(assignment_copy);
     if (sub_decision_builder_) {
       restore = solver->Compose(restore, sub_decision_builder_);
     }
+    if (batched_) {
+      if (FindNeighborInBatches(solver, assignment_copy, restore)) {
+        return nullptr;
+      }
+      solver->Fail();
+    }
     Assignment* delta = solver->MakeAssignment();
     Assignment* deltadelta = solver->MakeAssignment();
     while (true) {
@@ -2624,8 +3206,12 @@ Decision* FindOneNeighbor::Next(Solver* const solver) {
         const bool move_filter = FilterAccept(delta, deltadelta);
         if (mh_filter && move_filter) {
           solver->filtered_neighbors_ += 1;
-          assignment_copy->Copy(reference_assignment_.get());
-          assignment_copy->Copy(delta);
+          assignment_copy->RevertTracked(reference_assignment_.get());
+          if (!assignment_copy_synced_) {
+            assignment_copy->Copy(reference_assignment_.get());
+            assignment_copy_synced_ = true;
+          }
+          assignment_copy->CopyTracked(delta);
           if (solver->SolveAndCommit(restore)) {
             solver->accepted_neighbors_ += 1;
             assignment_->Store();
@@ -2651,6 +3237,91 @@ Decision* FindOneNeighbor::Next(Solver* const solver) {
   return nullptr;
 }
 
+bool FindOneNeighbor::FindNeighborInBatches(Solver* const solver,
+                                            Assignment* const assignment_copy,
+                                            DecisionBuilder* const restore) {
+  int counter = 0;
+  while (true) {
+    if (next_in_batch_ == batch_size_) {
+      solver->TopPeriodicCheck();
+      if (counter >= FLAGS_cp_local_search_sync_frequency &&
+          pool_->SyncNeeded(reference_assignment_.get())) {
+        counter = 0;
+        SynchronizeAll();
+      }
+      FillBatch(solver);
+      counter += batch_size_;
+      if (batch_size_ == 0) {
+        if (neighbor_found_) {
+          AcceptNeighbor(solver->ParentSearch());
+          pool_->RegisterNewSolution(assignment_);
+          SynchronizeAll();
+          continue;
+        }
+        return false;
+      }
+    }
+    const int candidate = next_in_batch_++;
+    if (!batch_accepted_[candidate]) continue;
+    assignment_copy->RevertTracked(reference_assignment_.get());
+    if (!assignment_copy_synced_) {
+      assignment_copy->Copy(reference_assignment_.get());
+      assignment_copy_synced_ = true;
+    }
+    assignment_copy->CopyTracked(batch_deltas_[candidate].get());
+    if (solver->SolveAndCommit(restore)) {
+      solver->accepted_neighbors_ += 1;
+      assignment_->Store();
+      neighbor_found_ = true;
+      return true;
+    }
+  }
+}
+
+void FindOneNeighbor::FillBatch(Solver* const solver) {
+  batch_size_ = 0;
+  next_in_batch_ = 0;
+  // The metaheuristics are asked first, as they may tighten the objective
+  // bounds of the deltas which the filters read.
+  while (batch_size_ < batch_deltas_.size()) {
+    Assignment* const delta = batch_deltas_[batch_size_].get();
+    Assignment* const deltadelta = batch_deltadeltas_[batch_size_].get();
+    delta->Clear();
+    deltadelta->Clear();
+    if (limit_->Check() || !ls_operator_->MakeNextNeighbor(delta, deltadelta)) {
+      break;
+    }
+    solver->neighbors_ += 1;
+    batch_accepted_[batch_size_] =
+        AcceptDelta(solver->ParentSearch(), delta, deltadelta);
+    ++batch_size_;
+  }
+  const auto accept = [this](int64 begin, int64 end) {
+    for (int64 i = begin; i < end; ++i) {
+      for (LocalSearchFilter* const filter : thread_safe_filters_) {
+        if (!batch_accepted_[i]) break;
+        batch_accepted_[i] = filter->Accept(batch_deltas_[i].get(),
+                                            batch_deltadeltas_[i].get());
+      }
+    }
+  };
+  if (filter_pool_ != nullptr && batch_size_ > 1) {
+    filter_pool_->ParallelFor(batch_size_, 1, accept);
+  } else {
+    accept(0, batch_size_);
+  }
+  for (int i = 0; i < batch_size_; ++i) {
+    for (LocalSearchFilter* const filter : sequential_filters_) {
+      if (!batch_accepted_[i]) break;
+      batch_accepted_[i] =
+          filter->Accept(batch_deltas_[i].get(), batch_deltadeltas_[i].get());
+    }
+    if (batch_accepted_[i]) {
+      solver->filtered_neighbors_ += 1;
+    }
+  }
+}
+
 bool FindOneNeighbor::FilterAccept(const Assignment* delta,
                                    const Assignment* deltadelta) {
   bool ok = true;
@@ -2665,7 +3336,12 @@ bool FindOneNeighbor::FilterAccept(const Assignment* delta,
 }
 
 void FindOneNeighbor::SynchronizeAll() {
+  batch_size_ = 0;
+  next_in_batch_ = 0;
+  // The previous reference is kept to synchronize filters incrementally.
+  reference_assignment_.swap(previous_reference_assignment_);
   pool_->GetNextSolution(reference_assignment_.get());
+  assignment_copy_synced_ = false;
   neighbor_found_ = false;
   limit_->Init();
   ls_operator_->Start(reference_assignment_.get());
@@ -2673,9 +3349,47 @@ void FindOneNeighbor::SynchronizeAll() {
 }
 
 void FindOneNeighbor::SynchronizeFilters(const Assignment* assignment) {
+  // After the first synchronization, only the variables which changed are
+  // sent to the filters; an empty delta means a full synchronization.
+  const Assignment* const delta =
+      filters_synchronized_ && ComputeSynchronizationDelta()
+          ? synchronization_delta_.get()
+          : nullptr;
   for (int i = 0; i < filters_.size(); ++i) {
-    filters_[i]->Synchronize(assignment, nullptr);
+    filters_[i]->Synchronize(assignment, delta);
   }
+  filters_synchronized_ = true;
+}
+
+bool FindOneNeighbor::ComputeSynchronizationDelta() {
+  synchronization_delta_->Clear();
+  const Assignment::IntContainer& container =
+      reference_assignment_->IntVarContainer();
+  const Assignment::IntContainer& previous_container =
+      previous_reference_assignment_->IntVarContainer();
+  const int size = container.Size();
+  if (size != previous_container.Size()) return false;
+  // Beyond this number of changes, synchronizing from the full assignment is
+  // cheaper.
+  const int max_changes = size / 2;
+  int changes = 0;
+  for (int i = 0; i < size; ++i) {
+    const IntVarElement& element = container.Element(i);
+    const IntVarElement& previous_element = previous_container.Element(i);
+    if (element.Var() != previous_element.Var() || !element.Bound() ||
+        !previous_element.Bound()) {
+      return false;
+    }
+    if (element.Activated() != previous_element.Activated() ||
+        element.Value() != previous_element.Value()) {
+      if (++changes > max_changes) return false;
+      IntVarElement* const changed =
+          synchronization_delta_->FastAdd(element.Var());
+      changed->SetValue(element.Value());
+      if (!element.Activated()) changed->Deactivate();
+    }
+  }
+  return true;
 }
 
 // ---------- Local Search Phase Parameters ----------
@@ -3077,6 +3791,159 @@ SolutionPool* Solver::MakeDefaultSolutionPool() {
   return RevAlloc(new DefaultSolutionPool());
 }
 
+// ----- Elite solution pool -----
+
+EliteSolutionPool::EliteSolutionPool(int max_size, int min_distance)
+    : max_size_(max_size),
+      min_distance_(min_distance),
+      best_objective_(kint64max) {
+  CHECK_GT(max_size, 0);
+}
+
+EliteSolutionPool::~EliteSolutionPool() {}
+
+int EliteSolutionPool::Distance(const std::vector<int64>& a,
+                                const std::vector<int64>& b) {
+  DCHECK_EQ(a.size(), b.size());
+  int distance = 0;
+  for (int i = 0; i < a.size(); ++i) {
+    if (a[i] != b[i]) ++distance;
+  }
+  return distance;
+}
+
+bool EliteSolutionPool::Add(const std::vector<int64>& values, int64 objective) {
+  MutexLock lock(&mutex_);
+  int closest = -1;
+  int worst = -1;
+  for (int i = 0; i < members_.size(); ++i) {
+    if (closest == -1 && Distance(members_[i].values, values) < min_distance_) {
+      closest = i;
+    }
+    if (worst == -1 || members_[i].objective > members_[worst].objective) {
+      worst = i;
+    }
+  }
+  int replaced = -1;
+  if (closest != -1) {
+    if (objective >= members_[closest].objective) return false;
+    replaced = closest;
+  } else if (members_.size() < max_size_) {
+    members_.push_back(Member());
+    replaced = members_.size() - 1;
+  } else {
+    if (objective >= members_[worst].objective) return false;
+    replaced = worst;
+  }
+  members_[replaced].values = values;
+  members_[replaced].objective = objective;
+  UpdateBest();
+  return true;
+}
+
+void EliteSolutionPool::UpdateBest() {
+  int64 best = kint64max;
+  for (const Member& member : members_) {
+    best = std::min(best, member.objective);
+  }
+  best_objective_.store(best);
+}
+
+bool EliteSolutionPool::GetBest(std::vector<int64>* const values,
+                                int64* const objective) const {
+  MutexLock lock(&mutex_);
+  if (members_.empty()) return false;
+  int best = 0;
+  for (int i = 1; i < members_.size(); ++i) {
+    if (members_[i].objective < members_[best].objective) best = i;
+  }
+  *values = members_[best].values;
+  *objective = members_[best].objective;
+  return true;
+}
+
+bool EliteSolutionPool::Get(int index, std::vector<int64>* const values,
+                            int64* const objective) const {
+  MutexLock lock(&mutex_);
+  if (members_.empty()) return false;
+  const Member& member = members_[index % members_.size()];
+  *values = member.values;
+  *objective = member.objective;
+  return true;
+}
+
+int EliteSolutionPool::size() const {
+  MutexLock lock(&mutex_);
+  return members_.size();
+}
+
+namespace {
+// Solution pool publishing to an EliteSolutionPool, and restarting from its
+// best member when it beats the reference solution.
+class SharedSolutionPool : public SolutionPool {
+ public:
+  SharedSolutionPool(EliteSolutionPool* const elite,
+                     const std::vector<IntVar*>& vars)
+      : elite_(elite), vars_(vars), values_(vars.size()) {
+    CHECK(elite != nullptr);
+  }
+
+  ~SharedSolutionPool() override {}
+
+  void Initialize(Assignment* const assignment) override {
+    reference_assignment_.reset(new Assignment(assignment));
+    Publish(assignment);
+  }
+
+  void RegisterNewSolution(Assignment* const assignment) override {
+    reference_assignment_->Copy(assignment);
+    Publish(assignment);
+  }
+
+  void GetNextSolution(Assignment* const assignment) override {
+    int64 objective = kint64max;
+    if (elite_->best_objective() < Objective(reference_assignment_.get()) &&
+        elite_->GetBest(&values_, &objective)) {
+      for (int i = 0; i < vars_.size(); ++i) {
+        reference_assignment_->SetValue(vars_[i], values_[i]);
+      }
+      if (reference_assignment_->HasObjective()) {
+        reference_assignment_->SetObjectiveValue(objective);
+      }
+    }
+    assignment->Copy(reference_assignment_.get());
+  }
+
+  bool SyncNeeded(Assignment* const local_assignment) override {
+    return elite_->best_objective() < Objective(local_assignment);
+  }
+
+  std::string DebugString() const override { return "SharedSolutionPool"; }
+
+ private:
+  static int64 Objective(const Assignment* const assignment) {
+    return assignment->HasObjective() ? assignment->ObjectiveValue() : 0;
+  }
+
+  void Publish(const Assignment* const assignment) {
+    for (int i = 0; i < vars_.size(); ++i) {
+      values_[i] = assignment->Value(vars_[i]);
+    }
+    elite_->Add(values_, Objective(assignment));
+  }
+
+  EliteSolutionPool* const elite_;
+  const std::vector<IntVar*> vars_;
+  std::vector<int64> values_;
+  std::unique_ptr<Assignment> reference_assignment_;
+};
+}  // namespace
+
+SolutionPool* Solver::MakeSharedSolutionPool(EliteSolutionPool* const elite,
+                                             const std::vector<IntVar*>& vars) {
+  return RevAlloc(new SharedSolutionPool(elite, vars));
+}
+
 DecisionBuilder* Solver::MakeLocalSearchPhase(
     Assignment* assignment, LocalSearchPhaseParameters* parameters) {
   return RevAlloc(new LocalSearch(assignment, parameters->solution_pool(),
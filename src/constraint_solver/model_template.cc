@@ -0,0 +1,195 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "constraint_solver/model_template.h"
+
+#include <string>
+#include <vector>
+
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "constraint_solver/constraint_solver.h"
+#include "constraint_solver/model.pb.h"
+
+namespace operations_research {
+// Fixes the bound parameters of a template, then delegates to the search
+// decision builder, if any. Parameters are set directly instead of through
+// decisions: there is nothing to refute. The binder is allocated once per
+// template, so that repeated solves do not grow the solver memory.
+class ParameterBinder : public DecisionBuilder {
+ public:
+  ParameterBinder(const std::vector<IntVar*>& parameters,
+                  const std::vector<bool>* const bound,
+                  const std::vector<int64>* const values)
+      : parameters_(parameters),
+        bound_(bound),
+        values_(values),
+        next_(nullptr),
+        applied_(false) {}
+  ~ParameterBinder() override {}
+
+  void set_next(DecisionBuilder* const next) { next_ = next; }
+
+  Decision* Next(Solver* const solver) override {
+    if (!applied_.Value()) {
+      for (int i = 0; i < parameters_.size(); ++i) {
+        if ((*bound_)[i]) {
+          parameters_[i]->SetValue((*values_)[i]);
+        }
+      }
+      applied_.SetValue(solver, true);
+    }
+    return next_ == nullptr ? nullptr : next_->Next(solver);
+  }
+
+  void AppendMonitors(Solver* const solver,
+                      std::vector<SearchMonitor*>* const extras) override {
+    if (next_ != nullptr) {
+      next_->AppendMonitors(solver, extras);
+    }
+  }
+
+  void Accept(ModelVisitor* const visitor) const override {
+    if (next_ != nullptr) {
+      next_->Accept(visitor);
+    }
+  }
+
+  std::string DebugString() const override { return "ParameterBinder"; }
+
+ private:
+  const std::vector<IntVar*> parameters_;
+  const std::vector<bool>* const bound_;
+  const std::vector<int64>* const values_;
+  DecisionBuilder* next_;
+  Rev<bool> applied_;
+};
+
+namespace {
+int FindOrAddTag(const std::string& tag, CPModelProto* const proto) {
+  for (int i = 0; i < proto->tags_size(); ++i) {
+    if (proto->tags(i) == tag) {
+      return i;
+    }
+  }
+  proto->add_tags(tag);
+  return proto->tags_size() - 1;
+}
+}  // namespace
+
+const char ModelTemplate::kParameterGroup[] = "Parameters";
+
+bool ModelTemplate::DeclareParameter(const std::string& name,
+                                     CPModelProto* const proto) {
+  CHECK(proto != nullptr);
+  int expression_index = -1;
+  for (int i = 0; i < proto->expressions_size(); ++i) {
+    if (proto->expressions(i).name() == name) {
+      expression_index = proto->expressions(i).index();
+      break;
+    }
+  }
+  if (expression_index == -1) {
+    return false;
+  }
+  CPVariableGroup* group = nullptr;
+  for (int i = 0; i < proto->variable_groups_size(); ++i) {
+    if (proto->variable_groups(i).type() == kParameterGroup) {
+      group = proto->mutable_variable_groups(i);
+      break;
+    }
+  }
+  if (group == nullptr) {
+    group = proto->add_variable_groups();
+    group->set_type(kParameterGroup);
+    CPArgumentProto* const argument = group->add_arguments();
+    argument->set_argument_index(
+        FindOrAddTag(ModelVisitor::kVarsArgument, proto));
+  }
+  CPArgumentProto* const argument = group->mutable_arguments(0);
+  for (int i = 0; i < argument->integer_expression_array_size(); ++i) {
+    if (argument->integer_expression_array(i) == expression_index) {
+      return true;
+    }
+  }
+  argument->add_integer_expression_array(expression_index);
+  return true;
+}
+
+ModelTemplate::ModelTemplate(const std::string& name)
+    : solver_(new Solver(name)), binder_(nullptr) {}
+
+ModelTemplate::~ModelTemplate() {}
+
+bool ModelTemplate::Load(const CPModelProto& proto) {
+  CHECK(binder_ == nullptr) << "Template already loaded";
+  std::vector<IntExpr*> expressions;
+  if (!solver_->LoadModel(proto, &monitors_, &expressions)) {
+    return false;
+  }
+  for (const CPVariableGroup& group : proto.variable_groups()) {
+    if (group.type() != kParameterGroup) {
+      continue;
+    }
+    for (const CPArgumentProto& argument : group.arguments()) {
+      for (const int index : argument.integer_expression_array()) {
+        if (index < 0 || index >= expressions.size() ||
+            expressions[index] == nullptr || !expressions[index]->IsVar()) {
+          LOG(ERROR) << "Parameter " << index
+                     << " is not an integer variable";
+          return false;
+        }
+        parameters_.push_back(expressions[index]->Var());
+      }
+    }
+  }
+  bound_.assign(parameters_.size(), false);
+  values_.assign(parameters_.size(), 0);
+  binder_ = solver_->RevAlloc(new ParameterBinder(parameters_, &bound_,
+                                                   &values_));
+  return true;
+}
+
+DecisionBuilder* ModelTemplate::parameter_binder() const { return binder_; }
+
+int ModelTemplate::ParameterIndex(const std::string& name) const {
+  for (int i = 0; i < parameters_.size(); ++i) {
+    if (parameters_[i]->name() == name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void ModelTemplate::BindParameter(int index, int64 value) {
+  bound_[index] = true;
+  values_[index] = value;
+}
+
+void ModelTemplate::UnbindParameter(int index) { bound_[index] = false; }
+
+void ModelTemplate::UnbindAllParameters() {
+  bound_.assign(parameters_.size(), false);
+}
+
+bool ModelTemplate::Solve(DecisionBuilder* const db,
+                          const std::vector<SearchMonitor*>& monitors) {
+  CHECK(binder_ != nullptr) << "Template not loaded";
+  std::vector<SearchMonitor*> all_monitors = monitors;
+  all_monitors.insert(all_monitors.end(), monitors_.begin(), monitors_.end());
+  binder_->set_next(db);
+  const bool result = solver_->Solve(binder_, all_monitors);
+  binder_->set_next(nullptr);
+  return result;
+}
+}  // namespace operations_research
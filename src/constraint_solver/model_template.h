@@ -0,0 +1,121 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Reusable model templates for the constraint solver.
+//
+// Applications that solve the same model many times, with only a few
+// constants changing from one solve to the next, spend a large share of
+// their time rebuilding the model. A ModelTemplate loads a CPModelProto once
+// into its own Solver and keeps it alive across solves. The constants that
+// change are modeled as integer variables (the "parameters") whose domain
+// spans all the values they can take. Parameters are declared in the proto
+// itself, through a variable group of type ModelTemplate::kParameterGroup,
+// so that templates can be serialized and shared like any other model.
+//
+// Before each solve, parameters are bound to a value. Bound parameters are
+// fixed at the root of the search, without creating a choice point, and are
+// restored when the search ends; unbound parameters are left free.
+//
+// Usage:
+//   // Offline: build the model with parameters as variables and export it.
+//   IntVar* const capacity = solver.MakeIntVar(0, 1000, "capacity");
+//   ...
+//   CPModelProto proto;
+//   solver.ExportModel(&proto);
+//   ModelTemplate::DeclareParameter("capacity", &proto);
+//
+//   // Online: load once, solve many times.
+//   ModelTemplate model_template("my_model");
+//   CHECK(model_template.Load(proto));
+//   const int capacity_index = model_template.ParameterIndex("capacity");
+//   for (...) {
+//     model_template.BindParameter(capacity_index, new_capacity);
+//     model_template.Solve(db, monitors);
+//   }
+
+#ifndef OR_TOOLS_CONSTRAINT_SOLVER_MODEL_TEMPLATE_H_
+#define OR_TOOLS_CONSTRAINT_SOLVER_MODEL_TEMPLATE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/integral_types.h"
+#include "base/macros.h"
+#include "constraint_solver/constraint_solver.h"
+
+namespace operations_research {
+
+class CPModelProto;
+class ParameterBinder;
+
+class ModelTemplate {
+ public:
+  // Type of the variable groups listing the parameters of a model.
+  static const char kParameterGroup[];
+
+  // Marks the integer expression named 'name' in the proto as a
+  // parameter. Returns false if there is no such expression.
+  static bool DeclareParameter(const std::string& name,
+                               CPModelProto* const proto);
+
+  explicit ModelTemplate(const std::string& name);
+  ~ModelTemplate();
+
+  // Builds the model once. Returns false if the proto cannot be loaded,
+  // or if one of its parameters is not an integer variable. Must be called
+  // exactly once.
+  bool Load(const CPModelProto& proto);
+
+  // The solver owning the model.
+  Solver* solver() const { return solver_.get(); }
+
+  // The monitors (objective, search limit) described in the proto.
+  const std::vector<SearchMonitor*>& monitors() const { return monitors_; }
+
+  int num_parameters() const { return parameters_.size(); }
+  IntVar* parameter(int index) const { return parameters_[index]; }
+  // Returns the index of the parameter with the given name, or -1.
+  int ParameterIndex(const std::string& name) const;
+
+  // Binds a parameter for the next solves. Binding to a value outside the
+  // domain of the parameter makes those solves fail.
+  void BindParameter(int index, int64 value);
+  void UnbindParameter(int index);
+  void UnbindAllParameters();
+  bool IsBound(int index) const { return bound_[index]; }
+  int64 BoundValue(int index) const { return values_[index]; }
+
+  // Returns a decision builder that fixes all bound parameters to their
+  // value and then returns. It always reads the current bindings; compose
+  // it in front of the search decision builder when using NewSearch()
+  // directly.
+  DecisionBuilder* parameter_binder() const;
+
+  // Solves the model with the current bindings. The monitors from the
+  // proto are added to the given ones.
+  bool Solve(DecisionBuilder* const db,
+             const std::vector<SearchMonitor*>& monitors);
+
+ private:
+  std::unique_ptr<Solver> solver_;
+  std::vector<SearchMonitor*> monitors_;
+  std::vector<IntVar*> parameters_;
+  std::vector<bool> bound_;
+  std::vector<int64> values_;
+  ParameterBinder* binder_;
+
+  DISALLOW_COPY_AND_ASSIGN(ModelTemplate);
+};
+}  // namespace operations_research
+#endif  // OR_TOOLS_CONSTRAINT_SOLVER_MODEL_TEMPLATE_H_
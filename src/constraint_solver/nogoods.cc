@@ -12,17 +12,28 @@
 // limitations under the License.
 
 
+#include <algorithm>
+#include "base/hash.h"
 #include <string>
 #include <vector>
 
+#include "base/commandlineflags.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/macros.h"
+#include "base/map_util.h"
 #include "base/stringprintf.h"
 #include "base/stl_util.h"
 #include "constraint_solver/constraint_solver.h"
 #include "util/string_array.h"
 
+DEFINE_bool(cp_use_watched_nogoods, true,
+            "Use the watched-term nogood manager instead of the naive one.");
+DEFINE_int32(cp_max_nogoods, 10000,
+             "Number of nogoods above which the watched-term nogood manager "
+             "removes the least active half of them. The limit then grows "
+             "by 10%.");
+
 namespace operations_research {
 
 // ----- Base Class -----
@@ -184,11 +195,279 @@ class NaiveNoGoodManager : public NoGoodManager {
  private:
   std::vector<NoGood*> nogoods_;
 };
+
+// ----- WatchedNoGoodManager -----
+
+// Nogoods are handled like clauses in SAT solvers: a nogood can only deduce
+// something when all its terms but one are always true, so it is enough to
+// watch two terms which are not always true. A nogood is only looked at when
+// one of its watched terms becomes true, in which case the watch moves to
+// another term if possible; otherwise the other watched term is refuted (or
+// the solver fails). The watches do not need to be restored on backtrack.
+//
+// Watches are indexed by variable and value, and which watches to look at
+// is decided from the current domains (a watch on x == v triggers when x is
+// bound to v, a watch on x != v when v is removed from x). This makes the
+// check both robust to backtracking and independent of the length of the
+// nogoods.
+//
+// Nogoods get an activity which is bumped each time they refute a term or
+// fail, and decays over time. When there are too many nogoods, the least
+// active half is removed, except short nogoods (up to two terms) which, as
+// low LBD clauses, are the most valuable ones and are always kept.
+class WatchedNoGoodManager : public NoGoodManager {
+ public:
+  explicit WatchedNoGoodManager(Solver* const solver)
+      : NoGoodManager(solver),
+        max_nogoods_(FLAGS_cp_max_nogoods),
+        activity_increment_(1.0) {}
+  ~WatchedNoGoodManager() override { Clear(); }
+
+  void Clear() override {
+    for (const WatchedNoGood& watched : nogoods_) {
+      delete watched.nogood;
+    }
+    nogoods_.clear();
+    STLDeleteElements(&unit_nogoods_);
+    variables_.clear();
+    variable_index_.clear();
+  }
+
+  void Init() override {}
+
+  void AddNoGood(NoGood* const nogood) override {
+    if (nogood->size() == 0) {
+      delete nogood;
+      return;
+    }
+    if (nogood->size() == 1) {
+      unit_nogoods_.push_back(nogood);
+      return;
+    }
+    if (nogoods_.size() >= max_nogoods_) {
+      ReduceNoGoods();
+    }
+    WatchedNoGood watched;
+    watched.nogood = nogood;
+    watched.activity = activity_increment_;
+    // Watches the first two terms which are not always true, if any.
+    int num_watches = 0;
+    for (int i = 0; i < nogood->size() && num_watches < 2; ++i) {
+      if (nogood->term(i)->Evaluate() != NoGoodTerm::ALWAYS_TRUE) {
+        watched.watches[num_watches++] = i;
+      }
+    }
+    for (int i = 0; num_watches < 2; ++i) {
+      if (num_watches == 0 || watched.watches[0] != i) {
+        watched.watches[num_watches++] = i;
+      }
+    }
+    nogoods_.push_back(watched);
+    WatchTerm(nogoods_.size() - 1, 0);
+    WatchTerm(nogoods_.size() - 1, 1);
+  }
+
+  int NoGoodCount() const override {
+    return nogoods_.size() + unit_nogoods_.size();
+  }
+
+  void Apply() override {
+    Solver* const s = solver();
+    for (NoGood* const nogood : unit_nogoods_) {
+      nogood->Apply(s);
+    }
+    triggered_.clear();
+    for (VariableWatches& watches : variables_) {
+      IntVar* const var = watches.variable;
+      if (var->Bound()) {
+        std::vector<Watch>* const equal_watches =
+            FindOrNull(watches.equal, var->Value());
+        if (equal_watches != nullptr) {
+          CollectTriggered(var, var->Value(), true, equal_watches);
+        }
+      }
+      for (auto& value_watches : watches.not_equal) {
+        if (!var->Contains(value_watches.first)) {
+          CollectTriggered(var, value_watches.first, false,
+                           &value_watches.second);
+        }
+      }
+    }
+    for (const Watch& watch : triggered_) {
+      ProcessWatch(watch);
+    }
+  }
+
+  std::string DebugString() const override {
+    return StringPrintf("WatchedNoGoodManager(%d)", NoGoodCount());
+  }
+
+ private:
+  static const double kActivityDecay;
+
+  struct WatchedNoGood {
+    NoGood* nogood;
+    // Indices of the two watched terms in the nogood.
+    int watches[2];
+    double activity;
+  };
+
+  struct Watch {
+    Watch(int n, int s) : nogood_index(n), slot(s) {}
+    int nogood_index;
+    int slot;
+  };
+
+  struct VariableWatches {
+    IntVar* variable;
+    hash_map<int64, std::vector<Watch> > equal;
+    hash_map<int64, std::vector<Watch> > not_equal;
+  };
+
+  // All terms are IntegerVariableNoGoodTerm, as NoGood can only create
+  // those.
+  static const IntegerVariableNoGoodTerm* Term(const NoGood* const nogood,
+                                               int index) {
+    return static_cast<const IntegerVariableNoGoodTerm*>(nogood->term(index));
+  }
+
+  const IntegerVariableNoGoodTerm* WatchedTerm(const Watch& watch) const {
+    const WatchedNoGood& watched = nogoods_[watch.nogood_index];
+    return Term(watched.nogood, watched.watches[watch.slot]);
+  }
+
+  void WatchTerm(int nogood_index, int slot) {
+    const WatchedNoGood& watched = nogoods_[nogood_index];
+    const IntegerVariableNoGoodTerm* const term =
+        Term(watched.nogood, watched.watches[slot]);
+    IntVar* const var = term->integer_variable();
+    int index = -1;
+    if (!FindCopy(variable_index_, var, &index)) {
+      index = variables_.size();
+      variable_index_[var] = index;
+      variables_.push_back(VariableWatches());
+      variables_.back().variable = var;
+    }
+    VariableWatches* const watches = &variables_[index];
+    (term->assign() ? watches->equal : watches->not_equal)[term->value()]
+        .push_back(Watch(nogood_index, slot));
+  }
+
+  // Moves the watches of 'list' which are still on (var, value, assign) to
+  // triggered_, and drops the ones which have moved to another term.
+  void CollectTriggered(IntVar* const var, int64 value, bool assign,
+                        std::vector<Watch>* const list) {
+    int kept = 0;
+    for (const Watch& watch : *list) {
+      const IntegerVariableNoGoodTerm* const term = WatchedTerm(watch);
+      if (term->integer_variable() == var && term->value() == value &&
+          term->assign() == assign) {
+        (*list)[kept++] = watch;
+        triggered_.push_back(watch);
+      }
+    }
+    list->erase(list->begin() + kept, list->end());
+  }
+
+  void ProcessWatch(const Watch& watch) {
+    WatchedNoGood* const watched = &nogoods_[watch.nogood_index];
+    const NoGood* const nogood = watched->nogood;
+    const int watched_index = watched->watches[watch.slot];
+    const int other_index = watched->watches[1 - watch.slot];
+    // A previous refutation may have changed the state of the nogood.
+    if (nogood->term(watched_index)->Evaluate() != NoGoodTerm::ALWAYS_TRUE) {
+      return;
+    }
+    for (int i = 0; i < nogood->size(); ++i) {
+      if (i != watched_index && i != other_index &&
+          nogood->term(i)->Evaluate() != NoGoodTerm::ALWAYS_TRUE) {
+        // The old watch is dropped lazily by CollectTriggered().
+        watched->watches[watch.slot] = i;
+        WatchTerm(watch.nogood_index, watch.slot);
+        return;
+      }
+    }
+    NoGoodTerm* const other = nogood->term(other_index);
+    switch (other->Evaluate()) {
+      case NoGoodTerm::ALWAYS_FALSE: { break; }
+      case NoGoodTerm::ALWAYS_TRUE: {
+        VLOG(2) << "No Good " << nogood->DebugString() << " -> Fail";
+        BumpActivity(watched);
+        solver()->Fail();
+        break;
+      }
+      case NoGoodTerm::UNDECIDED: {
+        VLOG(2) << "No Good " << nogood->DebugString() << " -> Refute "
+                << other->DebugString();
+        BumpActivity(watched);
+        other->Refute();
+        break;
+      }
+    }
+  }
+
+  void BumpActivity(WatchedNoGood* const watched) {
+    watched->activity += activity_increment_;
+    activity_increment_ /= kActivityDecay;
+    if (activity_increment_ > 1e100) {
+      for (WatchedNoGood& nogood : nogoods_) {
+        nogood.activity *= 1e-100;
+      }
+      activity_increment_ *= 1e-100;
+    }
+  }
+
+  // Removes the least active half of the nogoods with more than two terms,
+  // and rebuilds the watch lists.
+  void ReduceNoGoods() {
+    std::vector<WatchedNoGood> candidates;
+    std::vector<WatchedNoGood> kept;
+    for (const WatchedNoGood& watched : nogoods_) {
+      (watched.nogood->size() <= 2 ? kept : candidates).push_back(watched);
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const WatchedNoGood& a, const WatchedNoGood& b) {
+                return a.activity > b.activity;
+              });
+    const int num_kept = candidates.size() / 2;
+    for (int i = 0; i < candidates.size(); ++i) {
+      if (i < num_kept) {
+        kept.push_back(candidates[i]);
+      } else {
+        delete candidates[i].nogood;
+      }
+    }
+    VLOG(1) << "Removed " << nogoods_.size() - kept.size() << " nogoods out of "
+            << nogoods_.size();
+    nogoods_.swap(kept);
+    variables_.clear();
+    variable_index_.clear();
+    for (int i = 0; i < nogoods_.size(); ++i) {
+      WatchTerm(i, 0);
+      WatchTerm(i, 1);
+    }
+    max_nogoods_ = std::max<int64>(max_nogoods_ + max_nogoods_ / 10,
+                                   nogoods_.size() + 1);
+  }
+
+  std::vector<WatchedNoGood> nogoods_;
+  std::vector<NoGood*> unit_nogoods_;
+  std::vector<VariableWatches> variables_;
+  hash_map<const IntVar*, int> variable_index_;
+  std::vector<Watch> triggered_;
+  int64 max_nogoods_;
+  double activity_increment_;
+};
+
+const double WatchedNoGoodManager::kActivityDecay = 0.999;
 }  // namespace
 
 // ----- API -----
 
 NoGoodManager* Solver::MakeNoGoodManager() {
+  if (FLAGS_cp_use_watched_nogoods) {
+    return RevAlloc(new WatchedNoGoodManager(this));
+  }
   return RevAlloc(new NaiveNoGoodManager(this));
 }
 
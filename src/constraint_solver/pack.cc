@@ -16,11 +16,13 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "base/commandlineflags.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/stringprintf.h"
@@ -28,6 +30,11 @@
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
 
+DEFINE_bool(cp_pack_bin_packing_lower_bound, false,
+            "Fail in sum-less-than-constant pack dimensions when the Martello "
+            "and Toth L2 lower bound on the number of bins exceeds the number "
+            "of bins.");
+
 namespace operations_research {
 
 // ---------- Dimension ----------
@@ -140,16 +147,35 @@ void Pack::Post() {
 }
 
 void Pack::ClearAll() {
-  for (int bin_index = 0; bin_index <= bins_; ++bin_index) {
+  for (const int bin_index : touched_bins_) {
     forced_[bin_index].clear();
     removed_[bin_index].clear();
   }
+  touched_bins_.clear();
+  forced_[bins_].clear();
+  removed_[bins_].clear();
   to_set_.clear();
   to_unset_.clear();
   in_process_ = false;
   stamp_ = solver()->fail_stamp();
 }
 
+void Pack::PushForced(int bin_index, int var_index) {
+  if (bin_index < bins_ && forced_[bin_index].empty() &&
+      removed_[bin_index].empty()) {
+    touched_bins_.push_back(bin_index);
+  }
+  forced_[bin_index].push_back(var_index);
+}
+
+void Pack::PushRemoved(int bin_index, int var_index) {
+  if (bin_index < bins_ && forced_[bin_index].empty() &&
+      removed_[bin_index].empty()) {
+    touched_bins_.push_back(bin_index);
+  }
+  removed_[bin_index].push_back(var_index);
+}
+
 void Pack::PropagateDelayed() {
   for (int i = 0; i < to_set_.size(); ++i) {
     vars_[to_set_[i].first]->SetValue(to_set_[i].second);
@@ -196,7 +222,7 @@ void Pack::InitialPropagate() {
     if (var->Bound()) {
       const int64 value = var->Min();
       if (value < bins_) {
-        forced_[value].push_back(var_index);
+        PushForced(value, var_index);
         data->PushAssigned(var_index);
       } else {
         data->PushUnassigned(var_index);
@@ -275,30 +301,31 @@ void Pack::Propagate() {
   const bool need_context = solver()->InstrumentsVariables();
   in_process_ = true;
   DCHECK_EQ(stamp_, solver()->fail_stamp());
-  for (int bin_index = 0; bin_index < bins_; ++bin_index) {
-    if (!removed_[bin_index].empty() || !forced_[bin_index].empty()) {
+  // Only visit the bins that changed, in increasing order, instead of
+  // scanning all of them.
+  std::sort(touched_bins_.begin(), touched_bins_.end());
+  for (const int bin_index : touched_bins_) {
+    if (need_context) {
+      solver()->GetPropagationMonitor()->PushContext(StringPrintf(
+          "Pack(bin %d, forced = [%s], removed = [%s])", bin_index,
+          strings::Join(forced_[bin_index], ", ").c_str(),
+          strings::Join(removed_[bin_index], ", ").c_str()));
+    }
+
+    for (int dim_index = 0; dim_index < dims_.size(); ++dim_index) {
       if (need_context) {
         solver()->GetPropagationMonitor()->PushContext(StringPrintf(
-            "Pack(bin %d, forced = [%s], removed = [%s])", bin_index,
-            strings::Join(forced_[bin_index], ", ").c_str(),
-            strings::Join(removed_[bin_index], ", ").c_str()));
-      }
-
-      for (int dim_index = 0; dim_index < dims_.size(); ++dim_index) {
-        if (need_context) {
-          solver()->GetPropagationMonitor()->PushContext(StringPrintf(
-              "ProgateDimension(%s)", dims_[dim_index]->DebugString().c_str()));
-        }
-        dims_[dim_index]
-            ->Propagate(bin_index, forced_[bin_index], removed_[bin_index]);
-        if (need_context) {
-          solver()->GetPropagationMonitor()->PopContext();
-        }
+            "ProgateDimension(%s)", dims_[dim_index]->DebugString().c_str()));
       }
+      dims_[dim_index]
+          ->Propagate(bin_index, forced_[bin_index], removed_[bin_index]);
       if (need_context) {
         solver()->GetPropagationMonitor()->PopContext();
       }
     }
+    if (need_context) {
+      solver()->GetPropagationMonitor()->PopContext();
+    }
   }
   if (!removed_[bins_].empty() || !forced_[bins_].empty()) {
     if (need_context) {
@@ -349,7 +376,7 @@ void Pack::OneDomain(int var_index) {
        ++value) {
     if (unprocessed_->IsSet(value, var_index)) {
       unprocessed_->SetToZero(s, value, var_index);
-      removed_[value].push_back(var_index);
+      PushRemoved(value, var_index);
     }
   }
   if (!bound) {
@@ -358,7 +385,7 @@ void Pack::OneDomain(int var_index) {
           value <= std::min(static_cast<int64>(bins_), vmax)) {
         DCHECK(unprocessed_->IsSet(value, var_index));
         unprocessed_->SetToZero(s, value, var_index);
-        removed_[value].push_back(var_index);
+        PushRemoved(value, var_index);
       }
     }
   }
@@ -366,12 +393,12 @@ void Pack::OneDomain(int var_index) {
        value <= std::min(oldmax, static_cast<int64>(bins_)); ++value) {
     if (unprocessed_->IsSet(value, var_index)) {
       unprocessed_->SetToZero(s, value, var_index);
-      removed_[value].push_back(var_index);
+      PushRemoved(value, var_index);
     }
   }
   if (bound) {
     unprocessed_->SetToZero(s, var->Min(), var_index);
-    forced_[var->Min()].push_back(var_index);
+    PushForced(var->Min(), var_index);
   }
   EnqueueDelayedDemon(demon_);
 }
@@ -553,6 +580,50 @@ void SortIndexByWeight(std::vector<int>* const indices,
   SortWeightVector(indices, &to_sort);
 }
 
+// Returns the L2 lower bound of Martello and Toth on the number of bins of
+// the given capacity needed to pack items of the given sizes. Sizes must be
+// sorted by decreasing value, and none can exceed the capacity.
+// For each K in [0, capacity / 2], items larger than capacity - K cannot
+// share their bin with items of size at least K, and items larger than
+// capacity / 2 cannot share their bin with each other. Items of size in
+// [K, capacity / 2] then fill the room left by items in
+// ]capacity / 2, capacity - K] before opening new bins.
+int64 BinPackingLowerBound(const std::vector<int64>& sizes, int64 capacity) {
+  const int size = sizes.size();
+  std::vector<int64> prefix_sums(size + 1, 0LL);
+  for (int i = 0; i < size; ++i) {
+    prefix_sums[i + 1] = prefix_sums[i] + sizes[i];
+  }
+  const std::greater<int64> decreasing;
+  // Number of items larger than 'value'.
+  auto count_larger = [&sizes, &decreasing](int64 value) {
+    return std::lower_bound(sizes.begin(), sizes.end(), value, decreasing) -
+           sizes.begin();
+  };
+  const int large = count_larger(capacity / 2);
+  int64 best = large;
+  for (int i = large; i < size; ++i) {
+    const int64 k = sizes[i];
+    if (k == 0) break;
+    if (i > large && k == sizes[i - 1]) continue;
+    const int very_large = count_larger(capacity - k);
+    const int medium = large - very_large;
+    const int64 medium_room =
+        medium * capacity - (prefix_sums[large] - prefix_sums[very_large]);
+    // Items of size at least k are the ones before the last occurrence of k.
+    const int small_end =
+        std::upper_bound(sizes.begin(), sizes.end(), k, decreasing) -
+        sizes.begin();
+    const int64 small_sum = prefix_sums[small_end] - prefix_sums[large];
+    int64 bound = large;
+    if (small_sum > medium_room) {
+      bound += (small_sum - medium_room + capacity - 1) / capacity;
+    }
+    best = std::max(best, bound);
+  }
+  return best;
+}
+
 class DimensionLessThanConstant : public Dimension {
  public:
   DimensionLessThanConstant(Solver* const s, Pack* const p,
@@ -565,11 +636,21 @@ class DimensionLessThanConstant : public Dimension {
         upper_bounds_(upper_bounds),
         first_unbound_backward_vector_(bins_count_, 0),
         sum_of_bound_variables_vector_(bins_count_, 0LL),
-        ranked_(vars_count_) {
+        ranked_(vars_count_),
+        use_lower_bound_(FLAGS_cp_pack_bin_packing_lower_bound &&
+                         bins_count_ > 0),
+        max_capacity_(0),
+        must_pack_(use_lower_bound_ ? vars_count_ : 0),
+        packed_(use_lower_bound_ ? vars_count_ : 0),
+        lower_bound_dirty_(false) {
     for (int i = 0; i < vars_count_; ++i) {
       ranked_[i] = i;
     }
     SortIndexByWeight(&ranked_, weights_);
+    if (use_lower_bound_) {
+      max_capacity_ =
+          *std::max_element(upper_bounds_.begin(), upper_bounds_.end());
+    }
   }
 
   ~DimensionLessThanConstant() override {}
@@ -606,9 +687,10 @@ class DimensionLessThanConstant : public Dimension {
     sum_of_bound_variables_vector_.SetValue(s, bin_index, sum);
     first_unbound_backward_vector_.SetValue(s, bin_index, ranked_.size() - 1);
     PushFromTop(bin_index);
+    MarkPacked(forced);
   }
 
-  void EndInitialPropagate() override {}
+  void EndInitialPropagate() override { CheckLowerBound(); }
 
   void Propagate(int bin_index, const std::vector<int>& forced,
                  const std::vector<int>& removed) override {
@@ -620,14 +702,19 @@ class DimensionLessThanConstant : public Dimension {
       }
       sum_of_bound_variables_vector_.SetValue(s, bin_index, sum);
       PushFromTop(bin_index);
+      MarkPacked(forced);
     }
   }
   void InitialPropagateUnassigned(const std::vector<int>& assigned,
-                                  const std::vector<int>& unassigned) override {}
+                                  const std::vector<int>& unassigned) override {
+    MarkMustPack(assigned);
+  }
   void PropagateUnassigned(const std::vector<int>& assigned,
-                           const std::vector<int>& unassigned) override {}
+                           const std::vector<int>& unassigned) override {
+    MarkMustPack(assigned);
+  }
 
-  void EndPropagate() override {}
+  void EndPropagate() override { CheckLowerBound(); }
 
   void Accept(ModelVisitor* const visitor) const override {
     visitor->BeginVisitExtension(ModelVisitor::kUsageLessConstantExtension);
@@ -643,9 +730,73 @@ class DimensionLessThanConstant : public Dimension {
   const std::vector<int64> weights_;
   const int bins_count_;
   const std::vector<int64> upper_bounds_;
+  // The bin packing lower bound only depends on the bin loads and on the
+  // items that must be packed, but are not yet. It is recomputed only when
+  // one of them changed since the last check.
+  void MarkPacked(const std::vector<int>& forced) {
+    if (use_lower_bound_) {
+      for (const int var_index : forced) {
+        packed_.SetToOne(solver(), var_index);
+      }
+      lower_bound_dirty_ = true;
+    }
+  }
+
+  void MarkMustPack(const std::vector<int>& assigned) {
+    if (use_lower_bound_ && !assigned.empty()) {
+      for (const int var_index : assigned) {
+        must_pack_.SetToOne(solver(), var_index);
+      }
+      lower_bound_dirty_ = true;
+    }
+  }
+
+  // Packs the current bin loads, seen as items, and the items that must
+  // be packed into bins of the largest capacity, and fails if this needs
+  // more bins than available.
+  void CheckLowerBound() {
+    if (!lower_bound_dirty_) {
+      return;
+    }
+    lower_bound_dirty_ = false;
+    sizes_.clear();
+    for (int i = ranked_.size() - 1; i >= 0; --i) {
+      const int var_index = ranked_[i];
+      if (must_pack_.IsSet(var_index) && !packed_.IsSet(var_index)) {
+        sizes_.push_back(weights_[var_index]);
+      }
+    }
+    const int num_items = sizes_.size();
+    if (num_items == 0) {
+      return;
+    }
+    if (sizes_[0] > max_capacity_) {
+      solver()->Fail();
+    }
+    for (int bin_index = 0; bin_index < bins_count_; ++bin_index) {
+      const int64 load = sum_of_bound_variables_vector_[bin_index];
+      if (load > 0) {
+        sizes_.push_back(load);
+      }
+    }
+    std::sort(sizes_.begin() + num_items, sizes_.end(),
+              std::greater<int64>());
+    std::inplace_merge(sizes_.begin(), sizes_.begin() + num_items,
+                       sizes_.end(), std::greater<int64>());
+    if (BinPackingLowerBound(sizes_, max_capacity_) > bins_count_) {
+      solver()->Fail();
+    }
+  }
+
   RevArray<int> first_unbound_backward_vector_;
   RevArray<int64> sum_of_bound_variables_vector_;
   std::vector<int> ranked_;
+  const bool use_lower_bound_;
+  int64 max_capacity_;
+  RevBitSet must_pack_;
+  RevBitSet packed_;
+  bool lower_bound_dirty_;
+  std::vector<int64> sizes_;
 };
 
 class DimensionSumCallbackLessThanConstant : public Dimension {
@@ -0,0 +1,408 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "constraint_solver/portfolio.h"
+
+#include <string>
+
+#include "base/callback.h"
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "base/random.h"
+#include "base/stringprintf.h"
+#include "base/threadpool.h"
+#include "constraint_solver/constraint_solver.h"
+
+namespace operations_research {
+namespace {
+// Objective monitor sharing its bound with the other workers of a portfolio.
+// The shared best value is polled at each decision and refutation, and the
+// objective bound is tightened as soon as a better value is published by
+// another worker.
+class SharedOptimizeVar : public OptimizeVar {
+ public:
+  SharedOptimizeVar(Solver* const solver, bool maximize, IntVar* const var,
+                    int64 step, SolverPortfolio* const portfolio)
+      : OptimizeVar(solver, maximize, var, step), portfolio_(portfolio) {}
+  ~SharedOptimizeVar() override {}
+
+  void BeginNextDecision(DecisionBuilder* const db) override {
+    if (PollSharedBest()) {
+      ApplyBound();
+    }
+    OptimizeVar::BeginNextDecision(db);
+  }
+
+  void RefuteDecision(Decision* const d) override {
+    PollSharedBest();
+    OptimizeVar::RefuteDecision(d);
+  }
+
+  bool AtSolution() override {
+    if (!OptimizeVar::AtSolution()) {
+      return false;
+    }
+    portfolio_->UpdateBestObjective(best_);
+    return true;
+  }
+
+  std::string DebugString() const override {
+    return StringPrintf("SharedOptimizeVar(%s)",
+                        OptimizeVar::DebugString().c_str());
+  }
+
+ private:
+  // Returns true if the best value has been improved by another worker.
+  bool PollSharedBest() {
+    const int64 shared_best = portfolio_->best_objective();
+    if (maximize_ ? shared_best > best_ : shared_best < best_) {
+      best_ = shared_best;
+      found_initial_solution_ = true;
+      return true;
+    }
+    return false;
+  }
+
+  SolverPortfolio* const portfolio_;
+};
+
+// Limit crossed when the portfolio search must stop.
+class PortfolioLimit : public SearchLimit {
+ public:
+  PortfolioLimit(Solver* const solver, SolverPortfolio* const portfolio)
+      : SearchLimit(solver), portfolio_(portfolio) {}
+  ~PortfolioLimit() override {}
+
+  bool Check() override { return portfolio_->ShouldFinish(); }
+  void Init() override {}
+  void Copy(const SearchLimit* const limit) override {}
+  SearchLimit* MakeClone() const override {
+    return solver()->RevAlloc(new PortfolioLimit(solver(), portfolio_));
+  }
+  std::string DebugString() const override { return "PortfolioLimit"; }
+
+ private:
+  SolverPortfolio* const portfolio_;
+};
+
+// Monitor implementing work stealing. It replays the path of the subtree
+// assigned to its worker, using a branch selector which keeps only the
+// branches of the path, then keeps track of the branches of the current
+// search path: when some worker needs work, the shallowest open right branch
+// is given away, and will be failed when this worker backtracks to it.
+class WorkStealingMonitor : public SearchMonitor {
+ public:
+  WorkStealingMonitor(Solver* const solver, SolverPortfolio* const portfolio)
+      : SearchMonitor(solver),
+        portfolio_(portfolio),
+        num_replayed_(0),
+        replaying_(false) {}
+  ~WorkStealingMonitor() override {}
+
+  // Sets the path to replay from the root in the next search.
+  void set_prefix(const std::vector<bool>& prefix) { prefix_ = prefix; }
+
+  // Branch selector replaying the prefix.
+  Solver::DecisionModification SelectBranch() {
+    if (num_replayed_ < prefix_.size()) {
+      replaying_ = true;
+      return prefix_[num_replayed_++] ? Solver::KEEP_RIGHT : Solver::KEEP_LEFT;
+    }
+    return Solver::NO_CHANGE;
+  }
+
+  void EnterSearch() override {
+    num_replayed_ = 0;
+    replaying_ = false;
+    path_.clear();
+  }
+
+  void BeginNextDecision(DecisionBuilder* const db) override {
+    if (num_replayed_ == prefix_.size() && portfolio_->NeedsWork()) {
+      GiveAwayBranch();
+    }
+  }
+
+  void ApplyDecision(Decision* const d) override {
+    if (replaying_) {
+      replaying_ = false;
+      return;
+    }
+    path_.resize(solver()->SearchDepth());
+    path_.push_back(Branch());
+  }
+
+  void RefuteDecision(Decision* const d) override {
+    if (replaying_) {
+      replaying_ = false;
+      return;
+    }
+    const int depth = solver()->SearchDepth();
+    path_.resize(depth + 1);
+    Branch* const branch = &path_[depth];
+    branch->right = true;
+    if (branch->given_away) {
+      solver()->Fail();
+    }
+  }
+
+  std::string DebugString() const override { return "WorkStealingMonitor"; }
+
+ private:
+  struct Branch {
+    Branch() : right(false), given_away(false) {}
+    bool right;
+    bool given_away;
+  };
+
+  void GiveAwayBranch() {
+    for (int i = 0; i < path_.size(); ++i) {
+      Branch* const branch = &path_[i];
+      if (!branch->right && !branch->given_away) {
+        branch->given_away = true;
+        std::vector<bool> path = prefix_;
+        for (int j = 0; j < i; ++j) {
+          path.push_back(path_[j].right);
+        }
+        path.push_back(true);
+        portfolio_->AddWork(path);
+        return;
+      }
+    }
+  }
+
+  SolverPortfolio* const portfolio_;
+  std::vector<bool> prefix_;
+  int num_replayed_;
+  bool replaying_;
+  std::vector<Branch> path_;
+};
+}  // namespace
+
+struct SolverPortfolio::Worker {
+  Worker() : collector(nullptr), solution(nullptr), has_solution(false) {}
+
+  // Keeps the last solution found by the collector if it is better than the
+  // current solution of the worker.
+  void StoreSolution(bool optimize, bool maximize) {
+    if (collector->solution_count() == 0) return;
+    const Assignment* const candidate = collector->solution(0);
+    if (has_solution && optimize) {
+      const int64 value = candidate->ObjectiveValue();
+      const int64 best_value = solution->ObjectiveValue();
+      if (maximize ? value <= best_value : value >= best_value) return;
+    }
+    solution->Copy(candidate);
+    has_solution = true;
+  }
+
+  std::unique_ptr<Solver> solver;
+  WorkerModel model;
+  std::vector<SearchMonitor*> search_monitors;
+  SolutionCollector* collector;
+  Assignment* solution;
+  bool has_solution;
+};
+
+SolverPortfolio::SolverPortfolio(ModelBuilder model_builder)
+    : model_builder_(std::move(model_builder)),
+      optimize_(false),
+      maximize_(false),
+      best_objective_(kint64max),
+      should_finish_(false),
+      best_worker_(-1),
+      num_idle_(0),
+      num_queued_(0) {}
+
+SolverPortfolio::~SolverPortfolio() {}
+
+bool SolverPortfolio::Solve(int num_workers, int num_threads) {
+  CHECK_LT(0, num_threads);
+  BuildWorkers(num_workers, /*reseed=*/true);
+  {
+    ThreadPool pool("SolverPortfolio", num_threads);
+    for (int w = 0; w < num_workers; ++w) {
+      pool.Add(NewCallback(this, &SolverPortfolio::SolveWorker, w));
+    }
+    pool.StartWorkers();
+  }
+  SelectBestWorker();
+  return best_worker_ != -1;
+}
+
+bool SolverPortfolio::SolveWithWorkStealing(int num_workers) {
+  BuildWorkers(num_workers, /*reseed=*/false);
+  work_queue_.clear();
+  // The first worker to ask for work gets the whole search tree.
+  work_queue_.push_back(std::vector<bool>());
+  num_queued_.store(1);
+  num_idle_.store(0);
+  {
+    ThreadPool pool("SolverPortfolioStealing", num_workers);
+    for (int w = 0; w < num_workers; ++w) {
+      pool.Add(NewCallback(this, &SolverPortfolio::StealingWorker, w));
+    }
+    pool.StartWorkers();
+  }
+  SelectBestWorker();
+  return best_worker_ != -1;
+}
+
+void SolverPortfolio::BuildWorkers(int num_workers, bool reseed) {
+  CHECK_LT(0, num_workers);
+  workers_.clear();
+  should_finish_.store(false);
+  best_worker_ = -1;
+  // Models are built sequentially; model builders need not be thread-safe.
+  for (int w = 0; w < num_workers; ++w) {
+    workers_.emplace_back(new Worker);
+    Worker* const worker = workers_.back().get();
+    worker->solver.reset(new Solver(StringPrintf("PortfolioWorker%d", w)));
+    Solver* const solver = worker->solver.get();
+    solver->ReSeed(ACMRandom::DeterministicSeed() + (reseed ? w : 0));
+    WorkerModel* const model = &worker->model;
+    model_builder_(solver, w, model);
+    CHECK(model->decision_builder != nullptr);
+    const bool optimize = model->objective != nullptr;
+    if (w == 0) {
+      optimize_ = optimize;
+      maximize_ = model->maximize;
+    } else {
+      CHECK_EQ(optimize_, optimize);
+      CHECK(!optimize_ || maximize_ == model->maximize);
+    }
+    Assignment* const prototype = solver->MakeAssignment();
+    prototype->Add(model->solution_vars);
+    if (optimize) {
+      prototype->AddObjective(model->objective);
+    }
+    worker->collector = solver->MakeLastSolutionCollector(prototype);
+    worker->solution = solver->MakeAssignment(prototype);
+    worker->search_monitors = model->monitors;
+    worker->search_monitors.push_back(worker->collector);
+    worker->search_monitors.push_back(
+        solver->RevAlloc(new PortfolioLimit(solver, this)));
+    if (optimize) {
+      worker->search_monitors.push_back(solver->RevAlloc(new SharedOptimizeVar(
+          solver, model->maximize, model->objective, model->step, this)));
+    }
+  }
+  best_objective_.store(maximize_ ? kint64min : kint64max);
+}
+
+void SolverPortfolio::SelectBestWorker() {
+  best_worker_ = -1;
+  for (int w = 0; w < workers_.size(); ++w) {
+    const Worker* const worker = workers_[w].get();
+    if (!worker->has_solution) continue;
+    if (best_worker_ == -1) {
+      best_worker_ = w;
+      if (!optimize_) break;
+    } else {
+      const int64 value = worker->solution->ObjectiveValue();
+      const int64 best_value =
+          workers_[best_worker_]->solution->ObjectiveValue();
+      if (maximize_ ? value > best_value : value < best_value) {
+        best_worker_ = w;
+      }
+    }
+  }
+}
+
+const Assignment* SolverPortfolio::best_solution() const {
+  return best_worker_ == -1 ? nullptr : workers_[best_worker_]->solution;
+}
+
+Solver* SolverPortfolio::solver(int worker) const {
+  return workers_[worker]->solver.get();
+}
+
+bool SolverPortfolio::UpdateBestObjective(int64 value) {
+  int64 current = best_objective_.load();
+  while (maximize_ ? value > current : value < current) {
+    if (best_objective_.compare_exchange_weak(current, value)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void SolverPortfolio::Finish() {
+  {
+    std::lock_guard<std::mutex> lock(work_mutex_);
+    should_finish_.store(true);
+  }
+  work_condition_.notify_all();
+}
+
+void SolverPortfolio::AddWork(const std::vector<bool>& path) {
+  {
+    std::lock_guard<std::mutex> lock(work_mutex_);
+    work_queue_.push_back(path);
+    ++num_queued_;
+  }
+  work_condition_.notify_one();
+}
+
+bool SolverPortfolio::GetWork(std::vector<bool>* path) {
+  std::unique_lock<std::mutex> lock(work_mutex_);
+  ++num_idle_;
+  const int num_workers = workers_.size();
+  work_condition_.wait(lock, [this, num_workers]() {
+    return !work_queue_.empty() || ShouldFinish() ||
+           num_idle_.load() == num_workers;
+  });
+  if (ShouldFinish() || work_queue_.empty()) {
+    // All workers are idle and there is no work left: the search is over.
+    work_condition_.notify_all();
+    return false;
+  }
+  path->swap(work_queue_.front());
+  work_queue_.pop_front();
+  --num_queued_;
+  --num_idle_;
+  return true;
+}
+
+void SolverPortfolio::SolveWorker(int worker) {
+  Worker* const w = workers_[worker].get();
+  w->solver->Solve(w->model.decision_builder, w->search_monitors);
+  w->StoreSolution(optimize_, maximize_);
+  // The first worker to end its search (it proved optimality given the shared
+  // bound, found a solution to a satisfaction problem, or hit one of its own
+  // limits) stops the other workers.
+  Finish();
+}
+
+void SolverPortfolio::StealingWorker(int worker) {
+  Worker* const w = workers_[worker].get();
+  Solver* const solver = w->solver.get();
+  WorkStealingMonitor* const stealing =
+      solver->RevAlloc(new WorkStealingMonitor(solver, this));
+  DecisionBuilder* const db = solver->Compose(
+      solver->MakeApplyBranchSelector(
+          [stealing]() { return stealing->SelectBranch(); }),
+      w->model.decision_builder);
+  std::vector<SearchMonitor*> monitors = w->search_monitors;
+  monitors.push_back(stealing);
+  std::vector<bool> path;
+  while (GetWork(&path)) {
+    stealing->set_prefix(path);
+    const bool found = solver->Solve(db, monitors);
+    w->StoreSolution(optimize_, maximize_);
+    if (found && !optimize_) {
+      Finish();
+    }
+  }
+}
+}  // namespace operations_research
@@ -0,0 +1,170 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Parallel portfolio search for the constraint solver.
+//
+// A portfolio runs several independent searches ("workers") on the same
+// problem in parallel. Models cannot be shared across solvers, so each worker
+// owns its own Solver in which the model is built by a user-provided builder;
+// an existing model can be cloned with Solver::ExportModel() and
+// Solver::LoadModel(). Workers typically differ by their decision builder and
+// random seed (each worker solver is reseeded before its model is built).
+//
+// In optimization mode, workers share the best objective value found so far:
+// every worker tightens its own objective bound each time another worker
+// finds a better solution. The search stops as soon as one worker finishes
+// its search or, for satisfaction problems, as soon as one worker finds a
+// solution.
+//
+// Usage:
+//   SolverPortfolio portfolio(
+//       [](Solver* solver, int worker, SolverPortfolio::WorkerModel* model) {
+//         std::vector<IntVar*> vars;
+//         IntVar* const cost = BuildMyModel(solver, &vars);
+//         model->decision_builder = solver->MakePhase(
+//             vars, worker % 2 == 0 ? Solver::CHOOSE_FIRST_UNBOUND
+//                                   : Solver::CHOOSE_RANDOM,
+//             Solver::ASSIGN_MIN_VALUE);
+//         model->objective = cost;
+//         model->solution_vars = vars;
+//       });
+//   if (portfolio.Solve(/*num_workers=*/4, /*num_threads=*/4)) {
+//     const Assignment* const solution = portfolio.best_solution();
+//     ...
+//   }
+//
+// The portfolio can also split the search space among workers with
+// SolveWithWorkStealing(). All workers then run the same model and decision
+// builder; when a worker is idle, a busy worker gives away the shallowest open
+// right branch of its search tree, serialized as the sequence of branches
+// leading to it from the root. The idle worker replays this path from the root
+// of its own solver and explores the subtree below it. Combined with the
+// shared objective bound, this parallelizes complete searches (optimality
+// proofs). Decision builders must take the same decisions for the same search
+// state: randomized decision builders and branch selectors cannot be used in
+// this mode, and restarts are not supported.
+
+#ifndef OR_TOOLS_CONSTRAINT_SOLVER_PORTFOLIO_H_
+#define OR_TOOLS_CONSTRAINT_SOLVER_PORTFOLIO_H_
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "base/integral_types.h"
+#include "base/macros.h"
+#include "constraint_solver/constraint_solver.h"
+
+namespace operations_research {
+
+class SolverPortfolio {
+ public:
+  // Search setup of a worker, filled by the model builder. All objects must
+  // belong to the solver passed to the builder.
+  struct WorkerModel {
+    WorkerModel()
+        : decision_builder(nullptr),
+          objective(nullptr),
+          maximize(false),
+          step(1) {}
+    // Decision builder used by the worker; must not be null.
+    DecisionBuilder* decision_builder;
+    // Variable to optimize; null for satisfaction problems. The direction of
+    // the optimization must be the same for all workers.
+    IntVar* objective;
+    bool maximize;
+    int64 step;
+    // Additional search monitors (limits, restarts, logs...).
+    std::vector<SearchMonitor*> monitors;
+    // Variables stored in the solutions of the worker.
+    std::vector<IntVar*> solution_vars;
+  };
+  // Builds the model of worker 'worker' in 'solver'. Called sequentially, once
+  // per worker, from the thread calling Solve().
+  typedef std::function<void(Solver*, int, WorkerModel*)> ModelBuilder;
+
+  explicit SolverPortfolio(ModelBuilder model_builder);
+  ~SolverPortfolio();
+
+  // Builds the models of 'num_workers' workers and solves them in parallel
+  // using 'num_threads' threads. Returns true if a solution was found.
+  bool Solve(int num_workers, int num_threads);
+
+  // Builds the models of 'num_workers' workers and splits the search tree
+  // among them by work stealing, using one thread per worker. All workers
+  // must build the same model and decision builder. Search limits passed as
+  // monitors apply to each subtree explored by a worker; when crossed, the
+  // rest of the subtree is dropped and the search is no longer complete.
+  // Returns true if a solution was found.
+  bool SolveWithWorkStealing(int num_workers);
+
+  // Returns the index of the worker which found the best solution, -1 if no
+  // solution was found.
+  int best_worker() const { return best_worker_; }
+  // Returns the best solution found, nullptr if no solution was found. The
+  // solution belongs to the solver of the best worker.
+  const Assignment* best_solution() const;
+  // Returns the solver of a worker; valid until the next call to Solve().
+  Solver* solver(int worker) const;
+  // Returns the best objective value found; only meaningful in optimization
+  // mode when a solution was found.
+  int64 best_objective() const { return best_objective_.load(); }
+
+  // Methods called by workers during search; thread-safe.
+  // Publishes 'value' as the new shared best objective if it improves the
+  // current one; returns true if it did.
+  bool UpdateBestObjective(int64 value);
+  // Returns true if the portfolio search must stop.
+  bool ShouldFinish() const { return should_finish_.load(); }
+  void Finish();
+  // Returns true if some worker is waiting for a subtree to explore.
+  bool NeedsWork() const { return num_idle_.load() > num_queued_.load(); }
+  // Hands out the subtree reached by following 'path' from the root ('true'
+  // for a right branch, 'false' for a left branch).
+  void AddWork(const std::vector<bool>& path);
+
+ private:
+  struct Worker;
+
+  void BuildWorkers(int num_workers, bool reseed);
+  void SelectBestWorker();
+  void SolveWorker(int worker);
+  void StealingWorker(int worker);
+  // Waits for a subtree to explore and returns true, or returns false when
+  // the search is over.
+  bool GetWork(std::vector<bool>* path);
+
+  ModelBuilder model_builder_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  bool optimize_;
+  bool maximize_;
+  std::atomic<int64> best_objective_;
+  std::atomic<bool> should_finish_;
+  int best_worker_;
+  // Work stealing state.
+  std::mutex work_mutex_;
+  std::condition_variable work_condition_;
+  std::deque<std::vector<bool>> work_queue_;
+  std::atomic<int> num_idle_;
+  std::atomic<int> num_queued_;
+
+  DISALLOW_COPY_AND_ASSIGN(SolverPortfolio);
+};
+
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_CONSTRAINT_SOLVER_PORTFOLIO_H_
@@ -23,6 +23,7 @@
 
 #include <algorithm>
 #include "base/hash.h"
+#include <map>
 #include <string>
 #include <utility>
 #include <vector>
@@ -57,6 +58,12 @@ DEFINE_bool(cp_use_all_possible_disjunctions, true,
             "Post temporal disjunctions for all pairs of tasks sharing a "
             "cumulative resource and that cannot overlap because the sum of "
             "their demand exceeds the capacity.");
+DEFINE_bool(cp_use_cumulative_tt_edge_finder, false,
+            "Use a O(n^2 log n) time-table edge finding algorithm for "
+            "cumulative constraints, as described in 'Explaining Time-Table-"
+            "Edge-Finding Propagation for the Cumulative Resource Constraint' "
+            "by Andreas Schutt, Thibaut Feydy and Peter J. Stuckey, CPAIOR "
+            "2013.");
 DEFINE_int32(cp_max_edge_finder_size, 50,
              "Do not post the edge finder in the cumulative constraints if "
              "it contains more than this number of tasks");
@@ -92,6 +99,32 @@ bool IntervalStartMinLessThan(IntervalVar* i1, IntervalVar* i2) {
   return i1->StartMin() < i2->StartMin();
 }
 
+// Sorts the vector, which is expected to be almost sorted. Propagators keep
+// their tasks sorted from one call to the next, and only a few bounds change
+// in between, so an insertion sort, which runs in O(n + number of
+// inversions), is much cheaper than a full sort. Falls back to std::sort if
+// the vector turns out to be far from sorted, e.g. after a backtrack.
+template <class T, class Compare>
+void IncrementalSort(std::vector<T>* const elements, Compare less) {
+  const int size = elements->size();
+  const int64 max_moves = 4LL * size + 16;
+  int64 moves = 0;
+  for (int i = 1; i < size; ++i) {
+    T element = (*elements)[i];
+    int j = i;
+    while (j > 0 && less(element, (*elements)[j - 1])) {
+      (*elements)[j] = (*elements)[j - 1];
+      --j;
+    }
+    (*elements)[j] = element;
+    moves += i - j;
+    if (moves > max_moves) {
+      std::sort(elements->begin(), elements->end(), less);
+      return;
+    }
+  }
+}
+
 // ----- Wrappers around intervals -----
 
 // A DisjunctiveTask is a non-preemptive task sharing a disjunctive resource.
@@ -480,13 +513,10 @@ NotLast::NotLast(Solver* const solver, const std::vector<IntervalVar*>& interval
 
 bool NotLast::Propagate() {
   // ---- Init ----
-  std::sort(by_start_max_.begin(), by_start_max_.end(),
-            StartMaxLessThan<DisjunctiveTask>);
-  std::sort(by_end_max_.begin(), by_end_max_.end(),
-            EndMaxLessThan<DisjunctiveTask>);
+  IncrementalSort(&by_start_max_, StartMaxLessThan<DisjunctiveTask>);
+  IncrementalSort(&by_end_max_, EndMaxLessThan<DisjunctiveTask>);
   // Update start min positions
-  std::sort(by_start_min_.begin(), by_start_min_.end(),
-            StartMinLessThan<DisjunctiveTask>);
+  IncrementalSort(&by_start_min_, StartMinLessThan<DisjunctiveTask>);
   for (int i = 0; i < by_start_min_.size(); ++i) {
     by_start_min_[i]->index = i;
   }
@@ -600,8 +630,7 @@ EdgeFinderAndDetectablePrecedences::EdgeFinderAndDetectablePrecedences(
 }
 
 void EdgeFinderAndDetectablePrecedences::UpdateEst() {
-  std::sort(by_start_min_.begin(), by_start_min_.end(),
-            StartMinLessThan<DisjunctiveTask>);
+  IncrementalSort(&by_start_min_, StartMinLessThan<DisjunctiveTask>);
   for (int i = 0; i < size(); ++i) {
     by_start_min_[i]->index = i;
   }
@@ -610,8 +639,7 @@ void EdgeFinderAndDetectablePrecedences::UpdateEst() {
 void EdgeFinderAndDetectablePrecedences::OverloadChecking() {
   // Initialization.
   UpdateEst();
-  std::sort(by_end_max_.begin(), by_end_max_.end(),
-            EndMaxLessThan<DisjunctiveTask>);
+  IncrementalSort(&by_end_max_, EndMaxLessThan<DisjunctiveTask>);
   theta_tree_.Clear();
 
   for (DisjunctiveTask* const task : by_end_max_) {
@@ -628,10 +656,8 @@ bool EdgeFinderAndDetectablePrecedences::DetectablePrecedences() {
   new_est_.assign(size(), kint64min);
 
   // Propagate in one direction
-  std::sort(by_end_min_.begin(), by_end_min_.end(),
-            EndMinLessThan<DisjunctiveTask>);
-  std::sort(by_start_max_.begin(), by_start_max_.end(),
-            StartMaxLessThan<DisjunctiveTask>);
+  IncrementalSort(&by_end_min_, EndMinLessThan<DisjunctiveTask>);
+  IncrementalSort(&by_start_max_, StartMaxLessThan<DisjunctiveTask>);
   theta_tree_.Clear();
   int j = 0;
   for (DisjunctiveTask* const task_i : by_end_min_) {
@@ -680,8 +706,7 @@ bool EdgeFinderAndDetectablePrecedences::EdgeFinder() {
   }
 
   // Push in one direction.
-  std::sort(by_end_max_.begin(), by_end_max_.end(),
-            EndMaxLessThan<DisjunctiveTask>);
+  IncrementalSort(&by_end_max_, EndMaxLessThan<DisjunctiveTask>);
   lt_tree_.Clear();
   for (int i = 0; i < size(); ++i) {
     lt_tree_.Insert(*by_start_min_[i]);
@@ -1441,15 +1466,14 @@ class EdgeFinder : public Constraint {
     // Clear the update stack
     start_min_update_.clear();
     // sort y start min.
-    std::sort(by_start_min_.begin(), by_start_min_.end(),
-              StartMinLessThan<Task>);
+    IncrementalSort(&by_start_min_, StartMinLessThan<Task>);
     for (int i = 0; i < by_start_min_.size(); ++i) {
       by_start_min_[i]->index = i;
     }
     // Sort by end max.
-    std::sort(by_end_max_.begin(), by_end_max_.end(), EndMaxLessThan<Task>);
+    IncrementalSort(&by_end_max_, EndMaxLessThan<Task>);
     // Sort by end min.
-    std::sort(by_end_min_.begin(), by_end_min_.end(), EndMinLessThan<Task>);
+    IncrementalSort(&by_end_min_, EndMinLessThan<Task>);
     // Initialize the tree with the new capacity.
     lt_tree_.Init(capacity_->Max());
     // Clear updates
@@ -1656,48 +1680,189 @@ bool TimeLessThan(const ProfileDelta& delta1, const ProfileDelta& delta2) {
   return delta1.time < delta2.time;
 }
 
+// Incrementally maintained usage profile of the compulsory parts of a set of
+// cumulative tasks. The compulsory part of a task that must be performed is
+// [start max, end min) if non empty, with a usage of its min demand.
+//
+// The profile keeps the last compulsory part it has seen for each task,
+// and the profile events in a tree. Tasks whose bounds changed are reported
+// with TaskChanged(), and only those tasks are updated by the next call to
+// Synchronize(). The profile is not reversible: after a backtrack, which is
+// detected with the fail stamp of the solver, all tasks are compared with
+// their last known compulsory part. This costs O(n) but no sort.
+class CompulsoryPartProfile {
+ public:
+  explicit CompulsoryPartProfile(int num_tasks)
+      : parts_(num_tasks), modified_(num_tasks), stamp_(0) {}
+
+  // Records that the bounds or demand of task 'index' have changed. Returns
+  // true if the task was not already recorded.
+  bool TaskChanged(Solver* const solver, int index) {
+    return modified_.Add(solver, index);
+  }
+
+  // Forces a full comparison at the next synchronization.
+  void Invalidate() { stamp_ = 0; }
+
+  // Brings the profile up to date with the given tasks, which must always
+  // be passed in the same order, and fills 'profile' with one delta per
+  // unique time, sorted by time, surrounded by two sentinels. Returns the
+  // maximum usage of the profile.
+  template <class Task>
+  int64 Synchronize(Solver* const solver, const std::vector<Task*>& tasks,
+                    std::vector<ProfileDelta>* const profile) {
+    DCHECK_EQ(tasks.size(), parts_.size());
+    if (stamp_ != solver->fail_stamp()) {
+      for (int i = 0; i < tasks.size(); ++i) {
+        UpdateTask(i, tasks[i]);
+      }
+      stamp_ = solver->fail_stamp();
+    } else {
+      for (const int index : modified_.modified(solver)) {
+        UpdateTask(index, tasks[index]);
+      }
+    }
+    modified_.Clear();
+    profile->clear();
+    profile->emplace_back(kint64min, 0);
+    int64 usage = 0;
+    int64 max_usage = 0;
+    for (const std::pair<int64, Event>& event : events_) {
+      profile->emplace_back(event.first, event.second.delta);
+      usage += event.second.delta;
+      max_usage = std::max(max_usage, usage);
+    }
+    DCHECK_EQ(0, usage);
+    profile->emplace_back(kint64max, 0);
+    return max_usage;
+  }
+
+ private:
+  struct Part {
+    Part() : start(0), end(0), demand(0) {}
+    int64 start;
+    int64 end;
+    int64 demand;
+  };
+
+  // Events with a null delta are kept as long as a compulsory part starts
+  // or ends at their time, CumulativeTimeTable::PushTask() relies on it.
+  struct Event {
+    Event() : delta(0), count(0) {}
+    int64 delta;
+    int count;
+  };
+
+  template <class Task>
+  void UpdateTask(int index, const Task* const task) {
+    const IntervalVar* const interval = task->interval;
+    Part part;
+    if (interval->MustBePerformed() &&
+        interval->StartMax() < interval->EndMin()) {
+      const int64 demand_min = task->DemandMin();
+      if (demand_min > 0) {
+        part.start = interval->StartMax();
+        part.end = interval->EndMin();
+        part.demand = demand_min;
+      }
+    }
+    Part* const old_part = &parts_[index];
+    if (old_part->demand == part.demand && old_part->start == part.start &&
+        old_part->end == part.end) {
+      return;
+    }
+    if (old_part->demand > 0) {
+      RemoveEvent(old_part->start, old_part->demand);
+      RemoveEvent(old_part->end, -old_part->demand);
+    }
+    if (part.demand > 0) {
+      AddEvent(part.start, part.demand);
+      AddEvent(part.end, -part.demand);
+    }
+    *old_part = part;
+  }
+
+  void AddEvent(int64 time, int64 delta) {
+    Event* const event = &events_[time];
+    event->delta += delta;
+    event->count++;
+  }
+
+  void RemoveEvent(int64 time, int64 delta) {
+    std::map<int64, Event>::iterator it = events_.find(time);
+    DCHECK(it != events_.end());
+    it->second.delta -= delta;
+    if (--it->second.count == 0) {
+      DCHECK_EQ(0, it->second.delta);
+      events_.erase(it);
+    }
+  }
+
+  std::vector<Part> parts_;
+  std::map<int64, Event> events_;
+  ModifiedVarBatch modified_;
+  uint64 stamp_;
+};
+
 // Cumulative time-table.
 //
-// This class implements a propagator for the CumulativeConstraint which is not
-// incremental, and where a call to InitialPropagate() takes time which is
-// O(n^2) and Omega(n log n) with n the number of cumulative tasks.
+// This class implements a propagator for the CumulativeConstraint where a
+// call to InitialPropagate() takes time which is O(n^2) and Omega(n log n)
+// with n the number of cumulative tasks.
 //
 // Despite the high complexity, this propagator is needed, because of those
 // implemented, it is the only one that satisfy that if all instantiated, no
 // contradiction will be detected if and only if the constraint is satisfied.
 //
-// The implementation is quite naive, and could certainly be improved, for
-// example by maintaining the profile incrementally.
+// The profile of compulsory parts is maintained incrementally: only the
+// tasks modified since the last propagation are updated in the profile, as
+// long as there has been no backtrack.
 template <class Task>
 class CumulativeTimeTable : public Constraint {
  public:
   CumulativeTimeTable(Solver* const solver, const std::vector<Task*>& tasks,
                       IntVar* const capacity)
-      : Constraint(solver), by_start_min_(tasks), capacity_(capacity) {
+      : Constraint(solver),
+        tasks_(tasks),
+        by_start_min_(tasks),
+        capacity_(capacity),
+        profile_(tasks.size()),
+        propagate_demon_(nullptr) {
     // There may be up to 2 delta's per interval (one on each side),
     // plus two sentinels
     const int profile_max_size = 2 * by_start_min_.size() + 2;
-    profile_non_unique_time_.reserve(profile_max_size);
     profile_unique_time_.reserve(profile_max_size);
   }
 
   ~CumulativeTimeTable() override { STLDeleteElements(&by_start_min_); }
 
   void InitialPropagate() override {
-    BuildProfile();
-    PushTasks();
-    // TODO(user): When a task has a fixed part, we could propagate
-    // max_demand from its current location.
+    profile_.Invalidate();
+    Propagate();
   }
 
   void Post() override {
-    Demon* demon = MakeDelayedConstraintDemon0(
-        solver(), this, &CumulativeTimeTable::InitialPropagate,
-        "InitialPropagate");
-    for (Task* const task : by_start_min_) {
-      task->WhenAnything(demon);
+    propagate_demon_ = MakeDelayedConstraintDemon0(
+        solver(), this, &CumulativeTimeTable::Propagate, "Propagate");
+    for (int i = 0; i < tasks_.size(); ++i) {
+      Demon* const demon = MakeConstraintDemon1(
+          solver(), this, &CumulativeTimeTable::OnTaskChanged, "OnTaskChanged",
+          i);
+      tasks_[i]->WhenAnything(demon);
     }
-    capacity_->WhenRange(demon);
+    capacity_->WhenRange(propagate_demon_);
+  }
+
+  void OnTaskChanged(int index) {
+    profile_.TaskChanged(solver(), index);
+    EnqueueDelayedDemon(propagate_demon_);
+  }
+
+  void Propagate() {
+    BuildProfile();
+    PushTasks();
+    // TODO(user): When a task has a fixed part, we could propagate
+    // max_demand from its current location.
   }
 
   void Accept(ModelVisitor* const visitor) const override {
@@ -1707,58 +1872,17 @@ class CumulativeTimeTable : public Constraint {
   std::string DebugString() const override { return "CumulativeTimeTable"; }
 
  private:
-  // Build the usage profile. Runs in O(n log n).
+  // Build the usage profile. Runs in O(k log n) with k the number of tasks
+  // modified since the last call, plus O(n) to copy the profile.
   void BuildProfile() {
-    // Build profile with non unique time
-    profile_non_unique_time_.clear();
-    for (const Task* const task : by_start_min_) {
-      const IntervalVar* const interval = task->interval;
-      const int64 start_max = interval->StartMax();
-      const int64 end_min = interval->EndMin();
-      if (interval->MustBePerformed() && start_max < end_min) {
-        const int64 demand_min = task->DemandMin();
-        if (demand_min > 0) {
-          profile_non_unique_time_.emplace_back(start_max, +demand_min);
-          profile_non_unique_time_.emplace_back(end_min, -demand_min);
-        }
-      }
-    }
-    // Sort
-    std::sort(profile_non_unique_time_.begin(), profile_non_unique_time_.end(),
-              TimeLessThan);
-    // Build profile with unique times
-    profile_unique_time_.clear();
-    profile_unique_time_.emplace_back(kint64min, 0);
-    int64 usage = 0;
-    for (const ProfileDelta& step : profile_non_unique_time_) {
-      if (step.time == profile_unique_time_.back().time) {
-        profile_unique_time_.back().delta += step.delta;
-      } else {
-        profile_unique_time_.push_back(step);
-      }
-      // Update usage.
-      usage += step.delta;
-    }
-    // Check final usage to be 0.
-    DCHECK_EQ(0, usage);
-    // Scan to find max usage.
-    int64 max_usage = 0;
-    for (const ProfileDelta& step : profile_unique_time_) {
-      usage += step.delta;
-      if (usage > max_usage) {
-        max_usage = usage;
-      }
-    }
-    DCHECK_EQ(0, usage);
+    const int64 max_usage =
+        profile_.Synchronize(solver(), tasks_, &profile_unique_time_);
     capacity_->SetMin(max_usage);
-    // Add a sentinel.
-    profile_unique_time_.emplace_back(kint64max, 0);
   }
 
   // Update the start min for all tasks. Runs in O(n^2) and Omega(n).
   void PushTasks() {
-    std::sort(by_start_min_.begin(), by_start_min_.end(),
-              StartMinLessThan<Task>);
+    IncrementalSort(&by_start_min_, StartMinLessThan<Task>);
     int64 usage = 0;
     int profile_index = 0;
     for (const Task* const task : by_start_min_) {
@@ -1845,13 +1969,255 @@ class CumulativeTimeTable : public Constraint {
   typedef std::vector<ProfileDelta> Profile;
 
   Profile profile_unique_time_;
-  Profile profile_non_unique_time_;
+  // Tasks in their original order, not owned.
+  const std::vector<Task*> tasks_;
   std::vector<Task*> by_start_min_;
   IntVar* const capacity_;
+  CompulsoryPartProfile profile_;
+  Demon* propagate_demon_;
 
   DISALLOW_COPY_AND_ASSIGN(CumulativeTimeTable);
 };
 
+// Time-table edge finding.
+//
+// This propagator combines the compulsory parts of the time table with the
+// energy reasoning of the edge finder. For a window [a, b) where a is the
+// start min of a task and b the end max of a task, the energy required in
+// the window is at least the energy of the compulsory parts in the window
+// plus the energy of the free parts (the parts outside the compulsory part)
+// of the tasks that lie within the window. Failure is detected if this
+// energy exceeds the energy available in the window.
+//
+// A task u that starts in the window (a <= start min) and ends after it
+// (end max > b) is pushed if starting at its start min would place more
+// energy of its free part in the window than what remains available: its
+// start min becomes the smallest start for which its additional energy
+// in the window fits.
+//
+// Only start mins are updated: end maxes are handled by a mirrored instance.
+// A call to Propagate() runs in O(n^2 log n); the compulsory part profile is
+// maintained incrementally as in CumulativeTimeTable.
+template <class Task>
+class CumulativeTimeTableEdgeFinder : public Constraint {
+ public:
+  CumulativeTimeTableEdgeFinder(Solver* const solver,
+                                const std::vector<Task*>& tasks,
+                                IntVar* const capacity)
+      : Constraint(solver),
+        tasks_(tasks),
+        by_start_min_(tasks),
+        capacity_(capacity),
+        profile_(tasks.size()),
+        propagate_demon_(nullptr) {
+    const int profile_max_size = 2 * tasks_.size() + 2;
+    profile_unique_time_.reserve(profile_max_size);
+    energy_before_.reserve(profile_max_size);
+    usage_.reserve(profile_max_size);
+    available_energy_.resize(tasks_.size());
+    new_start_min_.resize(tasks_.size());
+  }
+
+  ~CumulativeTimeTableEdgeFinder() override { STLDeleteElements(&tasks_); }
+
+  void InitialPropagate() override {
+    profile_.Invalidate();
+    Propagate();
+  }
+
+  void Post() override {
+    propagate_demon_ = MakeDelayedConstraintDemon0(
+        solver(), this, &CumulativeTimeTableEdgeFinder::Propagate,
+        "Propagate");
+    for (int i = 0; i < tasks_.size(); ++i) {
+      Demon* const demon = MakeConstraintDemon1(
+          solver(), this, &CumulativeTimeTableEdgeFinder::OnTaskChanged,
+          "OnTaskChanged", i);
+      tasks_[i]->WhenAnything(demon);
+    }
+    capacity_->WhenRange(propagate_demon_);
+  }
+
+  void OnTaskChanged(int index) {
+    profile_.TaskChanged(solver(), index);
+    EnqueueDelayedDemon(propagate_demon_);
+  }
+
+  void Propagate() {
+    capacity_->SetMin(
+        profile_.Synchronize(solver(), tasks_, &profile_unique_time_));
+    ComputeEnergyBefore();
+    IncrementalSort(&by_start_min_, StartMinLessThan<Task>);
+    const int64 capacity = capacity_->Max();
+    for (int i = 0; i < by_start_min_.size(); ++i) {
+      new_start_min_[i] = by_start_min_[i]->interval->StartMin();
+    }
+    ComputeWindowEnds();
+    for (const int64 window_end : window_ends_) {
+      PropagateWindowEnd(window_end, capacity);
+    }
+    for (int i = 0; i < by_start_min_.size(); ++i) {
+      IntervalVar* const interval = by_start_min_[i]->interval;
+      if (new_start_min_[i] > interval->StartMin()) {
+        interval->SetStartMin(new_start_min_[i]);
+      }
+    }
+  }
+
+  void Accept(ModelVisitor* const visitor) const override {
+    LOG(FATAL) << "Should not be visited";
+  }
+
+  std::string DebugString() const override {
+    return "CumulativeTimeTableEdgeFinder";
+  }
+
+ private:
+  static int64 CompulsoryDuration(const IntervalVar* const interval) {
+    return interval->MustBePerformed()
+               ? std::max(0LL, interval->EndMin() - interval->StartMax())
+               : 0;
+  }
+
+  // Energy of the free part of a task that must be performed.
+  static int64 FreeEnergy(const Task* const task) {
+    const IntervalVar* const interval = task->interval;
+    return CapProd(task->DemandMin(), interval->DurationMin() -
+                                          CompulsoryDuration(interval));
+  }
+
+  // energy_before_[i] is the energy of the profile before
+  // profile_unique_time_[i].time, and usage_[i] the usage of the profile
+  // between profile_unique_time_[i].time and the next time.
+  void ComputeEnergyBefore() {
+    energy_before_.clear();
+    usage_.clear();
+    energy_before_.push_back(0);
+    usage_.push_back(profile_unique_time_[0].delta);
+    for (int i = 1; i < profile_unique_time_.size(); ++i) {
+      const int64 duration = CapSub(profile_unique_time_[i].time,
+                                    profile_unique_time_[i - 1].time);
+      energy_before_.push_back(
+          CapAdd(energy_before_.back(), CapProd(usage_.back(), duration)));
+      usage_.push_back(usage_.back() + profile_unique_time_[i].delta);
+    }
+  }
+
+  // Computes the sorted end maxes of the tasks that must be performed,
+  // without duplicates.
+  void ComputeWindowEnds() {
+    window_ends_.clear();
+    for (const Task* const task : tasks_) {
+      const IntervalVar* const interval = task->interval;
+      if (interval->MustBePerformed() && interval->EndMax() < kint64max) {
+        window_ends_.push_back(interval->EndMax());
+      }
+    }
+    std::sort(window_ends_.begin(), window_ends_.end());
+    window_ends_.erase(std::unique(window_ends_.begin(), window_ends_.end()),
+                       window_ends_.end());
+  }
+
+  // Energy of the profile before 'time'. Runs in O(log n).
+  int64 EnergyBefore(int64 time) const {
+    const int index =
+        std::upper_bound(profile_unique_time_.begin(),
+                         profile_unique_time_.end(), ProfileDelta(time, 0),
+                         TimeLessThan) -
+        profile_unique_time_.begin() - 1;
+    DCHECK_GE(index, 0);
+    return CapAdd(
+        energy_before_[index],
+        CapProd(usage_[index], CapSub(time, profile_unique_time_[index].time)));
+  }
+
+  // Checks and propagates all windows ending at 'window_end'.
+  void PropagateWindowEnd(int64 window_end, int64 capacity) {
+    const int size = by_start_min_.size();
+    const int64 energy_before_end = EnergyBefore(window_end);
+    // Computes the available energy of all windows [start min, window_end),
+    // sweeping start mins by decreasing value.
+    int64 free_energy_inside = 0;
+    for (int i = size - 1; i >= 0; --i) {
+      const Task* const task = by_start_min_[i];
+      const IntervalVar* const interval = task->interval;
+      const int64 window_start = interval->StartMin();
+      available_energy_[i] = kint64max;
+      if (window_start >= window_end || !interval->MustBePerformed()) {
+        continue;
+      }
+      if (interval->EndMax() <= window_end) {
+        free_energy_inside = CapAdd(free_energy_inside, FreeEnergy(task));
+      }
+      const int64 profile_energy =
+          CapSub(energy_before_end, EnergyBefore(window_start));
+      const int64 available = CapSub(
+          CapSub(CapProd(capacity, CapSub(window_end, window_start)),
+                 profile_energy),
+          free_energy_inside);
+      if (available < 0) {
+        solver()->Fail();
+      }
+      available_energy_[i] = available;
+    }
+    // Pushes the tasks starting in a window and ending after it, using the
+    // tightest window starting before them.
+    int64 min_available = kint64max;
+    for (int i = 0; i < size; ++i) {
+      min_available = std::min(min_available, available_energy_[i]);
+      const Task* const task = by_start_min_[i];
+      const IntervalVar* const interval = task->interval;
+      const int64 start_min = interval->StartMin();
+      if (start_min >= window_end) {
+        break;
+      }
+      const int64 demand = task->DemandMin();
+      if (min_available == kint64max || demand == 0 ||
+          interval->EndMax() <= window_end) {
+        continue;
+      }
+      // Tasks with the same start min define the same window.
+      int64 available = min_available;
+      for (int j = i + 1;
+           j < size && by_start_min_[j]->interval->StartMin() == start_min;
+           ++j) {
+        available = std::min(available, available_energy_[j]);
+      }
+      const int64 compulsory_inside =
+          CompulsoryDuration(interval) > 0
+              ? std::max(0LL, std::min(interval->EndMin(), window_end) -
+                                  interval->StartMax())
+              : 0;
+      const int64 max_duration_inside =
+          CapAdd(compulsory_inside, available / demand);
+      const int64 duration_inside =
+          std::min(interval->DurationMin(), window_end - start_min);
+      if (duration_inside > max_duration_inside) {
+        new_start_min_[i] =
+            std::max(new_start_min_[i], window_end - max_duration_inside);
+      }
+    }
+  }
+
+  typedef std::vector<ProfileDelta> Profile;
+
+  Profile profile_unique_time_;
+  std::vector<int64> energy_before_;
+  std::vector<int64> usage_;
+  std::vector<int64> window_ends_;
+  // Tasks in their original order, owned.
+  std::vector<Task*> tasks_;
+  std::vector<Task*> by_start_min_;
+  // Indexed like by_start_min_.
+  std::vector<int64> available_energy_;
+  std::vector<int64> new_start_min_;
+  IntVar* const capacity_;
+  CompulsoryPartProfile profile_;
+  Demon* propagate_demon_;
+
+  DISALLOW_COPY_AND_ASSIGN(CumulativeTimeTableEdgeFinder);
+};
+
 class CumulativeConstraint : public Constraint {
  public:
   CumulativeConstraint(Solver* const s, const std::vector<IntervalVar*>& intervals,
@@ -1879,6 +2245,10 @@ class CumulativeConstraint : public Constraint {
       PostOneSidedConstraint(false, true);
       PostOneSidedConstraint(true, true);
     }
+    if (FLAGS_cp_use_cumulative_tt_edge_finder) {
+      PostOneSidedTimeTableEdgeFinder(false);
+      PostOneSidedTimeTableEdgeFinder(true);
+    }
     if (FLAGS_cp_use_sequence_high_demand_tasks) {
       PostHighDemandSequenceConstraint();
     }
@@ -2018,6 +2388,19 @@ class CumulativeConstraint : public Constraint {
     }
   }
 
+  // Post a straight or mirrored time-table edge-finder, if needed
+  void PostOneSidedTimeTableEdgeFinder(bool mirror) {
+    std::vector<CumulativeTask*> useful_tasks;
+    PopulateVectorUsefulTasks(mirror, &useful_tasks);
+    if (!useful_tasks.empty()) {
+      Solver* const s = solver();
+      Constraint* const constraint =
+          s->RevAlloc(new CumulativeTimeTableEdgeFinder<CumulativeTask>(
+              s, useful_tasks, capacity_));
+      s->AddConstraint(constraint);
+    }
+  }
+
   // Capacity of the cumulative resource
   IntVar* const capacity_;
 
@@ -2060,6 +2443,10 @@ class VariableDemandCumulativeConstraint : public Constraint {
       PostOneSidedConstraint(false, true);
       PostOneSidedConstraint(true, true);
     }
+    if (FLAGS_cp_use_cumulative_tt_edge_finder) {
+      PostOneSidedTimeTableEdgeFinder(false);
+      PostOneSidedTimeTableEdgeFinder(true);
+    }
     if (FLAGS_cp_use_sequence_high_demand_tasks) {
       PostHighDemandSequenceConstraint();
     }
@@ -2198,6 +2585,19 @@ class VariableDemandCumulativeConstraint : public Constraint {
     }
   }
 
+  // Post a straight or mirrored time-table edge-finder, if needed
+  void PostOneSidedTimeTableEdgeFinder(bool mirror) {
+    std::vector<VariableCumulativeTask*> useful_tasks;
+    PopulateVectorUsefulTasks(mirror, &useful_tasks);
+    if (!useful_tasks.empty()) {
+      Solver* const s = solver();
+      Constraint* const constraint =
+          s->RevAlloc(new CumulativeTimeTableEdgeFinder<VariableCumulativeTask>(
+              s, useful_tasks, capacity_));
+      s->AddConstraint(constraint);
+    }
+  }
+
   // Capacity of the cumulative resource
   IntVar* const capacity_;
 
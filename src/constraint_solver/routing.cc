@@ -21,6 +21,7 @@
 #include "base/hash.h"
 #include <map>
 #include <memory>
+#include <thread>  // NOLINT
 
 #include "base/callback.h"
 #include "base/casts.h"
@@ -28,10 +29,15 @@
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/map_util.h"
+#include "base/memory_accounting.h"
+#include "base/mutex.h"
 #include "base/stl_util.h"
 #include "base/thorough_hash.h"
+#include "base/threadpool.h"
 #include "base/hash.h"
 #include "graph/linear_assignment.h"
+#include "util/bitset.h"
+#include "util/piecewise_linear_function.h"
 #include "util/saturated_arithmetic.h"
 
 namespace operations_research {
@@ -68,6 +74,16 @@ DEFINE_bool(routing_use_chain_make_inactive, false,
             "Routing: use chain version of MakeInactive neighborhood.");
 DEFINE_bool(routing_use_extended_swap_active, false,
             "Routing: use extended version of SwapActive neighborhood.");
+DEFINE_bool(routing_adaptive_operator_selection, false,
+            "Routing: picks neighborhoods randomly, favoring the ones which "
+            "recently produced accepted neighbors quickly, instead of "
+            "exploring them in a fixed order.");
+DEFINE_int32(routing_operator_selection_seed, 0,
+             "Routing: random seed of the adaptive neighborhood selection.");
+DEFINE_int64(routing_neighbors_per_node, 0,
+             "Routing: if positive, restricts Relocate, Exchange, Cross, 2Opt "
+             "and MakeActive moves to nodes which are among the given number "
+             "of nearest neighbors of each other (by arc cost).");
 
 // Search limits
 DEFINE_int64(routing_solution_limit, kint64max,
@@ -121,6 +137,9 @@ DEFINE_int64(savings_filter_radius, 0,
              "Use filter which filters the pair of orders considered in "
              "Savings first solution heuristic by limiting the distance "
              "up to which a neighbor is considered for each node.");
+DEFINE_int32(savings_num_threads, 1,
+             "Number of threads used to sort the savings in the filtered "
+             "Savings first solution heuristic.");
 DEFINE_int64(sweep_sectors, 1,
              "The number of sectors the space is divided before it is sweeped "
              "by the ray.");
@@ -133,7 +152,19 @@ DEFINE_bool(routing_use_light_propagation, true,
 DEFINE_bool(routing_cache_callbacks, false, "Cache callback calls.");
 DEFINE_int64(routing_max_cache_size, 1000,
              "Maximum cache size when callback caching is on.");
+DEFINE_int64(routing_sparse_cache_entries, 1 << 20,
+             "Number of entries of the sparse cache used instead of the dense "
+             "one when caching is on and the model is larger than "
+             "routing_max_cache_size. 0 disables caching for such models.");
+DEFINE_int32(routing_assignment_chunk_size, 0,
+             "Routing: if positive, WriteAssignment() writes assignments in "
+             "chunks of that many variables, which ReadAssignment() loads "
+             "one at a time.");
 DEFINE_bool(routing_trace, false, "Routing: trace search.");
+DEFINE_bool(routing_log_lower_bound_gap, false,
+            "Routing: computes the assignment lower bound of the cost in "
+            "parallel with the search, and logs the optimality gap of each "
+            "solution.");
 DEFINE_bool(routing_search_trace, false,
             "Routing: use SearchTrace for monitoring search.");
 DEFINE_bool(routing_use_homogeneous_costs, true,
@@ -144,6 +175,10 @@ DEFINE_bool(routing_check_compact_assignment, true,
 DEFINE_bool(routing_fingerprint_arc_cost_evaluators, true,
             "Compare arc-cost evaluators using the fingerprint of their "
             "corresponding matrix instead of evaluator addresses.");
+DEFINE_bool(routing_lean_model, false,
+            "Reduce the memory used by the routing model: variables are not "
+            "named and the variables tracking routes bound to their end are "
+            "only created if the first solution strategy needs them.");
 
 #if defined(_MSC_VER)
 namespace stdext {
@@ -612,6 +647,172 @@ LocalSearchOperator* MakePairRelocate(
       vars, secondary_vars, start_empty_path_class, pairs));
 }
 
+// Operator which exchanges the positions of two pairs of nodes: the first
+// nodes of the pairs are swapped, and so are their second nodes, which keeps
+// the first node of each pair before its second node on the same path.
+// Possible neighbors for the paths 1 -> A -> B -> 2 and 3 -> C -> D -> 4
+// (where (1, 2) and (3, 4) are first and last nodes of the paths, and (A, B)
+// and (C, D) are pairs of nodes):
+//   1 -> [C] -> [D] -> 2 and 3 -> [A] -> [B] -> 4
+class PairExchangeOperator : public PathOperator {
+ public:
+  PairExchangeOperator(const std::vector<IntVar*>& vars,
+                       const std::vector<IntVar*>& secondary_vars,
+                       ResultCallback1<int, int64>* start_empty_path_class,
+                       const RoutingModel::NodePairs& node_pairs)
+      : PathOperator(vars, secondary_vars, 2, start_empty_path_class),
+        pairs_(number_of_nexts(), -1),
+        prevs_(number_of_nexts(), -1),
+        is_first_(number_of_nexts(), false) {
+    for (const std::pair<int64, int64> node_pair : node_pairs) {
+      pairs_[node_pair.first] = node_pair.second;
+      pairs_[node_pair.second] = node_pair.first;
+      is_first_[node_pair.first] = true;
+    }
+  }
+  ~PairExchangeOperator() override {}
+  bool MakeNeighbor() override;
+  std::string DebugString() const override { return "PairExchange"; }
+
+ private:
+  void OnNodeInitialization() override;
+  bool RestartAtPathStartOnSynchronize() override { return true; }
+  // Returns the node replacing 'node' in the exchange.
+  int64 Exchanged(int64 node, int64 first1, int64 first2, int64 second1,
+                  int64 second2) const {
+    if (node == first1) return first2;
+    if (node == first2) return first1;
+    if (node == second1) return second2;
+    if (node == second2) return second1;
+    return node;
+  }
+
+  std::vector<int> pairs_;
+  std::vector<int64> prevs_;
+  std::vector<bool> is_first_;
+};
+
+bool PairExchangeOperator::MakeNeighbor() {
+  const int64 first1 = BaseNode(0);
+  const int64 first2 = BaseNode(1);
+  // Each exchange is only considered once.
+  if (first1 >= first2 || IsPathEnd(first2) || !is_first_[first1] ||
+      !is_first_[first2]) {
+    return false;
+  }
+  const int64 second1 = pairs_[first1];
+  const int64 second2 = pairs_[first2];
+  if (IsInactive(second1) || IsInactive(second2)) return false;
+  // The new paths are the current paths in which the nodes of the pairs are
+  // replaced by their exchanged node; only the arcs leaving the exchanged
+  // nodes or their predecessors change.
+  int64 tails[8];
+  int num_tails = 0;
+  for (const int64 node : {first1, second1, first2, second2}) {
+    for (const int64 tail : {prevs_[node], node}) {
+      if (std::find(tails, tails + num_tails, tail) == tails + num_tails) {
+        tails[num_tails++] = tail;
+      }
+    }
+  }
+  int64 froms[8];
+  int64 tos[8];
+  int64 paths[8];
+  for (int i = 0; i < num_tails; ++i) {
+    froms[i] = Exchanged(tails[i], first1, first2, second1, second2);
+    tos[i] = Exchanged(Next(tails[i]), first1, first2, second1, second2);
+    paths[i] = Path(tails[i]);
+  }
+  for (int i = 0; i < num_tails; ++i) {
+    SetNext(froms[i], tos[i], paths[i]);
+  }
+  return true;
+}
+
+void PairExchangeOperator::OnNodeInitialization() {
+  for (int i = 0; i < number_of_nexts(); ++i) {
+    if (!IsInactive(i)) prevs_[Next(i)] = i;
+  }
+}
+
+LocalSearchOperator* MakePairExchange(
+    Solver* const solver, const std::vector<IntVar*>& vars,
+    const std::vector<IntVar*>& secondary_vars,
+    ResultCallback1<int, int64>* start_empty_path_class,
+    const RoutingModel::NodePairs& pairs) {
+  return solver->RevAlloc(new PairExchangeOperator(
+      vars, secondary_vars, start_empty_path_class, pairs));
+}
+
+// 2-opt operator which does not reverse chains containing both nodes of a
+// pair, as this would put the second node of the pair before the first one.
+// Chains containing a single node of a pair are reversed as by TwoOpt.
+class PairTwoOptOperator : public PathOperator {
+ public:
+  PairTwoOptOperator(const std::vector<IntVar*>& vars,
+                     const std::vector<IntVar*>& secondary_vars,
+                     ResultCallback1<int, int64>* start_empty_path_class,
+                     const RoutingModel::NodePairs& node_pairs)
+      : PathOperator(vars, secondary_vars, 2, start_empty_path_class),
+        pairs_(number_of_nexts(), -1),
+        chain_stamps_(number_of_nexts(), 0),
+        stamp_(0) {
+    for (const std::pair<int64, int64> node_pair : node_pairs) {
+      pairs_[node_pair.first] = node_pair.second;
+      pairs_[node_pair.second] = node_pair.first;
+    }
+  }
+  ~PairTwoOptOperator() override {}
+  bool MakeNeighbor() override;
+  std::string DebugString() const override { return "PairTwoOpt"; }
+
+ protected:
+  bool OnSamePathAsPreviousBase(int64 base_index) override {
+    // Both base nodes have to be on the same path.
+    return true;
+  }
+  int64 GetBaseNodeRestartPosition(int base_index) override {
+    // The end of the reversed chain is after its start.
+    return base_index == 0 ? StartNode(0) : BaseNode(0);
+  }
+  bool RestartAtPathStartOnSynchronize() override { return true; }
+
+ private:
+  std::vector<int> pairs_;
+  std::vector<int64> chain_stamps_;
+  int64 stamp_;
+};
+
+bool PairTwoOptOperator::MakeNeighbor() {
+  DCHECK_EQ(StartNode(0), StartNode(1));
+  const int64 before_chain = BaseNode(0);
+  const int64 after_chain = BaseNode(1);
+  if (IsPathEnd(before_chain)) return false;
+  ++stamp_;
+  int64 node = Next(before_chain);
+  while (node != after_chain) {
+    if (IsPathEnd(node)) return false;
+    const int sibling = pairs_[node];
+    if (sibling >= 0 && chain_stamps_[sibling] == stamp_) return false;
+    chain_stamps_[node] = stamp_;
+    node = Next(node);
+  }
+  const int64 chain_first = Next(before_chain);
+  int64 chain_last;
+  // Reversing a single node is a NOP.
+  return ReverseChain(before_chain, after_chain, &chain_last) &&
+         chain_first != chain_last;
+}
+
+LocalSearchOperator* MakePairTwoOpt(
+    Solver* const solver, const std::vector<IntVar*>& vars,
+    const std::vector<IntVar*>& secondary_vars,
+    ResultCallback1<int, int64>* start_empty_path_class,
+    const RoutingModel::NodePairs& pairs) {
+  return solver->RevAlloc(new PairTwoOptOperator(
+      vars, secondary_vars, start_empty_path_class, pairs));
+}
+
 // Cached callbacks
 
 class RoutingCache : public RoutingModel::NodeEvaluator2 {
@@ -624,12 +825,14 @@ class RoutingCache : public RoutingModel::NodeEvaluator2 {
   // directly, but through RoutingModel::NewCachedCallback that ensures that the
   // base callback is deleted properly.
   RoutingCache(RoutingModel::NodeEvaluator2* callback, int size)
-      : cached_(size), cache_(size), callback_(callback) {
-    for (RoutingModel::NodeIndex i(0); i < RoutingModel::NodeIndex(size); ++i) {
-      cached_[i].resize(size, false);
-      cache_[i].resize(size, 0);
-    }
+      : size_(size),
+        cached_(static_cast<int64>(size) * size),
+        cache_(new int64[static_cast<int64>(size) * size]),
+        callback_(callback),
+        memory_(ROUTING_CACHES) {
     callback->CheckIsRepeatable();
+    memory_.Set(static_cast<int64>(size) * size * sizeof(int64) +
+                cached_.size() / 8);
   }
   bool IsRepeatable() const override { return true; }
   int64 Run(RoutingModel::NodeIndex i, RoutingModel::NodeIndex j) override {
@@ -638,48 +841,123 @@ class RoutingCache : public RoutingModel::NodeEvaluator2 {
     // returns previous result if so, or runs underlaying callback and
     // stores its result.
     // Not MT-safe.
-    if (cached_[i][j]) {
-      return cache_[i][j];
+    const int64 index = static_cast<int64>(i.value()) * size_ + j.value();
+    if (cached_.IsSet(index)) {
+      return cache_[index];
     } else {
       const int64 cached_value = callback_->Run(i, j);
-      cached_[i][j] = true;
-      cache_[i][j] = cached_value;
+      cached_.Set(index);
+      cache_[index] = cached_value;
       return cached_value;
     }
   }
 
  private:
-  ITIVector<RoutingModel::NodeIndex, ITIVector<RoutingModel::NodeIndex, bool>>
-      cached_;
-  ITIVector<RoutingModel::NodeIndex, ITIVector<RoutingModel::NodeIndex, int64>>
-      cache_;
+  const int64 size_;
+  // Both the cache and its occupancy are stored as flat row-major arrays.
+  Bitset64<int64> cached_;
+  std::unique_ptr<int64[]> cache_;
+  RoutingModel::NodeEvaluator2* const callback_;
+  MemoryUsageTracker memory_;
+};
+
+// Cached callback for models too large to hold a dense size x size cache.
+// Only the queried arcs are stored, in a fixed-size open-addressing table
+// keyed by (i, j) and allocated once. When all the slots probed for an arc are
+// taken, the first one is overwritten: the table behaves as a bounded cache and
+// never grows. As the keys are stored with the values, results are always
+// exact. Ownership semantics are the same as for RoutingCache.
+class RoutingSparseCache : public RoutingModel::NodeEvaluator2 {
+ public:
+  // 'capacity' is the number of entries of the table; it is rounded up to the
+  // next power of two.
+  RoutingSparseCache(RoutingModel::NodeEvaluator2* callback, int64 capacity)
+      : mask_(ComputeMask(capacity)),
+        entries_(new Entry[mask_ + 1]),
+        callback_(callback),
+        memory_(ROUTING_CACHES) {
+    for (uint64 slot = 0; slot <= mask_; ++slot) {
+      entries_[slot].from = kEmpty;
+    }
+    callback->CheckIsRepeatable();
+    memory_.Set((mask_ + 1) * sizeof(Entry));
+  }
+  bool IsRepeatable() const override { return true; }
+  int64 Run(RoutingModel::NodeIndex i, RoutingModel::NodeIndex j) override {
+    // Not MT-safe.
+    const uint64 first_slot = Hash(i.value(), j.value());
+    uint64 slot = first_slot;
+    for (int probe = 0; probe < kMaxProbes; ++probe) {
+      Entry* const entry = &entries_[slot];
+      if (entry->from == i.value() && entry->to == j.value()) {
+        return entry->value;
+      }
+      if (entry->from == kEmpty) {
+        return Insert(entry, i, j);
+      }
+      slot = (slot + 1) & mask_;
+    }
+    return Insert(&entries_[first_slot], i, j);
+  }
+
+ private:
+  struct Entry {
+    int32 from;
+    int32 to;
+    int64 value;
+  };
+  static const int32 kEmpty = -1;
+  // Number of consecutive slots looked at before evicting an entry.
+  static const int kMaxProbes = 4;
+
+  static uint64 ComputeMask(int64 capacity) {
+    uint64 size = 1;
+    while (size < capacity) size <<= 1;
+    return size - 1;
+  }
+  uint64 Hash(int i, int j) const {
+    const uint64 key = (static_cast<uint64>(i) << 32) | static_cast<uint32>(j);
+    return ((key * GG_ULONGLONG(0x9E3779B97F4A7C15)) >> 17) & mask_;
+  }
+  int64 Insert(Entry* const entry, RoutingModel::NodeIndex i,
+               RoutingModel::NodeIndex j) {
+    const int64 value = callback_->Run(i, j);
+    entry->from = i.value();
+    entry->to = j.value();
+    entry->value = value;
+    return value;
+  }
+
+  const uint64 mask_;
+  std::unique_ptr<Entry[]> entries_;
   RoutingModel::NodeEvaluator2* const callback_;
+  MemoryUsageTracker memory_;
 };
 
 // Evaluators
 
+// Stores the matrix as a single row-major array, which can be read directly by
+// the routing model (see RoutingModel::SetArcCostMatrixOfAllVehicles()).
 class MatrixEvaluator : public BaseObject {
  public:
   MatrixEvaluator(const int64* const* values, int nodes, RoutingModel* model)
-      : values_(new int64*[nodes]), nodes_(nodes), model_(model) {
+      : values_(new int64[static_cast<int64>(nodes) * nodes]),
+        nodes_(nodes),
+        model_(model) {
     CHECK(values) << "null pointer";
     for (int i = 0; i < nodes_; ++i) {
-      values_[i] = new int64[nodes_];
-      memcpy(values_[i], values[i], nodes_ * sizeof(*values[i]));
+      memcpy(values_.get() + static_cast<int64>(i) * nodes_, values[i],
+             nodes_ * sizeof(*values[i]));
     }
   }
-  ~MatrixEvaluator() override {
-    for (int i = 0; i < nodes_; ++i) {
-      delete[] values_[i];
-    }
-    delete[] values_;
-  }
+  ~MatrixEvaluator() override {}
   int64 Value(RoutingModel::NodeIndex i, RoutingModel::NodeIndex j) const {
-    return values_[i.value()][j.value()];
+    return values_[static_cast<int64>(i.value()) * nodes_ + j.value()];
   }
+  const int64* data() const { return values_.get(); }
 
  private:
-  int64** const values_;
+  std::unique_ptr<int64[]> values_;
   const int nodes_;
   RoutingModel* const model_;
 };
@@ -705,6 +983,27 @@ int64 VectorEvaluator::Value(RoutingModel::NodeIndex i,
   return values_[i.value()];
 }
 
+// Transit evaluator of a time-dependent dimension, returning the minimum
+// transit of the time-dependent transit function of each arc.
+class MinTransitProfileEvaluator : public BaseObject {
+ public:
+  MinTransitProfileEvaluator(RoutingModel::NodeEvaluator2* profile_evaluator,
+                             const std::vector<TimeDependentTransit>& profiles)
+      : profile_evaluator_(profile_evaluator) {
+    for (const TimeDependentTransit& profile : profiles) {
+      min_transits_.push_back(profile.Min());
+    }
+  }
+  ~MinTransitProfileEvaluator() override {}
+  int64 Value(RoutingModel::NodeIndex i, RoutingModel::NodeIndex j) const {
+    return min_transits_[profile_evaluator_->Run(i, j)];
+  }
+
+ private:
+  RoutingModel::NodeEvaluator2* const profile_evaluator_;
+  std::vector<int64> min_transits_;
+};
+
 class ConstantEvaluator : public BaseObject {
  public:
   explicit ConstantEvaluator(int64 value) : value_(value) {}
@@ -739,6 +1038,8 @@ void RoutingModel::SetGlobalParameters(const RoutingParameters& p) {
   FLAGS_routing_use_light_propagation = p.use_light_propagation;
   FLAGS_routing_cache_callbacks = p.cache_callbacks;
   FLAGS_routing_max_cache_size = p.max_cache_size;
+  FLAGS_routing_sparse_cache_entries = p.sparse_cache_entries;
+  FLAGS_routing_lean_model = p.lean_model;
 }
 
 RoutingModel::RoutingModel(int nodes, int vehicles)
@@ -753,6 +1054,8 @@ RoutingModel::RoutingModel(int nodes, int vehicles)
       costs_are_homogeneous_across_vehicles_(
           FLAGS_routing_use_homogeneous_costs),
       vehicle_class_index_of_vehicle_(vehicles_, VehicleClassIndex(-1)),
+      arc_cost_matrix_evaluator_(nullptr),
+      arc_cost_matrix_(nullptr),
       starts_(vehicles),
       ends_(vehicles),
       start_end_count_(vehicles > 0 ? 1 : 0),
@@ -790,6 +1093,8 @@ RoutingModel::RoutingModel(int nodes, int vehicles,
       costs_are_homogeneous_across_vehicles_(
           FLAGS_routing_use_homogeneous_costs),
       vehicle_class_index_of_vehicle_(vehicles_, VehicleClassIndex(-1)),
+      arc_cost_matrix_evaluator_(nullptr),
+      arc_cost_matrix_(nullptr),
       starts_(vehicles),
       ends_(vehicles),
       is_depot_set_(false),
@@ -835,6 +1140,8 @@ RoutingModel::RoutingModel(int nodes, int vehicles,
       costs_are_homogeneous_across_vehicles_(
           FLAGS_routing_use_homogeneous_costs),
       vehicle_class_index_of_vehicle_(vehicles_, VehicleClassIndex(-1)),
+      arc_cost_matrix_evaluator_(nullptr),
+      arc_cost_matrix_(nullptr),
       starts_(vehicles),
       ends_(vehicles),
       is_depot_set_(false),
@@ -870,20 +1177,30 @@ RoutingModel::RoutingModel(int nodes, int vehicles,
 }
 
 void RoutingModel::Initialize() {
+  last_memory_usage_ = Solver::MemoryUsage();
   const int size = Size();
+  // Variable names are skipped in lean mode.
+  const std::string no_name;
+  const bool lean = FLAGS_routing_lean_model;
   // Next variables
-  solver_->MakeIntVarArray(size, 0, size + vehicles_ - 1, "Nexts", &nexts_);
+  solver_->MakeIntVarArray(size, 0, size + vehicles_ - 1,
+                           lean ? no_name : "Nexts", &nexts_);
   solver_->AddConstraint(solver_->MakeAllDifferent(nexts_, false));
   node_to_disjunction_.resize(size, kNoDisjunction);
+  RecordMemoryUsage("next variables");
   // Vehicle variables. In case that node i is not active, vehicle_vars_[i] is
   // bound to -1.
-  solver_->MakeIntVarArray(size + vehicles_, -1, vehicles_ - 1, "Vehicles",
-                           &vehicle_vars_);
+  solver_->MakeIntVarArray(size + vehicles_, -1, vehicles_ - 1,
+                           lean ? no_name : "Vehicles", &vehicle_vars_);
+  RecordMemoryUsage("vehicle variables");
   // Active variables
-  solver_->MakeBoolVarArray(size, "Active", &active_);
-  // Is-bound-to-end variables.
-  solver_->MakeBoolVarArray(size + vehicles_, "IsBoundToEnd",
-                            &is_bound_to_end_);
+  solver_->MakeBoolVarArray(size, lean ? no_name : "Active", &active_);
+  RecordMemoryUsage("active variables");
+  // Is-bound-to-end variables; in lean mode they are created when closing the
+  // model, if needed.
+  if (!lean) {
+    InitializeIsBoundToEnd();
+  }
   // Cost cache
   cost_cache_.clear();
   cost_cache_.resize(size + vehicles_);
@@ -894,6 +1211,35 @@ void RoutingModel::Initialize() {
     cache.cost = 0;
   }
   preassignment_ = solver_->MakeAssignment();
+  RecordMemoryUsage("cost cache");
+}
+
+void RoutingModel::InitializeIsBoundToEnd() {
+  solver_->MakeBoolVarArray(
+      Size() + vehicles_,
+      FLAGS_routing_lean_model ? std::string() : std::string("IsBoundToEnd"),
+      &is_bound_to_end_);
+  RecordMemoryUsage("is-bound-to-end variables");
+}
+
+void RoutingModel::RecordMemoryUsage(const std::string& component) {
+  const int64 memory_usage = Solver::MemoryUsage();
+  memory_usage_by_component_.push_back(
+      std::make_pair(component, memory_usage - last_memory_usage_));
+  last_memory_usage_ = memory_usage;
+}
+
+std::string RoutingModel::MemoryUsageReport() const {
+  std::string report;
+  int64 total = 0;
+  for (const std::pair<std::string, int64>& component :
+       memory_usage_by_component_) {
+    StringAppendF(&report, "%s: %" GG_LL_FORMAT "d bytes\n",
+                  component.first.c_str(), component.second);
+    total += component.second;
+  }
+  StringAppendF(&report, "total: %" GG_LL_FORMAT "d bytes\n", total);
+  return report;
 }
 
 RoutingModel::~RoutingModel() {
@@ -949,7 +1295,8 @@ bool RoutingModel::AddDimensionWithVehicleTransitAndCapacity(
 bool RoutingModel::AddDimensionWithCapacityInternal(
     const std::vector<NodeEvaluator2*>& evaluators, int64 slack_max, int64 capacity,
     VehicleEvaluator* vehicle_capacity, bool fix_start_cumul_to_zero,
-    const std::string& dimension_name) {
+    const std::string& dimension_name, NodeEvaluator2* transit_profile_evaluator,
+    const std::vector<TimeDependentTransit>& transit_profiles) {
   CheckDepot();
   if (!HasDimension(dimension_name)) {
     const DimensionIndex dimension_index(dimensions_.size());
@@ -961,6 +1308,10 @@ bool RoutingModel::AddDimensionWithCapacityInternal(
       CHECK(evaluator != nullptr);
       cached_evaluators.push_back(NewCachedCallback(evaluator));
     }
+    if (transit_profile_evaluator != nullptr) {
+      dimension->transit_profiles_ = transit_profiles;
+      dimension->transit_profile_evaluator_ = transit_profile_evaluator;
+    }
     dimension->Initialize(vehicle_capacity, capacity, cached_evaluators,
                           slack_max);
     solver_->AddConstraint(solver_->MakeDelayedPathCumul(
@@ -972,6 +1323,7 @@ bool RoutingModel::AddDimensionWithCapacityInternal(
         start_cumul->SetValue(0);
       }
     }
+    RecordMemoryUsage("dimension " + dimension_name);
     return true;
   } else {
     hash_set<NodeEvaluator2*> evaluator_set(evaluators.begin(),
@@ -1000,8 +1352,13 @@ bool RoutingModel::AddVectorDimension(const int64* values, int64 capacity,
                                       const std::string& dimension_name) {
   VectorEvaluator* const evaluator =
       solver_->RevAlloc(new VectorEvaluator(values, nodes_, this));
-  return AddDimension(NewPermanentCallback(evaluator, &VectorEvaluator::Value),
-                      0, capacity, fix_start_cumul_to_zero, dimension_name);
+  if (!AddDimension(NewPermanentCallback(evaluator, &VectorEvaluator::Value),
+                    0, capacity, fix_start_cumul_to_zero, dimension_name)) {
+    return false;
+  }
+  // The transit only depends on the origin node.
+  GetMutableDimension(dimension_name)->InitializeTransitMatrix(values, 1, 0);
+  return true;
 }
 
 bool RoutingModel::AddMatrixDimension(const int64* const* values,
@@ -1010,8 +1367,41 @@ bool RoutingModel::AddMatrixDimension(const int64* const* values,
                                       const std::string& dimension_name) {
   MatrixEvaluator* const evaluator =
       solver_->RevAlloc(new MatrixEvaluator(values, nodes_, this));
-  return AddDimension(NewPermanentCallback(evaluator, &MatrixEvaluator::Value),
-                      0, capacity, fix_start_cumul_to_zero, dimension_name);
+  if (!AddDimension(NewPermanentCallback(evaluator, &MatrixEvaluator::Value),
+                    0, capacity, fix_start_cumul_to_zero, dimension_name)) {
+    return false;
+  }
+  GetMutableDimension(dimension_name)
+      ->InitializeTransitMatrix(evaluator->data(), nodes_, 1);
+  return true;
+}
+
+bool RoutingModel::AddTimeDependentDimension(
+    NodeEvaluator2* profile_evaluator,
+    const std::vector<TimeDependentTransit>& profiles, int64 slack_max,
+    int64 capacity, bool fix_start_cumul_to_zero,
+    const std::string& dimension_name) {
+  CHECK(profile_evaluator != nullptr);
+  CHECK(!profiles.empty());
+  for (const TimeDependentTransit& profile : profiles) {
+    CHECK(profile.IsFifo()) << "Time-dependent transits must be FIFO";
+  }
+  if (HasDimension(dimension_name)) {
+    delete profile_evaluator;
+    return false;
+  }
+  // The profile evaluator is owned by the model once cached; the transit
+  // evaluator reads the cached version.
+  NodeEvaluator2* const cached_profile_evaluator =
+      NewCachedCallback(profile_evaluator);
+  MinTransitProfileEvaluator* const evaluator = solver_->RevAlloc(
+      new MinTransitProfileEvaluator(cached_profile_evaluator, profiles));
+  const std::vector<NodeEvaluator2*> evaluators(
+      vehicles_,
+      NewPermanentCallback(evaluator, &MinTransitProfileEvaluator::Value));
+  return AddDimensionWithCapacityInternal(
+      evaluators, slack_max, capacity, nullptr, fix_start_cumul_to_zero,
+      dimension_name, cached_profile_evaluator, profiles);
 }
 
 void RoutingModel::GetAllDimensions(std::vector<std::string>* dimension_names) const {
@@ -1061,6 +1451,15 @@ void RoutingModel::SetArcCostEvaluatorOfAllVehicles(NodeEvaluator2* evaluator) {
   }
 }
 
+void RoutingModel::SetArcCostMatrixOfAllVehicles(const int64* const* values) {
+  MatrixEvaluator* const evaluator =
+      solver_->RevAlloc(new MatrixEvaluator(values, nodes_, this));
+  arc_cost_matrix_evaluator_ =
+      NewPermanentCallback(evaluator, &MatrixEvaluator::Value);
+  arc_cost_matrix_ = evaluator->data();
+  SetArcCostEvaluatorOfAllVehicles(arc_cost_matrix_evaluator_);
+}
+
 void RoutingModel::SetArcCostEvaluatorOfVehicle(NodeEvaluator2* evaluator,
                                                 int vehicle) {
   CHECK(evaluator != nullptr);
@@ -1220,6 +1619,9 @@ void RoutingModel::ComputeCostClasses() {
       *cached_evaluator = NewCachedCallback(uncached_evaluator);
     }
     CostClass cost_class(*cached_evaluator);
+    if (uncached_evaluator == arc_cost_matrix_evaluator_) {
+      cost_class.arc_cost_matrix = arc_cost_matrix_;
+    }
     // Insert the dimension data in a canonical way.
     for (const RoutingDimension* const dimension : dimensions_) {
       const int64 coeff = dimension->vehicle_span_cost_coefficients()[vehicle];
@@ -1291,6 +1693,9 @@ bool RoutingModel::VehicleClass::LessThan(const VehicleClass& a,
   if (a.dimension_capacities != b.dimension_capacities) {
     return a.dimension_capacities < b.dimension_capacities;
   }
+  if (a.dimension_span_upper_bounds != b.dimension_span_upper_bounds) {
+    return a.dimension_span_upper_bounds < b.dimension_span_upper_bounds;
+  }
   return a.dimension_evaluators < b.dimension_evaluators;
 }
 
@@ -1322,6 +1727,8 @@ void RoutingModel::ComputeVehicleClasses() {
           dimension->capacity_evaluator() != nullptr
               ? dimension->capacity_evaluator()->Run(vehicle)
               : -1);
+      vehicle_class.dimension_span_upper_bounds.push_back(
+          dimension->GetSpanUpperBoundForVehicle(vehicle));
       vehicle_class.dimension_evaluators.push_back(
           dimension->transit_evaluator(vehicle));
     }
@@ -1664,9 +2071,20 @@ void RoutingModel::CloseModel() {
     }
   }
 
-  // Constraining is_bound_to_end_ variables.
-  for (const int64 end : ends_) {
-    is_bound_to_end_[end]->SetValue(1);
+  // Constraining is_bound_to_end_ variables. In lean mode, they are only
+  // needed by the arc-based first solution strategies.
+  if (is_bound_to_end_.empty()) {
+    const RoutingStrategy strategy = GetSelectedFirstSolutionStrategy();
+    if (strategy == ROUTING_GLOBAL_CHEAPEST_ARC ||
+        strategy == ROUTING_LOCAL_CHEAPEST_ARC ||
+        strategy == ROUTING_PATH_CHEAPEST_ARC) {
+      InitializeIsBoundToEnd();
+    }
+  }
+  if (!is_bound_to_end_.empty()) {
+    for (const int64 end : ends_) {
+      is_bound_to_end_[end]->SetValue(1);
+    }
   }
 
   std::vector<IntVar*> cost_elements;
@@ -1709,12 +2127,14 @@ void RoutingModel::CloseModel() {
   // Keep this out of SetupSearch as this contains static search objects.
   // This will allow calling SetupSearch multiple times with different search
   // parameters.
+  RecordMemoryUsage("costs");
   CreateNeighborhoodOperators();
   CreateFirstSolutionDecisionBuilders();
   if (!ValidateSearchParameters()) {
     return;
   }
   SetupSearch();
+  RecordMemoryUsage("search");
 }
 
 struct Link {
@@ -2681,6 +3101,11 @@ void RoutingModel::AddSearchMonitor(SearchMonitor* const monitor) {
 
 const Assignment* RoutingModel::SolveWithParameters(
     const RoutingSearchParameters& p, const Assignment* assignment) {
+  SetSearchParameters(p);
+  return Solve(assignment);
+}
+
+void RoutingModel::SetSearchParameters(const RoutingSearchParameters& p) {
   FLAGS_routing_no_lns = p.no_lns;
   FLAGS_routing_no_fullpathlns = p.no_fullpathlns;
   FLAGS_routing_no_relocate = p.no_relocate;
@@ -2695,6 +3120,7 @@ const Assignment* RoutingModel::SolveWithParameters(
   FLAGS_routing_no_tsplns = p.no_tsplns;
   FLAGS_routing_use_chain_make_inactive = p.use_chain_make_inactive;
   FLAGS_routing_use_extended_swap_active = p.use_extended_swap_active;
+  FLAGS_routing_neighbors_per_node = p.neighbors_per_node;
   FLAGS_routing_solution_limit = p.solution_limit;
   FLAGS_routing_time_limit = p.time_limit;
   time_limit_ms_ = p.time_limit;
@@ -2710,8 +3136,6 @@ const Assignment* RoutingModel::SolveWithParameters(
   FLAGS_routing_use_first_solution_dive = p.use_first_solution_dive;
   FLAGS_routing_optimization_step = p.optimization_step;
   FLAGS_routing_trace = p.trace;
-
-  return Solve(assignment);
 }
 
 const Assignment* RoutingModel::Solve(const Assignment* assignment) {
@@ -2731,7 +3155,9 @@ const Assignment* RoutingModel::Solve(const Assignment* assignment) {
     status_ = ROUTING_SUCCESS;
     return collect_assignments_->solution(0);
   } else {
-    if (elapsed_time_ms >= time_limit_ms_) {
+    if (IsMemoryBudgetExceeded()) {
+      status_ = ROUTING_FAIL_MEMORY_LIMIT;
+    } else if (elapsed_time_ms >= time_limit_ms_) {
       status_ = ROUTING_FAIL_TIMEOUT;
     } else {
       status_ = ROUTING_FAIL;
@@ -2750,49 +3176,117 @@ const Assignment* RoutingModel::Solve(const Assignment* assignment) {
 // This is a lower bound given the solution to assignment problem does not
 // necessarily produce a (set of) closed route(s) from a starting node to an
 // ending node.
-int64 RoutingModel::ComputeLowerBound() {
-  if (!closed_) {
-    LOG(WARNING) << "Non-closed model not supported.";
-    return 0;
-  }
-  if (!CostsAreHomogeneousAcrossVehicles()) {
-    LOG(WARNING) << "Non-homogeneous vehicle costs not supported";
-    return 0;
-  }
-  if (disjunctions_.size() > 0) {
-    LOG(WARNING)
-        << "Node disjunction constraints or optional nodes not supported.";
-    return 0;
+// - With non-homogeneous costs, the cost of an arc leaving a start node or
+//   entering an end node is the cost for its vehicle, and the cost of the
+//   other arcs is the minimum over the cost classes of the vehicles.
+// - A node that can be unperformed has an arc to itself (the node is its own
+//   successor), whose cost is its penalty if it is alone in its disjunction,
+//   and 0 otherwise (the penalty of a disjunction of several nodes is only
+//   paid if none of them is performed).
+namespace {
+// Returns the cost of leaving the node of the given index unperformed in the
+// relaxation, or -1 if it must be performed.
+int64 UnperformedCost(RoutingModel* const model, int index) {
+  if (model->IsStart(index) || model->ActiveVar(index)->Min() == 1) return -1;
+  RoutingModel::DisjunctionIndex disjunction = RoutingModel::kNoDisjunction;
+  if (!model->GetDisjunctionIndexFromVariableIndex(index, &disjunction)) {
+    // Without disjunctions, all the nodes are active; with disjunctions, the
+    // nodes outside of them are optional, at no cost.
+    return model->GetNumberOfDisjunctions() == 0 ? -1 : 0;
+  }
+  const int64 penalty = model->GetDisjunctionPenalty(disjunction);
+  if (model->GetDisjunctionIndices(disjunction).size() > 1) return 0;
+  return penalty;
+}
+
+// The assignment relaxation of a routing model, detached from the model so
+// that it can be solved in another thread: the arcs and their costs are
+// collected from the model by the constructor, in the thread owning the
+// model, and Solve() does not access the model.
+class AssignmentRelaxation {
+ public:
+  explicit AssignmentRelaxation(RoutingModel* const model);
+
+  // Returns the cost of the minimum-cost assignment, or 0 if there is none.
+  int64 Solve() const;
+
+ private:
+  void AddArc(int tail, int head, int64 cost) {
+    tails_.push_back(tail);
+    heads_.push_back(head);
+    costs_.push_back(cost);
   }
-  const int num_nodes = Size() + vehicles_;
-  ForwardStarGraph graph(2 * num_nodes, num_nodes * num_nodes);
-  LinearSumAssignment<ForwardStarGraph> linear_sum_assignment(graph, num_nodes);
-  // Adding arcs for non-end nodes, based on possible values of next variables.
-  // Left nodes in the bipartite are indexed from 0 to num_nodes - 1; right
-  // nodes are indexed from num_nodes to 2 * num_nodes - 1.
-  for (int tail = 0; tail < Size(); ++tail) {
+
+  int num_nodes_;
+  std::vector<int> tails_;
+  std::vector<int> heads_;
+  std::vector<int64> costs_;
+};
+
+AssignmentRelaxation::AssignmentRelaxation(RoutingModel* const model)
+    : num_nodes_(model->Size() + model->vehicles()) {
+  const int size = model->Size();
+  // The vehicle of the start and end nodes, -1 for the other nodes, and one
+  // vehicle of each cost class.
+  std::vector<int> vehicle_of_index(num_nodes_, -1);
+  std::vector<int> cost_class_vehicles;
+  std::vector<bool> cost_class_seen(model->GetCostClassesCount(), false);
+  for (int vehicle = 0; vehicle < model->vehicles(); ++vehicle) {
+    vehicle_of_index[model->Start(vehicle)] = vehicle;
+    vehicle_of_index[model->End(vehicle)] = vehicle;
+    const int cost_class = model->GetCostClassIndexOfVehicle(vehicle).value();
+    if (!cost_class_seen[cost_class]) {
+      cost_class_seen[cost_class] = true;
+      cost_class_vehicles.push_back(vehicle);
+    }
+  }
+  for (int tail = 0; tail < size; ++tail) {
     std::unique_ptr<IntVarIterator> iterator(
-        nexts_[tail]->MakeDomainIterator(false));
+        model->NextVar(tail)->MakeDomainIterator(false));
     for (const int64 head : InitAndGetValues(iterator.get())) {
-      // Given there are no disjunction constraints, a node cannot point to
-      // itself. Doing this explicitely given that outside the search,
-      // propagation hasn't removed this value from next variables yet.
+      // Outside the search, propagation hasn't removed the node itself from
+      // the next variables yet: the arc to itself is only added for the nodes
+      // that can be unperformed.
       if (head == tail) {
+        const int64 penalty = UnperformedCost(model, tail);
+        if (penalty >= 0) {
+          AddArc(tail, num_nodes_ + head, penalty);
+        }
         continue;
       }
+      const int vehicle = vehicle_of_index[tail] >= 0 ? vehicle_of_index[tail]
+                                                      : vehicle_of_index[head];
+      int64 cost = kint64max;
+      if (vehicle >= 0) {
+        cost = model->GetArcCostForVehicle(tail, head, vehicle);
+      } else {
+        for (const int class_vehicle : cost_class_vehicles) {
+          cost = std::min(
+              cost, model->GetArcCostForVehicle(tail, head, class_vehicle));
+        }
+      }
       // The index of a right node in the bipartite graph is the index
       // of the successor offset by the number of nodes.
-      const ArcIndex arc = graph.AddArc(tail, num_nodes + head);
-      const CostValue cost = GetHomogeneousCost(tail, head);
-      linear_sum_assignment.SetArcCost(arc, cost);
+      AddArc(tail, num_nodes_ + head, cost);
     }
   }
   // The linear assignment library requires having as many left and right nodes.
   // Therefore we are creating fake assignments for end nodes, forced to point
   // to the equivalent start node with a cost of 0.
-  for (int tail = Size(); tail < num_nodes; ++tail) {
-    const ArcIndex arc = graph.AddArc(tail, num_nodes + starts_[tail - Size()]);
-    linear_sum_assignment.SetArcCost(arc, 0);
+  for (int tail = size; tail < num_nodes_; ++tail) {
+    AddArc(tail, num_nodes_ + model->Start(tail - size), 0);
+  }
+}
+
+int64 AssignmentRelaxation::Solve() const {
+  ForwardStarGraph graph(2 * num_nodes_, tails_.size());
+  LinearSumAssignment<ForwardStarGraph> linear_sum_assignment(graph,
+                                                              num_nodes_);
+  // Left nodes in the bipartite are indexed from 0 to num_nodes - 1; right
+  // nodes are indexed from num_nodes to 2 * num_nodes - 1.
+  for (int i = 0; i < tails_.size(); ++i) {
+    const ArcIndex arc = graph.AddArc(tails_[i], heads_[i]);
+    linear_sum_assignment.SetArcCost(arc, costs_[i]);
   }
   if (linear_sum_assignment.ComputeAssignment()) {
     return linear_sum_assignment.GetCost();
@@ -2800,6 +3294,60 @@ int64 RoutingModel::ComputeLowerBound() {
   return 0;
 }
 
+// Solves the assignment relaxation in a separate thread, started when the
+// search is entered, and logs the optimality gap of the solutions found once
+// the lower bound is known.
+class LowerBoundGapMonitor : public SearchMonitor {
+ public:
+  LowerBoundGapMonitor(Solver* const solver, RoutingModel* const model)
+      : SearchMonitor(solver),
+        model_(model),
+        has_lower_bound_(false),
+        lower_bound_(0) {}
+  ~LowerBoundGapMonitor() override {
+    if (thread_.joinable()) thread_.join();
+  }
+  void EnterSearch() override {
+    // The relaxation does not depend on the search: it is solved once.
+    if (relaxation_ != nullptr) return;
+    relaxation_.reset(new AssignmentRelaxation(model_));
+    thread_ = std::thread([this]() {
+      lower_bound_ = relaxation_->Solve();
+      has_lower_bound_ = true;
+    });
+  }
+  bool AtSolution() override {
+    const int64 cost = model_->CostVar()->Min();
+    if (!has_lower_bound_) {
+      LOG(INFO) << "Solution cost " << cost << ", lower bound pending";
+      return false;
+    }
+    const int64 lower_bound = lower_bound_;
+    const double gap = static_cast<double>(cost - lower_bound) /
+                       std::max<int64>(1, std::abs(cost));
+    LOG(INFO) << "Solution cost " << cost << ", lower bound " << lower_bound
+              << ", gap " << 100 * gap << "%";
+    return false;
+  }
+  std::string DebugString() const override { return "LowerBoundGapMonitor"; }
+
+ private:
+  RoutingModel* const model_;
+  std::unique_ptr<AssignmentRelaxation> relaxation_;
+  std::thread thread_;
+  std::atomic<bool> has_lower_bound_;
+  std::atomic<int64> lower_bound_;
+};
+}  // namespace
+
+int64 RoutingModel::ComputeLowerBound() {
+  if (!closed_) {
+    LOG(WARNING) << "Non-closed model not supported.";
+    return 0;
+  }
+  return AssignmentRelaxation(this).Solve();
+}
+
 bool RoutingModel::RouteCanBeUsedByVehicle(const Assignment& assignment,
                                            int start_index, int vehicle) const {
   int current_index =
@@ -3001,6 +3549,28 @@ bool RoutingModel::ApplyLocksToAllVehicles(
   return RoutesToAssignment(locks, true, close_routes, preassignment_);
 }
 
+bool RoutingModel::ApplyInactiveNodes(const std::vector<NodeIndex>& nodes) {
+  if (!closed_) {
+    LOG(ERROR) << "The model is not closed yet";
+    return false;
+  }
+  for (const NodeIndex node : nodes) {
+    const int64 index = HasIndex(node) ? NodeToIndex(node) : -1;
+    if (index < 0 || IsStart(index) || ActiveVar(index)->Min() == 1) {
+      LOG(ERROR) << "Node " << node << " cannot be inactive";
+      return false;
+    }
+    IntVar* const next_var = NextVar(index);
+    if (preassignment_->Contains(next_var)) {
+      LOG(ERROR) << "Node " << node << " is already locked";
+      return false;
+    }
+    preassignment_->Add(next_var);
+    preassignment_->SetValue(next_var, index);
+  }
+  return true;
+}
+
 void RoutingModel::UpdateTimeLimit(int64 limit_ms) {
   time_limit_ms_ = limit_ms;
   if (limit_ != nullptr) {
@@ -3116,6 +3686,10 @@ bool RoutingModel::ParseRoutingMetaheuristic(
 bool RoutingModel::WriteAssignment(const std::string& file_name) const {
   if (collect_assignments_->solution_count() == 1 && assignment_ != nullptr) {
     assignment_->Copy(collect_assignments_->solution(0));
+    if (FLAGS_routing_assignment_chunk_size > 0) {
+      return assignment_->SaveInChunks(file_name,
+                                       FLAGS_routing_assignment_chunk_size);
+    }
     return assignment_->Save(file_name);
   } else {
     return false;
@@ -3351,12 +3925,12 @@ int64 RoutingModel::GetArcCostForClassInternal(
   const CostClass& cost_class = cost_classes_[cost_class_index];
   if (!IsStart(i)) {
     // TODO(user): fix overflows.
-    cost = cost_class.arc_cost_evaluator->Run(node_i, node_j) +
+    cost = GetArcCostFromClassEvaluator(node_i, node_j, cost_class) +
            GetDimensionTransitCostSum(i, j, cost_class);
   } else if (!IsEnd(j)) {
     // Apply route fixed cost on first non-first/last node, in other words on
     // the arc from the first node to its next node if it's not the last node.
-    cost = cost_class.arc_cost_evaluator->Run(node_i, node_j) +
+    cost = GetArcCostFromClassEvaluator(node_i, node_j, cost_class) +
            GetDimensionTransitCostSum(i, j, cost_class) +
            fixed_cost_of_vehicle_[index_to_vehicle_[i]];
   } else {
@@ -3419,6 +3993,10 @@ int64 RoutingModel::GetArcCostForFirstSolution(int64 i, int64 j) {
   // Return high cost if connecting to an end (or bound-to-end) node;
   // this is used in the cost-based first solution strategies to avoid closing
   // routes too soon.
+  if (is_bound_to_end_.empty()) {
+    // Lean model without is-bound-to-end variables.
+    return GetHomogeneousCost(i, j);
+  }
   if (!is_bound_to_end_ct_added_.Switched()) {
     // Lazily adding path-cumul constraint propagating connection to route end,
     // as it can be pretty costly in the general case.
@@ -3724,6 +4302,14 @@ void RoutingModel::CreateNeighborhoodOperators() {
       solver_.get(), nexts_,
       CostsAreHomogeneousAcrossVehicles() ? empty : vehicle_vars_,
       vehicle_start_class_callback_.get(), pickup_delivery_pairs_);
+  local_search_operators_[ROUTING_PAIR_EXCHANGE] = MakePairExchange(
+      solver_.get(), nexts_,
+      CostsAreHomogeneousAcrossVehicles() ? empty : vehicle_vars_,
+      vehicle_start_class_callback_.get(), pickup_delivery_pairs_);
+  local_search_operators_[ROUTING_PAIR_TWO_OPT] = MakePairTwoOpt(
+      solver_.get(), nexts_,
+      CostsAreHomogeneousAcrossVehicles() ? empty : vehicle_vars_,
+      vehicle_start_class_callback_.get(), pickup_delivery_pairs_);
   local_search_operators_[ROUTING_RELOCATE_NEIGHBORS] = MakeRelocateNeighbors(
       solver_.get(), nexts_,
       CostsAreHomogeneousAcrossVehicles() ? empty : vehicle_vars_,
@@ -3746,6 +4332,74 @@ void RoutingModel::CreateNeighborhoodOperators() {
   CP_ROUTING_ADD_OPERATOR(ROUTING_PATH_LNS, Solver::PATHLNS);
   CP_ROUTING_ADD_OPERATOR(ROUTING_FULL_PATH_LNS, Solver::FULLPATHLNS);
   CP_ROUTING_ADD_OPERATOR(ROUTING_INACTIVE_LNS, Solver::UNACTIVELNS);
+  if (FLAGS_routing_neighbors_per_node > 0) {
+    ComputeNearestNeighbors(FLAGS_routing_neighbors_per_node);
+    std::function<bool(int64, int64)> are_neighbors = [this](int64 a,
+                                                             int64 b) {
+      return AreNeighbors(a, b);
+    };
+    for (const RoutingLocalSearchOperator op :
+         {ROUTING_RELOCATE, ROUTING_EXCHANGE, ROUTING_CROSS, ROUTING_TWO_OPT,
+          ROUTING_PAIR_TWO_OPT}) {
+      static_cast<PathOperator*>(local_search_operators_[op])
+          ->SetNeighborRestriction(are_neighbors);
+    }
+    // The pair version of MakeActive is not restricted: both nodes of a pair
+    // are inserted at once.
+    if (pickup_delivery_pairs_.empty()) {
+      static_cast<PathOperator*>(local_search_operators_[ROUTING_MAKE_ACTIVE])
+          ->SetNeighborRestriction(are_neighbors);
+    }
+  }
+}
+
+void RoutingModel::ComputeNearestNeighbors(int64 num_neighbors) {
+  // Neighbors are computed on the union of the cost classes used by vehicles,
+  // the cost of an arc being its minimal cost over these classes.
+  std::vector<int64> cost_classes;
+  for (int vehicle = 0; vehicle < vehicles_; ++vehicle) {
+    cost_classes.push_back(GetCostClassIndexOfVehicle(vehicle).value());
+  }
+  std::sort(cost_classes.begin(), cost_classes.end());
+  cost_classes.erase(std::unique(cost_classes.begin(), cost_classes.end()),
+                     cost_classes.end());
+  const int size = Size();
+  const int64 num_kept = std::min<int64>(num_neighbors, size - 1);
+  neighbors_.assign(size, std::vector<int64>());
+  std::vector<std::pair<int64, int64>> costed_nodes;
+  for (int node = 0; node < size; ++node) {
+    if (IsStart(node) || num_kept <= 0) continue;
+    costed_nodes.clear();
+    for (int next = 0; next < size; ++next) {
+      if (next == node || IsStart(next)) continue;
+      int64 cost = kint64max;
+      for (const int64 cost_class : cost_classes) {
+        cost = std::min(cost, GetArcCostForClass(node, next, cost_class));
+        cost = std::min(cost, GetArcCostForClass(next, node, cost_class));
+      }
+      costed_nodes.push_back(std::make_pair(cost, next));
+    }
+    const int64 kept = std::min<int64>(num_kept, costed_nodes.size());
+    std::nth_element(costed_nodes.begin(), costed_nodes.begin() + kept,
+                     costed_nodes.end());
+    std::vector<int64>& node_neighbors = neighbors_[node];
+    for (int i = 0; i < kept; ++i) {
+      node_neighbors.push_back(costed_nodes[i].second);
+    }
+    std::sort(node_neighbors.begin(), node_neighbors.end());
+  }
+}
+
+bool RoutingModel::AreNeighbors(int64 node1, int64 node2) const {
+  // Vehicle start and end nodes are close to every node.
+  if (node1 >= Size() || node2 >= Size() || IsStart(node1) ||
+      IsStart(node2)) {
+    return true;
+  }
+  const std::vector<int64>& neighbors1 = neighbors_[node1];
+  const std::vector<int64>& neighbors2 = neighbors_[node2];
+  return std::binary_search(neighbors1.begin(), neighbors1.end(), node2) ||
+         std::binary_search(neighbors2.begin(), neighbors2.end(), node1);
 }
 
 #undef CP_ROUTING_ADD_CALLBACK_OPERATOR
@@ -3755,6 +4409,9 @@ LocalSearchOperator* RoutingModel::GetNeighborhoodOperators() const {
   std::vector<LocalSearchOperator*> operators = extra_operators_;
   if (pickup_delivery_pairs_.size() > 0) {
     operators.push_back(local_search_operators_[ROUTING_PAIR_RELOCATE]);
+    if (!FLAGS_routing_no_exchange) {
+      operators.push_back(local_search_operators_[ROUTING_PAIR_EXCHANGE]);
+    }
   }
   if (vehicles_ > 1) {
     if (!FLAGS_routing_no_relocate) {
@@ -3776,7 +4433,11 @@ LocalSearchOperator* RoutingModel::GetNeighborhoodOperators() const {
     operators.push_back(local_search_operators_[ROUTING_LKH]);
   }
   if (!FLAGS_routing_no_2opt) {
-    operators.push_back(local_search_operators_[ROUTING_TWO_OPT]);
+    // Reversing a chain containing a pair always violates its precedence.
+    operators.push_back(
+        local_search_operators_[pickup_delivery_pairs_.empty()
+                                    ? ROUTING_TWO_OPT
+                                    : ROUTING_PAIR_TWO_OPT]);
   }
   if (!FLAGS_routing_no_oropt) {
     operators.push_back(local_search_operators_[ROUTING_OR_OPT]);
@@ -3818,6 +4479,10 @@ LocalSearchOperator* RoutingModel::GetNeighborhoodOperators() const {
       operators.push_back(local_search_operators_[ROUTING_INACTIVE_LNS]);
     }
   }
+  if (FLAGS_routing_adaptive_operator_selection) {
+    return solver_->AdaptiveConcatenateOperators(
+        operators, FLAGS_routing_operator_selection_seed);
+  }
   return solver_->ConcatenateOperators(operators);
 }
 
@@ -3879,11 +4544,7 @@ RoutingModel::GetOrCreateLocalSearchFilters() {
         };
       }
       if (CostsAreHomogeneousAcrossVehicles()) {
-        LocalSearchFilter* filter = solver_->MakeLocalSearchObjectiveFilter(
-            nexts_, [this](int64 i, int64 j) {
-              return GetHomogeneousCost(i, j);
-            }, objective_callback, cost_, Solver::LE, Solver::SUM);
-        filters_.push_back(filter);
+        filters_.push_back(MakePathArcCostFilter(this, objective_callback));
       } else {
         LocalSearchFilter* filter = solver_->MakeLocalSearchObjectiveFilter(
             nexts_, vehicle_vars_, [this](int64 i, int64 j, int64 k) {
@@ -4083,7 +4744,7 @@ void RoutingModel::CreateFirstSolutionDecisionBuilders() {
     first_solution_filtered_decision_builders_[ROUTING_SAVINGS] =
         solver_->RevAlloc(new SavingsFilteredDecisionBuilder(
             this, FLAGS_savings_filter_neighbors,
-            GetOrCreateFeasibilityFilters()));
+            GetOrCreateFeasibilityFilters(), FLAGS_savings_num_threads));
     first_solution_decision_builders_[ROUTING_SAVINGS] = solver_->Try(
         first_solution_filtered_decision_builders_[ROUTING_SAVINGS],
         solver_->RevAlloc(new SavingsBuilder(this, true)));
@@ -4243,6 +4904,10 @@ void RoutingModel::SetupTrace() {
     SearchMonitor* trace = solver_->MakeSearchTrace("Routing ");
     monitors_.push_back(trace);
   }
+  if (FLAGS_routing_log_lower_bound_gap) {
+    monitors_.push_back(
+        solver_->RevAlloc(new LowerBoundGapMonitor(solver_.get(), this)));
+  }
 }
 
 void RoutingModel::SetupSearchMonitors() {
@@ -4283,10 +4948,17 @@ void RoutingModel::AddIntervalToAssignment(IntervalVar* const interval) {
 RoutingModel::NodeEvaluator2* RoutingModel::NewCachedCallback(
     NodeEvaluator2* callback) {
   const int size = node_to_index_.size();
-  if (FLAGS_routing_cache_callbacks && size <= FLAGS_routing_max_cache_size) {
+  const bool use_dense_cache = size <= FLAGS_routing_max_cache_size;
+  if (FLAGS_routing_cache_callbacks &&
+      (use_dense_cache || FLAGS_routing_sparse_cache_entries > 0)) {
     NodeEvaluator2* cached_evaluator = nullptr;
     if (!FindCopy(cached_node_callbacks_, callback, &cached_evaluator)) {
-      cached_evaluator = new RoutingCache(callback, size);
+      if (use_dense_cache) {
+        cached_evaluator = new RoutingCache(callback, size);
+      } else {
+        cached_evaluator =
+            new RoutingSparseCache(callback, FLAGS_routing_sparse_cache_entries);
+      }
       cached_node_callbacks_[callback] = cached_evaluator;
       // Make sure that both the cache and the base callback get deleted
       // properly.
@@ -4438,8 +5110,168 @@ IntVar* RoutingModel::SlackVar(int64 index, const std::string& name) const {
 }
 // END(DEPRECATED)
 
+// TimeDependentTransit
+
+TimeDependentTransit::TimeDependentTransit(std::vector<int64> departures,
+                                           std::vector<int64> transits)
+    : departures_(std::move(departures)), transits_(std::move(transits)) {
+  CHECK(!departures_.empty());
+  CHECK_EQ(departures_.size(), transits_.size());
+  for (int i = 1; i < departures_.size(); ++i) {
+    CHECK_LT(departures_[i - 1], departures_[i]);
+  }
+}
+
+TimeDependentTransit TimeDependentTransit::FromPiecewiseLinearFunction(
+    const PiecewiseLinearFunction& function) {
+  // Infinite end points are dropped, the function being extended by
+  // constants; at a discontinuity, the value of the left segment is kept.
+  std::vector<int64> departures;
+  std::vector<int64> transits;
+  for (const PiecewiseSegment& segment : function.segments()) {
+    for (const int64 x : {segment.start_x(), segment.end_x()}) {
+      if (x == kint64min || x == kint64max) continue;
+      if (!departures.empty() && x <= departures.back()) continue;
+      departures.push_back(x);
+      transits.push_back(segment.Value(x));
+    }
+  }
+  CHECK(!departures.empty());
+  return TimeDependentTransit(std::move(departures), std::move(transits));
+}
+
+bool TimeDependentTransit::IsFifo() const {
+  // The function is linear between breakpoints, so the arrival time is
+  // non-decreasing if it is non-decreasing on breakpoints.
+  for (int i = 1; i < departures_.size(); ++i) {
+    if (CapAdd(departures_[i - 1], transits_[i - 1]) >
+        CapAdd(departures_[i], transits_[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int TimeDependentTransit::Breakpoint(int64 departure) const {
+  return std::upper_bound(departures_.begin(), departures_.end(), departure) -
+         departures_.begin() - 1;
+}
+
+int64 TimeDependentTransit::Value(int64 departure) const {
+  const int breakpoint = Breakpoint(departure);
+  if (breakpoint < 0) return transits_.front();
+  if (breakpoint == departures_.size() - 1) return transits_.back();
+  const int64 start = departures_[breakpoint];
+  const int64 start_transit = transits_[breakpoint];
+  return CapAdd(start_transit,
+                CapProd(transits_[breakpoint + 1] - start_transit,
+                        departure - start) /
+                    (departures_[breakpoint + 1] - start));
+}
+
+int64 TimeDependentTransit::Arrival(int64 departure) const {
+  return CapAdd(departure, Value(departure));
+}
+
+int64 TimeDependentTransit::LatestDeparture(int64 arrival) const {
+  const int size = departures_.size();
+  if (Arrival(departures_[0]) > arrival) {
+    return CapSub(arrival, transits_[0]);
+  }
+  // Last breakpoint arriving at or before 'arrival'.
+  int low = 0;
+  int high = size - 1;
+  while (low < high) {
+    const int middle = (low + high + 1) / 2;
+    if (Arrival(departures_[middle]) <= arrival) {
+      low = middle;
+    } else {
+      high = middle - 1;
+    }
+  }
+  if (low == size - 1) {
+    return std::max(departures_[low], CapSub(arrival, transits_[low]));
+  }
+  int64 latest = departures_[low];
+  int64 last = departures_[low + 1] - 1;
+  while (latest < last) {
+    const int64 middle = latest + (last - latest + 1) / 2;
+    if (Arrival(middle) <= arrival) {
+      latest = middle;
+    } else {
+      last = middle - 1;
+    }
+  }
+  return latest;
+}
+
+int64 TimeDependentTransit::EarliestDeparture(int64 arrival) const {
+  const int size = departures_.size();
+  if (Arrival(departures_[size - 1]) < arrival) {
+    return CapSub(arrival, transits_[size - 1]);
+  }
+  // First breakpoint arriving at or after 'arrival'.
+  int low = 0;
+  int high = size - 1;
+  while (low < high) {
+    const int middle = (low + high) / 2;
+    if (Arrival(departures_[middle]) >= arrival) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+  if (low == 0) {
+    return std::min(departures_[0], CapSub(arrival, transits_[0]));
+  }
+  int64 first = departures_[low - 1] + 1;
+  int64 earliest = departures_[low];
+  while (first < earliest) {
+    const int64 middle = first + (earliest - first) / 2;
+    if (Arrival(middle) >= arrival) {
+      earliest = middle;
+    } else {
+      first = middle + 1;
+    }
+  }
+  return earliest;
+}
+
+int64 TimeDependentTransit::Min(int64 departure_min,
+                                int64 departure_max) const {
+  int64 result = std::min(Value(departure_min), Value(departure_max));
+  for (int i = Breakpoint(departure_min) + 1;
+       i < departures_.size() && departures_[i] < departure_max; ++i) {
+    result = std::min(result, transits_[i]);
+  }
+  return result;
+}
+
+int64 TimeDependentTransit::Max(int64 departure_min,
+                                int64 departure_max) const {
+  int64 result = std::max(Value(departure_min), Value(departure_max));
+  for (int i = Breakpoint(departure_min) + 1;
+       i < departures_.size() && departures_[i] < departure_max; ++i) {
+    result = std::max(result, transits_[i]);
+  }
+  return result;
+}
+
+int64 TimeDependentTransit::Min() const {
+  return *std::min_element(transits_.begin(), transits_.end());
+}
+
+int64 TimeDependentTransit::Max() const {
+  return *std::max_element(transits_.begin(), transits_.end());
+}
+
 RoutingDimension::RoutingDimension(RoutingModel* model, const std::string& name)
-    : global_span_cost_coefficient_(0), model_(model), name_(name) {
+    : transit_matrix_row_stride_(0),
+      transit_matrix_column_stride_(0),
+      transit_profile_evaluator_(nullptr),
+      global_span_cost_coefficient_(0),
+      model_(model),
+      name_(name) {
   CHECK(model != nullptr);
   vehicle_span_upper_bounds_.assign(model->vehicles(), kint64max);
   vehicle_span_cost_coefficients_.assign(model->vehicles(), 0);
@@ -4538,7 +5370,9 @@ void RoutingDimension::InitializeCumuls(
     RoutingModel::VehicleEvaluator* vehicle_capacity, int64 capacity) {
   Solver* const solver = model_->solver();
   const int size = model_->Size() + model_->vehicles();
-  solver->MakeIntVarArray(size, 0LL, capacity, name_, &cumuls_);
+  solver->MakeIntVarArray(size, 0LL, capacity,
+                          FLAGS_routing_lean_model ? std::string() : name_,
+                          &cumuls_);
   if (vehicle_capacity != nullptr) {
     for (int i = 0; i < size; ++i) {
       IntVar* capacity_var = nullptr;
@@ -4571,6 +5405,37 @@ void RoutingDimension::InitializeCumuls(
   capacity_evaluator_.reset(vehicle_capacity);
 }
 
+void RoutingModel::BatchNodeEvaluator2::RunBatch(const NodeIndex* from,
+                                                 const NodeIndex* to,
+                                                 int64* out, int n) {
+  for (int i = 0; i < n; ++i) {
+    out[i] = Run(from[i], to[i]);
+  }
+}
+
+void RoutingModel::BatchTransitEvaluator2::RunBatch(const int64* from,
+                                                    const int64* to,
+                                                    int64* out, int n) {
+  for (int i = 0; i < n; ++i) {
+    out[i] = Run(from[i], to[i]);
+  }
+}
+
+void RoutingModel::RunTransitBatch(TransitEvaluator2* evaluator,
+                                   const int64* from, const int64* to,
+                                   int64* out, int n) {
+  DCHECK(evaluator != nullptr);
+  BatchTransitEvaluator2* const batch_evaluator =
+      dynamic_cast<BatchTransitEvaluator2*>(evaluator);
+  if (batch_evaluator != nullptr) {
+    batch_evaluator->RunBatch(from, to, out, n);
+  } else {
+    for (int i = 0; i < n; ++i) {
+      out[i] = evaluator->Run(from[i], to[i]);
+    }
+  }
+}
+
 namespace {
 int64 WrappedEvaluator(RoutingModel* model,
                        RoutingModel::NodeEvaluator2* evaluator, int64 from,
@@ -4579,10 +5444,130 @@ int64 WrappedEvaluator(RoutingModel* model,
   return evaluator->Run(model->IndexToNode(from), model->IndexToNode(to));
 }
 
+// Transit evaluator on var indices wrapping a node evaluator; batches of arcs
+// are forwarded to the node evaluator if it is a batch evaluator.
+class WrappedBatchEvaluator : public RoutingModel::BatchTransitEvaluator2 {
+ public:
+  WrappedBatchEvaluator(RoutingModel* model,
+                        RoutingModel::NodeEvaluator2* evaluator)
+      : model_(model),
+        evaluator_(evaluator),
+        batch_evaluator_(
+            dynamic_cast<RoutingModel::BatchNodeEvaluator2*>(evaluator)) {}
+  ~WrappedBatchEvaluator() override {}
+  bool IsRepeatable() const override { return true; }
+  int64 Run(int64 from, int64 to) override {
+    return WrappedEvaluator(model_, evaluator_, from, to);
+  }
+  void RunBatch(const int64* from, const int64* to, int64* out,
+                int n) override {
+    if (batch_evaluator_ == nullptr) {
+      RoutingModel::BatchTransitEvaluator2::RunBatch(from, to, out, n);
+      return;
+    }
+    from_nodes_.resize(n);
+    to_nodes_.resize(n);
+    for (int i = 0; i < n; ++i) {
+      from_nodes_[i] = model_->IndexToNode(from[i]);
+      to_nodes_[i] = model_->IndexToNode(to[i]);
+    }
+    batch_evaluator_->RunBatch(from_nodes_.data(), to_nodes_.data(), out, n);
+  }
+
+ private:
+  RoutingModel* const model_;
+  RoutingModel::NodeEvaluator2* const evaluator_;
+  RoutingModel::BatchNodeEvaluator2* const batch_evaluator_;
+  std::vector<RoutingModel::NodeIndex> from_nodes_;
+  std::vector<RoutingModel::NodeIndex> to_nodes_;
+
+  DISALLOW_COPY_AND_ASSIGN(WrappedBatchEvaluator);
+};
+
 template <int64 value>
 int64 IthElementOrValue(const std::vector<int64>& v, int64 index) {
   return index >= 0 ? v[index] : value;
 }
+
+// Links the cumul variables of a time-dependent dimension through the
+// time-dependent transits: for each arc i -> j = next(i),
+//   transit(i) = f(cumul(i)) and cumul(j) = f(cumul(i)) + cumul(i) + slack(i)
+// where f is the transit function of the arc (the sum itself is posted as a
+// path cumul constraint). Bounds are propagated both ways on arrival times
+// and, the functions being FIFO, on departure times using inverse lookups.
+class TimeDependentTransitConstraint : public Constraint {
+ public:
+  TimeDependentTransitConstraint(Solver* const solver,
+                                 const RoutingModel& model,
+                                 const RoutingDimension& dimension,
+                                 const std::vector<IntVar*>& fixed_transits)
+      : Constraint(solver),
+        dimension_(dimension),
+        nexts_(model.Nexts()),
+        cumuls_(dimension.cumuls()),
+        slacks_(dimension.slacks()),
+        fixed_transits_(fixed_transits),
+        prevs_(dimension.cumuls().size(), -1) {}
+  ~TimeDependentTransitConstraint() override {}
+
+  void Post() override {
+    for (int i = 0; i < nexts_.size(); ++i) {
+      Demon* const demon = MakeConstraintDemon1(
+          solver(), this, &TimeDependentTransitConstraint::PropagateArc,
+          "PropagateArc", i);
+      nexts_[i]->WhenBound(demon);
+      cumuls_[i]->WhenRange(demon);
+      slacks_[i]->WhenRange(demon);
+    }
+    for (int i = 0; i < cumuls_.size(); ++i) {
+      cumuls_[i]->WhenRange(MakeConstraintDemon1(
+          solver(), this, &TimeDependentTransitConstraint::PropagateArcTo,
+          "PropagateArcTo", i));
+    }
+  }
+  void InitialPropagate() override {
+    for (int i = 0; i < nexts_.size(); ++i) {
+      PropagateArc(i);
+    }
+  }
+  std::string DebugString() const override {
+    return "TimeDependentTransitConstraint(" + dimension_.name() + ")";
+  }
+
+ private:
+  void PropagateArc(int i) {
+    if (!nexts_[i]->Bound()) return;
+    const int64 next = nexts_[i]->Min();
+    // Inactive node.
+    if (next == i) return;
+    if (prevs_[next] != i) prevs_.SetValue(solver(), next, i);
+    const TimeDependentTransit& profile =
+        dimension_.GetTransitProfile(i, next);
+    IntVar* const cumul = cumuls_[i];
+    IntVar* const next_cumul = cumuls_[next];
+    IntVar* const slack = slacks_[i];
+    fixed_transits_[i]->SetRange(profile.Min(cumul->Min(), cumul->Max()),
+                                 profile.Max(cumul->Min(), cumul->Max()));
+    next_cumul->SetRange(CapAdd(profile.Arrival(cumul->Min()), slack->Min()),
+                         CapAdd(profile.Arrival(cumul->Max()), slack->Max()));
+    cumul->SetRange(
+        profile.EarliestDeparture(CapSub(next_cumul->Min(), slack->Max())),
+        profile.LatestDeparture(CapSub(next_cumul->Max(), slack->Min())));
+  }
+  void PropagateArcTo(int j) {
+    const int prev = prevs_[j];
+    if (prev >= 0) PropagateArc(prev);
+  }
+
+  const RoutingDimension& dimension_;
+  const std::vector<IntVar*> nexts_;
+  const std::vector<IntVar*> cumuls_;
+  const std::vector<IntVar*> slacks_;
+  const std::vector<IntVar*> fixed_transits_;
+  // prevs_[j] is the node whose next was last bound to j in the current
+  // branch, or -1.
+  RevArray<int> prevs_;
+};
 }  // namespace
 
 void RoutingDimension::InitializeTransits(
@@ -4610,7 +5595,7 @@ void RoutingDimension::InitializeTransits(
       evaluator_class = class_evaluators_.size();
       evaluator_to_class[evaluator] = evaluator_class;
       class_evaluators_.emplace_back(
-          NewPermanentCallback(&WrappedEvaluator, model_, evaluator));
+          new WrappedBatchEvaluator(model_, evaluator));
     }
     vehicle_to_class_[i] = evaluator_class;
     transit_evaluators_.push_back(class_evaluators_[evaluator_class].get());
@@ -4620,6 +5605,14 @@ void RoutingDimension::InitializeTransits(
   };
 
   CHECK(!class_evaluators_.empty());
+  // Bounds of the transits of time-dependent dimensions.
+  int64 min_profile_transit = kint64max;
+  int64 max_profile_transit = kint64min;
+  for (const TimeDependentTransit& profile : transit_profiles_) {
+    min_profile_transit = std::min(min_profile_transit, profile.Min());
+    max_profile_transit = std::max(max_profile_transit, profile.Max());
+  }
+  std::vector<IntVar*> fixed_transits;
   for (int i = 0; i < size; ++i) {
     IntVar* fixed_transit = nullptr;
     Solver::IndexEvaluator2 transit_vehicle_evaluator = [this, i](
@@ -4627,7 +5620,10 @@ void RoutingDimension::InitializeTransits(
       return eval_index >= 0 ? transit_evaluators_[eval_index]->Run(i, to)
                              : 0LL;
     };
-    if (model_->UsesLightPropagation()) {
+    if (HasTimeDependentTransits()) {
+      fixed_transit =
+          solver->MakeIntVar(min_profile_transit, max_profile_transit);
+    } else if (model_->UsesLightPropagation()) {
       if (class_evaluators_.size() == 1) {
         fixed_transit = solver->MakeIntVar(kint64min, kint64max);
         RoutingModel::NodeEvaluator2* const transit_evaluator =
@@ -4665,19 +5661,76 @@ void RoutingDimension::InitializeTransits(
       transits_[i] = fixed_transit;
       slacks_[i] = solver->MakeIntConst(Zero());
     } else {
-      IntVar* const slack_var = solver->MakeIntVar(0, slack_max, "slack");
+      IntVar* const slack_var = FLAGS_routing_lean_model
+                                    ? solver->MakeIntVar(0, slack_max)
+                                    : solver->MakeIntVar(0, slack_max, "slack");
       transits_[i] = solver->MakeSum(slack_var, fixed_transit)->Var();
       slacks_[i] = slack_var;
     }
+    fixed_transits.push_back(fixed_transit);
   }
+  if (HasTimeDependentTransits()) {
+    solver->AddConstraint(solver->RevAlloc(new TimeDependentTransitConstraint(
+        solver, *model_, *this, fixed_transits)));
+  }
+}
+
+void RoutingDimension::InitializeTransitMatrix(const int64* node_transits,
+                                               int64 node_row_stride,
+                                               int64 node_column_stride) {
+  CHECK_EQ(1, class_evaluators_.size());
+  const int size = model_->Size();
+  // Transits which do not depend on the destination are stored as a vector.
+  const int num_columns =
+      node_column_stride == 0 ? 1 : size + model_->vehicles();
+  transit_matrix_row_stride_ = num_columns;
+  transit_matrix_column_stride_ = node_column_stride == 0 ? 0 : 1;
+  transit_matrix_.resize(static_cast<int64>(size) * num_columns);
+  for (int from = 0; from < size; ++from) {
+    const int64 row = model_->IndexToNode(from).value() * node_row_stride;
+    for (int to = 0; to < num_columns; ++to) {
+      transit_matrix_[static_cast<int64>(from) * num_columns + to] =
+          node_transits[row +
+                        model_->IndexToNode(to).value() * node_column_stride];
+    }
+  }
+  // The transit evaluators are not used by the model yet, they can be safely
+  // replaced by a direct read of the matrix.
+  class_evaluators_[0].reset(
+      NewPermanentCallback(this, &RoutingDimension::GetMatrixTransitValue));
+  transit_evaluators_.assign(transit_evaluators_.size(),
+                             class_evaluators_[0].get());
 }
 
 int64 RoutingDimension::GetTransitValue(int64 from_index, int64 to_index,
                                         int64 vehicle) const {
+  if (HasTransitMatrix()) {
+    return GetMatrixTransitValue(from_index, to_index);
+  }
   DCHECK(transit_evaluators_[vehicle] != nullptr);
   return transit_evaluators_[vehicle]->Run(from_index, to_index);
 }
 
+const TimeDependentTransit& RoutingDimension::GetTransitProfile(
+    int64 from_index, int64 to_index) const {
+  DCHECK(HasTimeDependentTransits());
+  return transit_profiles_[transit_profile_evaluator_->Run(
+      model_->IndexToNode(from_index), model_->IndexToNode(to_index))];
+}
+
+void RoutingDimension::GetTransitValues(const int64* from_indices,
+                                        const int64* to_indices, int64 vehicle,
+                                        int64* out, int n) const {
+  if (HasTransitMatrix()) {
+    for (int i = 0; i < n; ++i) {
+      out[i] = GetMatrixTransitValue(from_indices[i], to_indices[i]);
+    }
+    return;
+  }
+  RoutingModel::RunTransitBatch(transit_evaluators_[vehicle], from_indices,
+                                to_indices, out, n);
+}
+
 void RoutingDimension::SetSpanUpperBoundForVehicle(int64 upper_bound,
                                                    int vehicle) {
   CHECK_GE(vehicle, 0);
@@ -5067,4 +6120,465 @@ void RoutingDimension::SetupSlackCosts(std::vector<IntVar*>* cost_elements) cons
     }
   }
 }
+
+// ----- RoutingMultiStartSolver -----
+
+namespace {
+// Publishes the cost of each solution found by a worker to the multi-start
+// solver.
+class SharedBestCostMonitor : public SearchMonitor {
+ public:
+  SharedBestCostMonitor(Solver* const solver, IntVar* const cost,
+                        RoutingMultiStartSolver* const multi_start_solver)
+      : SearchMonitor(solver),
+        cost_(cost),
+        multi_start_solver_(multi_start_solver) {}
+  ~SharedBestCostMonitor() override {}
+  bool AtSolution() override {
+    multi_start_solver_->UpdateBestCost(cost_->Min());
+    return false;
+  }
+  std::string DebugString() const override { return "SharedBestCostMonitor"; }
+
+ private:
+  IntVar* const cost_;
+  RoutingMultiStartSolver* const multi_start_solver_;
+};
+}  // namespace
+
+RoutingMultiStartSolver::RoutingMultiStartSolver(
+    ModelBuilder model_builder,
+    const std::vector<RoutingSearchParameters>& parameters)
+    : model_builder_(std::move(model_builder)),
+      parameters_(parameters),
+      solutions_(parameters.size(), nullptr),
+      best_cost_(kint64max),
+      best_worker_(-1) {}
+
+RoutingMultiStartSolver::~RoutingMultiStartSolver() {}
+
+bool RoutingMultiStartSolver::Solve(int num_threads) {
+  CHECK_GT(num_threads, 0);
+  // Search parameters are global flags read when the search is set up, so the
+  // models are built and closed sequentially; only the searches are run in
+  // parallel.
+  models_.clear();
+  for (int worker = 0; worker < parameters_.size(); ++worker) {
+    RoutingModel* const model = model_builder_(worker);
+    CHECK(model != nullptr);
+    models_.emplace_back(model);
+    model->solver()->ReSeed(ACMRandom::DeterministicSeed() + worker);
+    model->SetSearchParameters(parameters_[worker]);
+    model->AddSearchMonitor(model->solver()->RevAlloc(
+        new SharedBestCostMonitor(model->solver(), model->CostVar(), this)));
+    model->CloseModel();
+  }
+  {
+    ThreadPool pool("RoutingMultiStart", num_threads);
+    for (int worker = 0; worker < parameters_.size(); ++worker) {
+      pool.Add(NewCallback(this, &RoutingMultiStartSolver::SolveWorker, worker));
+    }
+    pool.StartWorkers();
+  }
+  int64 best_cost = kint64max;
+  MutexLock lock(&mutex_);
+  best_worker_ = -1;
+  for (int worker = 0; worker < solutions_.size(); ++worker) {
+    if (solutions_[worker] != nullptr &&
+        solutions_[worker]->ObjectiveValue() < best_cost) {
+      best_cost = solutions_[worker]->ObjectiveValue();
+      best_worker_ = worker;
+    }
+  }
+  return best_worker_ >= 0;
+}
+
+void RoutingMultiStartSolver::SolveWorker(int worker) {
+  solutions_[worker] = models_[worker]->Solve();
+}
+
+bool RoutingMultiStartSolver::UpdateBestCost(int64 cost) {
+  int64 best_cost = best_cost_.load();
+  while (cost < best_cost) {
+    if (best_cost_.compare_exchange_weak(best_cost, cost)) return true;
+  }
+  return false;
+}
+
+RoutingModel* RoutingMultiStartSolver::best_model() const {
+  return best_worker_ >= 0 ? models_[best_worker_].get() : nullptr;
+}
+
+const Assignment* RoutingMultiStartSolver::best_solution() const {
+  return best_worker_ >= 0 ? solutions_[best_worker_] : nullptr;
+}
+
+RoutingParallelRouteLns::RoutingParallelRouteLns(
+    RoutingMultiStartSolver::ModelBuilder model_builder,
+    const RoutingSearchParameters& parameters)
+    : model_builder_(std::move(model_builder)), parameters_(parameters) {}
+
+RoutingParallelRouteLns::~RoutingParallelRouteLns() {}
+
+int64 RoutingParallelRouteLns::Improve(
+    int num_subsets, int num_iterations, int num_threads,
+    std::vector<std::vector<RoutingModel::NodeIndex>>* routes) {
+  CHECK_GT(num_subsets, 0);
+  CHECK_GT(num_threads, 0);
+  CHECK(routes != nullptr);
+  std::unique_ptr<RoutingModel> reference(model_builder_(-1));
+  CHECK(reference != nullptr);
+  reference->SetSearchParameters(parameters_);
+  reference->CloseModel();
+  const Assignment* const initial_solution =
+      reference->ReadAssignmentFromRoutes(*routes, false);
+  if (initial_solution == nullptr) {
+    return kint64max;
+  }
+  int64 cost = initial_solution->ObjectiveValue();
+  const int num_vehicles = reference->vehicles();
+  std::vector<int> vehicles(num_vehicles);
+  for (int vehicle = 0; vehicle < num_vehicles; ++vehicle) {
+    vehicles[vehicle] = vehicle;
+  }
+  std::vector<int> subset_of_vehicle(num_vehicles);
+  ACMRandom random(ACMRandom::DeterministicSeed());
+  for (int iteration = 0; iteration < num_iterations; ++iteration) {
+    // Partition vehicles and unperformed nodes among workers.
+    std::random_shuffle(vehicles.begin(), vehicles.end(), random);
+    for (int i = 0; i < num_vehicles; ++i) {
+      subset_of_vehicle[vehicles[i]] = i % num_subsets;
+    }
+    std::vector<bool> performed(reference->Size(), false);
+    for (const std::vector<RoutingModel::NodeIndex>& route : *routes) {
+      for (const RoutingModel::NodeIndex node : route) {
+        performed[reference->NodeToIndex(node)] = true;
+      }
+    }
+    std::vector<int64> unperformed;
+    for (int64 index = 0; index < reference->Size(); ++index) {
+      if (!performed[index] && !reference->IsStart(index)) {
+        unperformed.push_back(index);
+      }
+    }
+    const int first_unperformed_owner = random.Uniform(num_subsets);
+    // Search parameters are global flags read when models are closed, so the
+    // worker models are built and closed sequentially.
+    models_.clear();
+    start_assignments_.assign(num_subsets, nullptr);
+    solutions_.assign(num_subsets, nullptr);
+    for (int worker = 0; worker < num_subsets; ++worker) {
+      RoutingModel* const model = model_builder_(worker);
+      CHECK(model != nullptr);
+      models_.emplace_back(model);
+      model->solver()->ReSeed(ACMRandom::DeterministicSeed() + worker);
+      model->SetSearchParameters(parameters_);
+      model->CloseModel();
+      Solver* const solver = model->solver();
+      for (int vehicle = 0; vehicle < num_vehicles; ++vehicle) {
+        if (subset_of_vehicle[vehicle] == worker) continue;
+        int64 previous = model->Start(vehicle);
+        if (vehicle < routes->size()) {
+          for (const RoutingModel::NodeIndex node : (*routes)[vehicle]) {
+            const int64 index = model->NodeToIndex(node);
+            solver->AddConstraint(
+                solver->MakeEquality(model->NextVar(previous), index));
+            previous = index;
+          }
+        }
+        solver->AddConstraint(
+            solver->MakeEquality(model->NextVar(previous), model->End(vehicle)));
+      }
+      for (int i = 0; i < unperformed.size(); ++i) {
+        if ((first_unperformed_owner + i) % num_subsets != worker) {
+          solver->AddConstraint(
+              solver->MakeEquality(model->ActiveVar(unperformed[i]), Zero()));
+        }
+      }
+      Assignment* const start_assignment = solver->MakeAssignment();
+      CHECK(model->RoutesToAssignment(*routes, false, true, start_assignment));
+      start_assignments_[worker] = start_assignment;
+    }
+    {
+      ThreadPool pool("RoutingParallelRouteLns", num_threads);
+      for (int worker = 0; worker < num_subsets; ++worker) {
+        pool.Add(NewCallback(this, &RoutingParallelRouteLns::SolveWorker,
+                             worker));
+      }
+      pool.StartWorkers();
+    }
+    // Merge improving workers.
+    std::vector<std::vector<RoutingModel::NodeIndex>> merged_routes = *routes;
+    merged_routes.resize(num_vehicles);
+    std::vector<std::vector<RoutingModel::NodeIndex>> best_worker_routes;
+    int64 best_worker_cost = cost;
+    int num_improving_workers = 0;
+    for (int worker = 0; worker < num_subsets; ++worker) {
+      const Assignment* const solution = solutions_[worker];
+      if (solution == nullptr || solution->ObjectiveValue() >= cost) continue;
+      ++num_improving_workers;
+      std::vector<std::vector<RoutingModel::NodeIndex>> worker_routes;
+      models_[worker]->AssignmentToRoutes(*solution, &worker_routes);
+      for (int vehicle = 0; vehicle < num_vehicles; ++vehicle) {
+        if (subset_of_vehicle[vehicle] == worker) {
+          merged_routes[vehicle] = worker_routes[vehicle];
+        }
+      }
+      if (solution->ObjectiveValue() < best_worker_cost) {
+        best_worker_cost = solution->ObjectiveValue();
+        best_worker_routes.swap(worker_routes);
+      }
+    }
+    if (num_improving_workers == 0) continue;
+    if (num_improving_workers > 1) {
+      const Assignment* const merged_solution =
+          reference->ReadAssignmentFromRoutes(merged_routes, false);
+      if (merged_solution != nullptr &&
+          merged_solution->ObjectiveValue() <= best_worker_cost) {
+        cost = merged_solution->ObjectiveValue();
+        routes->swap(merged_routes);
+        continue;
+      }
+    }
+    cost = best_worker_cost;
+    routes->swap(best_worker_routes);
+  }
+  models_.clear();
+  return cost;
+}
+
+void RoutingParallelRouteLns::SolveWorker(int worker) {
+  solutions_[worker] = models_[worker]->Solve(start_assignments_[worker]);
+}
+
+RoutingClusterDecomposition::RoutingClusterDecomposition(
+    SubModelBuilder model_builder,
+    const RoutingSearchParameters& cluster_parameters,
+    const RoutingSearchParameters& global_parameters)
+    : model_builder_(std::move(model_builder)),
+      cluster_parameters_(cluster_parameters),
+      global_parameters_(global_parameters) {}
+
+RoutingClusterDecomposition::~RoutingClusterDecomposition() {}
+
+std::vector<std::vector<RoutingModel::NodeIndex>>
+RoutingClusterDecomposition::SweepClusters(
+    const ITIVector<RoutingModel::NodeIndex, std::pair<int64, int64>>& points,
+    RoutingModel::NodeIndex depot, int num_clusters) {
+  CHECK_GT(num_clusters, 0);
+  const std::pair<int64, int64>& center = points[depot];
+  std::vector<std::pair<double, RoutingModel::NodeIndex>> angles;
+  for (RoutingModel::NodeIndex node(0); node < points.size(); ++node) {
+    if (node == depot) continue;
+    const double angle = atan2(points[node].second - center.second,
+                               points[node].first - center.first);
+    angles.push_back(std::make_pair(angle, node));
+  }
+  std::sort(angles.begin(), angles.end());
+  std::vector<std::vector<RoutingModel::NodeIndex>> clusters(num_clusters);
+  for (int i = 0; i < angles.size(); ++i) {
+    clusters[static_cast<int64>(i) * num_clusters / angles.size()].push_back(
+        angles[i].second);
+  }
+  return clusters;
+}
+
+const Assignment* RoutingClusterDecomposition::Solve(
+    const std::vector<std::vector<RoutingModel::NodeIndex>>& clusters,
+    int num_threads) {
+  CHECK_GT(num_threads, 0);
+  model_.reset(nullptr);
+  std::unique_ptr<RoutingModel> model(model_builder_(
+      std::vector<RoutingModel::NodeIndex>(), std::vector<int>()));
+  CHECK(model != nullptr);
+  const int num_clusters = clusters.size();
+  const int num_vehicles = model->vehicles();
+  CHECK_LE(num_clusters, num_vehicles);
+  model->SetSearchParameters(global_parameters_);
+  model->CloseModel();
+
+  // Splits the vehicles among the clusters in proportion to their number of
+  // nodes, with at least one vehicle per cluster.
+  int64 num_clustered_nodes = 0;
+  for (const std::vector<RoutingModel::NodeIndex>& cluster : clusters) {
+    num_clustered_nodes += cluster.size();
+  }
+  std::vector<std::vector<int>> cluster_vehicles(num_clusters);
+  int vehicle = 0;
+  int64 cumulated_nodes = 0;
+  for (int cluster = 0; cluster < num_clusters; ++cluster) {
+    cumulated_nodes += clusters[cluster].size();
+    const int64 end_vehicle =
+        cluster == num_clusters - 1
+            ? num_vehicles
+            : std::max<int64>(
+                  vehicle + 1,
+                  std::min<int64>(
+                      num_vehicles - (num_clusters - cluster - 1),
+                      num_vehicles * cumulated_nodes /
+                          std::max<int64>(1, num_clustered_nodes)));
+    for (; vehicle < end_vehicle; ++vehicle) {
+      cluster_vehicles[cluster].push_back(vehicle);
+    }
+  }
+
+  // Search parameters are global flags read when models are closed, so the
+  // cluster models are built and closed sequentially.
+  cluster_models_.clear();
+  cluster_solutions_.assign(num_clusters, nullptr);
+  std::vector<std::vector<RoutingModel::NodeIndex>> cluster_nodes(
+      num_clusters);
+  for (int cluster = 0; cluster < num_clusters; ++cluster) {
+    // The start and end nodes of the vehicles of the cluster come first.
+    std::vector<RoutingModel::NodeIndex>& nodes = cluster_nodes[cluster];
+    for (const int vehicle : cluster_vehicles[cluster]) {
+      for (const int64 index : {model->Start(vehicle), model->End(vehicle)}) {
+        const RoutingModel::NodeIndex node = model->IndexToNode(index);
+        if (std::find(nodes.begin(), nodes.end(), node) == nodes.end()) {
+          nodes.push_back(node);
+        }
+      }
+    }
+    nodes.insert(nodes.end(), clusters[cluster].begin(),
+                 clusters[cluster].end());
+    RoutingModel* const cluster_model =
+        model_builder_(nodes, cluster_vehicles[cluster]);
+    CHECK(cluster_model != nullptr);
+    cluster_models_.emplace_back(cluster_model);
+    cluster_model->solver()->ReSeed(ACMRandom::DeterministicSeed() + cluster);
+    cluster_model->SetSearchParameters(cluster_parameters_);
+    cluster_model->CloseModel();
+  }
+  {
+    ThreadPool pool("RoutingClusterDecomposition", num_threads);
+    for (int cluster = 0; cluster < num_clusters; ++cluster) {
+      pool.Add(NewCallback(this, &RoutingClusterDecomposition::SolveCluster,
+                           cluster));
+    }
+    pool.StartWorkers();
+  }
+
+  // Merges the routes of the clusters, in the node and vehicle numbering of
+  // the full model.
+  std::vector<std::vector<RoutingModel::NodeIndex>> routes(num_vehicles);
+  for (int cluster = 0; cluster < num_clusters; ++cluster) {
+    const Assignment* const solution = cluster_solutions_[cluster];
+    if (solution == nullptr) {
+      LOG(WARNING) << "No solution found for cluster " << cluster;
+      continue;
+    }
+    std::vector<std::vector<RoutingModel::NodeIndex>> cluster_routes;
+    cluster_models_[cluster]->AssignmentToRoutes(*solution, &cluster_routes);
+    for (int v = 0; v < cluster_routes.size(); ++v) {
+      std::vector<RoutingModel::NodeIndex>& route =
+          routes[cluster_vehicles[cluster][v]];
+      for (const RoutingModel::NodeIndex node : cluster_routes[v]) {
+        route.push_back(cluster_nodes[cluster][node.value()]);
+      }
+    }
+  }
+  cluster_models_.clear();
+  cluster_solutions_.clear();
+
+  // Improves the merged routes on the full model; if they are not a feasible
+  // solution of the full model (e.g. a cluster failed, or constraints link
+  // the clusters), solves the full model from scratch.
+  const Assignment* const merged_solution =
+      model->ReadAssignmentFromRoutes(routes, false);
+  if (merged_solution == nullptr) {
+    LOG(WARNING) << "The merged cluster routes are not feasible.";
+  }
+  const Assignment* const solution = model->Solve(merged_solution);
+  model_.swap(model);
+  return solution;
+}
+
+void RoutingClusterDecomposition::SolveCluster(int cluster) {
+  cluster_solutions_[cluster] = cluster_models_[cluster]->Solve(nullptr);
+}
+
+RoutingDynamicPlanner::RoutingDynamicPlanner(
+    RoutingModel* model, const RoutingSearchParameters& parameters)
+    : model_(model),
+      removed_(model->nodes(), false),
+      prefixes_(model->vehicles()) {
+  model_->SetSearchParameters(parameters);
+  model_->CloseModel();
+}
+
+RoutingDynamicPlanner::~RoutingDynamicPlanner() {}
+
+void RoutingDynamicPlanner::AddNode(RoutingModel::NodeIndex node) {
+  removed_[node.value()] = false;
+}
+
+void RoutingDynamicPlanner::RemoveNode(RoutingModel::NodeIndex node) {
+  removed_[node.value()] = true;
+}
+
+bool RoutingDynamicPlanner::IsNodeRemoved(RoutingModel::NodeIndex node) const {
+  return removed_[node.value()];
+}
+
+void RoutingDynamicPlanner::SetVisitedPrefix(
+    int vehicle, const std::vector<RoutingModel::NodeIndex>& prefix) {
+  prefixes_[vehicle] = prefix;
+}
+
+std::vector<std::vector<RoutingModel::NodeIndex>>
+RoutingDynamicPlanner::StartRoutes() const {
+  std::vector<std::vector<RoutingModel::NodeIndex>> routes(prefixes_.size());
+  std::vector<bool> locked(removed_.size(), false);
+  for (int vehicle = 0; vehicle < prefixes_.size(); ++vehicle) {
+    for (const RoutingModel::NodeIndex node : prefixes_[vehicle]) {
+      if (removed_[node.value()]) continue;
+      routes[vehicle].push_back(node);
+      locked[node.value()] = true;
+    }
+  }
+  for (int vehicle = 0; vehicle < routes_.size(); ++vehicle) {
+    for (const RoutingModel::NodeIndex node : routes_[vehicle]) {
+      if (!removed_[node.value()] && !locked[node.value()]) {
+        routes[vehicle].push_back(node);
+      }
+    }
+  }
+  return routes;
+}
+
+const Assignment* RoutingDynamicPlanner::Replan() {
+  // The locks and removed nodes are restored at the root of each search (see
+  // RoutingModel::SetupDecisionBuilders()), so they can change between plans
+  // without rebuilding the model.
+  std::vector<std::vector<RoutingModel::NodeIndex>> locks(prefixes_.size());
+  for (int vehicle = 0; vehicle < prefixes_.size(); ++vehicle) {
+    for (const RoutingModel::NodeIndex node : prefixes_[vehicle]) {
+      if (!removed_[node.value()]) locks[vehicle].push_back(node);
+    }
+  }
+  std::vector<RoutingModel::NodeIndex> removed_nodes;
+  for (RoutingModel::NodeIndex node(0); node < removed_.size(); ++node) {
+    if (removed_[node.value()]) removed_nodes.push_back(node);
+  }
+  if (!model_->ApplyLocksToAllVehicles(locks, false) ||
+      !model_->ApplyInactiveNodes(removed_nodes)) {
+    return nullptr;
+  }
+  // The new nodes are not in the start routes, and are inserted by the local
+  // search; if the start routes are not feasible (e.g. a new node must be
+  // performed), the plan is built from scratch.
+  const Assignment* start = nullptr;
+  if (!routes_.empty()) {
+    start = model_->ReadAssignmentFromRoutes(StartRoutes(), true);
+    if (start == nullptr) {
+      LOG(WARNING) << "The previous routes are not feasible, planning from "
+                   << "scratch.";
+    }
+  }
+  const Assignment* const solution = model_->Solve(start);
+  if (solution != nullptr) {
+    model_->AssignmentToRoutes(*solution, &routes_);
+  }
+  return solution;
+}
 }  // namespace operations_research
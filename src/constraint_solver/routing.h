@@ -154,6 +154,8 @@
 #define OR_TOOLS_CONSTRAINT_SOLVER_ROUTING_H_
 
 #include <stddef.h>
+#include <atomic>
+#include <functional>
 #include "base/hash.h"
 #include "base/hash.h"
 #include <memory>
@@ -166,6 +168,7 @@
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/macros.h"
+#include "base/mutex.h"
 #include "base/int_type_indexed_vector.h"
 #include "base/int_type.h"
 #include "base/hash.h"
@@ -179,6 +182,7 @@ namespace operations_research {
 
 class IntVarFilteredDecisionBuilder;
 class LocalSearchOperator;
+class PiecewiseLinearFunction;
 class RoutingDimension;
 #ifndef SWIG
 class SweepArranger;
@@ -199,6 +203,8 @@ struct RoutingParameters {
     use_light_propagation = false;
     cache_callbacks = false;
     max_cache_size = 1000;
+    sparse_cache_entries = 1 << 20;
+    lean_model = false;
   }
 
   // Use constraints with light propagation in routing model.
@@ -207,6 +213,14 @@ struct RoutingParameters {
   bool cache_callbacks;
   // Maximum cache size when callback caching is on.
   int64 max_cache_size;
+  // Number of entries of the sparse cache used when callback caching is on and
+  // the model has more than max_cache_size nodes; 0 disables caching for such
+  // models.
+  int64 sparse_cache_entries;
+  // Reduce the memory used by the model: variables are not named and the
+  // variables tracking routes bound to their end are only created if the
+  // first solution strategy needs them.
+  bool lean_model;
 };
 
 // This class stores search parameters.
@@ -226,6 +240,7 @@ struct RoutingSearchParameters {
     no_tsplns = true;
     use_chain_make_inactive = false;
     use_extended_swap_active = false;
+    neighbors_per_node = 0;
     solution_limit = kint64max;
     time_limit = kint64max;
     lns_time_limit = 100;
@@ -270,6 +285,10 @@ struct RoutingSearchParameters {
   bool use_chain_make_inactive;
   // Routing: use extended version of SwapActive neighborhood.
   bool use_extended_swap_active;
+  // Routing: if positive, restricts Relocate, Exchange, Cross, 2Opt and
+  // MakeActive moves to nodes which are among the given number of nearest
+  // neighbors of each other (by arc cost).
+  int64 neighbors_per_node;
 
   // ----- Search limits -----
 
@@ -306,6 +325,57 @@ struct RoutingSearchParameters {
   bool trace;
 };
 
+// Time-dependent transit of an arc, as a function of the departure time from
+// the origin of the arc. The function is stored as a compact array of
+// breakpoints (departure, transit), sorted by departure time; it is linear
+// between two breakpoints and constant before the first and after the last
+// breakpoint. Time-dependent dimensions require the functions to be FIFO
+// (first in, first out): leaving later never makes arriving earlier, i.e. the
+// slope of the transit is at least -1. The arrival time is then a
+// non-decreasing function of the departure time, which can be inverted to
+// find the latest departure time for a given arrival time.
+class TimeDependentTransit {
+ public:
+  // 'departures' must be non-empty, strictly increasing and have the same size
+  // as 'transits'.
+  TimeDependentTransit(std::vector<int64> departures,
+                       std::vector<int64> transits);
+  // Builds the transit function from the end points of the segments of
+  // 'function'; holes in the domain of the function are filled by linear
+  // interpolation.
+  static TimeDependentTransit FromPiecewiseLinearFunction(
+      const PiecewiseLinearFunction& function);
+
+  // Returns true if the function satisfies the FIFO property.
+  bool IsFifo() const;
+  // Returns the transit when leaving at 'departure'.
+  int64 Value(int64 departure) const;
+  // Returns the arrival time when leaving at 'departure'.
+  int64 Arrival(int64 departure) const;
+  // Returns the latest departure time arriving at or before 'arrival'.
+  int64 LatestDeparture(int64 arrival) const;
+  // Returns the earliest departure time arriving at or after 'arrival'.
+  int64 EarliestDeparture(int64 arrival) const;
+  // Returns the minimum and maximum transits when leaving in
+  // [departure_min, departure_max].
+  int64 Min(int64 departure_min, int64 departure_max) const;
+  int64 Max(int64 departure_min, int64 departure_max) const;
+  // Returns the minimum and maximum transits over all departure times.
+  int64 Min() const;
+  int64 Max() const;
+
+  const std::vector<int64>& departures() const { return departures_; }
+  const std::vector<int64>& transits() const { return transits_; }
+
+ private:
+  // Returns the index of the last breakpoint whose departure is at most
+  // 'departure', or -1 if there is none.
+  int Breakpoint(int64 departure) const;
+
+  std::vector<int64> departures_;
+  std::vector<int64> transits_;
+};
+
 class RoutingModel {
  public:
   // First solution strategies, used as starting point of local search.
@@ -394,7 +464,10 @@ class RoutingModel {
     // Time limit reached before finding a solution with RoutingModel::Solve().
     ROUTING_FAIL_TIMEOUT,
     // Model, model parameters or flags are not valid.
-    ROUTING_INVALID
+    ROUTING_INVALID,
+    // The memory budget of base/memory_accounting.h was exceeded before
+    // finding a solution with RoutingModel::Solve().
+    ROUTING_FAIL_MEMORY_LIMIT
   };
 
   typedef _RoutingModel_NodeIndex NodeIndex;
@@ -409,6 +482,33 @@ class RoutingModel {
   typedef std::vector<NodePair> NodePairs;
 
 #if !defined(SWIG)
+  // Node evaluator which can evaluate several arcs at once, for instance to
+  // vectorize lookups or to amortize the cost of fetching arc values from a
+  // remote service. Dimensions created with such evaluators pass them batches
+  // of arcs when filtering routes.
+  class BatchNodeEvaluator2 : public NodeEvaluator2 {
+   public:
+    ~BatchNodeEvaluator2() override {}
+    // Sets out[i] to the value of arc from[i] -> to[i] for i in [0, n). The
+    // default implementation calls Run() on each arc.
+    virtual void RunBatch(const NodeIndex* from, const NodeIndex* to,
+                          int64* out, int n);
+  };
+  // Same as BatchNodeEvaluator2 on var indices.
+  class BatchTransitEvaluator2 : public TransitEvaluator2 {
+   public:
+    ~BatchTransitEvaluator2() override {}
+    // Sets out[i] to the value of arc from[i] -> to[i] for i in [0, n). The
+    // default implementation calls Run() on each arc.
+    virtual void RunBatch(const int64* from, const int64* to, int64* out,
+                          int n);
+  };
+  // Evaluates n arcs with 'evaluator': sets out[i] to the value of arc
+  // from[i] -> to[i]. Uses RunBatch() if 'evaluator' is a
+  // BatchTransitEvaluator2 and Run() on each arc otherwise.
+  static void RunTransitBatch(TransitEvaluator2* evaluator, const int64* from,
+                              const int64* to, int64* out, int n);
+
   struct CostClass {
     // arc_cost_evaluator->Run(from, to) is the transit cost of arc
     // from->to. This may never be nullptr.
@@ -437,8 +537,12 @@ class RoutingModel {
     std::vector<std::pair<TransitEvaluator2*, int64> >
         dimension_transit_evaluator_and_cost_coefficient;
 
+    // If not nullptr, the row-major matrix (indexed by NodeIndex) of the
+    // values returned by arc_cost_evaluator, read instead of running it.
+    const int64* arc_cost_matrix;
+
     explicit CostClass(NodeEvaluator2* arc_cost_evaluator)
-        : arc_cost_evaluator(arc_cost_evaluator) {
+        : arc_cost_evaluator(arc_cost_evaluator), arc_cost_matrix(nullptr) {
       CHECK(arc_cost_evaluator != nullptr);
     }
 
@@ -471,6 +575,8 @@ class RoutingModel {
     ITIVector<DimensionIndex, int64> dimension_end_cumuls_min;
     ITIVector<DimensionIndex, int64> dimension_end_cumuls_max;
     ITIVector<DimensionIndex, int64> dimension_capacities;
+    // Upper bounds of the span of the vehicle route for each dimension.
+    ITIVector<DimensionIndex, int64> dimension_span_upper_bounds;
     // dimension_evaluators[d]->Run(from, to) is the transit value of arc
     // from->to for a dimension d.
     ITIVector<DimensionIndex, TransitEvaluator2*> dimension_evaluators;
@@ -583,6 +689,18 @@ class RoutingModel {
   // (and doesn't create the new dimension).
   bool AddMatrixDimension(const int64* const* values, int64 capacity,
                           bool fix_start_cumul_to_zero, const std::string& name);
+  // Creates a dimension where the transit variable of node i is constrained
+  // to be equal to profiles[profile_evaluator(i, next(i))].Value(cumul(i)),
+  // i.e. the transit depends on the departure time from i. All the profiles
+  // must be FIFO. The transit evaluators of the dimension (used by first
+  // solution heuristics and costs) return the minimum transit of each arc.
+  // Returns false if a dimension with the same name has already been created
+  // (and doesn't create the new dimension).
+  // Takes ownership of the callback 'profile_evaluator'.
+  bool AddTimeDependentDimension(
+      NodeEvaluator2* profile_evaluator,
+      const std::vector<TimeDependentTransit>& profiles, int64 slack_max,
+      int64 capacity, bool fix_start_cumul_to_zero, const std::string& name);
   // Outputs the names of all dimensions added to the routing engine.
   // TODO(user): rename.
   void GetAllDimensions(std::vector<std::string>* dimension_names) const;
@@ -711,6 +829,10 @@ class RoutingModel {
   // route between node 'from' and 'to' is evaluator(from, to), whatever the
   // route or vehicle performing the route.
   void SetArcCostEvaluatorOfAllVehicles(NodeEvaluator2* evaluator);
+  // Same as above but with an explicit matrix, values[from][to] being the cost
+  // of the arc from->to; the matrix is copied. The model reads the copy
+  // directly instead of going through a callback.
+  void SetArcCostMatrixOfAllVehicles(const int64* const* values);
   // Sets the cost function for a given vehicle route.
   void SetArcCostEvaluatorOfVehicle(NodeEvaluator2* evaluator, int vehicle);
   // Sets the fixed cost of all vehicle routes. It is equivalent to calling
@@ -782,15 +904,24 @@ class RoutingModel {
   const Assignment* SolveWithParameters(
       const RoutingSearchParameters& parameters,
       const Assignment* assignment);
+  // Sets the search parameters used when the model is closed, without solving
+  // it. SolveWithParameters() is equivalent to calling this method followed by
+  // Solve().
+  void SetSearchParameters(const RoutingSearchParameters& parameters);
   // Computes a lower bound to the routing problem solving a linear assignment
   // problem. The routing model must be closed before calling this method.
-  // Note that problems with node disjunction constraints (including optional
-  // nodes) and non-homogenous costs are not supported (the method returns 0 in
-  // these cases).
-  // TODO(user): Add support for non-homogeneous costs and disjunctions.
+  // Non-homogeneous costs are relaxed to the cheapest cost class of each arc,
+  // and the nodes that can be unperformed may be assigned to themselves for
+  // their penalty (or for free in a disjunction of several nodes). See
+  // --routing_log_lower_bound_gap to compute it in parallel with the search.
   int64 ComputeLowerBound();
   // Returns the current status of the routing model.
   Status status() const { return status_; }
+  // Returns a report of the memory used to build the model, per component
+  // (routing variables, dimensions, model closing, ...), as measured by the
+  // increase of the memory usage of the process while building each
+  // component.
+  std::string MemoryUsageReport() const;
   // Applies a lock chain to the next search. 'locks' represents an ordered
   // vector of nodes representing a partial route which will be fixed during the
   // next search; it will constrain next variables such that:
@@ -809,6 +940,12 @@ class RoutingModel {
   // PreAssignment().
   bool ApplyLocksToAllVehicles(const std::vector<std::vector<NodeIndex> >& locks,
                                bool close_routes);
+  // Adds to the locks of the next search that the given nodes are not
+  // performed; must be called after the locks have been applied (ApplyLocks()
+  // and ApplyLocksToAllVehicles() clear the previous locks). Returns false if
+  // a node cannot be unperformed (start and end nodes, nodes which must be
+  // active) or is already locked.
+  bool ApplyInactiveNodes(const std::vector<NodeIndex>& nodes);
   // Returns an assignment used to fix some of the variables of the problem.
   // In practice, this assignment locks partial routes of the problem. This
   // can be used in the context of locking the parts of the routes which have
@@ -1114,6 +1251,8 @@ class RoutingModel {
     ROUTING_MAKE_CHAIN_INACTIVE,
     ROUTING_SWAP_ACTIVE,
     ROUTING_EXTENDED_SWAP_ACTIVE,
+    ROUTING_PAIR_EXCHANGE,
+    ROUTING_PAIR_TWO_OPT,
     ROUTING_LOCAL_SEARCH_OPERATOR_COUNTER
   };
 
@@ -1138,13 +1277,24 @@ class RoutingModel {
 
   // Internal methods.
   void Initialize();
+  // Records the increase of the process memory usage since the previous call
+  // as the memory used by 'component'.
+  void RecordMemoryUsage(const std::string& component);
+  // Creates the is-bound-to-end variables.
+  void InitializeIsBoundToEnd();
   void SetStartEnd(const std::vector<std::pair<NodeIndex, NodeIndex> >& start_end);
   void AddDisjunctionInternal(const std::vector<NodeIndex>& nodes, int64 penalty);
   void AddNoCycleConstraintInternal();
+  // If 'transit_profile_evaluator' is not null, the dimension is
+  // time-dependent (see AddTimeDependentDimension()); the evaluator must
+  // already be owned by the model.
   bool AddDimensionWithCapacityInternal(
       const std::vector<NodeEvaluator2*>& evaluators, int64 slack_max,
       int64 capacity, VehicleEvaluator* vehicle_capacity,
-      bool fix_start_cumul_to_zero, const std::string& dimension_name);
+      bool fix_start_cumul_to_zero, const std::string& dimension_name,
+      NodeEvaluator2* transit_profile_evaluator = nullptr,
+      const std::vector<TimeDependentTransit>& transit_profiles =
+          std::vector<TimeDependentTransit>());
   DimensionIndex GetDimensionIndex(const std::string& dimension_name) const;
   uint64 GetFingerprintOfEvaluator(NodeEvaluator2* evaluator) const;
   void ComputeCostClasses();
@@ -1162,6 +1312,14 @@ class RoutingModel {
                          : kCostClassIndexOfZeroCost)
         .value();
   }
+  int64 GetArcCostFromClassEvaluator(NodeIndex i, NodeIndex j,
+                                     const CostClass& cost_class) const {
+    return cost_class.arc_cost_matrix != nullptr
+               ? cost_class.arc_cost_matrix[static_cast<int64>(i.value()) *
+                                                nodes_ +
+                                            j.value()]
+               : cost_class.arc_cost_evaluator->Run(i, j);
+  }
   int64 GetDimensionTransitCostSum(int64 i, int64 j,
                                    const CostClass& cost_class) const;
   // Returns nullptr if no penalty cost, otherwise returns penalty variable.
@@ -1206,6 +1364,12 @@ class RoutingModel {
   SearchLimit* GetOrCreateLargeNeighborhoodSearchLimit();
   LocalSearchOperator* CreateInsertionOperator();
   void CreateNeighborhoodOperators();
+  // Computes the 'num_neighbors' closest nodes of each node, by arc cost
+  // (start and end nodes are not considered), and stores them in neighbors_.
+  void ComputeNearestNeighbors(int64 num_neighbors);
+  // Returns true if one of the nodes is a nearest neighbor of the other or if
+  // one of them is a vehicle start or end node.
+  bool AreNeighbors(int64 node1, int64 node2) const;
   LocalSearchOperator* GetNeighborhoodOperators() const;
   const std::vector<LocalSearchFilter*>& GetOrCreateLocalSearchFilters();
   const std::vector<LocalSearchFilter*>& GetOrCreateFeasibilityFilters();
@@ -1241,6 +1405,9 @@ class RoutingModel {
   // - or nexts_[i] is bound and is_bound_to_end_[nexts_[i].Value()] is true.
   std::vector<IntVar*> is_bound_to_end_;
   RevSwitch is_bound_to_end_ct_added_;
+  // Memory used by each component of the model, in construction order.
+  std::vector<std::pair<std::string, int64>> memory_usage_by_component_;
+  int64 last_memory_usage_;
   // Dimensions
   hash_map<std::string, DimensionIndex> dimension_name_to_index_;
   ITIVector<DimensionIndex, RoutingDimension*> dimensions_;
@@ -1262,6 +1429,9 @@ class RoutingModel {
   std::unique_ptr<ResultCallback1<int, int64> > vehicle_start_class_callback_;
   // Cached callbacks
   hash_map<const NodeEvaluator2*, NodeEvaluator2*> cached_node_callbacks_;
+  // Arc cost evaluator set by SetArcCostMatrixOfAllVehicles() and its matrix.
+  NodeEvaluator2* arc_cost_matrix_evaluator_;
+  const int64* arc_cost_matrix_;
   // Disjunctions
   ITIVector<DisjunctionIndex, ValuedNodes> disjunctions_;
   std::vector<DisjunctionIndex> node_to_disjunction_;
@@ -1288,6 +1458,8 @@ class RoutingModel {
   RoutingStrategy first_solution_strategy_;
   Solver::IndexEvaluator2 first_solution_evaluator_;
   std::vector<LocalSearchOperator*> local_search_operators_;
+  // Sorted nearest neighbors of each node; see ComputeNearestNeighbors().
+  std::vector<std::vector<int64>> neighbors_;
   RoutingMetaheuristic metaheuristic_;
   std::vector<SearchMonitor*> monitors_;
   SolutionCollector* collect_assignments_;
@@ -1323,6 +1495,241 @@ class RoutingModel {
   DISALLOW_COPY_AND_ASSIGN(RoutingModel);
 };
 
+#ifndef SWIG
+// Parallel multi-start routing search. Routing models cannot be copied once
+// built, so the solver is given a builder returning a new (not closed) model
+// for each worker; all the models must describe the same problem. Each worker
+// solves its own model with its own search parameters (first solution
+// strategy, metaheuristic, ...) and random seed. The cost of the best
+// solution found by any worker is shared between the workers.
+//
+// Usage:
+//   RoutingMultiStartSolver solver(
+//       [](int worker) { return BuildMyModel(); }, worker_parameters);
+//   if (solver.Solve(num_threads)) {
+//     const Assignment* const solution = solver.best_solution();
+//     const RoutingModel& model = *solver.best_model();
+//     ...
+//   }
+class RoutingMultiStartSolver {
+ public:
+  typedef std::function<RoutingModel*(int)> ModelBuilder;
+
+  // There is one worker per element of 'parameters'. The models returned by
+  // the builder are owned by the multi-start solver.
+  RoutingMultiStartSolver(
+      ModelBuilder model_builder,
+      const std::vector<RoutingSearchParameters>& parameters);
+  ~RoutingMultiStartSolver();
+
+  // Builds and closes the models of all workers, then solves them using
+  // 'num_threads' threads. Returns true if a solution was found.
+  bool Solve(int num_threads);
+
+  // Cost of the best solution found by all the workers so far, kint64max if
+  // none was found. Can be called concurrently with Solve().
+  int64 best_cost() const { return best_cost_.load(); }
+  // Index of the worker which found the best solution, -1 if none.
+  int best_worker() const { return best_worker_; }
+  // Model of the best worker and its solution; nullptr if no solution was
+  // found.
+  RoutingModel* best_model() const;
+  const Assignment* best_solution() const;
+
+  // Called by the workers each time they find a solution; updates the shared
+  // best cost. Returns true if 'cost' is the new best cost.
+  bool UpdateBestCost(int64 cost);
+
+ private:
+  void SolveWorker(int worker);
+
+  ModelBuilder model_builder_;
+  const std::vector<RoutingSearchParameters> parameters_;
+  std::vector<std::unique_ptr<RoutingModel>> models_;
+  std::vector<const Assignment*> solutions_;
+  Mutex mutex_;
+  std::atomic<int64> best_cost_;
+  int best_worker_ GUARDED_BY(mutex_);
+
+  DISALLOW_COPY_AND_ASSIGN(RoutingMultiStartSolver);
+};
+
+// Large neighborhood search on routes, re-optimizing disjoint subsets of
+// routes in parallel. At each iteration, vehicles are randomly partitioned
+// into subsets and each subset is re-optimized by a worker, in its own model,
+// in which the routes of the other vehicles are fixed; unperformed nodes are
+// also split among workers so that no two workers can insert the same node.
+// The improvements of all workers are then merged into a single solution,
+// which is checked and evaluated on a reference model. If the merged solution
+// is not feasible or not better than the best worker solution (e.g. due to
+// constraints or costs linking routes), the best worker solution is kept.
+class RoutingParallelRouteLns {
+ public:
+  // 'model_builder' is called with the index of a worker to build worker
+  // models, and with -1 to build the reference model; all models must be
+  // identical. Workers search with 'parameters', typically with a time or
+  // solution limit.
+  RoutingParallelRouteLns(RoutingMultiStartSolver::ModelBuilder model_builder,
+                          const RoutingSearchParameters& parameters);
+  ~RoutingParallelRouteLns();
+
+  // Runs 'num_iterations' iterations, each one re-optimizing 'num_subsets'
+  // subsets of routes using 'num_threads' threads. 'routes' contains the
+  // initial solution, in the format of RoutingModel::AssignmentToRoutes(),
+  // and is replaced by the improved solution. Returns the cost of the
+  // solution, or kint64max if the initial routes are not feasible.
+  int64 Improve(int num_subsets, int num_iterations, int num_threads,
+                std::vector<std::vector<RoutingModel::NodeIndex>>* routes);
+
+ private:
+  void SolveWorker(int worker);
+
+  RoutingMultiStartSolver::ModelBuilder model_builder_;
+  const RoutingSearchParameters parameters_;
+  std::vector<std::unique_ptr<RoutingModel>> models_;
+  std::vector<const Assignment*> start_assignments_;
+  std::vector<const Assignment*> solutions_;
+
+  DISALLOW_COPY_AND_ASSIGN(RoutingParallelRouteLns);
+};
+
+// Cluster-first, route-second decomposition of large routing problems. The
+// nodes are partitioned into clusters (for instance geographic sectors, see
+// SweepClusters()), the vehicles are split among the clusters in proportion
+// to their number of nodes, and each cluster is solved in parallel on its own
+// smaller model. The routes of the clusters are then merged into a solution
+// of the full model, which is improved by a local search on the full model
+// (moving nodes between the routes of different clusters).
+//
+// Usage:
+//   RoutingClusterDecomposition decomposition(
+//       [](const std::vector<RoutingModel::NodeIndex>& nodes,
+//          const std::vector<int>& vehicles) {
+//         return BuildMyModel(nodes, vehicles);
+//       },
+//       cluster_parameters, global_parameters);
+//   const Assignment* const solution = decomposition.Solve(
+//       RoutingClusterDecomposition::SweepClusters(points, depot, 64),
+//       num_threads);
+class RoutingClusterDecomposition {
+ public:
+  // Returns a new (not closed) model of the problem restricted to 'nodes'
+  // and 'vehicles', which are nodes and vehicles of the full problem: the
+  // node i of the returned model is nodes[i], and its vehicle j is
+  // vehicles[j]. The full model is built by passing empty 'nodes' and
+  // 'vehicles'.
+  typedef std::function<RoutingModel*(
+      const std::vector<RoutingModel::NodeIndex>& nodes,
+      const std::vector<int>& vehicles)> SubModelBuilder;
+
+  // The clusters are solved with 'cluster_parameters', and the merged
+  // solution is improved with 'global_parameters', which typically have a
+  // time limit.
+  RoutingClusterDecomposition(SubModelBuilder model_builder,
+                              const RoutingSearchParameters& cluster_parameters,
+                              const RoutingSearchParameters& global_parameters);
+  ~RoutingClusterDecomposition();
+
+  // Partitions the nodes other than 'depot' into 'num_clusters' clusters of
+  // (almost) the same size, by sweeping a ray around the depot, as in the
+  // sweep first solution strategy.
+  static std::vector<std::vector<RoutingModel::NodeIndex>> SweepClusters(
+      const ITIVector<RoutingModel::NodeIndex, std::pair<int64, int64>>& points,
+      RoutingModel::NodeIndex depot, int num_clusters);
+
+  // Solves the clusters, which must be disjoint and must not contain the
+  // start and end nodes of the vehicles, using 'num_threads' threads. There
+  // must be at most as many clusters as vehicles. The nodes in no cluster
+  // are left to the global search. Returns the solution of the full model,
+  // or nullptr if none was found.
+  const Assignment* Solve(
+      const std::vector<std::vector<RoutingModel::NodeIndex>>& clusters,
+      int num_threads);
+
+  // The full model, built by Solve().
+  RoutingModel* model() const { return model_.get(); }
+
+ private:
+  void SolveCluster(int cluster);
+
+  SubModelBuilder model_builder_;
+  const RoutingSearchParameters cluster_parameters_;
+  const RoutingSearchParameters global_parameters_;
+  std::unique_ptr<RoutingModel> model_;
+  std::vector<std::unique_ptr<RoutingModel>> cluster_models_;
+  std::vector<const Assignment*> cluster_solutions_;
+
+  DISALLOW_COPY_AND_ASSIGN(RoutingClusterDecomposition);
+};
+
+// Re-optimization of a routing model whose nodes and routes change over time,
+// as in online routing problems where orders arrive and vehicles progress
+// along their routes. The model is built and closed once, and each re-plan
+// is a search on the same model, which keeps its cached evaluators, cost
+// classes and local search filters: nodes can be removed (made unperformed)
+// and added back, the visited prefixes of the routes are locked, and the
+// local search starts from the routes of the previous plan.
+// Nodes cannot be added to a closed model: the model must be built with
+// placeholder nodes for future orders, which are removed until their order
+// arrives. Removed nodes, and the nodes which can be added later, must be
+// optional (in a disjunction); new nodes are inserted by the local search
+// operators which make nodes active.
+//
+// Usage:
+//   RoutingDynamicPlanner planner(model, parameters);
+//   for (const NodeIndex node : placeholders) planner.RemoveNode(node);
+//   planner.Replan();
+//   ...
+//   planner.AddNode(new_order_node);
+//   planner.SetVisitedPrefix(vehicle, visited_nodes);
+//   const Assignment* const solution = planner.Replan();
+class RoutingDynamicPlanner {
+ public:
+  // Does not take ownership of the model, which must not be closed yet; it
+  // is closed with 'parameters'.
+  RoutingDynamicPlanner(RoutingModel* model,
+                        const RoutingSearchParameters& parameters);
+  ~RoutingDynamicPlanner();
+
+  // Makes a node available to the next plans; all the nodes are initially
+  // available.
+  void AddNode(RoutingModel::NodeIndex node);
+  // Makes a node unperformed in the next plans.
+  void RemoveNode(RoutingModel::NodeIndex node);
+  bool IsNodeRemoved(RoutingModel::NodeIndex node) const;
+  // Locks the beginning of the route of a vehicle in the next plans: the
+  // route will start with 'prefix', which does not contain the start node.
+  // Replaces the previous prefix of the vehicle.
+  void SetVisitedPrefix(int vehicle,
+                        const std::vector<RoutingModel::NodeIndex>& prefix);
+
+  // Solves the model with the current nodes and locks, starting from the
+  // routes of the previous plan if there is one. Returns the solution, which
+  // is owned by the model and valid until the next plan, or nullptr if none
+  // was found; in this case the routes of the previous plan are kept.
+  const Assignment* Replan();
+
+  // The routes of the last plan, in the format of
+  // RoutingModel::AssignmentToRoutes(); empty before the first plan.
+  const std::vector<std::vector<RoutingModel::NodeIndex>>& routes() const {
+    return routes_;
+  }
+
+ private:
+  // Returns the routes of the previous plan, starting with the locked
+  // prefixes and without the removed nodes.
+  std::vector<std::vector<RoutingModel::NodeIndex>> StartRoutes() const;
+
+  RoutingModel* const model_;
+  // Indexed by node.
+  std::vector<bool> removed_;
+  std::vector<std::vector<RoutingModel::NodeIndex>> prefixes_;
+  std::vector<std::vector<RoutingModel::NodeIndex>> routes_;
+
+  DISALLOW_COPY_AND_ASSIGN(RoutingDynamicPlanner);
+};
+#endif  // SWIG
+
 // Dimensions represent quantities accumulated at nodes along the routes. They
 // represent quantities such as weights or volumes carried along the route, or
 // distance or times.
@@ -1359,6 +1766,32 @@ class RoutingDimension {
   RoutingModel::TransitEvaluator2* transit_evaluator(int vehicle) const {
     return transit_evaluators_[vehicle];
   }
+  // Returns true if the transits of the dimension are stored in a flat array,
+  // indexed by var indices and shared by all vehicles, which can be read with
+  // GetMatrixTransitValue() instead of running the transit evaluators. This is
+  // the case for dimensions created with RoutingModel::AddVectorDimension()
+  // and RoutingModel::AddMatrixDimension().
+  bool HasTransitMatrix() const { return !transit_matrix_.empty(); }
+  // Returns true if the transits of the dimension depend on the departure
+  // time (see RoutingModel::AddTimeDependentDimension()).
+  bool HasTimeDependentTransits() const { return !transit_profiles_.empty(); }
+  // Returns the time-dependent transit function of the arc between two var
+  // indices; only valid if HasTimeDependentTransits().
+  const TimeDependentTransit& GetTransitProfile(int64 from_index,
+                                                int64 to_index) const;
+  // Returns the transit value between two var indices; only valid if
+  // HasTransitMatrix() is true.
+  int64 GetMatrixTransitValue(int64 from_index, int64 to_index) const {
+    DCHECK(HasTransitMatrix());
+    return transit_matrix_[from_index * transit_matrix_row_stride_ +
+                           to_index * transit_matrix_column_stride_];
+  }
+  // Sets out[i] to the transit value of arc from[i] -> to[i] for the given
+  // vehicle, for i in [0, n). Arcs are evaluated by batch when the transit
+  // evaluator of the vehicle supports it (see
+  // RoutingModel::BatchNodeEvaluator2).
+  void GetTransitValues(const int64* from_indices, const int64* to_indices,
+                        int64 vehicle, int64* out, int n) const;
 #endif  // SWIGCSHARP
 #endif  // !defined(SWIGPYTHON) && !defined(SWIGJAVA)
   // Sets an upper bound on the dimension span on a given vehicle. This is the
@@ -1548,6 +1981,13 @@ class RoutingDimension {
   void InitializeTransits(
       const std::vector<RoutingModel::NodeEvaluator2*>& transit_evaluators,
       int64 slack_max);
+  // Copies the transits of the dimension, the transit from node i to node j
+  // being node_transits[i * node_row_stride + j * node_column_stride], into
+  // transit_matrix_ and replaces the transit evaluators by reads of the matrix.
+  // Only valid for dimensions with a single transit evaluator and before the
+  // model is closed.
+  void InitializeTransitMatrix(const int64* node_transits,
+                               int64 node_row_stride, int64 node_column_stride);
   // Sets up the cost variables related to cumul soft upper bounds.
   void SetupCumulVarSoftUpperBoundCosts(std::vector<IntVar*>* cost_elements) const;
   // Sets up the cost variables related to cumul soft lower bounds.
@@ -1565,6 +2005,15 @@ class RoutingDimension {
   std::vector<RoutingModel::TransitEvaluator2*> transit_evaluators_;
   std::vector<std::unique_ptr<RoutingModel::TransitEvaluator2> > class_evaluators_;
   std::vector<int64> vehicle_to_class_;
+  // Row-major transits indexed by var indices. Transits which only depend on
+  // the origin are stored as a vector, with a column stride of 0.
+  std::vector<int64> transit_matrix_;
+  int64 transit_matrix_row_stride_;
+  int64 transit_matrix_column_stride_;
+  // Time-dependent transit functions, and the callback returning the index of
+  // the function of an arc between two nodes.
+  std::vector<TimeDependentTransit> transit_profiles_;
+  RoutingModel::NodeEvaluator2* transit_profile_evaluator_;
   std::vector<IntVar*> slacks_;
   std::vector<int64> vehicle_span_upper_bounds_;
   int64 global_span_cost_coefficient_;
@@ -1731,9 +2180,43 @@ class CheapestInsertionFilteredDecisionBuilder
   // Returns the cost of unperforming node 'node_to_insert'. Returns kint64max
   // if penalty callback is null or if the node cannot be unperformed.
   int64 GetUnperformedValue(int64 node_to_insert) const;
+  // Builds the cumul windows of dimensions in which some cumul variables have
+  // restricted domains (typically time windows), to be used by
+  // IsInsertionCompatibleWithCumulWindows().
+  void InitializeCumulWindows();
+  // Returns false if inserting 'node' between 'insert_after' and
+  // 'insert_before' on 'vehicle' cannot satisfy the cumul windows, assuming
+  // 'insert_after' is directly followed by 'node' and 'node' by
+  // 'insert_before'. The test only uses the initial bounds of cumul variables
+  // and transit values, therefore never discards feasible insertions.
+  bool IsInsertionCompatibleWithCumulWindows(int64 node, int64 insert_after,
+                                             int64 insert_before,
+                                             int64 vehicle) const;
+  // Sets 'vehicles' to the vehicles on which insertions have to be evaluated:
+  // all vehicles with non-empty routes and, since empty routes of vehicles of
+  // the same vehicle class are equivalent, a single vehicle per class among
+  // vehicles with empty routes. The other empty vehicles are kept aside and
+  // can be retrieved with PopEquivalentEmptyVehicle().
+  void ComputeVehiclesToEvaluate(std::vector<int>* vehicles);
+  // Returns a vehicle of the same class as 'vehicle' with an empty route which
+  // was kept aside by the last call to ComputeVehiclesToEvaluate(), or -1 if
+  // there is none. The returned vehicle is no longer kept aside.
+  int PopEquivalentEmptyVehicle(int vehicle);
 
   std::unique_ptr<ResultCallback3<int64, int64, int64, int64> > evaluator_;
   std::unique_ptr<ResultCallback1<int64, int64> > penalty_evaluator_;
+
+ private:
+  // Initial bounds of the cumul variables of a dimension, indexed by var index.
+  struct CumulWindows {
+    const RoutingDimension* dimension;
+    std::vector<int64> mins;
+    std::vector<int64> maxes;
+  };
+  std::vector<CumulWindows> cumul_windows_;
+  // Empty vehicles kept aside by ComputeVehiclesToEvaluate(), by class.
+  ITIVector<RoutingModel::VehicleClassIndex, std::vector<int>>
+      equivalent_empty_vehicles_;
 };
 
 // Filter-based decision builder which builds a solution by inserting
@@ -1818,6 +2301,14 @@ class GlobalCheapestInsertionFilteredDecisionBuilder
   void UpdatePositions(int vehicle, int64 insert_after,
                        AdjustablePriorityQueue<NodeEntry>* priority_queue,
                        std::vector<NodeEntries>* node_entries);
+  // Updates the value of a node entry inserting its node between its position
+  // and 'insert_before', 'old_value' being the value of the arc between both.
+  // The entry is added to the priority queue if needed, or removed from it if
+  // the insertion cannot satisfy cumul windows; in that case the evaluator is
+  // not called.
+  void UpdateNodeEntry(NodeEntry* node_entry, int64 insert_before,
+                       int64 old_value,
+                       AdjustablePriorityQueue<NodeEntry>* priority_queue);
   // Deletes an entry, removing it from the priority queue and the appropriate
   // node entry sets.
   void DeleteNodeEntry(NodeEntry* entry,
@@ -1935,8 +2426,12 @@ class SavingsFilteredDecisionBuilder : public RoutingFilteredDecisionBuilder {
  public:
   // If savings_neighbors > 0 then for each node only its 'saving_neighbors'
   // neighbors leading to the smallest arc costs are considered.
+  // The savings are sorted with num_threads threads; the arc costs are
+  // evaluated in the calling thread since the cost callbacks need not be
+  // thread-safe.
   SavingsFilteredDecisionBuilder(RoutingModel* model, int64 saving_neighbors,
-                                 const std::vector<LocalSearchFilter*>& filters);
+                                 const std::vector<LocalSearchFilter*>& filters,
+                                 int num_threads = 1);
   ~SavingsFilteredDecisionBuilder() override {}
   bool BuildSolution() override;
 
@@ -1970,6 +2465,7 @@ class SavingsFilteredDecisionBuilder : public RoutingFilteredDecisionBuilder {
   int64 GetSavingValue(const Saving& saving) const { return saving.first; }
 
   const int64 saving_neighbors_;
+  const int num_threads_;
   int64 size_squared_;
 };
 
@@ -2015,6 +2511,12 @@ class BasePathFilter : public RoutingLocalSearchFilter {
   int NumPaths() const { return starts_.size(); }
   int64 Start(int i) const { return starts_[i]; }
   int GetPath(int64 node) const { return paths_[node]; }
+  // Returns the start of the path of a node and its rank on the path in the
+  // synchronized solution, kUnassigned for inactive nodes.
+  int64 GetPathStartOfNode(int64 node) const {
+    return node_path_starts_[node];
+  }
+  int GetRank(int64 node) const { return ranks_[node]; }
 
  private:
   virtual void OnBeforeSynchronizePaths() {}
@@ -2042,6 +2544,68 @@ class BasePathFilter : public RoutingLocalSearchFilter {
   std::vector<int> ranks_;
 };
 
+// Filter on the arc costs of a model with homogeneous costs. On
+// synchronization, it caches the cost of each arc of the current solution and
+// the prefix sums of these costs along the routes. The arcs of a delta which
+// are arcs of the current solution, or reversed arcs of the current solution
+// (as in the reversed segment of a 2-opt or Lin-Kernighan move), are
+// evaluated from the cache instead of calling the cost callback; the cost of
+// the reversed arcs is computed once per synchronization, on first use. This
+// makes the evaluation of segment reversals cost two callback calls instead of
+// one per arc of the segment.
+class PathArcCostFilter : public RoutingLocalSearchFilter {
+ public:
+  PathArcCostFilter(RoutingModel* routing_model,
+                    std::function<void(int64)> objective_callback);
+  ~PathArcCostFilter() override {}
+  bool Accept(const Assignment* delta, const Assignment* deltadelta) override;
+  std::string DebugString() const override { return "PathArcCostFilter"; }
+
+  // Returns the cost of the arc from 'from' to 'to', from the cache if it is
+  // an arc or a reversed arc of the synchronized solution.
+  int64 ArcCost(int64 from, int64 to);
+  // Returns the cost of the part of the synchronized route from 'from' to
+  // 'to', which must be after 'from' on the same route, in O(1).
+  int64 SegmentCost(int64 from, int64 to) const {
+    return prefix_costs_[to] - prefix_costs_[from];
+  }
+  // Returns the cost of the same segment traversed from 'to' to 'from', in
+  // O(1) once the reversed arcs of the route have been evaluated.
+  int64 ReversedSegmentCost(int64 from, int64 to);
+
+ private:
+  void OnSynchronize(const Assignment* delta) override;
+  void SynchronizeFullAssignment();
+  // Recomputes the route and prefix cost of the nodes of a route.
+  void SynchronizeRoute(int route);
+  // Returns the cost of the arc from Value(index) to index.
+  int64 ReversedArcCost(int64 index);
+
+  RoutingModel* const routing_model_;
+  // Cost of the synchronized arc leaving each node, 0 if not synchronized.
+  std::vector<int64> arc_costs_;
+  // Cost of the reversed arc entering each node, valid if the stamp of the
+  // node is the current synchronization stamp.
+  std::vector<int64> reversed_arc_costs_;
+  std::vector<int64> reversed_arc_stamps_;
+  // Sum of the costs of the arcs from the start of the route to each node,
+  // and the same for the reversed arcs (valid if the stamp of the route is
+  // the current synchronization stamp).
+  std::vector<int64> prefix_costs_;
+  std::vector<int64> reversed_prefix_costs_;
+  std::vector<int64> reversed_prefix_stamps_;
+  // Route of each node of the synchronized solution, -1 if it is on no route.
+  std::vector<int> node_routes_;
+  // Routes changed by the last synchronization delta.
+  std::vector<int> touched_routes_;
+  std::vector<int64> touched_route_stamps_;
+  int64 synchronized_cost_;
+  int64 stamp_;
+};
+
+PathArcCostFilter* MakePathArcCostFilter(
+    RoutingModel* routing_model,
+    std::function<void(int64)> objective_callback);
 RoutingLocalSearchFilter* MakeNodeDisjunctionFilter(
     const RoutingModel& routing_model,
     std::function<void(int64)> objective_callback);
@@ -20,6 +20,8 @@
 #include <set>
 #include "base/small_map.h"
 #include "base/small_ordered_set.h"
+#include "base/stl_util.h"
+#include "base/threadpool.h"
 #include "constraint_solver/routing.h"
 #include "util/bitset.h"
 #include "util/saturated_arithmetic.h"
@@ -133,27 +135,51 @@ class NodeDisjunctionFilter : public RoutingLocalSearchFilter {
 
  private:
   void OnSynchronize(const Assignment* delta) override {
-    penalty_value_ = 0;
-    for (RoutingModel::DisjunctionIndex i(0);
-         i < active_per_disjunction_.size(); ++i) {
-      active_per_disjunction_[i] = 0;
-      const std::vector<int>& disjunction_nodes =
-          routing_model_.GetDisjunctionIndices(i);
-      bool all_nodes_synced = true;
-      for (const int64 node : disjunction_nodes) {
-        const bool node_synced = IsVarSynced(node);
-        if (!node_synced) all_nodes_synced = false;
-        if (node_synced && Value(node) != node) {
-          ++active_per_disjunction_[i];
-        }
+    if (delta == nullptr || delta->Empty() || penalty_value_ == kint64max) {
+      penalty_value_ = 0;
+      for (RoutingModel::DisjunctionIndex i(0);
+           i < active_per_disjunction_.size(); ++i) {
+        penalty_value_ = CapAdd(penalty_value_, SynchronizeDisjunction(i));
       }
-      const int64 penalty = routing_model_.GetDisjunctionPenalty(i);
-      if (active_per_disjunction_[i] == 0 && penalty > 0 && all_nodes_synced) {
-        penalty_value_ = CapAdd(penalty_value_, penalty);
+    } else {
+      // Only the disjunctions of the nodes of the delta change.
+      const int64 kUnassigned = -1;
+      const Assignment::IntContainer& container = delta->IntVarContainer();
+      for (int i = 0; i < container.Size(); ++i) {
+        int64 index = kUnassigned;
+        RoutingModel::DisjunctionIndex disjunction_index(kUnassigned);
+        if (FindIndex(container.Element(i).Var(), &index) &&
+            routing_model_.GetDisjunctionIndexFromVariableIndex(
+                index, &disjunction_index)) {
+          const int64 old_penalty = DisjunctionPenaltyValue(disjunction_index);
+          penalty_value_ =
+              CapAdd(CapSub(penalty_value_, old_penalty),
+                     SynchronizeDisjunction(disjunction_index));
+        }
       }
     }
     PropagateObjectiveValue(CapAdd(injected_objective_value_, penalty_value_));
   }
+  // Recomputes the number of active nodes of a disjunction and returns its
+  // penalty in the synchronized solution.
+  int64 SynchronizeDisjunction(RoutingModel::DisjunctionIndex index) {
+    active_per_disjunction_[index] = 0;
+    for (const int64 node : routing_model_.GetDisjunctionIndices(index)) {
+      if (IsVarSynced(node) && Value(node) != node) {
+        ++active_per_disjunction_[index];
+      }
+    }
+    return DisjunctionPenaltyValue(index);
+  }
+  // Returns the penalty of a disjunction given its number of active nodes.
+  int64 DisjunctionPenaltyValue(RoutingModel::DisjunctionIndex index) const {
+    const int64 penalty = routing_model_.GetDisjunctionPenalty(index);
+    if (active_per_disjunction_[index] != 0 || penalty <= 0) return 0;
+    for (const int64 node : routing_model_.GetDisjunctionIndices(index)) {
+      if (!IsVarSynced(node)) return 0;
+    }
+    return penalty;
+  }
 
   const RoutingModel& routing_model_;
   ITIVector<RoutingModel::DisjunctionIndex, int> active_per_disjunction_;
@@ -168,6 +194,170 @@ RoutingLocalSearchFilter* MakeNodeDisjunctionFilter(
       new NodeDisjunctionFilter(routing_model, objective_callback));
 }
 
+// PathArcCostFilter
+
+PathArcCostFilter::PathArcCostFilter(
+    RoutingModel* routing_model, Solver::ObjectiveWatcher objective_callback)
+    : RoutingLocalSearchFilter(routing_model->Nexts(), objective_callback),
+      routing_model_(routing_model),
+      arc_costs_(routing_model->Size(), 0),
+      reversed_arc_costs_(routing_model->Size(), 0),
+      reversed_arc_stamps_(routing_model->Size(), 0),
+      prefix_costs_(routing_model->Size() + routing_model->vehicles(), 0),
+      reversed_prefix_costs_(routing_model->Size() + routing_model->vehicles(),
+                             0),
+      reversed_prefix_stamps_(routing_model->vehicles(), 0),
+      node_routes_(routing_model->Size() + routing_model->vehicles(), -1),
+      touched_route_stamps_(routing_model->vehicles(), 0),
+      synchronized_cost_(0),
+      stamp_(0) {}
+
+void PathArcCostFilter::OnSynchronize(const Assignment* delta) {
+  // Invalidates the reversed arc costs.
+  ++stamp_;
+  // The synchronized cost can only be updated incrementally if it did not
+  // saturate.
+  if (delta == nullptr || delta->Empty() || synchronized_cost_ == kint64max) {
+    SynchronizeFullAssignment();
+  } else {
+    // Only the arcs of the delta change, and the routes they were on.
+    touched_routes_.clear();
+    const Assignment::IntContainer& container = delta->IntVarContainer();
+    for (int i = 0; i < container.Size(); ++i) {
+      int64 index = -1;
+      if (!FindIndex(container.Element(i).Var(), &index) ||
+          index >= arc_costs_.size()) {
+        continue;
+      }
+      const int route = node_routes_[index];
+      if (route != -1 && touched_route_stamps_[route] != stamp_) {
+        touched_route_stamps_[route] = stamp_;
+        touched_routes_.push_back(route);
+      }
+      // Nodes still on a route are reassigned to it when walking the route.
+      node_routes_[index] = -1;
+      const int64 arc_cost =
+          IsVarSynced(index)
+              ? routing_model_->GetHomogeneousCost(index, Value(index))
+              : 0;
+      synchronized_cost_ =
+          CapAdd(CapSub(synchronized_cost_, arc_costs_[index]), arc_cost);
+      arc_costs_[index] = arc_cost;
+    }
+    for (const int route : touched_routes_) {
+      SynchronizeRoute(route);
+    }
+  }
+  PropagateObjectiveValue(CapAdd(injected_objective_value_, synchronized_cost_));
+}
+
+void PathArcCostFilter::SynchronizeFullAssignment() {
+  synchronized_cost_ = 0;
+  const int size = routing_model_->Size();
+  for (int64 index = 0; index < size; ++index) {
+    arc_costs_[index] = IsVarSynced(index) ? routing_model_->GetHomogeneousCost(
+                                                 index, Value(index))
+                                           : 0;
+    synchronized_cost_ = CapAdd(synchronized_cost_, arc_costs_[index]);
+  }
+  std::fill(node_routes_.begin(), node_routes_.end(), -1);
+  for (int route = 0; route < routing_model_->vehicles(); ++route) {
+    SynchronizeRoute(route);
+  }
+}
+
+void PathArcCostFilter::SynchronizeRoute(int route) {
+  int64 node = routing_model_->Start(route);
+  int64 prefix_cost = 0;
+  // Stops on cycles, which are not routes (and are not synchronized in
+  // valid solutions).
+  for (int steps = 0; steps < node_routes_.size(); ++steps) {
+    node_routes_[node] = route;
+    prefix_costs_[node] = prefix_cost;
+    if (routing_model_->IsEnd(node) || !IsVarSynced(node)) break;
+    prefix_cost = CapAdd(prefix_cost, arc_costs_[node]);
+    node = Value(node);
+  }
+}
+
+int64 PathArcCostFilter::ReversedArcCost(int64 index) {
+  if (reversed_arc_stamps_[index] != stamp_) {
+    reversed_arc_stamps_[index] = stamp_;
+    reversed_arc_costs_[index] =
+        routing_model_->GetHomogeneousCost(Value(index), index);
+  }
+  return reversed_arc_costs_[index];
+}
+
+int64 PathArcCostFilter::ArcCost(int64 from, int64 to) {
+  if (from < arc_costs_.size() && IsVarSynced(from)) {
+    if (Value(from) == to) return arc_costs_[from];
+    if (to < arc_costs_.size() && IsVarSynced(to) && Value(to) == from) {
+      return ReversedArcCost(to);
+    }
+  }
+  return routing_model_->GetHomogeneousCost(from, to);
+}
+
+int64 PathArcCostFilter::ReversedSegmentCost(int64 from, int64 to) {
+  const int route = node_routes_[from];
+  DCHECK_GE(route, 0);
+  DCHECK_EQ(route, node_routes_[to]);
+  if (reversed_prefix_stamps_[route] != stamp_) {
+    reversed_prefix_stamps_[route] = stamp_;
+    int64 node = routing_model_->Start(route);
+    int64 prefix_cost = 0;
+    for (int step = 0; step < node_routes_.size(); ++step) {
+      reversed_prefix_costs_[node] = prefix_cost;
+      if (routing_model_->IsEnd(node) || !IsVarSynced(node)) break;
+      const int64 next = Value(node);
+      // Ends have no next: the arc from the end is never traversed.
+      if (!routing_model_->IsEnd(next)) {
+        prefix_cost = CapAdd(prefix_cost, ReversedArcCost(node));
+      }
+      node = next;
+    }
+  }
+  return reversed_prefix_costs_[to] - reversed_prefix_costs_[from];
+}
+
+bool PathArcCostFilter::Accept(const Assignment* delta,
+                               const Assignment* deltadelta) {
+  if (delta == nullptr) {
+    return false;
+  }
+  const Assignment::IntContainer& container = delta->IntVarContainer();
+  const int delta_size = container.Size();
+  int64 cost = synchronized_cost_;
+  for (int i = 0; i < delta_size; ++i) {
+    const IntVarElement& new_element = container.Element(i);
+    IntVar* const var = new_element.Var();
+    int64 index = kint64min;
+    if (!FindIndex(var, &index)) continue;
+    cost = CapSub(cost, arc_costs_[index]);
+    // Unbound nexts (as in LNS) do not contribute to the cost, which is then
+    // a lower bound.
+    if (new_element.Activated()) {
+      cost = CapAdd(cost, ArcCost(index, new_element.Value()));
+    } else if (var->Bound()) {
+      cost = CapAdd(cost, ArcCost(index, var->Min()));
+    }
+  }
+  PropagateObjectiveValue(CapAdd(injected_objective_value_, cost));
+  IntVar* const cost_var = routing_model_->CostVar();
+  int64 cost_max = cost_var->Max();
+  if (delta->Objective() == cost_var) {
+    cost_max = std::min(cost_max, delta->ObjectiveMax());
+  }
+  return cost <= cost_max;
+}
+
+PathArcCostFilter* MakePathArcCostFilter(
+    RoutingModel* routing_model, Solver::ObjectiveWatcher objective_callback) {
+  return routing_model->solver()->RevAlloc(
+      new PathArcCostFilter(routing_model, objective_callback));
+}
+
 const int64 BasePathFilter::kUnassigned = -1;
 
 BasePathFilter::BasePathFilter(const std::vector<IntVar*>& nexts,
@@ -346,6 +536,12 @@ void BasePathFilter::OnSynchronize(const Assignment* delta) {
       if (start != kUnassigned) {
         touched_paths_.Set(start);
       }
+      // Nodes which became inactive are not reached when walking the touched
+      // paths below.
+      if (IsVarSynced(index) && Value(index) == index) {
+        node_path_starts_[index] = kUnassigned;
+        ranks_[index] = kUnassigned;
+      }
     }
   }
   OnBeforeSynchronizePaths();
@@ -404,7 +600,13 @@ class ChainCumulFilter : public BasePathFilter {
   void OnSynchronizePathFromStart(int64 start) override;
   bool AcceptPath(int64 path_start, int64 chain_start,
                   int64 chain_end) override;
+  int64 GetTransit(int vehicle, int64 node, int64 next) const {
+    return dimension_.HasTransitMatrix()
+               ? dimension_.GetMatrixTransitValue(node, next)
+               : evaluators_[vehicle]->Run(node, next);
+  }
 
+  const RoutingDimension& dimension_;
   const std::vector<IntVar*> cumuls_;
   std::vector<int64> start_to_vehicle_;
   std::vector<int64> start_to_end_;
@@ -423,6 +625,7 @@ ChainCumulFilter::ChainCumulFilter(const RoutingModel& routing_model,
                                    Solver::ObjectiveWatcher objective_callback)
     : BasePathFilter(routing_model.Nexts(), dimension.cumuls().size(),
                      objective_callback),
+      dimension_(dimension),
       cumuls_(dimension.cumuls()),
       evaluators_(routing_model.vehicles(), nullptr),
       capacity_evaluator_(dimension.capacity_evaluator()),
@@ -456,7 +659,7 @@ void ChainCumulFilter::OnSynchronizePathFromStart(int64 start) {
     if (next != old_nexts_[node] || vehicle != old_vehicles_[node]) {
       old_nexts_[node] = next;
       old_vehicles_[node] = vehicle;
-      current_transits_[node] = evaluators_[vehicle]->Run(node, next);
+      current_transits_[node] = GetTransit(vehicle, node, next);
     }
     cumul = CapAdd(cumul, current_transits_[node]);
     cumul = std::max(cumuls_[next]->Min(), cumul);
@@ -487,7 +690,7 @@ bool ChainCumulFilter::AcceptPath(int64 path_start, int64 chain_start,
         vehicle == old_vehicles_[node]) {
       cumul = CapAdd(cumul, current_transits_[node]);
     } else {
-      cumul = CapAdd(cumul, evaluators_[vehicle]->Run(node, next));
+      cumul = CapAdd(cumul, GetTransit(vehicle, node, next));
     }
     cumul = std::max(cumuls_[next]->Min(), cumul);
     if (cumul > capacity) return false;
@@ -503,6 +706,129 @@ bool ChainCumulFilter::AcceptPath(int64 path_start, int64 chain_start,
          CapAdd(cumul, end_cumul_delta) <= cumuls_[end]->Max();
 }
 
+// TimeDependentPathCumul filter.
+
+// Filter checking the cumul bounds of a time-dependent dimension: cumuls are
+// propagated along the paths from the earliest departure from the start, the
+// transit of each arc being evaluated at the departure time from its origin.
+// As transit functions are FIFO, leaving as early as possible is always
+// feasible if any departure time is. Soft bounds, span costs and slack
+// maxima are not filtered.
+class TimeDependentPathCumulFilter : public BasePathFilter {
+ public:
+  TimeDependentPathCumulFilter(const RoutingModel& routing_model,
+                               const RoutingDimension& dimension,
+                               Solver::ObjectiveWatcher objective_callback);
+  ~TimeDependentPathCumulFilter() override {}
+  std::string DebugString() const override {
+    return "TimeDependentPathCumulFilter(" + name_ + ")";
+  }
+
+ private:
+  void OnSynchronizePathFromStart(int64 start) override;
+  bool AcceptPath(int64 path_start, int64 chain_start,
+                  int64 chain_end) override;
+  int64 Capacity(int64 path_start) const {
+    return capacity_evaluator_ == nullptr
+               ? kint64max
+               : capacity_evaluator_->Run(start_to_vehicle_[path_start]);
+  }
+
+  const RoutingDimension& dimension_;
+  const std::vector<IntVar*> cumuls_;
+  const std::vector<IntVar*> slacks_;
+  std::vector<int64> start_to_vehicle_;
+  RoutingModel::VehicleEvaluator* const capacity_evaluator_;
+  // For each node on a path of the synchronized solution, its earliest cumul
+  // and the latest cumul for which the rest of the path remains feasible.
+  std::vector<int64> current_cumul_mins_;
+  std::vector<int64> current_max_feasible_cumuls_;
+  std::vector<int64> path_nodes_;
+  const std::string name_;
+};
+
+TimeDependentPathCumulFilter::TimeDependentPathCumulFilter(
+    const RoutingModel& routing_model, const RoutingDimension& dimension,
+    Solver::ObjectiveWatcher objective_callback)
+    : BasePathFilter(routing_model.Nexts(), dimension.cumuls().size(),
+                     objective_callback),
+      dimension_(dimension),
+      cumuls_(dimension.cumuls()),
+      slacks_(dimension.slacks()),
+      capacity_evaluator_(dimension.capacity_evaluator()),
+      current_cumul_mins_(dimension.cumuls().size(), 0),
+      current_max_feasible_cumuls_(dimension.cumuls().size(), kint64max),
+      name_(dimension.name()) {
+  start_to_vehicle_.resize(Size(), -1);
+  for (int i = 0; i < routing_model.vehicles(); ++i) {
+    start_to_vehicle_[routing_model.Start(i)] = i;
+  }
+}
+
+void TimeDependentPathCumulFilter::OnSynchronizePathFromStart(int64 start) {
+  const int64 capacity = Capacity(start);
+  path_nodes_.clear();
+  int64 node = start;
+  int64 cumul = cumuls_[node]->Min();
+  while (node < Size()) {
+    path_nodes_.push_back(node);
+    current_cumul_mins_[node] = cumul;
+    const int64 next = Value(node);
+    cumul = std::max(
+        cumuls_[next]->Min(),
+        CapAdd(dimension_.GetTransitProfile(node, next).Arrival(cumul),
+               slacks_[node]->Min()));
+    node = next;
+  }
+  current_cumul_mins_[node] = cumul;
+  int64 max_cumul = std::min(capacity, cumuls_[node]->Max());
+  current_max_feasible_cumuls_[node] = max_cumul;
+  for (int i = path_nodes_.size() - 1; i >= 0; --i) {
+    const int64 path_node = path_nodes_[i];
+    const int64 next = Value(path_node);
+    if (max_cumul != kint64min) {
+      max_cumul =
+          cumuls_[next]->Min() > max_cumul
+              ? kint64min
+              : std::min(std::min(capacity, cumuls_[path_node]->Max()),
+                         dimension_.GetTransitProfile(path_node, next)
+                             .LatestDeparture(
+                                 CapSub(max_cumul, slacks_[path_node]->Min())));
+    }
+    current_max_feasible_cumuls_[path_node] = max_cumul;
+  }
+}
+
+// The complexity of the method is O(size of chain (chain_start...chain_end)),
+// unless the last node of the chain was moved to another path, in which case
+// the rest of the path is scanned.
+bool TimeDependentPathCumulFilter::AcceptPath(int64 path_start,
+                                              int64 chain_start,
+                                              int64 chain_end) {
+  const int64 capacity = Capacity(path_start);
+  int64 node = chain_start;
+  int64 cumul = current_cumul_mins_[node];
+  while (node < Size()) {
+    const int64 next = GetNext(node);
+    if (next == kUnassigned) {
+      // LNS detected, return true since other paths were ok up to now.
+      return true;
+    }
+    if (node == chain_end && IsVarSynced(node) && next == Value(node)) {
+      // Nodes after chain_end are untouched.
+      return cumul <= current_max_feasible_cumuls_[node];
+    }
+    cumul = CapAdd(dimension_.GetTransitProfile(node, next).Arrival(cumul),
+                   slacks_[node]->Min());
+    if (cumul > std::min(capacity, cumuls_[next]->Max())) {
+      return false;
+    }
+    cumul = std::max(cumuls_[next]->Min(), cumul);
+    node = next;
+  }
+  return true;
+}
+
 // PathCumul filter.
 
 class PathCumulFilter : public BasePathFilter {
@@ -582,6 +908,19 @@ class PathCumulFilter : public BasePathFilter {
                   int64 chain_end) override;
   bool FinalizeAcceptPath() override;
   void OnBeforeSynchronizePaths() override;
+  void OnSynchronizePathFromStart(int64 start) override;
+
+  // Checks the feasibility of a path when no cost is filtered, only scanning
+  // the part of the path between chain_start and chain_end; the parts of the
+  // path before and after the chain are summarized by the values computed
+  // in OnSynchronizePathFromStart().
+  bool AcceptPathFeasibility(int64 path_start, int64 chain_start,
+                             int64 chain_end);
+
+  bool FilterPathCosts() const {
+    return FilterSpanCost() || FilterCumulSoftBounds() || FilterSlackCost() ||
+           FilterCumulSoftLowerBounds();
+  }
 
   bool FilterSpanCost() const { return global_span_cost_coefficient_ != 0; }
 
@@ -611,6 +950,20 @@ class PathCumulFilter : public BasePathFilter {
   int64 ComputePathMaxStartFromEndCumul(const PathTransits& path_transits,
                                         int path, int end_cumul) const;
 
+  int64 GetTransit(int vehicle, int64 node, int64 next) const {
+    return dimension_.HasTransitMatrix()
+               ? dimension_.GetMatrixTransitValue(node, next)
+               : evaluators_[vehicle]->Run(node, next);
+  }
+  // Evaluates the transits of the arcs stored in arc_tails_ and arc_heads_ by
+  // batch and stores them in arc_transits_.
+  void EvaluateArcTransits(int vehicle) {
+    arc_transits_.resize(arc_tails_.size());
+    dimension_.GetTransitValues(arc_tails_.data(), arc_heads_.data(), vehicle,
+                                arc_transits_.data(), arc_tails_.size());
+  }
+
+  const RoutingDimension& dimension_;
   const std::vector<IntVar*> cumuls_;
   const std::vector<IntVar*> slacks_;
   std::vector<int64> start_to_vehicle_;
@@ -631,6 +984,17 @@ class PathCumulFilter : public BasePathFilter {
   RoutingModel::VehicleEvaluator* const capacity_evaluator_;
   // Data reflecting information on paths and cumul variables for the solution
   // to which the filter was synchronized.
+  // Only maintained when no cost is filtered: for each node on a path, its
+  // propagated cumul min, the transit (including slack min) to its next node,
+  // and the maximum cumul value it can take for the rest of the path to remain
+  // feasible.
+  std::vector<int64> current_cumul_mins_;
+  std::vector<int64> current_transit_slacks_;
+  std::vector<int64> current_max_feasible_cumuls_;
+  // Arcs of the route being scanned and their transits.
+  std::vector<int64> arc_tails_;
+  std::vector<int64> arc_heads_;
+  std::vector<int64> arc_transits_;
   SupportedPathCumul current_min_start_;
   SupportedPathCumul current_max_end_;
   PathTransits current_path_transits_;
@@ -650,6 +1014,7 @@ PathCumulFilter::PathCumulFilter(const RoutingModel& routing_model,
                                  Solver::ObjectiveWatcher objective_callback)
     : BasePathFilter(routing_model.Nexts(), dimension.cumuls().size(),
                      objective_callback),
+      dimension_(dimension),
       cumuls_(dimension.cumuls()),
       slacks_(dimension.slacks()),
       evaluators_(routing_model.vehicles(), nullptr),
@@ -729,6 +1094,11 @@ PathCumulFilter::PathCumulFilter(const RoutingModel& routing_model,
     start_to_vehicle_[routing_model.Start(i)] = i;
     evaluators_[i] = dimension.transit_evaluator(i);
   }
+  if (!FilterPathCosts()) {
+    current_cumul_mins_.resize(cumuls_.size(), 0);
+    current_transit_slacks_.resize(Size(), 0);
+    current_max_feasible_cumuls_.resize(cumuls_.size(), kint64max);
+  }
 }
 
 int64 PathCumulFilter::GetCumulSoftCost(int64 node, int64 cumul_value) const {
@@ -773,8 +1143,7 @@ void PathCumulFilter::OnBeforeSynchronizePaths() {
   total_current_cumul_cost_value_ = 0;
   cumul_cost_delta_ = 0;
   current_cumul_cost_values_.clear();
-  if (FilterSpanCost() || FilterCumulSoftBounds() || FilterSlackCost() ||
-      FilterCumulSoftLowerBounds()) {
+  if (FilterPathCosts()) {
     InitializeSupportedPathCumul(&current_min_start_, kint64max);
     InitializeSupportedPathCumul(&current_max_end_, kint64min);
     current_path_transits_.Clear();
@@ -783,22 +1152,25 @@ void PathCumulFilter::OnBeforeSynchronizePaths() {
     for (int r = 0; r < NumPaths(); ++r) {
       int64 node = Start(r);
       const int vehicle = start_to_vehicle_[Start(r)];
-      // First pass: evaluating route length to reserve memory to store route
-      // information.
-      int number_of_route_arcs = 0;
+      // First pass: collecting route arcs to evaluate their transits and
+      // reserve memory to store route information.
+      arc_tails_.clear();
+      arc_heads_.clear();
       while (node < Size()) {
-        ++number_of_route_arcs;
+        arc_tails_.push_back(node);
         node = Value(node);
+        arc_heads_.push_back(node);
       }
-      current_path_transits_.ReserveTransits(r, number_of_route_arcs);
+      current_path_transits_.ReserveTransits(r, arc_tails_.size());
+      EvaluateArcTransits(vehicle);
       // Second pass: update cumul, transit and cost values.
       node = Start(r);
       int64 cumul = cumuls_[node]->Min();
       int64 current_cumul_cost_value = GetCumulSoftCost(node, cumul);
       int64 total_transit = 0;
-      while (node < Size()) {
-        const int64 next = Value(node);
-        const int64 transit = evaluators_[vehicle]->Run(node, next);
+      for (int arc = 0; arc < arc_tails_.size(); ++arc) {
+        const int64 next = arc_heads_[arc];
+        const int64 transit = arc_transits_[arc];
         total_transit = CapAdd(total_transit, transit);
         const int64 transit_slack = CapAdd(transit, slacks_[node]->Min());
         current_path_transits_.PushTransit(r, node, next, transit_slack);
@@ -855,8 +1227,84 @@ void PathCumulFilter::OnBeforeSynchronizePaths() {
   }
 }
 
+void PathCumulFilter::OnSynchronizePathFromStart(int64 start) {
+  if (FilterPathCosts()) return;
+  const int vehicle = start_to_vehicle_[start];
+  const int64 capacity = capacity_evaluator_ == nullptr
+                             ? kint64max
+                             : capacity_evaluator_->Run(vehicle);
+  std::vector<int64> path_nodes;
+  int64 node = start;
+  int64 cumul = cumuls_[node]->Min();
+  while (node < Size()) {
+    path_nodes.push_back(node);
+    current_cumul_mins_[node] = cumul;
+    const int64 next = Value(node);
+    const int64 transit_slack =
+        CapAdd(GetTransit(vehicle, node, next), slacks_[node]->Min());
+    current_transit_slacks_[node] = transit_slack;
+    cumul = std::max(cumuls_[next]->Min(), CapAdd(cumul, transit_slack));
+    node = next;
+  }
+  current_cumul_mins_[node] = cumul;
+  current_max_feasible_cumuls_[node] = kint64max;
+  for (int i = path_nodes.size() - 1; i >= 0; --i) {
+    const int64 path_node = path_nodes[i];
+    const int64 next = Value(path_node);
+    const int64 max_next_cumul =
+        std::min(std::min(capacity, cumuls_[next]->Max()),
+                 current_max_feasible_cumuls_[next]);
+    current_max_feasible_cumuls_[path_node] =
+        cumuls_[next]->Min() > current_max_feasible_cumuls_[next]
+            ? kint64min
+            : CapSub(max_next_cumul, current_transit_slacks_[path_node]);
+  }
+}
+
+// The complexity of the method is O(size of chain (chain_start...chain_end)),
+// unless the last node of the chain was moved to another path, in which case
+// the rest of the path is scanned.
+bool PathCumulFilter::AcceptPathFeasibility(int64 path_start,
+                                            int64 chain_start,
+                                            int64 chain_end) {
+  const int vehicle = start_to_vehicle_[path_start];
+  const int64 capacity = capacity_evaluator_ == nullptr
+                             ? kint64max
+                             : capacity_evaluator_->Run(vehicle);
+  // Nodes before chain_start are untouched, so the cumul of chain_start is
+  // unchanged.
+  int64 node = chain_start;
+  int64 cumul = current_cumul_mins_[node];
+  while (node < Size()) {
+    const int64 next = GetNext(node);
+    if (next == kUnassigned) {
+      // LNS detected, return true since other paths were ok up to now.
+      return true;
+    }
+    const bool synced_arc = IsVarSynced(node) && next == Value(node);
+    if (node == chain_end && synced_arc) {
+      // Nodes after chain_end are untouched.
+      return cumul <= current_max_feasible_cumuls_[node];
+    }
+    const int64 transit_slack =
+        synced_arc
+            ? current_transit_slacks_[node]
+            : CapAdd(GetTransit(vehicle, node, next), slacks_[node]->Min());
+    cumul = CapAdd(cumul, transit_slack);
+    if (cumul > std::min(capacity, cumuls_[next]->Max())) {
+      return false;
+    }
+    cumul = std::max(cumuls_[next]->Min(), cumul);
+    node = next;
+  }
+  return true;
+}
+
 bool PathCumulFilter::AcceptPath(int64 path_start, int64 chain_start,
                                  int64 chain_end) {
+  if (!FilterPathCosts()) {
+    return AcceptPathFeasibility(path_start, chain_start, chain_end);
+  }
   int64 node = path_start;
   int64 cumul = cumuls_[node]->Min();
   cumul_cost_delta_ = CapAdd(cumul_cost_delta_, GetCumulSoftCost(node, cumul));
@@ -866,8 +1314,10 @@ bool PathCumulFilter::AcceptPath(int64 path_start, int64 chain_start,
   const int64 capacity = capacity_evaluator_ == nullptr
                              ? kint64max
                              : capacity_evaluator_->Run(vehicle);
-  // Evaluating route length to reserve memory to store transit information.
-  int number_of_route_arcs = 0;
+  // Collecting route arcs to evaluate their transits by batch and reserve
+  // memory to store transit information.
+  arc_tails_.clear();
+  arc_heads_.clear();
   while (node < Size()) {
     const int64 next = GetNext(node);
     // TODO(user): This shouldn't be needed anymore as the such deltas should
@@ -877,17 +1327,19 @@ bool PathCumulFilter::AcceptPath(int64 path_start, int64 chain_start,
       lns_detected_ = true;
       return true;
     }
-    ++number_of_route_arcs;
+    arc_tails_.push_back(node);
+    arc_heads_.push_back(next);
     node = next;
   }
-  delta_path_transits_.ReserveTransits(path, number_of_route_arcs);
+  delta_path_transits_.ReserveTransits(path, arc_tails_.size());
+  EvaluateArcTransits(vehicle);
   // Check that the path is feasible with regards to cumul bounds, scanning
   // the paths from start to end (caching path node sequences and transits
   // for further span cost filtering).
   node = path_start;
-  while (node < Size()) {
-    const int64 next = GetNext(node);
-    const int64 transit = evaluators_[vehicle]->Run(node, next);
+  for (int arc = 0; arc < arc_tails_.size(); ++arc) {
+    const int64 next = arc_heads_[arc];
+    const int64 transit = arc_transits_[arc];
     total_transit = CapAdd(total_transit, transit);
     const int64 transit_slack = CapAdd(transit, slacks_[node]->Min());
     delta_path_transits_.PushTransit(path, node, next, transit_slack);
@@ -916,8 +1368,7 @@ bool PathCumulFilter::AcceptPath(int64 path_start, int64 chain_start,
         CapAdd(cumul_cost_delta_,
                GetPathCumulSoftLowerBoundCost(delta_path_transits_, path));
   }
-  if (FilterSpanCost() || FilterCumulSoftBounds() || FilterSlackCost() ||
-      FilterCumulSoftLowerBounds()) {
+  if (FilterPathCosts()) {
     delta_paths_.insert(GetPath(path_start));
     delta_max_end_cumul_ = std::max(delta_max_end_cumul_, cumul);
     cumul_cost_delta_ =
@@ -927,9 +1378,7 @@ bool PathCumulFilter::AcceptPath(int64 path_start, int64 chain_start,
 }
 
 bool PathCumulFilter::FinalizeAcceptPath() {
-  if ((!FilterSpanCost() && !FilterCumulSoftBounds() && !FilterSlackCost() &&
-       !FilterCumulSoftLowerBounds()) ||
-      lns_detected_) {
+  if (!FilterPathCosts() || lns_detected_) {
     // Cleaning up for the next delta.
     delta_max_end_cumul_ = kint64min;
     delta_paths_.clear();
@@ -1026,6 +1475,10 @@ int64 PathCumulFilter::ComputePathMaxStartFromEndCumul(
 RoutingLocalSearchFilter* MakePathCumulFilter(
     const RoutingModel& routing_model, const RoutingDimension& dimension,
     Solver::ObjectiveWatcher objective_callback) {
+  if (dimension.HasTimeDependentTransits()) {
+    return routing_model.solver()->RevAlloc(new TimeDependentPathCumulFilter(
+        routing_model, dimension, objective_callback));
+  }
   for (const int64 upper_bound : dimension.vehicle_span_upper_bounds()) {
     if (upper_bound != kint64max) {
       return routing_model.solver()->RevAlloc(
@@ -1074,6 +1527,11 @@ RoutingLocalSearchFilter* MakePathCumulFilter(
 namespace {
 
 // Node precedence filter, resulting from pickup and delivery pairs.
+// Only the subchain of a path which changed is walked: the nodes before and
+// after it keep their synchronized ranks, which are used to check the
+// precedences with the nodes of the subchain in O(1). The complexity of
+// checking a path is therefore linear in the size of the changed subchain
+// instead of the size of the path.
 class NodePrecedenceFilter : public BasePathFilter {
  public:
   NodePrecedenceFilter(const std::vector<IntVar*>& nexts, int next_domain_size,
@@ -1084,9 +1542,20 @@ class NodePrecedenceFilter : public BasePathFilter {
   std::string DebugString() const override { return "NodePrecedenceFilter"; }
 
  private:
+  // Checks the whole path starting at path_start.
+  bool AcceptFullPath(int64 path_start);
+  // Returns true if node is active on the path starting at path_start in the
+  // synchronized solution.
+  bool IsSyncedOnPath(int64 node, int64 path_start) const {
+    return IsVarSynced(node) && Value(node) != node &&
+           GetPathStartOfNode(node) == path_start;
+  }
+
   std::vector<int> pair_firsts_;
   std::vector<int> pair_seconds_;
   SparseBitset<> visited_;
+  // Position of visited nodes in the walked subchain.
+  std::vector<int> positions_;
 };
 
 NodePrecedenceFilter::NodePrecedenceFilter(const std::vector<IntVar*>& nexts,
@@ -1095,7 +1564,8 @@ NodePrecedenceFilter::NodePrecedenceFilter(const std::vector<IntVar*>& nexts,
     : BasePathFilter(nexts, next_domain_size, nullptr),
       pair_firsts_(next_domain_size, kUnassigned),
       pair_seconds_(next_domain_size, kUnassigned),
-      visited_(Size()) {
+      visited_(Size()),
+      positions_(Size(), 0) {
   for (const std::pair<int64, int64> node_pair : pairs) {
     pair_firsts_[node_pair.first] = node_pair.second;
     pair_seconds_[node_pair.second] = node_pair.first;
@@ -1104,6 +1574,85 @@ NodePrecedenceFilter::NodePrecedenceFilter(const std::vector<IntVar*>& nexts,
 
 bool NodePrecedenceFilter::AcceptPath(int64 path_start, int64 chain_start,
                                       int64 chain_end) {
+  // The ranks of the subchain bounds are only meaningful if they are still
+  // active on the path in the synchronized solution.
+  if (chain_start == kUnassigned || chain_start >= Size() ||
+      !IsSyncedOnPath(chain_start, path_start)) {
+    return AcceptFullPath(path_start);
+  }
+  visited_.ClearAll();
+  // Walking the new subchain; the walk can stop at chain_end if its next is
+  // unchanged, in which case the rest of the path is unchanged too.
+  bool suffix_unchanged = false;
+  int64 node = chain_start;
+  int position = 0;
+  while (node < Size()) {
+    if (position > Size()) {
+      // Sub-cycle detected.
+      return false;
+    }
+    visited_.Set(node);
+    positions_[node] = position;
+    const int64 next = GetNext(node);
+    if (next == kUnassigned) {
+      // LNS detected, return true since path was ok up to now.
+      return true;
+    }
+    if (node == chain_end && IsVarSynced(node) && next == Value(node)) {
+      suffix_unchanged = true;
+      break;
+    }
+    node = next;
+    ++position;
+  }
+  const int start_rank = GetRank(chain_start);
+  const int end_rank =
+      suffix_unchanged ? GetRank(chain_end) : kint32max;
+  auto in_prefix = [this, path_start, start_rank](int64 n) {
+    return IsSyncedOnPath(n, path_start) && GetRank(n) < start_rank;
+  };
+  auto in_suffix = [this, path_start, end_rank](int64 n) {
+    return IsSyncedOnPath(n, path_start) && GetRank(n) > end_rank;
+  };
+  for (const int64 visited : visited_.PositionsSetAtLeastOnce()) {
+    const int delivery = pair_firsts_[visited];
+    if (delivery != kUnassigned) {
+      if (visited_[delivery]) {
+        if (positions_[delivery] < positions_[visited]) return false;
+      } else if (!in_suffix(delivery)) {
+        return false;
+      }
+    }
+    const int pickup = pair_seconds_[visited];
+    if (pickup != kUnassigned) {
+      if (visited_[pickup]) {
+        if (positions_[pickup] > positions_[visited]) return false;
+      } else if (!in_prefix(pickup)) {
+        return false;
+      }
+    }
+  }
+  // Nodes which were removed from the subchain must not leave their sibling
+  // on the path.
+  node = chain_start;
+  position = 0;
+  while (node < Size() && IsVarSynced(node) && position <= Size()) {
+    if (!visited_[node]) {
+      for (const int sibling : {pair_firsts_[node], pair_seconds_[node]}) {
+        if (sibling != kUnassigned &&
+            (visited_[sibling] || in_prefix(sibling) || in_suffix(sibling))) {
+          return false;
+        }
+      }
+    }
+    if (node == chain_end) break;
+    node = Value(node);
+    ++position;
+  }
+  return true;
+}
+
+bool NodePrecedenceFilter::AcceptFullPath(int64 path_start) {
   visited_.ClearAll();
   int64 node = path_start;
   int64 path_length = 1;
@@ -1455,6 +2004,102 @@ int64 CheapestInsertionFilteredDecisionBuilder::GetUnperformedValue(
   return kint64max;
 }
 
+void CheapestInsertionFilteredDecisionBuilder::ComputeVehiclesToEvaluate(
+    std::vector<int>* vehicles) {
+  CHECK(vehicles != nullptr);
+  vehicles->clear();
+  equivalent_empty_vehicles_.clear();
+  equivalent_empty_vehicles_.resize(model()->GetVehicleClassesCount());
+  std::vector<bool> class_has_empty_vehicle(model()->GetVehicleClassesCount(),
+                                            false);
+  for (int vehicle = 0; vehicle < model()->vehicles(); ++vehicle) {
+    const int64 start = model()->Start(vehicle);
+    if (Contains(start) && !model()->IsEnd(Value(start))) {
+      vehicles->push_back(vehicle);
+      continue;
+    }
+    const RoutingModel::VehicleClassIndex vehicle_class =
+        model()->GetVehicleClassIndexOfVehicle(vehicle);
+    if (class_has_empty_vehicle[vehicle_class.value()]) {
+      equivalent_empty_vehicles_[vehicle_class].push_back(vehicle);
+    } else {
+      class_has_empty_vehicle[vehicle_class.value()] = true;
+      vehicles->push_back(vehicle);
+    }
+  }
+  // Vehicles are popped from the back; keep the original vehicle order.
+  for (std::vector<int>& empty_vehicles : equivalent_empty_vehicles_) {
+    std::reverse(empty_vehicles.begin(), empty_vehicles.end());
+  }
+}
+
+int CheapestInsertionFilteredDecisionBuilder::PopEquivalentEmptyVehicle(
+    int vehicle) {
+  if (equivalent_empty_vehicles_.empty()) return -1;
+  std::vector<int>& empty_vehicles =
+      equivalent_empty_vehicles_[model()->GetVehicleClassIndexOfVehicle(
+          vehicle)];
+  if (empty_vehicles.empty()) return -1;
+  const int empty_vehicle = empty_vehicles.back();
+  empty_vehicles.pop_back();
+  return empty_vehicle;
+}
+
+void CheapestInsertionFilteredDecisionBuilder::InitializeCumulWindows() {
+  cumul_windows_.clear();
+  std::vector<std::string> dimension_names;
+  model()->GetAllDimensions(&dimension_names);
+  for (const std::string& name : dimension_names) {
+    const RoutingDimension& dimension = model()->GetDimensionOrDie(name);
+    const std::vector<IntVar*>& cumuls = dimension.cumuls();
+    CumulWindows windows;
+    windows.dimension = &dimension;
+    windows.mins.resize(cumuls.size());
+    windows.maxes.resize(cumuls.size());
+    int64 cumul_max = kint64min;
+    for (int i = 0; i < cumuls.size(); ++i) {
+      windows.mins[i] = cumuls[i]->Min();
+      windows.maxes[i] = cumuls[i]->Max();
+      cumul_max = std::max(cumul_max, windows.maxes[i]);
+    }
+    // Only keep dimensions in which some node has a restricted window; other
+    // dimensions cannot prune any position.
+    bool has_windows = false;
+    for (int i = 0; i < model()->Size(); ++i) {
+      if (!model()->IsStart(i) &&
+          (windows.mins[i] > 0 || windows.maxes[i] < cumul_max)) {
+        has_windows = true;
+        break;
+      }
+    }
+    if (has_windows) {
+      cumul_windows_.push_back(std::move(windows));
+    }
+  }
+}
+
+bool CheapestInsertionFilteredDecisionBuilder::
+    IsInsertionCompatibleWithCumulWindows(int64 node, int64 insert_after,
+                                          int64 insert_before,
+                                          int64 vehicle) const {
+  // Slacks being non-negative, cumuls can only be larger than the earliest
+  // cumul obtained by following the transits from the minimum cumul of
+  // 'insert_after'.
+  for (const CumulWindows& windows : cumul_windows_) {
+    const int64 node_cumul =
+        std::max(windows.mins[node],
+                 CapAdd(windows.mins[insert_after],
+                        windows.dimension->GetTransitValue(insert_after, node,
+                                                           vehicle)));
+    if (node_cumul > windows.maxes[node]) return false;
+    const int64 next_cumul = CapAdd(
+        node_cumul,
+        windows.dimension->GetTransitValue(node, insert_before, vehicle));
+    if (next_cumul > windows.maxes[insert_before]) return false;
+  }
+  return true;
+}
+
 namespace {
 template <class T>
 void SortAndExtractPairSeconds(std::vector<std::pair<int64, T>>* pairs,
@@ -1572,6 +2217,10 @@ bool GlobalCheapestInsertionFilteredDecisionBuilder::BuildSolution() {
     return false;
   }
   InsertPairs();
+  // Cumul windows are only used to prune single node insertions: the test
+  // assumes nothing is inserted between the node and its successor, which
+  // does not hold for pickups.
+  InitializeCumulWindows();
   InsertNodes();
   MakeUnassignedNodesUnperformed();
   return Commit();
@@ -1615,6 +2264,18 @@ void GlobalCheapestInsertionFilteredDecisionBuilder::InsertPairs() {
           const int64 delivery_after = entry->delivery_insert_after();
           const int64 delivery = entry->delivery_to_insert();
           const int vehicle = entry->vehicle();
+          if (pickup_after == model()->Start(vehicle) &&
+              delivery_after == pickup &&
+              model()->IsEnd(Value(delivery))) {
+            // The route was empty; insertions on an equivalent empty vehicle
+            // now have to be considered.
+            const int empty_vehicle = PopEquivalentEmptyVehicle(vehicle);
+            if (empty_vehicle != -1) {
+              UpdatePairPositions(empty_vehicle, model()->Start(empty_vehicle),
+                                  &priority_queue, &pickup_to_entries,
+                                  &delivery_to_entries);
+            }
+          }
           UpdatePairPositions(vehicle, pickup_after, &priority_queue,
                               &pickup_to_entries, &delivery_to_entries);
           UpdatePairPositions(vehicle, pickup, &priority_queue,
@@ -1655,6 +2316,17 @@ void GlobalCheapestInsertionFilteredDecisionBuilder::InsertNodes() {
                       Value(node_entry->insert_after()));
         if (Commit()) {
           const int vehicle = node_entry->vehicle();
+          const int64 start = model()->Start(vehicle);
+          if (node_entry->insert_after() == start &&
+              model()->IsEnd(Value(node_entry->node_to_insert()))) {
+            // The route was empty; insertions on an equivalent empty vehicle
+            // now have to be considered.
+            const int empty_vehicle = PopEquivalentEmptyVehicle(vehicle);
+            if (empty_vehicle != -1) {
+              UpdatePositions(empty_vehicle, model()->Start(empty_vehicle),
+                              &priority_queue, &position_to_node_entries);
+            }
+          }
           UpdatePositions(vehicle, node_entry->node_to_insert(),
                           &priority_queue, &position_to_node_entries);
           UpdatePositions(vehicle, node_entry->insert_after(), &priority_queue,
@@ -1666,6 +2338,10 @@ void GlobalCheapestInsertionFilteredDecisionBuilder::InsertNodes() {
       }
     }
   }
+  // Delete the entries which were kept out of the priority queue.
+  for (NodeEntries& entries : position_to_node_entries) {
+    STLDeleteElements(&entries);
+  }
 }
 
 void GlobalCheapestInsertionFilteredDecisionBuilder::InitializePairPositions(
@@ -1681,6 +2357,8 @@ void GlobalCheapestInsertionFilteredDecisionBuilder::InitializePairPositions(
   pickup_to_entries->resize(model()->Size());
   delivery_to_entries->clear();
   delivery_to_entries->resize(model()->Size());
+  std::vector<int> vehicles;
+  ComputeVehiclesToEvaluate(&vehicles);
   for (const RoutingModel::NodePair node_pair :
        model()->GetPickupAndDeliveryPairs()) {
     const int64 pickup = node_pair.first;
@@ -1707,7 +2385,7 @@ void GlobalCheapestInsertionFilteredDecisionBuilder::InitializePairPositions(
     // Add all other insertion entries with pair performed.
     std::vector<std::pair<std::pair<int64, int>, std::pair<int64, int64>>>
         valued_positions;
-    for (int vehicle = 0; vehicle < model()->vehicles(); ++vehicle) {
+    for (const int vehicle : vehicles) {
       std::vector<ValuedPosition> valued_pickup_positions;
       const int64 start = model()->Start(vehicle);
       AppendEvaluatedPositionsAfter(pickup, start, Value(start), vehicle,
@@ -1974,37 +2652,32 @@ void GlobalCheapestInsertionFilteredDecisionBuilder::InitializePositions(
   priority_queue->Clear();
   position_to_node_entries->clear();
   position_to_node_entries->resize(model()->Size());
+  std::vector<int> vehicles;
+  ComputeVehiclesToEvaluate(&vehicles);
   for (int node = 0; node < model()->Size(); ++node) {
     if (Contains(node)) {
       continue;
     }
     const int64 node_penalty = GetUnperformedValue(node);
-    int64 penalty =
-        FLAGS_routing_shift_insertion_cost_by_penalty ? kint64max : 0;
     // Add insertion entry making node unperformed.
     if (node_penalty != kint64max) {
       NodeEntry* const node_entry = new NodeEntry(node, -1, -1);
-      if (FLAGS_routing_shift_insertion_cost_by_penalty) {
-        node_entry->set_value(0);
-        penalty = node_penalty;
-      } else {
-        node_entry->set_value(node_penalty);
-        penalty = 0;
-      }
+      node_entry->set_value(
+          FLAGS_routing_shift_insertion_cost_by_penalty ? 0 : node_penalty);
       priority_queue->Add(node_entry);
     }
     // Add all insertion entries making node performed.
-    for (int vehicle = 0; vehicle < model()->vehicles(); ++vehicle) {
-      std::vector<ValuedPosition> valued_positions;
-      const int64 start = model()->Start(vehicle);
-      AppendEvaluatedPositionsAfter(node, start, Value(start), vehicle,
-                                    &valued_positions);
-      for (const std::pair<int64, int64>& valued_position : valued_positions) {
+    for (const int vehicle : vehicles) {
+      int64 insert_after = model()->Start(vehicle);
+      while (!model()->IsEnd(insert_after)) {
+        const int64 insert_before = Value(insert_after);
         NodeEntry* const node_entry =
-            new NodeEntry(node, valued_position.second, vehicle);
-        node_entry->set_value(CapSub(valued_position.first, penalty));
-        position_to_node_entries->at(valued_position.second).insert(node_entry);
-        priority_queue->Add(node_entry);
+            new NodeEntry(node, insert_after, vehicle);
+        position_to_node_entries->at(insert_after).insert(node_entry);
+        UpdateNodeEntry(node_entry, insert_before,
+                        evaluator_->Run(insert_after, insert_before, vehicle),
+                        priority_queue);
+        insert_after = insert_before;
       }
     }
   }
@@ -2019,9 +2692,7 @@ void GlobalCheapestInsertionFilteredDecisionBuilder::UpdatePositions(
         node_entries) {
   // Either create new entries if we are inserting after a newly inserted node
   // or remove entries which have already been inserted.
-  bool update = true;
   if (node_entries->at(insert_after).empty()) {
-    update = false;
     for (int node_to_insert = 0; node_to_insert < model()->Size();
          ++node_to_insert) {
       if (!Contains(node_to_insert)) {
@@ -2033,41 +2704,52 @@ void GlobalCheapestInsertionFilteredDecisionBuilder::UpdatePositions(
   } else {
     std::vector<NodeEntry*> to_remove;
     for (NodeEntry* const node_entry : node_entries->at(insert_after)) {
-      if (priority_queue->Contains(node_entry)) {
-        DCHECK_EQ(node_entry->insert_after(), insert_after);
-        if (Contains(node_entry->node_to_insert())) {
-          to_remove.push_back(node_entry);
-        }
+      DCHECK_EQ(node_entry->insert_after(), insert_after);
+      if (Contains(node_entry->node_to_insert())) {
+        to_remove.push_back(node_entry);
       }
     }
     for (NodeEntry* const node_entry : to_remove) {
       DeleteNodeEntry(node_entry, priority_queue, node_entries);
     }
   }
-  // Compute new value of entries and either update the priority queue
-  // accordingly if the entry already existed or add it to the queue if it's
-  // new.
+  // Compute new value of entries and update the priority queue accordingly.
   DCHECK_GE(model()->Size(), node_entries->at(insert_after).size());
   const int64 insert_before = Value(insert_after);
   const int64 old_value = evaluator_->Run(insert_after, insert_before, vehicle);
   for (NodeEntry* const node_entry : node_entries->at(insert_after)) {
     DCHECK_EQ(node_entry->insert_after(), insert_after);
-    const int64 value =
-        CapSub(CapAdd(evaluator_->Run(insert_after,
-                                      node_entry->node_to_insert(), vehicle),
-                      evaluator_->Run(node_entry->node_to_insert(),
-                                      insert_before, vehicle)),
-               old_value);
-    const int64 penalty =
-        FLAGS_routing_shift_insertion_cost_by_penalty
-            ? GetUnperformedValue(node_entry->node_to_insert())
-            : 0;
-    node_entry->set_value(CapSub(value, penalty));
-    if (update) {
-      priority_queue->NoteChangedPriority(node_entry);
-    } else {
-      priority_queue->Add(node_entry);
+    UpdateNodeEntry(node_entry, insert_before, old_value, priority_queue);
+  }
+}
+
+void GlobalCheapestInsertionFilteredDecisionBuilder::UpdateNodeEntry(
+    NodeEntry* node_entry, int64 insert_before, int64 old_value,
+    AdjustablePriorityQueue<NodeEntry>* priority_queue) {
+  const int64 node_to_insert = node_entry->node_to_insert();
+  const int64 insert_after = node_entry->insert_after();
+  const int vehicle = node_entry->vehicle();
+  // Entries which cannot satisfy cumul windows are kept out of the priority
+  // queue (without running the evaluator) until their position changes.
+  if (!IsInsertionCompatibleWithCumulWindows(node_to_insert, insert_after,
+                                             insert_before, vehicle)) {
+    if (priority_queue->Contains(node_entry)) {
+      priority_queue->Remove(node_entry);
     }
+    return;
+  }
+  const int64 value = CapSub(
+      CapAdd(evaluator_->Run(insert_after, node_to_insert, vehicle),
+             evaluator_->Run(node_to_insert, insert_before, vehicle)),
+      old_value);
+  const int64 penalty = FLAGS_routing_shift_insertion_cost_by_penalty
+                            ? GetUnperformedValue(node_to_insert)
+                            : 0;
+  node_entry->set_value(CapSub(value, penalty));
+  if (priority_queue->Contains(node_entry)) {
+    priority_queue->NoteChangedPriority(node_entry);
+  } else {
+    priority_queue->Add(node_entry);
   }
 }
 
@@ -2077,7 +2759,9 @@ void GlobalCheapestInsertionFilteredDecisionBuilder::DeleteNodeEntry(
         GlobalCheapestInsertionFilteredDecisionBuilder::NodeEntry>*
         priority_queue,
     std::vector<NodeEntries>* node_entries) {
-  priority_queue->Remove(entry);
+  if (priority_queue->Contains(entry)) {
+    priority_queue->Remove(entry);
+  }
   if (entry->insert_after() != -1) {
     node_entries->at(entry->insert_after()).erase(entry);
   }
@@ -2169,7 +2853,9 @@ void LocalCheapestInsertionFilteredDecisionBuilder::
   const int size = model()->Size();
   if (node < size) {
     std::vector<std::pair<int64, int64>> valued_positions;
-    for (int vehicle = 0; vehicle < model()->vehicles(); ++vehicle) {
+    std::vector<int> vehicles;
+    ComputeVehiclesToEvaluate(&vehicles);
+    for (const int vehicle : vehicles) {
       const int64 start = model()->Start(vehicle);
       AppendEvaluatedPositionsAfter(node, start, Value(start), vehicle,
                                     &valued_positions);
@@ -2364,11 +3050,59 @@ void ComparatorCheapestAdditionFilteredDecisionBuilder::SortPossibleNexts(
 
 SavingsFilteredDecisionBuilder::SavingsFilteredDecisionBuilder(
     RoutingModel* model, int64 saving_neighbors,
-    const std::vector<LocalSearchFilter*>& filters)
+    const std::vector<LocalSearchFilter*>& filters, int num_threads)
     : RoutingFilteredDecisionBuilder(model, filters),
       saving_neighbors_(saving_neighbors),
+      num_threads_(num_threads),
       size_squared_(0) {}
 
+namespace {
+// Sorts the savings by sorting num_threads chunks in parallel, then merging
+// pairs of sorted runs in parallel until one is left. The result is the same
+// as std::sort since the savings are pairwise distinct.
+template <class T>
+void ParallelSort(int num_threads, std::vector<T>* values) {
+  // Below this size per thread, the threads cost more than they save.
+  const int64 kMinValuesPerThread = 1 << 16;
+  const int64 size = values->size();
+  const int64 num_runs =
+      std::min<int64>(num_threads, size / kMinValuesPerThread);
+  if (num_runs <= 1) {
+    std::sort(values->begin(), values->end());
+    return;
+  }
+  std::vector<int64> run_starts;
+  for (int64 run = 0; run <= num_runs; ++run) {
+    run_starts.push_back(size * run / num_runs);
+  }
+  ThreadPool pool("SavingsSort", num_threads);
+  pool.StartWorkers();
+  pool.ParallelFor(num_runs, 1, [values, &run_starts](int64 begin, int64 end) {
+    for (int64 run = begin; run < end; ++run) {
+      std::sort(values->begin() + run_starts[run],
+                values->begin() + run_starts[run + 1]);
+    }
+  });
+  while (run_starts.size() > 2) {
+    const int64 num_merges = (run_starts.size() - 1) / 2;
+    pool.ParallelFor(num_merges, 1,
+                     [values, &run_starts](int64 begin, int64 end) {
+      for (int64 merge = begin; merge < end; ++merge) {
+        std::inplace_merge(values->begin() + run_starts[2 * merge],
+                           values->begin() + run_starts[2 * merge + 1],
+                           values->begin() + run_starts[2 * merge + 2]);
+      }
+    });
+    std::vector<int64> merged_run_starts;
+    for (int i = 0; i < run_starts.size(); i += 2) {
+      merged_run_starts.push_back(run_starts[i]);
+    }
+    if (merged_run_starts.back() != size) merged_run_starts.push_back(size);
+    run_starts.swap(merged_run_starts);
+  }
+}
+}  // namespace
+
 bool SavingsFilteredDecisionBuilder::BuildSolution() {
   if (!InitializeRoutes()) {
     return false;
@@ -2378,16 +3112,36 @@ bool SavingsFilteredDecisionBuilder::BuildSolution() {
   std::vector<Saving> savings = ComputeSavings();
   // Store savings for each incoming and outgoing node and by cost class. This
   // is necessary to quickly extend partial chains without scanning all savings.
+  // The savings of (cost class c, node n) are the indices in
+  // [starts[c * size + n], starts[c * size + n + 1]) of the flat arrays, in
+  // increasing order of savings.
   const int cost_classes = model()->GetCostClassesCount();
-  std::vector<std::vector<int>> in_savings(size * cost_classes);
-  std::vector<std::vector<int>> out_savings(size * cost_classes);
-  for (int i = 0; i < savings.size(); ++i) {
-    const Saving& saving = savings[i];
+  std::vector<int> in_saving_starts(size * cost_classes + 1, 0);
+  std::vector<int> out_saving_starts(size * cost_classes + 1, 0);
+  for (const Saving& saving : savings) {
     const int cost_class_offset = GetCostClassFromSaving(saving) * size;
-    const int before_node = GetBeforeNodeFromSaving(saving);
-    in_savings[cost_class_offset + before_node].push_back(i);
-    const int after_node = GetAfterNodeFromSaving(saving);
-    out_savings[cost_class_offset + after_node].push_back(i);
+    ++in_saving_starts[cost_class_offset + GetBeforeNodeFromSaving(saving) + 1];
+    ++out_saving_starts[cost_class_offset + GetAfterNodeFromSaving(saving) + 1];
+  }
+  for (int i = 0; i < size * cost_classes; ++i) {
+    in_saving_starts[i + 1] += in_saving_starts[i];
+    out_saving_starts[i + 1] += out_saving_starts[i];
+  }
+  std::vector<int> in_savings(savings.size());
+  std::vector<int> out_savings(savings.size());
+  {
+    std::vector<int> in_positions(in_saving_starts.begin(),
+                                  in_saving_starts.end() - 1);
+    std::vector<int> out_positions(out_saving_starts.begin(),
+                                   out_saving_starts.end() - 1);
+    for (int i = 0; i < savings.size(); ++i) {
+      const Saving& saving = savings[i];
+      const int cost_class_offset = GetCostClassFromSaving(saving) * size;
+      const int before_node = GetBeforeNodeFromSaving(saving);
+      in_savings[in_positions[cost_class_offset + before_node]++] = i;
+      const int after_node = GetAfterNodeFromSaving(saving);
+      out_savings[out_positions[cost_class_offset + after_node]++] = i;
+    }
   }
   // Build routes from savings.
   std::vector<bool> closed(model()->vehicles(), false);
@@ -2417,12 +3171,14 @@ bool SavingsFilteredDecisionBuilder::BuildSolution() {
         int in_index = 0;
         int out_index = 0;
         const int saving_offset = cost_class * size;
-        while (in_index < in_savings[saving_offset + after_node].size() &&
-               out_index < out_savings[saving_offset + before_node].size()) {
-          const Saving& in_saving =
-              savings[in_savings[saving_offset + after_node][in_index]];
-          const Saving& out_saving =
-              savings[out_savings[saving_offset + before_node][out_index]];
+        while (in_saving_starts[saving_offset + after_node] + in_index <
+                   in_saving_starts[saving_offset + after_node + 1] &&
+               out_saving_starts[saving_offset + before_node] + out_index <
+                   out_saving_starts[saving_offset + before_node + 1]) {
+          const Saving& in_saving = savings[in_savings
+              [in_saving_starts[saving_offset + after_node] + in_index]];
+          const Saving& out_saving = savings[out_savings
+              [out_saving_starts[saving_offset + before_node] + out_index]];
           if (GetSavingValue(in_saving) < GetSavingValue(out_saving)) {
             // Extending after after_node
             const int after_after_node = GetAfterNodeFromSaving(in_saving);
@@ -2478,6 +3234,16 @@ SavingsFilteredDecisionBuilder::ComputeSavings() const {
       class_covered[cost_class] = true;
       const int64 start = model()->Start(vehicle);
       const int64 end = model()->End(vehicle);
+      // The cost of the arcs from the start, which does not depend on the
+      // node before.
+      std::vector<int64> start_costs(size, 0);
+      for (int node = 0; node < size; ++node) {
+        if (!Contains(node) && !model()->IsEnd(node) &&
+            !model()->IsStart(node)) {
+          start_costs[node] =
+              model()->GetArcCostForClass(start, node, cost_class);
+        }
+      }
       for (int before_node = 0; before_node < size; ++before_node) {
         if (!Contains(before_node) && !model()->IsEnd(before_node) &&
             !model()->IsStart(before_node)) {
@@ -2501,10 +3267,9 @@ SavingsFilteredDecisionBuilder::ComputeSavings() const {
             costed_after_nodes.resize(saving_neighbors);
           }
           for (const auto& after_node : costed_after_nodes) {
-            const int64 saving = CapSub(
-                CapAdd(in_saving, model()->GetArcCostForClass(
-                                      start, after_node.second, cost_class)),
-                after_node.first);
+            const int64 saving =
+                CapSub(CapAdd(in_saving, start_costs[after_node.second]),
+                       after_node.first);
             savings.push_back(BuildSaving(-saving, cost_class, before_node,
                                           after_node.second));
           }
@@ -2512,7 +3277,7 @@ SavingsFilteredDecisionBuilder::ComputeSavings() const {
       }
     }
   }
-  std::sort(savings.begin(), savings.end());
+  ParallelSort(num_threads_, &savings);
   return savings;
 }
 }  // namespace operations_research
@@ -12,6 +12,7 @@
 // limitations under the License.
 
 
+#include <algorithm>
 #include <cstring>
 #include <string>
 #include <vector>
@@ -40,8 +41,20 @@ SequenceVar::SequenceVar(Solver* const s, const std::vector<IntervalVar*>& inter
     : PropagationBaseObject(s),
       intervals_(intervals),
       nexts_(nexts),
-      previous_(nexts.size() + 1, -1) {
+      previous_(nexts.size() + 1, -1),
+      forward_frontier_(0),
+      backward_frontier_(nexts.size()),
+      unranked_(intervals.size()),
+      unranked_position_(intervals.size()),
+      num_unranked_(intervals.size()),
+      num_ranked_(0),
+      num_unperformed_(0),
+      ranking_previous_(nexts.size() + 1, -1) {
   set_name(name);
+  for (int i = 0; i < intervals_.size(); ++i) {
+    unranked_[i] = i;
+    unranked_position_[i] = i;
+  }
 }
 
 SequenceVar::~SequenceVar() {}
@@ -104,37 +117,13 @@ void SequenceVar::HorizonRange(int64* const hmin, int64* const hmax) const {
 
 void SequenceVar::ActiveHorizonRange(int64* const hmin,
                                      int64* const hmax) const {
-  hash_set<int> decided;
-  for (int i = 0; i < intervals_.size(); ++i) {
-    if (intervals_[i]->CannotBePerformed()) {
-      decided.insert(i);
-    }
-  }
-  int first = 0;
-  while (nexts_[first]->Bound()) {
-    first = nexts_[first]->Min();
-    if (first < nexts_.size()) {
-      decided.insert(ValueToIndex(first));
-    } else {
-      break;
-    }
-  }
-  if (first != nexts_.size()) {
-    UpdatePrevious();
-    int last = nexts_.size();
-    while (previous_[last] != -1) {
-      last = previous_[last];
-      decided.insert(ValueToIndex(last));
-    }
-  }
+  UpdateRanking();
   int64 hor_min = kint64max;
   int64 hor_max = kint64min;
-  for (int i = 0; i < intervals_.size(); ++i) {
-    if (!ContainsKey(decided, i)) {
-      IntervalVar* const t = intervals_[i];
-      hor_min = std::min(hor_min, t->StartMin());
-      hor_max = std::max(hor_max, t->EndMax());
-    }
+  for (int i = 0; i < num_unranked_.Value(); ++i) {
+    IntervalVar* const t = intervals_[unranked_[i]];
+    hor_min = std::min(hor_min, t->StartMin());
+    hor_max = std::max(hor_max, t->EndMax());
   }
   *hmin = hor_min;
   *hmax = hor_max;
@@ -142,40 +131,22 @@ void SequenceVar::ActiveHorizonRange(int64* const hmin,
 
 void SequenceVar::ComputeStatistics(int* const ranked, int* const not_ranked,
                                     int* const unperformed) const {
-  *unperformed = 0;
-  for (int i = 0; i < intervals_.size(); ++i) {
-    if (intervals_[i]->CannotBePerformed()) {
-      (*unperformed)++;
-    }
-  }
-  *ranked = 0;
-  int first = 0;
-  while (first < nexts_.size() && nexts_[first]->Bound()) {
-    first = nexts_[first]->Min();
-    (*ranked)++;
-  }
-  if (first != nexts_.size()) {
-    UpdatePrevious();
-    int last = nexts_.size();
-    while (previous_[last] != -1) {
-      last = previous_[last];
-      (*ranked)++;
-    }
-  } else {  // We counted the sentinel.
-    (*ranked)--;
-  }
-  *not_ranked = intervals_.size() - *ranked - *unperformed;
+  UpdateRanking();
+  *ranked = num_ranked_.Value();
+  *not_ranked = num_unranked_.Value();
+  *unperformed = num_unperformed_.Value();
 }
 
 int SequenceVar::ComputeForwardFrontier() {
-  int first = 0;
-  while (first != nexts_.size() && nexts_[first]->Bound()) {
-    first = nexts_[first]->Min();
-  }
-  return first;
+  UpdateRanking();
+  return forward_frontier_.Value();
 }
 
 int SequenceVar::ComputeBackwardFrontier() {
+  UpdateRanking();
+  if (forward_frontier_.Value() != nexts_.size()) {
+    return backward_frontier_.Value();
+  }
   UpdatePrevious();
   int last = nexts_.size();
   while (previous_[last] != -1) {
@@ -184,35 +155,81 @@ int SequenceVar::ComputeBackwardFrontier() {
   return last;
 }
 
+void SequenceVar::RemoveUnranked(int index) const {
+  DCHECK(IsUnranked(index));
+  num_unranked_.Decr(solver());
+  const int position = unranked_position_[index];
+  const int last_position = num_unranked_.Value();
+  const int last_index = unranked_[last_position];
+  unranked_[position] = last_index;
+  unranked_position_[last_index] = position;
+  unranked_[last_position] = index;
+  unranked_position_[index] = last_position;
+}
+
+void SequenceVar::UpdateRanking() const {
+  Solver* const s = solver();
+  const int sentinel = nexts_.size();
+  int first = forward_frontier_.Value();
+  while (first != sentinel && nexts_[first]->Bound()) {
+    first = nexts_[first]->Min();
+    if (first != sentinel && IsUnranked(ValueToIndex(first))) {
+      RemoveUnranked(ValueToIndex(first));
+      num_ranked_.Incr(s);
+    }
+  }
+  forward_frontier_.SetValue(s, first);
+  // Drops the unperformed intervals, and links the bound nexts of the others
+  // backward. Going down keeps the positions still to visit in place when an
+  // interval is removed.
+  touched_nodes_.clear();
+  for (int i = num_unranked_.Value() - 1; i >= 0; --i) {
+    const int index = unranked_[i];
+    if (intervals_[index]->CannotBePerformed()) {
+      RemoveUnranked(index);
+      num_unperformed_.Incr(s);
+      continue;
+    }
+    IntVar* const next = nexts_[IndexToValue(index)];
+    if (next->Bound()) {
+      ranking_previous_[next->Min()] = IndexToValue(index);
+      touched_nodes_.push_back(next->Min());
+    }
+  }
+  if (first != sentinel) {
+    // The predecessors of the backward chain are unranked intervals: a
+    // ranked first interval pointing to it would have led the forward chain
+    // to the sentinel.
+    int last = backward_frontier_.Value();
+    while (ranking_previous_[last] != -1) {
+      last = ranking_previous_[last];
+      RemoveUnranked(ValueToIndex(last));
+      num_ranked_.Incr(s);
+    }
+    backward_frontier_.SetValue(s, last);
+  }
+  for (const int node : touched_nodes_) {
+    ranking_previous_[node] = -1;
+  }
+}
+
 void SequenceVar::ComputePossibleFirstsAndLasts(
     std::vector<int>* const possible_firsts, std::vector<int>* const possible_lasts) {
   possible_firsts->clear();
   possible_lasts->clear();
-  hash_set<int> to_check;
-  for (int i = 0; i < intervals_.size(); ++i) {
-    if (intervals_[i]->MayBePerformed()) {
-      to_check.insert(i);
-    }
-  }
-  int first = 0;
-  while (nexts_[first]->Bound()) {
-    first = nexts_[first]->Min();
-    if (first == nexts_.size()) {
-      return;
-    }
-    to_check.erase(ValueToIndex(first));
+  UpdateRanking();
+  const int first = forward_frontier_.Value();
+  if (first == nexts_.size()) {
+    return;
   }
 
   IntVar* const forward_var = nexts_[first];
   std::vector<int> candidates;
   int64 smallest_start_max = kint64max;
   int ssm_support = -1;
-  for (int64 i = forward_var->Min(); i <= forward_var->Max(); ++i) {
-    // TODO(user): use domain iterator.
-    if (i != 0 && i < IndexToValue(intervals_.size()) &&
-        intervals_[ValueToIndex(i)]->MayBePerformed() &&
-        forward_var->Contains(i)) {
-      const int candidate = ValueToIndex(i);
+  for (int i = 0; i < num_unranked_.Value(); ++i) {
+    const int candidate = unranked_[i];
+    if (forward_var->Contains(IndexToValue(candidate))) {
       candidates.push_back(candidate);
       if (intervals_[candidate]->MustBePerformed()) {
         if (smallest_start_max > intervals_[candidate]->StartMax()) {
@@ -222,6 +239,9 @@ void SequenceVar::ComputePossibleFirstsAndLasts(
       }
     }
   }
+  // Keeps the candidates in index order, as the ranking search breaks ties
+  // on it.
+  std::sort(candidates.begin(), candidates.end());
   for (int i = 0; i < candidates.size(); ++i) {
     const int candidate = candidates[i];
     if (candidate == ssm_support ||
@@ -230,17 +250,12 @@ void SequenceVar::ComputePossibleFirstsAndLasts(
     }
   }
 
-  UpdatePrevious();
-  int last = nexts_.size();
-  while (previous_[last] != -1) {
-    last = previous_[last];
-    to_check.erase(ValueToIndex(last));
-  }
-
+  const int last = backward_frontier_.Value();
   candidates.clear();
   int64 biggest_end_min = kint64min;
   int bem_support = -1;
-  for (const int candidate : to_check) {
+  for (int i = 0; i < num_unranked_.Value(); ++i) {
+    const int candidate = unranked_[i];
     if (nexts_[IndexToValue(candidate)]->Contains(last)) {
       candidates.push_back(candidate);
       if (intervals_[candidate]->MustBePerformed()) {
@@ -251,7 +266,7 @@ void SequenceVar::ComputePossibleFirstsAndLasts(
       }
     }
   }
-
+  std::sort(candidates.begin(), candidates.end());
   for (int i = 0; i < candidates.size(); ++i) {
     const int candidate = candidates[i];
     if (candidate == bem_support ||
@@ -289,6 +304,12 @@ void SequenceVar::RankSequence(const std::vector<int>& rank_first,
 void SequenceVar::RankFirst(int index) {
   solver()->GetPropagationMonitor()->RankFirst(this, index);
   intervals_[index]->SetPerformed(true);
+  UpdateRanking();
+  if (IsUnranked(index)) {
+    DCHECK_LT(forward_frontier_.Value(), nexts_.size());
+    nexts_[forward_frontier_.Value()]->SetValue(IndexToValue(index));
+    return;
+  }
   int forward_frontier = 0;
   while (forward_frontier != nexts_.size() &&
          nexts_[forward_frontier]->Bound()) {
@@ -312,6 +333,11 @@ void SequenceVar::RankNotFirst(int index) {
 void SequenceVar::RankLast(int index) {
   solver()->GetPropagationMonitor()->RankLast(this, index);
   intervals_[index]->SetPerformed(true);
+  UpdateRanking();
+  if (IsUnranked(index) && forward_frontier_.Value() != nexts_.size()) {
+    nexts_[IndexToValue(index)]->SetValue(backward_frontier_.Value());
+    return;
+  }
   UpdatePrevious();
   int backward_frontier = nexts_.size();
   while (previous_[backward_frontier] != -1) {
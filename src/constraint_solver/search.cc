@@ -13,19 +13,24 @@
 
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <functional>
 #include "base/hash.h"
 #include <list>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 
 #include "base/casts.h"
 #include "base/commandlineflags.h"
+#include "base/file.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/macros.h"
+#include "base/memory_accounting.h"
 #include "base/stringprintf.h"
 #include "base/timer.h"
 #include "base/join.h"
@@ -37,10 +42,15 @@
 #include "constraint_solver/constraint_solveri.h"
 #include "constraint_solver/search_limit.pb.h"
 #include "util/string_array.h"
+#include "util/time_limit.h"
 #include "base/random.h"
 
 DEFINE_bool(cp_use_sparse_gls_penalties, false,
             "Use sparse implementation to store Guided Local Search penalties");
+DEFINE_double(cp_gls_penalty_decay, 1.0,
+              "Factor, in ]0, 1], by which all Guided Local Search penalties "
+              "are multiplied at each local optimum before new penalties are "
+              "added. 1 disables decay.");
 DEFINE_bool(cp_log_to_vlog, false,
             "Whether search related logging should be "
             "vlog or info.");
@@ -361,6 +371,241 @@ SearchMonitor* Solver::MakeSearchTrace(const std::string& prefix) {
   return RevAlloc(new SearchTrace(this, prefix));
 }
 
+// ---------- Search Telemetry ----------
+
+namespace {
+// Records a compact binary trace of the search, meant to be left enabled on
+// production solves. Events are written by the search thread into a
+// single-producer single-consumer ring buffer, and a background thread drains
+// that buffer to the file. The search never blocks on the file: when the
+// buffer is full, events are dropped and counted. Only one decision and one
+// failure out of sampling_period are recorded; solutions are always recorded.
+//
+// The file starts with the 8 bytes "CPTELEM1", followed by a sequence of
+// TelemetryEvent structs in native byte order.
+class SearchTelemetry : public SearchMonitor {
+ public:
+  enum EventType {
+    ENTER_SEARCH = 0,
+    APPLY_DECISION = 1,
+    REFUTE_DECISION = 2,
+    FAILURE = 3,
+    SOLUTION = 4,
+    // value is the number of events dropped during the search.
+    EXIT_SEARCH = 5,
+  };
+
+  struct TelemetryEvent {
+    // Wall time since the monitor was created.
+    int64 time_us;
+    int64 branches;
+    // For decisions and failures, the value of the decision being applied or
+    // refuted (the failure is attributed to the last decision). For
+    // solutions, the value of the objective if any.
+    int64 value;
+    int32 depth;
+    // Index in the vars given at construction of the variable of the
+    // decision, or -1 if unknown.
+    int32 variable;
+    int32 type;
+    int32 reserved;
+  };
+
+  SearchTelemetry(Solver* const solver, const std::string& filename,
+                  const std::vector<IntVar*>& vars, IntVar* const objective,
+                  int sampling_period)
+      : SearchMonitor(solver),
+        filename_(filename),
+        objective_(objective),
+        sampling_period_(std::max(1, sampling_period)),
+        file_(nullptr),
+        buffer_(kBufferSize),
+        write_position_(0),
+        read_position_(0),
+        stop_drain_(false),
+        dropped_events_(0),
+        decision_count_(0),
+        failure_count_(0),
+        last_decision_(nullptr) {
+    for (int i = 0; i < vars.size(); ++i) {
+      var_indices_[vars[i]] = i;
+    }
+    timer_.Start();
+  }
+
+  ~SearchTelemetry() override {
+    StopDrain();
+    if (file_ != nullptr) {
+      file_->Close();
+    }
+  }
+
+  void EnterSearch() override {
+    if (file_ == nullptr) {
+      file_ = File::Open(filename_.c_str(), "w");
+      if (file_ == nullptr) {
+        LOG(WARNING) << "Cannot open search telemetry file " << filename_;
+        return;
+      }
+      file_->Write("CPTELEM1", 8);
+    }
+    dropped_events_ = 0;
+    last_decision_ = nullptr;
+    StartDrain();
+    Record(ENTER_SEARCH, 0, -1);
+  }
+
+  void ExitSearch() override {
+    Record(EXIT_SEARCH, dropped_events_, -1);
+    StopDrain();
+    if (file_ != nullptr) {
+      file_->Flush();
+    }
+  }
+
+  void ApplyDecision(Decision* const d) override {
+    last_decision_ = d;
+    if (++decision_count_ % sampling_period_ == 0) {
+      RecordDecision(APPLY_DECISION, d);
+    }
+  }
+
+  void RefuteDecision(Decision* const d) override {
+    last_decision_ = d;
+    if (++decision_count_ % sampling_period_ == 0) {
+      RecordDecision(REFUTE_DECISION, d);
+    }
+  }
+
+  void BeginFail() override {
+    if (++failure_count_ % sampling_period_ == 0) {
+      RecordDecision(FAILURE, last_decision_);
+    }
+  }
+
+  bool AtSolution() override {
+    Record(SOLUTION, objective_ != nullptr ? objective_->Value() : 0, -1);
+    return false;
+  }
+
+  std::string DebugString() const override { return "SearchTelemetry"; }
+
+ private:
+  static const int kBufferSize = 1 << 16;  // Must be a power of two.
+
+  // Extracts the variable and the value of the decisions that assign or
+  // split a variable.
+  class DecisionExtractor : public DecisionVisitor {
+   public:
+    DecisionExtractor() : var_(nullptr), value_(0) {}
+    ~DecisionExtractor() override {}
+    void VisitSetVariableValue(IntVar* const var, int64 value) override {
+      var_ = var;
+      value_ = value;
+    }
+    void VisitSplitVariableDomain(IntVar* const var, int64 value,
+                                  bool start_with_lower_half) override {
+      var_ = var;
+      value_ = value;
+    }
+    const IntVar* var() const { return var_; }
+    int64 value() const { return value_; }
+
+   private:
+    const IntVar* var_;
+    int64 value_;
+  };
+
+  void RecordDecision(EventType type, Decision* const d) {
+    if (d == nullptr) {
+      Record(type, 0, -1);
+      return;
+    }
+    DecisionExtractor extractor;
+    d->Accept(&extractor);
+    const int variable =
+        FindWithDefault(var_indices_, extractor.var(), -1);
+    Record(type, extractor.value(), variable);
+  }
+
+  // Called from the search thread only.
+  void Record(EventType type, int64 value, int variable) {
+    if (file_ == nullptr) return;
+    const uint64 write = write_position_.load(std::memory_order_relaxed);
+    if (write - read_position_.load(std::memory_order_acquire) >=
+        kBufferSize) {
+      ++dropped_events_;
+      return;
+    }
+    TelemetryEvent* const event = &buffer_[write & (kBufferSize - 1)];
+    event->time_us = timer_.GetInUsec();
+    event->branches = solver()->branches();
+    event->value = value;
+    event->depth = solver()->SearchDepth();
+    event->variable = variable;
+    event->type = type;
+    event->reserved = 0;
+    write_position_.store(write + 1, std::memory_order_release);
+  }
+
+  void StartDrain() {
+    if (file_ == nullptr || drain_thread_.joinable()) return;
+    stop_drain_.store(false, std::memory_order_release);
+    drain_thread_ = std::thread([this]() { Drain(); });
+  }
+
+  void StopDrain() {
+    if (!drain_thread_.joinable()) return;
+    stop_drain_.store(true, std::memory_order_release);
+    drain_thread_.join();
+  }
+
+  // Runs in the drain thread. Writes the buffered events by contiguous
+  // chunks, and sleeps when the buffer is empty.
+  void Drain() {
+    for (;;) {
+      const bool stop = stop_drain_.load(std::memory_order_acquire);
+      const uint64 read = read_position_.load(std::memory_order_relaxed);
+      const uint64 write = write_position_.load(std::memory_order_acquire);
+      if (read == write) {
+        if (stop) return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        continue;
+      }
+      const uint64 begin = read & (kBufferSize - 1);
+      const uint64 end =
+          std::min<uint64>(begin + write - read, kBufferSize);
+      file_->Write(&buffer_[begin], (end - begin) * sizeof(TelemetryEvent));
+      read_position_.store(read + end - begin, std::memory_order_release);
+    }
+  }
+
+  const std::string filename_;
+  IntVar* const objective_;
+  const int64 sampling_period_;
+  hash_map<const IntVar*, int> var_indices_;
+  File* file_;
+  WallTimer timer_;
+  std::vector<TelemetryEvent> buffer_;
+  std::atomic<uint64> write_position_;
+  std::atomic<uint64> read_position_;
+  std::atomic<bool> stop_drain_;
+  std::thread drain_thread_;
+  int64 dropped_events_;
+  int64 decision_count_;
+  int64 failure_count_;
+  Decision* last_decision_;
+};
+}  // namespace
+
+SearchMonitor* Solver::MakeSearchTelemetry(const std::string& filename,
+                                           const std::vector<IntVar*>& vars,
+                                           IntVar* const objective,
+                                           int sampling_period) {
+  return RevAlloc(
+      new SearchTelemetry(this, filename, vars, objective, sampling_period));
+}
+
 // ---------- Composite Decision Builder --------
 
 namespace {
@@ -510,7 +755,8 @@ class ClosureDecision : public Decision {
 }  // namespace
 
 Decision* Solver::MakeDecision(Action apply, Action refute) {
-  return RevAlloc(new ClosureDecision(apply, refute));
+  return RevAllocInArena(new (AllocateInSearchArena(sizeof(ClosureDecision)))
+                             ClosureDecision(apply, refute));
 }
 
 // ---------- Try Decision Builder ----------
@@ -1457,7 +1703,9 @@ void AssignOneVariableValue::Refute(Solver* const s) {
 }  // namespace
 
 Decision* Solver::MakeAssignVariableValue(IntVar* const v, int64 val) {
-  return RevAlloc(new AssignOneVariableValue(v, val));
+  return RevAllocInArena(
+      new (AllocateInSearchArena(sizeof(AssignOneVariableValue)))
+          AssignOneVariableValue(v, val));
 }
 
 // ----- AssignOneVariableValueOrFail decision -----
@@ -1496,7 +1744,9 @@ void AssignOneVariableValueOrFail::Refute(Solver* const s) { s->Fail(); }
 }  // namespace
 
 Decision* Solver::MakeAssignVariableValueOrFail(IntVar* const v, int64 value) {
-  return RevAlloc(new AssignOneVariableValueOrFail(v, value));
+  return RevAllocInArena(
+      new (AllocateInSearchArena(sizeof(AssignOneVariableValueOrFail)))
+          AssignOneVariableValueOrFail(v, value));
 }
 
 // ----- AssignOneVariableValue decision -----
@@ -1552,7 +1802,9 @@ void SplitOneVariable::Refute(Solver* const s) {
 
 Decision* Solver::MakeSplitVariableDomain(IntVar* const v, int64 val,
                                           bool start_with_lower_half) {
-  return RevAlloc(new SplitOneVariable(v, val, start_with_lower_half));
+  return RevAllocInArena(
+      new (AllocateInSearchArena(sizeof(SplitOneVariable)))
+          SplitOneVariable(v, val, start_with_lower_half));
 }
 
 Decision* Solver::MakeVariableLessOrEqualValue(IntVar* const var, int64 value) {
@@ -1741,11 +1993,11 @@ Decision* BaseAssignVariables::Next(Solver* const s) {
     const int64 value = selector_->SelectValue(var, id);
     switch (mode_) {
       case ASSIGN:
-        return s->RevAlloc(new AssignOneVariableValue(var, value));
+        return s->MakeAssignVariableValue(var, value);
       case SPLIT_LOWER:
-        return s->RevAlloc(new SplitOneVariable(var, value, true));
+        return s->MakeSplitVariableDomain(var, value, true);
       case SPLIT_UPPER:
-        return s->RevAlloc(new SplitOneVariable(var, value, false));
+        return s->MakeSplitVariableDomain(var, value, false);
     }
   }
   return nullptr;
@@ -3002,6 +3254,8 @@ class GuidedLocalSearchPenalties {
   virtual void Increment(const Arc& arc) = 0;
   virtual int64 Value(const Arc& arc) const = 0;
   virtual void Reset() = 0;
+  // Multiplies all penalties by 'factor', in ]0, 1], rounding down.
+  virtual void Decay(double factor) = 0;
 };
 
 // Dense GLS penalties implementation using a matrix to store penalties.
@@ -3013,6 +3267,7 @@ class GuidedLocalSearchPenaltiesTable : public GuidedLocalSearchPenalties {
   void Increment(const Arc& arc) override;
   int64 Value(const Arc& arc) const override;
   void Reset() override;
+  void Decay(double factor) override;
 
  private:
   std::vector<std::vector<int64> > penalties_;
@@ -3039,6 +3294,16 @@ void GuidedLocalSearchPenaltiesTable::Reset() {
   }
 }
 
+void GuidedLocalSearchPenaltiesTable::Decay(double factor) {
+  has_values_ = false;
+  for (std::vector<int64>& first_penalties : penalties_) {
+    for (int64& penalty : first_penalties) {
+      penalty = static_cast<int64>(penalty * factor);
+      has_values_ |= penalty != 0;
+    }
+  }
+}
+
 int64 GuidedLocalSearchPenaltiesTable::Value(const Arc& arc) const {
   const std::vector<int64>& first_penalties = penalties_[arc.first];
   const int64 second = arc.second;
@@ -3049,42 +3314,111 @@ int64 GuidedLocalSearchPenaltiesTable::Value(const Arc& arc) const {
   }
 }
 
-// Sparse GLS penalties implementation using a hash_map to store penalties.
-
+// Sparse GLS penalties implementation using an open-addressed hash table
+// with linear probing. Entries are stored inline in a single array, which
+// keeps lookups to one or two cache lines even with hundreds of millions of
+// arcs, where a node-based hash_map would chase a pointer per lookup.
+// Entries with a zero penalty are never stored.
 class GuidedLocalSearchPenaltiesMap : public GuidedLocalSearchPenalties {
  public:
   explicit GuidedLocalSearchPenaltiesMap(int size);
   ~GuidedLocalSearchPenaltiesMap() override {}
-  bool HasValues() const override { return (penalties_.size() != 0); }
+  bool HasValues() const override { return num_entries_ != 0; }
   void Increment(const Arc& arc) override;
   int64 Value(const Arc& arc) const override;
   void Reset() override;
+  void Decay(double factor) override;
 
  private:
+  struct Entry {
+    // first is -1 for empty entries; variable indices are non-negative.
+    Arc arc;
+    int64 penalty;
+  };
+  static const int kInitialCapacity = 16;
+
+  uint64 Slot(const Arc& arc) const {
+    return Hash64NumWithSeed(arc.second, arc.first) & (entries_.size() - 1);
+  }
+  // Returns the entry of 'arc', or the empty entry where it would be stored.
+  Entry* Find(const Arc& arc);
+  const Entry* Find(const Arc& arc) const;
+  // Rebuilds the table with the given capacity, dropping zero penalties.
+  void Rehash(int64 capacity);
+
   Bitmap penalized_;
-#if defined(_MSC_VER)
-  hash_map<Arc, int64, PairInt64Hasher> penalties_;
-#else
-  hash_map<Arc, int64> penalties_;
-#endif
+  std::vector<Entry> entries_;
+  int64 num_entries_;
 };
 
 GuidedLocalSearchPenaltiesMap::GuidedLocalSearchPenaltiesMap(int size)
-    : penalized_(size, false) {}
+    : penalized_(size, false), num_entries_(0) {
+  Rehash(kInitialCapacity);
+}
+
+GuidedLocalSearchPenaltiesMap::Entry* GuidedLocalSearchPenaltiesMap::Find(
+    const Arc& arc) {
+  const uint64 mask = entries_.size() - 1;
+  for (uint64 slot = Slot(arc);; slot = (slot + 1) & mask) {
+    Entry* const entry = &entries_[slot];
+    if (entry->arc.first == -1 || entry->arc == arc) {
+      return entry;
+    }
+  }
+}
+
+const GuidedLocalSearchPenaltiesMap::Entry*
+GuidedLocalSearchPenaltiesMap::Find(const Arc& arc) const {
+  return const_cast<GuidedLocalSearchPenaltiesMap*>(this)->Find(arc);
+}
+
+void GuidedLocalSearchPenaltiesMap::Rehash(int64 capacity) {
+  std::vector<Entry> old_entries;
+  old_entries.swap(entries_);
+  const Entry empty = {Arc(-1, 0), 0};
+  entries_.assign(capacity, empty);
+  num_entries_ = 0;
+  for (const Entry& entry : old_entries) {
+    if (entry.arc.first != -1 && entry.penalty != 0) {
+      *Find(entry.arc) = entry;
+      ++num_entries_;
+    }
+  }
+}
 
 void GuidedLocalSearchPenaltiesMap::Increment(const Arc& arc) {
-  ++penalties_[arc];
+  // Keeps the load factor under 1/2.
+  if (2 * (num_entries_ + 1) > entries_.size()) {
+    Rehash(2 * entries_.size());
+  }
+  Entry* const entry = Find(arc);
+  if (entry->arc.first == -1) {
+    entry->arc = arc;
+    entry->penalty = 0;
+    ++num_entries_;
+  }
+  ++entry->penalty;
   penalized_.Set(arc.first, true);
 }
 
 void GuidedLocalSearchPenaltiesMap::Reset() {
-  penalties_.clear();
+  entries_.clear();
+  Rehash(kInitialCapacity);
   penalized_.Clear();
 }
 
+void GuidedLocalSearchPenaltiesMap::Decay(double factor) {
+  for (Entry& entry : entries_) {
+    entry.penalty = static_cast<int64>(entry.penalty * factor);
+  }
+  // Rehashing removes the entries whose penalty dropped to zero, which
+  // would otherwise break probe sequences if emptied in place.
+  Rehash(entries_.size());
+}
+
 int64 GuidedLocalSearchPenaltiesMap::Value(const Arc& arc) const {
   if (penalized_.Get(arc.first)) {
-    return FindWithDefault(penalties_, arc, 0LL);
+    return Find(arc)->penalty;
   }
   return 0LL;
 }
@@ -3306,6 +3640,10 @@ int64 GuidedLocalSearch::Evaluate(const Assignment* delta,
 // Penalize all the most expensive arcs (var, value) according to their utility:
 // utility(i, j) = cost(i, j) / (1 + penalty(i, j))
 bool GuidedLocalSearch::LocalOptimum() {
+  if (FLAGS_cp_gls_penalty_decay < 1.0 && penalties_->HasValues()) {
+    // Penalties are read again from scratch in the next ApplyDecision().
+    penalties_->Decay(FLAGS_cp_gls_penalty_decay);
+  }
   std::vector<std::pair<Arc, double> > utility(vars_.size());
   for (int i = 0; i < vars_.size(); ++i) {
     if (!assignment_.Bound(vars_[i])) {
@@ -3673,7 +4011,8 @@ bool RegularLimit::Check() {
   // Warning limits might be kint64max, do not move the offset to the rhs
   return s->branches() - branches_offset_ >= branches_ ||
          s->failures() - failures_offset_ >= failures_ || CheckTime() ||
-         s->solutions() - solutions_offset_ >= solutions_;
+         s->solutions() - solutions_offset_ >= solutions_ ||
+         IsMemoryBudgetExceeded();
 }
 
 int RegularLimit::ProgressPercent() {
@@ -3904,6 +4243,17 @@ SearchLimit* Solver::MakeCustomLimit(std::function<bool()> limiter) {
   return RevAlloc(new CustomLimit(this, limiter));
 }
 
+SearchLimit* Solver::MakeDeterministicTimeLimit(TimeLimit* const time_limit) {
+  double last_deterministic_time = deterministic_time();
+  return MakeCustomLimit([this, time_limit, last_deterministic_time]() mutable {
+    const double current_deterministic_time = deterministic_time();
+    time_limit->AdvanceDeterministicTime(current_deterministic_time -
+                                         last_deterministic_time);
+    last_deterministic_time = current_deterministic_time;
+    return time_limit->LimitReached();
+  });
+}
+
 // ---------- SolveOnce ----------
 
 namespace {
@@ -37,12 +37,17 @@ DEFINE_bool(cp_use_compact_table, true,
             "Use compact table constraint when possible.");
 DEFINE_bool(cp_use_small_table, true,
             "Use small compact table constraint when possible.");
+DEFINE_bool(cp_use_sparse_compact_table, false,
+            "Use the Compact-Table propagator, based on reversible sparse "
+            "bitsets, instead of the compact table constraint.");
 DEFINE_bool(cp_use_sat_table, false,
             "If true, use a SAT constraint for all table constraints.");
 DEFINE_int32(cp_ac4r_table_threshold, 2048,
              "Above this size, allowed assignment constraints will use the "
              "revised AC-4 implementation of the table constraint.");
-DEFINE_bool(cp_use_mdd_table, false, "Use mdd table");
+DEFINE_bool(cp_use_mdd_table, false,
+            "If true, allowed assignment constraints above the AC-4 threshold "
+            "compile their tuples into a reduced MDD and propagate on it.");
 
 namespace operations_research {
 // External table code.
@@ -1259,6 +1264,226 @@ class SmallCompactPositiveTableConstraint : public BasePositiveTableConstraint {
   int touched_var_;
 };
 
+// ----- Compact-Table -----
+
+// Implementation of the Compact-Table algorithm (Demeulenaere et al., CP
+// 2016). The set of valid tuples is kept in a reversible sparse bitset. On
+// each domain change, it is updated incrementally from the removed values
+// when they are few, or rebuilt from the remaining values otherwise; values
+// are then filtered with word-level residues, so that only the non-zero
+// words of the bitset are ever visited.
+class CompactTableConstraint : public BasePositiveTableConstraint {
+ public:
+  CompactTableConstraint(Solver* const s, const std::vector<IntVar*>& vars,
+                         const IntTupleSet& tuples)
+      : BasePositiveTableConstraint(s, vars, tuples),
+        original_min_(arity_, 0),
+        demon_(nullptr),
+        touched_var_(-1),
+        var_sizes_(arity_, 0) {}
+
+  ~CompactTableConstraint() override {}
+
+  void Post() override {
+    demon_ = solver()->RegisterDemon(MakeDelayedConstraintDemon0(
+        solver(), this, &CompactTableConstraint::FilterDomains,
+        "FilterDomains"));
+    for (int i = 0; i < arity_; ++i) {
+      Demon* const u = MakeConstraintDemon1(
+          solver(), this, &CompactTableConstraint::Update, "Update", i);
+      vars_[i]->WhenDomain(u);
+    }
+  }
+
+  void InitialPropagate() override {
+    // Collect the tuples valid for the current domains.
+    std::vector<int> valid_tuples;
+    for (int tuple_index = 0; tuple_index < tuple_count_; ++tuple_index) {
+      if (IsTupleSupported(tuple_index)) {
+        valid_tuples.push_back(tuple_index);
+      }
+    }
+    if (valid_tuples.empty()) {
+      solver()->Fail();
+    }
+    const int num_valid_tuples = valid_tuples.size();
+    const int length = BitLength64(num_valid_tuples);
+    current_tuples_.reset(new SparseRevBitSet(num_valid_tuples));
+    supports_.clear();
+    supports_.resize(arity_);
+    residues_.clear();
+    residues_.resize(arity_);
+    for (int var_index = 0; var_index < arity_; ++var_index) {
+      original_min_[var_index] = vars_[var_index]->Min();
+      const int64 span = vars_[var_index]->Max() - original_min_[var_index] + 1;
+      supports_[var_index].assign(span, nullptr);
+      residues_[var_index].assign(span, 0);
+    }
+    for (int valid_index = 0; valid_index < num_valid_tuples; ++valid_index) {
+      const int tuple_index = valid_tuples[valid_index];
+      for (int var_index = 0; var_index < arity_; ++var_index) {
+        const int64 value_index =
+            UnsafeTupleValue(tuple_index, var_index) - original_min_[var_index];
+        uint64*& support = supports_[var_index][value_index];
+        if (support == nullptr) {
+          support = solver()->RevAllocArray(new uint64[length]);
+          memset(support, 0, length * sizeof(*support));
+          residues_[var_index][value_index] = BitOffset64(valid_index);
+        }
+        SetBit64(support, valid_index);
+      }
+    }
+    // Remove values without supports.
+    for (int var_index = 0; var_index < arity_; ++var_index) {
+      IntVar* const var = vars_[var_index];
+      to_remove_.clear();
+      for (const int64 value : InitAndGetValues(iterators_[var_index])) {
+        if (supports_[var_index][value - original_min_[var_index]] ==
+            nullptr) {
+          to_remove_.push_back(value);
+        }
+      }
+      var->RemoveValues(to_remove_);
+      var_sizes_.SetValue(solver(), var_index, var->Size());
+    }
+  }
+
+  // Updates the set of valid tuples after the domain of a variable changed.
+  void Update(int var_index) {
+    IntVar* const var = vars_[var_index];
+    const int64 var_size = var->Size();
+    const int64 old_size = var_sizes_.Value(var_index);
+    if (var_size == old_size) {
+      return;
+    }
+    const int64 omin = original_min_[var_index];
+    const int64 var_min = var->Min();
+    const int64 var_max = var->Max();
+    const int64 old_min = var->OldMin();
+    const int64 old_max = var->OldMax();
+    current_tuples_->ClearMask();
+    // Incremental update when the number of removed values is smaller than
+    // the domain, reset-based update otherwise.
+    if (old_size - var_size < var_size) {
+      for (int64 value = old_min; value < var_min; ++value) {
+        OrSupport(var_index, value - omin);
+      }
+      for (const int64 value : InitAndGetValues(holes_[var_index])) {
+        OrSupport(var_index, value - omin);
+      }
+      for (int64 value = var_max + 1; value <= old_max; ++value) {
+        OrSupport(var_index, value - omin);
+      }
+      current_tuples_->ReverseMask();
+    } else if (var_max - var_min + 1 == var_size) {
+      for (int64 value = var_min; value <= var_max; ++value) {
+        OrSupport(var_index, value - omin);
+      }
+    } else {
+      for (const int64 value : InitAndGetValues(iterators_[var_index])) {
+        OrSupport(var_index, value - omin);
+      }
+    }
+    var_sizes_.SetValue(solver(), var_index, var_size);
+    if (current_tuples_->IntersectWithMask(solver())) {
+      if (current_tuples_->Empty()) {
+        touched_var_ = -1;
+        solver()->Fail();
+      }
+      if (touched_var_ == -1 || touched_var_ == var_index) {
+        touched_var_ = var_index;
+      } else {
+        touched_var_ = -2;  // More than one var.
+      }
+      EnqueueDelayedDemon(demon_);
+    }
+  }
+
+  // Removes the values which are not supported by any valid tuple.
+  void FilterDomains() {
+    // When a single variable changed, all its values are still supported.
+    const int skipped_var = touched_var_;
+    touched_var_ = -1;
+    for (int var_index = 0; var_index < arity_; ++var_index) {
+      if (var_index == skipped_var) continue;
+      IntVar* const var = vars_[var_index];
+      const int64 omin = original_min_[var_index];
+      const int64 var_min = var->Min();
+      const int64 var_max = var->Max();
+      to_remove_.clear();
+      if (var_max - var_min + 1 == var->Size()) {
+        for (int64 value = var_min; value <= var_max; ++value) {
+          if (!Supported(var_index, value - omin)) {
+            to_remove_.push_back(value);
+          }
+        }
+      } else {
+        for (const int64 value : InitAndGetValues(iterators_[var_index])) {
+          if (!Supported(var_index, value - omin)) {
+            to_remove_.push_back(value);
+          }
+        }
+      }
+      if (!to_remove_.empty()) {
+        var->RemoveValues(to_remove_);
+        var_sizes_.SetValue(solver(), var_index, var->Size());
+      }
+    }
+  }
+
+  std::string DebugString() const override {
+    return StringPrintf("CompactTableConstraint([%s], %d tuples)",
+                        JoinDebugStringPtr(vars_, ", ").c_str(), tuple_count_);
+  }
+
+ private:
+  bool IsTupleSupported(int tuple_index) {
+    for (int var_index = 0; var_index < arity_; ++var_index) {
+      int64 value = 0;
+      if (!TupleValue(tuple_index, var_index, &value) ||
+          !vars_[var_index]->Contains(value)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void OrSupport(int var_index, int64 value_index) {
+    const uint64* const support = supports_[var_index][value_index];
+    if (support != nullptr) {
+      current_tuples_->OrMask(support);
+    }
+  }
+
+  bool Supported(int var_index, int64 value_index) {
+    const uint64* const support = supports_[var_index][value_index];
+    DCHECK(support != nullptr);
+    int& residue = residues_[var_index][value_index];
+    if (current_tuples_->IntersectsAt(support, residue)) {
+      return true;
+    }
+    const int offset = current_tuples_->FirstIntersectingWord(support);
+    if (offset == -1) {
+      return false;
+    }
+    residue = offset;
+    return true;
+  }
+
+  // The valid tuples, as indices in the list of tuples valid at the initial
+  // propagation.
+  std::unique_ptr<SparseRevBitSet> current_tuples_;
+  // The bitset of valid tuples supporting each value of each variable.
+  std::vector<std::vector<uint64*>> supports_;
+  // The last word where a support was found, per value per variable.
+  std::vector<std::vector<int>> residues_;
+  // The min on the vars at initial propagation.
+  std::vector<int64> original_min_;
+  Demon* demon_;
+  int touched_var_;
+  RevArray<int64> var_sizes_;
+};
+
 bool HasCompactDomains(const std::vector<IntVar*>& vars) {
   return true;
   int64 sum_of_spans = 0LL;
@@ -1409,20 +1634,22 @@ Constraint* Solver::MakeAllowedAssignments(const std::vector<IntVar*>& vars,
   if (FLAGS_cp_use_sat_table) {
     return BuildSatTableConstraint(this, vars, tuples);
   }
+  if (FLAGS_cp_use_mdd_table &&
+      tuples.NumTuples() > FLAGS_cp_ac4r_table_threshold) {
+    return BuildAc4MddResetTableConstraint(this, tuples, vars);
+  }
   if (FLAGS_cp_use_compact_table && HasCompactDomains(vars)) {
     if (tuples.NumTuples() < kBitsInUint64 && FLAGS_cp_use_small_table) {
       return RevAlloc(
           new SmallCompactPositiveTableConstraint(this, vars, tuples));
+    } else if (FLAGS_cp_use_sparse_compact_table) {
+      return RevAlloc(new CompactTableConstraint(this, vars, tuples));
     } else {
       return RevAlloc(new CompactPositiveTableConstraint(this, vars, tuples));
     }
   }
   if (tuples.NumTuples() > FLAGS_cp_ac4r_table_threshold) {
-    if (FLAGS_cp_use_mdd_table) {
-      return BuildAc4MddResetTableConstraint(this, tuples, vars);
-    } else {
-      return BuildAc4TableConstraint(this, tuples, vars);
-    }
+    return BuildAc4TableConstraint(this, tuples, vars);
   } else {
     return RevAlloc(new PositiveTableConstraint(this, vars, tuples));
   }
@@ -217,6 +217,97 @@ void RevBitMatrix::ClearAll(Solver* const solver) {
   RevBitSet::ClearAll(solver);
 }
 
+// ---------- SparseRevBitSet ----------
+
+SparseRevBitSet::SparseRevBitSet(int64 size)
+    : length_(BitLength64(size)),
+      words_(new uint64[length_]),
+      stamps_(new uint64[length_]),
+      mask_(new uint64[length_]),
+      index_(new int[length_]),
+      limit_(length_ - 1) {
+  DCHECK_GE(size, 1);
+  for (int i = 0; i < length_; ++i) {
+    words_[i] = kAllBits64;
+    stamps_[i] = 0;
+    mask_[i] = 0;
+    index_[i] = i;
+  }
+  if (BitPos64(size) != 0) {
+    words_[length_ - 1] = IntervalDown64(BitPos64(size) - 1);
+  }
+}
+
+SparseRevBitSet::~SparseRevBitSet() {}
+
+int64 SparseRevBitSet::Cardinality() const {
+  int64 card = 0;
+  for (int i = 0; i <= limit_.Value(); ++i) {
+    card += BitCount64(words_[index_[i]]);
+  }
+  return card;
+}
+
+int SparseRevBitSet::FirstIntersectingWord(const uint64* const mask) const {
+  for (int i = 0; i <= limit_.Value(); ++i) {
+    const int offset = index_[i];
+    if ((words_[offset] & mask[offset]) != 0) {
+      return offset;
+    }
+  }
+  return -1;
+}
+
+void SparseRevBitSet::ClearMask() {
+  for (int i = 0; i <= limit_.Value(); ++i) {
+    mask_[index_[i]] = 0;
+  }
+}
+
+void SparseRevBitSet::OrMask(const uint64* const mask) {
+  for (int i = 0; i <= limit_.Value(); ++i) {
+    const int offset = index_[i];
+    mask_[offset] |= mask[offset];
+  }
+}
+
+void SparseRevBitSet::ReverseMask() {
+  for (int i = 0; i <= limit_.Value(); ++i) {
+    const int offset = index_[i];
+    mask_[offset] = ~mask_[offset];
+  }
+}
+
+bool SparseRevBitSet::IntersectWithMask(Solver* const solver) {
+  bool changed = false;
+  int limit = limit_.Value();
+  for (int i = limit; i >= 0; --i) {
+    const int offset = index_[i];
+    const uint64 word = words_[offset] & mask_[offset];
+    if (word != words_[offset]) {
+      const uint64 current_stamp = solver->stamp();
+      if (stamps_[offset] < current_stamp) {
+        stamps_[offset] = current_stamp;
+        solver->SaveValue(&words_[offset]);
+      }
+      words_[offset] = word;
+      changed = true;
+      if (word == 0) {
+        // Swap the emptied word with the last non-zero one. The permutation
+        // itself needs not be restored on backtrack: restoring the limit
+        // brings back the same set of words.
+        index_[i] = index_[limit];
+        index_[limit] = offset;
+        --limit;
+      }
+    }
+  }
+  if (limit != limit_.Value()) {
+    limit_.SetValue(solver, limit);
+  }
+  return changed;
+}
+
 // ----- PrintModelVisitor -----
 
 namespace {
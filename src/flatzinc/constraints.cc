@@ -11,11 +11,17 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <functional>
 #include <string>
+#include <vector>
 #include "base/integral_types.h"
 #include "base/logging.h"
+#include "base/stringprintf.h"
 #include "base/hash.h"
+#include "base/map_util.h"
 #include "flatzinc/flatzinc_constraints.h"
+#include "flatzinc/linear_store.h"
 #include "flatzinc/model.h"
 #include "flatzinc/sat_constraint.h"
 #include "flatzinc/search.h"
@@ -26,6 +32,7 @@
 
 DECLARE_bool(use_sat);
 DECLARE_bool(fz_verbose);
+DECLARE_bool(fz_profile);
 
 // TODO (minizinc 2.0 support):
 //  - arg_sort
@@ -1451,6 +1458,66 @@ void ExtractIntLtReif(FzSolver* fzsolver, FzConstraint* ct) {
   EXTRACT_INT_XX_REIF(Less, Greater)
 }
 
+// Posts the reified comparison of two Boolean variables to the sat
+// propagator: target <=> left <= right, or left < right if strict. Returns
+// false if the arguments are not Boolean variables.
+bool PostBoolComparisonReifToSat(FzSolver* fzsolver, FzConstraint* ct,
+                                 int left_index, int right_index, bool strict) {
+  if (!FLAGS_use_sat || ct->Arg(left_index).HasOneValue() ||
+      ct->Arg(right_index).HasOneValue()) {
+    return false;
+  }
+  Solver* const solver = fzsolver->solver();
+  IntExpr* const left = fzsolver->GetExpression(ct->Arg(left_index));
+  IntExpr* const right = fzsolver->GetExpression(ct->Arg(right_index));
+  IntVar* tmp_var = nullptr;
+  bool tmp_neg = false;
+  if (!solver->IsBooleanVar(left, &tmp_var, &tmp_neg) ||
+      !solver->IsBooleanVar(right, &tmp_var, &tmp_neg)) {
+    return false;
+  }
+  IntVar* const boolvar = ct->target_variable != nullptr
+                              ? solver->MakeBoolVar()
+                              : fzsolver->GetExpression(ct->Arg(2))->Var();
+  const bool posted =
+      strict ? AddBoolIsLtVar(fzsolver->Sat(), left, right, boolvar)
+             : AddBoolIsLeVar(fzsolver->Sat(), left, right, boolvar);
+  if (!posted) {
+    return false;
+  }
+  FZVLOG << "  - posted to sat" << FZENDL;
+  if (ct->target_variable != nullptr) {
+    FZVLOG << "  - creating " << ct->target_variable->DebugString()
+           << " := " << boolvar->DebugString() << FZENDL;
+    fzsolver->SetExtracted(ct->target_variable, boolvar);
+  }
+  return true;
+}
+
+void ExtractBoolGeReif(FzSolver* fzsolver, FzConstraint* ct) {
+  if (!PostBoolComparisonReifToSat(fzsolver, ct, 1, 0, false)) {
+    ExtractIntGeReif(fzsolver, ct);
+  }
+}
+
+void ExtractBoolGtReif(FzSolver* fzsolver, FzConstraint* ct) {
+  if (!PostBoolComparisonReifToSat(fzsolver, ct, 1, 0, true)) {
+    ExtractIntGtReif(fzsolver, ct);
+  }
+}
+
+void ExtractBoolLeReif(FzSolver* fzsolver, FzConstraint* ct) {
+  if (!PostBoolComparisonReifToSat(fzsolver, ct, 0, 1, false)) {
+    ExtractIntLeReif(fzsolver, ct);
+  }
+}
+
+void ExtractBoolLtReif(FzSolver* fzsolver, FzConstraint* ct) {
+  if (!PostBoolComparisonReifToSat(fzsolver, ct, 0, 1, true)) {
+    ExtractIntLtReif(fzsolver, ct);
+  }
+}
+
 void ParseShortIntLin(FzSolver* fzsolver, FzConstraint* ct, IntExpr** left,
                       IntExpr** right) {
   Solver* const solver = fzsolver->solver();
@@ -1601,7 +1668,9 @@ bool ExtractLinAsShort(FzSolver* fzsolver, FzConstraint* ct) {
       return true;
     case 2:
     case 3: {
-      if (AreAllOnes(ct->Arg(0).values) &&
+      // Boolean sums, and all the pseudo-Boolean constraints when they can be
+      // posted to sat, are better handled by the long version.
+      if ((FLAGS_use_sat || AreAllOnes(ct->Arg(0).values)) &&
           AreAllExtractedAsVariables(fzsolver, ct->Arg(1).variables) &&
           AreAllFzVariablesBoolean(fzsolver, ct)) {
         return false;
@@ -1664,7 +1733,7 @@ void ExtractIntLinEq(FzSolver* fzsolver, FzConstraint* ct) {
     }
   } else {
     Constraint* constraint = nullptr;
-    if (ExtractLinAsShort(fzsolver, ct)) {
+    if (fzsolver->Linear() == nullptr && ExtractLinAsShort(fzsolver, ct)) {
       IntExpr* left = nullptr;
       IntExpr* right = nullptr;
       ParseShortIntLin(fzsolver, ct, &left, &right);
@@ -1676,6 +1745,14 @@ void ExtractIntLinEq(FzSolver* fzsolver, FzConstraint* ct) {
       if (AreAllBooleans(vars) && AreAllOnes(coeffs)) {
         PostBooleanSumInRange(fzsolver->Sat(), solver, vars, rhs, rhs);
         return;
+      } else if (FLAGS_use_sat && AddBooleanLinearInRange(fzsolver->Sat(), vars,
+                                                          coeffs, rhs, rhs)) {
+        FZVLOG << "  - posted to sat" << FZENDL;
+        return;
+      } else if (fzsolver->Linear() != nullptr &&
+                 AddLinearRow(fzsolver->Linear(), vars, coeffs, rhs, rhs)) {
+        FZVLOG << "  - added to the bulk linear propagator" << FZENDL;
+        return;
       } else {
         constraint = solver->MakeScalProdEquality(vars, coeffs, rhs);
       }
@@ -1738,7 +1815,7 @@ void ExtractIntLinEqReif(FzSolver* fzsolver, FzConstraint* ct) {
 void ExtractIntLinGe(FzSolver* fzsolver, FzConstraint* ct) {
   Solver* const solver = fzsolver->solver();
   const int size = ct->Arg(0).values.size();
-  if (ExtractLinAsShort(fzsolver, ct)) {
+  if (fzsolver->Linear() == nullptr && ExtractLinAsShort(fzsolver, ct)) {
     // Checks if it is not a hidden or.
     if (ct->Arg(2).Value() == 1 && AreAllOnes(ct->Arg(0).values)) {
       // Good candidate.
@@ -1770,6 +1847,14 @@ void ExtractIntLinGe(FzSolver* fzsolver, FzConstraint* ct) {
     ParseLongIntLin(fzsolver, ct, &vars, &coeffs, &rhs);
     if (AreAllBooleans(vars) && AreAllOnes(coeffs)) {
       PostBooleanSumInRange(fzsolver->Sat(), solver, vars, rhs, size);
+    } else if (FLAGS_use_sat &&
+               AddBooleanLinearInRange(fzsolver->Sat(), vars, coeffs, rhs,
+                                       kint64max)) {
+      FZVLOG << "  - posted to sat" << FZENDL;
+    } else if (fzsolver->Linear() != nullptr &&
+               AddLinearRow(fzsolver->Linear(), vars, coeffs, rhs,
+                            kint64max)) {
+      FZVLOG << "  - added to the bulk linear propagator" << FZENDL;
     } else {
       AddConstraint(solver, ct,
                     solver->MakeScalProdGreaterOrEqual(vars, coeffs, rhs));
@@ -1777,6 +1862,33 @@ void ExtractIntLinGe(FzSolver* fzsolver, FzConstraint* ct) {
   }
 }
 
+// Posts boolvar <=> sum(coeffs[i] * vars[i]) <= rhs to the sat propagator,
+// where boolvar is the reification argument of ct, or a new Boolean variable
+// if ct defines it. Returns false if the constraint cannot be posted to sat.
+bool PostIsBooleanLinearLessOrEqualToSat(FzSolver* fzsolver, FzConstraint* ct,
+                                         const std::vector<IntVar*>& vars,
+                                         const std::vector<int64>& coeffs,
+                                         int64 rhs) {
+  if (!FLAGS_use_sat || !AreAllBooleans(vars)) {
+    return false;
+  }
+  Solver* const solver = fzsolver->solver();
+  IntVar* const boolvar = ct->target_variable != nullptr
+                              ? solver->MakeBoolVar()
+                              : fzsolver->GetExpression(ct->Arg(3))->Var();
+  if (!AddIsBooleanLinearLessOrEqual(fzsolver->Sat(), vars, coeffs, rhs,
+                                     boolvar)) {
+    return false;
+  }
+  FZVLOG << "  - posted to sat" << FZENDL;
+  if (ct->target_variable != nullptr) {
+    FZVLOG << "  - creating " << ct->target_variable->DebugString()
+           << " := " << boolvar->DebugString() << FZENDL;
+    fzsolver->SetExtracted(ct->target_variable, boolvar);
+  }
+  return true;
+}
+
 void ExtractIntLinGeReif(FzSolver* fzsolver, FzConstraint* ct) {
   Solver* const solver = fzsolver->solver();
   const int size = ct->Arg(0).values.size();
@@ -1800,6 +1912,16 @@ void ExtractIntLinGeReif(FzSolver* fzsolver, FzConstraint* ct) {
     std::vector<int64> coeffs;
     int64 rhs = 0;
     ParseLongIntLin(fzsolver, ct, &vars, &coeffs, &rhs);
+    std::vector<int64> negated_coeffs(coeffs.size());
+    for (int i = 0; i < coeffs.size(); ++i) {
+      negated_coeffs[i] = -coeffs[i];
+    }
+    const bool use_sat =
+        !AreAllOnes(coeffs) && !(rhs == 1 && AreAllPositive(coeffs));
+    if (use_sat && PostIsBooleanLinearLessOrEqualToSat(fzsolver, ct, vars,
+                                                       negated_coeffs, -rhs)) {
+      return;
+    }
     if (ct->target_variable != nullptr) {
       if (AreAllBooleans(vars) &&
           (AreAllOnes(coeffs) || (rhs == 1 && AreAllPositive(coeffs)))) {
@@ -1864,7 +1986,7 @@ bool PostHiddenLeMax(SatPropagator* const sat, const std::vector<int64>& coeffs,
 
 void ExtractIntLinLe(FzSolver* fzsolver, FzConstraint* ct) {
   Solver* const solver = fzsolver->solver();
-  if (ExtractLinAsShort(fzsolver, ct)) {
+  if (fzsolver->Linear() == nullptr && ExtractLinAsShort(fzsolver, ct)) {
     IntExpr* left = nullptr;
     IntExpr* right = nullptr;
     ParseShortIntLin(fzsolver, ct, &left, &right);
@@ -1882,6 +2004,14 @@ void ExtractIntLinLe(FzSolver* fzsolver, FzConstraint* ct) {
     } else if (FLAGS_use_sat && AreAllBooleans(vars) && rhs == 0 &&
                PostHiddenLeMax(fzsolver->Sat(), coeffs, vars)) {
       FZVLOG << "  - posted to sat" << FZENDL;
+    } else if (FLAGS_use_sat &&
+               AddBooleanLinearInRange(fzsolver->Sat(), vars, coeffs,
+                                       kint64min, rhs)) {
+      FZVLOG << "  - posted to sat" << FZENDL;
+    } else if (fzsolver->Linear() != nullptr &&
+               AddLinearRow(fzsolver->Linear(), vars, coeffs, kint64min,
+                            rhs)) {
+      FZVLOG << "  - added to the bulk linear propagator" << FZENDL;
     } else {
       AddConstraint(solver, ct,
                     solver->MakeScalProdLessOrEqual(vars, coeffs, rhs));
@@ -1911,6 +2041,12 @@ void ExtractIntLinLeReif(FzSolver* fzsolver, FzConstraint* ct) {
     std::vector<int64> coeffs;
     int64 rhs = 0;
     ParseLongIntLin(fzsolver, ct, &vars, &coeffs, &rhs);
+    const bool use_sat =
+        !AreAllOnes(coeffs) && !(rhs == 0 && AreAllPositive(coeffs));
+    if (use_sat &&
+        PostIsBooleanLinearLessOrEqualToSat(fzsolver, ct, vars, coeffs, rhs)) {
+      return;
+    }
     if (ct->target_variable != nullptr) {
       if (AreAllBooleans(vars) &&
           (AreAllOnes(coeffs) || (rhs == 0 && AreAllPositive(coeffs)))) {
@@ -2727,15 +2863,15 @@ void FzSolver::ExtractConstraint(FzConstraint* ct) {
   } else if (type == "bool_ge") {
     ExtractIntGe(this, ct);
   } else if (type == "bool_ge_reif") {
-    ExtractIntGeReif(this, ct);
+    ExtractBoolGeReif(this, ct);
   } else if (type == "bool_gt") {
     ExtractIntGt(this, ct);
   } else if (type == "bool_gt_reif") {
-    ExtractIntGtReif(this, ct);
+    ExtractBoolGtReif(this, ct);
   } else if (type == "bool_le") {
     ExtractIntLe(this, ct);
   } else if (type == "bool_le_reif") {
-    ExtractIntLeReif(this, ct);
+    ExtractBoolLeReif(this, ct);
   } else if (type == "bool_left_imp") {
     ExtractIntLe(this, ct);
   } else if (type == "bool_lin_eq") {
@@ -2745,7 +2881,7 @@ void FzSolver::ExtractConstraint(FzConstraint* ct) {
   } else if (type == "bool_lt") {
     ExtractIntLt(this, ct);
   } else if (type == "bool_lt_reif") {
-    ExtractIntLtReif(this, ct);
+    ExtractBoolLtReif(this, ct);
   } else if (type == "bool_ne") {
     ExtractIntNe(this, ct);
   } else if (type == "bool_ne_reif") {
@@ -2899,4 +3035,92 @@ void FzSolver::ExtractConstraint(FzConstraint* ct) {
     LOG(FATAL) << "Unknown predicate: " << type;
   }
 }
+
+// ----- Constraint profiling -----
+
+extern void DemonProfilerVisitConstraints(
+    DemonProfiler* const monitor, std::function<void(const Constraint*)> visit);
+extern void DemonProfilerExportInformation(
+    DemonProfiler* const monitor, const Constraint* const constraint,
+    int64* const fails, int64* const initial_propagation_runtime,
+    int64* const demon_invocations, int64* const total_demon_runtime,
+    int* const demon_count);
+
+void FzSolver::TagConstraints(FzConstraint* ct, int id, int first_index) {
+  const std::string tag = StringPrintf("%s#%d", ct->type.c_str(), id);
+  for (int i = first_index; i < solver_.constraints(); ++i) {
+    Constraint* const cte = solver_.constraint(i);
+    if (!ContainsKey(constraint_origins_, cte)) {
+      cte->set_name(tag);
+      constraint_origins_[cte] = ct;
+    }
+  }
+}
+
+namespace {
+struct ConstraintTypeProfile {
+  ConstraintTypeProfile()
+      : constraints(0), runtime(0), demon_invocations(0), failures(0) {}
+
+  std::string type;
+  int constraints;
+  int64 runtime;
+  int64 demon_invocations;
+  int64 failures;
+};
+
+bool CompareByRuntime(const ConstraintTypeProfile& a,
+                      const ConstraintTypeProfile& b) {
+  return a.runtime > b.runtime || (a.runtime == b.runtime && a.type < b.type);
+}
+}  // namespace
+
+std::string FzSolver::ConstraintProfileString() {
+  DemonProfiler* const profiler = solver_.demon_profiler();
+  if (!FLAGS_fz_profile || profiler == nullptr) {
+    return "";
+  }
+  // Constraints posted by the solver itself (the sat propagator, the
+  // constraints added during the initial propagation, ...) have no
+  // originating flatzinc constraint.
+  const std::string kUntagged = "<untagged>";
+  hash_map<std::string, ConstraintTypeProfile> profiles;
+  DemonProfilerVisitConstraints(
+      profiler, [this, profiler, &kUntagged, &profiles](const Constraint* cte) {
+        const FzConstraint* const origin =
+            FindPtrOrNull(constraint_origins_, cte);
+        const std::string& type =
+            origin != nullptr ? origin->type : kUntagged;
+        int64 fails = 0;
+        int64 initial_propagation_runtime = 0;
+        int64 demon_invocations = 0;
+        int64 total_demon_runtime = 0;
+        int demon_count = 0;
+        DemonProfilerExportInformation(
+            profiler, cte, &fails, &initial_propagation_runtime,
+            &demon_invocations, &total_demon_runtime, &demon_count);
+        ConstraintTypeProfile* const profile = &profiles[type];
+        profile->type = type;
+        profile->constraints++;
+        profile->runtime += initial_propagation_runtime + total_demon_runtime;
+        profile->demon_invocations += demon_invocations;
+        profile->failures += fails;
+      });
+  std::vector<ConstraintTypeProfile> sorted;
+  for (const auto& it : profiles) {
+    sorted.push_back(it.second);
+  }
+  std::sort(sorted.begin(), sorted.end(), CompareByRuntime);
+  std::string result = StringPrintf(
+      "%%%%  %-32s %10s %14s %14s %12s\n", "constraint profile", "count",
+      "runtime (us)", "demon runs", "failures");
+  for (const ConstraintTypeProfile& profile : sorted) {
+    result.append(StringPrintf("%%%%    %-30s %10d %14" GG_LL_FORMAT
+                               "d %14" GG_LL_FORMAT "d %12" GG_LL_FORMAT "d\n",
+                               profile.type.c_str(), profile.constraints,
+                               profile.runtime, profile.demon_invocations,
+                               profile.failures));
+  }
+  return result;
+}
 }  // namespace operations_research
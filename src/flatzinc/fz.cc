@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "base/commandlineflags.h"
+#include "base/file.h"
 #include "base/stringprintf.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
@@ -32,6 +33,7 @@
 #include "flatzinc/model.h"
 #include "flatzinc/parser.h"
 #include "flatzinc/presolve.h"
+#include "flatzinc/presolve_cache.h"
 #include "flatzinc/search.h"
 #include "flatzinc/solver.h"
 
@@ -48,7 +50,30 @@ DEFINE_int32(luby_restart, -1, "Luby restart factor, <= 0 = no luby");
 DEFINE_int32(heuristic_period, 100, "Period to call heuristics in free search");
 DEFINE_bool(verbose_impact, false, "Verbose impact");
 DEFINE_bool(verbose_mt, false, "Verbose Multi-Thread");
+DEFINE_bool(share_clauses, true,
+            "Share the clauses learned by the sat propagators of the workers");
+DEFINE_bool(deterministic, false,
+            "Synchronize the workers at the end of each epoch so that the "
+            "multi-threaded search is reproducible");
+DEFINE_int32(epoch_length, 10000,
+             "Number of search limit checks of each worker per epoch in "
+             "deterministic mode");
+DEFINE_bool(lp_relaxation, false,
+            "Bound the objective with the linear relaxation of the linear "
+            "constraints");
+DEFINE_bool(lns, false,
+            "Improve the solutions of optimization problems with a large "
+            "neighborhood search instead of a complete search. It never "
+            "proves optimality and runs until the time limit. In parallel, "
+            "only the odd workers use it");
+DEFINE_int32(lns_failures, 100,
+             "Number of failures allowed in each neighbor of the large "
+             "neighborhood search");
 DEFINE_bool(presolve, true, "Use presolve.");
+DEFINE_string(presolve_cache_dir, "",
+              "If not empty, directory where the presolved models are cached. "
+              "A run on an input that is in the cache skips the parsing and "
+              "the presolve");
 DEFINE_bool(read_from_stdin, false, "Read the FlatZinc from stdin, not from a file");
 
 DECLARE_bool(fz_logging);
@@ -80,6 +105,9 @@ void SequentialRun(const FzModel* model) {
   parameters.threads = FLAGS_workers;
   parameters.time_limit_in_ms = FLAGS_time_limit;
   parameters.use_log = FLAGS_fz_logging;
+  parameters.use_lp_relaxation = FLAGS_lp_relaxation;
+  parameters.use_lns = FLAGS_lns;
+  parameters.lns_failures = FLAGS_lns_failures;
   parameters.verbose_impact = FLAGS_verbose_impact;
   parameters.worker_id = -1;
   parameters.search_type =
@@ -103,6 +131,11 @@ void ParallelRun(const FzModel* const model, int worker_id,
   parameters.threads = FLAGS_workers;
   parameters.time_limit_in_ms = FLAGS_time_limit;
   parameters.use_log = false;
+  parameters.use_lp_relaxation = FLAGS_lp_relaxation;
+  // The even workers (including worker 0) keep a complete search to prove
+  // optimality, the odd ones improve the shared bound with LNS.
+  parameters.use_lns = FLAGS_lns && worker_id % 2 == 1;
+  parameters.lns_failures = FLAGS_lns_failures;
   parameters.verbose_impact = false;
   parameters.worker_id = worker_id;
   switch (worker_id) {
@@ -215,26 +248,53 @@ void ParseAndRun(const std::string& input, int num_workers, bool input_is_filena
       problem_name = problem_name.substr(found + 1);
     }
   }
-  FzModel model(problem_name);
-  if (input_is_filename) {
-    CHECK(ParseFlatzincFile(input, &model));
-  } else {
-    CHECK(ParseFlatzincString(input, &model));
+  std::unique_ptr<FzModel> model(new FzModel(problem_name));
+  std::string cache_filename;
+  std::string contents;
+  if (!FLAGS_presolve_cache_dir.empty()) {
+    if (input_is_filename) {
+      CHECK(file::ReadFileToString(input, &contents))
+          << "Could not read '" << input << "'";
+    }
+    const std::string& text = input_is_filename ? contents : input;
+    cache_filename = FzCacheFilename(
+        FLAGS_presolve_cache_dir, text,
+        StringPrintf("presolve=%d use_sat=%d", FLAGS_presolve, FLAGS_use_sat));
   }
+  if (!cache_filename.empty() &&
+      LoadPresolvedModel(cache_filename, model.get())) {
+    FZLOG << "Presolved model loaded from " << cache_filename << " in "
+          << timer.GetInMs() << " ms" << FZENDL;
+  } else {
+    // A failed load may have left a partial model.
+    model.reset(new FzModel(problem_name));
+    if (!contents.empty()) {
+      CHECK(ParseFlatzincString(contents, model.get()));
+    } else if (input_is_filename) {
+      CHECK(ParseFlatzincFile(input, model.get()));
+    } else {
+      CHECK(ParseFlatzincString(input, model.get()));
+    }
 
-  FZLOG << "File " << (input_is_filename ? input : "stdin")
-        << " parsed in " << timer.GetInMs() << " ms"
-        << FZENDL;
-  FzPresolver presolve;
-  presolve.CleanUpModelForTheCpSolver(&model, FLAGS_use_sat);
-  if (FLAGS_presolve) {
-    FZLOG << "Presolve model" << FZENDL;
-    timer.Reset();
-    timer.Start();
-    presolve.Run(&model);
-    FZLOG << "  - done in " << timer.GetInMs() << " ms" << FZENDL;
+    FZLOG << "File " << (input_is_filename ? input : "stdin")
+          << " parsed in " << timer.GetInMs() << " ms"
+          << FZENDL;
+    FzPresolver presolve;
+    presolve.CleanUpModelForTheCpSolver(model.get(), FLAGS_use_sat);
+    if (FLAGS_presolve) {
+      FZLOG << "Presolve model" << FZENDL;
+      timer.Reset();
+      timer.Start();
+      presolve.Run(model.get());
+      FZLOG << "  - done in " << timer.GetInMs() << " ms" << FZENDL;
+    }
+    if (!cache_filename.empty() &&
+        !SavePresolvedModel(*model, cache_filename)) {
+      LOG(WARNING) << "Could not write the presolved model to "
+                   << cache_filename;
+    }
   }
-  FzModelStatistics stats(model);
+  FzModelStatistics stats(*model);
   stats.PrintStatistics();
 
 #if defined(__GNUC__)
@@ -242,15 +302,22 @@ void ParseAndRun(const std::string& input, int num_workers, bool input_is_filena
 #endif
 
   if (num_workers == 0) {
-    operations_research::SequentialRun(&model);
+    operations_research::SequentialRun(model.get());
   } else {
     std::unique_ptr<operations_research::FzParallelSupportInterface>
-        parallel_support(operations_research::MakeMtSupport(
-            FLAGS_all, FLAGS_num_solutions, FLAGS_verbose_mt));
+        parallel_support(
+            FLAGS_deterministic
+                ? operations_research::MakeDeterministicMtSupport(
+                      FLAGS_all, FLAGS_num_solutions, FLAGS_verbose_mt,
+                      num_workers, FLAGS_share_clauses, FLAGS_epoch_length)
+                : operations_research::MakeMtSupport(
+                      FLAGS_all, FLAGS_num_solutions, FLAGS_verbose_mt,
+                      num_workers, FLAGS_share_clauses));
     {
       ThreadPool pool("Parallel FlatZinc", num_workers);
       for (int w = 0; w < num_workers; ++w) {
-        pool.Add(NewCallback(ParallelRun, &model, w, parallel_support.get()));
+        pool.Add(
+            NewCallback(ParallelRun, model.get(), w, parallel_support.get()));
       }
       pool.StartWorkers();
     }
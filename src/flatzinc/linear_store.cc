@@ -0,0 +1,284 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "flatzinc/linear_store.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "base/stringprintf.h"
+#include "base/flat_hash.h"
+#include "base/map_util.h"
+#include "constraint_solver/constraint_solver.h"
+#include "constraint_solver/constraint_solveri.h"
+#include "util/saturated_arithmetic.h"
+
+namespace operations_research {
+namespace {
+// Bound on the absolute value of the activity of a row and of its range.
+// Sums and differences of three such values cannot overflow.
+const int64 kMaxActivity = kint64max / 4;
+}  // namespace
+
+class LinearStore : public Constraint {
+ public:
+  explicit LinearStore(Solver* solver)
+      : Constraint(solver), propagate_demon_(nullptr) {
+    row_starts_.push_back(0);
+  }
+
+  ~LinearStore() {}
+
+  bool AddRow(const std::vector<IntVar*>& vars,
+              const std::vector<int64>& coeffs, int64 range_min,
+              int64 range_max) {
+    DCHECK_EQ(vars.size(), coeffs.size());
+    int64 max_activity = 0;
+    for (int i = 0; i < vars.size(); ++i) {
+      const int64 bound = std::max(std::abs(vars[i]->Min()),
+                                   std::abs(vars[i]->Max()));
+      max_activity =
+          CapAdd(max_activity, CapProd(std::abs(coeffs[i]), bound));
+    }
+    if (max_activity > kMaxActivity ||
+        (range_min != kint64min && std::abs(range_min) > kMaxActivity) ||
+        (range_max != kint64max && std::abs(range_max) > kMaxActivity)) {
+      return false;
+    }
+    for (int i = 0; i < vars.size(); ++i) {
+      if (coeffs[i] == 0) {
+        continue;
+      }
+      entry_columns_.push_back(Column(vars[i]));
+      entry_coefficients_.push_back(coeffs[i]);
+    }
+    row_starts_.push_back(entry_columns_.size());
+    row_mins_.push_back(range_min);
+    row_maxs_.push_back(range_max);
+    return true;
+  }
+
+  int NumRows() const { return row_mins_.size(); }
+
+  virtual void Post() {
+    const int num_rows = NumRows();
+    const int num_columns = vars_.size();
+    // Transposes the rows into the columns.
+    column_starts_.assign(num_columns + 1, 0);
+    for (const int column : entry_columns_) {
+      column_starts_[column + 1]++;
+    }
+    for (int column = 0; column < num_columns; ++column) {
+      column_starts_[column + 1] += column_starts_[column];
+    }
+    column_rows_.resize(entry_columns_.size());
+    column_coefficients_.resize(entry_columns_.size());
+    std::vector<int> positions(column_starts_.begin(), column_starts_.end() - 1);
+    for (int row = 0; row < num_rows; ++row) {
+      for (int entry = row_starts_[row]; entry < row_starts_[row + 1];
+           ++entry) {
+        const int position = positions[entry_columns_[entry]]++;
+        column_rows_[position] = row;
+        column_coefficients_[position] = entry_coefficients_[entry];
+      }
+    }
+    activity_mins_.reset(new NumericalRevArray<int64>(num_rows, 0));
+    activity_maxs_.reset(new NumericalRevArray<int64>(num_rows, 0));
+    column_mins_.reset(new RevArray<int64>(num_columns, 0));
+    column_maxs_.reset(new RevArray<int64>(num_columns, 0));
+    dirty_.assign(num_rows, false);
+    for (int column = 0; column < num_columns; ++column) {
+      Demon* const demon = MakeConstraintDemon1(
+          solver(), this, &LinearStore::ColumnChanged, "ColumnChanged", column);
+      vars_[column]->WhenRange(demon);
+    }
+    propagate_demon_ = MakeDelayedConstraintDemon0(
+        solver(), this, &LinearStore::PropagateDirtyRows, "PropagateDirtyRows");
+  }
+
+  virtual void InitialPropagate() {
+    Solver* const s = solver();
+    for (int column = 0; column < vars_.size(); ++column) {
+      column_mins_->SetValue(s, column, vars_[column]->Min());
+      column_maxs_->SetValue(s, column, vars_[column]->Max());
+    }
+    dirty_rows_.clear();
+    for (int row = 0; row < NumRows(); ++row) {
+      int64 activity_min = 0;
+      int64 activity_max = 0;
+      for (int entry = row_starts_[row]; entry < row_starts_[row + 1];
+           ++entry) {
+        const int64 coeff = entry_coefficients_[entry];
+        IntVar* const var = vars_[entry_columns_[entry]];
+        activity_min += coeff * (coeff > 0 ? var->Min() : var->Max());
+        activity_max += coeff * (coeff > 0 ? var->Max() : var->Min());
+      }
+      activity_mins_->SetValue(s, row, activity_min);
+      activity_maxs_->SetValue(s, row, activity_max);
+      dirty_[row] = true;
+      dirty_rows_.push_back(row);
+    }
+    PropagateDirtyRows();
+  }
+
+  // Updates the activity bounds of the rows of the column, and schedules
+  // their propagation.
+  void ColumnChanged(int column) {
+    Solver* const s = solver();
+    IntVar* const var = vars_[column];
+    const int64 delta_min = var->Min() - column_mins_->Value(column);
+    const int64 delta_max = var->Max() - column_maxs_->Value(column);
+    if (delta_min == 0 && delta_max == 0) {
+      return;
+    }
+    column_mins_->SetValue(s, column, var->Min());
+    column_maxs_->SetValue(s, column, var->Max());
+    for (int entry = column_starts_[column];
+         entry < column_starts_[column + 1]; ++entry) {
+      const int row = column_rows_[entry];
+      const int64 coeff = column_coefficients_[entry];
+      if (coeff > 0) {
+        activity_mins_->Add(s, row, coeff * delta_min);
+        activity_maxs_->Add(s, row, coeff * delta_max);
+      } else {
+        activity_mins_->Add(s, row, coeff * delta_max);
+        activity_maxs_->Add(s, row, coeff * delta_min);
+      }
+      if (!dirty_[row]) {
+        dirty_[row] = true;
+        dirty_rows_.push_back(row);
+      }
+    }
+    EnqueueDelayedDemon(propagate_demon_);
+  }
+
+  // Propagates the bounds of the dirty rows onto their variables. A row
+  // that fails stays dirty; it is propagated again with the next one.
+  void PropagateDirtyRows() {
+    while (!dirty_rows_.empty()) {
+      const int row = dirty_rows_.back();
+      PropagateRow(row);
+      dirty_rows_.pop_back();
+      dirty_[row] = false;
+    }
+  }
+
+  virtual std::string DebugString() const {
+    return StringPrintf("LinearStore(%d rows, %d columns, %d entries)",
+                        NumRows(), static_cast<int>(vars_.size()),
+                        static_cast<int>(entry_columns_.size()));
+  }
+
+  void Accept(ModelVisitor* visitor) const {
+    VLOG(1) << "Should Not Be Visited";
+  }
+
+ private:
+  int Column(IntVar* var) {
+    const int* const column = FindOrNull(columns_, var);
+    if (column != nullptr) {
+      return *column;
+    }
+    const int index = vars_.size();
+    vars_.push_back(var);
+    columns_[var] = index;
+    return index;
+  }
+
+  void PropagateRow(int row) {
+    const int64 activity_min = activity_mins_->Value(row);
+    const int64 activity_max = activity_maxs_->Value(row);
+    const int64 range_min = row_mins_[row];
+    const int64 range_max = row_maxs_[row];
+    const bool has_min = range_min != kint64min;
+    const bool has_max = range_max != kint64max;
+    if ((has_min && activity_max < range_min) ||
+        (has_max && activity_min > range_max)) {
+      solver()->Fail();
+    }
+    if ((!has_min || activity_min >= range_min) &&
+        (!has_max || activity_max <= range_max)) {
+      return;  // Entailed.
+    }
+    for (int entry = row_starts_[row]; entry < row_starts_[row + 1]; ++entry) {
+      const int64 coeff = entry_coefficients_[entry];
+      IntVar* const var = vars_[entry_columns_[entry]];
+      const int64 term_min = coeff * (coeff > 0 ? var->Min() : var->Max());
+      const int64 term_max = coeff * (coeff > 0 ? var->Max() : var->Min());
+      // Bounds on coeff * var implied by the other terms of the row.
+      if (has_max) {
+        const int64 term_bound = range_max - (activity_min - term_min);
+        if (term_bound < term_max) {
+          if (coeff > 0) {
+            var->SetMax(PosIntDivDown(term_bound, coeff));
+          } else {
+            var->SetMin(PosIntDivUp(-term_bound, -coeff));
+          }
+        }
+      }
+      if (has_min) {
+        const int64 term_bound = range_min - (activity_max - term_max);
+        if (term_bound > term_min) {
+          if (coeff > 0) {
+            var->SetMin(PosIntDivUp(term_bound, coeff));
+          } else {
+            var->SetMax(PosIntDivDown(-term_bound, -coeff));
+          }
+        }
+      }
+    }
+  }
+
+  // Columns.
+  std::vector<IntVar*> vars_;
+  FlatHashMap<IntVar*, int> columns_;
+  // Rows, stored row by row: the entries of row r are in
+  // [row_starts_[r], row_starts_[r + 1]).
+  std::vector<int> row_starts_;
+  std::vector<int> entry_columns_;
+  std::vector<int64> entry_coefficients_;
+  std::vector<int64> row_mins_;
+  std::vector<int64> row_maxs_;
+  // The same matrix stored column by column, built by Post().
+  std::vector<int> column_starts_;
+  std::vector<int> column_rows_;
+  std::vector<int64> column_coefficients_;
+  // Bounds of the activity of each row, and bounds of each column the
+  // last time they were accounted for in these activities.
+  std::unique_ptr<NumericalRevArray<int64>> activity_mins_;
+  std::unique_ptr<NumericalRevArray<int64>> activity_maxs_;
+  std::unique_ptr<RevArray<int64>> column_mins_;
+  std::unique_ptr<RevArray<int64>> column_maxs_;
+  // Rows to propagate. dirty_[r] is true iff r is in dirty_rows_.
+  std::vector<int> dirty_rows_;
+  std::vector<bool> dirty_;
+  Demon* propagate_demon_;
+};
+
+LinearStore* MakeLinearStore(Solver* solver) {
+  return solver->RevAlloc(new LinearStore(solver));
+}
+
+bool AddLinearRow(LinearStore* store, const std::vector<IntVar*>& vars,
+                  const std::vector<int64>& coeffs, int64 range_min,
+                  int64 range_max) {
+  return store->AddRow(vars, coeffs, range_min, range_max);
+}
+
+int NumLinearRows(LinearStore* store) { return store->NumRows(); }
+}  // namespace operations_research
@@ -0,0 +1,45 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Bulk propagator for the linear constraints of a model. Instead of one
+// scalar product constraint (and its intermediate expressions) per linear
+// constraint, all the rows are stored in one sparse matrix, indexed both by
+// row and by column, inside a single constraint. Each variable has one demon
+// that updates incrementally the bounds of the activity of its rows, and a
+// single delayed demon propagates the rows whose bounds have changed.
+
+#ifndef OR_TOOLS_FLATZINC_LINEAR_STORE_H_
+#define OR_TOOLS_FLATZINC_LINEAR_STORE_H_
+
+#include <vector>
+
+#include "base/integral_types.h"
+#include "constraint_solver/constraint_solver.h"
+
+namespace operations_research {
+class LinearStore;
+
+// Creates the store. It must be added to the solver before the search, and
+// all its rows must be added before the search starts.
+LinearStore* MakeLinearStore(Solver* solver);
+
+// Adds the row range_min <= sum(coeffs[i] * vars[i]) <= range_max to the
+// store. Returns false (and adds nothing) if the activity of the row may
+// overflow.
+bool AddLinearRow(LinearStore* store, const std::vector<IntVar*>& vars,
+                  const std::vector<int64>& coeffs, int64 range_min,
+                  int64 range_max);
+
+int NumLinearRows(LinearStore* store);
+}  // namespace operations_research
+#endif  // OR_TOOLS_FLATZINC_LINEAR_STORE_H_
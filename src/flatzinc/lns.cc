@@ -0,0 +1,342 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "flatzinc/lns.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/commandlineflags.h"
+#include "base/hash.h"
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "base/map_util.h"
+#include "base/random.h"
+#include "base/stringprintf.h"
+#include "constraint_solver/constraint_solver.h"
+#include "constraint_solver/constraint_solveri.h"
+
+DECLARE_bool(fz_logging);
+DECLARE_bool(fz_verbose);
+
+namespace operations_research {
+namespace {
+// Initial size of the fragments, as a fraction of the number of variables.
+const double kInitialFragmentRatio = 0.1;
+
+// Factor applied to the size of the fragments of a kind after each sub-search
+// that does not improve the solution.
+const double kFragmentGrowth = 1.1;
+
+// Maximum number of consecutive windows of the annotation arrays that bring no
+// new variable to a fragment before it is completed with random variables.
+const int kMaxUselessWindows = 16;
+
+// Large neighborhood search operator whose fragments follow the constraints
+// and the arrays of the model, with one adaptive fragment size per kind of
+// fragment.
+class StructureLns : public BaseLNS {
+ public:
+  enum FragmentKind {
+    CONSTRAINT_GRAPH,
+    ARRAY_WINDOW,
+    RANDOM,
+    NUM_KINDS,
+  };
+
+  // constraint_vars[c] lists the indices of the variables of the constraint c
+  // and arrays[a] the indices of the variables of the array a, in order.
+  // 'limit' is the failure limit of the sub-searches.
+  StructureLns(const std::vector<IntVar*>& vars,
+               std::vector<std::vector<int>> constraint_vars,
+               std::vector<std::vector<int>> arrays, SearchLimit* limit,
+               int seed)
+      : BaseLNS(vars),
+        constraint_vars_(std::move(constraint_vars)),
+        var_constraints_(vars.size()),
+        arrays_(std::move(arrays)),
+        limit_(limit),
+        rand_(seed),
+        marked_(vars.size(), false),
+        ratios_(NUM_KINDS, kInitialFragmentRatio),
+        num_fragments_(NUM_KINDS, 0),
+        last_kind_(-1),
+        next_kind_(0) {
+    for (int c = 0; c < constraint_vars_.size(); ++c) {
+      for (const int var : constraint_vars_[c]) {
+        var_constraints_[var].push_back(c);
+      }
+    }
+    if (!constraint_vars_.empty()) kinds_.push_back(CONSTRAINT_GRAPH);
+    if (!arrays_.empty()) kinds_.push_back(ARRAY_WINDOW);
+    kinds_.push_back(RANDOM);
+  }
+
+  virtual ~StructureLns() {
+    FZVLOG << "Structure LNS: " << num_fragments_[CONSTRAINT_GRAPH]
+           << " constraint fragments (ratio " << ratios_[CONSTRAINT_GRAPH]
+           << "), " << num_fragments_[ARRAY_WINDOW]
+           << " array fragments (ratio " << ratios_[ARRAY_WINDOW] << "), "
+           << num_fragments_[RANDOM] << " random fragments (ratio "
+           << ratios_[RANDOM] << ")" << FZENDL;
+  }
+
+  // Called each time the current solution changes.
+  virtual void InitFragments() { last_kind_ = -1; }
+
+  virtual bool NextFragment(std::vector<int>* fragment) {
+    // If the last fragment did not lead to a new solution, its sub-search
+    // either reached the failure limit (the fragment was too large to be
+    // explored) or proved that it did not contain a better solution (it was
+    // too small).
+    if (last_kind_ >= 0) {
+      if (limit_->crossed()) {
+        ratios_[last_kind_] =
+            std::max(1.0 / Size(), ratios_[last_kind_] / kFragmentGrowth);
+      } else {
+        ratios_[last_kind_] =
+            std::min(1.0, ratios_[last_kind_] * kFragmentGrowth);
+      }
+    }
+    const int kind = kinds_[next_kind_];
+    next_kind_ = (next_kind_ + 1) % kinds_.size();
+    const int size = std::max(
+        1, std::min(static_cast<int>(ratios_[kind] * Size()), Size()));
+    switch (kind) {
+      case CONSTRAINT_GRAPH: {
+        ConstraintFragment(size, fragment);
+        break;
+      }
+      case ARRAY_WINDOW: {
+        ArrayFragment(size, fragment);
+        break;
+      }
+      default: { RandomFragment(size, fragment); }
+    }
+    for (const int var : *fragment) {
+      marked_[var] = false;
+    }
+    last_kind_ = kind;
+    num_fragments_[kind]++;
+    return true;
+  }
+
+  virtual std::string DebugString() const { return "StructureLns"; }
+
+ private:
+  void AddToFragment(int var, std::vector<int>* fragment) {
+    if (!marked_[var]) {
+      marked_[var] = true;
+      fragment->push_back(var);
+    }
+  }
+
+  // Returns a random variable that is not yet in the fragment.
+  int RandomFreeVariable() {
+    int var = rand_.Uniform(Size());
+    while (marked_[var]) {
+      var = var + 1 == Size() ? 0 : var + 1;
+    }
+    return var;
+  }
+
+  // Grows the fragment in breadth-first order from a random variable, adding
+  // the variables of the constraints of each variable of the fragment, from
+  // a random one. Restarts from a new random variable when the connected
+  // component is exhausted.
+  void ConstraintFragment(int size, std::vector<int>* fragment) {
+    int next = 0;
+    while (fragment->size() < size) {
+      if (next == fragment->size()) {
+        AddToFragment(RandomFreeVariable(), fragment);
+      }
+      const std::vector<int>& constraints = var_constraints_[(*fragment)[next]];
+      ++next;
+      if (constraints.empty()) continue;
+      const int first_constraint = rand_.Uniform(constraints.size());
+      for (int i = 0; i < constraints.size() && fragment->size() < size; ++i) {
+        const std::vector<int>& vars =
+            constraint_vars_[constraints[(first_constraint + i) %
+                                         constraints.size()]];
+        const int first_var = rand_.Uniform(vars.size());
+        for (int j = 0; j < vars.size() && fragment->size() < size; ++j) {
+          AddToFragment(vars[(first_var + j) % vars.size()], fragment);
+        }
+      }
+    }
+  }
+
+  // Adds windows of consecutive variables of random arrays.
+  void ArrayFragment(int size, std::vector<int>* fragment) {
+    int useless_windows = 0;
+    while (fragment->size() < size && useless_windows < kMaxUselessWindows) {
+      const std::vector<int>& array = arrays_[rand_.Uniform(arrays_.size())];
+      const int length =
+          std::min<int>(array.size(), size - fragment->size());
+      const int start = rand_.Uniform(array.size());
+      const int old_size = fragment->size();
+      for (int i = 0; i < length; ++i) {
+        AddToFragment(array[(start + i) % array.size()], fragment);
+      }
+      useless_windows = fragment->size() == old_size ? useless_windows + 1 : 0;
+    }
+    RandomFragment(size, fragment);
+  }
+
+  void RandomFragment(int size, std::vector<int>* fragment) {
+    while (fragment->size() < size) {
+      AddToFragment(RandomFreeVariable(), fragment);
+    }
+  }
+
+  const std::vector<std::vector<int>> constraint_vars_;
+  std::vector<std::vector<int>> var_constraints_;
+  const std::vector<std::vector<int>> arrays_;
+  SearchLimit* const limit_;
+  ACMRandom rand_;
+  std::vector<bool> marked_;
+  // The kinds of fragments that the model supports, used in turn.
+  std::vector<int> kinds_;
+  // Size of the fragments of each kind, as a fraction of the number of
+  // variables.
+  std::vector<double> ratios_;
+  std::vector<int64> num_fragments_;
+  // Kind of the last fragment, or -1 if it led to the current solution.
+  int last_kind_;
+  int next_kind_;
+};
+
+// Restricts the objective to values strictly better than the best solution.
+// The objective monitor only does so on the main search, not in the nested
+// sub-searches of the neighbors.
+class ObjectiveBound : public DecisionBuilder {
+ public:
+  ObjectiveBound(OptimizeVar* objective, bool maximize)
+      : objective_(objective), maximize_(maximize) {}
+  virtual ~ObjectiveBound() {}
+
+  virtual Decision* Next(Solver* const s) {
+    if (maximize_) {
+      objective_->Var()->SetMin(objective_->best() + 1);
+    } else {
+      objective_->Var()->SetMax(objective_->best() - 1);
+    }
+    return nullptr;
+  }
+
+  virtual std::string DebugString() const { return "ObjectiveBound"; }
+
+ private:
+  OptimizeVar* const objective_;
+  const bool maximize_;
+};
+
+void CollectSearchArrays(const FzAnnotation& ann,
+                         std::vector<std::vector<FzIntegerVariable*>>* arrays) {
+  if (ann.type == FzAnnotation::ANNOTATION_LIST ||
+      ann.IsFunctionCallWithIdentifier("seq_search")) {
+    for (const FzAnnotation& inner : ann.annotations) {
+      CollectSearchArrays(inner, arrays);
+    }
+  } else if (ann.IsFunctionCallWithIdentifier("int_search") ||
+             ann.IsFunctionCallWithIdentifier("bool_search")) {
+    arrays->resize(arrays->size() + 1);
+    ann.annotations[0].GetAllIntegerVariables(&arrays->back());
+  }
+}
+}  // namespace
+
+DecisionBuilder* MakeStructureLns(const FzModel& model, FzSolver* fzsolver,
+                                  const std::vector<IntVar*>& vars,
+                                  DecisionBuilder* db, OptimizeVar* objective,
+                                  int max_failures, int seed) {
+  if (vars.empty()) return db;
+  Solver* const solver = fzsolver->solver();
+  hash_map<IntVar*, int> indices;
+  for (int i = 0; i < vars.size(); ++i) {
+    indices[vars[i]] = i;
+  }
+  // Appends the index of 'var' to 'out'. If 'var' is not a variable of the
+  // neighborhood but is defined by a constraint, appends the indices of the
+  // variables of this constraint instead.
+  auto add_indices = [fzsolver, &indices](FzIntegerVariable* var,
+                                          bool expand_defined,
+                                          std::vector<int>* out) {
+    IntExpr* const expr = fzsolver->Extract(var);
+    if (expr->IsVar() && ContainsKey(indices, expr->Var())) {
+      out->push_back(indices[expr->Var()]);
+    } else if (expand_defined && var->defining_constraint != nullptr) {
+      for (const FzArgument& arg : var->defining_constraint->arguments) {
+        for (FzIntegerVariable* const inner : arg.variables) {
+          IntExpr* const inner_expr = fzsolver->Extract(inner);
+          if (inner_expr->IsVar() && ContainsKey(indices, inner_expr->Var())) {
+            out->push_back(indices[inner_expr->Var()]);
+          }
+        }
+      }
+    }
+  };
+
+  std::vector<std::vector<int>> constraint_vars;
+  for (FzConstraint* const ct : model.constraints()) {
+    if (!ct->active) continue;
+    std::vector<int> ct_vars;
+    for (const FzArgument& arg : ct->arguments) {
+      for (FzIntegerVariable* const var : arg.variables) {
+        if (var != ct->target_variable) {
+          add_indices(var, true, &ct_vars);
+        }
+      }
+    }
+    std::sort(ct_vars.begin(), ct_vars.end());
+    ct_vars.erase(std::unique(ct_vars.begin(), ct_vars.end()), ct_vars.end());
+    if (ct_vars.size() > 1) {
+      constraint_vars.push_back(std::move(ct_vars));
+    }
+  }
+
+  std::vector<std::vector<FzIntegerVariable*>> fz_arrays;
+  for (const FzAnnotation& ann : model.search_annotations()) {
+    CollectSearchArrays(ann, &fz_arrays);
+  }
+  for (const FzOnSolutionOutput& output : model.output()) {
+    fz_arrays.push_back(output.flat_variables);
+  }
+  std::vector<std::vector<int>> arrays;
+  for (const std::vector<FzIntegerVariable*>& fz_array : fz_arrays) {
+    std::vector<int> array;
+    for (FzIntegerVariable* const var : fz_array) {
+      add_indices(var, false, &array);
+    }
+    if (array.size() > 1) {
+      arrays.push_back(std::move(array));
+    }
+  }
+
+  FZLOG << "  - large neighborhood search on " << vars.size()
+        << " variables, " << constraint_vars.size() << " constraints and "
+        << arrays.size() << " arrays, " << max_failures
+        << " failures per neighbor" << FZENDL;
+  SearchLimit* const limit = solver->MakeFailuresLimit(max_failures);
+  LocalSearchOperator* const lns = solver->RevAlloc(new StructureLns(
+      vars, std::move(constraint_vars), std::move(arrays), limit, seed));
+  DecisionBuilder* const bound =
+      solver->RevAlloc(new ObjectiveBound(objective, model.maximize()));
+  DecisionBuilder* const sub_db =
+      solver->MakeSolveOnce(solver->Compose(bound, db), limit);
+  return solver->MakeLocalSearchPhase(
+      vars, db, solver->MakeLocalSearchPhaseParameters(lns, sub_db));
+}
+}  // namespace operations_research
@@ -0,0 +1,49 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OR_TOOLS_FLATZINC_LNS_H_
+#define OR_TOOLS_FLATZINC_LNS_H_
+
+#include <vector>
+
+#include "base/integral_types.h"
+#include "constraint_solver/constraint_solver.h"
+#include "flatzinc/model.h"
+#include "flatzinc/solver.h"
+
+namespace operations_research {
+// Returns a decision builder that runs a large neighborhood search on 'vars'
+// from the first solution found by 'db'. Each neighbor frees a fragment of
+// 'vars', fixes the others to their value in the current solution, and
+// re-solves the fragment with 'db' under a limit of 'max_failures' failures.
+// The sub-searches must improve on the best objective value found so far
+// by 'objective'.
+//
+// The fragments follow the structure of the model. They alternate between:
+//   - variables that share constraints with a random variable (the variables
+//     defined by a constraint connect all the variables of this constraint),
+//   - consecutive variables of the arrays of the search annotations and of
+//     the output,
+//   - random variables.
+// The size of the fragments of each kind adapts to the outcome of the
+// sub-searches: it shrinks when they reach the failure limit, and it grows
+// when they prove that the fragment holds no better solution.
+//
+// The model must have been extracted. The search never ends by itself once
+// it has found a solution: it must be stopped by a limit.
+DecisionBuilder* MakeStructureLns(const FzModel& model, FzSolver* fzsolver,
+                                  const std::vector<IntVar*>& vars,
+                                  DecisionBuilder* db, OptimizeVar* objective,
+                                  int max_failures, int seed);
+}  // namespace operations_research
+#endif  // OR_TOOLS_FLATZINC_LNS_H_
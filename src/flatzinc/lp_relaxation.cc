@@ -0,0 +1,276 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "flatzinc/lp_relaxation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/commandlineflags.h"
+#include "base/hash.h"
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "base/map_util.h"
+#include "base/stringprintf.h"
+#include "constraint_solver/constraint_solver.h"
+#include "constraint_solver/constraint_solveri.h"
+#include "glop/incremental_lp_solver.h"
+#include "glop/parameters.pb.h"
+#include "lp_data/lp_data.h"
+#include "lp_data/lp_types.h"
+#include "util/time_limit.h"
+
+DECLARE_bool(fz_logging);
+DECLARE_bool(fz_verbose);
+
+namespace operations_research {
+namespace {
+// The variable bounds with a larger magnitude are considered infinite by the
+// linear relaxation.
+const double kMaxFiniteBound = 1e9;
+
+// The dual simplex is stopped after this number of iterations at the search
+// nodes (but not at the root node). Its bound is then ignored.
+const int64 kMaxSimplexIterationsPerNode = 1000;
+
+// Relative tolerance used to round the bounds deduced from the relaxation.
+const double kTolerance = 1e-6;
+
+// Constraint that keeps a Glop linear program in sync with the bounds of its
+// variables, and uses it to bound the objective and shrink the domains.
+class LinearRelaxation : public Constraint {
+ public:
+  // The linear program must be cleaned up. Its column i corresponds to
+  // vars[i], and it must minimize the objective (or its opposite if
+  // maximize is true), which is the column objective_col.
+  LinearRelaxation(Solver* const solver, const glop::LinearProgram& lp,
+                   const std::vector<IntVar*>& vars, int objective_col,
+                   bool maximize)
+      : Constraint(solver),
+        vars_(vars),
+        objective_col_(objective_col),
+        maximize_(maximize),
+        lp_min_(vars.size(), kint64min),
+        lp_max_(vars.size(), kint64max),
+        time_limit_(TimeLimit::Infinite()),
+        num_rows_(lp.num_constraints().value()),
+        num_solves_(0),
+        num_bound_changes_(0) {
+    lp_solver_.Load(lp);
+  }
+
+  ~LinearRelaxation() {
+    FZVLOG << "Linear relaxation: " << num_solves_ << " solves, "
+           << num_bound_changes_ << " bound changes" << FZENDL;
+  }
+
+  virtual void Post() {
+    Demon* const demon = MakeDelayedConstraintDemon0(
+        solver(), this, &LinearRelaxation::Propagate, "Propagate");
+    for (IntVar* const var : vars_) {
+      var->WhenRange(demon);
+    }
+  }
+
+  virtual void InitialPropagate() { Propagate(); }
+
+  virtual std::string DebugString() const {
+    return StringPrintf("LinearRelaxation(%d variables, %d constraints)",
+                        static_cast<int>(vars_.size()), num_rows_);
+  }
+
+  void Accept(ModelVisitor* visitor) const {
+    VLOG(1) << "Should Not Be Visited";
+  }
+
+ private:
+  static double ToLpBound(int64 value) {
+    if (value >= kMaxFiniteBound) return glop::kInfinity;
+    if (value <= -kMaxFiniteBound) return -glop::kInfinity;
+    return static_cast<double>(value);
+  }
+
+  // Rounds the real bounds up or down to the closest integer, with a tolerance
+  // for the numerical errors of the simplex.
+  static int64 RoundUp(double value) {
+    return static_cast<int64>(
+        std::ceil(value - kTolerance * std::max(1.0, std::abs(value))));
+  }
+  static int64 RoundDown(double value) {
+    return static_cast<int64>(
+        std::floor(value + kTolerance * std::max(1.0, std::abs(value))));
+  }
+
+  // Copies the bounds of the variables that changed since the last solve.
+  // Returns false if there were none.
+  bool SyncBounds() {
+    bool changed = false;
+    for (int i = 0; i < vars_.size(); ++i) {
+      const int64 new_min = vars_[i]->Min();
+      const int64 new_max = vars_[i]->Max();
+      if (new_min != lp_min_[i] || new_max != lp_max_[i]) {
+        lp_min_[i] = new_min;
+        lp_max_[i] = new_max;
+        lp_solver_.SetVariableBounds(glop::ColIndex(i), ToLpBound(new_min),
+                                     ToLpBound(new_max));
+        changed = true;
+      }
+    }
+    return changed;
+  }
+
+  void Propagate() {
+    if (!SyncBounds() && num_solves_ > 0) return;
+    glop::GlopParameters parameters;
+    if (num_solves_ > 0) {
+      parameters.set_max_number_of_iterations(kMaxSimplexIterationsPerNode);
+    }
+    lp_solver_.SetParameters(parameters);
+    ++num_solves_;
+    const glop::ProblemStatus status = lp_solver_.Solve(time_limit_.get());
+    if (status == glop::ProblemStatus::PRIMAL_INFEASIBLE ||
+        status == glop::ProblemStatus::DUAL_UNBOUNDED) {
+      solver()->Fail();
+    }
+    if (status != glop::ProblemStatus::OPTIMAL) return;
+
+    // The relaxation minimizes sign * objective.
+    const double lp_bound = lp_solver_.GetObjectiveValue();
+    IntVar* const objective = vars_[objective_col_];
+    if (maximize_) {
+      objective->SetMax(RoundDown(-lp_bound));
+    } else {
+      objective->SetMin(RoundUp(lp_bound));
+    }
+
+    // Reduced cost fixing: the objective of any solution is at least
+    // lp_bound + reduced_cost * (value - bound) for each variable at one of
+    // its bounds in the relaxation, and at most the current objective bound.
+    const int64 objective_bound =
+        maximize_ ? -objective->Min() : objective->Max();
+    if (std::abs(objective_bound) >= kMaxFiniteBound) return;
+    const double gap = objective_bound - lp_bound;
+    if (gap < 0) return;
+    for (int i = 0; i < vars_.size(); ++i) {
+      if (i == objective_col_) continue;
+      IntVar* const var = vars_[i];
+      if (var->Bound()) continue;
+      const glop::ColIndex col(i);
+      const double reduced_cost = lp_solver_.GetReducedCost(col);
+      const glop::VariableStatus var_status = lp_solver_.GetVariableStatus(col);
+      if (var_status == glop::VariableStatus::AT_LOWER_BOUND &&
+          reduced_cost > kTolerance && lp_min_[i] > -kMaxFiniteBound) {
+        const int64 new_max = lp_min_[i] + RoundDown(gap / reduced_cost);
+        if (new_max < var->Max()) {
+          ++num_bound_changes_;
+          var->SetMax(new_max);
+        }
+      } else if (var_status == glop::VariableStatus::AT_UPPER_BOUND &&
+                 reduced_cost < -kTolerance && lp_max_[i] < kMaxFiniteBound) {
+        const int64 new_min = lp_max_[i] - RoundDown(gap / -reduced_cost);
+        if (new_min > var->Min()) {
+          ++num_bound_changes_;
+          var->SetMin(new_min);
+        }
+      }
+    }
+  }
+
+  const std::vector<IntVar*> vars_;
+  const int objective_col_;
+  const bool maximize_;
+  // The bounds of the variables in the linear program.
+  std::vector<int64> lp_min_;
+  std::vector<int64> lp_max_;
+  glop::IncrementalLPSolver lp_solver_;
+  std::unique_ptr<TimeLimit> time_limit_;
+  const int num_rows_;
+  int64 num_solves_;
+  int64 num_bound_changes_;
+};
+
+// Returns the bounds of the linear constraint ct, or false if it is not one of
+// the linear constraints used by the relaxation.
+bool GetLinearConstraintBounds(const FzConstraint& ct, double* lower_bound,
+                               double* upper_bound) {
+  const std::string& type = ct.type;
+  if (type != "int_lin_eq" && type != "int_lin_le" && type != "int_lin_ge" &&
+      type != "bool_lin_eq" && type != "bool_lin_le") {
+    return false;
+  }
+  if (ct.Arg(0).values.size() != ct.Arg(1).variables.size() ||
+      !ct.Arg(2).HasOneValue()) {
+    return false;
+  }
+  const double rhs = static_cast<double>(ct.Arg(2).Value());
+  *lower_bound = type == "int_lin_le" || type == "bool_lin_le"
+                     ? -glop::kInfinity
+                     : rhs;
+  *upper_bound = type == "int_lin_ge" ? glop::kInfinity : rhs;
+  return true;
+}
+}  // namespace
+
+bool PostLinearRelaxation(const FzModel& model, FzSolver* fzsolver) {
+  if (model.objective() == nullptr) return false;
+  Solver* const solver = fzsolver->solver();
+  IntVar* const objective = fzsolver->Extract(model.objective())->Var();
+  glop::LinearProgram lp;
+  std::vector<IntVar*> vars;
+  hash_map<IntVar*, int> columns;
+  bool objective_in_rows = false;
+  for (FzConstraint* const ct : model.constraints()) {
+    double lower_bound = 0.0;
+    double upper_bound = 0.0;
+    if (!ct->active ||
+        !GetLinearConstraintBounds(*ct, &lower_bound, &upper_bound)) {
+      continue;
+    }
+    const glop::RowIndex row = lp.CreateNewConstraint();
+    lp.SetConstraintBounds(row, lower_bound, upper_bound);
+    // The same variable may appear several times in a row.
+    hash_map<int, double> coefficients;
+    for (int i = 0; i < ct->Arg(1).variables.size(); ++i) {
+      IntVar* const var = fzsolver->Extract(ct->Arg(1).variables[i])->Var();
+      if (!ContainsKey(columns, var)) {
+        columns[var] = vars.size();
+        vars.push_back(var);
+        lp.CreateNewVariable();
+      }
+      objective_in_rows |= var == objective;
+      coefficients[columns[var]] += ct->Arg(0).values[i];
+    }
+    for (const auto& entry : coefficients) {
+      lp.SetCoefficient(row, glop::ColIndex(entry.first), entry.second);
+    }
+  }
+  if (!objective_in_rows) return false;
+  const int objective_col = columns[objective];
+  lp.SetObjectiveCoefficient(glop::ColIndex(objective_col),
+                             model.maximize() ? -1.0 : 1.0);
+  // The bounds of the variables are set at the first propagation.
+  for (int i = 0; i < vars.size(); ++i) {
+    lp.SetVariableBounds(glop::ColIndex(i), -glop::kInfinity,
+                         glop::kInfinity);
+  }
+  lp.CleanUp();
+  FZLOG << "Linear relaxation with " << lp.num_constraints().value()
+        << " constraints and " << vars.size() << " variables" << FZENDL;
+  solver->AddConstraint(solver->RevAlloc(new LinearRelaxation(
+      solver, lp, vars, objective_col, model.maximize())));
+  return true;
+}
+}  // namespace operations_research
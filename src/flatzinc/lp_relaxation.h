@@ -0,0 +1,35 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OR_TOOLS_FLATZINC_LP_RELAXATION_H_
+#define OR_TOOLS_FLATZINC_LP_RELAXATION_H_
+
+#include "flatzinc/model.h"
+#include "flatzinc/solver.h"
+
+namespace operations_research {
+// Posts on the solver of fzsolver a constraint that maintains the linear
+// relaxation of the linear constraints of the model (int_lin_eq, int_lin_le,
+// int_lin_ge, bool_lin_eq and bool_lin_le) with the objective of the model.
+// The relaxation is re-solved with Glop each time the bounds of its variables
+// change, warm-started with the dual simplex from the last basis. Its optimum
+// bounds the objective, and its reduced costs shrink the domains of the
+// variables that cannot move away from their bound without exceeding the
+// current objective bound.
+//
+// The model must have been extracted. Returns false (and posts nothing) if
+// the model has no objective, or if the objective does not appear in any
+// linear constraint.
+bool PostLinearRelaxation(const FzModel& model, FzSolver* fzsolver);
+}  // namespace operations_research
+#endif  // OR_TOOLS_FLATZINC_LP_RELAXATION_H_
@@ -14,7 +14,9 @@
 #include "flatzinc/model.h"
 
 #include "base/hash.h"
+#include <algorithm>
 #include <iostream>  // NOLINT
+#include <iterator>
 #include <set>
 #include <vector>
 
@@ -37,6 +39,7 @@ FzDomain FzDomain::IntegerList(std::vector<int64> values) {
   FzDomain result;
   result.is_interval = false;
   result.values = std::move(values);
+  STLSortAndRemoveDuplicates(&result.values);
   result.display_as_boolean = false;
   return result;
 }
@@ -114,28 +117,32 @@ void FzDomain::IntersectWithInterval(int64 imin, int64 imax) {
       values[1] = std::min(values[1], imax);
     }
   } else {
-    std::sort(values.begin(), values.end());
-    std::vector<int64> new_values;
-    new_values.reserve(values.size());
-    for (const int64 val : values) {
-      if (val > imax) break;
-      if (val >= imin && (new_values.empty() || val != new_values.back())) {
-        new_values.push_back(val);
-      }
-    }
-    values.swap(new_values);
+    // The values are sorted: keep the ones in [imin..imax] in place.
+    values.erase(std::upper_bound(values.begin(), values.end(), imax),
+                 values.end());
+    values.erase(values.begin(),
+                 std::lower_bound(values.begin(), values.end(), imin));
   }
 }
 
 void FzDomain::IntersectWithListOfIntegers(const std::vector<int64>& ovalues) {
+  // The lists of values of the arguments are usually sorted already.
+  std::vector<int64> sorted_values;
+  const std::vector<int64>* other_values = &ovalues;
+  if (!std::is_sorted(ovalues.begin(), ovalues.end())) {
+    sorted_values = ovalues;
+    std::sort(sorted_values.begin(), sorted_values.end());
+    other_values = &sorted_values;
+  }
   if (is_interval) {
     const int64 dmin = values.empty() ? kint64min : values[0];
     const int64 dmax = values.empty() ? kint64max : values[1];
     values.clear();
-    for (const int64 v : ovalues) {
-      if (v >= dmin && v <= dmax) values.push_back(v);
+    for (auto it = std::lower_bound(other_values->begin(), other_values->end(),
+                                    dmin);
+         it != other_values->end() && *it <= dmax; ++it) {
+      if (values.empty() || *it != values.back()) values.push_back(*it);
     }
-    STLSortAndRemoveDuplicates(&values);
     if (!values.empty() &&
         values.back() - values.front() == values.size() - 1 &&
         values.size() >= 2) {
@@ -150,17 +157,12 @@ void FzDomain::IntersectWithListOfIntegers(const std::vector<int64>& ovalues) {
       is_interval = false;
     }
   } else {
-    // TODO(user): Investigate faster code for small arrays.
-    std::sort(values.begin(), values.end());
-    hash_set<int64> other_values(ovalues.begin(), ovalues.end());
+    // Both lists are sorted, std::set_intersection() merges them in linear
+    // time, and the result has no duplicates because values has none.
     std::vector<int64> new_values;
-    new_values.reserve(std::min(values.size(), ovalues.size()));
-    for (const int64 val : values) {
-      if (ContainsKey(other_values, val) &&
-          (new_values.empty() || val != new_values.back())) {
-        new_values.push_back(val);
-      }
-    }
+    new_values.reserve(std::min(values.size(), other_values->size()));
+    std::set_intersection(values.begin(), values.end(), other_values->begin(),
+                          other_values->end(), std::back_inserter(new_values));
     values.swap(new_values);
   }
 }
@@ -177,7 +179,7 @@ bool FzDomain::Contains(int64 value) const {
       return value >= values[0] && value <= values[1];
     }
   } else {
-    return std::find(values.begin(), values.end(), value) != values.end();
+    return std::binary_search(values.begin(), values.end(), value);
   }
 }
 
@@ -204,9 +206,13 @@ bool FzDomain::RemoveValue(int64 value) {
       is_interval = false;
       return true;
     }
+    // TODO(user): Remove values from the middle of large intervals.
+    return false;
   }
-  // TODO(user): Remove value from list.
-  return false;
+  const auto it = std::lower_bound(values.begin(), values.end(), value);
+  if (it == values.end() || *it != value) return false;
+  values.erase(it);
+  return true;
 }
 
 std::string FzDomain::DebugString() const {
@@ -628,23 +634,27 @@ std::string FzOnSolutionOutput::DebugString() const {
 
 // ----- FzModel -----
 
-FzModel::~FzModel() {
-  STLDeleteElements(&variables_);
-  STLDeleteElements(&constraints_);
-}
+FzModel::~FzModel() {}
 
 FzIntegerVariable* FzModel::AddVariable(const std::string& name,
                                         const FzDomain& domain, bool defined) {
-  FzIntegerVariable* const var = new FzIntegerVariable(name, domain, defined);
+  FzIntegerVariable* const var = new (variable_arena_.Allocate())
+      FzIntegerVariable(name, domain, defined);
   variables_.push_back(var);
   return var;
 }
 
+FzIntegerVariable* FzModel::AddConstantVariable(int64 value) {
+  return new (variable_arena_.Allocate())
+      FzIntegerVariable(StringPrintf("%" GG_LL_FORMAT "d", value),
+                        FzDomain::Singleton(value), true);
+}
+
 void FzModel::AddConstraint(const std::string& id,
                             std::vector<FzArgument> arguments, bool is_domain,
                             FzIntegerVariable* const defines) {
-  FzConstraint* const constraint =
-      new FzConstraint(id, std::move(arguments), is_domain, defines);
+  FzConstraint* const constraint = new (constraint_arena_.Allocate())
+      FzConstraint(id, std::move(arguments), is_domain, defines);
   constraints_.push_back(constraint);
   if (defines != nullptr) {
     defines->defining_constraint = constraint;
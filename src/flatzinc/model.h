@@ -15,11 +15,15 @@
 #define OR_TOOLS_FLATZINC_MODEL_H_
 
 #include <iostream>  // NOLINT
+#include <memory>
 #include <string>
+#include <type_traits>
+#include <vector>
 #include "base/hash.h"
 #include "base/commandlineflags.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
+#include "base/macros.h"
 #include "base/stringprintf.h"
 #include "base/hash.h"
 #include "util/iterators.h"
@@ -45,13 +49,15 @@ class FzIntegerVariable;
 // differently than an integer with domain {0, 1}).
 // It can be:
 //  - an explicit list of all possible values, in which case is_interval is
-//    false.
+//    false. The list is sorted and has no duplicates, so that Contains() and
+//    RemoveValue() are binary searches, and intersections are linear merges.
 //  - an interval, in which case is_interval is true and values.size() == 2,
 //    and the interval is [values[0], values[1]].
 //  - all integers, in which case values is empty, and is_interval is true.
 // Note that semi-infinite intervals aren't supported.
 // - A boolean domain({ 0, 1 } with boolean display tag).
 struct FzDomain {
+  // Sorts the values and removes the duplicates.
   static FzDomain IntegerList(std::vector<int64> values);
   static FzDomain AllInt64();
   static FzDomain Singleton(int64 value);
@@ -310,6 +316,51 @@ struct FzOnSolutionOutput {
   bool display_as_boolean;
 };
 
+#if !defined(SWIG)
+// Owns objects of type T allocated by blocks and destroyed with the arena,
+// which saves one memory allocation per object and keeps the objects of a
+// large model close in memory. The objects never move.
+template <class T>
+class FzArena {
+ public:
+  FzArena() : num_objects_in_last_block_(kBlockSize) {}
+  ~FzArena();
+
+  // Returns the memory of a new object, which the caller must construct in
+  // place right away with a placement new.
+  void* Allocate();
+
+ private:
+  static const int kBlockSize = 1024;
+  typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+
+  std::vector<std::unique_ptr<Storage[]>> blocks_;
+  int num_objects_in_last_block_;
+
+  DISALLOW_COPY_AND_ASSIGN(FzArena);
+};
+
+template <class T>
+FzArena<T>::~FzArena() {
+  for (int b = 0; b < blocks_.size(); ++b) {
+    const int num_objects =
+        b + 1 == blocks_.size() ? num_objects_in_last_block_ : kBlockSize;
+    for (int i = 0; i < num_objects; ++i) {
+      reinterpret_cast<T*>(&blocks_[b][i])->~T();
+    }
+  }
+}
+
+template <class T>
+void* FzArena<T>::Allocate() {
+  if (num_objects_in_last_block_ == kBlockSize) {
+    blocks_.emplace_back(new Storage[kBlockSize]);
+    num_objects_in_last_block_ = 0;
+  }
+  return &blocks_.back()[num_objects_in_last_block_++];
+}
+#endif  // SWIG
+
 class FzModel {
  public:
   explicit FzModel(const std::string& name)
@@ -324,6 +375,10 @@ class FzModel {
                                  bool temporary);
   void AddConstraint(const std::string& type, std::vector<FzArgument> arguments,
                      bool is_domain, FzIntegerVariable* const target_variable);
+  // Returns a new temporary variable fixed to the given value. It belongs to
+  // the model but is not one of its variables(): the parser uses these for
+  // the constants of the arrays of variables.
+  FzIntegerVariable* AddConstantVariable(int64 value);
   void AddOutput(const FzOnSolutionOutput& output);
 
   // Set the search annotations and the objective: either simply satisfy the
@@ -363,9 +418,14 @@ class FzModel {
 
  private:
   const std::string name_;
-  // owned.
+#if !defined(SWIG)
+  // The storage of all the variables and constraints of the model.
+  FzArena<FzIntegerVariable> variable_arena_;
+  FzArena<FzConstraint> constraint_arena_;
+#endif
+  // Allocated in variable_arena_.
   std::vector<FzIntegerVariable*> variables_;
-  // owned.
+  // Allocated in constraint_arena_.
   std::vector<FzConstraint*> constraints_;
   // The objective variable (it belongs to variables_).
   FzIntegerVariable* objective_;
@@ -11,34 +11,50 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
 #include <iostream>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <utility>
+#include <vector>
+
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/mutex.h"
 #include "base/stringprintf.h"
-#include "base/synchronization.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
 #include "flatzinc/model.h"
 #include "flatzinc/search.h"
+#include "sat/portfolio.h"
 
 DECLARE_bool(fz_logging);
 
 namespace operations_research {
 namespace {
+// The size in words of the ring buffer in which each worker publishes its
+// learned clauses, and the maximum size of these clauses.
+const int kClauseRingCapacity = 1 << 16;
+const int kMaxSharedClauseSize = 8;
+
 class MtOptimizeVar : public OptimizeVar {
  public:
   MtOptimizeVar(Solver* s, bool maximize, IntVar* v, int64 step,
-                FzParallelSupportInterface* support, int worker_id)
+                FzParallelSupportInterface* support,
+                const std::atomic<int64>* shared_bound, int worker_id)
       : OptimizeVar(s, maximize, v, step),
         support_(support),
+        shared_bound_(shared_bound),
         worker_id_(worker_id) {}
 
   virtual ~MtOptimizeVar() {}
 
   virtual void RefuteDecision(Decision* d) {
-    const int64 polled_best = support_->BestSolution();
+    const int64 polled_best = shared_bound_->load(std::memory_order_relaxed);
     if ((maximize_ && polled_best > best_) ||
         (!maximize_ && polled_best < best_)) {
       support_->Log(
@@ -52,6 +68,7 @@ class MtOptimizeVar : public OptimizeVar {
 
  private:
   FzParallelSupportInterface* const support_;
+  const std::atomic<int64>* const shared_bound_;
   const int worker_id_;
 };
 
@@ -83,15 +100,26 @@ class MtCustomLimit : public SearchLimit {
 
 class MtSupportInterface : public FzParallelSupportInterface {
  public:
-  MtSupportInterface(bool print_all, int num_solutions, bool verbose)
+  MtSupportInterface(bool print_all, int num_solutions, bool verbose,
+                     int num_workers, bool share_clauses)
       : print_all_(print_all),
         num_solutions_(num_solutions),
         verbose_(verbose),
+        share_clauses_(share_clauses),
         type_(UNDEF),
         last_worker_(-1),
+        shared_bound_(0),
         best_solution_(0),
         should_finish_(false),
-        interrupted_(false) {}
+        interrupted_(false),
+        read_positions_(num_workers, std::vector<int64>(num_workers, 0)) {
+    if (share_clauses) {
+      for (int w = 0; w < num_workers; ++w) {
+        rings_.emplace_back(new sat::SharedClauseRing(kClauseRingCapacity,
+                                                      kMaxSharedClauseSize));
+      }
+    }
+  }
 
   virtual ~MtSupportInterface() {}
 
@@ -109,65 +137,26 @@ class MtSupportInterface : public FzParallelSupportInterface {
       type_ = type;
       if (type == MAXIMIZE) {
         best_solution_ = kint64min;
+        shared_bound_ = kint64min;
       } else if (type_ == MINIMIZE) {
         best_solution_ = kint64max;
+        shared_bound_ = kint64max;
       }
     }
   }
 
   virtual void SatSolution(int worker_id, const std::string& solution_string) {
     MutexLock lock(&mutex_);
-    if (NumSolutions() < num_solutions_ || print_all_) {
-      LogNoLock(worker_id, "solution found");
-      std::cout << solution_string << std::endl;
-      should_finish_ = true;
-    }
-    IncrementSolutions();
+    SatSolutionNoLock(worker_id, solution_string);
   }
 
+  // The new bound is published without lock, so that the other workers can
+  // poll it right away; the output is then serialized by the mutex.
   virtual void OptimizeSolution(int worker_id, int64 value,
                                 const std::string& solution_string) {
+    if (should_finish_ || !PublishBound(value)) return;
     MutexLock lock(&mutex_);
-    if (!should_finish_) {
-      switch (type_) {
-        case MINIMIZE: {
-          if (value < best_solution_) {
-            best_solution_ = value;
-            IncrementSolutions();
-            LogNoLock(
-                worker_id,
-                StringPrintf("solution found with value %" GG_LL_FORMAT "d",
-                             value));
-            if (print_all_ || num_solutions_ > 1) {
-              std::cout << solution_string << std::endl;
-            } else {
-              last_solution_ = solution_string + "\n";
-              last_worker_ = worker_id;
-            }
-          }
-          break;
-        }
-        case MAXIMIZE: {
-          if (value > best_solution_) {
-            best_solution_ = value;
-            IncrementSolutions();
-            LogNoLock(
-                worker_id,
-                StringPrintf("solution found with value %" GG_LL_FORMAT "d",
-                             value));
-            if (print_all_ || num_solutions_ > 1) {
-              std::cout << solution_string << std::endl;
-            } else {
-              last_solution_ = solution_string + "\n";
-              last_worker_ = worker_id;
-            }
-          }
-          break;
-        }
-        default:
-          LOG(ERROR) << "Should not be here";
-      }
-    }
+    OptimizeSolutionNoLock(worker_id, value, solution_string);
   }
 
   virtual void FinalOutput(int worker_id, const std::string& final_output) {
@@ -179,25 +168,15 @@ class MtSupportInterface : public FzParallelSupportInterface {
 
   virtual void EndSearch(int worker_id, bool interrupted) {
     MutexLock lock(&mutex_);
-    LogNoLock(worker_id, "exiting");
-    if (!last_solution_.empty()) {
-      LogNoLock(last_worker_,
-                StringPrintf("solution found with value %" GG_LL_FORMAT "d",
-                             best_solution_));
-      std::cout << last_solution_;
-      last_solution_.clear();
-    }
-    should_finish_ = true;
-    if (interrupted) {
-      interrupted_ = true;
-    }
+    EndSearchNoLock(worker_id, interrupted);
   }
 
   virtual int64 BestSolution() const { return best_solution_; }
 
   virtual OptimizeVar* Objective(Solver* s, bool maximize, IntVar* var,
                                  int64 step, int w) {
-    return s->RevAlloc(new MtOptimizeVar(s, maximize, var, step, this, w));
+    return s->RevAlloc(
+        new MtOptimizeVar(s, maximize, var, step, this, &shared_bound_, w));
   }
 
   virtual SearchLimit* Limit(Solver* s, int worker_id) {
@@ -213,28 +192,339 @@ class MtSupportInterface : public FzParallelSupportInterface {
 
   virtual bool Interrupted() const { return interrupted_; }
 
+  virtual bool ShareClauses() const { return share_clauses_; }
+
+  virtual void ExportClause(int worker_id,
+                            const std::vector<sat::Literal>& clause) {
+    sat::SharedClauseRing* const ring = rings_[worker_id].get();
+    if (clause.size() <= ring->max_clause_size()) {
+      ring->Add(clause, clause.size());
+    }
+  }
+
+  virtual void ImportClauses(int worker_id,
+                             std::vector<std::vector<sat::Literal>>* clauses) {
+    for (int other = 0; other < rings_.size(); ++other) {
+      if (other == worker_id) continue;
+      rings_[other]->Read(&read_positions_[worker_id][other], &ring_clauses_);
+      for (sat::SharedClauseRing::Clause& clause : ring_clauses_) {
+        clauses->push_back(std::move(clause.literals));
+      }
+      ring_clauses_.clear();
+    }
+  }
+
   void LogNoLock(int worker_id, const std::string& message) {
     if (verbose_) {
       std::cout << "%%  worker " << worker_id << ": " << message << std::endl;
     }
   }
 
- private:
+ protected:
+  bool IsBetter(int64 value, int64 reference) const {
+    return type_ == MAXIMIZE ? value > reference : value < reference;
+  }
+
+  // Lowers (or raises) the shared bound to the given value. Returns false if
+  // it was already at least as good.
+  bool PublishBound(int64 value) {
+    int64 bound = shared_bound_.load();
+    while (IsBetter(value, bound)) {
+      if (shared_bound_.compare_exchange_weak(bound, value)) return true;
+    }
+    return false;
+  }
+
+  void SatSolutionNoLock(int worker_id, const std::string& solution_string) {
+    if (NumSolutions() < num_solutions_ || print_all_) {
+      LogNoLock(worker_id, "solution found");
+      std::cout << solution_string << std::endl;
+      should_finish_ = true;
+    }
+    IncrementSolutions();
+  }
+
+  void OptimizeSolutionNoLock(int worker_id, int64 value,
+                              const std::string& solution_string) {
+    if (type_ != MINIMIZE && type_ != MAXIMIZE) {
+      LOG(ERROR) << "Should not be here";
+      return;
+    }
+    // The bound may have been published by several workers before they get
+    // the mutex, in any order.
+    if (should_finish_ || !IsBetter(value, best_solution_)) return;
+    best_solution_ = value;
+    IncrementSolutions();
+    LogNoLock(worker_id,
+              StringPrintf("solution found with value %" GG_LL_FORMAT "d",
+                           value));
+    if (print_all_ || num_solutions_ > 1) {
+      std::cout << solution_string << std::endl;
+    } else {
+      last_solution_ = solution_string + "\n";
+      last_worker_ = worker_id;
+    }
+  }
+
+  void EndSearchNoLock(int worker_id, bool interrupted) {
+    LogNoLock(worker_id, "exiting");
+    if (!last_solution_.empty()) {
+      LogNoLock(last_worker_,
+                StringPrintf("solution found with value %" GG_LL_FORMAT "d",
+                             best_solution_.load()));
+      std::cout << last_solution_;
+      last_solution_.clear();
+    }
+    should_finish_ = true;
+    if (interrupted) {
+      interrupted_ = true;
+    }
+  }
+
   const bool print_all_;
   const int num_solutions_;
   const bool verbose_;
+  const bool share_clauses_;
   Mutex mutex_;
   Type type_;
   std::string last_solution_;
   int last_worker_;
-  int64 best_solution_;
-  bool should_finish_;
-  bool interrupted_;
+  // The bound polled by the objectives of all the workers, and the value of
+  // the best solution reported so far (which is only written under mutex_).
+  std::atomic<int64> shared_bound_;
+  std::atomic<int64> best_solution_;
+  std::atomic<bool> should_finish_;
+  std::atomic<bool> interrupted_;
+
+ private:
+  // Each worker publishes its clauses in its own ring, and
+  // read_positions_[w][other] is the position of worker w in the ring of
+  // worker 'other'.
+  std::vector<std::unique_ptr<sat::SharedClauseRing>> rings_;
+  std::vector<std::vector<int64>> read_positions_;
+  std::vector<sat::SharedClauseRing::Clause> ring_clauses_;
+};
+
+class DeterministicMtSupportInterface;
+
+// The search limit of the deterministic mode, which also ends the epoch of
+// its worker every 'epoch_length' calls.
+class EpochLimit : public SearchLimit {
+ public:
+  EpochLimit(Solver* s, DeterministicMtSupportInterface* support,
+             int worker_id, int epoch_length)
+      : SearchLimit(s),
+        support_(support),
+        worker_id_(worker_id),
+        epoch_length_(epoch_length),
+        num_checks_(0) {}
+
+  virtual ~EpochLimit() {}
+
+  virtual void Init() {}
+
+  virtual bool Check();
+
+  virtual void Copy(const SearchLimit* limit) {}
+
+  virtual SearchLimit* MakeClone() const { return nullptr; }
+
+ private:
+  DeterministicMtSupportInterface* const support_;
+  const int worker_id_;
+  const int epoch_length_;
+  int num_checks_;
 };
+
+// In this mode, the solutions and the clauses of each worker are buffered
+// during an epoch, and processed in the order of the worker ids once all the
+// workers have reached the end of the epoch. The shared bound, the clauses
+// that can be imported and ShouldFinish() only change at that time, while all
+// the workers are blocked, so what each worker sees only depends on the
+// number of checks of its search limit.
+class DeterministicMtSupportInterface : public MtSupportInterface {
+ public:
+  DeterministicMtSupportInterface(bool print_all, int num_solutions,
+                                  bool verbose, int num_workers,
+                                  bool share_clauses, int epoch_length)
+      : MtSupportInterface(print_all, num_solutions, verbose, num_workers,
+                           false),
+        share_clauses_at_epoch_end_(share_clauses),
+        epoch_length_(epoch_length),
+        workers_(num_workers),
+        num_active_workers_(num_workers),
+        num_arrived_workers_(0),
+        epoch_(0),
+        first_shared_clause_(0) {}
+
+  virtual ~DeterministicMtSupportInterface() {}
+
+  virtual void SatSolution(int worker_id, const std::string& solution_string) {
+    workers_[worker_id].solutions.push_back(
+        BufferedSolution(false, 0, solution_string));
+  }
+
+  virtual void OptimizeSolution(int worker_id, int64 value,
+                                const std::string& solution_string) {
+    workers_[worker_id].solutions.push_back(
+        BufferedSolution(true, value, solution_string));
+  }
+
+  virtual void EndSearch(int worker_id, bool interrupted) {
+    workers_[worker_id].interrupted = interrupted;
+    EndEpoch(worker_id, true);
+  }
+
+  virtual SearchLimit* Limit(Solver* s, int worker_id) {
+    return s->RevAlloc(new EpochLimit(s, this, worker_id, epoch_length_));
+  }
+
+  virtual bool ShareClauses() const { return share_clauses_at_epoch_end_; }
+
+  virtual void ExportClause(int worker_id,
+                            const std::vector<sat::Literal>& clause) {
+    if (clause.size() <= kMaxSharedClauseSize) {
+      workers_[worker_id].exported_clauses.push_back(clause);
+    }
+  }
+
+  virtual void ImportClauses(int worker_id,
+                             std::vector<std::vector<sat::Literal>>* clauses) {
+    int64* const position = &workers_[worker_id].import_position;
+    const int64 end = first_shared_clause_ + shared_clauses_.size();
+    for (; *position < end; ++*position) {
+      const SharedClause& clause =
+          shared_clauses_[*position - first_shared_clause_];
+      if (clause.first != worker_id) clauses->push_back(clause.second);
+    }
+  }
+
+  // Ends the current epoch of the given worker, and returns when all the
+  // active workers have done the same. If 'leave' is true, the worker is no
+  // longer active after this epoch.
+  void EndEpoch(int worker_id, bool leave) {
+    std::unique_lock<std::mutex> lock(epoch_mutex_);
+    workers_[worker_id].leaving = leave;
+    const int64 epoch = epoch_;
+    if (++num_arrived_workers_ == num_active_workers_) {
+      MergeEpoch();
+      num_arrived_workers_ = 0;
+      ++epoch_;
+      epoch_end_.notify_all();
+    } else {
+      while (epoch_ == epoch) epoch_end_.wait(lock);
+    }
+  }
+
+ private:
+  struct BufferedSolution {
+    BufferedSolution(bool o, int64 v, const std::string& s)
+        : optimize(o), value(v), output(s) {}
+    bool optimize;
+    int64 value;
+    std::string output;
+  };
+
+  struct WorkerState {
+    WorkerState() : interrupted(false), leaving(false), import_position(0) {}
+    std::vector<BufferedSolution> solutions;
+    std::vector<std::vector<sat::Literal>> exported_clauses;
+    bool interrupted;
+    bool leaving;
+    int64 import_position;
+  };
+
+  // The shared clauses with the id of the worker that learned them.
+  typedef std::pair<int, std::vector<sat::Literal>> SharedClause;
+
+  // Processes what the workers did during the epoch that just ended. This is
+  // called with epoch_mutex_ held, while all the other active workers wait.
+  void MergeEpoch() {
+    MutexLock lock(&mutex_);
+    for (int w = 0; w < workers_.size(); ++w) {
+      WorkerState* const state = &workers_[w];
+      for (const BufferedSolution& solution : state->solutions) {
+        if (solution.optimize) {
+          OptimizeSolutionNoLock(w, solution.value, solution.output);
+        } else {
+          SatSolutionNoLock(w, solution.output);
+        }
+      }
+      state->solutions.clear();
+      for (std::vector<sat::Literal>& clause : state->exported_clauses) {
+        shared_clauses_.push_back(SharedClause(w, std::move(clause)));
+      }
+      state->exported_clauses.clear();
+    }
+    if (type_ == MINIMIZE || type_ == MAXIMIZE) {
+      shared_bound_ = best_solution_.load();
+    }
+    // The workers that left are processed after all the solutions of the
+    // epoch, like the workers that finish at the same time in the
+    // non-deterministic mode.
+    for (int w = 0; w < workers_.size(); ++w) {
+      WorkerState* const state = &workers_[w];
+      if (state->leaving) {
+        --num_active_workers_;
+        state->leaving = false;
+        // A worker that left will not import clauses anymore.
+        state->import_position = kint64max;
+        EndSearchNoLock(w, state->interrupted);
+      }
+    }
+
+    // Forgets the clauses that all the active workers have imported.
+    int64 min_position = kint64max;
+    for (const WorkerState& state : workers_) {
+      min_position = std::min(min_position, state.import_position);
+    }
+    while (!shared_clauses_.empty() && first_shared_clause_ < min_position) {
+      shared_clauses_.pop_front();
+      ++first_shared_clause_;
+    }
+  }
+
+  const bool share_clauses_at_epoch_end_;
+  const int epoch_length_;
+  std::vector<WorkerState> workers_;
+  std::mutex epoch_mutex_;
+  std::condition_variable epoch_end_;
+  int num_active_workers_;
+  int num_arrived_workers_;
+  int64 epoch_;
+  // The clause number first_shared_clause_ + i is shared_clauses_[i].
+  std::deque<SharedClause> shared_clauses_;
+  int64 first_shared_clause_;
+};
+
+bool EpochLimit::Check() {
+  if (++num_checks_ == epoch_length_) {
+    num_checks_ = 0;
+    support_->EndEpoch(worker_id_, false);
+  }
+  const bool result = support_->ShouldFinish();
+  if (result) {
+    support_->Log(worker_id_, "terminating");
+  }
+  return result;
+}
 }  // namespace
 
 FzParallelSupportInterface* MakeMtSupport(bool print_all, int num_solutions,
-                                          bool verbose) {
-  return new MtSupportInterface(print_all, num_solutions, verbose);
+                                          bool verbose, int num_workers,
+                                          bool share_clauses) {
+  return new MtSupportInterface(print_all, num_solutions, verbose, num_workers,
+                                share_clauses);
+}
+
+FzParallelSupportInterface* MakeDeterministicMtSupport(bool print_all,
+                                                       int num_solutions,
+                                                       bool verbose,
+                                                       int num_workers,
+                                                       bool share_clauses,
+                                                       int epoch_length) {
+  return new DeterministicMtSupportInterface(print_all, num_solutions, verbose,
+                                             num_workers, share_clauses,
+                                             epoch_length);
 }
 }  // namespace operations_research
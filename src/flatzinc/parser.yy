@@ -81,7 +81,9 @@ struct VariableRefOrValueArray {
   }
 };
 
-// Class needed to pass information from the lexer to the parser.
+// Class needed to pass information from the lexer to the parser. Bison copies
+// it at each reduction, so the potentially large values (arrays and
+// arguments) are passed by pointer and moved into the model.
 // TODO(lperron): Use std::unique_ptr<std::vector< >> to ease memory management.
 struct LexerInfo {
   int64 integer_value;
@@ -90,7 +92,7 @@ struct LexerInfo {
   FzDomain domain;
   std::vector<FzDomain>* domains;
   std::vector<int64>* integers;
-  FzArgument arg;
+  FzArgument* arg;
   std::vector<FzArgument>* args;
   FzAnnotation annotation;
   std::vector<FzAnnotation>* annotations;
@@ -285,11 +287,11 @@ variable_or_constant_declaration:
   CHECK_EQ($3, 1) << "Only [1..n] array are supported here.";
   const int64 num_constants = $5;
   const std::string& identifier = $10;
-  const std::vector<int64>* const assignments = $14;
+  std::vector<int64>* const assignments = $14;
   CHECK(assignments != nullptr);
   CHECK_EQ(num_constants, assignments->size());
   // TODO(lperron): CHECK all values within domain.
-  context->integer_array_map[identifier] = *assignments;
+  context->integer_array_map[identifier] = std::move(*assignments);
   delete assignments;
   delete annotations;
 }
@@ -310,13 +312,13 @@ variable_or_constant_declaration:
   const int64 num_constants = $5;
   const FzDomain& domain = $8;
   const std::string& identifier = $10;
-  const std::vector<FzDomain>* const assignments = $14;
+  std::vector<FzDomain>* const assignments = $14;
   const std::vector<FzAnnotation>* const annotations = $11;
   CHECK(assignments != nullptr);
   CHECK_EQ(num_constants, assignments->size());
 
   if (!AreAllSingleton(*assignments)) {
-    context->domain_array_map[identifier] = *assignments;
+    context->domain_array_map[identifier] = std::move(*assignments);
     // TODO(lperron): check that all assignments are included in the domain.
   } else {
     std::vector<int64> values(num_constants);
@@ -324,7 +326,7 @@ variable_or_constant_declaration:
       values[i] = (*assignments)[i].values.front();
       CHECK(domain.Contains(values[i]));
     }
-    context->integer_array_map[identifier] = values;
+    context->integer_array_map[identifier] = std::move(values);
   }
   delete assignments;
   delete annotations;
@@ -399,9 +401,6 @@ variable_or_constant_declaration:
   }
   delete assignments;
 
-  // Register the variable array on the context.
-  context->variable_array_map[identifier] = vars;
-
   // We parse the annotations to build an output object if
   // needed. It's a bit more convoluted than the simple variable
   // output.
@@ -429,6 +428,9 @@ variable_or_constant_declaration:
     }
     delete annotations;
   }
+
+  // Register the variable array on the context.
+  context->variable_array_map[identifier] = std::move(vars);
 }
 
 optional_var_or_value:
@@ -541,9 +543,12 @@ const_literal:
 const_literals:
   const_literals ',' const_literal {
   $$ = $1;
-  $$->emplace_back($3);
+  $$->emplace_back(std::move($3));
+}
+| const_literal {
+  $$ = new std::vector<FzDomain>();
+  $$->emplace_back(std::move($1));
 }
-| const_literal { $$ = new std::vector<FzDomain>(); $$->emplace_back($1); }
 
 //---------------------------------------------------------------------------
 // Parsing constraints
@@ -556,7 +561,7 @@ constraint :
   CONSTRAINT IDENTIFIER '(' arguments ')' annotations {
   const std::string& identifier = $2;
   CHECK($4 != nullptr) << "Missing argument in constraint";
-  const std::vector<FzArgument>& arguments = *$4;
+  std::vector<FzArgument>* const arguments = $4;
   std::vector<FzAnnotation>* const annotations = $6;
 
   // Does the constraint has a defines_var annotation?
@@ -573,61 +578,73 @@ constraint :
     }
   }
 
-  model->AddConstraint(identifier, arguments,
+  model->AddConstraint(identifier, std::move(*arguments),
                        ContainsId(annotations, "domain"), defines_var);
   delete annotations;
-  delete $4;
+  delete arguments;
 }
 
 arguments:
-  arguments ',' argument { $$ = $1; $$->emplace_back($3); }
-| argument { $$ = new std::vector<FzArgument>(); $$->emplace_back($1); }
+  arguments ',' argument {
+  $$ = $1;
+  $$->emplace_back(std::move(*$3));
+  delete $3;
+}
+| argument {
+  $$ = new std::vector<FzArgument>();
+  $$->emplace_back(std::move(*$1));
+  delete $1;
+}
 
 argument:
-  IVALUE { $$ = FzArgument::IntegerValue($1); }
-| DVALUE { $$ = FzArgument::VoidArgument(); }
-| SVALUE { $$ = FzArgument::VoidArgument(); }
-| IVALUE DOTDOT IVALUE { $$ = FzArgument::Interval($1, $3); }
+  IVALUE { $$ = new FzArgument(FzArgument::IntegerValue($1)); }
+| DVALUE { $$ = new FzArgument(FzArgument::VoidArgument()); }
+| SVALUE { $$ = new FzArgument(FzArgument::VoidArgument()); }
+| IVALUE DOTDOT IVALUE { $$ = new FzArgument(FzArgument::Interval($1, $3)); }
 | '{' integers '}' {
   CHECK($2 != nullptr);
-  $$ = FzArgument::IntegerList(std::move(*$2));
+  $$ = new FzArgument(FzArgument::IntegerList(std::move(*$2)));
   delete $2;
 }
 | IDENTIFIER {
   const std::string& id = $1;
   if (ContainsKey(context->integer_map, id)) {
-    $$ = FzArgument::IntegerValue(FindOrDie(context->integer_map, id));
+    $$ = new FzArgument(
+        FzArgument::IntegerValue(FindOrDie(context->integer_map, id)));
   } else if (ContainsKey(context->integer_array_map, id)) {
-    $$ = FzArgument::IntegerList(FindOrDie(context->integer_array_map, id));
+    $$ = new FzArgument(
+        FzArgument::IntegerList(FindOrDie(context->integer_array_map, id)));
   } else if (ContainsKey(context->variable_map, id)) {
-    $$ = FzArgument::IntVarRef(FindOrDie(context->variable_map, id));
+    $$ = new FzArgument(
+        FzArgument::IntVarRef(FindOrDie(context->variable_map, id)));
   } else if (ContainsKey(context->variable_array_map, id)) {
-    $$ = FzArgument::IntVarRefArray(FindOrDie(context->variable_array_map, id));
+    $$ = new FzArgument(FzArgument::IntVarRefArray(
+        FindOrDie(context->variable_array_map, id)));
   } else if (ContainsKey(context->domain_map, id)) {
     const FzDomain& d = FindOrDie(context->domain_map, id);
-    $$ = FzArgument::FromDomain(d);
+    $$ = new FzArgument(FzArgument::FromDomain(d));
   } else {
     CHECK(ContainsKey(context->domain_array_map, id)) << "Unknown identifier: "
                                                       << id;
     const std::vector<FzDomain>& d = FindOrDie(context->domain_array_map, id);
-    $$ = FzArgument::DomainList(d);
+    $$ = new FzArgument(FzArgument::DomainList(d));
   }
 }
 | IDENTIFIER '[' IVALUE ']' {
   const std::string& id = $1;
   const int64 index = $3;
   if (ContainsKey(context->integer_array_map, id)) {
-    $$ = FzArgument::IntegerValue(
-        FzLookup(FindOrDie(context->integer_array_map, id), index));
+    $$ = new FzArgument(FzArgument::IntegerValue(
+        FzLookup(FindOrDie(context->integer_array_map, id), index)));
   } else if (ContainsKey(context->variable_array_map, id)) {
-    $$ = FzArgument::IntVarRef(
-        FzLookup(FindOrDie(context->variable_array_map, id), index));
+    $$ = new FzArgument(FzArgument::IntVarRef(
+        FzLookup(FindOrDie(context->variable_array_map, id), index)));
   } else {
     CHECK(ContainsKey(context->domain_array_map, id))
         << "Unknown identifier: " << id;
     const FzDomain& d =
         FzLookup(FindOrDie(context->domain_array_map, id), index);
-    $$ = FzArgument::FromDomain(d);
+    $$ = new FzArgument(FzArgument::FromDomain(d));
   }
 }
 | '[' var_or_value_array ']' {
@@ -641,23 +658,23 @@ argument:
     }
   }
   if (has_variables) {
-    $$ = FzArgument::IntVarRefArray(std::vector<FzIntegerVariable*>());
-    $$.variables.reserve(arguments->Size());
+    // The constants of the array become fixed variables owned by the model.
     for (int i = 0; i < arguments->Size(); ++i) {
-      if (arguments->variables[i] != nullptr) {
-         $$.variables.emplace_back(arguments->variables[i]);
-      } else {
-         $$.variables.emplace_back(
-             FzIntegerVariable::Constant(arguments->values[i]));
+      if (arguments->variables[i] == nullptr) {
+        arguments->variables[i] =
+            model->AddConstantVariable(arguments->values[i]);
       }
     }
+    $$ = new FzArgument(
+        FzArgument::IntVarRefArray(std::move(arguments->variables)));
   } else {
-    $$ = FzArgument::IntegerList(arguments->values);
+    $$ = new FzArgument(
+        FzArgument::IntegerList(std::move(arguments->values)));
   }
   delete arguments;
 }
 | '[' ']' {
-  $$ = FzArgument::VoidArgument();
+  $$ = new FzArgument(FzArgument::VoidArgument());
 }
 
 //---------------------------------------------------------------------------
@@ -667,13 +684,19 @@ argument:
 annotations:
   annotations COLONCOLON annotation {
     $$ = $1 != nullptr ? $1 : new std::vector<FzAnnotation>();
-    $$->emplace_back($3);
+    $$->emplace_back(std::move($3));
   }
 | /* empty */ { $$ = nullptr; }
 
 annotation_arguments:  // Cannot be empty.
-  annotation_arguments ',' annotation  { $$ = $1; $$->emplace_back($3); }
-| annotation { $$ = new std::vector<FzAnnotation>(); $$->emplace_back($1); }
+  annotation_arguments ',' annotation {
+  $$ = $1;
+  $$->emplace_back(std::move($3));
+}
+| annotation {
+  $$ = new std::vector<FzAnnotation>();
+  $$->emplace_back(std::move($1));
+}
 
 annotation:
   IVALUE DOTDOT IVALUE { $$ = FzAnnotation::Interval($1, $3); }
@@ -728,22 +751,24 @@ solve:
   }
 }
 | SOLVE annotations MINIMIZE argument {
-  CHECK_EQ(FzArgument::INT_VAR_REF, $4.type);
+  CHECK_EQ(FzArgument::INT_VAR_REF, $4->type);
   if ($2 != nullptr) {
-    model->Minimize($4.Var(), std::move(*$2));
+    model->Minimize($4->Var(), std::move(*$2));
     delete $2;
   } else {
-    model->Minimize($4.Var(), std::vector<FzAnnotation>());
+    model->Minimize($4->Var(), std::vector<FzAnnotation>());
   }
+  delete $4;
 }
 | SOLVE annotations MAXIMIZE argument {
-  CHECK_EQ(FzArgument::INT_VAR_REF, $4.type);
+  CHECK_EQ(FzArgument::INT_VAR_REF, $4->type);
   if ($2 != nullptr) {
-    model->Maximize($4.Var(), std::move(*$2));
+    model->Maximize($4->Var(), std::move(*$2));
     delete $2;
   } else {
-    model->Maximize($4.Var(), std::vector<FzAnnotation>());
+    model->Maximize($4->Var(), std::vector<FzAnnotation>());
   }
+  delete $4;
 }
 
 %%
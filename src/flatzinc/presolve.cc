@@ -12,9 +12,14 @@
 // limitations under the License.
 
 #include "flatzinc/presolve.h"
+
+#include <algorithm>
+#include <deque>
+
 #include "util/saturated_arithmetic.h"
 #include "base/strutil.h"
 #include "base/map_util.h"
+#include "base/timer.h"
 
 DECLARE_bool(fz_logging);
 DECLARE_bool(fz_verbose);
@@ -1038,7 +1043,8 @@ bool FzPresolver::RegroupLinear(FzConstraint* ct) {
 // Rule 2:
 // Input : int_lin_xx([c1], [x1], c0) with c1 >= 0, and xx = eq, ge.
 // Action: intersect the domain of x1 with [c0/c1, kint64max]
-bool FzPresolver::PropagatePositiveLinear(FzConstraint* ct, bool upper) {
+bool FzPresolver::PropagatePositiveLinear(FzConstraint* ct) {
+  const bool upper = ct->type != "int_lin_ge";
   const int64 rhs = ct->Arg(2).Value();
   if (ct->presolve_propagation_done || rhs < 0) {
     return false;
@@ -1869,6 +1875,30 @@ bool FzPresolver::PresolveIntMod(FzConstraint* ct) {
   return false;
 }
 
+bool FzPresolver::ApplyRule(FzConstraint* ct, const char* rule_name,
+                            bool (FzPresolver::*rule)(FzConstraint* ct)) {
+  if (!FLAGS_fz_logging) return (this->*rule)(ct);
+  WallTimer timer;
+  timer.Start();
+  const bool changed = (this->*rule)(ct);
+  RuleStatistics& statistics = rule_statistics_[rule_name];
+  statistics.time_in_seconds += timer.Get();
+  ++statistics.num_calls;
+  if (changed) ++statistics.num_changes;
+  return changed;
+}
+
+void FzPresolver::PrintRuleStatistics() const {
+  for (const auto& p : rule_statistics_) {
+    FZLOG << "  - " << p.first << ": " << p.second.num_calls << " calls, "
+          << p.second.num_changes << " changes, "
+          << static_cast<int64>(p.second.time_in_seconds * 1000) << " ms"
+          << FZENDL;
+  }
+}
+
+#define FZ_APPLY_RULE(rule) ApplyRule(ct, #rule, &FzPresolver::rule)
+
 // Main presolve rule caller.
 bool FzPresolver::PresolveOneConstraint(FzConstraint* ct) {
   bool changed = false;
@@ -1879,11 +1909,11 @@ bool FzPresolver::PresolveOneConstraint(FzConstraint* ct) {
     Unreify(ct);
     changed = true;
   }
-  if (id == "bool2int") changed |= PresolveBool2Int(ct);
+  if (id == "bool2int") changed |= FZ_APPLY_RULE(PresolveBool2Int);
   if (id == "int_le" || id == "int_lt" || id == "int_ge" || id == "int_gt" ||
       id == "bool_le" || id == "bool_lt" || id == "bool_ge" ||
       id == "bool_gt") {
-    changed |= PresolveInequalities(ct);
+    changed |= FZ_APPLY_RULE(PresolveInequalities);
   }
   if (id == "int_abs" && !ContainsKey(abs_map_, ct->Arg(1).Var())) {
     // Stores abs() map.
@@ -1892,10 +1922,10 @@ bool FzPresolver::PresolveOneConstraint(FzConstraint* ct) {
     changed = true;
   }
   if (id == "int_eq_reif") {
-    changed |= StoreIntEqReif(ct);
+    changed |= FZ_APPLY_RULE(StoreIntEqReif);
   }
   if (id == "int_ne_reif") {
-    changed |= SimplifyIntNeReif(ct);
+    changed |= FZ_APPLY_RULE(SimplifyIntNeReif);
   }
   if ((id == "int_eq_reif" || id == "int_ne_reif" || id == "int_ne") &&
       ct->Arg(1).HasOneValue() && ct->Arg(1).Value() == 0 &&
@@ -1909,66 +1939,69 @@ bool FzPresolver::PresolveOneConstraint(FzConstraint* ct) {
   }
   if ((id == "int_le_reif") && ct->Arg(1).HasOneValue() &&
       ContainsKey(abs_map_, ct->Arg(0).Var())) {
-    changed |= RemoveAbsFromIntLinReif(ct);
+    changed |= FZ_APPLY_RULE(RemoveAbsFromIntLinReif);
+  }
+  if (id == "int_eq" || id == "bool_eq") {
+    changed |= FZ_APPLY_RULE(PresolveIntEq);
   }
-  if (id == "int_eq" || id == "bool_eq") changed |= PresolveIntEq(ct);
-  if (id == "int_ne" || id == "bool_not") changed |= PresolveIntNe(ct);
-  if (id == "set_in") changed |= PresolveSetIn(ct);
-  if (id == "array_bool_and") changed |= PresolveArrayBoolAnd(ct);
-  if (id == "array_bool_or") changed |= PresolveArrayBoolOr(ct);
+  if (id == "int_ne" || id == "bool_not") {
+    changed |= FZ_APPLY_RULE(PresolveIntNe);
+  }
+  if (id == "set_in") changed |= FZ_APPLY_RULE(PresolveSetIn);
+  if (id == "array_bool_and") changed |= FZ_APPLY_RULE(PresolveArrayBoolAnd);
+  if (id == "array_bool_or") changed |= FZ_APPLY_RULE(PresolveArrayBoolOr);
   if (id == "bool_eq_reif" || id == "bool_ne_reif") {
-    changed |= PresolveBoolEqNeReif(ct);
+    changed |= FZ_APPLY_RULE(PresolveBoolEqNeReif);
   }
   if (id == "bool_xor") {
-    changed |= PresolveBoolXor(ct);
+    changed |= FZ_APPLY_RULE(PresolveBoolXor);
   }
   if (id == "bool_not") {
-    changed |= PresolveBoolNot(ct);
+    changed |= FZ_APPLY_RULE(PresolveBoolNot);
   }
   if (id == "bool_clause") {
-    changed |= PresolveBoolClause(ct);
+    changed |= FZ_APPLY_RULE(PresolveBoolClause);
   }
-  if (id == "int_div") changed |= PresolveIntDiv(ct);
-  if (id == "int_times") changed |= PresolveIntTimes(ct);
-  if (id == "int_lin_gt") changed |= PresolveIntLinGt(ct);
-  if (id == "int_lin_lt") changed |= PresolveIntLinLt(ct);
+  if (id == "int_div") changed |= FZ_APPLY_RULE(PresolveIntDiv);
+  if (id == "int_times") changed |= FZ_APPLY_RULE(PresolveIntTimes);
+  if (id == "int_lin_gt") changed |= FZ_APPLY_RULE(PresolveIntLinGt);
+  if (id == "int_lin_lt") changed |= FZ_APPLY_RULE(PresolveIntLinLt);
   if (HasPrefixString(id, "int_lin_")) {
-    changed |= PresolveLinear(ct);
+    changed |= FZ_APPLY_RULE(PresolveLinear);
   }
   // type can have changed after the presolve.
   if (HasPrefixString(id, "int_lin_")) {
-    changed |= RegroupLinear(ct);
-    changed |= SimplifyUnaryLinear(ct);
-    changed |= SimplifyBinaryLinear(ct);
+    changed |= FZ_APPLY_RULE(RegroupLinear);
+    changed |= FZ_APPLY_RULE(SimplifyUnaryLinear);
+    changed |= FZ_APPLY_RULE(SimplifyBinaryLinear);
   }
   if (id == "int_lin_eq" || id == "int_lin_le" || id == "int_lin_ge") {
-    const bool upper = !(id == "int_lin_ge");
-    changed |= PropagatePositiveLinear(ct, upper);
+    changed |= FZ_APPLY_RULE(PropagatePositiveLinear);
   }
   if (id == "int_lin_eq") {
-    changed |= CreateLinearTarget(ct);
+    changed |= FZ_APPLY_RULE(CreateLinearTarget);
   }
-  if (id == "int_lin_eq") changed |= PresolveStoreMapping(ct);
-  if (id == "int_lin_eq_reif") changed |= CheckIntLinReifBounds(ct);
-  if (id == "int_lin_eq_reif") changed |= SimplifyIntLinEqReif(ct);
+  if (id == "int_lin_eq") changed |= FZ_APPLY_RULE(PresolveStoreMapping);
+  if (id == "int_lin_eq_reif") changed |= FZ_APPLY_RULE(CheckIntLinReifBounds);
+  if (id == "int_lin_eq_reif") changed |= FZ_APPLY_RULE(SimplifyIntLinEqReif);
   if (id == "array_int_element") {
-    changed |= PresolveSimplifyElement(ct);
+    changed |= FZ_APPLY_RULE(PresolveSimplifyElement);
   }
   // Type could have changed in the previous rule. We need to test again.
   if (id == "array_int_element") {
-    changed |= PresolveArrayIntElement(ct);
+    changed |= FZ_APPLY_RULE(PresolveArrayIntElement);
   }
   if (id == "array_var_int_element") {
-    changed |= PresolveSimplifyExprElement(ct);
+    changed |= FZ_APPLY_RULE(PresolveSimplifyExprElement);
   }
   if (id == "int_eq_reif" || id == "int_ne_reif" || id == "int_le_reif" ||
       id == "int_lt_reif" || id == "int_ge_reif" || id == "int_gt_reif" ||
       id == "bool_eq_reif" || id == "bool_ne_reif" || id == "bool_le_reif" ||
       id == "bool_lt_reif" || id == "bool_ge_reif" || id == "bool_gt_reif") {
-    changed |= PropagateReifiedComparisons(ct);
+    changed |= FZ_APPLY_RULE(PropagateReifiedComparisons);
   }
   if (id == "int_mod") {
-    changed |= PresolveIntMod(ct);
+    changed |= FZ_APPLY_RULE(PresolveIntMod);
   }
   // Last rule: if the target variable of a constraint is fixed, removed it
   // the target part.
@@ -1982,6 +2015,8 @@ bool FzPresolver::PresolveOneConstraint(FzConstraint* ct) {
   return changed;
 }
 
+#undef FZ_APPLY_RULE
+
 // Stores all pairs of variables appearing in an int_ne(x, y) constraint.
 void FzPresolver::StoreDifference(FzConstraint* ct) {
   if (ct->Arg(2).Value() == 0 && ct->Arg(0).values.size() == 3) {
@@ -2105,28 +2140,85 @@ bool FzPresolver::Run(FzModel* model) {
     var_representative_map_.clear();
   }
 
-  // Apply the rest of the presolve rules.
-  for (;;) {
-    bool changed = false;
-    var_representative_map_.clear();
-    for (FzConstraint* const ct : model->constraints()) {
-      if (ct->active) {
-        changed |= PresolveOneConstraint(ct);
-      }
-      if (!var_representative_map_.empty()) {
-        break;
+  // Apply the rest of the presolve rules. All the constraints are presolved
+  // once, and then only the ones sharing a variable with a modified
+  // constraint, in the order of the model.
+  const std::vector<FzConstraint*>& constraints = model->constraints();
+  hash_map<const FzConstraint*, int> constraint_index;
+  for (int i = 0; i < constraints.size(); ++i) {
+    constraint_index[constraints[i]] = i;
+  }
+  std::deque<int> worklist;
+  std::vector<bool> in_worklist(constraints.size(), false);
+  for (int i = 0; i < constraints.size(); ++i) {
+    if (constraints[i]->active) {
+      worklist.push_back(i);
+      in_worklist[i] = true;
+    }
+  }
+  std::vector<FzIntegerVariable*> touched_variables;
+  std::vector<int> to_enqueue;
+  int64 num_presolved_constraints = 0;
+  int64 num_substitution_rounds = 0;
+  var_representative_map_.clear();
+  while (!worklist.empty()) {
+    const int index = worklist.front();
+    worklist.pop_front();
+    in_worklist[index] = false;
+    FzConstraint* const ct = constraints[index];
+    if (!ct->active) continue;
+    ++num_presolved_constraints;
+    touched_variables.clear();
+    for (const FzArgument& arg : ct->arguments) {
+      touched_variables.insert(touched_variables.end(), arg.variables.begin(),
+                               arg.variables.end());
+    }
+    const bool changed = PresolveOneConstraint(ct);
+    if (!changed && var_representative_map_.empty()) continue;
+    changed_since_start = true;
+    // The rules may have replaced some variables of the constraint.
+    for (const FzArgument& arg : ct->arguments) {
+      for (FzIntegerVariable* const var : arg.variables) {
+        var_to_constraints_[var].insert(ct);
+        touched_variables.push_back(var);
       }
     }
     if (!var_representative_map_.empty()) {
       // Some new substitutions were introduced. Let's process them.
-      DCHECK(changed);
-      changed = true;  // To be safe in opt mode.
       SubstituteEverywhere(model);
+      for (const auto& p : var_representative_map_) {
+        touched_variables.push_back(FindRepresentativeOfVar(p.second));
+      }
       var_representative_map_.clear();
+      ++num_substitution_rounds;
+    }
+
+    // Presolves again the constraint and its neighbors, in model order so
+    // that the result does not depend on the iteration order of the sets.
+    to_enqueue.clear();
+    if (ct->active && !in_worklist[index]) {
+      in_worklist[index] = true;
+      to_enqueue.push_back(index);
+    }
+    for (FzIntegerVariable* const var : touched_variables) {
+      const hash_set<FzConstraint*>* const neighbors =
+          FindOrNull(var_to_constraints_, var);
+      if (neighbors == nullptr) continue;
+      for (FzConstraint* const neighbor : *neighbors) {
+        if (!neighbor->active) continue;
+        const int neighbor_index = FindOrDie(constraint_index, neighbor);
+        if (!in_worklist[neighbor_index]) {
+          in_worklist[neighbor_index] = true;
+          to_enqueue.push_back(neighbor_index);
+        }
+      }
     }
-    changed_since_start |= changed;
-    if (!changed) break;
+    std::sort(to_enqueue.begin(), to_enqueue.end());
+    worklist.insert(worklist.end(), to_enqueue.begin(), to_enqueue.end());
   }
+  FZLOG << "  - " << num_presolved_constraints << " constraints presolved, "
+        << num_substitution_rounds << " substitution rounds" << FZENDL;
+  PrintRuleStatistics();
   return changed_since_start;
 }
 
@@ -14,7 +14,9 @@
 #ifndef OR_TOOLS_FLATZINC_PRESOLVE_H_
 #define OR_TOOLS_FLATZINC_PRESOLVE_H_
 
+#include <map>
 #include <string>
+#include "base/flat_hash.h"
 #include "base/hash.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
@@ -35,6 +37,11 @@ class FzPresolver {
   // TODO(user): compute on the fly, and add an API to access the set of
   // unused variables.
   //
+  // The constraints are presolved from a worklist: once a constraint is
+  // modified, only the constraints sharing a variable with it are presolved
+  // again. With --fz_logging, the number of calls, of changes and the time
+  // of each rule are printed at the end.
+  //
   // This method returns true iff some transformations were applied to the
   // model.
   // TODO(user): Returns the number of rules applied instead.
@@ -104,6 +111,12 @@ class FzPresolver {
   // Returns true iff the model was modified.
   bool PresolveOneConstraint(FzConstraint* ct);
 
+  // Returns (this->*rule)(ct), and updates the statistics of the rule when
+  // --fz_logging is set.
+  bool ApplyRule(FzConstraint* ct, const char* rule_name,
+                 bool (FzPresolver::*rule)(FzConstraint* ct));
+  void PrintRuleStatistics() const;
+
   // Substitution support.
   void SubstituteEverywhere(FzModel* model);
   void SubstituteAnnotation(FzAnnotation* ann);
@@ -126,7 +139,7 @@ class FzPresolver {
   bool PresolveIntLinLt(FzConstraint* ct);
   bool PresolveLinear(FzConstraint* ct);
   bool RegroupLinear(FzConstraint* ct);
-  bool PropagatePositiveLinear(FzConstraint* ct, bool upper);
+  bool PropagatePositiveLinear(FzConstraint* ct);
   bool PresolveStoreMapping(FzConstraint* ct);
   bool PresolveSimplifyElement(FzConstraint* ct);
   bool PresolveSimplifyExprElement(FzConstraint* ct);
@@ -155,21 +168,23 @@ class FzPresolver {
   // of 'from' with 'to', rather than the opposite.
   void AddVariableSubstition(FzIntegerVariable* from, FzIntegerVariable* to);
   FzIntegerVariable* FindRepresentativeOfVar(FzIntegerVariable* var);
-  hash_map<const FzIntegerVariable*, FzIntegerVariable*>
+  FlatHashMap<const FzIntegerVariable*, FzIntegerVariable*>
       var_representative_map_;
 
   // Stores abs_map_[x] = y if x = abs(y).
-  hash_map<const FzIntegerVariable*, FzIntegerVariable*> abs_map_;
+  FlatHashMap<const FzIntegerVariable*, FzIntegerVariable*> abs_map_;
 
   // Stores affine_map_[x] = a * y + b.
-  hash_map<const FzIntegerVariable*, AffineMapping> affine_map_;
+  FlatHashMap<const FzIntegerVariable*, AffineMapping> affine_map_;
 
   // Stores array2d_index_map_[z] = a * x + y + b.
-  hash_map<const FzIntegerVariable*, Array2DIndexMapping> array2d_index_map_;
+  FlatHashMap<const FzIntegerVariable*, Array2DIndexMapping>
+      array2d_index_map_;
 
   // Stores x == (y - z).
-  hash_map<const FzIntegerVariable*,
-           std::pair<FzIntegerVariable*, FzIntegerVariable*>> difference_map_;
+  FlatHashMap<const FzIntegerVariable*,
+              std::pair<FzIntegerVariable*, FzIntegerVariable*>>
+      difference_map_;
 
   // Stores (x == y) == b
   hash_map<FzIntegerVariable*, hash_map<FzIntegerVariable*, FzIntegerVariable*>>
@@ -178,9 +193,20 @@ class FzPresolver {
   // Stores all variables defined in the search annotations.
   hash_set<FzIntegerVariable*> decision_variables_;
 
-  // For all variables, stores all constraints it appears in.
+  // For all variables, stores all constraints it appears in. This one stays a
+  // node-based hash_map: references to its sets are kept across insertions.
   hash_map<const FzIntegerVariable*, hash_set<FzConstraint*>>
       var_to_constraints_;
+
+  // The statistics of each presolve rule, only collected with --fz_logging.
+  struct RuleStatistics {
+    int64 num_calls;
+    int64 num_changes;
+    double time_in_seconds;
+
+    RuleStatistics() : num_calls(0), num_changes(0), time_in_seconds(0.0) {}
+  };
+  std::map<std::string, RuleStatistics> rule_statistics_;
 };
 }  // namespace operations_research
 
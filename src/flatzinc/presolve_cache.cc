@@ -0,0 +1,529 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "flatzinc/presolve_cache.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "base/file.h"
+#include "base/hash.h"
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "base/map_util.h"
+#include "base/random.h"
+#include "base/stringprintf.h"
+#include "base/thorough_hash.h"
+
+namespace operations_research {
+namespace {
+// Changes each time the format changes, so that the old cache files are not
+// read anymore.
+const char kFormatHeader[] = "fzcache 1";
+const char kFormatFooter[] = "end";
+
+// The serialized model is a sequence of tokens separated by spaces or
+// newlines. The strings are written as <length>:<characters> so that they can
+// contain anything.
+class FzWriter {
+ public:
+  explicit FzWriter(std::string* output) : output_(output) {}
+
+  void Int(int64 value) {
+    StringAppendF(output_, "%" GG_LL_FORMAT "d ", value);
+  }
+  void String(const std::string& value) {
+    StringAppendF(output_, "%d:", static_cast<int>(value.size()));
+    output_->append(value);
+    output_->append(" ");
+  }
+  void EndLine() { output_->append("\n"); }
+
+ private:
+  std::string* const output_;
+};
+
+// Reads back the tokens of FzWriter. All the methods return false at the end
+// of the input, or if the next token does not have the expected type.
+class FzReader {
+ public:
+  explicit FzReader(const std::string& input) : input_(input), pos_(0) {}
+
+  bool Int(int64* value) {
+    SkipSpaces();
+    if (pos_ == input_.size()) return false;
+    const char* const start = input_.c_str() + pos_;
+    char* end = nullptr;
+    *value = strtoll(start, &end, 10);
+    if (end == start) return false;
+    pos_ += end - start;
+    return true;
+  }
+  bool Int(int* value) {
+    int64 value64 = 0;
+    if (!Int(&value64) || value64 < kint32min || value64 > kint32max) {
+      return false;
+    }
+    *value = static_cast<int>(value64);
+    return true;
+  }
+  bool Bool(bool* value) {
+    int64 value64 = 0;
+    if (!Int(&value64) || (value64 != 0 && value64 != 1)) return false;
+    *value = value64 == 1;
+    return true;
+  }
+  bool String(std::string* value) {
+    int length = 0;
+    if (!Int(&length) || length < 0 || pos_ == input_.size() ||
+        input_[pos_] != ':' || input_.size() - pos_ - 1 < length) {
+      return false;
+    }
+    value->assign(input_, pos_ + 1, length);
+    pos_ += length + 1;
+    return true;
+  }
+  // Reads a size, which must be positive. Each element takes at least one
+  // character, which bounds the size.
+  bool Size(int* size) {
+    return Int(size) && *size >= 0 && *size <= input_.size() - pos_;
+  }
+
+ private:
+  void SkipSpaces() {
+    while (pos_ < input_.size() &&
+           (input_[pos_] == ' ' || input_[pos_] == '\n')) {
+      ++pos_;
+    }
+  }
+
+  const std::string& input_;
+  size_t pos_;
+};
+
+// ----- Serialization -----
+
+class FzModelSerializer {
+ public:
+  FzModelSerializer(const FzModel& model, std::string* output)
+      : model_(model), writer_(output) {}
+
+  void Run() {
+    // The variables that are referenced by the model but are not in
+    // variables(), like the constants of the arrays of variables, are written
+    // after the others.
+    for (FzIntegerVariable* const var : model_.variables()) {
+      Register(var);
+    }
+    const int num_variables = all_variables_.size();
+    for (int c = 0; c < model_.constraints().size(); ++c) {
+      FzConstraint* const ct = model_.constraints()[c];
+      constraint_indices_[ct] = c;
+      for (const FzArgument& arg : ct->arguments) {
+        for (FzIntegerVariable* const var : arg.variables) Register(var);
+      }
+      Register(ct->target_variable);
+    }
+    Register(model_.objective());
+    for (const FzAnnotation& ann : model_.search_annotations()) {
+      RegisterAnnotation(ann);
+    }
+    for (const FzOnSolutionOutput& output : model_.output()) {
+      Register(output.variable);
+      for (FzIntegerVariable* const var : output.flat_variables) Register(var);
+    }
+
+    writer_.String(kFormatHeader);
+    writer_.EndLine();
+    writer_.Int(num_variables);
+    writer_.Int(all_variables_.size() - num_variables);
+    writer_.Int(model_.constraints().size());
+    writer_.EndLine();
+    for (FzIntegerVariable* const var : all_variables_) {
+      WriteVariable(*var);
+    }
+    for (FzConstraint* const ct : model_.constraints()) {
+      WriteConstraint(*ct);
+    }
+    writer_.Int(VariableIndex(model_.objective()));
+    writer_.Int(model_.maximize());
+    writer_.EndLine();
+    writer_.Int(model_.search_annotations().size());
+    writer_.EndLine();
+    for (const FzAnnotation& ann : model_.search_annotations()) {
+      WriteAnnotation(ann);
+      writer_.EndLine();
+    }
+    writer_.Int(model_.output().size());
+    writer_.EndLine();
+    for (const FzOnSolutionOutput& output : model_.output()) {
+      WriteOutput(output);
+    }
+    writer_.String(kFormatFooter);
+    writer_.EndLine();
+  }
+
+ private:
+  void Register(FzIntegerVariable* var) {
+    if (var != nullptr && !ContainsKey(variable_indices_, var)) {
+      variable_indices_[var] = all_variables_.size();
+      all_variables_.push_back(var);
+    }
+  }
+
+  void RegisterAnnotation(const FzAnnotation& ann) {
+    for (FzIntegerVariable* const var : ann.variables) Register(var);
+    for (const FzAnnotation& inner : ann.annotations) RegisterAnnotation(inner);
+  }
+
+  int VariableIndex(FzIntegerVariable* var) const {
+    return var == nullptr ? -1 : FindOrDie(variable_indices_, var);
+  }
+
+  void WriteVariables(const std::vector<FzIntegerVariable*>& vars) {
+    writer_.Int(vars.size());
+    for (FzIntegerVariable* const var : vars) writer_.Int(VariableIndex(var));
+  }
+
+  void WriteValues(const std::vector<int64>& values) {
+    writer_.Int(values.size());
+    for (const int64 value : values) writer_.Int(value);
+  }
+
+  void WriteDomain(const FzDomain& domain) {
+    writer_.Int(domain.is_interval);
+    writer_.Int(domain.display_as_boolean);
+    WriteValues(domain.values);
+  }
+
+  void WriteVariable(const FzIntegerVariable& var) {
+    writer_.String(var.name);
+    WriteDomain(var.domain);
+    writer_.Int(var.temporary);
+    writer_.Int(var.active);
+    writer_.Int(var.defining_constraint == nullptr
+                    ? -1
+                    : FindOrDie(constraint_indices_, var.defining_constraint));
+    writer_.EndLine();
+  }
+
+  void WriteConstraint(const FzConstraint& ct) {
+    writer_.String(ct.type);
+    writer_.Int(VariableIndex(ct.target_variable));
+    writer_.Int(ct.strong_propagation);
+    writer_.Int(ct.active);
+    writer_.Int(ct.presolve_propagation_done);
+    writer_.Int(ct.arguments.size());
+    for (const FzArgument& arg : ct.arguments) {
+      writer_.Int(arg.type);
+      WriteValues(arg.values);
+      WriteVariables(arg.variables);
+      writer_.Int(arg.domains.size());
+      for (const FzDomain& domain : arg.domains) WriteDomain(domain);
+    }
+    writer_.EndLine();
+  }
+
+  void WriteAnnotation(const FzAnnotation& ann) {
+    writer_.Int(ann.type);
+    writer_.Int(ann.interval_min);
+    writer_.Int(ann.interval_max);
+    writer_.String(ann.id);
+    writer_.String(ann.string_value_);
+    WriteVariables(ann.variables);
+    writer_.Int(ann.annotations.size());
+    for (const FzAnnotation& inner : ann.annotations) WriteAnnotation(inner);
+  }
+
+  void WriteOutput(const FzOnSolutionOutput& output) {
+    writer_.String(output.name);
+    writer_.Int(VariableIndex(output.variable));
+    WriteVariables(output.flat_variables);
+    writer_.Int(output.bounds.size());
+    for (const FzOnSolutionOutput::Bounds& bounds : output.bounds) {
+      writer_.Int(bounds.min_value);
+      writer_.Int(bounds.max_value);
+    }
+    writer_.Int(output.display_as_boolean);
+    writer_.EndLine();
+  }
+
+  const FzModel& model_;
+  FzWriter writer_;
+  std::vector<FzIntegerVariable*> all_variables_;
+  hash_map<FzIntegerVariable*, int> variable_indices_;
+  hash_map<FzConstraint*, int> constraint_indices_;
+};
+
+// ----- Deserialization -----
+
+class FzModelDeserializer {
+ public:
+  FzModelDeserializer(const std::string& input, FzModel* model)
+      : reader_(input), model_(model) {}
+
+  bool Run() {
+    int num_variables = 0;
+    int num_extra_variables = 0;
+    int num_constraints = 0;
+    std::string header;
+    if (!reader_.String(&header) || header != kFormatHeader ||
+        !reader_.Size(&num_variables) || !reader_.Size(&num_extra_variables) ||
+        !reader_.Size(&num_constraints)) {
+      return false;
+    }
+    // The defining constraints of the variables are set once the constraints
+    // are read.
+    std::vector<int> defining_constraints;
+    for (int i = 0; i < num_variables + num_extra_variables; ++i) {
+      int defining_constraint = -1;
+      if (!ReadVariable(i >= num_variables, &defining_constraint) ||
+          defining_constraint < -1 || defining_constraint >= num_constraints) {
+        return false;
+      }
+      defining_constraints.push_back(defining_constraint);
+    }
+    for (int c = 0; c < num_constraints; ++c) {
+      if (!ReadConstraint()) return false;
+    }
+    for (int i = 0; i < variables_.size(); ++i) {
+      variables_[i]->defining_constraint =
+          defining_constraints[i] == -1
+              ? nullptr
+              : model_->constraints()[defining_constraints[i]];
+    }
+
+    FzIntegerVariable* objective = nullptr;
+    bool maximize = false;
+    int num_annotations = 0;
+    if (!ReadVariableRef(&objective) || !reader_.Bool(&maximize) ||
+        !reader_.Size(&num_annotations)) {
+      return false;
+    }
+    std::vector<FzAnnotation> search_annotations(num_annotations);
+    for (FzAnnotation& ann : search_annotations) {
+      if (!ReadAnnotation(&ann)) return false;
+    }
+    if (objective == nullptr) {
+      model_->Satisfy(std::move(search_annotations));
+    } else if (maximize) {
+      model_->Maximize(objective, std::move(search_annotations));
+    } else {
+      model_->Minimize(objective, std::move(search_annotations));
+    }
+
+    int num_outputs = 0;
+    if (!reader_.Size(&num_outputs)) return false;
+    for (int i = 0; i < num_outputs; ++i) {
+      if (!ReadOutput()) return false;
+    }
+    std::string footer;
+    return reader_.String(&footer) && footer == kFormatFooter;
+  }
+
+ private:
+  bool ReadVariableRef(FzIntegerVariable** var) {
+    int index = 0;
+    if (!reader_.Int(&index) || index < -1 ||
+        index >= static_cast<int>(variables_.size())) {
+      return false;
+    }
+    *var = index == -1 ? nullptr : variables_[index];
+    return true;
+  }
+
+  bool ReadVariables(std::vector<FzIntegerVariable*>* vars) {
+    int size = 0;
+    if (!reader_.Size(&size)) return false;
+    vars->resize(size);
+    for (FzIntegerVariable*& var : *vars) {
+      if (!ReadVariableRef(&var) || var == nullptr) return false;
+    }
+    return true;
+  }
+
+  bool ReadValues(std::vector<int64>* values) {
+    int size = 0;
+    if (!reader_.Size(&size)) return false;
+    values->resize(size);
+    for (int64& value : *values) {
+      if (!reader_.Int(&value)) return false;
+    }
+    return true;
+  }
+
+  bool ReadDomain(FzDomain* domain) {
+    bool is_interval = false;
+    bool display_as_boolean = false;
+    if (!reader_.Bool(&is_interval) || !reader_.Bool(&display_as_boolean) ||
+        !ReadValues(&domain->values)) {
+      return false;
+    }
+    domain->is_interval = is_interval;
+    domain->display_as_boolean = display_as_boolean;
+    return true;
+  }
+
+  // The extra variables are not in model->variables(): they are the
+  // constants of the arrays of variables.
+  bool ReadVariable(bool extra, int* defining_constraint) {
+    std::string name;
+    FzDomain domain = FzDomain::EmptyDomain();
+    bool temporary = false;
+    bool active = false;
+    if (!reader_.String(&name) || !ReadDomain(&domain) ||
+        !reader_.Bool(&temporary) || !reader_.Bool(&active) ||
+        !reader_.Int(defining_constraint)) {
+      return false;
+    }
+    FzIntegerVariable* var = nullptr;
+    if (extra) {
+      if (!domain.IsSingleton()) return false;
+      var = model_->AddConstantVariable(domain.values.front());
+      var->name = name;
+      var->domain = domain;
+    } else {
+      var = model_->AddVariable(name, domain, temporary);
+    }
+    var->temporary = temporary;
+    var->active = active;
+    variables_.push_back(var);
+    return true;
+  }
+
+  bool ReadConstraint() {
+    std::string type;
+    FzIntegerVariable* target = nullptr;
+    bool strong_propagation = false;
+    bool active = false;
+    bool presolve_propagation_done = false;
+    int num_arguments = 0;
+    if (!reader_.String(&type) || !ReadVariableRef(&target) ||
+        !reader_.Bool(&strong_propagation) || !reader_.Bool(&active) ||
+        !reader_.Bool(&presolve_propagation_done) ||
+        !reader_.Size(&num_arguments)) {
+      return false;
+    }
+    std::vector<FzArgument> arguments(num_arguments);
+    for (FzArgument& arg : arguments) {
+      int arg_type = 0;
+      int num_domains = 0;
+      if (!reader_.Int(&arg_type) || arg_type < FzArgument::INT_VALUE ||
+          arg_type > FzArgument::VOID_ARGUMENT || !ReadValues(&arg.values) ||
+          !ReadVariables(&arg.variables) || !reader_.Size(&num_domains)) {
+        return false;
+      }
+      arg.type = static_cast<FzArgument::Type>(arg_type);
+      arg.domains.resize(num_domains, FzDomain::EmptyDomain());
+      for (FzDomain& domain : arg.domains) {
+        if (!ReadDomain(&domain)) return false;
+      }
+    }
+    model_->AddConstraint(type, std::move(arguments), strong_propagation,
+                          target);
+    FzConstraint* const ct = model_->constraints().back();
+    ct->active = active;
+    ct->presolve_propagation_done = presolve_propagation_done;
+    return true;
+  }
+
+  bool ReadAnnotation(FzAnnotation* ann) {
+    int type = 0;
+    int num_annotations = 0;
+    if (!reader_.Int(&type) || type < FzAnnotation::ANNOTATION_LIST ||
+        type > FzAnnotation::STRING_VALUE ||
+        !reader_.Int(&ann->interval_min) || !reader_.Int(&ann->interval_max) ||
+        !reader_.String(&ann->id) || !reader_.String(&ann->string_value_) ||
+        !ReadVariables(&ann->variables) || !reader_.Size(&num_annotations)) {
+      return false;
+    }
+    ann->type = static_cast<FzAnnotation::Type>(type);
+    ann->annotations.resize(num_annotations);
+    for (FzAnnotation& inner : ann->annotations) {
+      if (!ReadAnnotation(&inner)) return false;
+    }
+    return true;
+  }
+
+  bool ReadOutput() {
+    FzOnSolutionOutput output = FzOnSolutionOutput::VoidOutput();
+    int num_bounds = 0;
+    if (!reader_.String(&output.name) || !ReadVariableRef(&output.variable) ||
+        !ReadVariables(&output.flat_variables) || !reader_.Size(&num_bounds)) {
+      return false;
+    }
+    for (int i = 0; i < num_bounds; ++i) {
+      int64 min_value = 0;
+      int64 max_value = 0;
+      if (!reader_.Int(&min_value) || !reader_.Int(&max_value)) return false;
+      output.bounds.push_back(
+          FzOnSolutionOutput::Bounds(min_value, max_value));
+    }
+    if (!reader_.Bool(&output.display_as_boolean)) return false;
+    model_->AddOutput(output);
+    return true;
+  }
+
+  FzReader reader_;
+  FzModel* const model_;
+  // All the variables, in the order of the serialization.
+  std::vector<FzIntegerVariable*> variables_;
+};
+}  // namespace
+
+void SerializeFzModel(const FzModel& model, std::string* output) {
+  FzModelSerializer(model, output).Run();
+}
+
+bool DeserializeFzModel(const std::string& input, FzModel* model) {
+  CHECK(model->variables().empty());
+  CHECK(model->constraints().empty());
+  return FzModelDeserializer(input, model).Run();
+}
+
+std::string FzCacheFilename(const std::string& cache_dir,
+                            const std::string& input,
+                            const std::string& options) {
+  const uint64 input_hash = ThoroughHash(input.data(), input.size());
+  const uint64 options_hash = ThoroughHash(options.data(), options.size());
+  const uint64 format_hash = ThoroughHash(kFormatHeader, sizeof(kFormatHeader));
+  return StringPrintf(
+      "%s/%016" GG_LL_FORMAT "x.fzc", cache_dir.c_str(),
+      MixTwoUInt64(MixTwoUInt64(input_hash, options_hash), format_hash));
+}
+
+bool LoadPresolvedModel(const std::string& filename, FzModel* model) {
+  std::string contents;
+  return File::Exists(filename.c_str()) &&
+         file::ReadFileToString(filename, &contents) &&
+         DeserializeFzModel(contents, model);
+}
+
+bool SavePresolvedModel(const FzModel& model, const std::string& filename) {
+  std::string contents;
+  SerializeFzModel(model, &contents);
+  // Concurrent runs on the same input may read the file while it is being
+  // written, so it only gets its final name once it is complete.
+  const std::string tmp_filename =
+      StringPrintf("%s.%d.tmp", filename.c_str(),
+                   static_cast<int>(ACMRandom::HostnamePidTimeSeed()));
+  if (!file::WriteStringToFile(contents, tmp_filename)) return false;
+  if (std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+    File::Delete(tmp_filename);
+    return false;
+  }
+  return true;
+}
+}  // namespace operations_research
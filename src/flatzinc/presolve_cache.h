@@ -0,0 +1,52 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// On-disk cache of presolved models. The presolved FzModel holds everything
+// that the solver needs: the variables (including the ones removed by the
+// presolve), the constraints with their tags, the objective, the search
+// annotations and the output. A cached model can thus replace the parsing and
+// the presolve of the same input.
+
+#ifndef OR_TOOLS_FLATZINC_PRESOLVE_CACHE_H_
+#define OR_TOOLS_FLATZINC_PRESOLVE_CACHE_H_
+
+#include <string>
+
+#include "flatzinc/model.h"
+
+namespace operations_research {
+// Writes 'model' to 'output' in a text format that DeserializeFzModel() reads
+// back.
+void SerializeFzModel(const FzModel& model, std::string* output);
+
+// Fills 'model', which must be empty, with the model serialized in 'input'.
+// Returns false if 'input' is not a valid serialized model, in which case the
+// content of 'model' is unspecified.
+bool DeserializeFzModel(const std::string& input, FzModel* model);
+
+// Returns the name of the cache file, in the directory 'cache_dir', of the
+// presolved model of the FlatZinc text 'input'. The name is a hash of the
+// input, of 'options' (which must list the options that change the presolved
+// model), and of the version of the serialization format.
+std::string FzCacheFilename(const std::string& cache_dir,
+                            const std::string& input,
+                            const std::string& options);
+
+// Loads the model of the cache file 'filename' into 'model', which must be
+// empty. Returns false if the file does not exist or is not valid.
+bool LoadPresolvedModel(const std::string& filename, FzModel* model);
+
+// Saves 'model' into the cache file 'filename'. Returns false on failure.
+bool SavePresolvedModel(const FzModel& model, const std::string& filename);
+}  // namespace operations_research
+#endif  // OR_TOOLS_FLATZINC_PRESOLVE_CACHE_H_
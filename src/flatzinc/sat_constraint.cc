@@ -14,6 +14,7 @@
 #include "flatzinc/sat_constraint.h"
 
 #include <algorithm>
+#include <cstdlib>
 #include <string>
 #include <vector>
 #include <iostream>  // NOLINT
@@ -29,6 +30,7 @@
 #include "constraint_solver/constraint_solveri.h"
 
 #include "flatzinc/model.h"
+#include "flatzinc/search.h"
 
 #include "sat/pb_constraint.h"
 #include "sat/sat_base.h"
@@ -39,12 +41,34 @@ DECLARE_bool(fz_verbose);
 DECLARE_bool(fz_debug);
 
 namespace operations_research {
+namespace {
+// Only the learned clauses with at most this number of literals are shared.
+const int kMaxSharedClauseSize = 8;
+// The clauses are imported every kClauseImportPeriod calls to
+// VariableIndexBound().
+const int kClauseImportPeriod = 256;
+// The maximum number of clauses that wait to be imported (because they
+// propagate or are in conflict with the current assignment), and the maximum
+// number of clauses imported during a search.
+const int kMaxPendingClauses = 1000;
+const int kMaxImportedClauses = 100000;
+// The pseudo-Boolean constraints are only posted to sat if the sum of the
+// absolute values of their coefficients is below this bound, which leaves room
+// for the linearization of the reified versions without overflow.
+const int64 kMaxPbCoefficientSum = 1LL << 40;
+}  // namespace
+
 // Constraint that tight together boolean variables in the CP solver to sat
 // variables and clauses.
 class SatPropagator : public Constraint {
  public:
   explicit SatPropagator(Solver* solver)
-      : Constraint(solver), sat_decision_level_(0) {}
+      : Constraint(solver),
+        sat_decision_level_(0),
+        support_(nullptr),
+        worker_id_(-1),
+        num_bound_events_(0),
+        num_imported_clauses_(0) {}
 
   ~SatPropagator() {}
 
@@ -105,9 +129,76 @@ class SatPropagator : public Constraint {
     }
   }
 
+  // Starts exchanging the learned clauses through the given parallel support.
+  void SetClauseSharing(FzParallelSupportInterface* support, int worker_id) {
+    support_ = support;
+    worker_id_ = worker_id;
+  }
+
+  // Imports the clauses published by the other workers, and tries again to
+  // add the clauses that could not be added before. Fails if one of them is
+  // false under the current assignment: since all the clauses are
+  // consequences of the problem, the current node cannot lead to a solution.
+  void ImportClauses() {
+    if (num_imported_clauses_ < kMaxImportedClauses) {
+      support_->ImportClauses(worker_id_, &pending_clauses_);
+    }
+    const int trail_index = sat_.LiteralTrail().Index();
+    const bool at_root = sat_.CurrentDecisionLevel() == 0;
+    bool conflict = false;
+    int num_kept = 0;
+    for (std::vector<sat::Literal>& clause : pending_clauses_) {
+      bool valid = true;
+      for (const sat::Literal literal : clause) {
+        valid &= literal.Variable().value() < sat_.NumVariables();
+      }
+      if (!valid) continue;
+      if (at_root) {
+        // At level 0, the sat solver can propagate the clause itself.
+        if (!sat_.AddImportedClause(clause, clause.size())) solver()->Fail();
+        ++num_imported_clauses_;
+        continue;
+      }
+      if (sat_.AddImportedClauseDuringSearch(clause, clause.size())) {
+        ++num_imported_clauses_;
+        continue;
+      }
+      bool all_false = true;
+      for (const sat::Literal literal : clause) {
+        all_false &= sat_.Assignment().LiteralIsFalse(literal);
+      }
+      conflict |= all_false;
+      pending_clauses_[num_kept++].swap(clause);
+    }
+    // Keeps the most recent clauses.
+    pending_clauses_.resize(num_kept);
+    if (num_kept > kMaxPendingClauses) {
+      pending_clauses_.erase(pending_clauses_.begin(),
+                             pending_clauses_.end() - kMaxPendingClauses);
+    }
+    if (conflict) solver()->Fail();
+    if (at_root) PullSatAssignmentFrom(trail_index);
+  }
+
+  // Enqueues the given decision in the sat solver. When clauses are shared,
+  // the conflict found if the decision fails is published, and kept to be
+  // added to this sat solver later.
+  bool EnqueueDecision(sat::Literal literal) {
+    if (support_ == nullptr) {
+      return sat_.EnqueueDecisionIfNotConflicting(literal);
+    }
+    if (sat_.EnqueueDecisionIfNotConflicting(literal, &conflict_)) return true;
+    if (!conflict_.empty() && conflict_.size() <= kMaxSharedClauseSize) {
+      support_->ExportClause(worker_id_, conflict_);
+      pending_clauses_.push_back(conflict_);
+    }
+    return false;
+  }
+
   // This method is called during the processing of the CP solver queue when
   // a boolean variable is bound.
   void VariableIndexBound(int index) {
+    if (sat_.IsModelUnsat()) solver()->Fail();
     if (sat_decision_level_.Value() < sat_.CurrentDecisionLevel()) {
 #ifdef SAT_DEBUG
       FZDLOG << "After failure, sat_decision_level = "
@@ -118,6 +209,9 @@ class SatPropagator : public Constraint {
       sat_.Backtrack(sat_decision_level_.Value());
       DCHECK_EQ(sat_decision_level_.Value(), sat_.CurrentDecisionLevel());
     }
+    if (support_ != nullptr && ++num_bound_events_ % kClauseImportPeriod == 0) {
+      ImportClauses();
+    }
     const sat::VariableIndex var = sat::VariableIndex(index);
 #ifdef SAT_DEBUG
     FZDLOG << "VariableIndexBound: " << vars_[index]->DebugString()
@@ -145,7 +239,7 @@ class SatPropagator : public Constraint {
            << sat_decision_level_.Value() << FZENDL;
 #endif
     const int trail_index = sat_.LiteralTrail().Index();
-    if (!sat_.EnqueueDecisionIfNotConflicting(literal)) {
+    if (!EnqueueDecision(literal)) {
 #ifdef SAT_DEBUG
       FZDLOG << " - failure detected, should backtrack" << FZENDL;
 #endif
@@ -202,6 +296,13 @@ class SatPropagator : public Constraint {
   NumericalRev<int> sat_decision_level_;
   std::vector<Demon*> demons_;
   std::vector<sat::Literal> early_deductions_;
+  // Clause sharing.
+  FzParallelSupportInterface* support_;
+  int worker_id_;
+  int64 num_bound_events_;
+  int64 num_imported_clauses_;
+  std::vector<sat::Literal> conflict_;
+  std::vector<std::vector<sat::Literal>> pending_clauses_;
 };
 
 void DeclareVariableIndex(SatPropagator* sat, IntVar* var) {
@@ -418,6 +519,22 @@ bool AddBoolIsLeVar(SatPropagator* sat, IntExpr* left, IntExpr* right,
   return true;
 }
 
+bool AddBoolIsLtVar(SatPropagator* sat, IntExpr* left, IntExpr* right,
+                    IntExpr* target) {
+  if (!sat->IsExpressionBoolean(left) || !sat->IsExpressionBoolean(right) ||
+      !sat->IsExpressionBoolean(target)) {
+    return false;
+  }
+  sat::Literal left_literal = sat->Literal(left);
+  sat::Literal right_literal = sat->Literal(right);
+  sat::Literal target_literal = sat->Literal(target);
+  sat->sat()->AddTernaryClause(left_literal, right_literal.Negated(),
+                               target_literal);
+  sat->sat()->AddBinaryClause(left_literal.Negated(), target_literal.Negated());
+  sat->sat()->AddBinaryClause(right_literal, target_literal.Negated());
+  return true;
+}
+
 bool AddBoolOrArrayEqualTrue(SatPropagator* sat, const std::vector<IntVar*>& vars) {
   if (!sat->AllVariablesBoolean(vars)) {
     return false;
@@ -529,6 +646,101 @@ bool AddSumInRange(SatPropagator* sat, const std::vector<IntVar*>& vars,
   return true;
 }
 
+namespace {
+// Fills terms with the literals of vars and the coefficients coeffs, and
+// computes the minimum and maximum value of the sum. Returns false if the
+// variables are not all Boolean, or if the coefficients are too large.
+bool BuildPbTerms(SatPropagator* sat, const std::vector<IntVar*>& vars,
+                  const std::vector<int64>& coeffs,
+                  std::vector<sat::LiteralWithCoeff>* terms, int64* min_sum,
+                  int64* max_sum) {
+  CHECK_EQ(vars.size(), coeffs.size());
+  if (!sat->AllVariablesBoolean(vars)) {
+    return false;
+  }
+  int64 abs_sum = 0;
+  for (const int64 coeff : coeffs) {
+    if (coeff > kMaxPbCoefficientSum || coeff < -kMaxPbCoefficientSum) {
+      return false;
+    }
+    abs_sum += std::abs(coeff);
+    if (abs_sum > kMaxPbCoefficientSum) {
+      return false;
+    }
+  }
+  terms->clear();
+  *min_sum = 0;
+  *max_sum = 0;
+  for (int i = 0; i < vars.size(); ++i) {
+    if (coeffs[i] == 0) continue;
+    terms->push_back(
+        sat::LiteralWithCoeff(sat->Literal(vars[i]), coeffs[i]));
+    if (coeffs[i] > 0) {
+      *max_sum += coeffs[i];
+    } else {
+      *min_sum += coeffs[i];
+    }
+  }
+  return true;
+}
+}  // namespace
+
+bool AddBooleanLinearInRange(SatPropagator* sat,
+                             const std::vector<IntVar*>& vars,
+                             const std::vector<int64>& coeffs, int64 range_min,
+                             int64 range_max) {
+  std::vector<sat::LiteralWithCoeff> terms;
+  int64 min_sum = 0;
+  int64 max_sum = 0;
+  if (!BuildPbTerms(sat, vars, coeffs, &terms, &min_sum, &max_sum)) {
+    return false;
+  }
+  const bool use_lower_bound = range_min > min_sum;
+  const bool use_upper_bound = range_max < max_sum;
+  sat->sat()->AddLinearConstraint(
+      use_lower_bound,
+      sat::Coefficient(use_lower_bound ? std::min(range_min, max_sum + 1) : 0),
+      use_upper_bound,
+      sat::Coefficient(use_upper_bound ? std::max(range_max, min_sum - 1) : 0),
+      &terms);
+  return true;
+}
+
+bool AddIsBooleanLinearLessOrEqual(SatPropagator* sat,
+                                   const std::vector<IntVar*>& vars,
+                                   const std::vector<int64>& coeffs, int64 rhs,
+                                   IntExpr* target) {
+  if (!sat->IsExpressionBoolean(target)) {
+    return false;
+  }
+  std::vector<sat::LiteralWithCoeff> terms;
+  int64 min_sum = 0;
+  int64 max_sum = 0;
+  if (!BuildPbTerms(sat, vars, coeffs, &terms, &min_sum, &max_sum)) {
+    return false;
+  }
+  const sat::Literal target_literal = sat->Literal(target);
+  if (rhs >= max_sum) {
+    sat->sat()->AddUnitClause(target_literal);
+    return true;
+  }
+  if (rhs < min_sum) {
+    sat->sat()->AddUnitClause(target_literal.Negated());
+    return true;
+  }
+  // target => sum <= rhs, i.e. sum + (max_sum - rhs) * target <= max_sum.
+  std::vector<sat::LiteralWithCoeff> implied = terms;
+  implied.push_back(sat::LiteralWithCoeff(target_literal, max_sum - rhs));
+  sat->sat()->AddLinearConstraint(false, sat::Coefficient(0), true,
+                                  sat::Coefficient(max_sum), &implied);
+  // not(target) => sum >= rhs + 1, i.e.
+  // sum + (rhs + 1 - min_sum) * target >= rhs + 1.
+  terms.push_back(sat::LiteralWithCoeff(target_literal, rhs + 1 - min_sum));
+  sat->sat()->AddLinearConstraint(true, sat::Coefficient(rhs + 1), false,
+                                  sat::Coefficient(0), &terms);
+  return true;
+}
+
 SatPropagator* MakeSatPropagator(Solver* solver) {
   return solver->RevAlloc(new SatPropagator(solver));
 }
@@ -536,4 +748,9 @@ SatPropagator* MakeSatPropagator(Solver* solver) {
 int NumSatConstraints(SatPropagator* sat) {
   return sat->sat()->NumAddedConstraints();
 }
+
+void SetClauseSharing(SatPropagator* sat, FzParallelSupportInterface* support,
+                      int worker_id) {
+  sat->SetClauseSharing(support, worker_id);
+}
 }  // namespace operations_research
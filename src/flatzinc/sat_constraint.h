@@ -15,6 +15,7 @@
 #define OR_TOOLS_FLATZINC_SAT_CONSTRAINT_H_
 
 #include "constraint_solver/constraint_solver.h"
+#include "flatzinc/search.h"
 
 namespace operations_research {
 class SatPropagator;
@@ -23,6 +24,11 @@ SatPropagator* MakeSatPropagator(Solver* solver);
 
 int NumSatConstraints(SatPropagator* sat);
 
+// Makes the propagator publish the short clauses it learns through the given
+// parallel support, and import the ones of the other workers.
+void SetClauseSharing(SatPropagator* sat, FzParallelSupportInterface* support,
+                      int worker_id);
+
 bool AddBoolEq(SatPropagator* sat, IntExpr* left, IntExpr* right);
 
 bool AddBoolLe(SatPropagator* sat, IntExpr* left, IntExpr* right);
@@ -53,6 +59,10 @@ bool AddBoolIsNEqVar(SatPropagator* sat, IntExpr* left, IntExpr* right,
 bool AddBoolIsLeVar(SatPropagator* sat, IntExpr* left, IntExpr* right,
                     IntExpr* target);
 
+// target <=> left < right, i.e. target <=> not(left) && right.
+bool AddBoolIsLtVar(SatPropagator* sat, IntExpr* left, IntExpr* right,
+                    IntExpr* target);
+
 bool AddBoolOrEqVar(SatPropagator* sat, IntExpr* left, IntExpr* right,
                     IntExpr* target);
 
@@ -77,6 +87,20 @@ bool AddIntNeReif(SatPropagator* sat, IntExpr* left, IntExpr* right,
 bool AddSumInRange(SatPropagator* sat, const std::vector<IntVar*>& vars,
                    int64 range_min, int64 range_max);
 
+// Pseudo-Boolean constraints, with arbitrary integer coefficients over Boolean
+// variables. They return false (and post nothing) if a variable is not
+// Boolean or if the coefficients are too large for the sat solver.
+// range_min <= sum(coeffs[i] * vars[i]) <= range_max.
+bool AddBooleanLinearInRange(SatPropagator* sat,
+                             const std::vector<IntVar*>& vars,
+                             const std::vector<int64>& coeffs, int64 range_min,
+                             int64 range_max);
+// target <=> sum(coeffs[i] * vars[i]) <= rhs.
+bool AddIsBooleanLinearLessOrEqual(SatPropagator* sat,
+                                   const std::vector<IntVar*>& vars,
+                                   const std::vector<int64>& coeffs, int64 rhs,
+                                   IntExpr* target);
+
 void DeclareVariable(SatPropagator* sat, IntVar* var);
 }  // namespace operations_research
 #endif  // OR_TOOLS_FLATZINC_SAT_CONSTRAINT_H_
@@ -20,7 +20,10 @@
 #include "base/hash.h"
 #include "constraint_solver/constraint_solver.h"
 #include "constraint_solver/constraint_solveri.h"
+#include "flatzinc/lns.h"
+#include "flatzinc/lp_relaxation.h"
 #include "flatzinc/model.h"
+#include "flatzinc/sat_constraint.h"
 #include "flatzinc/search.h"
 #include "flatzinc/solver.h"
 
@@ -155,7 +158,11 @@ FzSolverParameters::FzSolverParameters()
       threads(1),
       worker_id(-1),
       time_limit_in_ms(0),
-      search_type(MIN_SIZE) {}
+      search_type(MIN_SIZE),
+      store_all_solutions(false),
+      use_lp_relaxation(false),
+      use_lns(false),
+      lns_failures(100) {}
 
 void MarkComputedVariables(FzConstraint* ct,
                            hash_set<FzIntegerVariable*>* marked) {
@@ -587,6 +594,12 @@ void FzSolver::SyncWithModel() {
 void FzSolver::Solve(FzSolverParameters p,
                      FzParallelSupportInterface* parallel_support) {
   SyncWithModel();
+  if (sat_ != nullptr && parallel_support->ShareClauses()) {
+    SetClauseSharing(sat_, parallel_support, p.worker_id);
+  }
+  if (p.use_lp_relaxation) {
+    PostLinearRelaxation(model_, this);
+  }
   SearchLimit* const limit = p.time_limit_in_ms > 0
                                  ? solver()->MakeTimeLimit(p.time_limit_in_ms)
                                  : nullptr;
@@ -595,7 +608,7 @@ void FzSolver::Solve(FzSolverParameters p,
       limit == nullptr ? nullptr
                        : solver()->MakeCustomLimit(
                              [limit]() { return limit->Check(); });
-  DecisionBuilder* const db = CreateDecisionBuilders(p, shadow);
+  DecisionBuilder* db = CreateDecisionBuilders(p, shadow);
   std::vector<SearchMonitor*> monitors;
   if (model_.objective() != nullptr) {
     objective_monitor_ = parallel_support->Objective(
@@ -606,6 +619,15 @@ void FzSolver::Solve(FzSolverParameters p,
                   new FzLog(solver(), objective_monitor_, p.log_period))
             : nullptr;
     SearchLimit* const ctrl_c = solver()->RevAlloc(new FzInterrupt(solver()));
+    if (p.use_lns) {
+      // The objective is left free in all the neighbors.
+      std::vector<IntVar*> lns_vars;
+      for (IntVar* const var : active_variables_) {
+        if (var != objective_var_) lns_vars.push_back(var);
+      }
+      db = MakeStructureLns(model_, this, lns_vars, db, objective_monitor_,
+                            p.lns_failures, p.random_seed);
+    }
     monitors.push_back(log);
     monitors.push_back(objective_monitor_);
     monitors.push_back(ctrl_c);
@@ -759,7 +781,7 @@ void FzSolver::Solve(FzSolverParameters p,
                                          default_search_stats.c_str()));
       }
     }
-
+    final_output.append(ConstraintProfileString());
 
     const bool no_solutions = num_solutions == 0;
     const std::string status_string =
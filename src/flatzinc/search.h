@@ -14,8 +14,11 @@
 #ifndef OR_TOOLS_FLATZINC_SEARCH_H_
 #define OR_TOOLS_FLATZINC_SEARCH_H_
 
+#include <vector>
+
 #include "constraint_solver/constraint_solver.h"
 #include "flatzinc/model.h"
+#include "sat/sat_base.h"
 
 namespace operations_research {
 struct FzSolverParameters {
@@ -49,13 +52,18 @@ struct FzSolverParameters {
   int64 time_limit_in_ms;
   SearchType search_type;
   bool store_all_solutions;
+  bool use_lp_relaxation;
+  bool use_lns;
+  int lns_failures;
 };
 
 // This class is used to abstract the interface to parallelism from
-// the search code. It offers two sets of API:
+// the search code. It offers three sets of API:
 //    - Create specific search objects (Objective(), Limit(), Log()).
 //    - Report solution (SatSolution(), OptimizeSolution(), FinalOutput(),
 //                       EndSearch(), BestSolution(), Interrupted()).
+//    - Share the clauses learned by the sat propagators of the workers
+//      (ShareClauses(), ExportClause(), ImportClauses()).
 class FzParallelSupportInterface {
  public:
   enum Type {
@@ -98,6 +106,17 @@ class FzParallelSupportInterface {
   virtual SearchLimit* Limit(Solver* s, int worker_id) = 0;
   // Creates a dedicated search log.
   virtual void Log(int worker_id, const std::string& message) = 0;
+  // Returns true if the workers exchange the clauses learned by their sat
+  // propagator. This relies on all the workers extracting the same model in
+  // the same order, so that their sat solvers have the same variables.
+  virtual bool ShareClauses() const { return false; }
+  // Worker 'worker_id' publishes a clause learned by its sat propagator.
+  virtual void ExportClause(int worker_id,
+                            const std::vector<sat::Literal>& clause) {}
+  // Appends to 'clauses' the clauses published by the other workers since the
+  // last call from worker 'worker_id'.
+  virtual void ImportClauses(int worker_id,
+                             std::vector<std::vector<sat::Literal>>* clauses) {}
 #endif
   // Returns if the search was interrupted, usually by a time or
   // solution limit.
@@ -115,9 +134,23 @@ class FzParallelSupportInterface {
 // Create an interface suitable for a sequential search.
 FzParallelSupportInterface* MakeSequentialSupport(bool print_all,
                                                   int num_solutions);
-// Creates an interface suitable for a multi-threaded search.
+// Creates an interface suitable for a multi-threaded search. The best
+// objective value is published without locks, and the workers share their
+// short learned clauses if 'share_clauses' is true.
 FzParallelSupportInterface* MakeMtSupport(bool print_all, int num_solutions,
-                                          bool verbose);
+                                          bool verbose, int num_workers,
+                                          bool share_clauses);
+// Same as above, but the workers only exchange solutions, bounds and clauses
+// at the end of each epoch, when they have all called the Check() method of
+// their search limit 'epoch_length' times. The solutions are then processed
+// in the order of the worker ids, so that the result of the search does not
+// depend on the thread scheduling (unless a time limit is reached).
+FzParallelSupportInterface* MakeDeterministicMtSupport(bool print_all,
+                                                       int num_solutions,
+                                                       bool verbose,
+                                                       int num_workers,
+                                                       bool share_clauses,
+                                                       int epoch_length);
 }  // namespace operations_research
 
 #endif  // OR_TOOLS_FLATZINC_SEARCH_H_
@@ -16,6 +16,7 @@
 #include "base/logging.h"
 #include "base/hash.h"
 #include "base/map_util.h"
+#include "flatzinc/linear_store.h"
 #include "flatzinc/model.h"
 #include "flatzinc/sat_constraint.h"
 #include "flatzinc/solver.h"
@@ -26,8 +27,32 @@ DECLARE_bool(fz_logging);
 DECLARE_bool(fz_verbose);
 DECLARE_bool(fz_debug);
 DEFINE_bool(use_sat, true, "Use a sat solver for propagating on booleans.");
+DEFINE_bool(bulk_linear, false,
+            "Extract the linear constraints into one shared propagator instead "
+            "of one scalar product constraint each.");
+DEFINE_bool(fz_profile, false,
+            "Profile the propagation and print its cost per type of flatzinc "
+            "constraint at the end of the search.");
 
 namespace operations_research {
+namespace {
+SolverParameters CpSolverParameters() {
+  SolverParameters parameters;
+  if (FLAGS_fz_profile) {
+    parameters.profile_level = SolverParameters::NORMAL_PROFILING;
+  }
+  return parameters;
+}
+}  // namespace
+
+FzSolver::FzSolver(const FzModel& model)
+    : model_(model),
+      statistics_(model),
+      solver_(model.name(), CpSolverParameters()),
+      sat_(nullptr),
+      linear_store_(nullptr),
+      default_phase_(nullptr) {}
+
 IntExpr* FzSolver::GetExpression(const FzArgument& arg) {
   switch (arg.type) {
     case FzArgument::INT_VALUE: {
@@ -208,6 +233,14 @@ bool FzSolver::Extract() {
   } else {
     sat_ = nullptr;
   }
+  // Create the bulk linear propagator.
+  if (FLAGS_bulk_linear) {
+    FZLOG << "  - Use bulk linear propagator" << FZENDL;
+    linear_store_ = MakeLinearStore(&solver_);
+    solver_.AddConstraint(reinterpret_cast<Constraint*>(linear_store_));
+  } else {
+    linear_store_ = nullptr;
+  }
   // Build statistics.
   statistics_.BuildStatistics();
   // Extract variables.
@@ -303,8 +336,18 @@ bool FzSolver::Extract() {
     }
     delete ctio;
   }
+  hash_map<const FzConstraint*, int> constraint_ids;
+  if (FLAGS_fz_profile) {
+    for (int i = 0; i < model_.constraints().size(); ++i) {
+      constraint_ids[model_.constraints()[i]] = i;
+    }
+  }
   for (FzConstraint* const ct : sorted) {
+    const int first_index = solver_.constraints();
     ExtractConstraint(ct);
+    if (FLAGS_fz_profile) {
+      TagConstraints(ct, constraint_ids[ct], first_index);
+    }
   }
   FZLOG << "  - " << sorted.size() << " constraints parsed" << FZENDL;
   const int num_cp_constraints = solver_.constraints();
@@ -321,6 +364,13 @@ bool FzSolver::Extract() {
           << FZENDL;
   }
 
+  const int num_linear_rows =
+      linear_store_ != nullptr ? NumLinearRows(linear_store_) : 0;
+  if (num_linear_rows > 0) {
+    FZLOG << "  - " << num_linear_rows
+          << " constraints added to the bulk linear propagator" << FZENDL;
+  }
+
   // Add domain constraints to created expressions.
   int domain_constraints = 0;
   for (FzIntegerVariable* const var : model_.variables()) {
@@ -19,6 +19,7 @@
 #include "flatzinc/search.h"
 
 namespace operations_research {
+class LinearStore;
 class SatPropagator;
 
 // The main class to search for a solution in a flatzinc model.  It is
@@ -26,12 +27,7 @@ class SatPropagator;
 // search state and perform the actual search.
 class FzSolver {
  public:
-  explicit FzSolver(const FzModel& model)
-      : model_(model),
-        statistics_(model),
-        solver_(model.name()),
-        sat_(nullptr),
-        default_phase_(nullptr) {}
+  explicit FzSolver(const FzModel& model);
 
   // Search for for solutions in the model passed at construction
   // time.  The exact search context (search for optimal solution, for
@@ -63,8 +59,18 @@ class FzSolver {
 
   // Returns the sat constraint.
   SatPropagator* Sat() const { return sat_; }
+
+  // Returns the bulk linear propagator, or nullptr if the linear
+  // constraints are extracted one by one.
+  LinearStore* Linear() const { return linear_store_; }
 #endif
 
+  // Returns the table of the propagation runtime, demon runs and failures
+  // of the CP constraints aggregated per type of their originating flatzinc
+  // constraint, sorted by decreasing runtime. Returns an empty string if
+  // profiling is disabled (see --fz_profile).
+  std::string ConstraintProfileString();
+
   int NumStoredSolutions() const { return stored_values_.size(); }
   int64 StoredValue(int solution_index, FzIntegerVariable* var) {
     CHECK_GE(solution_index, 0);
@@ -75,6 +81,9 @@ class FzSolver {
 
  private:
   void ExtractConstraint(FzConstraint* ct);
+  // Names the CP constraints added from 'first_index' on after 'ct', of index
+  // 'id' in the model, and remembers 'ct' as their origin.
+  void TagConstraints(FzConstraint* ct, int id, int first_index);
   bool HasSearchAnnotations() const;
   void ParseSearchAnnotations(bool ignore_unknown,
                               std::vector<DecisionBuilder*>* defined,
@@ -107,10 +116,14 @@ class FzSolver {
       alldiffs_;
   // Sat constraint.
   SatPropagator* sat_;
+  // Bulk linear constraint.
+  LinearStore* linear_store_;
   // Default Search Phase (to get stats).
   DecisionBuilder* default_phase_;
   // Stored solutions.
   std::vector<hash_map<FzIntegerVariable*, int64>> stored_values_;
+  // Originating flatzinc constraint of the CP constraints, when profiling.
+  hash_map<const Constraint*, const FzConstraint*> constraint_origins_;
 };
 }  // namespace operations_research
 
@@ -173,6 +173,206 @@ void EtaFactorization::RightSolve(DenseColumn* d) const {
   }
 }
 
+// --------------------------------------------------------
+// ForrestTomlinFactorization
+// --------------------------------------------------------
+namespace {
+// The Forrest-Tomlin update fails if the magnitude of the new pivot is smaller
+// than this times the largest magnitude of the spike.
+const Fractional kForrestTomlinPivotTolerance = 1e-11;
+}  // namespace
+
+ForrestTomlinFactorization::ForrestTomlinFactorization()
+    : is_initialized_(false), num_rows_(0), num_entries_(0) {}
+
+void ForrestTomlinFactorization::Clear() {
+  is_initialized_ = false;
+  upper_.Clear();
+  eta_rows_.clear();
+  eta_multipliers_.Clear();
+  num_entries_ = EntryIndex(0);
+}
+
+void ForrestTomlinFactorization::Initialize(
+    const LuFactorization& lu_factorization, RowIndex num_rows) {
+  Clear();
+  is_initialized_ = true;
+  num_rows_ = num_rows;
+  const ColIndex num_cols = RowToColIndex(num_rows);
+  upper_.PopulateFromZero(num_rows, num_cols);
+  eta_multipliers_.PopulateFromZero(num_rows, ColIndex(0));
+  diagonal_.assign(num_cols, 0.0);
+  pivot_row_.assign(num_cols, kInvalidRow);
+
+  // The pivot row of the basis column col is the column of U that
+  // GetColumnOfU() returns, and the initial pivot order is the one of U.
+  const ColumnPermutation& col_perm = lu_factorization.GetColumnPermutation();
+  order_.assign(num_cols.value(), kInvalidCol);
+  position_.assign(num_cols, 0);
+  for (ColIndex col(0); col < num_cols; ++col) {
+    const RowIndex pivot_row =
+        ColToRowIndex(col_perm.empty() ? col : col_perm[col]);
+    pivot_row_[col] = pivot_row;
+    order_[pivot_row.value()] = col;
+    position_[col] = pivot_row.value();
+    SparseColumn* const column = upper_.mutable_column(col);
+    for (const SparseColumn::Entry e : lu_factorization.GetColumnOfU(col)) {
+      if (e.row() == pivot_row) {
+        diagonal_[col] = e.coefficient();
+      } else {
+        column->SetCoefficient(e.row(), e.coefficient());
+      }
+    }
+    num_entries_ += column->num_entries() + 1;
+  }
+}
+
+void ForrestTomlinFactorization::ApplyRowEtas(DenseColumn* x) const {
+  for (int i = 0; i < eta_rows_.size(); ++i) {
+    const SparseColumn& multipliers = eta_multipliers_.column(ColIndex(i));
+    Fractional sum = 0.0;
+    for (const SparseColumn::Entry e : multipliers) {
+      sum += e.coefficient() * (*x)[e.row()];
+    }
+    (*x)[eta_rows_[i]] -= sum;
+  }
+}
+
+// Let r be the pivot row of the replaced column. The multipliers m of the row
+// eta are the solution of m.U' = U(r, .) where U' is the submatrix of U formed
+// by the rows and the columns whose pivot comes after r. This is a left solve,
+// so it can be computed column by column in pivot order.
+Status ForrestTomlinFactorization::Update(ColIndex col, DenseColumn* spike) {
+  DCHECK(is_initialized_);
+  ApplyRowEtas(spike);
+  const RowIndex pivot_row = pivot_row_[col];
+  const int old_position = position_[col];
+
+  // Compute the multipliers and remove the row r from the other columns.
+  DenseColumn& multipliers = scratchpad_;
+  multipliers.AssignToZero(num_rows_);
+  std::vector<RowIndex> multiplier_rows;
+  const int num_cols = order_.size();
+  for (int position = old_position + 1; position < num_cols; ++position) {
+    const ColIndex other_col = order_[position];
+    SparseColumn* const column = upper_.mutable_column(other_col);
+    Fractional value = 0.0;
+    bool has_pivot_row_entry = false;
+    for (const SparseColumn::Entry e : *column) {
+      if (e.row() == pivot_row) {
+        value += e.coefficient();
+        has_pivot_row_entry = true;
+      } else {
+        value -= multipliers[e.row()] * e.coefficient();
+      }
+    }
+    if (has_pivot_row_entry) {
+      column->DeleteEntry(pivot_row);
+      --num_entries_;
+    }
+    if (value != 0.0) {
+      const RowIndex other_pivot_row = pivot_row_[other_col];
+      multipliers[other_pivot_row] = value / diagonal_[other_col];
+      multiplier_rows.push_back(other_pivot_row);
+    }
+  }
+
+  // The new pivot is the coefficient of the spike on the row r, once the row
+  // eta is applied to it.
+  Fractional new_pivot = (*spike)[pivot_row];
+  Fractional spike_magnitude = 0.0;
+  for (RowIndex row(0); row < num_rows_; ++row) {
+    spike_magnitude = std::max(spike_magnitude, std::abs((*spike)[row]));
+  }
+  for (const RowIndex row : multiplier_rows) {
+    new_pivot -= multipliers[row] * (*spike)[row];
+  }
+  if (std::abs(new_pivot) <= kForrestTomlinPivotTolerance * spike_magnitude) {
+    Clear();
+    VLOG(1) << "Singular Forrest-Tomlin update, new pivot = " << new_pivot;
+    return Status(Status::ERROR_LU, "Singular Forrest-Tomlin update.");
+  }
+
+  // Store the row eta.
+  if (!multiplier_rows.empty()) {
+    const ColIndex eta_col = eta_multipliers_.AppendEmptyColumn();
+    SparseColumn* const column = eta_multipliers_.mutable_column(eta_col);
+    for (const RowIndex row : multiplier_rows) {
+      column->SetCoefficient(row, multipliers[row]);
+      multipliers[row] = 0.0;
+    }
+    eta_rows_.push_back(pivot_row);
+    num_entries_ += column->num_entries();
+  }
+
+  // Replace the column by the spike.
+  SparseColumn* const column = upper_.mutable_column(col);
+  num_entries_ -= column->num_entries();
+  column->Clear();
+  for (RowIndex row(0); row < num_rows_; ++row) {
+    const Fractional value = (*spike)[row];
+    if (value != 0.0 && row != pivot_row) column->SetCoefficient(row, value);
+  }
+  num_entries_ += column->num_entries();
+  diagonal_[col] = new_pivot;
+
+  // Move the column at the end of the pivot order.
+  for (int position = old_position + 1; position < num_cols; ++position) {
+    const ColIndex other_col = order_[position];
+    order_[position - 1] = other_col;
+    position_[other_col] = position - 1;
+  }
+  order_[num_cols - 1] = col;
+  position_[col] = num_cols - 1;
+  return Status::OK;
+}
+
+void ForrestTomlinFactorization::RightSolveU(DenseColumn* x) const {
+  DCHECK(is_initialized_);
+  ApplyRowEtas(x);
+
+  // Solve U_k.Q.t = x by going backward in pivot order. The result is indexed
+  // by the basis columns.
+  scratchpad_.AssignToZero(num_rows_);
+  for (int position = order_.size() - 1; position >= 0; --position) {
+    const ColIndex col = order_[position];
+    const Fractional value = (*x)[pivot_row_[col]] / diagonal_[col];
+    if (value == 0.0) continue;
+    scratchpad_[ColToRowIndex(col)] = value;
+    for (const SparseColumn::Entry e : upper_.column(col)) {
+      (*x)[e.row()] -= e.coefficient() * value;
+    }
+  }
+  x->swap(scratchpad_);
+}
+
+void ForrestTomlinFactorization::LeftSolveU(DenseRow* y) const {
+  DCHECK(is_initialized_);
+
+  // Solve t.U_k.Q = y by going forward in pivot order. The result is indexed
+  // by the rows of U.
+  scratchpad_.AssignToZero(num_rows_);
+  for (const ColIndex col : order_) {
+    Fractional value = (*y)[col];
+    for (const SparseColumn::Entry e : upper_.column(col)) {
+      value -= e.coefficient() * scratchpad_[e.row()];
+    }
+    scratchpad_[pivot_row_[col]] = value / diagonal_[col];
+  }
+
+  // Apply the transposes of the row etas in reverse order.
+  for (int i = eta_rows_.size() - 1; i >= 0; --i) {
+    const Fractional value = scratchpad_[eta_rows_[i]];
+    if (value == 0.0) continue;
+    for (const SparseColumn::Entry e : eta_multipliers_.column(ColIndex(i))) {
+      scratchpad_[e.row()] -= e.coefficient() * value;
+    }
+  }
+  for (RowIndex row(0); row < num_rows_; ++row) {
+    (*y)[RowToColIndex(row)] = scratchpad_[row];
+  }
+}
+
 // --------------------------------------------------------
 // BasisFactorization
 // --------------------------------------------------------
@@ -184,6 +384,7 @@ BasisFactorization::BasisFactorization(const MatrixView& matrix,
       tau_is_computed_(false),
       max_num_updates_(0),
       num_updates_(0),
+      num_refactorizations_(0),
       eta_factorization_(),
       lu_factorization_(),
       deterministic_time_(0.0) {
@@ -197,6 +398,7 @@ void BasisFactorization::Clear() {
   num_updates_ = 0;
   tau_computation_can_be_optimized_ = false;
   eta_factorization_.Clear();
+  forrest_tomlin_factorization_.Clear();
   lu_factorization_.Clear();
   rank_one_factorization_.Clear();
   storage_.Reset(matrix_.num_rows());
@@ -224,6 +426,7 @@ Status BasisFactorization::Refactorize() {
 Status BasisFactorization::ForceRefactorization() {
   SCOPED_TIME_STAT(&stats_);
   stats_.refactorization_interval.Add(num_updates_);
+  ++num_refactorizations_;
   Clear();
   MatrixView basis_matrix;
   basis_matrix.PopulateFromBasis(matrix_, basis_);
@@ -285,13 +488,36 @@ Status BasisFactorization::MiddleProductFormUpdate(
   return Status::OK;
 }
 
+Status BasisFactorization::ForrestTomlinUpdate(ColIndex entering_col,
+                                               RowIndex leaving_variable_row) {
+  if (!forrest_tomlin_factorization_.IsInitialized()) {
+    forrest_tomlin_factorization_.Initialize(lu_factorization_,
+                                             matrix_.num_rows());
+  }
+  ClearAndResizeVectorWithNonZeros(matrix_.num_rows(), &scratchpad_,
+                                   &scratchpad_non_zeros_);
+  lu_factorization_.RightSolveLForSparseColumn(matrix_.column(entering_col),
+                                               &scratchpad_);
+  if (!forrest_tomlin_factorization_
+           .Update(RowToColIndex(leaving_variable_row), &scratchpad_)
+           .ok()) {
+    return ForceRefactorization();
+  }
+  scratchpad_.clear();
+  return Status::OK;
+}
+
 Status BasisFactorization::Update(ColIndex entering_col,
                                   RowIndex leaving_variable_row,
                                   const std::vector<RowIndex>& eta_non_zeros,
                                   DenseColumn* dense_eta) {
   if (num_updates_ < max_num_updates_) {
     SCOPED_TIME_STAT(&stats_);
-    if (use_middle_product_form_update_) {
+    if (use_forrest_tomlin_update_) {
+      // When the update fails, the basis is refactorized instead.
+      RETURN_IF_ERROR(ForrestTomlinUpdate(entering_col, leaving_variable_row));
+      if (!forrest_tomlin_factorization_.IsInitialized()) return Status::OK;
+    } else if (use_middle_product_form_update_) {
       RETURN_IF_ERROR(
           MiddleProductFormUpdate(entering_col, leaving_variable_row));
     } else {
@@ -309,7 +535,10 @@ void BasisFactorization::LeftSolve(DenseRow* y) const {
   SCOPED_TIME_STAT(&stats_);
   RETURN_IF_NULL(y);
   BumpDeterministicTimeForSolve(matrix_.num_rows().value());
-  if (use_middle_product_form_update_) {
+  if (UseForrestTomlinSolves()) {
+    forrest_tomlin_factorization_.LeftSolveU(y);
+    lu_factorization_.LeftSolveL(y);
+  } else if (use_middle_product_form_update_) {
     lu_factorization_.LeftSolveU(y);
     rank_one_factorization_.LeftSolve(y);
     lu_factorization_.LeftSolveL(y);
@@ -324,7 +553,10 @@ void BasisFactorization::LeftSolveWithNonZeros(
   SCOPED_TIME_STAT(&stats_);
   RETURN_IF_NULL(y);
   BumpDeterministicTimeForSolve(matrix_.num_rows().value());
-  if (use_middle_product_form_update_) {
+  if (UseForrestTomlinSolves()) {
+    forrest_tomlin_factorization_.LeftSolveU(y);
+    lu_factorization_.LeftSolveLWithNonZeros(y, non_zeros, nullptr);
+  } else if (use_middle_product_form_update_) {
     lu_factorization_.LeftSolveU(y);
     rank_one_factorization_.LeftSolve(y);
     lu_factorization_.LeftSolveLWithNonZeros(y, non_zeros, nullptr);
@@ -339,7 +571,10 @@ void BasisFactorization::RightSolve(DenseColumn* d) const {
   SCOPED_TIME_STAT(&stats_);
   RETURN_IF_NULL(d);
   BumpDeterministicTimeForSolve(matrix_.num_rows().value());
-  if (use_middle_product_form_update_) {
+  if (UseForrestTomlinSolves()) {
+    lu_factorization_.RightSolveL(d);
+    forrest_tomlin_factorization_.RightSolveU(d);
+  } else if (use_middle_product_form_update_) {
     lu_factorization_.RightSolveL(d);
     rank_one_factorization_.RightSolve(d);
     lu_factorization_.RightSolveU(d);
@@ -354,7 +589,11 @@ void BasisFactorization::RightSolveWithNonZeros(
   SCOPED_TIME_STAT(&stats_);
   RETURN_IF_NULL(d);
   BumpDeterministicTimeForSolve(non_zeros->size());
-  if (use_middle_product_form_update_) {
+  if (UseForrestTomlinSolves()) {
+    lu_factorization_.RightSolveL(d);
+    forrest_tomlin_factorization_.RightSolveU(d);
+    ComputeNonZeros(*d, non_zeros);
+  } else if (use_middle_product_form_update_) {
     lu_factorization_.RightSolveL(d);
     rank_one_factorization_.RightSolve(d);
     lu_factorization_.RightSolveUWithNonZeros(d, non_zeros);
@@ -370,7 +609,11 @@ DenseColumn* BasisFactorization::RightSolveForTau(ScatteredColumnReference a)
     const {
   SCOPED_TIME_STAT(&stats_);
   BumpDeterministicTimeForSolve(matrix_.num_rows().value());
-  if (use_middle_product_form_update_) {
+  if (UseForrestTomlinSolves()) {
+    tau_ = a.dense_column;
+    lu_factorization_.RightSolveL(&tau_);
+    forrest_tomlin_factorization_.RightSolveU(&tau_);
+  } else if (use_middle_product_form_update_) {
     if (tau_computation_can_be_optimized_) {
       // Once used, the intermediate result is overriden, so RightSolveForTau()
       // can no longer use the optimized algorithm.
@@ -399,6 +642,12 @@ void BasisFactorization::LeftSolveForUnitRow(ColIndex j, DenseRow* y,
   ClearAndResizeVectorWithNonZeros(RowToColIndex(matrix_.num_rows()), y,
                                    non_zeros);
 
+  if (UseForrestTomlinSolves()) {
+    (*y)[j] = 1.0;
+    forrest_tomlin_factorization_.LeftSolveU(y);
+    lu_factorization_.LeftSolveLWithNonZeros(y, non_zeros, nullptr);
+    return;
+  }
   if (!use_middle_product_form_update_) {
     (*y)[j] = 1.0;
     non_zeros->push_back(j);
@@ -444,6 +693,13 @@ void BasisFactorization::RightSolveForProblemColumn(
   SCOPED_TIME_STAT(&stats_);
   RETURN_IF_NULL(d);
   BumpDeterministicTimeForSolve(matrix_.column(col).num_entries().value());
+  if (UseForrestTomlinSolves()) {
+    ClearAndResizeVectorWithNonZeros(matrix_.num_rows(), d, non_zeros);
+    lu_factorization_.RightSolveLForSparseColumn(matrix_.column(col), d);
+    forrest_tomlin_factorization_.RightSolveU(d);
+    ComputeNonZeros(*d, non_zeros);
+    return;
+  }
   if (!use_middle_product_form_update_) {
     lu_factorization_.SparseRightSolve(matrix_.column(col), matrix_.num_rows(),
                                        d);
@@ -455,10 +711,18 @@ void BasisFactorization::RightSolveForProblemColumn(
   // TODO(user): if right_pool_mapping_[col] != kInvalidCol, we can reuse it and
   // just apply the last rank one update since it was computed.
   ClearAndResizeVectorWithNonZeros(matrix_.num_rows(), d, non_zeros);
-  lu_factorization_.RightSolveLForSparseColumn(matrix_.column(col), d);
-  rank_one_factorization_.RightSolve(d);
-  right_pool_mapping_[col] = right_storage_.AddDenseColumn(*d);
-  lu_factorization_.RightSolveUWithNonZeros(d, non_zeros);
+  lu_factorization_.RightSolveLForSparseColumn(matrix_.column(col), d,
+                                               non_zeros);
+
+  // The non-zeros of the L solve are only kept if there is no rank one update,
+  // since RankOneUpdateFactorization::RightSolve() is dense.
+  if (rank_one_factorization_.num_entries() > 0) {
+    rank_one_factorization_.RightSolve(d);
+    non_zeros->clear();
+  }
+  right_pool_mapping_[col] =
+      right_storage_.AddDenseColumnWithNonZeros(*d, *non_zeros);
+  lu_factorization_.RightSolveUWithKnownNonZeros(d, non_zeros);
 }
 
 Fractional BasisFactorization::RightSolveSquaredNorm(const SparseColumn& a)
@@ -476,6 +740,31 @@ Fractional BasisFactorization::DualEdgeSquaredNorm(RowIndex row) const {
   return lu_factorization_.DualEdgeSquaredNorm(row);
 }
 
+void BasisFactorization::ComputeDualEdgeSquaredNorms(
+    ParallelFor* parallel_for, DenseColumn* squared_norms) const {
+  SCOPED_TIME_STAT(&stats_);
+  DCHECK(IsRefactorized());
+  const int num_rows = GetNumberOfRows().value();
+  squared_norms->resize(RowIndex(num_rows), 0.0);
+
+  // Same deterministic time as num_rows calls to DualEdgeSquaredNorm().
+  for (int i = 0; i < num_rows; ++i) BumpDeterministicTimeForSolve(1);
+
+  // Each norm costs two triangular solves, so a chunk can be small.
+  const int kMinChunkSize = 16;
+  lu_factorization_.PrepareForConcurrentSolves();
+  dual_edge_scratchpads_.resize(
+      parallel_for->NumChunks(num_rows, kMinChunkSize));
+  parallel_for->Run(num_rows, kMinChunkSize,
+                    [this, squared_norms](int chunk, int begin, int end) {
+    LuFactorization::Scratchpad* scratchpad = &dual_edge_scratchpads_[chunk];
+    for (RowIndex row(begin); row < end; ++row) {
+      (*squared_norms)[row] =
+          lu_factorization_.DualEdgeSquaredNormWithScratchpad(row, scratchpad);
+    }
+  });
+}
+
 bool BasisFactorization::IsIdentityBasis() const {
   const RowIndex num_rows = matrix_.num_rows();
   for (RowIndex row(0); row < num_rows; ++row) {
@@ -572,7 +861,9 @@ void BasisFactorization::BumpDeterministicTimeForSolve(int num_entries) const {
       (1.0 + density) * DeterministicTimeForFpOperations(
                             lu_factorization_.NumberOfEntries().value()) +
       DeterministicTimeForFpOperations(
-          rank_one_factorization_.num_entries().value());
+          rank_one_factorization_.num_entries().value()) +
+      DeterministicTimeForFpOperations(
+          forrest_tomlin_factorization_.num_entries().value());
 }
 
 }  // namespace glop
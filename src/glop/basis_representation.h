@@ -17,6 +17,7 @@
 
 #include "base/logging.h"
 #include "glop/lu_factorization.h"
+#include "glop/parallel_for.h"
 #include "glop/parameters.pb.h"
 #include "glop/rank_one_update.h"
 #include "glop/status.h"
@@ -137,6 +138,81 @@ class EtaFactorization {
   DISALLOW_COPY_AND_ASSIGN(EtaFactorization);
 };
 
+// The Forrest-Tomlin update of the U factor of a LuFactorization.
+//
+// Since B = P^{-1}.L.U.Q, replacing the column j of B by a new column a
+// amounts to replacing the corresponding column of U by the "spike"
+// L^{-1}.P.a, which breaks the triangular structure of U. The Forrest-Tomlin
+// update moves the pivot of this column to the end of the pivot order, and
+// eliminates the off-diagonal entries of its row r with the row eta matrix
+// R = I - e_r.m^T, where the multipliers m only involve the rows that come
+// after r in the pivot order. After k updates, the basis is
+//   B_k = P^{-1}.L.R_1^{-1}. ... .R_k^{-1}.U_k.Q
+// where U_k is upper triangular with respect to the current pivot order.
+//
+// The solves with U_k cost about the same as the solves with U (modulo the
+// fill-in of the spikes) and the row etas are usually very sparse, so the cost
+// of the solves increases a lot slower with the number of updates than with
+// the eta or the middle product form update.
+//
+// The compact TriangularMatrix of LuFactorization can't be modified, so the
+// first update after a refactorization copies U into a column-wise SparseMatrix
+// that is then modified in place.
+class ForrestTomlinFactorization {
+ public:
+  ForrestTomlinFactorization();
+
+  // Forgets all the updates. IsInitialized() will then be false.
+  void Clear();
+
+  // Copies the U factor of the given factorization. Must be called before the
+  // first Update() following a refactorization.
+  void Initialize(const LuFactorization& lu_factorization, RowIndex num_rows);
+  bool IsInitialized() const { return is_initialized_; }
+
+  // Replaces the basis column 'col' by the column a, given by the result of
+  // LuFactorization::RightSolveLForSparseColumn() on a. The spike is modified.
+  // Returns an error if the new pivot is too small, in which case the
+  // factorization is no longer valid and must be recomputed.
+  Status Update(ColIndex col, DenseColumn* spike) MUST_USE_RESULT;
+
+  // Same as LuFactorization::RightSolveU() and LeftSolveU() for the updated
+  // factor R_1^{-1}. ... .R_k^{-1}.U_k.Q.
+  void RightSolveU(DenseColumn* x) const;
+  void LeftSolveU(DenseRow* y) const;
+
+  // The number of entries of U_k and of the row etas.
+  EntryIndex num_entries() const { return num_entries_; }
+
+ private:
+  // Applies the row etas, in the order they were added, to x.
+  void ApplyRowEtas(DenseColumn* x) const;
+
+  bool is_initialized_;
+  RowIndex num_rows_;
+
+  // The columns of U_k.Q, indexed like the basis columns, without their
+  // diagonal coefficient which is stored in diagonal_. The diagonal coefficient
+  // of the column col is in the row pivot_row_[col].
+  SparseMatrix upper_;
+  DenseRow diagonal_;
+  ColToRowMapping pivot_row_;
+
+  // The columns in pivot order, and the position of each column in order_.
+  ColIndexVector order_;
+  StrictITIVector<ColIndex, int> position_;
+
+  // The row etas: the row r_i of eta_rows_ and the multipliers m_i stored in
+  // the column i of eta_multipliers_.
+  std::vector<RowIndex> eta_rows_;
+  SparseMatrix eta_multipliers_;
+
+  EntryIndex num_entries_;
+  mutable DenseColumn scratchpad_;
+
+  DISALLOW_COPY_AND_ASSIGN(ForrestTomlinFactorization);
+};
+
 // A basis factorization is the product of an eta factorization and
 // a L.U decomposition, i.e. B = L.U.E_0.E_1. ... .E_{k-1}
 // It is used to solve two systems:
@@ -153,8 +229,10 @@ class BasisFactorization {
   // Sets the parameters for this component.
   void SetParameters(const GlopParameters& parameters) {
     max_num_updates_ = parameters.basis_refactorization_period();
+    use_forrest_tomlin_update_ = parameters.use_forrest_tomlin_update();
     use_middle_product_form_update_ =
-        parameters.use_middle_product_form_update();
+        parameters.use_middle_product_form_update() &&
+        !use_forrest_tomlin_update_;
     parameters_ = parameters;
     lu_factorization_.SetParameters(parameters);
   }
@@ -243,6 +321,11 @@ class BasisFactorization {
   // It can be called only when IsRefactorized() is true.
   Fractional DualEdgeSquaredNorm(RowIndex row) const;
 
+  // Computes DualEdgeSquaredNorm() for all the rows at once, with the threads
+  // of the given ParallelFor. Same precondition as DualEdgeSquaredNorm().
+  void ComputeDualEdgeSquaredNorms(ParallelFor* parallel_for,
+                                   DenseColumn* squared_norms) const;
+
   // Computes the condition number of B.
   // For a given norm, this is the matrix norm times the norm of its inverse.
   // A condition number greater than 1E7 will lead to precision problems.
@@ -279,6 +362,10 @@ class BasisFactorization {
   // solve and each factorization.
   double DeterministicTime() const;
 
+  // Number of LU factorizations computed by ForceRefactorization() since the
+  // creation of this class.
+  int64 NumRefactorizations() const { return num_refactorizations_; }
+
  private:
   // Return true if the submatrix of matrix_ given by basis_ is exactly the
   // identity (without permutation).
@@ -290,6 +377,19 @@ class BasisFactorization {
   Status MiddleProductFormUpdate(ColIndex entering_col,
                                  RowIndex leaving_variable_row) MUST_USE_RESULT;
 
+  // Updates the factorization using the Forrest-Tomlin update.
+  Status ForrestTomlinUpdate(ColIndex entering_col,
+                             RowIndex leaving_variable_row) MUST_USE_RESULT;
+
+  // Returns true if the solves must use forrest_tomlin_factorization_, i.e. if
+  // the Forrest-Tomlin update is used and the basis was updated since the last
+  // refactorization. Otherwise, the eta factorization is empty and the other
+  // code paths only use the LU factorization.
+  bool UseForrestTomlinSolves() const {
+    return use_forrest_tomlin_update_ &&
+           forrest_tomlin_factorization_.IsInitialized();
+  }
+
   // Increases the deterministic time for a solve operation with a vector having
   // this number of non-zero entries (it can be an approximation).
   void BumpDeterministicTimeForSolve(int num_entries) const;
@@ -317,6 +417,9 @@ class BasisFactorization {
   mutable DenseColumn scratchpad_;
   mutable std::vector<RowIndex> scratchpad_non_zeros_;
 
+  // One scratchpad per chunk of ComputeDualEdgeSquaredNorms().
+  mutable std::vector<LuFactorization::Scratchpad> dual_edge_scratchpads_;
+
   // This is used by RightSolveForTau(). It holds an intermediate result from
   // the last LeftSolveForUnitRow() and also the final result of
   // RightSolveForTau().
@@ -351,9 +454,12 @@ class BasisFactorization {
   mutable ColMapping right_pool_mapping_;
 
   bool use_middle_product_form_update_;
+  bool use_forrest_tomlin_update_;
   int max_num_updates_;
   int num_updates_;
+  int64 num_refactorizations_;
   EtaFactorization eta_factorization_;
+  ForrestTomlinFactorization forrest_tomlin_factorization_;
   LuFactorization lu_factorization_;
 
   // mutable because the Solve() functions are const but need to update this.
@@ -18,8 +18,10 @@
 namespace operations_research {
 namespace glop {
 
-DualEdgeNorms::DualEdgeNorms(const BasisFactorization& basis_factorization)
+DualEdgeNorms::DualEdgeNorms(const BasisFactorization& basis_factorization,
+                             ParallelFor* parallel_for)
     : basis_factorization_(basis_factorization),
+      parallel_for_(parallel_for),
       recompute_edge_squared_norms_(true) {}
 
 bool DualEdgeNorms::NeedsBasisRefactorization() {
@@ -33,6 +35,16 @@ const DenseColumn& DualEdgeNorms::GetEdgeSquaredNorms() {
   return edge_squared_norms_;
 }
 
+const DenseColumn* DualEdgeNorms::GetEdgeSquaredNormsIfValid() const {
+  return recompute_edge_squared_norms_ ? nullptr : &edge_squared_norms_;
+}
+
+void DualEdgeNorms::SetEdgeSquaredNorms(const DenseColumn& edge_squared_norms) {
+  DCHECK_EQ(edge_squared_norms.size(), basis_factorization_.GetNumberOfRows());
+  edge_squared_norms_ = edge_squared_norms;
+  recompute_edge_squared_norms_ = false;
+}
+
 void DualEdgeNorms::UpdateDataOnBasisPermutation(
     const ColumnPermutation& col_perm) {
   if (recompute_edge_squared_norms_) return;
@@ -103,11 +115,8 @@ void DualEdgeNorms::ComputeEdgeSquaredNorms() {
   // Since we will do a lot of inversions, it is better to be as efficient and
   // precise as possible by having a refactorized basis.
   DCHECK(basis_factorization_.IsRefactorized());
-  const RowIndex num_rows = basis_factorization_.GetNumberOfRows();
-  edge_squared_norms_.resize(num_rows, 0.0);
-  for (RowIndex row(0); row < num_rows; ++row) {
-    edge_squared_norms_[row] = basis_factorization_.DualEdgeSquaredNorm(row);
-  }
+  basis_factorization_.ComputeDualEdgeSquaredNorms(parallel_for_,
+                                                   &edge_squared_norms_);
   recompute_edge_squared_norms_ = false;
 }
 
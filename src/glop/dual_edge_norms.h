@@ -15,6 +15,7 @@
 #define OR_TOOLS_GLOP_DUAL_EDGE_NORMS_H_
 
 #include "glop/basis_representation.h"
+#include "glop/parallel_for.h"
 #include "glop/parameters.pb.h"
 #include "lp_data/lp_data.h"
 #include "lp_data/lp_types.h"
@@ -44,8 +45,10 @@ namespace glop {
 // http://digital.ub.uni-paderborn.de/hs/download/pdf/3885?originalFilename=true
 class DualEdgeNorms {
  public:
-  // Takes references to the linear program data we need.
-  explicit DualEdgeNorms(const BasisFactorization& basis_factorization);
+  // Takes references to the linear program data we need. The norms are
+  // recomputed from scratch with the threads of parallel_for.
+  DualEdgeNorms(const BasisFactorization& basis_factorization,
+                ParallelFor* parallel_for);
 
   // Clears, i.e. reset the object to its initial value. This will trigger a
   // full norm recomputation on the next GetEdgeSquaredNorms().
@@ -62,6 +65,15 @@ class DualEdgeNorms {
   // called Clear().
   const DenseColumn& GetEdgeSquaredNorms();
 
+  // Returns the current norms without recomputing them, or nullptr if they
+  // need to be recomputed. Used to save them in a BasisState.
+  const DenseColumn* GetEdgeSquaredNormsIfValid() const;
+
+  // Sets the norms, for instance to the ones saved with a basis that is
+  // loaded again. They must correspond to the current basis; they will be
+  // updated incrementally from there instead of being recomputed.
+  void SetEdgeSquaredNorms(const DenseColumn& edge_squared_norms);
+
   // Updates the norms if the columns of the basis where permuted.
   void UpdateDataOnBasisPermutation(const ColumnPermutation& col_perm);
 
@@ -111,6 +123,7 @@ class DualEdgeNorms {
 
   // Problem data that should be updated from outside.
   const BasisFactorization& basis_factorization_;
+  ParallelFor* parallel_for_;
 
   // The dual edge norms.
   DenseColumn edge_squared_norms_;
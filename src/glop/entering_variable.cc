@@ -14,6 +14,7 @@
 
 #include "glop/entering_variable.h"
 
+#include <algorithm>
 #include <queue>
 
 #include "base/timer.h"
@@ -34,14 +35,17 @@ std::string GlopParameters_PricingRule_Name(int rule) {
 EnteringVariable::EnteringVariable(const VariablesInfo& variables_info,
                                    RandomBase* random,
                                    ReducedCosts* reduced_costs,
-                                   PrimalEdgeNorms* primal_edge_norms)
+                                   PrimalEdgeNorms* primal_edge_norms,
+                                   ParallelFor* parallel_for)
     : variables_info_(variables_info),
       random_(random),
       reduced_costs_(reduced_costs),
       primal_edge_norms_(primal_edge_norms),
+      parallel_for_(parallel_for),
       parameters_(),
       rule_(GlopParameters::DANTZIG),
-      unused_columns_() {}
+      unused_columns_(),
+      next_partial_pricing_block_(0) {}
 
 Status EnteringVariable::PrimalChooseEnteringColumn(ColIndex* entering_col) {
   SCOPED_TIME_STAT(&stats_);
@@ -52,6 +56,11 @@ Status EnteringVariable::PrimalChooseEnteringColumn(ColIndex* entering_col) {
   const bool kNested = true;
   const bool kSteepest = true;
 
+  if (parameters_.use_partial_pricing()) {
+    PartialChooseEnteringColumn(entering_col);
+    return Status::OK;
+  }
+
   switch (rule_) {
     case GlopParameters::DANTZIG:
       if (parameters_.use_nested_pricing()) {
@@ -203,6 +212,14 @@ Status EnteringVariable::DualChooseEnteringColumn(
   Fractional best_coeff = -1.0;
   Fractional variation_magnitude = fabs(cost_variation);
   equivalent_entering_choices_.clear();
+
+  // Best candidate among the breakpoints processed before the last bound flip,
+  // and the number of bound flips that were done before it. See below.
+  ColIndex fallback_col = kInvalidCol;
+  Fractional fallback_coeff = -1.0;
+  Fractional fallback_step = 0.0;
+  int fallback_num_flips = 0;
+  int entering_num_flips = 0;
   while (!breakpoints.empty()) {
     const ColWithRatio top = breakpoints.front();
     if (top.ratio > harris_ratio) break;
@@ -224,22 +241,45 @@ Status EnteringVariable::DualChooseEnteringColumn(
           variables_info_.GetBoundDifference(top.col) * top.coeff_magnitude;
       if (variation_magnitude > threshold) {
         variable_can_flip = true;
-        bound_flip_candidates->push_back(top.col);
       }
     }
 
-    // Update harris_ratio (only if the variable cannot flip).
-    if (!variable_can_flip) {
-      harris_ratio =
-          std::min(harris_ratio, top.ratio + harris_tolerance / top.coeff_magnitude);
-
-      // If the dual infeasibility is too high, the harris_ratio can be
-      // negative. In this case we set it to 0.0, allowing any infeasible
-      // position to enter the basis. This is quite important because its helps
-      // in the choice of a stable pivot.
-      harris_ratio = std::max(harris_ratio, 0.0);
+    // This is a long step: the objective still improves after the flip, so
+    // the step will be at least top.ratio and the candidates processed so far
+    // (top included) can no longer enter the basis. We remember the best of
+    // them in case the candidates after the flips are all bad pivots.
+    if (variable_can_flip) {
+      if (best_coeff > fallback_coeff) {
+        fallback_col = *entering_col;
+        fallback_coeff = best_coeff;
+        fallback_step = *step;
+        fallback_num_flips = entering_num_flips;
+      }
+      if (top.coeff_magnitude > fallback_coeff) {
+        fallback_col = top.col;
+        fallback_coeff = top.coeff_magnitude;
+        fallback_step = top.ratio;
+        fallback_num_flips = bound_flip_candidates->size();
+      }
+      bound_flip_candidates->push_back(top.col);
+      *entering_col = kInvalidCol;
+      best_coeff = -1.0;
+      equivalent_entering_choices_.clear();
+      std::pop_heap(breakpoints.begin(), breakpoints.end());
+      breakpoints.pop_back();
+      continue;
     }
 
+    // Update harris_ratio (only if the variable cannot flip).
+    harris_ratio = std::min(harris_ratio,
+                            top.ratio + harris_tolerance / top.coeff_magnitude);
+
+    // If the dual infeasibility is too high, the harris_ratio can be
+    // negative. In this case we set it to 0.0, allowing any infeasible
+    // position to enter the basis. This is quite important because its helps
+    // in the choice of a stable pivot.
+    harris_ratio = std::max(harris_ratio, 0.0);
+
     // TODO(user): We want to maximize both the ratio (objective improvement)
     // and the coeff_magnitude (stable pivot), so we have to make some
     // trade-offs.
@@ -251,6 +291,7 @@ Status EnteringVariable::DualChooseEnteringColumn(
         equivalent_entering_choices_.clear();
         best_coeff = top.coeff_magnitude;
         *entering_col = top.col;
+        entering_num_flips = bound_flip_candidates->size();
 
         // Note that the step is not directly used, so it is okay to leave it
         // negative.
@@ -264,6 +305,21 @@ Status EnteringVariable::DualChooseEnteringColumn(
     breakpoints.pop_back();
   }
 
+  // Shorten the step if it is needed to get a stable pivot, or if all the
+  // breakpoints could be flipped. In the latter case, we do not report an
+  // unbounded dual since the processed breakpoints can still enter the basis.
+  if (fallback_col != kInvalidCol &&
+      (*entering_col == kInvalidCol ||
+       (best_coeff < parameters_.dual_small_pivot_threshold() &&
+        fallback_coeff > best_coeff))) {
+    *entering_col = fallback_col;
+    *step = fallback_step;
+    bound_flip_candidates->resize(fallback_num_flips);
+    equivalent_entering_choices_.clear();
+  }
+  IF_STATS_ENABLED(
+      stats_.num_bound_flips.Add(bound_flip_candidates->size()));
+
   // Break the ties randomly.
   if (!equivalent_entering_choices_.empty()) {
     equivalent_entering_choices_.push_back(*entering_col);
@@ -432,6 +488,101 @@ DenseBitRow* EnteringVariable::ResetUnusedColumns() {
   return &unused_columns_;
 }
 
+void EnteringVariable::PartialChooseEnteringColumn(ColIndex* entering_col) {
+  const DenseRow& reduced_costs = reduced_costs_->GetReducedCosts();
+  const DenseRow* weights = nullptr;
+  bool squared = false;
+  switch (rule_) {
+    case GlopParameters::DANTZIG:
+      if (parameters_.normalize_using_column_norm()) {
+        weights = &primal_edge_norms_->GetMatrixColumnNorms();
+      }
+      break;
+    case GlopParameters::STEEPEST_EDGE:
+      // Note that here the weights are squared.
+      weights = &primal_edge_norms_->GetEdgeSquaredNorms();
+      squared = true;
+      break;
+    case GlopParameters::DEVEX:
+      weights = &primal_edge_norms_->GetDevexWeights();
+      break;
+  }
+  SCOPED_TIME_STAT(&stats_);
+  const auto price = [&reduced_costs, weights, squared](ColIndex col) {
+    const Fractional cost =
+        squared ? Square(reduced_costs[col]) : fabs(reduced_costs[col]);
+    return weights == nullptr ? cost : cost / (*weights)[col];
+  };
+
+  const ColIndex num_cols = variables_info_.GetNumberOfColumns();
+  if (is_partial_pricing_candidate_.size() != num_cols) {
+    partial_pricing_candidates_.clear();
+    is_partial_pricing_candidate_.ClearAndResize(num_cols);
+    next_partial_pricing_block_ = ColIndex(0);
+  }
+
+  // Drop the candidates that became dual feasible. The reduced costs, and thus
+  // the dual infeasible positions, are maintained by reduced_costs_.
+  const DenseBitRow& is_dual_infeasible =
+      reduced_costs_->GetDualInfeasiblePositions();
+  int num_kept = 0;
+  for (const ColIndex col : partial_pricing_candidates_) {
+    if (is_dual_infeasible.IsSet(col)) {
+      partial_pricing_candidates_[num_kept++] = col;
+    } else {
+      is_partial_pricing_candidate_.Clear(col);
+    }
+  }
+  partial_pricing_candidates_.resize(num_kept);
+
+  // Scan the next block, and the following ones while there is no candidate.
+  // Once all the columns were scanned, an empty list means that there is no
+  // dual infeasible column.
+  const ColIndex block_size(
+      std::max(1, parameters_.partial_pricing_block_size()));
+  ColIndex num_scanned(0);
+  while (num_scanned < num_cols &&
+         (num_scanned == 0 || partial_pricing_candidates_.empty())) {
+    const ColIndex begin = next_partial_pricing_block_;
+    const ColIndex end = std::min(begin + block_size, num_cols);
+    for (ColIndex col = begin; col < end; ++col) {
+      if (is_dual_infeasible.IsSet(col) &&
+          !is_partial_pricing_candidate_.IsSet(col)) {
+        partial_pricing_candidates_.push_back(col);
+        is_partial_pricing_candidate_.Set(col);
+      }
+    }
+    num_scanned += end - begin;
+    next_partial_pricing_block_ = end == num_cols ? ColIndex(0) : end;
+  }
+
+  // Only keep the best candidates.
+  const int max_size =
+      std::max(1, parameters_.partial_pricing_candidate_list_size());
+  if (partial_pricing_candidates_.size() > max_size) {
+    std::nth_element(partial_pricing_candidates_.begin(),
+                     partial_pricing_candidates_.begin() + max_size,
+                     partial_pricing_candidates_.end(),
+                     [&price](ColIndex a, ColIndex b) {
+                       return price(a) > price(b);
+                     });
+    for (int i = max_size; i < partial_pricing_candidates_.size(); ++i) {
+      is_partial_pricing_candidate_.Clear(partial_pricing_candidates_[i]);
+    }
+    partial_pricing_candidates_.resize(max_size);
+  }
+
+  Fractional best_price(0.0);
+  *entering_col = kInvalidCol;
+  for (const ColIndex col : partial_pricing_candidates_) {
+    const Fractional col_price = price(col);
+    if (*entering_col == kInvalidCol || col_price > best_price) {
+      best_price = col_price;
+      *entering_col = col;
+    }
+  }
+}
+
 template <bool normalize, bool nested_pricing>
 void EnteringVariable::DantzigChooseEnteringColumn(ColIndex* entering_col) {
   DenseRow dummy;
@@ -466,6 +617,11 @@ void EnteringVariable::DantzigChooseEnteringColumn(ColIndex* entering_col) {
 //   the other parts of the simplex algorithm.
 template <bool use_steepest_edge>
 void EnteringVariable::NormalizedChooseEnteringColumn(ColIndex* entering_col) {
+  if (parallel_for_->NumChunks(variables_info_.GetNumberOfColumns().value()) >
+      1) {
+    ParallelNormalizedChooseEnteringColumn<use_steepest_edge>(entering_col);
+    return;
+  }
   const DenseRow& weights = use_steepest_edge
                                 ? primal_edge_norms_->GetEdgeSquaredNorms()
                                 : primal_edge_norms_->GetDevexWeights();
@@ -511,5 +667,50 @@ void EnteringVariable::NormalizedChooseEnteringColumn(ColIndex* entering_col) {
   }
 }
 
+template <bool use_steepest_edge>
+void EnteringVariable::ParallelNormalizedChooseEnteringColumn(
+    ColIndex* entering_col) {
+  const DenseRow& weights = use_steepest_edge
+                                ? primal_edge_norms_->GetEdgeSquaredNorms()
+                                : primal_edge_norms_->GetDevexWeights();
+  const DenseRow& reduced_costs = reduced_costs_->GetReducedCosts();
+  SCOPED_TIME_STAT(&stats_);
+
+  const DenseBitRow& candidates = reduced_costs_->GetDualInfeasiblePositions();
+  const int num_cols = candidates.size().value();
+  const int num_chunks = parallel_for_->NumChunks(num_cols);
+  std::vector<Fractional> chunk_best_price(num_chunks, 0.0);
+  std::vector<ColIndex> chunk_best_col(num_chunks, kInvalidCol);
+  parallel_for_->Run(num_cols, [&](int chunk, int begin, int end) {
+    Fractional best_price(0.0);
+    ColIndex best_col = kInvalidCol;
+    for (ColIndex col(begin); col < ColIndex(end); ++col) {
+      if (!candidates.IsSet(col)) continue;
+
+      // Note that for the steepest edge, the weights are squared.
+      const Fractional price =
+          use_steepest_edge ? Square(reduced_costs[col]) / weights[col]
+                            : fabs(reduced_costs[col]) / weights[col];
+      if (best_col == kInvalidCol || price > best_price) {
+        best_price = price;
+        best_col = col;
+      }
+    }
+    chunk_best_price[chunk] = best_price;
+    chunk_best_col[chunk] = best_col;
+  });
+
+  // The chunks are ordered, so this keeps the smallest column among the ties.
+  Fractional best_price(0.0);
+  *entering_col = kInvalidCol;
+  for (int chunk = 0; chunk < num_chunks; ++chunk) {
+    if (chunk_best_col[chunk] == kInvalidCol) continue;
+    if (*entering_col == kInvalidCol || chunk_best_price[chunk] > best_price) {
+      best_price = chunk_best_price[chunk];
+      *entering_col = chunk_best_col[chunk];
+    }
+  }
+}
+
 }  // namespace glop
 }  // namespace operations_research
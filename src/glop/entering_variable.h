@@ -19,6 +19,7 @@
 #include "glop/primal_edge_norms.h"
 #include "glop/reduced_costs.h"
 #include "glop/update_row.h"
+#include "glop/parallel_for.h"
 #include "glop/variables_info.h"
 #include "glop/status.h"
 #include "lp_data/lp_data.h"
@@ -52,10 +53,12 @@ namespace glop {
 //   http://www.optimization-online.org/DB_FILE/2007/10/1810.pdf
 class EnteringVariable {
  public:
-  // Takes references to the linear program data we need.
+  // Takes references to the linear program data we need. The steepest edge
+  // and devex pricing of large problems are run by parallel_for.
   EnteringVariable(const VariablesInfo& variables_info, RandomBase* random,
                    ReducedCosts* reduced_costs,
-                   PrimalEdgeNorms* primal_edge_norms);
+                   PrimalEdgeNorms* primal_edge_norms,
+                   ParallelFor* parallel_for);
 
   // Returns the index of a valid primal entering column (see
   // IsValidPrimalEnteringCandidate() for more details) or kInvalidCol if no
@@ -99,6 +102,10 @@ class EnteringVariable {
   DenseBitRow* ResetUnusedColumns();
 
  private:
+  // Partial pricing with a candidate list, see use_partial_pricing in
+  // parameters.proto. The price of a column depends on the current rule.
+  void PartialChooseEnteringColumn(ColIndex* entering_col);
+
   // Dantzig selection rule: choose the variable with the best reduced cost.
   // If normalize is true, we normalize the costs by the column norms.
   // If nested_pricing is true, we use nested pricing (see parameters.proto).
@@ -111,12 +118,20 @@ class EnteringVariable {
   template <bool use_steepest_edge>
   void NormalizedChooseEnteringColumn(ColIndex* entering_col);
 
+  // Parallel version of NormalizedChooseEnteringColumn(), used when the
+  // problem has enough columns for parallel_for_ to use more than one chunk.
+  // Each chunk of columns finds its best candidate, and the ties are broken
+  // by taking the smallest column index instead of randomly.
+  template <bool use_steepest_edge>
+  void ParallelNormalizedChooseEnteringColumn(ColIndex* entering_col);
+
   // Problem data that should be updated from outside.
   const VariablesInfo& variables_info_;
 
   RandomBase* random_;
   ReducedCosts* reduced_costs_;
   PrimalEdgeNorms* primal_edge_norms_;
+  ParallelFor* parallel_for_;
 
   // Internal data.
   GlopParameters parameters_;
@@ -126,8 +141,10 @@ class EnteringVariable {
   struct Stats : public StatsGroup {
     Stats()
         : StatsGroup("EnteringVariable"),
-          num_perfect_ties("num_perfect_ties", this) {}
+          num_perfect_ties("num_perfect_ties", this),
+          num_bound_flips("num_bound_flips", this) {}
     IntegerDistribution num_perfect_ties;
+    IntegerDistribution num_bound_flips;
   };
   Stats stats_;
 
@@ -136,6 +153,13 @@ class EnteringVariable {
   // entering the basis.
   DenseBitRow unused_columns_;
 
+  // Used by the partial pricing. The candidate columns kept across the
+  // iterations, the same set as a bit row, and the first column of the next
+  // block to scan.
+  std::vector<ColIndex> partial_pricing_candidates_;
+  DenseBitRow is_partial_pricing_candidate_;
+  ColIndex next_partial_pricing_block_;
+
   // Temporary vector used to hold the best entering column candidates that are
   // tied using the current choosing criteria. We actually only store the tied
   // candidate #2, #3, ...; because the first tied candidate is remembered
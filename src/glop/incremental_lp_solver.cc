@@ -0,0 +1,139 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "glop/incremental_lp_solver.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace operations_research {
+namespace glop {
+
+IncrementalLPSolver::IncrementalLPSolver()
+    : parameters_(),
+      lp_(),
+      scaler_(),
+      cost_scaling_factor_(1.0),
+      matrix_changed_since_last_solve_(true),
+      revised_simplex_(),
+      status_(ProblemStatus::INIT) {}
+
+void IncrementalLPSolver::SetParameters(const GlopParameters& parameters) {
+  parameters_ = parameters;
+  parameters_.set_allow_simplex_algorithm_change(true);
+  revised_simplex_.SetParameters(parameters_);
+}
+
+void IncrementalLPSolver::Load(const LinearProgram& lp) {
+  DCHECK(lp.IsCleanedUp());
+  lp_.PopulateFromLinearProgram(lp);
+  lp_.ClearTransposeMatrix();
+
+  // Same scaling as the ScalingPreprocessor, except that the scaling factors
+  // are kept to scale the future modifications.
+  scaler_.Clear();
+  cost_scaling_factor_ = 1.0;
+  if (parameters_.use_scaling()) {
+    scaler_.set_num_threads(parameters_.num_omp_threads());
+    lp_.Scale(&scaler_);
+    Fractional max_cost_magnitude = 0.0;
+    for (ColIndex col(0); col < lp_.num_variables(); ++col) {
+      max_cost_magnitude = std::max(
+          max_cost_magnitude, std::abs(lp_.objective_coefficients()[col]));
+    }
+    if (max_cost_magnitude > 0.0) {
+      cost_scaling_factor_ = max_cost_magnitude;
+      for (ColIndex col(0); col < lp_.num_variables(); ++col) {
+        lp_.SetObjectiveCoefficient(
+            col, lp_.objective_coefficients()[col] / cost_scaling_factor_);
+      }
+      lp_.SetObjectiveScalingFactor(lp_.objective_scaling_factor() *
+                                    cost_scaling_factor_);
+      lp_.SetObjectiveOffset(lp_.objective_offset() / cost_scaling_factor_);
+    }
+  }
+  matrix_changed_since_last_solve_ = true;
+  revised_simplex_.ClearStateForNextSolve();
+  status_ = ProblemStatus::INIT;
+}
+
+// Note that the scaled variable is x / col_scale and the scaled constraint is
+// the row divided by row_scale. See ScalingPreprocessor::RecoverSolution().
+void IncrementalLPSolver::SetVariableBounds(ColIndex col,
+                                            Fractional lower_bound,
+                                            Fractional upper_bound) {
+  const Fractional scale = scaler_.col_scale(col);
+  lp_.SetVariableBounds(col, lower_bound * scale, upper_bound * scale);
+}
+
+void IncrementalLPSolver::SetConstraintBounds(RowIndex row,
+                                              Fractional lower_bound,
+                                              Fractional upper_bound) {
+  DCHECK_LT(row, lp_.num_constraints());
+  const Fractional scale = scaler_.row_scale(row);
+  lp_.SetConstraintBounds(row, lower_bound / scale, upper_bound / scale);
+}
+
+void IncrementalLPSolver::SetObjectiveCoefficient(ColIndex col,
+                                                  Fractional value) {
+  lp_.SetObjectiveCoefficient(
+      col, value / (scaler_.col_scale(col) * cost_scaling_factor_));
+}
+
+ProblemStatus IncrementalLPSolver::Solve(TimeLimit* time_limit) {
+  if (!matrix_changed_since_last_solve_) {
+    revised_simplex_.NotifyThatMatrixIsUnchangedForNextSolve();
+  }
+  matrix_changed_since_last_solve_ = false;
+  revised_simplex_.SetParameters(parameters_);
+  if (!revised_simplex_.Solve(lp_, time_limit).ok()) {
+    VLOG(1) << "Error during the revised simplex algorithm.";
+    status_ = ProblemStatus::ABNORMAL;
+    return status_;
+  }
+  status_ = revised_simplex_.GetProblemStatus();
+  return status_;
+}
+
+Fractional IncrementalLPSolver::GetObjectiveValue() const {
+  return revised_simplex_.GetObjectiveValue();
+}
+
+Fractional IncrementalLPSolver::GetVariableValue(ColIndex col) const {
+  return revised_simplex_.GetVariableValue(col) / scaler_.col_scale(col);
+}
+
+Fractional IncrementalLPSolver::GetReducedCost(ColIndex col) const {
+  return revised_simplex_.GetReducedCost(col) * scaler_.col_scale(col) *
+         cost_scaling_factor_;
+}
+
+Fractional IncrementalLPSolver::GetDualValue(RowIndex row) const {
+  return revised_simplex_.GetDualValue(row) / scaler_.row_scale(row) *
+         cost_scaling_factor_;
+}
+
+VariableStatus IncrementalLPSolver::GetVariableStatus(ColIndex col) const {
+  return revised_simplex_.GetVariableStatus(col);
+}
+
+ConstraintStatus IncrementalLPSolver::GetConstraintStatus(RowIndex row) const {
+  return revised_simplex_.GetConstraintStatus(row);
+}
+
+int64 IncrementalLPSolver::GetNumberOfSimplexIterations() const {
+  return revised_simplex_.GetNumberOfIterations();
+}
+
+}  // namespace glop
+}  // namespace operations_research
@@ -0,0 +1,98 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OR_TOOLS_GLOP_INCREMENTAL_LP_SOLVER_H_
+#define OR_TOOLS_GLOP_INCREMENTAL_LP_SOLVER_H_
+
+#include "base/logging.h"
+#include "glop/parameters.pb.h"
+#include "glop/revised_simplex.h"
+#include "lp_data/lp_data.h"
+#include "lp_data/lp_types.h"
+#include "lp_data/matrix_scaler.h"
+#include "util/time_limit.h"
+
+namespace operations_research {
+namespace glop {
+
+// An LP solver for a sequence of linear programs that only differ by their
+// bounds and objective, like the master problems of a column generation or
+// the nodes of a branch and bound.
+//
+// Contrary to LPSolver::Solve(), which copies, preprocesses and scales the
+// given problem at each call, the linear program is copied and scaled only
+// once by Load(). The modifications are then applied directly to the scaled
+// copy, and Solve() resumes the revised simplex from the last basis (and
+// factorization) without any preprocessing or postsolve. If only the bounds
+// changed, this is done with the dual simplex. If only the objective changed,
+// this is done with the primal simplex.
+//
+// Note that since there is no preprocessing, the solution is not checked with
+// respect to the unscaled problem like LPSolver does, and infeasible or
+// unbounded problems are less likely to be detected quickly.
+class IncrementalLPSolver {
+ public:
+  IncrementalLPSolver();
+
+  // Sets the solver parameters. The preprocessing parameters are ignored and
+  // allow_simplex_algorithm_change is always considered to be true.
+  void SetParameters(const GlopParameters& parameters);
+
+  // Copies and scales the given linear program, which must be cleaned up (see
+  // LinearProgram::CleanUp()). The next Solve() starts from scratch.
+  void Load(const LinearProgram& lp);
+
+  // Modifies the loaded linear program. These are O(1) and can be called
+  // any number of times between two Solve().
+  void SetVariableBounds(ColIndex col, Fractional lower_bound,
+                         Fractional upper_bound);
+  void SetConstraintBounds(RowIndex row, Fractional lower_bound,
+                           Fractional upper_bound);
+  void SetObjectiveCoefficient(ColIndex col, Fractional value);
+
+  // Solves the current linear program, warm-started from the solution of the
+  // last Solve() if any.
+  ProblemStatus Solve(TimeLimit* time_limit) MUST_USE_RESULT;
+
+  // Getters for the solution of the last Solve(), in terms of the unscaled
+  // linear program.
+  Fractional GetObjectiveValue() const;
+  Fractional GetVariableValue(ColIndex col) const;
+  Fractional GetReducedCost(ColIndex col) const;
+  Fractional GetDualValue(RowIndex row) const;
+  VariableStatus GetVariableStatus(ColIndex col) const;
+  ConstraintStatus GetConstraintStatus(RowIndex row) const;
+  int64 GetNumberOfSimplexIterations() const;
+
+ private:
+  GlopParameters parameters_;
+
+  // The scaled copy of the loaded linear program, and its scaling factors.
+  // The objective is also divided by cost_scaling_factor_.
+  LinearProgram lp_;
+  SparseMatrixScaler scaler_;
+  Fractional cost_scaling_factor_;
+
+  // Whether the matrix of lp_ changed since the last Solve().
+  bool matrix_changed_since_last_solve_;
+
+  RevisedSimplex revised_simplex_;
+  ProblemStatus status_;
+
+  DISALLOW_COPY_AND_ASSIGN(IncrementalLPSolver);
+};
+
+}  // namespace glop
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_GLOP_INCREMENTAL_LP_SOLVER_H_
@@ -26,6 +26,7 @@ InitialBasis::InitialBasis(const MatrixView& matrix, const DenseRow& objective,
                            const DenseRow& upper_bound,
                            const VariableTypeRow& variable_type)
     : max_scaled_abs_cost_(0.0),
+      column_scores_(nullptr),
       bixby_column_comparator_(*this),
       triangular_column_comparator_(*this),
       matrix_(matrix),
@@ -98,17 +99,27 @@ void InitialBasis::CompleteBixbyBasis(ColIndex num_cols,
 
 bool InitialBasis::CompleteTriangularPrimalBasis(ColIndex num_cols,
                                                  RowToColMapping* basis) {
-  return CompleteTriangularBasis<false>(num_cols, basis);
+  return CompleteTriangularBasis<false>(num_cols, nullptr, basis);
 }
 
 bool InitialBasis::CompleteTriangularDualBasis(ColIndex num_cols,
                                                RowToColMapping* basis) {
-  return CompleteTriangularBasis<true>(num_cols, basis);
+  return CompleteTriangularBasis<true>(num_cols, nullptr, basis);
+}
+
+bool InitialBasis::CompleteTriangularBasisFromScores(ColIndex num_cols,
+                                                     const DenseRow& scores,
+                                                     RowToColMapping* basis) {
+  DCHECK_LE(num_cols, scores.size());
+  return CompleteTriangularBasis<false>(num_cols, &scores, basis);
 }
 
 template <bool only_allow_zero_cost_column>
 bool InitialBasis::CompleteTriangularBasis(ColIndex num_cols,
+                                           const DenseRow* column_scores,
                                            RowToColMapping* basis) {
+  column_scores_ = column_scores;
+
   // Initialize can_be_replaced.
   const RowIndex num_rows = matrix_.num_rows();
   DenseBooleanColumn can_be_replaced(num_rows, false);
@@ -125,6 +136,7 @@ bool InitialBasis::CompleteTriangularBasis(ColIndex num_cols,
   residual_pattern.Reset(num_rows, num_cols);
   for (ColIndex col(0); col < num_cols; ++col) {
     if (only_allow_zero_cost_column && objective_[col] != 0.0) continue;
+    if (column_scores != nullptr && (*column_scores)[col] <= 0.0) continue;
     for (const SparseColumn::Entry e : matrix_.column(col)) {
       if (can_be_replaced[e.row()]) {
         residual_pattern.AddEntry(e.row(), col);
@@ -178,7 +190,11 @@ bool InitialBasis::CompleteTriangularBasis(ColIndex num_cols,
         break;
       }
     }
-    const Fractional kStabilityThreshold = 0.01;
+    // The bases built from scores usually contain many more structural
+    // columns and the matrix may not be scaled, so a larger threshold is
+    // needed to avoid a too large growth of the basis inverse.
+    const Fractional kStabilityThreshold =
+        column_scores == nullptr ? 0.01 : 0.5;
     if (fabs(coeff) < kStabilityThreshold * max_magnitude) continue;
     DCHECK_NE(kInvalidRow, row);
 
@@ -203,6 +219,7 @@ bool InitialBasis::CompleteTriangularBasis(ColIndex num_cols,
     }
   }
 
+  column_scores_ = nullptr;
   return fabs(partial_diagonal_product) >= kMinimumProductMagnitude;
 }
 
@@ -275,6 +292,10 @@ bool InitialBasis::BixbyColumnComparator::operator()(ColIndex col_a,
 bool InitialBasis::TriangularColumnComparator::operator()(
     ColIndex col_a, ColIndex col_b) const {
   if (col_a == col_b) return false;
+  const DenseRow* scores = initial_basis_.column_scores_;
+  if (scores != nullptr && (*scores)[col_a] != (*scores)[col_b]) {
+    return (*scores)[col_a] < (*scores)[col_b];
+  }
   const int category_a = initial_basis_.GetColumnCategory(col_a);
   const int category_b = initial_basis_.GetColumnCategory(col_b);
   if (category_a != category_b) {
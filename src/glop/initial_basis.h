@@ -65,6 +65,16 @@ class InitialBasis {
   bool CompleteTriangularPrimalBasis(ColIndex num_cols, RowToColMapping* basis);
   bool CompleteTriangularDualBasis(ColIndex num_cols, RowToColMapping* basis);
 
+  // Similar to CompleteTriangularPrimalBasis() but the candidate columns are
+  // the ones with a positive score, and they are considered by decreasing
+  // score instead of by category. The Bixby ordering is only used to break
+  // ties. This is used to crash a basis out of an approximate solution, the
+  // score of a column measuring how likely it is to be basic in an optimal
+  // basis. The scores are indexed by the columns of A.
+  bool CompleteTriangularBasisFromScores(ColIndex num_cols,
+                                         const DenseRow& scores,
+                                         RowToColMapping* basis);
+
   // Visible for testing. Computes a list of candidate column indices out of the
   // fist num_candidate_columns of A and sorts them using the
   // bixby_column_comparator_. This also fills max_scaled_abs_cost_.
@@ -72,9 +82,13 @@ class InitialBasis {
                          std::vector<ColIndex>* candidates);
 
  private:
-  // Internal implementation of the Primal/Dual CompleteTriangularBasis().
+  // Internal implementation of the Primal/Dual CompleteTriangularBasis(). If
+  // column_scores is not null, only the columns with a positive score are
+  // candidates and they are ordered by score first.
   template <bool only_allow_zero_cost_column>
-  bool CompleteTriangularBasis(ColIndex num_cols, RowToColMapping* basis);
+  bool CompleteTriangularBasis(ColIndex num_cols,
+                               const DenseRow* column_scores,
+                               RowToColMapping* basis);
 
   // Returns an integer representing the order (the lower the better)
   // between column categories (known as C2, C3 or C4 in the paper).
@@ -89,6 +103,10 @@ class InitialBasis {
   // entering candidates. This is used by GetColumnPenalty().
   Fractional max_scaled_abs_cost_;
 
+  // The scores of the current CompleteTriangularBasisFromScores() call, or
+  // nullptr. This is used by the TriangularColumnComparator.
+  const DenseRow* column_scores_;
+
   // Comparator used to sort column indices according to their penalty.
   // Lower is better.
   struct BixbyColumnComparator {
@@ -0,0 +1,657 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "glop/interior_point.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <utility>
+
+namespace operations_research {
+namespace glop {
+
+namespace {
+// Pivots of the Cholesky factorization smaller than this times the largest
+// diagonal entry of N are replaced by kHugePivot.
+const Fractional kPivotTolerance = 1e-20;
+const Fractional kHugePivot = 1e128;
+
+// Regularization added to the inverse of the entries of D. Without it, the
+// free variables would have an infinite entry.
+const Fractional kPrimalRegularization = 1e-10;
+
+// The variables never get closer than this to their bounds.
+const Fractional kMinGap = 1e-300;
+
+// Fraction of the maximum step to the boundary taken by the corrector.
+const Fractional kStepFactor = 0.995;
+
+// The iterates whose values become larger than this are considered as
+// diverging, which usually means that the problem is infeasible or unbounded.
+const Fractional kDivergenceThreshold = 1e30;
+}  // namespace
+
+// --------------------------------------------------------
+// NormalMatrixCholesky
+// --------------------------------------------------------
+
+NormalMatrixCholesky::NormalMatrixCholesky()
+    : matrix_(nullptr), num_rows_(0), num_dropped_pivots_(0) {}
+
+void NormalMatrixCholesky::Initialize(const SparseMatrix& matrix,
+                                      const std::vector<bool>& is_column_used) {
+  matrix_ = &matrix;
+  num_rows_ = matrix.num_rows().value();
+  const ColIndex num_cols = matrix.num_cols();
+
+  // Row-wise copy of the used columns.
+  row_start_.assign(num_rows_ + 1, 0);
+  for (ColIndex col(0); col < num_cols; ++col) {
+    if (!is_column_used[col.value()]) continue;
+    for (const SparseColumn::Entry e : matrix.column(col)) {
+      ++row_start_[e.row().value() + 1];
+    }
+  }
+  for (int row = 0; row < num_rows_; ++row) {
+    row_start_[row + 1] += row_start_[row];
+  }
+  row_cols_.resize(row_start_[num_rows_]);
+  row_coefficients_.resize(row_start_[num_rows_]);
+  std::vector<int> position(row_start_.begin(), row_start_.end() - 1);
+  for (ColIndex col(0); col < num_cols; ++col) {
+    if (!is_column_used[col.value()]) continue;
+    for (const SparseColumn::Entry e : matrix.column(col)) {
+      const int p = position[e.row().value()]++;
+      row_cols_[p] = col;
+      row_coefficients_[p] = e.coefficient();
+    }
+  }
+
+  // Graph of N: two rows are adjacent if they share a used column.
+  std::vector<std::vector<int>> adjacency(num_rows_);
+  std::vector<int> marker(num_rows_, -1);
+  for (int row = 0; row < num_rows_; ++row) {
+    marker[row] = row;
+    for (int p = row_start_[row]; p < row_start_[row + 1]; ++p) {
+      for (const SparseColumn::Entry e : matrix.column(row_cols_[p])) {
+        const int other = e.row().value();
+        if (marker[other] != row) {
+          marker[other] = row;
+          adjacency[row].push_back(other);
+        }
+      }
+    }
+  }
+
+  // Minimum degree ordering, by explicit elimination: when a row is
+  // eliminated, its neighbors become a clique. Its neighbors at this point
+  // are exactly the structure of its column of L.
+  //
+  // TODO(user): Use a quotient graph and approximate degrees (AMD), this is
+  // quadratic in the number of non-zeros of L.
+  perm_.clear();
+  inverse_perm_.assign(num_rows_, -1);
+  col_start_.assign(1, 0);
+  rows_.clear();
+  typedef std::pair<int, int> DegreeAndRow;
+  std::priority_queue<DegreeAndRow, std::vector<DegreeAndRow>,
+                      std::greater<DegreeAndRow>> queue;
+  for (int row = 0; row < num_rows_; ++row) {
+    queue.push(DegreeAndRow(adjacency[row].size(), row));
+  }
+  marker.assign(num_rows_, -1);
+  int stamp = 0;
+  std::vector<int> new_neighbors;
+  while (!queue.empty()) {
+    const int degree = queue.top().first;
+    const int row = queue.top().second;
+    queue.pop();
+    if (inverse_perm_[row] != -1 || degree != adjacency[row].size()) continue;
+    inverse_perm_[row] = perm_.size();
+    perm_.push_back(row);
+    const std::vector<int>& neighbors = adjacency[row];
+    rows_.insert(rows_.end(), neighbors.begin(), neighbors.end());
+    col_start_.push_back(rows_.size());
+    for (const int neighbor : neighbors) {
+      ++stamp;
+      marker[row] = stamp;
+      marker[neighbor] = stamp;
+      new_neighbors.clear();
+      for (const int other : adjacency[neighbor]) {
+        if (marker[other] != stamp) {
+          marker[other] = stamp;
+          new_neighbors.push_back(other);
+        }
+      }
+      for (const int other : neighbors) {
+        if (marker[other] != stamp) {
+          marker[other] = stamp;
+          new_neighbors.push_back(other);
+        }
+      }
+      adjacency[neighbor] = new_neighbors;
+      queue.push(DegreeAndRow(new_neighbors.size(), neighbor));
+    }
+    std::vector<int>().swap(adjacency[row]);
+  }
+  DCHECK_EQ(num_rows_, perm_.size());
+
+  for (int k = 0; k < num_rows_; ++k) {
+    for (int p = col_start_[k]; p < col_start_[k + 1]; ++p) {
+      rows_[p] = inverse_perm_[rows_[p]];
+      DCHECK_GT(rows_[p], k);
+    }
+    std::sort(rows_.begin() + col_start_[k], rows_.begin() + col_start_[k + 1]);
+  }
+  values_.assign(rows_.size(), 0.0);
+  diagonal_.assign(num_rows_, 1.0);
+  VLOG(1) << "Cholesky of the normal matrix: " << num_rows_ << " rows, "
+          << rows_.size() << " non-zeros in L.";
+}
+
+void NormalMatrixCholesky::Factorize(const DenseRow& d, const DenseColumn& e) {
+  work_.assign(num_rows_, 0.0);
+  first_.assign(num_rows_, 0);
+  head_.assign(num_rows_, -1);
+  next_.assign(num_rows_, -1);
+  num_dropped_pivots_ = 0;
+  Fractional max_diagonal = 0.0;
+  for (int k = 0; k < num_rows_; ++k) {
+    // Scatter the lower part of the column k of P.N.P^T.
+    const int row = perm_[k];
+    work_[k] += e[RowIndex(row)];
+    for (int p = row_start_[row]; p < row_start_[row + 1]; ++p) {
+      const Fractional factor = d[row_cols_[p]] * row_coefficients_[p];
+      if (factor == 0.0) continue;
+      for (const SparseColumn::Entry entry : matrix_->column(row_cols_[p])) {
+        const int i = inverse_perm_[entry.row().value()];
+        if (i >= k) work_[i] += factor * entry.coefficient();
+      }
+    }
+    max_diagonal = std::max(max_diagonal, work_[k]);
+
+    // Apply the updates of the columns j < k such that L(k, j) != 0.
+    int j = head_[k];
+    while (j != -1) {
+      const int next_j = next_[j];
+      const int p = first_[j];
+      DCHECK_EQ(k, rows_[p]);
+      const Fractional l_kj = values_[p];
+      for (int q = p; q < col_start_[j + 1]; ++q) {
+        work_[rows_[q]] -= values_[q] * l_kj;
+      }
+      if (++first_[j] < col_start_[j + 1]) {
+        const int next_row = rows_[first_[j]];
+        next_[j] = head_[next_row];
+        head_[next_row] = j;
+      }
+      j = next_j;
+    }
+
+    Fractional pivot = work_[k];
+    work_[k] = 0.0;
+    if (pivot <= kPivotTolerance * max_diagonal) {
+      pivot = kHugePivot;
+      ++num_dropped_pivots_;
+    }
+    diagonal_[k] = std::sqrt(pivot);
+    for (int q = col_start_[k]; q < col_start_[k + 1]; ++q) {
+      values_[q] = work_[rows_[q]] / diagonal_[k];
+      work_[rows_[q]] = 0.0;
+    }
+    if (col_start_[k] < col_start_[k + 1]) {
+      first_[k] = col_start_[k];
+      const int next_row = rows_[col_start_[k]];
+      next_[k] = head_[next_row];
+      head_[next_row] = k;
+    }
+  }
+}
+
+void NormalMatrixCholesky::Solve(DenseColumn* rhs) const {
+  std::vector<Fractional> x(num_rows_);
+  for (int k = 0; k < num_rows_; ++k) x[k] = (*rhs)[RowIndex(perm_[k])];
+
+  // Solve L.y = x, then L^T.x = y.
+  for (int k = 0; k < num_rows_; ++k) {
+    x[k] /= diagonal_[k];
+    const Fractional value = x[k];
+    if (value == 0.0) continue;
+    for (int q = col_start_[k]; q < col_start_[k + 1]; ++q) {
+      x[rows_[q]] -= values_[q] * value;
+    }
+  }
+  for (int k = num_rows_ - 1; k >= 0; --k) {
+    Fractional sum = x[k];
+    for (int q = col_start_[k]; q < col_start_[k + 1]; ++q) {
+      sum -= values_[q] * x[rows_[q]];
+    }
+    x[k] = sum / diagonal_[k];
+  }
+
+  for (int k = 0; k < num_rows_; ++k) (*rhs)[RowIndex(perm_[k])] = x[k];
+}
+
+// --------------------------------------------------------
+// InteriorPointSolver
+// --------------------------------------------------------
+
+InteriorPointSolver::InteriorPointSolver()
+    : parameters_(),
+      matrix_(nullptr),
+      num_cols_(0),
+      num_rows_(0),
+      num_variables_(0),
+      num_complementarity_pairs_(0),
+      is_converged_(false),
+      num_iterations_(0) {}
+
+void InteriorPointSolver::SetParameters(const GlopParameters& parameters) {
+  parameters_ = parameters;
+}
+
+Fractional InteriorPointSolver::LowerGap(ColIndex col) const {
+  return std::max(x_[col] - lower_bound_[col], kMinGap);
+}
+
+Fractional InteriorPointSolver::UpperGap(ColIndex col) const {
+  return std::max(upper_bound_[col] - x_[col], kMinGap);
+}
+
+Fractional InteriorPointSolver::ColumnScalarProduct(
+    ColIndex col, const DenseColumn& vector) const {
+  if (col >= num_cols_) return -vector[ColToRowIndex(col - num_cols_)];
+  Fractional sum = 0.0;
+  for (const SparseColumn::Entry e : matrix_->column(col)) {
+    sum += e.coefficient() * vector[e.row()];
+  }
+  return sum;
+}
+
+Fractional InteriorPointSolver::GetObjectiveValue() const {
+  Fractional objective = 0.0;
+  for (ColIndex col(0); col < num_cols_; ++col) {
+    objective += cost_[col] * x_[col];
+  }
+  return objective;
+}
+
+void InteriorPointSolver::InitializeProblem(const LinearProgram& lp) {
+  matrix_ = &lp.GetSparseMatrix();
+  num_cols_ = lp.num_variables();
+  num_rows_ = lp.num_constraints();
+  num_variables_ = num_cols_ + RowToColIndex(num_rows_);
+  lower_bound_.resize(num_variables_, 0.0);
+  upper_bound_.resize(num_variables_, 0.0);
+  cost_.assign(num_variables_, 0.0);
+  for (ColIndex col(0); col < num_cols_; ++col) {
+    lower_bound_[col] = lp.variable_lower_bounds()[col];
+    upper_bound_[col] = lp.variable_upper_bounds()[col];
+    cost_[col] = lp.GetObjectiveCoefficientForMinimizationVersion(col);
+  }
+  for (RowIndex row(0); row < num_rows_; ++row) {
+    lower_bound_[SlackColIndex(row)] = lp.constraint_lower_bounds()[row];
+    upper_bound_[SlackColIndex(row)] = lp.constraint_upper_bounds()[row];
+  }
+
+  // Starting point: the projection of zero on the bounds, moved a bit inside
+  // them, and all the bound dual values at one.
+  const int size = num_variables_.value();
+  is_fixed_.assign(size, false);
+  has_lower_.assign(size, false);
+  has_upper_.assign(size, false);
+  num_complementarity_pairs_ = 0;
+  x_.assign(num_variables_, 0.0);
+  y_.assign(num_rows_, 0.0);
+  lower_dual_.assign(num_variables_, 0.0);
+  upper_dual_.assign(num_variables_, 0.0);
+  for (ColIndex col(0); col < num_variables_; ++col) {
+    const Fractional lb = lower_bound_[col];
+    const Fractional ub = upper_bound_[col];
+    if (lb == ub) {
+      is_fixed_[col.value()] = true;
+      x_[col] = lb;
+      continue;
+    }
+    has_lower_[col.value()] = IsFinite(lb);
+    has_upper_[col.value()] = IsFinite(ub);
+    if (has_lower_[col.value()] && has_upper_[col.value()]) {
+      const Fractional margin = std::min(1.0, 0.5 * (ub - lb));
+      x_[col] = std::max(lb + margin, std::min(ub - margin, 0.0));
+    } else if (has_lower_[col.value()]) {
+      x_[col] = std::max(lb + 1.0, 0.0);
+    } else if (has_upper_[col.value()]) {
+      x_[col] = std::min(ub - 1.0, 0.0);
+    }
+    if (has_lower_[col.value()]) {
+      lower_dual_[col] = 1.0;
+      ++num_complementarity_pairs_;
+    }
+    if (has_upper_[col.value()]) {
+      upper_dual_[col] = 1.0;
+      ++num_complementarity_pairs_;
+    }
+  }
+
+  std::vector<bool> is_column_used(is_fixed_.begin(),
+                                   is_fixed_.begin() + num_cols_.value());
+  is_column_used.flip();
+  cholesky_.Initialize(*matrix_, is_column_used);
+}
+
+void InteriorPointSolver::ComputeResiduals() {
+  // Primal residual: -(A.x - s).
+  primal_residual_.assign(num_rows_, 0.0);
+  for (ColIndex col(0); col < num_cols_; ++col) {
+    const Fractional value = x_[col];
+    if (value == 0.0) continue;
+    for (const SparseColumn::Entry e : matrix_->column(col)) {
+      primal_residual_[e.row()] -= e.coefficient() * value;
+    }
+  }
+  for (RowIndex row(0); row < num_rows_; ++row) {
+    primal_residual_[row] += x_[SlackColIndex(row)];
+  }
+
+  // Dual residual: c - [A, -I]^T.y - z_l + z_u. It is irrelevant for the
+  // fixed variables which have a free reduced cost.
+  dual_residual_.assign(num_variables_, 0.0);
+  for (ColIndex col(0); col < num_variables_; ++col) {
+    if (is_fixed_[col.value()]) continue;
+    dual_residual_[col] = cost_[col] - ColumnScalarProduct(col, y_) -
+                          lower_dual_[col] + upper_dual_[col];
+  }
+}
+
+Fractional InteriorPointSolver::ComputeAverageComplementarity() const {
+  if (num_complementarity_pairs_ == 0) return 0.0;
+  Fractional sum = 0.0;
+  for (ColIndex col(0); col < num_variables_; ++col) {
+    if (has_lower_[col.value()]) sum += LowerGap(col) * lower_dual_[col];
+    if (has_upper_[col.value()]) sum += UpperGap(col) * upper_dual_[col];
+  }
+  return sum / num_complementarity_pairs_;
+}
+
+// With M = [A, -I] and the complementarity equations linearized, the Newton
+// system reduces to (M.Theta.M^T).dy = r_p + M.Theta.g and
+// dx = Theta.(M^T.dy - g), where g = r_d - r_l / (x - l) + r_u / (u - x).
+void InteriorPointSolver::ComputeDirection(const DenseRow& lower_rhs,
+                                           const DenseRow& upper_rhs) {
+  scratch_.assign(num_variables_, 0.0);
+  for (ColIndex col(0); col < num_variables_; ++col) {
+    if (is_fixed_[col.value()]) continue;
+    Fractional g = dual_residual_[col];
+    if (has_lower_[col.value()]) g -= lower_rhs[col] / LowerGap(col);
+    if (has_upper_[col.value()]) g += upper_rhs[col] / UpperGap(col);
+    scratch_[col] = g;
+  }
+
+  dy_ = primal_residual_;
+  for (ColIndex col(0); col < num_cols_; ++col) {
+    const Fractional value = theta_[col] * scratch_[col];
+    if (value == 0.0) continue;
+    for (const SparseColumn::Entry e : matrix_->column(col)) {
+      dy_[e.row()] += e.coefficient() * value;
+    }
+  }
+  for (RowIndex row(0); row < num_rows_; ++row) {
+    const ColIndex col = SlackColIndex(row);
+    dy_[row] -= theta_[col] * scratch_[col];
+  }
+  cholesky_.Solve(&dy_);
+
+  dx_.assign(num_variables_, 0.0);
+  lower_dual_direction_.assign(num_variables_, 0.0);
+  upper_dual_direction_.assign(num_variables_, 0.0);
+  for (ColIndex col(0); col < num_variables_; ++col) {
+    if (is_fixed_[col.value()]) continue;
+    dx_[col] = theta_[col] * (ColumnScalarProduct(col, dy_) - scratch_[col]);
+    if (has_lower_[col.value()]) {
+      lower_dual_direction_[col] =
+          (lower_rhs[col] - lower_dual_[col] * dx_[col]) / LowerGap(col);
+    }
+    if (has_upper_[col.value()]) {
+      upper_dual_direction_[col] =
+          (upper_rhs[col] + upper_dual_[col] * dx_[col]) / UpperGap(col);
+    }
+  }
+}
+
+Fractional InteriorPointSolver::MaxPrimalStep() const {
+  Fractional step = 1.0;
+  for (ColIndex col(0); col < num_variables_; ++col) {
+    const Fractional direction = dx_[col];
+    if (has_lower_[col.value()] && direction < 0.0) {
+      step = std::min(step, -LowerGap(col) / direction);
+    }
+    if (has_upper_[col.value()] && direction > 0.0) {
+      step = std::min(step, UpperGap(col) / direction);
+    }
+  }
+  return step;
+}
+
+Fractional InteriorPointSolver::MaxDualStep() const {
+  Fractional step = 1.0;
+  for (ColIndex col(0); col < num_variables_; ++col) {
+    if (lower_dual_direction_[col] < 0.0) {
+      step = std::min(step, -lower_dual_[col] / lower_dual_direction_[col]);
+    }
+    if (upper_dual_direction_[col] < 0.0) {
+      step = std::min(step, -upper_dual_[col] / upper_dual_direction_[col]);
+    }
+  }
+  return step;
+}
+
+void InteriorPointSolver::Solve(const LinearProgram& lp,
+                                TimeLimit* time_limit) {
+  is_converged_ = false;
+  num_iterations_ = 0;
+  InitializeProblem(lp);
+
+  Fractional bound_norm = 0.0;
+  Fractional cost_norm = 0.0;
+  for (ColIndex col(0); col < num_variables_; ++col) {
+    if (IsFinite(lower_bound_[col])) {
+      bound_norm = std::max(bound_norm, std::abs(lower_bound_[col]));
+    }
+    if (IsFinite(upper_bound_[col])) {
+      bound_norm = std::max(bound_norm, std::abs(upper_bound_[col]));
+    }
+    cost_norm = std::max(cost_norm, std::abs(cost_[col]));
+  }
+
+  const Fractional tolerance = parameters_.interior_point_tolerance();
+  DenseRow lower_rhs;
+  DenseRow upper_rhs;
+  theta_.assign(num_variables_, 0.0);
+  slack_theta_.assign(num_rows_, 0.0);
+  for (; num_iterations_ < parameters_.interior_point_max_iterations();
+       ++num_iterations_) {
+    if (time_limit->LimitReached()) break;
+    ComputeResiduals();
+    const Fractional mu = ComputeAverageComplementarity();
+    Fractional primal_infeasibility = 0.0;
+    for (RowIndex row(0); row < num_rows_; ++row) {
+      primal_infeasibility =
+          std::max(primal_infeasibility, std::abs(primal_residual_[row]));
+    }
+    Fractional dual_infeasibility = 0.0;
+    Fractional max_value = 0.0;
+    for (ColIndex col(0); col < num_variables_; ++col) {
+      dual_infeasibility =
+          std::max(dual_infeasibility, std::abs(dual_residual_[col]));
+      max_value = std::max(max_value, std::abs(x_[col]));
+    }
+    for (RowIndex row(0); row < num_rows_; ++row) {
+      max_value = std::max(max_value, std::abs(y_[row]));
+    }
+    const Fractional objective = GetObjectiveValue();
+    VLOG(1) << "Interior point iteration " << num_iterations_
+            << ": objective = " << objective
+            << ", primal infeasibility = " << primal_infeasibility
+            << ", dual infeasibility = " << dual_infeasibility
+            << ", mu = " << mu;
+    if (primal_infeasibility <= tolerance * (1.0 + bound_norm) &&
+        dual_infeasibility <= tolerance * (1.0 + cost_norm) &&
+        mu * num_complementarity_pairs_ <=
+            tolerance * (1.0 + std::abs(objective))) {
+      is_converged_ = true;
+      break;
+    }
+    if (max_value > kDivergenceThreshold) {
+      VLOG(1) << "The interior point method diverges.";
+      break;
+    }
+
+    // Scaling of the normal matrix.
+    for (ColIndex col(0); col < num_variables_; ++col) {
+      if (is_fixed_[col.value()]) continue;
+      Fractional inverse = kPrimalRegularization;
+      if (has_lower_[col.value()]) inverse += lower_dual_[col] / LowerGap(col);
+      if (has_upper_[col.value()]) inverse += upper_dual_[col] / UpperGap(col);
+      theta_[col] = 1.0 / inverse;
+    }
+    for (RowIndex row(0); row < num_rows_; ++row) {
+      slack_theta_[row] = theta_[SlackColIndex(row)];
+    }
+    cholesky_.Factorize(theta_, slack_theta_);
+    if (cholesky_.num_dropped_pivots() > 0) {
+      VLOG(2) << cholesky_.num_dropped_pivots() << " dropped pivots.";
+    }
+
+    // Predictor (affine scaling) direction.
+    lower_rhs.assign(num_variables_, 0.0);
+    upper_rhs.assign(num_variables_, 0.0);
+    for (ColIndex col(0); col < num_variables_; ++col) {
+      if (has_lower_[col.value()]) {
+        lower_rhs[col] = -LowerGap(col) * lower_dual_[col];
+      }
+      if (has_upper_[col.value()]) {
+        upper_rhs[col] = -UpperGap(col) * upper_dual_[col];
+      }
+    }
+    ComputeDirection(lower_rhs, upper_rhs);
+    const Fractional affine_primal_step = MaxPrimalStep();
+    const Fractional affine_dual_step = MaxDualStep();
+    Fractional affine_mu = 0.0;
+    for (ColIndex col(0); col < num_variables_; ++col) {
+      const Fractional dx = affine_primal_step * dx_[col];
+      if (has_lower_[col.value()]) {
+        affine_mu += (LowerGap(col) + dx) *
+                     (lower_dual_[col] +
+                      affine_dual_step * lower_dual_direction_[col]);
+      }
+      if (has_upper_[col.value()]) {
+        affine_mu += (UpperGap(col) - dx) *
+                     (upper_dual_[col] +
+                      affine_dual_step * upper_dual_direction_[col]);
+      }
+    }
+    if (num_complementarity_pairs_ > 0) {
+      affine_mu /= num_complementarity_pairs_;
+    }
+
+    // Corrector direction, with Mehrotra's centering parameter.
+    const Fractional ratio = mu > 0.0 ? std::min(1.0, affine_mu / mu) : 0.0;
+    const Fractional target = ratio * ratio * ratio * mu;
+    for (ColIndex col(0); col < num_variables_; ++col) {
+      if (has_lower_[col.value()]) {
+        lower_rhs[col] +=
+            target - dx_[col] * lower_dual_direction_[col];
+      }
+      if (has_upper_[col.value()]) {
+        upper_rhs[col] +=
+            target + dx_[col] * upper_dual_direction_[col];
+      }
+    }
+    ComputeDirection(lower_rhs, upper_rhs);
+
+    // Take the step.
+    const Fractional primal_step = std::min(1.0, kStepFactor * MaxPrimalStep());
+    const Fractional dual_step = std::min(1.0, kStepFactor * MaxDualStep());
+    for (ColIndex col(0); col < num_variables_; ++col) {
+      x_[col] += primal_step * dx_[col];
+      lower_dual_[col] += dual_step * lower_dual_direction_[col];
+      upper_dual_[col] += dual_step * upper_dual_direction_[col];
+    }
+    for (RowIndex row(0); row < num_rows_; ++row) {
+      y_[row] += dual_step * dy_[row];
+    }
+  }
+  VLOG(1) << "Interior point method "
+          << (is_converged_ ? "converged" : "stopped") << " after "
+          << num_iterations_ << " iterations.";
+}
+
+void InteriorPointSolver::ComputeCrossoverBasis(BasisState* state) const {
+  state->num_rows = num_rows_;
+  state->num_cols = num_cols_;
+  state->statuses.resize(num_variables_, VariableStatus::FREE);
+
+  // The score of a variable is the ratio between its distance to its closest
+  // bound and the dual value of this bound: it goes to infinity for the basic
+  // variables of a strictly complementary solution, and to zero for the other
+  // ones. The fixed variables are only basic as a last resort.
+  std::vector<std::pair<Fractional, ColIndex>> candidates;
+  for (ColIndex col(0); col < num_variables_; ++col) {
+    VariableStatus status = VariableStatus::FREE;
+    Fractional score = kInfinity;
+    if (is_fixed_[col.value()]) {
+      status = VariableStatus::FIXED_VALUE;
+      score = -1.0;
+    } else {
+      const bool has_lower = has_lower_[col.value()];
+      const bool has_upper = has_upper_[col.value()];
+      if (has_lower) {
+        score = std::min(score, LowerGap(col) / lower_dual_[col]);
+      }
+      if (has_upper) {
+        score = std::min(score, UpperGap(col) / upper_dual_[col]);
+      }
+      if (has_lower && (!has_upper || LowerGap(col) <= UpperGap(col))) {
+        status = VariableStatus::AT_LOWER_BOUND;
+      } else if (has_upper) {
+        status = VariableStatus::AT_UPPER_BOUND;
+      }
+
+      // The RevisedSimplex slack variables are the opposite of the constraint
+      // activities, so their bounds are swapped.
+      if (col >= num_cols_) {
+        if (status == VariableStatus::AT_LOWER_BOUND) {
+          status = VariableStatus::AT_UPPER_BOUND;
+        } else if (status == VariableStatus::AT_UPPER_BOUND) {
+          status = VariableStatus::AT_LOWER_BOUND;
+        }
+      }
+    }
+    state->statuses[col] = status;
+    candidates.push_back(std::make_pair(-score, col));
+  }
+
+  // Exactly num_rows variables are basic, so the revised simplex never
+  // completes the basis with slack variables that may already be in it.
+  const int num_basic = num_rows_.value();
+  std::partial_sort(candidates.begin(), candidates.begin() + num_basic,
+                    candidates.end());
+  for (int i = 0; i < num_basic; ++i) {
+    state->statuses[candidates[i].second] = VariableStatus::BASIC;
+  }
+}
+
+}  // namespace glop
+}  // namespace operations_research
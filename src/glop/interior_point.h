@@ -0,0 +1,225 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Primal-dual interior point method (also called barrier method) for linear
+// programs, used by LPSolver before the revised simplex.
+//
+// Like the revised simplex, the solver works on the linear program
+//   min c.x  s.t.  A.x - s = 0,  l <= (x, s) <= u
+// where s is the vector of the constraint activities. We use Mehrotra's
+// predictor-corrector algorithm: at each iteration, the two Newton directions
+// are computed from the same sparse Cholesky factorization of the "normal"
+// matrix A.D.A^T + E, where D and E are positive diagonal matrices (E is only
+// zero on the equality constraints).
+//
+// The interior point solution is never exactly at a vertex. The "crossover"
+// is done by the revised simplex: ComputeCrossoverBasis() guesses a basis from
+// the final interior point, which is then loaded with
+// RevisedSimplex::LoadStateForNextSolve(). When the guess is good, only a few
+// simplex iterations are needed to reach an optimal basic solution.
+//
+// References:
+// Sanjay Mehrotra, "On the implementation of a primal-dual interior point
+// method", SIAM Journal on Optimization, Vol. 2, No. 4, 1992.
+//
+// Stephen J. Wright, "Primal-Dual Interior-Point Methods", SIAM, 1997.
+
+#ifndef OR_TOOLS_GLOP_INTERIOR_POINT_H_
+#define OR_TOOLS_GLOP_INTERIOR_POINT_H_
+
+#include <vector>
+
+#include "base/logging.h"
+#include "glop/parameters.pb.h"
+#include "glop/revised_simplex.h"
+#include "lp_data/lp_data.h"
+#include "lp_data/lp_types.h"
+#include "lp_data/sparse.h"
+#include "util/time_limit.h"
+
+namespace operations_research {
+namespace glop {
+
+// Cholesky factorization P.N.P^T = L.L^T of the normal matrix
+// N = A.D.A^T + E, where D and E are non-negative diagonal matrices. The
+// permutation P is a minimum degree ordering computed once from the sparsity
+// pattern of A, together with the structure of L. Only the numeric
+// factorization is redone at each iteration of the interior point method.
+class NormalMatrixCholesky {
+ public:
+  NormalMatrixCholesky();
+
+  // Computes the ordering and the structure of L. The columns of 'matrix'
+  // with is_column_used[col] false never contribute to N (i.e. their entry in
+  // D is always zero). The matrix must outlive this class.
+  //
+  // TODO(user): Dense columns of A make N dense. They should be handled
+  // separately, for instance with the Sherman-Morrison-Woodbury formula.
+  void Initialize(const SparseMatrix& matrix,
+                  const std::vector<bool>& is_column_used);
+
+  // Computes the numeric factorization for the given diagonals. The tiny
+  // pivots (this happens when A has linearly dependent rows) are replaced by a
+  // huge value, which amounts to fixing the corresponding component of the
+  // solution of Solve() to zero.
+  void Factorize(const DenseRow& d, const DenseColumn& e);
+
+  // Solves N.x = rhs, x replaces rhs.
+  void Solve(DenseColumn* rhs) const;
+
+  // Number of pivots that were replaced by the last Factorize().
+  int num_dropped_pivots() const { return num_dropped_pivots_; }
+
+  // Number of non-zeros of L, the diagonal excluded.
+  int num_entries() const { return rows_.size(); }
+
+ private:
+  const SparseMatrix* matrix_;
+  int num_rows_;
+
+  // Row-wise copy of the used columns of A.
+  std::vector<int> row_start_;
+  std::vector<ColIndex> row_cols_;
+  std::vector<Fractional> row_coefficients_;
+
+  // perm_[k] is the row of A at position k in the factorization.
+  std::vector<int> perm_;
+  std::vector<int> inverse_perm_;
+
+  // The strictly lower triangular part of L, column by column, in the
+  // permuted order. The row indices of each column are sorted.
+  std::vector<int> col_start_;
+  std::vector<int> rows_;
+  std::vector<Fractional> values_;
+  std::vector<Fractional> diagonal_;
+  int num_dropped_pivots_;
+
+  // Scratch data of Factorize(). For a column j already factorized,
+  // first_[j] is the position of the first entry of j whose row was not
+  // processed yet, and j is in the linked list (head_, next_) of this row.
+  std::vector<Fractional> work_;
+  std::vector<int> first_;
+  std::vector<int> head_;
+  std::vector<int> next_;
+
+  DISALLOW_COPY_AND_ASSIGN(NormalMatrixCholesky);
+};
+
+class InteriorPointSolver {
+ public:
+  InteriorPointSolver();
+
+  void SetParameters(const GlopParameters& parameters);
+
+  // Runs the interior point method on the given linear program until the
+  // interior_point_tolerance is reached, or until the iteration or time limit
+  // is hit. In all cases, the last iterate can be used for the crossover.
+  void Solve(const LinearProgram& lp, TimeLimit* time_limit);
+
+  // Whether or not the last Solve() reached the tolerance.
+  bool IsConverged() const { return is_converged_; }
+
+  // Number of iterations of the last Solve().
+  int GetNumberOfIterations() const { return num_iterations_; }
+
+  // Primal objective of the last iterate, for the minimization version of the
+  // problem and without the objective offset and scaling factor.
+  Fractional GetObjectiveValue() const;
+
+  // Fills 'state', in the RevisedSimplex convention, with a basis guessed from
+  // the last iterate. The num_rows "most interior" variables, measured by the
+  // ratio between their distance to their closest bound and the associated
+  // dual value, are basic. The other ones are at their closest bound.
+  void ComputeCrossoverBasis(BasisState* state) const;
+
+ private:
+  // The variables of the problem are indexed by ColIndex: the num_cols_
+  // variables of the linear program first, then the num_rows_ activities.
+  ColIndex SlackColIndex(RowIndex row) const {
+    return num_cols_ + RowToColIndex(row);
+  }
+
+  // Distance of a variable to its lower and upper bound. They are only
+  // meaningful if has_lower_[col] (resp. has_upper_[col]) is true.
+  Fractional LowerGap(ColIndex col) const;
+  Fractional UpperGap(ColIndex col) const;
+
+  // Column col of [A, -I] times 'vector'.
+  Fractional ColumnScalarProduct(ColIndex col,
+                                 const DenseColumn& vector) const;
+
+  // Initializes the bounds, the cost and the starting point.
+  void InitializeProblem(const LinearProgram& lp);
+
+  // Computes the primal and dual residuals of the current iterate.
+  void ComputeResiduals();
+
+  // Returns the average complementarity product of the current iterate.
+  Fractional ComputeAverageComplementarity() const;
+
+  // Computes the Newton direction for the given right-hand sides of the
+  // complementarity equations, with the current factorization.
+  void ComputeDirection(const DenseRow& lower_rhs, const DenseRow& upper_rhs);
+
+  // Returns the longest steps, capped to 1.0, that keep the primal (resp.
+  // dual) variables on the positive side of their bounds when following the
+  // current direction.
+  Fractional MaxPrimalStep() const;
+  Fractional MaxDualStep() const;
+
+  GlopParameters parameters_;
+  const SparseMatrix* matrix_;
+  ColIndex num_cols_;
+  RowIndex num_rows_;
+  ColIndex num_variables_;
+
+  DenseRow lower_bound_;
+  DenseRow upper_bound_;
+  DenseRow cost_;
+  std::vector<bool> is_fixed_;
+  std::vector<bool> has_lower_;
+  std::vector<bool> has_upper_;
+  int num_complementarity_pairs_;
+
+  // The current iterate: primal values, dual values of the constraints and
+  // dual values of the lower and upper bounds.
+  DenseRow x_;
+  DenseColumn y_;
+  DenseRow lower_dual_;
+  DenseRow upper_dual_;
+
+  // Residuals of the current iterate.
+  DenseColumn primal_residual_;
+  DenseRow dual_residual_;
+
+  // The diagonal scaling (D, E) of the normal matrix, and the current
+  // direction.
+  DenseRow theta_;
+  DenseColumn slack_theta_;
+  DenseRow dx_;
+  DenseColumn dy_;
+  DenseRow lower_dual_direction_;
+  DenseRow upper_dual_direction_;
+  DenseRow scratch_;
+
+  NormalMatrixCholesky cholesky_;
+  bool is_converged_;
+  int num_iterations_;
+
+  DISALLOW_COPY_AND_ASSIGN(InteriorPointSolver);
+};
+
+}  // namespace glop
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_GLOP_INTERIOR_POINT_H_
@@ -15,6 +15,7 @@
 #include "glop/lp_solver.h"
 
 #include <cmath>
+#include <mutex>  // NOLINT
 #include <stack>
 #include <vector>
 
@@ -24,8 +25,12 @@
 
 #include "base/join.h"
 #include "base/strutil.h"
+#include "glop/initial_basis.h"
+#include "glop/interior_point.h"
+#include "glop/parallel_for.h"
 #include "glop/preprocessor.h"
 #include "glop/proto_utils.h"
+#include "glop/revised_simplex.h"
 #include "glop/status.h"
 #include "lp_data/lp_types.h"
 #include "lp_data/lp_utils.h"
@@ -153,13 +158,17 @@ ProblemStatus LPSolver::SolveWithTimeLimit(const LinearProgram& lp,
   VLOG(1) << "Initial problem: " << lp.GetDimensionString();
   VLOG(1) << "Objective stats: " << lp.GetObjectiveStatsString();
   current_linear_program_.PopulateFromLinearProgram(lp);
+  solve_stats_ = SolveStats();
 
   // Preprocess.
+  WallTimer timer;
+  timer.Start();
   MainLpPreprocessor preprocessor;
   preprocessor.SetParameters(parameters_);
 
   const bool postsolve_is_needed = preprocessor.Run(&current_linear_program_,
                                                     time_limit);
+  solve_stats_.preprocessing_time = timer.Get();
 
   // At this point, we need to initialize a ProblemSolution with the correct
   // size and status.
@@ -167,10 +176,13 @@ ProblemStatus LPSolver::SolveWithTimeLimit(const LinearProgram& lp,
                            current_linear_program_.num_variables());
   solution.status = preprocessor.status();
 
-  RunRevisedSimplexIfNeeded(&solution, time_limit);
+  RunRevisedSimplexIfNeeded(nullptr, &solution, time_limit);
 
+  timer.Restart();
   if (postsolve_is_needed) preprocessor.RecoverSolution(&solution);
-  return LoadAndVerifySolution(lp, solution);
+  const ProblemStatus status = LoadAndVerifySolution(lp, solution);
+  solve_stats_.postsolve_time = timer.Get();
+  return status;
 }
 
 void LPSolver::Clear() {
@@ -389,6 +401,296 @@ int LPSolver::GetNumberOfSimplexIterations() const {
   return num_revised_simplex_iterations_;
 }
 
+namespace {
+// Returns the status of the RevisedSimplex slack variable of a constraint with
+// the given status. The slack variables are the opposite of the constraint
+// activities, so their bounds are swapped.
+VariableStatus SlackVariableStatus(ConstraintStatus status) {
+  switch (status) {
+    case ConstraintStatus::BASIC:
+      return VariableStatus::BASIC;
+    case ConstraintStatus::FIXED_VALUE:
+      return VariableStatus::FIXED_VALUE;
+    case ConstraintStatus::AT_LOWER_BOUND:
+      return VariableStatus::AT_UPPER_BOUND;
+    case ConstraintStatus::AT_UPPER_BOUND:
+      return VariableStatus::AT_LOWER_BOUND;
+    case ConstraintStatus::FREE:
+      return VariableStatus::FREE;
+  }
+  return VariableStatus::FREE;
+}
+}  // namespace
+
+void LPSolver::SolveBranchings(
+    const LinearProgram& lp, const std::vector<BranchingCandidate>& candidates,
+    TimeLimit* time_limit, std::vector<BranchingResult>* results) {
+  RETURN_IF_NULL(time_limit);
+  RETURN_IF_NULL(results);
+  results->assign(candidates.size(), BranchingResult());
+  const RowIndex num_rows = lp.num_constraints();
+  const ColIndex num_cols = lp.num_variables();
+  if (variable_statuses_.size() != num_cols ||
+      constraint_statuses_.size() != num_rows) {
+    LOG(DFATAL) << "SolveBranchings() must be called on the linear program of "
+                << "the last Solve().";
+    return;
+  }
+  if (candidates.empty()) return;
+
+  GlopParameters parameters = parameters_;
+  parameters.set_use_dual_simplex(true);
+  parameters.set_allow_simplex_algorithm_change(true);
+  parameters.set_num_omp_threads(1);
+
+  // Completes the optimal basis of the last Solve(), which is expressed on lp
+  // because it was postsolved, into a full RevisedSimplex state. This should
+  // not need any iteration.
+  BasisState root_state;
+  root_state.num_rows = num_rows;
+  root_state.num_cols = num_cols;
+  root_state.statuses = variable_statuses_;
+  for (RowIndex row(0); row < num_rows; ++row) {
+    root_state.statuses.push_back(
+        SlackVariableStatus(constraint_statuses_[row]));
+  }
+  {
+    RevisedSimplex root_simplex;
+    root_simplex.SetParameters(parameters);
+    root_simplex.LoadStateForNextSolve(root_state);
+    if (!root_simplex.Solve(lp, time_limit).ok()) {
+      VLOG(1) << "Error while loading the root state of SolveBranchings().";
+      return;
+    }
+    root_state = root_simplex.GetState();
+  }
+
+  // The chunks of candidates solved in parallel, with their own simplex, copy
+  // of the linear program and time limit. The time limits of the chunks share
+  // the deterministic time left.
+  parameters.set_max_number_of_iterations(
+      parameters_.max_number_of_branching_iterations());
+  const int num_candidates = candidates.size();
+  ParallelFor parallel_for;
+  parallel_for.SetNumThreads(parameters_.num_omp_threads());
+  const int num_chunks = parallel_for.NumChunks(num_candidates, 1);
+  std::vector<std::unique_ptr<RevisedSimplex>> simplexes(num_chunks);
+  std::vector<std::unique_ptr<LinearProgram>> lps(num_chunks);
+  ParallelTimeLimit parallel_time_limit(time_limit->GetTimeLeft(),
+                                        time_limit->GetDeterministicTimeLeft());
+  std::vector<std::unique_ptr<TimeLimit>> time_limits(num_chunks);
+  for (int chunk = 0; chunk < num_chunks; ++chunk) {
+    simplexes[chunk].reset(new RevisedSimplex());
+    simplexes[chunk]->SetParameters(parameters);
+    lps[chunk].reset(new LinearProgram());
+    lps[chunk]->PopulateFromLinearProgram(lp);
+    time_limits[chunk] = parallel_time_limit.NewWorkerTimeLimit();
+  }
+  const Fractional root_objective = GetObjectiveValue();
+  parallel_for.Run(
+      num_candidates, 1, [&](int chunk, int begin, int end) {
+        RevisedSimplex* const simplex = simplexes[chunk].get();
+        LinearProgram* const chunk_lp = lps[chunk].get();
+        TimeLimit* const chunk_time_limit = time_limits[chunk].get();
+        for (int i = begin; i < end; ++i) {
+          if (chunk_time_limit->LimitReached()) break;
+          const BranchingCandidate& candidate = candidates[i];
+          const Fractional old_lower_bound =
+              chunk_lp->variable_lower_bounds()[candidate.col];
+          const Fractional old_upper_bound =
+              chunk_lp->variable_upper_bounds()[candidate.col];
+          chunk_lp->SetVariableBounds(candidate.col, candidate.lower_bound,
+                                      candidate.upper_bound);
+          if (i > begin) simplex->NotifyThatMatrixIsUnchangedForNextSolve();
+          simplex->LoadStateForNextSolve(root_state);
+          BranchingResult* const result = &(*results)[i];
+          if (simplex->Solve(*chunk_lp, chunk_time_limit).ok()) {
+            result->status = simplex->GetProblemStatus();
+            result->objective_value = simplex->GetObjectiveValue();
+            result->objective_change = result->objective_value - root_objective;
+            result->num_iterations = simplex->GetNumberOfIterations();
+          } else {
+            result->status = ProblemStatus::ABNORMAL;
+          }
+          chunk_lp->SetVariableBounds(candidate.col, old_lower_bound,
+                                      old_upper_bound);
+        }
+      });
+  // Destroying the time limits of the chunks accounts their deterministic
+  // time in parallel_time_limit.
+  time_limits.clear();
+  time_limit->AdvanceDeterministicTime(
+      parallel_time_limit.GetElapsedDeterministicTime());
+}
+
+namespace {
+VariableType ComputeVariableType(Fractional lower_bound,
+                                 Fractional upper_bound) {
+  if (lower_bound == -kInfinity && upper_bound == kInfinity) {
+    return VariableType::UNCONSTRAINED;
+  } else if (lower_bound == -kInfinity) {
+    return VariableType::UPPER_BOUNDED;
+  } else if (upper_bound == kInfinity) {
+    return VariableType::LOWER_BOUNDED;
+  } else if (lower_bound == upper_bound) {
+    return VariableType::FIXED_VARIABLE;
+  } else {
+    return VariableType::UPPER_AND_LOWER_BOUNDED;
+  }
+}
+
+// Returns the crossover score of a variable with the given value, bounds and
+// reduced cost, i.e. the ratio between its distance to its closest bound and
+// its reduced cost. This goes to infinity for the basic variables of a strictly
+// complementary solution and to zero for the other ones. Fixed variables and
+// variables at one of their bounds have a score of zero. The status of the
+// variable if it is not basic is returned in status.
+Fractional CrossoverScore(Fractional value, Fractional lower_bound,
+                          Fractional upper_bound, Fractional reduced_cost,
+                          VariableStatus* status) {
+  if (lower_bound == upper_bound) {
+    *status = VariableStatus::FIXED_VALUE;
+    return 0.0;
+  }
+  const Fractional lower_gap =
+      lower_bound == -kInfinity ? kInfinity : value - lower_bound;
+  const Fractional upper_gap =
+      upper_bound == kInfinity ? kInfinity : upper_bound - value;
+  if (lower_bound != -kInfinity && lower_gap <= upper_gap) {
+    *status = VariableStatus::AT_LOWER_BOUND;
+  } else if (upper_bound != kInfinity) {
+    *status = VariableStatus::AT_UPPER_BOUND;
+  } else {
+    *status = VariableStatus::FREE;
+  }
+  const Fractional gap = std::min(lower_gap, upper_gap);
+  if (gap <= 0.0) return 0.0;
+  if (gap == kInfinity) return kInfinity;
+
+  // The minimum magnitude of a reduced cost avoids a division by zero, the
+  // order between such variables is decided by their gap.
+  const Fractional kMinReducedCostMagnitude = 1e-30;
+  return gap / std::max(std::abs(reduced_cost), kMinReducedCostMagnitude);
+}
+
+// Fills state with a crash basis of lp built from the given approximate
+// solution, see LPSolver::SolveFromApproximateSolution(). The columns of the
+// RevisedSimplex are the ones of lp followed by one slack per constraint, equal
+// to the opposite of the constraint activity.
+void ComputeCrossoverBasisFromSolution(const LinearProgram& lp,
+                                       const DenseRow& primal_values,
+                                       const DenseColumn& dual_values,
+                                       BasisState* state) {
+  const RowIndex num_rows = lp.num_constraints();
+  const ColIndex num_cols = lp.num_variables();
+  const ColIndex num_variables = num_cols + RowToColIndex(num_rows);
+  const SparseMatrix& matrix = lp.GetSparseMatrix();
+
+  DenseRow objective(num_variables, 0.0);
+  DenseRow lower_bounds(num_variables, 0.0);
+  DenseRow upper_bounds(num_variables, 0.0);
+  VariableTypeRow variable_types(num_variables, VariableType::UNCONSTRAINED);
+  DenseRow scores(num_variables, 0.0);
+  state->num_rows = num_rows;
+  state->num_cols = num_cols;
+  state->statuses.assign(num_variables, VariableStatus::FREE);
+  for (ColIndex col(0); col < num_cols; ++col) {
+    const Fractional lower_bound = lp.variable_lower_bounds()[col];
+    const Fractional upper_bound = lp.variable_upper_bounds()[col];
+    const Fractional reduced_cost =
+        lp.objective_coefficients()[col] -
+        ScalarProduct(dual_values, matrix.column(col));
+    objective[col] = lp.objective_coefficients()[col];
+    lower_bounds[col] = lower_bound;
+    upper_bounds[col] = upper_bound;
+    variable_types[col] = ComputeVariableType(lower_bound, upper_bound);
+    scores[col] = CrossoverScore(primal_values[col], lower_bound, upper_bound,
+                                 reduced_cost, &state->statuses[col]);
+  }
+
+  // The slack s = -a.x of a constraint l <= a.x <= u has the bounds [-u, -l]
+  // and its reduced cost is the opposite of the constraint dual value.
+  DenseColumn activities(num_rows, 0.0);
+  for (ColIndex col(0); col < num_cols; ++col) {
+    const Fractional value = primal_values[col];
+    if (value == 0.0) continue;
+    for (const SparseColumn::Entry e : matrix.column(col)) {
+      activities[e.row()] += e.coefficient() * value;
+    }
+  }
+  for (RowIndex row(0); row < num_rows; ++row) {
+    const ColIndex col = num_cols + RowToColIndex(row);
+    const Fractional lower_bound = -lp.constraint_upper_bounds()[row];
+    const Fractional upper_bound = -lp.constraint_lower_bounds()[row];
+    lower_bounds[col] = lower_bound;
+    upper_bounds[col] = upper_bound;
+    variable_types[col] = ComputeVariableType(lower_bound, upper_bound);
+    scores[col] = CrossoverScore(-activities[row], lower_bound, upper_bound,
+                                 -dual_values[row], &state->statuses[col]);
+  }
+
+  // The triangular crash only uses the candidates that keep the basis
+  // triangular, the rows it leaves out use their slack. This always gives a
+  // non-singular basis since a slack can only enter on its own row.
+  SparseMatrix identity;
+  identity.PopulateFromIdentity(RowToColIndex(num_rows));
+  MatrixView matrix_with_slack;
+  matrix_with_slack.PopulateFromMatrixPair(matrix, identity);
+  InitialBasis initial_basis(matrix_with_slack, objective, lower_bounds,
+                             upper_bounds, variable_types);
+  RowToColMapping basis(num_rows, kInvalidCol);
+  if (!initial_basis.CompleteTriangularBasisFromScores(num_variables, scores,
+                                                       &basis)) {
+    VLOG(1) << "Numerical difficulties in the crossover crash basis.";
+  }
+  for (RowIndex row(0); row < num_rows; ++row) {
+    const ColIndex col = basis[row] == kInvalidCol
+                             ? num_cols + RowToColIndex(row)
+                             : basis[row];
+    state->statuses[col] = VariableStatus::BASIC;
+  }
+}
+}  // namespace
+
+ProblemStatus LPSolver::SolveFromApproximateSolution(
+    const LinearProgram& lp, const DenseRow& primal_values,
+    const DenseColumn& dual_values, TimeLimit* time_limit) {
+  if (time_limit == nullptr) {
+    LOG(DFATAL) << "SolveFromApproximateSolution() called with a nullptr "
+                << "time_limit.";
+    return ProblemStatus::ABNORMAL;
+  }
+  ++num_solves_;
+  num_revised_simplex_iterations_ = 0;
+  if (!lp.IsCleanedUp() || !lp.IsValid()) {
+    LOG(DFATAL) << "The given linear program is invalid or not cleaned up. See "
+                << "SolveWithTimeLimit() for the exact requirements.";
+    ResizeSolution(lp.num_constraints(), lp.num_variables());
+    return ProblemStatus::INVALID_PROBLEM;
+  }
+  if (primal_values.size() != lp.num_variables() ||
+      dual_values.size() != lp.num_constraints()) {
+    LOG(DFATAL) << "The approximate solution does not have the dimensions of "
+                << "the given linear program.";
+    ResizeSolution(lp.num_constraints(), lp.num_variables());
+    return ProblemStatus::INVALID_PROBLEM;
+  }
+
+  BasisState state;
+  ComputeCrossoverBasisFromSolution(lp, primal_values, dual_values, &state);
+  current_linear_program_.PopulateFromLinearProgram(lp);
+  ProblemSolution solution(lp.num_constraints(), lp.num_variables());
+  solution.status = ProblemStatus::INIT;
+
+  // The dual simplex is used for the cleanup: it needs far fewer iterations
+  // than the primal simplex from such a crash basis, which is almost optimal
+  // but usually not primal feasible.
+  const GlopParameters parameters = parameters_;
+  parameters_.set_use_dual_simplex(true);
+  RunRevisedSimplexIfNeeded(&state, &solution, time_limit);
+  parameters_ = parameters;
+  return LoadAndVerifySolution(lp, solution);
+}
 
 double LPSolver::DeterministicTime() const {
   return revised_simplex_ == nullptr ? 0.0
@@ -446,7 +748,8 @@ void LPSolver::ResizeSolution(RowIndex num_rows, ColIndex num_cols) {
   constraint_statuses_.resize(num_rows, ConstraintStatus::FREE);
 }
 
-void LPSolver::RunRevisedSimplexIfNeeded(ProblemSolution* solution,
+void LPSolver::RunRevisedSimplexIfNeeded(const BasisState* initial_state,
+                                         ProblemSolution* solution,
                                          TimeLimit* time_limit) {
   // Note that the transpose matrix is no longer needed at this point.
   // This helps reduce the peak memory usage of the solver.
@@ -456,7 +759,35 @@ void LPSolver::RunRevisedSimplexIfNeeded(ProblemSolution* solution,
     revised_simplex_.reset(new RevisedSimplex());
   }
   revised_simplex_->SetParameters(parameters_);
-  if (revised_simplex_->Solve(current_linear_program_, time_limit).ok()) {
+  int64 num_refactorizations = revised_simplex_->GetNumberOfRefactorizations();
+  bool solved = false;
+  if (initial_state == nullptr && parameters_.use_concurrent_solve()) {
+    solved = RunConcurrentRevisedSimplex(time_limit);
+    num_refactorizations = 0;
+  } else {
+    if (initial_state != nullptr) {
+      revised_simplex_->LoadStateForNextSolve(*initial_state);
+    } else if (parameters_.use_interior_point()) {
+      // The revised simplex does the crossover from the basis guessed with the
+      // interior point solution.
+      InteriorPointSolver interior_point;
+      interior_point.SetParameters(parameters_);
+      interior_point.Solve(current_linear_program_, time_limit);
+      BasisState state;
+      interior_point.ComputeCrossoverBasis(&state);
+      revised_simplex_->LoadStateForNextSolve(state);
+    }
+    solved = revised_simplex_->Solve(current_linear_program_, time_limit).ok();
+  }
+  solve_stats_.feasibility_time = revised_simplex_->GetFeasibilityTime();
+  solve_stats_.optimization_time = revised_simplex_->GetOptimizationTime();
+  solve_stats_.num_feasibility_iterations =
+      revised_simplex_->GetNumberOfFeasibilityIterations();
+  solve_stats_.num_optimization_iterations =
+      revised_simplex_->GetNumberOfOptimizationIterations();
+  solve_stats_.num_refactorizations =
+      revised_simplex_->GetNumberOfRefactorizations() - num_refactorizations;
+  if (solved) {
     num_revised_simplex_iterations_ = revised_simplex_->GetNumberOfIterations();
     solution->status = revised_simplex_->GetProblemStatus();
 
@@ -481,6 +812,91 @@ void LPSolver::RunRevisedSimplexIfNeeded(ProblemSolution* solution,
   }
 }
 
+bool LPSolver::RunConcurrentRevisedSimplex(TimeLimit* time_limit) {
+  // The algorithms raced, each with its own simplex, time limit and copy of
+  // the preprocessed problem (the LinearProgram lazily updates some caches in
+  // its const methods, so it cannot be shared between threads). The workers
+  // use a single thread each.
+  std::vector<GlopParameters> variants;
+  GlopParameters parameters = parameters_;
+  parameters.set_num_omp_threads(1);
+  parameters.set_use_interior_point(false);
+  parameters.set_use_dual_simplex(false);
+  variants.push_back(parameters);
+  parameters.set_use_dual_simplex(true);
+  variants.push_back(parameters);
+  if (parameters_.use_interior_point()) {
+    parameters.set_use_dual_simplex(parameters_.use_dual_simplex());
+    parameters.set_use_interior_point(true);
+    variants.push_back(parameters);
+  }
+  const int num_variants = variants.size();
+  std::vector<std::unique_ptr<RevisedSimplex>> simplexes(num_variants);
+  std::vector<std::unique_ptr<LinearProgram>> lps(num_variants);
+  ParallelTimeLimit parallel_time_limit(time_limit->GetTimeLeft(),
+                                        time_limit->GetDeterministicTimeLeft());
+  std::vector<std::unique_ptr<TimeLimit>> time_limits(num_variants);
+  for (int i = 0; i < num_variants; ++i) {
+    simplexes[i].reset(new RevisedSimplex());
+    simplexes[i]->SetParameters(variants[i]);
+    lps[i].reset(new LinearProgram());
+    lps[i]->PopulateFromLinearProgram(current_linear_program_);
+    time_limits[i] = parallel_time_limit.NewWorkerTimeLimit();
+  }
+
+  // The first worker to finish with a definitive status cancels the others.
+  std::mutex mutex;
+  int winner = -1;
+  ParallelFor parallel_for;
+  parallel_for.SetNumThreads(num_variants);
+  parallel_for.Run(num_variants, 1, [&](int chunk, int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      RevisedSimplex* const simplex = simplexes[i].get();
+      TimeLimit* const worker_time_limit = time_limits[i].get();
+      if (variants[i].use_interior_point()) {
+        InteriorPointSolver interior_point;
+        interior_point.SetParameters(variants[i]);
+        interior_point.Solve(*lps[i], worker_time_limit);
+        BasisState state;
+        interior_point.ComputeCrossoverBasis(&state);
+        simplex->LoadStateForNextSolve(state);
+      }
+      if (!simplex->Solve(*lps[i], worker_time_limit).ok()) continue;
+      const ProblemStatus status = simplex->GetProblemStatus();
+      if (status == ProblemStatus::INIT || status == ProblemStatus::IMPRECISE ||
+          status == ProblemStatus::ABNORMAL ||
+          status == ProblemStatus::PRIMAL_FEASIBLE ||
+          status == ProblemStatus::DUAL_FEASIBLE) {
+        // Not a definitive answer, most likely because of the cancellation.
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      if (winner == -1) {
+        winner = i;
+        parallel_time_limit.Cancel();
+      }
+    }
+  });
+  // Destroying the time limits of the workers accounts their deterministic
+  // time in parallel_time_limit.
+  time_limits.clear();
+  time_limit->AdvanceDeterministicTime(
+      parallel_time_limit.GetElapsedDeterministicTime());
+  if (winner == -1) {
+    VLOG(1) << "No algorithm finished the concurrent solve.";
+    return false;
+  }
+  VLOG(1) << "Concurrent solve won by the "
+          << (variants[winner].use_interior_point()
+                  ? "interior point"
+                  : variants[winner].use_dual_simplex() ? "dual simplex"
+                                                        : "primal simplex");
+  revised_simplex_ = std::move(simplexes[winner]);
+  // The winner keeps the parameters of the LPSolver, for the next solves.
+  revised_simplex_->SetParameters(parameters_);
+  return true;
+}
+
 
 namespace {
 
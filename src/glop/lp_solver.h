@@ -15,6 +15,7 @@
 #define OR_TOOLS_GLOP_LP_SOLVER_H_
 
 #include <memory>
+#include <vector>
 
 #include "glop/parameters.pb.h"
 #include "glop/preprocessor.h"
@@ -25,6 +26,41 @@
 namespace operations_research {
 namespace glop {
 
+// A change of the bounds of one variable of a linear program, as evaluated by
+// LPSolver::SolveBranchings().
+struct BranchingCandidate {
+  BranchingCandidate(ColIndex c, Fractional lb, Fractional ub)
+      : col(c), lower_bound(lb), upper_bound(ub) {}
+
+  ColIndex col;
+  Fractional lower_bound;
+  Fractional upper_bound;
+};
+
+// The evaluation of one BranchingCandidate.
+struct BranchingResult {
+  BranchingResult()
+      : status(ProblemStatus::INIT),
+        objective_value(0.0),
+        objective_change(0.0),
+        num_iterations(0) {}
+
+  // The status of the dual simplex. It is DUAL_FEASIBLE if the iteration
+  // limit was reached, and INIT if the candidate was not evaluated because of
+  // the time limit.
+  ProblemStatus status;
+
+  // The objective value of the last basis, with its offset and scaling. With
+  // the statuses OPTIMAL and DUAL_FEASIBLE, this is a lower bound (for a
+  // minimization) on the objective of the modified linear program.
+  Fractional objective_value;
+
+  // objective_value minus the objective value of the last Solve().
+  Fractional objective_change;
+
+  int64 num_iterations;
+};
+
 // A full-fledged linear programming solver.
 class LPSolver {
  public:
@@ -121,6 +157,66 @@ class LPSolver {
   // Returns the number of simplex iterations used by the last Solve().
   int GetNumberOfSimplexIterations() const;
 
+  // Statistics about the phases of the last Solve(). Times are wall times in
+  // seconds. The preprocessing includes the scaling, and the postsolve
+  // includes the verification of the solution. The simplex statistics stay
+  // at zero if the problem was solved by the preprocessors.
+  struct SolveStats {
+    SolveStats()
+        : preprocessing_time(0.0),
+          feasibility_time(0.0),
+          optimization_time(0.0),
+          postsolve_time(0.0),
+          num_feasibility_iterations(0),
+          num_optimization_iterations(0),
+          num_refactorizations(0) {}
+    double preprocessing_time;
+    double feasibility_time;
+    double optimization_time;
+    double postsolve_time;
+    int64 num_feasibility_iterations;
+    int64 num_optimization_iterations;
+    int64 num_refactorizations;
+  };
+  const SolveStats& GetSolveStats() const { return solve_stats_; }
+
+  // Strong branching: evaluates the objective of the given lp when the bounds
+  // of one variable are changed, for each of the given candidates. The last
+  // Solve() must have been called on lp and have returned OPTIMAL.
+  //
+  // The optimal basis of the last Solve() is loaded once in a RevisedSimplex
+  // to get a complete starting state (including the dual edge norms). Each
+  // candidate is then solved by the dual simplex from this shared state, with
+  // at most max_number_of_branching_iterations iterations. The candidates are
+  // split among num_omp_threads threads, each with its own RevisedSimplex and
+  // copy of lp, so the results do not depend on the number of threads. The
+  // solution of the last Solve() is not modified.
+  //
+  // Note that lp is used as is, without preprocessing nor scaling.
+  void SolveBranchings(const LinearProgram& lp,
+                       const std::vector<BranchingCandidate>& candidates,
+                       TimeLimit* time_limit,
+                       std::vector<BranchingResult>* results);
+
+  // Crossover: solves lp starting from the given approximate primal and dual
+  // solution, for instance one computed by a first-order method. The vectors
+  // are indexed by the variables and constraints of lp, and the dual values
+  // follow the dual_values() convention.
+  //
+  // A crash basis is built from this solution: each variable (and constraint
+  // slack) is scored by the ratio between its distance to its closest bound
+  // and its reduced cost (resp. dual value), and the basis is completed into a
+  // triangular one by decreasing score, see
+  // InitialBasis::CompleteTriangularBasisFromScores(). The non-basic variables
+  // are put at their closest bound. The revised simplex then cleans up the
+  // primal and dual infeasibilities of this basis, and the solution can be
+  // retrieved with the usual getters.
+  //
+  // Note that lp is solved as is, without preprocessing nor scaling, since the
+  // given solution refers to it.
+  ProblemStatus SolveFromApproximateSolution(
+      const LinearProgram& lp, const DenseRow& primal_values,
+      const DenseColumn& dual_values, TimeLimit* time_limit) MUST_USE_RESULT;
 
   // Returns the "deterministic time" since the creation of the solver. Note
   // That this time is only increased when some operations take place in this
@@ -145,10 +241,19 @@ class LPSolver {
   void MoveDualValuesWithinBounds(const LinearProgram& lp);
 
   // Runs the revised simplex algorithm if needed (i.e. if the program was not
-  // already solved by the preprocessors).
-  void RunRevisedSimplexIfNeeded(ProblemSolution* solution,
+  // already solved by the preprocessors). If initial_state is not null, it is
+  // loaded in the simplex before the solve instead of the state guessed by the
+  // interior point (if use_interior_point is true).
+  void RunRevisedSimplexIfNeeded(const BasisState* initial_state,
+                                 ProblemSolution* solution,
                                  TimeLimit* time_limit);
 
+  // Used by RunRevisedSimplexIfNeeded() when use_concurrent_solve is true.
+  // Solves current_linear_program_ with several algorithms in parallel and
+  // sets revised_simplex_ to the one that finished first. Returns false if
+  // none of them succeeded.
+  bool RunConcurrentRevisedSimplex(TimeLimit* time_limit);
+
 
   // Checks that the returned solution values and statuses are consistent.
   // Returns true if this is the case. See the code for the exact check
@@ -231,6 +336,9 @@ class LPSolver {
   // The number of revised simplex iterations used by the last Solve().
   int num_revised_simplex_iterations_;
 
+  // Statistics about the last Solve().
+  SolveStats solve_stats_;
+
 
   // The current ProblemSolution.
   // TODO(user): use a ProblemSolution directly?
@@ -20,10 +20,13 @@ namespace glop {
 
 LuFactorization::LuFactorization()
     : is_identity_factorization_(true),
+      factors_memory_(GLOP_LU),
       col_perm_(),
       inverse_col_perm_(),
       row_perm_(),
-      inverse_row_perm_() {}
+      inverse_row_perm_(),
+      average_result_density_(0.0),
+      use_single_precision_solves_(false) {}
 
 void LuFactorization::Clear() {
   SCOPED_TIME_STAT(&stats_);
@@ -31,11 +34,15 @@ void LuFactorization::Clear() {
   upper_.Reset(RowIndex(0));
   transpose_upper_.Reset(RowIndex(0));
   transpose_lower_.Reset(RowIndex(0));
+  factors_memory_.Set(0);
   is_identity_factorization_ = true;
   col_perm_.clear();
   row_perm_.clear();
   inverse_row_perm_.clear();
   inverse_col_perm_.clear();
+  average_result_density_ = 0.0;
+  use_single_precision_solves_ = false;
+  basis_columns_.clear();
 }
 
 Status LuFactorization::ComputeFactorization(const MatrixView& matrix) {
@@ -50,7 +57,21 @@ Status LuFactorization::ComputeFactorization(const MatrixView& matrix) {
   inverse_col_perm_.PopulateFromInverse(col_perm_);
   inverse_row_perm_.PopulateFromInverse(row_perm_);
   ComputeTransposeUpper();
+  if (parameters_.use_single_precision_lu()) {
+    lower_.ComputeSinglePrecisionCoefficients();
+    upper_.ComputeSinglePrecisionCoefficients();
+    basis_columns_.resize(matrix.num_cols(), nullptr);
+    for (ColIndex col(0); col < matrix.num_cols(); ++col) {
+      basis_columns_[col] = &matrix.column(col);
+    }
+    use_single_precision_solves_ = true;
+  }
 
+  const EntryIndex num_factor_entries = lower_.num_entries() +
+                                        upper_.num_entries() +
+                                        transpose_upper_.num_entries();
+  factors_memory_.Set(num_factor_entries.value() *
+                      (sizeof(RowIndex) + sizeof(Fractional)));
   is_identity_factorization_ = false;
   IF_STATS_ENABLED({
     stats_.lu_fill_in.Add(GetFillInPercentage(matrix));
@@ -63,6 +84,7 @@ Status LuFactorization::ComputeFactorization(const MatrixView& matrix) {
 void LuFactorization::RightSolve(DenseColumn* x) const {
   SCOPED_TIME_STAT(&stats_);
   if (is_identity_factorization_) return;
+  if (use_single_precision_solves_ && SinglePrecisionRightSolve(x)) return;
   ApplyPermutation(row_perm_, *x, &dense_column_scratchpad_);
   lower_.LowerSolve(&dense_column_scratchpad_);
   upper_.UpperSolve(&dense_column_scratchpad_);
@@ -79,10 +101,77 @@ void LuFactorization::SparseRightSolve(const SparseColumn& b, RowIndex num_rows,
   DCHECK_EQ(num_rows, lower_.num_rows());
   DCHECK_EQ(num_rows, row_perm_.size());
 
-  b.PermutedCopyToDenseVector(row_perm_, num_rows, &dense_column_scratchpad_);
-  lower_.LowerSolve(&dense_column_scratchpad_);
-  upper_.UpperSolve(&dense_column_scratchpad_);
-  ApplyPermutation(inverse_col_perm_, dense_column_scratchpad_, x);
+  non_zero_rows_.clear();
+  dense_zero_scratchpad_.resize(num_rows, 0.0);
+  DCHECK(IsAllZero(dense_zero_scratchpad_));
+  for (const SparseColumn::Entry e : b) {
+    const RowIndex permuted_row = row_perm_[e.row()];
+    dense_zero_scratchpad_[permuted_row] = e.coefficient();
+    non_zero_rows_.push_back(permuted_row);
+  }
+
+  // Same logic as in RightSolveSquaredNorm(), we fall back to the dense solves
+  // as soon as the DFS aborts.
+  if (ResultIsPredictedHypersparse()) {
+    lower_.TriangularComputeRowsToConsider(&non_zero_rows_);
+  } else {
+    non_zero_rows_.clear();
+  }
+  if (non_zero_rows_.empty()) {
+    lower_.LowerSolve(&dense_zero_scratchpad_);
+  } else {
+    lower_.SparseTriangularSolve(non_zero_rows_, &dense_zero_scratchpad_);
+    upper_.TriangularComputeRowsToConsider(&non_zero_rows_);
+  }
+  if (non_zero_rows_.empty()) {
+    upper_.UpperSolve(&dense_zero_scratchpad_);
+    x->swap(dense_zero_scratchpad_);
+    dense_zero_scratchpad_.AssignToZero(num_rows);
+    if (col_perm_.empty()) {
+      ComputeNonZeros(*x, &non_zero_rows_);
+    } else {
+      PermuteAndComputeNonZeros(inverse_col_perm_, &dense_zero_scratchpad_, x,
+                                &non_zero_rows_);
+    }
+  } else {
+    upper_.SparseTriangularSolve(non_zero_rows_, &dense_zero_scratchpad_);
+    x->AssignToZero(num_rows);
+    for (const RowIndex row : non_zero_rows_) {
+      const RowIndex permuted_row =
+          col_perm_.empty()
+              ? row
+              : ColToRowIndex(inverse_col_perm_[RowToColIndex(row)]);
+      (*x)[permuted_row] = dense_zero_scratchpad_[row];
+      dense_zero_scratchpad_[row] = 0.0;
+    }
+  }
+  UpdateResultDensity(non_zero_rows_.size());
+  non_zero_rows_.clear();
+}
+
+namespace {
+// A right solve is done with the hyper-sparse algorithm only if the average
+// density of the recent results is below this ratio. It is lower than the
+// ratio of the number of operations over the number of rows at which
+// TriangularMatrix::TriangularComputeRowsToConsider() aborts, so that the
+// DFS is rarely wasted.
+const double kHypersparseResultDensity = 0.05;
+
+// Weight of the last result in average_result_density_.
+const double kResultDensityDecay = 0.1;
+}  // namespace
+
+bool LuFactorization::ResultIsPredictedHypersparse() const {
+  return average_result_density_ < kHypersparseResultDensity;
+}
+
+void LuFactorization::UpdateResultDensity(int num_non_zeros) const {
+  const RowIndex num_rows = lower_.num_rows();
+  if (num_rows == 0) return;
+  const double density = static_cast<double>(num_non_zeros) /
+                         static_cast<double>(num_rows.value());
+  average_result_density_ +=
+      kResultDensityDecay * (density - average_result_density_);
 }
 
 namespace {
@@ -135,6 +224,105 @@ Fractional LuFactorization::RightSolveSquaredNorm(const SparseColumn& a) const {
                                           &dense_zero_scratchpad_);
 }
 
+namespace {
+
+// Returns the infinity norm of the given dense vector.
+template <typename DenseVector>
+Fractional InfinityNorm(const DenseVector& v) {
+  Fractional norm(0.0);
+  for (const Fractional value : v) norm = std::max(norm, fabs(value));
+  return norm;
+}
+
+}  // namespace
+
+// Solves B.x = b with the single precision factors, then refines the result
+// with x += B^{-1}.(b - B.x), the residual being computed in double precision
+// with the columns of B.
+bool LuFactorization::SinglePrecisionRightSolve(DenseColumn* x) const {
+  refinement_rhs_ = *x;
+  const Fractional tolerance =
+      parameters_.lu_refinement_tolerance() *
+      std::max(Fractional(1.0), InfinityNorm(refinement_rhs_));
+  const ColIndex num_cols = basis_columns_.size();
+  for (int step = 0;; ++step) {
+    // At the first step, the residual is b itself and x is 0.
+    DenseColumn* const correction = step == 0 ? x : &refinement_residual_;
+    ApplyPermutation(row_perm_, *correction, &dense_column_scratchpad_);
+    lower_.LowerSolveInSinglePrecision(&dense_column_scratchpad_);
+    upper_.UpperSolveInSinglePrecision(&dense_column_scratchpad_);
+    if (step == 0) {
+      ApplyPermutation(inverse_col_perm_, dense_column_scratchpad_, x);
+    } else {
+      ApplyPermutation(inverse_col_perm_, dense_column_scratchpad_,
+                       &refinement_residual_);
+      for (RowIndex row(0); row < x->size(); ++row) {
+        (*x)[row] += refinement_residual_[row];
+      }
+    }
+
+    refinement_residual_ = refinement_rhs_;
+    for (ColIndex col(0); col < num_cols; ++col) {
+      const Fractional value = (*x)[ColToRowIndex(col)];
+      if (value == 0.0) continue;
+      for (const SparseColumn::Entry e : *basis_columns_[col]) {
+        refinement_residual_[e.row()] -= e.coefficient() * value;
+      }
+    }
+    if (InfinityNorm(refinement_residual_) <= tolerance) return true;
+    if (step >= parameters_.lu_max_refinement_steps()) break;
+  }
+  VLOG(1) << "Single precision LU refinement did not converge, switching to "
+          << "double precision until the next factorization.";
+  use_single_precision_solves_ = false;
+  *x = refinement_rhs_;
+  return false;
+}
+
+// Same as SinglePrecisionRightSolve() for y.B = r. The residual coefficient of
+// each column is r_j - B_j.y.
+bool LuFactorization::SinglePrecisionLeftSolve(DenseRow* y) const {
+  // We need to interpret y as a column for the permutation functions.
+  DenseColumn* const x = reinterpret_cast<DenseColumn*>(y);
+  refinement_rhs_ = *x;
+  const Fractional tolerance =
+      parameters_.lu_refinement_tolerance() *
+      std::max(Fractional(1.0), InfinityNorm(refinement_rhs_));
+  const ColIndex num_cols = basis_columns_.size();
+  for (int step = 0;; ++step) {
+    DenseColumn* const correction = step == 0 ? x : &refinement_residual_;
+    ApplyInversePermutation(inverse_col_perm_, *correction,
+                            &dense_column_scratchpad_);
+    upper_.TransposeUpperSolveInSinglePrecision(&dense_column_scratchpad_);
+    lower_.TransposeLowerSolveInSinglePrecision(&dense_column_scratchpad_);
+    if (step == 0) {
+      ApplyInversePermutation(row_perm_, dense_column_scratchpad_, x);
+    } else {
+      ApplyInversePermutation(row_perm_, dense_column_scratchpad_,
+                              &refinement_residual_);
+      for (RowIndex row(0); row < x->size(); ++row) {
+        (*x)[row] += refinement_residual_[row];
+      }
+    }
+
+    refinement_residual_.resize(refinement_rhs_.size(), 0.0);
+    for (ColIndex col(0); col < num_cols; ++col) {
+      Fractional sum = refinement_rhs_[ColToRowIndex(col)];
+      for (const SparseColumn::Entry e : *basis_columns_[col]) {
+        sum -= e.coefficient() * (*x)[e.row()];
+      }
+      refinement_residual_[ColToRowIndex(col)] = sum;
+    }
+    if (InfinityNorm(refinement_residual_) <= tolerance) return true;
+    if (step >= parameters_.lu_max_refinement_steps()) break;
+  }
+  VLOG(1) << "Single precision LU refinement did not converge, switching to "
+          << "double precision until the next factorization.";
+  use_single_precision_solves_ = false;
+  *x = refinement_rhs_;
+  return false;
+}
+
 void LuFactorization::LeftSolveScratchpad() const {
   upper_.TransposeUpperSolve(&dense_column_scratchpad_);
   lower_.TransposeLowerSolve(&dense_column_scratchpad_, nullptr);
@@ -142,41 +330,52 @@ void LuFactorization::LeftSolveScratchpad() const {
 
 Fractional LuFactorization::DualEdgeSquaredNorm(RowIndex row) const {
   if (is_identity_factorization_) return 1.0;
-  if (transpose_lower_.IsEmpty()) {
+  PrepareForConcurrentSolves();
+  SCOPED_TIME_STAT(&stats_);
+  return DualEdgeSquaredNormWithScratchpad(row, &dual_edge_scratchpad_);
+}
+
+void LuFactorization::PrepareForConcurrentSolves() const {
+  if (!is_identity_factorization_ && transpose_lower_.IsEmpty()) {
     ComputeTransposeLower();
   }
-  SCOPED_TIME_STAT(&stats_);
+}
+
+Fractional LuFactorization::DualEdgeSquaredNormWithScratchpad(
+    RowIndex row, Scratchpad* scratchpad) const {
+  if (is_identity_factorization_) return 1.0;
   const RowIndex permuted_row =
       col_perm_.empty() ? row : ColToRowIndex(col_perm_[RowToColIndex(row)]);
 
-  non_zero_rows_.clear();
-  dense_zero_scratchpad_.resize(lower_.num_rows(), 0.0);
-  DCHECK(IsAllZero(dense_zero_scratchpad_));
-  dense_zero_scratchpad_[permuted_row] = 1.0;
-  non_zero_rows_.push_back(permuted_row);
-
-  transpose_upper_.TriangularComputeRowsToConsider(&non_zero_rows_);
-  if (non_zero_rows_.empty()) {
-    transpose_upper_.LowerSolveStartingAt(RowToColIndex(permuted_row),
-                                          &dense_zero_scratchpad_);
+  DenseColumn* const column = &scratchpad->dense_zero_column;
+  std::vector<RowIndex>* const non_zero_rows = &scratchpad->non_zero_rows;
+  non_zero_rows->clear();
+  column->resize(lower_.num_rows(), 0.0);
+  DCHECK(IsAllZero(*column));
+  (*column)[permuted_row] = 1.0;
+  non_zero_rows->push_back(permuted_row);
+
+  transpose_upper_.TriangularComputeRowsToConsider(
+      non_zero_rows, &scratchpad->stored, &scratchpad->nodes_to_explore);
+  if (non_zero_rows->empty()) {
+    transpose_upper_.LowerSolveStartingAt(RowToColIndex(permuted_row), column);
   } else {
-    transpose_upper_.SparseTriangularSolve(non_zero_rows_,
-                                           &dense_zero_scratchpad_);
-    transpose_lower_.TriangularComputeRowsToConsider(&non_zero_rows_);
+    transpose_upper_.SparseTriangularSolve(*non_zero_rows, column);
+    transpose_lower_.TriangularComputeRowsToConsider(
+        non_zero_rows, &scratchpad->stored, &scratchpad->nodes_to_explore);
   }
-  if (non_zero_rows_.empty()) {
-    lower_.TransposeLowerSolve(&dense_zero_scratchpad_, nullptr);
+  if (non_zero_rows->empty()) {
+    lower_.TransposeLowerSolve(column, nullptr);
   } else {
-    transpose_lower_.SparseTriangularSolve(non_zero_rows_,
-                                           &dense_zero_scratchpad_);
+    transpose_lower_.SparseTriangularSolve(*non_zero_rows, column);
   }
-  return ComputeSquaredNormAndResetToZero(non_zero_rows_,
-                                          &dense_zero_scratchpad_);
+  return ComputeSquaredNormAndResetToZero(*non_zero_rows, column);
 }
 
 void LuFactorization::LeftSolve(DenseRow* y) const {
   SCOPED_TIME_STAT(&stats_);
   if (is_identity_factorization_) return;
+  if (use_single_precision_solves_ && SinglePrecisionLeftSolve(y)) return;
   // We need to interpret y as a column for the permutation functions.
   DenseColumn* const x = reinterpret_cast<DenseColumn*>(y);
   ApplyInversePermutation(inverse_col_perm_, *x, &dense_column_scratchpad_);
@@ -263,11 +462,20 @@ void LuFactorization::LeftSolveL(DenseRow* y) const {
 
 void LuFactorization::RightSolveLForSparseColumn(const SparseColumn& b,
                                                  DenseColumn* x) const {
+  RightSolveLForSparseColumn(b, x, &non_zero_rows_);
+  non_zero_rows_.clear();
+}
+
+void LuFactorization::RightSolveLForSparseColumn(
+    const SparseColumn& b, DenseColumn* x,
+    std::vector<RowIndex>* non_zeros) const {
   SCOPED_TIME_STAT(&stats_);
   DCHECK(IsAllZero(*x));
+  non_zeros->clear();
   if (is_identity_factorization_) {
     for (const SparseColumn::Entry e : b) {
       (*x)[e.row()] = e.coefficient();
+      non_zeros->push_back(e.row());
     }
     return;
   }
@@ -282,6 +490,7 @@ void LuFactorization::RightSolveLForSparseColumn(const SparseColumn& b,
   for (const SparseColumn::Entry e : b) {
     const RowIndex permuted_row = row_perm_[e.row()];
     (*x)[permuted_row] = e.coefficient();
+    non_zeros->push_back(permuted_row);
 
     // The second condition only works because lower_ only has 1.0
     // element on its diagonal.
@@ -293,7 +502,17 @@ void LuFactorization::RightSolveLForSparseColumn(const SparseColumn& b,
     first_column_to_consider = std::min(first_column_to_consider, col);
   }
 
-  // TODO(user): Use an hyper-sparse solve here?
+  // Nothing to do if b only touches identity columns of lower_.
+  if (first_column_to_consider == RowToColIndex(x->size())) return;
+
+  if (ResultIsPredictedHypersparse()) {
+    lower_.TriangularComputeRowsToConsider(non_zeros);
+    if (!non_zeros->empty()) {
+      lower_.SparseTriangularSolve(*non_zeros, x);
+      return;
+    }
+  }
+  non_zeros->clear();
   lower_.LowerSolveStartingAt(first_column_to_consider, x);
 }
 
@@ -311,6 +530,34 @@ void LuFactorization::RightSolveUWithNonZeros(
   }
 }
 
+void LuFactorization::RightSolveUWithKnownNonZeros(
+    DenseColumn* x, std::vector<RowIndex>* non_zeros) const {
+  SCOPED_TIME_STAT(&stats_);
+  if (is_identity_factorization_) {
+    if (non_zeros->empty()) ComputeNonZeros(*x, non_zeros);
+    return;
+  }
+  if (!non_zeros->empty() && ResultIsPredictedHypersparse()) {
+    upper_.TriangularComputeRowsToConsider(non_zeros);
+  } else {
+    non_zeros->clear();
+  }
+  if (non_zeros->empty()) {
+    upper_.UpperSolveWithNonZeros(x, non_zeros);
+    if (!col_perm_.empty()) {
+      PermuteAndComputeNonZeros(inverse_col_perm_, &dense_zero_scratchpad_, x,
+                                non_zeros);
+    }
+  } else {
+    upper_.SparseTriangularSolve(*non_zeros, x);
+    if (!col_perm_.empty()) {
+      PermuteWithKnownNonZeros(inverse_col_perm_, &dense_zero_scratchpad_, x,
+                               non_zeros);
+    }
+  }
+  UpdateResultDensity(non_zeros->size());
+}
+
 void LuFactorization::LeftSolveLWithNonZeros(
     DenseRow* y, ColIndexVector* non_zeros,
     DenseColumn* result_before_permutation) const {
@@ -14,6 +14,7 @@
 #ifndef OR_TOOLS_GLOP_LU_FACTORIZATION_H_
 #define OR_TOOLS_GLOP_LU_FACTORIZATION_H_
 
+#include "base/memory_accounting.h"
 #include "glop/markowitz.h"
 #include "glop/parameters.pb.h"
 #include "glop/status.h"
@@ -61,6 +62,9 @@ class LuFactorization {
   // and once this is done, then a client can call this and effectively remove
   // the need for a column permutation on each solve.
   void SetColumnPermutationToIdentity() {
+    if (!col_perm_.empty() && !basis_columns_.empty()) {
+      ApplyColumnPermutationToRowIndexedVector(col_perm_, &basis_columns_);
+    }
     col_perm_.clear();
     inverse_col_perm_.clear();
   }
@@ -71,11 +75,18 @@ class LuFactorization {
   // 2/ solve L.z = y for z,
   // 3/ solve U.t = z for t,
   // 4/ finally solve Q.x = t, by computing x = Q^{-1}.t.
+  //
+  // With use_single_precision_lu, the solve uses the single precision factors
+  // followed by an iterative refinement, see parameters.proto.
   void RightSolve(DenseColumn* x) const;
 
   // Same as RightSolve(), but takes a SparseColumn b as an input. It also needs
   // the number of rows because if the matrix is the identity matrix, this is
   // not stored in this class or in the given sparse column.
+  //
+  // When the result is predicted to be hyper-sparse, the L and U solves only
+  // touch the positions reachable from the non-zeros of b, see
+  // ResultIsPredictedHypersparse().
   void SparseRightSolve(const SparseColumn& b, RowIndex num_rows,
                         DenseColumn* x) const;
 
@@ -88,6 +99,7 @@ class LuFactorization {
   // 2/ solve U^T.z = y for z,
   // 3/ solve L^T.t = z for t,
   // 4/ finally, solve P.x = t for x by computing x = P^{-1}.t.
+  // Like RightSolve(), this may use the single precision factors.
   void LeftSolve(DenseRow* y) const;
 
   // Same as LeftSolve(), but exploits the given non_zeros of the input.
@@ -109,6 +121,12 @@ class LuFactorization {
   // Important: the output x must be of the correct size and all zero.
   void RightSolveLForSparseColumn(const SparseColumn& b, DenseColumn* x) const;
 
+  // Same as above, but also returns in non_zeros a superset of the non-zero
+  // positions of the result in the REVERSE order in which they were computed.
+  // non_zeros is left empty if a dense solve was used.
+  void RightSolveLForSparseColumn(const SparseColumn& b, DenseColumn* x,
+                                  std::vector<RowIndex>* non_zeros) const;
+
   // Specialized version of RightSolveL() where x is originaly equal to
   // 'a' permuted by row_perm_. Note that 'a' is only used for DCHECK or when
   // is_identity_factorization_ is true, in which case the assumption of x is
@@ -129,6 +147,13 @@ class LuFactorization {
   void RightSolveUWithNonZeros(DenseColumn* x,
                                std::vector<RowIndex>* non_zeros) const;
 
+  // Same as RightSolveUWithNonZeros(), except that the initial non_zeros must
+  // be either empty or contain all the non-zero positions of x. In the latter
+  // case, a hyper-sparse solve is used if the result is predicted to be
+  // sparse. The non_zeros of the result are not ordered.
+  void RightSolveUWithKnownNonZeros(DenseColumn* x,
+                                    std::vector<RowIndex>* non_zeros) const;
+
   // Specialized version of LeftSolveL() that also computes the non-zero
   // pattern of the output. Note that the initial value of non_zeros is not
   // used. Moreover, if result_before_permutation is not NULL, it is filled with
@@ -146,6 +171,23 @@ class LuFactorization {
   // Returns the norm of (B^T)^{-1}.e_row where e is an unit vector.
   Fractional DualEdgeSquaredNorm(RowIndex row) const;
 
+  // Scratch data for DualEdgeSquaredNormWithScratchpad(). The dense column is
+  // always left at zero.
+  struct Scratchpad {
+    DenseColumn dense_zero_column;
+    std::vector<RowIndex> non_zero_rows;
+    DenseBooleanColumn stored;
+    std::vector<RowIndex> nodes_to_explore;
+  };
+
+  // Same as DualEdgeSquaredNorm(), but only modifies the given scratchpad and
+  // does not update the stats. It can thus be called concurrently from several
+  // threads, each with its own scratchpad, once PrepareForConcurrentSolves()
+  // was called.
+  Fractional DualEdgeSquaredNormWithScratchpad(RowIndex row,
+                                               Scratchpad* scratchpad) const;
+  void PrepareForConcurrentSolves() const;
+
   // The fill-in of the LU-factorization is defined as the sum of the number
   // of entries of both the lower- and upper-triangular matrices L and U minus
   // the number of entries in the initial matrix B.
@@ -231,9 +273,23 @@ class LuFactorization {
     RatioDistribution lu_fill_in;
   };
 
+  // The decision of using a hyper-sparse right solve is made before each solve
+  // from the average density of the recent right solve results. This is
+  // needed because the symbolic phase of the hyper-sparse solve, a DFS in the
+  // graph of L or U as in the Gilbert-Peierls algorithm, is wasted when it
+  // aborts because the result has too many non-zeros.
+  bool ResultIsPredictedHypersparse() const;
+  void UpdateResultDensity(int num_non_zeros) const;
+
   // Internal function used in the left solve functions.
   void LeftSolveScratchpad() const;
 
+  // Versions of RightSolve() and LeftSolve() using the single precision
+  // factors and the iterative refinement. They return false, leaving the input
+  // unchanged, if the refinement did not converge.
+  bool SinglePrecisionRightSolve(DenseColumn* x) const;
+  bool SinglePrecisionLeftSolve(DenseRow* y) const;
+
   // Fills transpose_upper_ from upper_.
   void ComputeTransposeUpper();
 
@@ -260,6 +316,9 @@ class LuFactorization {
   // and mutable so it can be lazily initialized.
   mutable TriangularMatrix transpose_lower_;
 
+  // Accounts the memory used by lower_, upper_ and transpose_upper_.
+  MemoryUsageTracker factors_memory_;
+
   // The column permutation Q and its inverse Q^{-1} in P.B.Q^{-1} = L.U.
   ColumnPermutation col_perm_;
   ColumnPermutation inverse_col_perm_;
@@ -280,6 +339,27 @@ class LuFactorization {
   mutable DenseColumn dense_zero_scratchpad_;
   mutable std::vector<RowIndex> non_zero_rows_;
 
+  // Used by DualEdgeSquaredNorm().
+  mutable Scratchpad dual_edge_scratchpad_;
+
+  // Exponential moving average of the fraction of non-zeros in the results of
+  // the right solves since the last factorization.
+  mutable double average_result_density_;
+
+  // Whether RightSolve() and LeftSolve() use the single precision factors. It
+  // is set by ComputeFactorization() if use_single_precision_lu is true, and
+  // reset when a refinement does not converge.
+  mutable bool use_single_precision_solves_;
+
+  // The columns of the factorized matrix B, needed to compute the residuals
+  // of the iterative refinement. They are only filled if
+  // use_single_precision_lu is true.
+  StrictITIVector<ColIndex, const SparseColumn*> basis_columns_;
+
+  // Temporary storage used by the iterative refinement.
+  mutable DenseColumn refinement_rhs_;
+  mutable DenseColumn refinement_residual_;
+
   // Statistics, mutable so const functions can still update it.
   mutable Stats stats_;
 
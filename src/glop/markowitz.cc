@@ -13,6 +13,7 @@
 
 #include "glop/markowitz.h"
 
+#include <algorithm>
 #include <limits>
 #include "base/stringprintf.h"
 #include "lp_data/lp_utils.h"
@@ -41,6 +42,7 @@ Status Markowitz::ComputeRowAndColumnPermutation(const MatrixView& basis_matrix,
   permuted_upper_.PopulateFromZero(num_rows, num_cols);
   permuted_lower_column_needs_solve_.assign(num_cols, false);
   contains_only_singleton_columns_ = true;
+  residual_min_col_degree_ = 0;
 
   // Start by moving the singleton columns to the front and by putting their
   // non-zero coefficient on the diagonal. The general algorithm below would
@@ -60,14 +62,23 @@ Status Markowitz::ComputeRowAndColumnPermutation(const MatrixView& basis_matrix,
   const Fractional singularity_threshold =
       parameters_.markowitz_singularity_threshold();
   while (index < end_index) {
+    // Switch to a dense factorization once the residual matrix is dense. The
+    // density is estimated from the minimum column degree of the residual
+    // matrix, so this can only happen after FindPivot() used col_by_degree_.
+    //
+    // TODO(user): If we don't need L and U, we can abort when the residual
+    // matrix becomes dense.
+    if (!contains_only_singleton_columns_ && num_rows.value() == end_index &&
+        num_cols.value() == end_index &&
+        ResidualMatrixIsDense(end_index - index)) {
+      stats_.dense_residual_ratio.Add(1.0 * (end_index - index) / end_index);
+      RETURN_IF_ERROR(FactorizeDenseResidualMatrix(row_perm, col_perm, &index));
+      break;
+    }
+
     Fractional pivot_coefficient = 0.0;
     RowIndex pivot_row = kInvalidRow;
     ColIndex pivot_col = kInvalidCol;
-
-    // TODO(user): If we don't need L and U, we can abort when the residual
-    // matrix becomes dense (i.e. when its density factor is above a certain
-    // threshold). The residual size is 'end_index - index' and the
-    // density can either be computed exactly or estimated from min_markowitz.
     const int64 min_markowitz = FindPivot(*row_perm, *col_perm, &pivot_row,
                                           &pivot_col, &pivot_coefficient);
 
@@ -316,6 +327,7 @@ int64 Markowitz::FindPivot(const RowPermutation& row_perm,
                            RowIndex* pivot_row, ColIndex* pivot_col,
                            Fractional* pivot_coefficient) {
   SCOPED_TIME_STAT(&stats_);
+  residual_min_col_degree_ = 0;
 
   // Fast track for singleton columns.
   while (!singleton_column_.empty()) {
@@ -406,6 +418,7 @@ int64 Markowitz::FindPivot(const RowPermutation& row_perm,
     if (col_perm[col] != kInvalidCol) continue;
     const int col_degree = residual_matrix_non_zero_.ColDegree(col);
     examined_col_.push_back(col);
+    if (examined_col_.size() == 1) residual_min_col_degree_ = col_degree;
 
     // Because of the two singleton special cases at the beginning of this
     // function and because we process columns by increasing degree, we can
@@ -483,6 +496,143 @@ int64 Markowitz::FindPivot(const RowPermutation& row_perm,
   return min_markowitz_number;
 }
 
+bool Markowitz::ResidualMatrixIsDense(int residual_size) const {
+  // Below this size, the sparse algorithm is fast enough and the dense one
+  // is not worth its O(residual_size^2) memory.
+  const int kMinDenseResidualSize = 16;
+  if (residual_size < kMinDenseResidualSize) return false;
+
+  // The degree of a column decreases by at most one at each pivot.
+  return residual_min_col_degree_ - 1 >=
+         parameters_.markowitz_dense_switch_density() * residual_size;
+}
+
+Status Markowitz::FactorizeDenseResidualMatrix(RowPermutation* row_perm,
+                                               ColumnPermutation* col_perm,
+                                               int* index) {
+  SCOPED_TIME_STAT(&stats_);
+  const RowIndex num_rows = row_perm->size();
+  const ColIndex num_cols = col_perm->size();
+
+  // Collect the rows and columns of the residual matrix, and copy it into
+  // dense_residual_ in column-major order.
+  std::vector<RowIndex> rows;
+  std::vector<ColIndex> cols;
+  StrictITIVector<RowIndex, int> dense_position(num_rows, -1);
+  for (RowIndex row(0); row < num_rows; ++row) {
+    if ((*row_perm)[row] != kInvalidRow) continue;
+    dense_position[row] = rows.size();
+    rows.push_back(row);
+  }
+  for (ColIndex col(0); col < num_cols; ++col) {
+    if ((*col_perm)[col] == kInvalidCol) cols.push_back(col);
+  }
+  const int n = rows.size();
+  DCHECK_EQ(n, cols.size());
+  dense_residual_.assign(static_cast<size_t>(n) * n, 0.0);
+  for (int j = 0; j < n; ++j) {
+    Fractional* const dense_column =
+        &dense_residual_[static_cast<size_t>(j) * n];
+    for (const SparseColumn::Entry e : ComputeColumn(*row_perm, cols[j])) {
+      DCHECK_NE(dense_position[e.row()], -1);
+      dense_column[dense_position[e.row()]] = e.coefficient();
+    }
+  }
+
+  // Gaussian elimination with partial pivoting. At the end, the columns
+  // [0, num_independent) of dense_residual_ contain the U entries above the
+  // diagonal and the L multipliers below it, for the rows in the order of
+  // 'rows'. A column without any pivot of large enough magnitude depends on
+  // the previous ones, it is moved to the end and ignored.
+  const Fractional singularity_threshold =
+      parameters_.markowitz_singularity_threshold();
+  Fractional singular_pivot_magnitude = 0.0;
+  int num_independent = n;
+  int k = 0;
+  while (k < num_independent) {
+    Fractional* const column_k = &dense_residual_[static_cast<size_t>(k) * n];
+    int pivot = k;
+    Fractional max_magnitude = 0.0;
+    for (int i = k; i < n; ++i) {
+      const Fractional magnitude = fabs(column_k[i]);
+      if (magnitude > max_magnitude) {
+        max_magnitude = magnitude;
+        pivot = i;
+      }
+    }
+    if (max_magnitude <= singularity_threshold) {
+      singular_pivot_magnitude = max_magnitude;
+      --num_independent;
+      std::swap_ranges(
+          column_k, column_k + n,
+          &dense_residual_[static_cast<size_t>(num_independent) * n]);
+      std::swap(cols[k], cols[num_independent]);
+      continue;
+    }
+    if (pivot != k) {
+      for (int j = 0; j < n; ++j) {
+        const size_t start = static_cast<size_t>(j) * n;
+        std::swap(dense_residual_[start + k], dense_residual_[start + pivot]);
+      }
+      std::swap(rows[k], rows[pivot]);
+    }
+    const Fractional pivot_coefficient = column_k[k];
+    for (int i = k + 1; i < n; ++i) {
+      column_k[i] /= pivot_coefficient;
+    }
+    for (int j = k + 1; j < num_independent; ++j) {
+      Fractional* const column_j = &dense_residual_[static_cast<size_t>(j) * n];
+      const Fractional multiplier = column_j[k];
+      if (multiplier == 0.0) continue;
+      for (int i = k + 1; i < n; ++i) {
+        column_j[i] -= multiplier * column_k[i];
+      }
+    }
+    ++k;
+  }
+
+  // Append the L and U columns. The U part of a column also contains the
+  // entries on the rows pivoted by the sparse algorithm, they were computed
+  // by ComputeColumn() in permuted_upper_.
+  for (k = 0; k < num_independent; ++k) {
+    const ColIndex col = cols[k];
+    const RowIndex pivot_row = rows[k];
+    const Fractional* const column_k =
+        &dense_residual_[static_cast<size_t>(k) * n];
+    dense_column_scratchpad_.Clear();
+    for (int i = k + 1; i < n; ++i) {
+      if (column_k[i] != 0.0) {
+        dense_column_scratchpad_.SetCoefficient(rows[i], column_k[i]);
+      }
+    }
+    lower_.AddTriangularColumnWithGivenDiagonalEntry(dense_column_scratchpad_,
+                                                     pivot_row, 1.0);
+    permuted_lower_.mutable_column(col)->ClearAndRelease();
+
+    dense_column_scratchpad_.PopulateFromSparseVector(
+        permuted_upper_.column(col));
+    for (int i = 0; i < k; ++i) {
+      if (column_k[i] != 0.0) {
+        dense_column_scratchpad_.SetCoefficient(rows[i], column_k[i]);
+      }
+    }
+    upper_.AddTriangularColumnWithGivenDiagonalEntry(dense_column_scratchpad_,
+                                                     pivot_row, column_k[k]);
+    permuted_upper_.mutable_column(col)->ClearAndRelease();
+
+    (*col_perm)[col] = ColIndex(*index);
+    (*row_perm)[pivot_row] = RowIndex(*index);
+    ++(*index);
+  }
+  dense_residual_.clear();
+  if (num_independent < n) {
+    RETURN_AND_LOG_ERROR(Status::ERROR_LU,
+                         StringPrintf("The matrix is singular! pivot = %E",
+                                      singular_pivot_magnitude));
+  }
+  return Status::OK;
+}
+
 void Markowitz::UpdateDegree(ColIndex col, int degree) {
   DCHECK(is_col_by_degree_initialized_);
 
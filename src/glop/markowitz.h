@@ -269,11 +269,13 @@ class Markowitz {
           basis_residual_singleton_column_ratio(
               "basis_residual_singleton_column_ratio", this),
           pivots_without_fill_in_ratio("pivots_without_fill_in_ratio", this),
-          degree_two_pivot_columns("degree_two_pivot_columns", this) {}
+          degree_two_pivot_columns("degree_two_pivot_columns", this),
+          dense_residual_ratio("dense_residual_ratio", this) {}
     RatioDistribution basis_singleton_column_ratio;
     RatioDistribution basis_residual_singleton_column_ratio;
     RatioDistribution pivots_without_fill_in_ratio;
     RatioDistribution degree_two_pivot_columns;
+    RatioDistribution dense_residual_ratio;
   };
   Stats stats_;
 
@@ -328,6 +330,23 @@ class Markowitz {
                   const ColumnPermutation& col_perm, RowIndex* pivot_row,
                   ColIndex* pivot_col, Fractional* pivot_coefficient);
 
+  // Returns true if the residual matrix, of the given size, is dense enough
+  // for FactorizeDenseResidualMatrix(). See markowitz_dense_switch_density.
+  bool ResidualMatrixIsDense(int residual_size) const;
+
+  // Finishes the factorization of a square matrix when the residual matrix is
+  // dense: the residual columns are computed one last time with
+  // ComputeColumn(), copied to dense_residual_, and factorized with a
+  // right-looking LU with partial pivoting whose inner loops are on contiguous
+  // memory. The columns of L and U are then appended to lower_ and upper_ as
+  // in the sparse algorithm, and *index is advanced.
+  //
+  // If the residual matrix is singular, only a set of independent columns is
+  // appended and the same error as in the sparse algorithm is returned.
+  Status FactorizeDenseResidualMatrix(RowPermutation* row_perm,
+                                      ColumnPermutation* col_perm,
+                                      int* index) MUST_USE_RESULT;
+
   // Updates the degree of a given column in the internal structure of the
   // class.
   void UpdateDegree(ColIndex col, int degree);
@@ -388,6 +407,17 @@ class Markowitz {
   // List of singleton row indices.
   std::vector<RowIndex> singleton_row_;
 
+  // Lower bound on the degree of all the columns of the residual matrix, as of
+  // the last FindPivot(). It is the degree of the first column returned by
+  // col_by_degree_, or zero if FindPivot() used a singleton.
+  int residual_min_col_degree_;
+
+  // Column-major storage of the residual matrix used by
+  // FactorizeDenseResidualMatrix(), and a scratch column to build the L and U
+  // columns.
+  std::vector<Fractional> dense_residual_;
+  SparseColumn dense_column_scratchpad_;
+
   // Proto holding all the parameters of this algorithm.
   GlopParameters parameters_;
 
@@ -0,0 +1,126 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "glop/parallel_for.h"
+
+#include <algorithm>
+
+namespace operations_research {
+namespace glop {
+
+namespace {
+// Minimum number of loop indices per chunk. The loops we run have a cost of a
+// few floating point operations per index, and waking up a worker costs a few
+// micro-seconds.
+const int kMinChunkSize = 2048;
+}  // namespace
+
+ParallelFor::ParallelFor()
+    : workers_(),
+      stop_(false),
+      generation_(0),
+      num_pending_chunks_(0),
+      body_(nullptr),
+      size_(0),
+      num_chunks_(0) {}
+
+ParallelFor::~ParallelFor() { StopWorkers(); }
+
+void ParallelFor::SetNumThreads(int num_threads) {
+  num_threads = std::max(1, num_threads);
+  if (num_threads == this->num_threads()) return;
+  StopWorkers();
+  for (int i = 1; i < num_threads; ++i) {
+    workers_.push_back(std::thread(&ParallelFor::WorkerLoop, this, i,
+                                   generation_));
+  }
+}
+
+void ParallelFor::StopWorkers() {
+  if (workers_.empty()) return;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_available_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+  workers_.clear();
+  stop_ = false;
+}
+
+int ParallelFor::NumChunks(int size) const {
+  return NumChunks(size, kMinChunkSize);
+}
+
+int ParallelFor::NumChunks(int size, int min_chunk_size) const {
+  DCHECK_GT(min_chunk_size, 0);
+  return std::max(1, std::min(num_threads(), size / min_chunk_size));
+}
+
+void ParallelFor::Run(int size,
+                      const std::function<void(int, int, int)>& body) {
+  Run(size, kMinChunkSize, body);
+}
+
+void ParallelFor::Run(int size, int min_chunk_size,
+                      const std::function<void(int, int, int)>& body) {
+  const int num_chunks = NumChunks(size, min_chunk_size);
+  if (num_chunks == 1) {
+    if (size > 0) body(0, 0, size);
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    body_ = &body;
+    size_ = size;
+    num_chunks_ = num_chunks;
+    num_pending_chunks_ = num_chunks - 1;
+    ++generation_;
+  }
+  work_available_.notify_all();
+  RunChunk(0);
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (num_pending_chunks_ > 0) {
+    work_done_.wait(lock);
+  }
+  body_ = nullptr;
+}
+
+void ParallelFor::WorkerLoop(int chunk, int64 generation) {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (!stop_ && generation_ == generation) {
+        work_available_.wait(lock);
+      }
+      if (stop_) return;
+      generation = generation_;
+      if (chunk >= num_chunks_) continue;
+    }
+    RunChunk(chunk);
+    std::unique_lock<std::mutex> lock(mutex_);
+    --num_pending_chunks_;
+    if (num_pending_chunks_ == 0) work_done_.notify_one();
+  }
+}
+
+void ParallelFor::RunChunk(int chunk) const {
+  const int begin = static_cast<int64>(size_) * chunk / num_chunks_;
+  const int end = static_cast<int64>(size_) * (chunk + 1) / num_chunks_;
+  (*body_)(chunk, begin, end);
+}
+
+}  // namespace glop
+}  // namespace operations_research
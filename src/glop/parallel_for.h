@@ -0,0 +1,94 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef OR_TOOLS_GLOP_PARALLEL_FOR_H_
+#define OR_TOOLS_GLOP_PARALLEL_FOR_H_
+
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "base/integral_types.h"
+#include "base/logging.h"
+
+namespace operations_research {
+namespace glop {
+
+// A pool of persistent threads used to run the parallel loops of a simplex
+// iteration (pricing, update row, edge norms). Contrary to an OpenMP parallel
+// section or to base/threadpool.h, the threads are only created when the
+// number of threads changes and they wait on a condition variable between two
+// loops, so the overhead of a loop is small enough to be paid at each
+// iteration.
+//
+// This class is not thread-safe: Run() must always be called from the same
+// thread, which also executes the first chunk of each loop.
+class ParallelFor {
+ public:
+  ParallelFor();
+  ~ParallelFor();
+
+  // Sets the number of threads used by Run(), the calling thread included.
+  // With 1 (the default), Run() just calls its body in the calling thread.
+  void SetNumThreads(int num_threads);
+  int num_threads() const { return workers_.size() + 1; }
+
+  // Returns the number of chunks in which Run() splits a loop of the given
+  // size. Small loops are not worth waking up the workers for, so the result
+  // can be smaller than num_threads().
+  int NumChunks(int size) const;
+
+  // Splits [0, size) into NumChunks(size) contiguous chunks of about the same
+  // size and calls body(chunk, begin, end) on each of them in parallel. The
+  // chunks are ordered: chunk i + 1 starts where chunk i ends. Returns once
+  // all the chunks are done.
+  void Run(int size, const std::function<void(int, int, int)>& body);
+
+  // Same as above for loops whose iterations are expensive (for instance a
+  // triangular solve each), so that chunks with as few as min_chunk_size
+  // iterations are worth it. The default min_chunk_size is meant for loops of
+  // a few floating point operations per iteration.
+  int NumChunks(int size, int min_chunk_size) const;
+  void Run(int size, int min_chunk_size,
+           const std::function<void(int, int, int)>& body);
+
+ private:
+  void StopWorkers();
+  void WorkerLoop(int chunk, int64 generation);
+  void RunChunk(int chunk) const;
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable work_done_;
+  bool stop_;
+
+  // Incremented by each Run() that uses the workers. The worker number i
+  // executes the chunk i once per generation (if there is such a chunk).
+  int64 generation_;
+  int num_pending_chunks_;
+
+  // The loop being run.
+  const std::function<void(int, int, int)>* body_;
+  int size_;
+  int num_chunks_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelFor);
+};
+
+}  // namespace glop
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_GLOP_PARALLEL_FOR_H_
@@ -14,6 +14,8 @@
 
 #include "glop/preprocessor.h"
 
+#include <map>
+
 #include "base/stringprintf.h"
 #include "glop/revised_simplex.h"
 #include "glop/status.h"
@@ -49,6 +51,22 @@ Preprocessor::~Preprocessor() {}
   RunAndPushIfRelevant(std::unique_ptr<Preprocessor>(new name()), #name, \
                        time_limit, lp)
 
+// Same as RUN_PREPROCESSOR(), but skips the preprocessor if no other one
+// changed the lp since its last run did nothing. This only works for the
+// preprocessors that leave the lp untouched when they return false, and needs
+// a std::map<std::string, int> no_op_stack_sizes in the calling scope.
+#define RUN_PREPROCESSOR_IF_LP_CHANGED(name)                                   \
+  do {                                                                         \
+    const int stack_size = preprocessors_.size();                              \
+    const auto it = no_op_stack_sizes.find(#name);                             \
+    if (it == no_op_stack_sizes.end() || it->second != stack_size) {           \
+      RUN_PREPROCESSOR(name);                                                  \
+      if (preprocessors_.size() == stack_size) {                               \
+        no_op_stack_sizes[#name] = stack_size;                                 \
+      }                                                                        \
+    }                                                                          \
+  } while (false)
+
 bool MainLpPreprocessor::Run(LinearProgram* lp, TimeLimit* time_limit) {
   RETURN_VALUE_IF_NULL(lp, false);
   initial_num_rows_ = lp->num_constraints();
@@ -58,18 +76,23 @@ bool MainLpPreprocessor::Run(LinearProgram* lp, TimeLimit* time_limit) {
     RUN_PREPROCESSOR(ShiftVariableBoundsPreprocessor);
 
     // We run it a few times because running one preprocessor may allow another
-    // one to remove more stuff.
+    // one to remove more stuff. Since each run scans the whole lp, a
+    // preprocessor is only run again if the lp changed since it last did
+    // nothing. The stack size is used to detect the changes: for the
+    // preprocessors below, doing something is the same as needing postsolve.
+    std::map<std::string, int> no_op_stack_sizes;
     const int kMaxNumPasses = 20;
     for (int i = 0; i < kMaxNumPasses; ++i) {
       const int old_stack_size = preprocessors_.size();
-      RUN_PREPROCESSOR(FixedVariablePreprocessor);
-      RUN_PREPROCESSOR(SingletonPreprocessor);
-      RUN_PREPROCESSOR(ForcingAndImpliedFreeConstraintPreprocessor);
-      RUN_PREPROCESSOR(FreeConstraintPreprocessor);
-      RUN_PREPROCESSOR(UnconstrainedVariablePreprocessor);
-      RUN_PREPROCESSOR(DoubletonEqualityRowPreprocessor);
-      RUN_PREPROCESSOR(ImpliedFreePreprocessor);
-      RUN_PREPROCESSOR(DoubletonFreeColumnPreprocessor);
+      RUN_PREPROCESSOR_IF_LP_CHANGED(FixedVariablePreprocessor);
+      RUN_PREPROCESSOR_IF_LP_CHANGED(SingletonPreprocessor);
+      RUN_PREPROCESSOR_IF_LP_CHANGED(
+          ForcingAndImpliedFreeConstraintPreprocessor);
+      RUN_PREPROCESSOR_IF_LP_CHANGED(FreeConstraintPreprocessor);
+      RUN_PREPROCESSOR_IF_LP_CHANGED(UnconstrainedVariablePreprocessor);
+      RUN_PREPROCESSOR_IF_LP_CHANGED(DoubletonEqualityRowPreprocessor);
+      RUN_PREPROCESSOR_IF_LP_CHANGED(ImpliedFreePreprocessor);
+      RUN_PREPROCESSOR_IF_LP_CHANGED(DoubletonFreeColumnPreprocessor);
 
       // Abort early if none of the preprocessors did something. Technically
       // this is true if none of the preprocessors above needs postsolving,
@@ -113,6 +136,7 @@ bool MainLpPreprocessor::Run(LinearProgram* lp, TimeLimit* time_limit) {
   return !preprocessors_.empty();
 }
 
+#undef RUN_PREPROCESSOR_IF_LP_CHANGED
 #undef RUN_PREPROCESSOR
 
 void MainLpPreprocessor::RunAndPushIfRelevant(
@@ -432,7 +456,8 @@ bool ProportionalColumnPreprocessor::Run(LinearProgram* lp,
                                          TimeLimit* time_limit) {
   RETURN_VALUE_IF_NULL(lp, false);
   ColMapping mapping = FindProportionalColumns(
-      lp->GetSparseMatrix(), parameters_.preprocessor_zero_tolerance());
+      lp->GetSparseMatrix(), parameters_.preprocessor_zero_tolerance(),
+      parameters_.num_omp_threads());
 
   // Compute some statistics and make each class representative point to itself
   // in the mapping. Also store the columns that are proportional to at least
@@ -803,7 +828,8 @@ bool ProportionalRowPreprocessor::Run(LinearProgram* lp,
   // itself for the loop below. TODO(user): Already return such a mapping from
   // FindProportionalColumns()?
   ColMapping mapping = FindProportionalColumns(
-      transpose, parameters_.preprocessor_zero_tolerance());
+      transpose, parameters_.preprocessor_zero_tolerance(),
+      parameters_.num_omp_threads());
   DenseBooleanColumn is_a_representative(num_rows, false);
   int num_proportional_rows = 0;
   for (RowIndex row(0); row < num_rows; ++row) {
@@ -3038,7 +3064,7 @@ bool DualizerPreprocessor::Run(LinearProgram* lp, TimeLimit* time_limit) {
   // Note however that the default algorithm is likely to result in a faster
   // solving time because the dual program will have less rows.
   LinearProgram dual;
-  dual.PopulateFromDual(*lp, &duplicated_rows_);
+  dual.PopulateFromDualAndClear(lp, &duplicated_rows_);
   dual.Swap(lp);
   return true;
 }
@@ -3291,6 +3317,7 @@ bool ScalingPreprocessor::Run(LinearProgram* lp, TimeLimit* time_limit) {
     variable_upper_bounds_[col] = lp->variable_upper_bounds()[col];
   }
 
+  scaler_.set_num_threads(parameters_.num_omp_threads());
   lp->Scale(&scaler_);
 
   // We scale the costs to always have a maximum cost magnitude of 1.0. Note
@@ -13,10 +13,6 @@
 
 #include "glop/primal_edge_norms.h"
 
-#ifdef OMP
-#include <omp.h>
-#endif
-
 #include "base/timer.h"
 #include "lp_data/lp_utils.h"
 
@@ -26,11 +22,13 @@ namespace glop {
 PrimalEdgeNorms::PrimalEdgeNorms(const MatrixView& matrix,
                                  const CompactSparseMatrix& compact_matrix,
                                  const VariablesInfo& variables_info,
-                                 const BasisFactorization& basis_factorization)
+                                 const BasisFactorization& basis_factorization,
+                                 ParallelFor* parallel_for)
     : matrix_(matrix),
       compact_matrix_(compact_matrix),
       variables_info_(variables_info),
       basis_factorization_(basis_factorization),
+      parallel_for_(parallel_for),
       stats_(),
       recompute_edge_squared_norms_(true),
       reset_devex_weights_(true),
@@ -207,19 +205,23 @@ void PrimalEdgeNorms::UpdateEdgeSquaredNorms(ColIndex entering_col,
   const Fractional leaving_squared_norm =
       std::max(1.0, entering_squared_norm / Square(pivot));
 
-  int stat_lower_bounded_norms = 0;
   const Fractional factor = 2.0 / pivot;
-#ifdef OMP
-  const int num_omp_threads = parameters_.num_omp_threads();
-#else
-  const int num_omp_threads = 1;
-#endif
-  if (num_omp_threads == 1) {
-    for (const ColIndex col : update_row.GetNonZeroPositions()) {
+  const ColIndexVector& update_positions = update_row.GetNonZeroPositions();
+  const int size = update_positions.size();
+
+  // Each chunk counts its own operations and lower bounded norms.
+  const int num_chunks = parallel_for_->NumChunks(size);
+  std::vector<int64> chunk_num_operations(num_chunks, 0);
+  std::vector<int> chunk_lower_bounded_norms(num_chunks, 0);
+  parallel_for_->Run(size, [&](int chunk, int begin, int end) {
+    int64 num_operations = 0;
+    int num_lower_bounded_norms = 0;
+    for (int i = begin; i < end; ++i) {
+      const ColIndex col = update_positions[i];
       const Fractional coeff = update_row.GetCoefficient(col);
       const Fractional scalar_product =
           compact_matrix_.ColumnScalarProduct(col, direction_left_inverse_);
-      num_operations_ += compact_matrix_.column(col).num_entries().value();
+      num_operations += compact_matrix_.column(col).num_entries().value();
 
       // Update the edge squared norm of this column. Note that the update
       // formula used is important to maximize the precision. See an explanation
@@ -235,42 +237,19 @@ void PrimalEdgeNorms::UpdateEdgeSquaredNorms(ColIndex entering_col,
       const Fractional lower_bound = 1.0 + Square(coeff / pivot);
       if (edge_squared_norms_[col] < lower_bound) {
         edge_squared_norms_[col] = lower_bound;
-        ++stat_lower_bounded_norms;
-      }
-    }
-    edge_squared_norms_[leaving_col] = leaving_squared_norm;
-    stats_.lower_bounded_norms.Add(stat_lower_bounded_norms);
-  } else {
-#ifdef OMP
-    // In the multi-threaded case, perform the same computation as in the
-    // single-threaded case above.
-    //
-    // TODO(user): also update num_operations_.
-    std::vector<int> thread_local_stat_lower_bounded_norms(num_omp_threads, 0);
-    const std::vector<ColIndex>& relevant_rows = update_row.GetNonZeroPositions();
-    const int parallel_loop_size = relevant_rows.size();
-#pragma omp parallel for num_threads(num_omp_threads)
-    for (int i = 0; i < parallel_loop_size; i++) {
-      const ColIndex col(relevant_rows[i]);
-      const Fractional coeff = update_row.GetCoefficient(col);
-      const Fractional scalar_product =
-          compact_matrix_.ColumnScalarProduct(col, direction_left_inverse_);
-      edge_squared_norms_[col] +=
-          coeff * (coeff * leaving_squared_norm + factor * scalar_product);
-      const Fractional lower_bound = 1.0 + Square(coeff / pivot);
-      if (edge_squared_norms_[col] < lower_bound) {
-        edge_squared_norms_[col] = lower_bound;
-        ++thread_local_stat_lower_bounded_norms[omp_get_thread_num()];
+        ++num_lower_bounded_norms;
       }
     }
-    // end of omp parallel for
-    edge_squared_norms_[leaving_col] = leaving_squared_norm;
-    for (int i = 0; i < num_omp_threads; i++) {
-      stat_lower_bounded_norms += thread_local_stat_lower_bounded_norms[i];
-    }
-    stats_.lower_bounded_norms.Add(stat_lower_bounded_norms);
-#endif  // OMP
+    chunk_num_operations[chunk] = num_operations;
+    chunk_lower_bounded_norms[chunk] = num_lower_bounded_norms;
+  });
+  int stat_lower_bounded_norms = 0;
+  for (int chunk = 0; chunk < num_chunks; ++chunk) {
+    num_operations_ += chunk_num_operations[chunk];
+    stat_lower_bounded_norms += chunk_lower_bounded_norms[chunk];
   }
+  edge_squared_norms_[leaving_col] = leaving_squared_norm;
+  stats_.lower_bounded_norms.Add(stat_lower_bounded_norms);
 }
 
 void PrimalEdgeNorms::UpdateDevexWeights(
@@ -15,6 +15,7 @@
 #define OR_TOOLS_GLOP_PRIMAL_EDGE_NORMS_H_
 
 #include "glop/basis_representation.h"
+#include "glop/parallel_for.h"
 #include "glop/parameters.pb.h"
 #include "glop/update_row.h"
 #include "glop/variables_info.h"
@@ -54,11 +55,13 @@ class PrimalEdgeNorms {
  public:
   // Takes references to the linear program data we need. Note that we assume
   // that the matrix will never change in our back, but the other references are
-  // supposed to reflect the correct state.
+  // supposed to reflect the correct state. The edge norms updates are run by
+  // parallel_for.
   PrimalEdgeNorms(const MatrixView& matrix,
                   const CompactSparseMatrix& compact_matrix,
                   const VariablesInfo& variables_info,
-                  const BasisFactorization& basis_factorization);
+                  const BasisFactorization& basis_factorization,
+                  ParallelFor* parallel_for);
 
   // Clears, i.e. resets the object to its initial value. This will trigger
   // a recomputation for the next Get*() method call.
@@ -166,6 +169,7 @@ class PrimalEdgeNorms {
   const CompactSparseMatrix& compact_matrix_;
   const VariablesInfo& variables_info_;
   const BasisFactorization& basis_factorization_;
+  ParallelFor* parallel_for_;
 
   // Internal data.
   GlopParameters parameters_;
@@ -11,13 +11,20 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-// Driver to run MPSolver on MPModelProto text files.
+// Driver to run MPSolver on MPModelProto text files or MPS files.
+//
+// It can be used as a benchmark of the simplex: for each instance solved by
+// Glop, it reports the number of iterations and refactorizations, the time
+// spent in each phase of the solve and the deterministic time, and the
+// objectives can be checked against reference values given with
+// --reference_objectives.
 //
 // TODO(user): Move this under linear_solver/ and support more file formats and
 // linear programming solvers.
 
 #include <algorithm>
 #include <cstdio>
+#include <map>
 #include <memory>
 #include <string>
 
@@ -28,9 +35,14 @@
 #include "base/file.h"
 #include "google/protobuf/message.h"
 #include "google/protobuf/text_format.h"
+#include "base/split.h"
+#include "base/strutil.h"
 #include "base/threadpool.h"
 #include "util/gzip/gzipstring.h"
 #include "glop/lp_solver.h"
+#include "glop/proto_utils.h"
+#include "lp_data/lp_data.h"
+#include "lp_data/mps_reader.h"
 #include "linear_solver/linear_solver.h"
 #include "linear_solver/linear_solver.pb.h"
 #include "util/fp_utils.h"
@@ -48,6 +60,12 @@ DEFINE_int64(max_time_in_ms, -1, "Maximum time allowed in milliseconds.");
 DEFINE_int64(threads, 1, "Number of threads.");
 DEFINE_double(variable_tolerance, 1e-7, "Tolerance on variable values.");
 DEFINE_double(cost_tolerance, 1e-7, "Tolerance on cost value.");
+DEFINE_string(reference_objectives, "",
+              "If non-empty, file with one '<instance name> <objective>' line "
+              "per instance. The instance name is the file name without its "
+              "directory and extensions. The optimal objective of each "
+              "solved instance is checked against it, within --cost_tolerance, "
+              "and the program fails if one of them differs.");
 
 namespace operations_research {
 namespace glop {
@@ -61,7 +79,9 @@ struct InstanceResult {
         result_status(),
         objective_value(0),
         may_have_multiple_solutions(false),
-        variable_values() {}
+        variable_values(),
+        num_iterations(0),
+        deterministic_time(0) {}
   double parsing_time_in_sec;
   double loading_time_in_sec;
   double solving_time_in_sec;
@@ -69,25 +89,41 @@ struct InstanceResult {
   double objective_value;
   bool may_have_multiple_solutions;
   std::vector<double> variable_values;
+  // Only filled by Glop.
+  int64 num_iterations;
+  double deterministic_time;
+  LPSolver::SolveStats solve_stats;
 };
 
-void Solve(MPSolver::OptimizationProblemType type, const std::string& file_name,
-           InstanceResult* result) {
+// Returns the name of an instance: its file name without the directory and
+// the extensions.
+std::string InstanceName(const std::string& file_name) {
+  const size_t slash = file_name.find_last_of('/');
+  const std::string base =
+      slash == std::string::npos ? file_name : file_name.substr(slash + 1);
+  return base.substr(0, base.find('.'));
+}
+
+// Reads a binary or text MPModelProto file, which may be gzipped.
+void ReadProto(const std::string& file_name, MPModelProto* proto,
+               InstanceResult* result) {
   std::string raw_data;
   CHECK_OK(file::GetContents(file_name, &raw_data, file::Defaults()));
   std::string uncompressed;
   if (!GunzipString(raw_data, &uncompressed)) {
     uncompressed = raw_data;
   }
-  MPModelProto proto;
-  {
-    ScopedWallTime timer(&(result->parsing_time_in_sec));
-    if (!proto.ParseFromString(uncompressed)) {
-      // We do not care about timing the parsing from a text proto, that's why
-      // we try first to parse the proto as binary.
-      CHECK(TextFormat::ParseFromString(uncompressed, &proto));
-    }
+  ScopedWallTime timer(&(result->parsing_time_in_sec));
+  if (!proto->ParseFromString(uncompressed)) {
+    // We do not care about timing the parsing from a text proto, that's why
+    // we try first to parse the proto as binary.
+    CHECK(TextFormat::ParseFromString(uncompressed, proto));
   }
+}
+
+void SolveProto(MPSolver::OptimizationProblemType type,
+                const std::string& file_name, const MPModelProto& proto,
+                InstanceResult* result) {
   MPSolver solver(file_name, type);
   if (FLAGS_max_time_in_ms >= 0) {
     solver.set_time_limit(FLAGS_max_time_in_ms);
@@ -123,21 +159,51 @@ void Solve(MPSolver::OptimizationProblemType type, const std::string& file_name,
     CHECK_NOTNULL(lp_solver);
     result->may_have_multiple_solutions =
         lp_solver->MayHaveMultipleOptimalSolutions();
+    result->num_iterations = lp_solver->GetNumberOfSimplexIterations();
+    result->deterministic_time = lp_solver->DeterministicTime();
+    result->solve_stats = lp_solver->GetSolveStats();
+  }
+}
+
+void Solve(MPSolver::OptimizationProblemType type, const std::string& file_name,
+           InstanceResult* result) {
+  MPModelProto proto;
+  if (HasSuffixString(file_name, ".mps") ||
+      HasSuffixString(file_name, ".mps.gz")) {
+    ScopedWallTime timer(&(result->parsing_time_in_sec));
+    MPSReader mps_reader;
+    LinearProgram linear_program;
+    CHECK(mps_reader.LoadFileAndTryFreeFormOnFail(file_name, &linear_program))
+        << file_name;
+    LinearProgramToMPModelProto(linear_program, &proto);
+  } else {
+    ReadProto(file_name, &proto, result);
   }
+  SolveProto(type, file_name, proto, result);
 }
 
 void DisplayResults(const std::string& header, const std::vector<std::string>& file_list,
                     const std::vector<InstanceResult>& result) {
   printf("Results for %s:\n", header.c_str());
+  printf("file,status,objective,solving_time,multiple_solutions,iterations,"
+         "phase_1_iterations,phase_2_iterations,refactorizations,"
+         "preprocessing_time,phase_1_time,phase_2_time,postsolve_time,"
+         "deterministic_time\n");
   TimeDistribution parsing_time_distribution("Parsing time summary");
   TimeDistribution loading_time_distribution("Loading time summary");
   TimeDistribution solving_time_distribution("Solving time summary");
+  DoubleDistribution time_ratio_distribution(
+      "Wall time per unit of deterministic time summary");
   const int size = result.size();
   int num_solutions_on_facet = 0;
   for (int i = 0; i < size; ++i) {
     parsing_time_distribution.AddTimeInSec(result[i].parsing_time_in_sec);
     loading_time_distribution.AddTimeInSec(result[i].loading_time_in_sec);
     solving_time_distribution.AddTimeInSec(result[i].solving_time_in_sec);
+    if (result[i].deterministic_time > 0) {
+      time_ratio_distribution.Add(result[i].solving_time_in_sec /
+                                  result[i].deterministic_time);
+    }
     const std::string status =
         (result[i].result_status == MPSolver::OPTIMAL) ? "Optimal" : "Abnormal";
     num_solutions_on_facet += result[i].may_have_multiple_solutions;
@@ -146,12 +212,64 @@ void DisplayResults(const std::string& header, const std::vector<std::string>& f
     printf("%.15e,", result[i].objective_value);
     printf("%f,", result[i].solving_time_in_sec);
     printf("%d,", result[i].may_have_multiple_solutions);
+    const LPSolver::SolveStats& stats = result[i].solve_stats;
+    printf("%lld,%lld,%lld,%lld,", result[i].num_iterations,
+           stats.num_feasibility_iterations, stats.num_optimization_iterations,
+           stats.num_refactorizations);
+    printf("%f,%f,%f,%f,", stats.preprocessing_time, stats.feasibility_time,
+           stats.optimization_time, stats.postsolve_time);
+    printf("%f", result[i].deterministic_time);
     printf("\n");
   }
   printf("Number of solutions on a facet: %d\n", num_solutions_on_facet);
   printf("%s\n", parsing_time_distribution.StatString().c_str());
   printf("%s\n", loading_time_distribution.StatString().c_str());
   printf("%s\n", solving_time_distribution.StatString().c_str());
+  printf("%s\n", time_ratio_distribution.StatString().c_str());
+}
+
+// Checks the objectives against the ones in --reference_objectives. Returns
+// the number of instances that were not solved to optimality with the
+// reference objective.
+int CheckReferenceObjectives(const std::string& header,
+                             const std::vector<std::string>& file_list,
+                             const std::vector<InstanceResult>& result) {
+  std::string contents;
+  CHECK_OK(file::GetContents(FLAGS_reference_objectives, &contents,
+                             file::Defaults()));
+  std::map<std::string, double> reference_objectives;
+  for (const std::string& line :
+       strings::Split(contents, "\n", strings::SkipEmpty())) {
+    const std::vector<std::string> words =
+        strings::Split(line, " ", strings::SkipEmpty());
+    if (words.size() < 2 || words[0][0] == '#') continue;
+    reference_objectives[words[0]] = strtod(words[1].c_str(), nullptr);
+  }
+  int num_failures = 0;
+  int num_missing = 0;
+  for (int i = 0; i < file_list.size(); ++i) {
+    const std::string name = InstanceName(file_list[i]);
+    const auto it = reference_objectives.find(name);
+    if (it == reference_objectives.end()) {
+      ++num_missing;
+      continue;
+    }
+    const bool pass =
+        result[i].result_status == MPSolver::OPTIMAL &&
+        AreWithinAbsoluteOrRelativeTolerances(result[i].objective_value,
+                                              it->second, FLAGS_cost_tolerance,
+                                              FLAGS_cost_tolerance);
+    if (!pass) {
+      ++num_failures;
+      printf("%s FAIL %s: objective %.15e, reference %.15e\n", header.c_str(),
+             name.c_str(), result[i].objective_value, it->second);
+    }
+  }
+  printf("%s: %d instances passed, %d failed, %d without reference.\n",
+         header.c_str(), static_cast<int>(file_list.size()) - num_failures -
+                             num_missing,
+         num_failures, num_missing);
+  return num_failures;
 }
 
 void Compare(const std::vector<std::string>& file_list,
@@ -204,6 +322,7 @@ void Compare(const std::vector<std::string>& file_list,
 }  // namespace operations_research
 
 using operations_research::MPSolver;
+using operations_research::glop::CheckReferenceObjectives;
 using operations_research::glop::Compare;
 using operations_research::glop::DisplayResults;
 using operations_research::glop::InstanceResult;
@@ -212,7 +331,7 @@ using operations_research::glop::Solve;
 int main(int argc, char* argv[]) {
   InitGoogle(
       "Runs Glop or Clp on a given pattern of files given by --input. "
-      "The files must be in text proto format.",
+      "The files must be in MPS format or MPModelProto format.",
       &argc, &argv, true);
   std::vector<std::string> file_list;
   File::Match(FLAGS_input, &file_list);
@@ -243,5 +362,15 @@ int main(int argc, char* argv[]) {
   if (FLAGS_use_clp && FLAGS_use_glop) {
     Compare(file_list, clp_result, glop_result);
   }
+  if (!FLAGS_reference_objectives.empty()) {
+    int num_failures = 0;
+    if (FLAGS_use_clp) {
+      num_failures += CheckReferenceObjectives("CLP", file_list, clp_result);
+    }
+    if (FLAGS_use_glop) {
+      num_failures += CheckReferenceObjectives("Glop", file_list, glop_result);
+    }
+    if (num_failures > 0) return EXIT_FAILURE;
+  }
   return EXIT_SUCCESS;
 }
@@ -112,7 +112,7 @@ class RankOneUpdateElementaryMatrix {
 // update elementary matrices, i.e. T = T_0.T_1. ... .T_{k-1}
 class RankOneUpdateFactorization {
  public:
-  RankOneUpdateFactorization() : elementary_matrices_() {}
+  RankOneUpdateFactorization() : num_entries_(0), elementary_matrices_() {}
 
   // Deletes all elementary matrices of this factorization.
   void Clear() {
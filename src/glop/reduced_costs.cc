@@ -13,10 +13,6 @@
 
 #include "glop/reduced_costs.h"
 
-#ifdef OMP
-#include <omp.h>
-#endif
-
 #include "lp_data/lp_utils.h"
 
 namespace operations_research {
@@ -26,12 +22,14 @@ ReducedCosts::ReducedCosts(const CompactSparseMatrix& matrix,
                            const DenseRow& objective,
                            const RowToColMapping& basis,
                            const VariablesInfo& variables_info,
-                           const BasisFactorization& basis_factorization)
+                           const BasisFactorization& basis_factorization,
+                           ParallelFor* parallel_for)
     : matrix_(matrix),
       objective_(objective),
       basis_(basis),
       variables_info_(variables_info),
       basis_factorization_(basis_factorization),
+      parallel_for_(parallel_for),
       parameters_(),
       stats_(),
       must_refactorize_basis_(false),
@@ -303,48 +301,26 @@ void ReducedCosts::ComputeReducedCosts() {
 
   reduced_costs_.resize(num_cols, 0.0);
   const DenseBitRow& is_basic = variables_info_.GetIsBasicBitRow();
-#ifdef OMP
-  const int num_omp_threads = parameters_.num_omp_threads();
-#else
-  const int num_omp_threads = 1;
-#endif
-  if (num_omp_threads == 1) {
-    for (ColIndex col(0); col < num_cols; ++col) {
-      reduced_costs_[col] =
-          objective_[col] + objective_perturbation_[col] -
-          matrix_.ColumnScalarProduct(col, basic_objective_left_inverse_);
 
-      // We also compute the dual residual error y.B - c_B.
-      if (is_basic.IsSet(col)) {
-        dual_residual_error =
-            std::max(dual_residual_error, fabs(reduced_costs_[col]));
-      }
-    }
-  } else {
-#ifdef OMP
-    // In the multi-threaded case, perform the same computation as in the
-    // single-threaded case above.
-    std::vector<Fractional> thread_local_dual_residual_error(num_omp_threads, 0.0);
-    const int parallel_loop_size = num_cols.value();
-#pragma omp parallel for num_threads(num_omp_threads)
-    for (int i = 0; i < parallel_loop_size; i++) {
-      const ColIndex col(i);
+  // Each chunk of columns computes its own dual residual error.
+  std::vector<Fractional> chunk_dual_residual_error(
+      parallel_for_->NumChunks(num_cols.value()), 0.0);
+  parallel_for_->Run(num_cols.value(), [&](int chunk, int begin, int end) {
+    Fractional error(0.0);
+    for (ColIndex col(begin); col < ColIndex(end); ++col) {
       reduced_costs_[col] =
           objective_[col] + objective_perturbation_[col] -
           matrix_.ColumnScalarProduct(col, basic_objective_left_inverse_);
 
+      // We also compute the dual residual error y.B - c_B.
       if (is_basic.IsSet(col)) {
-        thread_local_dual_residual_error[omp_get_thread_num()] =
-            std::max(thread_local_dual_residual_error[omp_get_thread_num()],
-                fabs(reduced_costs_[col]));
+        error = std::max(error, fabs(reduced_costs_[col]));
       }
     }
-    // end of omp parallel for
-    for (int i = 0; i < num_omp_threads; i++) {
-      dual_residual_error =
-          std::max(dual_residual_error, thread_local_dual_residual_error[i]);
-    }
-#endif  // OMP
+    chunk_dual_residual_error[chunk] = error;
+  });
+  for (const Fractional error : chunk_dual_residual_error) {
+    dual_residual_error = std::max(dual_residual_error, error);
   }
 
   recompute_reduced_costs_ = false;
@@ -15,6 +15,7 @@
 #define OR_TOOLS_GLOP_REDUCED_COSTS_H_
 
 #include "glop/basis_representation.h"
+#include "glop/parallel_for.h"
 #include "glop/parameters.pb.h"
 #include "glop/primal_edge_norms.h"
 #include "glop/status.h"
@@ -45,11 +46,13 @@ namespace glop {
 //   column with the vector of the dual values.
 class ReducedCosts {
  public:
-  // Takes references to the linear program data we need.
+  // Takes references to the linear program data we need. The loop over all
+  // the columns of ComputeReducedCosts() is run by parallel_for.
   ReducedCosts(const CompactSparseMatrix& matrix_, const DenseRow& objective,
                const RowToColMapping& basis,
                const VariablesInfo& variables_info,
-               const BasisFactorization& basis_factorization);
+               const BasisFactorization& basis_factorization,
+               ParallelFor* parallel_for);
 
   // If this is true, then the caller must re-factorize the basis before the
   // next call to GetReducedCosts().
@@ -218,6 +221,7 @@ class ReducedCosts {
   const RowToColMapping& basis_;
   const VariablesInfo& variables_info_;
   const BasisFactorization& basis_factorization_;
+  ParallelFor* parallel_for_;
 
   // Internal data.
   GlopParameters parameters_;
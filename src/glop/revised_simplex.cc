@@ -90,15 +90,16 @@ RevisedSimplex::RevisedSimplex()
       variables_info_(compact_matrix_, lower_bound_, upper_bound_),
       variable_values_(compact_matrix_, basis_, variables_info_,
                        basis_factorization_),
-      dual_edge_norms_(basis_factorization_),
+      dual_edge_norms_(basis_factorization_, &parallel_for_),
+      parallel_for_(),
       primal_edge_norms_(matrix_with_slack_, compact_matrix_, variables_info_,
-                         basis_factorization_),
+                         basis_factorization_, &parallel_for_),
       update_row_(compact_matrix_, transposed_matrix_, variables_info_, basis_,
-                  basis_factorization_),
+                  basis_factorization_, &parallel_for_),
       reduced_costs_(compact_matrix_, current_objective_, basis_,
-                     variables_info_, basis_factorization_),
+                     variables_info_, basis_factorization_, &parallel_for_),
       entering_variable_(variables_info_, &random_, &reduced_costs_,
-                         &primal_edge_norms_),
+                         &primal_edge_norms_, &parallel_for_),
       num_iterations_(0),
       num_feasibility_iterations_(0),
       num_optimization_iterations_(0),
@@ -112,7 +113,8 @@ RevisedSimplex::RevisedSimplex()
       parameters_(),
       test_lu_(),
       feasibility_phase_(true),
-      random_("This is a deterministic seed.") {
+      random_("This is a deterministic seed."),
+      notify_that_matrix_is_unchanged_(false) {
   PropagateParameters();
 }
 
@@ -121,6 +123,7 @@ void RevisedSimplex::ClearStateForNextSolve() {
   solution_state_.num_rows = RowIndex(0);
   solution_state_.num_cols = ColIndex(0);
   solution_state_.statuses.clear();
+  solution_state_.dual_edge_squared_norms.clear();
 }
 
 void RevisedSimplex::LoadStateForNextSolve(const BasisState& state) {
@@ -129,6 +132,10 @@ void RevisedSimplex::LoadStateForNextSolve(const BasisState& state) {
   solution_state_has_been_set_externally_ = true;
 }
 
+void RevisedSimplex::NotifyThatMatrixIsUnchangedForNextSolve() {
+  notify_that_matrix_is_unchanged_ = true;
+}
+
 Status RevisedSimplex::Solve(const LinearProgram& lp, TimeLimit* time_limit) {
   SCOPED_TIME_STAT(&function_stats_);
   DCHECK(lp.IsCleanedUp());
@@ -587,16 +594,25 @@ void RevisedSimplex::UseSingletonColumnInInitialBasis(RowToColMapping* basis) {
 }
 
 bool RevisedSimplex::InitializeMatrixAndTestIfUnchanged(const LinearProgram& lp,
-                                                        bool* only_new_rows) {
+                                                        bool* only_new_rows,
+                                                        bool* only_new_cols) {
   SCOPED_TIME_STAT(&function_stats_);
   DCHECK_EQ(num_cols_, compact_matrix_.num_cols());
   DCHECK_EQ(num_rows_, compact_matrix_.num_rows());
 
-  // Test if the matrix is unchanged, and if yes, just returns true.
+  // Test if the matrix is unchanged, and if yes, just returns true. Note that
+  // the exact comparison is skipped if the caller told us the matrix did not
+  // change (but not if this is the first solve).
+  const bool matrix_is_notified_unchanged = notify_that_matrix_is_unchanged_;
+  notify_that_matrix_is_unchanged_ = false;
   if (lp.num_constraints() == num_rows_ &&
       lp.num_variables() == first_slack_col_ &&
-      AreFirstColumnsAndRowsExactlyEquals(
-          num_rows_, first_slack_col_, lp.GetSparseMatrix(), compact_matrix_)) {
+      (matrix_is_notified_unchanged ||
+       AreFirstColumnsAndRowsExactlyEquals(num_rows_, first_slack_col_,
+                                           lp.GetSparseMatrix(),
+                                           compact_matrix_))) {
+    DCHECK(AreFirstColumnsAndRowsExactlyEquals(
+        num_rows_, first_slack_col_, lp.GetSparseMatrix(), compact_matrix_));
     // IMPORTANT: we need to recreate matrix_with_slack_ because this matrix
     // view was refering to a previous lp.GetSparseMatrix(). The matrices are
     // the same, but we do need to update the pointers.
@@ -615,6 +631,15 @@ bool RevisedSimplex::InitializeMatrixAndTestIfUnchanged(const LinearProgram& lp,
       AreFirstColumnsAndRowsExactlyEquals(
           num_rows_, first_slack_col_, lp.GetSparseMatrix(), compact_matrix_);
 
+  // Same for new columns (i.e. new variables), which is what happens in a
+  // column generation algorithm. Note that this is only detected after a
+  // first solve, since num_rows_ is zero before.
+  *only_new_cols =
+      num_rows_ > 0 && lp.num_constraints() == num_rows_ &&
+      lp.num_variables() > first_slack_col_ &&
+      AreFirstColumnsAndRowsExactlyEquals(
+          num_rows_, first_slack_col_, lp.GetSparseMatrix(), compact_matrix_);
+
   // Initialize matrix_with_slack_. Note that many of the slack variables may
   // not be useful at all, but in order not to recompute the matrix from one
   // Solve() to the next, we include all of them for a given lp matrix.
@@ -938,8 +963,9 @@ Status RevisedSimplex::Initialize(const LinearProgram& lp) {
   // Note that these functions can't depend on use_dual_simplex() since we may
   // change it below.
   bool only_new_rows = false;
+  bool only_new_cols = false;
   const bool is_matrix_unchanged =
-      InitializeMatrixAndTestIfUnchanged(lp, &only_new_rows);
+      InitializeMatrixAndTestIfUnchanged(lp, &only_new_rows, &only_new_cols);
   const bool objective_is_unchanged = InitializeObjectiveAndTestIfUnchanged(lp);
   const bool bounds_are_unchanged = InitializeBoundsAndTestIfUnchanged(lp);
 
@@ -957,6 +983,14 @@ Status RevisedSimplex::Initialize(const LinearProgram& lp) {
     }
   }
 
+  // New columns usually make the current basis dual infeasible but keep it
+  // primal feasible (if their default value is zero), so we prefer the primal
+  // simplex in this case.
+  if (only_new_cols && parameters_.allow_simplex_algorithm_change()) {
+    parameters_.set_use_dual_simplex(false);
+    PropagateParameters();
+  }
+
   InitializeObjectiveLimit(lp);
 
   // Computes the variable name as soon as possible for logging.
@@ -991,6 +1025,7 @@ Status RevisedSimplex::Initialize(const LinearProgram& lp) {
       if (InitializeFirstBasis(basis_).ok()) {
         primal_edge_norms_.Clear();
         dual_edge_norms_.Clear();
+        LoadDualEdgeSquaredNormsFromState(solution_state_);
         dual_pricing_vector_.clear();
         reduced_costs_.ClearAndRemoveCostShifts();
         solve_from_scratch = false;
@@ -1001,7 +1036,7 @@ Status RevisedSimplex::Initialize(const LinearProgram& lp) {
     } else if (!parameters_.use_dual_simplex()) {
       // With primal simplex, always clear dual norms and dual pricing.
       // Incrementality is supported only if both the matrix and the bounds
-      // remain the same (objective may change).
+      // remain the same (objective may change), or if new columns were added.
       dual_edge_norms_.Clear();
       dual_pricing_vector_.clear();
       if (is_matrix_unchanged && bounds_are_unchanged) {
@@ -1009,6 +1044,30 @@ Status RevisedSimplex::Initialize(const LinearProgram& lp) {
         // this seems to break something. Investigate.
         reduced_costs_.ClearAndRemoveCostShifts();
         solve_from_scratch = false;
+      } else if (only_new_cols) {
+        // The new columns are inserted before the slack columns, so the
+        // indices of the basic slack variables changed. The statuses are
+        // remapped by InitializeVariableStatusesForWarmStart(), the new
+        // columns start non-basic at their default bound, and the same basis
+        // as before is refactorized.
+        //
+        // TODO(user): The primal edge norms of the old columns are still
+        // valid, only the ones of the new columns need to be computed.
+        InitializeVariableStatusesForWarmStart(solution_state_);
+        basis_.assign(num_rows_, kInvalidCol);
+        RowIndex row(0);
+        for (ColIndex col : variables_info_.GetIsBasicBitRow()) {
+          basis_[row] = col;
+          ++row;
+        }
+        primal_edge_norms_.Clear();
+        reduced_costs_.ClearAndRemoveCostShifts();
+        if (InitializeFirstBasis(basis_).ok()) {
+          solve_from_scratch = false;
+        } else {
+          VLOG(1) << "RevisedSimplex is not using the previous basis because "
+                     "it is not factorizable anymore.";
+        }
       }
     } else {
       // With dual simplex, always clear primal norms. Incrementality is
@@ -1105,9 +1164,36 @@ void RevisedSimplex::SaveState() {
   solution_state_.num_rows = num_rows_;
   solution_state_.num_cols = first_slack_col_;
   solution_state_.statuses = variables_info_.GetStatusRow();
+  solution_state_.dual_edge_squared_norms.clear();
+  const DenseColumn* norms = dual_edge_norms_.GetEdgeSquaredNormsIfValid();
+  if (norms != nullptr && norms->size() == num_rows_) {
+    solution_state_.dual_edge_squared_norms.assign(num_cols_, 0.0);
+    for (RowIndex row(0); row < num_rows_; ++row) {
+      solution_state_.dual_edge_squared_norms[basis_[row]] = (*norms)[row];
+    }
+  }
   solution_state_has_been_set_externally_ = false;
 }
 
+void RevisedSimplex::LoadDualEdgeSquaredNormsFromState(
+    const BasisState& state) {
+  // The norms are only meaningful for the exact same problem dimensions and
+  // basis. A variable of the current basis that was not basic in the state
+  // (for instance a slack added by InitializeFirstBasis()) has a zero norm.
+  if (state.num_rows != num_rows_ || state.num_cols != first_slack_col_ ||
+      state.dual_edge_squared_norms.size() != num_cols_) {
+    return;
+  }
+  DenseColumn norms(num_rows_, 0.0);
+  for (RowIndex row(0); row < num_rows_; ++row) {
+    const Fractional norm = state.dual_edge_squared_norms[basis_[row]];
+    if (!(norm > 0.0)) return;
+    norms[row] = norm;
+  }
+  VLOG(1) << "Reusing the dual edge norms of the provided basis.";
+  dual_edge_norms_.SetEdgeSquaredNorms(norms);
+}
+
 RowIndex RevisedSimplex::ComputeNumberOfEmptyRows() {
   DenseBooleanColumn contains_data(num_rows_, false);
   for (ColIndex col(0); col < num_cols_; ++col) {
@@ -2094,6 +2180,9 @@ Status RevisedSimplex::Minimize(TimeLimit* time_limit) {
   DisplayIterationInfo();
   bool refactorize = false;
 
+  // The dual edge norms are not updated by the primal pivots.
+  dual_edge_norms_.Clear();
+
   if (feasibility_phase_) {
     // Initialize the primal phase-I objective.
     current_objective_.assign(num_cols_, 0.0);
@@ -2644,6 +2733,7 @@ void RevisedSimplex::SetParameters(const GlopParameters& parameters) {
 
 void RevisedSimplex::PropagateParameters() {
   SCOPED_TIME_STAT(&function_stats_);
+  parallel_for_.SetNumThreads(parameters_.num_omp_threads());
   basis_factorization_.SetParameters(parameters_);
   entering_variable_.SetParameters(parameters_);
   reduced_costs_.SetParameters(parameters_);
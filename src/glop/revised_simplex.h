@@ -102,6 +102,7 @@
 #include "base/macros.h"
 #include "glop/basis_representation.h"
 #include "glop/dual_edge_norms.h"
+#include "glop/parallel_for.h"
 #include "glop/parameters.pb.h"
 #include "glop/primal_edge_norms.h"
 #include "glop/entering_variable.h"
@@ -147,6 +148,14 @@ struct BasisState {
   // which bound the fixed status correspond.
   VariableStatusRow statuses;
 
+  // The dual steepest-edge squared norms of the basis, indexed like statuses:
+  // the entry of a basic variable is the squared norm of the row of the
+  // inverse basis in which it is basic, the other entries are zero. This is
+  // empty if the norms were not known when the state was saved. Recomputing
+  // them from scratch costs one left solve per row, which can be more than a
+  // warm-started dual simplex solve.
+  DenseRow dual_edge_squared_norms;
+
   // Returns true if this state is empty.
   bool IsEmpty() const { return statuses.empty(); }
 };
@@ -177,6 +186,13 @@ class RevisedSimplex {
   // Uses the given state as a warm-start for the next Solve() call.
   void LoadStateForNextSolve(const BasisState& state);
 
+  // Promises that the matrix of the linear program given to the next Solve()
+  // is exactly the same as the one of the last Solve(). This skips the
+  // O(num_entries) comparison done to detect it, which matters when only the
+  // bounds or the objective change between two solves. Only the next Solve()
+  // is affected.
+  void NotifyThatMatrixIsUnchangedForNextSolve();
+
   // Getters to retrieve all the information computed by the last Solve().
   RowIndex GetProblemNumRows() const;
   ColIndex GetProblemNumCols() const;
@@ -193,6 +209,22 @@ class RevisedSimplex {
   double DeterministicTime() const;
   bool objective_limit_reached() const { return objective_limit_reached_; }
 
+  // Time in seconds and number of iterations of the first (feasibility) and
+  // second (optimization) phases of the last Solve().
+  double GetFeasibilityTime() const { return feasibility_time_; }
+  double GetOptimizationTime() const { return optimization_time_; }
+  int64 GetNumberOfFeasibilityIterations() const {
+    return num_feasibility_iterations_;
+  }
+  int64 GetNumberOfOptimizationIterations() const {
+    return num_optimization_iterations_;
+  }
+
+  // Number of refactorizations of the basis since the creation of this class.
+  int64 GetNumberOfRefactorizations() const {
+    return basis_factorization_.NumRefactorizations();
+  }
+
   // If the problem status is PRIMAL_UNBOUNDED (respectively DUAL_UNBOUNDED),
   // then the solver has a corresponding primal (respectively dual) ray to show
   // the unboundness. From a primal (respectively dual) feasible solution any
@@ -304,10 +336,12 @@ class RevisedSimplex {
                    VariableStatus leaving_variable_status);
 
   // Initializes matrix-related internal data. Returns true if this data was
-  // unchanged. If not, also sets only_new_rows to true if compared to the
-  // current matrix, the only difference is that new rows have been added.
+  // unchanged. If not, also sets only_new_rows (resp. only_new_cols) to true
+  // if compared to the current matrix, the only difference is that new rows
+  // (resp. new columns) have been added.
   bool InitializeMatrixAndTestIfUnchanged(const LinearProgram& lp,
-                                          bool* only_new_rows);
+                                          bool* only_new_rows,
+                                          bool* only_new_cols);
 
   // Initializes bound-related internal data. Returns true if unchanged.
   bool InitializeBoundsAndTestIfUnchanged(const LinearProgram& lp);
@@ -336,6 +370,10 @@ class RevisedSimplex {
   // Saves the current variable statuses in solution_state_.
   void SaveState();
 
+  // Sets the dual edge norms from the ones saved in the given state if they
+  // exist for the current basis, otherwise leaves them for recomputation.
+  void LoadDualEdgeSquaredNormsFromState(const BasisState& state);
+
   // Displays statistics on what kinds of variables are in the current basis.
   void DisplayBasicVariableStatistics();
 
@@ -651,6 +689,10 @@ class RevisedSimplex {
   VariablesInfo variables_info_;
   VariableValues variable_values_;
   DualEdgeNorms dual_edge_norms_;
+
+  // The threads running the parallel loops of the classes below.
+  ParallelFor parallel_for_;
+
   PrimalEdgeNorms primal_edge_norms_;
   UpdateRow update_row_;
   ReducedCosts reduced_costs_;
@@ -757,6 +799,9 @@ class RevisedSimplex {
   // A random number generator.
   MTRandom random_;
 
+  // Set by NotifyThatMatrixIsUnchangedForNextSolve().
+  bool notify_that_matrix_is_unchanged_;
+
   DISALLOW_COPY_AND_ASSIGN(RevisedSimplex);
 };
 
@@ -13,10 +13,6 @@
 
 #include "glop/update_row.h"
 
-#ifdef OMP
-#include <omp.h>
-#endif
-
 #include "lp_data/lp_utils.h"
 
 namespace operations_research {
@@ -26,12 +22,14 @@ UpdateRow::UpdateRow(const CompactSparseMatrix& matrix,
                      const CompactSparseMatrix& transposed_matrix,
                      const VariablesInfo& variables_info,
                      const RowToColMapping& basis,
-                     const BasisFactorization& basis_factorization)
+                     const BasisFactorization& basis_factorization,
+                     ParallelFor* parallel_for)
     : matrix_(matrix),
       transposed_matrix_(transposed_matrix),
       variables_info_(variables_info),
       basis_(basis),
       basis_factorization_(basis_factorization),
+      parallel_for_(parallel_for),
       unit_row_left_inverse_(),
       non_zero_position_list_(),
       non_zero_position_set_(),
@@ -90,11 +88,17 @@ void UpdateRow::ComputeUpdateRow(RowIndex leaving_row) {
     const EntryIndex num_col_wise_entries =
         variables_info_.GetNumEntriesInRelevantColumns();
 
+    // Only the column-wise computation is parallel, so its cost is divided by
+    // the number of chunks it would use.
+    const double num_col_wise_chunks =
+        parallel_for_->NumChunks(matrix_.num_cols().value());
+
     // Note that the thresholds were chosen (more or less) from the result of
     // the microbenchmark tests of this file in September 2013.
     // TODO(user): automate the computation of these constants at run-time?
     const double lhs = static_cast<double>(num_row_wise_entries.value());
-    if (lhs < 0.5 * static_cast<double>(num_col_wise_entries.value())) {
+    if (lhs < 0.5 * static_cast<double>(num_col_wise_entries.value()) /
+                  num_col_wise_chunks) {
       if (lhs < 1.1 * static_cast<double>(matrix_.num_cols().value())) {
         ComputeUpdatesRowWiseHypersparse();
         num_operations_ += num_row_wise_entries.value();
@@ -214,14 +218,18 @@ void UpdateRow::ComputeUpdatesColumnWise() {
 
   const ColIndex num_cols = matrix_.num_cols();
   coefficient_.resize(num_cols, 0.0);
-  non_zero_position_list_.clear();
-#ifdef OMP
-  const int num_omp_threads = parameters_.num_omp_threads();
-#else
-  const int num_omp_threads = 1;
-#endif
-  if (num_omp_threads == 1) {
-    for (const ColIndex col : variables_info_.GetIsRelevantBitRow()) {
+  const DenseBitRow& is_relevant = variables_info_.GetIsRelevantBitRow();
+
+  // Each chunk computes the coefficients of a contiguous range of columns, so
+  // the concatenation of the chunk non-zero positions is sorted.
+  chunk_non_zero_positions_.resize(
+      parallel_for_->NumChunks(num_cols.value()));
+  parallel_for_->Run(num_cols.value(), [&](int chunk, int begin, int end) {
+    ColIndexVector* const non_zeros = &chunk_non_zero_positions_[chunk];
+    non_zeros->clear();
+    for (ColIndex col(begin); col < ColIndex(end); ++col) {
+      if (!is_relevant.IsSet(col)) continue;
+
       // Coefficient of the column right inverse on the 'leaving_row'.
       const Fractional coeff =
           matrix_.ColumnScalarProduct(col, unit_row_left_inverse_);
@@ -230,31 +238,19 @@ void UpdateRow::ComputeUpdatesColumnWise() {
       // TODO(user): Be more aggresive and use a threshold to counter
       // computation errors and be a bit faster?
       if (fabs(coeff) > 0.0) {
-        non_zero_position_list_.push_back(col);
+        non_zeros->push_back(col);
         coefficient_[col] = coeff;
       }
     }
+  });
+  if (chunk_non_zero_positions_.size() == 1) {
+    non_zero_position_list_.swap(chunk_non_zero_positions_[0]);
   } else {
-#ifdef OMP
-    // In the multi-threaded case, perform the same computation as in the
-    // single-threaded case above.
-    const DenseBitRow& is_relevant = variables_info_.GetIsRelevantBitRow();
-    const int parallel_loop_size = is_relevant.size().value();
-#pragma omp parallel for num_threads(num_omp_threads)
-    for (int i = 0; i < parallel_loop_size; i++) {
-      const ColIndex col(i);
-      if (is_relevant.IsSet(col)) {
-        coefficient_[col] =
-            matrix_.ColumnScalarProduct(col, unit_row_left_inverse_);
-      }
-    }
-    // end of omp parallel for
-    for (const ColIndex col : variables_info_.GetIsRelevantBitRow()) {
-      if (fabs(coefficient_[col]) > 0.0) {
-        non_zero_position_list_.push_back(col);
-      }
+    non_zero_position_list_.clear();
+    for (const ColIndexVector& non_zeros : chunk_non_zero_positions_) {
+      non_zero_position_list_.insert(non_zero_position_list_.end(),
+                                     non_zeros.begin(), non_zeros.end());
     }
-#endif  // OMP
   }
 }
 
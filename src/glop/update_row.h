@@ -15,6 +15,7 @@
 #define OR_TOOLS_GLOP_UPDATE_ROW_H_
 
 #include "glop/basis_representation.h"
+#include "glop/parallel_for.h"
 #include "glop/parameters.pb.h"
 #include "glop/variables_info.h"
 #include "lp_data/lp_types.h"
@@ -36,11 +37,13 @@ namespace glop {
 //     update_row[col] = (unit_{leaving_row} . B^{-1}) . A_col
 class UpdateRow {
  public:
-  // Takes references to the linear program data we need.
+  // Takes references to the linear program data we need. The column-wise
+  // computation of the update row is run by parallel_for.
   UpdateRow(const CompactSparseMatrix& matrix,
             const CompactSparseMatrix& transposed_matrix,
             const VariablesInfo& variables_info, const RowToColMapping& basis,
-            const BasisFactorization& basis_factorization);
+            const BasisFactorization& basis_factorization,
+            ParallelFor* parallel_for);
 
   // Invalidates the current update row and unit_row_left_inverse so the next
   // call to ComputeUpdateRow() will recompute everything and not just return
@@ -105,6 +108,7 @@ class UpdateRow {
   const VariablesInfo& variables_info_;
   const RowToColMapping& basis_;
   const BasisFactorization& basis_factorization_;
+  ParallelFor* parallel_for_;
 
   // Left inverse by B of a unit row. Its scalar product with a column 'a' of A
   // gives the value of the right inverse of 'a' on the 'leaving_row'.
@@ -117,6 +121,9 @@ class UpdateRow {
   DenseBitRow non_zero_position_set_;
   DenseRow coefficient_;
 
+  // The non-zero positions found by each chunk of ComputeUpdatesColumnWise().
+  std::vector<ColIndexVector> chunk_non_zero_positions_;
+
   // Boolean used to avoid recomputing many times the same thing.
   bool compute_unit_row_left_inverse_;
   bool compute_update_row_;
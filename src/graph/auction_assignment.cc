@@ -0,0 +1,291 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "graph/auction_assignment.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+
+namespace operations_research {
+
+namespace {
+// The factor by which epsilon is divided between two auctions.
+const int kEpsilonDivisor = 5;
+
+// The bids are computed in the calling thread when there are less than this
+// number of bids per thread.
+const int kMinBidsPerThread = 64;
+
+// Calls body(i) for all the i in [0, num_items) on at most num_threads threads,
+// including the calling one. Thread t handles the items i with i % num_workers
+// == t.
+template <typename Body>
+void ParallelFor(int num_threads, int64 num_items, const Body& body) {
+  const int64 num_workers =
+      std::min<int64>(num_threads, num_items / kMinBidsPerThread);
+  if (num_workers <= 1) {
+    for (int64 i = 0; i < num_items; ++i) body(i);
+    return;
+  }
+  auto worker = [num_items, num_workers, &body](int64 first_item) {
+    for (int64 i = first_item; i < num_items; i += num_workers) body(i);
+  };
+  std::vector<std::thread> threads;
+  for (int64 thread = 1; thread < num_workers; ++thread) {
+    threads.push_back(std::thread(worker, thread));
+  }
+  worker(0);
+  for (std::thread& thread : threads) thread.join();
+}
+}  // namespace
+
+template <typename Graph>
+AuctionAssignment<Graph>::AuctionAssignment(const Graph& graph,
+                                            NodeIndex num_left_nodes)
+    : graph_(graph),
+      num_left_nodes_(num_left_nodes),
+      cost_(graph.num_arcs(), 0),
+      has_prices_(false),
+      max_cost_change_(0),
+      cost_scaling_factor_(num_left_nodes + 1),
+      epsilon_(1),
+      single_arc_price_increase_(1),
+      num_threads_(1),
+      success_(false),
+      num_bids_(0) {}
+
+template <typename Graph>
+void AuctionAssignment<Graph>::SetArcCost(ArcIndex arc, CostValue cost) {
+  DCHECK_LE(0, arc);
+  DCHECK_LT(arc, cost_.size());
+  if (max_cost_change_ >= 0) {
+    max_cost_change_ = std::max(max_cost_change_, std::abs(cost - cost_[arc]));
+  }
+  cost_[arc] = cost;
+  success_ = false;
+}
+
+template <typename Graph>
+void AuctionAssignment<Graph>::SetPrices(const std::vector<CostValue>& prices) {
+  CHECK_EQ(graph_.num_nodes() - num_left_nodes_, prices.size());
+  price_ = prices;
+  has_prices_ = true;
+  max_cost_change_ = -1;
+  success_ = false;
+}
+
+template <typename Graph>
+CostValue AuctionAssignment<Graph>::GetCost() const {
+  DCHECK(success_);
+  CostValue cost = 0;
+  for (NodeIndex left_node = 0; left_node < num_left_nodes_; ++left_node) {
+    cost += GetAssignmentCost(left_node);
+  }
+  return cost;
+}
+
+template <typename Graph>
+void AuctionAssignment<Graph>::ComputeBid(NodeIndex left_node, ArcIndex* arc,
+                                          CostValue* price) const {
+  CostValue best_value = kint64max;
+  CostValue second_best_value = kint64max;
+  ArcIndex best_arc = -1;
+  for (const ArcIndex a : graph_.OutgoingArcs(left_node)) {
+    const CostValue value =
+        ScaledCost(a) + price_[graph_.Head(a) - num_left_nodes_];
+    if (value < best_value) {
+      second_best_value = best_value;
+      best_value = value;
+      best_arc = a;
+    } else if (value < second_best_value) {
+      second_best_value = value;
+    }
+  }
+  DCHECK_NE(-1, best_arc);
+  *arc = best_arc;
+  *price = price_[graph_.Head(best_arc) - num_left_nodes_] +
+           (second_best_value == kint64max
+                ? single_arc_price_increase_
+                : second_best_value - best_value + epsilon_);
+}
+
+template <typename Graph>
+typename Graph::NodeIndex AuctionAssignment<Graph>::Assign(NodeIndex left_node,
+                                                           ArcIndex arc,
+                                                           CostValue price) {
+  const NodeIndex right_node = graph_.Head(arc) - num_left_nodes_;
+  const NodeIndex previous_owner = owner_[right_node];
+  if (previous_owner != -1) assigned_arc_[previous_owner] = -1;
+  owner_[right_node] = left_node;
+  assigned_arc_[left_node] = arc;
+  price_[right_node] = price;
+  return previous_owner;
+}
+
+template <typename Graph>
+bool AuctionAssignment<Graph>::RunGaussSeidelAuction(CostValue price_limit) {
+  unassigned_.clear();
+  for (NodeIndex left_node = num_left_nodes_ - 1; left_node >= 0;
+       --left_node) {
+    unassigned_.push_back(left_node);
+  }
+  while (!unassigned_.empty()) {
+    const NodeIndex left_node = unassigned_.back();
+    unassigned_.pop_back();
+    ArcIndex arc;
+    CostValue price;
+    ComputeBid(left_node, &arc, &price);
+    ++num_bids_;
+    if (price > price_limit) return false;
+    const NodeIndex previous_owner = Assign(left_node, arc, price);
+    if (previous_owner != -1) unassigned_.push_back(previous_owner);
+  }
+  return true;
+}
+
+template <typename Graph>
+bool AuctionAssignment<Graph>::RunJacobiAuction(CostValue price_limit) {
+  unassigned_.clear();
+  for (NodeIndex left_node = 0; left_node < num_left_nodes_; ++left_node) {
+    unassigned_.push_back(left_node);
+  }
+  best_bidder_.assign(num_left_nodes_, -1);
+  std::vector<NodeIndex> next_unassigned;
+  std::vector<NodeIndex> bid_right_nodes;
+  while (!unassigned_.empty()) {
+    const int num_bidders = unassigned_.size();
+    bid_arc_.resize(num_bidders);
+    bid_price_.resize(num_bidders);
+    ParallelFor(num_threads_, num_bidders, [this](int64 i) {
+      ComputeBid(unassigned_[i], &bid_arc_[i], &bid_price_[i]);
+    });
+    num_bids_ += num_bidders;
+
+    // Each right node goes to its highest bidder, the first one in case of a
+    // tie.
+    bid_right_nodes.clear();
+    for (int i = 0; i < num_bidders; ++i) {
+      const NodeIndex right_node = graph_.Head(bid_arc_[i]) - num_left_nodes_;
+      const int best_bidder = best_bidder_[right_node];
+      if (best_bidder == -1) {
+        best_bidder_[right_node] = i;
+        bid_right_nodes.push_back(right_node);
+      } else if (bid_price_[i] > bid_price_[best_bidder]) {
+        best_bidder_[right_node] = i;
+      }
+    }
+    next_unassigned.clear();
+    for (int i = 0; i < num_bidders; ++i) {
+      const NodeIndex right_node = graph_.Head(bid_arc_[i]) - num_left_nodes_;
+      if (best_bidder_[right_node] != i) next_unassigned.push_back(i);
+    }
+    for (int j = 0; j < next_unassigned.size(); ++j) {
+      next_unassigned[j] = unassigned_[next_unassigned[j]];
+    }
+    for (const NodeIndex right_node : bid_right_nodes) {
+      const int i = best_bidder_[right_node];
+      best_bidder_[right_node] = -1;
+      if (bid_price_[i] > price_limit) return false;
+      const NodeIndex previous_owner =
+          Assign(unassigned_[i], bid_arc_[i], bid_price_[i]);
+      if (previous_owner != -1) next_unassigned.push_back(previous_owner);
+    }
+    unassigned_.swap(next_unassigned);
+  }
+  return true;
+}
+
+template <typename Graph>
+bool AuctionAssignment<Graph>::ComputeAssignment() {
+  success_ = false;
+  num_bids_ = 0;
+  const NodeIndex num_right_nodes = graph_.num_nodes() - num_left_nodes_;
+  if (num_right_nodes != num_left_nodes_) return false;
+  if (num_left_nodes_ == 0) {
+    success_ = true;
+    return true;
+  }
+  for (NodeIndex left_node = 0; left_node < num_left_nodes_; ++left_node) {
+    bool has_arc = false;
+    for (const ArcIndex arc : graph_.OutgoingArcs(left_node)) {
+      has_arc = arc >= 0;
+      break;
+    }
+    if (!has_arc) return false;
+  }
+  CostValue max_abs_cost = 0;
+  for (const CostValue cost : cost_) {
+    max_abs_cost = std::max(max_abs_cost, std::abs(cost));
+  }
+  // The prices of a feasible problem stay below the initial maximum price plus
+  // about num_left_nodes times the range of the scaled costs, which must not
+  // overflow.
+  cost_scaling_factor_ = num_left_nodes_ + 1;
+  if (max_abs_cost >
+      kint64max / (32 * cost_scaling_factor_ * cost_scaling_factor_)) {
+    LOG(ERROR) << "The costs are too large for the auction algorithm.";
+    return false;
+  }
+  const CostValue scaled_cost_range = 2 * max_abs_cost * cost_scaling_factor_;
+  const CostValue cold_start_epsilon = std::max<CostValue>(
+      1, max_abs_cost * cost_scaling_factor_ / kEpsilonDivisor);
+  if (has_prices_) {
+    // The optimal prices change by about the size of the cost changes, so a
+    // larger epsilon is better after larger changes.
+    const CostValue warm_start_epsilon = std::max(
+        cost_scaling_factor_,
+        max_cost_change_ * cost_scaling_factor_ / kEpsilonDivisor);
+    epsilon_ = std::min(cold_start_epsilon, warm_start_epsilon);
+  } else {
+    price_.assign(num_right_nodes, 0);
+    epsilon_ = cold_start_epsilon;
+  }
+  single_arc_price_increase_ = scaled_cost_range + epsilon_;
+
+  assigned_arc_.resize(num_left_nodes_);
+  owner_.resize(num_right_nodes);
+  while (true) {
+    assigned_arc_.assign(num_left_nodes_, -1);
+    owner_.assign(num_right_nodes, -1);
+    const CostValue price_limit =
+        *std::max_element(price_.begin(), price_.end()) +
+        2 * cost_scaling_factor_ * (scaled_cost_range + epsilon_);
+    const bool feasible = num_threads_ > 1 ? RunJacobiAuction(price_limit)
+                                           : RunGaussSeidelAuction(price_limit);
+    if (!feasible) {
+      has_prices_ = false;
+      return false;
+    }
+    if (epsilon_ == 1) break;
+    epsilon_ = std::max<CostValue>(1, epsilon_ / kEpsilonDivisor);
+  }
+
+  // Only the price differences matter, so we keep the prices small for the
+  // next solves.
+  const CostValue min_price = *std::min_element(price_.begin(), price_.end());
+  for (CostValue& price : price_) price -= min_price;
+  has_prices_ = true;
+  max_cost_change_ = 0;
+  success_ = true;
+  return true;
+}
+
+// Explicit instantiations that can be used by a client.
+template class AuctionAssignment<ListGraph<> >;
+template class AuctionAssignment<StaticGraph<> >;
+template class AuctionAssignment<ReverseArcListGraph<> >;
+template class AuctionAssignment<ReverseArcStaticGraph<> >;
+template class AuctionAssignment<ReverseArcMixedGraph<> >;
+
+}  // namespace operations_research
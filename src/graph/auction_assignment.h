@@ -0,0 +1,172 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// An auction algorithm for the assignment problem, as an alternative to the
+// cost-scaling algorithm of linear_assignment.h that can use several threads
+// and start from the prices of a previous solve. See:
+//
+// D.P. Bertsekas, "The auction algorithm: A distributed relaxation method for
+// the assignment problem", Annals of Operations Research 14:105-123, 1988.
+// D.P. Bertsekas, D.A. Castanon, "Parallel synchronous and asynchronous
+// implementations of the auction algorithm", Parallel Computing 17:707-732,
+// 1991.
+//
+// Each right node has a price, and each unassigned left node bids for the
+// right node j minimizing cost(left, j) + price(j): it raises the price of j
+// until j is epsilon worse than its second best choice, and takes j from its
+// current owner. The solution is optimal once every left node is assigned
+// with epsilon small enough, which is reached by epsilon scaling. Since the
+// costs are multiplied by num_left_nodes + 1 internally, the final epsilon of
+// 1 gives an optimal integral assignment.
+//
+// With one thread, the bids are performed one after the other (Gauss-Seidel
+// style). With more threads, all the unassigned left nodes compute their
+// bids in parallel from the same prices, then each right node goes to its
+// highest bidder (Jacobi style). In both cases the result does not depend on
+// the number of threads.
+//
+// The auction is usually faster than LinearSumAssignment on dense problems,
+// and much faster when it starts from the prices of a previous solve of a
+// similar problem: when ComputeAssignment() is called again after some calls
+// to SetArcCost(), it starts from the last prices with an epsilon
+// proportional to the largest cost change.
+//
+// Example:
+//   AuctionAssignment<StaticGraph<> > assignment(graph, num_left_nodes);
+//   assignment.SetNumThreads(8);
+//   for (...) assignment.SetArcCost(arc, cost);
+//   if (assignment.ComputeAssignment()) {
+//     ... use assignment.GetCost() and assignment.GetMate(left_node) ...
+//   }
+
+#ifndef OR_TOOLS_GRAPH_AUCTION_ASSIGNMENT_H_
+#define OR_TOOLS_GRAPH_AUCTION_ASSIGNMENT_H_
+
+#include <vector>
+
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "base/macros.h"
+#include "graph/ebert_graph.h"
+#include "graph/graph.h"
+
+namespace operations_research {
+
+// The graph must be bipartite: the left nodes are [0, num_left_nodes), the
+// right nodes are [num_left_nodes, graph.num_nodes()) and all the arcs go
+// from a left node to a right node. Only the outgoing arcs of the left nodes
+// are used. See the end of auction_assignment.cc for the graph types this
+// class is compiled for.
+template <typename Graph>
+class AuctionAssignment {
+ public:
+  typedef typename Graph::NodeIndex NodeIndex;
+  typedef typename Graph::ArcIndex ArcIndex;
+
+  // The graph must be fully built and must outlive this object. All the costs
+  // are initially zero.
+  AuctionAssignment(const Graph& graph, NodeIndex num_left_nodes);
+
+  // Sets the cost of the given arc.
+  void SetArcCost(ArcIndex arc, CostValue cost);
+
+  // Sets the number of threads used to compute the bids, 1 by default.
+  void SetNumThreads(int num_threads) { num_threads_ = num_threads; }
+
+  // Computes an assignment of minimum cost, i.e. a perfect matching of the
+  // left nodes to the right nodes. Returns false if there is none (or if the
+  // costs are too large to be scaled without overflow). After the first call,
+  // starts from the last prices.
+  bool ComputeAssignment();
+
+  // The prices of the right nodes: (*prices)[i] is the price of the right
+  // node num_left_nodes + i, in units of 1 / (num_left_nodes + 1) of the
+  // costs. They can be saved after ComputeAssignment(), and given back with
+  // SetPrices() to warm-start the auction on a similar problem, with an
+  // initial epsilon of one cost unit.
+  const std::vector<CostValue>& prices() const { return price_; }
+  void SetPrices(const std::vector<CostValue>& prices);
+
+  // The solution of the last successful ComputeAssignment().
+  CostValue GetCost() const;
+  ArcIndex GetAssignmentArc(NodeIndex left_node) const {
+    DCHECK(success_);
+    return assigned_arc_[left_node];
+  }
+  CostValue GetAssignmentCost(NodeIndex left_node) const {
+    return cost_[GetAssignmentArc(left_node)];
+  }
+  NodeIndex GetMate(NodeIndex left_node) const {
+    return graph_.Head(GetAssignmentArc(left_node));
+  }
+
+  NodeIndex NumLeftNodes() const { return num_left_nodes_; }
+  NodeIndex NumNodes() const { return graph_.num_nodes(); }
+
+  // The number of bids of the last ComputeAssignment().
+  int64 num_bids() const { return num_bids_; }
+
+ private:
+  // The cost scaled by num_left_nodes_ + 1.
+  CostValue ScaledCost(ArcIndex arc) const {
+    return cost_[arc] * cost_scaling_factor_;
+  }
+
+  // Computes the bid of the given left node: the arc to its best right node
+  // and the new price of this right node.
+  void ComputeBid(NodeIndex left_node, ArcIndex* arc, CostValue* price) const;
+
+  // Runs the auction for the current epsilon until all the left nodes are
+  // assigned, starting from an empty assignment. Returns false if a price
+  // exceeds price_limit, which means that there is no perfect matching.
+  bool RunGaussSeidelAuction(CostValue price_limit);
+  bool RunJacobiAuction(CostValue price_limit);
+
+  // Assigns the right node of arc to its left node at the given price.
+  // Returns the previous owner of the right node, or -1.
+  NodeIndex Assign(NodeIndex left_node, ArcIndex arc, CostValue price);
+
+  const Graph& graph_;
+  const NodeIndex num_left_nodes_;
+  std::vector<CostValue> cost_;
+
+  // The prices of the right nodes, the arc assigned to each left node and the
+  // owner (left node) of each right node, or -1.
+  std::vector<CostValue> price_;
+  std::vector<ArcIndex> assigned_arc_;
+  std::vector<NodeIndex> owner_;
+  bool has_prices_;
+  // The largest cost change since the last prices were computed, or -1 if
+  // they were given by SetPrices().
+  CostValue max_cost_change_;
+
+  CostValue cost_scaling_factor_;
+  CostValue epsilon_;
+  // The price increase of a bid for a left node with only one arc.
+  CostValue single_arc_price_increase_;
+
+  // The unassigned left nodes, and the bids of the Jacobi auction.
+  std::vector<NodeIndex> unassigned_;
+  std::vector<ArcIndex> bid_arc_;
+  std::vector<CostValue> bid_price_;
+  std::vector<NodeIndex> best_bidder_;
+
+  int num_threads_;
+  bool success_;
+  int64 num_bids_;
+
+  DISALLOW_COPY_AND_ASSIGN(AuctionAssignment);
+};
+
+}  // namespace operations_research
+#endif  // OR_TOOLS_GRAPH_AUCTION_ASSIGNMENT_H_
@@ -15,13 +15,17 @@
 #include "graph/cliques.h"
 
 #include <algorithm>
+#include <atomic>
 #include "base/hash.h"
 #include <memory>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "base/callback.h"
 #include "base/hash.h"
+#include "base/mutex.h"
+#include "util/bitset.h"
 
 namespace operations_research {
 
@@ -278,4 +282,403 @@ void CoverArcsByCliques(
          node_count, &actual, &stop);
 }
 
+namespace {
+
+// Runs body(thread, i) for all the i in [0, num_items), dynamically
+// dispatched to at most num_threads threads numbered from 0. The calling
+// thread is thread 0.
+void RunInParallel(int num_items, int num_threads,
+                   const std::function<void(int, int)>& body) {
+  const int num_workers = std::max(1, std::min(num_threads, num_items));
+  std::atomic<int> next_item(0);
+  auto worker = [&](int thread) {
+    for (int i = next_item++; i < num_items; i = next_item++) body(thread, i);
+  };
+  std::vector<std::thread> threads;
+  for (int thread = 1; thread < num_workers; ++thread) {
+    threads.push_back(std::thread(worker, thread));
+  }
+  worker(0);
+  for (std::thread& thread : threads) thread.join();
+}
+
+// The number of branches between two checks of the time limit.
+const int kNumBranchesBetweenTimeLimitChecks = 256;
+
+// The state shared by the threads of BitsetBronKerboschAlgorithm::Run().
+struct SharedCliqueSearchState {
+  explicit SharedCliqueSearchState(
+      const BitsetBronKerboschAlgorithm::CliqueCallback& callback)
+      : clique_callback(callback), stop(false) {}
+
+  const BitsetBronKerboschAlgorithm::CliqueCallback& clique_callback;
+  // Serializes the calls to clique_callback.
+  Mutex mutex;
+  std::atomic<bool> stop;
+};
+
+// Enumerates the maximal cliques of the subproblems of
+// BitsetBronKerboschAlgorithm. There is one instance per thread.
+//
+// A subproblem has n local nodes: the p candidates, numbered from 0, followed
+// by the n - p nodes of the initial "not" set. The candidate sets only
+// contain candidates and are stored on p_words = ceil(p / 64) words, while
+// the "not" sets can contain all the local nodes and are stored on
+// n_words = ceil(n / 64) words. Similarly, the adjacency row of a candidate
+// has n_words words, while the row of a node of the initial "not" set only
+// has the p_words words of its neighbors among the candidates, which is all
+// that is needed to choose a pivot.
+class LocalCliqueSearch {
+ public:
+  LocalCliqueSearch(const std::vector<std::vector<int>>& adjacency,
+                    const std::vector<int>& rank)
+      : adjacency_(adjacency),
+        rank_(rank),
+        local_index_(adjacency.size(), -1),
+        num_branches_(0) {}
+
+  // Reports all the maximal cliques whose first node in the degeneracy order
+  // is the given node, unless shared->stop becomes true. When time_limit is
+  // not null, sets shared->stop to true once it is reached.
+  void Solve(int node, SharedCliqueSearchState* shared, TimeLimit* time_limit);
+
+  int64 num_branches() const { return num_branches_; }
+
+ private:
+  uint64* Row(int local_node) {
+    return matrix_.data() +
+           (local_node < num_candidates_
+                ? local_node * n_words_
+                : num_candidates_ * n_words_ +
+                      (local_node - num_candidates_) * p_words_);
+  }
+  uint64* Candidates(int depth) { return stack_.data() + depth * level_size_; }
+  uint64* NotSet(int depth) { return Candidates(depth) + p_words_; }
+  // The candidates that remain to be added to the clique at the given depth:
+  // the candidates that are not neighbors of the pivot.
+  uint64* Branches(int depth) { return NotSet(depth) + n_words_; }
+
+  // Builds the local bit matrix of the subproblem of the given node.
+  void BuildSubproblem(int node);
+
+  // Chooses the pivot at the given depth and initializes Branches(depth).
+  void ChoosePivot(int depth);
+
+  // Calls the clique callback on clique_.
+  void ReportClique(SharedCliqueSearchState* shared);
+
+  const std::vector<std::vector<int>>& adjacency_;
+  const std::vector<int>& rank_;
+
+  // The global index of each local node, and the local index of each global
+  // node or -1.
+  std::vector<int> nodes_;
+  std::vector<int> local_index_;
+  int num_candidates_;
+  int p_words_;
+  int n_words_;
+  std::vector<uint64> matrix_;
+
+  // The candidates, "not" set and branches of each level of the search.
+  int level_size_;
+  std::vector<uint64> stack_;
+  // The first word of Branches(depth) that may still be non-zero.
+  std::vector<int> branch_word_;
+
+  std::vector<int> clique_;
+  int64 num_branches_;
+};
+
+void LocalCliqueSearch::BuildSubproblem(int node) {
+  nodes_.clear();
+  for (const int neighbor : adjacency_[node]) {
+    if (rank_[neighbor] > rank_[node]) nodes_.push_back(neighbor);
+  }
+  num_candidates_ = nodes_.size();
+  for (const int neighbor : adjacency_[node]) {
+    if (rank_[neighbor] < rank_[node]) nodes_.push_back(neighbor);
+  }
+  const int num_local_nodes = nodes_.size();
+  p_words_ = BitLength64(num_candidates_);
+  n_words_ = BitLength64(num_local_nodes);
+  for (int i = 0; i < num_local_nodes; ++i) local_index_[nodes_[i]] = i;
+
+  // Only the adjacency lists of the candidates are scanned: the rows of the
+  // "not" set are filled by symmetry.
+  matrix_.assign(num_candidates_ * n_words_ +
+                     (num_local_nodes - num_candidates_) * p_words_,
+                 0);
+  for (int i = 0; i < num_candidates_; ++i) {
+    uint64* const row = Row(i);
+    for (const int neighbor : adjacency_[nodes_[i]]) {
+      const int j = local_index_[neighbor];
+      if (j < 0) continue;
+      row[BitOffset64(j)] |= OneBit64(BitPos64(j));
+      if (j >= num_candidates_) {
+        Row(j)[BitOffset64(i)] |= OneBit64(BitPos64(i));
+      }
+    }
+  }
+  for (const int local_node : nodes_) local_index_[local_node] = -1;
+
+  // The depth of the search is at most num_candidates_ + 1.
+  level_size_ = 2 * p_words_ + n_words_;
+  stack_.resize((num_candidates_ + 1) * level_size_);
+  branch_word_.resize(num_candidates_ + 1);
+  uint64* const candidates = Candidates(0);
+  uint64* const not_set = NotSet(0);
+  std::fill(candidates, candidates + p_words_, 0);
+  std::fill(not_set, not_set + n_words_, 0);
+  for (int i = 0; i < num_candidates_; ++i) {
+    candidates[BitOffset64(i)] |= OneBit64(BitPos64(i));
+  }
+  for (int i = num_candidates_; i < num_local_nodes; ++i) {
+    not_set[BitOffset64(i)] |= OneBit64(BitPos64(i));
+  }
+}
+
+void LocalCliqueSearch::ChoosePivot(int depth) {
+  const uint64* const candidates = Candidates(depth);
+  const uint64* const not_set = NotSet(depth);
+  int num_remaining_candidates = 0;
+  for (int w = 0; w < p_words_; ++w) {
+    num_remaining_candidates += BitCount64(candidates[w]);
+  }
+  int pivot = -1;
+  int max_num_neighbors = -1;
+  // The pivot is first looked for in the "not" set: if one of its nodes is
+  // connected to all the candidates, there is no new maximal clique.
+  bool is_best_possible = false;
+  for (int pass = 0; pass < 2 && !is_best_possible; ++pass) {
+    const uint64* const set = pass == 0 ? not_set : candidates;
+    const int num_words = pass == 0 ? n_words_ : p_words_;
+    // A candidate is not its own neighbor.
+    const int best_possible = num_remaining_candidates - pass;
+    for (int w = 0; w < num_words && !is_best_possible; ++w) {
+      for (uint64 word = set[w]; word != 0 && !is_best_possible;
+           word &= word - 1) {
+        const int node = BitShift64(w) + LeastSignificantBitPosition64(word);
+        const uint64* const row = Row(node);
+        int num_neighbors = 0;
+        for (int i = 0; i < p_words_; ++i) {
+          num_neighbors += BitCount64(candidates[i] & row[i]);
+        }
+        if (num_neighbors > max_num_neighbors) {
+          max_num_neighbors = num_neighbors;
+          pivot = node;
+          is_best_possible = num_neighbors == best_possible;
+        }
+      }
+    }
+  }
+  DCHECK_NE(-1, pivot);
+  uint64* const branches = Branches(depth);
+  const uint64* const pivot_row = Row(pivot);
+  for (int w = 0; w < p_words_; ++w) {
+    branches[w] = candidates[w] & ~pivot_row[w];
+  }
+  branch_word_[depth] = 0;
+}
+
+void LocalCliqueSearch::ReportClique(SharedCliqueSearchState* shared) {
+  MutexLock lock(&shared->mutex);
+  if (shared->stop) return;
+  if (shared->clique_callback(clique_) == CliqueResponse::STOP) {
+    shared->stop = true;
+  }
+}
+
+void LocalCliqueSearch::Solve(int node, SharedCliqueSearchState* shared,
+                              TimeLimit* time_limit) {
+  clique_.assign(1, node);
+  if (adjacency_[node].empty()) {
+    ReportClique(shared);
+    return;
+  }
+  BuildSubproblem(node);
+  // If node has no later neighbor, its earlier neighbors extend {node}.
+  if (num_candidates_ == 0) return;
+  ChoosePivot(0);
+  int depth = 0;
+  while (depth >= 0) {
+    uint64* const branches = Branches(depth);
+    int& w = branch_word_[depth];
+    while (w < p_words_ && branches[w] == 0) ++w;
+    if (w == p_words_) {
+      // Return from the recursive call of this level.
+      --depth;
+      if (depth >= 0) clique_.pop_back();
+      continue;
+    }
+    const int selected = BitShift64(w) + LeastSignificantBitPosition64(
+                                             branches[w]);
+    branches[w] &= branches[w] - 1;
+
+    ++num_branches_;
+    if (num_branches_ % kNumBranchesBetweenTimeLimitChecks == 0) {
+      if (time_limit != nullptr && time_limit->LimitReached()) {
+        shared->stop = true;
+      }
+      if (shared->stop) return;
+    }
+
+    // The candidates and "not" set of the next level are the neighbors of
+    // selected, which then moves from the candidates to the "not" set of the
+    // current level.
+    uint64* const candidates = Candidates(depth);
+    uint64* const not_set = NotSet(depth);
+    uint64* const next_candidates = Candidates(depth + 1);
+    uint64* const next_not_set = NotSet(depth + 1);
+    const uint64* const row = Row(selected);
+    uint64 has_candidates = 0;
+    for (int i = 0; i < p_words_; ++i) {
+      next_candidates[i] = candidates[i] & row[i];
+      has_candidates |= next_candidates[i];
+    }
+    uint64 has_not_set = 0;
+    for (int i = 0; i < n_words_; ++i) {
+      next_not_set[i] = not_set[i] & row[i];
+      has_not_set |= next_not_set[i];
+    }
+    candidates[w] &= ~OneBit64(BitPos64(selected));
+    not_set[w] |= OneBit64(BitPos64(selected));
+    clique_.push_back(nodes_[selected]);
+    if (has_candidates == 0) {
+      if (has_not_set == 0) ReportClique(shared);
+      clique_.pop_back();
+      continue;
+    }
+    ++depth;
+    ChoosePivot(depth);
+  }
+}
+
+}  // namespace
+
+BitsetBronKerboschAlgorithm::BitsetBronKerboschAlgorithm(int num_nodes)
+    : num_nodes_(num_nodes),
+      adjacency_(num_nodes),
+      num_threads_(1),
+      num_branches_(0) {}
+
+BitsetBronKerboschAlgorithm::BitsetBronKerboschAlgorithm(
+    const std::function<bool(int, int)>& is_arc, int num_nodes)
+    : BitsetBronKerboschAlgorithm(num_nodes) {
+  for (int i = 0; i < num_nodes; ++i) {
+    for (int j = i + 1; j < num_nodes; ++j) {
+      if (is_arc(i, j)) AddArc(i, j);
+    }
+  }
+}
+
+void BitsetBronKerboschAlgorithm::AddArc(int node1, int node2) {
+  DCHECK_LE(0, node1);
+  DCHECK_LT(node1, num_nodes_);
+  DCHECK_LE(0, node2);
+  DCHECK_LT(node2, num_nodes_);
+  if (node1 == node2) return;
+  adjacency_[node1].push_back(node2);
+  adjacency_[node2].push_back(node1);
+}
+
+void BitsetBronKerboschAlgorithm::ComputeDegeneracyOrder() {
+  int max_degree = 0;
+  for (std::vector<int>& neighbors : adjacency_) {
+    std::sort(neighbors.begin(), neighbors.end());
+    neighbors.erase(std::unique(neighbors.begin(), neighbors.end()),
+                    neighbors.end());
+    max_degree = std::max<int>(max_degree, neighbors.size());
+  }
+
+  // The bucket algorithm of V. Batagelj, M. Zaversnik, "An O(m) algorithm for
+  // cores decomposition of networks", 2003: the nodes are sorted by degree in
+  // order_, and bucket_start[d] is the position of the first node of degree d.
+  // Removing the first node decrements the degree of its remaining
+  // neighbors, which are moved to the start of their bucket.
+  std::vector<int> degree(num_nodes_);
+  std::vector<int> bucket_start(max_degree + 1, 0);
+  for (int node = 0; node < num_nodes_; ++node) {
+    degree[node] = adjacency_[node].size();
+    ++bucket_start[degree[node]];
+  }
+  int start = 0;
+  for (int d = 0; d <= max_degree; ++d) {
+    const int bucket_size = bucket_start[d];
+    bucket_start[d] = start;
+    start += bucket_size;
+  }
+  std::vector<int> order(num_nodes_);
+  rank_.resize(num_nodes_);
+  for (int node = 0; node < num_nodes_; ++node) {
+    rank_[node] = bucket_start[degree[node]]++;
+    order[rank_[node]] = node;
+  }
+  for (int d = max_degree; d > 0; --d) bucket_start[d] = bucket_start[d - 1];
+  bucket_start[0] = 0;
+  for (int i = 0; i < num_nodes_; ++i) {
+    const int node = order[i];
+    for (const int neighbor : adjacency_[node]) {
+      if (degree[neighbor] <= degree[node]) continue;
+      // Swaps neighbor with the first node of its bucket, and moves the start
+      // of the bucket after it.
+      const int neighbor_degree = degree[neighbor];
+      const int first_rank = bucket_start[neighbor_degree];
+      const int first_node = order[first_rank];
+      if (first_node != neighbor) {
+        order[rank_[neighbor]] = first_node;
+        rank_[first_node] = rank_[neighbor];
+        order[first_rank] = neighbor;
+        rank_[neighbor] = first_rank;
+      }
+      ++bucket_start[neighbor_degree];
+      --degree[neighbor];
+    }
+  }
+}
+
+BronKerboschAlgorithmStatus BitsetBronKerboschAlgorithm::Run(
+    const CliqueCallback& clique_callback) {
+  return RunWithTimeLimit(clique_callback, nullptr);
+}
+
+BronKerboschAlgorithmStatus BitsetBronKerboschAlgorithm::RunWithTimeLimit(
+    const CliqueCallback& clique_callback, TimeLimit* time_limit) {
+  ComputeDegeneracyOrder();
+
+  // The subproblems with the most candidates, which are usually the longest
+  // to solve, are solved first so that they don't end up on a single thread
+  // at the end of the search.
+  std::vector<int> num_candidates(num_nodes_, 0);
+  for (int node = 0; node < num_nodes_; ++node) {
+    for (const int neighbor : adjacency_[node]) {
+      if (rank_[neighbor] > rank_[node]) ++num_candidates[node];
+    }
+  }
+  std::vector<int> subproblems(num_nodes_);
+  std::iota(subproblems.begin(), subproblems.end(), 0);
+  std::stable_sort(subproblems.begin(), subproblems.end(),
+                   [&num_candidates](int a, int b) {
+                     return num_candidates[a] > num_candidates[b];
+                   });
+
+  SharedCliqueSearchState shared(clique_callback);
+  const int num_workers =
+      std::max(1, std::min(num_threads_, std::max(1, num_nodes_)));
+  std::vector<std::unique_ptr<LocalCliqueSearch>> searches;
+  for (int thread = 0; thread < num_workers; ++thread) {
+    searches.emplace_back(new LocalCliqueSearch(adjacency_, rank_));
+  }
+  RunInParallel(num_nodes_, num_workers,
+                [&searches, &subproblems, &shared, time_limit](int thread,
+                                                               int i) {
+                  if (shared.stop) return;
+                  searches[thread]->Solve(subproblems[i], &shared,
+                                          thread == 0 ? time_limit : nullptr);
+                });
+  num_branches_ = 0;
+  for (const auto& search : searches) num_branches_ += search->num_branches();
+  return shared.stop ? BronKerboschAlgorithmStatus::INTERRUPTED
+                     : BronKerboschAlgorithmStatus::COMPLETED;
+}
+
 }  // namespace operations_research
@@ -15,12 +15,51 @@
 #include "graph/connectivity.h"
 
 #include <algorithm>
+#include <numeric>
+#include <thread>
 #include <vector>
 
 #include "base/logging.h"
 
 namespace operations_research {
 
+namespace {
+// ParallelFor() runs in the calling thread when there are less than this number
+// of items per thread.
+const int kMinItemsPerThread = 1024;
+
+// The number of consecutive items processed by a thread at a time.
+const int kParallelForBlockSize = 256;
+
+// Calls body(i) for all the i in [0, num_items) on at most num_threads threads,
+// including the calling one.
+template <typename Body>
+void ParallelFor(int num_threads, int64 num_items, const Body& body) {
+  const int64 num_workers =
+      std::min<int64>(num_threads, num_items / kMinItemsPerThread);
+  if (num_workers <= 1) {
+    for (int64 i = 0; i < num_items; ++i) body(i);
+    return;
+  }
+  std::atomic<int64> next_block(0);
+  auto worker = [num_items, &body, &next_block]() {
+    while (true) {
+      const int64 begin = next_block.fetch_add(kParallelForBlockSize);
+      if (begin >= num_items) return;
+      const int64 end =
+          std::min<int64>(num_items, begin + kParallelForBlockSize);
+      for (int64 i = begin; i < end; ++i) body(i);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int64 thread = 1; thread < num_workers; ++thread) {
+    threads.push_back(std::thread(worker));
+  }
+  worker();
+  for (std::thread& thread : threads) thread.join();
+}
+}  // namespace
+
 #define DCHECK_NODE_BOUNDS(node_index, num_nodes) \
   do {                                            \
     DCHECK_LE(0, node_index);                     \
@@ -104,4 +143,71 @@ void ConnectedComponents::MergeClasses(NodeIndex node1, NodeIndex node2) {
 
 #undef DCHECK_NODE_BOUNDS
 
+template <typename Graph>
+typename Graph::NodeIndex ComputeConnectedComponents(
+    const Graph& graph, int num_threads,
+    std::vector<typename Graph::NodeIndex>* component_of_node,
+    std::vector<typename Graph::NodeIndex>* component_start,
+    std::vector<typename Graph::NodeIndex>* component_nodes) {
+  typedef typename Graph::NodeIndex NodeIndexType;
+  typedef typename Graph::ArcIndex ArcIndexType;
+  CHECK(component_of_node != nullptr);
+  DCHECK_EQ(component_start == nullptr, component_nodes == nullptr);
+  const NodeIndexType num_nodes = graph.num_nodes();
+  ConcurrentUnionFind<NodeIndexType> union_find(num_nodes);
+  ParallelFor(num_threads, num_nodes, [&graph, &union_find](int64 node) {
+    for (const ArcIndexType arc : graph.OutgoingArcs(node)) {
+      union_find.AddArc(node, graph.Head(arc));
+    }
+  });
+
+  component_of_node->resize(num_nodes);
+  ParallelFor(num_threads, num_nodes,
+              [component_of_node, &union_find](int64 node) {
+                (*component_of_node)[node] = union_find.FindRoot(node);
+              });
+  // The root of a component is its smallest node, so its number is known
+  // when its other nodes are reached.
+  NodeIndexType num_components = 0;
+  for (NodeIndexType node = 0; node < num_nodes; ++node) {
+    NodeIndexType& component = (*component_of_node)[node];
+    component =
+        component == node ? num_components++ : (*component_of_node)[component];
+  }
+
+  if (component_start != nullptr && component_nodes != nullptr) {
+    component_start->assign(num_components + 1, 0);
+    for (const NodeIndexType component : *component_of_node) {
+      ++(*component_start)[component + 1];
+    }
+    std::partial_sum(component_start->begin(), component_start->end(),
+                     component_start->begin());
+    std::vector<NodeIndexType> next_position(component_start->begin(),
+                                             component_start->end() - 1);
+    component_nodes->resize(num_nodes);
+    for (NodeIndexType node = 0; node < num_nodes; ++node) {
+      (*component_nodes)[next_position[(*component_of_node)[node]]++] = node;
+    }
+  }
+  return num_components;
+}
+
+// Explicit instantiations that can be used by a client.
+#define INSTANTIATE_COMPUTE_CONNECTED_COMPONENTS(Graph)             \
+  template Graph::NodeIndex ComputeConnectedComponents<Graph>(      \
+      const Graph& graph, int num_threads,                          \
+      std::vector<Graph::NodeIndex>* component_of_node,             \
+      std::vector<Graph::NodeIndex>* component_start,               \
+      std::vector<Graph::NodeIndex>* component_nodes)
+INSTANTIATE_COMPUTE_CONNECTED_COMPONENTS(ListGraph<>);
+INSTANTIATE_COMPUTE_CONNECTED_COMPONENTS(StaticGraph<>);
+INSTANTIATE_COMPUTE_CONNECTED_COMPONENTS(ReverseArcListGraph<>);
+INSTANTIATE_COMPUTE_CONNECTED_COMPONENTS(ReverseArcStaticGraph<>);
+INSTANTIATE_COMPUTE_CONNECTED_COMPONENTS(ReverseArcMixedGraph<>);
+typedef StaticGraph<int32, int64> LargeStaticGraph;
+typedef ReverseArcStaticGraph<int32, int64> LargeReverseArcStaticGraph;
+INSTANTIATE_COMPUTE_CONNECTED_COMPONENTS(LargeStaticGraph);
+INSTANTIATE_COMPUTE_CONNECTED_COMPONENTS(LargeReverseArcStaticGraph);
+#undef INSTANTIATE_COMPUTE_CONNECTED_COMPONENTS
+
 }  // namespace operations_research
@@ -15,16 +15,26 @@
 // Graph connectivity algorithm for undirected graphs.
 // Memory consumption: O(n) where m is the number of arcs and n the number
 // of nodes.
+//
+// ConnectedComponents is a sequential union-find fed one arc at a time.
+// ConcurrentUnionFind can be fed from several threads at the same time, and
+// ComputeConnectedComponents() uses it to compute the components of a graph.h
+// graph in parallel.
 // TODO(user): add depth-first-search based connectivity for directed graphs.
 // TODO(user): add depth-first-search based biconnectivity for directed graphs.
 
 #ifndef OR_TOOLS_GRAPH_CONNECTIVITY_H_
 #define OR_TOOLS_GRAPH_CONNECTIVITY_H_
 
+#include <atomic>
+#include <utility>
+#include <vector>
+
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/macros.h"
 #include "graph/ebert_graph.h"
+#include "graph/graph.h"
 
 namespace operations_research {
 
@@ -113,6 +123,84 @@ class ConnectedComponents {
   DISALLOW_COPY_AND_ASSIGN(ConnectedComponents);
 };
 
+// A lock-free union-find on which AddArc() and FindRoot() can be called
+// concurrently from several threads. The root of a class is always linked to
+// a root with a smaller index with a compare-and-swap, which fails and is
+// retried if another thread has linked it in the meantime. Since the parent of
+// a node can only decrease, the paths are halved with a compare-and-swap too,
+// without any risk of creating a cycle. See S.V. Jayanti, R.E. Tarjan,
+// "A randomized concurrent algorithm for disjoint set union", PODC 2016, for
+// the analysis of such algorithms.
+//
+// Once all the calls to AddArc() are done, the root of each class is its
+// smallest node.
+template <typename NodeIndexType>
+class ConcurrentUnionFind {
+ public:
+  explicit ConcurrentUnionFind(NodeIndexType num_nodes) : parent_(num_nodes) {
+    for (NodeIndexType node = 0; node < num_nodes; ++node) {
+      parent_[node].store(node, std::memory_order_relaxed);
+    }
+  }
+
+  NodeIndexType num_nodes() const { return parent_.size(); }
+
+  // Returns the root of the class of node.
+  NodeIndexType FindRoot(NodeIndexType node) {
+    DCHECK_LE(0, node);
+    DCHECK_LT(node, num_nodes());
+    while (true) {
+      NodeIndexType parent = parent_[node].load(std::memory_order_relaxed);
+      if (parent == node) return node;
+      const NodeIndexType grandparent =
+          parent_[parent].load(std::memory_order_relaxed);
+      if (grandparent != parent) {
+        parent_[node].compare_exchange_weak(parent, grandparent,
+                                            std::memory_order_relaxed);
+      }
+      node = grandparent;
+    }
+  }
+
+  // Merges the classes of node1 and node2.
+  void AddArc(NodeIndexType node1, NodeIndexType node2) {
+    while (true) {
+      node1 = FindRoot(node1);
+      node2 = FindRoot(node2);
+      if (node1 == node2) return;
+      if (node1 < node2) std::swap(node1, node2);
+      NodeIndexType expected = node1;
+      if (parent_[node1].compare_exchange_strong(expected, node2,
+                                                 std::memory_order_relaxed)) {
+        return;
+      }
+    }
+  }
+
+ private:
+  std::vector<std::atomic<NodeIndexType>> parent_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConcurrentUnionFind);
+};
+
+// Computes the connected components of the given graph, seen as undirected,
+// by feeding its arcs to a ConcurrentUnionFind from num_threads threads.
+// Returns the number of components, which are numbered from 0 in the order of
+// their smallest node: (*component_of_node)[node] is the component of node.
+// If component_start and component_nodes are not null, they receive the nodes
+// of each component in CSR form: the nodes of the component c are
+// (*component_nodes)[(*component_start)[c]], ...,
+// (*component_nodes)[(*component_start)[c + 1] - 1], in increasing order.
+//
+// See the end of connectivity.cc for the graph types this function is
+// compiled for.
+template <typename Graph>
+typename Graph::NodeIndex ComputeConnectedComponents(
+    const Graph& graph, int num_threads,
+    std::vector<typename Graph::NodeIndex>* component_of_node,
+    std::vector<typename Graph::NodeIndex>* component_start,
+    std::vector<typename Graph::NodeIndex>* component_nodes);
+
 }  // namespace operations_research
 
 #endif  // OR_TOOLS_GRAPH_CONNECTIVITY_H_
@@ -0,0 +1,827 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "graph/contraction_hierarchy.h"
+
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>  // NOLINT
+#include <utility>
+
+#if !defined(_MSC_VER)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "base/file.h"
+#include "graph/shortestpaths.h"
+
+namespace operations_research {
+
+namespace {
+
+// The file format, in native byte order, is a sequence of int64 words:
+// - kFileMagic, the number of nodes, and the number of arcs of the upward and
+//   downward search graphs.
+// - For each of the two search graphs, the start, head and middle arrays of
+//   int32 and the length array of int64, each padded to a whole number of
+//   words.
+const int64 kFileMagic = 0x3130484354524f4fLL;
+const int kHeaderNumWords = 4;
+
+// The maximum number of nodes settled by a witness search. If no witness is
+// found within this limit, the shortcut is added, which is always correct.
+const int kMaxWitnessSettledNodes = 100;
+
+template <typename T>
+int64 NumWords(int64 num_elements) {
+  return (num_elements * static_cast<int64>(sizeof(T)) + 7) / 8;
+}
+
+int64 SearchGraphNumWords(int64 num_nodes, int64 num_arcs) {
+  return NumWords<int32>(num_nodes + 1) + 2 * NumWords<int32>(num_arcs) +
+         num_arcs;
+}
+
+// Runs body(thread, i) for all the i in [0, num_items), dynamically
+// dispatched to at most num_threads threads numbered from 0.
+void RunInParallel(int num_items, int num_threads,
+                   const std::function<void(int, int)>& body) {
+  const int num_workers = std::max(1, std::min(num_threads, num_items));
+  std::atomic<int> next_item(0);
+  auto worker = [&](int thread) {
+    for (int i = next_item++; i < num_items; i = next_item++) body(thread, i);
+  };
+  if (num_workers == 1) {
+    worker(0);
+    return;
+  }
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < num_workers; ++thread) {
+    threads.push_back(std::thread(worker, thread));
+  }
+  for (std::thread& thread : threads) thread.join();
+}
+
+// An arc of the graph being contracted, stored at one of its ends.
+struct ContractionArc {
+  ContractionArc(int32 n, int32 m, int64 l) : node(n), middle(m), length(l) {}
+
+  // The other end of the arc.
+  int32 node;
+  // The contracted node for a shortcut, or -1.
+  int32 middle;
+  int64 length;
+};
+typedef std::vector<std::vector<ContractionArc>> ContractionArcs;
+
+struct Shortcut {
+  int32 tail;
+  int32 head;
+  int64 length;
+};
+
+enum NodeState : int8 { REMAINING, CONTRACTING, CONTRACTED };
+
+// A Dijkstra search limited to the remaining nodes minus one avoided node, to
+// look for witness paths. This is a reusable workspace.
+class WitnessSearch {
+ public:
+  explicit WitnessSearch(int num_nodes) : distance_(num_nodes, kint64max) {
+    heap_.Reset(num_nodes);
+  }
+
+  // Runs the search from source until the distances exceed max_distance or
+  // kMaxWitnessSettledNodes nodes are settled.
+  void Run(const ContractionArcs& outgoing, const std::vector<NodeState>& state,
+           int32 source, int32 avoided_node, int64 max_distance);
+
+  // Returns the length of the shortest path to the node found by the last
+  // Run(), which is an upper bound of the distance from the source.
+  int64 distance(int32 node) const { return distance_[node]; }
+
+ private:
+  std::vector<int64> distance_;
+  std::vector<int32> reached_nodes_;
+  FourAryNodeHeap<int32, int64> heap_;
+
+  DISALLOW_COPY_AND_ASSIGN(WitnessSearch);
+};
+
+void WitnessSearch::Run(const ContractionArcs& outgoing,
+                        const std::vector<NodeState>& state, int32 source,
+                        int32 avoided_node, int64 max_distance) {
+  for (const int32 node : reached_nodes_) distance_[node] = kint64max;
+  reached_nodes_.clear();
+  heap_.Clear();
+  distance_[source] = 0;
+  reached_nodes_.push_back(source);
+  heap_.InsertOrDecrease(source, 0);
+  int num_settled_nodes = 0;
+  while (!heap_.IsEmpty()) {
+    const int32 node = heap_.TopNode();
+    const int64 distance = heap_.TopKey();
+    if (distance > max_distance) break;
+    if (++num_settled_nodes > kMaxWitnessSettledNodes) break;
+    heap_.Pop();
+    for (const ContractionArc& arc : outgoing[node]) {
+      if (arc.node == avoided_node || state[arc.node] != REMAINING) continue;
+      const int64 new_distance = distance + arc.length;
+      if (new_distance < distance_[arc.node]) {
+        if (distance_[arc.node] == kint64max) {
+          reached_nodes_.push_back(arc.node);
+        }
+        distance_[arc.node] = new_distance;
+        heap_.InsertOrDecrease(arc.node, new_distance);
+      }
+    }
+  }
+}
+
+// Contracts all the nodes of a graph and exports the resulting search graphs.
+class HierarchyBuilder {
+ public:
+  HierarchyBuilder(const ContractionHierarchy::Graph& graph,
+                   const std::vector<int64>& arc_lengths);
+
+  void ContractAllNodes(int num_threads);
+
+  // Fills buffer with the search graphs in the file format.
+  void ExportData(std::vector<int64>* buffer) const;
+
+ private:
+  // Adds the arc tail -> head, or decreases the length of the existing one.
+  void AddArc(int32 tail, int32 head, int32 middle, int64 length);
+
+  // Fills shortcuts with the shortcuts needed to contract the node.
+  void ComputeShortcuts(int32 node, WitnessSearch* search,
+                        std::vector<Shortcut>* shortcuts) const;
+
+  // Returns the priority of the node (the lower, the earlier it is
+  // contracted): a weighted sum of the number of shortcuts minus the number of
+  // removed arcs, of the number of already contracted neighbors, and of the
+  // depth of the node in the hierarchy so far. The last two spread the
+  // contraction uniformly over the graph, which keeps the searches small.
+  int ComputePriority(int32 node, WitnessSearch* search) const;
+
+  // Returns true if the node has a smaller priority than all its neighbors.
+  bool IsLocalMinimum(int32 node) const;
+
+  // Removes the arcs to the contracted nodes from the arcs of the node.
+  void RemoveContractedArcs(int32 node);
+
+  const int32 num_nodes_;
+  ContractionArcs outgoing_;
+  ContractionArcs incoming_;
+  std::vector<NodeState> state_;
+  std::vector<int> priority_;
+  std::vector<int> num_contracted_neighbors_;
+  // One plus the maximum depth of the contracted neighbors, or 0.
+  std::vector<int> depth_;
+
+  // The arcs to the nodes that were not contracted yet when the node was
+  // contracted, i.e. the arcs of the upward and downward search graphs.
+  ContractionArcs upward_arcs_;
+  ContractionArcs downward_arcs_;
+
+  DISALLOW_COPY_AND_ASSIGN(HierarchyBuilder);
+};
+
+HierarchyBuilder::HierarchyBuilder(const ContractionHierarchy::Graph& graph,
+                                   const std::vector<int64>& arc_lengths)
+    : num_nodes_(graph.num_nodes()),
+      outgoing_(num_nodes_),
+      incoming_(num_nodes_),
+      state_(num_nodes_, REMAINING),
+      priority_(num_nodes_, 0),
+      num_contracted_neighbors_(num_nodes_, 0),
+      depth_(num_nodes_, 0),
+      upward_arcs_(num_nodes_),
+      downward_arcs_(num_nodes_) {
+  CHECK_GE(arc_lengths.size(), graph.num_arcs());
+  for (int32 node = 0; node < num_nodes_; ++node) {
+    for (const ContractionHierarchy::ArcIndex arc :
+         graph.OutgoingArcs(node)) {
+      CHECK_GE(arc_lengths[arc], 0);
+      AddArc(node, graph.Head(arc), -1, arc_lengths[arc]);
+    }
+  }
+}
+
+void HierarchyBuilder::AddArc(int32 tail, int32 head, int32 middle,
+                              int64 length) {
+  if (tail == head) return;
+  for (ContractionArc& arc : outgoing_[tail]) {
+    if (arc.node != head) continue;
+    if (length < arc.length) {
+      arc.length = length;
+      arc.middle = middle;
+      for (ContractionArc& reverse_arc : incoming_[head]) {
+        if (reverse_arc.node == tail) {
+          reverse_arc.length = length;
+          reverse_arc.middle = middle;
+          break;
+        }
+      }
+    }
+    return;
+  }
+  outgoing_[tail].push_back(ContractionArc(head, middle, length));
+  incoming_[head].push_back(ContractionArc(tail, middle, length));
+}
+
+void HierarchyBuilder::ComputeShortcuts(
+    int32 node, WitnessSearch* search, std::vector<Shortcut>* shortcuts) const {
+  shortcuts->clear();
+  int64 max_outgoing_length = 0;
+  for (const ContractionArc& arc : outgoing_[node]) {
+    if (state_[arc.node] != REMAINING) continue;
+    max_outgoing_length = std::max(max_outgoing_length, arc.length);
+  }
+  for (const ContractionArc& in : incoming_[node]) {
+    if (state_[in.node] != REMAINING) continue;
+    search->Run(outgoing_, state_, in.node, node,
+                in.length + max_outgoing_length);
+    for (const ContractionArc& out : outgoing_[node]) {
+      if (state_[out.node] != REMAINING || out.node == in.node) continue;
+      const int64 length = in.length + out.length;
+      if (search->distance(out.node) > length) {
+        Shortcut shortcut;
+        shortcut.tail = in.node;
+        shortcut.head = out.node;
+        shortcut.length = length;
+        shortcuts->push_back(shortcut);
+      }
+    }
+  }
+}
+
+int HierarchyBuilder::ComputePriority(int32 node, WitnessSearch* search) const {
+  std::vector<Shortcut> shortcuts;
+  ComputeShortcuts(node, search, &shortcuts);
+  int num_removed_arcs = 0;
+  for (const ContractionArc& arc : outgoing_[node]) {
+    if (state_[arc.node] == REMAINING) ++num_removed_arcs;
+  }
+  for (const ContractionArc& arc : incoming_[node]) {
+    if (state_[arc.node] == REMAINING) ++num_removed_arcs;
+  }
+  return 4 * (static_cast<int>(shortcuts.size()) - num_removed_arcs) +
+         2 * num_contracted_neighbors_[node] + depth_[node];
+}
+
+bool HierarchyBuilder::IsLocalMinimum(int32 node) const {
+  const std::pair<int, int32> key(priority_[node], node);
+  for (const ContractionArcs* arcs : {&outgoing_, &incoming_}) {
+    for (const ContractionArc& arc : (*arcs)[node]) {
+      if (state_[arc.node] != REMAINING) continue;
+      if (std::make_pair(priority_[arc.node], arc.node) < key) return false;
+    }
+  }
+  return true;
+}
+
+void HierarchyBuilder::RemoveContractedArcs(int32 node) {
+  for (std::vector<ContractionArc>* arcs :
+       {&outgoing_[node], &incoming_[node]}) {
+    arcs->erase(std::remove_if(arcs->begin(), arcs->end(),
+                               [this](const ContractionArc& arc) {
+                                 return state_[arc.node] == CONTRACTED;
+                               }),
+                arcs->end());
+  }
+}
+
+void HierarchyBuilder::ContractAllNodes(int num_threads) {
+  const int num_searches = std::max(1, num_threads);
+  std::vector<std::unique_ptr<WitnessSearch>> searches(num_searches);
+  for (int i = 0; i < num_searches; ++i) {
+    searches[i].reset(new WitnessSearch(num_nodes_));
+  }
+  RunInParallel(num_nodes_, num_threads, [&](int thread, int node) {
+    priority_[node] = ComputePriority(node, searches[thread].get());
+  });
+
+  // Each round contracts the nodes with a smaller priority than all their
+  // neighbors. Their witness searches ignore all these nodes, so the shortcuts
+  // of the different nodes can be computed in parallel: a path through two of
+  // them always has an arc between them and another node.
+  std::vector<int32> remaining_nodes(num_nodes_);
+  for (int32 node = 0; node < num_nodes_; ++node) remaining_nodes[node] = node;
+  std::vector<int32> selected_nodes;
+  std::vector<std::vector<Shortcut>> shortcuts;
+  std::vector<int32> neighbors;
+  while (!remaining_nodes.empty()) {
+    selected_nodes.clear();
+    for (const int32 node : remaining_nodes) {
+      if (IsLocalMinimum(node)) selected_nodes.push_back(node);
+    }
+    DCHECK(!selected_nodes.empty());
+    for (const int32 node : selected_nodes) state_[node] = CONTRACTING;
+    const int num_selected_nodes = selected_nodes.size();
+    shortcuts.resize(num_selected_nodes);
+    RunInParallel(num_selected_nodes, num_threads, [&](int thread, int i) {
+      ComputeShortcuts(selected_nodes[i], searches[thread].get(),
+                       &shortcuts[i]);
+    });
+
+    // Applies the contractions in a deterministic order.
+    neighbors.clear();
+    for (int i = 0; i < num_selected_nodes; ++i) {
+      const int32 node = selected_nodes[i];
+      for (const ContractionArc& arc : outgoing_[node]) {
+        if (state_[arc.node] != REMAINING) continue;
+        upward_arcs_[node].push_back(arc);
+        neighbors.push_back(arc.node);
+        depth_[arc.node] = std::max(depth_[arc.node], depth_[node] + 1);
+      }
+      for (const ContractionArc& arc : incoming_[node]) {
+        if (state_[arc.node] != REMAINING) continue;
+        downward_arcs_[node].push_back(arc);
+        neighbors.push_back(arc.node);
+        depth_[arc.node] = std::max(depth_[arc.node], depth_[node] + 1);
+      }
+      state_[node] = CONTRACTED;
+      std::vector<ContractionArc>().swap(outgoing_[node]);
+      std::vector<ContractionArc>().swap(incoming_[node]);
+      for (const Shortcut& shortcut : shortcuts[i]) {
+        AddArc(shortcut.tail, shortcut.head, node, shortcut.length);
+      }
+    }
+    for (const int32 neighbor : neighbors) {
+      ++num_contracted_neighbors_[neighbor];
+    }
+    std::sort(neighbors.begin(), neighbors.end());
+    neighbors.erase(std::unique(neighbors.begin(), neighbors.end()),
+                    neighbors.end());
+    for (const int32 neighbor : neighbors) RemoveContractedArcs(neighbor);
+    RunInParallel(neighbors.size(), num_threads, [&](int thread, int i) {
+      priority_[neighbors[i]] =
+          ComputePriority(neighbors[i], searches[thread].get());
+    });
+    remaining_nodes.erase(
+        std::remove_if(remaining_nodes.begin(), remaining_nodes.end(),
+                       [this](int32 node) {
+                         return state_[node] == CONTRACTED;
+                       }),
+        remaining_nodes.end());
+  }
+}
+
+// Writes the search graph given by its arcs per node at the given position of
+// a buffer in the file format, and returns the position after it.
+char* WriteSearchGraph(const ContractionArcs& arcs, char* data) {
+  const int32 num_nodes = arcs.size();
+  int64 num_arcs = 0;
+  for (const std::vector<ContractionArc>& node_arcs : arcs) {
+    num_arcs += node_arcs.size();
+  }
+  int32* const start = reinterpret_cast<int32*>(data);
+  data += 8 * NumWords<int32>(num_nodes + 1);
+  int32* const head = reinterpret_cast<int32*>(data);
+  data += 8 * NumWords<int32>(num_arcs);
+  int32* const middle = reinterpret_cast<int32*>(data);
+  data += 8 * NumWords<int32>(num_arcs);
+  int64* const length = reinterpret_cast<int64*>(data);
+  data += 8 * num_arcs;
+  int32 arc_index = 0;
+  for (int32 node = 0; node < num_nodes; ++node) {
+    start[node] = arc_index;
+    for (const ContractionArc& arc : arcs[node]) {
+      head[arc_index] = arc.node;
+      middle[arc_index] = arc.middle;
+      length[arc_index] = arc.length;
+      ++arc_index;
+    }
+  }
+  start[num_nodes] = arc_index;
+  return data;
+}
+
+void HierarchyBuilder::ExportData(std::vector<int64>* buffer) const {
+  int64 num_upward_arcs = 0;
+  int64 num_downward_arcs = 0;
+  for (int32 node = 0; node < num_nodes_; ++node) {
+    num_upward_arcs += upward_arcs_[node].size();
+    num_downward_arcs += downward_arcs_[node].size();
+  }
+  CHECK_LE(num_upward_arcs, kint32max);
+  CHECK_LE(num_downward_arcs, kint32max);
+  buffer->assign(kHeaderNumWords +
+                     SearchGraphNumWords(num_nodes_, num_upward_arcs) +
+                     SearchGraphNumWords(num_nodes_, num_downward_arcs),
+                 0);
+  (*buffer)[0] = kFileMagic;
+  (*buffer)[1] = num_nodes_;
+  (*buffer)[2] = num_upward_arcs;
+  (*buffer)[3] = num_downward_arcs;
+  char* data = reinterpret_cast<char*>(buffer->data() + kHeaderNumWords);
+  data = WriteSearchGraph(upward_arcs_, data);
+  data = WriteSearchGraph(downward_arcs_, data);
+  DCHECK_EQ(reinterpret_cast<char*>(buffer->data() + buffer->size()), data);
+}
+
+}  // namespace
+
+// A Dijkstra search on one of the search graphs of a hierarchy, settling the
+// nodes one at a time. This is a reusable workspace.
+class ContractionHierarchy::UpwardSearch {
+ public:
+  UpwardSearch(const SearchGraph& graph, NodeIndex num_nodes)
+      : graph_(graph),
+        distance_(num_nodes, UnreachableDistance()),
+        parent_(num_nodes, -1) {
+    heap_.Reset(num_nodes);
+  }
+
+  // Starts a new search from the given node.
+  void Start(NodeIndex source) {
+    for (const NodeIndex node : reached_nodes_) {
+      distance_[node] = UnreachableDistance();
+      parent_[node] = -1;
+    }
+    reached_nodes_.clear();
+    heap_.Clear();
+    distance_[source] = 0;
+    reached_nodes_.push_back(source);
+    heap_.InsertOrDecrease(source, 0);
+  }
+
+  bool IsEmpty() const { return heap_.IsEmpty(); }
+  int64 TopDistance() const { return heap_.TopKey(); }
+
+  // Settles the closest node that is not settled yet, relaxes its arcs and
+  // returns it. The search must not be empty.
+  NodeIndex SettleNext() {
+    const NodeIndex node = heap_.TopNode();
+    const int64 distance = heap_.TopKey();
+    heap_.Pop();
+    const int32 end = graph_.start[node + 1];
+    for (int32 arc = graph_.start[node]; arc < end; ++arc) {
+      const NodeIndex head = graph_.head[arc];
+      const int64 new_distance = distance + graph_.length[arc];
+      if (new_distance < distance_[head]) {
+        if (distance_[head] == UnreachableDistance()) {
+          reached_nodes_.push_back(head);
+        }
+        distance_[head] = new_distance;
+        parent_[head] = node;
+        heap_.InsertOrDecrease(head, new_distance);
+      }
+    }
+    return node;
+  }
+
+  // The tentative distance of the node (the exact one if it is settled), or
+  // UnreachableDistance() if it was not reached.
+  int64 Distance(NodeIndex node) const { return distance_[node]; }
+
+  // The previous node on the path to the node, or -1 for the source.
+  NodeIndex Parent(NodeIndex node) const { return parent_[node]; }
+
+ private:
+  const SearchGraph& graph_;
+  std::vector<int64> distance_;
+  std::vector<NodeIndex> parent_;
+  std::vector<NodeIndex> reached_nodes_;
+  FourAryNodeHeap<NodeIndex, int64> heap_;
+
+  DISALLOW_COPY_AND_ASSIGN(UpwardSearch);
+};
+
+ContractionHierarchy::ContractionHierarchy()
+    : num_nodes_(0), mapped_data_(nullptr), mapped_size_(0) {}
+
+ContractionHierarchy::~ContractionHierarchy() { Unmap(); }
+
+void ContractionHierarchy::Unmap() {
+#if !defined(_MSC_VER)
+  if (mapped_data_ != nullptr) {
+    munmap(const_cast<char*>(mapped_data_), mapped_size_);
+  }
+#endif
+  mapped_data_ = nullptr;
+  mapped_size_ = 0;
+}
+
+void ContractionHierarchy::Build(const Graph& graph,
+                                 const std::vector<int64>& arc_lengths,
+                                 int num_threads) {
+  Unmap();
+  {
+    HierarchyBuilder builder(graph, arc_lengths);
+    builder.ContractAllNodes(num_threads);
+    builder.ExportData(&buffer_);
+  }
+  CHECK(InitializeFromData(reinterpret_cast<const char*>(buffer_.data()),
+                           8 * buffer_.size()));
+}
+
+bool ContractionHierarchy::InitializeFromData(const char* data, int64 size) {
+  num_nodes_ = 0;
+  upward_ = SearchGraph();
+  downward_ = SearchGraph();
+  if (size < 8 * kHeaderNumWords) return false;
+  const int64* const header = reinterpret_cast<const int64*>(data);
+  const int64 num_nodes = header[1];
+  const int64 num_upward_arcs = header[2];
+  const int64 num_downward_arcs = header[3];
+  if (header[0] != kFileMagic || num_nodes < 0 || num_nodes > kint32max ||
+      num_upward_arcs < 0 || num_upward_arcs > kint32max ||
+      num_downward_arcs < 0 || num_downward_arcs > kint32max) {
+    return false;
+  }
+  if (size != 8 * (kHeaderNumWords +
+                   SearchGraphNumWords(num_nodes, num_upward_arcs) +
+                   SearchGraphNumWords(num_nodes, num_downward_arcs))) {
+    return false;
+  }
+  data += 8 * kHeaderNumWords;
+  for (SearchGraph* graph : {&upward_, &downward_}) {
+    graph->num_arcs = graph == &upward_ ? num_upward_arcs : num_downward_arcs;
+    graph->start = reinterpret_cast<const int32*>(data);
+    data += 8 * NumWords<int32>(num_nodes + 1);
+    graph->head = reinterpret_cast<const int32*>(data);
+    data += 8 * NumWords<int32>(graph->num_arcs);
+    graph->middle = reinterpret_cast<const int32*>(data);
+    data += 8 * NumWords<int32>(graph->num_arcs);
+    graph->length = reinterpret_cast<const int64*>(data);
+    data += 8 * graph->num_arcs;
+    if (graph->start[0] != 0 || graph->start[num_nodes] != graph->num_arcs) {
+      upward_ = SearchGraph();
+      downward_ = SearchGraph();
+      return false;
+    }
+  }
+  num_nodes_ = num_nodes;
+  return true;
+}
+
+bool ContractionHierarchy::SaveToFile(const std::string& file_name) const {
+  const char* const data = mapped_data_ != nullptr
+                               ? mapped_data_
+                               : reinterpret_cast<const char*>(buffer_.data());
+  const size_t size =
+      mapped_data_ != nullptr ? mapped_size_ : 8 * buffer_.size();
+  if (size == 0) return false;
+  File* const file = File::Open(file_name, "w");
+  if (file == nullptr) return false;
+  const bool ok = file->Write(data, size) == size;
+  return file->Close() && ok;
+}
+
+bool ContractionHierarchy::LoadFromFile(const std::string& file_name) {
+  Unmap();
+  buffer_.clear();
+#if !defined(_MSC_VER)
+  const int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+    void* const data =
+        mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data != MAP_FAILED) {
+      mapped_data_ = static_cast<const char*>(data);
+      mapped_size_ = file_stat.st_size;
+    }
+  }
+  // The mapping stays valid after the file is closed.
+  close(fd);
+  if (mapped_data_ != nullptr) {
+    if (InitializeFromData(mapped_data_, mapped_size_)) return true;
+    Unmap();
+    return false;
+  }
+#endif
+  File* const file = File::Open(file_name, "r");
+  if (file == nullptr) return false;
+  const size_t size = file->Size();
+  buffer_.assign((size + 7) / 8, 0);
+  const size_t num_read = size == 0 ? 0 : file->Read(buffer_.data(), size);
+  file->Close();
+  delete file;
+  if (num_read != size ||
+      !InitializeFromData(reinterpret_cast<const char*>(buffer_.data()),
+                          size)) {
+    buffer_.clear();
+    return false;
+  }
+  return true;
+}
+
+void ContractionHierarchy::UnpackArc(NodeIndex tail, NodeIndex head,
+                                     std::vector<NodeIndex>* path) const {
+  // The arc is stored at its lowest node in the hierarchy: either as an
+  // upward arc of tail or a downward arc of head.
+  NodeIndex middle = -1;
+  int64 best_length = UnreachableDistance();
+  for (int32 arc = upward_.start[tail]; arc < upward_.start[tail + 1]; ++arc) {
+    if (upward_.head[arc] == head && upward_.length[arc] < best_length) {
+      best_length = upward_.length[arc];
+      middle = upward_.middle[arc];
+    }
+  }
+  for (int32 arc = downward_.start[head]; arc < downward_.start[head + 1];
+       ++arc) {
+    if (downward_.head[arc] == tail && downward_.length[arc] < best_length) {
+      best_length = downward_.length[arc];
+      middle = downward_.middle[arc];
+    }
+  }
+  DCHECK_NE(best_length, UnreachableDistance());
+  if (middle == -1) {
+    path->push_back(head);
+  } else {
+    UnpackArc(tail, middle, path);
+    UnpackArc(middle, head, path);
+  }
+}
+
+void ContractionHierarchy::ComputeDistanceMatrix(
+    const std::vector<NodeIndex>& sources,
+    const std::vector<NodeIndex>& targets, int num_threads,
+    std::vector<int64>* distances) const {
+  CHECK(distances != nullptr);
+  const int num_sources = sources.size();
+  const int num_targets = targets.size();
+  distances->assign(static_cast<size_t>(num_sources) * num_targets,
+                    UnreachableDistance());
+  if (num_sources == 0 || num_targets == 0) return;
+  const int num_searches = std::max(1, num_threads);
+  std::vector<std::unique_ptr<UpwardSearch>> searches(num_searches);
+
+  // The backward searches from the targets, with the distances to the target
+  // of all the nodes they reach.
+  std::vector<std::vector<std::pair<NodeIndex, int64>>> target_buckets(
+      num_targets);
+  for (int i = 0; i < num_searches; ++i) {
+    searches[i].reset(new UpwardSearch(downward_, num_nodes_));
+  }
+  RunInParallel(num_targets, num_threads, [&](int thread, int j) {
+    UpwardSearch* const search = searches[thread].get();
+    search->Start(targets[j]);
+    while (!search->IsEmpty()) {
+      const NodeIndex node = search->SettleNext();
+      target_buckets[j].push_back(std::make_pair(node, search->Distance(node)));
+    }
+  });
+
+  // The buckets of all the nodes, in the compressed sparse row format.
+  std::vector<int32> bucket_start(num_nodes_ + 1, 0);
+  for (int j = 0; j < num_targets; ++j) {
+    for (const std::pair<NodeIndex, int64>& entry : target_buckets[j]) {
+      ++bucket_start[entry.first + 1];
+    }
+  }
+  for (NodeIndex node = 0; node < num_nodes_; ++node) {
+    bucket_start[node + 1] += bucket_start[node];
+  }
+  std::vector<int32> bucket_target(bucket_start[num_nodes_]);
+  std::vector<int64> bucket_distance(bucket_start[num_nodes_]);
+  {
+    std::vector<int32> position(bucket_start.begin(), bucket_start.end() - 1);
+    for (int j = 0; j < num_targets; ++j) {
+      for (const std::pair<NodeIndex, int64>& entry : target_buckets[j]) {
+        const int32 k = position[entry.first]++;
+        bucket_target[k] = j;
+        bucket_distance[k] = entry.second;
+      }
+      std::vector<std::pair<NodeIndex, int64>>().swap(target_buckets[j]);
+    }
+  }
+
+  // The forward searches from the sources scan the buckets.
+  for (int i = 0; i < num_searches; ++i) {
+    searches[i].reset(new UpwardSearch(upward_, num_nodes_));
+  }
+  RunInParallel(num_sources, num_threads, [&](int thread, int i) {
+    UpwardSearch* const search = searches[thread].get();
+    int64* const row = distances->data() + static_cast<size_t>(i) * num_targets;
+    search->Start(sources[i]);
+    while (!search->IsEmpty()) {
+      const NodeIndex node = search->SettleNext();
+      const int64 distance = search->Distance(node);
+      for (int32 k = bucket_start[node]; k < bucket_start[node + 1]; ++k) {
+        const int64 candidate = distance + bucket_distance[k];
+        if (candidate < row[bucket_target[k]]) {
+          row[bucket_target[k]] = candidate;
+        }
+      }
+    }
+  });
+}
+
+ContractionHierarchyQuery::ContractionHierarchyQuery(
+    const ContractionHierarchy& hierarchy)
+    : hierarchy_(hierarchy),
+      forward_search_(new ContractionHierarchy::UpwardSearch(
+          hierarchy.upward_, hierarchy.num_nodes())),
+      backward_search_(new ContractionHierarchy::UpwardSearch(
+          hierarchy.downward_, hierarchy.num_nodes())),
+      meeting_node_(-1) {}
+
+ContractionHierarchyQuery::~ContractionHierarchyQuery() {}
+
+int64 ContractionHierarchyQuery::Run(NodeIndex source, NodeIndex target) {
+  DCHECK_GE(source, 0);
+  DCHECK_LT(source, hierarchy_.num_nodes());
+  DCHECK_GE(target, 0);
+  DCHECK_LT(target, hierarchy_.num_nodes());
+  int64 best_distance = ContractionHierarchy::UnreachableDistance();
+  meeting_node_ = -1;
+  forward_search_->Start(source);
+  backward_search_->Start(target);
+
+  // The two searches alternate, a search stops as soon as its closest node is
+  // farther than the best distance found so far.
+  bool forward_turn = true;
+  while (true) {
+    const bool can_go_forward = !forward_search_->IsEmpty() &&
+                                forward_search_->TopDistance() < best_distance;
+    const bool can_go_backward =
+        !backward_search_->IsEmpty() &&
+        backward_search_->TopDistance() < best_distance;
+    if (!can_go_forward && !can_go_backward) break;
+    const bool go_forward =
+        can_go_forward && (forward_turn || !can_go_backward);
+    forward_turn = !forward_turn;
+    ContractionHierarchy::UpwardSearch* const search =
+        go_forward ? forward_search_.get() : backward_search_.get();
+    const ContractionHierarchy::UpwardSearch* const other_search =
+        go_forward ? backward_search_.get() : forward_search_.get();
+    const NodeIndex node = search->SettleNext();
+    const int64 other_distance = other_search->Distance(node);
+    if (other_distance == ContractionHierarchy::UnreachableDistance()) continue;
+    const int64 distance = search->Distance(node) + other_distance;
+    if (distance < best_distance) {
+      best_distance = distance;
+      meeting_node_ = node;
+    }
+  }
+  return best_distance;
+}
+
+int64 ContractionHierarchyQuery::Distance(NodeIndex source, NodeIndex target) {
+  return Run(source, target);
+}
+
+bool ContractionHierarchyQuery::GetPath(NodeIndex source, NodeIndex target,
+                                        std::vector<NodeIndex>* path) {
+  CHECK(path != nullptr);
+  path->clear();
+  if (Run(source, target) == ContractionHierarchy::UnreachableDistance()) {
+    return false;
+  }
+
+  // The nodes of the path in the hierarchy, from the source up to the meeting
+  // node and from there down to the target.
+  std::vector<NodeIndex> nodes;
+  for (NodeIndex node = meeting_node_; node != -1;
+       node = forward_search_->Parent(node)) {
+    nodes.push_back(node);
+  }
+  std::reverse(nodes.begin(), nodes.end());
+  for (NodeIndex node = backward_search_->Parent(meeting_node_); node != -1;
+       node = backward_search_->Parent(node)) {
+    nodes.push_back(node);
+  }
+  path->push_back(source);
+  for (int i = 1; i < nodes.size(); ++i) {
+    hierarchy_.UnpackArc(nodes[i - 1], nodes[i], path);
+  }
+  return true;
+}
+
+ContractionHierarchyDistanceMatrix::ContractionHierarchyDistanceMatrix(
+    const ContractionHierarchy& hierarchy,
+    const std::vector<ContractionHierarchy::NodeIndex>& graph_nodes,
+    int num_threads, int64 unreachable_value) {
+  hierarchy.ComputeDistanceMatrix(graph_nodes, graph_nodes, num_threads,
+                                  &values_);
+  for (int64& value : values_) {
+    if (value == ContractionHierarchy::UnreachableDistance()) {
+      value = unreachable_value;
+    }
+  }
+  const int num_nodes = graph_nodes.size();
+  rows_.resize(num_nodes);
+  for (int i = 0; i < num_nodes; ++i) {
+    rows_[i] = values_.data() + static_cast<size_t>(i) * num_nodes;
+  }
+}
+
+}  // namespace operations_research
@@ -0,0 +1,224 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Contraction hierarchies for repeated shortest path queries on the same
+// graph, typically a road network. See:
+//
+// Robert Geisberger, Peter Sanders, Dominik Schultes, Daniel Delling,
+// "Contraction Hierarchies: Faster and Simpler Hierarchical Routing in Road
+// Networks", WEA 2008.
+//
+// The nodes are contracted one by one in an order given by a priority (mainly
+// the number of added shortcuts minus the number of removed arcs):
+// contracting a node removes it from the graph, and adds a shortcut u -> w for
+// each pair of arcs u -> node -> w unless a witness search finds a path from
+// u to w that is not longer and avoids the node. A shortest path then always
+// goes up and then down in the order of contraction, so a query only needs
+// two small Dijkstra searches following the "upward" arcs from the source and
+// the target.
+//
+// The preprocessing contracts in each round a set of independent nodes (whose
+// priorities are smaller than those of all their neighbors) in parallel. The
+// hierarchy is stored in a flat binary format that can be written to a file
+// and memory-mapped back.
+//
+// Example:
+//   ContractionHierarchy hierarchy;
+//   hierarchy.Build(graph, arc_lengths, /*num_threads=*/8);
+//   hierarchy.SaveToFile("roads.ch");
+//   ...
+//   ContractionHierarchy hierarchy;
+//   CHECK(hierarchy.LoadFromFile("roads.ch"));
+//   ContractionHierarchyQuery query(hierarchy);
+//   const int64 distance = query.Distance(source, target);
+//
+// The routing distance matrices can be computed with
+// ContractionHierarchyDistanceMatrix below.
+
+#ifndef OR_TOOLS_GRAPH_CONTRACTION_HIERARCHY_H_
+#define OR_TOOLS_GRAPH_CONTRACTION_HIERARCHY_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "base/macros.h"
+#include "graph/graph.h"
+
+namespace operations_research {
+
+class ContractionHierarchy {
+ public:
+  typedef ReverseArcStaticGraph<> Graph;
+  typedef Graph::NodeIndex NodeIndex;
+  typedef Graph::ArcIndex ArcIndex;
+
+  ContractionHierarchy();
+  ~ContractionHierarchy();
+
+  // The distance between two nodes that are not connected.
+  static int64 UnreachableDistance() { return kint64max; }
+
+  // Builds the hierarchy of the given graph with the given non-negative arc
+  // lengths, indexed by the (forward) arcs of the graph. The contraction of the
+  // nodes of each round is spread over num_threads threads, and the result
+  // does not depend on the number of threads.
+  void Build(const Graph& graph, const std::vector<int64>& arc_lengths,
+             int num_threads);
+
+  // Writes the hierarchy to the given file. Returns false on error.
+  bool SaveToFile(const std::string& file_name) const;
+
+  // Loads a hierarchy written by SaveToFile(). The file is memory-mapped when
+  // possible, so loading is almost instantaneous and several processes share
+  // the same memory. Returns false if the file cannot be read or is not a
+  // valid hierarchy.
+  bool LoadFromFile(const std::string& file_name);
+
+  // The number of nodes of the graph, and the number of arcs of the hierarchy
+  // (the original arcs plus the shortcuts, without the redundant ones).
+  NodeIndex num_nodes() const { return num_nodes_; }
+  int64 num_arcs() const { return upward_.num_arcs + downward_.num_arcs; }
+
+  // Computes the shortest distances from each of the sources to each of the
+  // targets: (*distances)[i * targets.size() + j] is the distance from
+  // sources[i] to targets[j], or UnreachableDistance().
+  //
+  // This uses the bucket-based algorithm: one upward search from each target
+  // stores its distances in buckets at the nodes it reaches, then one upward
+  // search from each source scans the buckets of the nodes it reaches. The
+  // searches are spread over num_threads threads.
+  void ComputeDistanceMatrix(const std::vector<NodeIndex>& sources,
+                             const std::vector<NodeIndex>& targets,
+                             int num_threads,
+                             std::vector<int64>* distances) const;
+
+ private:
+  friend class ContractionHierarchyQuery;
+  class UpwardSearch;
+
+  // The arcs going up in the hierarchy in the compressed sparse row format.
+  // For the upward graph, the arc i of a node goes from the node to head[i];
+  // for the downward graph, it goes from head[i] to the node (it is used
+  // backwards from the targets). If middle[i] is not -1, the arc is a
+  // shortcut for the arcs tail -> middle[i] -> head.
+  struct SearchGraph {
+    SearchGraph()
+        : num_arcs(0),
+          start(nullptr),
+          head(nullptr),
+          middle(nullptr),
+          length(nullptr) {}
+    int64 num_arcs;
+    const int32* start;
+    const int32* head;
+    const int32* middle;
+    const int64* length;
+  };
+
+  // Sets num_nodes_ and the search graphs from the given data in the file
+  // format. Returns false if it is not valid.
+  bool InitializeFromData(const char* data, int64 size);
+
+  // Appends to path the nodes of the arc from tail to head, unpacking the
+  // shortcuts recursively, but without tail.
+  void UnpackArc(NodeIndex tail, NodeIndex head,
+                 std::vector<NodeIndex>* path) const;
+
+  void Unmap();
+
+  NodeIndex num_nodes_;
+  SearchGraph upward_;
+  SearchGraph downward_;
+
+  // The data of the search graphs in the file format: either buffer_ or the
+  // memory mapping of the file.
+  std::vector<int64> buffer_;
+  const char* mapped_data_;
+  int64 mapped_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(ContractionHierarchy);
+};
+
+// Point-to-point queries in a ContractionHierarchy. This is a reusable
+// workspace of size O(num_nodes): a query only resets the nodes reached by
+// the previous one. An instance must not be used by several threads at the
+// same time, but several instances can share the same hierarchy.
+class ContractionHierarchyQuery {
+ public:
+  typedef ContractionHierarchy::NodeIndex NodeIndex;
+
+  explicit ContractionHierarchyQuery(const ContractionHierarchy& hierarchy);
+  ~ContractionHierarchyQuery();
+
+  // Returns the shortest distance from source to target, or
+  // ContractionHierarchy::UnreachableDistance().
+  int64 Distance(NodeIndex source, NodeIndex target);
+
+  // Fills path with the nodes of the shortest path from source to target, in
+  // the original graph. Returns false if there is no path.
+  bool GetPath(NodeIndex source, NodeIndex target,
+               std::vector<NodeIndex>* path);
+
+ private:
+  // Runs the bidirectional search and returns the distance. Sets
+  // meeting_node_ to the highest node of the shortest path.
+  int64 Run(NodeIndex source, NodeIndex target);
+
+  const ContractionHierarchy& hierarchy_;
+  std::unique_ptr<ContractionHierarchy::UpwardSearch> forward_search_;
+  std::unique_ptr<ContractionHierarchy::UpwardSearch> backward_search_;
+  NodeIndex meeting_node_;
+
+  DISALLOW_COPY_AND_ASSIGN(ContractionHierarchyQuery);
+};
+
+// A square matrix of the shortest distances between a set of nodes of a
+// hierarchy, in the format of the matrix APIs of RoutingModel. The node i of
+// the routing model corresponds to graph_nodes[i]. The unreachable pairs get
+// unreachable_value, which should be large but not overflow the cumuls.
+//
+// Example:
+//   ContractionHierarchyDistanceMatrix matrix(hierarchy, graph_nodes,
+//                                             num_threads, kMaxDistance);
+//   routing.AddMatrixDimension(matrix.rows(), capacity, true, "distance");
+//   routing.SetArcCostMatrixOfAllVehicles(matrix.rows());
+//
+// The routing model copies the matrix, so this object can be destroyed after
+// these calls.
+class ContractionHierarchyDistanceMatrix {
+ public:
+  ContractionHierarchyDistanceMatrix(
+      const ContractionHierarchy& hierarchy,
+      const std::vector<ContractionHierarchy::NodeIndex>& graph_nodes,
+      int num_threads, int64 unreachable_value);
+
+  int size() const { return rows_.size(); }
+  int64 Value(int from, int to) const { return rows_[from][to]; }
+
+  // The rows of the matrix: rows()[from][to] is the distance from the node
+  // from to the node to.
+  const int64* const* rows() const { return rows_.data(); }
+
+ private:
+  std::vector<int64> values_;
+  std::vector<const int64*> rows_;
+
+  DISALLOW_COPY_AND_ASSIGN(ContractionHierarchyDistanceMatrix);
+};
+
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_GRAPH_CONTRACTION_HIERARCHY_H_
@@ -18,7 +18,7 @@
 
 #include "base/callback.h"
 #include "base/integral_types.h"
-#include "base/adjustable_priority_queue.h"
+#include "util/integer_pq.h"
 
 namespace operations_research {
 namespace {
@@ -26,21 +26,17 @@ namespace {
 // Priority queue element
 class Element {
  public:
-  Element() : heap_index_(-1), distance_(0), node_(-1) {}
+  Element(int node, int64 distance) : node_(node), distance_(distance) {}
   bool operator<(const Element& other) const {
     return distance_ > other.distance_;
   }
-  void SetHeapIndex(int h) { heap_index_ = h; }
-  int GetHeapIndex() const { return heap_index_; }
-  void set_distance(int64 distance) { distance_ = distance; }
+  int Index() const { return node_; }
   int64 distance() const { return distance_; }
-  void set_node(int node) { node_ = node; }
   int node() const { return node_; }
 
  private:
-  int heap_index_;
-  int64 distance_;
   int node_;
+  int64 distance_;
 };
 }  // namespace
 
@@ -56,7 +52,8 @@ class DijkstraSP {
         graph_(graph),
         disconnected_distance_(disconnected_distance),
         predecessor_(new int[node_count]),
-        elements_(node_count) {
+        frontier_(node_count),
+        distances_(node_count) {
     graph->CheckIsRepeatable();
   }
   bool ShortestPath(int end_node, std::vector<int>* nodes);
@@ -72,21 +69,19 @@ class DijkstraSP {
   std::unique_ptr<ResultCallback2<int64, int, int> > graph_;
   const int64 disconnected_distance_;
   std::unique_ptr<int[]> predecessor_;
-  AdjustablePriorityQueue<Element> frontier_;
-  std::vector<Element> elements_;
+  IntegerPriorityQueue<Element> frontier_;
+  std::vector<int64> distances_;
   hash_set<int> not_visited_;
-  hash_set<int> added_to_the_frontier_;
 };
 
 void DijkstraSP::Initialize() {
   for (int i = 0; i < node_count_; i++) {
-    elements_[i].set_node(i);
     if (i == start_node_) {
       predecessor_[i] = -1;
-      elements_[i].set_distance(0);
-      frontier_.Add(&elements_[i]);
+      distances_[i] = 0;
+      frontier_.Add(Element(i, 0));
     } else {
-      elements_[i].set_distance(kInfinity);
+      distances_[i] = kInfinity;
       predecessor_[i] = start_node_;
       not_visited_.insert(i);
     }
@@ -94,11 +89,10 @@ void DijkstraSP::Initialize() {
 }
 
 int DijkstraSP::SelectClosestNode(int64* distance) {
-  const int node = frontier_.Top()->node();
-  *distance = frontier_.Top()->distance();
+  const int node = frontier_.Top().node();
+  *distance = frontier_.Top().distance();
   frontier_.Pop();
   not_visited_.erase(node);
-  added_to_the_frontier_.erase(node);
   return node;
 }
 
@@ -108,15 +102,13 @@ void DijkstraSP::Update(int node) {
     const int other_node = *it;
     const int64 graph_node_i = graph_->Run(node, other_node);
     if (graph_node_i != disconnected_distance_) {
-      if (added_to_the_frontier_.find(other_node) ==
-          added_to_the_frontier_.end()) {
-        frontier_.Add(&elements_[other_node]);
-        added_to_the_frontier_.insert(other_node);
+      if (!frontier_.Contains(other_node)) {
+        frontier_.Add(Element(other_node, distances_[other_node]));
       }
-      const int64 other_distance = elements_[node].distance() + graph_node_i;
-      if (elements_[other_node].distance() > other_distance) {
-        elements_[other_node].set_distance(other_distance);
-        frontier_.NoteChangedPriority(&elements_[other_node]);
+      const int64 other_distance = distances_[node] + graph_node_i;
+      if (distances_[other_node] > other_distance) {
+        distances_[other_node] = other_distance;
+        frontier_.ChangePriority(Element(other_node, other_distance));
         predecessor_[other_node] = node;
       }
     }
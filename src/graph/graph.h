@@ -103,6 +103,16 @@
 //   Permute(permutation, &weights);  // Build() may permute the arc index.
 //   ...
 //
+// Renumbering the nodes for a better memory locality (StaticGraph<> and
+// ReverseArcStaticGraph<> only). This is worth it when the initial node
+// numbering is arbitrary, for instance on large road networks:
+//   std::vector<Graph::NodeIndex> node_permutation;
+//   graph.BuildWithNodeRenumbering(REVERSE_CUTHILL_MCKEE_ORDER,
+//                                  &node_permutation, &permutation);
+//   Permute(permutation, &weights);
+//   Permute(node_permutation, &node_supplies);
+//   ... the node i of the input is now node_permutation[i] ...
+//
 // Encoding an undirected graph:
 //   typedef ReverseArc... Graph;
 //   Graph graph;
@@ -145,6 +155,7 @@
 #include <vector>
 
 #include "base/integral_types.h"
+#include "base/large_array_allocator.h"
 #include "base/logging.h"
 #include "base/macros.h"
 #include "base/port.h"
@@ -157,6 +168,20 @@ namespace operations_research {
 template <typename T>
 class SVector;
 
+// The node orderings of BuildWithNodeRenumbering(). Both are computed on the
+// undirected version of the graph, and number the nodes of each connected
+// component consecutively.
+enum NodeOrdering {
+  // Breadth-first search order, each search starting from the smallest node
+  // index not yet numbered.
+  BREADTH_FIRST_ORDER,
+  // Reverse Cuthill-McKee order: breadth-first search order where each search
+  // starts from a node of minimum degree and visits the neighbors of a node by
+  // increasing degree, then reversed. This usually gives a smaller bandwidth
+  // (the largest difference between the two ends of an arc).
+  REVERSE_CUTHILL_MCKEE_ORDER
+};
+
 // Base class of all Graphs implemented here. The default value for the graph
 // index types is int32 since almost all graphs that fit into memory do not
 // need bigger indices.
@@ -242,10 +267,16 @@ class BaseGraph {
 
  protected:
   // Functions commented when defined because they are implementation details.
-  void ComputeCumulativeSum(std::vector<ArcIndexType>* v);
+  template <typename ArcIndexArray>
+  void ComputeCumulativeSum(ArcIndexArray* v);
+  template <typename ArcIndexArray>
   void BuildStartAndForwardHead(SVector<NodeIndexType>* head,
-                                std::vector<ArcIndexType>* start,
+                                ArcIndexArray* start,
                                 std::vector<ArcIndexType>* permutation);
+  template <typename TailFunction, typename HeadFunction>
+  void ComputeNodeOrdering(NodeOrdering ordering, const TailFunction& tail,
+                           const HeadFunction& head,
+                           std::vector<NodeIndexType>* node_permutation) const;
   class BaseStaticArcIterator;
 
   NodeIndexType num_nodes_;
@@ -420,6 +451,20 @@ class StaticGraph : public BaseGraph<NodeIndexType, ArcIndexType, false> {
   void BuildTailArray();
   void FreeTailArray();
 
+  // Like Build(), but first renumbers the nodes so that the adjacent nodes
+  // have close indices, which makes the arc and node data used together more
+  // likely to be close in memory. The node i of the input becomes the node
+  // (*node_permutation)[i], and the arcs are permuted as in Build().
+  void BuildWithNodeRenumbering(NodeOrdering ordering,
+                                std::vector<NodeIndexType>* node_permutation,
+                                std::vector<ArcIndexType>* arc_permutation);
+
+  // Same as above with a given node permutation, for instance one computed
+  // from the node coordinates along a space-filling curve.
+  void BuildWithNodePermutation(
+      const std::vector<NodeIndexType>& node_permutation,
+      std::vector<ArcIndexType>* arc_permutation);
+
   // Deprecated.
   class OutgoingArcIterator;
 
@@ -441,9 +486,10 @@ class StaticGraph : public BaseGraph<NodeIndexType, ArcIndexType, false> {
   bool is_built_;
   bool arc_in_order_;
   NodeIndexType last_tail_seen_;
-  std::vector<ArcIndexType> start_;
-  std::vector<NodeIndexType> head_;
-  mutable std::vector<NodeIndexType> tail_;
+  std::vector<ArcIndexType, LargeArrayAllocator<ArcIndexType> > start_;
+  std::vector<NodeIndexType, LargeArrayAllocator<NodeIndexType> > head_;
+  mutable std::vector<NodeIndexType, LargeArrayAllocator<NodeIndexType> >
+      tail_;
   DISALLOW_COPY_AND_ASSIGN(StaticGraph);
 };
 
@@ -601,6 +647,14 @@ class ReverseArcStaticGraph
   void BuildTailArray() {}
   void FreeTailArray() {}
 
+  // See StaticGraph<>.
+  void BuildWithNodeRenumbering(NodeOrdering ordering,
+                                std::vector<NodeIndexType>* node_permutation,
+                                std::vector<ArcIndexType>* arc_permutation);
+  void BuildWithNodePermutation(
+      const std::vector<NodeIndexType>& node_permutation,
+      std::vector<ArcIndexType>* arc_permutation);
+
  private:
   ArcIndexType DirectArcLimit(NodeIndexType node) const {
     DCHECK(is_built_);
@@ -614,8 +668,8 @@ class ReverseArcStaticGraph
   }
 
   bool is_built_;
-  std::vector<ArcIndexType> start_;
-  std::vector<ArcIndexType> reverse_start_;
+  std::vector<ArcIndexType, LargeArrayAllocator<ArcIndexType> > start_;
+  std::vector<ArcIndexType, LargeArrayAllocator<ArcIndexType> > reverse_start_;
   SVector<NodeIndexType> head_;
   SVector<ArcIndexType> opposite_;
   DISALLOW_COPY_AND_ASSIGN(ReverseArcStaticGraph);
@@ -756,7 +810,7 @@ class SVector {
   ~SVector() {
     clear();
     if (capacity_ > 0) {
-      free(base_ - capacity_);
+      Deallocate(base_ - capacity_, capacity_);
     }
   }
 
@@ -804,14 +858,9 @@ class SVector {
     DCHECK_LE(n, max_size());
     if (n > capacity_) {
       int new_capacity = n;
-      size_t requested_block_size = 2LL * new_capacity * sizeof(T);
-      T* new_storage = static_cast<T*>(malloc(requested_block_size));
-      CHECK(new_storage != NULL);
-      size_t block_size = requested_block_size;
-      if (block_size > 0) {
-        new_capacity = static_cast<int>(
-            std::min(static_cast<size_t>(max_size()), block_size / (2 * sizeof(T))));
-      }
+      T* new_storage = static_cast<T*>(
+          GetLargeArrayAllocationPolicy()->Allocate(
+              2LL * new_capacity * sizeof(T)));
       T* new_base = new_storage + new_capacity;
       for (int i = -size_; i < size_; ++i) {
         new (new_base + i) T(base_[i]);
@@ -819,7 +868,7 @@ class SVector {
       int temp = size_;
       clear();
       if (capacity_ > 0) {
-        free(base_ - capacity_);
+        Deallocate(base_ - capacity_, capacity_);
       }
       size_ = temp;
       base_ = new_base;
@@ -851,6 +900,13 @@ class SVector {
   int max_size() const { return std::numeric_limits<int>::max(); }
 
  private:
+  // The storage comes from the LargeArrayAllocationPolicy, since it holds the
+  // arcs of the graphs with reverse arcs.
+  static void Deallocate(T* storage, int capacity) {
+    GetLargeArrayAllocationPolicy()->Deallocate(
+        storage, 2LL * capacity * sizeof(T));
+  }
+
   int NewCapacity(int delta) {
     // TODO(user): check validity.
     double candidate = 1.3 * static_cast<double>(capacity_);
@@ -922,8 +978,9 @@ BaseGraph<NodeIndexType, ArcIndexType, HasReverseArcs>::FreezeCapacities() {
 // Computes the cummulative sum of the entry in v. We only use it with
 // in/out degree distribution, hence the Check() at the end.
 template <typename NodeIndexType, typename ArcIndexType, bool HasReverseArcs>
+template <typename ArcIndexArray>
 void BaseGraph<NodeIndexType, ArcIndexType,
-               HasReverseArcs>::ComputeCumulativeSum(std::vector<ArcIndexType>* v) {
+               HasReverseArcs>::ComputeCumulativeSum(ArcIndexArray* v) {
   ArcIndexType sum = 0;
   for (int i = 0; i < num_nodes_; ++i) {
     ArcIndexType temp = (*v)[i];
@@ -933,6 +990,79 @@ void BaseGraph<NodeIndexType, ArcIndexType,
   DCHECK(sum == num_arcs_);
 }
 
+// Computes in (*node_permutation)[i] the new index of the node i for the given
+// ordering of a graph whose arcs are given by the tail and head functions. The
+// nodes are ordered in the vector order first, then renumbered.
+template <typename NodeIndexType, typename ArcIndexType, bool HasReverseArcs>
+template <typename TailFunction, typename HeadFunction>
+void BaseGraph<NodeIndexType, ArcIndexType, HasReverseArcs>::
+    ComputeNodeOrdering(NodeOrdering ordering, const TailFunction& tail,
+                        const HeadFunction& head,
+                        std::vector<NodeIndexType>* node_permutation) const {
+  // The undirected adjacency lists, without the self-loops.
+  std::vector<ArcIndexType> degree(num_nodes_, 0);
+  for (ArcIndexType arc = 0; arc < num_arcs_; ++arc) {
+    if (tail(arc) == head(arc)) continue;
+    ++degree[tail(arc)];
+    ++degree[head(arc)];
+  }
+  std::vector<ArcIndexType> start(num_nodes_ + 1, 0);
+  for (NodeIndexType node = 0; node < num_nodes_; ++node) {
+    start[node + 1] = start[node] + degree[node];
+  }
+  std::vector<NodeIndexType> neighbors(start[num_nodes_]);
+  {
+    std::vector<ArcIndexType> next(start.begin(), start.end() - 1);
+    for (ArcIndexType arc = 0; arc < num_arcs_; ++arc) {
+      const NodeIndexType t = tail(arc);
+      const NodeIndexType h = head(arc);
+      if (t == h) continue;
+      neighbors[next[t]++] = h;
+      neighbors[next[h]++] = t;
+    }
+  }
+
+  // The nodes from which a search can start, in order of preference.
+  const bool is_cuthill_mckee = ordering == REVERSE_CUTHILL_MCKEE_ORDER;
+  std::vector<NodeIndexType> roots(num_nodes_);
+  for (NodeIndexType node = 0; node < num_nodes_; ++node) roots[node] = node;
+  auto has_smaller_degree = [&degree](NodeIndexType a, NodeIndexType b) {
+    return degree[a] < degree[b];
+  };
+  if (is_cuthill_mckee) {
+    std::stable_sort(roots.begin(), roots.end(), has_smaller_degree);
+  }
+
+  // The breadth-first searches. order is also the queue of the searches.
+  std::vector<NodeIndexType> order;
+  order.reserve(num_nodes_);
+  std::vector<bool> is_reached(num_nodes_, false);
+  for (const NodeIndexType root : roots) {
+    if (is_reached[root]) continue;
+    is_reached[root] = true;
+    order.push_back(root);
+    for (int i = order.size() - 1; i < order.size(); ++i) {
+      const NodeIndexType node = order[i];
+      const int first_new_node = order.size();
+      for (ArcIndexType j = start[node]; j < start[node + 1]; ++j) {
+        const NodeIndexType neighbor = neighbors[j];
+        if (is_reached[neighbor]) continue;
+        is_reached[neighbor] = true;
+        order.push_back(neighbor);
+      }
+      if (is_cuthill_mckee) {
+        std::stable_sort(order.begin() + first_new_node, order.end(),
+                         has_smaller_degree);
+      }
+    }
+  }
+  DCHECK_EQ(num_nodes_, order.size());
+  if (is_cuthill_mckee) std::reverse(order.begin(), order.end());
+
+  node_permutation->resize(num_nodes_);
+  for (int i = 0; i < order.size(); ++i) (*node_permutation)[order[i]] = i;
+}
+
 // Base class for StaticGraph arc iterator.
 template <typename NodeIndexType, typename ArcIndexType, bool HasReverseArcs>
 class BaseGraph<NodeIndexType, ArcIndexType,
@@ -961,9 +1091,10 @@ class BaseGraph<NodeIndexType, ArcIndexType,
 // - Put in start[i] the index of the first arc with tail >= i.
 // - Update "permutation" to reflect the change, unless it is NULL.
 template <typename NodeIndexType, typename ArcIndexType, bool HasReverseArcs>
+template <typename ArcIndexArray>
 void BaseGraph<NodeIndexType, ArcIndexType, HasReverseArcs>::
     BuildStartAndForwardHead(SVector<NodeIndexType>* head,
-                             std::vector<ArcIndexType>* start,
+                             ArcIndexArray* start,
                              std::vector<ArcIndexType>* permutation) {
   // Computes the outgoing degree of each nodes and check if we need to permute
   // something or not. Note that the tails are currently stored in the positive
@@ -1429,6 +1560,39 @@ void StaticGraph<NodeIndexType, ArcIndexType>::Build(
   start_[0] = 0;
 }
 
+template <typename NodeIndexType, typename ArcIndexType>
+void StaticGraph<NodeIndexType, ArcIndexType>::BuildWithNodeRenumbering(
+    NodeOrdering ordering, std::vector<NodeIndexType>* node_permutation,
+    std::vector<ArcIndexType>* arc_permutation) {
+  DCHECK(!is_built_);
+  this->ComputeNodeOrdering(ordering,
+                            [this](ArcIndexType arc) { return Tail(arc); },
+                            [this](ArcIndexType arc) { return head_[arc]; },
+                            node_permutation);
+  BuildWithNodePermutation(*node_permutation, arc_permutation);
+}
+
+template <typename NodeIndexType, typename ArcIndexType>
+void StaticGraph<NodeIndexType, ArcIndexType>::BuildWithNodePermutation(
+    const std::vector<NodeIndexType>& node_permutation,
+    std::vector<ArcIndexType>* arc_permutation) {
+  DCHECK(!is_built_);
+  CHECK_EQ(num_nodes_, node_permutation.size());
+  if (num_arcs_ > 0) {
+    // The arcs are no longer ordered by tail after the renumbering, so we
+    // need the complete tail_ array for Build().
+    if (arc_in_order_) {
+      IncrementallyComputeTailsForAllAddedArcs();
+      arc_in_order_ = false;
+    }
+    for (ArcIndexType arc = 0; arc < num_arcs_; ++arc) {
+      tail_[arc] = node_permutation[tail_[arc]];
+      head_[arc] = node_permutation[head_[arc]];
+    }
+  }
+  Build(arc_permutation);
+}
+
 template <typename NodeIndexType, typename ArcIndexType>
 void StaticGraph<NodeIndexType, ArcIndexType>::BuildTailArray() {
   DCHECK(is_built_);
@@ -1438,7 +1602,7 @@ void StaticGraph<NodeIndexType, ArcIndexType>::BuildTailArray() {
 template <typename NodeIndexType, typename ArcIndexType>
 void StaticGraph<NodeIndexType, ArcIndexType>::FreeTailArray() {
   DCHECK(is_built_);
-  std::vector<NodeIndexType> tmp;
+  std::vector<NodeIndexType, LargeArrayAllocator<NodeIndexType> > tmp;
   tmp.swap(tail_);
 }
 
@@ -1845,6 +2009,34 @@ void ReverseArcStaticGraph<NodeIndexType, ArcIndexType>::Build(
   }
 }
 
+template <typename NodeIndexType, typename ArcIndexType>
+void ReverseArcStaticGraph<NodeIndexType, ArcIndexType>::
+    BuildWithNodeRenumbering(NodeOrdering ordering,
+                             std::vector<NodeIndexType>* node_permutation,
+                             std::vector<ArcIndexType>* arc_permutation) {
+  DCHECK(!is_built_);
+  // Before Build(), the tail of arc #i is in head_[i] and its head in
+  // head_[~i].
+  this->ComputeNodeOrdering(ordering,
+                            [this](ArcIndexType arc) { return head_[arc]; },
+                            [this](ArcIndexType arc) { return head_[~arc]; },
+                            node_permutation);
+  BuildWithNodePermutation(*node_permutation, arc_permutation);
+}
+
+template <typename NodeIndexType, typename ArcIndexType>
+void ReverseArcStaticGraph<NodeIndexType, ArcIndexType>::
+    BuildWithNodePermutation(const std::vector<NodeIndexType>& node_permutation,
+                             std::vector<ArcIndexType>* arc_permutation) {
+  DCHECK(!is_built_);
+  CHECK_EQ(num_nodes_, node_permutation.size());
+  for (ArcIndexType arc = 0; arc < num_arcs_; ++arc) {
+    head_[arc] = node_permutation[head_[arc]];
+    head_[~arc] = node_permutation[head_[~arc]];
+  }
+  Build(arc_permutation);
+}
+
 template <typename NodeIndexType, typename ArcIndexType>
 class ReverseArcStaticGraph<NodeIndexType, ArcIndexType>::OutgoingArcIterator
     : public Base::BaseStaticArcIterator {
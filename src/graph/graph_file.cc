@@ -0,0 +1,74 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "graph/graph_file.h"
+
+#if !defined(_MSC_VER)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace operations_research {
+
+MappedFile::MappedFile() : data_(nullptr), size_(0), is_mapped_(false) {}
+
+MappedFile::~MappedFile() { Close(); }
+
+void MappedFile::Close() {
+#if !defined(_MSC_VER)
+  if (is_mapped_) munmap(const_cast<char*>(data_), size_);
+#endif
+  data_ = nullptr;
+  size_ = 0;
+  is_mapped_ = false;
+  buffer_.clear();
+}
+
+bool MappedFile::Open(const std::string& file_name) {
+  Close();
+#if !defined(_MSC_VER)
+  const int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+    void* const data =
+        mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data != MAP_FAILED) {
+      data_ = static_cast<const char*>(data);
+      size_ = file_stat.st_size;
+      is_mapped_ = true;
+    }
+  }
+  // The mapping stays valid after the file is closed.
+  close(fd);
+  if (is_mapped_) return true;
+#endif
+  File* const file = File::Open(file_name, "r");
+  if (file == nullptr) return false;
+  const size_t size = file->Size();
+  buffer_.assign((size + 7) / 8, 0);
+  const size_t num_read = size == 0 ? 0 : file->Read(buffer_.data(), size);
+  file->Close();
+  delete file;
+  if (num_read != size) {
+    buffer_.clear();
+    return false;
+  }
+  data_ = reinterpret_cast<const char*>(buffer_.data());
+  size_ = size;
+  return true;
+}
+
+}  // namespace operations_research
@@ -0,0 +1,461 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// A binary file format for the built StaticGraph<> and ReverseArcStaticGraph<>
+// of graph.h, with optional int64 annotations of the arcs and of the nodes.
+// The file contains the arrays of the built graph, so it can be memory-mapped
+// and used without any copy or Build(): loading a huge graph is almost
+// instantaneous, and several processes loading the same file share the same
+// physical memory.
+//
+// Example:
+//   StaticGraph<> graph;
+//   ... add the arcs, call graph.Build(&permutation) ...
+//   Permute(permutation, &arc_lengths);
+//   CHECK(WriteGraphToBinaryFile(graph, {&arc_lengths}, {}, "roads.graph"));
+//   ...
+//   MappedStaticGraph<> mapped_graph;
+//   CHECK(mapped_graph.LoadFromFile("roads.graph"));
+//   const int64* const arc_lengths = mapped_graph.ArcAnnotation(0);
+//   for (const int arc : mapped_graph.OutgoingArcs(node)) {
+//     ... mapped_graph.Head(arc) ... arc_lengths[arc] ...
+//   }
+//
+// MappedStaticGraph<> implements the read-only part of the graph interface of
+// graph.h (and the reverse arcs when the file has them), so it can be used
+// with the graph algorithms templated on the graph type.
+//
+// The format is versioned. All the integers are in the native byte order, so
+// a file can only be read on an architecture with the same endianness. It is a
+// header of kGraphFileHeaderSize int64, followed by the arrays below, each one
+// padded to a multiple of 8 bytes:
+// - start[num_nodes + 1]: the first outgoing arc of each node (ArcIndex).
+// - With reverse arcs only, reverse_start[num_nodes + 1]: the first incoming
+//   (reverse) arc of each node, in [-num_arcs, 0].
+// - head[num_arcs], or head[2 * num_arcs] for the arcs in [-num_arcs, num_arcs)
+//   with reverse arcs (NodeIndex).
+// - With reverse arcs only, opposite[2 * num_arcs] (ArcIndex).
+// - The arc annotations, num_arcs int64 each.
+// - The node annotations, num_nodes int64 each.
+
+#ifndef OR_TOOLS_GRAPH_GRAPH_FILE_H_
+#define OR_TOOLS_GRAPH_GRAPH_FILE_H_
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "base/file.h"
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "base/macros.h"
+#include "graph/graph.h"
+#include "util/iterators.h"
+
+namespace operations_research {
+
+// The header of a graph file: kGraphFileMagic, kGraphFileVersion, the numbers
+// of nodes and arcs, 1 if the file has reverse arcs and 0 otherwise, the sizes
+// in bytes of NodeIndex and ArcIndex, then the numbers of arc and node
+// annotations.
+const int64 kGraphFileMagic = 0x48504152474f524fLL;
+const int64 kGraphFileVersion = 1;
+const int kGraphFileHeaderSize = 9;
+
+// Writes the given built graph and its annotations to a file. Each arc
+// annotation must have graph.num_arcs() elements, and each node annotation
+// graph.num_nodes() elements. Returns false on error.
+template <typename NodeIndexType, typename ArcIndexType>
+bool WriteGraphToBinaryFile(
+    const StaticGraph<NodeIndexType, ArcIndexType>& graph,
+    const std::vector<const std::vector<int64>*>& arc_annotations,
+    const std::vector<const std::vector<int64>*>& node_annotations,
+    const std::string& file_name);
+template <typename NodeIndexType, typename ArcIndexType>
+bool WriteGraphToBinaryFile(
+    const ReverseArcStaticGraph<NodeIndexType, ArcIndexType>& graph,
+    const std::vector<const std::vector<int64>*>& arc_annotations,
+    const std::vector<const std::vector<int64>*>& node_annotations,
+    const std::string& file_name);
+
+// A read-only file in memory: the file is memory-mapped when possible, and
+// read into a buffer otherwise.
+class MappedFile {
+ public:
+  MappedFile();
+  ~MappedFile();
+
+  // Loads the given file, and returns false on error.
+  bool Open(const std::string& file_name);
+  void Close();
+
+  // The content of the file, aligned on 8 bytes.
+  const char* data() const { return data_; }
+  int64 size() const { return size_; }
+
+ private:
+  const char* data_;
+  int64 size_;
+  bool is_mapped_;
+  std::vector<int64> buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+// A graph loaded from a file written by WriteGraphToBinaryFile(). The node and
+// arc index types must be the ones of the written graph.
+template <typename NodeIndexType = int32, typename ArcIndexType = int32>
+class MappedStaticGraph {
+ public:
+  typedef NodeIndexType NodeIndex;
+  typedef ArcIndexType ArcIndex;
+
+  static const NodeIndexType kNilNode;
+  static const ArcIndexType kNilArc;
+
+  MappedStaticGraph();
+
+  // Loads the graph from the given file. Returns false if the file cannot be
+  // read or is not a valid graph file for these index types.
+  bool LoadFromFile(const std::string& file_name);
+
+  NodeIndexType num_nodes() const { return num_nodes_; }
+  ArcIndexType num_arcs() const { return num_arcs_; }
+  bool has_reverse_arcs() const { return reverse_start_ != nullptr; }
+  IntegerRange<NodeIndexType> AllNodes() const {
+    return IntegerRange<NodeIndexType>(0, num_nodes_);
+  }
+  IntegerRange<ArcIndexType> AllForwardArcs() const {
+    return IntegerRange<ArcIndexType>(0, num_arcs_);
+  }
+  bool IsNodeValid(NodeIndexType node) const {
+    return node >= 0 && node < num_nodes_;
+  }
+  bool IsArcValid(ArcIndexType arc) const {
+    return (has_reverse_arcs() ? -num_arcs_ : 0) <= arc && arc < num_arcs_;
+  }
+
+  ArcIndexType OutDegree(NodeIndexType node) const {
+    return start_[node + 1] - start_[node];
+  }
+  IntegerRange<ArcIndexType> OutgoingArcs(NodeIndexType node) const {
+    return IntegerRange<ArcIndexType>(start_[node], start_[node + 1]);
+  }
+  IntegerRange<ArcIndexType> OutgoingArcsStartingFrom(NodeIndexType node,
+                                                      ArcIndexType from) const {
+    DCHECK_LE(start_[node], from);
+    return IntegerRange<ArcIndexType>(from, start_[node + 1]);
+  }
+  BeginEndWrapper<NodeIndexType const*> operator[](NodeIndexType node) const {
+    return BeginEndWrapper<NodeIndexType const*>(head_ + start_[node],
+                                                 head_ + start_[node + 1]);
+  }
+  NodeIndexType Head(ArcIndexType arc) const {
+    DCHECK(IsArcValid(arc));
+    return head_[arc];
+  }
+  // In O(1) with reverse arcs, in O(log(num_nodes)) otherwise.
+  NodeIndexType Tail(ArcIndexType arc) const;
+
+  // Only with reverse arcs.
+  ArcIndexType InDegree(NodeIndexType node) const {
+    DCHECK(has_reverse_arcs());
+    return reverse_start_[node + 1] - reverse_start_[node];
+  }
+  IntegerRange<ArcIndexType> IncomingArcs(NodeIndexType node) const {
+    DCHECK(has_reverse_arcs());
+    return IntegerRange<ArcIndexType>(reverse_start_[node],
+                                      reverse_start_[node + 1]);
+  }
+  ArcIndexType OppositeArc(ArcIndexType arc) const {
+    DCHECK(has_reverse_arcs());
+    DCHECK(IsArcValid(arc));
+    return opposite_[arc];
+  }
+
+  // The annotations of the file: ArcAnnotation(i)[arc] is the value of the
+  // i-th arc annotation for the given (forward) arc.
+  int num_arc_annotations() const { return arc_annotations_.size(); }
+  int num_node_annotations() const { return node_annotations_.size(); }
+  const int64* ArcAnnotation(int index) const {
+    return arc_annotations_[index];
+  }
+  const int64* NodeAnnotation(int index) const {
+    return node_annotations_[index];
+  }
+
+ private:
+  // Sets the graph from the content of a file. Returns false if it is not
+  // valid.
+  bool InitializeFromData(const char* data, int64 size);
+
+  MappedFile file_;
+  NodeIndexType num_nodes_;
+  ArcIndexType num_arcs_;
+  const ArcIndexType* start_;
+  const ArcIndexType* reverse_start_;
+  // With reverse arcs, these point to the middle of the arrays, so that they
+  // can be indexed by the arcs in [-num_arcs_, num_arcs_).
+  const NodeIndexType* head_;
+  const ArcIndexType* opposite_;
+  std::vector<const int64*> arc_annotations_;
+  std::vector<const int64*> node_annotations_;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedStaticGraph);
+};
+
+// Implementation details.
+
+namespace graph_file_internal {
+
+// The number of int64 needed to store size elements of type T.
+template <typename T>
+int64 NumWords(int64 size) {
+  return (size * sizeof(T) + 7) / 8;
+}
+
+// Writes value(i) for all i in [0, size) as a T, plus the padding to a
+// multiple of 8 bytes. Returns false on error.
+template <typename T, typename ValueFunction>
+bool WriteSection(File* file, int64 size, const ValueFunction& value) {
+  const int kChunkSize = 1 << 16;
+  std::vector<T> chunk;
+  chunk.reserve(kChunkSize);
+  for (int64 i = 0; i < size; ++i) {
+    chunk.push_back(value(i));
+    if (chunk.size() == kChunkSize || i + 1 == size) {
+      const size_t num_bytes = chunk.size() * sizeof(T);
+      if (file->Write(chunk.data(), num_bytes) != num_bytes) return false;
+      chunk.clear();
+    }
+  }
+  const size_t padding = 8 * NumWords<T>(size) - size * sizeof(T);
+  const int64 zero = 0;
+  return padding == 0 || file->Write(&zero, padding) == padding;
+}
+
+// Writes the sections after start[] for each graph type.
+template <typename NodeIndexType, typename ArcIndexType>
+bool WriteArcSections(File* file,
+                      const StaticGraph<NodeIndexType, ArcIndexType>& graph) {
+  return WriteSection<NodeIndexType>(
+      file, graph.num_arcs(), [&graph](int64 i) { return graph.Head(i); });
+}
+
+template <typename NodeIndexType, typename ArcIndexType>
+bool WriteArcSections(
+    File* file,
+    const ReverseArcStaticGraph<NodeIndexType, ArcIndexType>& graph) {
+  const int64 num_arcs = graph.num_arcs();
+  return WriteSection<ArcIndexType>(
+             file, graph.num_nodes() + 1,
+             [&graph](int64 i) {
+               return i == graph.num_nodes() ? 0
+                                             : *graph.IncomingArcs(i).begin();
+             }) &&
+         WriteSection<NodeIndexType>(file, 2 * num_arcs,
+                                     [&graph, num_arcs](int64 i) {
+                                       return graph.Head(i - num_arcs);
+                                     }) &&
+         WriteSection<ArcIndexType>(file, 2 * num_arcs,
+                                    [&graph, num_arcs](int64 i) {
+                                      return graph.OppositeArc(i - num_arcs);
+                                    });
+}
+
+template <typename Graph>
+bool WriteGraph(const Graph& graph, bool has_reverse_arcs,
+                const std::vector<const std::vector<int64>*>& arc_annotations,
+                const std::vector<const std::vector<int64>*>& node_annotations,
+                const std::string& file_name) {
+  typedef typename Graph::NodeIndex NodeIndex;
+  typedef typename Graph::ArcIndex ArcIndex;
+  const int64 num_nodes = graph.num_nodes();
+  const int64 num_arcs = graph.num_arcs();
+  for (const std::vector<int64>* annotation : arc_annotations) {
+    CHECK_EQ(num_arcs, annotation->size());
+  }
+  for (const std::vector<int64>* annotation : node_annotations) {
+    CHECK_EQ(num_nodes, annotation->size());
+  }
+  File* const file = File::Open(file_name, "w");
+  if (file == nullptr) return false;
+  const int64 header[kGraphFileHeaderSize] = {
+      kGraphFileMagic,         kGraphFileVersion,
+      num_nodes,               num_arcs,
+      has_reverse_arcs ? 1 : 0, sizeof(NodeIndex),
+      sizeof(ArcIndex),        static_cast<int64>(arc_annotations.size()),
+      static_cast<int64>(node_annotations.size())};
+  bool ok = file->Write(header, sizeof(header)) == sizeof(header);
+  ok = ok && WriteSection<ArcIndex>(file, num_nodes + 1, [&graph](int64 i) {
+         return i == graph.num_nodes() ? graph.num_arcs()
+                                       : *graph.OutgoingArcs(i).begin();
+       });
+  ok = ok && WriteArcSections(file, graph);
+  for (const std::vector<int64>* annotation : arc_annotations) {
+    ok = ok && WriteSection<int64>(file, num_arcs, [annotation](int64 i) {
+           return (*annotation)[i];
+         });
+  }
+  for (const std::vector<int64>* annotation : node_annotations) {
+    ok = ok && WriteSection<int64>(file, num_nodes, [annotation](int64 i) {
+           return (*annotation)[i];
+         });
+  }
+  ok = file->Close() && ok;
+  delete file;
+  return ok;
+}
+
+}  // namespace graph_file_internal
+
+template <typename NodeIndexType, typename ArcIndexType>
+bool WriteGraphToBinaryFile(
+    const StaticGraph<NodeIndexType, ArcIndexType>& graph,
+    const std::vector<const std::vector<int64>*>& arc_annotations,
+    const std::vector<const std::vector<int64>*>& node_annotations,
+    const std::string& file_name) {
+  return graph_file_internal::WriteGraph(graph, /*has_reverse_arcs=*/false,
+                                         arc_annotations, node_annotations,
+                                         file_name);
+}
+
+template <typename NodeIndexType, typename ArcIndexType>
+bool WriteGraphToBinaryFile(
+    const ReverseArcStaticGraph<NodeIndexType, ArcIndexType>& graph,
+    const std::vector<const std::vector<int64>*>& arc_annotations,
+    const std::vector<const std::vector<int64>*>& node_annotations,
+    const std::string& file_name) {
+  return graph_file_internal::WriteGraph(graph, /*has_reverse_arcs=*/true,
+                                         arc_annotations, node_annotations,
+                                         file_name);
+}
+
+template <typename NodeIndexType, typename ArcIndexType>
+const NodeIndexType
+    MappedStaticGraph<NodeIndexType, ArcIndexType>::kNilNode =
+        std::numeric_limits<NodeIndexType>::max();
+
+template <typename NodeIndexType, typename ArcIndexType>
+const ArcIndexType MappedStaticGraph<NodeIndexType, ArcIndexType>::kNilArc =
+    std::numeric_limits<ArcIndexType>::max();
+
+template <typename NodeIndexType, typename ArcIndexType>
+MappedStaticGraph<NodeIndexType, ArcIndexType>::MappedStaticGraph()
+    : num_nodes_(0),
+      num_arcs_(0),
+      start_(nullptr),
+      reverse_start_(nullptr),
+      head_(nullptr),
+      opposite_(nullptr) {}
+
+template <typename NodeIndexType, typename ArcIndexType>
+NodeIndexType MappedStaticGraph<NodeIndexType, ArcIndexType>::Tail(
+    ArcIndexType arc) const {
+  DCHECK(IsArcValid(arc));
+  if (has_reverse_arcs()) return head_[opposite_[arc]];
+  // The last node whose first arc is <= arc.
+  return std::upper_bound(start_, start_ + num_nodes_ + 1, arc) - start_ - 1;
+}
+
+template <typename NodeIndexType, typename ArcIndexType>
+bool MappedStaticGraph<NodeIndexType, ArcIndexType>::LoadFromFile(
+    const std::string& file_name) {
+  if (file_.Open(file_name) && InitializeFromData(file_.data(), file_.size())) {
+    return true;
+  }
+  file_.Close();
+  return false;
+}
+
+template <typename NodeIndexType, typename ArcIndexType>
+bool MappedStaticGraph<NodeIndexType, ArcIndexType>::InitializeFromData(
+    const char* data, int64 size) {
+  using graph_file_internal::NumWords;
+  num_nodes_ = 0;
+  num_arcs_ = 0;
+  start_ = nullptr;
+  reverse_start_ = nullptr;
+  head_ = nullptr;
+  opposite_ = nullptr;
+  arc_annotations_.clear();
+  node_annotations_.clear();
+  if (size < 8 * kGraphFileHeaderSize) return false;
+  const int64* const header = reinterpret_cast<const int64*>(data);
+  const int64 num_nodes = header[2];
+  const int64 num_arcs = header[3];
+  const bool has_reverse_arcs = header[4] == 1;
+  const int64 num_arc_annotations = header[7];
+  const int64 num_node_annotations = header[8];
+  if (header[0] != kGraphFileMagic || header[1] != kGraphFileVersion ||
+      (header[4] != 0 && header[4] != 1) ||
+      header[5] != sizeof(NodeIndexType) || header[6] != sizeof(ArcIndexType) ||
+      num_nodes < 0 || num_nodes >= std::numeric_limits<NodeIndexType>::max() ||
+      num_arcs < 0 || num_arcs >= std::numeric_limits<ArcIndexType>::max() ||
+      num_arc_annotations < 0 || num_node_annotations < 0) {
+    return false;
+  }
+  const int64 num_head_words =
+      NumWords<NodeIndexType>(has_reverse_arcs ? 2 * num_arcs : num_arcs);
+  const int64 num_size_words =
+      kGraphFileHeaderSize +
+      (has_reverse_arcs ? 2 : 1) * NumWords<ArcIndexType>(num_nodes + 1) +
+      num_head_words +
+      (has_reverse_arcs ? NumWords<ArcIndexType>(2 * num_arcs) : 0) +
+      num_arc_annotations * num_arcs + num_node_annotations * num_nodes;
+  if (size != 8 * num_size_words) return false;
+
+  data += 8 * kGraphFileHeaderSize;
+  start_ = reinterpret_cast<const ArcIndexType*>(data);
+  data += 8 * NumWords<ArcIndexType>(num_nodes + 1);
+  if (has_reverse_arcs) {
+    reverse_start_ = reinterpret_cast<const ArcIndexType*>(data);
+    data += 8 * NumWords<ArcIndexType>(num_nodes + 1);
+  }
+  head_ = reinterpret_cast<const NodeIndexType*>(data) +
+          (has_reverse_arcs ? num_arcs : 0);
+  data += 8 * num_head_words;
+  if (has_reverse_arcs) {
+    opposite_ = reinterpret_cast<const ArcIndexType*>(data) + num_arcs;
+    data += 8 * NumWords<ArcIndexType>(2 * num_arcs);
+  }
+  for (int i = 0; i < num_arc_annotations; ++i) {
+    arc_annotations_.push_back(reinterpret_cast<const int64*>(data));
+    data += 8 * num_arcs;
+  }
+  for (int i = 0; i < num_node_annotations; ++i) {
+    node_annotations_.push_back(reinterpret_cast<const int64*>(data));
+    data += 8 * num_nodes;
+  }
+  // Only the extremities of the start arrays are checked, so that loading
+  // does not depend on the size of the graph.
+  if (start_[0] != 0 || start_[num_nodes] != num_arcs ||
+      (has_reverse_arcs &&
+       (reverse_start_[0] != -num_arcs || reverse_start_[num_nodes] != 0))) {
+    start_ = nullptr;
+    reverse_start_ = nullptr;
+    head_ = nullptr;
+    opposite_ = nullptr;
+    arc_annotations_.clear();
+    node_annotations_.clear();
+    return false;
+  }
+  num_nodes_ = num_nodes;
+  num_arcs_ = num_arcs;
+  return true;
+}
+
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_GRAPH_GRAPH_FILE_H_
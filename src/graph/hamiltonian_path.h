@@ -86,6 +86,7 @@
 #include <cmath>
 #include <limits>
 #include <memory>
+#include <thread>  // NOLINT
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -282,12 +283,27 @@ template <typename Set> class SetRangeWithCardinality {
 // node in set, for all the subsets of cardinality <= max_card_.
 // LatticeMemoryManager manages the storage of f(set, node) so that the
 // DP iteration access memory in increasing addresses.
+//
+// The manager can also keep only two layers, i.e. the values for the sets of
+// two consecutive cardinalities, which is all the DP iteration needs. The
+// layers of odd and even cardinalities then share the same memory, and the
+// memory is divided by about sqrt(pi * max_card / 8).
 template <typename Set, typename CostType> class LatticeMemoryManager {
  public:
-  LatticeMemoryManager() : max_card_(0) {}
+  LatticeMemoryManager() : max_card_(0), keep_all_layers_(true) {}
 
   // Reserves memory and fills in the data necessary to access memory.
-  void Init(int max_card);
+  void Init(int max_card) { Init(max_card, true); }
+  void Init(int max_card, bool keep_all_layers);
+
+  // Returns (n choose k), for k <= n + 1 <= max_card + 1.
+  uint64 BinomialCoefficient(int n, int k) const {
+    return binomial_coefficients_[n][k];
+  }
+
+  // Returns the set of cardinality 'card' with the given rank in the order
+  // of SetRangeWithCardinality, i.e. the order in which the sets are stored.
+  Set SetOfRank(int card, uint64 rank) const;
 
   // Returns the offset in memory for f(s, node), with node contained in s.
   uint64 Offset(Set s, int node) const;
@@ -337,6 +353,12 @@ template <typename Set, typename CostType> class LatticeMemoryManager {
   // used. This is equal to the number of nodes in the TSP.
   int max_card_;
 
+  // When false, only two layers are kept in memory_: the layers of even
+  // cardinalities start at offset 0 and those of odd cardinalities at offset
+  // layer_size_.
+  bool keep_all_layers_;
+  uint64 layer_size_;
+
   // binomial_coefficients_[n][k] contains (n choose k).
   std::vector<std::vector<uint64>> binomial_coefficients_;
 
@@ -350,11 +372,13 @@ template <typename Set, typename CostType> class LatticeMemoryManager {
 };
 
 template <typename Set, typename CostType>
-void LatticeMemoryManager<Set, CostType>::Init(int max_card) {
+void LatticeMemoryManager<Set, CostType>::Init(int max_card,
+                                               bool keep_all_layers) {
   DCHECK_LT(0, max_card);
   DCHECK_GE(Set::MaxCardinality, max_card);
-  if (max_card <= max_card_) return;
-  max_card_ = max_card;
+  if (max_card <= max_card_ && keep_all_layers == keep_all_layers_) return;
+  max_card_ = std::max(max_card, max_card_);
+  keep_all_layers_ = keep_all_layers;
   binomial_coefficients_.resize(max_card_ + 1);
 
   // Initialize binomial_coefficients_ using Pascal's triangle recursion.
@@ -374,27 +398,51 @@ void LatticeMemoryManager<Set, CostType>::Init(int max_card) {
   // There are k * binomial_coefficients_[max_card_][k] f(S,j) values to store
   // for each group of f(S,j), with card(S) = k. Update base_offset[k]
   // accordingly.
+  layer_size_ = 0;
   for (int k = 0; k < max_card_; ++k) {
     base_offset_[k + 1] = base_offset_[k] +
                           k * binomial_coefficients_[max_card_][k];
+    layer_size_ = std::max<uint64>(
+        layer_size_, (k + 1) * binomial_coefficients_[max_card_][k + 1]);
   }
   memory_.resize(0);
   memory_.shrink_to_fit();
-  memory_.resize(max_card_ * (1 << (max_card_ - 1)));
+  memory_.resize(keep_all_layers_
+                     ? static_cast<uint64>(max_card_) << (max_card_ - 1)
+                     : 2 * layer_size_);
   DCHECK(CheckConsistency());
 }
 
+template <typename Set, typename CostType>
+Set LatticeMemoryManager<Set, CostType>::SetOfRank(int card,
+                                                   uint64 rank) const {
+  DCHECK_LT(rank, binomial_coefficients_[max_card_][card]);
+  // This is the inverse of the computation of local_offset in BaseOffset():
+  // the largest element is the largest node such that there are at most rank
+  // sets with smaller largest elements, and so on.
+  Set set(0);
+  int node = max_card_ - 1;
+  for (int node_rank = card; node_rank > 0; --node_rank) {
+    while (binomial_coefficients_[node][node_rank] > rank) --node;
+    rank -= binomial_coefficients_[node][node_rank];
+    set = set.AddElement(node);
+    --node;
+  }
+  DCHECK_EQ(0, rank);
+  return set;
+}
+
 template <typename Set, typename CostType>
 bool LatticeMemoryManager<Set, CostType>::CheckConsistency() const {
   for (int n = 0; n <= max_card_; ++n) {
-    int64 sum = 0;
+    uint64 sum = 0;
     for (int k = 0; k <= n; ++k) {
       sum += binomial_coefficients_[n][k];
     }
-    DCHECK_EQ(1 << n, sum);
+    DCHECK_EQ(GG_ULONGLONG(1) << n, sum);
   }
   DCHECK_EQ(0, base_offset_[1]);
-  DCHECK_EQ(max_card_ * (1 << (max_card_ - 1)),
+  DCHECK_EQ(static_cast<uint64>(max_card_) << (max_card_ - 1),
             base_offset_[max_card_] + max_card_);
   return true;
 }
@@ -420,6 +468,7 @@ uint64 LatticeMemoryManager<Set, CostType>::BaseOffset(int card,
   // TODO(user): Evaluate the interest of the above.
   // There are 'card' f(set, j) to store. That is why we need to multiply
   // local_offset by card before adding it to the corresponding base_offset_.
+  if (!keep_all_layers_) return (card & 1) * layer_size_ + card * local_offset;
   return base_offset_[card] + card * local_offset;
 }
 
@@ -458,6 +507,10 @@ template <typename CostType> class HamiltonianPathSolver {
   // HamiltonianPathSolver<int> mhp(cost_mat);     // no computation done
   // printf("%d\n", mhp.TravelingSalesmanCost());  // computation done and
   // stored
+  //
+  // The sets of each cardinality can be processed in parallel, see
+  // SetNumThreads(), and the memory can be limited to two layers of the
+  // lattice, see SetMemoryBoundedMode().
  public:
   // In 2010, 26 was the maximum solvable with 24 Gigs of RAM, and it took
   // several minutes. With this 2014 version of the code, one may go a little
@@ -474,6 +527,20 @@ template <typename CostType> class HamiltonianPathSolver {
   // Replaces the cost matrix while avoiding re-allocating memory.
   void ChangeCostMatrix(const std::vector<std::vector<CostType>>& cost_matrix);
 
+  // Sets the number of threads used to compute each layer of the lattice, 1 by
+  // default. Small layers are always computed by the calling thread.
+  void SetNumThreads(int num_threads) { num_threads_ = num_threads; }
+
+  // In the memory-bounded mode, only the values of the two last layers of the
+  // lattice are kept, which divides the memory by about sqrt(pi * n / 8), and
+  // the paths are reconstructed by recomputing the lattices of the subsets of
+  // their nodes. Computing a path then takes about a third of the time of the
+  // initial computation. The costs are not affected. False by default.
+  void SetMemoryBoundedMode(bool memory_bounded) {
+    if (memory_bounded != memory_bounded_) solved_ = false;
+    memory_bounded_ = memory_bounded;
+  }
+
   // Returns the cost of the Hamiltonian path from 0 to end_node.
   CostType HamiltonianCost(int end_node);
 
@@ -513,6 +580,21 @@ template <typename CostType> class HamiltonianPathSolver {
   // Does all the Dynamic Progamming iterations.
   void Solve();
 
+  // Computes f(set, node) for all the subsets of universe, layer by layer.
+  void ComputeLattice(NodeSet universe);
+
+  // Computes f(set, node) for all the subsets of universe with cardinality
+  // card, possibly in parallel.
+  void ComputeLayer(int card, NodeSet universe, int universe_size);
+
+  // Computes f(set, node) for all the nodes of the given set. The nodes of
+  // set are stored in elements, which must have room for card values.
+  void ComputeSetValues(int card, NodeSet set, int* elements);
+
+  // Returns f(set, node). In the memory-bounded mode, first recomputes the
+  // lattice of the subsets of set if f(set, node) is no longer in memory.
+  CostType PartialCost(NodeSet set, int node);
+
   // Computes a path by looking at the information in mem_.
   std::vector<int> ComputePath(CostType cost, NodeSet set, int end);
 
@@ -524,6 +606,11 @@ template <typename CostType> class HamiltonianPathSolver {
   // ChangeCostMatrix();
   std::vector<std::vector<CostType>> cost_matrix_;
 
+  // The transposed cost matrix, stored by rows: incoming_costs_[dest *
+  // num_nodes_ + src] is the cost from src to dest. The DP iteration reads
+  // the costs to a given destination, which are thus contiguous.
+  std::vector<CostType> incoming_costs_;
+
   // Returns the saturated addition of a and b. By default for floating-point
   // types it is a + b. It is specialized below for int32 and int64.
   CostType SaturatedAdd(CostType a, CostType b) {
@@ -555,6 +642,14 @@ template <typename CostType> class HamiltonianPathSolver {
   // is hamiltonian_paths_[best_hamiltonian_path_end_node_].
   int best_hamiltonian_path_end_node_;
 
+  int num_threads_;
+  bool memory_bounded_;
+
+  // In the memory-bounded mode, mem_ contains f(set, node) for the subsets
+  // of computed_universe_ with at least computed_universe_.Cardinality() - 1
+  // elements.
+  NodeSet computed_universe_;
+
   LatticeMemoryManager<NodeSet, CostType> mem_;
 };
 
@@ -569,7 +664,10 @@ HamiltonianPathSolver<CostType>::HamiltonianPathSolver(
       triangle_inequality_ok_(true),
       robustness_checked_(false),
       triangle_inequality_checked_(false),
-      solved_(false) {
+      solved_(false),
+      num_threads_(1),
+      memory_bounded_(false),
+      computed_universe_(0) {
   CHECK(CheckCostMatrix());
 }
 
@@ -621,62 +719,26 @@ template <typename CostType> void HamiltonianPathSolver<CostType>::Solve() {
     hamiltonian_paths_[0] = { 0 };
     return;
   }
-  mem_.Init(num_nodes_);
-  // Initialize the first layer of the search lattice, taking into account
-  // that base_offset_[1] == 0. (This is what the DCHECK_EQ is for).
-  for (int dest = 0; dest < num_nodes_; ++dest) {
-    DCHECK_EQ(dest, mem_.BaseOffset(1, NodeSet::Singleton(dest)));
-    mem_.SetValueAtOffset(dest, cost_matrix_[0][dest]);
-  }
-
-  // Populate the dynamic programming lattice layer by layer, by iterating
-  // on cardinality.
-  for (int card = 2; card <= num_nodes_; ++card) {
-    // Iterate on sets of same cardinality.
-    for (NodeSet set : SetRangeWithCardinality<Set<uint32>>(card, num_nodes_)) {
-      // Using BaseOffset and maintaining the node ranks, to reduce the
-      // computational effort for accessing the data.
-      const uint64 set_offset = mem_.BaseOffset(card, set);
-      // The first subset on which we'll iterate is set.RemoveSmallestElement().
-      // Compute its offset. It will be updated incrementaly. This saves about
-      // 30-35% of computation time.
-      uint64 subset_offset = mem_.BaseOffset(card - 1,
-                                             set.RemoveSmallestElement());
-      int prev_dest = set.SmallestElement();
-      int dest_rank = 0;
-      for (int dest : set) {
-        CostType min_cost = std::numeric_limits<CostType>::max();
-        const NodeSet subset = set.RemoveElement(dest);
-        // We compute the offset for subset from the preceding iteration
-        // by taking into account that prev_dest is now in subset, and
-        // that dest is now removed from subset.
-        subset_offset += mem_.OffsetDelta(card - 1, prev_dest, dest, dest_rank);
-        int src_rank = 0;
-        for (int src : subset) {
-          min_cost = std::min(min_cost,
-                              SaturatedAdd(cost_matrix_[src][dest],
-                              mem_.ValueAtOffset(subset_offset + src_rank)));
-          ++src_rank;
-        }
-        prev_dest = dest;
-        mem_.SetValueAtOffset(set_offset + dest_rank, min_cost);
-        ++dest_rank;
-      }
+  mem_.Init(num_nodes_, !memory_bounded_);
+  incoming_costs_.resize(num_nodes_ * num_nodes_);
+  for (int src = 0; src < num_nodes_; ++src) {
+    for (int dest = 0; dest < num_nodes_; ++dest) {
+      incoming_costs_[dest * num_nodes_ + src] = cost_matrix_[src][dest];
     }
   }
-
   const NodeSet full_set = NodeSet::FullSet(num_nodes_);
+  ComputeLattice(full_set);
 
   // Get the cost of the tsp from node 0. It is the path that leaves 0 and goes
   // through all other nodes, and returns at 0, with minimal cost.
   tsp_cost_ = mem_.Value(full_set, 0);
-  tsp_path_ = ComputePath(tsp_cost_, full_set, 0);
 
-  hamiltonian_paths_.resize(num_nodes_);
+  hamiltonian_paths_.assign(num_nodes_, std::vector<int>());
   hamiltonian_costs_.resize(num_nodes_);
   // Compute the cost of the Hamiltonian paths starting from node 0, going
   // through all the other nodes, and ending at end_node. Compute the minimum
-  // one along the way.
+  // one along the way. The paths themselves are only computed on demand, by
+  // HamiltonianPath().
   CostType min_hamiltonian_cost = std::numeric_limits<CostType>::max();
   const NodeSet hamiltonian_set = full_set.RemoveElement(0);
   for (int end_node : hamiltonian_set) {
@@ -687,14 +749,119 @@ template <typename CostType> void HamiltonianPathSolver<CostType>::Solve() {
       best_hamiltonian_path_end_node_ = end_node;
     }
     DCHECK_LE(tsp_cost_, cost + cost_matrix_[end_node][0]);
-    // Get the Hamiltonian paths.
-    hamiltonian_paths_[end_node] =
-      ComputePath(hamiltonian_costs_[end_node], hamiltonian_set, end_node);
   }
 
+  // In the memory-bounded mode, this overwrites the values used above.
+  tsp_path_ = ComputePath(tsp_cost_, full_set, 0);
   solved_ = true;
 }
 
+template <typename CostType>
+void HamiltonianPathSolver<CostType>::ComputeLattice(NodeSet universe) {
+  // Initialize the first layer of the search lattice.
+  for (int dest : universe) {
+    mem_.SetValue(NodeSet::Singleton(dest), dest, cost_matrix_[0][dest]);
+  }
+
+  // Populate the dynamic programming lattice layer by layer, by iterating
+  // on cardinality.
+  const int universe_size = universe.Cardinality();
+  for (int card = 2; card <= universe_size; ++card) {
+    ComputeLayer(card, universe, universe_size);
+  }
+  computed_universe_ = universe;
+}
+
+template <typename CostType>
+void HamiltonianPathSolver<CostType>::ComputeLayer(int card, NodeSet universe,
+                                                   int universe_size) {
+  // The layers smaller than this number of sets per thread are not
+  // parallelized.
+  const uint64 kMinNumSetsPerThread = 1 << 12;
+  const bool is_full_universe = universe_size == num_nodes_;
+  std::vector<int> universe_nodes;
+  for (int node : universe) universe_nodes.push_back(node);
+
+  // Computes the values of the sets whose ranks, among the subsets of
+  // universe with cardinality card, are in [begin, end). The subsets of
+  // universe are enumerated as the subsets of [0, universe_size), whose
+  // elements are then replaced by the corresponding elements of universe.
+  auto compute_sets = [this, card, is_full_universe, &universe_nodes](
+      uint64 begin, uint64 end) {
+    std::vector<int> elements(card);
+    SetRangeIterator<SetRangeWithCardinality<NodeSet>> local_set(
+        mem_.SetOfRank(card, begin));
+    for (uint64 rank = begin; rank < end; ++rank, ++local_set) {
+      NodeSet set = *local_set;
+      if (!is_full_universe) {
+        set = NodeSet(0);
+        for (int i : *local_set) set = set.AddElement(universe_nodes[i]);
+      }
+      ComputeSetValues(card, set, elements.data());
+    }
+  };
+
+  const uint64 num_sets = mem_.BinomialCoefficient(universe_size, card);
+  const int num_chunks = static_cast<int>(std::min<uint64>(
+      std::max(1, num_threads_), num_sets / kMinNumSetsPerThread + 1));
+  std::vector<std::thread> threads;
+  for (int chunk = 1; chunk < num_chunks; ++chunk) {
+    threads.push_back(std::thread(compute_sets, num_sets * chunk / num_chunks,
+                                  num_sets * (chunk + 1) / num_chunks));
+  }
+  compute_sets(0, num_sets / num_chunks);
+  for (std::thread& thread : threads) thread.join();
+}
+
+template <typename CostType>
+void HamiltonianPathSolver<CostType>::ComputeSetValues(int card, NodeSet set,
+                                                       int* elements) {
+  // Using BaseOffset and maintaining the node ranks, to reduce the
+  // computational effort for accessing the data.
+  const uint64 set_offset = mem_.BaseOffset(card, set);
+  int num_elements = 0;
+  for (int node : set) elements[num_elements++] = node;
+  // The first subset on which we'll iterate is set.RemoveSmallestElement().
+  // Compute its offset. It will be updated incrementaly. This saves about
+  // 30-35% of computation time.
+  uint64 subset_offset = mem_.BaseOffset(card - 1, set.RemoveSmallestElement());
+  int prev_dest = elements[0];
+  for (int dest_rank = 0; dest_rank < card; ++dest_rank) {
+    const int dest = elements[dest_rank];
+    // We compute the offset for subset from the preceding iteration
+    // by taking into account that prev_dest is now in subset, and
+    // that dest is now removed from subset.
+    subset_offset += mem_.OffsetDelta(card - 1, prev_dest, dest, dest_rank);
+    // The element of rank src_rank in subset is elements[src_rank] before
+    // dest, and elements[src_rank + 1] after it. The two loops below only
+    // read contiguous memory, besides the costs to dest.
+    const CostType* const costs_to_dest = &incoming_costs_[dest * num_nodes_];
+    CostType min_cost = std::numeric_limits<CostType>::max();
+    for (int src_rank = 0; src_rank < dest_rank; ++src_rank) {
+      min_cost = std::min(
+          min_cost, SaturatedAdd(costs_to_dest[elements[src_rank]],
+                                 mem_.ValueAtOffset(subset_offset + src_rank)));
+    }
+    for (int src_rank = dest_rank; src_rank < card - 1; ++src_rank) {
+      min_cost = std::min(
+          min_cost, SaturatedAdd(costs_to_dest[elements[src_rank + 1]],
+                                 mem_.ValueAtOffset(subset_offset + src_rank)));
+    }
+    prev_dest = dest;
+    mem_.SetValueAtOffset(set_offset + dest_rank, min_cost);
+  }
+}
+
+template <typename CostType>
+CostType HamiltonianPathSolver<CostType>::PartialCost(NodeSet set, int node) {
+  if (memory_bounded_ &&
+      !(computed_universe_.Includes(set) &&
+        set.Cardinality() + 1 >= computed_universe_.Cardinality())) {
+    ComputeLattice(set);
+  }
+  return mem_.Value(set, node);
+}
+
 template <typename CostType>
 std::vector<int> HamiltonianPathSolver<CostType>::ComputePath(
     CostType cost, NodeSet set, int end_node) {
@@ -707,7 +874,7 @@ std::vector<int> HamiltonianPathSolver<CostType>::ComputePath(
   CostType current_cost = cost;
   for (int rank = path_size - 2; rank >= 0; --rank) {
     for (int src : subset) {
-      const CostType partial_cost = mem_.Value(subset, src);
+      const CostType partial_cost = PartialCost(subset, src);
       const CostType incumbent_cost = partial_cost + cost_matrix_[src][dest];
       // Take precision into account when CosttType is float or double.
       // There is no visible penalty in the case CostType is an integer type.
@@ -799,13 +966,19 @@ CostType HamiltonianPathSolver<CostType>::HamiltonianCost(int end_node) {
 template <typename CostType>
 std::vector<int> HamiltonianPathSolver<CostType>::HamiltonianPath(int end_node) {
   Solve();
+  if (hamiltonian_paths_[end_node].empty() && end_node != 0) {
+    const NodeSet hamiltonian_set =
+        NodeSet::FullSet(num_nodes_).RemoveElement(0);
+    hamiltonian_paths_[end_node] = ComputePath(hamiltonian_costs_[end_node],
+                                               hamiltonian_set, end_node);
+  }
   return hamiltonian_paths_[end_node];
 }
 
 template <typename CostType>
 void HamiltonianPathSolver<CostType>::HamiltonianPath(
     std::vector<PathNodeIndex>* path) {
-  *path = HamiltonianPath(best_hamiltonian_path_end_node_);
+  *path = HamiltonianPath(BestHamiltonianPathEndNode());
 }
 
 template <typename CostType>
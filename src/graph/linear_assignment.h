@@ -31,6 +31,9 @@
 // but in the practical implementation jimbob@ could never get that approach to
 // yield faster code.
 //
+// See graph/auction_assignment.h for an auction algorithm that can use several
+// threads and start from the prices of a previous solve.
+//
 // Example usage:
 //
 //   #include "graph/graph.h"
@@ -207,6 +210,7 @@
 
 #include "base/commandlineflags.h"
 #include "base/integral_types.h"
+#include "base/large_array_allocator.h"
 #include "base/logging.h"
 #include "base/macros.h"
 #include "base/stringprintf.h"
@@ -941,8 +945,9 @@ class LinearSumAssignment {
 
   // The array of arc costs as given in the problem definition, except
   // that they are scaled up by the number of nodes in the graph so we
-  // can use integer arithmetic throughout.
-  std::vector<CostValue> scaled_arc_cost_;
+  // can use integer arithmetic throughout. This is the only per-arc array of
+  // the algorithm, hence the LargeArrayAllocator.
+  std::vector<CostValue, LargeArrayAllocator<CostValue> > scaled_arc_cost_;
 
   // The container of active nodes (i.e., unmatched nodes). This can
   // be switched easily between ActiveNodeStack and ActiveNodeQueue
@@ -1030,7 +1035,8 @@ void LinearSumAssignment<GraphType>::SetArcCost(ArcIndex arc, CostValue cost) {
 template <typename ArcIndexType>
 class CostValueCycleHandler : public PermutationCycleHandler<ArcIndexType> {
  public:
-  explicit CostValueCycleHandler(std::vector<CostValue>* cost)
+  explicit CostValueCycleHandler(
+      std::vector<CostValue, LargeArrayAllocator<CostValue> >* cost)
       : temp_(0), cost_(cost) {}
 
   void SetTempFromIndex(ArcIndexType source) override {
@@ -1050,7 +1056,7 @@ class CostValueCycleHandler : public PermutationCycleHandler<ArcIndexType> {
 
  private:
   CostValue temp_;
-  std::vector<CostValue>* const cost_;
+  std::vector<CostValue, LargeArrayAllocator<CostValue> >* const cost_;
 
   DISALLOW_COPY_AND_ASSIGN(CostValueCycleHandler);
 };
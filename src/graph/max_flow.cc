@@ -15,12 +15,50 @@
 #include "graph/max_flow.h"
 
 #include <algorithm>
+#include <thread>
 
 #include "base/stringprintf.h"
 #include "graph/graphs.h"
 
 namespace operations_research {
 
+namespace {
+// ParallelFor() runs in the calling thread when there are less than this number
+// of items per thread.
+const int kMinItemsPerThread = 1024;
+
+// The number of consecutive items processed by a thread at a time.
+const int kParallelForBlockSize = 256;
+
+// Calls body(i) for all the i in [0, num_items) on at most num_threads threads,
+// including the calling one.
+template <typename Body>
+void ParallelFor(int num_threads, int64 num_items, const Body& body) {
+  const int64 num_workers =
+      std::min<int64>(num_threads, num_items / kMinItemsPerThread);
+  if (num_workers <= 1) {
+    for (int64 i = 0; i < num_items; ++i) body(i);
+    return;
+  }
+  std::atomic<int64> next_block(0);
+  auto worker = [num_items, &body, &next_block]() {
+    while (true) {
+      const int64 begin = next_block.fetch_add(kParallelForBlockSize);
+      if (begin >= num_items) return;
+      const int64 end =
+          std::min<int64>(num_items, begin + kParallelForBlockSize);
+      for (int64 i = begin; i < end; ++i) body(i);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int64 thread = 1; thread < num_workers; ++thread) {
+    threads.push_back(std::thread(worker));
+  }
+  worker();
+  for (std::thread& thread : threads) thread.join();
+}
+}  // namespace
+
 SimpleMaxFlow::SimpleMaxFlow() : num_nodes_(0) {}
 
 ArcIndex SimpleMaxFlow::AddArcWithCapacity(NodeIndex tail, NodeIndex head,
@@ -132,6 +170,7 @@ GenericMaxFlow<Graph>::GenericMaxFlow(const Graph* graph, NodeIndex source,
       process_node_by_height_(true),
       check_input_(true),
       check_result_(true),
+      num_threads_(1),
       stats_("MaxFlow") {
   SCOPED_TIME_STAT(&stats_);
   DCHECK(graph->IsNodeValid(source));
@@ -341,7 +380,9 @@ bool GenericMaxFlow<Graph>::Solve() {
     status_ = OPTIMAL;
     return true;
   }
-  if (use_global_update_) {
+  if (num_threads_ > 1) {
+    RefineInParallel();
+  } else if (use_global_update_) {
     RefineWithGlobalUpdate();
   } else {
     Refine();
@@ -833,6 +874,204 @@ void GenericMaxFlow<Graph>::RefineWithGlobalUpdate() {
   }
 }
 
+template <typename Graph>
+void GenericMaxFlow<Graph>::RefineInParallel() {
+  SCOPED_TIME_STAT(&stats_);
+  const NodeIndex num_nodes = Graphs<Graph>::NodeReservation(*graph_);
+  if (pushed_excess_.size() != num_nodes) {
+    pushed_excess_ = std::vector<std::atomic<FlowQuantity>>(num_nodes);
+    node_reached_ = std::vector<std::atomic<bool>>(num_nodes);
+  }
+  for (NodeIndex node = 0; node < num_nodes; ++node) {
+    pushed_excess_[node].store(0, std::memory_order_relaxed);
+  }
+  new_node_potential_.assign(num_nodes, 0);
+  node_is_active_.assign(num_nodes, false);
+  next_active_nodes_.resize(num_nodes);
+  active_nodes_.clear();
+
+  // As in RefineWithGlobalUpdate(), the heights quickly become poor lower
+  // bounds of the distances to the sink, so they are recomputed after a number
+  // of relabels proportional to the number of nodes.
+  while (SaturateOutgoingArcsFromSource()) {
+    GlobalUpdateInParallel();
+    int64 num_relabels = 0;
+    while (!active_nodes_.empty()) {
+      if (num_relabels > num_nodes / 2) {
+        GlobalUpdateInParallel();
+        num_relabels = 0;
+        continue;
+      }
+      num_relabels += DischargeActiveNodesInParallel();
+    }
+    if (use_two_phase_algorithm_) {
+      PushFlowExcessBackToSource();
+    }
+  }
+}
+
+template <typename Graph>
+int64 GenericMaxFlow<Graph>::DischargeActiveNodesInParallel() {
+  SCOPED_TIME_STAT(&stats_);
+  const NodeIndex num_nodes = graph_->num_nodes();
+  const int64 num_active_nodes = active_nodes_.size();
+  std::atomic<int64> num_next_active_nodes(0);
+
+  // Pushes the excess of each active node on its admissible arcs. The heights
+  // do not change during this step, so the two arcs of a pair are never both
+  // admissible, and only one node modifies their residual capacities. Note
+  // that the heights are compared first, so that a node never reads the
+  // residual capacity of an arc that another node is pushing on.
+  //
+  // The nodes that become active are added to next_active_nodes_ by the first
+  // push to them, unless they are already in active_nodes_.
+  ParallelFor(num_threads_, num_active_nodes, [&](int64 i) {
+    const NodeIndex node = active_nodes_[i];
+    const NodeHeight head_height = node_potential_[node] - 1;
+    FlowQuantity excess = node_excess_[node];
+    const ArcIndex first_arc = first_admissible_arc_[node];
+    for (IncidentArcIterator it = first_arc == Graph::kNilArc
+                                      ? IncidentArcIterator(*graph_, node)
+                                      : IncidentArcIterator(*graph_, node,
+                                                            first_arc);
+         it.Ok(); it.Next()) {
+      const ArcIndex arc = it.Index();
+      const NodeIndex head = Head(arc);
+      if (node_potential_[head] != head_height) continue;
+      if (residual_arc_capacity_[arc] == 0) continue;
+      const FlowQuantity flow = std::min(excess, residual_arc_capacity_[arc]);
+      residual_arc_capacity_[arc] -= flow;
+      residual_arc_capacity_[Opposite(arc)] += flow;
+      excess -= flow;
+      if (pushed_excess_[head].fetch_add(flow, std::memory_order_relaxed) ==
+              0 &&
+          !node_is_active_[head] && head != source_ && head != sink_) {
+        next_active_nodes_[num_next_active_nodes++] = head;
+      }
+      if (excess == 0) {
+        first_admissible_arc_[node] = arc;  // arc may still be admissible.
+        break;
+      }
+    }
+    node_excess_[node] = excess;
+  });
+  const int64 num_new_active_nodes = num_next_active_nodes;
+
+  // Relabels the nodes that still have some excess, using the heights of
+  // the previous round. All their admissible arcs are saturated, so their
+  // height increases. This is the same as Relabel() except that the new
+  // heights are only applied in the next step.
+  std::atomic<int64> num_relabels(0);
+  ParallelFor(num_threads_, num_active_nodes, [&](int64 i) {
+    const NodeIndex node = active_nodes_[i];
+    node_is_active_[node] = false;
+    if (node_excess_[node] == 0) return;
+    NodeHeight min_height = std::numeric_limits<NodeHeight>::max();
+    ArcIndex first_admissible_arc = Graph::kNilArc;
+    for (IncidentArcIterator it(*graph_, node); it.Ok(); it.Next()) {
+      const ArcIndex arc = it.Index();
+      if (residual_arc_capacity_[arc] > 0) {
+        const NodeHeight head_height = node_potential_[Head(arc)];
+        if (head_height < min_height) {
+          min_height = head_height;
+          first_admissible_arc = arc;
+        }
+      }
+    }
+    DCHECK_NE(first_admissible_arc, Graph::kNilArc);
+    DCHECK_GE(min_height, node_potential_[node]);
+    new_node_potential_[node] = min_height + 1;
+    first_admissible_arc_[node] = first_admissible_arc;
+    ++num_relabels;
+  });
+
+  // Applies the new heights and the pushed excesses. The discharged nodes that
+  // are still active are added after the new active nodes.
+  ParallelFor(num_threads_, num_active_nodes + num_new_active_nodes,
+              [&](int64 i) {
+    if (i >= num_active_nodes) {
+      const NodeIndex node = next_active_nodes_[i - num_active_nodes];
+      node_excess_[node] += pushed_excess_[node].exchange(0);
+      node_is_active_[node] = true;
+      return;
+    }
+    const NodeIndex node = active_nodes_[i];
+    if (node_excess_[node] > 0) {
+      node_potential_[node] = new_node_potential_[node];
+    }
+    node_excess_[node] += pushed_excess_[node].exchange(0);
+    if (node_excess_[node] > 0 &&
+        (!use_two_phase_algorithm_ || node_potential_[node] < num_nodes)) {
+      node_is_active_[node] = true;
+      next_active_nodes_[num_next_active_nodes++] = node;
+    }
+  });
+  node_excess_[sink_] += pushed_excess_[sink_].exchange(0);
+  node_excess_[source_] += pushed_excess_[source_].exchange(0);
+  active_nodes_.assign(next_active_nodes_.begin(),
+                       next_active_nodes_.begin() + num_next_active_nodes);
+  return num_relabels;
+}
+
+template <typename Graph>
+void GenericMaxFlow<Graph>::GlobalUpdateInParallel() {
+  SCOPED_TIME_STAT(&stats_);
+  const NodeIndex num_nodes = graph_->num_nodes();
+  for (const NodeIndex node : active_nodes_) node_is_active_[node] = false;
+  active_nodes_.clear();
+  // The heights change, so the first admissible arc of each node is reset and
+  // the next discharge scans all its arcs.
+  ParallelFor(num_threads_, num_nodes, [this](int64 node) {
+    node_reached_[node].store(false, std::memory_order_relaxed);
+    first_admissible_arc_[node] = Graph::kNilArc;
+  });
+  node_reached_[sink_] = true;
+  node_reached_[source_] = true;
+
+  // The two searches of GlobalUpdate(), one level at a time: the nodes of a
+  // level are in bfs_queue_ between level_begin and level_end, and the nodes
+  // that they reach are appended after them.
+  bfs_queue_.resize(num_nodes);
+  std::atomic<int64> queue_size(0);
+  const int num_passes = use_two_phase_algorithm_ ? 1 : 2;
+  for (int pass = 0; pass < num_passes; ++pass) {
+    int64 level_begin = queue_size;
+    bfs_queue_[queue_size++] = pass == 0 ? sink_ : source_;
+    while (level_begin < queue_size) {
+      const int64 level_end = queue_size;
+      ParallelFor(num_threads_, level_end - level_begin, [&](int64 i) {
+        const NodeIndex node = bfs_queue_[level_begin + i];
+        const NodeIndex candidate_distance = node_potential_[node] + 1;
+        for (IncidentArcIterator it(*graph_, node); it.Ok(); it.Next()) {
+          const ArcIndex arc = it.Index();
+          const NodeIndex head = Head(arc);
+          if (node_reached_[head].load(std::memory_order_relaxed)) continue;
+          if (residual_arc_capacity_[Opposite(arc)] == 0) continue;
+          if (node_reached_[head].exchange(true)) continue;
+          node_potential_[head] = candidate_distance;
+          bfs_queue_[queue_size++] = head;
+        }
+      });
+      level_begin = level_end;
+    }
+  }
+
+  // As in GlobalUpdate(), the nodes that were not reached get an unreachable
+  // height. The active nodes are then the reached nodes with some excess.
+  ParallelFor(num_threads_, num_nodes, [this, num_nodes](int64 node) {
+    if (!node_reached_[node].load(std::memory_order_relaxed)) {
+      node_potential_[node] = 2 * num_nodes - 1;
+    }
+  });
+  bfs_queue_.resize(queue_size);
+  for (const NodeIndex node : bfs_queue_) {
+    if (IsActive(node)) {
+      active_nodes_.push_back(node);
+      node_is_active_[node] = true;
+    }
+  }
+}
+
 template <typename Graph>
 void GenericMaxFlow<Graph>::Discharge(NodeIndex node) {
   SCOPED_TIME_STAT(&stats_);
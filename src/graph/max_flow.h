@@ -115,6 +115,7 @@
 #define OR_TOOLS_GRAPH_MAX_FLOW_H_
 
 #include <algorithm>
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -407,6 +408,19 @@ class GenericMaxFlow : public MaxFlowStatusClass {
     process_node_by_height_ = value && use_global_update_;
   }
 
+  // Sets the number of threads used by Solve(), 1 by default. With more than
+  // one thread, Solve() uses a synchronous parallel variant of push-relabel:
+  // each round discharges all the active nodes concurrently with the heights
+  // of the previous round, so that each pair of opposite arcs is only modified
+  // by one node, and the excesses are accumulated with atomic operations. The
+  // heights are periodically recomputed by a parallel breadth-first search.
+  // The result does not depend on the number of threads. The options above
+  // about the global update and the processing order are then ignored.
+  //
+  // This is only worth it on large graphs: the active nodes are discharged by
+  // the current thread when there are only a few of them.
+  void SetNumThreads(int num_threads) { num_threads_ = num_threads; }
+
   // Returns the protocol buffer representation of the current problem.
   FlowModel CreateFlowModel();
 
@@ -470,6 +484,19 @@ class GenericMaxFlow : public MaxFlowStatusClass {
   // Performs optimization step.
   void Refine();
   void RefineWithGlobalUpdate();
+  void RefineInParallel();
+
+  // Runs one round of the parallel algorithm: discharges all the nodes of
+  // active_nodes_ concurrently, relabels the ones that still have some excess,
+  // and replaces active_nodes_ by the nodes that are active after the round.
+  // Returns the number of relabeled nodes.
+  int64 DischargeActiveNodesInParallel();
+
+  // Same as GlobalUpdate() with a parallel level-by-level breadth-first
+  // search, but without stealing the excess of the reached nodes. Fills
+  // active_nodes_ with all the active nodes that can reach the sink (or the
+  // source, without the two-phase algorithm).
+  void GlobalUpdateInParallel();
 
   // Discharges an active node node by saturating its admissible adjacent arcs,
   // if any, and by relabelling it when it becomes inactive.
@@ -622,6 +649,20 @@ class GenericMaxFlow : public MaxFlowStatusClass {
   // TODO(user): Make the check more exhaustive by checking the optimality?
   bool check_result_;
 
+  // The number of threads used by Solve(), see SetNumThreads().
+  int num_threads_;
+
+  // Used by the parallel algorithm. During a round, pushed_excess_ accumulates
+  // the flow pushed to each node and new_node_potential_ holds the new heights
+  // of the discharged nodes. node_is_active_[node] is true if node is in
+  // active_nodes_, and next_active_nodes_ collects the active nodes of the next
+  // round. node_reached_ marks the nodes reached by GlobalUpdateInParallel().
+  std::vector<std::atomic<FlowQuantity>> pushed_excess_;
+  std::vector<NodeHeight> new_node_potential_;
+  std::vector<char> node_is_active_;
+  std::vector<NodeIndex> next_active_nodes_;
+  std::vector<std::atomic<bool>> node_reached_;
+
   // Statistics about this class.
   mutable StatsGroup stats_;
 
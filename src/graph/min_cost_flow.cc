@@ -486,6 +486,39 @@ GenericMinCostFlow<Graph, ArcFlowType, ArcScaledCostType>::GetFirstIncidentArc(
 template <typename Graph, typename ArcFlowType, typename ArcScaledCostType>
 bool GenericMinCostFlow<Graph, ArcFlowType, ArcScaledCostType>::Solve() {
   status_ = NOT_SOLVED;
+  if (!CheckInputBeforeSolve()) return false;
+  node_potential_.SetAll(0);
+  ResetFirstAdmissibleArcs();
+  ScaleCosts();
+  return OptimizeScaledCosts();
+}
+
+template <typename Graph, typename ArcFlowType, typename ArcScaledCostType>
+bool GenericMinCostFlow<Graph, ArcFlowType, ArcScaledCostType>::Resolve() {
+  status_ = NOT_SOLVED;
+  ComputeExcessesFromFlow();
+  if (!CheckInputBeforeSolve()) return false;
+  ResetFirstAdmissibleArcs();
+  ScaleCosts();
+
+  // The first Refine() of Optimize() uses epsilon_ / alpha_. This is the
+  // same as in Solve() where the initial zero flow and potentials are
+  // epsilon-optimal for the largest scaled cost.
+  epsilon_ = NormalizePotentialsAndComputeEpsilon();
+  VLOG(3) << "Initial epsilon of the previous solution = " << epsilon_;
+
+  // The changes usually require large potential changes compared to the small
+  // epsilon, which would take many relabels without the price updates.
+  const bool use_price_update = use_price_update_;
+  use_price_update_ = true;
+  const bool result = OptimizeScaledCosts();
+  use_price_update_ = use_price_update;
+  return result;
+}
+
+template <typename Graph, typename ArcFlowType, typename ArcScaledCostType>
+bool GenericMinCostFlow<Graph, ArcFlowType,
+                        ArcScaledCostType>::CheckInputBeforeSolve() {
   if (FLAGS_min_cost_flow_check_balance && !CheckInputConsistency()) {
     status_ = UNBALANCED;
     return false;
@@ -498,9 +531,56 @@ bool GenericMinCostFlow<Graph, ArcFlowType, ArcScaledCostType>::Solve() {
     status_ = INFEASIBLE;
     return false;
   }
-  node_potential_.SetAll(0);
-  ResetFirstAdmissibleArcs();
-  ScaleCosts();
+  return true;
+}
+
+template <typename Graph, typename ArcFlowType, typename ArcScaledCostType>
+void GenericMinCostFlow<Graph, ArcFlowType,
+                        ArcScaledCostType>::ComputeExcessesFromFlow() {
+  for (NodeIndex node = 0; node < graph_->num_nodes(); ++node) {
+    node_excess_.Set(node, initial_node_excess_[node]);
+  }
+  for (ArcIndex arc = 0; arc < graph_->num_arcs(); ++arc) {
+    const FlowQuantity flow = residual_arc_capacity_[Opposite(arc)];
+    if (flow == 0) continue;
+    const NodeIndex tail = Tail(arc);
+    node_excess_.Set(tail, node_excess_[tail] - flow);
+    const NodeIndex head = Head(arc);
+    node_excess_.Set(head, node_excess_[head] + flow);
+  }
+}
+
+template <typename Graph, typename ArcFlowType, typename ArcScaledCostType>
+CostValue
+GenericMinCostFlow<Graph, ArcFlowType,
+                   ArcScaledCostType>::NormalizePotentialsAndComputeEpsilon() {
+  const NodeIndex num_nodes = graph_->num_nodes();
+  if (num_nodes == 0) return 1LL;
+
+  // Potentials only decrease during the algorithm, so this avoids an overflow
+  // after many calls to Resolve(). The reduced costs do not change.
+  CostValue max_potential = node_potential_[0];
+  for (NodeIndex node = 1; node < num_nodes; ++node) {
+    max_potential = std::max(max_potential, node_potential_[node]);
+  }
+  for (NodeIndex node = 0; node < num_nodes; ++node) {
+    node_potential_.Set(node, node_potential_[node] - max_potential);
+  }
+  CostValue epsilon = 1LL;
+  for (NodeIndex node = 0; node < num_nodes; ++node) {
+    for (IncidentArcIterator it(*graph_, node); it.Ok(); it.Next()) {
+      const ArcIndex arc = it.Index();
+      if (residual_arc_capacity_[arc] > 0) {
+        epsilon = std::max(epsilon, -ReducedCost(arc));
+      }
+    }
+  }
+  return epsilon;
+}
+
+template <typename Graph, typename ArcFlowType, typename ArcScaledCostType>
+bool GenericMinCostFlow<Graph, ArcFlowType,
+                        ArcScaledCostType>::OptimizeScaledCosts() {
   Optimize();
   if (FLAGS_min_cost_flow_check_result && !CheckResult()) {
     status_ = BAD_RESULT;
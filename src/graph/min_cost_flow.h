@@ -361,6 +361,17 @@ class GenericMinCostFlow : public MinCostFlowBase {
   // Solves the problem, returning true if a min-cost flow could be found.
   bool Solve();
 
+  // Same as Solve(), but starts from the flow and the node potentials of the
+  // last Solve() or Resolve(). This is much faster after small changes of the
+  // supplies, arc costs or capacities: the flow is then epsilon-optimal for
+  // a small epsilon, and only the last epsilon phases of the cost scaling
+  // are run, pushing the flow around the modified parts of the network.
+  //
+  // Contrary to Solve(), the current flow is kept, and the excess at each
+  // node is recomputed as its supply minus its net outflow. Note that
+  // SetArcFlow() can be used to give an arbitrary initial flow.
+  bool Resolve();
+
   // Checks for feasibility, i.e., that all the supplies and demands can be
   // matched without exceeding bottlenecks in the network.
   // If infeasible_supply_node (resp. infeasible_demand_node) are not NULL,
@@ -464,6 +475,22 @@ class GenericMinCostFlow : public MinCostFlowBase {
   // Scales the costs, by multiplying them by (graph_->num_nodes() + 1).
   void ScaleCosts();
 
+  // Runs the checks of Solve() selected by the flags and options, and sets
+  // status_ and returns false if one of them fails.
+  bool CheckInputBeforeSolve();
+
+  // Runs the cost scaling from the current epsilon_, unscales the costs and
+  // computes the total cost of the flow. Returns false on error.
+  bool OptimizeScaledCosts();
+
+  // Sets node_excess_ to the supply of each node minus its net outflow.
+  void ComputeExcessesFromFlow();
+
+  // Returns the smallest epsilon for which the current pseudo-flow is
+  // epsilon-optimal with the scaled costs, or 1 if it is optimal. Also shifts
+  // the node potentials so that the largest one is 0.
+  CostValue NormalizePotentialsAndComputeEpsilon();
+
   // Unscales the costs, by dividing them by (graph_->num_nodes() + 1).
   void UnscaleCosts();
 
@@ -0,0 +1,507 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "graph/network_simplex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+
+namespace operations_research {
+
+namespace {
+// The minimum number of arcs of a pricing block.
+const int kMinBlockSize = 10;
+
+// The blocks are priced in the calling thread when there are less than this
+// number of blocks per thread.
+const int kMinBlocksPerThread = 16;
+
+// Calls body(i) for all the i in [0, num_items) on at most num_threads threads,
+// including the calling one. Thread t handles the items i with i % num_workers
+// == t.
+template <typename Body>
+void ParallelFor(int num_threads, int64 num_items, const Body& body) {
+  const int64 num_workers =
+      std::min<int64>(num_threads, num_items / kMinBlocksPerThread);
+  if (num_workers <= 1) {
+    for (int64 i = 0; i < num_items; ++i) body(i);
+    return;
+  }
+  auto worker = [num_items, num_workers, &body](int64 first_item) {
+    for (int64 i = first_item; i < num_items; i += num_workers) body(i);
+  };
+  std::vector<std::thread> threads;
+  for (int64 thread = 1; thread < num_workers; ++thread) {
+    threads.push_back(std::thread(worker, thread));
+  }
+  worker(0);
+  for (std::thread& thread : threads) thread.join();
+}
+}  // namespace
+
+template <typename Graph>
+const typename Graph::NodeIndex
+    NetworkSimplexMinCostFlow<Graph>::kNilNode = -1;
+
+template <typename Graph>
+NetworkSimplexMinCostFlow<Graph>::NetworkSimplexMinCostFlow(const Graph* graph)
+    : graph_(graph),
+      num_nodes_(graph->num_nodes()),
+      num_arcs_(graph->num_arcs()),
+      root_(graph->num_nodes()),
+      supply_(num_nodes_, 0),
+      capacity_(num_arcs_ + num_nodes_, kint64max),
+      cost_(num_arcs_ + num_nodes_, 0),
+      source_(num_arcs_ + num_nodes_),
+      target_(num_arcs_ + num_nodes_),
+      flow_(num_arcs_ + num_nodes_, 0),
+      state_(num_arcs_ + num_nodes_, LOWER),
+      parent_(num_nodes_ + 1, kNilNode),
+      pred_(num_nodes_ + 1, -1),
+      depth_(num_nodes_ + 1, 0),
+      first_child_(num_nodes_ + 1, kNilNode),
+      next_sibling_(num_nodes_ + 1, kNilNode),
+      previous_sibling_(num_nodes_ + 1, kNilNode),
+      potential_(num_nodes_ + 1, 0),
+      has_tree_(false),
+      block_size_(kMinBlockSize),
+      next_arc_(0),
+      num_threads_(1),
+      status_(NOT_SOLVED),
+      optimal_cost_(0),
+      num_pivots_(0) {
+  for (ArcIndex arc = 0; arc < num_arcs_; ++arc) {
+    capacity_[arc] = 0;
+    source_[arc] = graph_->Tail(arc);
+    target_[arc] = graph_->Head(arc);
+  }
+  for (NodeIndex node = 0; node < num_nodes_; ++node) {
+    source_[ArtificialArc(node)] = node;
+    target_[ArtificialArc(node)] = root_;
+  }
+}
+
+template <typename Graph>
+void NetworkSimplexMinCostFlow<Graph>::SetNodeSupply(NodeIndex node,
+                                                     FlowQuantity supply) {
+  DCHECK_LE(0, node);
+  DCHECK_LT(node, num_nodes_);
+  supply_[node] = supply;
+  status_ = NOT_SOLVED;
+}
+
+template <typename Graph>
+void NetworkSimplexMinCostFlow<Graph>::SetArcCapacity(ArcIndex arc,
+                                                      FlowQuantity capacity) {
+  DCHECK_LE(0, arc);
+  DCHECK_LT(arc, num_arcs_);
+  DCHECK_LE(0, capacity);
+  capacity_[arc] = capacity;
+  status_ = NOT_SOLVED;
+}
+
+template <typename Graph>
+void NetworkSimplexMinCostFlow<Graph>::SetArcUnitCost(ArcIndex arc,
+                                                      CostValue unit_cost) {
+  DCHECK_LE(0, arc);
+  DCHECK_LT(arc, num_arcs_);
+  cost_[arc] = unit_cost;
+  status_ = NOT_SOLVED;
+}
+
+template <typename Graph>
+void NetworkSimplexMinCostFlow<Graph>::AddChild(NodeIndex parent,
+                                                NodeIndex node) {
+  parent_[node] = parent;
+  previous_sibling_[node] = kNilNode;
+  next_sibling_[node] = first_child_[parent];
+  if (first_child_[parent] != kNilNode) {
+    previous_sibling_[first_child_[parent]] = node;
+  }
+  first_child_[parent] = node;
+}
+
+template <typename Graph>
+void NetworkSimplexMinCostFlow<Graph>::RemoveChild(NodeIndex node) {
+  const NodeIndex previous = previous_sibling_[node];
+  const NodeIndex next = next_sibling_[node];
+  if (previous == kNilNode) {
+    first_child_[parent_[node]] = next;
+  } else {
+    next_sibling_[previous] = next;
+  }
+  if (next != kNilNode) previous_sibling_[next] = previous;
+  parent_[node] = kNilNode;
+}
+
+template <typename Graph>
+void NetworkSimplexMinCostFlow<Graph>::InitializeStarTree() {
+  for (ArcIndex arc = 0; arc < num_arcs_ + num_nodes_; ++arc) {
+    flow_[arc] = 0;
+    state_[arc] = LOWER;
+  }
+  first_child_.assign(num_nodes_ + 1, kNilNode);
+  for (NodeIndex node = 0; node < num_nodes_; ++node) {
+    AddChild(root_, node);
+    pred_[node] = ArtificialArc(node);
+    state_[ArtificialArc(node)] = TREE;
+  }
+  parent_[root_] = kNilNode;
+  next_arc_ = 0;
+  has_tree_ = true;
+}
+
+template <typename Graph>
+void NetworkSimplexMinCostFlow<Graph>::RepairTree() {
+  // The flow of the non-tree arcs, and the balance of each node without the
+  // tree arcs.
+  node_balance_.assign(num_nodes_ + 1, 0);
+  for (NodeIndex node = 0; node < num_nodes_; ++node) {
+    node_balance_[node] = supply_[node];
+  }
+  for (ArcIndex arc = 0; arc < num_arcs_ + num_nodes_; ++arc) {
+    if (state_[arc] == TREE) continue;
+    if (arc >= num_arcs_ || capacity_[arc] == 0) state_[arc] = LOWER;
+    flow_[arc] = state_[arc] == UPPER ? capacity_[arc] : 0;
+    node_balance_[source_[arc]] -= flow_[arc];
+    node_balance_[target_[arc]] += flow_[arc];
+  }
+
+  // The nodes in breadth-first order, so the subtrees are processed before
+  // their root below.
+  std::vector<NodeIndex> order;
+  order.reserve(num_nodes_ + 1);
+  order.push_back(root_);
+  for (int i = 0; i < order.size(); ++i) {
+    for (NodeIndex child = first_child_[order[i]]; child != kNilNode;
+         child = next_sibling_[child]) {
+      order.push_back(child);
+    }
+  }
+  DCHECK_EQ(num_nodes_ + 1, order.size());
+
+  for (int i = order.size() - 1; i > 0; --i) {
+    const NodeIndex node = order[i];
+    const ArcIndex arc = pred_[node];
+    const FlowQuantity balance = node_balance_[node];
+    if (arc >= num_arcs_) {
+      // This is the artificial arc of the node, which can simply be oriented
+      // to carry the balance.
+      source_[arc] = balance >= 0 ? node : root_;
+      target_[arc] = balance >= 0 ? root_ : node;
+      flow_[arc] = std::abs(balance);
+      continue;
+    }
+    const bool is_up_arc = source_[arc] == node;
+    const FlowQuantity flow = is_up_arc ? balance : -balance;
+    // The tree must stay strongly feasible: the node must be able to send some
+    // more flow to its parent.
+    const bool is_feasible =
+        is_up_arc ? flow >= 0 && flow < capacity_[arc]
+                  : flow > 0 && flow <= capacity_[arc];
+    if (is_feasible) {
+      flow_[arc] = flow;
+      node_balance_[parent_[node]] += balance;
+      continue;
+    }
+    const FlowQuantity bound = flow <= 0 ? 0 : capacity_[arc];
+    flow_[arc] = bound;
+    state_[arc] = bound == 0 ? LOWER : UPPER;
+    const FlowQuantity sent = is_up_arc ? bound : -bound;
+    node_balance_[parent_[node]] += sent;
+    const FlowQuantity remainder = balance - sent;
+    const ArcIndex artificial_arc = ArtificialArc(node);
+    source_[artificial_arc] = remainder >= 0 ? node : root_;
+    target_[artificial_arc] = remainder >= 0 ? root_ : node;
+    flow_[artificial_arc] = std::abs(remainder);
+    state_[artificial_arc] = TREE;
+    pred_[node] = artificial_arc;
+    RemoveChild(node);
+    AddChild(root_, node);
+  }
+  ComputeDepthsAndPotentials();
+}
+
+template <typename Graph>
+void NetworkSimplexMinCostFlow<Graph>::ComputeDepthsAndPotentials() {
+  depth_[root_] = 0;
+  potential_[root_] = 0;
+  node_stack_.clear();
+  node_stack_.push_back(root_);
+  while (!node_stack_.empty()) {
+    const NodeIndex node = node_stack_.back();
+    node_stack_.pop_back();
+    for (NodeIndex child = first_child_[node]; child != kNilNode;
+         child = next_sibling_[child]) {
+      const ArcIndex arc = pred_[child];
+      depth_[child] = depth_[node] + 1;
+      // The reduced cost of the tree arcs is zero.
+      potential_[child] = source_[arc] == child ? potential_[node] - cost_[arc]
+                                                : potential_[node] + cost_[arc];
+      node_stack_.push_back(child);
+    }
+  }
+}
+
+template <typename Graph>
+typename Graph::ArcIndex
+NetworkSimplexMinCostFlow<Graph>::FindEnteringArcByBlockSearch() {
+  const ArcIndex num_total_arcs = num_arcs_ + num_nodes_;
+  CostValue best_violation = 0;
+  ArcIndex best_arc = -1;
+  ArcIndex arc = next_arc_;
+  ArcIndex remaining_in_block = block_size_;
+  for (ArcIndex i = 0; i < num_total_arcs; ++i) {
+    const CostValue violation = state_[arc] * ReducedCost(arc);
+    if (violation < best_violation) {
+      best_violation = violation;
+      best_arc = arc;
+    }
+    if (++arc == num_total_arcs) arc = 0;
+    if (--remaining_in_block == 0) {
+      if (best_arc != -1) break;
+      remaining_in_block = block_size_;
+    }
+  }
+  next_arc_ = arc;
+  return best_arc;
+}
+
+template <typename Graph>
+typename Graph::ArcIndex
+NetworkSimplexMinCostFlow<Graph>::FindEnteringArcInCandidateList() {
+  // Minor iteration: the best candidate that is still eligible.
+  CostValue best_violation = 0;
+  ArcIndex best_arc = -1;
+  for (int i = 0; i < candidates_.size(); ++i) {
+    const ArcIndex arc = candidates_[i];
+    const CostValue violation = state_[arc] * ReducedCost(arc);
+    if (violation >= 0) {
+      candidates_[i] = candidates_.back();
+      candidates_.pop_back();
+      --i;
+    } else if (violation < best_violation) {
+      best_violation = violation;
+      best_arc = arc;
+    }
+  }
+  if (best_arc != -1) return best_arc;
+
+  // Major iteration: the best arc of each block, priced in parallel.
+  const ArcIndex num_total_arcs = num_arcs_ + num_nodes_;
+  const int64 num_blocks = (num_total_arcs + block_size_ - 1) / block_size_;
+  block_candidates_.assign(num_blocks, -1);
+  ParallelFor(num_threads_, num_blocks, [this, num_total_arcs](int64 block) {
+    const ArcIndex begin = block * block_size_;
+    const ArcIndex end = std::min<int64>(num_total_arcs, begin + block_size_);
+    CostValue best_violation = 0;
+    for (ArcIndex arc = begin; arc < end; ++arc) {
+      const CostValue violation = state_[arc] * ReducedCost(arc);
+      if (violation < best_violation) {
+        best_violation = violation;
+        block_candidates_[block] = arc;
+      }
+    }
+  });
+  candidates_.clear();
+  for (const ArcIndex arc : block_candidates_) {
+    if (arc == -1) continue;
+    candidates_.push_back(arc);
+    const CostValue violation = state_[arc] * ReducedCost(arc);
+    if (violation < best_violation) {
+      best_violation = violation;
+      best_arc = arc;
+    }
+  }
+  return best_arc;
+}
+
+template <typename Graph>
+void NetworkSimplexMinCostFlow<Graph>::Pivot(ArcIndex entering_arc) {
+  // The flow goes along the cycle from first to second through the entering
+  // arc, then back to first through the tree.
+  const bool increase = state_[entering_arc] == LOWER;
+  const NodeIndex first =
+      increase ? source_[entering_arc] : target_[entering_arc];
+  const NodeIndex second =
+      increase ? target_[entering_arc] : source_[entering_arc];
+  NodeIndex u = first;
+  NodeIndex v = second;
+  while (u != v) {
+    if (depth_[u] > depth_[v]) {
+      u = parent_[u];
+    } else if (depth_[v] > depth_[u]) {
+      v = parent_[v];
+    } else {
+      u = parent_[u];
+      v = parent_[v];
+    }
+  }
+  const NodeIndex join = u;
+
+  // The leaving arc is the last blocking arc of the cycle when starting from
+  // join, which keeps the tree strongly feasible. leaving_node is the node
+  // below the leaving arc, or kNilNode if it is the entering arc.
+  FlowQuantity delta = capacity_[entering_arc];
+  NodeIndex leaving_node = kNilNode;
+  bool leaving_on_first_path = false;
+  for (NodeIndex node = first; node != join; node = parent_[node]) {
+    const ArcIndex arc = pred_[node];
+    const FlowQuantity residual =
+        target_[arc] == node ? capacity_[arc] - flow_[arc] : flow_[arc];
+    if (residual < delta) {
+      delta = residual;
+      leaving_node = node;
+      leaving_on_first_path = true;
+    }
+  }
+  for (NodeIndex node = second; node != join; node = parent_[node]) {
+    const ArcIndex arc = pred_[node];
+    const FlowQuantity residual =
+        source_[arc] == node ? capacity_[arc] - flow_[arc] : flow_[arc];
+    if (residual <= delta) {
+      delta = residual;
+      leaving_node = node;
+      leaving_on_first_path = false;
+    }
+  }
+  DCHECK_LT(delta, kint64max);
+
+  if (delta > 0) {
+    flow_[entering_arc] += increase ? delta : -delta;
+    for (NodeIndex node = first; node != join; node = parent_[node]) {
+      const ArcIndex arc = pred_[node];
+      flow_[arc] += target_[arc] == node ? delta : -delta;
+    }
+    for (NodeIndex node = second; node != join; node = parent_[node]) {
+      const ArcIndex arc = pred_[node];
+      flow_[arc] += source_[arc] == node ? delta : -delta;
+    }
+  }
+  if (leaving_node == kNilNode) {
+    state_[entering_arc] = increase ? UPPER : LOWER;
+    return;
+  }
+
+  const ArcIndex leaving_arc = pred_[leaving_node];
+  state_[leaving_arc] = flow_[leaving_arc] == 0 ? LOWER : UPPER;
+  state_[entering_arc] = TREE;
+
+  // The subtree of leaving_node is now attached by the entering arc at its
+  // endpoint subtree_node. The tree path from subtree_node to leaving_node is
+  // reversed.
+  const NodeIndex subtree_node = leaving_on_first_path ? first : second;
+  const NodeIndex new_parent_of_subtree =
+      leaving_on_first_path ? second : first;
+  const CostValue reduced_cost = ReducedCost(entering_arc);
+  const CostValue potential_shift =
+      target_[entering_arc] == subtree_node ? reduced_cost : -reduced_cost;
+  NodeIndex node = subtree_node;
+  NodeIndex new_parent = new_parent_of_subtree;
+  ArcIndex new_pred = entering_arc;
+  while (true) {
+    const NodeIndex old_parent = parent_[node];
+    const ArcIndex old_pred = pred_[node];
+    RemoveChild(node);
+    AddChild(new_parent, node);
+    pred_[node] = new_pred;
+    if (node == leaving_node) break;
+    new_parent = node;
+    new_pred = old_pred;
+    node = old_parent;
+  }
+
+  // Updates the depths and the potentials of the moved subtree.
+  node_stack_.clear();
+  node_stack_.push_back(subtree_node);
+  while (!node_stack_.empty()) {
+    const NodeIndex node = node_stack_.back();
+    node_stack_.pop_back();
+    depth_[node] = depth_[parent_[node]] + 1;
+    potential_[node] += potential_shift;
+    for (NodeIndex child = first_child_[node]; child != kNilNode;
+         child = next_sibling_[child]) {
+      node_stack_.push_back(child);
+    }
+  }
+}
+
+template <typename Graph>
+typename NetworkSimplexMinCostFlow<Graph>::Status
+NetworkSimplexMinCostFlow<Graph>::Solve() {
+  num_pivots_ = 0;
+  optimal_cost_ = 0;
+  FlowQuantity total_supply = 0;
+  for (NodeIndex node = 0; node < num_nodes_; ++node) {
+    total_supply += supply_[node];
+  }
+  if (total_supply != 0) {
+    status_ = UNBALANCED;
+    return status_;
+  }
+
+  // The cost of the artificial arcs must be larger than the cost of any path.
+  // The potentials are then bounded in magnitude by twice this cost, and the
+  // reduced costs by four times.
+  CostValue max_cost = 0;
+  for (ArcIndex arc = 0; arc < num_arcs_; ++arc) {
+    max_cost = std::max(max_cost, std::abs(cost_[arc]));
+  }
+  if (max_cost >= kint64max / (8 * (static_cast<int64>(num_nodes_) + 1))) {
+    status_ = BAD_COST_RANGE;
+    return status_;
+  }
+  const CostValue artificial_cost =
+      (static_cast<int64>(num_nodes_) + 1) * max_cost + 1;
+  for (NodeIndex node = 0; node < num_nodes_; ++node) {
+    cost_[ArtificialArc(node)] = artificial_cost;
+  }
+
+  if (!has_tree_) InitializeStarTree();
+  RepairTree();
+  const ArcIndex num_total_arcs = num_arcs_ + num_nodes_;
+  block_size_ = std::max<ArcIndex>(
+      kMinBlockSize, static_cast<ArcIndex>(std::sqrt(num_total_arcs)));
+  candidates_.clear();
+  while (true) {
+    const ArcIndex entering_arc = num_threads_ > 1
+                                      ? FindEnteringArcInCandidateList()
+                                      : FindEnteringArcByBlockSearch();
+    if (entering_arc == -1) break;
+    Pivot(entering_arc);
+    ++num_pivots_;
+  }
+
+  for (NodeIndex node = 0; node < num_nodes_; ++node) {
+    if (flow_[ArtificialArc(node)] > 0) {
+      status_ = INFEASIBLE;
+      return status_;
+    }
+  }
+  for (ArcIndex arc = 0; arc < num_arcs_; ++arc) {
+    optimal_cost_ += cost_[arc] * flow_[arc];
+  }
+  status_ = OPTIMAL;
+  return status_;
+}
+
+// Explicit instantiations that can be used by a client.
+template class NetworkSimplexMinCostFlow<ListGraph<> >;
+template class NetworkSimplexMinCostFlow<StaticGraph<> >;
+template class NetworkSimplexMinCostFlow<ReverseArcListGraph<> >;
+template class NetworkSimplexMinCostFlow<ReverseArcStaticGraph<> >;
+template class NetworkSimplexMinCostFlow<ReverseArcMixedGraph<> >;
+
+}  // namespace operations_research
@@ -0,0 +1,221 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// A primal network simplex algorithm for the min-cost flow problem, as an
+// alternative to the cost-scaling algorithm of min_cost_flow.h. It is usually
+// faster on small and dense networks such as transportation problems, and it
+// naturally warm-starts from the previous solution after some changes of the
+// supplies, costs or capacities.
+//
+// The basis is a spanning tree of the network extended with an artificial
+// root node, linked to each node by an artificial arc whose cost is larger
+// than the cost of any path. Each pivot makes a non-tree arc with a negative
+// reduced cost enter the tree, pushes as much flow as possible along the cycle
+// that it closes, and removes a saturated arc of this cycle from the tree.
+// The tree is kept strongly feasible (every node can send some flow to the
+// root along the tree), which prevents cycling.
+//
+// The entering arc is chosen by block search pricing: the arcs are scanned
+// cyclically by blocks of about sqrt(num_arcs) arcs, and the arc with the most
+// negative reduced cost of the first block containing one enters the tree.
+// With several threads, the blocks are priced in parallel into a candidate
+// list, and the best candidate enters the tree until the list is exhausted.
+//
+// See for instance:
+// R.K. Ahuja, T.L. Magnanti, J.B. Orlin, "Network Flows: Theory, Algorithms,
+// and Applications", Prentice Hall, 1993, chapter 11.
+// Z. Kiraly, P. Kovacs, "Efficient implementations of minimum-cost flow
+// algorithms", Acta Universitatis Sapientiae, Informatica 4(1):67-118, 2012.
+//
+// Example:
+//   StaticGraph<> graph(num_nodes, num_arcs);
+//   ... add the arcs and call graph.Build() ...
+//   NetworkSimplexMinCostFlow<StaticGraph<>> min_cost_flow(&graph);
+//   ... call SetArcCapacity(), SetArcUnitCost() and SetNodeSupply() ...
+//   if (min_cost_flow.Solve() == NetworkSimplexMinCostFlow<>::OPTIMAL) {
+//     ... use min_cost_flow.OptimalCost() and min_cost_flow.Flow(arc) ...
+//   }
+
+#ifndef OR_TOOLS_GRAPH_NETWORK_SIMPLEX_H_
+#define OR_TOOLS_GRAPH_NETWORK_SIMPLEX_H_
+
+#include <vector>
+
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "base/macros.h"
+#include "graph/ebert_graph.h"
+#include "graph/graph.h"
+#include "graph/min_cost_flow.h"
+
+namespace operations_research {
+
+// The interface is the same as the one of SimpleMinCostFlow, except that the
+// graph is given at construction. It works with all the graphs of graph.h,
+// see the end of network_simplex.cc for the exact types this class is
+// compiled for. Only the direct arcs of the graph are used.
+template <typename Graph = StaticGraph<> >
+class NetworkSimplexMinCostFlow : public MinCostFlowBase {
+ public:
+  typedef typename Graph::NodeIndex NodeIndex;
+  typedef typename Graph::ArcIndex ArcIndex;
+
+  // The graph must be fully built, and must not change afterwards. All the
+  // supplies, capacities and unit costs are initially zero.
+  explicit NetworkSimplexMinCostFlow(const Graph* graph);
+
+  // Sets the supply of the given node. A demand is modeled as a negative
+  // supply.
+  void SetNodeSupply(NodeIndex node, FlowQuantity supply);
+
+  // Sets the capacity and the unit cost of the given arc. The capacity must be
+  // non-negative, and the unit cost can be any integer.
+  void SetArcCapacity(ArcIndex arc, FlowQuantity capacity);
+  void SetArcUnitCost(ArcIndex arc, CostValue unit_cost);
+
+  // Sets the number of threads used to price the arcs, 1 by default. With
+  // more than one thread, the pricing uses the parallel candidate list
+  // described above. The result is then the same for any number of threads.
+  void SetNumThreads(int num_threads) { num_threads_ = num_threads; }
+
+  // Solves the problem, and returns its status:
+  // - OPTIMAL if an optimal flow was found.
+  // - UNBALANCED if the sum of the supplies is not zero.
+  // - INFEASIBLE if the supplies cannot be sent to the demands.
+  // - BAD_COST_RANGE if the costs are too large for the artificial arcs,
+  //   whose cost is about (num_nodes + 1) * (largest unit cost).
+  //
+  // After the first call, Solve() starts from the last spanning tree. The
+  // flow on the tree arcs is recomputed for the new supplies and capacities,
+  // and the tree arcs whose flow becomes infeasible are replaced by
+  // artificial arcs, so a few pivots are usually enough after small changes.
+  Status Solve();
+
+  // Returns the status of the last call to Solve().
+  Status status() const { return status_; }
+
+  // Returns the cost of the flow found by the last Solve().
+  CostValue OptimalCost() const { return optimal_cost_; }
+
+  // Returns the flow on the given arc.
+  FlowQuantity Flow(ArcIndex arc) const { return flow_[arc]; }
+
+  // Returns the node potentials of the optimal solution, i.e. the optimal
+  // dual values: the reduced cost unit_cost + Potential(tail) - Potential(head)
+  // is >= 0 on the arcs without flow, <= 0 on the saturated arcs, and 0 on the
+  // other arcs.
+  CostValue Potential(NodeIndex node) const { return potential_[node]; }
+
+  // Accessors for the user given data.
+  NodeIndex NumNodes() const { return num_nodes_; }
+  ArcIndex NumArcs() const { return num_arcs_; }
+  FlowQuantity Capacity(ArcIndex arc) const { return capacity_[arc]; }
+  CostValue UnitCost(ArcIndex arc) const { return cost_[arc]; }
+  FlowQuantity Supply(NodeIndex node) const { return supply_[node]; }
+
+  // The number of pivots of the last Solve().
+  int64 num_pivots() const { return num_pivots_; }
+
+ private:
+  // The state of an arc: in the tree, or not in the tree with a flow equal to
+  // its upper (capacity) or lower (zero) bound. A non-tree arc can enter the
+  // tree if state * ReducedCost(arc) < 0.
+  enum ArcState { UPPER = -1, TREE = 0, LOWER = 1 };
+
+  static const NodeIndex kNilNode;
+
+  // The artificial arc of the given node, between the node and the root.
+  ArcIndex ArtificialArc(NodeIndex node) const { return num_arcs_ + node; }
+
+  CostValue ReducedCost(ArcIndex arc) const {
+    return cost_[arc] + potential_[source_[arc]] - potential_[target_[arc]];
+  }
+
+  // Makes the tree the star of the artificial arcs, with no flow on the other
+  // arcs.
+  void InitializeStarTree();
+
+  // Recomputes the flow of the tree arcs from the supplies and the flow of the
+  // non-tree arcs. A tree arc whose flow is not strongly feasible is removed
+  // from the tree at its nearest bound, and its subtree is attached to the
+  // root with the artificial arc of its root node.
+  void RepairTree();
+
+  // Recomputes the depths and the potentials of all the nodes from the tree.
+  void ComputeDepthsAndPotentials();
+
+  // Returns the arc entering the tree, or -1 if the solution is optimal.
+  ArcIndex FindEnteringArcByBlockSearch();
+  ArcIndex FindEnteringArcInCandidateList();
+
+  // Performs the pivot of the given entering arc.
+  void Pivot(ArcIndex entering_arc);
+
+  // Maintains the list of the children of each node.
+  void AddChild(NodeIndex parent, NodeIndex node);
+  void RemoveChild(NodeIndex node);
+
+  const Graph* graph_;
+  const NodeIndex num_nodes_;
+  const ArcIndex num_arcs_;
+  // The index of the artificial root node.
+  const NodeIndex root_;
+
+  // The supplies, then for each arc its capacity and unit cost as given by
+  // the user. The artificial arcs at the end have an infinite capacity and a
+  // cost computed by Solve().
+  std::vector<FlowQuantity> supply_;
+  std::vector<FlowQuantity> capacity_;
+  std::vector<CostValue> cost_;
+
+  // The arcs of the extended network: the arcs of the graph followed by the
+  // artificial arcs, whose orientation can change between two Solve().
+  std::vector<NodeIndex> source_;
+  std::vector<NodeIndex> target_;
+  std::vector<FlowQuantity> flow_;
+  std::vector<int8> state_;
+
+  // The spanning tree of the extended network, rooted at root_. pred_[node] is
+  // the tree arc between node and parent_[node]. The children of a node are in
+  // a doubly linked list.
+  std::vector<NodeIndex> parent_;
+  std::vector<ArcIndex> pred_;
+  std::vector<NodeIndex> depth_;
+  std::vector<NodeIndex> first_child_;
+  std::vector<NodeIndex> next_sibling_;
+  std::vector<NodeIndex> previous_sibling_;
+  std::vector<CostValue> potential_;
+  bool has_tree_;
+
+  // The pricing data: the arcs are scanned from next_arc_ by blocks of
+  // block_size_ arcs. candidates_ is the current candidate list and
+  // block_candidates_ contains the best arc of each block (or -1).
+  ArcIndex block_size_;
+  ArcIndex next_arc_;
+  std::vector<ArcIndex> candidates_;
+  std::vector<ArcIndex> block_candidates_;
+  int num_threads_;
+
+  // Workspaces.
+  std::vector<NodeIndex> node_stack_;
+  std::vector<FlowQuantity> node_balance_;
+
+  Status status_;
+  CostValue optimal_cost_;
+  int64 num_pivots_;
+
+  DISALLOW_COPY_AND_ASSIGN(NetworkSimplexMinCostFlow);
+};
+
+}  // namespace operations_research
+#endif  // OR_TOOLS_GRAPH_NETWORK_SIMPLEX_H_
@@ -14,18 +14,35 @@
 
 // This file contains various shortest paths utilities.
 //
+// The callback-based functions DijkstraShortestPath() and
+// BellmanFordShortestPath() work on an implicit complete graph, so each search
+// calls the callback O(node_count^2) times. For sparse graphs, use instead the
+// DijkstraShortestPathSearch and ComputeManyToManyShortestPathDistances() below
+// which work on the graphs of graph/graph.h with arc lengths stored in a
+// vector. For point-to-point queries on graphs with reverse arcs,
+// PointToPointShortestPathSearch runs bidirectional or A* searches, the
+// latter guided by the landmark bounds of ShortestPathLandmarks.
+//
 // Keywords: directed graph, cheapest path, shortest path, Dijkstra, spp.
 
 #ifndef OR_TOOLS_GRAPH_SHORTESTPATHS_H_
 #define OR_TOOLS_GRAPH_SHORTESTPATHS_H_
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
 #include <memory>
 #include <string>
+#include <thread>  // NOLINT
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "base/callback.h"
 #include "base/integral_types.h"
+#include "base/logging.h"
 #include "base/macros.h"
+#include "graph/graph.h"
 
 namespace operations_research {
 
@@ -50,6 +67,895 @@ bool DijkstraShortestPath(int node_count, int start_node, int end_node,
 bool BellmanFordShortestPath(int node_count, int start_node, int end_node,
                              ResultCallback2<int64, int, int>* const graph,
                              int64 disconnected_distance, std::vector<int>* nodes);
+
+// A 4-ary min-heap of the nodes in [0, num_nodes) keyed by a distance, with
+// the position of each node in the heap to support decreasing a key. Compared
+// to a binary heap, the tree is half as deep and the children of a node are
+// contiguous in memory, which makes Dijkstra's algorithm faster.
+template <typename NodeIndex, typename KeyType>
+class FourAryNodeHeap {
+ public:
+  FourAryNodeHeap() {}
+
+  // Empties the heap and makes it accept the nodes in [0, num_nodes).
+  void Reset(NodeIndex num_nodes) {
+    heap_.clear();
+    position_.assign(num_nodes, kNotInHeap);
+  }
+
+  // Empties the heap in O(size()).
+  void Clear() {
+    for (const Entry& entry : heap_) position_[entry.node] = kNotInHeap;
+    heap_.clear();
+  }
+
+  bool IsEmpty() const { return heap_.empty(); }
+  int size() const { return heap_.size(); }
+  bool Contains(NodeIndex node) const {
+    return position_[node] != kNotInHeap;
+  }
+
+  // Returns the node with the smallest key and its key. The heap must not be
+  // empty.
+  NodeIndex TopNode() const { return heap_[0].node; }
+  KeyType TopKey() const { return heap_[0].key; }
+
+  // Inserts the node with the given key if it is not in the heap, otherwise
+  // decreases its key to the given one. In the latter case, the key must not
+  // be greater than the current one.
+  void InsertOrDecrease(NodeIndex node, KeyType key);
+
+  // Removes the top node.
+  void Pop();
+
+ private:
+  struct Entry {
+    KeyType key;
+    NodeIndex node;
+  };
+  static const int kArity = 4;
+  static const int kNotInHeap = -1;
+
+  // Moves the entry up (resp. down) from the given position in the heap until
+  // the heap property is restored.
+  void SiftUp(int position, Entry entry);
+  void SiftDown(int position, Entry entry);
+
+  std::vector<Entry> heap_;
+  std::vector<int> position_;
+
+  DISALLOW_COPY_AND_ASSIGN(FourAryNodeHeap);
+};
+
+// Dijkstra's algorithm on one of the graphs of graph/graph.h (usually a
+// StaticGraph or a ReverseArcStaticGraph), with the non-negative arc lengths
+// given in a vector indexed by arc. The sum of the lengths of any path must
+// be smaller than UnreachableDistance().
+//
+// An instance is a reusable workspace: a search only resets the nodes reached
+// by the previous one, so its cost only depends on the explored part of the
+// graph. The graph and the lengths are only read, so several instances (for
+// instance one per thread) can share them.
+//
+// If kReverse is true, the arcs are followed backwards using the IncomingArcs()
+// of the graphs with reverse arcs, so the search computes the distances from
+// all the nodes to the source.
+//
+// Example:
+//   typedef StaticGraph<> Graph;
+//   DijkstraShortestPathSearch<Graph> search(graph, arc_lengths);
+//   search.RunToTargets(source, targets);
+//   for (const Graph::NodeIndex target : targets) {
+//     LOG(INFO) << search.Distance(target);
+//   }
+template <typename GraphType, typename DistanceType = int64,
+          bool kReverse = false>
+class DijkstraShortestPathSearch {
+ public:
+  typedef typename GraphType::NodeIndex NodeIndex;
+  typedef typename GraphType::ArcIndex ArcIndex;
+
+  DijkstraShortestPathSearch(const GraphType& graph,
+                             const std::vector<DistanceType>& arc_lengths);
+
+  // The distance of the nodes that are not reached by the last search.
+  static DistanceType UnreachableDistance() {
+    return std::numeric_limits<DistanceType>::max();
+  }
+
+  // Computes the distance from the source to all the nodes of the graph.
+  void Run(NodeIndex source) { RunToTargets(source, std::vector<NodeIndex>()); }
+
+  // Same as Run(), but stops as soon as the distances to all the given targets
+  // are known. If targets is empty, all the nodes are explored.
+  void RunToTargets(NodeIndex source, const std::vector<NodeIndex>& targets);
+
+  // Returns true if the distance of the node is known after the last search:
+  // its returned Distance() and path are then the shortest ones. This is false
+  // for the nodes that are not reachable from the source, but also for the
+  // ones that were not explored because the targets were all reached first.
+  bool IsSettled(NodeIndex node) const { return is_settled_[node]; }
+
+  // Returns the shortest distance from the source to the node, or
+  // UnreachableDistance() if the node is not settled.
+  DistanceType Distance(NodeIndex node) const {
+    return is_settled_[node] ? distance_[node] : UnreachableDistance();
+  }
+
+  // Returns the last arc of the shortest path to the node, or
+  // GraphType::kNilArc for the source and the nodes that are not settled. For
+  // a reverse search, this is the (forward) arc leaving the node on its
+  // shortest path to the source.
+  ArcIndex PredecessorArc(NodeIndex node) const {
+    return is_settled_[node] ? predecessor_arc_[node] : GraphType::kNilArc;
+  }
+
+  // Fills nodes with the shortest path from the source to the node, or from
+  // the node to the source for a reverse search. Returns false if the node is
+  // not settled.
+  bool GetPath(NodeIndex node, std::vector<NodeIndex>* nodes) const;
+
+  // The settled nodes of the last search, by non-decreasing distance.
+  const std::vector<NodeIndex>& settled_nodes() const { return settled_nodes_; }
+
+ private:
+  // Updates the distances of the neighbors of the node that was just settled.
+  // The two versions follow the arcs respectively forwards and backwards.
+  void RelaxArcsOf(NodeIndex node, DistanceType distance,
+                   std::false_type forward);
+  void RelaxArcsOf(NodeIndex node, DistanceType distance,
+                   std::true_type reverse);
+  void Relax(ArcIndex arc, NodeIndex from, NodeIndex to,
+             DistanceType distance) {
+    if (is_settled_[to]) return;
+    DCHECK_GE(arc_lengths_[arc], 0);
+    const DistanceType new_distance = distance + arc_lengths_[arc];
+    if (new_distance < distance_[to]) {
+      if (distance_[to] == UnreachableDistance()) reached_nodes_.push_back(to);
+      distance_[to] = new_distance;
+      predecessor_arc_[to] = arc;
+      predecessor_node_[to] = from;
+      heap_.InsertOrDecrease(to, new_distance);
+    }
+  }
+
+  const GraphType& graph_;
+  const std::vector<DistanceType>& arc_lengths_;
+
+  // Tentative distances and predecessors. Only the reached_nodes_ can have a
+  // finite distance and are reset by the next search.
+  std::vector<DistanceType> distance_;
+  std::vector<ArcIndex> predecessor_arc_;
+  std::vector<NodeIndex> predecessor_node_;
+  std::vector<bool> is_settled_;
+  std::vector<bool> is_target_;
+  std::vector<NodeIndex> reached_nodes_;
+  std::vector<NodeIndex> settled_nodes_;
+  FourAryNodeHeap<NodeIndex, DistanceType> heap_;
+
+  DISALLOW_COPY_AND_ASSIGN(DijkstraShortestPathSearch);
+};
+
+// Computes the shortest distances from each of the sources to each of the
+// targets: (*distances)[i * targets.size() + j] is the distance from
+// sources[i] to targets[j], or UnreachableDistance() of the corresponding
+// DijkstraShortestPathSearch if there is no path. Each search stops as soon as
+// all the targets are reached. The sources are dynamically dispatched to
+// num_threads threads, each with its own DijkstraShortestPathSearch, and the
+// result does not depend on the number of threads.
+//
+// When there are many more sources than targets, it is usually faster to call
+// this on a ReverseArcStaticGraph with kReverse set to true and the sources
+// and targets swapped: the result is then the transposed matrix.
+template <typename GraphType, typename DistanceType, bool kReverse>
+void ComputeManyToManyShortestPathDistances(
+    const GraphType& graph, const std::vector<DistanceType>& arc_lengths,
+    const std::vector<typename GraphType::NodeIndex>& sources,
+    const std::vector<typename GraphType::NodeIndex>& targets, int num_threads,
+    std::vector<DistanceType>* distances);
+
+// Same as above for a forward search.
+template <typename GraphType, typename DistanceType>
+void ComputeManyToManyShortestPathDistances(
+    const GraphType& graph, const std::vector<DistanceType>& arc_lengths,
+    const std::vector<typename GraphType::NodeIndex>& sources,
+    const std::vector<typename GraphType::NodeIndex>& targets, int num_threads,
+    std::vector<DistanceType>* distances) {
+  ComputeManyToManyShortestPathDistances<GraphType, DistanceType, false>(
+      graph, arc_lengths, sources, targets, num_threads, distances);
+}
+
+// A* lower bounds on the distances between the nodes of a graph with reverse
+// arcs (e.g. a ReverseArcStaticGraph), from the distances from and to a few
+// landmark nodes (the ALT algorithm). By the triangle inequality, for any
+// landmark L, d(u, v) >= d(L, v) - d(L, u) and d(u, v) >= d(u, L) - d(v, L).
+// See A.V. Goldberg, C. Harrelson, "Computing the shortest path: A* search
+// meets graph theory", SODA 2005.
+//
+// The landmarks are best chosen on the border of the graph, for instance with
+// SelectFarthestLandmarks(). The bounds take 2 * num_landmarks() distances per
+// node and are shared read-only by the searches.
+template <typename GraphType, typename DistanceType = int64>
+class ShortestPathLandmarks {
+ public:
+  typedef typename GraphType::NodeIndex NodeIndex;
+  typedef DijkstraShortestPathSearch<GraphType, DistanceType> Search;
+
+  // Computes the distances from and to the given landmarks. The 2 *
+  // landmarks.size() searches are dispatched to num_threads threads.
+  ShortestPathLandmarks(const GraphType& graph,
+                        const std::vector<DistanceType>& arc_lengths,
+                        const std::vector<NodeIndex>& landmarks,
+                        int num_threads);
+
+  // Chooses num_landmarks landmarks (or all the nodes if there are fewer) with
+  // the farthest-first heuristic: the first one is the node farthest from
+  // first_node, and each next one maximizes its smallest distance from the
+  // landmarks already chosen. This runs num_landmarks + 1 searches in
+  // sequence.
+  static std::vector<NodeIndex> SelectFarthestLandmarks(
+      const GraphType& graph, const std::vector<DistanceType>& arc_lengths,
+      int num_landmarks, NodeIndex first_node);
+
+  int num_landmarks() const { return landmarks_.size(); }
+  const std::vector<NodeIndex>& landmarks() const { return landmarks_; }
+
+  // Returns a lower bound of the distance from the node to the target, or
+  // Search::UnreachableDistance() if the distances of the landmarks prove that
+  // there is no path. For a fixed target, this is a consistent A* potential.
+  DistanceType LowerBound(NodeIndex node, NodeIndex target) const;
+
+ private:
+  const std::vector<NodeIndex> landmarks_;
+  // The distance from (resp. to) the l-th landmark to (resp. from) the node n
+  // is at index n * num_landmarks() + l, so the bounds of a node are
+  // contiguous.
+  std::vector<DistanceType> from_landmark_;
+  std::vector<DistanceType> to_landmark_;
+
+  DISALLOW_COPY_AND_ASSIGN(ShortestPathLandmarks);
+};
+
+// Point-to-point shortest path queries on a graph with reverse arcs (e.g. a
+// ReverseArcStaticGraph) with non-negative arc lengths, either with a
+// bidirectional Dijkstra or with an A* search guided by ShortestPathLandmarks.
+// On road-like graphs, the former settles about half the nodes of a one-way
+// search, and the latter usually much less.
+//
+// An instance is a reusable workspace for one thread. Its per-node arrays are
+// tagged with the number of the query that last wrote them, so a query does
+// not even have to reset the nodes of the previous one.
+//
+// Example:
+//   typedef ReverseArcStaticGraph<> Graph;
+//   ShortestPathLandmarks<Graph> landmarks(
+//       graph, arc_lengths,
+//       ShortestPathLandmarks<Graph>::SelectFarthestLandmarks(
+//           graph, arc_lengths, 16, 0),
+//       num_threads);
+//   PointToPointShortestPathSearch<Graph> search(graph, arc_lengths);
+//   const int64 distance = search.AStarDistance(source, target, landmarks);
+//   std::vector<int> path;
+//   if (search.GetPath(&path)) ...
+template <typename GraphType, typename DistanceType = int64>
+class PointToPointShortestPathSearch {
+ public:
+  typedef typename GraphType::NodeIndex NodeIndex;
+  typedef typename GraphType::ArcIndex ArcIndex;
+
+  PointToPointShortestPathSearch(const GraphType& graph,
+                                 const std::vector<DistanceType>& arc_lengths);
+
+  static DistanceType UnreachableDistance() {
+    return std::numeric_limits<DistanceType>::max();
+  }
+
+  // Returns the shortest distance from the source to the target, or
+  // UnreachableDistance() if there is no path. The first one grows a forward
+  // search from the source and a backward one from the target, always
+  // extending the one with the smallest distance, until they meet.
+  DistanceType BidirectionalDistance(NodeIndex source, NodeIndex target);
+  DistanceType AStarDistance(
+      NodeIndex source, NodeIndex target,
+      const ShortestPathLandmarks<GraphType, DistanceType>& landmarks);
+
+  // Fills nodes with the shortest path of the last query, from its source to
+  // its target. Returns false if there is none.
+  bool GetPath(std::vector<NodeIndex>* nodes) const;
+
+  // The number of nodes settled by the last query, in both directions.
+  int64 num_settled_nodes() const { return num_settled_nodes_; }
+
+ private:
+  // The forward and backward searches.
+  enum { kForward = 0, kBackward = 1 };
+
+  // Starts a new query: increments the stamp_ and empties the heaps.
+  void StartQuery(NodeIndex source, NodeIndex target);
+
+  // The mark_ of a node is stamp_ once it is reached, stamp_ + 1 once it is
+  // settled, and anything smaller for the nodes untouched by this query.
+  bool IsReached(int direction, NodeIndex node) const {
+    return mark_[direction][node] >= stamp_;
+  }
+  bool IsSettled(int direction, NodeIndex node) const {
+    return mark_[direction][node] == stamp_ + 1;
+  }
+  void Reach(int direction, NodeIndex node, DistanceType distance,
+             NodeIndex parent) {
+    mark_[direction][node] = stamp_;
+    distance_[direction][node] = distance;
+    parent_[direction][node] = parent;
+  }
+
+  // Relaxes the arcs of the node just settled by the search in the given
+  // direction, and updates the best path meeting the other search.
+  void RelaxBidirectional(int direction, NodeIndex node, DistanceType distance,
+                          DistanceType* best_distance);
+  void RelaxBidirectionalArc(int direction, NodeIndex node, NodeIndex head,
+                             DistanceType new_distance,
+                             DistanceType* best_distance);
+
+  const GraphType& graph_;
+  const std::vector<DistanceType>& arc_lengths_;
+
+  uint32 stamp_;
+  std::vector<uint32> mark_[2];
+  std::vector<DistanceType> distance_[2];
+  // The previous node on the path from the source for the forward search, and
+  // the next one on the path to the target for the backward search.
+  std::vector<NodeIndex> parent_[2];
+  // The A* potential of the reached nodes.
+  std::vector<DistanceType> potential_;
+  FourAryNodeHeap<NodeIndex, DistanceType> heap_[2];
+
+  // The last query, and the node where its shortest path goes from the forward
+  // search to the backward one, or GraphType::kNilNode if there is no path.
+  NodeIndex source_;
+  NodeIndex target_;
+  NodeIndex meeting_node_;
+  int64 num_settled_nodes_;
+
+  DISALLOW_COPY_AND_ASSIGN(PointToPointShortestPathSearch);
+};
+
+// Computes the shortest distances of the given (source, target) queries:
+// (*distances)[i] is the distance from queries[i].first to queries[i].second,
+// or UnreachableDistance() if there is no path. The queries are dynamically
+// dispatched to num_threads threads, each with its own
+// PointToPointShortestPathSearch, which runs A* searches if landmarks is not
+// null and bidirectional Dijkstras otherwise.
+template <typename GraphType, typename DistanceType>
+void ComputePointToPointShortestPathDistances(
+    const GraphType& graph, const std::vector<DistanceType>& arc_lengths,
+    const ShortestPathLandmarks<GraphType, DistanceType>* landmarks,
+    const std::vector<std::pair<typename GraphType::NodeIndex,
+                                typename GraphType::NodeIndex> >& queries,
+    int num_threads, std::vector<DistanceType>* distances);
+
+// Implementation of the templates.
+
+template <typename NodeIndex, typename KeyType>
+const int FourAryNodeHeap<NodeIndex, KeyType>::kArity;
+
+template <typename NodeIndex, typename KeyType>
+const int FourAryNodeHeap<NodeIndex, KeyType>::kNotInHeap;
+
+template <typename NodeIndex, typename KeyType>
+void FourAryNodeHeap<NodeIndex, KeyType>::InsertOrDecrease(NodeIndex node,
+                                                           KeyType key) {
+  int position = position_[node];
+  if (position == kNotInHeap) {
+    position = heap_.size();
+    heap_.push_back(Entry());
+  } else {
+    DCHECK_LE(key, heap_[position].key);
+  }
+  Entry entry;
+  entry.key = key;
+  entry.node = node;
+  SiftUp(position, entry);
+}
+
+template <typename NodeIndex, typename KeyType>
+void FourAryNodeHeap<NodeIndex, KeyType>::Pop() {
+  DCHECK(!IsEmpty());
+  position_[heap_[0].node] = kNotInHeap;
+  const Entry last = heap_.back();
+  heap_.pop_back();
+  if (!heap_.empty()) SiftDown(0, last);
+}
+
+template <typename NodeIndex, typename KeyType>
+void FourAryNodeHeap<NodeIndex, KeyType>::SiftUp(int position, Entry entry) {
+  while (position > 0) {
+    const int parent = (position - 1) / kArity;
+    if (!(entry.key < heap_[parent].key)) break;
+    heap_[position] = heap_[parent];
+    position_[heap_[position].node] = position;
+    position = parent;
+  }
+  heap_[position] = entry;
+  position_[entry.node] = position;
+}
+
+template <typename NodeIndex, typename KeyType>
+void FourAryNodeHeap<NodeIndex, KeyType>::SiftDown(int position, Entry entry) {
+  const int size = heap_.size();
+  while (true) {
+    const int first_child = kArity * position + 1;
+    if (first_child >= size) break;
+    const int last_child =
+        first_child + kArity < size ? first_child + kArity : size;
+    int best_child = first_child;
+    for (int child = first_child + 1; child < last_child; ++child) {
+      if (heap_[child].key < heap_[best_child].key) best_child = child;
+    }
+    if (!(heap_[best_child].key < entry.key)) break;
+    heap_[position] = heap_[best_child];
+    position_[heap_[position].node] = position;
+    position = best_child;
+  }
+  heap_[position] = entry;
+  position_[entry.node] = position;
+}
+
+template <typename GraphType, typename DistanceType, bool kReverse>
+DijkstraShortestPathSearch<GraphType, DistanceType, kReverse>::
+    DijkstraShortestPathSearch(const GraphType& graph,
+                               const std::vector<DistanceType>& arc_lengths)
+    : graph_(graph), arc_lengths_(arc_lengths) {
+  const NodeIndex num_nodes = graph.num_nodes();
+  CHECK_GE(arc_lengths.size(), graph.num_arcs());
+  distance_.assign(num_nodes, UnreachableDistance());
+  predecessor_arc_.assign(num_nodes, GraphType::kNilArc);
+  predecessor_node_.assign(num_nodes, GraphType::kNilNode);
+  is_settled_.assign(num_nodes, false);
+  is_target_.assign(num_nodes, false);
+  heap_.Reset(num_nodes);
+}
+
+template <typename GraphType, typename DistanceType, bool kReverse>
+void DijkstraShortestPathSearch<GraphType, DistanceType, kReverse>::
+    RunToTargets(NodeIndex source, const std::vector<NodeIndex>& targets) {
+  DCHECK(graph_.IsNodeValid(source));
+  for (const NodeIndex node : reached_nodes_) {
+    distance_[node] = UnreachableDistance();
+    predecessor_arc_[node] = GraphType::kNilArc;
+    predecessor_node_[node] = GraphType::kNilNode;
+    is_settled_[node] = false;
+  }
+  reached_nodes_.clear();
+  settled_nodes_.clear();
+  heap_.Clear();
+
+  // Note that duplicate targets are only counted once.
+  int num_targets_left = 0;
+  for (const NodeIndex target : targets) {
+    DCHECK(graph_.IsNodeValid(target));
+    if (!is_target_[target]) {
+      is_target_[target] = true;
+      ++num_targets_left;
+    }
+  }
+  const bool stop_at_targets = num_targets_left > 0;
+
+  reached_nodes_.push_back(source);
+  distance_[source] = 0;
+  heap_.InsertOrDecrease(source, 0);
+  while (!heap_.IsEmpty()) {
+    const NodeIndex node = heap_.TopNode();
+    const DistanceType distance = heap_.TopKey();
+    heap_.Pop();
+    is_settled_[node] = true;
+    settled_nodes_.push_back(node);
+    if (is_target_[node] && --num_targets_left == 0 && stop_at_targets) break;
+    RelaxArcsOf(node, distance, std::integral_constant<bool, kReverse>());
+  }
+  for (const NodeIndex target : targets) is_target_[target] = false;
+}
+
+template <typename GraphType, typename DistanceType, bool kReverse>
+void DijkstraShortestPathSearch<GraphType, DistanceType, kReverse>::RelaxArcsOf(
+    NodeIndex node, DistanceType distance, std::false_type forward) {
+  for (const ArcIndex arc : graph_.OutgoingArcs(node)) {
+    Relax(arc, node, graph_.Head(arc), distance);
+  }
+}
+
+template <typename GraphType, typename DistanceType, bool kReverse>
+void DijkstraShortestPathSearch<GraphType, DistanceType, kReverse>::RelaxArcsOf(
+    NodeIndex node, DistanceType distance, std::true_type reverse) {
+  // The incoming arcs are the reverse arcs leaving the node, their head is the
+  // tail of the corresponding forward arc.
+  for (const ArcIndex arc : graph_.IncomingArcs(node)) {
+    Relax(graph_.OppositeArc(arc), node, graph_.Head(arc), distance);
+  }
+}
+
+template <typename GraphType, typename DistanceType, bool kReverse>
+bool DijkstraShortestPathSearch<GraphType, DistanceType, kReverse>::GetPath(
+    NodeIndex node, std::vector<NodeIndex>* nodes) const {
+  nodes->clear();
+  if (!is_settled_[node]) return false;
+  for (NodeIndex n = node; n != GraphType::kNilNode;
+       n = predecessor_node_[n]) {
+    nodes->push_back(n);
+  }
+  if (!kReverse) std::reverse(nodes->begin(), nodes->end());
+  return true;
+}
+
+template <typename GraphType, typename DistanceType, bool kReverse>
+void ComputeManyToManyShortestPathDistances(
+    const GraphType& graph, const std::vector<DistanceType>& arc_lengths,
+    const std::vector<typename GraphType::NodeIndex>& sources,
+    const std::vector<typename GraphType::NodeIndex>& targets, int num_threads,
+    std::vector<DistanceType>* distances) {
+  typedef DijkstraShortestPathSearch<GraphType, DistanceType, kReverse> Search;
+  CHECK(distances != nullptr);
+  const int num_sources = sources.size();
+  const int num_targets = targets.size();
+  distances->assign(static_cast<size_t>(num_sources) * num_targets,
+                    Search::UnreachableDistance());
+  if (num_sources == 0 || num_targets == 0) return;
+
+  // Each thread takes the next source not yet processed. Since each source
+  // row is computed by one search from scratch, the result is the same
+  // regardless of the assignment of the sources to the threads.
+  std::atomic<int> next_source(0);
+  auto worker = [&]() {
+    Search search(graph, arc_lengths);
+    for (int i = next_source++; i < num_sources; i = next_source++) {
+      search.RunToTargets(sources[i], targets);
+      DistanceType* const row =
+          distances->data() + static_cast<size_t>(i) * num_targets;
+      for (int j = 0; j < num_targets; ++j) {
+        row[j] = search.Distance(targets[j]);
+      }
+    }
+  };
+  const int num_workers = std::max(1, std::min(num_threads, num_sources));
+  if (num_workers == 1) {
+    worker();
+    return;
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_workers; ++t) threads.push_back(std::thread(worker));
+  for (std::thread& thread : threads) thread.join();
+}
+
+template <typename GraphType, typename DistanceType>
+ShortestPathLandmarks<GraphType, DistanceType>::ShortestPathLandmarks(
+    const GraphType& graph, const std::vector<DistanceType>& arc_lengths,
+    const std::vector<NodeIndex>& landmarks, int num_threads)
+    : landmarks_(landmarks) {
+  const NodeIndex num_nodes = graph.num_nodes();
+  const int num_landmarks = landmarks.size();
+  from_landmark_.resize(static_cast<size_t>(num_nodes) * num_landmarks);
+  to_landmark_.resize(static_cast<size_t>(num_nodes) * num_landmarks);
+
+  // Search 2 * l computes the distances from the l-th landmark, and search
+  // 2 * l + 1 the distances to it. Each thread takes the next one.
+  const int num_searches = 2 * num_landmarks;
+  std::atomic<int> next_search(0);
+  auto worker = [&]() {
+    Search forward_search(graph, arc_lengths);
+    DijkstraShortestPathSearch<GraphType, DistanceType, true> backward_search(
+        graph, arc_lengths);
+    for (int i = next_search++; i < num_searches; i = next_search++) {
+      const int l = i / 2;
+      DCHECK(graph.IsNodeValid(landmarks[l]));
+      if (i % 2 == 0) {
+        forward_search.Run(landmarks[l]);
+        for (NodeIndex node = 0; node < num_nodes; ++node) {
+          from_landmark_[static_cast<size_t>(node) * num_landmarks + l] =
+              forward_search.Distance(node);
+        }
+      } else {
+        backward_search.Run(landmarks[l]);
+        for (NodeIndex node = 0; node < num_nodes; ++node) {
+          to_landmark_[static_cast<size_t>(node) * num_landmarks + l] =
+              backward_search.Distance(node);
+        }
+      }
+    }
+  };
+  const int num_workers = std::max(1, std::min(num_threads, num_searches));
+  if (num_workers == 1) {
+    worker();
+    return;
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_workers; ++t) threads.push_back(std::thread(worker));
+  for (std::thread& thread : threads) thread.join();
+}
+
+template <typename GraphType, typename DistanceType>
+std::vector<typename GraphType::NodeIndex>
+ShortestPathLandmarks<GraphType, DistanceType>::SelectFarthestLandmarks(
+    const GraphType& graph, const std::vector<DistanceType>& arc_lengths,
+    int num_landmarks, NodeIndex first_node) {
+  const NodeIndex num_nodes = graph.num_nodes();
+  std::vector<NodeIndex> landmarks;
+  if (num_nodes == 0) return landmarks;
+  DCHECK(graph.IsNodeValid(first_node));
+  Search search(graph, arc_lengths);
+
+  // The first landmark is the farthest node reachable from first_node.
+  search.Run(first_node);
+  NodeIndex landmark = search.settled_nodes().back();
+
+  // min_distance[n] is the smallest distance from a landmark to n. The
+  // unreachable nodes come first, as they are in another part of the graph.
+  std::vector<DistanceType> min_distance(num_nodes,
+                                         Search::UnreachableDistance());
+  const size_t max_num_landmarks = std::min<int64>(num_landmarks, num_nodes);
+  while (true) {
+    landmarks.push_back(landmark);
+    if (landmarks.size() == max_num_landmarks) break;
+    search.Run(landmark);
+    for (const NodeIndex node : search.settled_nodes()) {
+      min_distance[node] = std::min(min_distance[node], search.Distance(node));
+    }
+    min_distance[landmark] = 0;
+    landmark = std::max_element(min_distance.begin(), min_distance.end()) -
+               min_distance.begin();
+    if (min_distance[landmark] == 0) break;
+  }
+  return landmarks;
+}
+
+template <typename GraphType, typename DistanceType>
+DistanceType ShortestPathLandmarks<GraphType, DistanceType>::LowerBound(
+    NodeIndex node, NodeIndex target) const {
+  const DistanceType kUnreachable = Search::UnreachableDistance();
+  const int num_landmarks = landmarks_.size();
+  const DistanceType* const from_node =
+      from_landmark_.data() + static_cast<size_t>(node) * num_landmarks;
+  const DistanceType* const from_target =
+      from_landmark_.data() + static_cast<size_t>(target) * num_landmarks;
+  const DistanceType* const to_node =
+      to_landmark_.data() + static_cast<size_t>(node) * num_landmarks;
+  const DistanceType* const to_target =
+      to_landmark_.data() + static_cast<size_t>(target) * num_landmarks;
+  DistanceType bound = 0;
+  for (int l = 0; l < num_landmarks; ++l) {
+    // The target can't be reached from the node if it can't be reached from a
+    // landmark that reaches the node, or if it reaches a landmark that the
+    // node can't reach. The bounds of the node-dependent unreachable terms
+    // are skipped, which keeps the potential consistent.
+    if (from_node[l] != kUnreachable) {
+      if (from_target[l] == kUnreachable) return kUnreachable;
+      bound = std::max(bound, from_target[l] - from_node[l]);
+    }
+    if (to_target[l] != kUnreachable) {
+      if (to_node[l] == kUnreachable) return kUnreachable;
+      bound = std::max(bound, to_node[l] - to_target[l]);
+    }
+  }
+  return bound;
+}
+
+template <typename GraphType, typename DistanceType>
+PointToPointShortestPathSearch<GraphType, DistanceType>::
+    PointToPointShortestPathSearch(const GraphType& graph,
+                                   const std::vector<DistanceType>& arc_lengths)
+    : graph_(graph),
+      arc_lengths_(arc_lengths),
+      stamp_(0),
+      source_(GraphType::kNilNode),
+      target_(GraphType::kNilNode),
+      meeting_node_(GraphType::kNilNode),
+      num_settled_nodes_(0) {
+  const NodeIndex num_nodes = graph.num_nodes();
+  CHECK_GE(arc_lengths.size(), graph.num_arcs());
+  for (int direction = 0; direction < 2; ++direction) {
+    mark_[direction].assign(num_nodes, 0);
+    distance_[direction].resize(num_nodes);
+    parent_[direction].resize(num_nodes);
+    heap_[direction].Reset(num_nodes);
+  }
+  potential_.resize(num_nodes);
+}
+
+template <typename GraphType, typename DistanceType>
+void PointToPointShortestPathSearch<GraphType, DistanceType>::StartQuery(
+    NodeIndex source, NodeIndex target) {
+  DCHECK(graph_.IsNodeValid(source));
+  DCHECK(graph_.IsNodeValid(target));
+  // The marks of the previous queries are all smaller than the new stamp_,
+  // until it wraps around after 2^31 queries.
+  stamp_ += 2;
+  if (stamp_ == 0) {
+    for (int direction = 0; direction < 2; ++direction) {
+      mark_[direction].assign(mark_[direction].size(), 0);
+    }
+    stamp_ = 2;
+  }
+  heap_[kForward].Clear();
+  heap_[kBackward].Clear();
+  source_ = source;
+  target_ = target;
+  meeting_node_ = GraphType::kNilNode;
+  num_settled_nodes_ = 0;
+}
+
+template <typename GraphType, typename DistanceType>
+void PointToPointShortestPathSearch<GraphType, DistanceType>::
+    RelaxBidirectionalArc(int direction, NodeIndex node, NodeIndex head,
+                          DistanceType new_distance,
+                          DistanceType* best_distance) {
+  if (IsSettled(direction, head)) return;
+  if (!IsReached(direction, head) ||
+      new_distance < distance_[direction][head]) {
+    Reach(direction, head, new_distance, node);
+    heap_[direction].InsertOrDecrease(head, new_distance);
+  }
+  const int other = 1 - direction;
+  if (IsReached(other, head) &&
+      new_distance < *best_distance - distance_[other][head]) {
+    *best_distance = new_distance + distance_[other][head];
+    meeting_node_ = head;
+  }
+}
+
+template <typename GraphType, typename DistanceType>
+void PointToPointShortestPathSearch<GraphType, DistanceType>::
+    RelaxBidirectional(int direction, NodeIndex node, DistanceType distance,
+                       DistanceType* best_distance) {
+  if (direction == kForward) {
+    for (const ArcIndex arc : graph_.OutgoingArcs(node)) {
+      DCHECK_GE(arc_lengths_[arc], 0);
+      RelaxBidirectionalArc(direction, node, graph_.Head(arc),
+                            distance + arc_lengths_[arc], best_distance);
+    }
+  } else {
+    // The head of an incoming arc is the tail of the forward arc.
+    for (const ArcIndex arc : graph_.IncomingArcs(node)) {
+      const ArcIndex forward_arc = graph_.OppositeArc(arc);
+      DCHECK_GE(arc_lengths_[forward_arc], 0);
+      RelaxBidirectionalArc(direction, node, graph_.Head(arc),
+                            distance + arc_lengths_[forward_arc],
+                            best_distance);
+    }
+  }
+}
+
+template <typename GraphType, typename DistanceType>
+DistanceType
+PointToPointShortestPathSearch<GraphType, DistanceType>::BidirectionalDistance(
+    NodeIndex source, NodeIndex target) {
+  StartQuery(source, target);
+  DistanceType best_distance = UnreachableDistance();
+  Reach(kForward, source, 0, GraphType::kNilNode);
+  heap_[kForward].InsertOrDecrease(source, 0);
+  Reach(kBackward, target, 0, GraphType::kNilNode);
+  heap_[kBackward].InsertOrDecrease(target, 0);
+  if (source == target) {
+    best_distance = 0;
+    meeting_node_ = source;
+  }
+  while (!heap_[kForward].IsEmpty() && !heap_[kBackward].IsEmpty()) {
+    const DistanceType forward_key = heap_[kForward].TopKey();
+    const DistanceType backward_key = heap_[kBackward].TopKey();
+    // Any path through a node settled from now on would be longer.
+    if (best_distance != UnreachableDistance() &&
+        forward_key >= best_distance - backward_key) {
+      break;
+    }
+    const int direction = forward_key <= backward_key ? kForward : kBackward;
+    const NodeIndex node = heap_[direction].TopNode();
+    const DistanceType distance = heap_[direction].TopKey();
+    heap_[direction].Pop();
+    mark_[direction][node] = stamp_ + 1;
+    ++num_settled_nodes_;
+    RelaxBidirectional(direction, node, distance, &best_distance);
+  }
+  return best_distance;
+}
+
+template <typename GraphType, typename DistanceType>
+DistanceType
+PointToPointShortestPathSearch<GraphType, DistanceType>::AStarDistance(
+    NodeIndex source, NodeIndex target,
+    const ShortestPathLandmarks<GraphType, DistanceType>& landmarks) {
+  StartQuery(source, target);
+  // The nodes proven not to reach the target are reached with an unreachable
+  // potential, and then ignored.
+  potential_[source] = landmarks.LowerBound(source, target);
+  if (potential_[source] == UnreachableDistance()) return UnreachableDistance();
+  Reach(kForward, source, 0, GraphType::kNilNode);
+  FourAryNodeHeap<NodeIndex, DistanceType>& heap = heap_[kForward];
+  heap.InsertOrDecrease(source, potential_[source]);
+  while (!heap.IsEmpty()) {
+    const NodeIndex node = heap.TopNode();
+    heap.Pop();
+    mark_[kForward][node] = stamp_ + 1;
+    ++num_settled_nodes_;
+    const DistanceType distance = distance_[kForward][node];
+    // Since the potential is consistent, the target has its shortest distance
+    // when it is settled.
+    if (node == target) {
+      meeting_node_ = target;
+      return distance;
+    }
+    for (const ArcIndex arc : graph_.OutgoingArcs(node)) {
+      const NodeIndex head = graph_.Head(arc);
+      DCHECK_GE(arc_lengths_[arc], 0);
+      const DistanceType new_distance = distance + arc_lengths_[arc];
+      if (!IsReached(kForward, head)) {
+        potential_[head] = landmarks.LowerBound(head, target);
+        Reach(kForward, head, new_distance, node);
+        if (potential_[head] != UnreachableDistance()) {
+          heap.InsertOrDecrease(head, new_distance + potential_[head]);
+        }
+      } else if (!IsSettled(kForward, head) &&
+                 potential_[head] != UnreachableDistance() &&
+                 new_distance < distance_[kForward][head]) {
+        Reach(kForward, head, new_distance, node);
+        heap.InsertOrDecrease(head, new_distance + potential_[head]);
+      }
+    }
+  }
+  return UnreachableDistance();
+}
+
+template <typename GraphType, typename DistanceType>
+bool PointToPointShortestPathSearch<GraphType, DistanceType>::GetPath(
+    std::vector<NodeIndex>* nodes) const {
+  nodes->clear();
+  if (meeting_node_ == GraphType::kNilNode) return false;
+  for (NodeIndex n = meeting_node_; n != GraphType::kNilNode;
+       n = parent_[kForward][n]) {
+    nodes->push_back(n);
+  }
+  std::reverse(nodes->begin(), nodes->end());
+  if (meeting_node_ != target_) {
+    for (NodeIndex n = parent_[kBackward][meeting_node_];
+         n != GraphType::kNilNode; n = parent_[kBackward][n]) {
+      nodes->push_back(n);
+    }
+  }
+  return true;
+}
+
+template <typename GraphType, typename DistanceType>
+void ComputePointToPointShortestPathDistances(
+    const GraphType& graph, const std::vector<DistanceType>& arc_lengths,
+    const ShortestPathLandmarks<GraphType, DistanceType>* landmarks,
+    const std::vector<std::pair<typename GraphType::NodeIndex,
+                                typename GraphType::NodeIndex> >& queries,
+    int num_threads, std::vector<DistanceType>* distances) {
+  typedef PointToPointShortestPathSearch<GraphType, DistanceType> Search;
+  CHECK(distances != nullptr);
+  const int num_queries = queries.size();
+  distances->assign(num_queries, Search::UnreachableDistance());
+  if (num_queries == 0) return;
+
+  // Each thread takes the next query not yet processed.
+  std::atomic<int> next_query(0);
+  auto worker = [&]() {
+    Search search(graph, arc_lengths);
+    for (int i = next_query++; i < num_queries; i = next_query++) {
+      (*distances)[i] =
+          landmarks != nullptr
+              ? search.AStarDistance(queries[i].first, queries[i].second,
+                                     *landmarks)
+              : search.BidirectionalDistance(queries[i].first,
+                                             queries[i].second);
+    }
+  };
+  const int num_workers = std::max(1, std::min(num_threads, num_queries));
+  if (num_workers == 1) {
+    worker();
+    return;
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_workers; ++t) threads.push_back(std::thread(worker));
+  for (std::thread& thread : threads) thread.join();
+}
+
 }  // namespace operations_research
 
 #endif  // OR_TOOLS_GRAPH_SHORTESTPATHS_H_
@@ -0,0 +1,134 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "linear_solver/batch_solver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "base/callback.h"
+#include "base/logging.h"
+
+namespace operations_research {
+
+MPBatchSolver::MPBatchSolver(int num_threads)
+    : num_added_requests_(0),
+      num_returned_responses_(0),
+      thread_pool_(new ThreadPool("MPBatchSolver", std::max(1, num_threads))) {
+  thread_pool_->StartWorkers();
+}
+
+MPBatchSolver::~MPBatchSolver() {
+  // This waits for all the queued requests to be solved.
+  thread_pool_.reset(nullptr);
+}
+
+int64 MPBatchSolver::Add(const MPModelRequest& request) {
+  int64 request_id;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    request_id = num_added_requests_++;
+  }
+  // The qualification avoids finding google::protobuf::NewCallback() by
+  // argument-dependent lookup.
+  thread_pool_->Add(::NewCallback(
+      this, &MPBatchSolver::Solve, request_id, new MPModelRequest(request)));
+  return request_id;
+}
+
+bool MPBatchSolver::NextResponse(int64* request_id,
+                                 MPSolutionResponse* response) {
+  CHECK(request_id != nullptr);
+  CHECK(response != nullptr);
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (num_returned_responses_ == num_added_requests_) return false;
+  while (responses_.empty()) {
+    response_available_.wait(lock);
+  }
+  *request_id = responses_.front().first;
+  response->Swap(responses_.front().second.get());
+  responses_.pop_front();
+  ++num_returned_responses_;
+  return true;
+}
+
+int64 MPBatchSolver::num_pending_requests() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return num_added_requests_ - num_returned_responses_;
+}
+
+void MPBatchSolver::Solve(int64 request_id, MPModelRequest* request) {
+  std::unique_ptr<MPModelRequest> deleter(request);
+  std::unique_ptr<MPSolutionResponse> response(new MPSolutionResponse());
+  std::unique_ptr<MPSolver> solver =
+      TakeSolver(static_cast<MPSolver::OptimizationProblemType>(
+          request->solver_type()));
+
+  // This follows MPSolver::SolveWithProto().
+  solver->Clear();
+  if (request->enable_internal_solver_output()) {
+    solver->EnableOutput();
+  } else {
+    solver->SuppressOutput();
+  }
+  std::string error_message;
+  response->set_status(
+      solver->LoadModelFromProto(request->model(), &error_message));
+  if (response->status() == MPSOLVER_MODEL_IS_VALID) {
+    // A time limit of 0 means no time limit for MPSolver, so a positive time
+    // limit is rounded up to 1 millisecond.
+    int64 time_limit_ms = 0;
+    if (request->has_solver_time_limit_seconds()) {
+      time_limit_ms = std::max<int64>(
+          1, std::ceil(request->solver_time_limit_seconds() * 1000.0));
+    }
+    solver->set_time_limit(time_limit_ms);
+    solver->Solve();
+    solver->FillSolutionResponseProto(response.get());
+  } else {
+    LOG_EVERY_N_SEC(WARNING, 1.0)
+        << "Loading model from protocol buffer failed, load status = "
+        << MPSolverResponseStatus_Name(response->status()) << " ("
+        << response->status() << "); Error: " << error_message;
+  }
+  ReleaseSolver(std::move(solver));
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    responses_.push_back(std::make_pair(request_id, std::move(response)));
+  }
+  response_available_.notify_one();
+}
+
+std::unique_ptr<MPSolver> MPBatchSolver::TakeSolver(
+    MPSolver::OptimizationProblemType problem_type) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<std::unique_ptr<MPSolver>>& solvers =
+        idle_solvers_[problem_type];
+    if (!solvers.empty()) {
+      std::unique_ptr<MPSolver> solver = std::move(solvers.back());
+      solvers.pop_back();
+      return solver;
+    }
+  }
+  return std::unique_ptr<MPSolver>(new MPSolver("MPBatchSolver", problem_type));
+}
+
+void MPBatchSolver::ReleaseSolver(std::unique_ptr<MPSolver> solver) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_solvers_[solver->ProblemType()].push_back(std::move(solver));
+}
+
+}  // namespace operations_research
@@ -0,0 +1,115 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Solves a stream of MPModelRequest on a pool of threads.
+//
+// MPSolver::SolveWithProto() creates and destroys an MPSolver (and thus the
+// underlying solver) for each request. For a lot of small models, this setup
+// dominates the solve time. Here, each MPSolver is kept once its request is
+// solved and is cleared and reused for a later request of the same solver
+// type, so its underlying solver keeps its allocations.
+//
+// Example:
+//   MPBatchSolver batch_solver(num_threads);
+//   for (const MPModelRequest& request : requests) {
+//     batch_solver.Add(request);
+//   }
+//   int64 request_id;
+//   MPSolutionResponse response;
+//   while (batch_solver.NextResponse(&request_id, &response)) {
+//     ... requests[request_id] was solved, use response ...
+//   }
+//
+// Add() and NextResponse() can be interleaved and called from different
+// threads.
+
+#ifndef OR_TOOLS_LINEAR_SOLVER_BATCH_SOLVER_H_
+#define OR_TOOLS_LINEAR_SOLVER_BATCH_SOLVER_H_
+
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "base/integral_types.h"
+#include "base/macros.h"
+#include "base/threadpool.h"
+#include "linear_solver/linear_solver.h"
+#include "linear_solver/linear_solver.pb.h"
+
+namespace operations_research {
+
+class MPBatchSolver {
+ public:
+  // Solves the requests with num_threads threads.
+  explicit MPBatchSolver(int num_threads);
+
+  // Waits for the requests being solved. The requests that were not started
+  // yet are still solved, and the responses not returned by NextResponse()
+  // are discarded.
+  ~MPBatchSolver();
+
+  // Queues the given request and returns its id. The ids are consecutive and
+  // start at 0. The request is copied, so it can be destroyed right away.
+  //
+  // As in MPSolver::SolveWithProto(), the solver_time_limit_seconds of the
+  // request is honored, but here with a millisecond precision.
+  int64 Add(const MPModelRequest& request);
+
+  // Waits until one of the added requests is solved, and returns its id and
+  // its response. The responses are returned in the order in which their
+  // requests complete, not in the order of the requests. Returns false right
+  // away if all the responses of the added requests were already returned.
+  bool NextResponse(int64* request_id, MPSolutionResponse* response);
+
+  // Number of added requests whose response was not returned yet.
+  int64 num_pending_requests() const;
+
+ private:
+  // Solves the request (that we take ownership of) and queues its response.
+  // This runs in a thread of the pool.
+  void Solve(int64 request_id, MPModelRequest* request);
+
+  // Returns an idle MPSolver of the given type, or a new one. The returned
+  // MPSolver may still contain the model of its previous request.
+  std::unique_ptr<MPSolver> TakeSolver(
+      MPSolver::OptimizationProblemType problem_type);
+  void ReleaseSolver(std::unique_ptr<MPSolver> solver);
+
+  mutable std::mutex mutex_;
+  std::condition_variable response_available_;
+
+  // The MPSolvers not used by a thread of the pool, by solver type.
+  std::map<MPSolver::OptimizationProblemType,
+           std::vector<std::unique_ptr<MPSolver>>> idle_solvers_;
+
+  // The responses not returned by NextResponse() yet, in completion order.
+  std::deque<std::pair<int64, std::unique_ptr<MPSolutionResponse>>>
+      responses_;
+
+  int64 num_added_requests_;
+  int64 num_returned_responses_;
+
+  // Destroyed explicitly first by the destructor, because the threads of the
+  // pool use the other members.
+  std::unique_ptr<ThreadPool> thread_pool_;
+
+  DISALLOW_COPY_AND_ASSIGN(MPBatchSolver);
+};
+
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_LINEAR_SOLVER_BATCH_SOLVER_H_
@@ -91,13 +91,11 @@ class CBCInterface : public MPSolverInterface {
 
   // Change a coefficient in the linear objective.
   void SetObjectiveCoefficient(const MPVariable* const variable,
-                               double coefficient) override {
-    sync_status_ = MUST_RELOAD;
-  }
+                               double coefficient) override;
   // Change the constant term in the linear objective.
-  void SetObjectiveOffset(double value) override { sync_status_ = MUST_RELOAD; }
+  void SetObjectiveOffset(double value) override;
   // Clear the objective from all its terms.
-  void ClearObjective() override { sync_status_ = MUST_RELOAD; }
+  void ClearObjective() override;
 
   // Number of simplex iterations
   int64 iterations() const override;
@@ -229,6 +227,40 @@ void CBCInterface::SetConstraintBounds(int index, double lb, double ub) {
   }
 }
 
+void CBCInterface::SetObjectiveCoefficient(const MPVariable* const variable,
+                                           double coefficient) {
+  InvalidateSolutionSynchronization();
+  if (sync_status_ == MODEL_SYNCHRONIZED) {
+    osi_.setObjCoeff(MPSolverVarIndexToCbcVarIndex(variable->index()),
+                     coefficient);
+  } else {
+    sync_status_ = MUST_RELOAD;
+  }
+}
+
+// The offset is the objective coefficient of the dummy variable fixed to 1.
+void CBCInterface::SetObjectiveOffset(double value) {
+  InvalidateSolutionSynchronization();
+  if (sync_status_ == MODEL_SYNCHRONIZED) {
+    osi_.setObjCoeff(0, value);
+  } else {
+    sync_status_ = MUST_RELOAD;
+  }
+}
+
+void CBCInterface::ClearObjective() {
+  InvalidateSolutionSynchronization();
+  if (sync_status_ == MODEL_SYNCHRONIZED) {
+    for (CoeffEntry entry : solver_->objective_->coefficients_) {
+      osi_.setObjCoeff(MPSolverVarIndexToCbcVarIndex(entry.first->index()),
+                       0.0);
+    }
+    osi_.setObjCoeff(0, 0.0);
+  } else {
+    sync_status_ = MUST_RELOAD;
+  }
+}
+
 void CBCInterface::AddRowConstraint(MPConstraint* const ct) {
   sync_status_ = MUST_RELOAD;
 }
@@ -243,7 +275,8 @@ MPSolver::ResultStatus CBCInterface::Solve(const MPSolverParameters& param) {
   WallTimer timer;
   timer.Start();
 
-  // Note that CBC does not provide any incrementality.
+  // The bounds and objective changes are applied to osi_ in place, so that
+  // only structural changes rebuild it.
   if (param.GetIntegerParam(MPSolverParameters::INCREMENTALITY) ==
       MPSolverParameters::INCREMENTALITY_OFF) {
     Reset();
@@ -345,6 +378,19 @@ MPSolver::ResultStatus CBCInterface::Solve(const MPSolverParameters& param) {
     message_handler.setLogLevel(3, 1);  // Cgl messages
   }
 
+  // Pass the solution hint as a MIP start. CBC matches it by column name,
+  // fixes the hinted integer variables and completes it by solving an LP.
+  if (!solver_->solution_hint_.empty()) {
+    std::vector<std::pair<std::string, double> > mip_start;
+    mip_start.reserve(solver_->solution_hint_.size());
+    for (const std::pair<MPVariable*, double>& p : solver_->solution_hint_) {
+      mip_start.push_back(std::make_pair(
+          osi_.getColName(MPSolverVarIndexToCbcVarIndex(p.first->index())),
+          p.second));
+    }
+    model.setMIPStart(mip_start);
+  }
+
   // Time limit.
   if (solver_->time_limit() != 0) {
     VLOG(1) << "Setting time limit = " << solver_->time_limit() << " ms.";
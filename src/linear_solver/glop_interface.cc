@@ -13,6 +13,7 @@
 
 
 #include "base/hash.h"
+#include <memory>
 #include <string>
 #include <vector>
 #include <fstream>
@@ -38,6 +39,7 @@
 #include "linear_solver/linear_solver.h"
 #include "lp_data/lp_data.h"
 #include "lp_data/lp_types.h"
+#include "util/time_limit.h"
 
 DECLARE_double(solver_timeout_in_seconds);
 DECLARE_string(solver_write_model);
@@ -165,13 +167,16 @@ class GLOPInterface : public MPSolverInterface {
   bool ReadParameterFile(const std::string& filename) override;
 
  private:
-  void NonIncrementalChange();
-
   glop::LinearProgram linear_program_;
   glop::LPSolver lp_solver_;
   std::vector<MPSolver::BasisStatus> column_status_;
   std::vector<MPSolver::BasisStatus> row_status_;
   glop::GlopParameters parameters_;
+
+  // The (row, col) coefficients set in an already extracted constraint on a
+  // variable that was not extracted yet. They are pushed into linear_program_
+  // by ExtractNewConstraints(), once the new columns exist.
+  std::vector<std::pair<glop::RowIndex, glop::ColIndex>> pending_coefficients_;
 };
 
 GLOPInterface::GLOPInterface(MPSolver* const solver)
@@ -180,13 +185,16 @@ GLOPInterface::GLOPInterface(MPSolver* const solver)
       lp_solver_(),
       column_status_(),
       row_status_(),
-      parameters_() {}
+      parameters_(),
+      pending_coefficients_() {}
 
 GLOPInterface::~GLOPInterface() {}
 
 MPSolver::ResultStatus GLOPInterface::Solve(const MPSolverParameters& param) {
-  // Reset extraction as Glop is not incremental yet.
-  Reset();
+  // The model modifications since the last solve were either applied directly
+  // to linear_program_ or will be by the extraction of the new variables and
+  // constraints below. Since linear_program_ and lp_solver_ are kept, the
+  // solve is warm-started from the last basis.
   ExtractModel();
   SetParameters(param);
 
@@ -203,7 +211,13 @@ MPSolver::ResultStatus GLOPInterface::Solve(const MPSolverParameters& param) {
   solver_->SetSolverSpecificParametersAsString(
       solver_->solver_specific_parameter_string_);
   lp_solver_.SetParameters(parameters_);
-  const glop::ProblemStatus status = lp_solver_.Solve(linear_program_);
+  // A solve started by MPSolver::SolveAsync() stops when it is cancelled.
+  std::unique_ptr<TimeLimit> time_limit = TimeLimit::FromParameters(parameters_);
+  if (solver_->interrupt_flag_ != nullptr) {
+    time_limit->RegisterExternalBooleanAsLimit(solver_->interrupt_flag_);
+  }
+  const glop::ProblemStatus status =
+      lp_solver_.SolveWithTimeLimit(linear_program_, time_limit.get());
 
   // The solution must be marked as synchronized even when no solution exists.
   sync_status_ = SOLUTION_SYNCHRONIZED;
@@ -250,14 +264,21 @@ MPSolver::ResultStatus GLOPInterface::Solve(const MPSolverParameters& param) {
 void GLOPInterface::Reset() {
   ResetExtractionInformation();
   linear_program_.Clear();
+  pending_coefficients_.clear();
 }
 
 void GLOPInterface::SetOptimizationDirection(bool maximize) {
-  NonIncrementalChange();
+  // maximize_ is passed to linear_program_ by Solve().
+  InvalidateSolutionSynchronization();
 }
 
 void GLOPInterface::SetVariableBounds(int index, double lb, double ub) {
-  NonIncrementalChange();
+  InvalidateSolutionSynchronization();
+  if (variable_is_extracted(index)) {
+    linear_program_.SetVariableBounds(glop::ColIndex(index), lb, ub);
+  } else {
+    sync_status_ = MUST_RELOAD;
+  }
 }
 
 void GLOPInterface::SetVariableInteger(int index, bool integer) {
@@ -265,35 +286,84 @@ void GLOPInterface::SetVariableInteger(int index, bool integer) {
 }
 
 void GLOPInterface::SetConstraintBounds(int index, double lb, double ub) {
-  NonIncrementalChange();
+  InvalidateSolutionSynchronization();
+  if (constraint_is_extracted(index)) {
+    linear_program_.SetConstraintBounds(glop::RowIndex(index), lb, ub);
+  } else {
+    sync_status_ = MUST_RELOAD;
+  }
 }
 
+// The new variables and constraints are added to linear_program_ by
+// ExtractNewVariables() and ExtractNewConstraints() at the next solve.
 void GLOPInterface::AddRowConstraint(MPConstraint* const ct) {
-  NonIncrementalChange();
+  sync_status_ = MUST_RELOAD;
 }
 
 void GLOPInterface::AddVariable(MPVariable* const var) {
-  NonIncrementalChange();
+  sync_status_ = MUST_RELOAD;
 }
 
+// Note that LinearProgram::SetCoefficient() does not look for an existing
+// entry: it appends one, and LinearProgram::CleanUp() (called by Solve()) keeps
+// the last entry of each (row, col) and removes the zeros.
 void GLOPInterface::SetCoefficient(MPConstraint* const constraint,
                                    const MPVariable* const variable,
                                    double new_value, double old_value) {
-  NonIncrementalChange();
+  InvalidateSolutionSynchronization();
+  if (!constraint_is_extracted(constraint->index())) {
+    // The whole constraint will be extracted by ExtractNewConstraints().
+    sync_status_ = MUST_RELOAD;
+    return;
+  }
+  const glop::RowIndex row(constraint->index());
+  const glop::ColIndex col(variable->index());
+  if (variable_is_extracted(variable->index())) {
+    linear_program_.SetCoefficient(row, col, new_value);
+  } else {
+    pending_coefficients_.push_back(std::make_pair(row, col));
+    sync_status_ = MUST_RELOAD;
+  }
 }
 
 void GLOPInterface::ClearConstraint(MPConstraint* const constraint) {
-  NonIncrementalChange();
+  InvalidateSolutionSynchronization();
+  if (!constraint_is_extracted(constraint->index())) return;
+  const glop::RowIndex row(constraint->index());
+  for (CoeffEntry entry : constraint->coefficients_) {
+    const int var_index = entry.first->index();
+    if (variable_is_extracted(var_index)) {
+      linear_program_.SetCoefficient(row, glop::ColIndex(var_index), 0.0);
+    }
+  }
 }
 
 void GLOPInterface::SetObjectiveCoefficient(const MPVariable* const variable,
                                             double coefficient) {
-  NonIncrementalChange();
+  InvalidateSolutionSynchronization();
+  if (variable_is_extracted(variable->index())) {
+    linear_program_.SetObjectiveCoefficient(glop::ColIndex(variable->index()),
+                                            coefficient);
+  } else {
+    sync_status_ = MUST_RELOAD;
+  }
 }
 
-void GLOPInterface::SetObjectiveOffset(double value) { NonIncrementalChange(); }
+void GLOPInterface::SetObjectiveOffset(double value) {
+  InvalidateSolutionSynchronization();
+  linear_program_.SetObjectiveOffset(value);
+}
 
-void GLOPInterface::ClearObjective() { NonIncrementalChange(); }
+void GLOPInterface::ClearObjective() {
+  InvalidateSolutionSynchronization();
+  for (CoeffEntry entry : solver_->objective_->coefficients_) {
+    const int var_index = entry.first->index();
+    if (variable_is_extracted(var_index)) {
+      linear_program_.SetObjectiveCoefficient(glop::ColIndex(var_index), 0.0);
+    }
+  }
+  linear_program_.SetObjectiveOffset(0.0);
+}
 
 int64 GLOPInterface::iterations() const {
   return lp_solver_.GetNumberOfSimplexIterations();
@@ -331,9 +401,6 @@ std::string GLOPInterface::SolverVersion() const {
 void* GLOPInterface::underlying_solver() { return &lp_solver_; }
 
 void GLOPInterface::ExtractNewVariables() {
-  DCHECK_EQ(0, last_variable_index_);
-  DCHECK_EQ(0, last_constraint_index_);
-
   const glop::ColIndex num_cols(solver_->variables_.size());
   for (glop::ColIndex col(last_variable_index_); col < num_cols; ++col) {
     MPVariable* const var = solver_->variables_[col.value()];
@@ -346,10 +413,8 @@ void GLOPInterface::ExtractNewVariables() {
 }
 
 void GLOPInterface::ExtractNewConstraints() {
-  DCHECK_EQ(0, last_constraint_index_);
-
   const glop::RowIndex num_rows(solver_->constraints_.size());
-  for (glop::RowIndex row(0); row < num_rows; ++row) {
+  for (glop::RowIndex row(last_constraint_index_); row < num_rows; ++row) {
     MPConstraint* const ct = solver_->constraints_[row.value()];
     set_constraint_as_extracted(row.value(), true);
 
@@ -368,6 +433,18 @@ void GLOPInterface::ExtractNewConstraints() {
       linear_program_.SetCoefficient(row, col, coeff);
     }
   }
+
+  // The coefficients of the new variables in the old constraints. The value is
+  // read from the constraint since it may have changed since it was recorded.
+  for (const std::pair<glop::RowIndex, glop::ColIndex>& entry :
+       pending_coefficients_) {
+    const MPConstraint* const ct = solver_->constraints_[entry.first.value()];
+    const MPVariable* const var = solver_->variables_[entry.second.value()];
+    DCHECK(variable_is_extracted(var->index()));
+    linear_program_.SetCoefficient(entry.first, entry.second,
+                                   ct->GetCoefficient(var));
+  }
+  pending_coefficients_.clear();
 }
 
 void GLOPInterface::ExtractObjective() {
@@ -474,11 +551,6 @@ bool GLOPInterface::ReadParameterFile(const std::string& filename) {
 #endif
 }
 
-void GLOPInterface::NonIncrementalChange() {
-  // The current implementation is not incremental.
-  sync_status_ = MUST_RELOAD;
-}
-
 // Register GLOP in the global linear solver factory.
 MPSolverInterface* BuildGLOPInterface(MPSolver* const solver) {
   return new GLOPInterface(solver);
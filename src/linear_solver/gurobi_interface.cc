@@ -13,6 +13,7 @@
 
 #if defined(USE_GUROBI)
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include "base/hash.h"
@@ -110,6 +111,11 @@ class GurobiInterface : public MPSolverInterface {
                         technical);
   }
 
+  bool InterruptSolve() override {
+    if (model_ != nullptr) GRBterminate(model_);
+    return true;
+  }
+
   void* underlying_solver() override { return reinterpret_cast<void*>(model_); }
 
   double ComputeExactConditionNumber() const override {
@@ -149,6 +155,11 @@ class GurobiInterface : public MPSolverInterface {
   bool ReadParameterFile(const std::string& filename) override;
   std::string ValidFileExtensionForParameterFile() const override;
 
+  // Gurobi callback reporting the new incumbents to the progress callback of
+  // MPSolver::SolveAsync(), and stopping the solve when it is cancelled.
+  static int __stdcall SolveCallback(GRBmodel* model, void* cbdata, int where,
+                                     void* usrdata);
+
   MPSolver::BasisStatus TransformGRBVarBasisStatus(int gurobi_basis_status)
       const;
   MPSolver::BasisStatus TransformGRBConstraintBasisStatus(
@@ -158,11 +169,17 @@ class GurobiInterface : public MPSolverInterface {
   GRBmodel* model_;
   GRBenv* env_;
   bool mip_;
+  // Whether the "Start" attribute was set on the variables of model_.
+  bool has_mip_start_;
 };
 
 // Creates a LP/MIP instance with the specified name and minimization objective.
 GurobiInterface::GurobiInterface(MPSolver* const solver, bool mip)
-    : MPSolverInterface(solver), model_(0), env_(0), mip_(mip) {
+    : MPSolverInterface(solver),
+      model_(0),
+      env_(0),
+      mip_(mip),
+      has_mip_start_(false) {
   if (GRBloadenv(&env_, NULL) != 0 || env_ == NULL) {
     LOG(FATAL) << "Error: could not create environment";
   }
@@ -186,6 +203,25 @@ GurobiInterface::~GurobiInterface() {
   GRBfreeenv(env_);
 }
 
+// static
+int __stdcall GurobiInterface::SolveCallback(GRBmodel* model, void* cbdata,
+                                             int where, void* usrdata) {
+  const MPSolver* const solver =
+      reinterpret_cast<GurobiInterface*>(usrdata)->solver_;
+  if (solver->interrupt_flag_ != nullptr && *solver->interrupt_flag_) {
+    GRBterminate(model);
+  }
+  if (where == GRB_CB_MIPSOL && solver->progress_callback_ != nullptr) {
+    double objective_value = 0.0;
+    double best_bound = 0.0;
+    if (GRBcbget(cbdata, where, GRB_CB_MIPSOL_OBJ, &objective_value) == 0 &&
+        GRBcbget(cbdata, where, GRB_CB_MIPSOL_OBJBND, &best_bound) == 0) {
+      solver->progress_callback_(objective_value, best_bound);
+    }
+  }
+  return 0;
+}
+
 // ------ Model modifications and extraction -----
 
 void GurobiInterface::Reset() {
@@ -197,20 +233,33 @@ void GurobiInterface::Reset() {
                                   NULL,    // ub
                                   NULL,    // vtype
                                   NULL));  // varnames
+  has_mip_start_ = false;
   ResetExtractionInformation();
 }
 
+// The bounds and the objective are changed in place on the extracted model, so
+// that re-solving a model that only differs by them keeps the Gurobi model and
+// warm starts from its last basis. The structural changes still rebuild it.
 void GurobiInterface::SetOptimizationDirection(bool maximize) {
-  sync_status_ = MUST_RELOAD;
-  // TODO(user,user): Fix, not yet working.
-  // InvalidateSolutionSynchronization();
-  // CHECKED_GUROBI_CALL(GRBsetintattr(model_,
-  //                                   GRB_INT_ATTR_MODELSENSE,
-  //                                   maximize_ ? -1 : 1));
+  InvalidateSolutionSynchronization();
+  if (sync_status_ == MODEL_SYNCHRONIZED) {
+    CHECKED_GUROBI_CALL(
+        GRBsetintattr(model_, GRB_INT_ATTR_MODELSENSE, maximize ? -1 : 1));
+  } else {
+    sync_status_ = MUST_RELOAD;
+  }
 }
 
 void GurobiInterface::SetVariableBounds(int var_index, double lb, double ub) {
-  sync_status_ = MUST_RELOAD;
+  InvalidateSolutionSynchronization();
+  if (sync_status_ == MODEL_SYNCHRONIZED && variable_is_extracted(var_index)) {
+    CHECKED_GUROBI_CALL(
+        GRBsetdblattrelement(model_, GRB_DBL_ATTR_LB, var_index, lb));
+    CHECKED_GUROBI_CALL(
+        GRBsetdblattrelement(model_, GRB_DBL_ATTR_UB, var_index, ub));
+  } else {
+    sync_status_ = MUST_RELOAD;
+  }
 }
 
 // Modifies integrality of an extracted variable.
@@ -264,20 +313,40 @@ void GurobiInterface::ClearConstraint(MPConstraint* const constraint) {
 
 void GurobiInterface::SetObjectiveCoefficient(const MPVariable* const variable,
                                               double coefficient) {
-  sync_status_ = MUST_RELOAD;
+  InvalidateSolutionSynchronization();
+  if (sync_status_ == MODEL_SYNCHRONIZED &&
+      variable_is_extracted(variable->index())) {
+    CHECKED_GUROBI_CALL(GRBsetdblattrelement(model_, GRB_DBL_ATTR_OBJ,
+                                             variable->index(), coefficient));
+  } else {
+    sync_status_ = MUST_RELOAD;
+  }
 }
 
 void GurobiInterface::SetObjectiveOffset(double value) {
-  sync_status_ = MUST_RELOAD;
-  // TODO(user,user): make it work.
-  // InvalidateSolutionSynchronization();
-  // CHECKED_GUROBI_CALL(GRBsetdblattr(model_,
-  //                                   GRB_DBL_ATTR_OBJCON,
-  //                                   solver_->Objective().offset()));
-  // CHECKED_GUROBI_CALL(GRBupdatemodel(model_));
+  InvalidateSolutionSynchronization();
+  if (sync_status_ == MODEL_SYNCHRONIZED) {
+    CHECKED_GUROBI_CALL(GRBsetdblattr(model_, GRB_DBL_ATTR_OBJCON, value));
+  } else {
+    sync_status_ = MUST_RELOAD;
+  }
 }
 
-void GurobiInterface::ClearObjective() { sync_status_ = MUST_RELOAD; }
+void GurobiInterface::ClearObjective() {
+  InvalidateSolutionSynchronization();
+  if (sync_status_ != MODEL_SYNCHRONIZED) {
+    sync_status_ = MUST_RELOAD;
+    return;
+  }
+  for (CoeffEntry entry : solver_->objective_->coefficients_) {
+    const int var_index = entry.first->index();
+    if (variable_is_extracted(var_index)) {
+      CHECKED_GUROBI_CALL(
+          GRBsetdblattrelement(model_, GRB_DBL_ATTR_OBJ, var_index, 0.0));
+    }
+  }
+  CHECKED_GUROBI_CALL(GRBsetdblattr(model_, GRB_DBL_ATTR_OBJCON, 0.0));
+}
 
 // ------ Query statistics on the solution and the solve ------
 
@@ -597,7 +666,8 @@ MPSolver::ResultStatus GurobiInterface::Solve(const MPSolverParameters& param) {
     Reset();
   }
 
-  // TODO(user,user): Support incrementality.
+  // The changes of bounds and objective were applied in place, the other
+  // changes require to rebuild the model.
   if (sync_status_ == MUST_RELOAD) {
     Reset();
   }
@@ -611,10 +681,19 @@ MPSolver::ResultStatus GurobiInterface::Solve(const MPSolverParameters& param) {
   CHECKED_GUROBI_CALL(GRBupdatemodel(model_));
   VLOG(1) << StringPrintf("Model built in %.3f seconds.", timer.Get());
 
-  // Set solution hints if any.
-  for (const std::pair<MPVariable*, double>& p : solver_->solution_hint_) {
-    CHECKED_GUROBI_CALL(
-        GRBsetdblattrelement(model_, "Start", p.first->index(), p.second));
+  // Set the MIP start from the solution hint. As the model may be kept from
+  // the previous solve, the start of the variables that are not in the hint
+  // is reset so that no stale value is used.
+  if (mip_ && (!solver_->solution_hint_.empty() || has_mip_start_)) {
+    const int num_vars = solver_->variables_.size();
+    std::unique_ptr<double[]> start(new double[num_vars]);
+    std::fill(start.get(), start.get() + num_vars, GRB_UNDEFINED);
+    for (const std::pair<MPVariable*, double>& p : solver_->solution_hint_) {
+      start[p.first->index()] = p.second;
+    }
+    CHECKED_GUROBI_CALL(GRBsetdblattrarray(model_, GRB_DBL_ATTR_START, 0,
+                                           num_vars, start.get()));
+    has_mip_start_ = !solver_->solution_hint_.empty();
   }
 
   // Time limit.
@@ -628,6 +707,13 @@ MPSolver::ResultStatus GurobiInterface::Solve(const MPSolverParameters& param) {
       solver_->solver_specific_parameter_string_);
   SetParameters(param);
 
+  // The callback is only set for MPSolver::SolveAsync().
+  const bool use_callback = solver_->progress_callback_ != nullptr ||
+                            solver_->interrupt_flag_ != nullptr;
+  CHECKED_GUROBI_CALL(GRBsetcallbackfunc(
+      model_, use_callback ? SolveCallback : nullptr,
+      use_callback ? this : nullptr));
+
   // Solve
   timer.Restart();
   const int status = GRBoptimize(model_);
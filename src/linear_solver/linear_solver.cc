@@ -20,14 +20,17 @@
 #endif
 
 
+#include <chrono>  // NOLINT
 #include <cmath>
 #include <cstddef>
+#include <thread>  // NOLINT
 #include <utility>
 
 #include "base/commandlineflags.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/stringprintf.h"
+#include "base/threadpool.h"
 #include "base/timer.h"
 
 #ifndef ANDROID_JNI
@@ -67,6 +70,10 @@ DEFINE_bool(mpsolver_bypass_model_validation, false,
             " Invalid models will typically trigger various error responses"
             " from the underlying solvers; sometimes crashes.");
 
+DEFINE_int32(mpsolver_async_num_threads, 0,
+             "Number of threads of the pool shared by the MPSolver::SolveAsync()"
+             " calls. If 0, the number of cores is used.");
+
 
 // To compile the open-source code, the anonymous namespace should be
 // inside the operations_research namespace (This is due to the
@@ -86,6 +93,41 @@ std::string MPModelRequest_SolverType_Name(int type) {
 }
 #endif  // defined(ANDROID_JNI) && (defined(__ANDROID__) || defined(__APPLE__))
 
+// ----- CoeffMap -----
+
+CoeffMap::const_iterator CoeffMap::LowerBound(const MPVariable* var) const {
+  const int index = var->index();
+  // Fast path for the entries added by increasing variable index.
+  if (entries_.empty() || entries_.back().first->index() < index) {
+    return entries_.end();
+  }
+  return std::lower_bound(entries_.begin(), entries_.end(), index,
+                          [](const CoeffEntry& entry, int index) {
+                            return entry.first->index() < index;
+                          });
+}
+
+CoeffMap::iterator CoeffMap::find(const MPVariable* var) {
+  const iterator it = entries_.begin() + (LowerBound(var) - entries_.begin());
+  return it != entries_.end() && it->first == var ? it : entries_.end();
+}
+
+CoeffMap::const_iterator CoeffMap::find(const MPVariable* var) const {
+  const const_iterator it = LowerBound(var);
+  return it != entries_.end() && it->first == var ? it : entries_.end();
+}
+
+std::pair<CoeffMap::iterator, bool> CoeffMap::insert(const CoeffEntry& entry) {
+  iterator it =
+      entries_.begin() + (LowerBound(entry.first) - entries_.begin());
+  if (it != entries_.end() && it->first == entry.first) {
+    return std::make_pair(it, false);
+  }
+  return std::make_pair(entries_.insert(it, entry), true);
+}
+
+// ----- MPConstraint -----
+
 double MPConstraint::GetCoefficient(const MPVariable* const var) const {
   DLOG_IF(DFATAL, !interface_->solver_->OwnsVariable(var)) << var;
   if (var == NULL) return 0.0;
@@ -448,11 +490,10 @@ int NumDigits(int n) {
 MPSolver::MPSolver(const std::string& name, OptimizationProblemType problem_type)
     : name_(name),
       problem_type_(problem_type),
-#if !defined(_MSC_VER)
-      variable_name_to_index_(1),
-      constraint_name_to_index_(1),
-#endif
-      time_limit_(0.0) {
+      variable_name_to_index_(&variables_),
+      constraint_name_to_index_(&constraints_),
+      time_limit_(0.0),
+      interrupt_flag_(nullptr) {
   timer_.Restart();
   interface_.reset(BuildSolverInterface(this));
   if (FLAGS_linear_solver_enable_verbose_output) {
@@ -496,18 +537,14 @@ bool MPSolver::SupportsProblemType(OptimizationProblemType problem_type) {
 }
 
 MPVariable* MPSolver::LookupVariableOrNull(const std::string& var_name) const {
-  hash_map<std::string, int>::const_iterator it =
-      variable_name_to_index_.find(var_name);
-  if (it == variable_name_to_index_.end()) return NULL;
-  return variables_[it->second];
+  const int var_index = variable_name_to_index_.Find(var_name);
+  return var_index == -1 ? NULL : variables_[var_index];
 }
 
 MPConstraint* MPSolver::LookupConstraintOrNull(const std::string& constraint_name)
     const {
-  hash_map<std::string, int>::const_iterator it =
-      constraint_name_to_index_.find(constraint_name);
-  if (it == constraint_name_to_index_.end()) return NULL;
-  return constraints_[it->second];
+  const int constraint_index = constraint_name_to_index_.Find(constraint_name);
+  return constraint_index == -1 ? NULL : constraints_[constraint_index];
 }
 
 // ----- Methods using protocol buffers -----
@@ -672,24 +709,16 @@ void MPSolver::ExportModelToProto(MPModelProto* output_model) const {
     variable_proto->set_lower_bound(var->lb());
     variable_proto->set_upper_bound(var->ub());
     variable_proto->set_is_integer(var->integer());
-    if (objective_->GetCoefficient(var) != 0.0) {
-      variable_proto->set_objective_coefficient(
-          objective_->GetCoefficient(var));
-    }
   }
-
-  // Map the variables to their indices. This is needed to output the
-  // variables in the order they were created, which in turn is needed to have
-  // repeatable results with ExportModelAsLpString and ExportModelAsMpsString.
-  // This step is needed as long as the variable indices are given by the
-  // underlying solver at the time of model extraction.
-  // TODO(user): remove this step.
-  hash_map<const MPVariable*, int> var_to_index;
-  for (int j = 0; j < variables_.size(); ++j) {
-    var_to_index[variables_[j]] = j;
+  for (CoeffEntry entry : objective_->coefficients_) {
+    if (entry.second != 0.0) {
+      output_model->mutable_variable(entry.first->index())
+          ->set_objective_coefficient(entry.second);
+    }
   }
 
-  // Constraints
+  // Constraints. Their coefficients are already sorted by variable index, and
+  // the index of a variable is its position in variables_.
   for (int i = 0; i < constraints_.size(); ++i) {
     MPConstraint* const constraint = constraints_[i];
     MPConstraintProto* const constraint_proto = output_model->add_constraint();
@@ -697,23 +726,14 @@ void MPSolver::ExportModelToProto(MPModelProto* output_model) const {
     constraint_proto->set_lower_bound(constraint->lb());
     constraint_proto->set_upper_bound(constraint->ub());
     constraint_proto->set_is_lazy(constraint->is_lazy());
-    // Vector linear_term will contain pairs (variable index, coeff), that will
-    // be sorted by variable index.
-    std::vector<std::pair<int, double> > linear_term;
+    constraint_proto->mutable_var_index()->Reserve(
+        constraint->coefficients_.size());
+    constraint_proto->mutable_coefficient()->Reserve(
+        constraint->coefficients_.size());
     for (CoeffEntry entry : constraint->coefficients_) {
-      const MPVariable* const var = entry.first;
-      const int var_index = FindWithDefault(var_to_index, var, -1);
-      DCHECK_NE(-1, var_index);
-      const double coeff = entry.second;
-      linear_term.push_back(std::pair<int, double>(var_index, coeff));
-    }
-    // The cost of sort is expected to be low as constraints usually have very
-    // few terms.
-    std::sort(linear_term.begin(), linear_term.end());
-    // Now use linear term.
-    for (const std::pair<int, double> var_and_coeff : linear_term) {
-      constraint_proto->add_var_index(var_and_coeff.first);
-      constraint_proto->add_coefficient(var_and_coeff.second);
+      DCHECK_EQ(entry.first, variables_[entry.first->index()]);
+      constraint_proto->add_var_index(entry.first->index());
+      constraint_proto->add_coefficient(entry.second);
     }
   }
   output_model->set_maximize(Objective().maximization());
@@ -774,13 +794,13 @@ bool MPSolver::LoadSolutionFromProto(const MPSolutionResponse& response) {
 
 void MPSolver::Clear() {
   MutableObjective()->Clear();
-  STLDeleteElements(&variables_);
-  STLDeleteElements(&constraints_);
   variables_.clear();
-  variable_name_to_index_.clear();
+  variable_arena_.Clear();
+  variable_name_to_index_.Clear();
   variable_is_extracted_.clear();
   constraints_.clear();
-  constraint_name_to_index_.clear();
+  constraint_arena_.Clear();
+  constraint_name_to_index_.Clear();
   constraint_is_extracted_.clear();
   interface_->Reset();
   solution_hint_.clear();
@@ -790,15 +810,127 @@ void MPSolver::Reset() { interface_->Reset(); }
 
 bool MPSolver::InterruptSolve() { return interface_->InterruptSolve(); }
 
+void MPSolver::SetHint(
+    const std::vector<std::pair<MPVariable*, double> >& hint) {
+  for (const std::pair<MPVariable*, double>& p : hint) {
+    DCHECK(OwnsVariable(p.first));
+  }
+  solution_hint_ = hint;
+}
+
+void MPSolver::SetHintFromSolution() {
+  solution_hint_.clear();
+  if (!interface_->CheckSolutionIsSynchronizedAndExists()) return;
+  solution_hint_.reserve(variables_.size());
+  for (MPVariable* const var : variables_) {
+    solution_hint_.push_back(std::make_pair(var, var->solution_value()));
+  }
+}
+
+void MPSolver::ClearHint() { solution_hint_.clear(); }
+
+namespace {
+
+// The pool running the solves of MPSolver::SolveAsync(), created on first use
+// and never destroyed.
+ThreadPool* AsyncSolvePool() {
+  static ThreadPool* const pool = [] {
+    const int num_threads = FLAGS_mpsolver_async_num_threads > 0
+                                ? FLAGS_mpsolver_async_num_threads
+                                : std::max(1U, std::thread::hardware_concurrency());
+    ThreadPool* const result = new ThreadPool("MPSolveAsync", num_threads);
+    result->StartWorkers();
+    return result;
+  }();
+  return pool;
+}
+
+}  // namespace
+
+std::unique_ptr<MPSolveHandle> MPSolver::SolveAsync(
+    const MPSolverParameters& param, ProgressCallback progress) {
+  progress_callback_ = std::move(progress);
+  std::unique_ptr<MPSolveHandle> handle(new MPSolveHandle(this, param));
+  MPSolveHandle* const raw_handle = handle.get();
+  AsyncSolvePool()->Schedule([raw_handle]() { raw_handle->Run(); });
+  return handle;
+}
+
+MPSolveHandle::MPSolveHandle(MPSolver* solver, const MPSolverParameters& param)
+    : solver_(solver),
+      param_(param),
+      state_(PENDING),
+      result_status_(MPSolver::NOT_SOLVED),
+      cancelled_(false) {}
+
+MPSolveHandle::~MPSolveHandle() { Wait(); }
+
+void MPSolveHandle::Run() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (cancelled_) {
+      state_ = DONE;
+      solver_->progress_callback_ = nullptr;
+      done_.notify_all();
+      return;
+    }
+    state_ = RUNNING;
+  }
+  solver_->interrupt_flag_ = &cancelled_;
+  const MPSolver::ResultStatus status = solver_->Solve(param_);
+  solver_->interrupt_flag_ = nullptr;
+  if (solver_->progress_callback_ != nullptr &&
+      (status == MPSolver::OPTIMAL || status == MPSolver::FEASIBLE)) {
+    solver_->progress_callback_(solver_->Objective().Value(),
+                                solver_->Objective().BestBound());
+  }
+  solver_->progress_callback_ = nullptr;
+  std::unique_lock<std::mutex> lock(mutex_);
+  result_status_ = status;
+  state_ = DONE;
+  done_.notify_all();
+}
+
+MPSolver::ResultStatus MPSolveHandle::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return state_ == DONE; });
+  return result_status_;
+}
+
+bool MPSolveHandle::WaitFor(int64 timeout_ms,
+                            MPSolver::ResultStatus* result_status) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!done_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                      [this] { return state_ == DONE; })) {
+    return false;
+  }
+  *result_status = result_status_;
+  return true;
+}
+
+bool MPSolveHandle::IsDone() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return state_ == DONE;
+}
+
+void MPSolveHandle::Cancel() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  // The interfaces checking interrupt_flag_ see this right away, including if
+  // the solve is about to start.
+  cancelled_ = true;
+  if (state_ == RUNNING) solver_->InterruptSolve();
+}
+
 MPVariable* MPSolver::MakeVar(double lb, double ub, bool integer,
                               const std::string& name) {
   const int var_index = NumVariables();
   const std::string fixed_name =
       name.empty() ? StringPrintf("auto_v_%09d", var_index) : name;
-  InsertOrDie(&variable_name_to_index_, fixed_name, var_index);
-  MPVariable* v =
-      new MPVariable(var_index, lb, ub, integer, fixed_name, interface_.get());
+  MPVariable* v = new (variable_arena_.Allocate())
+      MPVariable(var_index, lb, ub, integer, fixed_name, interface_.get());
   variables_.push_back(v);
+  CHECK(variable_name_to_index_.Insert(var_index))
+      << "Duplicate variable name: " << fixed_name;
   variable_is_extracted_.push_back(false);
   interface_->AddVariable(v);
   return v;
@@ -859,15 +991,82 @@ MPConstraint* MPSolver::MakeRowConstraint(double lb, double ub,
   const int constraint_index = NumConstraints();
   const std::string fixed_name =
       name.empty() ? StringPrintf("auto_c_%09d", constraint_index) : name;
-  InsertOrDie(&constraint_name_to_index_, fixed_name, constraint_index);
-  MPConstraint* const constraint =
-      new MPConstraint(constraint_index, lb, ub, fixed_name, interface_.get());
+  MPConstraint* const constraint = new (constraint_arena_.Allocate())
+      MPConstraint(constraint_index, lb, ub, fixed_name, interface_.get());
   constraints_.push_back(constraint);
+  CHECK(constraint_name_to_index_.Insert(constraint_index))
+      << "Duplicate constraint name: " << fixed_name;
   constraint_is_extracted_.push_back(false);
   interface_->AddRowConstraint(constraint);
   return constraint;
 }
 
+void MPSolver::AddRows(const std::vector<int>& starts,
+                       const std::vector<int>& var_indices,
+                       const std::vector<double>& coefficients,
+                       const std::vector<double>& lbs,
+                       const std::vector<double>& ubs,
+                       const std::vector<std::string>& names,
+                       std::vector<MPConstraint*>* constraints) {
+  const int num_new_constraints = lbs.size();
+  if (ubs.size() != num_new_constraints ||
+      (!names.empty() && names.size() != num_new_constraints) ||
+      starts.size() != num_new_constraints + 1 || starts[0] != 0 ||
+      starts.back() != var_indices.size() ||
+      coefficients.size() != var_indices.size()) {
+    LOG(DFATAL) << "Inconsistent sizes in MPSolver::AddRows().";
+    return;
+  }
+  for (int i = 0; i < num_new_constraints; ++i) {
+    if (starts[i] > starts[i + 1]) {
+      LOG(DFATAL) << "Decreasing starts in MPSolver::AddRows().";
+      return;
+    }
+  }
+  const int num_variables = NumVariables();
+  for (const int var_index : var_indices) {
+    if (var_index < 0 || var_index >= num_variables) {
+      LOG(DFATAL) << "Invalid variable index " << var_index
+                  << " in MPSolver::AddRows().";
+      return;
+    }
+  }
+
+  constraints_.reserve(constraints_.size() + num_new_constraints);
+  constraint_is_extracted_.reserve(constraints_.size() + num_new_constraints);
+  for (int i = 0; i < num_new_constraints; ++i) {
+    const int constraint_index = NumConstraints();
+    const std::string fixed_name =
+        names.empty() || names[i].empty()
+            ? StringPrintf("auto_c_%09d", constraint_index)
+            : names[i];
+    MPConstraint* const constraint = new (constraint_arena_.Allocate())
+        MPConstraint(constraint_index, lbs[i], ubs[i], fixed_name,
+                     interface_.get());
+
+    // Same as MPConstraint::SetCoefficient(), without the calls to
+    // MPSolverInterface::SetCoefficient(): the constraint is not extracted
+    // yet, so all the interfaces read its coefficients at extraction.
+    CoeffMap* const coefficients_map = &constraint->coefficients_;
+    coefficients_map->reserve(starts[i + 1] - starts[i]);
+    for (int k = starts[i]; k < starts[i + 1]; ++k) {
+      const MPVariable* const var = variables_[var_indices[k]];
+      if (coefficients[k] == 0.0) {
+        CoeffMap::iterator it = coefficients_map->find(var);
+        if (it != coefficients_map->end()) it->second = 0.0;
+      } else {
+        (*coefficients_map)[var] = coefficients[k];
+      }
+    }
+    constraints_.push_back(constraint);
+    CHECK(constraint_name_to_index_.Insert(constraint_index))
+        << "Duplicate constraint name: " << fixed_name;
+    constraint_is_extracted_.push_back(false);
+    interface_->AddRowConstraint(constraint);
+    if (constraints != NULL) constraints->push_back(constraint);
+  }
+}
+
 MPConstraint* MPSolver::MakeRowConstraint(const std::string& name) {
   return MakeRowConstraint(-infinity(), infinity(), name);
 }
@@ -1160,8 +1359,7 @@ bool MPSolver::OwnsVariable(const MPVariable* var) const {
   if (var == NULL) return false;
   // First, verify that a variable with the same name exists, and look up
   // its index (names are unique, so there can be only one).
-  const int var_index =
-      FindWithDefault(variable_name_to_index_, var->name(), -1);
+  const int var_index = variable_name_to_index_.Find(var->name());
   if (var_index == -1) return false;
   // Then, verify that the variable with this index has the same address.
   return variables_[var_index] == var;
@@ -131,12 +131,15 @@
 #ifndef OR_TOOLS_LINEAR_SOLVER_LINEAR_SOLVER_H_
 #define OR_TOOLS_LINEAR_SOLVER_LINEAR_SOLVER_H_
 
+#include <algorithm>
+#include <condition_variable>  // NOLINT
 #include <functional>
 #include "base/hash.h"
 #include "base/hash.h"
 #include <limits>
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
 #include <utility>
 #include <vector>
@@ -152,6 +155,7 @@ namespace operations_research {
 
 class MPConstraint;
 class MPObjective;
+class MPSolveHandle;
 class MPSolverInterface;
 class MPSolverParameters;
 class MPVariable;
@@ -161,6 +165,115 @@ class MPModelProto;
 class MPModelRequest;
 class MPSolutionResponse;
 
+// The storage of the variables (or of the constraints) of an MPSolver. The
+// objects are allocated by blocks of increasing sizes, so building a model
+// with n variables only takes O(log(n)) allocations for the MPVariable
+// objects themselves, and they never move.
+template <class T>
+class MPObjectArena {
+ public:
+  MPObjectArena() : blocks_(), last_block_capacity_(0) {}
+  ~MPObjectArena() { Clear(); }
+
+  // Returns the uninitialized memory of one object. The caller must construct
+  // the object in it with a placement new before the next call.
+  void* Allocate() {
+    if (blocks_.empty() || blocks_.back().second == last_block_capacity_) {
+      last_block_capacity_ = last_block_capacity_ == 0
+                                 ? kMinBlockCapacity
+                                 : std::min(2 * last_block_capacity_,
+                                            int{kMaxBlockCapacity});
+      blocks_.push_back(std::make_pair(
+          static_cast<T*>(::operator new(last_block_capacity_ * sizeof(T))),
+          0));
+    }
+    std::pair<T*, int>* const block = &blocks_.back();
+    return block->first + block->second++;
+  }
+
+  // Destroys all the objects and frees the memory.
+  void Clear() {
+    for (const std::pair<T*, int>& block : blocks_) {
+      for (int i = 0; i < block.second; ++i) {
+        block.first[i].~T();
+      }
+      ::operator delete(block.first);
+    }
+    blocks_.clear();
+    last_block_capacity_ = 0;
+  }
+
+ private:
+  static const int kMinBlockCapacity = 64;
+  static const int kMaxBlockCapacity = 1 << 16;
+
+  // The blocks with their number of constructed objects. Only the last one
+  // can be partially filled.
+  std::vector<std::pair<T*, int> > blocks_;
+  int last_block_capacity_;
+
+  DISALLOW_COPY_AND_ASSIGN(MPObjectArena);
+};
+
+// A hash table from the names of the variables (or of the constraints) of an
+// MPSolver to their index. Contrary to a hash_map<std::string, int>, the names
+// are not copied: they are read from the objects in *objects, and a slot of
+// the table only holds an index.
+template <class T>
+class MPNameIndex {
+ public:
+  explicit MPNameIndex(const std::vector<T*>* objects)
+      : objects_(objects), size_(0), slots_(kMinNumSlots, -1) {}
+
+  // Returns the index of the object with the given name, or -1.
+  int Find(const std::string& name) const { return slots_[SlotOf(name)]; }
+
+  // Adds (*objects)[index] to the table, and returns false if an object with
+  // the same name is already there (in which case nothing is added).
+  bool Insert(int index) {
+    const int slot = SlotOf((*objects_)[index]->name());
+    if (slots_[slot] != -1) return false;
+    slots_[slot] = index;
+    ++size_;
+    if (2 * size_ > slots_.size()) {
+      std::vector<int> old_slots(2 * slots_.size(), -1);
+      slots_.swap(old_slots);
+      for (const int i : old_slots) {
+        if (i != -1) slots_[SlotOf((*objects_)[i]->name())] = i;
+      }
+    }
+    return true;
+  }
+
+  void Clear() {
+    size_ = 0;
+    slots_.assign(kMinNumSlots, -1);
+  }
+
+ private:
+  static const int kMinNumSlots = 16;
+
+  // Returns the slot containing the index of the given name, or the empty
+  // slot where it should be inserted.
+  int SlotOf(const std::string& name) const {
+    const int mask = slots_.size() - 1;
+    int slot = hash<std::string>()(name) & mask;
+    while (slots_[slot] != -1 && (*objects_)[slots_[slot]]->name() != name) {
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+
+  const std::vector<T*>* const objects_;
+  int size_;
+
+  // Open addressing with linear probing. The size is a power of two, and -1
+  // marks an empty slot.
+  std::vector<int> slots_;
+
+  DISALLOW_COPY_AND_ASSIGN(MPNameIndex);
+};
+
 // This mathematical programming (MP) solver class is the main class
 // though which users build and solve problems.
 class MPSolver {
@@ -293,6 +406,22 @@ class MPSolver {
   // Creates a named constraint with -infinity and +infinity bounds.
   MPConstraint* MakeRowConstraint(const std::string& name);
 
+  // Bulk version of MakeRowConstraint() and MPConstraint::SetCoefficient(), to
+  // build large models. The i-th new constraint has the bounds lbs[i] and
+  // ubs[i], the name names[i] (or an automatic name if names is empty), and
+  // its coefficients are coefficients[k] on the variables with index
+  // var_indices[k], for k in [starts[i], starts[i + 1]). So starts has one
+  // more element than lbs, starts[0] is 0 and the last element is the size of
+  // var_indices. The input is checked once, and nothing is added (which
+  // crashes in non-opt mode) if it is inconsistent. If constraints is not
+  // NULL, the new constraints are appended to it.
+  void AddRows(const std::vector<int>& starts,
+               const std::vector<int>& var_indices,
+               const std::vector<double>& coefficients,
+               const std::vector<double>& lbs, const std::vector<double>& ubs,
+               const std::vector<std::string>& names,
+               std::vector<MPConstraint*>* constraints);
+
   // ----- Objective -----
   // Note that the objective is owned by the solver, and is initialized to
   // its default value (see the MPObjective class below) at construction.
@@ -359,6 +488,47 @@ class MPSolver {
   // interruption is not supported; returns false and does nothing.
   bool InterruptSolve();
 
+  // ----- Solution hint -----
+
+  // Sets initial values for all or some of the variables, replacing the
+  // previous hint. They are passed to the solvers that can use them as a
+  // starting point: as a MIP start by SCIP, Gurobi, CBC and BOP. The hint is
+  // kept across Solve() calls until it is changed or cleared, and it does not
+  // need to be feasible. Each variable must appear at most once.
+  void SetHint(const std::vector<std::pair<MPVariable*, double> >& hint);
+
+  // Uses the current solution as the hint of the next Solve(). This is the
+  // usual way to warm start a sequence of similar models: call it right after
+  // a successful Solve(), then modify the model and solve again. It must be
+  // called before the model is modified, while the solution is still
+  // available; otherwise the hint is cleared.
+  void SetHintFromSolution();
+
+  // Removes the hint.
+  void ClearHint();
+
+  // ----- Asynchronous solve -----
+
+  // Called from the thread running the solve with the objective value of each
+  // new incumbent solution and the best objective bound known at that time.
+  typedef std::function<void(double objective_value,
+                             double best_objective_bound)> ProgressCallback;
+
+  // Starts Solve(param) on a pool of threads shared by all the MPSolver
+  // instances, and returns right away a handle to wait for or cancel the
+  // solve. The MPSolver, its model and param must be neither modified nor
+  // queried (except through the handle) until the solve is done, and param
+  // must outlive it.
+  //
+  // progress, if not null, is called with each new incumbent by SCIP and
+  // Gurobi, and for all solvers with the final solution when one was found.
+  //
+  // The solve can be cancelled with MPSolveHandle::Cancel(): a solve that did
+  // not start yet is skipped, and a running one is interrupted with Glop (see
+  // GLOPInterface), BOP, SCIP and Gurobi. The other solvers run to completion.
+  std::unique_ptr<MPSolveHandle> SolveAsync(const MPSolverParameters& param,
+                                            ProgressCallback progress);
+
   // ----- Methods using protocol buffers -----
 
   // Loads model from protocol buffer. Returns MPSOLVER_MODEL_IS_VALID if the
@@ -540,6 +710,7 @@ class MPSolver {
   friend class GLOPInterface;
   friend class BopInterface;
   friend class KnapsackInterface;
+  friend class MPSolveHandle;
 
   // Debugging: verify that the given MPVariable* belongs to this solver.
   bool OwnsVariable(const MPVariable* var) const;
@@ -563,17 +734,19 @@ class MPSolver {
   // The solver interface.
   std::unique_ptr<MPSolverInterface> interface_;
 
-  // The vector of variables in the problem.
+  // The vector of variables in the problem, and their storage.
   std::vector<MPVariable*> variables_;
+  MPObjectArena<MPVariable> variable_arena_;
   // A map from a variable's name to its index in variables_.
-  hash_map<std::string, int> variable_name_to_index_;
+  MPNameIndex<MPVariable> variable_name_to_index_;
   // Whether constraints have been extracted to the underlying interface.
   std::vector<bool> variable_is_extracted_;
 
-  // The vector of constraints in the problem.
+  // The vector of constraints in the problem, and their storage.
   std::vector<MPConstraint*> constraints_;
+  MPObjectArena<MPConstraint> constraint_arena_;
   // A map from a constraint's name to its index in constraints_.
-  hash_map<std::string, int> constraint_name_to_index_;
+  MPNameIndex<MPConstraint> constraint_name_to_index_;
   // Whether constraints have been extracted to the underlying interface.
   std::vector<bool> constraint_is_extracted_;
 
@@ -594,6 +767,12 @@ class MPSolver {
   // Permanent storage for SetSolverSpecificParametersAsString().
   std::string solver_specific_parameter_string_;
 
+  // Set by SolveAsync() for the duration of the solve. The interfaces that
+  // can stop on an external Boolean check interrupt_flag_, and the ones that
+  // can report incumbents call progress_callback_. Both may be null.
+  const bool* interrupt_flag_;
+  ProgressCallback progress_callback_;
+
 
   MPSolverResponseStatus LoadModelFromProtoInternal(
       const MPModelProto& input_model, bool clear_names, std::string* error_message);
@@ -609,20 +788,53 @@ inline std::ostream& operator<<(std::ostream& os,
 }
 #endif
 
+typedef std::pair<const MPVariable*, double> CoeffEntry;
+
 // The data structure used to store the coefficients of the contraints and of
-// the objective. Also define a type to facilitate iteration over them with:
+// the objective. It is a vector of entries sorted by variable index, with the
+// subset of the interface of a hash_map<const MPVariable*, double> used by the
+// solver interfaces. Iterate over it with:
 //  for (CoeffEntry entry : coefficients_) { ... }
-class CoeffMap : public hash_map<const MPVariable*, double> {
+//
+// Adding the coefficients by increasing variable index is O(1) per entry.
+// Otherwise, the insertions are O(size()), which is fine for the short rows
+// of most models.
+class CoeffMap {
  public:
-  explicit CoeffMap(int num_buckets)
-#if !defined(_MSC_VER)  // Visual C++ doesn't support this constructor
-      : hash_map<const MPVariable*, double>(num_buckets)
-#endif  // _MSC_VER
-  {
+  typedef CoeffEntry value_type;
+  typedef std::vector<CoeffEntry>::iterator iterator;
+  typedef std::vector<CoeffEntry>::const_iterator const_iterator;
+
+  CoeffMap() {}
+
+  iterator begin() { return entries_.begin(); }
+  iterator end() { return entries_.end(); }
+  const_iterator begin() const { return entries_.begin(); }
+  const_iterator end() const { return entries_.end(); }
+  int size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+  void clear() { entries_.clear(); }
+  void reserve(int size) { entries_.reserve(size); }
+
+  // Returns end() if var has no entry.
+  iterator find(const MPVariable* var);
+  const_iterator find(const MPVariable* var) const;
+
+  // Inserts the given entry if its variable has no entry yet. Returns the
+  // entry of the variable and whether it was inserted, like a std::map.
+  std::pair<iterator, bool> insert(const CoeffEntry& entry);
+
+  // Returns the coefficient of var, inserting a 0 if it has no entry.
+  double& operator[](const MPVariable* var) {
+    return insert(CoeffEntry(var, 0.0)).first->second;
   }
-};
 
-typedef std::pair<const MPVariable*, double> CoeffEntry;
+ private:
+  // Returns the first entry whose variable index is >= the one of var.
+  const_iterator LowerBound(const MPVariable* var) const;
+
+  std::vector<CoeffEntry> entries_;
+};
 
 // A class to express a linear objective.
 class MPObjective {
@@ -695,7 +907,7 @@ class MPObjective {
   // At construction, an MPObjective has no terms (which is equivalent
   // on having a coefficient of 0 for all variables), and an offset of 0.
   explicit MPObjective(MPSolverInterface* const interface)
-      : interface_(interface), coefficients_(1), offset_(0.0) {}
+      : interface_(interface), coefficients_(), offset_(0.0) {}
 
   MPSolverInterface* const interface_;
 
@@ -865,7 +1077,7 @@ class MPConstraint {
   // to several models.
   MPConstraint(int index, double lb, double ub, const std::string& name,
                MPSolverInterface* const interface)
-      : coefficients_(1),
+      : coefficients_(),
         index_(index),
         lb_(lb),
         ub_(ub),
@@ -1055,6 +1267,53 @@ class MPSolverParameters {
   DISALLOW_COPY_AND_ASSIGN(MPSolverParameters);
 };
 
+// Handle on a solve started by MPSolver::SolveAsync(). All its functions can be
+// called from any thread.
+class MPSolveHandle {
+ public:
+  // Waits for the solve to be done.
+  ~MPSolveHandle();
+
+  // Waits for the solve to be done and returns its result status, which is
+  // NOT_SOLVED if it was cancelled before it started. Once this returns, the
+  // solution can be read from the MPSolver as after MPSolver::Solve().
+  MPSolver::ResultStatus Wait();
+
+  // Same as Wait() but gives up after timeout_ms milliseconds. Returns true
+  // and sets result_status if the solve is done.
+  bool WaitFor(int64 timeout_ms, MPSolver::ResultStatus* result_status);
+
+  // Returns true once the solve is done.
+  bool IsDone() const;
+
+  // Requests the solve to stop as soon as possible, see
+  // MPSolver::SolveAsync(). The handle still has to be waited for.
+  void Cancel();
+
+ private:
+  friend class MPSolver;
+
+  enum State { PENDING, RUNNING, DONE };
+
+  MPSolveHandle(MPSolver* solver, const MPSolverParameters& param);
+
+  // Runs the solve. This is called in a thread of the shared pool.
+  void Run();
+
+  MPSolver* const solver_;
+  const MPSolverParameters& param_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable done_;
+  State state_;
+  MPSolver::ResultStatus result_status_;
+
+  // Registered as MPSolver::interrupt_flag_ during the solve.
+  bool cancelled_;
+
+  DISALLOW_COPY_AND_ASSIGN(MPSolveHandle);
+};
+
 // This class wraps the actual mathematical programming solvers. Each
 // solver (CLP, CBC, GLPK, SCIP) has its own interface class that
 // derives from this abstract class. This class is never directly
@@ -13,10 +13,16 @@
 
 #include "linear_solver/model_exporter.h"
 
+#include <zlib.h>
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <limits>
+#include <memory>
+#include <thread>  // NOLINT
 
 #include "base/commandlineflags.h"
+#include "base/file.h"
 #include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/stringprintf.h"
@@ -39,12 +45,128 @@ DEFINE_bool(lp_log_invalid_name, false,
 
 namespace operations_research {
 
+namespace {
+// Appends to a std::string.
+class StringExportSink : public MPModelExportSink {
+ public:
+  explicit StringExportSink(std::string* output) : output_(output) {}
+  bool Write(const char* data, int64 size) override {
+    output_->append(data, size);
+    return true;
+  }
+
+ private:
+  std::string* const output_;
+};
+
+class FileExportSink : public MPModelExportSink {
+ public:
+  explicit FileExportSink(File* file) : file_(file) {}
+  ~FileExportSink() override {
+    if (file_->Open()) file_->Close();
+  }
+  bool Write(const char* data, int64 size) override {
+    return file_->Write(data, size) == size;
+  }
+  bool Close() override { return file_->Close(); }
+
+ private:
+  std::unique_ptr<File> file_;
+};
+
+class GzipFileExportSink : public MPModelExportSink {
+ public:
+  explicit GzipFileExportSink(gzFile file) : file_(file) {}
+  ~GzipFileExportSink() override {
+    if (file_ != nullptr) gzclose(file_);
+  }
+  bool Write(const char* data, int64 size) override {
+    // gzwrite() takes the size as an unsigned int.
+    const int64 kMaxBlockSize = 1 << 30;
+    while (size > 0) {
+      const unsigned int block_size = std::min(size, kMaxBlockSize);
+      if (gzwrite(file_, data, block_size) != block_size) return false;
+      data += block_size;
+      size -= block_size;
+    }
+    return true;
+  }
+  bool Close() override {
+    const bool ok = gzclose(file_) == Z_OK;
+    file_ = nullptr;
+    return ok;
+  }
+
+ private:
+  gzFile file_;
+};
+}  // namespace
+
+MPModelExportSink* NewFileExportSink(const std::string& filename) {
+  if (HasSuffixString(filename, ".gz")) {
+    gzFile file = gzopen(filename.c_str(), "wb");
+    return file == nullptr ? nullptr : new GzipFileExportSink(file);
+  }
+  File* const file = File::Open(filename, "w");
+  return file == nullptr ? nullptr : new FileExportSink(file);
+}
+
+// Buffers the output of an export and gives it to the sink by blocks. It also
+// takes care of the sections of the MPS format that are omitted when they are
+// empty: the header given to StartSection() is only written right before the
+// first non-empty data given to AppendToSection().
+class MPModelProtoExporter::BufferedWriter {
+ public:
+  explicit BufferedWriter(MPModelExportSink* sink)
+      : sink_(sink), ok_(true), section_started_(true) {}
+
+  void Append(const std::string& data) {
+    buffer_ += data;
+    if (buffer_.size() >= kBlockSize) Flush();
+  }
+
+  void StartSection(const std::string& header) {
+    pending_header_ = header;
+    section_started_ = false;
+  }
+  void AppendToSection(const std::string& data) {
+    if (data.empty()) return;
+    if (!section_started_) {
+      Append(pending_header_);
+      section_started_ = true;
+    }
+    Append(data);
+  }
+  bool section_started() const { return section_started_; }
+
+  // Writes the buffered data to the sink. Returns false if this or a previous
+  // write failed, in which case nothing more is written.
+  bool Flush() {
+    if (ok_ && !buffer_.empty()) {
+      ok_ = sink_->Write(buffer_.data(), buffer_.size());
+    }
+    buffer_.clear();
+    return ok_;
+  }
+
+ private:
+  static const int kBlockSize = 4 << 20;
+
+  MPModelExportSink* const sink_;
+  std::string buffer_;
+  bool ok_;
+  std::string pending_header_;
+  bool section_started_;
+
+  DISALLOW_COPY_AND_ASSIGN(BufferedWriter);
+};
+
 MPModelProtoExporter::MPModelProtoExporter(const MPModelProto& proto)
     : proto_(proto),
       num_integer_variables_(0),
       num_binary_variables_(0),
       num_continuous_variables_(0),
-      current_mps_column_(0),
+      num_threads_(1),
       use_fixed_mps_format_(false),
       use_obfuscated_names_(false) {}
 
@@ -165,6 +287,45 @@ void MPModelProtoExporter::AppendComments(const std::string& separator,
 }
 
 namespace {
+// Enough for any double printed with printf("%+.16G").
+const int kMaxDoubleLength = 32;
+
+// The sections of the MPS format that are built serially are given to the
+// writer by blocks of about this size.
+const size_t kMpsSectionBlockSize = 1 << 20;
+
+// Writes value to buffer exactly as snprintf() with "%+.16G" (if plus_sign)
+// or "%.16G" would, and returns the number of characters written. The
+// integral values, which are the most common coefficients, are written
+// without the (slow) printf machinery.
+int FormatDouble(double value, bool plus_sign, char* buffer) {
+  // Below this, an integral value is printed by "%.16G" with all its digits
+  // and no exponent.
+  const double kMaxPlainInteger = 1e15;
+  if (value == std::floor(value) && value != 0.0 &&
+      std::abs(value) < kMaxPlainInteger) {
+    int64 n = static_cast<int64>(value);
+    int length = 0;
+    if (n < 0) {
+      buffer[length++] = '-';
+      n = -n;
+    } else if (plus_sign) {
+      buffer[length++] = '+';
+    }
+    char digits[kMaxDoubleLength];
+    int num_digits = 0;
+    while (n != 0) {
+      digits[num_digits++] = '0' + n % 10;
+      n /= 10;
+    }
+    while (num_digits > 0) buffer[length++] = digits[--num_digits];
+    buffer[length] = '\0';
+    return length;
+  }
+  return snprintf(buffer, kMaxDoubleLength, plus_sign ? "%+.16G" : "%.16G",
+                  value);
+}
+
 class LineBreaker {
  public:
   explicit LineBreaker(int max_line_size) :
@@ -213,12 +374,96 @@ bool MPModelProtoExporter::WriteLpTerm(int var_index, double coefficient,
     return false;
   }
   if (coefficient != 0.0) {
-    *output = StringPrintf("%+.16G %-s ", coefficient,
-                           exported_variable_names_[var_index].c_str());
+    char buffer[kMaxDoubleLength];
+    output->append(buffer, FormatDouble(coefficient, true, buffer));
+    *output += ' ';
+    *output += exported_variable_names_[var_index];
+    *output += ' ';
   }
   return true;
 }
 
+void MPModelProtoExporter::AppendLpConstraint(int cst_index,
+                                              std::string* output) const {
+  const MPConstraintProto& ct_proto = proto_.constraint(cst_index);
+  const std::string& name = exported_constraint_names_[cst_index];
+  LineBreaker line_breaker(FLAGS_lp_max_line_length);
+  const int kNumFormattingChars = 10;  // Overevaluated.
+  // Account for the size of the constraint name + possibly "_rhs" +
+  // the formatting characters here.
+  line_breaker.Consume(kNumFormattingChars + name.size());
+  std::string term;
+  for (int i = 0; i < ct_proto.var_index_size(); ++i) {
+    WriteLpTerm(ct_proto.var_index(i), ct_proto.coefficient(i), &term);
+    line_breaker.Append(term);
+  }
+  const double lb = ct_proto.lower_bound();
+  const double ub = ct_proto.upper_bound();
+  if (lb == ub) {
+    line_breaker.Append(StringPrintf(" = %-.16G\n", ub));
+    StrAppend(output, " ", name, ": ", line_breaker.GetOutput());
+  } else {
+    if (ub != +std::numeric_limits<double>::infinity()) {
+      std::string rhs_name = name;
+      if (lb != -std::numeric_limits<double>::infinity()) {
+        rhs_name += "_rhs";
+      }
+      StrAppend(output, " ", rhs_name, ": ", line_breaker.GetOutput());
+      const std::string relation = StringPrintf(" <= %-.16G\n", ub);
+      // Here we have to make sure we do not add the relation to the contents
+      // of line_breaker, which may be used in the subsequent clause.
+      if (!line_breaker.WillFit(relation)) StrAppend(output, "\n ");
+      StrAppend(output, relation);
+    }
+    if (lb != -std::numeric_limits<double>::infinity()) {
+      std::string lhs_name = name;
+      if (ub != +std::numeric_limits<double>::infinity()) {
+        lhs_name += "_lhs";
+      }
+      StrAppend(output, " ", lhs_name, ": ", line_breaker.GetOutput());
+      const std::string relation = StringPrintf(" >= %-.16G\n", lb);
+      if (!line_breaker.WillFit(relation)) StrAppend(output, "\n ");
+      StrAppend(output, relation);
+    }
+  }
+}
+
+void MPModelProtoExporter::FormatInParallel(
+    int num_items, const std::function<void(int, std::string*)>& format,
+    BufferedWriter* writer) const {
+  // Number of consecutive items formatted by one thread at a time. The threads
+  // are started for each round, so a chunk must be large enough to amortize
+  // this.
+  const int kChunkSize = 10000;
+  const int num_chunks = (num_items + kChunkSize - 1) / kChunkSize;
+  const int num_threads = std::max(1, std::min(num_threads_, num_chunks));
+  std::vector<std::string> outputs(num_threads);
+  const auto format_chunk = [num_items, &format, &outputs](int chunk,
+                                                           int begin) {
+    const int end = std::min(num_items, begin + kChunkSize);
+    for (int i = begin; i < end; ++i) {
+      format(i, &outputs[chunk]);
+    }
+  };
+  for (int round_begin = 0; round_begin < num_items;
+       round_begin += num_threads * kChunkSize) {
+    std::vector<std::thread> threads;
+    for (int chunk = 1; chunk < num_threads; ++chunk) {
+      const int begin = round_begin + chunk * kChunkSize;
+      if (begin >= num_items) break;
+      threads.push_back(std::thread(format_chunk, chunk, begin));
+    }
+    format_chunk(0, round_begin);
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    for (std::string& output : outputs) {
+      writer->AppendToSection(output);
+      output.clear();
+    }
+  }
+}
+
 namespace {
 bool IsBoolean(const MPVariableProto& var) {
   return var.is_integer() && ceil(var.lower_bound()) == 0.0 &&
@@ -245,6 +490,16 @@ void MPModelProtoExporter::Setup() {
 bool MPModelProtoExporter::ExportModelAsLpFormat(bool obfuscated,
                                                  std::string* output) {
   output->clear();
+  StringExportSink sink(output);
+  return ExportModelAsLpFormat(obfuscated, &sink);
+}
+
+bool MPModelProtoExporter::ExportModelAsLpFormat(bool obfuscated,
+                                                 MPModelExportSink* sink) {
+  CHECK(sink != nullptr);
+  BufferedWriter writer(sink);
+  std::string output_str;
+  std::string* const output = &output_str;
   Setup();
   exported_constraint_names_ =
       ExtractAndProcessNames(proto_.constraint(), "C", obfuscated);
@@ -256,6 +511,8 @@ bool MPModelProtoExporter::ExportModelAsLpFormat(bool obfuscated,
 
   // Objective
   StrAppend(output, proto_.maximize() ? "Maximize\n" : "Minimize\n");
+  writer.Append(output_str);
+  output->clear();
   LineBreaker obj_line_breaker(FLAGS_lp_max_line_length);
   obj_line_breaker.Append(" Obj: ");
   if (proto_.objective_offset() != 0.0) {
@@ -264,66 +521,37 @@ bool MPModelProtoExporter::ExportModelAsLpFormat(bool obfuscated,
   }
   std::vector<bool> show_variable(proto_.variable_size(),
                              FLAGS_lp_shows_unused_variables);
+  std::string term;
   for (int var_index = 0; var_index < proto_.variable_size(); ++var_index) {
     const double coeff = proto_.variable(var_index).objective_coefficient();
-    std::string term;
     if (!WriteLpTerm(var_index, coeff, &term)) {
       return false;
     }
     obj_line_breaker.Append(term);
     show_variable[var_index] = coeff != 0.0 || FLAGS_lp_shows_unused_variables;
   }
-  // Constraints
-  StrAppend(output, obj_line_breaker.GetOutput(), "\nSubject to\n");
+  // Constraints. The variable indices are checked and show_variable is
+  // updated first, so that the constraints can then be formatted in parallel.
   for (int cst_index = 0; cst_index < proto_.constraint_size(); ++cst_index) {
     const MPConstraintProto& ct_proto = proto_.constraint(cst_index);
-    const std::string& name = exported_constraint_names_[cst_index];
-    LineBreaker line_breaker(FLAGS_lp_max_line_length);
-    const int kNumFormattingChars = 10;  // Overevaluated.
-    // Account for the size of the constraint name + possibly "_rhs" +
-    // the formatting characters here.
-    line_breaker.Consume(kNumFormattingChars + name.size());
     for (int i = 0; i < ct_proto.var_index_size(); ++i) {
       const int var_index = ct_proto.var_index(i);
-      const double coeff = ct_proto.coefficient(i);
-      std::string term;
-      if (!WriteLpTerm(var_index, coeff, &term)) {
+      if (var_index < 0 || var_index >= proto_.variable_size()) {
+        LOG(DFATAL) << "Reference to out-of-bounds variable index # "
+                    << var_index;
         return false;
       }
-      line_breaker.Append(term);
       show_variable[var_index] =
-          coeff != 0.0 || FLAGS_lp_shows_unused_variables;
-    }
-    const double lb = ct_proto.lower_bound();
-    const double ub = ct_proto.upper_bound();
-    if (lb == ub) {
-      line_breaker.Append(StringPrintf(" = %-.16G\n", ub));
-      StrAppend(output, " ", name, ": ", line_breaker.GetOutput());
-    } else {
-      if (ub != +std::numeric_limits<double>::infinity()) {
-        std::string rhs_name = name;
-        if (lb != -std::numeric_limits<double>::infinity()) {
-          rhs_name += "_rhs";
-        }
-        StrAppend(output, " ", rhs_name, ": ", line_breaker.GetOutput());
-        const std::string relation = StringPrintf(" <= %-.16G\n", ub);
-        // Here we have to make sure we do not add the relation to the contents
-        // of line_breaker, which may be used in the subsequent clause.
-        if (!line_breaker.WillFit(relation)) StrAppend(output, "\n ");
-        StrAppend(output, relation);
-      }
-      if (lb != -std::numeric_limits<double>::infinity()) {
-        std::string lhs_name = name;
-        if (ub != +std::numeric_limits<double>::infinity()) {
-          lhs_name += "_lhs";
-        }
-        StrAppend(output, " ", lhs_name, ": ", line_breaker.GetOutput());
-        const std::string relation = StringPrintf(" >= %-.16G\n", lb);
-        if (!line_breaker.WillFit(relation)) StrAppend(output, "\n ");
-        StrAppend(output, relation);
-      }
+          ct_proto.coefficient(i) != 0.0 || FLAGS_lp_shows_unused_variables;
     }
   }
+  writer.Append(obj_line_breaker.GetOutput());
+  writer.Append("\nSubject to\n");
+  FormatInParallel(proto_.constraint_size(),
+                   [this](int cst_index, std::string* output) {
+                     AppendLpConstraint(cst_index, output);
+                   },
+                   &writer);
 
   // Bounds
   StringAppendF(output, "Bounds\n");
@@ -376,7 +604,8 @@ bool MPModelProtoExporter::ExportModelAsLpFormat(bool obfuscated,
     }
   }
   StringAppendF(output, "End\n");
-  return true;
+  writer.Append(output_str);
+  return writer.Flush() && sink->Close();
 }
 
 void MPModelProtoExporter::AppendMpsPair(const std::string& name, double value,
@@ -393,7 +622,23 @@ void MPModelProtoExporter::AppendMpsPair(const std::string& name, double value,
     StringAppendF(output, "  %-8s  %*s ", name.c_str(), kFixedMpsDoubleWidth,
                   value_str.c_str());
   } else {
-    StringAppendF(output, "  %-16s  %21.16G ", name.c_str(), value);
+    // Same as StringAppendF(output, "  %-16s  %21.16G ", ...), which is too
+    // slow for the COLUMNS section of large models.
+    const int kFreeMpsNameWidth = 16;
+    const int kFreeMpsDoubleWidth = 21;
+    char buffer[kMaxDoubleLength];
+    const int length = FormatDouble(value, false, buffer);
+    *output += "  ";
+    *output += name;
+    if (name.size() < kFreeMpsNameWidth) {
+      output->append(kFreeMpsNameWidth - name.size(), ' ');
+    }
+    *output += "  ";
+    if (length < kFreeMpsDoubleWidth) {
+      output->append(kFreeMpsDoubleWidth - length, ' ');
+    }
+    output->append(buffer, length);
+    *output += ' ';
   }
 }
 
@@ -410,15 +655,14 @@ void MPModelProtoExporter::AppendMpsLineHeaderWithNewLine(
   *output += "\n";
 }
 
-void MPModelProtoExporter::AppendMpsTermWithContext(const std::string& head_name,
-                                                    const std::string& name,
-                                                    double value,
-                                                    std::string* output) {
-  if (current_mps_column_ == 0) {
+void MPModelProtoExporter::AppendMpsTermWithContext(
+    const std::string& head_name, const std::string& name, double value,
+    int* current_mps_column, std::string* output) const {
+  if (*current_mps_column == 0) {
     AppendMpsLineHeader("", head_name, output);
   }
   AppendMpsPair(name, value, output);
-  AppendNewLineIfTwoColumns(output);
+  AppendNewLineIfTwoColumns(current_mps_column, output);
 }
 
 void MPModelProtoExporter::AppendMpsBound(const std::string& bound_type,
@@ -429,41 +673,48 @@ void MPModelProtoExporter::AppendMpsBound(const std::string& bound_type,
   *output += "\n";
 }
 
-void MPModelProtoExporter::AppendNewLineIfTwoColumns(std::string* output) {
-  ++current_mps_column_;
-  if (current_mps_column_ == 2) {
+void MPModelProtoExporter::AppendNewLineIfTwoColumns(
+    int* current_mps_column, std::string* output) const {
+  ++*current_mps_column;
+  if (*current_mps_column == 2) {
     *output += "\n";
-    current_mps_column_ = 0;
+    *current_mps_column = 0;
   }
 }
 
-void MPModelProtoExporter::AppendMpsColumns(bool integrality,
-    const std::vector<std::vector<std::pair<int, double>>>& transpose, std::string* output) {
-  current_mps_column_ = 0;
-  for (int var_index = 0; var_index < proto_.variable_size(); ++var_index) {
-    const MPVariableProto& var_proto = proto_.variable(var_index);
-    if (var_proto.is_integer() != integrality) continue;
-    const std::string& var_name = exported_variable_names_[var_index];
-    current_mps_column_ = 0;
-    if (var_proto.objective_coefficient() != 0.0) {
-      AppendMpsTermWithContext(var_name, "COST",
-                               var_proto.objective_coefficient(),
-                               output);
-    }
-    for (const std::pair<int, double> cst_index_and_coeff : transpose[var_index]) {
-      const std::string& cst_name =
-          exported_constraint_names_[cst_index_and_coeff.first];
-      AppendMpsTermWithContext(var_name, cst_name, cst_index_and_coeff.second,
-                               output);
-    }
-    AppendNewLineIfTwoColumns(output);
+void MPModelProtoExporter::AppendMpsColumn(int var_index,
+                                           std::string* output) const {
+  const MPVariableProto& var_proto = proto_.variable(var_index);
+  const std::string& var_name = exported_variable_names_[var_index];
+  int current_mps_column = 0;
+  if (var_proto.objective_coefficient() != 0.0) {
+    AppendMpsTermWithContext(var_name, "COST",
+                             var_proto.objective_coefficient(),
+                             &current_mps_column, output);
+  }
+  for (int64 i = transpose_starts_[var_index];
+       i < transpose_starts_[var_index + 1]; ++i) {
+    AppendMpsTermWithContext(
+        var_name, exported_constraint_names_[transpose_constraints_[i]],
+        transpose_coefficients_[i], &current_mps_column, output);
   }
+  AppendNewLineIfTwoColumns(&current_mps_column, output);
 }
 
 bool MPModelProtoExporter::ExportModelAsMpsFormat(bool fixed_format,
                                                   bool obfuscated,
                                                   std::string* output) {
   output->clear();
+  StringExportSink sink(output);
+  return ExportModelAsMpsFormat(fixed_format, obfuscated, &sink);
+}
+
+bool MPModelProtoExporter::ExportModelAsMpsFormat(bool fixed_format,
+                                                  bool obfuscated,
+                                                  MPModelExportSink* sink) {
+  CHECK(sink != nullptr);
+  BufferedWriter writer(sink);
+  std::string output;
   Setup();
   use_fixed_mps_format_ = fixed_format;
   exported_constraint_names_ =
@@ -475,150 +726,193 @@ bool MPModelProtoExporter::ExportModelAsMpsFormat(bool fixed_format,
   LOG_IF(WARNING, fixed_format && !use_fixed_mps_format_)
       << "Cannot use fixed format. Falling back to free format";
   // Comments.
-  AppendComments("*", output);
+  AppendComments("*", &output);
 
   // NAME section.
-  StringAppendF(output, "%-14s%s\n", "NAME", proto_.name().c_str());
+  StringAppendF(&output, "%-14s%s\n", "NAME", proto_.name().c_str());
 
-  // ROWS section.
-  current_mps_column_ = 0;
-  std::string rows_section;
-  AppendMpsLineHeaderWithNewLine("N", "COST", &rows_section);
+  // ROWS section. It is never empty because of the objective row.
+  output += "ROWS\n";
+  AppendMpsLineHeaderWithNewLine("N", "COST", &output);
   for (int cst_index = 0; cst_index < proto_.constraint_size(); ++cst_index) {
     const MPConstraintProto& ct_proto = proto_.constraint(cst_index);
     const double lb = ct_proto.lower_bound();
     const double ub = ct_proto.upper_bound();
     const std::string& cst_name = exported_constraint_names_[cst_index];
     if (lb == ub) {
-      AppendMpsLineHeaderWithNewLine("E", cst_name, &rows_section);
+      AppendMpsLineHeaderWithNewLine("E", cst_name, &output);
     } else if (lb == -std::numeric_limits<double>::infinity()) {
       DCHECK_NE(std::numeric_limits<double>::infinity(), ub);
-      AppendMpsLineHeaderWithNewLine("L", cst_name, &rows_section);
+      AppendMpsLineHeaderWithNewLine("L", cst_name, &output);
     } else {
       DCHECK_NE(-std::numeric_limits<double>::infinity(), lb);
-      AppendMpsLineHeaderWithNewLine("G", cst_name, &rows_section);
+      AppendMpsLineHeaderWithNewLine("G", cst_name, &output);
+    }
+    if (output.size() >= kMpsSectionBlockSize) {
+      writer.Append(output);
+      output.clear();
     }
   }
-  if (!rows_section.empty()) {
-    *output += "ROWS\n" + rows_section;
-  }
-
-  // As the information regarding a column needs to be contiguous, we create
-  // a vector associating a variable index to a vector containing the indices
-  // of the constraints where this variable appears.
-  std::vector<std::vector<std::pair<int, double>>> transpose(proto_.variable_size());
+  writer.Append(output);
+  output.clear();
+
+  // As the information regarding a column needs to be contiguous, we store
+  // the transpose of the constraint matrix, i.e. for each variable the indices
+  // of the constraints where it appears with their coefficients.
+  const int num_variables = proto_.variable_size();
+  transpose_starts_.assign(num_variables + 1, 0);
   for (int cst_index = 0; cst_index < proto_.constraint_size(); ++cst_index) {
     const MPConstraintProto& ct_proto = proto_.constraint(cst_index);
     for (int k = 0; k < ct_proto.var_index_size(); ++k) {
       const int var_index = ct_proto.var_index(k);
-      if (var_index < 0 || var_index >= proto_.variable_size()) {
+      if (var_index < 0 || var_index >= num_variables) {
         LOG(DFATAL) << "In constraint #" << cst_index << ", var_index #" << k
                     << " is " << var_index << ", which is out of bounds.";
         return false;
       }
-      const double coeff = ct_proto.coefficient(k);
-      if (coeff != 0.0) {
-        transpose[var_index].push_back(std::pair<int, double>(cst_index, coeff));
+      if (ct_proto.coefficient(k) != 0.0) ++transpose_starts_[var_index + 1];
+    }
+  }
+  for (int var_index = 0; var_index < num_variables; ++var_index) {
+    transpose_starts_[var_index + 1] += transpose_starts_[var_index];
+  }
+  transpose_constraints_.resize(transpose_starts_[num_variables]);
+  transpose_coefficients_.resize(transpose_starts_[num_variables]);
+  {
+    std::vector<int64> next_position(transpose_starts_.begin(),
+                                     transpose_starts_.end() - 1);
+    for (int cst_index = 0; cst_index < proto_.constraint_size();
+         ++cst_index) {
+      const MPConstraintProto& ct_proto = proto_.constraint(cst_index);
+      for (int k = 0; k < ct_proto.var_index_size(); ++k) {
+        const double coeff = ct_proto.coefficient(k);
+        if (coeff == 0.0) continue;
+        const int64 position = next_position[ct_proto.var_index(k)]++;
+        transpose_constraints_[position] = cst_index;
+        transpose_coefficients_[position] = coeff;
       }
     }
   }
 
-  // COLUMNS section.
-  std::string columns_section;
-  AppendMpsColumns(/*integrality=*/true, transpose, &columns_section);
-  if (!columns_section.empty()) {
-    const char* const kIntMarkerFormat = "  %-10s%-36s%-10s\n";
-    columns_section = StringPrintf(kIntMarkerFormat, "INTSTART",
-                                   "'MARKER'", "'INTORG'") + columns_section;
-    StringAppendF(&columns_section, kIntMarkerFormat,
-                  "INTEND", "'MARKER'", "'INTEND'");
-  }
-  AppendMpsColumns(/*integrality=*/false, transpose, &columns_section);
-  if (!columns_section.empty()) {
-    *output += "COLUMNS\n" + columns_section;
+  // COLUMNS section. The integer variables come first, between two markers.
+  const char* const kIntMarkerFormat = "  %-10s%-36s%-10s\n";
+  writer.StartSection("COLUMNS\n" + StringPrintf(kIntMarkerFormat, "INTSTART",
+                                                 "'MARKER'", "'INTORG'"));
+  FormatInParallel(num_variables,
+                   [this](int var_index, std::string* output) {
+                     if (proto_.variable(var_index).is_integer()) {
+                       AppendMpsColumn(var_index, output);
+                     }
+                   },
+                   &writer);
+  if (writer.section_started()) {
+    writer.Append(StringPrintf(kIntMarkerFormat, "INTEND", "'MARKER'",
+                               "'INTEND'"));
+  } else {
+    writer.StartSection("COLUMNS\n");
   }
+  FormatInParallel(num_variables,
+                   [this](int var_index, std::string* output) {
+                     if (!proto_.variable(var_index).is_integer()) {
+                       AppendMpsColumn(var_index, output);
+                     }
+                   },
+                   &writer);
+  transpose_starts_.clear();
+  transpose_constraints_.clear();
+  transpose_coefficients_.clear();
 
   // RHS (right-hand-side) section.
-  current_mps_column_ = 0;
-  std::string rhs_section;
+  int current_mps_column = 0;
+  writer.StartSection("RHS\n");
   for (int cst_index = 0; cst_index < proto_.constraint_size(); ++cst_index) {
     const MPConstraintProto& ct_proto = proto_.constraint(cst_index);
     const double lb = ct_proto.lower_bound();
     const double ub = ct_proto.upper_bound();
     const std::string& cst_name = exported_constraint_names_[cst_index];
     if (lb != -std::numeric_limits<double>::infinity()) {
-      AppendMpsTermWithContext("RHS", cst_name, lb, &rhs_section);
+      AppendMpsTermWithContext("RHS", cst_name, lb, &current_mps_column,
+                               &output);
     } else if (ub != +std::numeric_limits<double>::infinity()) {
-      AppendMpsTermWithContext("RHS", cst_name, ub, &rhs_section);
+      AppendMpsTermWithContext("RHS", cst_name, ub, &current_mps_column,
+                               &output);
+    }
+    if (output.size() >= kMpsSectionBlockSize) {
+      writer.AppendToSection(output);
+      output.clear();
     }
   }
-  AppendNewLineIfTwoColumns(&rhs_section);
-  if (!rhs_section.empty()) {
-    *output += "RHS\n" + rhs_section;
-  }
+  AppendNewLineIfTwoColumns(&current_mps_column, &output);
+  writer.AppendToSection(output);
+  output.clear();
 
   // RANGES section.
-  current_mps_column_ = 0;
-  std::string ranges_section;
+  current_mps_column = 0;
+  writer.StartSection("RANGES\n");
   for (int cst_index = 0; cst_index < proto_.constraint_size(); ++cst_index) {
     const MPConstraintProto& ct_proto = proto_.constraint(cst_index);
     const double range = fabs(ct_proto.upper_bound() - ct_proto.lower_bound());
     if (range != 0.0 && range != +std::numeric_limits<double>::infinity()) {
       const std::string& cst_name = exported_constraint_names_[cst_index];
-      AppendMpsTermWithContext("RANGE", cst_name, range, &ranges_section);
+      AppendMpsTermWithContext("RANGE", cst_name, range, &current_mps_column,
+                               &output);
+    }
+    if (output.size() >= kMpsSectionBlockSize) {
+      writer.AppendToSection(output);
+      output.clear();
     }
   }
-  AppendNewLineIfTwoColumns(&ranges_section);
-  if (!ranges_section.empty()) {
-    *output += "RANGES\n" + ranges_section;
-  }
+  AppendNewLineIfTwoColumns(&current_mps_column, &output);
+  writer.AppendToSection(output);
+  output.clear();
 
   // BOUNDS section.
-  current_mps_column_ = 0;
-  std::string bounds_section;
-  for (int var_index = 0; var_index < proto_.variable_size(); ++var_index) {
+  writer.StartSection("BOUNDS\n");
+  for (int var_index = 0; var_index < num_variables; ++var_index) {
     const MPVariableProto& var_proto = proto_.variable(var_index);
     const double lb = var_proto.lower_bound();
     const double ub = var_proto.upper_bound();
     const std::string& var_name = exported_variable_names_[var_index];
     if (var_proto.is_integer()) {
       if (IsBoolean(var_proto)) {
-        AppendMpsLineHeader("BV", "BOUND", &bounds_section);
-        StringAppendF(&bounds_section, "  %s\n", var_name.c_str());
+        AppendMpsLineHeader("BV", "BOUND", &output);
+        StringAppendF(&output, "  %s\n", var_name.c_str());
       } else {
         if (lb != 0.0) {
-          AppendMpsBound("LI", var_name, lb, &bounds_section);
+          AppendMpsBound("LI", var_name, lb, &output);
         }
         if (ub != +std::numeric_limits<double>::infinity()) {
-          AppendMpsBound("UI", var_name, ub, &bounds_section);
+          AppendMpsBound("UI", var_name, ub, &output);
         }
       }
     } else {
       if (lb == -std::numeric_limits<double>::infinity() &&
           ub == +std::numeric_limits<double>::infinity()) {
-        AppendMpsLineHeader("FR", "BOUND", &bounds_section);
-        StringAppendF(&bounds_section, "  %s\n", var_name.c_str());
+        AppendMpsLineHeader("FR", "BOUND", &output);
+        StringAppendF(&output, "  %s\n", var_name.c_str());
       } else if (lb == ub) {
-        AppendMpsBound("FX", var_name, lb, &bounds_section);
+        AppendMpsBound("FX", var_name, lb, &output);
       } else {
         if (lb != 0.0) {
-          AppendMpsBound("LO", var_name, lb, &bounds_section);
+          AppendMpsBound("LO", var_name, lb, &output);
         } else if (ub == +std::numeric_limits<double>::infinity()) {
-          AppendMpsLineHeader("PL", "BOUND", &bounds_section);
-          StringAppendF(&bounds_section, "  %s\n", var_name.c_str());
+          AppendMpsLineHeader("PL", "BOUND", &output);
+          StringAppendF(&output, "  %s\n", var_name.c_str());
         }
         if (ub != +std::numeric_limits<double>::infinity()) {
-          AppendMpsBound("UP", var_name, ub, &bounds_section);
+          AppendMpsBound("UP", var_name, ub, &output);
         }
       }
     }
+    if (output.size() >= kMpsSectionBlockSize) {
+      writer.AppendToSection(output);
+      output.clear();
+    }
   }
-  if (!bounds_section.empty()) {
-    *output += "BOUNDS\n" + bounds_section;
-  }
+  writer.AppendToSection(output);
 
-  *output += "ENDATA\n";
-  return true;
+  writer.Append("ENDATA\n");
+  return writer.Flush() && sink->Close();
 }
 
 }  // namespace operations_research
@@ -15,7 +15,10 @@
 #define OR_TOOLS_LINEAR_SOLVER_MODEL_EXPORTER_H_
 
 #include "base/hash.h"
+#include <functional>
 #include <string>
+#include <vector>
+#include "base/integral_types.h"
 #include "base/macros.h"
 #include "base/hash.h"
 
@@ -27,11 +30,36 @@ class MPVariable;
 
 class MPModelProto;
 
+// Where MPModelProtoExporter writes an exported model. The exporter buffers
+// its output and gives it to the sink in blocks of a few MB, so a model can be
+// exported to a file without ever holding the whole file contents in memory.
+class MPModelExportSink {
+ public:
+  virtual ~MPModelExportSink() {}
+
+  // Writes the given data at the end of the output. Returns false on error,
+  // which stops the export.
+  virtual bool Write(const char* data, int64 size) = 0;
+
+  // Called once at the end of a successful export. Returns false on error.
+  virtual bool Close() { return true; }
+};
+
+// Returns a new sink that writes to the given file, compressed with gzip if
+// the file name ends with ".gz". Returns nullptr if the file cannot be opened.
+// The caller takes ownership of the result.
+MPModelExportSink* NewFileExportSink(const std::string& filename);
+
 class MPModelProtoExporter {
  public:
   // The argument must live as long as this class is active.
   explicit MPModelProtoExporter(const MPModelProto& proto);
 
+  // Number of threads used to format the constraints of the LP format and the
+  // COLUMNS section of the MPS format. The output does not depend on it. The
+  // default is 1.
+  void set_num_threads(int num_threads) { num_threads_ = num_threads; }
+
   // Outputs the current model (variables, constraints, objective) as a std::string
   // encoded in the so-called "CPLEX LP file format" as generated by SCIP.
   // The LP file format is easily readable by a human.
@@ -53,6 +81,11 @@ class MPModelProtoExporter {
   // http://www.gurobi.com/documentation/5.1/reference-manual/node871
   bool ExportModelAsLpFormat(bool obfuscated, std::string* model_str);
 
+  // Same as above, but writes the model to the given sink instead. For large
+  // models, this avoids building the whole output in memory. The sink is
+  // closed if the export succeeds.
+  bool ExportModelAsLpFormat(bool obfuscated, MPModelExportSink* sink);
+
   // Outputs the current model (variables, constraints, objective) as a std::string
   // encoded in MPS file format, using the "fixed" MPS format if possible,
   // and the "free" MPS format otherwise.
@@ -83,7 +116,13 @@ class MPModelProtoExporter {
   bool ExportModelAsMpsFormat(bool fixed_format, bool obfuscated,
                               std::string* model_str);
 
+  // Same as above, but writes the model to the given sink instead.
+  bool ExportModelAsMpsFormat(bool fixed_format, bool obfuscated,
+                              MPModelExportSink* sink);
+
  private:
+  class BufferedWriter;
+
   // Computes the number of continuous, integer and binary variables.
   // Called by ExportModelAsLpFormat() and ExportModelAsMpsFormat().
   void Setup();
@@ -130,6 +169,18 @@ class MPModelProtoExporter {
   // error (for example, var_index is out of range).
   bool WriteLpTerm(int var_index, double coefficient, std::string* output) const;
 
+  // Appends the line(s) of the given constraint to "output", in "Lp" format.
+  // The variable indices must have been checked. This is called in parallel.
+  void AppendLpConstraint(int cst_index, std::string* output) const;
+
+  // Calls format(i, &block) for i in [0, num_items) and writes the blocks to
+  // the writer in order. With more than one thread, consecutive items are
+  // formatted by chunks in parallel, by rounds of one chunk per thread, so
+  // that only a few chunks of output are in memory at the same time.
+  void FormatInParallel(int num_items,
+                        const std::function<void(int, std::string*)>& format,
+                        BufferedWriter* writer) const;
+
   // Appends a pair name, value to "output", formatted to comply with the MPS
   // standard.
   void AppendMpsPair(const std::string& name, double value, std::string* output) const;
@@ -146,20 +197,20 @@ class MPModelProtoExporter {
   // Appends an MPS term in various contexts. The term consists of a head name,
   // a name, and a value. If the line is not empty, then only the pair
   // (name, value) is appended. The number of columns, limited to 2 by the MPS
-  // format is also taken care of.
+  // format is also taken care of. current_mps_column is the number of pairs
+  // already on the current MPS line.
   void AppendMpsTermWithContext(const std::string& head_name, const std::string& name,
-                                double value, std::string* output);
+                                double value, int* current_mps_column,
+                                std::string* output) const;
 
   // Appends a new-line if two columns are already present on the MPS line.
   // Used by and in complement to AppendMpsTermWithContext.
-  void AppendNewLineIfTwoColumns(std::string* output);
+  void AppendNewLineIfTwoColumns(int* current_mps_column,
+                                 std::string* output) const;
 
-  // When 'integrality' is true, appends columns corresponding to integer
-  // variables. Appends the columns for non-integer variables otherwise.
-  // The sparse matrix must be passed as a vector of columns ('transpose').
-  void AppendMpsColumns(bool integrality,
-                        const std::vector<std::vector<std::pair<int, double>>>& transpose,
-                        std::string* output);
+  // Appends the lines of the COLUMNS section of the given variable. Uses the
+  // transpose_* vectors below. This is called in parallel.
+  void AppendMpsColumn(int var_index, std::string* output) const;
 
   // Appends a line describing the bound of a variablenew-line if two columns
   // are already present on the MPS line.
@@ -184,8 +235,15 @@ class MPModelProtoExporter {
   // Number of continuous variables in proto_.
   int num_continuous_variables_;
 
-  // Current MPS file column number.
-  int current_mps_column_;
+  // The constraint matrix stored by columns, for the COLUMNS section of the
+  // MPS format: the non-zeros of the variable i are the (constraint index,
+  // coefficient) pairs of the positions [transpose_starts_[i],
+  // transpose_starts_[i + 1]) of the two other vectors.
+  std::vector<int64> transpose_starts_;
+  std::vector<int> transpose_constraints_;
+  std::vector<double> transpose_coefficients_;
+
+  int num_threads_;
 
   // True is the fixed MPS format shall be used.
   bool use_fixed_mps_format_;
@@ -132,6 +132,13 @@ class SCIPInterface : public MPSolverInterface {
   void* underlying_solver() override { return reinterpret_cast<void*>(scip_); }
 
  private:
+  // Event handler for MPSolver::SolveAsync(): reports the new incumbents to
+  // the progress callback, and interrupts the solve once it is cancelled,
+  // which is checked after each node.
+  static SCIP_DECL_EVENTINIT(AsyncEventInit);
+  static SCIP_DECL_EVENTEXIT(AsyncEventExit);
+  static SCIP_DECL_EVENTEXEC(AsyncEventExec);
+
   // Set all parameters in the underlying solver.
   void SetParameters(const MPSolverParameters& param) override;
   // Set each parameter in the underlying solver.
@@ -169,9 +176,48 @@ void SCIPInterface::Reset() {
   ResetExtractionInformation();
 }
 
+const SCIP_EVENTTYPE kAsyncEventTypes =
+    SCIP_EVENTTYPE_BESTSOLFOUND | SCIP_EVENTTYPE_NODESOLVED;
+
+// static
+SCIP_DECL_EVENTINIT(SCIPInterface::AsyncEventInit) {
+  return SCIPcatchEvent(scip, kAsyncEventTypes, eventhdlr, NULL, NULL);
+}
+
+// static
+SCIP_DECL_EVENTEXIT(SCIPInterface::AsyncEventExit) {
+  return SCIPdropEvent(scip, kAsyncEventTypes, eventhdlr, NULL, -1);
+}
+
+// static
+SCIP_DECL_EVENTEXEC(SCIPInterface::AsyncEventExec) {
+  const MPSolver* const solver =
+      reinterpret_cast<SCIPInterface*>(SCIPeventhdlrGetData(eventhdlr))
+          ->solver_;
+  if (SCIPeventGetType(event) & SCIP_EVENTTYPE_BESTSOLFOUND) {
+    if (solver->progress_callback_ != nullptr) {
+      solver->progress_callback_(
+          SCIPgetSolOrigObj(scip, SCIPeventGetSol(event)),
+          SCIPgetDualbound(scip));
+    }
+  } else if (solver->interrupt_flag_ != nullptr && *solver->interrupt_flag_) {
+    return SCIPinterruptSolve(scip);
+  }
+  return SCIP_OKAY;
+}
+
 void SCIPInterface::CreateSCIP() {
   ORTOOLS_SCIP_CALL(SCIPcreate(&scip_));
   ORTOOLS_SCIP_CALL(SCIPincludeDefaultPlugins(scip_));
+  SCIP_EVENTHDLR* async_event_handler = NULL;
+  ORTOOLS_SCIP_CALL(SCIPincludeEventhdlrBasic(
+      scip_, &async_event_handler, "mpsolver_async",
+      "Progress and cancellation of MPSolver::SolveAsync()", AsyncEventExec,
+      reinterpret_cast<SCIP_EVENTHDLRDATA*>(this)));
+  ORTOOLS_SCIP_CALL(
+      SCIPsetEventhdlrInit(scip_, async_event_handler, AsyncEventInit));
+  ORTOOLS_SCIP_CALL(
+      SCIPsetEventhdlrExit(scip_, async_event_handler, AsyncEventExit));
   // Set the emphasis to enum SCIP_PARAMEMPHASIS_FEASIBILITY. Do not print
   // the new parameter (quiet = true).
   if (FLAGS_scip_feasibility_emphasis) {
@@ -310,15 +356,24 @@ void SCIPInterface::ClearConstraint(MPConstraint* const constraint) {
   }
 }
 
-// Cached
+// Not cached if the variable has been extracted.
 void SCIPInterface::SetObjectiveCoefficient(const MPVariable* const variable,
                                             double coefficient) {
-  sync_status_ = MUST_RELOAD;
+  InvalidateSolutionSynchronization();
+  if (variable_is_extracted(variable->index())) {
+    ORTOOLS_SCIP_CALL(SCIPfreeTransform(scip_));
+    ORTOOLS_SCIP_CALL(SCIPchgVarObj(
+        scip_, scip_variables_[variable->index()], coefficient));
+  } else {
+    sync_status_ = MUST_RELOAD;
+  }
 }
 
-// Cached
+// Not cached
 void SCIPInterface::SetObjectiveOffset(double value) {
-  sync_status_ = MUST_RELOAD;
+  InvalidateSolutionSynchronization();
+  ORTOOLS_SCIP_CALL(SCIPfreeTransform(scip_));
+  ORTOOLS_SCIP_CALL(SCIPchgVarObj(scip_, objective_offset_variable_, value));
 }
 
 // Clear objective of all its terms.
@@ -500,14 +555,28 @@ MPSolver::ResultStatus SCIPInterface::Solve(const MPSolverParameters& param) {
   // Note that SCIP will only use this if it is a feasible solution.
   if (!solver_->solution_hint_.empty()) {
     const int num_vars = solver_->variables_.size();
-    if (solver_->solution_hint_.size() != num_vars) {
-      LOG(WARNING) << "SCIP currently doesn't handle partial solution hints. "
-                   << "Filling the missing positions with zeros...";
-    }
+    const bool is_partial = solver_->solution_hint_.size() != num_vars;
 
-    // We start by creating the all-zero solution.
     SCIP_SOL* solution;
-    ORTOOLS_SCIP_CALL(SCIPcreateSol(scip_, &solution, nullptr));
+    bool use_partial_solution = false;
+#if (SCIP_VERSION >= 400)
+    // A partial hint is completed by SCIP at the start of the solve, and the
+    // completed solution is tried as a MIP start.
+    use_partial_solution = is_partial;
+#else
+    if (is_partial) {
+      LOG(WARNING) << "This version of SCIP doesn't handle partial solution "
+                   << "hints. Filling the missing positions with zeros...";
+    }
+#endif  // SCIP_VERSION >= 400
+    if (use_partial_solution) {
+#if (SCIP_VERSION >= 400)
+      ORTOOLS_SCIP_CALL(SCIPcreatePartialSol(scip_, &solution, nullptr));
+#endif  // SCIP_VERSION >= 400
+    } else {
+      // We start by creating the all-zero solution.
+      ORTOOLS_SCIP_CALL(SCIPcreateSol(scip_, &solution, nullptr));
+    }
 
     // The variable representing the objective offset should always be one!!
     // See CreateSCIP().
@@ -520,18 +589,22 @@ MPSolver::ResultStatus SCIPInterface::Solve(const MPSolverParameters& param) {
           scip_, solution, scip_variables_[p.first->index()], p.second));
     }
 
-    SCIP_Bool is_feasible;
-    ORTOOLS_SCIP_CALL(SCIPcheckSol(
-        scip_, solution, /*printreason=*/FALSE, /*checkbounds=*/TRUE,
-        /*checkintegrality=*/TRUE, /*checklprows=*/TRUE, &is_feasible));
-    VLOG(1) << "Solution hint is " << (is_feasible ? "FEASIBLE" : "INFEASIBLE");
+    // A partial solution can't be checked, and can only be added.
+    if (!use_partial_solution) {
+      SCIP_Bool is_feasible;
+      ORTOOLS_SCIP_CALL(SCIPcheckSol(
+          scip_, solution, /*printreason=*/FALSE, /*checkbounds=*/TRUE,
+          /*checkintegrality=*/TRUE, /*checklprows=*/TRUE, &is_feasible));
+      VLOG(1) << "Solution hint is "
+              << (is_feasible ? "FEASIBLE" : "INFEASIBLE");
+    }
 
     // TODO(user): I more or less copied this from the SCIPreadSol() code that
     // reads a solution from a file. I am not sure what SCIPisTransformed() is
     // or what is the difference between the try and add version. In any case
     // this seems to always call SCIPaddSolFree() for now and it works.
     SCIP_Bool is_stored;
-    if (SCIPisTransformed(scip_)) {
+    if (SCIPisTransformed(scip_) && !use_partial_solution) {
       ORTOOLS_SCIP_CALL(SCIPtrySolFree(
           scip_, &solution, /*printreason=*/FALSE, /*checkbounds=*/TRUE,
           /*checkintegrality=*/TRUE, /*checklprows=*/TRUE, &is_stored));
@@ -602,6 +602,51 @@ void LinearProgram::AddSlackVariablesForFreeAndBoxedRows() {
 
 void LinearProgram::PopulateFromDual(const LinearProgram& dual,
                                      RowToColMapping* duplicated_rows) {
+  SparseMatrix transpose;
+  transpose.PopulateFromTranspose(dual.GetSparseMatrix());
+  PopulateFromDualWithTranspose(dual, &transpose, duplicated_rows);
+}
+
+void LinearProgram::PopulateFromDualAndClear(LinearProgram* dual,
+                                             RowToColMapping* duplicated_rows) {
+  // Transpose the matrix column by column, releasing each column of dual as
+  // soon as its entries are moved, so that only one copy of the coefficients
+  // exists at any time. The transpose is reused if it is already computed.
+  SparseMatrix transpose;
+  if (dual->transpose_matrix_is_consistent_) {
+    transpose.Swap(&dual->transpose_matrix_);
+    dual->transpose_matrix_is_consistent_ = false;
+    dual->matrix_.Clear();
+  } else {
+    const ColIndex num_cols = dual->num_variables();
+    const RowIndex num_rows = dual->num_constraints();
+    transpose.SetNumRows(ColToRowIndex(num_cols));
+    StrictITIVector<RowIndex, EntryIndex> row_degree(num_rows, EntryIndex(0));
+    for (ColIndex col(0); col < num_cols; ++col) {
+      for (const SparseColumn::Entry e : dual->matrix_.column(col)) {
+        ++row_degree[e.row()];
+      }
+    }
+    for (RowIndex row(0); row < num_rows; ++row) {
+      transpose.mutable_column(transpose.AppendEmptyColumn())
+          ->Reserve(row_degree[row]);
+    }
+    for (ColIndex col(0); col < num_cols; ++col) {
+      SparseColumn* const column = dual->matrix_.mutable_column(col);
+      for (const SparseColumn::Entry e : *column) {
+        transpose.mutable_column(RowToColIndex(e.row()))
+            ->SetCoefficient(ColToRowIndex(col), e.coefficient());
+      }
+      column->ClearAndRelease();
+    }
+  }
+  PopulateFromDualWithTranspose(*dual, &transpose, duplicated_rows);
+  dual->Clear();
+}
+
+void LinearProgram::PopulateFromDualWithTranspose(
+    const LinearProgram& dual, SparseMatrix* transpose,
+    RowToColMapping* duplicated_rows) {
   const ColIndex dual_num_variables = dual.num_variables();
   const RowIndex dual_num_constraints = dual.num_constraints();
   Clear();
@@ -616,11 +661,20 @@ void LinearProgram::PopulateFromDual(const LinearProgram& dual,
   SetObjectiveOffset(dual.objective_offset());
   SetObjectiveScalingFactor(dual.objective_scaling_factor());
 
+  // The rows of the dual correspond to the primal variables.
+  for (ColIndex dual_col(0); dual_col < dual_num_variables; ++dual_col) {
+    const RowIndex row = ColToRowIndex(dual_col);
+    const Fractional row_bound =
+        dual.GetObjectiveCoefficientForMinimizationVersion(dual_col);
+    SetConstraintBounds(row, row_bound, row_bound);
+  }
+
   // Create the dual variables y, with bounds depending on the type
-  // of constraints in the primal.
+  // of constraints in the primal. Their columns are the transposed rows.
   for (RowIndex dual_row(0); dual_row < dual_num_constraints; ++dual_row) {
     CreateNewVariable();
     const ColIndex col = RowToColIndex(dual_row);
+    matrix_.mutable_column(col)->Swap(transpose->mutable_column(col));
     const Fractional lower_bound = dual.constraint_lower_bounds()[dual_row];
     const Fractional upper_bound = dual.constraint_upper_bounds()[dual_row];
     if (lower_bound == upper_bound) {
@@ -662,19 +716,6 @@ void LinearProgram::PopulateFromDual(const LinearProgram& dual,
       SetCoefficient(row, col, Fractional(1.0));
     }
   }
-  // Store the transpose of the matrix.
-  for (ColIndex dual_col(0); dual_col < dual_num_variables; ++dual_col) {
-    const RowIndex row = ColToRowIndex(dual_col);
-    const Fractional row_bound =
-        dual.GetObjectiveCoefficientForMinimizationVersion(dual_col);
-    SetConstraintBounds(row, row_bound, row_bound);
-    for (const SparseColumn::Entry e : dual.GetSparseColumn(dual_col)) {
-      const RowIndex dual_row = e.row();
-      const ColIndex col = RowToColIndex(dual_row);
-      SetCoefficient(row, col, e.coefficient());
-    }
-  }
-
   // Take care of ranged constraints.
   duplicated_rows->assign(dual_num_constraints, kInvalidCol);
   for (RowIndex dual_row(0); dual_row < dual_num_constraints; ++dual_row) {
@@ -779,6 +820,94 @@ void LinearProgram::AddConstraints(
   constraint_names_.insert(constraint_names_.end(), names.begin(), names.end());
 }
 
+RowIndex LinearProgram::AddRows(const std::vector<EntryIndex>& starts,
+                                const std::vector<ColIndex>& cols,
+                                const std::vector<Fractional>& coefficients,
+                                const DenseColumn& lower_bounds,
+                                const DenseColumn& upper_bounds) {
+  const RowIndex first_new_row = num_constraints();
+  const RowIndex num_new_rows = lower_bounds.size();
+  DCHECK_EQ(num_new_rows, upper_bounds.size());
+  DCHECK_EQ(num_new_rows.value() + 1, starts.size());
+  DCHECK_EQ(cols.size(), coefficients.size());
+  DCHECK_EQ(starts.back().value(), cols.size());
+
+  // Counts the new entries of each column to reserve their storage once.
+  const ColIndex num_cols = num_variables();
+  StrictITIVector<ColIndex, EntryIndex> num_new_entries(num_cols,
+                                                        EntryIndex(0));
+  for (const ColIndex col : cols) {
+    DCHECK_GE(col, 0);
+    DCHECK_LT(col, num_cols);
+    ++num_new_entries[col];
+  }
+  for (ColIndex col(0); col < num_cols; ++col) {
+    if (num_new_entries[col] == 0) continue;
+    SparseColumn* const column = matrix_.mutable_column(col);
+    column->Reserve(column->num_entries() + num_new_entries[col]);
+  }
+
+  matrix_.SetNumRows(first_new_row + num_new_rows);
+  for (RowIndex i(0); i < num_new_rows; ++i) {
+    const RowIndex row = first_new_row + i;
+    for (EntryIndex k = starts[i.value()]; k < starts[i.value() + 1]; ++k) {
+      DCHECK(IsFinite(coefficients[k.value()]));
+      matrix_.mutable_column(cols[k.value()])
+          ->SetCoefficient(row, coefficients[k.value()]);
+    }
+  }
+  constraint_lower_bounds_.insert(constraint_lower_bounds_.end(),
+                                  lower_bounds.begin(), lower_bounds.end());
+  constraint_upper_bounds_.insert(constraint_upper_bounds_.end(),
+                                  upper_bounds.begin(), upper_bounds.end());
+  constraint_names_.resize(first_new_row + num_new_rows, "");
+  columns_are_known_to_be_clean_ = false;
+  transpose_matrix_is_consistent_ = false;
+  return first_new_row;
+}
+
+ColIndex LinearProgram::AddColumns(const std::vector<EntryIndex>& starts,
+                                   const std::vector<RowIndex>& rows,
+                                   const std::vector<Fractional>& coefficients,
+                                   const DenseRow& lower_bounds,
+                                   const DenseRow& upper_bounds,
+                                   const DenseRow& objective_coefficients) {
+  const ColIndex first_new_col = num_variables();
+  const ColIndex num_new_cols = lower_bounds.size();
+  DCHECK_EQ(num_new_cols, upper_bounds.size());
+  DCHECK_EQ(num_new_cols, objective_coefficients.size());
+  DCHECK_EQ(num_new_cols.value() + 1, starts.size());
+  DCHECK_EQ(rows.size(), coefficients.size());
+  DCHECK_EQ(starts.back().value(), rows.size());
+
+  for (ColIndex i(0); i < num_new_cols; ++i) {
+    DebugCheckBoundsValid(lower_bounds[i], upper_bounds[i]);
+    DCHECK(IsFinite(objective_coefficients[i]));
+    const ColIndex col = matrix_.AppendEmptyColumn();
+    SparseColumn* const column = matrix_.mutable_column(col);
+    const EntryIndex begin = starts[i.value()];
+    const EntryIndex end = starts[i.value() + 1];
+    column->Reserve(end - begin);
+    for (EntryIndex k = begin; k < end; ++k) {
+      DCHECK_LT(rows[k.value()], num_constraints());
+      DCHECK(IsFinite(coefficients[k.value()]));
+      column->SetCoefficient(rows[k.value()], coefficients[k.value()]);
+    }
+  }
+  objective_coefficients_.insert(objective_coefficients_.end(),
+                                 objective_coefficients.begin(),
+                                 objective_coefficients.end());
+  variable_lower_bounds_.insert(variable_lower_bounds_.end(),
+                                lower_bounds.begin(), lower_bounds.end());
+  variable_upper_bounds_.insert(variable_upper_bounds_.end(),
+                                upper_bounds.begin(), upper_bounds.end());
+  is_variable_integer_.resize(first_new_col + num_new_cols, false);
+  variable_names_.resize(first_new_col + num_new_cols, "");
+  columns_are_known_to_be_clean_ = false;
+  transpose_matrix_is_consistent_ = false;
+  return first_new_col;
+}
+
 bool LinearProgram::UpdateVariableBoundsToIntersection(
     const DenseRow& variable_lower_bounds,
     const DenseRow& variable_upper_bounds) {
@@ -359,6 +359,13 @@ class LinearProgram {
   void PopulateFromDual(const LinearProgram& linear_program,
                         RowToColMapping* duplicated_rows);
 
+  // Same as PopulateFromDual(), but consumes the given linear program, which
+  // is left empty. Its columns are released as they are transposed (or its
+  // transpose is reused if it was already computed), so its matrix is never
+  // held twice in memory.
+  void PopulateFromDualAndClear(LinearProgram* linear_program,
+                                RowToColMapping* duplicated_rows);
+
   // Populates the calling object with the given LinearProgram.
   void PopulateFromLinearProgram(const LinearProgram& linear_program);
 
@@ -380,6 +387,31 @@ class LinearProgram {
                       const DenseColumn& right_hand_sides,
                       const StrictITIVector<RowIndex, std::string>& names);
 
+  // Bulk versions of CreateNewConstraint() (resp. CreateNewVariable()) followed
+  // by the calls to SetConstraintBounds() (resp. SetVariableBounds() and
+  // SetObjectiveCoefficient()) and SetCoefficient() for each new row (resp.
+  // column). They are much faster on large linear programs since the storage
+  // of each column is only reserved once, and there are no per-entry checks.
+  //
+  // The new rows of AddRows() are given in compressed sparse row format: the
+  // entries of the i-th new row are (cols[k], coefficients[k]) for k in
+  // [starts[i], starts[i + 1]). The columns must already exist. Similarly, the
+  // new columns of AddColumns() are given in compressed sparse column format
+  // and their rows must already exist. The new rows and columns have no name,
+  // and the new columns are continuous. Both return the index of the first
+  // new row (resp. column).
+  RowIndex AddRows(const std::vector<EntryIndex>& starts,
+                   const std::vector<ColIndex>& cols,
+                   const std::vector<Fractional>& coefficients,
+                   const DenseColumn& lower_bounds,
+                   const DenseColumn& upper_bounds);
+  ColIndex AddColumns(const std::vector<EntryIndex>& starts,
+                      const std::vector<RowIndex>& rows,
+                      const std::vector<Fractional>& coefficients,
+                      const DenseRow& lower_bounds,
+                      const DenseRow& upper_bounds,
+                      const DenseRow& objective_coefficients);
+
   // Swaps the content of this LinearProgram with the one passed as argument.
   // Works in O(1).
   void Swap(LinearProgram* linear_program);
@@ -426,6 +458,12 @@ class LinearProgram {
   // Resizes all row vectors to include index 'row'.
   void ResizeRowsIfNeeded(RowIndex row);
 
+  // Implementation of PopulateFromDual() given the transpose of the matrix of
+  // linear_program. The columns of transpose are moved into this program.
+  void PopulateFromDualWithTranspose(const LinearProgram& linear_program,
+                                     SparseMatrix* transpose,
+                                     RowToColMapping* duplicated_rows);
+
   // Populates the definitions of variables, name and objective in the calling
   // linear program with the data from the given linear program. The method does
   // not touch the data structures for storing constraints.
@@ -68,6 +68,13 @@ int LPDecomposer::GetNumberOfProblems() const {
   return clusters_.size();
 }
 
+int LPDecomposer::GetNumberOfVariables(int problem_index) const {
+  MutexLock mutex_lock(&mutex_);
+  CHECK_GE(problem_index, 0);
+  CHECK_LT(problem_index, clusters_.size());
+  return clusters_[problem_index].size();
+}
+
 const LinearProgram& LPDecomposer::original_problem() const {
   MutexLock mutex_lock(&mutex_);
   return *original_problem_;
@@ -59,6 +59,10 @@ class LPDecomposer {
   // Returns the number of independent problems generated by Decompose().
   int GetNumberOfProblems() const LOCKS_EXCLUDED(mutex_);
 
+  // Returns the number of variables of the problem_index^th independent
+  // problem generated by Decompose().
+  int GetNumberOfVariables(int problem_index) const LOCKS_EXCLUDED(mutex_);
+
   // Returns the original problem, i.e. as it was before any decomposition.
   const LinearProgram& original_problem() const LOCKS_EXCLUDED(mutex_);
 
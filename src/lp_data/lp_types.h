@@ -248,11 +248,11 @@ ConstraintStatus VariableToConstraintStatus(VariableStatus status);
 // TODO(user): This should probably move into ITIVector, but note that this
 // version is more strict and does not allow any other size types nor a resize()
 // or creation with a default value.
-template <typename IntType, typename T>
-class StrictITIVector : public ITIVector<IntType, T> {
+template <typename IntType, typename T, typename Alloc = std::allocator<T> >
+class StrictITIVector : public ITIVector<IntType, T, Alloc> {
  public:
   typedef IntType IndexType; // g++ 4.8.1 needs this.
-  typedef ITIVector<IntType, T> ParentType;
+  typedef ITIVector<IntType, T, Alloc> ParentType;
 // This allows for brace initialization, which is really useful in tests.
 // It is not 'explicit' by design, so one can do vector = {...};
 #if !defined(__ANDROID__) && (!defined(_MSC_VER) || (_MSC_VER >= 1800))
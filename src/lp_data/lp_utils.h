@@ -212,6 +212,28 @@ inline void PermuteAndComputeNonZeros(
   }
 }
 
+// Same as PermuteAndComputeNonZeros() above, but the non-zero positions of the
+// input are already known and are permuted in place. The work is thus only
+// proportional to their number.
+template <typename IndexType, typename PermutationIndexType>
+inline void PermuteWithKnownNonZeros(
+    const Permutation<PermutationIndexType>& permutation,
+    StrictITIVector<IndexType, Fractional>* zero_scratchpad,
+    StrictITIVector<IndexType, Fractional>* output,
+    std::vector<IndexType>* non_zeros) {
+  DCHECK(IsAllZero(*zero_scratchpad));
+  zero_scratchpad->swap(*output);
+  output->resize(zero_scratchpad->size(), 0.0);
+  for (IndexType& index : *non_zeros) {
+    const Fractional value = (*zero_scratchpad)[index];
+    (*zero_scratchpad)[index] = 0.0;
+    const IndexType permuted_index(
+        permutation[PermutationIndexType(index.value())].value());
+    (*output)[permuted_index] = value;
+    index = permuted_index;
+  }
+}
+
 // Same algorithm as PermuteAndComputeNonZeros() above when the non-zeros are
 // not needed. This should be faster than a simple ApplyPermutation() if the
 // input vector is relatively sparse. The input is the initial value of output.
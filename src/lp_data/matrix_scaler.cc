@@ -16,6 +16,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <functional>
+#include <numeric>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "base/logging.h"
@@ -26,8 +29,53 @@
 namespace operations_research {
 namespace glop {
 
+namespace {
+// Minimum number of columns in a chunk of a parallel sweep over the matrix.
+// A sweep only does a few floating point operations per entry, and a thread is
+// started for each chunk but the first.
+const int kMinColumnsPerChunk = 4096;
+
+// Splits [0, num_cols) into contiguous chunks, at most one per thread, and
+// calls body(chunk, begin, end) on each of them in parallel. Returns the
+// number of chunks, which is 1 for small matrices.
+int RunInParallel(int num_threads, ColIndex num_cols,
+                  const std::function<void(int, ColIndex, ColIndex)>& body) {
+  const int size = num_cols.value();
+  const int num_chunks =
+      std::max(1, std::min(num_threads, size / kMinColumnsPerChunk));
+  const auto chunk_begin = [size, num_chunks](int chunk) {
+    return ColIndex(static_cast<int64>(size) * chunk / num_chunks);
+  };
+  std::vector<std::thread> threads;
+  for (int chunk = 1; chunk < num_chunks; ++chunk) {
+    threads.push_back(
+        std::thread(body, chunk, chunk_begin(chunk), chunk_begin(chunk + 1)));
+  }
+  body(0, ColIndex(0), chunk_begin(1));
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  return num_chunks;
+}
+
+// Returns the largest max(factor, 1 / factor) of the given factors, i.e. how
+// far from 1.0 the farthest factor is.
+template <class FactorVector>
+Fractional MaxFactorDeviation(const FactorVector& factors) {
+  Fractional result(1.0);
+  for (const Fractional factor : factors) {
+    result = std::max(result, std::max(factor, 1.0 / factor));
+  }
+  return result;
+}
+}  // namespace
+
 SparseMatrixScaler::SparseMatrixScaler()
-    : matrix_(nullptr), row_scale_(), col_scale_() {}
+    : matrix_(nullptr),
+      row_scale_(),
+      col_scale_(),
+      num_threads_(1),
+      max_factor_of_last_pass_(1.0) {}
 
 void SparseMatrixScaler::Init(SparseMatrix* matrix) {
   DCHECK(matrix != nullptr);
@@ -100,18 +148,23 @@ void SparseMatrixScaler::Scale() {
   if (dynamic_range < kMaxDynamicRangeForGeometricScaling) {
     const int kScalingIterations = 4;
     const Fractional kVarianceThreshold(10.0);
+    // When no factor of an iteration is farther than this from 1.0, the next
+    // iterations would barely change the matrix.
+    const Fractional kConvergedFactor(1.01);
     for (int iteration = 0; iteration < kScalingIterations; ++iteration) {
       const RowIndex num_rows_scaled = ScaleRowsGeometrically();
+      const Fractional max_row_factor = max_factor_of_last_pass_;
       const ColIndex num_cols_scaled = ScaleColumnsGeometrically();
-      const Fractional variance = VarianceOfAbsoluteValueOfNonZeros();
+      const Fractional max_col_factor = max_factor_of_last_pass_;
       VLOG(1) << "Geometric scaling iteration " << iteration
               << ". Rows scaled = " << num_rows_scaled
               << ", columns scaled = " << num_cols_scaled << "\n";
       VLOG(1) << DebugInformationString();
-      if (variance < kVarianceThreshold ||
-          (num_cols_scaled == 0 && num_rows_scaled == 0)) {
+      if ((num_cols_scaled == 0 && num_rows_scaled == 0) ||
+          std::max(max_row_factor, max_col_factor) < kConvergedFactor) {
         break;
       }
+      if (VarianceOfAbsoluteValueOfNonZeros() < kVarianceThreshold) break;
     }
   }
   RowIndex rows_equilibrated = EquilibrateRows();
@@ -153,19 +206,39 @@ void SparseMatrixScaler::ScaleColumnVector(bool up,
 
 Fractional SparseMatrixScaler::VarianceOfAbsoluteValueOfNonZeros() const {
   DCHECK(matrix_ != nullptr);
+  // The sums are computed per column in parallel, and then summed in order so
+  // that the result does not depend on the number of threads.
+  const ColIndex num_cols = matrix_->num_cols();
+  DenseRow col_sigma_square(num_cols, 0.0);
+  DenseRow col_sigma_abs(num_cols, 0.0);
+  StrictITIVector<ColIndex, int> col_n(num_cols, 0);
+  RunInParallel(num_threads_, num_cols,
+                [this, &col_sigma_square, &col_sigma_abs, &col_n](
+                    int chunk, ColIndex begin, ColIndex end) {
+                  for (ColIndex col(begin); col < end; ++col) {
+                    Fractional sigma_square(0.0);
+                    Fractional sigma_abs(0.0);
+                    int n = 0;
+                    for (const SparseColumn::Entry e : matrix_->column(col)) {
+                      const Fractional magnitude = fabs(e.coefficient());
+                      if (magnitude != 0.0) {
+                        sigma_square += magnitude * magnitude;
+                        sigma_abs += magnitude;
+                        ++n;
+                      }
+                    }
+                    col_sigma_square[col] = sigma_square;
+                    col_sigma_abs[col] = sigma_abs;
+                    col_n[col] = n;
+                  }
+                });
   Fractional sigma_square(0.0);
   Fractional sigma_abs(0.0);
   double n = 0.0;  // n is used in a calculation involving doubles.
-  const ColIndex num_cols = matrix_->num_cols();
   for (ColIndex col(0); col < num_cols; ++col) {
-    for (const SparseColumn::Entry e : matrix_->column(col)) {
-      const Fractional magnitude = fabs(e.coefficient());
-      if (magnitude != 0.0) {
-        sigma_square += magnitude * magnitude;
-        sigma_abs += magnitude;
-        ++n;
-      }
-    }
+    sigma_square += col_sigma_square[col];
+    sigma_abs += col_sigma_abs[col];
+    n += col_n[col];
   }
   if (n == 0.0) return 0.0;
   // Since we know all the population (the non-zeros) and we are not using a
@@ -181,21 +254,68 @@ Fractional SparseMatrixScaler::VarianceOfAbsoluteValueOfNonZeros() const {
 // max and min. We then scale the row (resp. column) by dividing the
 // coefficients by sqrt(min * max).
 
-RowIndex SparseMatrixScaler::ScaleRowsGeometrically() {
+void SparseMatrixScaler::ComputeRowMagnitudes(DenseColumn* min_in_row,
+                                              DenseColumn* max_in_row) {
   DCHECK(matrix_ != nullptr);
-  DenseColumn max_in_row(matrix_->num_rows(), 0.0);
-  DenseColumn min_in_row(matrix_->num_rows(), kInfinity);
+  DCHECK(max_in_row != nullptr);
+  // Each chunk of columns gets its own min and max vectors; the ones of the
+  // first chunk are the outputs. The chunks are then merged, which does not
+  // depend on their order since only min and max are involved.
+  const RowIndex num_rows = matrix_->num_rows();
   const ColIndex num_cols = matrix_->num_cols();
-  for (ColIndex col(0); col < num_cols; ++col) {
-    for (const SparseColumn::Entry e : matrix_->column(col)) {
-      const Fractional magnitude = fabs(e.coefficient());
-      const RowIndex row = e.row();
-      if (magnitude != 0.0) {
-        max_in_row[row] = std::max(max_in_row[row], magnitude);
-        min_in_row[row] = std::min(min_in_row[row], magnitude);
-      }
+  max_in_row->assign(num_rows, 0.0);
+  if (min_in_row != nullptr) min_in_row->assign(num_rows, kInfinity);
+  const int max_num_chunks = num_threads_;
+  chunk_max_in_row_.resize(max_num_chunks - 1);
+  chunk_min_in_row_.resize(min_in_row == nullptr ? 0 : max_num_chunks - 1);
+  const int num_chunks = RunInParallel(
+      num_threads_, num_cols,
+      [this, min_in_row, max_in_row](int chunk, ColIndex begin, ColIndex end) {
+        DenseColumn* const max_magnitude =
+            chunk == 0 ? max_in_row : &chunk_max_in_row_[chunk - 1];
+        DenseColumn* const min_magnitude =
+            min_in_row == nullptr
+                ? nullptr
+                : chunk == 0 ? min_in_row : &chunk_min_in_row_[chunk - 1];
+        if (chunk > 0) {
+          max_magnitude->assign(matrix_->num_rows(), 0.0);
+          if (min_magnitude != nullptr) {
+            min_magnitude->assign(matrix_->num_rows(), kInfinity);
+          }
+        }
+        for (ColIndex col(begin); col < end; ++col) {
+          for (const SparseColumn::Entry e : matrix_->column(col)) {
+            const Fractional magnitude = fabs(e.coefficient());
+            const RowIndex row = e.row();
+            if (magnitude != 0.0) {
+              (*max_magnitude)[row] =
+                  std::max((*max_magnitude)[row], magnitude);
+              if (min_magnitude != nullptr) {
+                (*min_magnitude)[row] =
+                    std::min((*min_magnitude)[row], magnitude);
+              }
+            }
+          }
+        }
+      });
+  for (int chunk = 1; chunk < num_chunks; ++chunk) {
+    const DenseColumn& chunk_max = chunk_max_in_row_[chunk - 1];
+    for (RowIndex row(0); row < num_rows; ++row) {
+      (*max_in_row)[row] = std::max((*max_in_row)[row], chunk_max[row]);
+    }
+    if (min_in_row == nullptr) continue;
+    const DenseColumn& chunk_min = chunk_min_in_row_[chunk - 1];
+    for (RowIndex row(0); row < num_rows; ++row) {
+      (*min_in_row)[row] = std::min((*min_in_row)[row], chunk_min[row]);
     }
   }
+}
+
+RowIndex SparseMatrixScaler::ScaleRowsGeometrically() {
+  DCHECK(matrix_ != nullptr);
+  DenseColumn max_in_row;
+  DenseColumn min_in_row;
+  ComputeRowMagnitudes(&min_in_row, &max_in_row);
   const RowIndex num_rows = matrix_->num_rows();
   DenseColumn scaling_factor(num_rows, 0.0);
   for (RowIndex row(0); row < num_rows; ++row) {
@@ -206,30 +326,38 @@ RowIndex SparseMatrixScaler::ScaleRowsGeometrically() {
       scaling_factor[row] = sqrt(max_in_row[row] * min_in_row[row]);
     }
   }
+  max_factor_of_last_pass_ = MaxFactorDeviation(scaling_factor);
   return ScaleMatrixRows(scaling_factor);
 }
 
 ColIndex SparseMatrixScaler::ScaleColumnsGeometrically() {
   DCHECK(matrix_ != nullptr);
-  ColIndex num_cols_scaled(0);
   const ColIndex num_cols = matrix_->num_cols();
-  for (ColIndex col(0); col < num_cols; ++col) {
-    Fractional max_in_col(0.0);
-    Fractional min_in_col(kInfinity);
-    for (const SparseColumn::Entry e : matrix_->column(col)) {
-      const Fractional magnitude = fabs(e.coefficient());
-      if (magnitude != 0.0) {
-        max_in_col = std::max(max_in_col, magnitude);
-        min_in_col = std::min(min_in_col, magnitude);
-      }
-    }
-    if (max_in_col != 0.0) {
-      const Fractional factor(sqrt(ToDouble(max_in_col * min_in_col)));
-      ScaleMatrixColumn(col, factor);
-      num_cols_scaled++;
-    }
-  }
-  return num_cols_scaled;
+  DenseRow factors(num_cols, 1.0);
+  std::vector<ColIndex> num_cols_scaled(num_threads_, ColIndex(0));
+  RunInParallel(num_threads_, num_cols,
+                [this, &factors, &num_cols_scaled](int chunk, ColIndex begin,
+                                                   ColIndex end) {
+                  for (ColIndex col(begin); col < end; ++col) {
+                    Fractional max_in_col(0.0);
+                    Fractional min_in_col(kInfinity);
+                    for (const SparseColumn::Entry e : matrix_->column(col)) {
+                      const Fractional magnitude = fabs(e.coefficient());
+                      if (magnitude != 0.0) {
+                        max_in_col = std::max(max_in_col, magnitude);
+                        min_in_col = std::min(min_in_col, magnitude);
+                      }
+                    }
+                    if (max_in_col != 0.0) {
+                      factors[col] = sqrt(ToDouble(max_in_col * min_in_col));
+                      ScaleMatrixColumn(col, factors[col]);
+                      ++num_cols_scaled[chunk];
+                    }
+                  }
+                });
+  max_factor_of_last_pass_ = MaxFactorDeviation(factors);
+  return std::accumulate(num_cols_scaled.begin(), num_cols_scaled.end(),
+                         ColIndex(0));
 }
 
 // For equilibration, we compute the maximum magnitude of non-zeros
@@ -240,17 +368,8 @@ ColIndex SparseMatrixScaler::ScaleColumnsGeometrically() {
 RowIndex SparseMatrixScaler::EquilibrateRows() {
   DCHECK(matrix_ != nullptr);
   const RowIndex num_rows = matrix_->num_rows();
-  DenseColumn max_magnitude(num_rows, 0.0);
-  const ColIndex num_cols = matrix_->num_cols();
-  for (ColIndex col(0); col < num_cols; ++col) {
-    for (const SparseColumn::Entry e : matrix_->column(col)) {
-      const Fractional magnitude = fabs(e.coefficient());
-      if (magnitude != 0.0) {
-        const RowIndex row = e.row();
-        max_magnitude[row] = std::max(max_magnitude[row], magnitude);
-      }
-    }
-  }
+  DenseColumn max_magnitude;
+  ComputeRowMagnitudes(nullptr, &max_magnitude);
   for (RowIndex row(0); row < num_rows; ++row) {
     if (max_magnitude[row] == 0.0) {
       max_magnitude[row] = 1.0;
@@ -261,16 +380,21 @@ RowIndex SparseMatrixScaler::EquilibrateRows() {
 
 ColIndex SparseMatrixScaler::EquilibrateColumns() {
   DCHECK(matrix_ != nullptr);
-  ColIndex num_cols_scaled(0);
-  const ColIndex num_cols = matrix_->num_cols();
-  for (ColIndex col(0); col < num_cols; ++col) {
-    const Fractional max_magnitude = InfinityNorm(matrix_->column(col));
-    if (max_magnitude != 0.0) {
-      ScaleMatrixColumn(col, max_magnitude);
-      num_cols_scaled++;
-    }
-  }
-  return num_cols_scaled;
+  std::vector<ColIndex> num_cols_scaled(num_threads_, ColIndex(0));
+  RunInParallel(num_threads_, matrix_->num_cols(),
+                [this, &num_cols_scaled](int chunk, ColIndex begin,
+                                         ColIndex end) {
+                  for (ColIndex col(begin); col < end; ++col) {
+                    const Fractional max_magnitude =
+                        InfinityNorm(matrix_->column(col));
+                    if (max_magnitude != 0.0) {
+                      ScaleMatrixColumn(col, max_magnitude);
+                      ++num_cols_scaled[chunk];
+                    }
+                  }
+                });
+  return std::accumulate(num_cols_scaled.begin(), num_cols_scaled.end(),
+                         ColIndex(0));
 }
 
 RowIndex SparseMatrixScaler::ScaleMatrixRows(const DenseColumn& factors) {
@@ -288,13 +412,15 @@ RowIndex SparseMatrixScaler::ScaleMatrixRows(const DenseColumn& factors) {
     }
   }
 
-  const ColIndex num_cols = matrix_->num_cols();
-  for (ColIndex col(0); col < num_cols; ++col) {
-    SparseColumn* const column = matrix_->mutable_column(col);
-    if (column != nullptr) {
-      column->ComponentWiseDivide(factors);
-    }
-  }
+  RunInParallel(num_threads_, matrix_->num_cols(),
+                [this, &factors](int chunk, ColIndex begin, ColIndex end) {
+                  for (ColIndex col(begin); col < end; ++col) {
+                    SparseColumn* const column = matrix_->mutable_column(col);
+                    if (column != nullptr) {
+                      column->ComponentWiseDivide(factors);
+                    }
+                  }
+                });
 
   return num_rows_scaled;
 }
@@ -314,17 +440,19 @@ void SparseMatrixScaler::ScaleMatrixColumn(ColIndex col, Fractional factor) {
 void SparseMatrixScaler::Unscale() {
   // Unscaling is easier than scaling since all scaling factors are stored.
   DCHECK(matrix_ != nullptr);
-  const ColIndex num_cols = matrix_->num_cols();
-  for (ColIndex col(0); col < num_cols; ++col) {
-    const Fractional column_scale = col_scale_[col];
-    DCHECK_NE(0.0, column_scale);
+  RunInParallel(num_threads_, matrix_->num_cols(),
+                [this](int chunk, ColIndex begin, ColIndex end) {
+                  for (ColIndex col(begin); col < end; ++col) {
+                    const Fractional column_scale = col_scale_[col];
+                    DCHECK_NE(0.0, column_scale);
 
-    SparseColumn* const column = matrix_->mutable_column(col);
-    if (column != nullptr) {
-      column->MultiplyByConstant(column_scale);
-      column->ComponentWiseMultiply(row_scale_);
-    }
-  }
+                    SparseColumn* const column = matrix_->mutable_column(col);
+                    if (column != nullptr) {
+                      column->MultiplyByConstant(column_scale);
+                      column->ComponentWiseMultiply(row_scale_);
+                    }
+                  }
+                });
 }
 
 }  // namespace glop
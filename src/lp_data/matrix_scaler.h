@@ -61,6 +61,7 @@
 #ifndef OR_TOOLS_LP_DATA_MATRIX_SCALER_H_
 #define OR_TOOLS_LP_DATA_MATRIX_SCALER_H_
 
+#include <algorithm>
 #include <vector>
 
 #include "base/integral_types.h"
@@ -83,9 +84,17 @@ class SparseMatrixScaler {
   void Init(SparseMatrix* matrix);
 
   // Clears the object, and puts it back into the same state as after being
-  // constructed.
+  // constructed, except for the number of threads.
   void Clear();
 
+  // Number of threads used by the sweeps over the matrix of Scale() and
+  // Unscale(). The columns are split in chunks of contiguous columns, and
+  // the rows are handled with one vector of partial results per chunk, so the
+  // result does not depend on the number of threads. The default is 1.
+  void set_num_threads(int num_threads) {
+    num_threads_ = std::max(1, num_threads);
+  }
+
   // Returns the scaling factor of the given row/col. If the given row/col is
   // outside the range of the matrix used in Init(), returns 1.0. This is to
   // simplify the use of the scaler if the matrix was extended afterwards.
@@ -139,6 +148,11 @@ class SparseMatrixScaler {
   // Used by ScaleColumnsGeometrically and EquilibrateColumns.
   void ScaleMatrixColumn(ColIndex col, Fractional factor);
 
+  // Computes the min (if min_in_row is not nullptr) and max magnitudes of the
+  // non-zeros of each row. The min of an empty row is kInfinity and its max is
+  // 0.0. Used by ScaleRowsGeometrically and EquilibrateRows.
+  void ComputeRowMagnitudes(DenseColumn* min_in_row, DenseColumn* max_in_row);
+
   // Returns a std::string containing information on the progress of the scaling
   // algorithm. This is not meant to be called in an optimized mode as it takes
   // some time to compute the displayed quantities.
@@ -153,6 +167,18 @@ class SparseMatrixScaler {
   // Array of scaling factors for each column. Indexed by column number.
   DenseRow col_scale_;
 
+  int num_threads_;
+
+  // The largest max(factor, 1 / factor) of the last call to
+  // ScaleRowsGeometrically() or ScaleColumnsGeometrically(). Scale() stops
+  // the geometric scaling when it is close to 1.0 for both.
+  Fractional max_factor_of_last_pass_;
+
+  // The partial row magnitudes of the column chunks but the first, kept to
+  // reuse their memory from one call of ComputeRowMagnitudes() to the next.
+  std::vector<DenseColumn> chunk_min_in_row_;
+  std::vector<DenseColumn> chunk_max_in_row_;
+
   DISALLOW_COPY_AND_ASSIGN(SparseMatrixScaler);
 };
 
@@ -13,6 +13,7 @@
 
 #include "lp_data/matrix_utils.h"
 #include <algorithm>
+#include <thread>  // NOLINT
 #include "base/hash.h"
 
 namespace operations_research {
@@ -107,20 +108,67 @@ ColumnFingerprint ComputeFingerprint(ColIndex col, const SparseColumn& column) {
                            inverse_dynamic_range + scaled_average);
 }
 
+// Appends to 'fingerprints' the fingerprints of the non-empty columns of
+// matrix in [begin, end).
+void AppendFingerprints(const SparseMatrix& matrix, ColIndex begin,
+                        ColIndex end,
+                        std::vector<ColumnFingerprint>* fingerprints) {
+  for (ColIndex col(begin); col < end; ++col) {
+    if (!matrix.column(col).IsEmpty()) {
+      fingerprints->push_back(ComputeFingerprint(col, matrix.column(col)));
+    }
+  }
+}
+
+// Computes the fingerprints of all the non-empty columns of matrix, in the
+// column order. The columns are split in contiguous chunks that are processed
+// by different threads if the matrix is large enough.
+std::vector<ColumnFingerprint> ComputeAllFingerprints(
+    const SparseMatrix& matrix, int num_threads) {
+  // Below this number of entries per thread, starting a thread costs more
+  // than it saves.
+  const int64 kMinNumEntriesPerThread = 100000;
+  const ColIndex num_cols = matrix.num_cols();
+  num_threads = std::min<int64>(
+      num_threads, matrix.num_entries().value() / kMinNumEntriesPerThread);
+  std::vector<ColumnFingerprint> fingerprints;
+  if (num_threads <= 1) {
+    AppendFingerprints(matrix, ColIndex(0), num_cols, &fingerprints);
+    return fingerprints;
+  }
+
+  // The chunk 0 is done by the calling thread. The chunks are concatenated in
+  // order so that the result does not depend on the number of threads.
+  std::vector<std::vector<ColumnFingerprint>> chunks(num_threads);
+  std::vector<std::thread> threads;
+  const auto chunk_begin = [num_cols, num_threads](int chunk) {
+    return ColIndex(num_cols.value() * static_cast<int64>(chunk) /
+                    num_threads);
+  };
+  for (int chunk = 1; chunk < num_threads; ++chunk) {
+    threads.push_back(std::thread(AppendFingerprints, std::cref(matrix),
+                                  chunk_begin(chunk), chunk_begin(chunk + 1),
+                                  &chunks[chunk]));
+  }
+  AppendFingerprints(matrix, ColIndex(0), chunk_begin(1), &fingerprints);
+  for (int chunk = 1; chunk < num_threads; ++chunk) {
+    threads[chunk - 1].join();
+    fingerprints.insert(fingerprints.end(), chunks[chunk].begin(),
+                        chunks[chunk].end());
+  }
+  return fingerprints;
+}
+
 }  // namespace
 
 ColMapping FindProportionalColumns(const SparseMatrix& matrix,
-                                   Fractional tolerance) {
+                                   Fractional tolerance, int num_threads) {
   const ColIndex num_cols = matrix.num_cols();
   ColMapping mapping(num_cols, kInvalidCol);
 
   // Compute the fingerprint of each columns and sort them.
-  std::vector<ColumnFingerprint> fingerprints;
-  for (ColIndex col(0); col < num_cols; ++col) {
-    if (!matrix.column(col).IsEmpty()) {
-      fingerprints.push_back(ComputeFingerprint(col, matrix.column(col)));
-    }
-  }
+  std::vector<ColumnFingerprint> fingerprints =
+      ComputeAllFingerprints(matrix, num_threads);
   std::sort(fingerprints.begin(), fingerprints.end());
 
   // Find a representative of each proportional columns class. This only
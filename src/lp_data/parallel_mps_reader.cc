@@ -0,0 +1,915 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lp_data/parallel_mps_reader.h"
+
+#include <math.h>
+#include <string.h>
+#include <zlib.h>
+#include <algorithm>
+#include <thread>  // NOLINT
+#include <vector>
+
+#if !defined(_MSC_VER)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "base/commandlineflags.h"
+#include "base/file.h"
+#include "base/numbers.h"  // for safe_strtod
+#include "base/stringpiece.h"
+#include "lp_data/lp_types.h"
+#include "lp_data/sparse_column.h"
+
+DECLARE_bool(mps_free_form);
+
+namespace operations_research {
+namespace glop {
+
+namespace {
+
+// Minimum size in bytes of the chunks of the COLUMNS section parsed by one
+// thread.
+const int64 kMinChunkSize = 1 << 20;
+
+// Same layout as in MPSReader.
+const int kNumFields = 6;
+const int kFieldStartPos[kNumFields] = {1, 4, 14, 24, 39, 49};
+const int kFieldLength[kNumFields] = {2, 8, 8, 12, 8, 12};
+
+// The contents of a file: its memory mapping if possible, otherwise a copy in
+// memory.
+class FileContents {
+ public:
+  FileContents() : mapped_data_(nullptr), mapped_size_(0), buffer_() {}
+  ~FileContents() { Unmap(); }
+
+  bool Open(const std::string& file_name);
+
+  // Replaces the contents by their decompressed version if they start with
+  // the gzip magic number. Returns false if they cannot be decompressed.
+  bool InflateIfGzipped();
+
+  const char* data() const {
+    return mapped_data_ != nullptr ? mapped_data_ : buffer_.data();
+  }
+  int64 size() const {
+    return mapped_data_ != nullptr ? mapped_size_ : buffer_.size();
+  }
+
+ private:
+  void Unmap();
+
+  const char* mapped_data_;
+  int64 mapped_size_;
+  std::string buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(FileContents);
+};
+
+void FileContents::Unmap() {
+#if !defined(_MSC_VER)
+  if (mapped_data_ != nullptr) {
+    munmap(const_cast<char*>(mapped_data_), mapped_size_);
+  }
+#endif
+  mapped_data_ = nullptr;
+  mapped_size_ = 0;
+}
+
+bool FileContents::Open(const std::string& file_name) {
+  Unmap();
+  buffer_.clear();
+#if !defined(_MSC_VER)
+  const int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+    void* const data =
+        mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      mapped_data_ = static_cast<const char*>(data);
+      mapped_size_ = file_stat.st_size;
+      madvise(data, mapped_size_, MADV_SEQUENTIAL);
+    }
+  }
+  // The mapping stays valid after the file is closed.
+  close(fd);
+  if (mapped_data_ != nullptr) return true;
+#endif
+  File* const file = File::Open(file_name, "r");
+  if (file == nullptr) return false;
+  buffer_.resize(file->Size());
+  const size_t num_read =
+      buffer_.empty() ? 0 : file->Read(&buffer_[0], buffer_.size());
+  file->Close();
+  delete file;
+  return num_read == buffer_.size();
+}
+
+bool FileContents::InflateIfGzipped() {
+  const unsigned char* const input =
+      reinterpret_cast<const unsigned char*>(data());
+  const int64 input_size = size();
+  if (input_size < 2 || input[0] != 0x1f || input[1] != 0x8b) return true;
+
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // 16 + MAX_WBITS only accepts the gzip format.
+  if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) return false;
+
+  // The input is given to zlib in blocks because avail_in is 32 bits.
+  const int64 kMaxInputBlockSize = 1 << 30;
+  const int kOutputBlockSize = 1 << 20;
+  std::string output;
+  int64 input_pos = 0;
+  int status = Z_OK;
+  while (true) {
+    if (stream.avail_in == 0 && input_pos < input_size) {
+      const int64 block_size =
+          std::min(kMaxInputBlockSize, input_size - input_pos);
+      stream.next_in = const_cast<unsigned char*>(input + input_pos);
+      stream.avail_in = block_size;
+      input_pos += block_size;
+    }
+    const size_t old_size = output.size();
+    output.resize(old_size + kOutputBlockSize);
+    stream.next_out = reinterpret_cast<unsigned char*>(&output[old_size]);
+    stream.avail_out = kOutputBlockSize;
+    status = inflate(&stream, Z_NO_FLUSH);
+    output.resize(output.size() - stream.avail_out);
+    if (status == Z_STREAM_END) {
+      if (stream.avail_in == 0 && input_pos == input_size) break;
+      // A gzip file can be the concatenation of several gzip streams.
+      status = inflateReset(&stream);
+    }
+    if (status != Z_OK) break;
+  }
+  inflateEnd(&stream);
+  if (status != Z_STREAM_END) return false;
+  Unmap();
+  buffer_.swap(output);
+  return true;
+}
+
+// A hash table that gives consecutive indices to names. The names are not
+// copied: they must outlive the table.
+class NameTable {
+ public:
+  NameTable() : names_(), slots_(16, -1) {}
+
+  // Returns the index of the given name, or -1 if it is not in the table.
+  int Find(StringPiece name) const { return slots_[SlotOf(name)]; }
+
+  // Returns the index of the given name. If it was not in the table, it is
+  // added with the index size() - 1 and *inserted is set to true.
+  int FindOrInsert(StringPiece name, bool* inserted);
+
+  int size() const { return names_.size(); }
+
+ private:
+  // Returns the slot containing the index of the given name, or the empty
+  // slot where it should be inserted.
+  int SlotOf(StringPiece name) const;
+
+  std::vector<StringPiece> names_;
+
+  // Open addressing with linear probing. The size is a power of two, and -1
+  // marks an empty slot.
+  std::vector<int> slots_;
+};
+
+int NameTable::SlotOf(StringPiece name) const {
+  // FNV-1a.
+  uint64 hash = GG_ULONGLONG(14695981039346656037);
+  for (int i = 0; i < name.size(); ++i) {
+    hash ^= static_cast<unsigned char>(name[i]);
+    hash *= GG_ULONGLONG(1099511628211);
+  }
+  const int mask = slots_.size() - 1;
+  int slot = hash & mask;
+  while (slots_[slot] != -1 && names_[slots_[slot]] != name) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+int NameTable::FindOrInsert(StringPiece name, bool* inserted) {
+  const int slot = SlotOf(name);
+  *inserted = slots_[slot] == -1;
+  if (!*inserted) return slots_[slot];
+  const int index = names_.size();
+  names_.push_back(name);
+  slots_[slot] = index;
+  if (2 * names_.size() > slots_.size()) {
+    slots_.assign(2 * slots_.size(), -1);
+    for (int i = 0; i < names_.size(); ++i) {
+      slots_[SlotOf(names_[i])] = i;
+    }
+  }
+  return index;
+}
+
+bool IsBlank(char c) { return c == ' ' || c == '\t'; }
+
+// Returns the line starting at begin, without its end of line, and sets *next
+// to the start of the following line.
+StringPiece NextLine(const char* begin, const char* end, const char** next) {
+  const char* eol =
+      static_cast<const char*>(memchr(begin, '\n', end - begin));
+  if (eol == nullptr) {
+    eol = end;
+    *next = end;
+  } else {
+    *next = eol + 1;
+  }
+  if (eol > begin && eol[-1] == '\r') --eol;
+  return StringPiece(begin, eol - begin);
+}
+
+bool IsCommentOrBlank(StringPiece line) {
+  if (!line.empty() && line[0] == '*') return true;
+  for (int i = 0; i < line.size(); ++i) {
+    if (!IsBlank(line[i])) return false;
+  }
+  return true;
+}
+
+// Same as MPSReader::SplitLineIntoFields(). Returns the number of fields, or
+// -1 if a free-form line has more than kNumFields of them. In fixed form,
+// there are always kNumFields fields, but some of them may be empty.
+int SplitLineIntoFields(StringPiece line, bool free_form, StringPiece* fields) {
+  const int size = line.size();
+  if (free_form) {
+    int num_fields = 0;
+    int i = 0;
+    while (true) {
+      while (i < size && IsBlank(line[i])) ++i;
+      if (i == size) break;
+      const int start = i;
+      while (i < size && !IsBlank(line[i])) ++i;
+      if (num_fields == kNumFields) return -1;
+      fields[num_fields++] = StringPiece(line.data() + start, i - start);
+    }
+    return num_fields;
+  }
+  for (int i = 0; i < kNumFields; ++i) {
+    const int start = std::min(kFieldStartPos[i], size);
+    int length = std::min(kFieldLength[i], size - start);
+    while (length > 0 && line[start + length - 1] == ' ') --length;
+    fields[i] = StringPiece(line.data() + start, length);
+  }
+  return kNumFields;
+}
+
+bool ParseDouble(StringPiece field, double* value) {
+  char buffer[64];
+  if (field.empty() || field.size() >= sizeof(buffer)) return false;
+  memcpy(buffer, field.data(), field.size());
+  buffer[field.size()] = '\0';
+  return safe_strtod(buffer, value);
+}
+
+// The result of parsing a chunk of the COLUMNS section. The consecutive lines
+// of the same column, not separated by a marker, form a segment.
+struct ColumnsChunk {
+  struct Segment {
+    StringPiece name;
+
+    // 1 (resp. 0) if the lines are after an INTORG (resp. INTEND) marker of
+    // the chunk, -1 if no marker was seen before them in the chunk.
+    int integer_state;
+
+    // The entries of the segment are [entries_begin, entries_end) in
+    // entry_rows and entry_values.
+    int64 entries_begin;
+    int64 entries_end;
+    bool has_objective;
+    Fractional objective;
+  };
+  std::vector<Segment> segments;
+
+  // The non-negative rows are indices in the row table of the parser. A
+  // negative row r stands for the row unknown_rows[-1 - r], which did not
+  // appear in the ROWS section.
+  std::vector<int> entry_rows;
+  std::vector<Fractional> entry_values;
+  std::vector<StringPiece> unknown_rows;
+
+  // Integer state after the last line, with the same convention as
+  // Segment::integer_state.
+  int final_integer_state;
+  int64 num_lines;
+
+  // The first error of the chunk, if error_line_in_chunk is positive. The
+  // chunk stops at its first error.
+  int64 error_line_in_chunk;
+  StringPiece error_line;
+  std::string error;
+};
+
+class MPSParser {
+ public:
+  MPSParser(bool free_form, int num_threads, bool log_errors,
+            LinearProgram* data);
+
+  // Parses the MPS contents in [begin, end) and fills the linear program.
+  // Returns false on the first error.
+  bool Parse(const char* begin, const char* end);
+
+  const std::string& problem_name() const { return problem_name_; }
+
+ private:
+  enum SectionId {
+    UNKNOWN_SECTION,
+    NAME,
+    ROWS,
+    LAZYCONS,
+    COLUMNS,
+    RHS,
+    RANGES,
+    BOUNDS,
+    ENDATA
+  };
+
+  // Logs the error if needed, and stops the parsing.
+  void ReportError(int64 line_num, StringPiece line,
+                   const std::string& message);
+  void Error(const std::string& message) {
+    ReportError(line_num_, line_, message);
+  }
+
+  // Returns the field of the current line with the given index, or an empty
+  // field if the line does not have it.
+  StringPiece Field(int index) const {
+    return index < num_fields_ ? fields_[index] : StringPiece();
+  }
+
+  // Converts a field to a double, reports an error on failure.
+  bool GetDouble(StringPiece field, Fractional* value);
+
+  RowIndex FindOrCreateRow(StringPiece name);
+  ColIndex FindOrCreateColumn(StringPiece name);
+
+  void ProcessSectionHeader(StringPiece line);
+  void ProcessDataLine();
+  void ProcessRowsLine();
+  void ProcessRhsLine();
+  void ProcessRangesLine();
+  void ProcessBoundsLine();
+
+  // Parses the COLUMNS section that starts at begin and returns the start of
+  // the next section. The section is split in chunks of whole lines that are
+  // parsed in parallel, and then merged in order.
+  const char* ProcessColumnsSection(const char* begin, const char* end);
+  void ParseColumnsChunk(const char* begin, const char* end,
+                         ColumnsChunk* chunk) const;
+  void MergeColumnsChunk(const ColumnsChunk& chunk);
+
+  void StoreRightHandSide(StringPiece row_name, StringPiece row_value);
+  void StoreRange(StringPiece row_name, StringPiece range_value);
+  void StoreBound(StringPiece bound_type_mnemonic, StringPiece column_name,
+                  StringPiece bound_value);
+
+  const bool free_form_;
+  const int num_threads_;
+  const bool log_errors_;
+  LinearProgram* const data_;
+  bool parse_success_;
+  std::string problem_name_;
+  SectionId section_;
+
+  // The current line and its fields.
+  int64 line_num_;
+  StringPiece line_;
+  StringPiece fields_[kNumFields];
+  int num_fields_;
+
+  StringPiece objective_name_;
+  NameTable row_table_;
+  NameTable column_table_;
+
+  // Same as in MPSReader.
+  DenseBooleanRow is_binary_by_default_;
+  bool has_lazy_constraints_;
+  bool in_integer_section_;
+  int num_unconstrained_rows_;
+
+  DISALLOW_COPY_AND_ASSIGN(MPSParser);
+};
+
+MPSParser::MPSParser(bool free_form, int num_threads, bool log_errors,
+                     LinearProgram* data)
+    : free_form_(free_form),
+      num_threads_(std::max(1, num_threads)),
+      log_errors_(log_errors),
+      data_(data),
+      parse_success_(true),
+      problem_name_(),
+      section_(UNKNOWN_SECTION),
+      line_num_(0),
+      line_(),
+      num_fields_(0),
+      objective_name_(),
+      row_table_(),
+      column_table_(),
+      is_binary_by_default_(),
+      has_lazy_constraints_(false),
+      in_integer_section_(false),
+      num_unconstrained_rows_(0) {}
+
+void MPSParser::ReportError(int64 line_num, StringPiece line,
+                            const std::string& message) {
+  if (log_errors_) {
+    LOG(ERROR) << "At line " << line_num << ": " << message
+               << ". (Line contents: " << line.as_string() << ").";
+  }
+  parse_success_ = false;
+}
+
+bool MPSParser::GetDouble(StringPiece field, Fractional* value) {
+  double result;
+  if (!ParseDouble(field, &result)) {
+    Error("Failed to convert '" + field.as_string() + "' to double");
+    return false;
+  }
+  *value = result;
+  return true;
+}
+
+RowIndex MPSParser::FindOrCreateRow(StringPiece name) {
+  bool inserted;
+  const RowIndex row(row_table_.FindOrInsert(name, &inserted));
+  if (inserted) {
+    DCHECK_EQ(row, data_->num_constraints());
+    data_->CreateNewConstraint();
+    data_->SetConstraintName(row, name.as_string());
+  }
+  return row;
+}
+
+ColIndex MPSParser::FindOrCreateColumn(StringPiece name) {
+  bool inserted;
+  const ColIndex col(column_table_.FindOrInsert(name, &inserted));
+  if (inserted) {
+    DCHECK_EQ(col, data_->num_variables());
+    data_->CreateNewVariable();
+    data_->SetVariableName(col, name.as_string());
+    is_binary_by_default_.push_back(false);
+  }
+  return col;
+}
+
+bool MPSParser::Parse(const char* begin, const char* end) {
+  const char* next = begin;
+  while (next < end && parse_success_) {
+    line_ = NextLine(next, end, &next);
+    ++line_num_;
+    if (IsCommentOrBlank(line_)) continue;
+    if (!IsBlank(line_[0])) {
+      ProcessSectionHeader(line_);
+      if (parse_success_ && section_ == COLUMNS) {
+        next = ProcessColumnsSection(next, end);
+      }
+      continue;
+    }
+    num_fields_ = SplitLineIntoFields(line_, free_form_, fields_);
+    if (num_fields_ < 0) {
+      Error("Too many fields");
+      break;
+    }
+    ProcessDataLine();
+  }
+  if (num_unconstrained_rows_ > 0) {
+    LOG(INFO) << "There are " << num_unconstrained_rows_ + 1
+              << " unconstrained rows. The first of them ("
+              << objective_name_.as_string()
+              << ") was used as the objective.";
+  }
+  return parse_success_;
+}
+
+void MPSParser::ProcessSectionHeader(StringPiece line) {
+  int first_word_size = 0;
+  while (first_word_size < line.size() && !IsBlank(line[first_word_size])) {
+    ++first_word_size;
+  }
+  const StringPiece section(line.data(), first_word_size);
+  section_ = section == "NAME"       ? NAME
+             : section == "ROWS"     ? ROWS
+             : section == "LAZYCONS" ? LAZYCONS
+             : section == "COLUMNS"  ? COLUMNS
+             : section == "RHS"      ? RHS
+             : section == "RANGES"   ? RANGES
+             : section == "BOUNDS"   ? BOUNDS
+             : section == "ENDATA"   ? ENDATA
+                                     : UNKNOWN_SECTION;
+  if (section_ == UNKNOWN_SECTION) {
+    Error("Unknown section: " + section.as_string());
+    return;
+  }
+  if (section_ == NAME) {
+    num_fields_ = SplitLineIntoFields(line, free_form_, fields_);
+    problem_name_ = Field(free_form_ ? 1 : 2).as_string();
+  }
+}
+
+void MPSParser::ProcessDataLine() {
+  switch (section_) {
+    case NAME:
+      Error("Second NAME field");
+      break;
+    case LAZYCONS:
+      if (!has_lazy_constraints_) {
+        LOG(WARNING) << "LAZYCONS section detected. It will be handled as an "
+                        "extension of the ROWS section.";
+        has_lazy_constraints_ = true;
+      }
+      ProcessRowsLine();
+      break;
+    case ROWS:
+      ProcessRowsLine();
+      break;
+    case RHS:
+      ProcessRhsLine();
+      break;
+    case RANGES:
+      ProcessRangesLine();
+      break;
+    case BOUNDS:
+      ProcessBoundsLine();
+      break;
+    case ENDATA:  // Do nothing.
+      break;
+    case COLUMNS:  // Handled by ProcessColumnsSection().
+    case UNKNOWN_SECTION:
+    default:
+      Error("Line outside of a known section");
+      break;
+  }
+}
+
+void MPSParser::ProcessRowsLine() {
+  const StringPiece row_type_name = Field(0);
+  const StringPiece row_name = Field(1);
+  if (row_type_name != "E" && row_type_name != "L" && row_type_name != "G" &&
+      row_type_name != "N") {
+    Error("Unknown row type " + row_type_name.as_string());
+    return;
+  }
+
+  // The first N constraint is used as the objective.
+  if (row_type_name == "N" && objective_name_.empty()) {
+    objective_name_ = row_name;
+    return;
+  }
+  if (row_type_name == "N") ++num_unconstrained_rows_;
+  const RowIndex row = FindOrCreateRow(row_name);
+
+  // The initial row range is [0, 0]. We encode the type in the range by
+  // setting one of the bound to +/- infinity.
+  if (row_type_name == "L") {
+    data_->SetConstraintBounds(row, -kInfinity,
+                               data_->constraint_upper_bounds()[row]);
+  } else if (row_type_name == "G") {
+    data_->SetConstraintBounds(row, data_->constraint_lower_bounds()[row],
+                               kInfinity);
+  } else if (row_type_name == "N") {
+    data_->SetConstraintBounds(row, -kInfinity, kInfinity);
+  }
+}
+
+const char* MPSParser::ProcessColumnsSection(const char* begin,
+                                             const char* end) {
+  // The section ends at the first line that starts a new section.
+  const char* section_end = begin;
+  while (section_end < end) {
+    const char c = *section_end;
+    if (!IsBlank(c) && c != '*' && c != '\n' && c != '\r') break;
+    NextLine(section_end, end, &section_end);
+  }
+
+  // Splits the section in chunks of whole lines.
+  const int64 size = section_end - begin;
+  const int num_chunks =
+      std::max(int64{1}, std::min<int64>(num_threads_, size / kMinChunkSize));
+  std::vector<const char*> chunk_starts(num_chunks + 1, section_end);
+  chunk_starts[0] = begin;
+  for (int i = 1; i < num_chunks; ++i) {
+    const char* start =
+        std::max(chunk_starts[i - 1], begin + size * i / num_chunks);
+    if (start > begin && start[-1] != '\n') {
+      const char* const eol = static_cast<const char*>(
+          memchr(start, '\n', section_end - start));
+      start = eol == nullptr ? section_end : eol + 1;
+    }
+    chunk_starts[i] = start;
+  }
+
+  std::vector<ColumnsChunk> chunks(num_chunks);
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_chunks; ++i) {
+    threads.push_back(std::thread(&MPSParser::ParseColumnsChunk, this,
+                                  chunk_starts[i], chunk_starts[i + 1],
+                                  &chunks[i]));
+  }
+  ParseColumnsChunk(chunk_starts[0], chunk_starts[1], &chunks[0]);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  // The merge is sequential so that the indices of the columns, and of the
+  // rows that only appear in the COLUMNS section, do not depend on the number
+  // of chunks.
+  for (int i = 0; i < num_chunks && parse_success_; ++i) {
+    MergeColumnsChunk(chunks[i]);
+    line_num_ += chunks[i].num_lines;
+    chunks[i] = ColumnsChunk();
+  }
+  return section_end;
+}
+
+void MPSParser::ParseColumnsChunk(const char* begin, const char* end,
+                                  ColumnsChunk* chunk) const {
+  chunk->final_integer_state = -1;
+  chunk->num_lines = 0;
+  chunk->error_line_in_chunk = 0;
+  NameTable unknown_rows;
+  StringPiece fields[kNumFields];
+  const int start_index = free_form_ ? 0 : 1;
+  bool start_new_segment = true;
+  const char* next = begin;
+  while (next < end) {
+    const StringPiece line = NextLine(next, end, &next);
+    ++chunk->num_lines;
+    if (IsCommentOrBlank(line)) continue;
+
+    // Take into account the INTORG and INTEND markers.
+    if (line.find("'MARKER'") != StringPiece::npos) {
+      if (line.find("'INTORG'") != StringPiece::npos) {
+        chunk->final_integer_state = 1;
+      } else if (line.find("'INTEND'") != StringPiece::npos) {
+        chunk->final_integer_state = 0;
+      }
+      start_new_segment = true;
+      continue;
+    }
+    const int num_fields = SplitLineIntoFields(line, free_form_, fields);
+    if (num_fields <= start_index) {
+      chunk->error_line_in_chunk = chunk->num_lines;
+      chunk->error_line = line;
+      chunk->error = num_fields < 0 ? "Too many fields" : "Missing column name";
+      return;
+    }
+    const StringPiece column_name = fields[start_index];
+    if (start_new_segment || chunk->segments.back().name != column_name) {
+      ColumnsChunk::Segment segment;
+      segment.name = column_name;
+      segment.integer_state = chunk->final_integer_state;
+      segment.entries_begin = chunk->entry_rows.size();
+      segment.entries_end = chunk->entry_rows.size();
+      segment.has_objective = false;
+      segment.objective = 0.0;
+      chunk->segments.push_back(segment);
+      start_new_segment = false;
+    }
+    ColumnsChunk::Segment* const segment = &chunk->segments.back();
+
+    // Each line contains one or two (row name, value) pairs.
+    for (int field = start_index + 1; field < num_fields; field += 2) {
+      const StringPiece row_name = fields[field];
+      if (row_name.empty() || row_name == "$") continue;
+      double value;
+      const StringPiece row_value =
+          field + 1 < num_fields ? fields[field + 1] : StringPiece();
+      if (!ParseDouble(row_value, &value)) {
+        chunk->error_line_in_chunk = chunk->num_lines;
+        chunk->error_line = line;
+        chunk->error =
+            "Failed to convert '" + row_value.as_string() + "' to double";
+        return;
+      }
+      if (value == 0.0) continue;
+      if (row_name == objective_name_) {
+        segment->has_objective = true;
+        segment->objective = value;
+        continue;
+      }
+      int row = row_table_.Find(row_name);
+      if (row < 0) {
+        bool inserted;
+        row = -1 - unknown_rows.FindOrInsert(row_name, &inserted);
+        if (inserted) chunk->unknown_rows.push_back(row_name);
+      }
+      chunk->entry_rows.push_back(row);
+      chunk->entry_values.push_back(value);
+    }
+    segment->entries_end = chunk->entry_rows.size();
+  }
+}
+
+void MPSParser::MergeColumnsChunk(const ColumnsChunk& chunk) {
+  std::vector<RowIndex> unknown_rows;
+  for (const StringPiece name : chunk.unknown_rows) {
+    unknown_rows.push_back(FindOrCreateRow(name));
+  }
+  for (const ColumnsChunk::Segment& segment : chunk.segments) {
+    const bool is_integer = segment.integer_state == -1
+                                ? in_integer_section_
+                                : segment.integer_state == 1;
+    const ColIndex col = FindOrCreateColumn(segment.name);
+    if (is_integer) {
+      data_->SetVariableIntegrality(col, true);
+      // The default bounds for integer variables are [0, 1].
+      data_->SetVariableBounds(col, 0.0, 1.0);
+      is_binary_by_default_[col] = true;
+    } else {
+      data_->SetVariableBounds(col, 0.0, kInfinity);
+    }
+    if (segment.has_objective) {
+      data_->SetObjectiveCoefficient(col, segment.objective);
+    }
+    if (segment.entries_end == segment.entries_begin) continue;
+    SparseColumn* const column = data_->GetMutableSparseColumn(col);
+    for (int64 i = segment.entries_begin; i < segment.entries_end; ++i) {
+      const int row = chunk.entry_rows[i];
+      column->SetCoefficient(row >= 0 ? RowIndex(row) : unknown_rows[-1 - row],
+                             chunk.entry_values[i]);
+    }
+  }
+  if (chunk.final_integer_state != -1) {
+    in_integer_section_ = chunk.final_integer_state == 1;
+  }
+  if (chunk.error_line_in_chunk > 0) {
+    ReportError(line_num_ + chunk.error_line_in_chunk, chunk.error_line,
+                chunk.error);
+  }
+}
+
+void MPSParser::ProcessRhsLine() {
+  const int start_index = free_form_ ? 0 : 2;
+  const int offset = start_index + (free_form_ ? num_fields_ & 1 : 0);
+  StoreRightHandSide(Field(offset), Field(offset + 1));
+  if (num_fields_ - start_index >= 4) {
+    StoreRightHandSide(Field(offset + 2), Field(offset + 3));
+  }
+}
+
+void MPSParser::ProcessRangesLine() {
+  const int start_index = free_form_ ? 0 : 2;
+  const int offset = start_index + (free_form_ ? num_fields_ & 1 : 0);
+  StoreRange(Field(offset), Field(offset + 1));
+  if (num_fields_ - start_index >= 4) {
+    StoreRange(Field(offset + 2), Field(offset + 3));
+  }
+}
+
+void MPSParser::ProcessBoundsLine() {
+  StoreBound(Field(0), Field(2), Field(3));
+}
+
+void MPSParser::StoreRightHandSide(StringPiece row_name,
+                                   StringPiece row_value) {
+  if (row_name.empty() || row_name == objective_name_) return;
+  const RowIndex row = FindOrCreateRow(row_name);
+  Fractional value;
+  if (!GetDouble(row_value, &value)) return;
+
+  // The row type is encoded in the bounds, so at this point we have either
+  // (-kInfinity, 0.0], [0.0, 0.0] or [0.0, kInfinity). We use the right
+  // hand side to change any finite bound.
+  const Fractional lower_bound =
+      (data_->constraint_lower_bounds()[row] == -kInfinity) ? -kInfinity
+                                                            : value;
+  const Fractional upper_bound =
+      (data_->constraint_upper_bounds()[row] == kInfinity) ? kInfinity
+                                                           : value;
+  data_->SetConstraintBounds(row, lower_bound, upper_bound);
+}
+
+void MPSParser::StoreRange(StringPiece row_name, StringPiece range_value) {
+  if (row_name.empty()) return;
+  const RowIndex row = FindOrCreateRow(row_name);
+  Fractional range;
+  if (!GetDouble(range_value, &range)) return;
+
+  Fractional lower_bound = data_->constraint_lower_bounds()[row];
+  Fractional upper_bound = data_->constraint_upper_bounds()[row];
+  if (lower_bound == upper_bound) {
+    if (range < 0.0) {
+      lower_bound += range;
+    } else {
+      upper_bound += range;
+    }
+  }
+  if (lower_bound == -kInfinity) {
+    lower_bound = upper_bound - fabs(range);
+  }
+  if (upper_bound == kInfinity) {
+    upper_bound = lower_bound + fabs(range);
+  }
+  data_->SetConstraintBounds(row, lower_bound, upper_bound);
+}
+
+void MPSParser::StoreBound(StringPiece bound_type_mnemonic,
+                           StringPiece column_name, StringPiece bound_value) {
+  const StringPiece type = bound_type_mnemonic;
+  if (type != "LO" && type != "UP" && type != "FX" && type != "FR" &&
+      type != "MI" && type != "PL" && type != "BV" && type != "LI" &&
+      type != "UI") {
+    Error("Unknown bound type " + type.as_string());
+    return;
+  }
+  const ColIndex col = FindOrCreateColumn(column_name);
+  if (type == "BV" || type == "LI" || type == "UI") {
+    data_->SetVariableIntegrality(col, true);
+  }
+  // Check that "binary by default" implies "integer".
+  DCHECK(!is_binary_by_default_[col] || data_->is_variable_integer()[col]);
+  Fractional lower_bound = data_->variable_lower_bounds()[col];
+  Fractional upper_bound = data_->variable_upper_bounds()[col];
+  // If a variable is binary by default, its status is reset if any bound
+  // is set on it. We take care to restore the default bounds for general
+  // integer variables.
+  if (is_binary_by_default_[col]) {
+    lower_bound = Fractional(0.0);
+    upper_bound = kInfinity;
+  }
+  if (type == "LO" || type == "LI") {
+    if (!GetDouble(bound_value, &lower_bound)) return;
+  } else if (type == "UP" || type == "UI") {
+    if (!GetDouble(bound_value, &upper_bound)) return;
+  } else if (type == "FX") {
+    Fractional value;
+    if (!GetDouble(bound_value, &value)) return;
+    lower_bound = value;
+    upper_bound = value;
+  } else if (type == "FR") {
+    lower_bound = -kInfinity;
+    upper_bound = +kInfinity;
+  } else if (type == "MI") {
+    lower_bound = -kInfinity;
+    upper_bound = Fractional(0.0);
+  } else if (type == "PL") {
+    lower_bound = Fractional(0.0);
+    upper_bound = +kInfinity;
+  } else if (type == "BV") {
+    lower_bound = Fractional(0.0);
+    upper_bound = Fractional(1.0);
+  }
+  is_binary_by_default_[col] = false;
+  data_->SetVariableBounds(col, lower_bound, upper_bound);
+}
+
+}  // namespace
+
+ParallelMPSReader::ParallelMPSReader()
+    : free_form_(FLAGS_mps_free_form),
+      num_threads_(std::max(1u, std::thread::hardware_concurrency())),
+      log_errors_(true),
+      problem_name_() {}
+
+bool ParallelMPSReader::LoadFile(const std::string& file_name,
+                                 LinearProgram* data) {
+  FileContents contents;
+  if (!contents.Open(file_name)) {
+    if (log_errors_) LOG(ERROR) << "Cannot read file: " << file_name;
+    return false;
+  }
+  if (!contents.InflateIfGzipped()) {
+    if (log_errors_) LOG(ERROR) << "Corrupted gzip file: " << file_name;
+    return false;
+  }
+  return LoadFromBuffer(contents.data(), contents.size(), data);
+}
+
+bool ParallelMPSReader::LoadFromBuffer(const char* buffer, int64 size,
+                                       LinearProgram* data) {
+  if (data == nullptr) {
+    LOG(ERROR) << "Serious programming error: NULL LinearProgram pointer "
+               << "passed as argument.";
+    return false;
+  }
+  data->Clear();
+  MPSParser parser(free_form_, num_threads_, log_errors_, data);
+  const bool success = parser.Parse(buffer, buffer + size);
+  problem_name_ = parser.problem_name();
+  data->CleanUp();
+  return success;
+}
+
+}  // namespace glop
+}  // namespace operations_research
@@ -0,0 +1,81 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// A reader for large MPS files. It accepts the same files as MPSReader and
+// builds the same LinearProgram, but:
+// - The file is memory-mapped (or inflated in memory if it is gzipped) and
+//   the fields are parsed in place as StringPieces: no std::string is created
+//   per line or per field, and the names are only copied once, into the
+//   LinearProgram.
+// - The names are looked up in hash tables of StringPieces pointing into the
+//   file contents.
+// - The COLUMNS section, which holds almost all the data of a large file, is
+//   split into chunks of whole lines that are parsed by several threads. The
+//   chunks are then merged in order, so the result does not depend on the
+//   number of threads.
+//
+// Contrary to MPSReader, the variables and constraints are created without an
+// id, i.e. LinearProgram::FindOrCreateVariable() and FindOrCreateConstraint()
+// do not know about them. Their names are set as usual.
+
+#ifndef OR_TOOLS_LP_DATA_PARALLEL_MPS_READER_H_
+#define OR_TOOLS_LP_DATA_PARALLEL_MPS_READER_H_
+
+#include <string>
+
+#include "base/integral_types.h"
+#include "base/logging.h"
+#include "lp_data/lp_data.h"
+
+namespace operations_research {
+namespace glop {
+
+class ParallelMPSReader {
+ public:
+  ParallelMPSReader();
+
+  // Loads the given fixed-form (or free-form, see set_free_form()) MPS file.
+  // Files compressed with gzip are detected from their first bytes. Returns
+  // false if the file cannot be read or is not a valid MPS file.
+  bool LoadFile(const std::string& file_name, LinearProgram* data);
+
+  // Same as LoadFile() but for the contents of an MPS file already in memory.
+  bool LoadFromBuffer(const char* buffer, int64 size, LinearProgram* data);
+
+  // Returns the name of the last loaded problem as defined in the NAME line.
+  const std::string& problem_name() const { return problem_name_; }
+
+  // Whether the files are in free form. The default is the mps_free_form
+  // flag of MPSReader.
+  void set_free_form(bool v) { free_form_ = v; }
+
+  // Number of threads used to parse the COLUMNS section. The default is the
+  // number of cores of the machine.
+  void set_num_threads(int num_threads) { num_threads_ = num_threads; }
+
+  // Whether to log errors to LOG(ERROR) or not (the default is true).
+  void set_log_errors(bool v) { log_errors_ = v; }
+
+ private:
+  bool free_form_;
+  int num_threads_;
+  bool log_errors_;
+  std::string problem_name_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelMPSReader);
+};
+
+}  // namespace glop
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_LP_DATA_PARALLEL_MPS_READER_H_
@@ -530,6 +530,7 @@ void TriangularMatrix::Reset(RowIndex num_rows) {
   diagonal_coefficients_.clear();
   all_diagonal_coefficients_are_one_ = true;
   pruned_ends_.clear();
+  single_precision_coefficients_.clear();
 }
 
 ColIndex CompactSparseMatrix::AddDenseColumn(const DenseColumn& dense_column) {
@@ -592,6 +593,7 @@ void TriangularMatrix::Swap(TriangularMatrix* other) {
   std::swap(first_non_identity_column_, other->first_non_identity_column_);
   std::swap(all_diagonal_coefficients_are_one_,
             other->all_diagonal_coefficients_are_one_);
+  single_precision_coefficients_.swap(other->single_precision_coefficients_);
 }
 
 // Internal function used to finish adding one column to a triangular matrix.
@@ -724,13 +726,13 @@ void TriangularMatrix::LowerSolve(DenseColumn* rhs) const {
 void TriangularMatrix::LowerSolveStartingAt(ColIndex start,
                                             DenseColumn* rhs) const {
   if (all_diagonal_coefficients_are_one_) {
-    LowerSolveStartingAtInternal<true>(start, rhs);
+    LowerSolveStartingAtInternal<true, false>(start, rhs);
   } else {
-    LowerSolveStartingAtInternal<false>(start, rhs);
+    LowerSolveStartingAtInternal<false, false>(start, rhs);
   }
 }
 
-template <bool diagonal_of_ones>
+template <bool diagonal_of_ones, bool single_precision>
 void TriangularMatrix::LowerSolveStartingAtInternal(ColIndex start,
                                                     DenseColumn* rhs) const {
   RETURN_IF_NULL(rhs);
@@ -745,29 +747,29 @@ void TriangularMatrix::LowerSolveStartingAtInternal(ColIndex start,
       (*rhs)[ColToRowIndex(col)] = coeff;
     }
     for (const EntryIndex i : Column(col)) {
-      (*rhs)[EntryRow(i)] -= coeff * EntryCoefficient(i);
+      (*rhs)[EntryRow(i)] -= coeff * Coefficient<single_precision>(i);
     }
   }
 }
 
 void TriangularMatrix::UpperSolve(DenseColumn* rhs) const {
   if (all_diagonal_coefficients_are_one_) {
-    UpperSolveWithNonZerosInternal<true, false>(rhs, nullptr);
+    UpperSolveWithNonZerosInternal<true, false, false>(rhs, nullptr);
   } else {
-    UpperSolveWithNonZerosInternal<false, false>(rhs, nullptr);
+    UpperSolveWithNonZerosInternal<false, false, false>(rhs, nullptr);
   }
 }
 
 void TriangularMatrix::UpperSolveWithNonZeros(
     DenseColumn* rhs, RowIndexVector* non_zero_rows) const {
   if (all_diagonal_coefficients_are_one_) {
-    UpperSolveWithNonZerosInternal<true, true>(rhs, non_zero_rows);
+    UpperSolveWithNonZerosInternal<true, true, false>(rhs, non_zero_rows);
   } else {
-    UpperSolveWithNonZerosInternal<false, true>(rhs, non_zero_rows);
+    UpperSolveWithNonZerosInternal<false, true, false>(rhs, non_zero_rows);
   }
 }
 
-template <bool diagonal_of_ones, bool with_non_zeros>
+template <bool diagonal_of_ones, bool with_non_zeros, bool single_precision>
 void TriangularMatrix::UpperSolveWithNonZerosInternal(
     DenseColumn* rhs, RowIndexVector* non_zero_rows) const {
   RETURN_IF_NULL(rhs);
@@ -793,7 +795,7 @@ void TriangularMatrix::UpperSolveWithNonZerosInternal(
     // same in both cases.
     const EntryIndex last = starts_[col];
     for (EntryIndex i(starts_[col + 1] - 1); i >= last; --i) {
-      (*rhs)[EntryRow(i)] -= coeff * EntryCoefficient(i);
+      (*rhs)[EntryRow(i)] -= coeff * Coefficient<single_precision>(i);
     }
   }
 
@@ -812,13 +814,13 @@ void TriangularMatrix::UpperSolveWithNonZerosInternal(
 
 void TriangularMatrix::TransposeUpperSolve(DenseColumn* rhs) const {
   if (all_diagonal_coefficients_are_one_) {
-    TransposeUpperSolveInternal<true>(rhs);
+    TransposeUpperSolveInternal<true, false>(rhs);
   } else {
-    TransposeUpperSolveInternal<false>(rhs);
+    TransposeUpperSolveInternal<false, false>(rhs);
   }
 }
 
-template <bool diagonal_of_ones>
+template <bool diagonal_of_ones, bool single_precision>
 void TriangularMatrix::TransposeUpperSolveInternal(DenseColumn* rhs) const {
   RETURN_IF_NULL(rhs);
   const ColIndex end = num_cols_;
@@ -830,7 +832,7 @@ void TriangularMatrix::TransposeUpperSolveInternal(DenseColumn* rhs) const {
     //     for (const EntryIndex i : Column(col)) {
     const EntryIndex i_end = starts_[col + 1];
     for (; i < i_end; ++i) {
-      sum -= EntryCoefficient(i) * (*rhs)[EntryRow(i)];
+      sum -= Coefficient<single_precision>(i) * (*rhs)[EntryRow(i)];
     }
     (*rhs)[ColToRowIndex(col)] =
         diagonal_of_ones ? sum : sum / diagonal_coefficients_[col];
@@ -840,13 +842,13 @@ void TriangularMatrix::TransposeUpperSolveInternal(DenseColumn* rhs) const {
 void TriangularMatrix::TransposeLowerSolve(DenseColumn* rhs,
                                            RowIndex* last_non_zero_row) const {
   if (all_diagonal_coefficients_are_one_) {
-    TransposeLowerSolveInternal<true>(rhs, last_non_zero_row);
+    TransposeLowerSolveInternal<true, false>(rhs, last_non_zero_row);
   } else {
-    TransposeLowerSolveInternal<false>(rhs, last_non_zero_row);
+    TransposeLowerSolveInternal<false, false>(rhs, last_non_zero_row);
   }
 }
 
-template <bool diagonal_of_ones>
+template <bool diagonal_of_ones, bool single_precision>
 void TriangularMatrix::TransposeLowerSolveInternal(
     DenseColumn* rhs, RowIndex* last_non_zero_row) const {
   RETURN_IF_NULL(rhs);
@@ -870,13 +872,58 @@ void TriangularMatrix::TransposeLowerSolveInternal(
     // mainly because we iterate in a good direction for the cache.
     const EntryIndex i_end = starts_[col];
     for (; i >= i_end; --i) {
-      sum -= EntryCoefficient(i) * (*rhs)[EntryRow(i)];
+      sum -= Coefficient<single_precision>(i) * (*rhs)[EntryRow(i)];
     }
     (*rhs)[ColToRowIndex(col)] =
         diagonal_of_ones ? sum : sum / diagonal_coefficients_[col];
   }
 }
 
+void TriangularMatrix::ComputeSinglePrecisionCoefficients() {
+  single_precision_coefficients_.resize(coefficients_.size(), 0.0f);
+  for (EntryIndex i(0); i < coefficients_.size(); ++i) {
+    single_precision_coefficients_[i] = static_cast<float>(coefficients_[i]);
+  }
+}
+
+void TriangularMatrix::LowerSolveInSinglePrecision(DenseColumn* rhs) const {
+  DCHECK_EQ(single_precision_coefficients_.size(), coefficients_.size());
+  if (all_diagonal_coefficients_are_one_) {
+    LowerSolveStartingAtInternal<true, true>(ColIndex(0), rhs);
+  } else {
+    LowerSolveStartingAtInternal<false, true>(ColIndex(0), rhs);
+  }
+}
+
+void TriangularMatrix::UpperSolveInSinglePrecision(DenseColumn* rhs) const {
+  DCHECK_EQ(single_precision_coefficients_.size(), coefficients_.size());
+  if (all_diagonal_coefficients_are_one_) {
+    UpperSolveWithNonZerosInternal<true, false, true>(rhs, nullptr);
+  } else {
+    UpperSolveWithNonZerosInternal<false, false, true>(rhs, nullptr);
+  }
+}
+
+void TriangularMatrix::TransposeUpperSolveInSinglePrecision(
+    DenseColumn* rhs) const {
+  DCHECK_EQ(single_precision_coefficients_.size(), coefficients_.size());
+  if (all_diagonal_coefficients_are_one_) {
+    TransposeUpperSolveInternal<true, true>(rhs);
+  } else {
+    TransposeUpperSolveInternal<false, true>(rhs);
+  }
+}
+
+void TriangularMatrix::TransposeLowerSolveInSinglePrecision(
+    DenseColumn* rhs) const {
+  DCHECK_EQ(single_precision_coefficients_.size(), coefficients_.size());
+  if (all_diagonal_coefficients_are_one_) {
+    TransposeLowerSolveInternal<true, true>(rhs, nullptr);
+  } else {
+    TransposeLowerSolveInternal<false, true>(rhs, nullptr);
+  }
+}
+
 // TODO(user): exploit all_diagonal_coefficients_are_one_ when true.
 void TriangularMatrix::SparseTriangularSolve(
     const RowIndexVector& non_zero_rows, DenseColumn* rhs) const {
@@ -1141,7 +1188,13 @@ void TriangularMatrix::ComputeRowsToConsider(
 
 void TriangularMatrix::TriangularComputeRowsToConsider(
     RowIndexVector* non_zero_rows) const {
-  stored_.resize(num_rows_, false);
+  TriangularComputeRowsToConsider(non_zero_rows, &stored_, &nodes_to_explore_);
+}
+
+void TriangularMatrix::TriangularComputeRowsToConsider(
+    RowIndexVector* non_zero_rows, DenseBooleanColumn* stored,
+    std::vector<RowIndex>* nodes_to_explore) const {
+  stored->resize(num_rows_, false);
 
   // We stop the DFS if the number of floating point operations reaches this
   // threshold. TODO(user): Investigate the best threshold.
@@ -1154,39 +1207,39 @@ void TriangularMatrix::TriangularComputeRowsToConsider(
   }
 
   // Initialize using the non-zero positions of the input.
-  nodes_to_explore_.clear();
-  nodes_to_explore_.swap(*non_zero_rows);
+  nodes_to_explore->clear();
+  nodes_to_explore->swap(*non_zero_rows);
 
   // Topological sort based on Depth-First-Search.
   // Same remarks as the version implemented in ComputeRowsToConsider().
-  while (!nodes_to_explore_.empty()) {
-    const RowIndex row = nodes_to_explore_.back();
+  while (!nodes_to_explore->empty()) {
+    const RowIndex row = nodes_to_explore->back();
 
     // If the depth-first search from the current node is finished, we store the
     // node. This will store the node in reverse topological order.
     if (row < 0) {
-      nodes_to_explore_.pop_back();
-      const RowIndex explored_row = nodes_to_explore_.back();
-      nodes_to_explore_.pop_back();
-      stored_[explored_row] = true;
+      nodes_to_explore->pop_back();
+      const RowIndex explored_row = nodes_to_explore->back();
+      nodes_to_explore->pop_back();
+      (*stored)[explored_row] = true;
       non_zero_rows->push_back(explored_row);
       continue;
     }
 
     // If the node is already stored, skip.
-    if (stored_[row]) {
-      nodes_to_explore_.pop_back();
+    if ((*stored)[row]) {
+      nodes_to_explore->pop_back();
       continue;
     }
 
     // Go one level forward in the depth-first search, and store the 'adjacent'
-    // node on nodes_to_explore_ for further processing.
-    nodes_to_explore_.push_back(kInvalidRow);
+    // node on nodes_to_explore for further processing.
+    nodes_to_explore->push_back(kInvalidRow);
     for (const EntryIndex i : Column(RowToColIndex(row))) {
       ++num_ops;
       const RowIndex entry_row = EntryRow(i);
-      if (!stored_[entry_row]) {
-        nodes_to_explore_.push_back(entry_row);
+      if (!(*stored)[entry_row]) {
+        nodes_to_explore->push_back(entry_row);
       }
     }
 
@@ -1196,9 +1249,9 @@ void TriangularMatrix::TriangularComputeRowsToConsider(
     if (num_ops > kHypersparseThreshold) break;
   }
 
-  // Clear stored_.
+  // Clear stored.
   for (const RowIndex row : *non_zero_rows) {
-    stored_[row] = false;
+    (*stored)[row] = false;
   }
 
   // If we aborted, clear the result.
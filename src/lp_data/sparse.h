@@ -30,6 +30,7 @@
 #include <string>
 
 #include "base/integral_types.h"
+#include "base/large_array_allocator.h"
 #include "lp_data/lp_types.h"
 #include "lp_data/permutation.h"
 #include "lp_data/sparse_column.h"
@@ -432,9 +433,11 @@ class CompactSparseMatrix {
 
   // Holds the columns non-zero coefficients and row positions.
   // The entries for the column of index col are stored in the entries
-  // [starts_[col], starts_[col + 1]).
-  StrictITIVector<EntryIndex, Fractional> coefficients_;
-  StrictITIVector<EntryIndex, RowIndex> rows_;
+  // [starts_[col], starts_[col + 1]). These are the largest arrays of Glop
+  // (they also hold the LU factors), hence the LargeArrayAllocator.
+  StrictITIVector<EntryIndex, Fractional, LargeArrayAllocator<Fractional> >
+      coefficients_;
+  StrictITIVector<EntryIndex, RowIndex, LargeArrayAllocator<RowIndex> > rows_;
   StrictITIVector<ColIndex, EntryIndex> starts_;
 
  private:
@@ -548,6 +551,18 @@ class TriangularMatrix : private CompactSparseMatrix {
   void UpperSolveWithNonZeros(DenseColumn* rhs,
                               RowIndexVector* non_zero_rows) const;
 
+  // Same as LowerSolve(), UpperSolve(), TransposeUpperSolve() and
+  // TransposeLowerSolve(), but reading a single precision copy of the
+  // coefficients, which halves the memory traffic of the solves. The rhs and
+  // the arithmetic stay in double precision, and so do the diagonal
+  // coefficients. ComputeSinglePrecisionCoefficients() must be called once the
+  // matrix is complete, and again after each modification of its coefficients.
+  void ComputeSinglePrecisionCoefficients();
+  void LowerSolveInSinglePrecision(DenseColumn* rhs) const;
+  void UpperSolveInSinglePrecision(DenseColumn* rhs) const;
+  void TransposeUpperSolveInSinglePrecision(DenseColumn* rhs) const;
+  void TransposeLowerSolveInSinglePrecision(DenseColumn* rhs) const;
+
   // Hyper-sparse version of the triangular solve functions.
   // The passed non_zero_rows should contain the positions of the non-zeros of
   // the result in the REVERSE order in which they need to be accessed. It can
@@ -569,6 +584,14 @@ class TriangularMatrix : private CompactSparseMatrix {
   // aborts early and non_zero_rows is cleared.
   void TriangularComputeRowsToConsider(RowIndexVector* non_zero_rows) const;
 
+  // Same as above, but uses the given scratch data instead of the internal
+  // one, so it can be called concurrently from several threads with different
+  // scratch data. The vector stored must be all false and is left so, it is
+  // resized if needed.
+  void TriangularComputeRowsToConsider(
+      RowIndexVector* non_zero_rows, DenseBooleanColumn* stored,
+      std::vector<RowIndex>* nodes_to_explore) const;
+
   // This is currently only used for testing. It achieves the same result as
   // PermutedLowerSparseSolve() below, but the latter exploits the sparsity of
   // rhs and is thus faster for our use case.
@@ -639,17 +662,25 @@ class TriangularMatrix : private CompactSparseMatrix {
 
  private:
   // Internal versions of some Solve() functions to avoid code duplication.
-  template <bool diagonal_of_ones>
+  // When single_precision is true, they read single_precision_coefficients_
+  // instead of coefficients_.
+  template <bool diagonal_of_ones, bool single_precision>
   void LowerSolveStartingAtInternal(ColIndex start, DenseColumn* rhs) const;
-  template <bool diagonal_of_ones, bool with_non_zeros>
+  template <bool diagonal_of_ones, bool with_non_zeros, bool single_precision>
   void UpperSolveWithNonZerosInternal(DenseColumn* rhs,
                                       RowIndexVector* non_zero_rows) const;
-  template <bool diagonal_of_ones>
+  template <bool diagonal_of_ones, bool single_precision>
   void TransposeLowerSolveInternal(DenseColumn* rhs,
                                    RowIndex* last_non_zero_row) const;
-  template <bool diagonal_of_ones>
+  template <bool diagonal_of_ones, bool single_precision>
   void TransposeUpperSolveInternal(DenseColumn* rhs) const;
 
+  template <bool single_precision>
+  Fractional Coefficient(EntryIndex i) const {
+    return single_precision ? single_precision_coefficients_[i]
+                            : coefficients_[i];
+  }
+
   // Internal function used by the Add*() functions to finish adding
   // a new column to a triangular matrix.
   void CloseCurrentColumn(Fractional diagonal_value);
@@ -666,6 +697,10 @@ class TriangularMatrix : private CompactSparseMatrix {
   // TODO(user): Do not even construct diagonal_coefficients_ in this case?
   bool all_diagonal_coefficients_are_one_;
 
+  // Single precision copy of coefficients_, see
+  // ComputeSinglePrecisionCoefficients(). Empty if it was never computed.
+  StrictITIVector<EntryIndex, float> single_precision_coefficients_;
+
   // For the hyper-sparse version. These are used to implement a DFS, see
   // TriangularComputeRowsToConsider() for more details.
   mutable DenseBooleanColumn stored_;
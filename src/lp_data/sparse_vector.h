@@ -30,6 +30,8 @@
 
 #include <algorithm>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "base/integral_types.h"
 #include "base/logging.h"  // for CHECK*
@@ -238,7 +240,7 @@ class SparseVector {
   // Note this method can only be used when the vector has no duplicates.
   EntryIndex num_entries() const {
     DCHECK(CheckNoDuplicates());
-    return EntryIndex(entry_.size());
+    return EntryIndex(index_.size());
   }
 
   // Returns the first entry's index and coefficient; note that 'first' doesn't
@@ -247,21 +249,21 @@ class SparseVector {
   // Note this method can only be used when the vector has no duplicates.
   Index GetFirstIndex() const {
     DCHECK(CheckNoDuplicates());
-    return entry_.front().index;
+    return index_.front();
   }
   Fractional GetFirstCoefficient() const {
     DCHECK(CheckNoDuplicates());
-    return entry_.front().coefficient;
+    return coefficient_.front();
   }
 
   // Like GetFirst*, but for the last entry.
   Index GetLastIndex() const {
     DCHECK(CheckNoDuplicates());
-    return entry_.back().index;
+    return index_.back();
   }
   Fractional GetLastCoefficient() const {
     DCHECK(CheckNoDuplicates());
-    return entry_.back().coefficient;
+    return coefficient_.back();
   }
 
   // Allows to loop over the entry indices like this:
@@ -269,7 +271,7 @@ class SparseVector {
   // TODO(user): consider removing this, in favor of the natural range
   // iteration.
   IntegerRange<EntryIndex> AllEntryIndices() const {
-    return IntegerRange<EntryIndex>(EntryIndex(0), entry_.size());
+    return IntegerRange<EntryIndex>(EntryIndex(0), index_.size());
   }
 
   // Returns true if this vector is exactly equal to the given one, i.e. all its
@@ -281,29 +283,19 @@ class SparseVector {
   std::string DebugString() const;
 
  protected:
-  // The internal storage of entries.
-  struct InternalEntry {
-    Index index;
-    Fractional coefficient;
-    // TODO(user): Evaluate the impact of having padding (12 bytes struct when
-    //              Fractional is a double).
-    // Note(user): The two constructors below are not needed when we switch
-    // to initializer lists.
-    InternalEntry() : index(0), coefficient(0.0) {}
-    InternalEntry(Index i, Fractional c) : index(i), coefficient(c) {}
-    bool operator<(const InternalEntry& other) const {
-      return index < other.index;
-    }
-  };
-
   // TODO(user): Consider making this public and using it instead of EntryRow()
   // EntryCoefficient() in SparseColumn.
-  const InternalEntry& entry(EntryIndex i) const { return entry_[i]; }
-
-  // Vector of entries. Not necessarily sorted.
-  // TODO(user): try splitting the std::vector<InternalEntry> into two vectors
-  // of index and coefficient, like it is done in SparseMatrix.
-  StrictITIVector<EntryIndex, InternalEntry> entry_;
+  Index GetIndex(EntryIndex i) const { return index_[i]; }
+  Fractional GetCoefficient(EntryIndex i) const { return coefficient_[i]; }
+
+  // The entries, not necessarily sorted: the entry i is (index_[i],
+  // coefficient_[i]). They are stored in two vectors, like it is done in
+  // CompactSparseMatrix, so that the loops that only need the coefficients
+  // (scaling) or that scan the indices do not waste half of the memory
+  // bandwidth on the other field and on the padding of an {index, coefficient}
+  // struct, and can be vectorized. Both vectors always have the same size.
+  StrictITIVector<EntryIndex, Index> index_;
+  StrictITIVector<EntryIndex, Fractional> coefficient_;
 
   // This is here to speed up the CheckNoDuplicates() methods and is mutable
   // so we can perform checks on const argument.
@@ -315,15 +307,37 @@ class SparseVector {
   void AddMultipleToSparseVectorInternal(
       bool delete_common_index, Fractional multiplier, Index common_index,
       SparseVector* accumulator_vector) const;
+
+  // Appends an entry without marking the vector as possibly containing
+  // duplicates.
+  void PushBack(Index index, Fractional coefficient) {
+    index_.push_back(index);
+    coefficient_.push_back(coefficient);
+  }
+
+  // Copies the entry from to the entry to, of the same vector.
+  void MoveEntry(EntryIndex from, EntryIndex to) {
+    index_[to] = index_[from];
+    coefficient_[to] = coefficient_[from];
+  }
+
+  // Keeps only the first new_size entries.
+  void ResizeDown(EntryIndex new_size) {
+    index_.resize_down(new_size);
+    coefficient_.resize_down(new_size);
+  }
+
+  void SwapEntries(EntryIndex a, EntryIndex b) {
+    std::swap(index_[a], index_[b]);
+    std::swap(coefficient_[a], coefficient_[b]);
+  }
 };
 
 template <class Index>
 class SparseVector<Index>::Entry {
  public:
-  Index index() const { return sparse_vector_.entry(i_).index; }
-  Fractional coefficient() const {
-    return sparse_vector_.entry(i_).coefficient;
-  }
+  Index index() const { return sparse_vector_.GetIndex(i_); }
+  Fractional coefficient() const { return sparse_vector_.GetCoefficient(i_); }
 
  protected:
   Entry(const SparseVector& sparse_vector, EntryIndex i)
@@ -361,7 +375,7 @@ typename SparseVector<Index>::Iterator SparseVector<Index>::begin() const {
 
 template <class Index>
 typename SparseVector<Index>::Iterator SparseVector<Index>::end() const {
-  return Iterator(*this, EntryIndex(entry_.size()));
+  return Iterator(*this, EntryIndex(index_.size()));
 }
 
 // --------------------------------------------------------
@@ -369,50 +383,92 @@ typename SparseVector<Index>::Iterator SparseVector<Index>::end() const {
 // --------------------------------------------------------
 template <typename IndexType>
 SparseVector<IndexType>::SparseVector()
-    : entry_(), may_contain_duplicates_(false) {}
+    : index_(), coefficient_(), may_contain_duplicates_(false) {}
 
 template <typename IndexType>
 void SparseVector<IndexType>::Clear() {
-  entry_.clear();
+  index_.clear();
+  coefficient_.clear();
   may_contain_duplicates_ = false;
 }
 
 template <typename IndexType>
 void SparseVector<IndexType>::ClearAndRelease() {
-  StrictITIVector<EntryIndex, InternalEntry> empty;
-  empty.swap(entry_);
+  StrictITIVector<EntryIndex, Index> empty_index;
+  StrictITIVector<EntryIndex, Fractional> empty_coefficient;
+  empty_index.swap(index_);
+  empty_coefficient.swap(coefficient_);
   may_contain_duplicates_ = false;
 }
 
 template <typename IndexType>
 void SparseVector<IndexType>::Reserve(EntryIndex size) {
-  entry_.reserve(size.value());
+  index_.reserve(size.value());
+  coefficient_.reserve(size.value());
 }
 
 template <typename IndexType>
 bool SparseVector<IndexType>::IsEmpty() const {
-  return entry_.empty();
+  return index_.empty();
 }
 
 template <typename IndexType>
 void SparseVector<IndexType>::Swap(SparseVector* other) {
-  entry_.swap(other->entry_);
+  index_.swap(other->index_);
+  coefficient_.swap(other->coefficient_);
   std::swap(may_contain_duplicates_, other->may_contain_duplicates_);
 }
 
 template <typename IndexType>
 void SparseVector<IndexType>::CleanUp() {
-  std::stable_sort(entry_.begin(), entry_.end());
+  const EntryIndex num_entries = index_.size();
+  bool is_sorted = true;
+  for (EntryIndex i(1); i < num_entries; ++i) {
+    if (index_[i] <= index_[i - 1]) {
+      is_sorted = false;
+      break;
+    }
+  }
   EntryIndex new_index(0);
-  const EntryIndex num_entries = entry_.size();
-  for (EntryIndex i(0); i < num_entries; ++i) {
-    if (i + 1 < num_entries && entry_[i + 1].index == entry_[i].index) continue;
-    if (entry_[i].coefficient != 0.0) {
-      entry_[new_index] = entry_[i];
-      ++new_index;
+  if (is_sorted) {
+    // This is the common case of an already clean vector, or of a vector that
+    // was filled in order: only the zeros need to be removed.
+    for (EntryIndex i(0); i < num_entries; ++i) {
+      if (coefficient_[i] != 0.0) {
+        MoveEntry(i, new_index);
+        ++new_index;
+      }
+    }
+  } else {
+    // Sorts the positions of the entries by index. Using a stable sort keeps
+    // the positions of the duplicates in order, and the last one is the value
+    // of the index.
+    std::vector<std::pair<Index, EntryIndex>> order;
+    order.reserve(num_entries.value());
+    for (EntryIndex i(0); i < num_entries; ++i) {
+      order.push_back(std::make_pair(index_[i], i));
     }
+    std::stable_sort(order.begin(), order.end(),
+                     [](const std::pair<Index, EntryIndex>& a,
+                        const std::pair<Index, EntryIndex>& b) {
+                       return a.first < b.first;
+                     });
+    StrictITIVector<EntryIndex, Fractional> coefficients(num_entries, 0.0);
+    for (EntryIndex i(0); i < num_entries; ++i) {
+      if (i + 1 < num_entries && order[i.value() + 1].first ==
+                                     order[i.value()].first) {
+        continue;
+      }
+      const Fractional coefficient = coefficient_[order[i.value()].second];
+      if (coefficient != 0.0) {
+        index_[new_index] = order[i.value()].first;
+        coefficients[new_index] = coefficient;
+        ++new_index;
+      }
+    }
+    coefficients.swap(coefficient_);
   }
-  entry_.resize_down(new_index);
+  ResizeDown(new_index);
   may_contain_duplicates_ = false;
 }
 
@@ -420,8 +476,8 @@ template <typename IndexType>
 bool SparseVector<IndexType>::IsCleanedUp() const {
   Index previous_index(-1);
   for (const EntryIndex i : AllEntryIndices()) {
-    const Index index = entry(i).index;
-    if (index <= previous_index || entry(i).coefficient == 0.0) return false;
+    const Index index = GetIndex(i);
+    if (index <= previous_index || GetCoefficient(i) == 0.0) return false;
     previous_index = index;
   }
   may_contain_duplicates_ = false;
@@ -431,7 +487,8 @@ bool SparseVector<IndexType>::IsCleanedUp() const {
 template <typename IndexType>
 void SparseVector<IndexType>::PopulateFromSparseVector(
     const SparseVector& sparse_vector) {
-  entry_ = sparse_vector.entry_;
+  index_ = sparse_vector.index_;
+  coefficient_ = sparse_vector.coefficient_;
   may_contain_duplicates_ = sparse_vector.may_contain_duplicates_;
 }
 
@@ -452,10 +509,9 @@ template <typename IndexType>
 void SparseVector<IndexType>::AppendEntriesWithOffset(
     const SparseVector& sparse_vector, Index offset) {
   for (const EntryIndex i : sparse_vector.AllEntryIndices()) {
-    const InternalEntry& entry = sparse_vector.entry_[i];
-    const Index new_index = offset + entry.index;
+    const Index new_index = offset + sparse_vector.GetIndex(i);
     DCHECK_GE(new_index, 0);
-    entry_.push_back(InternalEntry(new_index, entry.coefficient));
+    PushBack(new_index, sparse_vector.GetCoefficient(i));
   }
   may_contain_duplicates_ = true;
 }
@@ -466,17 +522,17 @@ bool SparseVector<IndexType>::CheckNoDuplicates(
   RETURN_VALUE_IF_NULL(boolean_vector, false);
   // Note(user): Using num_entries() or any function that call
   // CheckNoDuplicates() again will cause an infinite loop!
-  if (!may_contain_duplicates_ || entry_.size() <= 1) return true;
+  if (!may_contain_duplicates_ || index_.size() <= 1) return true;
 
   // Update size if needed.
-  const Index max_index = std::max_element(entry_.begin(), entry_.end())->index;
+  const Index max_index = *std::max_element(index_.begin(), index_.end());
   if (boolean_vector->size() <= max_index) {
     boolean_vector->resize(max_index + 1, false);
   }
 
   may_contain_duplicates_ = false;
   for (const EntryIndex i : AllEntryIndices()) {
-    const Index index = entry(i).index;
+    const Index index = GetIndex(i);
     if ((*boolean_vector)[index]) {
       may_contain_duplicates_ = true;
       break;
@@ -486,7 +542,7 @@ bool SparseVector<IndexType>::CheckNoDuplicates(
 
   // Reset boolean_vector to false.
   for (const EntryIndex i : AllEntryIndices()) {
-    (*boolean_vector)[entry(i).index] = false;
+    (*boolean_vector)[GetIndex(i)] = false;
   }
   return !may_contain_duplicates_;
 }
@@ -495,7 +551,7 @@ template <typename IndexType>
 bool SparseVector<IndexType>::CheckNoDuplicates() const {
   // Using num_entries() or any function in that will call CheckNoDuplicates()
   // again will cause an infinite loop!
-  if (!may_contain_duplicates_ || entry_.size() <= 1) return true;
+  if (!may_contain_duplicates_ || index_.size() <= 1) return true;
   StrictITIVector<Index, bool> boolean_vector;
   return CheckNoDuplicates(&boolean_vector);
 }
@@ -505,9 +561,7 @@ bool SparseVector<IndexType>::CheckNoDuplicates() const {
 template <typename IndexType>
 void SparseVector<IndexType>::SetCoefficient(Index index, Fractional value) {
   DCHECK_GE(index, 0);
-  // TODO(user): when we drop MSVC2012 in the open-source project,
-  // use initializer list-based idiom:  entry_.push_back({index, value});
-  entry_.push_back(InternalEntry(index, value));
+  PushBack(index, value);
   may_contain_duplicates_ = true;
 }
 
@@ -516,11 +570,12 @@ void SparseVector<IndexType>::DeleteEntry(Index index) {
   DCHECK(CheckNoDuplicates());
   EntryIndex i(0);
   const EntryIndex end(num_entries());
-  while (i < end && entry(i).index != index) {
+  while (i < end && GetIndex(i) != index) {
     ++i;
   }
   if (i == end) return;
-  entry_.erase(entry_.begin() + i.value());
+  index_.erase(index_.begin() + i.value());
+  coefficient_.erase(coefficient_.begin() + i.value());
 }
 
 template <typename IndexType>
@@ -528,13 +583,13 @@ void SparseVector<IndexType>::RemoveNearZeroEntries(Fractional threshold) {
   DCHECK(CheckNoDuplicates());
   EntryIndex new_index(0);
   for (const EntryIndex i : AllEntryIndices()) {
-    const Fractional magnitude = fabs(entry(i).coefficient);
+    const Fractional magnitude = fabs(GetCoefficient(i));
     if (magnitude > threshold) {
-      entry_[new_index] = entry_[i];
+      MoveEntry(i, new_index);
       ++new_index;
     }
   }
-  entry_.resize_down(new_index);
+  ResizeDown(new_index);
 }
 
 template <typename IndexType>
@@ -543,20 +598,20 @@ void SparseVector<IndexType>::RemoveNearZeroEntriesWithWeights(
   DCHECK(CheckNoDuplicates());
   EntryIndex new_index(0);
   for (const EntryIndex i : AllEntryIndices()) {
-    if (fabs(entry_[i].coefficient) * weights[entry_[i].index] > threshold) {
-      entry_[new_index] = entry_[i];
+    if (fabs(coefficient_[i]) * weights[index_[i]] > threshold) {
+      MoveEntry(i, new_index);
       ++new_index;
     }
   }
-  entry_.resize_down(new_index);
+  ResizeDown(new_index);
 }
 
 template <typename IndexType>
 void SparseVector<IndexType>::MoveEntryToFirstPosition(Index index) {
   DCHECK(CheckNoDuplicates());
   for (const EntryIndex i : AllEntryIndices()) {
-    if (entry(i).index == index) {
-      std::swap(entry_[EntryIndex(0)], entry_[i]);
+    if (GetIndex(i) == index) {
+      SwapEntries(EntryIndex(0), i);
       return;
     }
   }
@@ -566,8 +621,8 @@ template <typename IndexType>
 void SparseVector<IndexType>::MoveEntryToLastPosition(Index index) {
   DCHECK(CheckNoDuplicates());
   for (const EntryIndex i : AllEntryIndices()) {
-    if (entry(i).index == index) {
-      std::swap(entry_[num_entries() - 1], entry_[i]);
+    if (GetIndex(i) == index) {
+      SwapEntries(num_entries() - 1, i);
       return;
     }
   }
@@ -576,7 +631,7 @@ void SparseVector<IndexType>::MoveEntryToLastPosition(Index index) {
 template <typename IndexType>
 void SparseVector<IndexType>::MultiplyByConstant(Fractional factor) {
   for (const EntryIndex i : AllEntryIndices()) {
-    entry_[i].coefficient *= factor;
+    coefficient_[i] *= factor;
   }
 }
 
@@ -584,21 +639,21 @@ template <typename IndexType>
 void SparseVector<IndexType>::ComponentWiseMultiply(
     const DenseVector& factors) {
   for (const EntryIndex i : AllEntryIndices()) {
-    entry_[i].coefficient *= factors[entry(i).index];
+    coefficient_[i] *= factors[index_[i]];
   }
 }
 
 template <typename IndexType>
 void SparseVector<IndexType>::DivideByConstant(Fractional factor) {
   for (const EntryIndex i : AllEntryIndices()) {
-    entry_[i].coefficient /= factor;
+    coefficient_[i] /= factor;
   }
 }
 
 template <typename IndexType>
 void SparseVector<IndexType>::ComponentWiseDivide(const DenseVector& factors) {
   for (const EntryIndex i : AllEntryIndices()) {
-    entry_[i].coefficient /= factors[entry(i).index];
+    coefficient_[i] /= factors[index_[i]];
   }
 }
 
@@ -608,7 +663,7 @@ void SparseVector<IndexType>::CopyToDenseVector(
   RETURN_IF_NULL(dense_vector);
   dense_vector->AssignToZero(num_indices);
   for (const EntryIndex i : AllEntryIndices()) {
-    (*dense_vector)[entry(i).index] = entry(i).coefficient;
+    (*dense_vector)[GetIndex(i)] = GetCoefficient(i);
   }
 }
 
@@ -619,7 +674,7 @@ void SparseVector<IndexType>::PermutedCopyToDenseVector(
   RETURN_IF_NULL(dense_vector);
   dense_vector->AssignToZero(num_indices);
   for (const EntryIndex i : AllEntryIndices()) {
-    (*dense_vector)[index_perm[entry(i).index]] = entry(i).coefficient;
+    (*dense_vector)[index_perm[GetIndex(i)]] = GetCoefficient(i);
   }
 }
 
@@ -629,7 +684,7 @@ void SparseVector<IndexType>::AddMultipleToDenseVector(
   RETURN_IF_NULL(dense_vector);
   if (multiplier == 0.0) return;
   for (const EntryIndex i : AllEntryIndices()) {
-    (*dense_vector)[entry(i).index] += multiplier * entry(i).coefficient;
+    (*dense_vector)[GetIndex(i)] += multiplier * GetCoefficient(i);
   }
 }
 
@@ -675,53 +730,52 @@ void SparseVector<IndexType>::AddMultipleToSparseVectorInternal(
   const EntryIndex size_a = a.num_entries();
   const EntryIndex size_b = b.num_entries();
   const int size_adjustment = delete_common_index ? -2 : 0;
-  c.entry_.resize(size_a + size_b + size_adjustment, InternalEntry());
+  const EntryIndex c_size = size_a + size_b + size_adjustment;
+  c.index_.resize(c_size, Index(0));
+  c.coefficient_.resize(c_size, 0.0);
+  const auto set_c_entry = [&c, &ic](Index index, Fractional coefficient) {
+    c.index_[ic] = index;
+    c.coefficient_[ic] = coefficient;
+    ++ic;
+  };
   while ((ia < size_a) && (ib < size_b)) {
-    const Index index_a = a.entry(ia).index;
-    const Index index_b = b.entry(ib).index;
+    const Index index_a = a.GetIndex(ia);
+    const Index index_b = b.GetIndex(ib);
     // Benchmarks done by fdid@ in 2012 showed that it was faster to put the
     // "if" clauses in that specific order.
     if (index_a == index_b) {
       if (index_a != common_index) {
-        const Fractional a_coeff_mul = multiplier * a.entry(ia).coefficient;
-        const Fractional b_coeff = b.entry(ib).coefficient;
+        const Fractional a_coeff_mul = multiplier * a.GetCoefficient(ia);
+        const Fractional b_coeff = b.GetCoefficient(ib);
         const Fractional sum = a_coeff_mul + b_coeff;
         // We use the factor 2.0 because the error can be slightly greater than
         // 1ulp, and we don't want to leave such near zero entries.
         if (fabs(sum) > 2.0 * std::numeric_limits<Fractional>::epsilon() *
                             std::max(fabs(a_coeff_mul), fabs(b_coeff))) {
-          c.entry_[ic] = InternalEntry(index_a, sum);
-          ++ic;
+          set_c_entry(index_a, sum);
         }
       } else if (!delete_common_index) {
-        c.entry_[ic] = b.entry(ib);
-        ++ic;
+        set_c_entry(index_b, b.GetCoefficient(ib));
       }
       ++ia;
       ++ib;
     } else if (index_a < index_b) {
-      c.entry_[ic] =
-          InternalEntry(index_a, multiplier * a.entry(ia).coefficient);
+      set_c_entry(index_a, multiplier * a.GetCoefficient(ia));
       ++ia;
-      ++ic;
     } else {  // index_b < index_a
-      c.entry_[ic] = b.entry_[ib];
+      set_c_entry(index_b, b.GetCoefficient(ib));
       ++ib;
-      ++ic;
     }
   }
   while (ia < size_a) {
-    c.entry_[ic] =
-        InternalEntry(a.entry(ia).index, multiplier * a.entry(ia).coefficient);
+    set_c_entry(a.GetIndex(ia), multiplier * a.GetCoefficient(ia));
     ++ia;
-    ++ic;
   }
   while (ib < size_b) {
-    c.entry_[ic] = b.entry_[ib];
+    set_c_entry(b.GetIndex(ib), b.GetCoefficient(ib));
     ++ib;
-    ++ic;
   }
-  c.entry_.resize_down(ic);
+  c.ResizeDown(ic);
   c.may_contain_duplicates_ = false;
   c.Swap(accumulator_vector);
 }
@@ -730,7 +784,7 @@ template <typename IndexType>
 void SparseVector<IndexType>::ApplyIndexPermutation(
     const IndexPermutation& index_perm) {
   for (const EntryIndex i : AllEntryIndices()) {
-    entry_[i].index = index_perm[entry_[i].index];
+    index_[i] = index_perm[index_[i]];
   }
 }
 
@@ -739,14 +793,14 @@ void SparseVector<IndexType>::ApplyPartialIndexPermutation(
     const IndexPermutation& index_perm) {
   EntryIndex new_index(0);
   for (const EntryIndex i : AllEntryIndices()) {
-    const Index index = entry_[i].index;
+    const Index index = index_[i];
     if (index_perm[index] >= 0) {
-      entry_[new_index].index = index_perm[index];
-      entry_[new_index].coefficient = entry_[i].coefficient;
+      index_[new_index] = index_perm[index];
+      coefficient_[new_index] = coefficient_[i];
       ++new_index;
     }
   }
-  entry_.resize_down(new_index);
+  ResizeDown(new_index);
 }
 
 template <typename IndexType>
@@ -754,23 +808,23 @@ void SparseVector<IndexType>::MoveTaggedEntriesTo(
     const IndexPermutation& index_perm, SparseVector* output) {
   // Note that this function is called many times, so performance does matter
   // and it is why we optimized the "nothing to do" case.
-  const EntryIndex end(entry_.size());
+  const EntryIndex end(index_.size());
   EntryIndex i(0);
   while (true) {
     if (i >= end) return;  // "nothing to do" case.
-    if (index_perm[entry_[i].index] >= 0) break;
+    if (index_perm[index_[i]] >= 0) break;
     ++i;
   }
-  output->entry_.push_back(entry_[i]);
+  output->PushBack(index_[i], coefficient_[i]);
   for (EntryIndex j(i + 1); j < end; ++j) {
-    if (index_perm[entry_[j].index] < 0) {
-      entry_[i] = entry_[j];
+    if (index_perm[index_[j]] < 0) {
+      MoveEntry(j, i);
       ++i;
     } else {
-      output->entry_.push_back(entry_[j]);
+      output->PushBack(index_[j], coefficient_[j]);
     }
   }
-  entry_.resize_down(i);
+  ResizeDown(i);
 
   // TODO(user): In the way we use this function, we know that will not
   // happen, but it is better to be careful so we can check that properly in
@@ -782,12 +836,12 @@ template <typename IndexType>
 Fractional SparseVector<IndexType>::LookUpCoefficient(Index index) const {
   Fractional value(0.0);
   for (const EntryIndex i : AllEntryIndices()) {
-    if (entry(i).index == index) {
+    if (GetIndex(i) == index) {
       // Keep in mind the vector may contains several entries with the same
       // index. In such a case the last one is returned.
       // TODO(user): investigate whether an optimized version of
       // LookUpCoefficient for "clean" columns yields speed-ups.
-      value = entry(i).coefficient;
+      value = GetCoefficient(i);
     }
   }
   return value;
@@ -798,8 +852,8 @@ bool SparseVector<IndexType>::IsEqualTo(const SparseVector& other) const {
   // We do not take into account the mutable value may_contain_duplicates_.
   if (num_entries() != other.num_entries()) return false;
   for (const EntryIndex i : AllEntryIndices()) {
-    if (entry(i).index != other.entry(i).index) return false;
-    if (entry(i).coefficient != other.entry(i).coefficient) return false;
+    if (GetIndex(i) != other.GetIndex(i)) return false;
+    if (GetCoefficient(i) != other.GetCoefficient(i)) return false;
   }
   return true;
 }
@@ -809,7 +863,7 @@ std::string SparseVector<IndexType>::DebugString() const {
   std::string s;
   for (const EntryIndex i : AllEntryIndices()) {
     if (i != 0) s += ", ";
-    StringAppendF(&s, "[%d]=%g", entry(i).index.value(), entry(i).coefficient);
+    StringAppendF(&s, "[%d]=%g", GetIndex(i).value(), GetCoefficient(i));
   }
   return s;
 }
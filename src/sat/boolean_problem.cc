@@ -18,6 +18,7 @@
 #include "base/commandlineflags.h"
 #include "base/join.h"
 #include "base/map_util.h"
+#include "base/timer.h"
 #include "base/hash.h"
 #include "algorithms/find_graph_symmetries.h"
 #include "graph/graph.h"
@@ -589,8 +590,10 @@ void MakeAllLiteralsPositive(LinearBooleanProblem* problem) {
 }
 
 void FindLinearBooleanProblemSymmetries(
-    const LinearBooleanProblem& problem,
+    const LinearBooleanProblem& problem, double time_limit_seconds,
     std::vector<std::unique_ptr<SparsePermutation>>* generators) {
+  WallTimer timer;
+  timer.Start();
   typedef GraphSymmetryFinder::Graph Graph;
   std::vector<int> equivalence_classes;
   std::unique_ptr<Graph> graph(
@@ -623,10 +626,16 @@ void FindLinearBooleanProblemSymmetries(
   GraphSymmetryFinder symmetry_finder(*graph,
                                       /*is_undirected=*/true);
   std::vector<int> factorized_automorphism_group_size;
-  // TODO(user): inject the appropriate time limit here.
-  CHECK_OK(symmetry_finder.FindSymmetries(
-      /*time_limit_seconds=*/std::numeric_limits<double>::infinity(),
-      &equivalence_classes, generators, &factorized_automorphism_group_size));
+  const util::Status status = symmetry_finder.FindSymmetries(
+      std::max(0.0, time_limit_seconds - timer.Get()), &equivalence_classes,
+      generators, &factorized_automorphism_group_size);
+
+  // The only possible error is the deadline, in which case the generators
+  // found so far are still valid symmetries.
+  if (!status.ok()) {
+    LOG(INFO) << "Symmetry detection stopped after " << timer.Get()
+              << "s: " << status;
+  }
 
   // Remove from the permutations the part not concerning the literals.
   // Note that some permutation may becomes empty, which means that we had
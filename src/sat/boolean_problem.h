@@ -104,8 +104,12 @@ void MakeAllLiteralsPositive(LinearBooleanProblem* problem);
 // generator is a permutation of the integer range [0, 2n) where n is the number
 // of variables of the problem. They are permutations of the (index
 // representation of the) problem literals.
+//
+// The search stops after time_limit_seconds. In this case the generators are
+// still valid symmetries of the problem, but they may not generate the whole
+// symmetry group.
 void FindLinearBooleanProblemSymmetries(
-    const LinearBooleanProblem& problem,
+    const LinearBooleanProblem& problem, double time_limit_seconds,
     std::vector<std::unique_ptr<SparsePermutation>>* generators);
 
 // Maps all the literals of the problem. Note that this converts the cost of a
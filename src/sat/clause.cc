@@ -23,7 +23,9 @@
 #include "base/logging.h"
 #include "base/sysinfo.h"
 #include "base/join.h"
+#include "base/memory_accounting.h"
 #include "base/stl_util.h"
+#include "base/strongly_connected_components.h"
 #include "util/time_limit.h"
 
 namespace operations_research {
@@ -34,9 +36,9 @@ namespace {
 // Returns true if the given watcher list contains the given clause.
 template <typename Watcher>
 bool WatcherListContains(const std::vector<Watcher>& list,
-                         const SatClause& candidate) {
+                         ArenaIndex candidate) {
   for (const Watcher& watcher : list) {
-    if (watcher.clause == &candidate) return true;
+    if (watcher.clause == candidate) return true;
   }
   return false;
 }
@@ -47,13 +49,108 @@ void RemoveIf(Container c, Predicate p) {
   c->erase(std::remove_if(c->begin(), c->end(), p), c->end());
 }
 
-// Removes dettached clauses from a watcher list.
-template <typename Watcher>
-bool CleanUpPredicate(const Watcher& watcher) {
-  return !watcher.clause->IsAttached();
+}  // namespace
+
+// ----- ClauseArena -----
+
+ClauseArena::ClauseArena()
+    : last_block_size_(0), num_words_(0), num_wasted_words_(0) {}
+
+ClauseArena::~ClauseArena() {
+  int64 num_allocated_words = 0;
+  for (const int block_words : block_sizes_) num_allocated_words += block_words;
+  RecordMemoryAllocation(
+      SAT_CLAUSES,
+      -num_allocated_words * static_cast<int64>(sizeof(uint32)));
 }
 
-}  // namespace
+// static
+int ClauseArena::NumWords(int num_literals) {
+  static_assert(alignof(SatClause) % sizeof(uint32) == 0,
+                "A SatClause must be aligned on 32-bit words.");
+  const int alignment = alignof(SatClause) / sizeof(uint32);
+  const int bytes = sizeof(SatClause) + num_literals * sizeof(Literal);
+  const int words = (bytes + sizeof(uint32) - 1) / sizeof(uint32);
+  return (words + alignment - 1) / alignment * alignment;
+}
+
+ArenaIndex ClauseArena::Allocate(int num_words) {
+  CHECK_LE(num_words, 1 << kBlockBits);
+  if (blocks_.empty() || last_block_size_ + num_words > block_sizes_.back()) {
+    // Blocks double in size, so that small problems do not use a lot of
+    // memory, up to the maximum block size.
+    int block_words = kMinBlockWords;
+    if (!blocks_.empty()) {
+      num_wasted_words_ += block_sizes_.back() - last_block_size_;
+      num_words_ += block_sizes_.back() - last_block_size_;
+      block_words = std::min(2 * block_sizes_.back(), 1 << kBlockBits);
+    }
+    block_words = std::max(block_words, num_words);
+    CHECK_LT(blocks_.size(), 1 << (31 - kBlockBits))
+        << "Too many clauses for the ClauseArena.";
+    blocks_.emplace_back(new uint32[block_words]);
+    block_sizes_.push_back(block_words);
+    RecordMemoryAllocation(SAT_CLAUSES,
+                           static_cast<int64>(block_words) * sizeof(uint32));
+    last_block_size_ = 0;
+  }
+  const ArenaIndex index(((blocks_.size() - 1) << kBlockBits) |
+                         last_block_size_);
+  last_block_size_ += num_words;
+  num_words_ += num_words;
+  return index;
+}
+
+SatClause* ClauseArena::NewClause(const std::vector<Literal>& literals,
+                                  bool is_redundant, ResolutionNode* node) {
+  CHECK_GE(literals.size(), 2);
+  SatClause* const clause = Clause(Allocate(NumWords(literals.size())));
+  clause->size_ = literals.size();
+  for (int i = 0; i < literals.size(); ++i) {
+    clause->literals_[i] = literals[i];
+  }
+  clause->is_redundant_ = is_redundant;
+  clause->is_attached_ = false;
+#ifdef SAT_ENABLE_RESOLUTION
+  clause->resolution_node_ = node;
+#endif  // SAT_ENABLE_RESOLUTION
+  return clause;
+}
+
+ArenaIndex ClauseArena::CopyClause(const SatClause& clause) {
+  const ArenaIndex index = Allocate(NumWords(clause.Size()));
+  SatClause* const copy = Clause(index);
+  copy->size_ = clause.size_;
+  for (int i = 0; i < clause.Size(); ++i) {
+    copy->literals_[i] = clause.literals_[i];
+  }
+  copy->is_redundant_ = clause.is_redundant_;
+  copy->is_attached_ = clause.is_attached_;
+#ifdef SAT_ENABLE_RESOLUTION
+  copy->resolution_node_ = clause.resolution_node_;
+#endif  // SAT_ENABLE_RESOLUTION
+  return index;
+}
+
+ArenaIndex ClauseArena::IndexOf(const SatClause* clause) const {
+  const uint32* const address = reinterpret_cast<const uint32*>(clause);
+  for (int block = 0; block < blocks_.size(); ++block) {
+    const uint32* const start = blocks_[block].get();
+    if (address >= start && address < start + block_sizes_[block]) {
+      return ArenaIndex((block << kBlockBits) | (address - start));
+    }
+  }
+  LOG(FATAL) << "Clause not in this ClauseArena.";
+  return ArenaIndex(-1);
+}
+
+void ClauseArena::Swap(ClauseArena* other) {
+  blocks_.swap(other->blocks_);
+  block_sizes_.swap(other->block_sizes_);
+  std::swap(last_block_size_, other->last_block_size_);
+  std::swap(num_words_, other->num_words_);
+  std::swap(num_wasted_words_, other->num_wasted_words_);
+}
 
 // ----- LiteralWatchers -----
 
@@ -79,10 +176,10 @@ void LiteralWatchers::Resize(int num_variables) {
 
 // Note that this is the only place where we add Watcher so the DCHECK
 // guarantees that there are no duplicates.
-void LiteralWatchers::AttachOnFalse(Literal a, Literal b, SatClause* clause) {
+void LiteralWatchers::AttachOnFalse(Literal a, Literal b, ArenaIndex clause) {
   SCOPED_TIME_STAT(&stats_);
   DCHECK(is_clean_);
-  DCHECK(!WatcherListContains(watchers_on_false_[a.Index()], *clause));
+  DCHECK(!WatcherListContains(watchers_on_false_[a.Index()], clause));
   watchers_on_false_[a.Index()].push_back(Watcher(clause, b));
 }
 
@@ -106,7 +203,8 @@ bool LiteralWatchers::PropagateOnFalse(Literal false_literal, Trail* trail) {
     ++num_inspected_clauses_;
 
     // If the other watched literal is true, just change the blocking literal.
-    Literal* literals = it->clause->literals();
+    SatClause* const clause = arena_.Clause(it->clause);
+    Literal* literals = clause->literals();
     const Literal other_watched_literal =
         (literals[1] == false_literal) ? literals[0] : literals[1];
     if (other_watched_literal != it->blocking_literal &&
@@ -119,7 +217,7 @@ bool LiteralWatchers::PropagateOnFalse(Literal false_literal, Trail* trail) {
     // Look for another literal to watch.
     {
       int i = 2;
-      const int size = it->clause->Size();
+      const int size = clause->Size();
       while (i < size && assignment.LiteralIsFalse(literals[i])) ++i;
       num_inspected_clause_literals_ += i;
       if (i < size) {
@@ -137,13 +235,13 @@ bool LiteralWatchers::PropagateOnFalse(Literal false_literal, Trail* trail) {
     // At this point other_watched_literal is either false or undefined, all
     // other literals are false.
     if (assignment.LiteralIsFalse(other_watched_literal)) {
-      // Conflict: All literals of it->clause are false.
+      // Conflict: All literals of clause are false.
       //
       // Note(user): we could avoid a copy here, but the conflict analysis
       // complexity will be a lot higher than this anyway.
-      trail->MutableConflict()->assign(it->clause->begin(), it->clause->end());
-      trail->SetFailingSatClause(it->clause);
-      trail->SetFailingResolutionNode(it->clause->ResolutionNodePointer());
+      trail->MutableConflict()->assign(clause->begin(), clause->end());
+      trail->SetFailingSatClause(clause);
+      trail->SetFailingResolutionNode(clause->ResolutionNodePointer());
       num_inspected_clause_literals_ += it - watchers.begin() + 1;
       watchers.erase(new_it, it);
       return false;
@@ -174,15 +272,15 @@ bool LiteralWatchers::Propagate(Trail* trail) {
 }
 
 ClauseRef LiteralWatchers::Reason(const Trail& trail, int trail_index) const {
-  return reasons_[trail_index]->PropagationReason();
+  return ReasonClause(trail_index)->PropagationReason();
 }
 
 ResolutionNode* LiteralWatchers::GetResolutionNode(int trail_index) const {
-  return reasons_[trail_index]->ResolutionNodePointer();
+  return ReasonClause(trail_index)->ResolutionNodePointer();
 }
 
 SatClause* LiteralWatchers::ReasonClause(int trail_index) const {
-  return reasons_[trail_index];
+  return arena_.Clause(reasons_[trail_index]);
 }
 
 bool LiteralWatchers::AttachAndPropagate(SatClause* clause, Trail* trail) {
@@ -199,7 +297,8 @@ bool LiteralWatchers::AttachAndPropagate(SatClause* clause, Trail* trail) {
   // relies on this.
   if (!clause->IsRedundant()) UpdateStatistics(*clause, /*added=*/true);
   clause->SortLiterals(statistics_, parameters_);
-  return clause->AttachAndEnqueuePotentialUnitPropagation(trail, this);
+  return clause->AttachAndEnqueuePotentialUnitPropagation(
+      arena_.IndexOf(clause), trail, this);
 }
 
 void LiteralWatchers::LazyDetach(SatClause* clause) {
@@ -214,15 +313,58 @@ void LiteralWatchers::LazyDetach(SatClause* clause) {
 
 void LiteralWatchers::CleanUpWatchers() {
   SCOPED_TIME_STAT(&stats_);
+  // Removes dettached clauses from a watcher list.
+  const auto is_detached = [this](const Watcher& watcher) {
+    return !arena_.Clause(watcher.clause)->IsAttached();
+  };
   for (LiteralIndex index : needs_cleaning_.PositionsSetAtLeastOnce()) {
     DCHECK(needs_cleaning_[index]);
-    RemoveIf(&(watchers_on_false_[index]), CleanUpPredicate<Watcher>);
+    RemoveIf(&(watchers_on_false_[index]), is_detached);
     needs_cleaning_.Clear(index);
   }
   needs_cleaning_.NotifyAllClear();
   is_clean_ = true;
 }
 
+void LiteralWatchers::CompactClauses(const Trail& trail,
+                                     std::vector<SatClause*>* clauses) {
+  SCOPED_TIME_STAT(&stats_);
+  DCHECK(is_clean_);
+  ClauseArena new_arena;
+  for (SatClause*& clause : *clauses) {
+    DCHECK(clause->IsAttached());
+    const ArenaIndex new_index = new_arena.CopyClause(*clause);
+    // The old clause will never be read again, so we use its first literal to
+    // store its new index.
+    clause->literals()[0] = Literal(LiteralIndex(new_index.value()));
+    clause = new_arena.Clause(new_index);
+  }
+  const auto new_index = [this](ArenaIndex old_index) {
+    return ArenaIndex(arena_.Clause(old_index)->FirstLiteral().Index().value());
+  };
+  for (std::vector<Watcher>& watchers : watchers_on_false_) {
+    for (Watcher& watcher : watchers) {
+      watcher.clause = new_index(watcher.clause);
+    }
+  }
+
+  // Only the reasons of the variables currently propagated by this class can
+  // be used. Note that the clauses that were released are not attached.
+  for (int trail_index = 0; trail_index < trail.Index(); ++trail_index) {
+    const VariableIndex var = trail[trail_index].Variable();
+    if (trail.ReferenceVarWithSameReason(var) != var ||
+        trail.AssignmentType(var) != propagator_id_) {
+      continue;
+    }
+    if (arena_.Clause(reasons_[trail_index])->IsAttached()) {
+      reasons_[trail_index] = new_index(reasons_[trail_index]);
+    } else {
+      reasons_[trail_index] = ArenaIndex(-1);
+    }
+  }
+  arena_.Swap(&new_arena);
+}
+
 void LiteralWatchers::UpdateStatistics(const SatClause& clause, bool added) {
   SCOPED_TIME_STAT(&stats_);
   for (const Literal literal : clause) {
@@ -241,16 +383,69 @@ void LiteralWatchers::UpdateStatistics(const SatClause& clause, bool added) {
 
 // ----- BinaryImplicationGraph -----
 
+template <typename Predicate>
+void BinaryImplicationGraph::RemoveImplicationsIf(LiteralIndex index,
+                                                  Predicate predicate) {
+  Literal* const begin = csr_literals_.data() + csr_start_[index];
+  int new_size = 0;
+  for (int i = 0; i < csr_size_[index]; ++i) {
+    const Literal literal = begin[i];
+    if (!predicate(literal)) begin[new_size++] = literal;
+  }
+  num_removed_implications_ += csr_size_[index] - new_size;
+  csr_size_[index] = new_size;
+
+  std::vector<Literal>& others = new_implications_[index];
+  new_size = 0;
+  for (const Literal literal : others) {
+    if (!predicate(literal)) others[new_size++] = literal;
+  }
+  num_new_implications_ -= others.size() - new_size;
+  others.resize(new_size);
+}
+
+void BinaryImplicationGraph::ShuffleImplications(LiteralIndex index,
+                                                 RandomBase* random) {
+  Literal* const begin = csr_literals_.data() + csr_start_[index];
+  std::random_shuffle(begin, begin + csr_size_[index], *random);
+  std::random_shuffle(new_implications_[index].begin(),
+                      new_implications_[index].end(), *random);
+}
+
+void BinaryImplicationGraph::BuildCompactStorage(
+    const ITIVector<LiteralIndex, std::vector<Literal>>& implications) {
+  SCOPED_TIME_STAT(&stats_);
+  int num_literals = 0;
+  for (const std::vector<Literal>& list : implications) {
+    num_literals += list.size();
+  }
+  csr_literals_.clear();
+  csr_literals_.reserve(num_literals);
+  for (LiteralIndex i(0); i < implications.size(); ++i) {
+    csr_start_[i] = csr_literals_.size();
+    csr_size_[i] = implications[i].size();
+    csr_literals_.insert(csr_literals_.end(), implications[i].begin(),
+                         implications[i].end());
+    STLClearObject(&new_implications_[i]);
+  }
+  num_new_implications_ = 0;
+  num_removed_implications_ = 0;
+}
+
 void BinaryImplicationGraph::Resize(int num_variables) {
   SCOPED_TIME_STAT(&stats_);
-  implications_.resize(num_variables << 1);
+  const int num_literals = num_variables << 1;
+  csr_start_.resize(num_literals, csr_literals_.size());
+  csr_size_.resize(num_literals, 0);
+  new_implications_.resize(num_literals);
   reasons_.resize(num_variables);
 }
 
 void BinaryImplicationGraph::AddBinaryClause(Literal a, Literal b) {
   SCOPED_TIME_STAT(&stats_);
-  implications_[a.Negated().Index()].push_back(b);
-  implications_[b.Negated().Index()].push_back(a);
+  new_implications_[a.Negated().Index()].push_back(b);
+  new_implications_[b.Negated().Index()].push_back(a);
+  num_new_implications_ += 2;
   ++num_implications_;
 }
 
@@ -268,17 +463,18 @@ void BinaryImplicationGraph::AddBinaryConflict(Literal a, Literal b,
   }
 }
 
-bool BinaryImplicationGraph::PropagateOnTrue(Literal true_literal,
-                                             Trail* trail) {
-  SCOPED_TIME_STAT(&stats_);
-
+bool BinaryImplicationGraph::PropagateImplications(Literal true_literal,
+                                                   const Literal* begin,
+                                                   const Literal* end,
+                                                   Trail* trail) {
   // Note(user): This update is not exactly correct because in case of conflict
   // we don't inspect that much clauses. But doing ++num_inspections_ inside the
   // loop does slow down the code by a few percent.
-  num_inspections_ += implications_[true_literal.Index()].size();
+  num_inspections_ += end - begin;
 
   const VariablesAssignment& assignment = trail->Assignment();
-  for (Literal literal : implications_[true_literal.Index()]) {
+  for (const Literal* it = begin; it < end; ++it) {
+    const Literal literal = *it;
     if (assignment.LiteralIsTrue(literal)) {
       // Note(user): I tried to update the reason here if the literal was
       // enqueued after the true_literal on the trail. This property is
@@ -302,6 +498,21 @@ bool BinaryImplicationGraph::PropagateOnTrue(Literal true_literal,
   return true;
 }
 
+bool BinaryImplicationGraph::PropagateOnTrue(Literal true_literal,
+                                             Trail* trail) {
+  SCOPED_TIME_STAT(&stats_);
+  const LiteralIndex index = true_literal.Index();
+  const Literal* const begin = csr_literals_.data() + csr_start_[index];
+  if (!PropagateImplications(true_literal, begin, begin + csr_size_[index],
+                             trail)) {
+    return false;
+  }
+  const std::vector<Literal>& others = new_implications_[index];
+  if (others.empty()) return true;
+  return PropagateImplications(true_literal, others.data(),
+                               others.data() + others.size(), trail);
+}
+
 bool BinaryImplicationGraph::Propagate(Trail* trail) {
   if (num_implications_ == 0) {
     propagation_trail_index_ = trail->Index();
@@ -333,7 +544,7 @@ void BinaryImplicationGraph::MinimizeConflictWithReachability(
   // Compute the reachability from the literal "not(conflict->front())" using
   // an iterative dfs.
   const LiteralIndex root_literal_index = conflict->front().NegatedIndex();
-  is_marked_.ClearAndResize(LiteralIndex(implications_.size()));
+  is_marked_.ClearAndResize(LiteralIndex(csr_size_.size()));
   is_marked_.Set(root_literal_index);
 
   // TODO(user): This sounds like a good idea, but somehow it seems better not
@@ -347,18 +558,19 @@ void BinaryImplicationGraph::MinimizeConflictWithReachability(
 
   // We treat the direct implications differently so we can also remove the
   // redundant implications from this list at the same time.
-  auto& direct_implications = implications_[root_literal_index];
-  for (const Literal l : direct_implications) {
-    if (is_marked_[l.Index()]) continue;
+  const auto push_unmarked = [this](Literal implied) {
+    if (!is_marked_[implied.Index()]) dfs_stack_.push_back(implied);
+  };
+  const auto explore = [this, &push_unmarked,
+                        also_prune_direct_implication_list](Literal l) {
+    if (is_marked_[l.Index()]) return;
     dfs_stack_.push_back(l);
     while (!dfs_stack_.empty()) {
       const LiteralIndex index = dfs_stack_.back().Index();
       dfs_stack_.pop_back();
       if (!is_marked_[index]) {
         is_marked_.Set(index);
-        for (Literal implied : implications_[index]) {
-          if (!is_marked_[implied.Index()]) dfs_stack_.push_back(implied);
-        }
+        ForEachImplication(index, push_unmarked);
       }
     }
 
@@ -376,23 +588,20 @@ void BinaryImplicationGraph::MinimizeConflictWithReachability(
     if (also_prune_direct_implication_list) {
       is_marked_.Clear(l.Index());
     }
-  }
+  };
+  ForEachImplication(root_literal_index, explore);
 
   // Now we can prune the direct implications list and make sure are the
   // literals there are marked.
   if (also_prune_direct_implication_list) {
-    int new_size = 0;
-    for (const Literal l : direct_implications) {
-      if (!is_marked_[l.Index()]) {
-        is_marked_.Set(l.Index());
-        direct_implications[new_size] = l;
-        ++new_size;
+    RemoveImplicationsIf(root_literal_index, [this](Literal l) {
+      if (is_marked_[l.Index()]) {
+        ++num_redundant_implications_;
+        return true;
       }
-    }
-    if (new_size < direct_implications.size()) {
-      num_redundant_implications_ += direct_implications.size() - new_size;
-      direct_implications.resize(new_size);
-    }
+      is_marked_.Set(l.Index());
+      return false;
+    });
   }
 
   RemoveRedundantLiterals(conflict);
@@ -406,7 +615,7 @@ void BinaryImplicationGraph::MinimizeConflictFirst(
     const Trail& trail, std::vector<Literal>* conflict,
     SparseBitset<VariableIndex>* marked) {
   SCOPED_TIME_STAT(&stats_);
-  is_marked_.ClearAndResize(LiteralIndex(implications_.size()));
+  is_marked_.ClearAndResize(LiteralIndex(csr_size_.size()));
   dfs_stack_.clear();
   dfs_stack_.push_back(conflict->front().Negated());
   while (!dfs_stack_.empty()) {
@@ -418,9 +627,9 @@ void BinaryImplicationGraph::MinimizeConflictFirst(
       if (trail.Assignment().LiteralIsFalse(literal)) {
         marked->Set(literal.Variable());
       }
-      for (Literal implied : implications_[literal.Index()]) {
+      ForEachImplication(literal.Index(), [this](Literal implied) {
         if (!is_marked_[implied.Index()]) dfs_stack_.push_back(implied);
-      }
+      });
     }
   }
   RemoveRedundantLiterals(conflict);
@@ -434,43 +643,37 @@ void BinaryImplicationGraph::MinimizeConflictFirstWithTransitiveReduction(
     SparseBitset<VariableIndex>* marked, RandomBase* random) {
   SCOPED_TIME_STAT(&stats_);
   const LiteralIndex root_literal_index = conflict->front().NegatedIndex();
-  is_marked_.ClearAndResize(LiteralIndex(implications_.size()));
+  is_marked_.ClearAndResize(LiteralIndex(csr_size_.size()));
   is_marked_.Set(root_literal_index);
 
-  int new_size = 0;
-  auto& direct_implications = implications_[root_literal_index];
-
   // The randomization allow to find more redundant implication since to find
   // a => b and remove b, a must be before b in direct_implications. Note that
   // a std::reverse() could work too. But randomization seems to work better.
   // Probably because it has other impact on the search tree.
-  std::random_shuffle(direct_implications.begin(), direct_implications.end(),
-                      *random);
+  ShuffleImplications(root_literal_index, random);
   dfs_stack_.clear();
-  for (const Literal l : direct_implications) {
+  const auto push_unmarked = [this](Literal implied) {
+    if (!is_marked_[implied.Index()]) dfs_stack_.push_back(implied);
+  };
+  RemoveImplicationsIf(root_literal_index, [this, &push_unmarked](Literal l) {
     if (is_marked_[l.Index()]) {
       // The literal is already marked! so it must be implied by one of the
       // previous literal in the direct_implications list. We can safely remove
       // it.
-      continue;
+      ++num_redundant_implications_;
+      return true;
     }
-    direct_implications[new_size++] = l;
     dfs_stack_.push_back(l);
     while (!dfs_stack_.empty()) {
       const LiteralIndex index = dfs_stack_.back().Index();
       dfs_stack_.pop_back();
       if (!is_marked_[index]) {
         is_marked_.Set(index);
-        for (Literal implied : implications_[index]) {
-          if (!is_marked_[implied.Index()]) dfs_stack_.push_back(implied);
-        }
+        ForEachImplication(index, push_unmarked);
       }
     }
-  }
-  if (new_size < direct_implications.size()) {
-    num_redundant_implications_ += direct_implications.size() - new_size;
-    direct_implications.resize(new_size);
-  }
+    return false;
+  });
   RemoveRedundantLiterals(conflict);
 }
 
@@ -494,8 +697,8 @@ void BinaryImplicationGraph::RemoveRedundantLiterals(
 void BinaryImplicationGraph::MinimizeConflictExperimental(
     const Trail& trail, std::vector<Literal>* conflict) {
   SCOPED_TIME_STAT(&stats_);
-  is_marked_.ClearAndResize(LiteralIndex(implications_.size()));
-  is_removed_.ClearAndResize(LiteralIndex(implications_.size()));
+  is_marked_.ClearAndResize(LiteralIndex(csr_size_.size()));
+  is_removed_.ClearAndResize(LiteralIndex(csr_size_.size()));
   for (Literal lit : *conflict) {
     is_marked_.Set(lit.Index());
   }
@@ -517,17 +720,16 @@ void BinaryImplicationGraph::MinimizeConflictExperimental(
     const Literal lit = (*conflict)[i];
     const int lit_level = trail.Info(lit.Variable()).level;
     bool keep_literal = true;
-    for (Literal implied : implications_[lit.Index()]) {
-      if (is_marked_[implied.Index()]) {
-        DCHECK_LE(lit_level, trail.Info(implied.Variable()).level);
-        if (lit_level == trail.Info(implied.Variable()).level &&
-            is_removed_[implied.Index()]) {
-          continue;
-        }
-        keep_literal = false;
-        break;
+    ForEachImplication(lit.Index(), [this, &trail, lit_level,
+                                     &keep_literal](Literal implied) {
+      if (!keep_literal || !is_marked_[implied.Index()]) return;
+      DCHECK_LE(lit_level, trail.Info(implied.Variable()).level);
+      if (lit_level == trail.Info(implied.Variable()).level &&
+          is_removed_[implied.Index()]) {
+        return;
       }
-    }
+      keep_literal = false;
+    });
     if (keep_literal) {
       (*conflict)[index] = lit;
       ++index;
@@ -546,7 +748,7 @@ void BinaryImplicationGraph::RemoveFixedVariables(
     int first_unprocessed_trail_index, const Trail& trail) {
   const VariablesAssignment& assigment = trail.Assignment();
   SCOPED_TIME_STAT(&stats_);
-  is_marked_.ClearAndResize(LiteralIndex(implications_.size()));
+  is_marked_.ClearAndResize(LiteralIndex(csr_size_.size()));
   for (int i = first_unprocessed_trail_index; i < trail.Index(); ++i) {
     const Literal true_literal = trail[i];
     // If b is true and a -> b then because not b -> not a, all the
@@ -554,39 +756,126 @@ void BinaryImplicationGraph::RemoveFixedVariables(
     //
     // TODO(user): This doesn't seems true if we remove implication by
     // transitive reduction.
-    for (Literal lit : implications_[true_literal.NegatedIndex()]) {
+    ForEachImplication(true_literal.NegatedIndex(), [this](Literal lit) {
       is_marked_.Set(lit.NegatedIndex());
-    }
-    STLClearObject(&(implications_[true_literal.Index()]));
-    STLClearObject(&(implications_[true_literal.NegatedIndex()]));
+    });
+    RemoveImplicationsIf(true_literal.Index(), [](Literal) { return true; });
+    RemoveImplicationsIf(true_literal.NegatedIndex(),
+                         [](Literal) { return true; });
   }
   for (const LiteralIndex i : is_marked_.PositionsSetAtLeastOnce()) {
-    RemoveIf(&implications_[i],
-             std::bind1st(std::mem_fun(&VariablesAssignment::LiteralIsTrue),
-                          &assigment));
+    RemoveImplicationsIf(i, [&assigment](Literal literal) {
+      return assigment.LiteralIsTrue(literal);
+    });
   }
 }
 
-// ----- SatClause -----
+void BinaryImplicationGraph::CompactImplicationsIfNeeded() {
+  if (4 * (num_new_implications_ + num_removed_implications_) <=
+      csr_literals_.size()) {
+    return;
+  }
+  SCOPED_TIME_STAT(&stats_);
+  ITIVector<LiteralIndex, std::vector<Literal>> implications(csr_size_.size());
+  for (LiteralIndex i(0); i < csr_size_.size(); ++i) {
+    implications[i].reserve(csr_size_[i] + new_implications_[i].size());
+    ForEachImplication(
+        i, [&implications, i](Literal l) { implications[i].push_back(l); });
+  }
+  BuildCompactStorage(implications);
+}
 
-// static
-SatClause* SatClause::Create(const std::vector<Literal>& literals, bool is_redundant,
-                             ResolutionNode* node) {
-  CHECK_GE(literals.size(), 2);
-  SatClause* clause = reinterpret_cast<SatClause*>(
-      ::operator new(sizeof(SatClause) + literals.size() * sizeof(Literal)));
-  clause->size_ = literals.size();
-  for (int i = 0; i < literals.size(); ++i) {
-    clause->literals_[i] = literals[i];
+namespace {
+// Adjacency lists of the implication graph in the format needed by
+// FindStronglyConnectedComponents(). The nodes are the literal indices.
+class ImplicationGraphView {
+ public:
+  ImplicationGraphView(
+      const ITIVector<LiteralIndex, std::vector<Literal>>& implications)
+      : implications_(implications) {}
+
+  const std::vector<int32>& operator[](int32 index) const {
+    scratchpad_.clear();
+    for (const Literal literal : implications_[LiteralIndex(index)]) {
+      scratchpad_.push_back(literal.Index().value());
+    }
+    return scratchpad_;
   }
-  clause->is_redundant_ = is_redundant;
-  clause->is_attached_ = false;
-#ifdef SAT_ENABLE_RESOLUTION
-  clause->resolution_node_ = node;
-#endif  // SAT_ENABLE_RESOLUTION
-  return clause;
+
+ private:
+  const ITIVector<LiteralIndex, std::vector<Literal>>& implications_;
+  mutable std::vector<int32> scratchpad_;
+
+  DISALLOW_COPY_AND_ASSIGN(ImplicationGraphView);
+};
+}  // namespace
+
+bool BinaryImplicationGraph::DetectEquivalences() {
+  SCOPED_TIME_STAT(&stats_);
+  const int32 num_literals = csr_size_.size();
+  ITIVector<LiteralIndex, std::vector<Literal>> implications(num_literals);
+  for (LiteralIndex i(0); i < num_literals; ++i) {
+    ForEachImplication(
+        i, [&implications, i](Literal l) { implications[i].push_back(l); });
+  }
+  const int32 num_components = scc_finder_.FindComponents(
+      num_literals, ImplicationGraphView(implications));
+  const std::vector<int32>& component_of_literal =
+      scc_finder_.component_of_node();
+
+  // Two literals of the same variable in the same component are necessarily
+  // l and not(l).
+  for (int32 i = 0; i + 1 < num_literals; i += 2) {
+    if (component_of_literal[i] == component_of_literal[i + 1]) return false;
+  }
+
+  // The representative of a component is its smallest literal. Since the
+  // negations of the literals of a component form another component, the
+  // representative of not(l) is always not(representative(l)).
+  ITIVector<LiteralIndex, LiteralIndex> representative(num_literals);
+  std::vector<LiteralIndex> representative_of_component(num_components,
+                                                        LiteralIndex(-1));
+  for (LiteralIndex i(0); i < num_literals; ++i) {
+    const int32 component = component_of_literal[i.value()];
+    if (representative_of_component[component] == LiteralIndex(-1)) {
+      representative_of_component[component] = i;
+    }
+    representative[i] = representative_of_component[component];
+  }
+  const int num_merged = num_literals - num_components;
+  if (num_merged == 0) return true;
+  num_equivalent_literals_ += num_merged;
+
+  // Moves all the implications to the representatives, and adds l <=> rep.
+  ITIVector<LiteralIndex, std::vector<Literal>> new_implications(num_literals);
+  for (LiteralIndex i(0); i < num_literals; ++i) {
+    const LiteralIndex rep = representative[i];
+    for (const Literal l : implications[i]) {
+      const LiteralIndex implied_rep = representative[l.Index()];
+      if (implied_rep != rep) {
+        new_implications[rep].push_back(Literal(implied_rep));
+      }
+    }
+    if (rep != i) {
+      new_implications[i].push_back(Literal(rep));
+      new_implications[rep].push_back(Literal(i));
+    }
+  }
+  int64 num_implications = 0;
+  for (std::vector<Literal>& list : new_implications) {
+    std::sort(list.begin(), list.end());
+    list.erase(std::unique(list.begin(), list.end()), list.end());
+    num_implications += list.size();
+  }
+  num_implications_ = (num_implications + 1) / 2;
+  BuildCompactStorage(new_implications);
+  VLOG(1) << "Binary implication graph: " << num_merged
+          << " equivalent literals, " << num_implications_ << " implications.";
+  return true;
 }
 
+// ----- SatClause -----
+
 // Note that for an attached clause, removing fixed literal is okay because if
 // any of the watched literal is assigned, then the clause is necessarily true.
 bool SatClause::RemoveFixedLiteralsAndTestIfTrue(
@@ -675,7 +964,7 @@ void SatClause::SortLiterals(
 }
 
 bool SatClause::AttachAndEnqueuePotentialUnitPropagation(
-    Trail* trail, LiteralWatchers* demons) {
+    ArenaIndex index, Trail* trail, LiteralWatchers* demons) {
   CHECK(!IsAttached());
   // Select the first two literals that are not assigned to false and put them
   // on position 0 and 1.
@@ -709,15 +998,15 @@ bool SatClause::AttachAndEnqueuePotentialUnitPropagation(
 
     // Propagates literals_[0] if it is undefined.
     if (!trail->Assignment().LiteralIsTrue(literals_[0])) {
-      demons->SetReasonClause(trail->Index(), this);
+      demons->SetReasonClause(trail->Index(), index);
       trail->Enqueue(literals_[0], demons->propagator_id_);
     }
   }
 
   // Attach the watchers.
   is_attached_ = true;
-  demons->AttachOnFalse(literals_[0], literals_[1], this);
-  demons->AttachOnFalse(literals_[1], literals_[0], this);
+  demons->AttachOnFalse(literals_[0], literals_[1], index);
+  demons->AttachOnFalse(literals_[1], literals_[0], index);
   return true;
 }
 
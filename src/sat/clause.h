@@ -31,6 +31,7 @@
 #include "base/int_type.h"
 #include "base/hash.h"
 #include "base/random.h"
+#include "base/strongly_connected_components.h"
 #include "sat/sat_base.h"
 #include "sat/sat_parameters.pb.h"
 #include "util/bitset.h"
@@ -42,6 +43,11 @@ namespace sat {
 // Forward declarations.
 // TODO(user): This cyclic dependency can be relatively easily removed.
 class LiteralWatchers;
+class ClauseArena;
+
+// Position of a clause in a ClauseArena. This is only 32 bits, instead of the
+// 64 bits of a SatClause* on most platforms.
+DEFINE_INT_TYPE(ArenaIndex, int32);
 
 // Variable information. This is updated each time we attach/detach a clause.
 struct VariableInfo {
@@ -62,11 +68,8 @@ struct VariableInfo {
 // the solver needs to keep a few extra fields attached to each clause.
 class SatClause {
  public:
-  // Creates a sat clause. There must be at least 2 literals. Smaller clause are
-  // treated separatly and never constructed. A redundant clause can be removed
-  // without changing the problem.
-  static SatClause* Create(const std::vector<Literal>& literals, bool is_redundant,
-                           ResolutionNode* node);
+  // Note that clauses are created by a ClauseArena: see
+  // ClauseArena::NewClause().
 
   // Number of literals in the clause.
   int Size() const { return size_; }
@@ -118,8 +121,9 @@ class SatClause {
   // and attaches the clause to the event: one of the watched literals become
   // false. It returns false if the clause only contains literals assigned to
   // false. If only one literals is not false, it propagates it to true if it
-  // is not already assigned.
-  bool AttachAndEnqueuePotentialUnitPropagation(Trail* trail,
+  // is not already assigned. The given index must be the one of this clause
+  // in the arena of the LiteralWatchers.
+  bool AttachAndEnqueuePotentialUnitPropagation(ArenaIndex index, Trail* trail,
                                                 LiteralWatchers* demons);
 
   // Returns true if the clause is attached to a LiteralWatchers.
@@ -142,6 +146,8 @@ class SatClause {
   std::string DebugString() const;
 
  private:
+  friend class ClauseArena;
+
   // The data is packed so that only 4 bytes are used for these fields.
   //
   // TODO(user): It should be possible to remove one or both of the Booleans.
@@ -166,6 +172,75 @@ class SatClause {
   DISALLOW_COPY_AND_ASSIGN(SatClause);
 };
 
+// Stores clauses contiguously in a few large blocks of memory, instead of
+// allocating each of them on the heap. This avoids the malloc overhead per
+// clause and makes the propagation more cache friendly.
+//
+// Blocks are never reallocated, so the SatClause* returned by this class stay
+// valid until the arena is destroyed or swapped. Released clauses are not
+// reused: their memory is only given back by copying the live clauses to a
+// new arena, see LiteralWatchers::CompactClauses().
+class ClauseArena {
+ public:
+  ClauseArena();
+  ~ClauseArena();
+
+  // Creates a sat clause. There must be at least 2 literals. Smaller clause are
+  // treated separatly and never constructed. A redundant clause can be removed
+  // without changing the problem.
+  SatClause* NewClause(const std::vector<Literal>& literals,
+                       bool is_redundant, ResolutionNode* node);
+
+  // Copies the given clause, which can belong to another arena, and returns
+  // the index of the copy.
+  ArenaIndex CopyClause(const SatClause& clause);
+
+  SatClause* Clause(ArenaIndex index) const {
+    DCHECK_GE(index.value(), 0);
+    return reinterpret_cast<SatClause*>(blocks_[index.value() >> kBlockBits]
+                                            .get() +
+                                        (index.value() & kOffsetMask));
+  }
+
+  // Returns the index of a clause of this arena. This is linear in the number
+  // of blocks, which is small.
+  ArenaIndex IndexOf(const SatClause* clause) const;
+
+  // Marks the memory of the given clause as unused.
+  void ReleaseClause(const SatClause& clause) {
+    num_wasted_words_ += NumWords(clause.Size());
+  }
+
+  // Number of 32-bit words allocated and wasted. Wasted words are the ones of
+  // released clauses, and the unused ends of blocks.
+  int64 num_words() const { return num_words_; }
+  int64 num_wasted_words() const { return num_wasted_words_; }
+
+  void Swap(ClauseArena* other);
+
+ private:
+  // A block holds at most 2^kBlockBits 32-bit words, and the index of the
+  // block is stored in the higher bits of an ArenaIndex.
+  static const int kBlockBits = 22;
+  static const int kOffsetMask = (1 << kBlockBits) - 1;
+  static const int kMinBlockWords = 1 << 10;
+
+  // Returns the number of 32-bit words used by a clause of the given size.
+  static int NumWords(int num_literals);
+
+  // Returns the index of num_words new contiguous words.
+  ArenaIndex Allocate(int num_words);
+
+  std::vector<std::unique_ptr<uint32[]>> blocks_;
+  std::vector<int> block_sizes_;
+  // Number of words used in the last block.
+  int last_block_size_;
+  int64 num_words_;
+  int64 num_wasted_words_;
+
+  DISALLOW_COPY_AND_ASSIGN(ClauseArena);
+};
+
 // Stores the 2-watched literals data structure.  See
 // http://www.cs.berkeley.edu/~necula/autded/lecture24-sat.pdf for
 // detail.
@@ -181,6 +256,32 @@ class LiteralWatchers : public Propagator {
   // Resizes the data structure.
   void Resize(int num_variables);
 
+  // Creates a clause, see ClauseArena::NewClause(). The clause is owned by
+  // this class.
+  SatClause* NewClause(const std::vector<Literal>& literals,
+                       bool is_redundant, ResolutionNode* node) {
+    return arena_.NewClause(literals, is_redundant, node);
+  }
+
+  // Indicates that the given clause, which must be detached, will never be
+  // used again.
+  void ReleaseClause(SatClause* clause) {
+    DCHECK(!clause->IsAttached());
+    arena_.ReleaseClause(*clause);
+  }
+
+  // Returns true if enough clause memory was released to make worthwhile a
+  // call to CompactClauses().
+  bool ShouldCompactClauses() const {
+    return 4 * arena_.num_wasted_words() > arena_.num_words();
+  }
+
+  // Moves all the given clauses, which must be all the attached clauses, to a
+  // new contiguous memory and releases the old one. The pointers in 'clauses'
+  // are updated, and all other SatClause* become invalid. This must be called
+  // with clean watchers.
+  void CompactClauses(const Trail& trail, std::vector<SatClause*>* clauses);
+
   // Attaches the given clause. This eventually propagates a literal which is
   // enqueued on the trail. Returns false if a contradiction was encountered.
   bool AttachAndPropagate(SatClause* clause, Trail* trail);
@@ -224,15 +325,15 @@ class LiteralWatchers : public Propagator {
   // The blocking_literal can be any literal from the clause, it is used to
   // speed up PropagateOnFalse() by skipping the clause if it is true.
   void AttachOnFalse(Literal literal, Literal blocking_literal,
-                     SatClause* clause);
+                     ArenaIndex clause);
 
   // AttachOnFalse and SetReasonClause() need to be called from
   // SatClause::AttachAndEnqueuePotentialUnitPropagation().
   //
   // TODO(user): This is not super clean, find a better way.
   friend bool SatClause::AttachAndEnqueuePotentialUnitPropagation(
-      Trail* trail, LiteralWatchers* demons);
-  void SetReasonClause(int trail_index, SatClause* clause) {
+      ArenaIndex index, Trail* trail, LiteralWatchers* demons);
+  void SetReasonClause(int trail_index, ArenaIndex clause) {
     reasons_[trail_index] = clause;
   }
 
@@ -240,18 +341,22 @@ class LiteralWatchers : public Propagator {
   // if we are adding the clause or deleting it.
   void UpdateStatistics(const SatClause& clause, bool added);
 
+  // All the clauses attached to this class.
+  ClauseArena arena_;
+
   // Contains, for each literal, the list of clauses that need to be inspected
-  // when the corresponding literal becomes false.
+  // when the corresponding literal becomes false. Note that a Watcher only
+  // uses 8 bytes.
   struct Watcher {
     Watcher() {}
-    Watcher(SatClause* c, Literal b) : clause(c), blocking_literal(b) {}
-    SatClause* clause;
+    Watcher(ArenaIndex c, Literal b) : clause(c), blocking_literal(b) {}
+    ArenaIndex clause;
     Literal blocking_literal;
   };
   ITIVector<LiteralIndex, std::vector<Watcher> > watchers_on_false_;
 
   // SatClause reasons by trail_index.
-  std::vector<SatClause*> reasons_;
+  std::vector<ArenaIndex> reasons_;
 
   // Indicates if the corresponding watchers_on_false_ list need to be
   // cleaned. The boolean is_clean_ is just used in DCHECKs.
@@ -346,6 +451,9 @@ class BinaryImplicationGraph : public Propagator {
   BinaryImplicationGraph()
       : Propagator("BinaryImplicationGraph"),
         num_implications_(0),
+        num_new_implications_(0),
+        num_removed_implications_(0),
+        num_equivalent_literals_(0),
         num_propagations_(0),
         num_inspections_(0),
         num_minimization_(0),
@@ -397,6 +505,23 @@ class BinaryImplicationGraph : public Propagator {
   void RemoveFixedVariables(int first_unprocessed_trail_index,
                             const Trail& trail);
 
+  // Moves the implications added or removed since the last compaction into
+  // the compact storage if there are enough of them. This can be called at
+  // any decision level, but not during a propagation.
+  void CompactImplicationsIfNeeded();
+
+  // Finds the strongly connected components of the implication graph. All the
+  // literals of a component are equivalent: the implications of a component
+  // are moved to its representative, and the other literals of the component
+  // just imply and are implied by it. Returns false if a literal is found
+  // equivalent to its negation, which means that the problem is UNSAT.
+  //
+  // This must be called at level 0, after RemoveFixedVariables().
+  bool DetectEquivalences();
+
+  // Number of literals merged by DetectEquivalences() so far.
+  int64 num_equivalent_literals() const { return num_equivalent_literals_; }
+
   // Number of literal propagated by this class (including conflicts).
   int64 num_propagations() const { return num_propagations_; }
 
@@ -415,17 +540,24 @@ class BinaryImplicationGraph : public Propagator {
   // Returns the number of current implications.
   int64 NumberOfImplications() const { return num_implications_; }
 
+  // Returns true if 'literal' being true directly implies other literals.
+  bool HasImplications(Literal literal) const {
+    const LiteralIndex index = literal.Index();
+    return index < csr_size_.size() &&
+           (csr_size_[index] > 0 || !new_implications_[index].empty());
+  }
+
   // Extract all the binary clauses managed by this class. The Output type must
   // support an AddBinaryClause(Literal a, Literal b) function.
   template <typename Output>
   void ExtractAllBinaryClauses(Output* out) const {
-    for (LiteralIndex i(0); i < implications_.size(); ++i) {
+    for (LiteralIndex i(0); i < csr_size_.size(); ++i) {
       const Literal a = Literal(i).Negated();
-      for (const Literal b : implications_[i]) {
+      ForEachImplication(i, [a, out](Literal b) {
         // Because we store implications, the clause will actually appear twice
         // as (a, b) and (b, a). We output only one.
         if (a < b) out->AddBinaryClause(a, b);
-      }
+      });
     }
   }
 
@@ -436,17 +568,57 @@ class BinaryImplicationGraph : public Propagator {
   // This calls trail->Enqueue() on the newly assigned literals.
   bool PropagateOnTrue(Literal true_literal, Trail* trail);
 
+  bool PropagateImplications(Literal true_literal, const Literal* begin,
+                             const Literal* end, Trail* trail);
+
   // Remove any literal whose negation is marked (except the first one).
   void RemoveRedundantLiterals(std::vector<Literal>* conflict);
 
+  // Calls f(literal) on each literal implied by the literal of the given
+  // index.
+  template <typename Function>
+  void ForEachImplication(LiteralIndex index, Function f) const {
+    const Literal* const begin = csr_literals_.data() + csr_start_[index];
+    for (const Literal* it = begin; it < begin + csr_size_[index]; ++it) {
+      f(*it);
+    }
+    for (const Literal literal : new_implications_[index]) f(literal);
+  }
+
+  // Removes the literals implied by the literal of the given index for which
+  // predicate(literal) is true. The predicate is called once on each literal,
+  // in the same order as ForEachImplication().
+  template <typename Predicate>
+  void RemoveImplicationsIf(LiteralIndex index, Predicate predicate);
+
+  // Randomly shuffles the literals implied by the literal of the given index.
+  void ShuffleImplications(LiteralIndex index, RandomBase* random);
+
+  // Rebuilds the compact storage from the given implication lists, and
+  // clears new_implications_.
+  void BuildCompactStorage(
+      const ITIVector<LiteralIndex, std::vector<Literal>>& implications);
+
   // Binary reasons by trail_index.
   std::vector<Literal> reasons_;
 
-  // This is indexed by the Index() of a literal. Each list stores the
-  // literals that are implied if the index literal becomes true.
-  ITIVector<LiteralIndex, std::vector<Literal>> implications_;
+  // The literals implied by the literal of index i, if it becomes true. For
+  // cache efficiency, most of them are stored contiguously: they are the
+  // csr_size_[i] literals starting at csr_literals_[csr_start_[i]] (in the
+  // compressed sparse row format). They are followed by the ones added since
+  // the last compaction, in new_implications_[i].
+  std::vector<Literal> csr_literals_;
+  ITIVector<LiteralIndex, int> csr_start_;
+  ITIVector<LiteralIndex, int> csr_size_;
+  ITIVector<LiteralIndex, std::vector<Literal>> new_implications_;
   int64 num_implications_;
 
+  // Number of implications in new_implications_, and of slots left unused in
+  // csr_literals_ by the removals. Used to decide when to compact.
+  int64 num_new_implications_;
+  int64 num_removed_implications_;
+  int64 num_equivalent_literals_;
+
   // Some stats.
   int64 num_propagations_;
   int64 num_inspections_;
@@ -464,6 +636,10 @@ class BinaryImplicationGraph : public Propagator {
   // Temporary stack used by MinimizeClauseWithReachability().
   std::vector<Literal> dfs_stack_;
 
+  // Used by DetectEquivalences(), its memory is kept from one call to the
+  // next.
+  StronglyConnectedComponentsFinder<int32> scc_finder_;
+
   mutable StatsGroup stats_;
   DISALLOW_COPY_AND_ASSIGN(BinaryImplicationGraph);
 };
@@ -0,0 +1,76 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sat/drat_writer.h"
+
+#include <cstdlib>
+
+#include "base/logging.h"
+#include "base/stringprintf.h"
+
+namespace operations_research {
+namespace sat {
+
+namespace {
+// The buffer is written to the output as soon as it is larger than this.
+const int kMaxBufferSize = 1 << 16;
+}  // namespace
+
+DratWriter::DratWriter(bool in_binary_format, File* output)
+    : in_binary_format_(in_binary_format), output_(output) {
+  CHECK(output != nullptr);
+  buffer_.reserve(kMaxBufferSize + 1024);
+}
+
+DratWriter::~DratWriter() {
+  Flush();
+  CHECK(output_->Close());
+}
+
+void DratWriter::AddClause(ClauseRef clause) { WriteClause(false, clause); }
+
+void DratWriter::DeleteClause(ClauseRef clause) { WriteClause(true, clause); }
+
+void DratWriter::Flush() {
+  if (buffer_.empty()) return;
+  output_->WriteOrDie(buffer_.data(), buffer_.size());
+  buffer_.clear();
+}
+
+void DratWriter::WriteClause(bool is_deletion, ClauseRef clause) {
+  if (in_binary_format_) {
+    // Each literal is encoded as 2 * (variable + 1) + sign using 7 bits per
+    // byte, the high bit of a byte being set if more bytes follow.
+    buffer_.push_back(is_deletion ? 'd' : 'a');
+    for (const Literal literal : clause) {
+      const int signed_value = literal.SignedValue();
+      uint32 value = 2 * std::abs(signed_value) + (signed_value < 0 ? 1 : 0);
+      while (value > 127) {
+        buffer_.push_back(static_cast<char>((value & 127) | 128));
+        value >>= 7;
+      }
+      buffer_.push_back(static_cast<char>(value));
+    }
+    buffer_.push_back(0);
+  } else {
+    if (is_deletion) buffer_.append("d ");
+    for (const Literal literal : clause) {
+      StringAppendF(&buffer_, "%d ", literal.SignedValue());
+    }
+    buffer_.append("0\n");
+  }
+  if (buffer_.size() > kMaxBufferSize) Flush();
+}
+
+}  // namespace sat
+}  // namespace operations_research
@@ -0,0 +1,73 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Streaming of DRAT unsatisfiability proofs.
+//
+// Unlike the in-memory resolution graph of unsat_proof.h, a DRAT proof is just
+// the sequence of the clauses added and deleted by the solver, in order. It
+// can be written to a file (or a pipe) while the solver runs, with a memory
+// usage bounded by the size of the write buffer, and checked afterwards by an
+// external tool like drat-trim: https://www.cs.utexas.edu/~marijn/drat-trim/
+//
+// Note that the added clauses must be derivable by unit propagation from the
+// problem clauses and the clauses previously added, so this doesn't work with
+// the pseudo-Boolean reasoning of the solver.
+
+#ifndef OR_TOOLS_SAT_DRAT_WRITER_H_
+#define OR_TOOLS_SAT_DRAT_WRITER_H_
+
+#include <string>
+#include <vector>
+
+#include "base/file.h"
+#include "base/macros.h"
+#include "sat/sat_base.h"
+
+namespace operations_research {
+namespace sat {
+
+class DratWriter {
+ public:
+  // Takes ownership of the given file, which is closed on destruction. The
+  // binary format is about two times more compact than the textual one.
+  DratWriter(bool in_binary_format, File* output);
+  ~DratWriter();
+
+  // Writes an added or a deleted clause. An empty added clause terminates the
+  // proof.
+  void AddClause(ClauseRef clause);
+  void AddClause(const std::vector<Literal>& clause) {
+    AddClause(ClauseRef(clause.data(), clause.data() + clause.size()));
+  }
+  void DeleteClause(ClauseRef clause);
+  void DeleteClause(const std::vector<Literal>& clause) {
+    DeleteClause(ClauseRef(clause.data(), clause.data() + clause.size()));
+  }
+
+  // Writes the buffered clauses to the output.
+  void Flush();
+
+ private:
+  void WriteClause(bool is_deletion, ClauseRef clause);
+
+  const bool in_binary_format_;
+  File* output_;
+  std::string buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(DratWriter);
+};
+
+}  // namespace sat
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_SAT_DRAT_WRITER_H_
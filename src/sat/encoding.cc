@@ -205,6 +205,13 @@ void IncreaseNodeSize(EncodingNode* node, SatSolver* solver) {
   }
 }
 
+void IncreaseNodeSizeUpTo(int target_ub, EncodingNode* node,
+                          SatSolver* solver) {
+  while (node->current_ub() < std::min(target_ub, node->ub())) {
+    IncreaseNodeSize(node, solver);
+  }
+}
+
 EncodingNode FullMerge(Coefficient upper_bound, EncodingNode* a,
                        EncodingNode* b, SatSolver* solver) {
   EncodingNode n;
@@ -133,6 +133,12 @@ EncodingNode LazyMerge(EncodingNode* a, EncodingNode* b, SatSolver* solver);
 // literals.
 void IncreaseNodeSize(EncodingNode* node, SatSolver* solver);
 
+// Calls IncreaseNodeSize() until current_ub() of the given node reaches
+// target_ub or the node ub(). This is how a lazy node is expanded up to the
+// literals needed by a bound: unlike FullMerge(), the number of literals and
+// clauses created only depends on this bound and not on the node ub().
+void IncreaseNodeSizeUpTo(int target_ub, EncodingNode* node, SatSolver* solver);
+
 // Merges the two given EncodingNode by creating a new node that corresponds to
 // the sum of the two given ones. The given upper_bound is interpreted as a
 // bound on this sum, and allows to create less binary variables.
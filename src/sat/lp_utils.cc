@@ -30,138 +30,154 @@ using operations_research::MPConstraintProto;
 using operations_research::MPModelProto;
 using operations_research::MPVariableProto;
 
-bool ConvertBinaryMPModelProtoToBooleanProblem(const MPModelProto& mp_model,
-                                               LinearBooleanProblem* problem) {
-  CHECK(problem != nullptr);
-  problem->Clear();
-  problem->set_name(mp_model.name());
-  const int num_variables = mp_model.variable_size();
-  problem->set_num_variables(num_variables);
+namespace {
 
-  // Test if the variables are binary variables.
-  // Add constraints for the fixed variables.
-  for (int var_id(0); var_id < num_variables; ++var_id) {
-    const MPVariableProto& mp_var = mp_model.variable(var_id);
-    problem->add_var_names(mp_var.name());
+// Returns false, with a warning, if the given variable is not binary.
+// Otherwise sets fixed_value to the value of the variable if its bounds fix it,
+// and to -1 if it is a free binary variable.
+bool CheckBinaryVariable(int var_id, const MPVariableProto& mp_var,
+                         int* fixed_value) {
+  // This will be changed to false as soon as we detect the variable to be
+  // non-binary. This is done this way so we can display a nice error message
+  // before returning false.
+  bool is_binary = mp_var.is_integer();
+  *fixed_value = -1;
 
-    // This will be changed to false as soon as we detect the variable to be
-    // non-binary. This is done this way so we can display a nice error message
-    // before aborting the function and returning false.
-    bool is_binary = mp_var.is_integer();
-
-    const Fractional lb = mp_var.lower_bound();
-    const Fractional ub = mp_var.upper_bound();
-    if (lb <= -1.0) is_binary = false;
-    if (ub >= 2.0) is_binary = false;
-    if (is_binary) {
-      // 4 cases.
-      if (lb <= 0.0 && ub >= 1.0) {
-        // Binary variable. Ok.
-      } else if (lb <= 1.0 && ub >= 1.0) {
-        // Fixed variable at 1.
-        LinearBooleanConstraint* constraint = problem->add_constraints();
-        constraint->set_lower_bound(1);
-        constraint->set_upper_bound(1);
-        constraint->add_literals(var_id + 1);
-        constraint->add_coefficients(1);
-      } else if (lb <= 0.0 && ub >= 0.0) {
-        // Fixed variable at 0.
-        LinearBooleanConstraint* constraint = problem->add_constraints();
-        constraint->set_lower_bound(1);
-        constraint->set_upper_bound(1);
-        constraint->add_literals(var_id + 1);
-        constraint->add_coefficients(1);
-      } else {
-        // No possible integer value!
-        is_binary = false;
-      }
-    }
-
-    // Abort if the variable is not binary.
-    if (!is_binary) {
-      LOG(WARNING) << "The variable #" << var_id << " with name "
-                   << mp_var.name() << " is not binary. "
-                   << "lb: " << lb << " ub: " << ub;
-      return false;
+  const Fractional lb = mp_var.lower_bound();
+  const Fractional ub = mp_var.upper_bound();
+  if (lb <= -1.0) is_binary = false;
+  if (ub >= 2.0) is_binary = false;
+  if (is_binary) {
+    // 4 cases.
+    if (lb <= 0.0 && ub >= 1.0) {
+      // Binary variable. Ok.
+    } else if (lb <= 1.0 && ub >= 1.0) {
+      // Fixed variable at 1.
+      *fixed_value = 1;
+    } else if (lb <= 0.0 && ub >= 0.0) {
+      // Fixed variable at 0.
+      *fixed_value = 0;
+    } else {
+      // No possible integer value!
+      is_binary = false;
     }
   }
+  if (!is_binary) {
+    LOG(WARNING) << "The variable #" << var_id << " with name "
+                 << mp_var.name() << " is not binary. "
+                 << "lb: " << lb << " ub: " << ub;
+  }
+  return is_binary;
+}
+
+// Maximum errors of the double -> int64 conversion of the constraints.
+struct ConstraintScalingErrors {
+  ConstraintScalingErrors()
+      : max_relative_error(0.0),
+        max_bound_error(0.0),
+        max_scaling_factor(0.0) {}
+  double max_relative_error;
+  double max_bound_error;
+  double max_scaling_factor;
+};
 
-  // Variables needed to scale the double coefficients into int64.
+// Scales the given constraint to integer coefficients. The terms are returned
+// in the given vector, and the bounds that are not trivial in lb and ub with
+// use_lb and use_ub set accordingly. The given coefficients vector is only
+// used as a buffer. Returns false if the constraint is trivially
+// unsatisfiable.
+bool ScaleMPConstraint(const MPConstraintProto& mp_constraint,
+                       std::vector<double>* coefficients,
+                       ConstraintScalingErrors* errors,
+                       std::vector<LiteralWithCoeff>* terms, bool* use_lb,
+                       Coefficient* lb, bool* use_ub, Coefficient* ub) {
   const int64 kInt64Max = std::numeric_limits<int64>::max();
-  double max_relative_error = 0.0;
-  double max_bound_error = 0.0;
-  double max_scaling_factor = 0.0;
   double relative_error = 0.0;
   double scaling_factor = 0.0;
-  std::vector<double> coefficients;
 
-  // Add all constraints.
-  for (const MPConstraintProto& mp_constraint : mp_model.constraint()) {
-    LinearBooleanConstraint* constraint = problem->add_constraints();
-    constraint->set_name(mp_constraint.name());
+  // First scale the coefficients of the constraints.
+  coefficients->clear();
+  const int num_coeffs = mp_constraint.coefficient_size();
+  for (int i = 0; i < num_coeffs; ++i) {
+    coefficients->push_back(mp_constraint.coefficient(i));
+  }
+  GetBestScalingOfDoublesToInt64(*coefficients, kInt64Max, &scaling_factor,
+                                 &relative_error);
+  const int64 gcd = ComputeGcdOfRoundedDoubles(*coefficients, scaling_factor);
+  errors->max_relative_error =
+      std::max(relative_error, errors->max_relative_error);
+  errors->max_scaling_factor =
+      std::max(scaling_factor / gcd, errors->max_scaling_factor);
 
-    // First scale the coefficients of the constraints.
-    coefficients.clear();
-    const int num_coeffs = mp_constraint.coefficient_size();
-    for (int i = 0; i < num_coeffs; ++i) {
-      coefficients.push_back(mp_constraint.coefficient(i));
+  terms->clear();
+  double bound_error = 0.0;
+  for (int i = 0; i < num_coeffs; ++i) {
+    const double scaled_value = mp_constraint.coefficient(i) * scaling_factor;
+    bound_error += fabs(round(scaled_value) - scaled_value);
+    const int64 value = static_cast<int64>(round(scaled_value)) / gcd;
+    if (value != 0) {
+      terms->push_back(
+          LiteralWithCoeff(Literal(mp_constraint.var_index(i) + 1), value));
     }
-    GetBestScalingOfDoublesToInt64(coefficients, kInt64Max, &scaling_factor,
-                                   &relative_error);
-    const int64 gcd = ComputeGcdOfRoundedDoubles(coefficients, scaling_factor);
-    max_relative_error = std::max(relative_error, max_relative_error);
-    max_scaling_factor = std::max(scaling_factor / gcd, max_scaling_factor);
-
-    double bound_error = 0.0;
-    for (int i = 0; i < num_coeffs; ++i) {
-      const double scaled_value = mp_constraint.coefficient(i) * scaling_factor;
-      bound_error += fabs(round(scaled_value) - scaled_value);
-      const int64 value = static_cast<int64>(round(scaled_value)) / gcd;
-      if (value != 0) {
-        constraint->add_literals(mp_constraint.var_index(i) + 1);
-        constraint->add_coefficients(value);
-      }
+  }
+  errors->max_bound_error = std::max(errors->max_bound_error, bound_error);
+
+  // Add the bounds. Note that we do not pass them to
+  // GetBestScalingOfDoublesToInt64() because we know that the sum of absolute
+  // coefficients of the constraint fit on an int64. If one of the scaled
+  // bound overflows, we don't care by how much because in this case the
+  // constraint is just trivial or unsatisfiable.
+  *use_lb = false;
+  *use_ub = false;
+  const Fractional mp_lb = mp_constraint.lower_bound();
+  if (mp_lb != -kInfinity) {
+    if (mp_lb * scaling_factor > static_cast<double>(kInt64Max)) {
+      LOG(WARNING) << "A constraint is trivially unsatisfiable.";
+      return false;
     }
-    max_bound_error = std::max(max_bound_error, bound_error);
-
-    // Add the bounds. Note that we do not pass them to
-    // GetBestScalingOfDoublesToInt64() because we know that the sum of absolute
-    // coefficients of the constraint fit on an int64. If one of the scaled
-    // bound overflows, we don't care by how much because in this case the
-    // constraint is just trivial or unsatisfiable.
-    const Fractional lb = mp_constraint.lower_bound();
-    if (lb != -kInfinity) {
-      if (lb * scaling_factor > static_cast<double>(kInt64Max)) {
-        LOG(WARNING) << "A constraint is trivially unsatisfiable.";
-        return false;
-      }
-      if (lb * scaling_factor > -static_cast<double>(kInt64Max)) {
-        // Otherwise, the constraint is not needed.
-        constraint->set_lower_bound(
-            static_cast<int64>(round(lb * scaling_factor - bound_error)) / gcd);
-      }
+    if (mp_lb * scaling_factor > -static_cast<double>(kInt64Max)) {
+      // Otherwise, the constraint is not needed.
+      *use_lb = true;
+      *lb = Coefficient(
+          static_cast<int64>(round(mp_lb * scaling_factor - bound_error)) /
+          gcd);
     }
-    const Fractional ub = mp_constraint.upper_bound();
-    if (ub != kInfinity) {
-      if (ub * scaling_factor < -static_cast<double>(kInt64Max)) {
-        LOG(WARNING) << "A constraint is trivially unsatisfiable.";
-        return false;
-      }
-      if (ub * scaling_factor < static_cast<double>(kInt64Max)) {
-        // Otherwise, the constraint is not needed.
-        constraint->set_upper_bound(
-            static_cast<int64>(round(ub * scaling_factor + bound_error)) / gcd);
-      }
+  }
+  const Fractional mp_ub = mp_constraint.upper_bound();
+  if (mp_ub != kInfinity) {
+    if (mp_ub * scaling_factor < -static_cast<double>(kInt64Max)) {
+      LOG(WARNING) << "A constraint is trivially unsatisfiable.";
+      return false;
+    }
+    if (mp_ub * scaling_factor < static_cast<double>(kInt64Max)) {
+      // Otherwise, the constraint is not needed.
+      *use_ub = true;
+      *ub = Coefficient(
+          static_cast<int64>(round(mp_ub * scaling_factor + bound_error)) /
+          gcd);
     }
   }
+  return true;
+}
 
-  // Display the error/scaling without taking into account the objective first.
-  LOG(INFO) << "Maximum constraint relative error: " << max_relative_error;
-  LOG(INFO) << "Maximum constraint bound error: " << max_bound_error;
-  LOG(INFO) << "Maximum constraint scaling factor: " << max_scaling_factor;
+void LogConstraintScalingErrors(const ConstraintScalingErrors& errors) {
+  LOG(INFO) << "Maximum constraint relative error: "
+            << errors.max_relative_error;
+  LOG(INFO) << "Maximum constraint bound error: " << errors.max_bound_error;
+  LOG(INFO) << "Maximum constraint scaling factor: "
+            << errors.max_scaling_factor;
+}
 
-  // Add the objective.
-  coefficients.clear();
+// Scales the objective of the given model to integer coefficients and returns
+// the relative error of this conversion.
+double ConvertMPObjective(const MPModelProto& mp_model,
+                          LinearObjective* objective) {
+  const int64 kInt64Max = std::numeric_limits<int64>::max();
+  const int num_variables = mp_model.variable_size();
+  double relative_error = 0.0;
+  double scaling_factor = 0.0;
+  std::vector<double> coefficients;
+  coefficients.reserve(num_variables);
   for (int var_id = 0; var_id < num_variables; ++var_id) {
     const MPVariableProto& mp_var = mp_model.variable(var_id);
     coefficients.push_back(mp_var.objective_coefficient());
@@ -169,23 +185,20 @@ bool ConvertBinaryMPModelProtoToBooleanProblem(const MPModelProto& mp_model,
   GetBestScalingOfDoublesToInt64(coefficients, kInt64Max, &scaling_factor,
                                  &relative_error);
   const int64 gcd = ComputeGcdOfRoundedDoubles(coefficients, scaling_factor);
-  max_relative_error = std::max(relative_error, max_relative_error);
 
   // Display the objective error/scaling.
   LOG(INFO) << "objective relative error: " << relative_error;
   LOG(INFO) << "objective scaling factor: " << scaling_factor / gcd;
 
-  LinearObjective* objective = problem->mutable_objective();
+  objective->Clear();
   objective->set_offset(mp_model.objective_offset() * scaling_factor / gcd);
 
   // Note that here we set the scaling factor for the inverse operation of
   // getting the "true" objective value from the scaled one. Hence the inverse.
   objective->set_scaling_factor(1.0 / scaling_factor * gcd);
   for (int var_id = 0; var_id < num_variables; ++var_id) {
-    const MPVariableProto& mp_var = mp_model.variable(var_id);
-    const int64 value = static_cast<int64>(round(
-                            mp_var.objective_coefficient() * scaling_factor)) /
-                        gcd;
+    const int64 value =
+        static_cast<int64>(round(coefficients[var_id] * scaling_factor)) / gcd;
     if (value != 0) {
       objective->add_literals(var_id + 1);
       objective->add_coefficients(value);
@@ -193,9 +206,19 @@ bool ConvertBinaryMPModelProtoToBooleanProblem(const MPModelProto& mp_model,
   }
 
   // If the problem was a maximization one, we need to modify the objective.
-  if (mp_model.maximize()) ChangeOptimizationDirection(problem);
+  // This is the same as ChangeOptimizationDirection().
+  if (mp_model.maximize()) {
+    objective->set_scaling_factor(-objective->scaling_factor());
+    objective->set_offset(-objective->offset());
+    for (auto& coefficients_ref : *objective->mutable_coefficients()) {
+      coefficients_ref = -coefficients_ref;
+    }
+  }
+  return relative_error;
+}
 
-  // Test the precision of the conversion.
+// Tests the precision of the conversion.
+bool IsScalingPrecise(double max_relative_error) {
   const double kRelativeTolerance = 1e-8;
   if (max_relative_error > kRelativeTolerance) {
     LOG(WARNING) << "The relative error during double -> int64 conversion "
@@ -205,6 +228,121 @@ bool ConvertBinaryMPModelProtoToBooleanProblem(const MPModelProto& mp_model,
   return true;
 }
 
+}  // namespace
+
+bool ConvertBinaryMPModelProtoToBooleanProblem(const MPModelProto& mp_model,
+                                               LinearBooleanProblem* problem) {
+  CHECK(problem != nullptr);
+  problem->Clear();
+  problem->set_name(mp_model.name());
+  const int num_variables = mp_model.variable_size();
+  problem->set_num_variables(num_variables);
+
+  // Test if the variables are binary variables.
+  // Add constraints for the fixed variables.
+  for (int var_id(0); var_id < num_variables; ++var_id) {
+    const MPVariableProto& mp_var = mp_model.variable(var_id);
+    problem->add_var_names(mp_var.name());
+    int fixed_value = -1;
+    if (!CheckBinaryVariable(var_id, mp_var, &fixed_value)) return false;
+    if (fixed_value != -1) {
+      LinearBooleanConstraint* constraint = problem->add_constraints();
+      constraint->set_lower_bound(fixed_value);
+      constraint->set_upper_bound(fixed_value);
+      constraint->add_literals(var_id + 1);
+      constraint->add_coefficients(1);
+    }
+  }
+
+  // Add all constraints.
+  ConstraintScalingErrors errors;
+  std::vector<double> coefficients;
+  std::vector<LiteralWithCoeff> terms;
+  for (const MPConstraintProto& mp_constraint : mp_model.constraint()) {
+    LinearBooleanConstraint* constraint = problem->add_constraints();
+    constraint->set_name(mp_constraint.name());
+    bool use_lb = false;
+    bool use_ub = false;
+    Coefficient lb(0);
+    Coefficient ub(0);
+    if (!ScaleMPConstraint(mp_constraint, &coefficients, &errors, &terms,
+                           &use_lb, &lb, &use_ub, &ub)) {
+      return false;
+    }
+    for (const LiteralWithCoeff& term : terms) {
+      constraint->add_literals(term.literal.SignedValue());
+      constraint->add_coefficients(term.coefficient.value());
+    }
+    if (use_lb) constraint->set_lower_bound(lb.value());
+    if (use_ub) constraint->set_upper_bound(ub.value());
+  }
+
+  // Display the error/scaling without taking into account the objective first.
+  LogConstraintScalingErrors(errors);
+
+  // Add the objective.
+  const double objective_error =
+      ConvertMPObjective(mp_model, problem->mutable_objective());
+  return IsScalingPrecise(std::max(objective_error, errors.max_relative_error));
+}
+
+bool LoadBinaryMPModelProto(const MPModelProto& mp_model, SatSolver* solver,
+                            LinearObjective* objective) {
+  CHECK(solver != nullptr);
+  const int num_variables = mp_model.variable_size();
+  if (solver->parameters().log_search_progress()) {
+    LOG(INFO) << "Loading model '" << mp_model.name() << "', " << num_variables
+              << " variables, " << mp_model.constraint_size()
+              << " constraints.";
+  }
+  solver->SetNumVariables(num_variables);
+
+  // Test if the variables are binary variables, and fix the fixed variables.
+  // Note that it is more efficient to add the unit clauses first.
+  for (int var_id(0); var_id < num_variables; ++var_id) {
+    int fixed_value = -1;
+    if (!CheckBinaryVariable(var_id, mp_model.variable(var_id),
+                             &fixed_value)) {
+      return false;
+    }
+    if (fixed_value != -1) {
+      const Literal literal(VariableIndex(var_id), fixed_value == 1);
+      if (!solver->AddUnitClause(literal)) return false;
+    }
+  }
+
+  // Add all constraints. The terms are canonicalized in place by
+  // AddLinearConstraint(), which reuses the same vector for all of them.
+  ConstraintScalingErrors errors;
+  std::vector<double> coefficients;
+  std::vector<LiteralWithCoeff> terms;
+  int num_constraints = 0;
+  for (const MPConstraintProto& mp_constraint : mp_model.constraint()) {
+    bool use_lb = false;
+    bool use_ub = false;
+    Coefficient lb(0);
+    Coefficient ub(0);
+    if (!ScaleMPConstraint(mp_constraint, &coefficients, &errors, &terms,
+                           &use_lb, &lb, &use_ub, &ub)) {
+      return false;
+    }
+    if (!solver->AddLinearConstraint(use_lb, lb, use_ub, ub, &terms)) {
+      LOG(INFO) << "Problem detected to be UNSAT when "
+                << "adding the constraint #" << num_constraints
+                << " with name '" << mp_constraint.name() << "'";
+      return false;
+    }
+    ++num_constraints;
+  }
+  LogConstraintScalingErrors(errors);
+
+  double objective_error = 0.0;
+  if (objective != nullptr) {
+    objective_error = ConvertMPObjective(mp_model, objective);
+  }
+  return IsScalingPrecise(std::max(objective_error, errors.max_relative_error));
+}
+
 void ConvertBooleanProblemToLinearProgram(const LinearBooleanProblem& problem,
                                           glop::LinearProgram* lp) {
   lp->Clear();
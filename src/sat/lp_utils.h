@@ -31,6 +31,16 @@ namespace sat {
 bool ConvertBinaryMPModelProtoToBooleanProblem(const MPModelProto& mp_model,
                                                LinearBooleanProblem* problem);
 
+// Same conversion as ConvertBinaryMPModelProtoToBooleanProblem(), but the
+// constraints are directly added to the given solver instead of being stored
+// in an intermediate LinearBooleanProblem, so that only one copy of the model
+// is built. The objective, if not null, is filled like the one of the
+// converted problem. Also returns false if the problem is detected to be UNSAT
+// during the loading. Note that the solver may be partially loaded when this
+// returns false.
+bool LoadBinaryMPModelProto(const MPModelProto& mp_model, SatSolver* solver,
+                            LinearObjective* objective);
+
 // Converts a Boolean optimization problem to its lp formulation.
 void ConvertBooleanProblemToLinearProgram(const LinearBooleanProblem& problem,
                                           glop::LinearProgram* lp);
@@ -14,8 +14,11 @@
 #include "sat/optimization.h"
 
 #include <deque>
+#include <memory>
 #include <queue>
 
+#include "base/callback.h"
+#include "base/threadpool.h"
 #include "google/protobuf/descriptor.h"
 #include "sat/encoding.h"
 
@@ -877,11 +880,9 @@ SatSolver::Status SolveWithCardinalityEncoding(
 
   // Initialize the current objective.
   Coefficient objective = kCoefficientMax;
-  Coefficient upper_bound = kCoefficientMax;
   if (!solution->empty()) {
     CHECK(IsAssignmentValid(problem, *solution));
     objective = ComputeObjectiveValue(problem, *solution);
-    upper_bound = objective + offset;
   }
 
   // Print the number of variables with a non-zero cost.
@@ -889,10 +890,12 @@ SatSolver::Status SolveWithCardinalityEncoding(
                           nodes.size(), problem.num_variables(),
                           problem.constraints_size()));
 
-  // Create the sorter network.
+  // Create the sorter network lazily. Only the left-most literal of each node
+  // exists at this point, the others are created below when the objective
+  // bound needs them. Compared to a full encoding, this only creates the
+  // literals and clauses up to the first objective found.
   solver->Backtrack(0);
-  EncodingNode* root =
-      MergeAllNodesWithDeque(upper_bound, nodes, solver, &repository);
+  EncodingNode* root = LazyMergeAllNodeWithPQ(nodes, solver, &repository);
   logger.Log(StringPrintf("c encoding depth:%d", root->depth()));
 
   while (true) {
@@ -902,7 +905,8 @@ SatSolver::Status SolveWithCardinalityEncoding(
       const int index = offset.value() + objective.value();
       if (index == 0) return SatSolver::MODEL_SAT;
       solver->Backtrack(0);
-      if (!solver->AddUnitClause(root->literal(index - 1).Negated())) {
+      IncreaseNodeSizeUpTo(index, root, solver);
+      if (!solver->AddUnitClause(root->GreaterThan(index - 1).Negated())) {
         return SatSolver::MODEL_SAT;
       }
     }
@@ -939,6 +943,179 @@ bool EncodingNodeByDepth(const EncodingNode* a, const EncodingNode* b) {
 
 bool EmptyEncodingNode(const EncodingNode* a) { return a->size() == 0; }
 
+// Output of SatSolver::ExtractClauses() that adds the clauses to another
+// solver.
+class ClauseCopier {
+ public:
+  explicit ClauseCopier(SatSolver* solver) : solver_(solver), ok_(true) {}
+  void AddBinaryClause(Literal a, Literal b) {
+    ok_ = ok_ && solver_->AddBinaryClause(a, b);
+  }
+  void AddClause(ClauseRef clause) {
+    ok_ = ok_ && solver_->AddProblemClause(
+                     std::vector<Literal>(clause.begin(), clause.end()));
+  }
+  bool ok() const { return ok_; }
+
+ private:
+  SatSolver* solver_;
+  bool ok_;
+};
+
+// Extracts, in parallel, cores that are disjoint from the ones already found
+// by the main solver. Each worker solves its own copy of the main solver with
+// a different ordering of a differently stratified subset of the assumptions:
+// it repeatedly removes the assumptions of its last core from its set until
+// the remaining ones are satisfiable. The cores of the different workers are
+// then greedily filtered so that all the cores are pairwise disjoint.
+class DisjointCoreExtractor {
+ public:
+  DisjointCoreExtractor(const LinearBooleanProblem& problem, int num_workers)
+      : problem_(problem), num_workers_(num_workers) {}
+
+  // Appends new cores to the given ones, using as assumptions the negation of
+  // the first literal of the given nodes whose weight is at least
+  // stratified_lower_bound.
+  void ExtractMoreCores(const std::vector<EncodingNode*>& nodes,
+                        Coefficient stratified_lower_bound, SatSolver* solver,
+                        std::vector<std::vector<Literal>>* cores);
+
+ private:
+  void RunWorker(int index);
+
+  const LinearBooleanProblem& problem_;
+  const int num_workers_;
+  std::vector<std::unique_ptr<SatSolver>> solvers_;
+  std::vector<std::vector<Literal>> assumptions_;
+  std::vector<std::vector<std::vector<Literal>>> worker_cores_;
+
+  DISALLOW_COPY_AND_ASSIGN(DisjointCoreExtractor);
+};
+
+void DisjointCoreExtractor::ExtractMoreCores(
+    const std::vector<EncodingNode*>& nodes, Coefficient stratified_lower_bound,
+    SatSolver* solver, std::vector<std::vector<Literal>>* cores) {
+  hash_set<LiteralIndex> in_core;
+  for (const std::vector<Literal>& core : *cores) {
+    for (const Literal literal : core) in_core.insert(literal.Index());
+  }
+  std::vector<Literal> candidates;
+  std::vector<Coefficient> weights;
+  for (EncodingNode* n : nodes) {
+    const Literal assumption = n->literal(0).Negated();
+    if (n->weight() >= stratified_lower_bound &&
+        !ContainsKey(in_core, assumption.Index())) {
+      candidates.push_back(assumption);
+      weights.push_back(n->weight());
+    }
+  }
+  if (candidates.empty()) return;
+
+  // The worker i only uses the assumptions with a weight at least the
+  // (i / num_workers) quantile of the distinct weights, in a random order
+  // except for the first worker.
+  std::vector<Coefficient> distinct_weights = weights;
+  std::sort(distinct_weights.begin(), distinct_weights.end(),
+            std::greater<Coefficient>());
+  distinct_weights.erase(
+      std::unique(distinct_weights.begin(), distinct_weights.end()),
+      distinct_weights.end());
+  solvers_.clear();
+  assumptions_.assign(num_workers_, std::vector<Literal>());
+  worker_cores_.assign(num_workers_, std::vector<std::vector<Literal>>());
+  SatParameters parameters = solver->parameters();
+  parameters.set_log_search_progress(false);
+  solver->Backtrack(0);
+  for (int i = 0; i < num_workers_; ++i) {
+    const int quantile = distinct_weights.size() * (num_workers_ - 1 - i) /
+                         num_workers_;
+    const Coefficient min_weight = distinct_weights[quantile];
+    for (int j = 0; j < candidates.size(); ++j) {
+      if (weights[j] >= min_weight) assumptions_[i].push_back(candidates[j]);
+    }
+    if (i > 0) {
+      MTRandom random(StringPrintf("DisjointCoreExtractor%d", i));
+      std::random_shuffle(assumptions_[i].begin(), assumptions_[i].end(),
+                          random);
+    }
+
+    // Copy the current state of the main solver. Note that the
+    // pseudo-Boolean constraints are not extracted, so we also load the
+    // problem.
+    solvers_.emplace_back(new SatSolver());
+    SatSolver* const copy = solvers_.back().get();
+    copy->SetParameters(parameters);
+    bool ok = LoadBooleanProblem(problem_, copy);
+    copy->SetNumVariables(solver->NumVariables());
+    for (int j = 0; ok && j < solver->LiteralTrail().Index(); ++j) {
+      ok = copy->AddUnitClause(solver->LiteralTrail()[j]);
+    }
+    if (ok) {
+      ClauseCopier copier(copy);
+      solver->ExtractClauses(&copier);
+      ok = copier.ok();
+    }
+    if (!ok) assumptions_[i].clear();
+  }
+  {
+    ThreadPool pool("DisjointCores", num_workers_);
+    pool.StartWorkers();
+    for (int i = 0; i < num_workers_; ++i) {
+      pool.Add(NewCallback(this, &DisjointCoreExtractor::RunWorker, i));
+    }
+  }
+  solvers_.clear();
+
+  // Keeps the small cores first.
+  std::vector<std::vector<Literal>> new_cores;
+  for (std::vector<std::vector<Literal>>& worker_cores : worker_cores_) {
+    for (std::vector<Literal>& core : worker_cores) {
+      new_cores.push_back(std::vector<Literal>());
+      new_cores.back().swap(core);
+    }
+  }
+  std::stable_sort(new_cores.begin(), new_cores.end(),
+                   [](const std::vector<Literal>& a,
+                      const std::vector<Literal>& b) {
+                     return a.size() < b.size();
+                   });
+  for (std::vector<Literal>& core : new_cores) {
+    bool is_disjoint = true;
+    for (const Literal literal : core) {
+      if (ContainsKey(in_core, literal.Index())) {
+        is_disjoint = false;
+        break;
+      }
+    }
+    if (!is_disjoint) continue;
+    for (const Literal literal : core) in_core.insert(literal.Index());
+    cores->push_back(std::vector<Literal>());
+    cores->back().swap(core);
+  }
+}
+
+void DisjointCoreExtractor::RunWorker(int index) {
+  SatSolver* const solver = solvers_[index].get();
+  std::vector<Literal>& assumptions = assumptions_[index];
+  while (!assumptions.empty()) {
+    const SatSolver::Status result =
+        solver->ResetAndSolveWithGivenAssumptions(assumptions);
+    if (result != SatSolver::ASSUMPTIONS_UNSAT) break;
+    std::vector<Literal> core = solver->GetLastIncompatibleDecisions();
+    if (core.empty()) break;
+    if (solver->parameters().minimize_core()) MinimizeCore(solver, &core);
+    hash_set<LiteralIndex> in_core;
+    for (const Literal literal : core) in_core.insert(literal.Index());
+    assumptions.erase(
+        std::remove_if(assumptions.begin(), assumptions.end(),
+                       [&in_core](Literal l) {
+                         return ContainsKey(in_core, l.Index());
+                       }),
+        assumptions.end());
+    worker_cores_[index].push_back(core);
+  }
+}
+
 }  // namespace
 
 SatSolver::Status SolveWithCardinalityEncodingAndCore(
@@ -980,6 +1157,8 @@ SatSolver::Status SolveWithCardinalityEncodingAndCore(
   // Start the algorithm.
   int max_depth = 0;
   std::string previous_core_info = "";
+  DisjointCoreExtractor core_extractor(problem,
+                                       parameters.max_sat_num_core_workers());
   for (int iter = 0;; ++iter) {
     // Remove the left-most variables fixed to one from each node.
     // Also update the lower_bound. Note that Reduce() needs the solver to be
@@ -1071,86 +1250,118 @@ SatSolver::Status SolveWithCardinalityEncodingAndCore(
     if (result != SatSolver::ASSUMPTIONS_UNSAT) return result;
 
     // We have a new core.
-    std::vector<Literal> core = solver->GetLastIncompatibleDecisions();
-    if (parameters.minimize_core()) MinimizeCore(solver, &core);
-
-    // Compute the min weight of all the nodes in the core.
-    // The lower bound will be increased by that much.
-    Coefficient min_weight = kCoefficientMax;
-    {
-      int index = 0;
-      for (int i = 0; i < core.size(); ++i) {
-        for (; index < nodes.size() &&
-                   nodes[index]->literal(0).Negated() != core[i];
-             ++index) {
-        }
-        CHECK_LT(index, nodes.size());
-        min_weight = std::min(min_weight, nodes[index]->weight());
-      }
-    }
-    previous_core_info =
-        StringPrintf("core:%zu mw:%lld", core.size(), min_weight.value());
-
-    // Increase stratified_lower_bound according to the parameters.
-    if (stratified_lower_bound < min_weight &&
-        parameters.max_sat_stratification() ==
-            SatParameters::STRATIFICATION_ASCENT) {
-      stratified_lower_bound = min_weight;
+    std::vector<std::vector<Literal>> cores(1);
+    cores[0] = solver->GetLastIncompatibleDecisions();
+    if (parameters.minimize_core()) MinimizeCore(solver, &cores[0]);
+    if (parameters.max_sat_num_core_workers() > 1) {
+      core_extractor.ExtractMoreCores(nodes, stratified_lower_bound, solver,
+                                      &cores);
     }
 
     // Backtrack to be able to add new constraints.
     solver->Backtrack(0);
 
-    int new_node_index = 0;
-    if (core.size() == 1) {
-      // The core will be reduced at the beginning of the next loop.
-      // Find the associated node, and call IncreaseNodeSize() on it.
-      CHECK(solver->Assignment().LiteralIsFalse(core[0]));
-      for (EncodingNode* n : nodes) {
-        if (n->literal(0).Negated() == core[0]) {
-          IncreaseNodeSize(n, solver);
-          break;
+    // The cores are pairwise disjoint, so they can be processed one after the
+    // other: processing one does not change the nodes of the others.
+    Coefficient sum_of_min_weights(0);
+    for (std::vector<Literal>& core : cores) {
+      // The cores found by the workers are not in the nodes order.
+      if (&core != &cores[0]) {
+        hash_map<LiteralIndex, int> position;
+        for (int i = 0; i < nodes.size(); ++i) {
+          position[nodes[i]->literal(0).Negated().Index()] = i;
         }
+        std::sort(core.begin(), core.end(),
+                  [&position](Literal a, Literal b) {
+                    return position[a.Index()] < position[b.Index()];
+                  });
       }
-    } else {
-      // Remove from nodes the EncodingNode in the core, merge them, and add the
-      // resulting EncodingNode at the back.
-      int index = 0;
-      std::vector<EncodingNode*> to_merge;
-      for (int i = 0; i < core.size(); ++i) {
-        // Since the nodes appear in order in the core, we can find the
-        // relevant "objective" variable efficiently with a simple linear scan
-        // in the nodes vector (done with index).
-        for (; nodes[index]->literal(0).Negated() != core[i]; ++index) {
+
+      // Compute the min weight of all the nodes in the core.
+      // The lower bound will be increased by that much.
+      Coefficient min_weight = kCoefficientMax;
+      {
+        int index = 0;
+        for (int i = 0; i < core.size(); ++i) {
+          for (; index < nodes.size() &&
+                     nodes[index]->literal(0).Negated() != core[i];
+               ++index) {
+          }
           CHECK_LT(index, nodes.size());
-          nodes[new_node_index] = nodes[index];
-          ++new_node_index;
+          min_weight = std::min(min_weight, nodes[index]->weight());
+        }
+      }
+      sum_of_min_weights += min_weight;
+      previous_core_info =
+          StringPrintf("core:%zu mw:%lld", core.size(), min_weight.value());
+
+      // Increase stratified_lower_bound according to the parameters.
+      if (stratified_lower_bound < min_weight &&
+          parameters.max_sat_stratification() ==
+              SatParameters::STRATIFICATION_ASCENT) {
+        stratified_lower_bound = min_weight;
+      }
+
+      int new_node_index = 0;
+      if (core.size() == 1) {
+        // The core will be reduced at the beginning of the next loop.
+        // Find the associated node, and call IncreaseNodeSize() on it. Note
+        // that a core found by a worker is not yet known by this solver.
+        if (!solver->Assignment().LiteralIsFalse(core[0]) &&
+            !solver->AddUnitClause(core[0].Negated())) {
+          return solution->empty() ? SatSolver::MODEL_UNSAT
+                                   : SatSolver::MODEL_SAT;
         }
-        CHECK_LT(index, nodes.size());
-        to_merge.push_back(nodes[index]);
-
-        // Special case if the weight > min_weight. we keep it, but reduce its
-        // cost. This is the same "trick" as in WPM1 used to deal with weight.
-        // We basically split a clause with a larger weight in two identical
-        // clauses, one with weight min_weight that will be merged and one with
-        // the remaining weight.
-        if (nodes[index]->weight() > min_weight) {
-          nodes[index]->set_weight(nodes[index]->weight() - min_weight);
+        for (EncodingNode* n : nodes) {
+          if (n->literal(0).Negated() == core[0]) {
+            IncreaseNodeSize(n, solver);
+            break;
+          }
+        }
+      } else {
+        // Remove from nodes the EncodingNode in the core, merge them, and add
+        // the resulting EncodingNode at the back.
+        int index = 0;
+        std::vector<EncodingNode*> to_merge;
+        for (int i = 0; i < core.size(); ++i) {
+          // Since the nodes appear in order in the core, we can find the
+          // relevant "objective" variable efficiently with a simple linear scan
+          // in the nodes vector (done with index).
+          for (; nodes[index]->literal(0).Negated() != core[i]; ++index) {
+            CHECK_LT(index, nodes.size());
+            nodes[new_node_index] = nodes[index];
+            ++new_node_index;
+          }
+          CHECK_LT(index, nodes.size());
+          to_merge.push_back(nodes[index]);
+
+          // Special case if the weight > min_weight. we keep it, but reduce
+          // its cost. This is the same "trick" as in WPM1 used to deal with
+          // weight. We basically split a clause with a larger weight in two
+          // identical clauses, one with weight min_weight that will be merged
+          // and one with the remaining weight.
+          if (nodes[index]->weight() > min_weight) {
+            nodes[index]->set_weight(nodes[index]->weight() - min_weight);
+            nodes[new_node_index] = nodes[index];
+            ++new_node_index;
+          }
+          ++index;
+        }
+        for (; index < nodes.size(); ++index) {
           nodes[new_node_index] = nodes[index];
           ++new_node_index;
         }
-        ++index;
+        nodes.resize(new_node_index);
+        nodes.push_back(LazyMergeAllNodeWithPQ(to_merge, solver, &repository));
+        IncreaseNodeSize(nodes.back(), solver);
+        max_depth = std::max(max_depth, nodes.back()->depth());
+        nodes.back()->set_weight(min_weight);
+        CHECK(solver->AddUnitClause(nodes.back()->literal(0)));
       }
-      for (; index < nodes.size(); ++index) {
-        nodes[new_node_index] = nodes[index];
-        ++new_node_index;
-      }
-      nodes.resize(new_node_index);
-      nodes.push_back(LazyMergeAllNodeWithPQ(to_merge, solver, &repository));
-      IncreaseNodeSize(nodes.back(), solver);
-      max_depth = std::max(max_depth, nodes.back()->depth());
-      nodes.back()->set_weight(min_weight);
-      CHECK(solver->AddUnitClause(nodes.back()->literal(0)));
+    }
+    if (cores.size() > 1) {
+      previous_core_info = StringPrintf("cores:%zu mw:%lld", cores.size(),
+                                        sum_of_min_weights.value());
     }
   }
 }
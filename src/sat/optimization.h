@@ -108,6 +108,10 @@ SatSolver::Status SolveWithCardinalityEncoding(
 
 // This is an original algorithm. It is a mix between the cardinality encoding
 // and the Fu & Malik algorithm. It also works on general weighted instances.
+//
+// With max_sat_num_core_workers > 1, each core found is completed in parallel
+// by a set of cores disjoint from it, extracted on copies of the solver, and
+// all of them are relaxed before the next solve.
 SatSolver::Status SolveWithCardinalityEncodingAndCore(
     LogBehavior log, const LinearBooleanProblem& problem, SatSolver* solver,
     std::vector<bool>* solution);
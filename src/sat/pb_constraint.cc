@@ -387,6 +387,9 @@ UpperBoundedLinearConstraint::UpperBoundedLinearConstraint(
       is_learned_(false),
       first_reason_trail_index_(-1),
       activity_(0.0),
+      is_watched_(false),
+      watch_target_(0),
+      watched_sum_(0),
       node_(node) {
   DCHECK(!cst.empty());
   DCHECK(std::is_sorted(cst.begin(), cst.end(), CoeffComparator));
@@ -533,8 +536,21 @@ bool UpperBoundedLinearConstraint::Propagate(
   while (index_ >= 0 && coeffs_[index_] > slack) --index_;
 
   // Check propagation.
+  if (!PropagateLiterals(starts_[index_ + 1], already_propagated_end_,
+                         trail_index, trail, helper)) {
+    Update(slack, threshold);
+    return false;
+  }
+  Update(slack, threshold);
+  DCHECK_GE(*threshold, 0);
+  return true;
+}
+
+bool UpperBoundedLinearConstraint::PropagateLiterals(
+    int begin, int end, int trail_index, Trail* trail,
+    PbConstraintsEnqueueHelper* helper) {
   VariableIndex first_propagated_variable(-1);
-  for (int i = starts_[index_ + 1]; i < already_propagated_end_; ++i) {
+  for (int i = begin; i < end; ++i) {
     if (trail->Assignment().LiteralIsFalse(literals_[i])) continue;
     if (trail->Assignment().LiteralIsTrue(literals_[i])) {
       if (trail->Info(literals_[i].Variable()).trail_index > trail_index) {
@@ -542,7 +558,6 @@ bool UpperBoundedLinearConstraint::Propagate(
         FillReason(*trail, trail_index, literals_[i].Variable(),
                    &helper->conflict);
         helper->conflict.push_back(literals_[i].Negated());
-        Update(slack, threshold);
         return false;
       }
     } else {
@@ -562,11 +577,103 @@ bool UpperBoundedLinearConstraint::Propagate(
       }
     }
   }
-  Update(slack, threshold);
-  DCHECK_GE(*threshold, 0);
   return true;
 }
 
+void UpperBoundedLinearConstraint::InitializeWatches(
+    int trail_index, const Trail& trail, std::vector<Literal>* new_watches) {
+  DCHECK(CanBeWatched());
+  if (!is_watched_) {
+    is_watched_ = true;
+    literal_is_watched_.assign(literals_.size(), false);
+    watched_sum_ = 0;
+  }
+  Coefficient sum(0);
+  for (int i = 0; i + 1 < starts_.size(); ++i) {
+    sum += coeffs_[i] * (starts_[i + 1] - starts_[i]);
+  }
+  watch_target_ = sum - rhs_ + coeffs_.back();
+
+  // We watch the largest coefficients first, and the literals already assigned
+  // to true only if there is not enough other literals. Note that the target
+  // can always be reached since the largest coefficient is at most rhs_.
+  for (int pass = 0; pass < 2; ++pass) {
+    int coeff_index = coeffs_.size() - 1;
+    for (int i = literals_.size() - 1; i >= 0; --i) {
+      if (watched_sum_ >= watch_target_) return;
+      while (i < starts_[coeff_index]) --coeff_index;
+      if (literal_is_watched_[i]) continue;
+      const Literal literal = literals_[i];
+      if (pass == 0 && trail.Assignment().LiteralIsTrue(literal) &&
+          trail.Info(literal.Variable()).trail_index < trail_index) {
+        continue;
+      }
+      Watch(i, coeffs_[coeff_index], new_watches);
+    }
+  }
+  DCHECK_GE(watched_sum_, watch_target_);
+}
+
+bool UpperBoundedLinearConstraint::PropagateWatched(
+    int trail_index, Trail* trail, PbConstraintsEnqueueHelper* helper,
+    std::vector<Literal>* new_watches, bool* keep_watch) {
+  DCHECK(is_watched_);
+  const Literal true_literal = (*trail)[trail_index];
+  const VariablesAssignment& assignment = trail->Assignment();
+
+  // Compute the slack and the sum of the coefficients of the watched literals
+  // that are not "processed" true literals.
+  Coefficient slack = rhs_;
+  Coefficient covered(0);
+  int true_literal_position = -1;
+  int coeff_index = 0;
+  for (int i = 0; i < literals_.size(); ++i) {
+    if (i == starts_[coeff_index + 1]) ++coeff_index;
+    const Literal literal = literals_[i];
+    if (literal == true_literal) true_literal_position = i;
+    if (assignment.LiteralIsTrue(literal) &&
+        trail->Info(literal.Variable()).trail_index <= trail_index) {
+      slack -= coeffs_[coeff_index];
+    } else if (literal_is_watched_[i]) {
+      covered += coeffs_[coeff_index];
+    }
+  }
+  DCHECK_NE(true_literal_position, -1);
+  DCHECK_GE(slack, 0) << "The constraint is already a conflict!";
+
+  // Look for new literals to watch, the largest coefficients first.
+  coeff_index = coeffs_.size() - 1;
+  for (int i = literals_.size() - 1; i >= 0; --i) {
+    if (covered >= watch_target_) break;
+    while (i < starts_[coeff_index]) --coeff_index;
+    if (literal_is_watched_[i]) continue;
+    const Literal literal = literals_[i];
+    if (assignment.LiteralIsTrue(literal) &&
+        trail->Info(literal.Variable()).trail_index <= trail_index) {
+      continue;
+    }
+    Watch(i, coeffs_[coeff_index], new_watches);
+    covered += coeffs_[coeff_index];
+  }
+  if (covered >= watch_target_) {
+    int index = 0;
+    while (starts_[index + 1] <= true_literal_position) ++index;
+    literal_is_watched_[true_literal_position] = false;
+    watched_sum_ -= coeffs_[index];
+    *keep_watch = false;
+    return true;
+  }
+
+  // All the literals that are not "processed" true literals are watched. The
+  // true literal stays watched so that watched_sum_ never decreases below the
+  // target, and we check the propagation like in Propagate().
+  *keep_watch = true;
+  int index = coeffs_.size() - 1;
+  while (index >= 0 && coeffs_[index] > slack) --index;
+  return PropagateLiterals(starts_[index + 1], literals_.size(), trail_index,
+                           trail, helper);
+}
+
 void UpperBoundedLinearConstraint::FillReason(const Trail& trail,
                                               int source_trail_index,
                                               VariableIndex propagated_variable,
@@ -829,6 +936,7 @@ bool PbConstraints::AddConstraint(const std::vector<LiteralWithCoeff>& cst,
   // Special case if this is the first constraint.
   if (constraints_.empty()) {
     to_update_.resize(trail->NumVariables() << 1);
+    watchers_.resize(trail->NumVariables() << 1);
     enqueue_helper_.propagator_id = propagator_id_;
     enqueue_helper_.reasons.resize(trail->NumVariables());
     propagation_trail_index_ = trail->Index();
@@ -842,7 +950,31 @@ bool PbConstraints::AddConstraint(const std::vector<LiteralWithCoeff>& cst,
   // Optimization if the constraint terms are duplicates.
   for (UpperBoundedLinearConstraint* candidate : duplicate_candidates) {
     if (candidate->HasIdenticalTerms(cst)) {
-      if (rhs < candidate->Rhs()) {
+      if (rhs < candidate->Rhs() && candidate->is_watched()) {
+        // A watched constraint needs all its coefficients to be at most its
+        // rhs, if this is not the case we just add the new constraint.
+        if (cst.back().coefficient > rhs) break;
+        const bool was_reason = candidate->is_used_as_a_reason();
+        candidate->ChangeResolutionNode(node);
+        Coefficient unused_threshold;
+        if (!candidate->InitializeRhs(rhs, propagation_trail_index_,
+                                      &unused_threshold, trail,
+                                      &enqueue_helper_)) {
+          return false;
+        }
+        if (!was_reason && candidate->is_used_as_a_reason()) {
+          watched_reasons_.push_back(candidate);
+        }
+        ConstraintIndex i(0);
+        while (constraints_[i.value()].get() != candidate) ++i;
+        tmp_new_watches_.clear();
+        candidate->InitializeWatches(propagation_trail_index_, *trail,
+                                     &tmp_new_watches_);
+        for (const Literal literal : tmp_new_watches_) {
+          watchers_[literal.Index()].push_back(i);
+        }
+        return true;
+      } else if (rhs < candidate->Rhs()) {
         // TODO(user): the index is needed to give the correct thresholds_ entry
         // to InitializeRhs() below, but this linear scan is not super
         // efficient.
@@ -876,6 +1008,16 @@ bool PbConstraints::AddConstraint(const std::vector<LiteralWithCoeff>& cst,
 
   const ConstraintIndex cst_index(constraints_.size());
   duplicate_candidates.push_back(c.get());
+  if (parameters_.use_pb_watched_literals() && c->CanBeWatched()) {
+    if (c->is_used_as_a_reason()) watched_reasons_.push_back(c.get());
+    tmp_new_watches_.clear();
+    c->InitializeWatches(propagation_trail_index_, *trail, &tmp_new_watches_);
+    for (const Literal literal : tmp_new_watches_) {
+      watchers_[literal.Index()].push_back(cst_index);
+    }
+    constraints_.emplace_back(c.release());
+    return true;
+  }
   constraints_.emplace_back(c.release());
   for (LiteralWithCoeff term : cst) {
     DCHECK_LT(term.literal.Index(), to_update_.size());
@@ -923,21 +1065,57 @@ bool PbConstraints::PropagateNext(Trail* trail) {
       const int old_value = cst->already_propagated_end();
       if (!cst->Propagate(source_trail_index, &thresholds_[update.index], trail,
                           &enqueue_helper_)) {
-        trail->MutableConflict()->swap(enqueue_helper_.conflict);
-        trail->SetFailingResolutionNode(cst->ResolutionNodePointer());
-        conflicting_constraint_index_ = update.index;
+        SetConflict(update.index, trail);
         conflict = true;
-
-        // We bump the activity of the conflict.
-        BumpActivity(constraints_[update.index.value()].get());
       }
       num_inspected_constraint_literals_ +=
           old_value - cst->already_propagated_end();
     }
   }
+
+  // The watched constraints only need to be inspected if the true literal is
+  // one of their watched literal. Note that in case of conflict, we don't need
+  // to update anything.
+  std::vector<ConstraintIndex>& watchers = watchers_[true_literal.Index()];
+  int new_size = 0;
+  for (int i = 0; i < watchers.size(); ++i) {
+    const ConstraintIndex index = watchers[i];
+    if (conflict) {
+      watchers[new_size++] = index;
+      continue;
+    }
+    UpperBoundedLinearConstraint* const cst = constraints_[index.value()].get();
+    ++num_constraint_lookups_;
+    const bool was_reason = cst->is_used_as_a_reason();
+    bool keep_watch = true;
+    tmp_new_watches_.clear();
+    if (!cst->PropagateWatched(source_trail_index, trail, &enqueue_helper_,
+                               &tmp_new_watches_, &keep_watch)) {
+      SetConflict(index, trail);
+      conflict = true;
+    }
+    if (!was_reason && cst->is_used_as_a_reason()) {
+      watched_reasons_.push_back(cst);
+    }
+    for (const Literal literal : tmp_new_watches_) {
+      watchers_[literal.Index()].push_back(index);
+    }
+    if (keep_watch) watchers[new_size++] = index;
+  }
+  watchers.resize(new_size);
   return !conflict;
 }
 
+void PbConstraints::SetConflict(ConstraintIndex index, Trail* trail) {
+  UpperBoundedLinearConstraint* const cst = constraints_[index.value()].get();
+  trail->MutableConflict()->swap(enqueue_helper_.conflict);
+  trail->SetFailingResolutionNode(cst->ResolutionNodePointer());
+  conflicting_constraint_index_ = index;
+
+  // We bump the activity of the conflict.
+  BumpActivity(cst);
+}
+
 bool PbConstraints::Propagate(Trail* trail) {
   const int old_index = trail->Index();
   while (trail->Index() == old_index && propagation_trail_index_ < old_index) {
@@ -967,6 +1145,10 @@ void PbConstraints::Untrail(const Trail& trail, int trail_index) {
     constraints_[cst_index.value()]->Untrail(&(thresholds_[cst_index]),
                                              trail_index);
   }
+  while (!watched_reasons_.empty() &&
+         !watched_reasons_.back()->UntrailReason(trail_index)) {
+    watched_reasons_.pop_back();
+  }
 }
 
 ClauseRef PbConstraints::Reason(const Trail& trail, int trail_index) const {
@@ -1141,6 +1323,15 @@ void PbConstraints::DeleteConstraintMarkedForDeletion() {
     }
     updates.resize(new_index);
   }
+  for (LiteralIndex lit(0); lit < watchers_.size(); ++lit) {
+    std::vector<ConstraintIndex>& watchers = watchers_[lit];
+    int new_index = 0;
+    for (int i = 0; i < watchers.size(); ++i) {
+      const ConstraintIndex m = index_mapping[watchers[i]];
+      if (m != -1) watchers[new_index++] = m;
+    }
+    watchers.resize(new_index);
+  }
 }
 
 }  // namespace sat
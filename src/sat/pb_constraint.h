@@ -396,6 +396,44 @@ class UpperBoundedLinearConstraint {
   // new value.
   void Untrail(Coefficient* threshold, int trail_index);
 
+  // Watched literal propagation. Instead of keeping track of the slack on each
+  // assignment, a watched constraint only watches a subset of its literals
+  // whose coefficients sum to at least the sum of all the coefficients minus
+  // the rhs plus the largest coefficient. As long as no watched literal is
+  // true, the slack is thus at least the largest coefficient and nothing can
+  // be propagated. Nothing needs to be done on Untrail() except for the
+  // first_reason_trail_index_ (see UntrailReason()).
+  //
+  // This is only possible if no coefficient is larger than the rhs (which must
+  // be initialized).
+  bool CanBeWatched() const { return coeffs_.back() <= rhs_; }
+  bool is_watched() const { return is_watched_; }
+
+  // Makes this constraint a watched one, or updates its watches after a change
+  // of rhs. The literal assigned to true with a trail index smaller than the
+  // given one are not watched unless there is no other choice. The newly
+  // watched literals are appended to new_watches.
+  void InitializeWatches(int trail_index, const Trail& trail,
+                         std::vector<Literal>* new_watches);
+
+  // Same as Propagate() for a watched constraint whose watched literal at the
+  // given trail_index is now true. All literals with smaller trail index must
+  // have been "processed". The newly watched literals are appended to
+  // new_watches, and *keep_watch is set to false if the literal at trail_index
+  // is not watched anymore.
+  bool PropagateWatched(int trail_index, Trail* trail,
+                        PbConstraintsEnqueueHelper* helper,
+                        std::vector<Literal>* new_watches, bool* keep_watch);
+
+  // Returns false and makes the constraint not used as a reason if it was
+  // first used as a reason at a trail index greater or equal to the given one.
+  // Returns true if it is still used as a reason.
+  bool UntrailReason(int trail_index) {
+    if (first_reason_trail_index_ < trail_index) return true;
+    first_reason_trail_index_ = -1;
+    return false;
+  }
+
   // Provided that the literal with given source_trail_index was the one that
   // propagated the conflict or the literal we wants to explain, then this will
   // compute the reason.
@@ -475,6 +513,20 @@ class UpperBoundedLinearConstraint {
     already_propagated_end_ = starts_[index_ + 1];
   }
 
+  // Propagates the literals of literals_ in [begin, end), their coefficients
+  // must be greater than the current slack. Returns false and fills the
+  // helper conflict if one of them is true with a greater trail index than
+  // the given one.
+  bool PropagateLiterals(int begin, int end, int trail_index, Trail* trail,
+                         PbConstraintsEnqueueHelper* helper);
+
+  // Watches the literal at the given position of literals_.
+  void Watch(int i, Coefficient coeff, std::vector<Literal>* new_watches) {
+    literal_is_watched_[i] = true;
+    watched_sum_ += coeff;
+    new_watches->push_back(literals_[i]);
+  }
+
   // Constraint management fields.
   // TODO(user): Rearrange and specify bit size to minimize memory usage.
   bool is_marked_for_deletion_;
@@ -486,6 +538,13 @@ class UpperBoundedLinearConstraint {
   int index_;
   int already_propagated_end_;
 
+  // Watched literal propagation fields. The sum of the coefficients of the
+  // watched literals should be at least watch_target_.
+  bool is_watched_;
+  Coefficient watch_target_;
+  Coefficient watched_sum_;
+  std::vector<bool> literal_is_watched_;
+
   // In the internal representation, we merge the terms with the same
   // coefficient.
   // - literals_ contains all the literal of the constraint sorted by increasing
@@ -537,6 +596,7 @@ class PbConstraints : public Propagator {
     // alone will take 480 MB!
     if (!constraints_.empty()) {
       to_update_.resize(num_variables << 1);
+      watchers_.resize(num_variables << 1);
       enqueue_helper_.reasons.resize(num_variables);
     }
   }
@@ -632,6 +692,9 @@ class PbConstraints : public Propagator {
     Coefficient coefficient;
   };
 
+  // Records the conflict returned by the given constraint propagation.
+  void SetConflict(ConstraintIndex index, Trail* trail);
+
   // The set of all pseudo-boolean constraint managed by this class.
   std::vector<std::unique_ptr<UpperBoundedLinearConstraint>> constraints_;
 
@@ -645,6 +708,16 @@ class PbConstraints : public Propagator {
   // Bitset used to optimize the Untrail() function.
   SparseBitset<ConstraintIndex> to_untrail_;
 
+  // For each literal, the list of the watched constraints (see
+  // UpperBoundedLinearConstraint::InitializeWatches()) that watch it.
+  ITIVector<LiteralIndex, std::vector<ConstraintIndex>> watchers_;
+  std::vector<Literal> tmp_new_watches_;
+
+  // The watched constraints used as a reason, by increasing trail index of
+  // their first propagation, so that Untrail() can reset them. Note that such
+  // a constraint cannot be deleted.
+  std::vector<UpperBoundedLinearConstraint*> watched_reasons_;
+
   // Pointers to the constraints grouped by their hash.
   // This is used to find duplicate constraints by AddConstraint().
   hash_map<int64, std::vector<UpperBoundedLinearConstraint*>> possible_duplicates_;
@@ -0,0 +1,269 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sat/portfolio.h"
+
+#include <algorithm>
+
+#include "base/callback.h"
+#include "base/logging.h"
+#include "base/mutex.h"
+#include "base/threadpool.h"
+#include "sat/boolean_problem.h"
+#include "util/time_limit.h"
+
+namespace operations_research {
+namespace sat {
+
+SharedClauseRing::SharedClauseRing(int capacity, int max_clause_size)
+    : capacity_(capacity),
+      max_clause_size_(max_clause_size),
+      words_(new std::atomic<int32>[capacity]),
+      end_(0),
+      reserved_(0) {
+  CHECK_GT(max_clause_size, 0);
+  CHECK_GE(capacity, 2 * (max_clause_size + 2));
+}
+
+void SharedClauseRing::Add(const std::vector<Literal>& clause, int lbd) {
+  DCHECK(!clause.empty());
+  DCHECK_LE(clause.size(), max_clause_size_);
+  const int64 start = end_.load(std::memory_order_relaxed);
+  const int64 end = start + clause.size() + 2;
+
+  // Tell the readers which words are about to be overwritten before actually
+  // overwriting them.
+  reserved_.store(end, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  int64 position = start;
+  words_[position++ % capacity_].store(clause.size(),
+                                       std::memory_order_relaxed);
+  words_[position++ % capacity_].store(lbd, std::memory_order_relaxed);
+  for (const Literal literal : clause) {
+    words_[position++ % capacity_].store(literal.SignedValue(),
+                                         std::memory_order_relaxed);
+  }
+  end_.store(end, std::memory_order_release);
+}
+
+void SharedClauseRing::Read(int64* position,
+                            std::vector<Clause>* clauses) const {
+  const int64 end = end_.load(std::memory_order_acquire);
+  if (*position == end) return;
+
+  // We are too far behind, the next clause is already overwritten.
+  if (end - *position > capacity_ - max_clause_size_ - 2) {
+    *position = end;
+    return;
+  }
+
+  const int initial_size = clauses->size();
+  bool valid = true;
+  int64 p = *position;
+  while (p < end) {
+    const int size = words_[p++ % capacity_].load(std::memory_order_relaxed);
+    const int lbd = words_[p++ % capacity_].load(std::memory_order_relaxed);
+    if (size <= 0 || size > max_clause_size_ || p + size > end) {
+      // This can only happen if the words were overwritten while we read
+      // them, the check below will discard everything.
+      valid = false;
+      break;
+    }
+    clauses->push_back(Clause());
+    Clause* const clause = &clauses->back();
+    clause->lbd = lbd;
+    for (int i = 0; i < size; ++i) {
+      clause->literals.push_back(
+          Literal(words_[p++ % capacity_].load(std::memory_order_relaxed)));
+    }
+  }
+
+  // Discard what we read if the writer may have overwritten some of it.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const int64 reserved = reserved_.load(std::memory_order_relaxed);
+  if (!valid || reserved - capacity_ > *position) {
+    clauses->resize(initial_size);
+  }
+  *position = end;
+}
+
+SatParameters DiversifyParameters(const SatParameters& parameters,
+                                  int index) {
+  SatParameters result = parameters;
+  if (index == 0) return result;
+  result.set_random_seed(parameters.random_seed() + index);
+  result.set_log_search_progress(false);
+  switch (index % 4) {
+    case 0:
+      result.set_random_polarity_ratio(0.01);
+      result.set_random_branches_ratio(0.01);
+      break;
+    case 1:
+      result.clear_restart_algorithms();
+      result.add_restart_algorithms(SatParameters::LUBY_RESTART);
+      result.set_initial_polarity(SatParameters::POLARITY_TRUE);
+      break;
+    case 2:
+      result.clear_restart_algorithms();
+      result.add_restart_algorithms(SatParameters::LBD_MOVING_AVERAGE_RESTART);
+      result.set_initial_polarity(SatParameters::POLARITY_RANDOM);
+      result.set_preferred_variable_order(SatParameters::IN_RANDOM_ORDER);
+      break;
+    case 3:
+      result.clear_restart_algorithms();
+      result.add_restart_algorithms(SatParameters::DL_MOVING_AVERAGE_RESTART);
+      result.set_use_blocking_restart(true);
+      result.set_preferred_variable_order(SatParameters::IN_REVERSE_ORDER);
+      break;
+  }
+  return result;
+}
+
+namespace {
+// Number of words of each SharedClauseRing.
+const int kRingCapacity = 1 << 16;
+
+// Clauses with a small LBD are shared even if they are larger than
+// clause_sharing_max_size, but not if they are larger than this.
+const int kMaxSharedClauseSize = 32;
+
+class PortfolioSolver {
+ public:
+  PortfolioSolver(const LinearBooleanProblem& problem,
+                  const SatParameters& parameters, int num_solvers)
+      : problem_(problem),
+        parameters_(parameters),
+        num_solvers_(num_solvers),
+        time_limit_(parameters.max_time_in_seconds(),
+                    parameters.max_deterministic_time()),
+        done_(false),
+        status_(SatSolver::LIMIT_REACHED) {
+    const int max_size =
+        std::max(parameters.clause_sharing_max_size(), kMaxSharedClauseSize);
+    for (int i = 0; i < num_solvers; ++i) {
+      rings_.emplace_back(new SharedClauseRing(kRingCapacity, max_size));
+    }
+  }
+
+  SatSolver::Status Solve(std::vector<bool>* solution) {
+    {
+      ThreadPool pool("SatPortfolio", num_solvers_);
+      pool.StartWorkers();
+      for (int i = 0; i < num_solvers_; ++i) {
+        pool.Add(NewCallback(this, &PortfolioSolver::RunWorker, i));
+      }
+    }
+    if (status_ == SatSolver::MODEL_SAT) *solution = solution_;
+    return status_;
+  }
+
+ private:
+  void RunWorker(int index);
+
+  const LinearBooleanProblem& problem_;
+  const SatParameters parameters_;
+  const int num_solvers_;
+  std::vector<std::unique_ptr<SharedClauseRing>> rings_;
+
+  // Shared by all the workers: the deterministic time is the total over all
+  // of them. It is cancelled by the first worker that finds the answer.
+  ParallelTimeLimit time_limit_;
+
+  // Set by the first worker that finds the answer.
+  Mutex mutex_;
+  bool done_;
+  SatSolver::Status status_;
+  std::vector<bool> solution_;
+
+  DISALLOW_COPY_AND_ASSIGN(PortfolioSolver);
+};
+
+void PortfolioSolver::RunWorker(int index) {
+  const SatParameters parameters = DiversifyParameters(parameters_, index);
+  std::unique_ptr<TimeLimit> time_limit = time_limit_.NewWorkerTimeLimit();
+
+  // The solver stops every clause_sharing_period conflicts to import the
+  // clauses of the others. Note that the total conflict limit may thus be
+  // exceeded by up to one period.
+  SatParameters slice_parameters = parameters;
+  slice_parameters.set_max_number_of_conflicts(
+      std::max(1, parameters.clause_sharing_period()));
+  SatSolver solver;
+  solver.SetParameters(slice_parameters);
+
+  SharedClauseRing* const ring = rings_[index].get();
+  const int max_size = parameters.clause_sharing_max_size();
+  const int max_lbd = parameters.clause_sharing_max_lbd();
+  solver.SetLearnedClauseCallback(
+      [ring, max_size, max_lbd](const std::vector<Literal>& clause, int lbd) {
+        if (clause.size() > ring->max_clause_size()) return;
+        if (clause.size() == 1 || clause.size() <= max_size ||
+            lbd <= max_lbd) {
+          ring->Add(clause, lbd);
+        }
+      });
+
+  SatSolver::Status status = SatSolver::LIMIT_REACHED;
+  if (!LoadBooleanProblem(problem_, &solver)) status = SatSolver::MODEL_UNSAT;
+  std::vector<int64> positions(num_solvers_, 0);
+  std::vector<SharedClauseRing::Clause> clauses;
+  while (status == SatSolver::LIMIT_REACHED) {
+    if (time_limit->LimitReached() ||
+        solver.num_failures() >= parameters.max_number_of_conflicts()) {
+      break;
+    }
+    status = solver.SolveWithTimeLimit(time_limit.get());
+    if (status != SatSolver::LIMIT_REACHED) break;
+
+    solver.Backtrack(0);
+    clauses.clear();
+    for (int i = 0; i < num_solvers_; ++i) {
+      if (i != index) rings_[i]->Read(&positions[i], &clauses);
+    }
+    for (const SharedClauseRing::Clause& clause : clauses) {
+      if (!solver.AddImportedClause(clause.literals, clause.lbd)) {
+        status = SatSolver::MODEL_UNSAT;
+        break;
+      }
+    }
+  }
+
+  if (status == SatSolver::LIMIT_REACHED) return;
+  MutexLock lock(&mutex_);
+  if (done_) return;
+  done_ = true;
+  time_limit_.Cancel();
+  status_ = status;
+  if (status == SatSolver::MODEL_SAT) {
+    ExtractAssignment(problem_, solver, &solution_);
+  }
+  if (parameters_.log_search_progress()) {
+    LOG(INFO) << "Portfolio solver " << index << " finished with status "
+              << status;
+  }
+}
+}  // namespace
+
+SatSolver::Status SolveWithPortfolio(const LinearBooleanProblem& problem,
+                                     const SatParameters& parameters,
+                                     int num_solvers,
+                                     std::vector<bool>* solution) {
+  CHECK_GT(num_solvers, 0);
+  CHECK(!parameters.unsat_proof());
+  PortfolioSolver portfolio(problem, parameters, num_solvers);
+  return portfolio.Solve(solution);
+}
+
+}  // namespace sat
+}  // namespace operations_research
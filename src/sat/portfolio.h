@@ -0,0 +1,97 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Parallel portfolio of SAT solvers.
+//
+// Several SatSolvers with diversified parameters work on the same problem in
+// different threads, and the first one to find the answer stops the others.
+// The solvers exchange their short learned clauses (and all the learned
+// units): each solver publishes them in its own SharedClauseRing, and pulls
+// the clauses of the other solvers every clause_sharing_period conflicts, when
+// it is back at decision level zero.
+
+#ifndef OR_TOOLS_SAT_PORTFOLIO_H_
+#define OR_TOOLS_SAT_PORTFOLIO_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "base/integral_types.h"
+#include "base/macros.h"
+#include "sat/boolean_problem.pb.h"
+#include "sat/sat_base.h"
+#include "sat/sat_parameters.pb.h"
+#include "sat/sat_solver.h"
+
+namespace operations_research {
+namespace sat {
+
+// A lock-free ring buffer of clauses with one writer and any number of
+// readers. The writer never waits: it overwrites the oldest clauses, and a
+// reader that is too far behind just loses them. Each reader keeps its own
+// position in the ring.
+class SharedClauseRing {
+ public:
+  // The ring holds 'capacity' words; each clause uses its size plus two words.
+  // Clauses with more than max_clause_size literals are not accepted.
+  SharedClauseRing(int capacity, int max_clause_size);
+
+  int max_clause_size() const { return max_clause_size_; }
+
+  // Publishes a clause. Must only be called by the writer thread.
+  void Add(const std::vector<Literal>& clause, int lbd);
+
+  struct Clause {
+    std::vector<Literal> literals;
+    int lbd;
+  };
+
+  // Appends to 'clauses' the clauses published since *position, and advances
+  // *position. The position of a new reader must be initialized to zero. The
+  // clauses that were overwritten before they could be read are skipped.
+  void Read(int64* position, std::vector<Clause>* clauses) const;
+
+ private:
+  const int capacity_;
+  const int max_clause_size_;
+  std::unique_ptr<std::atomic<int32>[]> words_;
+
+  // Positions only grow; the word at position p is words_[p % capacity_]. All
+  // the words before end_ are published, and the writer never touches a word
+  // before reserved_ - capacity_.
+  std::atomic<int64> end_;
+  std::atomic<int64> reserved_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedClauseRing);
+};
+
+// Returns the parameters of the solver number 'index' of a portfolio. The
+// solver 0 uses the given parameters; the others use a different seed and
+// vary the restart strategy and the branching heuristic, and do not log.
+SatParameters DiversifyParameters(const SatParameters& parameters, int index);
+
+// Solves the given pure SAT problem (its objective, if any, is ignored) with
+// num_solvers SatSolvers, each in its own thread. Returns MODEL_SAT and fills
+// 'solution', MODEL_UNSAT or LIMIT_REACHED. The time limits of 'parameters'
+// apply to the whole portfolio, max_number_of_conflicts applies to each
+// solver.
+SatSolver::Status SolveWithPortfolio(const LinearBooleanProblem& problem,
+                                     const SatParameters& parameters,
+                                     int num_solvers,
+                                     std::vector<bool>* solution);
+
+}  // namespace sat
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_SAT_PORTFOLIO_H_
@@ -20,6 +20,7 @@
 
 #include "base/integral_types.h"
 #include "base/logging.h"
+#include "base/memory_accounting.h"
 #include "base/sysinfo.h"
 #include "google/protobuf/text_format.h"
 #include "base/split.h"
@@ -40,8 +41,13 @@ SatSolver::SatSolver()
       assumption_level_(0),
       num_processed_fixed_variables_(0),
       deterministic_time_of_last_fixed_variables_cleanup_(0.0),
+      next_inprocessing_time_(0.0),
+      num_clauses_at_last_inprocessing_(0),
+      probing_cursor_(0),
+      vivification_cursor_(0),
       counters_(),
       is_model_unsat_(false),
+      drat_writer_(nullptr),
       is_var_ordering_initialized_(false),
       variable_activity_increment_(1.0),
       clause_activity_increment_(1.0),
@@ -52,6 +58,8 @@ SatSolver::SatSolver()
       luby_count_(0),
       conflicts_until_next_strategy_change_(0),
       strategy_counter_(0),
+      abstract_conflict_levels_(0),
+      lbd_stamp_(0),
       same_reason_identifier_(trail_),
       is_relevant_for_core_computation_(true),
       time_limit_(TimeLimit::Infinite()),
@@ -84,7 +92,6 @@ SatSolver::~SatSolver() {
       unsat_proof_.UnlockNode(node);
     }
   }
-  STLDeleteElements(&clauses_);
 }
 
 void SatSolver::SetNumVariables(int num_variables) {
@@ -124,6 +131,8 @@ int64 SatSolver::num_propagations() const {
   return trail_.NumberOfEnqueues() - counters_.num_branches;
 }
 
+int64 SatSolver::num_learned_clauses() const { return clauses_info_.size(); }
+
 double SatSolver::deterministic_time() const {
   // Each of these counters mesure really basic operations.
   // The weight are just an estimate of the operation complexity.
@@ -159,6 +168,8 @@ void SatSolver::SetParameters(const SatParameters& parameters) {
   lbd_running_average_.Reset(parameters_.restart_running_window_size());
   trail_size_running_average_.Reset(parameters_.blocking_restart_window_size());
   deterministic_time_at_last_advanced_time_limit_ = deterministic_time();
+  next_inprocessing_time_ =
+      deterministic_time() + parameters_.inprocessing_period();
 }
 
 std::string SatSolver::Indent() const {
@@ -174,10 +185,14 @@ std::string SatSolver::Indent() const {
 bool SatSolver::IsMemoryLimitReached() const {
   const int64 memory_usage = GetProcessMemoryUsage();
   const int64 kMegaByte = 1024 * 1024;
-  return memory_usage > kMegaByte * parameters_.max_memory_in_mb();
+  return memory_usage > kMegaByte * parameters_.max_memory_in_mb() ||
+         IsMemoryBudgetExceeded();
 }
 
 bool SatSolver::SetModelUnsat() {
+  if (drat_writer_ != nullptr && !is_model_unsat_) {
+    drat_writer_->AddClause(ClauseRef());
+  }
   is_model_unsat_ = true;
   return false;
 }
@@ -254,17 +269,17 @@ bool SatSolver::AddProblemClauseInternal(const std::vector<Literal>& literals,
     trail_.EnqueueWithUnitReason(literals[0], node);  // Not assigned.
     return true;
   }
-  // Create a new clause.
-  std::unique_ptr<SatClause> clause(
-      SatClause::Create(literals, /*is_redundant=*/false, node));
-
-  if (parameters_.treat_binary_clauses_separately() && clause->Size() == 2) {
-    AddBinaryClauseInternal(clause->FirstLiteral(), clause->SecondLiteral());
+  if (parameters_.treat_binary_clauses_separately() && literals.size() == 2) {
+    AddBinaryClauseInternal(literals[0], literals[1]);
   } else {
-    if (!clauses_propagator_.AttachAndPropagate(clause.get(), &trail_)) {
+    // Create a new clause.
+    SatClause* const clause =
+        clauses_propagator_.NewClause(literals, /*is_redundant=*/false, node);
+    if (!clauses_propagator_.AttachAndPropagate(clause, &trail_)) {
+      clauses_propagator_.ReleaseClause(clause);
       return SetModelUnsat();
     }
-    clauses_.push_back(clause.release());
+    clauses_.push_back(clause);
   }
   return true;
 }
@@ -376,15 +391,86 @@ bool SatSolver::AddLinearConstraint(bool use_lower_bound,
   return true;
 }
 
+bool SatSolver::AddImportedClause(const std::vector<Literal>& literals,
+                                  int lbd) {
+  SCOPED_TIME_STAT(&stats_);
+  CHECK_EQ(CurrentDecisionLevel(), 0);
+  CHECK(!parameters_.unsat_proof());
+  CHECK(drat_writer_ == nullptr);
+  if (is_model_unsat_) return false;
+
+  // Removes the literals fixed at level zero.
+  std::vector<Literal> clause;
+  for (const Literal literal : literals) {
+    if (trail_.Assignment().LiteralIsTrue(literal)) return true;
+    if (!trail_.Assignment().LiteralIsFalse(literal)) clause.push_back(literal);
+  }
+  if (clause.empty()) return SetModelUnsat();
+  if (clause.size() == 1) {
+    trail_.EnqueueWithUnitReason(clause[0], nullptr);
+  } else if (clause.size() == 2 &&
+             parameters_.treat_binary_clauses_separately()) {
+    AddBinaryClauseInternal(clause[0], clause[1]);
+  } else {
+    SatClause* clause_pointer =
+        clauses_propagator_.NewClause(clause, /*is_redundant=*/true, nullptr);
+    clauses_.push_back(clause_pointer);
+    if (lbd > parameters_.clause_cleanup_lbd_bound()) {
+      clauses_info_[clause_pointer].lbd = lbd;
+    }
+    CHECK(clauses_propagator_.AttachAndPropagate(clause_pointer, &trail_));
+  }
+  if (!Propagate()) return SetModelUnsat();
+  return true;
+}
+
+bool SatSolver::AddImportedClauseDuringSearch(
+    const std::vector<Literal>& literals, int lbd) {
+  SCOPED_TIME_STAT(&stats_);
+  CHECK(!parameters_.unsat_proof());
+  CHECK(drat_writer_ == nullptr);
+  if (is_model_unsat_) return false;
+
+  // Removes the literals fixed at level zero, and counts the ones that are not
+  // false: with two of them, the clause can be watched without propagation.
+  std::vector<Literal> clause;
+  int num_not_false = 0;
+  for (const Literal literal : literals) {
+    if (trail_.Assignment().VariableIsAssigned(literal.Variable()) &&
+        trail_.Info(literal.Variable()).level == 0) {
+      if (trail_.Assignment().LiteralIsTrue(literal)) return true;
+      continue;
+    }
+    if (!trail_.Assignment().LiteralIsFalse(literal)) ++num_not_false;
+    clause.push_back(literal);
+  }
+  if (num_not_false < 2) return false;
+  if (clause.size() == 2 && parameters_.treat_binary_clauses_separately()) {
+    AddBinaryClauseInternal(clause[0], clause[1]);
+  } else {
+    SatClause* clause_pointer =
+        clauses_propagator_.NewClause(clause, /*is_redundant=*/true, nullptr);
+    clauses_.push_back(clause_pointer);
+    if (lbd > parameters_.clause_cleanup_lbd_bound()) {
+      clauses_info_[clause_pointer].lbd = lbd;
+    }
+    CHECK(clauses_propagator_.AttachAndPropagate(clause_pointer, &trail_));
+  }
+  DCHECK(PropagationIsDone());
+  return true;
+}
+
 void SatSolver::AddLearnedClauseAndEnqueueUnitPropagation(
     const std::vector<Literal>& literals, bool is_redundant, ResolutionNode* node) {
   SCOPED_TIME_STAT(&stats_);
+  if (drat_writer_ != nullptr) drat_writer_->AddClause(literals);
   if (literals.size() == 1) {
     // A length 1 clause fix a literal for all the search.
     // ComputeBacktrackLevel() should have returned 0.
     CHECK_EQ(CurrentDecisionLevel(), 0);
     trail_.EnqueueWithUnitReason(literals[0], node);
     lbd_running_average_.Add(1);
+    if (learned_clause_callback_) learned_clause_callback_(literals, 1);
   } else if (literals.size() == 2 &&
              parameters_.treat_binary_clauses_separately()) {
     if (track_binary_clauses_) {
@@ -393,18 +479,21 @@ void SatSolver::AddLearnedClauseAndEnqueueUnitPropagation(
     binary_implication_graph_.AddBinaryConflict(literals[0], literals[1],
                                                 &trail_);
     lbd_running_average_.Add(2);
+    if (learned_clause_callback_) learned_clause_callback_(literals, 2);
 
     // In case this is the first binary clauses.
     InitializePropagators();
   } else {
     CleanClauseDatabaseIfNeeded();
-    SatClause* clause = SatClause::Create(literals, is_redundant, node);
+    SatClause* clause =
+        clauses_propagator_.NewClause(literals, is_redundant, node);
     clauses_.emplace_back(clause);
 
     // Important: Even though the only literal at the last decision level has
     // been unassigned, its level was not modified, so ComputeLbd() works.
     const int lbd = ComputeLbd(*clause);
     lbd_running_average_.Add(lbd);
+    if (learned_clause_callback_) learned_clause_callback_(literals, lbd);
 
     if (is_redundant && lbd > parameters_.clause_cleanup_lbd_bound()) {
       --num_learned_clause_before_cleanup_;
@@ -774,7 +863,22 @@ bool SatSolver::PropagateAndStopAfterOneConflictResolution() {
 
   // Backtrack and add the reason to the set of learned clause.
   counters_.num_literals_learned += learned_conflict_.size();
-  Backtrack(ComputeBacktrackLevel(learned_conflict_));
+  int backtrack_level = ComputeBacktrackLevel(learned_conflict_);
+  if (parameters_.use_chronological_backtracking() &&
+      learned_conflict_.size() > 1) {
+    // The learned clause is also asserting just below the level of its first
+    // literal. Backtracking there instead keeps the assignments of all the
+    // levels in between, at the price of a propagated literal with a higher
+    // level than necessary. Note that the trail levels stay ordered.
+    const int chronological_level =
+        DecisionLevel(learned_conflict_[0].Variable()) - 1;
+    if (chronological_level - backtrack_level >=
+        parameters_.chronological_backtracking_min_jump()) {
+      backtrack_level = chronological_level;
+      ++counters_.num_chronological_backtracks;
+    }
+  }
+  Backtrack(backtrack_level);
   DCHECK(ClauseIsValidUnderDebugAssignement(learned_conflict_));
 
   // Detach any subsumed clause. They will actually be deleted on the next
@@ -785,6 +889,9 @@ bool SatSolver::PropagateAndStopAfterOneConflictResolution() {
     for (SatClause* clause : subsumed_clauses_) {
       DCHECK(ClauseSubsumption(learned_conflict_, clause));
       clauses_propagator_.LazyDetach(clause);
+      if (drat_writer_ != nullptr) {
+        drat_writer_->DeleteClause(ClauseRef(clause->begin(), clause->end()));
+      }
       if (!clause->IsRedundant()) is_redundant = false;
     }
     clauses_propagator_.CleanUpWatchers();
@@ -861,6 +968,31 @@ bool SatSolver::EnqueueDecisionIfNotConflicting(Literal true_literal) {
   }
 }
 
+bool SatSolver::EnqueueDecisionIfNotConflicting(
+    Literal true_literal, std::vector<Literal>* conflict) {
+  SCOPED_TIME_STAT(&stats_);
+  CHECK(PropagationIsDone());
+  conflict->clear();
+  if (is_model_unsat_) return false;
+  const int current_level = CurrentDecisionLevel();
+  EnqueueNewDecision(true_literal);
+  if (Propagate()) return true;
+
+  // Same analysis as in PropagateAndStopAfterOneConflictResolution(), without
+  // the PB resolution and without touching the activities.
+  const int max_trail_index = ComputeMaxTrailIndex(trail_.FailingClause());
+  same_reason_identifier_.Clear();
+  ComputeFirstUIPConflict(max_trail_index, conflict,
+                          &reason_used_to_infer_the_conflict_,
+                          &subsumed_clauses_);
+  if (!conflict->empty()) {
+    MinimizeConflict(conflict, &reason_used_to_infer_the_conflict_);
+  }
+  pb_constraints_.ClearConflictingConstraint();
+  Backtrack(current_level);
+  return false;
+}
+
 void SatSolver::Backtrack(int target_level) {
   SCOPED_TIME_STAT(&stats_);
   // TODO(user): The backtrack method should not be called when the model is
@@ -922,15 +1054,66 @@ SatSolver::Status SatSolver::ResetAndSolveWithGivenAssumptions(
     const std::vector<Literal>& assumptions) {
   SCOPED_TIME_STAT(&stats_);
   DCHECK(!is_model_unsat_);
-  CHECK_LE(assumptions.size(), num_variables_);
-  Backtrack(0);
-  for (int i = 0; i < assumptions.size(); ++i) {
-    decisions_[i].literal = assumptions[i];
-  }
-  assumption_level_ = assumptions.size();
+  const std::vector<Literal>* all_assumptions = &assumptions;
+  if (!clause_groups_.empty()) {
+    tmp_assumptions_.clear();
+    for (const Literal activation : clause_groups_) {
+      if (!trail_.Assignment().LiteralIsFalse(activation)) {
+        tmp_assumptions_.push_back(activation);
+      }
+    }
+    tmp_assumptions_.insert(tmp_assumptions_.end(), assumptions.begin(),
+                            assumptions.end());
+    all_assumptions = &tmp_assumptions_;
+  }
+  CHECK_LE(all_assumptions->size(), num_variables_);
+
+  // Keep the decisions shared with the previous call. Note that because some
+  // assumptions may be skipped when they are implied by the previous ones, the
+  // decisions are not necessarily a prefix of the previous assumptions, so this
+  // is just the longest common prefix of the decisions and the new assumptions.
+  const int max_level =
+      std::min(static_cast<int>(all_assumptions->size()),
+               std::min(CurrentDecisionLevel(), assumption_level_));
+  int num_kept = 0;
+  while (num_kept < max_level &&
+         decisions_[num_kept].literal == (*all_assumptions)[num_kept]) {
+    ++num_kept;
+  }
+  Backtrack(num_kept);
+  for (int i = num_kept; i < all_assumptions->size(); ++i) {
+    decisions_[i].literal = (*all_assumptions)[i];
+  }
+  assumption_level_ = all_assumptions->size();
   return SolveInternal(time_limit_.get());
 }
 
+int SatSolver::NewClauseGroup() {
+  SCOPED_TIME_STAT(&stats_);
+  Backtrack(0);
+  const VariableIndex var = num_variables_;
+  SetNumVariables(num_variables_.value() + 1);
+  clause_groups_.push_back(Literal(var, true));
+  return clause_groups_.size() - 1;
+}
+
+bool SatSolver::AddClauseToGroup(int group,
+                                 const std::vector<Literal>& literals) {
+  SCOPED_TIME_STAT(&stats_);
+  CHECK(ClauseGroupIsActive(group));
+  Backtrack(0);
+  std::vector<Literal> clause = literals;
+  clause.push_back(clause_groups_[group].Negated());
+  return AddProblemClause(clause);
+}
+
+void SatSolver::RetractClauseGroup(int group) {
+  SCOPED_TIME_STAT(&stats_);
+  Backtrack(0);
+  if (is_model_unsat_) return;
+  AddUnitClause(clause_groups_[group].Negated());
+}
+
 SatSolver::Status SatSolver::StatusWithLog(Status status) {
   if (parameters_.log_search_progress()) {
     LOG(INFO) << RunningStatisticsString();
@@ -1104,7 +1287,22 @@ SatSolver::Status SatSolver::SolveInternal(TimeLimit* time_limit) {
       }
       if (restart) {
         restart_count_++;
-        Backtrack(assumption_level_);
+        const bool inprocess =
+            parameters_.use_inprocessing() && !parameters_.unsat_proof() &&
+            assumption_level_ == 0 &&
+            deterministic_time() >= next_inprocessing_time_;
+        Backtrack(parameters_.use_trail_reuse() && !inprocess
+                      ? ComputeRestartLevel()
+                      : assumption_level_);
+        binary_implication_graph_.CompactImplicationsIfNeeded();
+
+        // Inprocessing?
+        if (inprocess) {
+          if (!Inprocess()) return StatusWithLog(MODEL_UNSAT);
+          if (trail_.Index() == num_variables_.value()) {
+            return StatusWithLog(MODEL_SAT);
+          }
+        }
 
         // Strategy switch?
         if (conflicts_until_next_strategy_change_ == 0) {
@@ -1347,17 +1545,24 @@ int SatSolver::ComputeLbd(const LiteralList& conflict) {
       parameters_.count_assumption_levels_in_lbd() ? 0 : assumption_level_;
 
   // We know that the first literal of the conflict is always of the highest
-  // level.
-  is_level_marked_.ClearAndResize(
-      SatDecisionLevel(DecisionLevel(conflict.begin()->Variable()) + 1));
+  // level. A level is counted the first time it is stamped with the current
+  // stamp, so there is nothing to clear between two calls.
+  const int max_level = DecisionLevel(conflict.begin()->Variable());
+  if (max_level >= level_stamps_.size()) {
+    level_stamps_.resize(max_level + 1, 0);
+  }
+  const int64 stamp = ++lbd_stamp_;
+  int lbd = 0;
   for (const Literal literal : conflict) {
-    const SatDecisionLevel level(DecisionLevel(literal.Variable()));
+    const int level = DecisionLevel(literal.Variable());
     DCHECK_GE(level, 0);
-    if (level > limit && !is_level_marked_[level]) {
-      is_level_marked_.Set(level);
+    DCHECK_LE(level, max_level);
+    if (level > limit && level_stamps_[level] != stamp) {
+      level_stamps_[level] = stamp;
+      ++lbd;
     }
   }
-  return is_level_marked_.NumberOfSetCallsWithDifferentArguments();
+  return lbd;
 }
 
 std::string SatSolver::StatusString(Status status) const {
@@ -1410,6 +1615,19 @@ std::string SatSolver::StatusString(Status status) const {
                           counters_.num_failures) +
          StringPrintf("  num subsumed clauses: %lld\n",
                       counters_.num_subsumed_clauses) +
+         StringPrintf("  num chronological backtracks: %lld\n",
+                      counters_.num_chronological_backtracks) +
+         StringPrintf("  num reused trail levels: %lld\n",
+                      counters_.num_reused_trail_levels) +
+         StringPrintf("  num inprocessings: %lld\n",
+                      counters_.num_inprocessings) +
+         StringPrintf("  num failed literals: %lld\n",
+                      counters_.num_failed_literals) +
+         StringPrintf("  num equivalent literals: %lld\n",
+                      binary_implication_graph_.num_equivalent_literals()) +
+         StringPrintf("  num vivified clauses: %lld  (%lld literals)\n",
+                      counters_.num_vivified_clauses,
+                      counters_.num_vivified_literals) +
          StringPrintf("  num restarts: %d\n", restart_count_) +
          StringPrintf("  pb num threshold updates: %lld\n",
                       pb_constraints_.num_threshold_updates()) +
@@ -1480,12 +1698,20 @@ void SatSolver::ProcessNewlyFixedVariables() {
     if (clause->IsAttached()) {
       if (clause->RemoveFixedLiteralsAndTestIfTrue(trail_.Assignment(),
                                                    &removed_literals)) {
-        // The clause is always true, detach it.
+        // The clause is always true, detach it. Note that we don't delete it
+        // from the DRAT proof since its literals may have been changed, this
+        // is correct but makes the proof check slower.
         // TODO(user): Unlock its associated resolution node right away since
         // the solver will not be able to reach it again.
         clauses_propagator_.LazyDetach(clause);
         ++num_detached_clauses;
       } else if (!removed_literals.empty()) {
+        if (drat_writer_ != nullptr) {
+          drat_writer_->AddClause(ClauseRef(clause->begin(), clause->end()));
+          removed_literals.insert(removed_literals.end(), clause->begin(),
+                                  clause->end());
+          drat_writer_->DeleteClause(removed_literals);
+        }
         if (clause->Size() == 2 &&
             parameters_.treat_binary_clauses_separately()) {
           // This clause is now a binary clause, treat it separately. Note that
@@ -1657,6 +1883,33 @@ void SatSolver::EnqueueNewDecision(Literal literal) {
   trail_.EnqueueSeachDecision(literal);
 }
 
+int SatSolver::ComputeRestartLevel() {
+  SCOPED_TIME_STAT(&stats_);
+  if (!is_var_ordering_initialized_ ||
+      CurrentDecisionLevel() <= assumption_level_) {
+    return assumption_level_;
+  }
+
+  // Find the next decision variable like NextBranch() does. Note that the
+  // priority queue weights of the unassigned variables are up to date.
+  DCHECK(!var_ordering_.IsEmpty());
+  VariableIndex var(var_ordering_.Top() - &queue_elements_.front());
+  while (trail_.Assignment().VariableIsAssigned(var)) {
+    var_ordering_.Pop();
+    pq_need_update_for_var_at_trail_index_.Set(trail_.Info(var).trail_index);
+    DCHECK(!var_ordering_.IsEmpty());
+    var = VariableIndex(var_ordering_.Top() - &queue_elements_.front());
+  }
+  const double activity = activities_[var];
+  int level = assumption_level_;
+  while (level < CurrentDecisionLevel() &&
+         activities_[decisions_[level].literal.Variable()] >= activity) {
+    ++level;
+  }
+  counters_.num_reused_trail_levels += level - assumption_level_;
+  return level;
+}
+
 Literal SatSolver::NextBranch() {
   SCOPED_TIME_STAT(&stats_);
 
@@ -2357,8 +2610,14 @@ void SatSolver::MinimizeConflictRecursively(std::vector<Literal>* conflict) {
   // Note(user): Because is_marked_ may actually contains literals that are
   // implied if the 1-UIP literal is false, we can't just iterate on the
   // variables of the conflict here.
+  //
+  // We also compute the "abstract levels" of the marked variables: a literal
+  // whose level bit is not set can't be redundant, and this is tested with a
+  // single word operation before looking at min_trail_index_per_level_.
+  abstract_conflict_levels_ = 0;
   for (VariableIndex var : is_marked_.PositionsSetAtLeastOnce()) {
     const int level = DecisionLevel(var);
+    abstract_conflict_levels_ |= AbstractLevel(level);
     min_trail_index_per_level_[level] =
         std::min(min_trail_index_per_level_[level], trail_.Info(var).trail_index);
   }
@@ -2432,7 +2691,8 @@ bool SatSolver::CanBeInferedFromConflictVariables(VariableIndex variable) {
       is_marked_.Set(var);
       continue;
     }
-    if (trail_.Info(var).trail_index <= min_trail_index_per_level_[level] ||
+    if ((abstract_conflict_levels_ & AbstractLevel(level)) == 0 ||
+        trail_.Info(var).trail_index <= min_trail_index_per_level_[level] ||
         is_independent_[var]) {
       return false;
     }
@@ -2485,7 +2745,8 @@ bool SatSolver::CanBeInferedFromConflictVariables(VariableIndex variable) {
       DCHECK_NE(var, current_var);
       const int level = DecisionLevel(var);
       if (level == 0 || is_marked_[var]) continue;
-      if (trail_.Info(var).trail_index <= min_trail_index_per_level_[level] ||
+      if ((abstract_conflict_levels_ & AbstractLevel(level)) == 0 ||
+          trail_.Info(var).trail_index <= min_trail_index_per_level_[level] ||
           is_independent_[var]) {
         abort_early = true;
         break;
@@ -2612,6 +2873,17 @@ void SatSolver::MinimizeConflictExperimental(std::vector<Literal>* conflict) {
 }
 
 void SatSolver::DeleteDetachedClauses() {
+  // The positions in clauses_ used by the inprocessing are shifted by the
+  // number of deleted clauses before them.
+  const auto num_attached_before = [this](int position) {
+    position = std::min(position, static_cast<int>(clauses_.size()));
+    return std::count_if(clauses_.begin(), clauses_.begin() + position,
+                         [](SatClause* a) { return a->IsAttached(); });
+  };
+  num_clauses_at_last_inprocessing_ =
+      num_attached_before(num_clauses_at_last_inprocessing_);
+  vivification_cursor_ = num_attached_before(vivification_cursor_);
+
   std::vector<SatClause*>::iterator iter =
       std::stable_partition(clauses_.begin(), clauses_.end(),
                             [](SatClause* a) { return a->IsAttached(); });
@@ -2622,9 +2894,24 @@ void SatSolver::DeleteDetachedClauses() {
   }
   for (std::vector<SatClause*>::iterator it = iter; it != clauses_.end(); ++it) {
     clauses_info_.erase(*it);
+    clauses_propagator_.ReleaseClause(*it);
   }
-  STLDeleteContainerPointers(iter, clauses_.end());
   clauses_.erase(iter, clauses_.end());
+
+  // Gives the memory of the released clauses back. This moves all the
+  // clauses, so clauses_info_ must be updated.
+  if (clauses_propagator_.ShouldCompactClauses()) {
+    const std::vector<SatClause*> old_clauses = clauses_;
+    clauses_propagator_.CompactClauses(trail_, &clauses_);
+    hash_map<SatClause*, ClauseInfo> new_clauses_info;
+    for (int i = 0; i < clauses_.size(); ++i) {
+      const auto it = clauses_info_.find(old_clauses[i]);
+      if (it != clauses_info_.end()) {
+        new_clauses_info[clauses_[i]] = it->second;
+      }
+    }
+    clauses_info_.swap(new_clauses_info);
+  }
 }
 
 void SatSolver::CleanClauseDatabaseIfNeeded() {
@@ -2686,6 +2973,9 @@ void SatSolver::CleanClauseDatabaseIfNeeded() {
       SatClause* clause = entry.first;
       counters_.num_literals_forgotten += clause->Size();
       clauses_propagator_.LazyDetach(clause);
+      if (drat_writer_ != nullptr) {
+        drat_writer_->DeleteClause(ClauseRef(clause->begin(), clause->end()));
+      }
     }
     clauses_propagator_.CleanUpWatchers();
 
@@ -2700,6 +2990,186 @@ void SatSolver::CleanClauseDatabaseIfNeeded() {
           << " #deleted:" << num_deleted_clauses;
 }
 
+bool SatSolver::Inprocess() {
+  SCOPED_TIME_STAT(&stats_);
+  CHECK_EQ(CurrentDecisionLevel(), 0);
+  if (is_model_unsat_) return false;
+  ++counters_.num_inprocessings;
+  const double start_time = deterministic_time();
+  const double budget =
+      parameters_.inprocessing_time_ratio() * parameters_.inprocessing_period();
+  if (num_processed_fixed_variables_ < trail_.Index()) {
+    ProcessNewlyFixedVariables();
+  }
+  if (!binary_implication_graph_.DetectEquivalences()) return SetModelUnsat();
+
+  // Note that the probing may learn new clauses and trigger a database
+  // cleanup, so it must be done first: the other steps keep pointers to the
+  // clauses.
+  if (!ProbeFailedLiterals(start_time + 0.5 * budget)) return false;
+  if (!VivifyRedundantClauses(start_time + budget)) return false;
+  SubsumeWithNewClauses();
+  clauses_propagator_.CleanUpWatchers();
+  DeleteDetachedClauses();
+
+  num_clauses_at_last_inprocessing_ = clauses_.size();
+  next_inprocessing_time_ =
+      deterministic_time() + parameters_.inprocessing_period();
+  VLOG(1) << "Inprocessing in " << deterministic_time() - start_time
+          << " dtime, #failed_literals:" << counters_.num_failed_literals
+          << " #vivified:" << counters_.num_vivified_clauses
+          << " #subsumed:" << counters_.num_subsumed_clauses;
+  return true;
+}
+
+bool SatSolver::ProbeFailedLiterals(double deadline) {
+  SCOPED_TIME_STAT(&stats_);
+  const int num_literals = 2 * num_variables_.value();
+  for (int i = 0; i < num_literals && deterministic_time() < deadline; ++i) {
+    if (probing_cursor_ >= num_literals) probing_cursor_ = 0;
+    const Literal literal = Literal(LiteralIndex(probing_cursor_++));
+    if (Assignment().VariableIsAssigned(literal.Variable())) continue;
+    if (!binary_implication_graph_.HasImplications(literal)) continue;
+
+    // If the propagation of literal leads to a conflict, the learned clause
+    // will fix some variables at level 0 (usually literal.Negated()).
+    const int old_num_fixed = trail_.Index();
+    EnqueueDecisionAndBackjumpOnConflict(literal);
+    if (is_model_unsat_) return false;
+    if (CurrentDecisionLevel() > 0) {
+      Backtrack(0);
+    } else if (trail_.Index() > old_num_fixed) {
+      ++counters_.num_failed_literals;
+    }
+  }
+  return true;
+}
+
+bool SatSolver::VivifyRedundantClauses(double deadline) {
+  SCOPED_TIME_STAT(&stats_);
+  std::vector<Literal> literals;
+  std::vector<Literal> new_literals;
+
+  // The clauses added by the loop are not vivified.
+  const int num_clauses = clauses_.size();
+  for (int i = 0; i < num_clauses && deterministic_time() < deadline; ++i) {
+    if (vivification_cursor_ >= num_clauses) vivification_cursor_ = 0;
+    SatClause* const clause = clauses_[vivification_cursor_++];
+    if (!clause->IsAttached() || !clause->IsRedundant()) continue;
+    if (clause->Size() <= 2 || clause->IsSatisfied(trail_.Assignment())) {
+      continue;
+    }
+
+    // Assign the literals of the clause to false one by one. If this leads to
+    // a conflict, or if a literal is propagated to true, the following ones
+    // can be removed. The literals propagated to false can also be removed.
+    literals.assign(clause->begin(), clause->end());
+    new_literals.clear();
+    for (const Literal literal : literals) {
+      if (trail_.Assignment().LiteralIsFalse(literal)) continue;
+      new_literals.push_back(literal);
+      if (trail_.Assignment().LiteralIsTrue(literal)) break;
+      EnqueueNewDecision(literal.Negated());
+      if (!Propagate()) break;
+    }
+    Backtrack(0);
+    if (new_literals.size() < literals.size()) {
+      ++counters_.num_vivified_clauses;
+      counters_.num_vivified_literals += literals.size() - new_literals.size();
+      if (!ReplaceClause(clause, new_literals)) return false;
+    }
+  }
+  return true;
+}
+
+void SatSolver::SubsumeWithNewClauses() {
+  SCOPED_TIME_STAT(&stats_);
+  if (num_clauses_at_last_inprocessing_ >= clauses_.size()) return;
+
+  // Occurrence lists of all the attached clauses.
+  ITIVector<LiteralIndex, std::vector<SatClause*>> occurrences(
+      2 * num_variables_.value());
+  for (SatClause* clause : clauses_) {
+    if (!clause->IsAttached()) continue;
+    for (const Literal literal : *clause) {
+      occurrences[literal.Index()].push_back(clause);
+    }
+  }
+
+  ITIVector<LiteralIndex, bool> is_in_clause(2 * num_variables_.value(),
+                                             false);
+  for (int i = num_clauses_at_last_inprocessing_; i < clauses_.size(); ++i) {
+    SatClause* const clause = clauses_[i];
+    if (!clause->IsAttached()) continue;
+
+    // Only the clauses containing the least frequent literal of clause can be
+    // subsumed by it.
+    LiteralIndex best = clause->FirstLiteral().Index();
+    for (const Literal literal : *clause) {
+      is_in_clause[literal.Index()] = true;
+      if (occurrences[literal.Index()].size() < occurrences[best].size()) {
+        best = literal.Index();
+      }
+    }
+    for (SatClause* other : occurrences[best]) {
+      if (other == clause || !other->IsAttached()) continue;
+      if (other->Size() < clause->Size()) continue;
+
+      // We cannot remove a problem clause if the clause subsuming it may be
+      // deleted later.
+      if (!other->IsRedundant() && clause->IsRedundant()) continue;
+      if (ClauseIsUsedAsReason(other)) continue;
+      int num_common = 0;
+      for (const Literal literal : *other) {
+        if (is_in_clause[literal.Index()]) ++num_common;
+      }
+      if (num_common == clause->Size()) {
+        DCHECK(ClauseSubsumption(
+            std::vector<Literal>(clause->begin(), clause->end()), other));
+        clauses_propagator_.LazyDetach(other);
+        if (drat_writer_ != nullptr) {
+          drat_writer_->DeleteClause(ClauseRef(other->begin(), other->end()));
+        }
+        ++counters_.num_subsumed_clauses;
+      }
+    }
+    for (const Literal literal : *clause) {
+      is_in_clause[literal.Index()] = false;
+    }
+  }
+}
+
+bool SatSolver::ReplaceClause(SatClause* clause,
+                              const std::vector<Literal>& literals) {
+  SCOPED_TIME_STAT(&stats_);
+  DCHECK_EQ(CurrentDecisionLevel(), 0);
+  if (drat_writer_ != nullptr) {
+    if (!literals.empty()) drat_writer_->AddClause(literals);
+    drat_writer_->DeleteClause(ClauseRef(clause->begin(), clause->end()));
+  }
+  clauses_propagator_.LazyDetach(clause);
+  if (literals.empty()) return SetModelUnsat();
+  if (literals.size() == 1) {
+    trail_.EnqueueWithUnitReason(literals[0], nullptr);
+  } else if (literals.size() == 2 &&
+             parameters_.treat_binary_clauses_separately()) {
+    AddBinaryClauseInternal(literals[0], literals[1]);
+  } else {
+    SatClause* new_clause =
+        clauses_propagator_.NewClause(literals, clause->IsRedundant(), nullptr);
+    clauses_.push_back(new_clause);
+    const auto it = clauses_info_.find(clause);
+    if (it != clauses_info_.end()) {
+      ClauseInfo info = it->second;
+      info.lbd = std::min(info.lbd, static_cast<int32>(literals.size()));
+      clauses_info_[new_clause] = info;
+    }
+    CHECK(clauses_propagator_.AttachAndPropagate(new_clause, &trail_));
+  }
+  if (!Propagate()) return SetModelUnsat();
+  return true;
+}
+
 void SatSolver::InitRestart() {
   SCOPED_TIME_STAT(&stats_);
   restart_count_ = 0;
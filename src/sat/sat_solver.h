@@ -20,6 +20,7 @@
 #define OR_TOOLS_SAT_SAT_SOLVER_H_
 
 #include "base/hash.h"
+#include <functional>
 #include <memory>
 #include <queue>
 #include <string>
@@ -35,6 +36,7 @@
 #include "base/random.h"
 #include "sat/pb_constraint.h"
 #include "sat/clause.h"
+#include "sat/drat_writer.h"
 #include "sat/sat_base.h"
 #include "sat/sat_parameters.pb.h"
 #include "sat/unsat_proof.h"
@@ -196,16 +198,45 @@ class SatSolver {
   //
   // This function backtrack over all the current decision, tries to enqueue the
   // given assumptions, sets the assumption level accordingly and finally calls
-  // Solve().
+  // Solve(). The decisions that are the same as the first assumptions are kept
+  // as is: when the assumptions of successive calls share a long prefix, only
+  // the ones after it are enqueued and propagated again. Call Backtrack(0)
+  // before to restart from scratch.
+  //
+  // The activation literals of the active clause groups (see below) are
+  // implicitly added in front of the given assumptions.
   //
   // If, given these assumptions, the model is UNSAT, this returns the
   // ASSUMPTIONS_UNSAT status. MODEL_UNSAT is reserved for the case where the
   // model is proven to be unsat without any assumptions.
   //
   // If ASSUMPTIONS_UNSAT is returned, it is possible to get a "core" of unsat
-  // assumptions by calling GetLastIncompatibleDecisions().
+  // assumptions by calling GetLastIncompatibleDecisions(). Note that this core
+  // may contain activation literals.
   Status ResetAndSolveWithGivenAssumptions(const std::vector<Literal>& assumptions);
 
+  // Clause groups: sets of clauses that can be retracted all at once, for
+  // incremental solving. Each group uses a fresh activation variable that is
+  // added negated to each of its clauses, and assumed true by
+  // ResetAndSolveWithGivenAssumptions() until the group is retracted. Note
+  // that the other Solve() functions do not enforce the clause groups.
+  //
+  // All these functions backtrack to level 0. NewClauseGroup() returns the
+  // index of the new group. AddClauseToGroup() returns false if the problem
+  // is detected to be UNSAT. RetractClauseGroup() fixes the activation
+  // literal to false, which satisfies all the clauses of the group; they will
+  // be deleted with the other satisfied clauses.
+  int NewClauseGroup();
+  bool AddClauseToGroup(int group, const std::vector<Literal>& literals);
+  void RetractClauseGroup(int group);
+  int NumClauseGroups() const { return clause_groups_.size(); }
+  Literal ClauseGroupActivationLiteral(int group) const {
+    return clause_groups_[group];
+  }
+  bool ClauseGroupIsActive(int group) const {
+    return !trail_.Assignment().LiteralIsFalse(clause_groups_[group]);
+  }
+
   // Changes the assumption level. All the decisions below this level will be
   // treated as assumptions by the next Solve(). Note that this may impact some
   // heuristics, like the LBD value of a clause.
@@ -275,6 +306,13 @@ class SatSolver {
   // Note(user): With this function, the solver doesn't learn anything.
   bool EnqueueDecisionIfNotConflicting(Literal true_literal);
 
+  // Same as EnqueueDecisionIfNotConflicting(), but on conflict, also fills
+  // 'conflict' with the first UIP clause that the solver would have learned.
+  // This clause is not added to the solver, it can be given back to it (or to
+  // another solver of the same problem) with AddImportedClauseDuringSearch().
+  bool EnqueueDecisionIfNotConflicting(Literal true_literal,
+                                       std::vector<Literal>* conflict);
+
   // Restores the state to the given target decision level. The decision at that
   // level and all its propagation will not be undone. But all the trail after
   // this will be cleared. Calling this with 0 will revert all the decisions and
@@ -329,6 +367,36 @@ class SatSolver {
   const std::vector<BinaryClause>& NewlyAddedBinaryClauses();
   void ClearNewlyAddedBinaryClauses();
 
+  // Functions to exchange learned clauses with other solvers working on the
+  // same problem, see sat/portfolio.h.
+  //
+  // The given function is called with each newly learned clause and its LBD,
+  // including the unit and binary ones. It must not modify the solver.
+  void SetLearnedClauseCallback(
+      const std::function<void(const std::vector<Literal>&, int)>& callback) {
+    learned_clause_callback_ = callback;
+  }
+
+  // If not nullptr, the clauses learned and deleted by the solver are streamed
+  // to the given writer (which is not owned) so that a DRAT proof of the
+  // unsatisfiability of the problem clauses is produced. This must be called
+  // before the search, and is only valid if the problem contains only clauses
+  // and use_pb_resolution is false. The solver must not import clauses.
+  void SetDratWriter(DratWriter* drat_writer) { drat_writer_ = drat_writer; }
+
+  // Adds a clause learned by another solver, with the given LBD. This must be
+  // called at level 0, and is not compatible with unsat_proof(). The clause
+  // is treated as a learned one by the clause database cleanup. Returns false
+  // if the problem is detected to be UNSAT.
+  bool AddImportedClause(const std::vector<Literal>& literals, int lbd);
+
+  // Same as AddImportedClause(), but this can be called at any decision level
+  // as long as the clause does not propagate anything: it is only added if at
+  // least two of its literals are not false, the other clauses are ignored.
+  // Returns true if the clause was added, or if it is satisfied at level 0.
+  bool AddImportedClauseDuringSearch(const std::vector<Literal>& literals,
+                                     int lbd);
+
   // Various getters of the current solver state.
   struct Decision {
     Decision() : trail_index(-1) {}
@@ -346,6 +414,9 @@ class SatSolver {
   int64 num_failures() const;
   int64 num_propagations() const;
 
+  // Number of learned clauses currently in the clause database.
+  int64 num_learned_clauses() const;
+
   // A deterministic number that should be correlated with the time spent in
   // the Solve() function. The order of magnitude should be close to the time
   // in seconds.
@@ -569,6 +640,13 @@ class SatSolver {
   // Utility function used by MinimizeConflictRecursively().
   bool CanBeInferedFromConflictVariables(VariableIndex variable);
 
+  // Returns a word with only the bit (level mod 64) set. The bitwise or of the
+  // abstract levels of a set of variables can be used to quickly reject the
+  // variables whose level is not in the set.
+  static uint64 AbstractLevel(int level) {
+    return static_cast<uint64>(1) << (level & 63);
+  }
+
   // To be used in DCHECK(). Verifies some property of the conflict clause:
   // - There is an unique literal with the highest decision level.
   // - This literal appears in the first position.
@@ -600,6 +678,29 @@ class SatSolver {
   // it if needed. Also updates the learned clause limit for the next cleanup.
   void CleanClauseDatabaseIfNeeded();
 
+  // Inprocessing: simplifies the clause database during the search. This must
+  // be called at level 0 and runs, within a deterministic time budget:
+  // - the merge of the equivalent literals of the binary implication graph,
+  // - failed literal probing on the literals with binary implications,
+  // - vivification of the learned clauses,
+  // - backward subsumption with the clauses added since the last call.
+  // Returns false if the problem was proven UNSAT.
+  bool Inprocess();
+
+  // Trail reuse on restart: returns the level to backtrack to so that only the
+  // decisions of a variable at least as active as the next decision variable
+  // are kept. Searching from there is exactly what would happen after a full
+  // restart, without repropagating the same prefix. Never returns a level
+  // smaller than the assumption level.
+  int ComputeRestartLevel();
+  bool ProbeFailedLiterals(double deadline);
+  bool VivifyRedundantClauses(double deadline);
+  void SubsumeWithNewClauses();
+
+  // Detaches 'clause' and replaces it with the given subset of its literals
+  // which must all be unassigned. Returns false if the problem is UNSAT.
+  bool ReplaceClause(SatClause* clause, const std::vector<Literal>& literals);
+
   // Bumps the activity of all variables appearing in the conflict.
   // See VSIDS decision heuristic: Chaff: Engineering an Efficient SAT Solver.
   // M.W. Moskewicz et al. ANNUAL ACM IEEE DESIGN AUTOMATION CONFERENCE 2001.
@@ -641,10 +742,9 @@ class SatSolver {
   // The number of constraints of the initial problem that where added.
   int num_constraints_;
 
-  // All the clauses managed by the solver (initial and learned). This vector
-  // has ownership of the pointers. We currently do not use
-  // std::unique_ptr<SatClause> because it can't be used with some STL
-  // algorithms like std::partition.
+  // All the clauses managed by the solver (initial and learned). They are
+  // owned by the arena of clauses_propagator_, and the pointers change when
+  // this arena is compacted, see DeleteDetachedClauses().
   //
   // Note that the unit clauses are not kept here and if the parameter
   // treat_binary_clauses_separately is true, the binary clause are not kept
@@ -696,12 +796,26 @@ class SatSolver {
   // The assumption level. See SolveWithAssumptions().
   int assumption_level_;
 
+  // The activation literal of each clause group. A group is retracted when
+  // its literal is fixed to false.
+  std::vector<Literal> clause_groups_;
+  std::vector<Literal> tmp_assumptions_;
+
   // The size of the trail when ProcessNewlyFixedVariables() was last called.
   // Note that the trail contains only fixed literals (that is literals of
   // decision levels 0) before this point.
   int num_processed_fixed_variables_;
   double deterministic_time_of_last_fixed_variables_cleanup_;
 
+  // Inprocessing state. The clauses at index num_clauses_at_last_inprocessing_
+  // or more in clauses_ were added since the last Inprocess(). The cursors
+  // are where the next probing and vivification will start, so that
+  // successive calls cover the whole problem.
+  double next_inprocessing_time_;
+  int num_clauses_at_last_inprocessing_;
+  int probing_cursor_;
+  int vivification_cursor_;
+
   // Tracks various information about the solver progress.
   struct Counters {
     int64 num_branches;
@@ -720,6 +834,16 @@ class SatSolver {
     int64 num_literals_forgotten;
     int64 num_subsumed_clauses;
 
+    // Backtracking stats.
+    int64 num_chronological_backtracks;
+    int64 num_reused_trail_levels;
+
+    // Inprocessing stats.
+    int64 num_inprocessings;
+    int64 num_failed_literals;
+    int64 num_vivified_clauses;
+    int64 num_vivified_literals;
+
     Counters()
         : num_branches(0),
           num_random_branches(0),
@@ -729,7 +853,13 @@ class SatSolver {
           num_learned_pb_literals_(0),
           num_literals_learned(0),
           num_literals_forgotten(0),
-          num_subsumed_clauses(0) {}
+          num_subsumed_clauses(0),
+          num_chronological_backtracks(0),
+          num_reused_trail_levels(0),
+          num_inprocessings(0),
+          num_failed_literals(0),
+          num_vivified_clauses(0),
+          num_vivified_literals(0) {}
   };
   Counters counters_;
 
@@ -740,6 +870,13 @@ class SatSolver {
   // constraints.
   bool is_model_unsat_;
 
+  // See SetLearnedClauseCallback().
+  std::function<void(const std::vector<Literal>&, int)>
+      learned_clause_callback_;
+
+  // See SetDratWriter().
+  DratWriter* drat_writer_;
+
   // Parameters.
   SatParameters parameters_;
 
@@ -835,6 +972,7 @@ class SatSolver {
   SparseBitset<VariableIndex> is_marked_;
   SparseBitset<VariableIndex> is_independent_;
   std::vector<int> min_trail_index_per_level_;
+  uint64 abstract_conflict_levels_;
 
   // Temporary members used by CanBeInferedFromConflictVariables().
   std::vector<VariableIndex> dfs_stack_;
@@ -843,9 +981,11 @@ class SatSolver {
   // Temporary member used by AddLinearConstraintInternal().
   std::vector<Literal> literals_scratchpad_;
 
-  // A boolean vector used to temporarily mark decision levels.
-  DEFINE_INT_TYPE(SatDecisionLevel, int);
-  SparseBitset<SatDecisionLevel> is_level_marked_;
+  // Used by ComputeLbd() to mark the decision levels: a level is marked when
+  // level_stamps_[level] == lbd_stamp_, and lbd_stamp_ is incremented on each
+  // call instead of clearing the marks.
+  std::vector<int64> level_stamps_;
+  int64 lbd_stamp_;
 
   // Temporary vectors used by EnqueueDecisionAndBackjumpOnConflict().
   std::vector<Literal> learned_conflict_;
@@ -13,6 +13,10 @@
 
 #include "sat/simplification.h"
 
+#include <memory>
+
+#include "base/callback.h"
+#include "base/threadpool.h"
 #include "base/timer.h"
 #include "base/strongly_connected_components.h"
 #include "base/stl_util.h"
@@ -147,6 +151,7 @@ void SatPresolver::AddClause(ClauseRef clause) {
   std::sort(clause_ref.begin(), clause_ref.end());
   clause_ref.erase(std::unique(clause_ref.begin(), clause_ref.end()),
                    clause_ref.end());
+  clause_ref.shrink_to_fit();
 
   // Check for trivial clauses:
   for (int i = 1; i < clause_ref.size(); ++i) {
@@ -166,6 +171,7 @@ void SatPresolver::AddClause(ClauseRef clause) {
   if (required_size > literal_to_clauses_.size()) {
     literal_to_clauses_.resize(required_size);
     literal_to_clause_sizes_.resize(required_size);
+    is_marked_for_compaction_.resize(required_size, false);
   }
   for (Literal e : clause_ref) {
     literal_to_clauses_[e.Index()].push_back(ci);
@@ -176,8 +182,12 @@ void SatPresolver::AddClause(ClauseRef clause) {
 void SatPresolver::AddClauseInternal(std::vector<Literal>* clause) {
   CHECK_GT(clause->size(), 0) << "TODO(fdid): Unsat during presolve?";
   const ClauseIndex ci(clauses_.size());
-  clauses_.push_back(std::vector<Literal>());
-  clauses_.back().swap(*clause);
+
+  // We copy the clause rather than swapping it so that it does not keep the
+  // extra capacity of the given vector. This matters since a lot of resolvents
+  // are added by CrossProduct(), and this way the given vector is reused.
+  clauses_.push_back(std::vector<Literal>(clause->begin(), clause->end()));
+  clause->clear();
   in_clause_to_process_.push_back(true);
   clause_to_process_.push_back(ci);
   for (Literal e : clauses_.back()) {
@@ -209,6 +219,8 @@ void SatPresolver::LoadProblemIntoSatSolver(SatSolver* solver) {
   in_clause_to_process_.clear();
   clause_to_process_.clear();
   literal_to_clauses_.clear();
+  is_marked_for_compaction_.clear();
+  literals_to_compact_.clear();
 
   const ITIVector<VariableIndex, VariableIndex> mapping = VariableMapping();
   int new_size = 0;
@@ -231,6 +243,7 @@ void SatPresolver::LoadProblemIntoSatSolver(SatSolver* solver) {
 
 bool SatPresolver::ProcessAllClauses() {
   while (!clause_to_process_.empty()) {
+    CompactOccurrenceLists();
     const ClauseIndex ci = clause_to_process_.front();
     in_clause_to_process_[ci] = false;
     clause_to_process_.pop_front();
@@ -452,6 +465,7 @@ bool SatPresolver::CrossProduct(Literal x) {
 void SatPresolver::Remove(ClauseIndex ci) {
   for (Literal e : clauses_[ci]) {
     literal_to_clause_sizes_[e.Index()]--;
+    MaybeMarkOccurrenceListForCompaction(e.Index());
     UpdatePriorityQueue(e.Variable());
   }
   STLClearObject(&clauses_[ci]);
@@ -460,12 +474,40 @@ void SatPresolver::Remove(ClauseIndex ci) {
 void SatPresolver::RemoveAndRegisterForPostsolve(ClauseIndex ci, Literal x) {
   for (Literal e : clauses_[ci]) {
     literal_to_clause_sizes_[e.Index()]--;
+    MaybeMarkOccurrenceListForCompaction(e.Index());
     UpdatePriorityQueue(e.Variable());
   }
   postsolver_->Add(x, clauses_[ci]);
   STLClearObject(&clauses_[ci]);
 }
 
+void SatPresolver::MaybeMarkOccurrenceListForCompaction(LiteralIndex lit) {
+  // The slack avoids compacting the short lists too often. Since a list is
+  // only marked when it contains at least half removed clauses, the total
+  // compaction work is linear in the number of removals.
+  const int kSlack = 8;
+  if (is_marked_for_compaction_[lit]) return;
+  if (literal_to_clauses_[lit].size() >
+      2 * literal_to_clause_sizes_[lit] + kSlack) {
+    is_marked_for_compaction_[lit] = true;
+    literals_to_compact_.push_back(lit);
+  }
+}
+
+void SatPresolver::CompactOccurrenceLists() {
+  for (const LiteralIndex lit : literals_to_compact_) {
+    is_marked_for_compaction_[lit] = false;
+    std::vector<ClauseIndex>& occurrence_list = literal_to_clauses_[lit];
+    int new_size = 0;
+    for (const ClauseIndex ci : occurrence_list) {
+      if (!clauses_[ci].empty()) occurrence_list[new_size++] = ci;
+    }
+    occurrence_list.resize(new_size);
+    occurrence_list.shrink_to_fit();
+  }
+  literals_to_compact_.clear();
+}
+
 Literal SatPresolver::FindLiteralWithShortestOccurenceList(
     const std::vector<Literal>& clause) {
   CHECK(!clause.empty());
@@ -694,6 +736,115 @@ class PropagationGraph {
   DISALLOW_COPY_AND_ASSIGN(PropagationGraph);
 };
 
+// Output of SatSolver::ExtractClauses() that just stores the clauses.
+class ClauseCollector {
+ public:
+  void AddBinaryClause(Literal a, Literal b) {
+    clauses_.push_back({a, b});
+  }
+  void AddClause(ClauseRef clause) {
+    clauses_.push_back(std::vector<Literal>(clause.begin(), clause.end()));
+  }
+  const std::vector<std::vector<Literal>>& clauses() const { return clauses_; }
+
+ private:
+  std::vector<std::vector<Literal>> clauses_;
+};
+
+// Computes in parallel the full PropagationGraph of a solver. Each worker
+// loads the clauses of the solver in its own SatSolver and probes a contiguous
+// range of the literals with its share of the deterministic time limit. The
+// literals that could not be probed in time have no adjacent nodes.
+class ParallelPropagationGraphBuilder {
+ public:
+  ParallelPropagationGraphBuilder(SatSolver* solver, int num_workers)
+      : solver_(solver), num_workers_(num_workers) {}
+
+  // Fills the graph and the literals fixed by the workers. The latter are
+  // sorted by worker, so that the result does not depend on the thread
+  // scheduling. Returns false if a worker proved the problem UNSAT.
+  bool Build(std::vector<std::vector<int32>>* graph,
+             std::vector<Literal>* fixed_literals);
+
+ private:
+  void RunWorker(int index);
+
+  SatSolver* const solver_;
+  const int num_workers_;
+  ClauseCollector collector_;
+  std::vector<std::vector<int32>>* graph_;
+  std::vector<std::vector<Literal>> worker_fixed_literals_;
+  std::vector<bool> worker_is_unsat_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelPropagationGraphBuilder);
+};
+
+bool ParallelPropagationGraphBuilder::Build(
+    std::vector<std::vector<int32>>* graph,
+    std::vector<Literal>* fixed_literals) {
+  // Note that this backtracks the solver and is not thread-safe, so it is done
+  // once before starting the workers.
+  solver_->ExtractClauses(&collector_);
+  graph_ = graph;
+  graph_->assign(2 * solver_->NumVariables(), std::vector<int32>());
+  worker_fixed_literals_.assign(num_workers_, std::vector<Literal>());
+  worker_is_unsat_.assign(num_workers_, false);
+  {
+    ThreadPool pool("ParallelProbing", num_workers_);
+    pool.StartWorkers();
+    for (int i = 0; i < num_workers_; ++i) {
+      pool.Add(NewCallback(this, &ParallelPropagationGraphBuilder::RunWorker,
+                           i));
+    }
+  }
+  fixed_literals->clear();
+  for (int i = 0; i < num_workers_; ++i) {
+    if (worker_is_unsat_[i]) return false;
+    fixed_literals->insert(fixed_literals->end(),
+                           worker_fixed_literals_[i].begin(),
+                           worker_fixed_literals_[i].end());
+  }
+  return true;
+}
+
+void ParallelPropagationGraphBuilder::RunWorker(int index) {
+  SatSolver solver;
+  solver.SetParameters(solver_->parameters());
+  solver.SetNumVariables(solver_->NumVariables());
+  bool ok = true;
+  for (int i = 0; ok && i < solver_->LiteralTrail().Index(); ++i) {
+    ok = solver.AddUnitClause(solver_->LiteralTrail()[i]);
+  }
+  for (const std::vector<Literal>& clause : collector_.clauses()) {
+    if (!ok) break;
+    ok = solver.AddProblemClause(clause);
+  }
+  if (!ok) {
+    worker_is_unsat_[index] = true;
+    return;
+  }
+
+  const int size = graph_->size();
+  const int begin = static_cast<int64>(size) * index / num_workers_;
+  const int end = static_cast<int64>(size) * (index + 1) / num_workers_;
+  PropagationGraph graph(
+      solver_->parameters().presolve_probing_deterministic_time_limit() /
+          num_workers_,
+      &solver);
+  for (int i = begin; i < end; ++i) {
+    (*graph_)[i] = graph[i];
+    if (solver.IsModelUnsat()) {
+      worker_is_unsat_[index] = true;
+      return;
+    }
+  }
+  solver.Backtrack(0);
+  for (int i = solver_->LiteralTrail().Index();
+       i < solver.LiteralTrail().Index(); ++i) {
+    worker_fixed_literals_[index].push_back(solver.LiteralTrail()[i]);
+  }
+}
+
 void ProbeAndFindEquivalentLiteral(
     SatSolver* solver, SatPostsolver* postsolver,
     ITIVector<LiteralIndex, LiteralIndex>* mapping) {
@@ -701,11 +852,28 @@ void ProbeAndFindEquivalentLiteral(
   mapping->clear();
   const int num_already_fixed_vars = solver->LiteralTrail().Index();
 
-  PropagationGraph graph(
-      solver->parameters().presolve_probing_deterministic_time_limit(), solver);
   const int32 size = solver->NumVariables() * 2;
   std::vector<std::vector<int32>> scc;
-  FindStronglyConnectedComponents(size, graph, &scc);
+  const int num_workers = solver->parameters().presolve_probing_num_workers();
+  if (num_workers > 1 && !solver->IsModelUnsat()) {
+    std::vector<std::vector<int32>> graph;
+    std::vector<Literal> fixed_literals;
+    ParallelPropagationGraphBuilder builder(solver, num_workers);
+    bool ok = builder.Build(&graph, &fixed_literals);
+    for (int i = 0; ok && i < fixed_literals.size(); ++i) {
+      ok = solver->AddUnitClause(fixed_literals[i]);
+    }
+    if (!ok) {
+      LOG(INFO) << "UNSAT during probing.";
+      return;
+    }
+    FindStronglyConnectedComponents(size, graph, &scc);
+  } else {
+    PropagationGraph graph(
+        solver->parameters().presolve_probing_deterministic_time_limit(),
+        solver);
+    FindStronglyConnectedComponents(size, graph, &scc);
+  }
 
   // We have no guarantee that the cycle of x and not(x) touch the same
   // variables. This is because we may have more info for the literal probed
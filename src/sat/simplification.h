@@ -172,7 +172,8 @@ class SatPresolver {
   // after this call.
   void AddClauseInternal(std::vector<Literal>* clause);
 
-  // Clause removal function.
+  // Clause removal function. Note that the removed clauses are only lazily
+  // removed from the occurrence lists, see CompactOccurrenceLists().
   void Remove(ClauseIndex ci);
   void RemoveAndRegisterForPostsolve(ClauseIndex ci, Literal x);
   void RemoveAndRegisterForPostsolveAllClauseContaining(Literal x);
@@ -183,6 +184,16 @@ class SatPresolver {
   // the problem is shown to be UNSAT.
   bool ProcessAllClauses();
 
+  // Marks the occurrence list of the given literal for compaction if most of
+  // its entries are removed clauses. This is called each time a clause
+  // containing the literal is removed.
+  void MaybeMarkOccurrenceListForCompaction(LiteralIndex lit);
+
+  // Removes the deleted clauses from the marked occurrence lists and releases
+  // their unused memory. Because this changes the lists, it must not be called
+  // while iterating over one of them.
+  void CompactOccurrenceLists();
+
   // Finds the literal from the clause that occur the less in the clause
   // database.
   Literal FindLiteralWithShortestOccurenceList(const std::vector<Literal>& clause);
@@ -232,6 +243,10 @@ class SatPresolver {
   // we keep the size of the occurence list (without the deleted clause) here.
   ITIVector<LiteralIndex, int> literal_to_clause_sizes_;
 
+  // The occurrence lists to clean on the next CompactOccurrenceLists().
+  ITIVector<LiteralIndex, bool> is_marked_for_compaction_;
+  std::vector<LiteralIndex> literals_to_compact_;
+
   // Used for postsolve.
   SatPostsolver* postsolver_;
 
@@ -18,6 +18,7 @@ namespace sat {
 
 SymmetryPropagator::SymmetryPropagator()
     : Propagator("SymmetryPropagator"),
+      num_cached_images_(0),
       stats_("SymmetryPropagator"),
       num_propagations_(0),
       num_conflicts_(0) {}
@@ -51,6 +52,8 @@ void SymmetryPropagator::AddSymmetry(
   }
   permutation_trails_.push_back(std::vector<AssignedLiteralInfo>());
   permutation_trails_.back().reserve(permutation->Support().size());
+  image_cache_.push_back(std::vector<int>());
+  permute_work_.push_back(0);
   permutations_.emplace_back(permutation.release());
 }
 
@@ -187,9 +190,31 @@ bool SymmetryPropagator::Enqueue(const Trail& trail, Literal literal,
 void SymmetryPropagator::Permute(int index, ClauseRef input,
                                  std::vector<Literal>* output) const {
   SCOPED_TIME_STAT(&stats_);
+  const SparsePermutation& permutation = *(permutations_[index].get());
+
+  // Use the dense image table if there is one, or if it is time to build it.
+  std::vector<int>* const image = &image_cache_[index];
+  if (image->empty()) {
+    permute_work_[index] += permutation.Support().size();
+    if (permute_work_[index] >= permutation.Size() &&
+        num_cached_images_ + permutation.Size() <= kMaxNumCachedImages) {
+      permutation.FillDenseImages(image);
+      num_cached_images_ += permutation.Size();
+    }
+  }
+  if (!image->empty()) {
+    output->resize(input.size());
+    Literal* const out = output->data();
+    const int* const dense_image = image->data();
+    int i = 0;
+    for (Literal literal : input) {
+      DCHECK_LT(literal.Index(), image->size());
+      out[i++] = Literal(LiteralIndex(dense_image[literal.Index().value()]));
+    }
+    return;
+  }
 
   // Initialize tmp_literal_mapping_ (resize it if needed).
-  const SparsePermutation& permutation = *(permutations_[index].get());
   if (permutation.Size() > tmp_literal_mapping_.size()) {
     tmp_literal_mapping_.resize(permutation.Size());
     for (LiteralIndex i(0); i < tmp_literal_mapping_.size(); ++i) {
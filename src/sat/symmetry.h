@@ -84,7 +84,9 @@ class SymmetryPropagator : public Propagator {
   //
   // Permutes a list of literals from input into output using the permutation
   // with given index. This uses tmp_literal_mapping_ and has a complexity in
-  // O(permutation_support + input_size).
+  // O(permutation_support + input_size), except for the permutations that are
+  // used often enough to get a dense image table (see image_cache_), for which
+  // it is in O(input_size).
   void Permute(int index, ClauseRef input, std::vector<Literal>* output) const;
 
  private:
@@ -135,6 +137,16 @@ class SymmetryPropagator : public Propagator {
   // restored to the identity.
   mutable ITIVector<LiteralIndex, Literal> tmp_literal_mapping_;
 
+  // The dense image tables of the permutations used most by Permute(), see
+  // SparsePermutation::FillDenseImages(). A table is built once the work that
+  // Permute() spent walking the cycles of its permutation exceeds the size of
+  // the table, and as long as the total size of the tables stays below
+  // kMaxNumCachedImages. An empty table means that there is none.
+  static const int kMaxNumCachedImages = 1 << 22;
+  mutable std::vector<std::vector<int>> image_cache_;
+  mutable std::vector<int64> permute_work_;
+  mutable int64 num_cached_images_;
+
   // Symmetry reason indexed by trail_index.
   struct ReasonInfo {
     int source_trail_index;
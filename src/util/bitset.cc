@@ -14,6 +14,8 @@
 
 #include "util/bitset.h"
 
+#include <algorithm>
+
 #include "base/commandlineflags.h"
 #include "base/logging.h"
 
@@ -255,4 +257,217 @@ UNSAFE_MOST_SIGNIFICANT_BIT_POSITION(32)
 
 #undef UNSAFE_MOST_SIGNIFICANT_BIT_POSITION
 
+// ---------- Bulk Operations ----------
+
+void IntersectWords64(uint64* const dest, const uint64* const src,
+                      uint64 num_words) {
+  for (uint64 i = 0; i < num_words; ++i) {
+    dest[i] &= src[i];
+  }
+}
+
+void UnionWords64(uint64* const dest, const uint64* const src,
+                  uint64 num_words) {
+  for (uint64 i = 0; i < num_words; ++i) {
+    dest[i] |= src[i];
+  }
+}
+
+void DifferenceWords64(uint64* const dest, const uint64* const src,
+                       uint64 num_words) {
+  for (uint64 i = 0; i < num_words; ++i) {
+    dest[i] &= ~src[i];
+  }
+}
+
+uint64 IntersectionCountWords64(const uint64* const a, const uint64* const b,
+                                uint64 num_words) {
+  uint64 bit_count = 0;
+  for (uint64 i = 0; i < num_words; ++i) {
+    bit_count += BitCount64(a[i] & b[i]);
+  }
+  return bit_count;
+}
+
+uint64 BitCountWords64(const uint64* const bitset, uint64 num_words) {
+  uint64 bit_count = 0;
+  for (uint64 i = 0; i < num_words; ++i) {
+    bit_count += BitCount64(bitset[i]);
+  }
+  return bit_count;
+}
+
+// ---------- CompressedBitset ----------
+
+int CompressedBitset::ChunkIndex(uint16 key) const {
+  int low = 0;
+  int high = chunks_.size();
+  while (low < high) {
+    const int middle = (low + high) / 2;
+    if (chunks_[middle].key < key) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+bool CompressedBitset::IsSet(uint32 i) const {
+  const uint16 key = i >> 16;
+  const uint16 low_bits = i & 0xFFFF;
+  const int index = ChunkIndex(key);
+  if (index == chunks_.size() || chunks_[index].key != key) return false;
+  const Chunk& chunk = chunks_[index];
+  if (chunk.IsBitset()) return IsBitSet64(chunk.words.data(), low_bits);
+  return std::binary_search(chunk.values.begin(), chunk.values.end(),
+                            low_bits);
+}
+
+void CompressedBitset::Set(uint32 i) {
+  const uint16 key = i >> 16;
+  const uint16 low_bits = i & 0xFFFF;
+  const int index = ChunkIndex(key);
+  if (index == chunks_.size() || chunks_[index].key != key) {
+    chunks_.insert(chunks_.begin() + index, Chunk(key));
+  }
+  Chunk& chunk = chunks_[index];
+  if (chunk.IsBitset()) {
+    if (IsBitSet64(chunk.words.data(), low_bits)) return;
+    SetBit64(chunk.words.data(), low_bits);
+  } else {
+    const std::vector<uint16>::iterator it =
+        std::lower_bound(chunk.values.begin(), chunk.values.end(), low_bits);
+    if (it != chunk.values.end() && *it == low_bits) return;
+    chunk.values.insert(it, low_bits);
+    if (chunk.values.size() > kMaxArraySize) {
+      chunk.words.assign(kNumWordsPerChunk, 0);
+      for (const uint16 value : chunk.values) {
+        SetBit64(chunk.words.data(), value);
+      }
+      std::vector<uint16>().swap(chunk.values);
+    }
+  }
+  ++chunk.size;
+  ++num_set_bits_;
+}
+
+void CompressedBitset::Clear(uint32 i) {
+  const uint16 key = i >> 16;
+  const uint16 low_bits = i & 0xFFFF;
+  const int index = ChunkIndex(key);
+  if (index == chunks_.size() || chunks_[index].key != key) return;
+  Chunk& chunk = chunks_[index];
+  if (chunk.IsBitset()) {
+    if (!IsBitSet64(chunk.words.data(), low_bits)) return;
+    ClearBit64(chunk.words.data(), low_bits);
+  } else {
+    const std::vector<uint16>::iterator it =
+        std::lower_bound(chunk.values.begin(), chunk.values.end(), low_bits);
+    if (it == chunk.values.end() || *it != low_bits) return;
+    chunk.values.erase(it);
+  }
+  --chunk.size;
+  --num_set_bits_;
+  if (chunk.size == 0) {
+    chunks_.erase(chunks_.begin() + index);
+  } else if (chunk.IsBitset() && chunk.size <= kMaxArraySize / 2) {
+    // Goes back to an array, with some hysteresis so that alternating Set()
+    // and Clear() around the threshold do not convert the chunk each time.
+    chunk.values.reserve(chunk.size);
+    for (int value = 0; value < (1 << 16); ++value) {
+      if (IsBitSet64(chunk.words.data(), value)) chunk.values.push_back(value);
+    }
+    std::vector<uint64>().swap(chunk.words);
+  }
+}
+
+int64 CompressedBitset::ChunkIntersectionCount(const Chunk& a,
+                                               const Chunk& b) {
+  if (a.IsBitset() && b.IsBitset()) {
+    return IntersectionCountWords64(a.words.data(), b.words.data(),
+                                    kNumWordsPerChunk);
+  }
+  if (a.IsBitset() || b.IsBitset()) {
+    const Chunk& array = a.IsBitset() ? b : a;
+    const uint64* const words = a.IsBitset() ? a.words.data() : b.words.data();
+    int64 count = 0;
+    for (const uint16 value : array.values) {
+      count += IsBitSet64(words, value);
+    }
+    return count;
+  }
+  int64 count = 0;
+  int i = 0;
+  int j = 0;
+  while (i < a.values.size() && j < b.values.size()) {
+    if (a.values[i] < b.values[j]) {
+      ++i;
+    } else if (b.values[j] < a.values[i]) {
+      ++j;
+    } else {
+      ++count;
+      ++i;
+      ++j;
+    }
+  }
+  return count;
+}
+
+int64 CompressedBitset::IntersectionCount(const CompressedBitset& other) const {
+  int64 count = 0;
+  int i = 0;
+  int j = 0;
+  while (i < chunks_.size() && j < other.chunks_.size()) {
+    if (chunks_[i].key < other.chunks_[j].key) {
+      ++i;
+    } else if (other.chunks_[j].key < chunks_[i].key) {
+      ++j;
+    } else {
+      count += ChunkIntersectionCount(chunks_[i], other.chunks_[j]);
+      ++i;
+      ++j;
+    }
+  }
+  return count;
+}
+
+CompressedBitset::Iterator::Iterator(const CompressedBitset& bitset)
+    : bitset_(bitset), chunk_(0), position_(0) {
+  Settle();
+}
+
+void CompressedBitset::Iterator::Next() {
+  DCHECK(Ok());
+  ++position_;
+  Settle();
+}
+
+void CompressedBitset::Iterator::Settle() {
+  // For the arrays, position_ is the index in the array, converted by
+  // Index(); for the bitsets, it is the low 16 bits of the value.
+  while (chunk_ < bitset_.chunks_.size()) {
+    const Chunk& chunk = bitset_.chunks_[chunk_];
+    if (!chunk.IsBitset()) {
+      if (position_ < chunk.values.size()) return;
+    } else {
+      uint64 word_index = BitOffset64(position_);
+      if (word_index < kNumWordsPerChunk) {
+        uint64 word =
+            chunk.words[word_index] & IntervalUp64(BitPos64(position_));
+        while (word == 0 && ++word_index < kNumWordsPerChunk) {
+          word = chunk.words[word_index];
+        }
+        if (word != 0) {
+          position_ =
+              BitShift64(word_index) + LeastSignificantBitPosition64(word);
+          return;
+        }
+      }
+    }
+    ++chunk_;
+    position_ = 0;
+  }
+}
+
 }  // namespace operations_research
@@ -405,6 +405,24 @@ int64 UnsafeMostSignificantBitPosition64(const uint64* const bitset,
 int32 UnsafeMostSignificantBitPosition32(const uint32* const bitset,
                                          uint32 start, uint32 end);
 
+// Bulk operations on the words [0, num_words) of two bitsets, which must not
+// overlap. They are written as plain loops over the words, that the compiler
+// vectorizes.
+// Sets dest to dest & src.
+void IntersectWords64(uint64* const dest, const uint64* const src,
+                      uint64 num_words);
+// Sets dest to dest | src.
+void UnionWords64(uint64* const dest, const uint64* const src,
+                  uint64 num_words);
+// Sets dest to dest & ~src.
+void DifferenceWords64(uint64* const dest, const uint64* const src,
+                       uint64 num_words);
+// Returns the number of bits set in a & b.
+uint64 IntersectionCountWords64(const uint64* const a, const uint64* const b,
+                                uint64 num_words);
+// Returns the number of bits set in the words.
+uint64 BitCountWords64(const uint64* const bitset, uint64 num_words);
+
 // Returns a mask with the bits pos % 64 and (pos ^ 1) % 64 sets.
 inline uint64 TwoBitsFromPos64(uint64 pos) {
   return GG_ULONGLONG(3) << (pos & 62);
@@ -548,14 +566,41 @@ class Bitset64 {
   // the higher order bits are assumed to be 0.
   void Intersection(const Bitset64<IndexType>& other) {
     const int min_size = std::min(data_.size(), other.data_.size());
-    for (int i = 0; i < min_size; ++i) {
-      data_[i] &= other.data_[i];
-    }
+    IntersectWords64(data_.data(), other.data_.data(), min_size);
     for (int i = min_size; i < data_.size(); ++i) {
       data_[i] = 0;
     }
   }
 
+  // Sets "this" to be the union of "this" and "other". The bitsets do not
+  // have to be the same size. If other is larger, its high order bits are
+  // ignored.
+  void Union(const Bitset64<IndexType>& other) {
+    const int min_size = std::min(data_.size(), other.data_.size());
+    UnionWords64(data_.data(), other.data_.data(), min_size);
+    if (other.data_.size() >= data_.size()) ClearBitsAfterSize();
+  }
+
+  // Clears in "this" the bits set in "other". The bitsets do not have to be
+  // the same size.
+  void Difference(const Bitset64<IndexType>& other) {
+    const int min_size = std::min(data_.size(), other.data_.size());
+    DifferenceWords64(data_.data(), other.data_.data(), min_size);
+  }
+
+  // Returns the number of bits set in both "this" and "other", without
+  // building their intersection.
+  int64 IntersectionCount(const Bitset64<IndexType>& other) const {
+    const int min_size = std::min(data_.size(), other.data_.size());
+    return IntersectionCountWords64(data_.data(), other.data_.data(),
+                                    min_size);
+  }
+
+  // Returns the number of bits set.
+  int64 NumberOfSetBits() const {
+    return BitCountWords64(data_.data(), data_.size());
+  }
+
   // Class to iterate over the bit positions at 1 of a Bitset64.
   //
   // IMPORTANT: Because the iterator "caches" the current uint64 bucket, this
@@ -666,6 +711,14 @@ class Bitset64 {
   // This function is specialized below to work with IntType and int64.
   int64 Value(IndexType input) const;
 
+  // Clears the bits of the last bucket after size_, which must stay 0 for
+  // the Iterator.
+  void ClearBitsAfterSize() {
+    if (!data_.empty() && BitPos64(Value(size_)) != 0) {
+      data_.back() &= IntervalDown64(BitPos64(Value(size_) - 1));
+    }
+  }
+
   IndexType size_;
   std::vector<uint64> data_;
 
@@ -762,6 +815,85 @@ class SparseBitset {
   DISALLOW_COPY_AND_ASSIGN(SparseBitset);
 };
 
+// A compressed set of uint32, for very large and sparse sets. The range of
+// the values is split in chunks of 2^16 values, and only the chunks with a
+// value in the set are stored: as a sorted array of the low 16 bits of the
+// values when the chunk has few values, or as a bitset of 2^16 bits
+// otherwise (this is the layout of the "roaring" bitmaps). A set of n values
+// thus takes at most about 2n bytes, and at most 8KB per chunk.
+class CompressedBitset {
+ public:
+  CompressedBitset() : num_set_bits_(0) {}
+
+  bool IsSet(uint32 i) const;
+  void Set(uint32 i);
+  void Clear(uint32 i);
+  void ClearAll() {
+    chunks_.clear();
+    num_set_bits_ = 0;
+  }
+
+  // Returns the number of values in the set.
+  int64 NumberOfSetBits() const { return num_set_bits_; }
+
+  // Returns the number of values in both "this" and "other".
+  int64 IntersectionCount(const CompressedBitset& other) const;
+
+  // Class to iterate over the values of a CompressedBitset, in increasing
+  // order. The set must not be modified while iterating.
+  class Iterator {
+   public:
+    explicit Iterator(const CompressedBitset& bitset);
+    bool Ok() const { return chunk_ < bitset_.chunks_.size(); }
+    uint32 Index() const {
+      DCHECK(Ok());
+      const Chunk& chunk = bitset_.chunks_[chunk_];
+      return (static_cast<uint32>(chunk.key) << 16) |
+             (chunk.IsBitset() ? position_ : chunk.values[position_]);
+    }
+    void Next();
+
+   private:
+    // Moves to the first value of the chunk chunk_ at or after position_, or
+    // to the next chunks if there is none.
+    void Settle();
+
+    const CompressedBitset& bitset_;
+    int chunk_;
+    uint32 position_;
+  };
+
+ private:
+  // Chunks with more values than this are stored as bitsets. With 2 bytes
+  // per value in the array, both layouts take 8KB at this size.
+  static const int kMaxArraySize = 4096;
+  static const int kNumWordsPerChunk = (1 << 16) / 64;
+
+  struct Chunk {
+    explicit Chunk(uint16 k) : key(k), size(0) {}
+    bool IsBitset() const { return !words.empty(); }
+
+    // The high 16 bits of the values of the chunk.
+    uint16 key;
+    int size;
+    // The sorted low 16 bits of the values, if !IsBitset().
+    std::vector<uint16> values;
+    // Otherwise, the bitset of the low 16 bits of the values.
+    std::vector<uint64> words;
+  };
+
+  // Returns the index in chunks_ of the chunk with the given key, or of the
+  // place where it should be inserted.
+  int ChunkIndex(uint16 key) const;
+
+  static int64 ChunkIntersectionCount(const Chunk& a, const Chunk& b);
+
+  // The chunks with at least one value, sorted by key.
+  std::vector<Chunk> chunks_;
+  int64 num_set_bits_;
+  DISALLOW_COPY_AND_ASSIGN(CompressedBitset);
+};
+
 }  // namespace operations_research
 
 #endif  // OR_TOOLS_UTIL_BITSET_H_
@@ -11,32 +11,51 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-
 #include "util/graph_export.h"
 
+#include <zlib.h>
+#include <algorithm>
+#include <functional>
 #include <memory>
+#include <thread>  // NOLINT
 
+#include "base/integral_types.h"
 #include "base/logging.h"
 #include "base/macros.h"
 #include "base/stringprintf.h"
+#include "base/join.h"
+#include "base/strutil.h"
 #include "base/file.h"
-#include "base/status.h"
 
 namespace operations_research {
 
 GraphExporter::~GraphExporter() {}
 
+void GraphExporter::WriteNodes(const std::vector<Node>& nodes) {
+  for (const Node& node : nodes) {
+    WriteNode(node.name, node.label, node.shape, node.color);
+  }
+}
+
+void GraphExporter::WriteLinks(const std::vector<Link>& links) {
+  for (const Link& link : links) {
+    WriteLink(link.source, link.destination, link.label);
+  }
+}
+
 namespace {
 class GraphSyntax {
  public:
   virtual ~GraphSyntax() {}
 
-  // Node in the right syntax.
-  virtual std::string Node(const std::string& name, const std::string& label,
-                      const std::string& shape, const std::string& color) = 0;
-  // Adds one link in the generated graph.
-  virtual std::string Link(const std::string& source, const std::string& destination,
-                      const std::string& label) = 0;
+  // Appends the node in the right syntax to output.
+  virtual void AppendNode(const std::string& name, const std::string& label,
+                          const std::string& shape, const std::string& color,
+                          std::string* output) = 0;
+  // Appends one link of the generated graph to output.
+  virtual void AppendLink(const std::string& source,
+                          const std::string& destination,
+                          const std::string& label, std::string* output) = 0;
   // File header.
   virtual std::string Header(const std::string& name) = 0;
 
@@ -48,17 +67,17 @@ class DotSyntax : public GraphSyntax {
  public:
   ~DotSyntax() override {}
 
-  std::string Node(const std::string& name, const std::string& label, const std::string& shape,
-              const std::string& color) override {
-    return StringPrintf("%s [shape=%s label=\"%s\" color=%s]\n", name.c_str(),
-                        shape.c_str(), label.c_str(), color.c_str());
+  void AppendNode(const std::string& name, const std::string& label,
+                  const std::string& shape, const std::string& color,
+                  std::string* output) override {
+    StrAppend(output, name, " [shape=", shape, " label=\"", label, "\" color=",
+              color, "]\n");
   }
 
   // Adds one link in the generated graph.
-  std::string Link(const std::string& source, const std::string& destination,
-              const std::string& label) override {
-    return StringPrintf("%s -> %s [label=%s]\n", source.c_str(),
-                        destination.c_str(), label.c_str());
+  void AppendLink(const std::string& source, const std::string& destination,
+                  const std::string& label, std::string* output) override {
+    StrAppend(output, source, " -> ", destination, " [label=", label, "]\n");
   }
 
   // File header.
@@ -74,30 +93,20 @@ class GmlSyntax : public GraphSyntax {
  public:
   ~GmlSyntax() override {}
 
-  std::string Node(const std::string& name, const std::string& label, const std::string& shape,
-              const std::string& color) override {
-    return StringPrintf(
-        "  node [\n"
-        "    name \"%s\"\n"
-        "    label \"%s\"\n"
-        "    graphics [\n"
-        "      type \"%s\"\n"
-        "      fill \"%s\"\n"
-        "    ]\n"
-        "  ]\n",
-        name.c_str(), label.c_str(), shape.c_str(), color.c_str());
+  void AppendNode(const std::string& name, const std::string& label,
+                  const std::string& shape, const std::string& color,
+                  std::string* output) override {
+    StrAppend(output, "  node [\n    name \"", name, "\"\n    label \"", label,
+              "\"\n    graphics [\n      type \"", shape,
+              "\"\n      fill \"", color);
+    output->append("\"\n    ]\n  ]\n");
   }
 
   // Adds one link in the generated graph.
-  std::string Link(const std::string& source, const std::string& destination,
-              const std::string& label) override {
-    return StringPrintf(
-        "  edge [\n"
-        "    label \"%s\"\n"
-        "    source \"%s\"\n"
-        "    target \"%s\"\n"
-        "  ]\n",
-        label.c_str(), source.c_str(), destination.c_str());
+  void AppendLink(const std::string& source, const std::string& destination,
+                  const std::string& label, std::string* output) override {
+    StrAppend(output, "  edge [\n    label \"", label, "\"\n    source \"",
+              source, "\"\n    target \"", destination, "\"\n  ]\n");
   }
 
   // File header.
@@ -112,45 +121,167 @@ class GmlSyntax : public GraphSyntax {
   std::string Footer() override { return "]\n"; }
 };
 
+// Where a FileGraphExporter writes its output.
+class GraphOutput {
+ public:
+  virtual ~GraphOutput() {}
+
+  // Writes the data at the end of the output. Returns false on error.
+  virtual bool Write(const std::string& data) = 0;
+};
+
+// Writes to a File, which is closed and deleted at the end if it is owned.
+// Note that file::WriteString() can't be used, since it closes the file.
+class FileGraphOutput : public GraphOutput {
+ public:
+  FileGraphOutput(File* const file, bool owned) : file_(file), owned_(owned) {}
+  ~FileGraphOutput() override {
+    if (owned_) {
+      file_->Close();
+      delete file_;
+    }
+  }
+
+  bool Write(const std::string& data) override {
+    return file_->Write(data.data(), data.size()) == data.size();
+  }
+
+ private:
+  File* const file_;
+  const bool owned_;
+};
+
+// Writes to a gzip file, which is closed at the end.
+class GzipGraphOutput : public GraphOutput {
+ public:
+  explicit GzipGraphOutput(gzFile file) : file_(file) {}
+  ~GzipGraphOutput() override { gzclose(file_); }
+
+  bool Write(const std::string& data) override {
+    const int size = data.size();
+    return size == 0 || gzwrite(file_, data.data(), size) == size;
+  }
+
+ private:
+  gzFile file_;
+};
+
 // Graph exporter that will write to a file with a given format.
-// Takes ownership of the GraphSyntax parameter.
+// Takes ownership of the GraphSyntax and GraphOutput parameters.
 class FileGraphExporter : public GraphExporter {
  public:
-  FileGraphExporter(File* const file, GraphSyntax* const syntax)
-      : file_(file), syntax_(syntax) {}
+  FileGraphExporter(GraphOutput* const output, GraphSyntax* const syntax)
+      : output_(output), syntax_(syntax), ok_(true) {}
 
-  ~FileGraphExporter() override {}
+  ~FileGraphExporter() override { Flush(); }
 
   // Write node in GML or DOT format.
-  void WriteNode(const std::string& name, const std::string& label, const std::string& shape,
-                 const std::string& color) override {
-    Append(syntax_->Node(name, label, shape, color));
+  void WriteNode(const std::string& name, const std::string& label,
+                 const std::string& shape, const std::string& color) override {
+    syntax_->AppendNode(name, label, shape, color, &buffer_);
+    MaybeFlush();
   }
 
   // Adds one link in the generated graph.
   void WriteLink(const std::string& source, const std::string& destination,
                  const std::string& label) override {
-    Append(syntax_->Link(source, destination, label));
+    syntax_->AppendLink(source, destination, label, &buffer_);
+    MaybeFlush();
+  }
+
+  void WriteNodes(const std::vector<Node>& nodes) override {
+    FormatInParallel(nodes.size(), [this, &nodes](int i, std::string* output) {
+      const Node& node = nodes[i];
+      syntax_->AppendNode(node.name, node.label, node.shape, node.color,
+                          output);
+    });
+  }
+
+  void WriteLinks(const std::vector<Link>& links) override {
+    FormatInParallel(links.size(), [this, &links](int i, std::string* output) {
+      const Link& link = links[i];
+      syntax_->AppendLink(link.source, link.destination, link.label, output);
+    });
   }
 
   void WriteHeader(const std::string& name) override {
-    Append(syntax_->Header(name));
+    buffer_ += syntax_->Header(name);
   }
 
-  void WriteFooter() override { Append(syntax_->Footer()); }
+  void WriteFooter() override {
+    buffer_ += syntax_->Footer();
+    Flush();
+  }
 
  private:
-  void Append(const std::string& str) {
-    file::WriteString(file_, str, file::Defaults()).IgnoreError();
+  // The output is written by blocks of at least this size.
+  static const int kBlockSize = 4 << 20;
+
+  void MaybeFlush() {
+    if (buffer_.size() >= kBlockSize) Flush();
   }
 
-  File* const file_;
+  // Writes the buffered data. After an error, nothing more is written.
+  void Flush() {
+    if (ok_ && !buffer_.empty()) {
+      ok_ = output_->Write(buffer_);
+      LOG_IF(ERROR, !ok_) << "Error while writing the graph file.";
+    }
+    buffer_.clear();
+  }
+
+  // Calls format(i, output) for all i in [0, num_items), on up to
+  // num_threads() threads, and appends the outputs in the order of i.
+  void FormatInParallel(int num_items,
+                        const std::function<void(int, std::string*)>& format) {
+    // Number of consecutive items formatted by one thread at a time. The
+    // threads are started for each round, so a chunk must be large enough to
+    // amortize this.
+    const int kChunkSize = 10000;
+    const int num_chunks = (num_items + kChunkSize - 1) / kChunkSize;
+    const int num_workers = std::max(1, std::min(num_threads(), num_chunks));
+    if (num_workers == 1) {
+      for (int i = 0; i < num_items; ++i) {
+        format(i, &buffer_);
+        MaybeFlush();
+      }
+      return;
+    }
+    std::vector<std::string> outputs(num_workers);
+    const auto format_chunk = [num_items, &format, &outputs](int chunk,
+                                                             int begin) {
+      const int end = std::min(num_items, begin + kChunkSize);
+      for (int i = begin; i < end; ++i) {
+        format(i, &outputs[chunk]);
+      }
+    };
+    for (int round_begin = 0; round_begin < num_items;
+         round_begin += num_workers * kChunkSize) {
+      std::vector<std::thread> threads;
+      for (int chunk = 1; chunk < num_workers; ++chunk) {
+        const int begin = round_begin + chunk * kChunkSize;
+        if (begin >= num_items) break;
+        threads.push_back(std::thread(format_chunk, chunk, begin));
+      }
+      format_chunk(0, round_begin);
+      for (std::thread& thread : threads) {
+        thread.join();
+      }
+      for (std::string& output : outputs) {
+        buffer_ += output;
+        output.clear();
+      }
+      MaybeFlush();
+    }
+  }
+
+  std::unique_ptr<GraphOutput> output_;
   std::unique_ptr<GraphSyntax> syntax_;
+  std::string buffer_;
+  bool ok_;
 };
-}  // namespace
 
-GraphExporter* GraphExporter::MakeFileExporter(
-    File* const file, GraphExporter::GraphFormat format) {
+GraphSyntax* MakeSyntax(GraphExporter::GraphFormat format) {
   GraphSyntax* syntax = NULL;
   switch (format) {
     case GraphExporter::DOT_FORMAT: {
@@ -165,6 +296,28 @@ GraphExporter* GraphExporter::MakeFileExporter(
       LOG(FATAL) << "Unknown graph format";
   }
   CHECK(syntax != NULL);
-  return new FileGraphExporter(file, syntax);
+  return syntax;
+}
+}  // namespace
+
+GraphExporter* GraphExporter::MakeFileExporter(
+    File* const file, GraphExporter::GraphFormat format) {
+  return new FileGraphExporter(new FileGraphOutput(file, /*owned=*/false),
+                               MakeSyntax(format));
+}
+
+GraphExporter* GraphExporter::MakeFileExporter(
+    const std::string& filename, GraphExporter::GraphFormat format) {
+  GraphOutput* output = NULL;
+  if (HasSuffixString(filename, ".gz")) {
+    gzFile file = gzopen(filename.c_str(), "wb");
+    if (file == NULL) return NULL;
+    output = new GzipGraphOutput(file);
+  } else {
+    File* const file = File::Open(filename, "w");
+    if (file == NULL) return NULL;
+    output = new FileGraphOutput(file, /*owned=*/true);
+  }
+  return new FileGraphExporter(output, MakeSyntax(format));
 }
 }  // namespace operations_research
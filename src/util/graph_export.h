@@ -16,6 +16,7 @@
 #define OR_TOOLS_UTIL_GRAPH_EXPORT_H_
 
 #include <string>
+#include <vector>
 
 #include "base/logging.h"
 #include "base/macros.h"
@@ -34,6 +35,20 @@ class GraphExporter {
     GML_FORMAT,
   };
 
+  // A node or a link of the graph, see WriteNodes() and WriteLinks().
+  struct Node {
+    std::string name;
+    std::string label;
+    std::string shape;
+    std::string color;
+  };
+  struct Link {
+    std::string source;
+    std::string destination;
+    std::string label;
+  };
+
+  GraphExporter() : num_threads_(1) {}
   virtual ~GraphExporter();
 
   // Write the header of the graph file.
@@ -50,9 +65,32 @@ class GraphExporter {
   virtual void WriteLink(const std::string& source, const std::string& destination,
                          const std::string& label) = 0;
 
+  // Writes the given nodes (resp. links), in order. This is the same as
+  // calling WriteNode() (resp. WriteLink()) on each of them, but the file
+  // exporters format large batches on num_threads() threads.
+  virtual void WriteNodes(const std::vector<Node>& nodes);
+  virtual void WriteLinks(const std::vector<Link>& links);
+
+  // Number of threads used by WriteNodes() and WriteLinks(). The output does
+  // not depend on it. The default is 1.
+  int num_threads() const { return num_threads_; }
+  void set_num_threads(int num_threads) { num_threads_ = num_threads; }
+
   // Creates a graph exporter that will write to file with a given format.
+  // The output is buffered, and written to the file by blocks of a few MB,
+  // the last one when the footer is written or when the exporter is deleted.
+  // The file is not closed by the exporter.
   static GraphExporter* MakeFileExporter(File* const file,
                                          GraphExporter::GraphFormat format);
+
+  // Ditto, but opens the file with the given name, which is compressed with
+  // gzip if the name ends with ".gz". The file is closed when the exporter is
+  // deleted. Returns NULL if the file cannot be opened.
+  static GraphExporter* MakeFileExporter(const std::string& filename,
+                                         GraphExporter::GraphFormat format);
+
+ private:
+  int num_threads_;
 };
 }  // namespace operations_research
 
@@ -0,0 +1,213 @@
+// Copyright 2010-2014 Google
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// An adjustable priority queue of elements that are identified by a dense
+// integer index in [0, n). Compared to AdjustablePriorityQueue:
+// - The elements are stored by value in the heap, and they do not need to
+//   store their position: the positions are in a separate array indexed by
+//   the element indices. Contains() is thus O(1) without touching the
+//   elements.
+// - The heap is 4-ary: it is half as deep as a binary heap, and the 4
+//   children of a node are contiguous in memory, which makes the sift-down
+//   (the costly part of Pop()) much more cache-friendly.
+// - A set of elements can be added at once in O(n) with AddAll().
+//
+// The Element class must be copyable, cheap to copy, and provide an
+// "int Index() const" function returning its index in [0, n). The Top() is
+// the largest element according to Compare, like for std::priority_queue.
+
+#ifndef OR_TOOLS_UTIL_INTEGER_PQ_H_
+#define OR_TOOLS_UTIL_INTEGER_PQ_H_
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/macros.h"
+
+namespace operations_research {
+
+template <typename Element, class Compare = std::less<Element>>
+class IntegerPriorityQueue {
+ public:
+  // Starts with no element. The indices of the elements must be in [0, n).
+  explicit IntegerPriorityQueue(int n = 0, Compare compare = Compare())
+      : compare_(compare), positions_(n, -1) {}
+
+  // Changes the range of the indices to [0, n). Must be called when the queue
+  // is empty if n is smaller than the current range.
+  void Resize(int n) {
+    DCHECK(n >= positions_.size() || IsEmpty());
+    positions_.resize(n, -1);
+  }
+
+  int Size() const { return heap_.size(); }
+  bool IsEmpty() const { return heap_.empty(); }
+
+  // Removes all the elements, in O(number of elements).
+  void Clear() {
+    for (const Element& element : heap_) positions_[element.Index()] = -1;
+    heap_.clear();
+  }
+
+  // Returns true if an element with the given index is in the queue.
+  bool Contains(int index) const {
+    DCHECK_GE(index, 0);
+    DCHECK_LT(index, positions_.size());
+    return positions_[index] >= 0;
+  }
+
+  // Returns the element of the queue with the given index.
+  const Element& GetElement(int index) const {
+    DCHECK(Contains(index));
+    return heap_[positions_[index]];
+  }
+
+  // Adds an element whose index is not already in the queue.
+  void Add(Element element) {
+    DCHECK(!Contains(element.Index()));
+    heap_.push_back(element);
+    SiftUp(heap_.size() - 1);
+  }
+
+  // Adds all the elements, whose indices must not be in the queue, and
+  // rebuilds the heap bottom-up. This is O(size of the queue) instead of
+  // O(number of elements * log(size of the queue)) with Add().
+  void AddAll(const std::vector<Element>& elements) {
+    for (const Element& element : elements) {
+      DCHECK(!Contains(element.Index()));
+      positions_[element.Index()] = heap_.size();
+      heap_.push_back(element);
+    }
+    if (heap_.size() <= 1) return;
+    for (int i = Parent(heap_.size() - 1); i >= 0; --i) {
+      SiftDown(i);
+    }
+  }
+
+  const Element& Top() const {
+    DCHECK(!IsEmpty());
+    return heap_[0];
+  }
+
+  void Pop() {
+    DCHECK(!IsEmpty());
+    Remove(heap_[0].Index());
+  }
+
+  // Removes the element with the given index, which must be in the queue.
+  void Remove(int index) {
+    DCHECK(Contains(index));
+    const int position = positions_[index];
+    positions_[index] = -1;
+    const Element last = heap_.back();
+    heap_.pop_back();
+    if (position == heap_.size()) return;
+    heap_[position] = last;
+    SiftUpOrDown(position);
+  }
+
+  // Replaces the element with the same index as 'element', which must be in
+  // the queue, by 'element', whose priority may have changed.
+  void ChangePriority(Element element) {
+    DCHECK(Contains(element.Index()));
+    const int position = positions_[element.Index()];
+    heap_[position] = element;
+    SiftUpOrDown(position);
+  }
+
+  // Adds the element, or changes its priority if its index is in the queue.
+  void AddOrChangePriority(Element element) {
+    if (Contains(element.Index())) {
+      ChangePriority(element);
+    } else {
+      Add(element);
+    }
+  }
+
+  // The elements of the queue, in heap order. For debugging.
+  const std::vector<Element>& Raw() const { return heap_; }
+
+  void CheckValid() const {
+    for (int i = 1; i < heap_.size(); ++i) {
+      CHECK(!compare_(heap_[Parent(i)], heap_[i]));
+    }
+    for (int i = 0; i < heap_.size(); ++i) {
+      CHECK_EQ(i, positions_[heap_[i].Index()]);
+    }
+  }
+
+ private:
+  static const int kArity = 4;
+
+  static int Parent(int i) { return (i - 1) / kArity; }
+  static int FirstChild(int i) { return kArity * i + 1; }
+
+  void SiftUpOrDown(int i) {
+    if (i > 0 && compare_(heap_[Parent(i)], heap_[i])) {
+      SiftUp(i);
+    } else {
+      SiftDown(i);
+    }
+  }
+
+  // Moves the element at position i up to its place, and updates the
+  // positions of the elements it moves.
+  void SiftUp(int i) {
+    const Element element = heap_[i];
+    while (i > 0) {
+      const int parent = Parent(i);
+      if (!compare_(heap_[parent], element)) break;
+      heap_[i] = heap_[parent];
+      positions_[heap_[i].Index()] = i;
+      i = parent;
+    }
+    heap_[i] = element;
+    positions_[element.Index()] = i;
+  }
+
+  // Moves the element at position i down to its place, and updates the
+  // positions of the elements it moves.
+  void SiftDown(int i) {
+    const Element element = heap_[i];
+    const int size = heap_.size();
+    while (true) {
+      const int first_child = FirstChild(i);
+      if (first_child >= size) break;
+      const int end = std::min(first_child + kArity, size);
+      int best_child = first_child;
+      for (int child = first_child + 1; child < end; ++child) {
+        if (compare_(heap_[best_child], heap_[child])) best_child = child;
+      }
+      if (!compare_(element, heap_[best_child])) break;
+      heap_[i] = heap_[best_child];
+      positions_[heap_[i].Index()] = i;
+      i = best_child;
+    }
+    heap_[i] = element;
+    positions_[element.Index()] = i;
+  }
+
+  Compare compare_;
+  std::vector<Element> heap_;
+  // positions_[index] is the position in heap_ of the element with this
+  // index, or -1 if it is not in the queue.
+  std::vector<int> positions_;
+
+  DISALLOW_COPY_AND_ASSIGN(IntegerPriorityQueue);
+};
+
+}  // namespace operations_research
+
+#endif  // OR_TOOLS_UTIL_INTEGER_PQ_H_
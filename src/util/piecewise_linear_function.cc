@@ -430,15 +430,47 @@ bool PiecewiseLinearFunction::IsConvex() const {
 }
 
 int64 PiecewiseLinearFunction::Value(int64 x) const {
-  if (!InDomain(x)) {
+  const int index = FindSegmentIndex(segments_, x);
+  if (index == kNotFound || segments_[index].end_x() < x) {
     // TODO(user): Allow the user to specify the
     // undefined value and use kint64max as the default.
     return kint64max;
   }
-  const int index = FindSegmentIndex(segments_, x);
   return segments_[index].Value(x);
 }
 
+void PiecewiseLinearFunction::Values(const int64* xs, int64* values,
+                                     int num_values) const {
+  // Number of segments tried after the one of the previous x before falling
+  // back to the binary search.
+  const int kMaxLinearSteps = 4;
+  const int num_segments = segments_.size();
+  int index = kNotFound;
+  for (int i = 0; i < num_values; ++i) {
+    const int64 x = xs[i];
+    // Checks whether x is still in the segment 'index' (or just after it, in
+    // the hole before the next one), else moves forward a few segments.
+    bool found = false;
+    if (index != kNotFound && segments_[index].start_x() <= x) {
+      for (int step = 0; step <= kMaxLinearSteps; ++step) {
+        if (index + 1 == num_segments || segments_[index + 1].start_x() > x) {
+          found = true;
+          break;
+        }
+        ++index;
+      }
+    }
+    if (!found) {
+      index = FindSegmentIndex(segments_, x);
+    }
+    if (index == kNotFound || segments_[index].end_x() < x) {
+      values[i] = kint64max;
+    } else {
+      values[i] = segments_[index].Value(x);
+    }
+  }
+}
+
 int64 PiecewiseLinearFunction::GetMaximum(int64 range_start,
                                           int64 range_end) const {
   const int start_segment = FindSegmentIndex(segments_, range_start);
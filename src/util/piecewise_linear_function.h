@@ -186,6 +186,11 @@ class PiecewiseLinearFunction {
   bool IsConvex() const;
   // Returns the value of the piecewise linear function for x.
   int64 Value(int64 x) const;
+  // Sets values[i] to Value(xs[i]) for all i in [0, num_values). This is
+  // faster than calling Value() on each x when the xs are sorted or close to
+  // each other: the segment of the previous x is tried first, then its
+  // successors, before searching the segment of x among all the segments.
+  void Values(const int64* xs, int64* values, int num_values) const;
   // Returns the maximum value of all the segments in the function.
   int64 GetMaximum() const;
   // Returns the minimum value of all the segments in the function.
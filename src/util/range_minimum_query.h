@@ -29,6 +29,12 @@
 // i + 2^k < j and note that
 // std::min(std::min(arr, i, i+2^k), std::min(arr, j-2^k, j)) = std::min(arr, i, j).
 
+//
+// These structures are immutable. DynamicRangeQuery below answers the same
+// queries, and more generally queries for any associative and commutative
+// operation (min, max, sum), in O(log(n)), but the array can be modified in
+// O(log(n)) per element.
+
 #ifndef OR_TOOLS_UTIL_RANGE_MINIMUM_QUERY_H_
 #define OR_TOOLS_UTIL_RANGE_MINIMUM_QUERY_H_
 
@@ -88,6 +94,54 @@ class RangeMinimumIndexQuery {
   DISALLOW_COPY_AND_ASSIGN(RangeMinimumIndexQuery);
 };
 
+// Range queries on an array that can be modified. This is a segment tree
+// stored bottom-up in a single array of 2n elements: the leaves
+// tree_[n, 2n) are the array, and tree_[i] = combine(tree_[2i], tree_[2i+1]).
+// There are no pointers and the siblings are contiguous, and the updates and
+// the queries walk from the leaves to the root without recursion.
+// Combine must be associative and commutative, e.g. DynamicRangeMinimum,
+// DynamicRangeMaximum or std::plus<T>.
+template <typename T, typename Combine>
+class DynamicRangeQuery {
+ public:
+  explicit DynamicRangeQuery(const std::vector<T>& array,
+                             Combine combine = Combine());
+
+  int size() const { return size_; }
+
+  const T& Get(int index) const {
+    DCHECK_LE(0, index);
+    DCHECK_LT(index, size_);
+    return tree_[size_ + index];
+  }
+
+  // Sets array[index] to value, in O(log(n)).
+  void Set(int index, T value);
+
+  // Sets array[from + i] to values[i] for all i, in
+  // O(values.size() + log(n)) instead of O(values.size() * log(n)).
+  void SetRange(int from, const std::vector<T>& values);
+
+  // Returns the combination of the array[x] for x in [from, to), which must
+  // not be empty.
+  T GetFromRange(int from, int to) const;
+
+ private:
+  const int size_;
+  Combine combine_;
+  std::vector<T> tree_;
+};
+
+template <typename T>
+struct DynamicRangeMinimum {
+  T operator()(const T& a, const T& b) const { return std::min(a, b); }
+};
+
+template <typename T>
+struct DynamicRangeMaximum {
+  T operator()(const T& a, const T& b) const { return std::max(a, b); }
+};
+
 // RangeMinimumQuery implementation
 template <typename T, typename Compare>
 inline RangeMinimumQuery<T, Compare>::RangeMinimumQuery(std::vector<T> array)
@@ -167,5 +221,73 @@ template <typename T, typename Compare>
 inline const std::vector<T>& RangeMinimumIndexQuery<T, Compare>::array() const {
   return cmp_.array;
 }
+
+// DynamicRangeQuery implementation
+template <typename T, typename Combine>
+DynamicRangeQuery<T, Combine>::DynamicRangeQuery(const std::vector<T>& array,
+                                                 Combine combine)
+    : size_(array.size()), combine_(std::move(combine)), tree_(2 * size_) {
+  std::copy(array.begin(), array.end(), tree_.begin() + size_);
+  for (int i = size_ - 1; i > 0; --i) {
+    tree_[i] = combine_(tree_[2 * i], tree_[2 * i + 1]);
+  }
+}
+
+template <typename T, typename Combine>
+void DynamicRangeQuery<T, Combine>::Set(int index, T value) {
+  DCHECK_LE(0, index);
+  DCHECK_LT(index, size_);
+  int i = size_ + index;
+  tree_[i] = std::move(value);
+  for (i /= 2; i > 0; i /= 2) {
+    tree_[i] = combine_(tree_[2 * i], tree_[2 * i + 1]);
+  }
+}
+
+template <typename T, typename Combine>
+void DynamicRangeQuery<T, Combine>::SetRange(int from,
+                                             const std::vector<T>& values) {
+  if (values.empty()) return;
+  DCHECK_LE(0, from);
+  DCHECK_LE(from + values.size(), size_);
+  std::copy(values.begin(), values.end(), tree_.begin() + size_ + from);
+  // Recomputes the ancestors of the modified leaves, level by level.
+  int first = (size_ + from) / 2;
+  int last = (size_ + from + values.size() - 1) / 2;
+  while (last > 0) {
+    for (int i = std::max(first, 1); i <= last; ++i) {
+      tree_[i] = combine_(tree_[2 * i], tree_[2 * i + 1]);
+    }
+    first /= 2;
+    last /= 2;
+  }
+}
+
+template <typename T, typename Combine>
+T DynamicRangeQuery<T, Combine>::GetFromRange(int from, int to) const {
+  DCHECK_LE(0, from);
+  DCHECK_LT(from, to);
+  DCHECK_LE(to, size_);
+  int left = from + size_;
+  int right = to + size_;
+  // Combines the nodes that cover exactly [from, to), from the leaves up.
+  bool has_result = false;
+  T result = tree_[left];
+  while (left < right) {
+    if (left & 1) {
+      result = has_result ? combine_(result, tree_[left]) : tree_[left];
+      has_result = true;
+      ++left;
+    }
+    if (right & 1) {
+      --right;
+      result = has_result ? combine_(result, tree_[right]) : tree_[right];
+      has_result = true;
+    }
+    left /= 2;
+    right /= 2;
+  }
+  return result;
+}
 }  // namespace operations_research
 #endif  // OR_TOOLS_UTIL_RANGE_MINIMUM_QUERY_H_
@@ -14,6 +14,7 @@
 
 #include "util/stats.h"
 
+#include <algorithm>
 #include <cmath>
 #include "base/stringprintf.h"
 #include "base/sysinfo.h"
@@ -61,38 +62,89 @@ StatsGroup::~StatsGroup() { STLDeleteValues(&time_distributions_); }
 
 void StatsGroup::Register(Stat* stat) { stats_.push_back(stat); }
 
+void StatsGroup::RegisterSubGroup(StatsGroup* group) {
+  sub_groups_.push_back(group);
+}
+
 void StatsGroup::Reset() {
   for (int i = 0; i < stats_.size(); ++i) {
     stats_[i]->Reset();
   }
+  for (int i = 0; i < sub_groups_.size(); ++i) {
+    sub_groups_[i]->Reset();
+  }
 }
 
 namespace {
 bool CompareStatPointerByName(Stat* s1, Stat* s2) {
   return s1->Name() < s2->Name();
 }
+
+// Returns 'text' as a JSON string, with the quotes.
+std::string JsonQuote(const std::string& text) {
+  std::string result("\"");
+  for (const char c : text) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      result += StringPrintf("\\u%04x", c);
+    } else {
+      result += c;
+    }
+  }
+  result += '"';
+  return result;
+}
+
+// Returns 'value' as a JSON number. JSON has no infinity nor NaN.
+std::string JsonDouble(double value) {
+  if (!std::isfinite(value)) return "null";
+  return StringPrintf("%.17g", value);
+}
+
+// Indents all the lines of 'text' by two spaces.
+std::string Indent(const std::string& text) {
+  std::string result;
+  bool line_start = true;
+  for (const char c : text) {
+    if (line_start) result += "  ";
+    result += c;
+    line_start = c == '\n';
+  }
+  return result;
+}
 }  // namespace
 
+std::vector<Stat*> StatsGroup::SortedStatsToPrint() const {
+  std::vector<Stat*> sorted_stats;
+  for (int i = 0; i < stats_.size(); ++i) {
+    if (stats_[i]->WorthPrinting()) sorted_stats.push_back(stats_[i]);
+  }
+  std::sort(sorted_stats.begin(), sorted_stats.end(), CompareStatPointerByName);
+  return sorted_stats;
+}
+
 std::string StatsGroup::StatString() const {
   // Computes the longest name of all the stats we want to display.
-  // Also create a temporary vector so we can sort the stats by names.
+  const std::vector<Stat*> sorted_stats = SortedStatsToPrint();
   int longest_name_size = 0;
-  std::vector<Stat*> sorted_stats;
-  for (int i = 0; i < stats_.size(); ++i) {
-    if (!stats_[i]->WorthPrinting()) continue;
+  for (int i = 0; i < sorted_stats.size(); ++i) {
     // We support UTF8 characters in the stat names.
 #ifdef ANDROID_JNI
-    const int size = stats_[i]->Name().length();
+    const int size = sorted_stats[i]->Name().length();
 #else
-    const int size = EncodingUtils::UTF8StrLen(stats_[i]->Name());
+    const int size = EncodingUtils::UTF8StrLen(sorted_stats[i]->Name());
 #endif
     longest_name_size = std::max(longest_name_size, size);
-    sorted_stats.push_back(stats_[i]);
   }
-  std::sort(sorted_stats.begin(), sorted_stats.end(), CompareStatPointerByName);
+  std::string sub_groups;
+  for (int i = 0; i < sub_groups_.size(); ++i) {
+    sub_groups += Indent(sub_groups_[i]->StatString());
+  }
 
   // Do not display groups without print-worthy stats.
-  if (sorted_stats.empty()) return "";
+  if (sorted_stats.empty() && sub_groups.empty()) return "";
 
   // Pretty-print all the stats.
   std::string result(name_ + " {\n");
@@ -108,10 +160,28 @@ std::string StatsGroup::StatString() const {
         ' ');
     result += " : " + sorted_stats[i]->ValueAsString();
   }
+  result += sub_groups;
   result += "}\n";
   return result;
 }
 
+std::string StatsGroup::JsonString() const {
+  const std::vector<Stat*> sorted_stats = SortedStatsToPrint();
+  std::string result("{\"name\": " + JsonQuote(name_) + ", \"stats\": {");
+  for (int i = 0; i < sorted_stats.size(); ++i) {
+    if (i > 0) result += ", ";
+    result += JsonQuote(sorted_stats[i]->Name()) + ": " +
+              sorted_stats[i]->ValueAsJson();
+  }
+  result += "}, \"groups\": [";
+  for (int i = 0; i < sub_groups_.size(); ++i) {
+    if (i > 0) result += ", ";
+    result += sub_groups_[i]->JsonString();
+  }
+  result += "]}";
+  return result;
+}
+
 TimeDistribution* StatsGroup::LookupOrCreateTimeDistribution(std::string name) {
   TimeDistribution*& ref = time_distributions_[name];
   if (ref == NULL) {
@@ -166,6 +236,38 @@ void DistributionStat::AddToDistribution(double value) {
   sum_squares_from_average_ += delta * (value - average_);
 }
 
+void DistributionStat::MergeFrom(const DistributionStat& other) {
+  if (other.num_ == 0) return;
+  if (num_ == 0) {
+    sum_ = other.sum_;
+    average_ = other.average_;
+    sum_squares_from_average_ = other.sum_squares_from_average_;
+    min_ = other.min_;
+    max_ = other.max_;
+    num_ = other.num_;
+    return;
+  }
+  // Parallel variant of the algorithm of Welford, by Chan et al.
+  const double delta = other.average_ - average_;
+  const int64 num = num_ + other.num_;
+  sum_squares_from_average_ += other.sum_squares_from_average_ +
+                               delta * delta * num_ * other.num_ / num;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  sum_ += other.sum_;
+  num_ = num;
+  average_ = sum_ / num_;
+}
+
+std::string DistributionStat::ValueAsJson() const {
+  return StringPrintf(
+      "{\"num\": %lld, \"min\": %s, \"max\": %s, \"average\": %s, "
+      "\"std_deviation\": %s, \"sum\": %s}",
+      num_, JsonDouble(min_).c_str(), JsonDouble(max_).c_str(),
+      JsonDouble(Average()).c_str(), JsonDouble(StdDeviation()).c_str(),
+      JsonDouble(sum_).c_str());
+}
+
 double DistributionStat::Average() const { return average_; }
 
 double DistributionStat::StdDeviation() const {
@@ -210,6 +312,17 @@ std::string TimeDistribution::ValueAsString() const {
       PrintCyclesAsTime(sum_).c_str());
 }
 
+std::string TimeDistribution::ValueAsJson() const {
+  return StringPrintf(
+      "{\"num\": %lld, \"min\": %s, \"max\": %s, \"average\": %s, "
+      "\"std_deviation\": %s, \"sum\": %s}",
+      num_, JsonDouble(CyclesToSeconds(min_)).c_str(),
+      JsonDouble(CyclesToSeconds(max_)).c_str(),
+      JsonDouble(CyclesToSeconds(Average())).c_str(),
+      JsonDouble(CyclesToSeconds(StdDeviation())).c_str(),
+      JsonDouble(CyclesToSeconds(sum_)).c_str());
+}
+
 void RatioDistribution::Add(double value) {
   DCHECK_GE(value, 0.0);
   AddToDistribution(value);
@@ -237,4 +350,41 @@ std::string IntegerDistribution::ValueAsString() const {
                       max_, Average(), StdDeviation(), sum_);
 }
 
+ShardedCounter::ShardedCounter(const std::string& name) : Stat(name) { Reset(); }
+
+ShardedCounter::ShardedCounter(const std::string& name, StatsGroup* group)
+    : Stat(name, group) {
+  Reset();
+}
+
+void ShardedCounter::Reset() {
+  for (int i = 0; i < kNumShards; ++i) {
+    shards_[i].value.store(0, std::memory_order_relaxed);
+  }
+}
+
+int64 ShardedCounter::Value() const {
+  int64 value = 0;
+  for (int i = 0; i < kNumShards; ++i) {
+    value += shards_[i].value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
+
+int ShardedCounter::ShardOfCurrentThread() {
+  // The threads get consecutive shards in the order of their first update.
+  static std::atomic<int> num_threads(0);
+  static thread_local const int shard =
+      num_threads.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+  return shard;
+}
+
+std::string ShardedCounter::ValueAsString() const {
+  return StringPrintf("%8lld\n", Value());
+}
+
+std::string ShardedCounter::ValueAsJson() const {
+  return StringPrintf("%lld", Value());
+}
+
 }  // namespace operations_research
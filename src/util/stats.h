@@ -60,16 +60,27 @@
 // This automatically adds a TimeDistribution with name "Solve" to stats_ and
 // times your function calls!
 //
+// Groups can be nested with StatsGroup::RegisterSubGroup(): the StatString()
+// and JsonString() of a group contain the ones of its sub-groups, so that a
+// solver can print, or export in JSON, the stats of all its components at
+// once.
+//
+// The stats are not thread-safe, except ShardedCounter which can be updated
+// by several threads at once. A stat updated by several threads can also be
+// a DistributionStat per thread, merged with MergeFrom() when displayed.
+//
 // IMPORTANT: The SCOPED_TIME_STAT() macro only does something if OR_STATS is
-// The idea is that by default the instrumentation is off. You can also use the
+// defined. The idea is that by default the instrumentation is off. You can also use the
 // macro IF_STATS_ENABLED() that does nothing if OR_STATS is not defined or just
 // translates to its argument otherwise.
 
 #ifndef OR_TOOLS_UTIL_STATS_H_
 #define OR_TOOLS_UTIL_STATS_H_
 
+#include <atomic>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "base/timer.h"
 
@@ -100,6 +111,9 @@ class Stat {
   // Prints information about this statistic.
   virtual std::string ValueAsString() const = 0;
 
+  // Returns the value of this statistic as a JSON value.
+  virtual std::string ValueAsJson() const = 0;
+
   // Is this stat worth printing? usually false if nothing was measured.
   virtual bool WorthPrinting() const = 0;
 
@@ -121,22 +135,37 @@ class StatsGroup {
   // The Stat object must live as long as this StatsGroup.
   void Register(Stat* stat);
 
+  // Registers a sub-group, whose stats will appear nested in the ones of this
+  // group. The sub-group must live as long as this StatsGroup.
+  void RegisterSubGroup(StatsGroup* group);
+
   // Returns this group name, followed by one line per Stat registered with this
-  // group (this includes the ones created by LookupOrCreateTimeDistribution()).
+  // group (this includes the ones created by LookupOrCreateTimeDistribution()),
+  // and by the StatString() of the sub-groups, indented.
   // Note that only the stats WorthPrinting() are printed.
   std::string StatString() const;
 
+  // Same as StatString() in JSON, for the tools that process the stats:
+  // {"name": ..., "stats": {stat name: stat value, ...}, "groups": [...]}.
+  // The times are in seconds.
+  std::string JsonString() const;
+
   // Returns and if needed creates and registers a TimeDistribution with the
   // given name. Note that this involve a map lookup and his thus slower than
   // directly accessing a TimeDistribution variable.
   TimeDistribution* LookupOrCreateTimeDistribution(std::string name);
 
-  // Calls Reset() on all the statistics registered with this group.
+  // Calls Reset() on all the statistics registered with this group and with
+  // its sub-groups.
   void Reset();
 
  private:
+  // Returns the stats WorthPrinting(), sorted by name.
+  std::vector<Stat*> SortedStatsToPrint() const;
+
   std::string name_;
   std::vector<Stat*> stats_;
+  std::vector<StatsGroup*> sub_groups_;
   std::map<std::string, TimeDistribution*> time_distributions_;
 
   DISALLOW_COPY_AND_ASSIGN(StatsGroup);
@@ -156,6 +185,14 @@ class DistributionStat : public Stat {
   // Implemented by the subclasses.
   std::string ValueAsString() const override = 0;
 
+  // {"num": ..., "min": ..., "max": ..., "average": ..., "std_deviation": ...,
+  // "sum": ...}.
+  std::string ValueAsJson() const override;
+
+  // Adds all the values of 'other' to this distribution, as if they had been
+  // added one by one (up to the rounding errors).
+  void MergeFrom(const DistributionStat& other);
+
   // Trivial statistics on all the values added so far.
   double Sum() const { return sum_; }
   double Max() const { return max_; }
@@ -197,6 +234,7 @@ class TimeDistribution : public DistributionStat {
   TimeDistribution(const std::string& name, StatsGroup* group)
       : DistributionStat(name, group), timer_() {}
   std::string ValueAsString() const override;
+  std::string ValueAsJson() const override;
 
   // Internaly the TimeDistribution stores cpu cycles (to do a bit less work
   // on each StopTimerAndAddElapsedTime()). Use this function to convert
@@ -261,6 +299,40 @@ class IntegerDistribution : public DistributionStat {
   void Add(int64 value);
 };
 
+// Statistic on a sum of integers that several threads can update at once.
+// Each thread adds to its own shard, on its own cache line, so the threads do
+// not contend on the same counter; the shards are summed when the value is
+// read.
+class ShardedCounter : public Stat {
+ public:
+  explicit ShardedCounter(const std::string& name);
+  ShardedCounter(const std::string& name, StatsGroup* group);
+  std::string ValueAsString() const override;
+  std::string ValueAsJson() const override;
+  bool WorthPrinting() const override { return Value() != 0; }
+
+  // Not thread-safe with respect to Add().
+  void Reset() override;
+
+  void Add(int64 value) {
+    shards_[ShardOfCurrentThread()].value.fetch_add(value,
+                                                    std::memory_order_relaxed);
+  }
+
+  int64 Value() const;
+
+ private:
+  static const int kNumShards = 32;
+  struct Shard {
+    std::atomic<int64> value;
+    char padding[64 - sizeof(std::atomic<int64>)];
+  };
+
+  static int ShardOfCurrentThread();
+
+  Shard shards_[kNumShards];
+};
+
 #ifdef OR_STATS
 
 // Helper class to time a block of code and add the result to a
@@ -23,6 +23,19 @@ namespace operations_research {
 // static constants.
 const double TimeLimit::kSafetyBufferSeconds = 1e-4;
 const int TimeLimit::kHistorySize = 100;
+const double ParallelTimeLimit::kDeterministicTimeSynchronizationPeriod = 1e-2;
+
+TimeLimit::~TimeLimit() {
+  if (accounts_parallel_deterministic_time_) SynchronizeDeterministicTime();
+}
+
+void TimeLimit::SynchronizeDeterministicTime() {
+  DCHECK(accounts_parallel_deterministic_time_);
+  const double total = parallel_time_limit_->AddDeterministicTime(
+      elapsed_deterministic_time_ - synchronized_deterministic_time_);
+  synchronized_deterministic_time_ = elapsed_deterministic_time_;
+  other_workers_deterministic_time_ = total - elapsed_deterministic_time_;
+}
 
 std::string TimeLimit::DebugString() const {
   std::string buffer =
@@ -50,6 +63,7 @@ NestedTimeLimit::NestedTimeLimit(TimeLimit* base_time_limit,
     time_limit_.RegisterExternalBooleanAsLimit(
         base_time_limit_->external_boolean_as_limit_);
   }
+  time_limit_.parallel_time_limit_ = base_time_limit_->parallel_time_limit_;
 }
 
 NestedTimeLimit::~NestedTimeLimit() {
@@ -57,4 +71,30 @@ NestedTimeLimit::~NestedTimeLimit() {
       time_limit_.GetElapsedDeterministicTime());
 }
 
+ParallelTimeLimit::ParallelTimeLimit(double limit_in_seconds,
+                                     double deterministic_limit)
+    : start_ns_(base::GetCurrentTimeNanos()),
+      limit_in_seconds_(limit_in_seconds),
+      deterministic_limit_(deterministic_limit),
+      elapsed_deterministic_time_(0.0),
+      cancelled_(false) {}
+
+std::unique_ptr<TimeLimit> ParallelTimeLimit::NewWorkerTimeLimit() {
+  const double elapsed_time = 1e-9 * (base::GetCurrentTimeNanos() - start_ns_);
+  std::unique_ptr<TimeLimit> time_limit(new TimeLimit(
+      std::max(0.0, limit_in_seconds_ - elapsed_time), deterministic_limit_));
+  time_limit->parallel_time_limit_ = this;
+  time_limit->accounts_parallel_deterministic_time_ = true;
+  time_limit->other_workers_deterministic_time_ =
+      GetElapsedDeterministicTime();
+  return time_limit;
+}
+
+double ParallelTimeLimit::AddDeterministicTime(double deterministic_duration) {
+  double total = elapsed_deterministic_time_.load(std::memory_order_relaxed);
+  while (!elapsed_deterministic_time_.compare_exchange_weak(
+      total, total + deterministic_duration, std::memory_order_relaxed)) {
+  }
+  return total + deterministic_duration;
+}
 }  // namespace operations_research
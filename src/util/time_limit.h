@@ -15,6 +15,7 @@
 #define OR_TOOLS_UTIL_TIME_LIMIT_H_
 
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <limits>
 #include <memory>
@@ -26,6 +27,7 @@
 #include "base/commandlineflags.h"
 #include "base/logging.h"
 #include "base/macros.h"
+#include "base/memory_accounting.h"
 #include "base/port.h"
 #include "base/timer.h"
 #include "base/time_support.h"
@@ -36,6 +38,7 @@
 DECLARE_bool(time_limit_use_usertime);
 
 namespace operations_research {
+class ParallelTimeLimit;
 
 // A simple class to enforce both an elapsed time limit and a deterministic time
 // limit in the same thread as a program.
@@ -99,6 +102,9 @@ class TimeLimit {
       double limit_in_seconds,
       double deterministic_limit = std::numeric_limits<double>::infinity());
 
+  // Accounts the deterministic time of a worker of a ParallelTimeLimit.
+  ~TimeLimit();
+
   // Creates a time limit object that uses infinite time for both wall time and
   // deterministic time.
   static std::unique_ptr<TimeLimit> Infinite() {
@@ -125,7 +131,8 @@ class TimeLimit {
         parameters.max_time_in_seconds(), parameters.max_deterministic_time()));
   }
 
-  // Returns true when the external limit is true, or the deterministic time is
+  // Returns true when the external limit is true, or the memory budget of
+  // base/memory_accounting.h is exceeded, or the deterministic time is
   // over the deterministic limit or if the next time LimitReached() is called
   // is likely to be over the time limit. See toplevel comment.
   // Once it has returned true, it is guaranteed to always return true.
@@ -148,8 +155,11 @@ class TimeLimit {
   // true due to the deterministic limit.
   // If the TimeLimit was constructed with "infinity" as the deterministic
   // limit (default value), this will always return infinity.
+  // For the time limit of a worker of a ParallelTimeLimit, this accounts the
+  // deterministic time of all the workers, as of the last synchronization.
   double GetDeterministicTimeLeft() const {
-    return std::max(0.0, deterministic_limit_ - elapsed_deterministic_time_);
+    return std::max(0.0, deterministic_limit_ - elapsed_deterministic_time_ -
+                             other_workers_deterministic_time_);
   }
 
   // Advances the deterministic time. For reproducibility reasons, the
@@ -182,7 +192,9 @@ return 1e-9 * (base::GetCurrentTimeNanos() - start_ns_);
 
   // Returns the elapsed deterministic time since the construction of this
   // object. That corresponds to the sum of all deterministic durations passed
-  // as an argument to AdvanceDeterministicTime() calls.
+  // as an argument to AdvanceDeterministicTime() calls. For the time limit of
+  // a worker of a ParallelTimeLimit, only the deterministic time of this
+  // worker is counted.
   double GetElapsedDeterministicTime() const {
     return elapsed_deterministic_time_;
   }
@@ -205,6 +217,10 @@ return 1e-9 * (base::GetCurrentTimeNanos() - start_ns_);
   std::string DebugString() const;
 
  private:
+  // Adds the deterministic time of this worker not yet accounted in
+  // parallel_time_limit_, and fetches the one of the other workers.
+  void SynchronizeDeterministicTime();
+
   const int64 start_ns_;
   int64 last_ns_;
   int64 limit_ns_;  // Not const! See the code of LimitReached().
@@ -222,6 +238,15 @@ return 1e-9 * (base::GetCurrentTimeNanos() - start_ns_);
 
   const bool* external_boolean_as_limit_;
 
+  // Set for the time limits of the workers of a ParallelTimeLimit, and for
+  // the time limits nested in them. Only the time limits of the workers
+  // account their deterministic time in it, the nested ones account theirs
+  // in their base time limit.
+  ParallelTimeLimit* parallel_time_limit_;
+  bool accounts_parallel_deterministic_time_;
+  double synchronized_deterministic_time_;
+  double other_workers_deterministic_time_;
+
 #ifndef NDEBUG
   // Contains the values of the deterministic time counters.
   std::unordered_map<std::string, double> deterministic_counters_;
@@ -294,6 +319,82 @@ class NestedTimeLimit {
   DISALLOW_COPY_AND_ASSIGN(NestedTimeLimit);
 };
 
+// Enforces a wall time limit and a deterministic time limit shared by
+// several threads. Each thread works with its own TimeLimit object, returned
+// by NewWorkerTimeLimit(), and uses it exactly like a regular time limit:
+//   - the wall time limit is the same for all the workers,
+//   - the deterministic time advanced by all the workers is summed up, and
+//     compared to the deterministic limit,
+//   - Cancel() makes LimitReached() return true in all the workers.
+//
+// To keep LimitReached() cheap, a worker accumulates its deterministic time
+// locally, and adds it to the shared total only every
+// kDeterministicTimeSynchronizationPeriod of deterministic time (and when it
+// is destroyed). The workers may thus exceed the deterministic limit by up
+// to this period each. The total is stored in an atomic, so that no mutex is
+// needed, and cancellation is a single atomic load.
+//
+// Example usage:
+// ParallelTimeLimit time_limit(limit_in_seconds, deterministic_limit);
+// // In each worker thread:
+// std::unique_ptr<TimeLimit> worker_time_limit =
+//     time_limit.NewWorkerTimeLimit();
+// while (!worker_time_limit->LimitReached()) { ... }
+// // When a worker finds the answer:
+// time_limit.Cancel();
+class ParallelTimeLimit {
+ public:
+  static const double kDeterministicTimeSynchronizationPeriod;
+
+  // Sets both the elapsed and the deterministic time limits, like TimeLimit.
+  // The elapsed time counter starts 'now'.
+  explicit ParallelTimeLimit(
+      double limit_in_seconds,
+      double deterministic_limit = std::numeric_limits<double>::infinity());
+
+  // Creates a parallel time limit object initialized from an object that
+  // provides methods max_time_in_seconds() and max_deterministic_time(), see
+  // TimeLimit::FromParameters().
+  template <typename Parameters>
+  static std::unique_ptr<ParallelTimeLimit> FromParameters(
+      const Parameters& parameters) {
+    return std::unique_ptr<ParallelTimeLimit>(
+        new ParallelTimeLimit(parameters.max_time_in_seconds(),
+                              parameters.max_deterministic_time()));
+  }
+
+  // Returns the time limit of a new worker. The parallel time limit must
+  // outlive the returned object, which must be used by one thread at a time.
+  std::unique_ptr<TimeLimit> NewWorkerTimeLimit();
+
+  // Makes LimitReached() return true in all the workers. Thread-safe.
+  void Cancel() { cancelled_.store(true, std::memory_order_release); }
+
+  bool IsCancelled() const {
+    return cancelled_.load(std::memory_order_acquire);
+  }
+
+  // Returns the deterministic time advanced by all the workers, as of their
+  // last synchronization. Thread-safe.
+  double GetElapsedDeterministicTime() const {
+    return elapsed_deterministic_time_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  friend class TimeLimit;
+
+  // Adds 'deterministic_duration' to the total deterministic time, and
+  // returns the new total.
+  double AddDeterministicTime(double deterministic_duration);
+
+  const int64 start_ns_;
+  const double limit_in_seconds_;
+  const double deterministic_limit_;
+  std::atomic<double> elapsed_deterministic_time_;
+  std::atomic<bool> cancelled_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelTimeLimit);
+};
 
 // ################## Implementations below #####################
 
@@ -307,7 +408,11 @@ inline TimeLimit::TimeLimit(double limit_in_seconds, double deterministic_limit)
       running_max_(kHistorySize),
       deterministic_limit_(deterministic_limit),
       elapsed_deterministic_time_(0.0),
-      external_boolean_as_limit_(nullptr) {
+      external_boolean_as_limit_(nullptr),
+      parallel_time_limit_(nullptr),
+      accounts_parallel_deterministic_time_(false),
+      synchronized_deterministic_time_(0.0),
+      other_workers_deterministic_time_(0.0) {
 #ifndef ANDROID_JNI
   if (FLAGS_time_limit_use_usertime) {
     user_timer_.Start();
@@ -321,6 +426,21 @@ inline bool TimeLimit::LimitReached() {
     return true;
   }
 
+  if (IsMemoryBudgetExceeded()) {
+    // To ensure that future calls to LimitReached() will return true.
+    limit_ns_ = 0;
+    return true;
+  }
+
+  if (parallel_time_limit_ != nullptr) {
+    if (parallel_time_limit_->IsCancelled()) return true;
+    if (accounts_parallel_deterministic_time_ &&
+        elapsed_deterministic_time_ - synchronized_deterministic_time_ >=
+            ParallelTimeLimit::kDeterministicTimeSynchronizationPeriod) {
+      SynchronizeDeterministicTime();
+    }
+  }
+
   if (GetDeterministicTimeLeft() <= 0.0) {
     return true;
   }
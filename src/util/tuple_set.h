@@ -28,14 +28,23 @@
 // Therefore, you don't need to use const IntTupleSet& in methods. Just do:
 // void MyMethod(IntTupleSet tuple_set) { ... }
 //
-// This class is thread hostile as the copy and reference counter are
-// not protected by a mutex.
+// The reference counter is atomic, so the data can be shared by copies of an
+// IntTupleSet used by different threads (for instance by the table
+// constraints of several solvers): as long as none of them is modified, the
+// tuples are stored only once. A given IntTupleSet object is thread-compatible:
+// it can be read concurrently, but not modified concurrently.
+//
+// The tuples are stored row by row. A column by column copy of the tuples is
+// built on the first call to Column(), for the scans over a given position of
+// all the tuples; it is shared like the rest of the data.
 
 #ifndef OR_TOOLS_UTIL_TUPLE_SET_H_
 #define OR_TOOLS_UTIL_TUPLE_SET_H_
 
 #include <algorithm>
-#include "base/hash.h"
+#include <atomic>
+#include <memory>
+#include <mutex>  // NOLINT
 #include "base/hash.h"
 #include <vector>
 
@@ -68,7 +77,7 @@ class IntTupleSet {
   int Insert2(int64 v0, int64 v1);
   int Insert3(int64 v0, int64 v1, int64 v2);
   int Insert4(int64 v0, int64 v1, int64 v2, int64 v3);
-  // Inserts the tuples.
+  // Inserts the tuples. The storage is reserved once for all of them.
   void InsertAll(const std::vector<std::vector<int64> >& tuples);
   void InsertAll(const std::vector<std::vector<int> >& tuples);
 
@@ -86,6 +95,9 @@ class IntTupleSet {
   int Arity() const;
   // Access the raw data, see IntTupleSet::Data::flat_tuples_.
   const int64* RawData() const;
+  // Returns the values at position 'col' of all the tuples, in the order of
+  // the tuples. The column is valid until the set is modified.
+  const std::vector<int64>& Column(int col) const;
   // Returns the number of different values in the given column.
   int NumDifferentValuesInColumn(int col) const;
   // Return a copy of the set, sorted by the "col"-th value of each
@@ -115,17 +127,29 @@ class IntTupleSet {
     int64 Value(int index, int pos) const;
     int Arity() const;
     const int64* RawData() const;
+    const std::vector<int64>& Column(int col) const;
+    void Reserve(int num_tuples);
     void Clear();
 
    private:
+    // Returns the index of the tuple, or -1 if it is not in the set.
+    template <class T>
+    int Find(const std::vector<T>& candidate, int64 fingerprint) const;
+
     const int arity_;
-    int num_owners_;
+    std::atomic<int> num_owners_;
+    int num_tuples_;
     // Concatenation of all tuples ever added.
     std::vector<int64> flat_tuples_;
-    // Maps a tuple's fingerprint to the list of tuples with this
-    // fingerprint, represented by their start index in the
-    // flat_tuples_ vector.
-    hash_map<int64, std::vector<int> > tuple_fprint_to_index_;
+    // Maps a tuple's fingerprint to the last tuple with this fingerprint;
+    // the previous ones are chained by previous_with_same_fprint_, which
+    // is indexed by tuple and ends with -1.
+    hash_map<int64, int> tuple_fprint_to_index_;
+    std::vector<int> previous_with_same_fprint_;
+    // The tuples stored column by column, built by the first call to
+    // Column() after a modification.
+    mutable std::unique_ptr<std::vector<std::vector<int64> > > columns_;
+    mutable std::mutex columns_mutex_;
   };
 
   // Used to represent a light representation of a tuple.
@@ -147,13 +171,16 @@ class IntTupleSet {
 };
 
 // ----- Data -----
-inline IntTupleSet::Data::Data(int arity) : arity_(arity), num_owners_(0) {}
+inline IntTupleSet::Data::Data(int arity)
+    : arity_(arity), num_owners_(0), num_tuples_(0) {}
 
 inline IntTupleSet::Data::Data(const Data& data)
     : arity_(data.arity_),
       num_owners_(0),
+      num_tuples_(data.num_tuples_),
       flat_tuples_(data.flat_tuples_),
-      tuple_fprint_to_index_(data.tuple_fprint_to_index_) {}
+      tuple_fprint_to_index_(data.tuple_fprint_to_index_),
+      previous_with_same_fprint_(data.previous_with_same_fprint_) {}
 
 inline IntTupleSet::Data::~Data() {}
 
@@ -164,6 +191,8 @@ inline bool IntTupleSet::Data::RemovedSharedOwner() {
 }
 
 inline IntTupleSet::Data* IntTupleSet::Data::CopyIfShared() {
+  // The owner calling this is the only one allowed to modify its set, so
+  // if it is the only owner, no other owner can appear concurrently.
   if (num_owners_ > 1) {  // Copy on write.
     Data* const new_data = new Data(*this);
     RemovedSharedOwner();
@@ -178,20 +207,41 @@ int IntTupleSet::Data::Insert(const std::vector<T>& tuple) {
   DCHECK(arity_ == 0 || flat_tuples_.size() % arity_ == 0);
   CHECK_EQ(arity_, tuple.size());
   DCHECK_EQ(1, num_owners_);
-  if (!Contains(tuple)) {
-    const int index = NumTuples();
-    const int offset = flat_tuples_.size();
-    flat_tuples_.resize(offset + arity_);
-    // On mac os X, using this instead of push_back gives a 10x speedup!
-    for (int i = 0; i < arity_; ++i) {
-      flat_tuples_[offset + i] = tuple[i];
-    }
-    const int64 fingerprint = Fingerprint(tuple);
-    tuple_fprint_to_index_[fingerprint].push_back(index);
-    return index;
-  } else {
+  const int64 fingerprint = Fingerprint(tuple);
+  if (Find(tuple, fingerprint) != -1) {
     return -1;
   }
+  const int index = num_tuples_++;
+  const int offset = flat_tuples_.size();
+  flat_tuples_.resize(offset + arity_);
+  // On mac os X, using this instead of push_back gives a 10x speedup!
+  for (int i = 0; i < arity_; ++i) {
+    flat_tuples_[offset + i] = tuple[i];
+  }
+  const std::pair<hash_map<int64, int>::iterator, bool> inserted =
+      tuple_fprint_to_index_.insert(std::make_pair(fingerprint, index));
+  previous_with_same_fprint_.push_back(inserted.second ? -1
+                                                       : inserted.first->second);
+  inserted.first->second = index;
+  columns_.reset();
+  return index;
+}
+
+template <class T>
+int IntTupleSet::Data::Find(const std::vector<T>& candidate,
+                            int64 fingerprint) const {
+  const int* const last_index = FindOrNull(tuple_fprint_to_index_, fingerprint);
+  if (last_index == nullptr) {
+    return -1;
+  }
+  for (int tuple_index = *last_index; tuple_index != -1;
+       tuple_index = previous_with_same_fprint_[tuple_index]) {
+    const int64* const tuple = flat_tuples_.data() + tuple_index * arity_;
+    int j = 0;
+    while (j < arity_ && candidate[j] == tuple[j]) ++j;
+    if (j == arity_) return tuple_index;
+  }
+  return -1;
 }
 
 template <class T>
@@ -199,20 +249,7 @@ bool IntTupleSet::Data::Contains(const std::vector<T>& candidate) const {
   if (candidate.size() != arity_) {
     return false;
   }
-  const int64 fingerprint = Fingerprint(candidate);
-  if (ContainsKey(tuple_fprint_to_index_, fingerprint)) {
-    const std::vector<int>& indices = FindOrDie(tuple_fprint_to_index_, fingerprint);
-    for (int i = 0; i < indices.size(); ++i) {
-      const int tuple_index = indices[i];
-      for (int j = 0; j < arity_; ++j) {
-        if (candidate[j] != flat_tuples_[tuple_index * arity_ + j]) {
-          return false;
-        }
-      }
-      return true;
-    }
-  }
-  return false;
+  return Find(candidate, Fingerprint(candidate)) != -1;
 }
 
 template <class T>
@@ -242,9 +279,7 @@ int64 IntTupleSet::Data::Fingerprint(const std::vector<T>& tuple) const {
   }
 }
 
-inline int IntTupleSet::Data::NumTuples() const {
-  return tuple_fprint_to_index_.size();
-}
+inline int IntTupleSet::Data::NumTuples() const { return num_tuples_; }
 
 inline int64 IntTupleSet::Data::Value(int index, int pos) const {
   DCHECK_GE(index, 0);
@@ -260,9 +295,36 @@ inline const int64* IntTupleSet::Data::RawData() const {
   return flat_tuples_.data();
 }
 
+inline const std::vector<int64>& IntTupleSet::Data::Column(int col) const {
+  DCHECK_GE(col, 0);
+  DCHECK_LT(col, arity_);
+  std::lock_guard<std::mutex> lock(columns_mutex_);
+  if (columns_ == nullptr) {
+    columns_.reset(new std::vector<std::vector<int64> >(arity_));
+    for (int i = 0; i < arity_; ++i) {
+      (*columns_)[i].resize(num_tuples_);
+    }
+    for (int index = 0; index < num_tuples_; ++index) {
+      const int64* const tuple = flat_tuples_.data() + index * arity_;
+      for (int i = 0; i < arity_; ++i) {
+        (*columns_)[i][index] = tuple[i];
+      }
+    }
+  }
+  return (*columns_)[col];
+}
+
+inline void IntTupleSet::Data::Reserve(int num_tuples) {
+  flat_tuples_.reserve(num_tuples * arity_);
+  previous_with_same_fprint_.reserve(num_tuples);
+}
+
 inline void IntTupleSet::Data::Clear() {
+  num_tuples_ = 0;
   flat_tuples_.clear();
   tuple_fprint_to_index_.clear();
+  previous_with_same_fprint_.clear();
+  columns_.reset();
 }
 
 inline IntTupleSet::IntTupleSet(int arity) : data_(new Data(arity)) {
@@ -330,15 +392,17 @@ inline bool IntTupleSet::Contains(const std::vector<int64>& tuple) const {
 
 inline void IntTupleSet::InsertAll(const std::vector<std::vector<int> >& tuples) {
   data_ = data_->CopyIfShared();
+  data_->Reserve(data_->NumTuples() + tuples.size());
   for (int i = 0; i < tuples.size(); ++i) {
-    Insert(tuples[i]);
+    data_->Insert(tuples[i]);
   }
 }
 
 inline void IntTupleSet::InsertAll(const std::vector<std::vector<int64> >& tuples) {
   data_ = data_->CopyIfShared();
+  data_->Reserve(data_->NumTuples() + tuples.size());
   for (int i = 0; i < tuples.size(); ++i) {
-    Insert(tuples[i]);
+    data_->Insert(tuples[i]);
   }
 }
 
@@ -352,6 +416,10 @@ inline int IntTupleSet::Arity() const { return data_->Arity(); }
 
 inline const int64* IntTupleSet::RawData() const { return data_->RawData(); }
 
+inline const std::vector<int64>& IntTupleSet::Column(int col) const {
+  return data_->Column(col);
+}
+
 inline int IntTupleSet::NumDifferentValuesInColumn(int col) const {
   if (col < 0 || col >= data_->Arity()) {
     return 0;